@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,11 +12,14 @@
 #include "app/app.h"
 
 #include "app/app_mod.h"
+#include "app/cels_prefetcher.h"
 #include "app/check_update.h"
 #include "app/cli/app_options.h"
 #include "app/cli/cli_processor.h"
+#include "app/cli/cli_server.h"
 #include "app/cli/default_cli_delegate.h"
 #include "app/cli/preview_cli_delegate.h"
+#include "app/cold_cels_compressor.h"
 #include "app/color_spaces.h"
 #include "app/color_utils.h"
 #include "app/commands/commands.h"
@@ -31,6 +34,7 @@
 #include "app/i18n/strings.h"
 #include "app/ini_file.h"
 #include "app/log.h"
+#include "app/memory_budget.h"
 #include "app/modules.h"
 #include "app/modules/gfx.h"
 #include "app/modules/gui.h"
@@ -40,6 +44,7 @@
 #include "app/resource_finder.h"
 #include "app/send_crash.h"
 #include "app/site.h"
+#include "app/task_scheduler.h"
 #include "app/tools/active_tool.h"
 #include "app/tools/tool_box.h"
 #include "app/ui/backup_indicator.h"
@@ -55,11 +60,13 @@
 #include "app/ui/workspace.h"
 #include "app/ui_context.h"
 #include "app/util/clipboard.h"
+#include "base/chrono.h"
 #include "base/exception.h"
 #include "base/fs.h"
 #include "base/platform.h"
 #include "base/replace_string.h"
 #include "base/split_string.h"
+#include "doc/palette.h"
 #include "doc/sprite.h"
 #include "fmt/format.h"
 #include "os/error.h"
@@ -78,8 +85,12 @@
   #include "os/x11/system.h"
 #endif
 
+#include <functional>
+#include <future>
 #include <iostream>
 #include <memory>
+#include <utility>
+#include <vector>
 
 #ifdef ENABLE_SCRIPTING
   #include "app/script/engine.h"
@@ -118,6 +129,90 @@ private:
 
 #endif // ENABLER_SCRIPTING
 
+namespace {
+
+// Measures the time spent in each stage of App::initialize() to print
+// it with --startup-profile.
+class StartupProfile {
+public:
+  StartupProfile(const bool enabled) : m_enabled(enabled) { }
+
+  // Finishes the current stage
+  void stage(const char* name) {
+    if (!m_enabled)
+      return;
+    const double t = m_chrono.elapsed();
+    m_stages.emplace_back(name, t - m_last);
+    m_last = t;
+  }
+
+  // Adds a stage that was executed in a background thread (it's not
+  // included in the total time of the main thread)
+  void backgroundStage(const char* name, const double elapsed) {
+    if (!m_enabled)
+      return;
+    m_backgroundStages.emplace_back(name, elapsed);
+  }
+
+  void print() const {
+    if (!m_enabled)
+      return;
+    for (const auto& stage : m_stages)
+      std::cout << fmt::format("startup: {:<16} {:8.2f} ms\n",
+                               stage.first, stage.second * 1000.0);
+    for (const auto& stage : m_backgroundStages)
+      std::cout << fmt::format("startup: {:<16} {:8.2f} ms (background)\n",
+                               stage.first, stage.second * 1000.0);
+    std::cout << fmt::format("startup: {:<16} {:8.2f} ms\n",
+                             "total", m_last * 1000.0);
+    std::cout.flush();
+  }
+
+private:
+  bool m_enabled;
+  base::Chrono m_chrono;
+  double m_last = 0.0;
+  std::vector<std::pair<const char*, double>> m_stages;
+  std::vector<std::pair<const char*, double>> m_backgroundStages;
+};
+
+// Initialization stage that doesn't depend on the stages executed in
+// the main thread after it was started, so it runs in a TaskScheduler
+// thread in the meantime. finish() must be called before the stages
+// that depend on it.
+class StartupTask {
+public:
+  StartupTask(const char* name, std::function<void()>&& func)
+    : m_name(name)
+    , m_elapsed(0.0) {
+    m_future = TaskScheduler::instance().execute(
+      TaskPriority::Interactive,
+      [this, func = std::move(func)]{
+        base::Chrono chrono;
+        func();
+        m_elapsed = chrono.elapsed();
+      });
+  }
+
+  ~StartupTask() {
+    if (m_future.valid())
+      m_future.wait();
+  }
+
+  // Waits the task (re-throwing its exception if it failed)
+  void finish(StartupProfile& profile) {
+    m_future.get();
+    profile.backgroundStage(m_name, m_elapsed);
+  }
+
+private:
+  const char* m_name;
+  double m_elapsed;
+  std::future<void> m_future;
+};
+
+} // anonymous namespace
+
 class App::CoreModules {
 public:
 #ifdef ENABLE_UI
@@ -149,7 +244,8 @@ public:
   tools::ActiveToolManager m_activeToolManager;
   Commands m_commands;
 #ifdef ENABLE_UI
-  RecentFiles m_recent_files;
+  // Created on demand (it's not used in batch mode)
+  std::unique_ptr<RecentFiles> m_recent_files;
   InputChain m_inputChain;
   Clipboard m_clipboard;
 #endif
@@ -165,9 +261,6 @@ public:
     : m_loggerModule(createLogInDesktop)
     , m_loadLanguage(pref, m_extensions)
     , m_activeToolManager(&m_toolbox)
-#ifdef ENABLE_UI
-    , m_recent_files(pref.general.recentItems())
-#endif
 #ifdef ENABLE_DATA_RECOVERY
     , m_recovery(nullptr)
 #endif
@@ -250,8 +343,12 @@ App::App(AppMod* mod)
   , m_legacy(nullptr)
   , m_isGui(false)
   , m_isShell(false)
+  , m_isServer(false)
 #ifdef ENABLE_UI
   , m_backupIndicator(nullptr)
+  , m_celsPrefetcher(nullptr)
+  , m_coldCelsCompressor(nullptr)
+  , m_memoryBudget(nullptr)
 #endif
 #ifdef ENABLE_SCRIPTING
   , m_engine(new script::Engine)
@@ -264,6 +361,7 @@ App::App(AppMod* mod)
 int App::initialize(const AppOptions& options)
 {
   os::System* system = os::instance();
+  StartupProfile profile(options.startupProfile());
 
 #ifdef ENABLE_UI
   m_isGui = options.startUI() && !options.previewCLI();
@@ -271,6 +369,7 @@ int App::initialize(const AppOptions& options)
   m_isGui = false;
 #endif
   m_isShell = options.startShell();
+  m_isServer = options.startServer();
   m_coreModules = std::make_unique<CoreModules>();
 
 #if LAF_WINDOWS
@@ -321,6 +420,8 @@ int App::initialize(const AppOptions& options)
       break;
   }
 
+  profile.stage("system");
+
   initialize_color_spaces(preferences());
 
 #ifdef ENABLE_DRM
@@ -333,11 +434,41 @@ int App::initialize(const AppOptions& options)
     m_inAppSteam = false;
 #endif
 
+  profile.stage("color spaces");
+
+#ifdef ENABLE_UI
+  // User brushes don't depend on other modules, so they are loaded
+  // in background meanwhile the modules are initialized. In batch
+  // mode they are loaded on demand (see brushes()).
+  std::unique_ptr<StartupTask> brushesTask;
+  if (isGui()) {
+    brushesTask = std::make_unique<StartupTask>(
+      "brushes", [this]{ m_brushes = std::make_unique<AppBrushes>(); });
+  }
+#endif
+
   // Load modules
   m_modules = std::make_unique<Modules>(createLogInDesktop, preferences());
+  profile.stage("modules");
+
+  // The default palette file depends on the extensions only (to
+  // create it from an extension palette the first time), so it's
+  // read in background meanwhile the legacy modules are loaded.
+  std::unique_ptr<Palette> defaultPalette;
+  std::unique_ptr<StartupTask> paletteTask;
+  if (isGui()) {
+    paletteTask = std::make_unique<StartupTask>(
+      "palette file", [&defaultPalette]{ defaultPalette = read_default_palette(); });
+  }
+
   m_legacy = std::make_unique<LegacyModules>(isGui() ? REQUIRE_INTERFACE: 0);
+  profile.stage("legacy modules");
+
 #ifdef ENABLE_UI
-  m_brushes = std::make_unique<AppBrushes>();
+  if (brushesTask) {
+    brushesTask->finish(profile);
+    profile.stage("brushes");
+  }
 #endif
 
   // Data recovery is enabled only in GUI mode
@@ -348,8 +479,15 @@ int App::initialize(const AppOptions& options)
     LOG("APP: Running in portable mode\n");
 
   // Load or create the default palette, or migrate the default
-  // palette from an old format palette to the new one, etc.
-  load_default_palette();
+  // palette from an old format palette to the new one, etc. In batch
+  // mode it's loaded only if some command or script needs it.
+  if (isGui()) {
+    paletteTask->finish(profile);
+    load_default_palette(defaultPalette.get());
+    profile.stage("palette");
+  }
+  else
+    load_default_palette_lazily();
 
 #ifdef ENABLE_UI
   // Initialize GUI interface
@@ -378,6 +516,17 @@ int App::initialize(const AppOptions& options)
     if (preferences().general.dataRecovery())
       m_modules->searchDataRecoverySessions();
 
+    // Compress in memory the cels that are not used
+    if (preferences().experimental.compressColdCels())
+      m_coldCelsCompressor = std::make_unique<ColdCelsCompressor>();
+
+    // Release memory when the documents use more than the budget
+    m_memoryBudget = std::make_unique<MemoryBudget>();
+
+    // Load the cels that follow the playhead in lazy loading mode
+    if (preferences().experimental.lazyLoadCels())
+      m_celsPrefetcher = std::make_unique<CelsPrefetcher>();
+
     // Default status of the main window.
     app_rebuild_documents_tabs();
     m_mainWindow->statusBar()->showDefaultText();
@@ -400,6 +549,7 @@ int App::initialize(const AppOptions& options)
     const int scale = Preferences::instance().general.screenScale();
     manager->updateAllDisplaysWithNewScale(scale);
 #endif
+    profile.stage("gui");
   }
 #endif  // ENABLE_UI
 
@@ -407,8 +557,11 @@ int App::initialize(const AppOptions& options)
   // Call the init() function from all plugins
   LOG("APP: Initializing scripts...\n");
   extensions().executeInitActions();
+  profile.stage("scripts");
 #endif
 
+  profile.print();
+
   // Process options
   LOG("APP: Processing options...\n");
   int code;
@@ -578,6 +731,12 @@ void App::run()
   }
 #endif  // ENABLE_SCRIPTING
 
+  // Start the headless server to process requests from STDIN.
+  if (m_isServer) {
+    CliServer server(context());
+    server.run(std::cin, std::cout);
+  }
+
   // ----------------------------------------------------------------------
 
 #ifdef ENABLE_SCRIPTING
@@ -635,6 +794,9 @@ App::~App()
     Editor::destroyEditorSharedInternals();
 
     m_backupIndicator.reset();
+    m_celsPrefetcher.reset();
+    m_coldCelsCompressor.reset();
+    m_memoryBudget.reset();
 
     // Save brushes
     m_brushes.reset();
@@ -710,7 +872,11 @@ RecentFiles* App::recentFiles() const
 {
 #ifdef ENABLE_UI
   ASSERT(m_modules != NULL);
-  return &m_modules->m_recent_files;
+  if (!m_modules->m_recent_files) {
+    m_modules->m_recent_files =
+      std::make_unique<RecentFiles>(preferences().general.recentItems());
+  }
+  return m_modules->m_recent_files.get();
 #else
   return nullptr;
 #endif
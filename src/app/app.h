@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -40,6 +40,8 @@ namespace app {
   class AppMod;
   class AppOptions;
   class BackupIndicator;
+  class CelsPrefetcher;
+  class ColdCelsCompressor;
   class Context;
   class ContextBar;
   class Doc;
@@ -49,6 +51,7 @@ namespace app {
   class LegacyModules;
   class LoggerModule;
   class MainWindow;
+  class MemoryBudget;
   class Preferences;
   class RecentFiles;
   class Timeline;
@@ -103,7 +106,10 @@ namespace app {
 
 #ifdef ENABLE_UI
     AppBrushes& brushes() {
-      ASSERT(m_brushes.get());
+      // In batch mode user brushes are loaded the first time they
+      // are needed
+      if (!m_brushes)
+        m_brushes = std::make_unique<AppBrushes>();
       return *m_brushes;
     }
 
@@ -142,6 +148,7 @@ namespace app {
     std::unique_ptr<LegacyModules> m_legacy;
     bool m_isGui;
     bool m_isShell;
+    bool m_isServer;
 #ifdef ENABLE_STEAM
     bool m_inAppSteam = true;
 #endif
@@ -150,6 +157,9 @@ namespace app {
 #ifdef ENABLE_UI
     std::unique_ptr<AppBrushes> m_brushes;
     std::unique_ptr<BackupIndicator> m_backupIndicator;
+    std::unique_ptr<CelsPrefetcher> m_celsPrefetcher;
+    std::unique_ptr<ColdCelsCompressor> m_coldCelsCompressor;
+    std::unique_ptr<MemoryBudget> m_memoryBudget;
 #endif // ENABLE_UI
 #ifdef ENABLE_SCRIPTING
     std::unique_ptr<script::Engine> m_engine;
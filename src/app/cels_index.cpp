@@ -0,0 +1,232 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cels_index.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "app/doc_undo.h"
+#include "doc/cel.h"
+#include "doc/layer.h"
+#include "doc/render_plan.h"
+#include "doc/sprite.h"
+
+#include <cmath>
+
+namespace app {
+
+using namespace doc;
+
+namespace {
+
+// Integer rectangle that contains all the pixels touched by the cel
+// (reference layers can have cels with sub-pixel bounds).
+gfx::Rect cel_pick_bounds(const Cel* cel)
+{
+  if (!cel->layer()->isReference())
+    return cel->bounds();
+
+  const gfx::RectF& bounds = cel->boundsF();
+  const int x1 = int(std::floor(bounds.x));
+  const int y1 = int(std::floor(bounds.y));
+  const int x2 = int(std::ceil(bounds.x2()));
+  const int y2 = int(std::ceil(bounds.y2()));
+  return gfx::Rect(x1, y1, x2-x1, y2-y1);
+}
+
+} // anonymous namespace
+
+CelsIndex::CelsIndex(Doc* doc)
+  : m_doc(doc)
+{
+  m_doc->add_observer(this);
+  m_doc->undoHistory()->add_observer(this);
+}
+
+CelsIndex::~CelsIndex()
+{
+  m_doc->undoHistory()->remove_observer(this);
+  m_doc->remove_observer(this);
+}
+
+void CelsIndex::pick(const frame_t frame,
+                     const gfx::PointF& pos,
+                     CelList& cels)
+{
+  const Sprite* sprite = m_doc->sprite();
+  if (!sprite)
+    return;
+
+  auto it = m_frames.find(frame);
+  if (it == m_frames.end()) {
+    RenderPlan plan;
+    plan.addLayer(sprite->root(), frame);
+
+    // From the front-most to the bottom-most cel
+    Frame data;
+    std::vector<gfx::Rect> bounds;
+    const auto& planItems = plan.items();
+    for (auto jt=planItems.rbegin(), end=planItems.rend(); jt!=end; ++jt) {
+      const Cel* cel = jt->cel;
+      if (cel && cel->image()) {
+        data.cels.push_back(const_cast<Cel*>(cel));
+        bounds.push_back(cel_pick_bounds(cel));
+      }
+    }
+    data.index = RectIndex(bounds);
+
+    it = m_frames.emplace(frame, std::move(data)).first;
+  }
+
+  const Frame& data = it->second;
+  std::vector<int> found;
+  data.index.pick(gfx::Rect(int(std::floor(pos.x)),
+                            int(std::floor(pos.y)), 1, 1), found);
+  for (int i : found)
+    cels.push_back(data.cels[i]);
+}
+
+void CelsIndex::resetFrame(const frame_t frame)
+{
+  m_frames.erase(frame);
+}
+
+void CelsIndex::resetCel(const DocEvent& ev)
+{
+  const Cel* cel = ev.cel();
+  if (!cel) {
+    reset();
+    return;
+  }
+
+  // Linked cels share their bounds with cels in other frames
+  if (cel->links() > 0)
+    reset();
+  else
+    resetFrame(cel->frame());
+}
+
+void CelsIndex::reset()
+{
+  m_frames.clear();
+}
+
+void CelsIndex::onGeneralUpdate(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onPixelFormatChanged(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onAddLayer(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onAddFrame(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onAddCel(DocEvent& ev)
+{
+  resetCel(ev);
+}
+
+void CelsIndex::onAfterRemoveLayer(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onRemoveFrame(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onBeforeRemoveCel(DocEvent& ev)
+{
+  resetCel(ev);
+}
+
+void CelsIndex::onSpriteSizeChanged(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onSpriteGridBoundsChanged(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onLayerRestacked(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onLayerMergedDown(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onCelMoved(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onCelCopied(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onCelFrameChanged(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onCelPositionChanged(DocEvent& ev)
+{
+  resetCel(ev);
+}
+
+void CelsIndex::onCelZIndexChange(DocEvent& ev)
+{
+  resetCel(ev);
+}
+
+void CelsIndex::onTilesetChanged(DocEvent& ev)
+{
+  reset();
+}
+
+void CelsIndex::onAfterLayerVisibilityChange(DocEvent& ev)
+{
+  reset();
+}
+
+// Some commands modify the cel bounds without a specific
+// notification (e.g. cmd::ReplaceImage when the cel canvas is
+// expanded to draw outside the cel), so we discard the whole index
+// each time the undo history changes (a transaction is committed,
+// or the user undoes/redoes).
+
+void CelsIndex::onAddUndoState(DocUndo* history)
+{
+  reset();
+}
+
+void CelsIndex::onCurrentUndoStateChange(DocUndo* history)
+{
+  reset();
+}
+
+} // namespace app
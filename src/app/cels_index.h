@@ -0,0 +1,86 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CELS_INDEX_H_INCLUDED
+#define APP_CELS_INDEX_H_INCLUDED
+#pragma once
+
+#include "app/doc_observer.h"
+#include "app/doc_undo_observer.h"
+#include "doc/cel_list.h"
+#include "doc/frame.h"
+#include "doc/rect_index.h"
+#include "gfx/point.h"
+
+#include <map>
+
+namespace app {
+  class Doc;
+
+  // Index of the bounds of the cels of visible layers in each frame,
+  // so we can find the cels under the mouse (e.g. to select the
+  // layer with the Move tool or pick a color from the composition)
+  // without iterating all layers.
+  //
+  // The index of each frame is created the first time it's used, and
+  // it's discarded when the document notifies a change that can
+  // modify the bounds, the visibility, or the order of its cels.
+  class CelsIndex : public DocObserver,
+                    public DocUndoObserver {
+  public:
+    CelsIndex(Doc* doc);
+    ~CelsIndex();
+
+    // Adds to "cels" the cels of visible layers in the given frame
+    // whose bounds could contain the given position, from the
+    // front-most to the bottom-most one. Then Sprite::pickCels() can
+    // be used to check the pixels of these cels.
+    void pick(doc::frame_t frame,
+              const gfx::PointF& pos,
+              doc::CelList& cels);
+
+  private:
+    struct Frame {
+      doc::CelList cels;
+      doc::RectIndex index;
+    };
+
+    void resetFrame(doc::frame_t frame);
+    void resetCel(const DocEvent& ev);
+    void reset();
+
+    // DocObserver impl
+    void onGeneralUpdate(DocEvent& ev) override;
+    void onPixelFormatChanged(DocEvent& ev) override;
+    void onAddLayer(DocEvent& ev) override;
+    void onAddFrame(DocEvent& ev) override;
+    void onAddCel(DocEvent& ev) override;
+    void onAfterRemoveLayer(DocEvent& ev) override;
+    void onRemoveFrame(DocEvent& ev) override;
+    void onBeforeRemoveCel(DocEvent& ev) override;
+    void onSpriteSizeChanged(DocEvent& ev) override;
+    void onSpriteGridBoundsChanged(DocEvent& ev) override;
+    void onLayerRestacked(DocEvent& ev) override;
+    void onLayerMergedDown(DocEvent& ev) override;
+    void onCelMoved(DocEvent& ev) override;
+    void onCelCopied(DocEvent& ev) override;
+    void onCelFrameChanged(DocEvent& ev) override;
+    void onCelPositionChanged(DocEvent& ev) override;
+    void onCelZIndexChange(DocEvent& ev) override;
+    void onTilesetChanged(DocEvent& ev) override;
+    void onAfterLayerVisibilityChange(DocEvent& ev) override;
+
+    // DocUndoObserver impl
+    void onAddUndoState(DocUndo* history) override;
+    void onCurrentUndoStateChange(DocUndo* history) override;
+
+    Doc* m_doc;
+    std::map<doc::frame_t, Frame> m_frames;
+  };
+
+} // namespace app
+
+#endif
@@ -0,0 +1,89 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cels_prefetcher.h"
+
+#include "app/doc.h"
+#include "app/site.h"
+#include "app/ui_context.h"
+#include "doc/cel.h"
+#include "doc/cels_range.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+
+#include <algorithm>
+
+namespace app {
+
+using namespace doc;
+
+// Check the active frame each 100 milliseconds and load the cels of
+// the next 8 frames (the loaded images are not counted, so it's
+// cheap to check them again).
+static const int kCheckInterval = 100;
+static const frame_t kFramesAhead = 8;
+
+CelsPrefetcher::CelsPrefetcher()
+  : m_timer(kCheckInterval)
+  , m_pending(0)
+  , m_pool(1)
+{
+  m_timer.Tick.connect([this]{ onTick(); });
+  m_timer.start();
+}
+
+CelsPrefetcher::~CelsPrefetcher()
+{
+  m_timer.stop();
+}
+
+void CelsPrefetcher::onTick()
+{
+  // Wait the previous images to be loaded
+  if (m_pending > 0)
+    return;
+
+  const Site site = UIContext::instance()->activeSite();
+  if (Doc* doc = site.document())
+    prefetchDoc(doc, site.frame());
+}
+
+void CelsPrefetcher::prefetchDoc(Doc* doc, const frame_t fromFrame)
+{
+  // We don't want to wait if the document is being modified
+  const Doc::LockResult res = doc->readLock(0);
+  if (res == Doc::LockResult::Fail)
+    return;
+
+  const Sprite* sprite = doc->sprite();
+  const frame_t nframes = std::min(kFramesAhead, sprite->totalFrames());
+
+  // Frames that follow the playhead (looping to the first frame)
+  for (frame_t i=0; i<nframes; ++i) {
+    const frame_t frame = (fromFrame + i) % sprite->totalFrames();
+    for (Cel* cel : sprite->cels(frame)) {
+      if (!cel->image()->hasBitsLoader())
+        continue;
+
+      // The ImageRef keeps the image alive even if the cel is
+      // deleted or the document is closed while it's loaded
+      ImageRef image = cel->imageRef();
+      ++m_pending;
+      m_pool.execute([this, image]{
+        image->prefetchBits();
+        --m_pending;
+      });
+    }
+  }
+
+  doc->unlock(res);
+}
+
+} // namespace app
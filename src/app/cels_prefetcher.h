@@ -0,0 +1,41 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CELS_PREFETCHER_H_INCLUDED
+#define APP_CELS_PREFETCHER_H_INCLUDED
+#pragma once
+
+#include "base/thread_pool.h"
+#include "doc/frame.h"
+#include "ui/timer.h"
+
+#include <atomic>
+
+namespace app {
+  class Doc;
+
+  // Loads in a background thread the pixels of the cels that are
+  // still in the original file (lazy loading mode, see
+  // doc::Image::setBitsLoader()) in the frames that follow the active
+  // frame, so they are ready when the user navigates or plays the
+  // animation.
+  class CelsPrefetcher {
+  public:
+    CelsPrefetcher();
+    ~CelsPrefetcher();
+
+  private:
+    void onTick();
+    void prefetchDoc(Doc* doc, const doc::frame_t fromFrame);
+
+    ui::Timer m_timer;
+    std::atomic<int> m_pending;
+    base::thread_pool m_pool;
+  };
+
+} // namespace app
+
+#endif
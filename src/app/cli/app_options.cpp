@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -11,8 +11,10 @@
 
 #include "app/cli/app_options.h"
 
+#include "base/convert_to.h"
 #include "base/fs.h"
 
+#include <algorithm>
 #include <iostream>
 
 namespace app {
@@ -21,6 +23,7 @@ AppOptions::AppOptions(int argc, const char* argv[])
   : m_exeName(base::get_file_name(argv[0]))
   , m_startUI(true)
   , m_startShell(false)
+  , m_startServer(false)
   , m_previewCLI(false)
   , m_showHelp(false)
   , m_showVersion(false)
@@ -29,11 +32,14 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_shell(m_po.add("shell").description("Start an interactive console to execute scripts"))
 #endif
   , m_batch(m_po.add("batch").mnemonic('b').description("Do not start the UI"))
+  , m_server(m_po.add("server").description("Start a headless server that processes\nJSON requests from STDIN (one per line)"))
   , m_preview(m_po.add("preview").mnemonic('p').description("Do not execute actions, just print what will be\ndone"))
+  , m_jobs(m_po.add("jobs").requiresValue("<n>").description("Load the given files in batch mode using\nn threads (files are processed in order)"))
+  , m_cacheDir(m_po.add("cache-dir").requiresValue("<dir>").description("Store the output files in the given folder\nand copy them from there when the same\narguments and input files are used again"))
   , m_saveAs(m_po.add("save-as").requiresValue("<filename>").description("Save the last given sprite with other format"))
   , m_palette(m_po.add("palette").requiresValue("<filename>").description("Change the palette of the last given sprite"))
   , m_scale(m_po.add("scale").requiresValue("<factor>").description("Resize all previously opened sprites"))
-  , m_ditheringAlgorithm(m_po.add("dithering-algorithm").requiresValue("<algorithm>").description("Dithering algorithm used in --color-mode\nto convert images from RGB to Indexed\n  none\n  ordered\n  old"))
+  , m_ditheringAlgorithm(m_po.add("dithering-algorithm").alias("dithering").requiresValue("<algorithm>").description("Dithering algorithm used in --color-mode\nto convert images from RGB to Indexed\n  none\n  ordered\n  old\n  error-diffusion"))
   , m_ditheringMatrix(m_po.add("dithering-matrix").requiresValue("<id>").description("Matrix used in ordered dithering algorithm\n  bayer2x2\n  bayer4x4\n  bayer8x8\n  filename.png"))
   , m_colorMode(m_po.add("color-mode").requiresValue("<mode>").description("Change color mode of all previously\nopened sprites:\n  rgb\n  grayscale\n  indexed"))
   , m_shrinkTo(m_po.add("shrink-to").requiresValue("width,height").description("Shrink each sprite if it is\nlarger than width or height"))
@@ -56,6 +62,9 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_tag(m_po.add("tag").alias("frame-tag").requiresValue("<name>").description("Include tagged frames in the sheet"))
   , m_frameRange(m_po.add("frame-range").requiresValue("from,to").description("Only export frames in the [from,to] range"))
   , m_ignoreEmpty(m_po.add("ignore-empty").description("Do not export empty frames/cels"))
+  , m_compressionLevel(m_po.add("compression-level").requiresValue("<level>").description("Compression level of .aseprite files from\n0 (faster) to 9 (smaller)"))
+  , m_linkIdenticalCels(m_po.add("link-identical-cels").description("Save identical cels of the same layer as\nlinked cels in .aseprite files"))
+  , m_pngPreset(m_po.add("png-preset").requiresValue("<preset>").description("Encode .png files with the fast, default, or\nsmall preset (speed vs file size)"))
   , m_mergeDuplicates(m_po.add("merge-duplicates").description("Merge all duplicate frames into one in the sprite sheet"))
   , m_borderPadding(m_po.add("border-padding").requiresValue("<value>").description("Add padding on the texture borders"))
   , m_shapePadding(m_po.add("shape-padding").requiresValue("<value>").description("Add padding between frames"))
@@ -64,6 +73,8 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_trimSprite(m_po.add("trim-sprite").description("Trim the whole sprite (for --save-as and --sheet)"))
   , m_trimByGrid(m_po.add("trim-by-grid").description("Trim all images by its correspondent grid boundaries before exporting"))
   , m_extrude(m_po.add("extrude").description("Extrude all images duplicating all edges one pixel"))
+  , m_sheetMaxSize(m_po.add("sheet-max-size").requiresValue("width,height").description("Split a packed sheet in several pages\n(textures) of the given maximum size"))
+  , m_sheetCache(m_po.add("sheet-cache").requiresValue("<dir>").description("Keep the trimmed frames of --sheet in the\ngiven folder to re-export only modified frames"))
   , m_crop(m_po.add("crop").requiresValue("x,y,width,height").description("Crop all the images to the given rectangle"))
   , m_slice(m_po.add("slice").requiresValue("<name>").description("Crop the sprite to the given slice area"))
   , m_filenameFormat(m_po.add("filename-format").requiresValue("<fmt>").description("Special format to generate filenames"))
@@ -79,6 +90,10 @@ AppOptions::AppOptions(int argc, const char* argv[])
   , m_exportTileset(m_po.add("export-tileset").description("Export only tilesets from visible tilemap layers"))
   , m_verbose(m_po.add("verbose").mnemonic('v').description("Explain what is being done"))
   , m_debug(m_po.add("debug").description("Extreme verbose mode and\ncopy log to desktop"))
+  , m_startupProfile(m_po.add("startup-profile").description("Print the time spent initializing each\npart of the program"))
+  , m_profile(m_po.add("profile").description("Print the time spent in each phase (decode,\nrender, quantize, encode, etc.) per file"))
+  , m_profileTrace(m_po.add("profile-trace").requiresValue("<filename.json>").description("Same as --profile and save the events in\nthe Chrome trace event format"))
+  , m_profileMemory(m_po.add("profile-memory").description("Same as --profile and print the number of\nallocations, allocated bytes, and peak of\nmemory in each phase"))
 #ifdef ENABLE_STEAM
   , m_noInApp(m_po.add("noinapp").description("Disable \"in game\" visibility on Steam\nDoesn't count playtime"))
 #endif
@@ -99,11 +114,13 @@ AppOptions::AppOptions(int argc, const char* argv[])
 #ifdef ENABLE_SCRIPTING
     m_startShell = m_po.enabled(m_shell);
 #endif
+    m_startServer = m_po.enabled(m_server);
     m_previewCLI = m_po.enabled(m_preview);
     m_showHelp = m_po.enabled(m_help);
     m_showVersion = m_po.enabled(m_version);
 
     if (m_startShell ||
+        m_startServer ||
         m_showHelp ||
         m_showVersion ||
         m_po.enabled(m_batch)) {
@@ -117,6 +134,25 @@ AppOptions::AppOptions(int argc, const char* argv[])
   }
 }
 
+int AppOptions::jobs() const
+{
+  if (m_po.enabled(m_jobs))
+    return std::max(1, base::convert_to<int>(m_po.value_of(m_jobs)));
+  return 1;
+}
+
+std::string AppOptions::cacheDir() const
+{
+  if (m_po.enabled(m_cacheDir))
+    return m_po.value_of(m_cacheDir);
+  return std::string();
+}
+
+bool AppOptions::profileMemory() const
+{
+  return m_po.enabled(m_profileMemory);
+}
+
 bool AppOptions::hasExporterParams() const
 {
   return
@@ -124,6 +160,26 @@ bool AppOptions::hasExporterParams() const
     m_po.enabled(m_sheet);
 }
 
+bool AppOptions::startupProfile() const
+{
+  return m_po.enabled(m_startupProfile);
+}
+
+bool AppOptions::profile() const
+{
+  return
+    m_po.enabled(m_profile) ||
+    m_po.enabled(m_profileTrace) ||
+    m_po.enabled(m_profileMemory);
+}
+
+std::string AppOptions::profileTrace() const
+{
+  if (m_po.enabled(m_profileTrace))
+    return m_po.value_of(m_profileTrace);
+  return std::string();
+}
+
 #ifdef ENABLE_STEAM
 bool AppOptions::noInApp() const
 {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -36,6 +36,7 @@ public:
 
   bool startUI() const { return m_startUI; }
   bool startShell() const { return m_startShell; }
+  bool startServer() const { return m_startServer; }
   bool previewCLI() const { return m_previewCLI; }
   bool showHelp() const { return m_showHelp; }
   bool showVersion() const { return m_showVersion; }
@@ -72,6 +73,9 @@ public:
   const Option& tag() const { return m_tag; }
   const Option& frameRange() const { return m_frameRange; }
   const Option& ignoreEmpty() const { return m_ignoreEmpty; }
+  const Option& compressionLevel() const { return m_compressionLevel; }
+  const Option& linkIdenticalCels() const { return m_linkIdenticalCels; }
+  const Option& pngPreset() const { return m_pngPreset; }
   const Option& mergeDuplicates() const { return m_mergeDuplicates; }
   const Option& borderPadding() const { return m_borderPadding; }
   const Option& shapePadding() const { return m_shapePadding; }
@@ -80,6 +84,8 @@ public:
   const Option& trimSprite() const { return m_trimSprite; }
   const Option& trimByGrid() const { return m_trimByGrid; }
   const Option& extrude() const { return m_extrude; }
+  const Option& sheetMaxSize() const { return m_sheetMaxSize; }
+  const Option& sheetCache() const { return m_sheetCache; }
   const Option& crop() const { return m_crop; }
   const Option& slice() const { return m_slice; }
   const Option& filenameFormat() const { return m_filenameFormat; }
@@ -94,7 +100,19 @@ public:
   const Option& oneFrame() const { return m_oneFrame; }
   const Option& exportTileset() const { return m_exportTileset; }
 
+  // Number of threads to load files in batch mode (--jobs)
+  int jobs() const;
+
+  // Folder to cache the output files (--cache-dir)
+  std::string cacheDir() const;
+
   bool hasExporterParams() const;
+  bool startupProfile() const;
+
+  // --profile, --profile-trace <filename.json>, and --profile-memory
+  bool profile() const;
+  std::string profileTrace() const;
+  bool profileMemory() const;
 #ifdef ENABLE_STEAM
   bool noInApp() const;
 #endif
@@ -109,6 +127,7 @@ private:
   base::ProgramOptions m_po;
   bool m_startUI;
   bool m_startShell;
+  bool m_startServer;
   bool m_previewCLI;
   bool m_showHelp;
   bool m_showVersion;
@@ -118,7 +137,10 @@ private:
   Option& m_shell;
 #endif
   Option& m_batch;
+  Option& m_server;
   Option& m_preview;
+  Option& m_jobs;
+  Option& m_cacheDir;
   Option& m_saveAs;
   Option& m_palette;
   Option& m_scale;
@@ -145,6 +167,9 @@ private:
   Option& m_tag;
   Option& m_frameRange;
   Option& m_ignoreEmpty;
+  Option& m_compressionLevel;
+  Option& m_linkIdenticalCels;
+  Option& m_pngPreset;
   Option& m_mergeDuplicates;
   Option& m_borderPadding;
   Option& m_shapePadding;
@@ -153,6 +178,8 @@ private:
   Option& m_trimSprite;
   Option& m_trimByGrid;
   Option& m_extrude;
+  Option& m_sheetMaxSize;
+  Option& m_sheetCache;
   Option& m_crop;
   Option& m_slice;
   Option& m_filenameFormat;
@@ -169,6 +196,10 @@ private:
 
   Option& m_verbose;
   Option& m_debug;
+  Option& m_startupProfile;
+  Option& m_profile;
+  Option& m_profileTrace;
+  Option& m_profileMemory;
 #ifdef ENABLE_STEAM
   Option& m_noInApp;
 #endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2016-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -40,6 +40,9 @@ namespace app {
     bool listTags = false;
     bool listSlices = false;
     bool ignoreEmpty = false;
+    int compressionLevel = -1;
+    bool linkIdenticalCels = false;
+    std::string pngPreset;
     bool trim = false;
     bool trimByGrid = false;
     bool oneFrame = false;
@@ -0,0 +1,257 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cli/cli_output_cache.h"
+
+#include "app/cli/app_options.h"
+#include "app/file/split_filename.h"
+#include "base/debug.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "fmt/format.h"
+#include "ver/info.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace app {
+
+// Increment this version when the layout of the cache folder or the
+// way the keys are calculated changes
+static const int kCacheVersion = 1;
+
+namespace {
+
+// FNV-1a hash (same as the one used in SheetSampleCache), it must
+// give the same result in each execution of the program
+class KeyHasher {
+public:
+  void add(const void* data, const size_t n) {
+    auto p = (const uint8_t*)data;
+    for (size_t i=0; i<n; ++i) {
+      m_value ^= p[i];
+      m_value *= 1099511628211ull;
+    }
+  }
+
+  void add(const int value) {
+    const int32_t v = value;
+    add(&v, sizeof(v));
+  }
+
+  void add(const std::string& str) {
+    add(int(str.size()));
+    add(str.c_str(), str.size());
+  }
+
+  void addFileContent(const std::string& filename) {
+    add(filename);
+
+    std::ifstream f(FSTREAM_PATH(filename), std::ios::binary);
+    if (!f) {
+      add(-1);
+      return;
+    }
+
+    std::vector<char> buf(64*1024);
+    while (f) {
+      f.read(buf.data(), buf.size());
+      add(buf.data(), size_t(f.gcount()));
+    }
+  }
+
+  uint64_t value() const { return m_value; }
+
+private:
+  uint64_t m_value = 14695981039346656037ull;
+};
+
+// Adds the given input file and all the other files that could be
+// loaded with it (the rest of the sequence and the .aseprite-data
+// file, the same files used by FileOp::createLoadDocumentOperation())
+void add_input_file(KeyHasher& h, const std::string& filename)
+{
+  h.addFileContent(filename);
+
+  std::string left, right;
+  int width;
+  const int start_from = split_filename(filename, left, right, width);
+  if (start_from >= 0) {
+    for (int c=start_from+1; ; ++c) {
+      const std::string fn = fmt::format("{0}{1:0{2}d}{3}", left, c, width, right);
+      if (!base::is_file(fn))
+        break;
+      h.addFileContent(fn);
+    }
+  }
+
+  const std::string dataFilename = base::replace_extension(filename, "aseprite-data");
+  if (base::is_file(dataFilename))
+    h.addFileContent(dataFilename);
+}
+
+bool copy_file(const std::string& from, const std::string& to)
+{
+  std::ifstream src(FSTREAM_PATH(from), std::ios::binary);
+  if (!src)
+    return false;
+
+  const std::string dir = base::get_file_path(to);
+  if (!dir.empty() && !base::is_directory(dir))
+    base::make_all_directories(dir);
+
+  std::ofstream dst(FSTREAM_PATH(to), std::ios::binary);
+  if (!dst)
+    return false;
+
+  dst << src.rdbuf();
+  return bool(dst);
+}
+
+} // anonymous namespace
+
+CliOutputCache* CliOutputCache::m_instance = nullptr;
+
+// static
+bool CliOutputCache::canCache(const AppOptions& options)
+{
+  const auto& po = options.programOptions();
+
+  // Outputs printed in the STDOUT or generated by scripts cannot be
+  // restored
+  if (options.previewCLI() ||
+      options.startShell() ||
+      options.profile() ||
+#ifdef ENABLE_SCRIPTING
+      po.enabled(options.script()) ||
+#endif
+      (po.enabled(options.sheet()) && !po.enabled(options.data())) ||
+      (!po.enabled(options.data()) &&
+       (po.enabled(options.listLayers()) ||
+        po.enabled(options.listTags()) ||
+        po.enabled(options.listSlices())))) {
+    return false;
+  }
+  return true;
+}
+
+// static
+void CliOutputCache::notifySavedFile(const std::string& filename)
+{
+  if (CliOutputCache* cache = m_instance) {
+    const std::string fn = base::get_absolute_path(filename);
+
+    const std::lock_guard lock(cache->m_mutex);
+    if (std::find(cache->m_outputs.begin(),
+                  cache->m_outputs.end(), fn) == cache->m_outputs.end())
+      cache->m_outputs.push_back(fn);
+  }
+}
+
+// static
+void CliOutputCache::notifyError()
+{
+  if (CliOutputCache* cache = m_instance) {
+    const std::lock_guard lock(cache->m_mutex);
+    cache->m_error = true;
+  }
+}
+
+CliOutputCache::CliOutputCache(const std::string& dir,
+                               const AppOptions& options)
+  : m_dir(dir)
+  , m_error(false)
+{
+  KeyHasher h;
+  h.add(kCacheVersion);
+  h.add(std::string(get_app_version()));
+  // Relative output filenames depend on the current path
+  h.add(base::get_current_path());
+
+  for (const auto& value : options.values()) {
+    const AppOptions::Option* opt = value.option();
+    if (opt) {
+      h.add(opt->name());
+      h.add(value.value());
+
+      // Options that read other files
+      if ((opt == &options.palette() ||
+           opt == &options.ditheringMatrix()) &&
+          base::is_file(value.value())) {
+        h.addFileContent(value.value());
+      }
+    }
+    else {
+      h.add(-1);
+      add_input_file(h, value.value());
+    }
+  }
+  m_key = h.value();
+
+  ASSERT(m_instance == nullptr);
+  m_instance = this;
+}
+
+CliOutputCache::~CliOutputCache()
+{
+  ASSERT(m_instance == this);
+  m_instance = nullptr;
+}
+
+bool CliOutputCache::restore()
+{
+  std::ifstream manifest(FSTREAM_PATH(manifestFilename()));
+  if (!manifest)
+    return false;
+
+  std::string fn;
+  for (int i=0; std::getline(manifest, fn); ++i) {
+    if (fn.empty())
+      continue;
+    if (!copy_file(base::join_path(entryDir(), fmt::format("{}", i)), fn))
+      return false;
+  }
+  return true;
+}
+
+void CliOutputCache::store()
+{
+  const std::lock_guard lock(m_mutex);
+  if (m_error || m_outputs.empty())
+    return;
+
+  const std::string dir = entryDir();
+  if (!base::is_directory(dir))
+    base::make_all_directories(dir);
+
+  int i = 0;
+  for (const auto& fn : m_outputs) {
+    if (!copy_file(fn, base::join_path(dir, fmt::format("{}", i++))))
+      return;
+  }
+
+  // The manifest is written at the end, so an incomplete entry is
+  // never restored
+  std::ofstream manifest(FSTREAM_PATH(manifestFilename()));
+  for (const auto& fn : m_outputs)
+    manifest << fn << '\n';
+}
+
+std::string CliOutputCache::entryDir() const
+{
+  return base::join_path(m_dir, fmt::format("{:016x}", m_key));
+}
+
+std::string CliOutputCache::manifestFilename() const
+{
+  return base::join_path(entryDir(), "manifest.txt");
+}
+
+} // namespace app
@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CLI_CLI_OUTPUT_CACHE_H_INCLUDED
+#define APP_CLI_CLI_OUTPUT_CACHE_H_INCLUDED
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace app {
+
+  class AppOptions;
+
+  // Keeps the files generated by the CLI in a folder (--cache-dir)
+  // indexed by a key calculated from the program version, the CLI
+  // arguments, and the content of the input files. When the same
+  // command is executed again with the same inputs, the outputs are
+  // copied from the cache without loading or saving any sprite.
+  class CliOutputCache {
+  public:
+    // Returns nullptr if there is no active cache.
+    static CliOutputCache* instance() { return m_instance; }
+
+    // Returns false if the output of the given options cannot be
+    // cached (e.g. if something is printed in the STDOUT or a script
+    // is executed).
+    static bool canCache(const AppOptions& options);
+
+    // Called by FileOp/DocExporter (from any thread) when a file is
+    // written, or when there is an error, so the outputs of this
+    // execution are not stored.
+    static void notifySavedFile(const std::string& filename);
+    static void notifyError();
+
+    CliOutputCache(const std::string& dir,
+                   const AppOptions& options);
+    ~CliOutputCache();
+
+    // Copies the outputs of a previous execution with the same key
+    // to their original locations. Returns false if there is no
+    // entry for this key (or some output couldn't be restored).
+    bool restore();
+
+    // Copies the files saved in this execution to the cache.
+    void store();
+
+  private:
+    std::string entryDir() const;
+    std::string manifestFilename() const;
+
+    static CliOutputCache* m_instance;
+    std::string m_dir;
+    uint64_t m_key;
+    std::mutex m_mutex;
+    std::vector<std::string> m_outputs;
+    bool m_error;
+  };
+
+} // namespace app
+
+#endif
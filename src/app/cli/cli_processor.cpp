@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,8 @@
 #include "app/doc_exporter.h"
 #include "app/doc_undo.h"
 #include "app/file/file.h"
+#include "app/file/file_preloader.h"
+#include "app/file/file_save_queue.h"
 #include "app/filename_formatter.h"
 #include "app/restore_visible_layers.h"
 #include "app/ui_context.h"
@@ -36,7 +38,9 @@
 #include "render/dithering_algorithm.h"
 
 #include <algorithm>
+#include <iostream>
 #include <queue>
+#include <thread>
 #include <vector>
 
 namespace app {
@@ -182,6 +186,16 @@ CliProcessor::CliProcessor(CliDelegate* delegate,
 
 int CliProcessor::process(Context* ctx)
 {
+  // --cache-dir <dir>: skip the whole processing if the outputs of
+  // the same arguments/input files are in the cache
+  if (!m_options.cacheDir().empty() &&
+      !m_options.values().empty() &&
+      !ctx->isUIAvailable() &&
+      CliOutputCache::canCache(m_options)) {
+    m_cache = std::make_unique<CliOutputCache>(m_options.cacheDir(),
+                                               m_options);
+  }
+
   // --help
   if (m_options.showHelp()) {
     m_delegate->showHelp(m_options);
@@ -190,6 +204,10 @@ int CliProcessor::process(Context* ctx)
   else if (m_options.showVersion()) {
     m_delegate->showVersion();
   }
+  // Outputs copied from the cache
+  else if (m_cache && m_cache->restore()) {
+    // Do nothing
+  }
   // Process other options and file names
   else if (!m_options.values().empty()) {
 #ifdef ENABLE_SCRIPTING
@@ -202,6 +220,32 @@ int CliProcessor::process(Context* ctx)
     render::DitheringAlgorithm ditheringAlgorithm = render::DitheringAlgorithm::None;
     std::string ditheringMatrix;
 
+    // --profile: measure the time spent in each phase per file
+    if (m_options.profile())
+      m_profiler = std::make_unique<PhaseProfiler>(m_options.profileMemory());
+
+    // --jobs <n>: load the input files in background threads while
+    // the previous ones are processed (the CLI arguments are still
+    // processed in order, so the output is the same)
+    if (m_options.jobs() > 1 && !ctx->isUIAvailable()) {
+      base::paths filenames;
+      for (const auto& value : m_options.values()) {
+        if (!value.option())
+          filenames.push_back(base::normalize_path(value.value()));
+      }
+
+      // Same flags used by OpenFileCommand to open files from the CLI
+      const int flags =
+        FILE_LOAD_DATA_FILE |
+        FILE_LOAD_CREATE_PALETTE |
+        FILE_LOAD_SEQUENCE_ASK |
+        FILE_LOAD_SEQUENCE_ASK_CHECKBOX;
+
+      m_preloader = std::make_unique<FilePreloader>(
+        ctx, filenames, flags, m_options.jobs());
+      m_batch.setPreloader(m_preloader.get());
+    }
+
     for (const auto& value : m_options.values()) {
       const AppOptions::Option* opt = value.option();
 
@@ -321,6 +365,25 @@ int CliProcessor::process(Context* ctx)
           if (m_exporter)
             m_exporter->setIgnoreEmptyCels(true);
         }
+        // --compression-level <level>
+        else if (opt == &m_options.compressionLevel()) {
+          cof.compressionLevel =
+            std::clamp(base::convert_to<int>(value.value()), -1, 9);
+        }
+        // --link-identical-cels
+        else if (opt == &m_options.linkIdenticalCels()) {
+          cof.linkIdenticalCels = true;
+        }
+        // --png-preset <preset>
+        else if (opt == &m_options.pngPreset()) {
+          if (value.value() != "fast" &&
+              value.value() != "default" &&
+              value.value() != "small")
+            throw std::runtime_error("--png-preset needs a valid preset name\n"
+                                     "Usage: --png-preset <preset>\n"
+                                     "Where <preset> can be fast, default, or small");
+          cof.pngPreset = value.value();
+        }
         // --merge-duplicates
         else if (opt == &m_options.mergeDuplicates()) {
           if (m_exporter)
@@ -366,6 +429,24 @@ int CliProcessor::process(Context* ctx)
           if (m_exporter)
             m_exporter->setExtrude(true);
         }
+        // --sheet-max-size width,height
+        else if (opt == &m_options.sheetMaxSize()) {
+          std::vector<std::string> parts;
+          base::split_string(value.value(), parts, ",");
+          if (parts.size() < 2)
+            throw std::runtime_error("--sheet-max-size needs two parameters separated by comma (,)\n"
+                                     "Usage: --sheet-max-size width,height\n"
+                                     "E.g. --sheet-max-size 2048,2048");
+          if (m_exporter)
+            m_exporter->setMaxPageSize(
+              gfx::Size(base::convert_to<int>(parts[0]),
+                        base::convert_to<int>(parts[1])));
+        }
+        // --sheet-cache <dir>
+        else if (opt == &m_options.sheetCache()) {
+          if (m_exporter)
+            m_exporter->setSampleCacheDir(value.value());
+        }
         // --crop x,y,width,height
         else if (opt == &m_options.crop()) {
           std::vector<std::string> parts;
@@ -519,6 +600,8 @@ int CliProcessor::process(Context* ctx)
           }
 
           for (auto doc : ctx->documents()) {
+            ScopedPhase phase(PhaseProfiler::Phase::Quantize,
+                              doc->filename());
             ctx->setActiveDocument(doc);
             ctx->executeCommand(command, params);
           }
@@ -621,6 +704,11 @@ int CliProcessor::process(Context* ctx)
       }
     }
 
+    if (m_preloader) {
+      m_batch.setPreloader(nullptr);
+      m_preloader.reset();
+    }
+
     if (m_exporter) {
       // Rows sprite sheet as the default type
       if (sheetType == SpriteSheetType::None)
@@ -630,7 +718,18 @@ int CliProcessor::process(Context* ctx)
       m_delegate->exportFiles(ctx, *m_exporter.get());
       m_exporter.reset(nullptr);
     }
+
+    if (m_profiler) {
+      m_profiler->print(std::cout);
+      if (!m_options.profileTrace().empty())
+        m_profiler->saveTrace(m_options.profileTrace());
+      m_profiler.reset();
+    }
+
+    if (m_cache)
+      m_cache->store();
   }
+  m_cache.reset();
 
   // Running mode
   if (m_options.startUI()) {
@@ -814,32 +913,43 @@ void CliProcessor::saveFile(Context* ctx, const CliOpenFile& cof)
   bool layerInFormat = is_layer_in_filename_format(fn);
   bool groupInFormat = is_group_in_filename_format(fn);
 
-  for (doc::Slice* slice : slices) {
-    for (doc::Tag* tag : tags) {
-      // For each layer, hide other ones and save the sprite.
-      for (doc::Layer* layer : layers) {
-        RestoreVisibleLayers layersVisibility;
+  // All the tags/slices of each layer only read the document (if
+  // they don't need to be trimmed), so they are saved at the same
+  // time in background threads.
+  std::unique_ptr<FileSaveQueue> saveQueue;
+  if (!ctx->isUIAvailable() &&
+      !cof.trim &&
+      tags.size() * slices.size() > 1) {
+    saveQueue = std::make_unique<FileSaveQueue>(
+      std::thread::hardware_concurrency());
+  }
 
-        if (cof.splitLayers) {
-          ASSERT(layer);
+  // For each layer, hide other ones and save the sprite.
+  for (doc::Layer* layer : layers) {
+    RestoreVisibleLayers layersVisibility;
 
-          // If the user doesn't want all layers and this one is hidden.
-          if (!layer->isVisible())
-            continue;     // Just ignore this layer.
+    if (cof.splitLayers) {
+      ASSERT(layer);
 
-          // Make this layer ("show") the only one visible.
-          layersVisibility.showLayer(layer);
-        }
-        else if (!filteredLayers.empty())
-          layersVisibility.showSelectedLayers(doc->sprite(), filteredLayers);
+      // If the user doesn't want all layers and this one is hidden.
+      if (!layer->isVisible())
+        continue;     // Just ignore this layer.
 
-        if (layer) {
-          if ((layerInFormat && layer->isGroup()) ||
-              (!layerInFormat && groupInFormat && !layer->isGroup())) {
-            continue;
-          }
-        }
+      // Make this layer ("show") the only one visible.
+      layersVisibility.showLayer(layer);
+    }
+    else if (!filteredLayers.empty())
+      layersVisibility.showSelectedLayers(doc->sprite(), filteredLayers);
 
+    if (layer) {
+      if ((layerInFormat && layer->isGroup()) ||
+          (!layerInFormat && groupInFormat && !layer->isGroup())) {
+        continue;
+      }
+    }
+
+    for (doc::Slice* slice : slices) {
+      for (doc::Tag* tag : tags) {
         // TODO --trim --save-as --split-layers doesn't make too much
         // sense as we lost the trim rectangle information (e.g. we
         // don't have sheet .json) Also, we should trim each frame
@@ -888,6 +998,10 @@ void CliProcessor::saveFile(Context* ctx, const CliOpenFile& cof)
         }
       }
     }
+
+    // Wait the files of this layer before restoring the visibility
+    if (saveQueue)
+      saveQueue->wait();
   }
 
   // Undo crop
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,7 +11,10 @@
 
 #include "app/cli/cli_delegate.h"
 #include "app/cli/cli_open_file.h"
+#include "app/cli/cli_output_cache.h"
 #include "app/doc_exporter.h"
+#include "app/file/file_preloader.h"
+#include "app/phase_profiler.h"
 #include "app/util/open_batch.h"
 #include "doc/selected_layers.h"
 
@@ -59,7 +62,11 @@ namespace app {
 
     CliDelegate* m_delegate;
     const AppOptions& m_options;
+    // Destroyed after m_preloader as its threads might use them
+    std::unique_ptr<CliOutputCache> m_cache;
+    std::unique_ptr<PhaseProfiler> m_profiler;
     std::unique_ptr<DocExporter> m_exporter;
+    std::unique_ptr<FilePreloader> m_preloader;
 
     // Files already used in the CLI processing (e.g. when used to
     // load a sequence of files) so we don't ask for them again.
@@ -0,0 +1,239 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cli/cli_server.h"
+
+#include "app/cli/app_options.h"
+#include "app/cli/cli_processor.h"
+#include "app/cli/default_cli_delegate.h"
+#include "app/commands/params.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "doc/sprite.h"
+#include "json11.hpp"
+
+#ifdef ENABLE_SCRIPTING
+  #include "app/app.h"
+  #include "app/script/engine.h"
+#endif
+
+#include <iostream>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+
+namespace app {
+
+using namespace json11;
+
+namespace {
+
+Json error_response(const std::string& msg)
+{
+  return Json::object{ { "ok", false }, { "error", msg } };
+}
+
+Json doc_response(const Doc* doc)
+{
+  const doc::Sprite* sprite = doc->sprite();
+  return Json::object{
+    { "ok", true },
+    { "doc", int(doc->id()) },
+    { "width", sprite->width() },
+    { "height", sprite->height() },
+    { "frames", int(sprite->totalFrames()) }
+  };
+}
+
+} // anonymous namespace
+
+CliServer::CliServer(Context* ctx)
+  : m_ctx(ctx)
+{
+}
+
+void CliServer::run(std::istream& is, std::ostream& os)
+{
+  std::string line;
+  bool quit = false;
+  while (!quit && std::getline(is, line)) {
+    if (line.empty())
+      continue;
+
+    std::string err;
+    const Json req = Json::parse(line, err);
+    Json res;
+    if (!err.empty() || !req.is_object())
+      res = error_response("Invalid request: " + err);
+    else {
+      try {
+        res = processRequest(req, quit);
+      }
+      catch (const std::exception& ex) {
+        res = error_response(ex.what());
+      }
+    }
+
+    // Add the "id" of the request in the response
+    Json::object obj = res.object_items();
+    if (req.is_object() && !req["id"].is_null())
+      obj["id"] = req["id"];
+
+    os << Json(obj).dump() << std::endl;
+  }
+}
+
+Json CliServer::processRequest(const Json& req, bool& quit)
+{
+  const std::string& cmd = req["cmd"].string_value();
+  if (cmd == "open")
+    return openDoc(req);
+  else if (cmd == "save")
+    return saveDoc(req);
+  else if (cmd == "close")
+    return closeDoc(req);
+  else if (cmd == "export")
+    return exportFiles(req);
+#ifdef ENABLE_SCRIPTING
+  else if (cmd == "run-script")
+    return runScript(req);
+#endif
+  else if (cmd == "quit") {
+    quit = true;
+    return Json::object{ { "ok", true } };
+  }
+  return error_response("Unknown command: " + cmd);
+}
+
+Json CliServer::openDoc(const Json& req)
+{
+  const std::string& filename = req["filename"].string_value();
+  std::unique_ptr<FileOp> fop(
+    FileOp::createLoadDocumentOperation(
+      m_ctx, filename,
+      FILE_LOAD_DATA_FILE |
+      FILE_LOAD_CREATE_PALETTE |
+      FILE_LOAD_SEQUENCE_NONE));
+  if (!fop)
+    return error_response("Cannot open " + filename);
+  if (fop->hasError())
+    return error_response(fop->error());
+
+  fop->operate();
+  fop->done();
+  fop->postLoad();
+
+  Doc* doc = fop->releaseDocument();
+  if (!doc)
+    return error_response(fop->hasError() ? fop->error():
+                                            "Cannot open " + filename);
+  doc->setContext(m_ctx);
+  return doc_response(doc);
+}
+
+Json CliServer::saveDoc(const Json& req)
+{
+  Doc* doc = m_ctx->documents().getById(req["doc"].int_value());
+  if (!doc)
+    return error_response("Document not found");
+
+  // Save a copy, the document keeps its original filename
+  const std::string& filename = req["filename"].string_value();
+  std::unique_ptr<FileOp> fop(
+    FileOp::createSaveDocumentOperation(
+      m_ctx,
+      FileOpROI(doc, doc->sprite()->bounds(),
+                "", "", doc::FramesSequence(), false),
+      filename, "", false));
+  if (!fop)
+    return error_response("Cannot save " + filename);
+  if (!fop->hasError()) {
+    fop->operate();
+    fop->done();
+  }
+  if (fop->hasError())
+    return error_response(fop->error());
+  return doc_response(doc);
+}
+
+Json CliServer::closeDoc(const Json& req)
+{
+  // Close all documents if "doc" is not specified
+  std::vector<Doc*> docs;
+  if (req["doc"].is_null()) {
+    for (Doc* doc : m_ctx->documents())
+      docs.push_back(doc);
+  }
+  else if (Doc* doc = m_ctx->documents().getById(req["doc"].int_value()))
+    docs.push_back(doc);
+  else
+    return error_response("Document not found");
+
+  for (Doc* doc : docs) {
+    doc->close();
+    delete doc;
+  }
+  return Json::object{ { "ok", true } };
+}
+
+Json CliServer::exportFiles(const Json& req)
+{
+  // Process the arguments as a new batch mode CLI execution
+  std::vector<std::string> args = { "aseprite", "--batch" };
+  for (const Json& arg : req["args"].array_items())
+    args.push_back(arg.string_value());
+
+  std::vector<const char*> argv;
+  for (const auto& arg : args)
+    argv.push_back(arg.c_str());
+
+  const std::set<Doc*> oldDocs(m_ctx->documents().begin(),
+                               m_ctx->documents().end());
+  int code;
+  {
+    AppOptions options(int(argv.size()), argv.data());
+    DefaultCliDelegate delegate;
+    CliProcessor cli(&delegate, options);
+    code = cli.process(m_ctx);
+  }
+
+  // Close the documents opened by this request (documents opened
+  // with "open" are kept)
+  std::vector<Doc*> newDocs;
+  for (Doc* doc : m_ctx->documents()) {
+    if (oldDocs.find(doc) == oldDocs.end())
+      newDocs.push_back(doc);
+  }
+  for (Doc* doc : newDocs) {
+    doc->close();
+    delete doc;
+  }
+
+  return Json::object{ { "ok", code == 0 }, { "code", code } };
+}
+
+#ifdef ENABLE_SCRIPTING
+Json CliServer::runScript(const Json& req)
+{
+  Params params;
+  for (const auto& kv : req["params"].object_items())
+    params.set(kv.first.c_str(), kv.second.string_value().c_str());
+
+  auto engine = App::instance()->scriptEngine();
+  const std::string& filename = req["filename"].string_value();
+  if (!engine->evalUserFile(filename, params))
+    return error_response("Error executing script " + filename);
+  return Json::object{ { "ok", true }, { "code", engine->returnCode() } };
+}
+#endif
+
+} // namespace app
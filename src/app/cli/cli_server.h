@@ -0,0 +1,59 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CLI_CLI_SERVER_H_INCLUDED
+#define APP_CLI_CLI_SERVER_H_INCLUDED
+#pragma once
+
+#include <iosfwd>
+#include <string>
+
+namespace json11 {
+  class Json;
+}
+
+namespace app {
+  class Context;
+
+  // Headless server (--server) that processes requests from an input
+  // stream (one JSON object per line) and writes one JSON response
+  // line for each request, so several operations can be done
+  // without paying the startup cost of the program each time.
+  //
+  // Requests:
+  //   { "id": 1, "cmd": "open", "filename": "a.aseprite" }
+  //   { "id": 2, "cmd": "save", "doc": 5, "filename": "a.png" }
+  //   { "id": 3, "cmd": "close", "doc": 5 }
+  //   { "id": 4, "cmd": "export", "args": [ "b.aseprite", "--sheet", "b.png" ] }
+  //   { "id": 5, "cmd": "run-script", "filename": "s.lua", "params": { "k": "v" } }
+  //   { "id": 6, "cmd": "quit" }
+  //
+  // Responses include the same "id" and "ok": true/false (with an
+  // "error" message when it fails). The "export" requests should use
+  // --data to save the sprite sheet data (in other case it's printed
+  // in the same output stream of the responses).
+  class CliServer {
+  public:
+    CliServer(Context* ctx);
+
+    void run(std::istream& is, std::ostream& os);
+
+  private:
+    json11::Json processRequest(const json11::Json& req, bool& quit);
+    json11::Json openDoc(const json11::Json& req);
+    json11::Json saveDoc(const json11::Json& req);
+    json11::Json closeDoc(const json11::Json& req);
+    json11::Json exportFiles(const json11::Json& req);
+#ifdef ENABLE_SCRIPTING
+    json11::Json runScript(const json11::Json& req);
+#endif
+
+    Context* m_ctx;
+  };
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -99,6 +99,15 @@ void DefaultCliDelegate::saveFile(Context* ctx, const CliOpenFile& cof)
   if (cof.ignoreEmpty)
     params.set("ignoreEmpty", "true");
 
+  if (cof.compressionLevel >= 0)
+    params.set("compressionLevel", base::convert_to<std::string>(cof.compressionLevel).c_str());
+
+  if (cof.linkIdenticalCels)
+    params.set("linkIdenticalCels", "true");
+
+  if (!cof.pngPreset.empty())
+    params.set("pngPreset", cof.pngPreset.c_str());
+
   ctx->executeCommand(saveAsCommand, params);
 }
 
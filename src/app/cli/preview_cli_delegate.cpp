@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -109,6 +109,18 @@ void PreviewCliDelegate::saveFile(Context* ctx, const CliOpenFile& cof)
     std::cout << "  - Ignore empty frames\n";
   }
 
+  if (cof.compressionLevel >= 0) {
+    std::cout << "  - Compression level: " << cof.compressionLevel << "\n";
+  }
+
+  if (cof.linkIdenticalCels) {
+    std::cout << "  - Link identical cels\n";
+  }
+
+  if (!cof.pngPreset.empty()) {
+    std::cout << "  - PNG preset: " << cof.pngPreset << "\n";
+  }
+
   std::cout << "  - Size: "
             << cof.document->sprite()->width() << "x"
             << cof.document->sprite()->height() << "\n";
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -10,8 +10,15 @@
 
 #include "app/closed_docs.h"
 #include "app/doc.h"
+#include "app/doc_undo.h"
 #include "app/pref/preferences.h"
+#include "base/log.h"
 #include "base/thread.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
 
 #include <algorithm>
 #include <limits>
@@ -20,8 +27,15 @@
 
 namespace app {
 
+using namespace doc;
+
+// Time to wait before compressing a closed document (if the user
+// closes a document by mistake it's reopened without delay)
+static const base::tick_t kCompressClosedDocAfterMSecs = 5000;
+
 ClosedDocs::ClosedDocs(const Preferences& pref)
   : m_done(false)
+  , m_stopCompression(false)
 {
   if (pref.general.dataRecovery())
     m_dataRecoveryPeriodMSecs = int(1000.0*60.0*pref.general.dataRecoveryPeriod());
@@ -74,7 +88,7 @@ void ClosedDocs::addClosedDoc(Doc* doc)
   ASSERT(doc != nullptr);
   ASSERT(doc->context() == nullptr);
 
-  ClosedDoc closedDoc = { doc, base::current_tick() };
+  ClosedDoc closedDoc = { doc, base::current_tick(), false };
 
   std::unique_lock<std::mutex> lock(m_mutex);
   m_docs.insert(m_docs.begin(), std::move(closedDoc));
@@ -89,7 +103,12 @@ Doc* ClosedDocs::reopenLastClosedDoc()
 {
   Doc* doc = nullptr;
   {
+    // Stop the compression of a document in the background thread
+    // (if any) so we can get the mutex earlier
+    m_stopCompression = true;
+
     std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopCompression = false;
     if (!m_docs.empty()) {
       doc = m_docs.front().doc;
       m_docs.erase(m_docs.begin());
@@ -104,7 +123,10 @@ std::vector<Doc*> ClosedDocs::getAndRemoveAllClosedDocs()
 {
   std::vector<Doc*> docs;
   {
+    m_stopCompression = true;
+
     std::unique_lock<std::mutex> lock(m_mutex);
+    m_stopCompression = false;
     CLOSEDOC_TRACE("CLOSEDOC: Get and remove all closed", m_docs.size(), "docs");
     for (const ClosedDoc& closedDoc : m_docs)
       docs.push_back(closedDoc.doc);
@@ -127,7 +149,7 @@ void ClosedDocs::backgroundThread()
     base::tick_t waitForMSecs = std::numeric_limits<base::tick_t>::max();
 
     for (auto it=m_docs.begin(); it != m_docs.end(); ) {
-      const ClosedDoc& closedDoc = *it;
+      ClosedDoc& closedDoc = *it;
       auto doc = closedDoc.doc;
 
       base::tick_t diff = now - closedDoc.timestamp;
@@ -151,6 +173,20 @@ void ClosedDocs::backgroundThread()
       }
       else {
         waitForMSecs = std::min(waitForMSecs, m_keepClosedDocAliveForMSecs-diff);
+
+        if (!closedDoc.compressed) {
+          if (diff < kCompressClosedDocAfterMSecs) {
+            waitForMSecs = std::min(waitForMSecs, kCompressClosedDocAfterMSecs-diff);
+          }
+          else if (compressDoc(doc)) {
+            closedDoc.compressed = true;
+          }
+          else {
+            // The document is locked (e.g. by the backup thread) or
+            // the compression was stopped, try again later
+            waitForMSecs = std::min(waitForMSecs, kCompressClosedDocAfterMSecs);
+          }
+        }
         ++it;
       }
     }
@@ -172,4 +208,62 @@ void ClosedDocs::backgroundThread()
   CLOSEDOC_TRACE("CLOSEDOC: [BG] Background thread end");
 }
 
+// Executed from the backgroundThread() with m_mutex locked. Returns
+// false if the document couldn't be completely compressed.
+bool ClosedDocs::compressDoc(Doc* doc)
+{
+  // The backup thread could be reading the document
+  const Doc::LockResult res = doc->writeLock(0);
+  if (res == Doc::LockResult::Fail)
+    return false;
+
+  CLOSEDOC_TRACE("CLOSEDOC: [BG] Compress doc", doc);
+
+  std::vector<Image*> images;
+  Sprite* sprite = doc->sprite();
+  for (Cel* cel : sprite->uniqueCels())
+    images.push_back(cel->image());
+  if (sprite->hasTilesets()) {
+    for (Tileset* tileset : *sprite->tilesets()) {
+      if (!tileset)
+        continue;
+      for (tile_index ti=0; ti<tileset->size(); ++ti) {
+        if (ImageRef tile = tileset->get(ti))
+          images.push_back(tile.get());
+      }
+    }
+  }
+
+  bool result = true;
+  std::size_t oldMemSize = 0;
+  std::size_t newMemSize = 0;
+  for (Image* image : images) {
+    if (m_done || m_stopCompression) {
+      result = false;
+      break;
+    }
+    if (image->isCompressed())
+      continue;
+
+    const std::size_t memSize = image->getMemSize();
+    if (image->compressBits()) {
+      oldMemSize += memSize;
+      newMemSize += image->getMemSize();
+    }
+  }
+
+  // Compress the payloads of all undo states too (they are
+  // uncompressed again when the user undoes/redoes them)
+  if (result)
+    doc->undoHistory()->compactMemory();
+
+  doc->unlock(res);
+
+  LOG(VERBOSE, "CLOSEDOC: \"%s\" compressed, %d KB -> %d KB\n",
+      doc->name().c_str(),
+      int(oldMemSize / 1024),
+      int(newMemSize / 1024));
+  return result;
+}
+
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -29,6 +29,10 @@ namespace app {
   //   garbage collector).
   // * If the document was not restore, we delete it from memory, if
   //   the document was restore, we remove it from the m_docs.
+  // * While the document is waiting, the pixels of its images and the
+  //   undo history are compressed in the same background thread, so a
+  //   big closed document doesn't keep all its memory pinned. The
+  //   pixels are uncompressed on demand when the document is reopened.
   class ClosedDocs {
   public:
     ClosedDocs(const Preferences& pref);
@@ -44,13 +48,18 @@ namespace app {
 
   private:
     void backgroundThread();
+    bool compressDoc(Doc* doc);
 
     struct ClosedDoc {
       Doc* doc;
       base::tick_t timestamp;
+      bool compressed;
     };
 
     std::atomic<bool> m_done;
+    // Set to stop compressing a document as soon as possible (e.g.
+    // when the user wants to reopen it)
+    std::atomic<bool> m_stopCompression;
     base::tick_t m_dataRecoveryPeriodMSecs;
     base::tick_t m_keepClosedDocAliveForMSecs;
     std::vector<ClosedDoc> m_docs;
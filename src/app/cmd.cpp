@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -89,6 +90,18 @@ size_t Cmd::memSize() const
   return onMemSize();
 }
 
+void Cmd::compactMemory()
+{
+  onCompactMemory();
+}
+
+bool Cmd::merge(Cmd* newer)
+{
+  ASSERT(newer);
+  ASSERT(newer != this);
+  return onMerge(newer);
+}
+
 void Cmd::onExecute()
 {
   // Do nothing
@@ -119,4 +132,14 @@ size_t Cmd::onMemSize() const {
   return sizeof(*this);
 }
 
+void Cmd::onCompactMemory()
+{
+  // Do nothing
+}
+
+bool Cmd::onMerge(Cmd* newer)
+{
+  return false;
+}
+
 } // namespace app
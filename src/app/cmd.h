@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +33,17 @@ namespace app {
     std::string label() const;
     size_t memSize() const;
 
+    // Compresses the undo data of the command in a background thread
+    // (e.g. because it's an old undo state), so memSize() will be
+    // smaller. The data is uncompressed automatically if the command
+    // is undone/redone.
+    void compactMemory();
+
+    // Tries to merge a newer command (executed just after this one)
+    // into this command. Returns true if the "newer" command can be
+    // deleted because this command undoes/redoes both.
+    bool merge(Cmd* newer);
+
     Context* context() const { return m_ctx; }
 
   protected:
@@ -41,6 +53,8 @@ namespace app {
     virtual void onFireNotifications();
     virtual std::string onLabel() const;
     virtual size_t onMemSize() const;
+    virtual void onCompactMemory();
+    virtual bool onMerge(Cmd* newer);
 
   private:
     Context* m_ctx;
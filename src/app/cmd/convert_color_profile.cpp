@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2021  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -13,6 +13,7 @@
 #include "app/cmd/assign_color_profile.h"
 #include "app/cmd/replace_image.h"
 #include "app/cmd/set_palette.h"
+#include "app/color_spaces.h"
 #include "app/doc.h"
 #include "doc/cels_range.h"
 #include "doc/palette.h"
@@ -70,6 +71,20 @@ static doc::ImageRef convert_image_color_space(const doc::Image* srcImage,
   return dstImage;
 }
 
+// Converts all palette entries with one call to the conversion.
+static void convert_palette_color_space(const doc::Palette* srcPal,
+                                        doc::Palette* dstPal,
+                                        os::ColorSpaceConversion* conversion)
+{
+  ASSERT(srcPal->size() == dstPal->size());
+  std::vector<color_t> colors(srcPal->rawColorsData(),
+                              srcPal->rawColorsData() + srcPal->size());
+  conversion->convertRgba((uint32_t*)&colors[0],
+                          (const uint32_t*)&colors[0], int(colors.size()));
+  for (int i=0; i<dstPal->size(); ++i)
+    dstPal->setEntry(i, colors[i]);
+}
+
 void convert_color_profile(doc::Sprite* sprite,
                            const gfx::ColorSpaceRef& newCS)
 {
@@ -82,7 +97,7 @@ void convert_color_profile(doc::Sprite* sprite,
   ASSERT(srcOCS);
   ASSERT(dstOCS);
 
-  auto conversion = system->convertBetweenColorSpace(srcOCS, dstOCS);
+  auto conversion = get_color_space_conversion(srcOCS, dstOCS);
 
   // Convert images
   if (sprite->pixelFormat() != doc::IMAGE_INDEXED) {
@@ -102,14 +117,7 @@ void convert_color_profile(doc::Sprite* sprite,
     if (sprite->pixelFormat() != doc::IMAGE_GRAYSCALE) {
       for (auto& pal : sprite->getPalettes()) {
         Palette newPal(pal->frame(), pal->size());
-
-        for (int i=0; i<pal->size(); ++i) {
-          color_t oldCol = pal->entry(i);
-          color_t newCol = pal->entry(i);
-          conversion->convertRgba((uint32_t*)&newCol,
-                                  (const uint32_t*)&oldCol, 1);
-          newPal.setEntry(i, newCol);
-        }
+        convert_palette_color_space(pal, &newPal, conversion.get());
 
         if (*pal != newPal)
           sprite->setPalette(&newPal, false);
@@ -137,7 +145,7 @@ void convert_color_profile(doc::Image* image,
   ASSERT(srcOCS);
   ASSERT(dstOCS);
 
-  auto conversion = system->convertBetweenColorSpace(srcOCS, dstOCS);
+  auto conversion = get_color_space_conversion(srcOCS, dstOCS);
   if (conversion) {
     switch (image->pixelFormat()) {
       case doc::IMAGE_RGB:
@@ -146,17 +154,12 @@ void convert_color_profile(doc::Image* image,
           image, newCS, conversion.get());
 
         image->copy(newImage.get(), gfx::Clip(image->bounds()));
+        image->incrementVersion();
         break;
       }
 
       case doc::IMAGE_INDEXED: {
-        for (int i=0; i<palette->size(); ++i) {
-          color_t oldCol, newCol;
-          oldCol = newCol = palette->entry(i);
-          conversion->convertRgba((uint32_t*)&newCol,
-                                  (const uint32_t*)&oldCol, 1);
-          palette->setEntry(i, newCol);
-        }
+        convert_palette_color_space(palette, palette, conversion.get());
         break;
       }
     }
@@ -177,7 +180,7 @@ ConvertColorProfile::ConvertColorProfile(doc::Sprite* sprite, const gfx::ColorSp
   ASSERT(srcOCS);
   ASSERT(dstOCS);
 
-  auto conversion = system->convertBetweenColorSpace(srcOCS, dstOCS);
+  auto conversion = get_color_space_conversion(srcOCS, dstOCS);
 
   // Convert images
   if (sprite->pixelFormat() != doc::IMAGE_INDEXED) {
@@ -197,14 +200,7 @@ ConvertColorProfile::ConvertColorProfile(doc::Sprite* sprite, const gfx::ColorSp
     if (sprite->pixelFormat() != doc::IMAGE_GRAYSCALE) {
       for (auto& pal : sprite->getPalettes()) {
         Palette newPal(pal->frame(), pal->size());
-
-        for (int i=0; i<pal->size(); ++i) {
-          color_t oldCol = pal->entry(i);
-          color_t newCol = pal->entry(i);
-          conversion->convertRgba((uint32_t*)&newCol,
-                                  (const uint32_t*)&oldCol, 1);
-          newPal.setEntry(i, newCol);
-        }
+        convert_palette_color_space(pal, &newPal, conversion.get());
 
         if (*pal != newPal)
           m_seq.add(new cmd::SetPalette(sprite, pal->frame(), &newPal));
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -17,9 +17,15 @@
 #include "doc/sprite.h"
 #include "doc/tileset.h"
 
+#include <typeinfo>
+
 namespace app {
 namespace cmd {
 
+// Merged commands cannot save more bytes than this (to avoid a big
+// cost merging each new command)
+static const std::size_t kMaxMergedBytes = 4*1024*1024;
+
 CopyRegion::CopyRegion(Image* dst, const Image* src,
                        const gfx::Region& region,
                        const gfx::Point& dstPos,
@@ -42,7 +48,7 @@ CopyRegion::CopyRegion(Image* dst, const Image* src,
     m_region &= gfx::Region(clip.dstBounds());
   }
 
-  save_image_region_in_buffer(m_region, src, dstPos, m_buffer);
+  save_image_region_in_buffer(m_region, src, dstPos, m_payload.buffer());
 }
 
 CopyTileRegion::CopyTileRegion(Image* dst, const Image* src,
@@ -73,12 +79,53 @@ void CopyRegion::onRedo()
   swap();
 }
 
+bool CopyRegion::onMerge(Cmd* newer)
+{
+  auto other = dynamic_cast<CopyRegion*>(newer);
+  // CopyTileRegion commands must notify the change of their tiles
+  if (!other ||
+      typeid(*this) != typeid(CopyRegion) ||
+      typeid(*other) != typeid(CopyRegion) ||
+      other->image() != image())
+    return false;
+
+  Image* image = this->image();
+  ASSERT(image);
+
+  gfx::Region region(m_region);
+  region |= other->m_region;
+
+  std::size_t bytes = 0;
+  for (const gfx::Rect& rc : region)
+    bytes += std::size_t(rc.w) * rc.h * image->bytesPerPixel();
+  if (bytes > kMaxMergedBytes)
+    return false;
+
+  // Go back to the original pixels (before both commands) to save
+  // them in the buffer of the merged command, and then restore the
+  // current pixels (both commands are already executed)
+  base::buffer& buffer = m_payload.buffer();
+  base::buffer& otherBuffer = other->m_payload.buffer();
+  swap_image_region_with_buffer(other->m_region, image, otherBuffer);
+  swap_image_region_with_buffer(m_region, image, buffer);
+
+  base::buffer merged;
+  save_image_region_in_buffer(region, image, gfx::Point(0, 0), merged);
+
+  swap_image_region_with_buffer(m_region, image, buffer);
+  swap_image_region_with_buffer(other->m_region, image, otherBuffer);
+
+  m_region = std::move(region);
+  buffer = std::move(merged);
+  return true;
+}
+
 void CopyRegion::swap()
 {
   Image* image = this->image();
   ASSERT(image);
 
-  swap_image_region_with_buffer(m_region, image, m_buffer);
+  swap_image_region_with_buffer(m_region, image, m_payload.buffer());
   image->incrementVersion();
 
   rehash();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -22,6 +22,7 @@
 #include "app/doc.h"
 #include "app/i18n/strings.h"
 #include "app/restore_visible_layers.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/layer.h"
@@ -29,9 +30,35 @@
 #include "doc/sprite.h"
 #include "render/render.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace app {
 namespace cmd {
 
+// Returns the union of the bounds of the cels of the visible image
+// layers inside "layer" in the given frame.
+static gfx::Rect get_visible_cels_bounds(const Layer* layer,
+                                         const frame_t frame)
+{
+  gfx::Rect bounds;
+  if (!layer->isVisible())
+    return bounds;
+
+  if (layer->isImage()) {
+    if (const Cel* cel = layer->cel(frame))
+      bounds = cel->bounds();
+  }
+  else if (layer->isGroup()) {
+    for (const Layer* child : static_cast<const LayerGroup*>(layer)->layers())
+      bounds |= get_visible_cels_bounds(child, frame);
+  }
+  return bounds;
+}
+
 FlattenLayers::FlattenLayers(doc::Sprite* sprite,
                              const doc::SelectedLayers& layers0,
                              const bool newBlend)
@@ -46,6 +73,40 @@ FlattenLayers::FlattenLayers(doc::Sprite* sprite,
     m_layerIds.push_back(layer->id());
 }
 
+// Renders the given frame of the visible layers of the sprite (only
+// the area of the visible cels) to flatFrame.image.
+void FlattenLayers::renderFrame(FlatFrame& flatFrame,
+                                const doc::Sprite* sprite,
+                                const doc::LayerImage* flatLayer,
+                                const doc::frame_t frame,
+                                const doc::color_t bgcolor) const
+{
+  // The existing cel of the flat layer (the background) is replaced
+  // completely.
+  gfx::Rect bounds = get_visible_cels_bounds(sprite->root(), frame);
+  if (const Cel* cel = flatLayer->cel(frame))
+    bounds |= cel->bounds();
+  bounds &= sprite->bounds();
+  if (bounds.isEmpty()) {
+    flatFrame.image.reset();
+    return;
+  }
+
+  ImageSpec spec = sprite->spec();
+  spec.setSize(bounds.size());
+  ImageRef image(Image::create(spec));
+  clear_image(image.get(), bgcolor);
+
+  render::Render render;
+  render.setNewBlend(m_newBlendMethod);
+  render.setBgOptions(render::BgOptions::MakeNone());
+  render.renderSprite(image.get(), sprite, frame,
+                      gfx::ClipF(0, 0, bounds));
+
+  flatFrame.image = image;
+  flatFrame.bounds = bounds;
+}
+
 void FlattenLayers::onExecute()
 {
   Sprite* sprite = this->sprite();
@@ -66,9 +127,6 @@ void FlattenLayers::onExecute()
   if (list.empty())
     return;                     // Do nothing
 
-  // Create a temporary image.
-  ImageRef image(Image::create(sprite->spec()));
-
   LayerImage* flatLayer;  // The layer onto which everything will be flattened.
   color_t bgcolor;        // The background color to use for flatLayer.
   bool newFlatLayer = false;
@@ -87,46 +145,78 @@ void FlattenLayers::onExecute()
     bgcolor = sprite->transparentColor();
   }
 
-  render::Render render;
-  render.setNewBlend(m_newBlendMethod);
-  render.setBgOptions(render::BgOptions::MakeNone());
-
   {
     // Show only the layers to be flattened so other layers are hidden
     // temporarily.
     RestoreVisibleLayers restore;
     restore.showSelectedLayers(sprite, layers);
 
-    // Copy all frames to the background.
-    for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
-      // Clear the image and render this frame.
-      clear_image(image.get(), bgcolor);
-      render.renderSprite(image.get(), sprite, frame);
-
-      // TODO Keep cel links when possible
-
-      ImageRef cel_image;
-      Cel* cel = flatLayer->cel(frame);
-      if (cel) {
-        if (cel->links())
-          executeAndAdd(new cmd::UnlinkCel(cel));
-
-        cel_image = cel->imageRef();
-        ASSERT(cel_image);
-
-        executeAndAdd(
-          new cmd::CopyRect(cel_image.get(), image.get(),
-                            gfx::Clip(0, 0, image->bounds())));
+    // Frames are rendered in parallel, a few frames at a time (to
+    // limit the memory used by the rendered images), and then the
+    // flat layer is modified in order from this thread.
+    const frame_t nframes = sprite->totalFrames();
+    const int threads = std::clamp(int(std::thread::hardware_concurrency()), 1, 16);
+    std::vector<FlatFrame> frames(threads);
+    base::thread_pool pool(threads);
+
+    for (frame_t first(0); first<nframes; first+=threads) {
+      const int n = std::min<int>(threads, nframes-first);
+      std::mutex mutex;
+      std::condition_variable cv;
+      int pending = n;
+
+      for (int i=0; i<n; ++i) {
+        FlatFrame* flatFrame = &frames[i];
+        const frame_t frame = first+i;
+        pool.execute(
+          [this, flatFrame, sprite, flatLayer, frame, bgcolor,
+           &mutex, &cv, &pending]{
+            renderFrame(*flatFrame, sprite, flatLayer, frame, bgcolor);
+
+            const std::lock_guard lock(mutex);
+            if (--pending == 0)
+              cv.notify_one();
+          });
       }
-      else {
-        gfx::Rect bounds(image->bounds());
-        if (doc::algorithm::shrink_bounds(
-              image.get(), image->maskColor(), nullptr, bounds)) {
-          cel_image.reset(
-            doc::crop_image(image.get(), bounds, image->maskColor()));
-          cel = new Cel(frame, cel_image);
-          cel->setPosition(bounds.origin());
-          flatLayer->addCel(cel);
+      {
+        std::unique_lock lock(mutex);
+        cv.wait(lock, [&pending]{ return pending == 0; });
+      }
+
+      for (int i=0; i<n; ++i) {
+        const frame_t frame = first+i;
+        FlatFrame& flatFrame = frames[i];
+        ImageRef image = std::move(flatFrame.image);
+        if (!image)
+          continue;
+
+        // TODO Keep cel links when possible
+
+        ImageRef cel_image;
+        Cel* cel = flatLayer->cel(frame);
+        if (cel) {
+          if (cel->links())
+            executeAndAdd(new cmd::UnlinkCel(cel));
+
+          cel_image = cel->imageRef();
+          ASSERT(cel_image);
+
+          executeAndAdd(
+            new cmd::CopyRect(cel_image.get(), image.get(),
+                              gfx::Clip(flatFrame.bounds.x - cel->x(),
+                                        flatFrame.bounds.y - cel->y(),
+                                        image->bounds())));
+        }
+        else {
+          gfx::Rect bounds(image->bounds());
+          if (doc::algorithm::shrink_bounds(
+                image.get(), image->maskColor(), nullptr, bounds)) {
+            cel_image.reset(
+              doc::crop_image(image.get(), bounds, image->maskColor()));
+            cel = new Cel(frame, cel_image);
+            cel->setPosition(flatFrame.bounds.origin() + bounds.origin());
+            flatLayer->addCel(cel);
+          }
         }
       }
     }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019 Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,8 +11,16 @@
 
 #include "app/cmd/with_sprite.h"
 #include "app/cmd_sequence.h"
+#include "doc/color.h"
+#include "doc/frame.h"
+#include "doc/image_ref.h"
 #include "doc/object_ids.h"
 #include "doc/selected_layers.h"
+#include "gfx/rect.h"
+
+namespace doc {
+  class LayerImage;
+}
 
 namespace app {
 namespace cmd {
@@ -28,6 +36,18 @@ namespace cmd {
     void onExecute() override;
 
   private:
+    // Flattened image of a frame, and its position in the sprite
+    struct FlatFrame {
+      doc::ImageRef image;
+      gfx::Rect bounds;
+    };
+
+    void renderFrame(FlatFrame& flatFrame,
+                     const doc::Sprite* sprite,
+                     const doc::LayerImage* flatLayer,
+                     const doc::frame_t frame,
+                     const doc::color_t bgcolor) const;
+
     doc::ObjectIds m_layerIds;
     bool m_newBlendMethod;
   };
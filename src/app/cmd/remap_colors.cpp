@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -10,9 +11,6 @@
 
 #include "app/cmd/remap_colors.h"
 
-#include "doc/cel.h"
-#include "doc/cels_range.h"
-#include "doc/image.h"
 #include "doc/remap.h"
 #include "doc/sprite.h"
 
@@ -30,25 +28,15 @@ RemapColors::RemapColors(Sprite* sprite, const Remap& remap)
 void RemapColors::onExecute()
 {
   Sprite* spr = sprite();
-  if (spr->pixelFormat() == IMAGE_INDEXED) {
+  if (spr->pixelFormat() == IMAGE_INDEXED)
     spr->remapImages(m_remap);
-    incrementVersions(spr);
-  }
 }
 
 void RemapColors::onUndo()
 {
   Sprite* spr = this->sprite();
-  if (spr->pixelFormat() == IMAGE_INDEXED) {
+  if (spr->pixelFormat() == IMAGE_INDEXED)
     spr->remapImages(m_remap.invert());
-    incrementVersions(spr);
-  }
-}
-
-void RemapColors::incrementVersions(Sprite* spr)
-{
-  for (const Cel* cel : spr->uniqueCels())
-    cel->image()->incrementVersion();
 }
 
 } // namespace cmd
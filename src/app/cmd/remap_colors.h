@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -29,8 +30,6 @@ namespace cmd {
     }
 
   private:
-    void incrementVersions(Sprite* spr);
-
     Remap m_remap;
   };
 
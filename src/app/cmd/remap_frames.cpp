@@ -0,0 +1,61 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/remap_frames.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+#include "doc/layer.h"
+#include "doc/sprite.h"
+
+namespace app {
+namespace cmd {
+
+RemapFrames::RemapFrames(Sprite* sprite, const Remap& remap)
+  : WithSprite(sprite)
+  , m_remap(remap)
+{
+  ASSERT(m_remap.size() == sprite->totalFrames());
+}
+
+void RemapFrames::onExecute()
+{
+  remapFrames(m_remap);
+}
+
+void RemapFrames::onUndo()
+{
+  remapFrames(m_remap.invert());
+}
+
+void RemapFrames::onFireNotifications()
+{
+  // Just one notification for all moved cels
+  Sprite* sprite = this->sprite();
+  Doc* doc = static_cast<Doc*>(sprite->document());
+  DocEvent ev(doc);
+  ev.sprite(sprite);
+  doc->notify_observers<DocEvent&>(&DocObserver::onCelFrameChanged, ev);
+}
+
+void RemapFrames::remapFrames(const Remap& remap)
+{
+  Sprite* sprite = this->sprite();
+  sprite->remapFrames(remap);
+  sprite->incrementVersion();
+
+  for (Layer* layer : sprite->allLayers()) {
+    if (layer->isImage())
+      layer->incrementVersion();
+  }
+}
+
+} // namespace cmd
+} // namespace app
@@ -0,0 +1,46 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CMD_REMAP_FRAMES_H_INCLUDED
+#define APP_CMD_REMAP_FRAMES_H_INCLUDED
+#pragma once
+
+#include "app/cmd.h"
+#include "app/cmd/with_sprite.h"
+#include "doc/remap.h"
+
+namespace app {
+namespace cmd {
+  using namespace doc;
+
+  // Moves all frames (durations and cels) to new positions in one
+  // step, "remap" is a permutation of all sprite frames (frame ->
+  // new frame). It's used to move ranges of frames without a
+  // cmd::SetCelFrame/SetFrameDuration for each cel/frame, and the
+  // undo information is just the remap.
+  class RemapFrames : public Cmd
+                    , public WithSprite {
+  public:
+    RemapFrames(Sprite* sprite, const Remap& remap);
+
+  protected:
+    void onExecute() override;
+    void onUndo() override;
+    void onFireNotifications() override;
+    size_t onMemSize() const override {
+      return sizeof(*this) + m_remap.getMemSize();
+    }
+
+  private:
+    void remapFrames(const Remap& remap);
+
+    Remap m_remap;
+  };
+
+} // namespace cmd
+} // namespace app
+
+#endif
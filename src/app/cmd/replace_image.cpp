@@ -37,10 +37,11 @@ void ReplaceImage::onExecute()
 {
   // Save old image in m_copy. We cannot keep an ImageRef to this
   // image, because there are other undo branches that could try to
-  // modify/re-add this same image ID
+  // modify/re-add this same image ID. The copy shares the pixels
+  // with the original image until one of them is modified.
   ImageRef oldImage = sprite()->getImageRef(m_oldImageId);
   ASSERT(oldImage);
-  m_copy.reset(Image::createCopy(oldImage.get()));
+  m_copy.reset(Image::createSharedCopy(oldImage.get()));
 
   replaceImage(m_oldImageId, m_newImage);
   m_newImage.reset();
@@ -54,7 +55,7 @@ void ReplaceImage::onUndo()
   m_copy->setId(m_oldImageId);
 
   replaceImage(m_newImageId, m_copy);
-  m_copy.reset(Image::createCopy(newImage.get()));
+  m_copy.reset(Image::createSharedCopy(newImage.get()));
 }
 
 void ReplaceImage::onRedo()
@@ -65,7 +66,7 @@ void ReplaceImage::onRedo()
   m_copy->setId(m_newImageId);
 
   replaceImage(m_oldImageId, m_copy);
-  m_copy.reset(Image::createCopy(oldImage.get()));
+  m_copy.reset(Image::createSharedCopy(oldImage.get()));
 }
 
 void ReplaceImage::replaceImage(ObjectId oldId, const ImageRef& newImage)
@@ -83,7 +83,7 @@ void SetCelData::createCopy()
   ASSERT(!m_dataCopy);
   m_dataCopy.reset(new CelData(*cel->data()));
   m_dataCopy->setImage(
-    ImageRef(Image::createCopy(cel->image())),
+    ImageRef(Image::createSharedCopy(cel->image())),
     cel->layer());
 }
 
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -38,6 +39,16 @@ void SetCelOpacity::onUndo()
   cel()->data()->incrementVersion();
 }
 
+bool SetCelOpacity::onMerge(Cmd* newer)
+{
+  auto other = dynamic_cast<SetCelOpacity*>(newer);
+  if (!other || other->cel() != cel())
+    return false;
+
+  m_newOpacity = other->m_newOpacity;
+  return true;
+}
+
 void SetCelOpacity::onFireNotifications()
 {
   Cel* cel = this->cel();
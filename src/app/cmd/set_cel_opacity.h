@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -24,6 +25,7 @@ namespace cmd {
     void onExecute() override;
     void onUndo() override;
     void onFireNotifications() override;
+    bool onMerge(Cmd* newer) override;
     size_t onMemSize() const override {
       return sizeof(*this);
     }
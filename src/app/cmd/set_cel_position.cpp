@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -40,6 +41,17 @@ void SetCelPosition::onUndo()
   cel()->data()->incrementVersion();
 }
 
+bool SetCelPosition::onMerge(Cmd* newer)
+{
+  auto other = dynamic_cast<SetCelPosition*>(newer);
+  if (!other || other->cel() != cel())
+    return false;
+
+  m_newX = other->m_newX;
+  m_newY = other->m_newY;
+  return true;
+}
+
 void SetCelPosition::onFireNotifications()
 {
   Cel* cel = this->cel();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,14 +20,23 @@
 #include "doc/cel.h"
 #include "doc/cels_range.h"
 #include "doc/document.h"
+#include "base/thread_pool.h"
 #include "doc/layer.h"
+#include "doc/octree_map.h"
 #include "doc/palette.h"
 #include "doc/rgbmap.h"
+#include "doc/rgbmap_rgb5a3.h"
 #include "doc/sprite.h"
 #include "doc/tilesets.h"
 #include "render/quantization.h"
 #include "render/task_delegate.h"
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
 namespace app {
 namespace cmd {
 
@@ -66,6 +75,97 @@ private:
   TaskDelegate* m_delegate;
 };
 
+// Used in the worker threads to cancel the conversion, the progress
+// is reported from the main thread as each image is converted.
+class CancelDelegate : public render::TaskDelegate {
+public:
+  CancelDelegate(render::TaskDelegate* delegate)
+    : m_delegate(delegate) {
+  }
+
+  void notifyTaskProgress(double progress) override { }
+
+  bool continueTask() override {
+    if (m_delegate)
+      return m_delegate->continueTask();
+    else
+      return true;
+  }
+
+private:
+  TaskDelegate* m_delegate;
+};
+
+// RgbMap implementations cannot be regenerated while other threads
+// use them, and each image can need a different palette. Each worker
+// takes a map regenerated for the palette that it needs and gives it
+// back when the image is converted, so the cached colors are re-used
+// by the next images with the same palette.
+class RgbMapPool {
+public:
+  RgbMapPool(const RgbMapAlgorithm algorithm,
+             const RgbMapFor forLayer)
+    : m_algorithm(algorithm)
+    , m_forLayer(forLayer) {
+  }
+
+  RgbMap* acquire(const Palette* palette) {
+    {
+      const std::lock_guard lock(m_mutex);
+      for (Entry& entry : m_entries) {
+        if (!entry.used && entry.palette == palette) {
+          entry.used = true;
+          return entry.map.get();
+        }
+      }
+    }
+
+    // Same maps created by Sprite::rgbMap()
+    std::unique_ptr<RgbMap> map;
+    switch (m_algorithm) {
+      case RgbMapAlgorithm::RGB5A3: map.reset(new RgbMapRGB5A3); break;
+      default: map.reset(new OctreeMap); break;
+    }
+
+    int maskIndex;
+    if (m_forLayer == RgbMapFor::OpaqueLayer)
+      maskIndex = -1;
+    else {
+      maskIndex = palette->findMaskColor();
+      if (maskIndex == -1)
+        maskIndex = 0;
+    }
+    map->regenerateMap(palette, maskIndex);
+
+    RgbMap* result = map.get();
+    const std::lock_guard lock(m_mutex);
+    m_entries.push_back(Entry{ std::move(map), palette, true });
+    return result;
+  }
+
+  void release(RgbMap* map) {
+    const std::lock_guard lock(m_mutex);
+    for (Entry& entry : m_entries) {
+      if (entry.map.get() == map) {
+        entry.used = false;
+        break;
+      }
+    }
+  }
+
+private:
+  struct Entry {
+    std::unique_ptr<RgbMap> map;
+    const Palette* palette;
+    bool used;
+  };
+
+  RgbMapAlgorithm m_algorithm;
+  RgbMapFor m_forLayer;
+  std::mutex m_mutex;
+  std::deque<Entry> m_entries;
+};
+
 } // anonymous namespace
 
 SetPixelFormat::SetPixelFormat(Sprite* sprite,
@@ -81,39 +181,17 @@ SetPixelFormat::SetPixelFormat(Sprite* sprite,
   if (sprite->pixelFormat() == newFormat)
     return;
 
-  // Calculate the number of images to convert just to show a proper
-  // progress bar.
-  tile_index nimages = 0;
-  for (Cel* cel : sprite->uniqueCels())
-    if (!cel->layer()->isTilemap())
-      ++nimages;
-  if (sprite->hasTilesets()) {
-    for (Tileset* tileset : *sprite->tilesets()) {
-      if (tileset)
-        nimages += tileset->size();
-    }
-  }
-
-  SuperDelegate superDel(nimages, delegate);
-
-  // Convert cel images
+  // Images to convert: cel images and tileset images
+  std::vector<Conversion> conversions;
   for (Cel* cel : sprite->uniqueCels()) {
     if (cel->layer()->isTilemap())
       continue;
 
-    ImageRef oldImage = cel->imageRef();
-    convertImage(sprite, dithering,
-                 oldImage,
-                 cel->frame(),
-                 cel->layer()->isBackground(),
-                 mapAlgorithm,
-                 toGray,
-                 &superDel);
-
-    superDel.nextImage();
+    conversions.push_back(
+      Conversion{ cel->imageRef(),
+                  cel->frame(),
+                  cel->layer()->isBackground() });
   }
-
-  // Convert tileset images
   if (sprite->hasTilesets()) {
     for (Tileset* tileset : *sprite->tilesets()) {
       if (!tileset)
@@ -122,19 +200,23 @@ SetPixelFormat::SetPixelFormat(Sprite* sprite,
       for (tile_index i=0; i<tileset->size(); ++i) {
         ImageRef oldImage = tileset->get(i);
         if (oldImage) {
-          convertImage(sprite, dithering,
-                       oldImage,
-                       0,     // TODO select a frame or generate other tilesets?
-                       false, // TODO is background? it depends of the layer where this tileset is used
-                       mapAlgorithm,
-                       toGray,
-                       &superDel);
+          conversions.push_back(
+            Conversion{ oldImage,
+                        0,        // TODO select a frame or generate other tilesets?
+                        false }); // TODO is background? it depends of the layer where this tileset is used
         }
-        superDel.nextImage();
       }
     }
   }
 
+  convertImages(sprite, dithering, mapAlgorithm, toGray,
+                conversions, delegate);
+
+  for (const Conversion& conv : conversions) {
+    if (conv.newImage)
+      m_seq.add(new cmd::ReplaceImage(sprite, conv.oldImage, conv.newImage));
+  }
+
   // Set all cels opacity to 100% if we are converting to indexed.
   // TODO remove this
   if (newFormat == IMAGE_INDEXED) {
@@ -201,44 +283,91 @@ void SetPixelFormat::setFormat(PixelFormat format)
   doc->notify_observers<DocEvent&>(&DocObserver::onPixelFormatChanged, ev);
 }
 
-void SetPixelFormat::convertImage(doc::Sprite* sprite,
-                                  const render::Dithering& dithering,
-                                  const doc::ImageRef& oldImage,
-                                  const doc::frame_t frame,
-                                  const bool isBackground,
-                                  const doc::RgbMapAlgorithm mapAlgorithm,
-                                  doc::rgba_to_graya_func toGray,
-                                  render::TaskDelegate* delegate)
+void SetPixelFormat::convertImages(doc::Sprite* sprite,
+                                   const render::Dithering& dithering,
+                                   const doc::RgbMapAlgorithm mapAlgorithm,
+                                   doc::rgba_to_graya_func toGray,
+                                   std::vector<Conversion>& conversions,
+                                   render::TaskDelegate* delegate)
 {
-  ASSERT(oldImage);
-  ASSERT(oldImage->pixelFormat() != IMAGE_TILEMAP);
-
-  // Making the RGBMap for Image->INDEXDED conversion.
-  // TODO: this is needed only when newImage
-  RgbMap* rgbmap;
-  int newMaskIndex = (isBackground ? -1 : 0);
-  if (m_newFormat == IMAGE_INDEXED) {
-    rgbmap = sprite->rgbMap(frame, sprite->rgbMapForSprite(), mapAlgorithm);
-    if (m_oldFormat == IMAGE_INDEXED)
-      newMaskIndex = sprite->transparentColor();
-    else
-      newMaskIndex = rgbmap->maskIndex();
-  }
-  else {
-    rgbmap = nullptr;
-  }
-  ImageRef newImage(
-    render::convert_pixel_format
-    (oldImage.get(), nullptr, m_newFormat,
-     dithering,
-     rgbmap,
-     sprite->palette(frame),
-     isBackground,
-     newMaskIndex,
-     toGray,
-     delegate));
-
-  m_seq.add(new cmd::ReplaceImage(sprite, oldImage, newImage));
+  if (conversions.empty())
+    return;
+
+  // The RgbMaps are needed only for RGB/Grayscale -> Indexed
+  // conversions
+  std::unique_ptr<RgbMapPool> rgbmaps;
+  if (m_newFormat == IMAGE_INDEXED)
+    rgbmaps = std::make_unique<RgbMapPool>(mapAlgorithm,
+                                           sprite->rgbMapForSprite());
+
+  auto convert = [&](Conversion& conv,
+                     render::TaskDelegate* convDelegate) {
+    ASSERT(conv.oldImage);
+    ASSERT(conv.oldImage->pixelFormat() != IMAGE_TILEMAP);
+
+    const Palette* palette = sprite->palette(conv.frame);
+    RgbMap* rgbmap = nullptr;
+    int newMaskIndex = (conv.isBackground ? -1 : 0);
+    if (rgbmaps) {
+      rgbmap = rgbmaps->acquire(palette);
+      if (m_oldFormat == IMAGE_INDEXED)
+        newMaskIndex = sprite->transparentColor();
+      else
+        newMaskIndex = rgbmap->maskIndex();
+    }
+
+    conv.newImage.reset(
+      render::convert_pixel_format
+      (conv.oldImage.get(), nullptr, m_newFormat,
+       dithering,
+       rgbmap,
+       palette,
+       conv.isBackground,
+       newMaskIndex,
+       toGray,
+       convDelegate));
+
+    if (rgbmap)
+      rgbmaps->release(rgbmap);
+  };
+
+  const int threads = std::thread::hardware_concurrency();
+  if (threads <= 1 || conversions.size() == 1) {
+    SuperDelegate superDel(int(conversions.size()), delegate);
+    for (Conversion& conv : conversions) {
+      convert(conv, &superDel);
+      superDel.nextImage();
+    }
+    return;
+  }
+
+  // Convert each image in parallel (each conversion is independent of
+  // the others, and the sprite/palettes are only read)
+  CancelDelegate cancelDel(delegate);
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t done = 0;
+  {
+    base::thread_pool pool(threads);
+    for (Conversion& conversion : conversions) {
+      Conversion* conv = &conversion;
+      pool.execute([&, conv]{
+        if (cancelDel.continueTask())
+          convert(*conv, &cancelDel);
+
+        const std::lock_guard lock(mutex);
+        ++done;
+        cv.notify_all();
+      });
+    }
+
+    std::unique_lock lock(mutex);
+    while (done < conversions.size()) {
+      cv.wait(lock);
+      if (delegate)
+        delegate->notifyTaskProgress(double(done) / double(conversions.size()));
+    }
+  }
 }
 
 } // namespace cmd
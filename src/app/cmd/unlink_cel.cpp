@@ -35,7 +35,7 @@ void UnlinkCel::onExecute()
   CelDataRef oldCelData = cel->sprite()->getCelDataRef(m_oldCelDataId);
   ASSERT(oldCelData);
 
-  ImageRef imgCopy(Image::createCopy(oldCelData->image()));
+  ImageRef imgCopy(Image::createSharedCopy(oldCelData->image()));
   CelDataRef celDataCopy(new CelData(*oldCelData));
   celDataCopy->setImage(imgCopy, cel->layer());
   celDataCopy->setUserData(oldCelData->userData());
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -52,6 +52,15 @@ void CmdSequence::addAndExecute(Context* ctx, Cmd* cmd)
   }
 }
 
+void CmdSequence::mergeLastCmd()
+{
+  const int n = int(m_cmds.size());
+  if (n >= 2 && m_cmds[n-2]->merge(m_cmds[n-1])) {
+    delete m_cmds[n-1];
+    m_cmds.pop_back();
+  }
+}
+
 void CmdSequence::onExecute()
 {
   for (auto it = m_cmds.begin(), end=m_cmds.end(); it!=end; ++it)
@@ -80,6 +89,12 @@ size_t CmdSequence::onMemSize() const
   return size;
 }
 
+void CmdSequence::onCompactMemory()
+{
+  for (Cmd* cmd : m_cmds)
+    cmd->compactMemory();
+}
+
 void CmdSequence::executeAndAdd(Cmd* cmd)
 {
   addAndExecute(context(), cmd);
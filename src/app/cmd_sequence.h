@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -27,11 +27,17 @@ namespace app {
     // function.
     void executeAndAdd(Cmd* cmd);
 
+    // Merges the last command with the previous one if it's possible
+    // (see Cmd::merge()), e.g. to join thousands of SetCelPosition of
+    // the same cel executed by a script in one transaction.
+    void mergeLastCmd();
+
   protected:
     void onExecute() override;
     void onUndo() override;
     void onRedo() override;
     size_t onMemSize() const override;
+    void onCompactMemory() override;
 
   private:
     std::vector<Cmd*> m_cmds;
@@ -0,0 +1,119 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cold_cels_compressor.h"
+
+#include "app/doc.h"
+#include "app/site.h"
+#include "app/ui_context.h"
+#include "base/log.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+
+namespace app {
+
+using namespace doc;
+
+// Check the cels each 30 seconds and compress the ones that were not
+// used in the last 5 minutes.
+static const int kCheckInterval = 30 * 1000;
+static const base::tick_t kColdTime = 5 * 60 * 1000;
+
+ColdCelsCompressor::ColdCelsCompressor()
+  : m_timer(kCheckInterval)
+{
+  m_timer.Tick.connect([this]{ onTick(); });
+  m_timer.start();
+}
+
+ColdCelsCompressor::~ColdCelsCompressor()
+{
+  m_timer.stop();
+}
+
+void ColdCelsCompressor::onTick()
+{
+  const base::tick_t now = base::current_tick();
+  std::unordered_set<ObjectId> seen;
+  for (Doc* doc : UIContext::instance()->documents())
+    compressDoc(doc, now, seen);
+
+  // Forget deleted images
+  for (auto it=m_images.begin(); it!=m_images.end(); ) {
+    if (seen.find(it->first) == seen.end())
+      it = m_images.erase(it);
+    else
+      ++it;
+  }
+}
+
+void ColdCelsCompressor::compressDoc(Doc* doc,
+                                     const base::tick_t now,
+                                     std::unordered_set<ObjectId>& seen)
+{
+  // We don't want to wait if the document is being used
+  const Doc::LockResult res = doc->writeLock(0);
+  if (res == Doc::LockResult::Fail)
+    return;
+
+  // Don't compress the cels of the active frame
+  const Site site = UIContext::instance()->activeSite();
+  const frame_t activeFrame = (site.document() == doc ? site.frame(): -1);
+
+  int compressed = 0;
+  int oldMemSize = 0;
+  int newMemSize = 0;
+
+  for (Cel* cel : doc->sprite()->uniqueCels()) {
+    Image* image = cel->image();
+    seen.insert(image->id());
+
+    auto it = m_images.find(image->id());
+
+    // The image was created, modified, or uncompressed because it
+    // was used since the last check
+    if (it == m_images.end() ||
+        it->second.version != image->version() ||
+        (it->second.compressed && !image->isCompressed())) {
+      m_images[image->id()] = ImageState{ image->version(), now, false };
+      continue;
+    }
+
+    ImageState& state = it->second;
+    if (state.compressed ||
+        cel->frame() == activeFrame ||
+        now - state.lastUse < kColdTime)
+      continue;
+
+    const int memSize = image->getMemSize();
+    if (image->compressBits()) {
+      oldMemSize += memSize;
+      newMemSize += image->getMemSize();
+      ++compressed;
+      state.compressed = true;
+    }
+    else {
+      // Try again later
+      state.lastUse = now;
+    }
+  }
+
+  doc->unlock(res);
+
+  if (compressed > 0) {
+    LOG(VERBOSE, "COLD: %d cel(s) compressed in \"%s\", %d KB -> %d KB (%d KB saved)\n",
+        compressed, doc->name().c_str(),
+        oldMemSize / 1024, newMemSize / 1024,
+        (oldMemSize - newMemSize) / 1024);
+  }
+}
+
+} // namespace app
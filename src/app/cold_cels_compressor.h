@@ -0,0 +1,50 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_COLD_CELS_COMPRESSOR_H_INCLUDED
+#define APP_COLD_CELS_COMPRESSOR_H_INCLUDED
+#pragma once
+
+#include "base/time.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+#include "ui/timer.h"
+
+#include <unordered_map>
+#include <unordered_set>
+
+namespace app {
+  class Doc;
+
+  // Compresses in memory the pixels of the cels that were not
+  // modified or accessed in a while (see doc::Image::compressBits()),
+  // so we can keep more big documents open. The pixels are
+  // uncompressed automatically when they are needed again (e.g. to
+  // render the cel).
+  class ColdCelsCompressor {
+  public:
+    ColdCelsCompressor();
+    ~ColdCelsCompressor();
+
+  private:
+    struct ImageState {
+      doc::ObjectVersion version;
+      base::tick_t lastUse;
+      bool compressed;
+    };
+
+    void onTick();
+    void compressDoc(Doc* doc,
+                     const base::tick_t now,
+                     std::unordered_set<doc::ObjectId>& seen);
+
+    ui::Timer m_timer;
+    std::unordered_map<doc::ObjectId, ImageState> m_images;
+  };
+
+} // namespace app
+
+#endif
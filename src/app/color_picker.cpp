@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,6 +11,7 @@
 
 #include "app/color_picker.h"
 
+#include "app/cels_index.h"
 #include "app/doc.h"
 #include "app/pref/preferences.h"
 #include "app/site.h"
@@ -35,6 +36,11 @@ namespace {
 
 const int kOpacityThreshold = 1;
 
+// Keeps the last composited block of the sprite, so dragging the
+// eyedropper doesn't render the sprite for each mouse movement (only
+// used from the UI thread).
+render::SpritePixelSampler g_sampler;
+
 bool get_cel_pixel(const Cel* cel,
                    const double x,
                    const double y,
@@ -107,11 +113,17 @@ void ColorPicker::pickColor(const Site& site,
 
     // Pick from the composed image
     case FromComposition: {
-      doc::RenderPlan plan;
-      plan.addLayer(sprite->root(), site.frame());
-
       doc::CelList cels;
-      sprite->pickCels(pos, kOpacityThreshold, plan, cels);
+      if (auto doc = static_cast<const Doc*>(site.document())) {
+        doc::CelList candidates;
+        doc->celsIndex()->pick(site.frame(), pos, candidates);
+        sprite->pickCels(pos, kOpacityThreshold, candidates, cels);
+      }
+      else {
+        doc::RenderPlan plan;
+        plan.addLayer(sprite->root(), site.frame());
+        sprite->pickCels(pos, kOpacityThreshold, plan, cels);
+      }
       if (!cels.empty())
         m_layer = cels.front()->layer();
 
@@ -134,9 +146,9 @@ void ColorPicker::pickColor(const Site& site,
       else if (site.tilemapMode() == TilemapMode::Pixels) {
         m_color = app::Color::fromImage(
           sprite->pixelFormat(),
-          render::get_sprite_pixel(sprite, pos.x, pos.y,
-                                   site.frame(), proj,
-                                   Preferences::instance().experimental.newBlend()));
+          g_sampler.getPixel(sprite, pos.x, pos.y,
+                             site.frame(), proj,
+                             Preferences::instance().experimental.newBlend()));
       }
       break;
     }
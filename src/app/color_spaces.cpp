@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -16,6 +16,10 @@
 #include "os/system.h"
 #include "os/window.h"
 
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
 namespace app {
 
 // We use this variable to avoid accessing Preferences::instance()
@@ -64,6 +68,81 @@ gfx::ColorSpaceRef get_working_rgb_space_from_preferences()
   return gfx::ColorSpace::MakeNone();
 }
 
+//////////////////////////////////////////////////////////////////////
+// Cache of conversions
+
+namespace {
+
+// Maximum number of cached conversions (e.g. current document to
+// screen, sRGB to screen, etc.)
+const int kMaxCachedConversions = 8;
+
+struct CachedConversion {
+  // We keep a reference to the color spaces so the pointers of their
+  // gfx::ColorSpace cannot be re-used while they are in the cache.
+  os::ColorSpaceRef srcCS;
+  os::ColorSpaceRef dstCS;
+  os::Ref<os::ColorSpaceConversion> conversion;
+};
+
+// Conversions can be requested from background threads (e.g. when a
+// file is saved).
+std::mutex g_conversionsMutex;
+
+// Sorted from the least to the most recently used conversion.
+std::vector<CachedConversion> g_conversions;
+
+// os::ColorSpace objects are created each time from the same
+// gfx::ColorSpace (e.g. for the sprite color profile), so we identify
+// them by their gfx::ColorSpace.
+const void* color_space_key(const os::ColorSpaceRef& cs)
+{
+  if (auto gfxCS = cs->gfxColorSpace().get())
+    return gfxCS;
+  return cs.get();
+}
+
+} // anonymous namespace
+
+os::Ref<os::ColorSpaceConversion> get_color_space_conversion(
+  const os::ColorSpaceRef& srcCS,
+  const os::ColorSpaceRef& dstCS)
+{
+  if (!srcCS || !dstCS || srcCS.get() == dstCS.get())
+    return nullptr;
+
+  const std::lock_guard lock(g_conversionsMutex);
+
+  const void* srcKey = color_space_key(srcCS);
+  const void* dstKey = color_space_key(dstCS);
+  auto it = std::find_if(
+    g_conversions.begin(), g_conversions.end(),
+    [srcKey, dstKey](const CachedConversion& c){
+      return (color_space_key(c.srcCS) == srcKey &&
+              color_space_key(c.dstCS) == dstKey);
+    });
+  if (it != g_conversions.end()) {
+    // Move the conversion to the end (most recently used)
+    std::rotate(it, it+1, g_conversions.end());
+    return g_conversions.back().conversion;
+  }
+
+  CachedConversion c;
+  c.srcCS = srcCS;
+  c.dstCS = dstCS;
+  // Equal profiles don't need a conversion at all
+  if (!srcCS->gfxColorSpace() ||
+      !dstCS->gfxColorSpace() ||
+      !srcCS->gfxColorSpace()->nearlyEqual(*dstCS->gfxColorSpace())) {
+    c.conversion = os::instance()->convertBetweenColorSpace(srcCS, dstCS);
+  }
+
+  if (int(g_conversions.size()) == kMaxCachedConversions)
+    g_conversions.erase(g_conversions.begin());
+  g_conversions.push_back(c);
+  return c.conversion;
+}
+
 //////////////////////////////////////////////////////////////////////
 // Color conversion
 
@@ -72,8 +151,7 @@ ConvertCS::ConvertCS()
   if (g_manage) {
     auto srcCS = get_current_color_space();
     auto dstCS = get_screen_color_space();
-    if (srcCS && dstCS)
-      m_conversion = os::instance()->convertBetweenColorSpace(srcCS, dstCS);
+    m_conversion = get_color_space_conversion(srcCS, dstCS);
   }
 }
 
@@ -81,7 +159,7 @@ ConvertCS::ConvertCS(const os::ColorSpaceRef& srcCS,
                      const os::ColorSpaceRef& dstCS)
 {
   if (g_manage) {
-    m_conversion = os::instance()->convertBetweenColorSpace(srcCS, dstCS);
+    m_conversion = get_color_space_conversion(srcCS, dstCS);
   }
 }
 
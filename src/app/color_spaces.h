@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2018-2020  Igara Studio S.A.
+// Copyright (c) 2018-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -28,6 +28,14 @@ namespace app {
 
   gfx::ColorSpaceRef get_working_rgb_space_from_preferences();
 
+  // Returns a conversion from "srcCS" to "dstCS", or nullptr if both
+  // color spaces are equal (or there is no possible conversion). The
+  // conversions are cached, so this can be called each time a color
+  // is painted.
+  os::Ref<os::ColorSpaceConversion> get_color_space_conversion(
+    const os::ColorSpaceRef& srcCS,
+    const os::ColorSpaceRef& dstCS);
+
   class ConvertCS {
   public:
     ConvertCS();
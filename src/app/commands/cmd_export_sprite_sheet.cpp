@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -1026,7 +1026,7 @@ private:
     ExportSpriteSheetParams params;
     updateParams(params);
 
-    std::unique_ptr<Task> task(new Task);
+    std::unique_ptr<Task> task(new Task(TaskPriority::Interactive));
     task->run(
       [this, params](base::task_token& token){
         generateSpriteSheetOnBackground(params, token);
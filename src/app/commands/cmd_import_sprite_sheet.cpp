@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +32,7 @@
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "render/render.h"
@@ -39,6 +40,9 @@
 
 #include "import_sprite_sheet.xml.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace ui;
@@ -440,7 +444,8 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
       return;
   }
 
-  // The list of frames imported from the sheet
+  // The list of frames imported from the sheet (nullptr for empty
+  // frames)
   std::vector<ImageRef> animation;
 
   try {
@@ -490,25 +495,28 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
         break;
     }
 
-    // As first step, we cut each tile and add them into "animation" list.
-    for (const auto& tileRect : tileRects) {
-      ImageRef resultImage(
-        Image::create(
-          sprite->pixelFormat(), tileRect.w, tileRect.h));
-
-      // Render the portion of sheet.
-      render.renderSprite(
-        resultImage.get(), sprite, currentFrame,
-        gfx::Clip(0, 0, tileRect));
-
-      animation.push_back(resultImage);
-    }
-
-    if (animation.size() == 0) {
+    if (tileRects.empty()) {
       Alert::show(Strings::alerts_empty_rect_importing_sprite_sheet());
       return;
     }
 
+    // As first step, we render the whole sheet one time, and then we
+    // cut each tile (in parallel) and add them into the "animation"
+    // list. Empty tiles are not added as cels.
+    ImageRef sheet(Image::create(sprite->spec()));
+    render.renderSprite(sheet.get(), sprite, currentFrame);
+
+    animation.resize(tileRects.size());
+
+    const color_t bg = sprite->transparentColor();
+    doc::parallel_for(
+      int(tileRects.size()),
+      [&sheet, &tileRects, &animation, bg](const int i){
+        ImageRef tileImage(crop_image(sheet.get(), tileRects[i], bg));
+        if (!is_empty_image(tileImage.get()))
+          animation[i] = tileImage;
+      });
+
     // The following steps modify the sprite, so we wrap all
     // operations in a undo-transaction.
     ContextWriter writer(context);
@@ -517,20 +525,18 @@ void ImportSpriteSheetCommand::onExecute(Context* context)
           ModifyDocument);
     DocApi api = document->getApi(tx);
 
-    // Add the layer in the sprite.
-    LayerImage* resultLayer =
-      api.newLayer(sprite->root(), Strings::import_sprite_sheet_layer_name());
-
-    // Add all frames+cels to the new layer
+    // Create the new layer with all its cels, so it's added in the
+    // sprite with just one undoable command.
+    LayerImage* resultLayer = new LayerImage(sprite);
+    resultLayer->setName(Strings::import_sprite_sheet_layer_name());
     for (size_t i=0; i<animation.size(); ++i) {
-      // Create the cel.
-      std::unique_ptr<Cel> resultCel(new Cel(frame_t(i), animation[i]));
-
-      // Add the cel in the layer.
-      api.addCel(resultLayer, resultCel.get());
-      resultCel.release();
+      if (animation[i])
+        resultLayer->addCel(new Cel(frame_t(i), animation[i]));
     }
 
+    // Add the layer in the sprite.
+    api.addLayer(sprite->root(), resultLayer, sprite->root()->lastLayer());
+
     // Copy the list of layers (because we will modify it in the iteration).
     LayerList layers = sprite->root()->layers();
 
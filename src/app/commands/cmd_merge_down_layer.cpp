@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,7 @@
 #include "app/doc_api.h"
 #include "app/modules/gui.h"
 #include "app/tx.h"
+#include "base/thread_pool.h"
 #include "doc/blend_internals.h"
 #include "doc/cel.h"
 #include "doc/image.h"
@@ -29,8 +30,82 @@
 #include "render/rasterize.h"
 #include "ui/ui.h"
 
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace app {
 
+namespace {
+
+// Result of merging the cels of one frame
+struct MergedCel {
+  ImageRef image;
+  gfx::Rect bounds;
+  int opacity = 255;
+};
+
+} // anonymous namespace
+
+// Creates the image of the source cel merged into the destination
+// cel in the given frame (or a copy of the source cel if there is no
+// destination cel). It doesn't modify the sprite, so it can be
+// called from several threads at the same time ("bgcolor" is the
+// color to clear the new areas of the destination cel).
+static void merge_cels(MergedCel& merged,
+                       const Sprite* sprite,
+                       const LayerImage* src_layer,
+                       const Layer* dst_layer,
+                       const frame_t frame,
+                       const doc::color_t bgcolor)
+{
+  merged.image.reset();
+
+  const Cel* src_cel = src_layer->cel(frame);
+  const Cel* dst_cel = dst_layer->cel(frame);
+  if (!src_cel || !src_cel->image())
+    return;
+
+  // No destination image
+  if (!dst_cel) {
+    int t;
+    merged.opacity = MUL_UN8(src_cel->opacity(), src_layer->opacity(), t);
+    merged.bounds = src_cel->bounds();
+
+    // Creating a copy of the image
+    merged.image.reset(
+      render::rasterize_with_cel_bounds(src_cel));
+    return;
+  }
+
+  gfx::Rect bounds;
+
+  // Merge down in the background layer
+  if (dst_layer->isBackground()) {
+    bounds = sprite->bounds();
+  }
+  // Merge down in a transparent layer
+  else {
+    bounds = src_cel->bounds().createUnion(dst_cel->bounds());
+  }
+
+  ImageRef new_image(doc::crop_image(
+      dst_cel->image(),
+      bounds.x-dst_cel->x(),
+      bounds.y-dst_cel->y(),
+      bounds.w, bounds.h, bgcolor));
+
+  // Draw src_cel on new_image
+  render::rasterize(
+    new_image.get(), src_cel,
+    -bounds.x, -bounds.y, false);
+
+  merged.image = new_image;
+  merged.bounds = bounds;
+}
+
 class MergeDownLayerCommand : public Command {
 public:
   MergeDownLayerCommand();
@@ -81,76 +156,67 @@ void MergeDownLayerCommand::onExecute(Context* context)
 
   Tx tx(writer, friendlyName(), ModifyDocument);
 
-  for (frame_t frpos = 0; frpos<sprite->totalFrames(); ++frpos) {
-    // Get frames
-    Cel* src_cel = src_layer->cel(frpos);
-    Cel* dst_cel = dst_layer->cel(frpos);
-
-    // Get images
-    Image* src_image;
-    if (src_cel != NULL)
-      src_image = src_cel->image();
-    else
-      src_image = NULL;
+  // The merged images are created in parallel, a few frames at a
+  // time, and then the destination layer is modified in order from
+  // this thread.
+  const frame_t nframes = sprite->totalFrames();
+  const doc::color_t bgcolor = app_get_color_to_clear_layer(dst_layer);
+  const int threads = std::clamp(int(std::thread::hardware_concurrency()), 1, 16);
+  std::vector<MergedCel> merged(threads);
+  base::thread_pool pool(threads);
+
+  for (frame_t first=0; first<nframes; first+=threads) {
+    const int n = std::min<int>(threads, nframes-first);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending = n;
+
+    for (int i=0; i<n; ++i) {
+      MergedCel* mergedCel = &merged[i];
+      const frame_t frame = first+i;
+      pool.execute(
+        [mergedCel, sprite, src_layer, dst_layer, frame, bgcolor,
+         &mutex, &cv, &pending]{
+          merge_cels(*mergedCel, sprite, src_layer, dst_layer, frame, bgcolor);
+
+          const std::lock_guard lock(mutex);
+          if (--pending == 0)
+            cv.notify_one();
+        });
+    }
+    {
+      std::unique_lock lock(mutex);
+      cv.wait(lock, [&pending]{ return pending == 0; });
+    }
 
-    ImageRef dst_image;
-    if (dst_cel)
-      dst_image = dst_cel->imageRef();
+    for (int i=0; i<n; ++i) {
+      const frame_t frpos = first+i;
+      MergedCel& mergedCel = merged[i];
+      ImageRef new_image = std::move(mergedCel.image);
+      if (!new_image)
+        continue;
 
-    // With source image?
-    if (src_image) {
-      int t;
-      int opacity;
-      opacity = MUL_UN8(src_cel->opacity(), src_layer->opacity(), t);
+      Cel* src_cel = src_layer->cel(frpos);
+      Cel* dst_cel = dst_layer->cel(frpos);
 
       // No destination image
-      if (!dst_image) {  // Only a transparent layer can have a null cel
-        // Copy this cel to the destination layer...
-
-        // Creating a copy of the image
-        dst_image.reset(
-          render::rasterize_with_cel_bounds(src_cel));
-
+      if (!dst_cel) {  // Only a transparent layer can have a null cel
         // Creating a copy of the cell
-        dst_cel = new Cel(frpos, dst_image);
+        dst_cel = new Cel(frpos, new_image);
         dst_cel->setPosition(src_cel->x(), src_cel->y());
-        dst_cel->setOpacity(opacity);
+        dst_cel->setOpacity(mergedCel.opacity);
 
         tx(new cmd::AddCel(dst_layer, dst_cel));
       }
       // With destination
       else {
-        gfx::Rect bounds;
-
-        // Merge down in the background layer
-        if (dst_layer->isBackground()) {
-          bounds = sprite->bounds();
-        }
-        // Merge down in a transparent layer
-        else {
-          bounds = src_cel->bounds().createUnion(dst_cel->bounds());
-        }
-
-        doc::color_t bgcolor = app_get_color_to_clear_layer(dst_layer);
-
-        ImageRef new_image(doc::crop_image(
-            dst_image.get(),
-            bounds.x-dst_cel->x(),
-            bounds.y-dst_cel->y(),
-            bounds.w, bounds.h, bgcolor));
-
-        // Draw src_cel on new_image
-        render::rasterize(
-          new_image.get(), src_cel,
-          -bounds.x, -bounds.y, false);
-
         // First unlink the dst_cel
         if (dst_cel->links())
           tx(new cmd::UnlinkCel(dst_cel));
 
         // Then modify the dst_cel
         tx(new cmd::SetCelPosition(dst_cel,
-            bounds.x, bounds.y));
+            mergedCel.bounds.x, mergedCel.bounds.y));
 
         tx(new cmd::ReplaceImage(sprite,
             dst_cel->imageRef(), new_image));
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,12 +17,14 @@
 #include "app/console.h"
 #include "app/doc.h"
 #include "app/file/file.h"
+#include "app/file/file_preloader.h"
 #include "app/file_selector.h"
 #include "app/i18n/strings.h"
 #include "app/job.h"
 #include "app/modules/gui.h"
 #include "app/pref/preferences.h"
 #include "app/recent_files.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/status_bar.h"
 #include "app/ui_context.h"
 #include "base/fs.h"
@@ -79,6 +81,7 @@ OpenFileCommand::OpenFileCommand()
   , m_repeatCheckbox(false)
   , m_oneFrame(false)
   , m_seqDecision(gen::SequenceDecision::ASK)
+  , m_preloader(nullptr)
 {
 }
 
@@ -181,8 +184,10 @@ void OpenFileCommand::onExecute(Context* context)
     filenames.erase(filenames.begin());
 
     std::unique_ptr<FileOp> fop(
-      FileOp::createLoadDocumentOperation(
-        context, filename, flags));
+      m_preloader ? m_preloader->take(filename, flags): nullptr);
+    if (!fop)
+      fop.reset(FileOp::createLoadDocumentOperation(
+                  context, filename, flags));
     bool unrecent = false;
 
     // Do nothing (the user cancelled or something like that)
@@ -220,8 +225,11 @@ void OpenFileCommand::onExecute(Context* context)
         m_usedFiles.push_back(fn);
       }
 
-      OpenFileJob task(fop.get());
-      task.showProgressWindow();
+      // Preloaded files are already loaded
+      if (!fop->isDone()) {
+        OpenFileJob task(fop.get());
+        task.showProgressWindow();
+      }
 
       // Post-load processing, it is called from the GUI because may require user intervention.
       fop->postLoad();
@@ -234,6 +242,7 @@ void OpenFileCommand::onExecute(Context* context)
       if (doc) {
         if (context->isUIAvailable()) {
           App::instance()->recentFiles()->addRecentFile(fop->filename().c_str());
+          ThumbnailGenerator::instance()->cacheThumbnail(doc, fop->filename());
           auto& docPref = Preferences::instance().document(doc);
 
           if (fop->hasEmbeddedGridBounds() &&
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2021  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,11 +16,17 @@
 #include <string>
 
 namespace app {
+  class FilePreloader;
 
   class OpenFileCommand : public Command {
   public:
     OpenFileCommand();
 
+    // Files that are already being loaded in background threads
+    void setPreloader(FilePreloader* preloader) {
+      m_preloader = preloader;
+    }
+
     const base::paths& usedFiles() const {
       return m_usedFiles;
     }
@@ -40,6 +46,7 @@ namespace app {
     bool m_oneFrame;
     base::paths m_usedFiles;
     gen::SequenceDecision m_seqDecision;
+    FilePreloader* m_preloader;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -50,6 +50,8 @@
 
 #include "options.xml.h"
 
+#include <optional>
+
 namespace app {
 
 namespace {
@@ -646,6 +648,10 @@ public:
   }
 
   void saveConfig() {
+    // Emit only one AfterChange signal for each modified section
+    // (e.g. to avoid relayouts/repaints for each option)
+    std::optional<OptionsBatch> batch(std::in_place);
+
     // Save preferences in widgets that are bound to options automatically
     {
       Message msg(kSavePreferencesMessage);
@@ -892,6 +898,7 @@ public:
     if (newShowHome != m_pref.general.showHome())
       m_pref.general.showHome(newShowHome);
 
+    batch.reset();
     m_pref.save();
 
     if (!warnings.empty()) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,7 @@
 #include "app/doc.h"
 #include "app/doc_undo.h"
 #include "app/file/file.h"
+#include "app/file/file_save_queue.h"
 #include "app/file/gif_format.h"
 #include "app/file/png_format.h"
 #include "app/file_selector.h"
@@ -29,6 +30,7 @@
 #include "app/pref/preferences.h"
 #include "app/recent_files.h"
 #include "app/restore_visible_layers.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/export_file_window.h"
 #include "app/ui/incompat_file_window.h"
 #include "app/ui/layer_frame_comboboxes.h"
@@ -239,6 +241,31 @@ void SaveFileBaseCommand::saveDocumentInBackground(
   if (resizeOnTheFly == ResizeOnTheFly::On)
     fop->setOnTheFlyScale(scale);
 
+  if (params().compressionLevel.isSet())
+    fop->setCompressionLevel(params().compressionLevel());
+
+  if (params().linkIdenticalCels.isSet())
+    fop->setLinkIdenticalCels(params().linkIdenticalCels());
+
+  if (params().pngPreset.isSet()) {
+    const std::string& preset = params().pngPreset();
+    if (preset == "fast")
+      fop->setPngPreset(gen::PngPreset::FAST);
+    else if (preset == "small")
+      fop->setPngPreset(gen::PngPreset::SMALL);
+    else if (preset == "default")
+      fop->setPngPreset(gen::PngPreset::DEFAULT);
+  }
+
+  // Save the file in background with other files (e.g. exporting
+  // several tags of the same sprite from the CLI)
+  if (FileSaveQueue* queue = FileSaveQueue::instance()) {
+    if (markAsSaved == MarkAsSaved::Off) {
+      queue->save(std::move(fop), document);
+      return;
+    }
+  }
+
   SaveFileJob job(fop.get());
   job.showProgressWindow();
 
@@ -257,9 +284,13 @@ void SaveFileBaseCommand::saveDocumentInBackground(
     document->impossibleToBackToSavedState();
   }
   else {
-    if (context->isUIAvailable() && params().ui())
+    if (context->isUIAvailable() && params().ui()) {
       App::instance()->recentFiles()->addRecentFile(filename);
 
+      // Thumbnail for the recent files list
+      ThumbnailGenerator::instance()->cacheThumbnail(document, filename);
+    }
+
     if (markAsSaved == MarkAsSaved::On) {
       document->markAsSaved();
       document->setFilename(filename);
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021-2022  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -31,6 +31,9 @@ namespace app {
     Param<doc::frame_t> fromFrame { this, 0, { "fromFrame", "from-frame" } };
     Param<doc::frame_t> toFrame { this, 0, { "toFrame", "to-frame" } };
     Param<bool> ignoreEmpty { this, false, "ignoreEmpty" };
+    Param<int> compressionLevel { this, -1, "compressionLevel" };
+    Param<bool> linkIdenticalCels { this, false, "linkIdenticalCels" };
+    Param<std::string> pngPreset { this, std::string(), "pngPreset" };
     Param<double> scale { this, 1.0, "scale" };
     Param<gfx::Rect> bounds { this, gfx::Rect(), "bounds" };
     Param<bool> playSubtags { this, false, "playSubtags" };
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio SA
+// Copyright (C) 2021-2026  Igara Studio SA
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -18,11 +18,11 @@
 #include "app/site.h"
 #include "doc/cel.h"
 #include "doc/frame_range.h"
-#include "doc/image_bits.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/octree_map.h"
 #include "doc/palette.h"
+#include "doc/primitives.h"
 #include "doc/sprite.h"
 
 namespace app {
@@ -98,13 +98,8 @@ void SelectPaletteColorsCommand::selectTiles(
 
   // For each tile on each cel's tilemap
   for (frame_t frame : selectedFrames) {
-    if (Cel* cel = layer->cel(frame)) {
-      for (const doc::tile_t t : LockImageBits<TilemapTraits>(cel->image())) {
-        tile_index ti = doc::tile_geti(t);
-        if (ti >= 0 && ti < usedTiles.size())
-          usedTiles[ti] = true;
-      }
-    }
+    if (Cel* cel = layer->cel(frame))
+      doc::get_used_entries(cel->image(), usedTiles);
   }
 }
 
@@ -142,11 +137,7 @@ void SelectPaletteColorsCommand::onExecute(Context* context)
           break;
 
         case IMAGE_INDEXED:
-          doc::for_each_pixel<IndexedTraits>(
-            image,
-            [&usedEntries](const color_t p) {
-              usedEntries[p] = true;
-            });
+          doc::get_used_entries(image, usedEntries);
           break;
       }
     };
@@ -162,15 +153,16 @@ void SelectPaletteColorsCommand::onExecute(Context* context)
           if (layer->isTilemap()) {
             Tileset* tileset = static_cast<LayerTilemap*>(layer)->tileset();
             tile_index ti;
+            PalettePicks tilemapTiles(tileset->size());
             PalettePicks usedTiles(tileset->size());
 
             // Looking for tiles (available in tileset) used in the tilemap image:
-            doc::for_each_pixel<TilemapTraits>(
-              image,
-              [&usedTiles, &tileset, &ti](const tile_t t) {
-                if (tileset->findTileIndex(tileset->get(t), ti))
-                  usedTiles[ti] = true;
-              });
+            doc::get_used_entries(image, tilemapTiles);
+            for (int i=0; i<tilemapTiles.size(); ++i) {
+              if (tilemapTiles[i] &&
+                  tileset->findTileIndex(tileset->get(i), ti))
+                usedTiles[ti] = true;
+            }
 
             // Looking for tile matches in usedTiles. If a tile matches, then
             // search into the tilemap (pixel by pixel) looking for color matches.
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -30,6 +30,7 @@
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/mask.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/slice.h"
 #include "doc/sprite.h"
@@ -39,6 +40,7 @@
 #include "sprite_size.xml.h"
 
 #include <algorithm>
+#include <vector>
 
 #define PERC_FORMAT     "%.4g"
 
@@ -155,34 +157,57 @@ protected:
       }
     }
 
-    // For each cel...
-    for (Cel* cel : sprite()->uniqueCels()) {
-      // We need to adjust only the origin/position of tilemap cels
-      // (because tiles are resized automatically when we resize the
-      // tileset).
-      if (cel->layer()->isTilemap()) {
-        Tileset* tileset = static_cast<LayerTilemap*>(cel->layer())->tileset();
-        gfx::Size canvasSize =
-          tileset->grid().tilemapSizeToCanvas(
-            gfx::Size(cel->image()->width(),
-                      cel->image()->height()));
-        gfx::Rect newBounds(cel->x()*scale.w,
-                            cel->y()*scale.h,
-                            canvasSize.w,
-                            canvasSize.h);
-        tx()(new cmd::SetCelBoundsF(cel, newBounds));
-      }
-      else {
-        resize_cel_image(
-          tx(), cel, scale,
-          m_resize_method,
-          cel->layer()->isReference() ?
-          -cel->boundsF().origin():
-          gfx::PointF(-cel->bounds().origin()));
-      }
+    // Images of cels are resized in parallel in batches (so we can
+    // report the progress and cancel the operation between batches),
+    // and then the undoable commands are added from this thread. The
+    // shared RgbMap of the sprite is needed to interpolate indexed
+    // colors, so in that case cels are resized one by one.
+    std::vector<Cel*> cels;
+    for (Cel* cel : sprite()->uniqueCels())
+      cels.push_back(cel);
+
+    const bool parallel =
+      (sprite()->pixelFormat() != IMAGE_INDEXED ||
+       m_resize_method != doc::algorithm::RESIZE_METHOD_BILINEAR);
+    const int batchSize = (parallel ? doc::parallel_threads()*4: 1);
+    std::vector<ImageRef> newImages;
+
+    for (int i=0; i<int(cels.size()); i+=batchSize) {
+      const int n = std::min(batchSize, int(cels.size())-i);
+      newImages.assign(n, nullptr);
+      createResizedCelImages(&cels[i], &newImages[0], n, scale);
+
+      for (int j=0; j<n; ++j) {
+        Cel* cel = cels[i+j];
+
+        // We need to adjust only the origin/position of tilemap cels
+        // (because tiles are resized automatically when we resize the
+        // tileset).
+        if (cel->layer()->isTilemap()) {
+          Tileset* tileset = static_cast<LayerTilemap*>(cel->layer())->tileset();
+          gfx::Size canvasSize =
+            tileset->grid().tilemapSizeToCanvas(
+              gfx::Size(cel->image()->width(),
+                        cel->image()->height()));
+          gfx::Rect newBounds(cel->x()*scale.w,
+                              cel->y()*scale.h,
+                              canvasSize.w,
+                              canvasSize.h);
+          tx()(new cmd::SetCelBoundsF(cel, newBounds));
+        }
+        else {
+          resize_cel_image(
+            tx(), cel, scale,
+            m_resize_method,
+            cel->layer()->isReference() ?
+            -cel->boundsF().origin():
+            gfx::PointF(-cel->bounds().origin()),
+            newImages[j]);
+        }
 
-      jobProgress((float)progress / img_count);
-      ++progress;
+        jobProgress((float)progress / img_count);
+        ++progress;
+      }
 
       // Cancel all the operation?
       if (isCanceled())
@@ -247,6 +272,21 @@ protected:
     api.setSpriteSize(sprite(), m_new_width, m_new_height);
   }
 
+private:
+
+  // [working thread]
+  void createResizedCelImages(Cel* const* cels,
+                              ImageRef* newImages,
+                              const int n,
+                              const gfx::SizeF& scale) {
+    doc::parallel_for(
+      n,
+      [this, cels, newImages, &scale](const int i) {
+        if (!cels[i]->layer()->isTilemap())
+          newImages[i] = create_resized_cel_image(cels[i], scale, m_resize_method);
+      });
+  }
+
 };
 
 #ifdef ENABLE_UI
@@ -0,0 +1,81 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/commands/command.h"
+#include "app/commands/new_params.h"
+#include "app/console.h"
+#include "app/context.h"
+#include "app/resource_finder.h"
+#include "app/trace.h"
+#include "base/fs.h"
+#include "base/time.h"
+#include "fmt/format.h"
+
+namespace app {
+
+struct TraceRecordingParams : public NewParams {
+  Param<std::string> filename { this, std::string(), "filename" };
+};
+
+// Starts/stops the recording of a performance trace (a tool for
+// developers to attach traces to performance bug reports). When the
+// recording is stopped, the trace is saved in the given "filename"
+// or in the "traces" folder of the user directory.
+class TraceRecordingCommand : public CommandWithNewParams<TraceRecordingParams> {
+public:
+  TraceRecordingCommand();
+
+protected:
+  bool onChecked(Context* ctx) override;
+  void onExecute(Context* ctx) override;
+};
+
+TraceRecordingCommand::TraceRecordingCommand()
+  : CommandWithNewParams<TraceRecordingParams>(CommandId::TraceRecording(), CmdRecordableFlag)
+{
+}
+
+bool TraceRecordingCommand::onChecked(Context* ctx)
+{
+  return trace::is_recording();
+}
+
+void TraceRecordingCommand::onExecute(Context* ctx)
+{
+  if (!trace::is_recording()) {
+    trace::start_recording();
+    return;
+  }
+
+  std::string filename = params().filename();
+  if (filename.empty()) {
+    const base::Time t = base::current_time();
+    ResourceFinder rf;
+    rf.includeUserDir(
+      base::join_path("traces",
+                      fmt::format("trace-{:04}{:02}{:02}-{:02}{:02}{:02}.json",
+                                  t.year, t.month, t.day,
+                                  t.hour, t.minute, t.second)).c_str());
+    filename = rf.defaultFilename();
+  }
+
+  Console console(ctx);
+  if (trace::stop_recording(filename))
+    console.printf("Performance trace saved in \"%s\"\n", filename.c_str());
+  else
+    console.printf("Error saving performance trace in \"%s\"\n", filename.c_str());
+}
+
+Command* CommandFactory::createTraceRecordingCommand()
+{
+  return new TraceRecordingCommand;
+}
+
+} // namespace app
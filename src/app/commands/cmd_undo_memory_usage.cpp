@@ -0,0 +1,97 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd_transaction.h"
+#include "app/commands/command.h"
+#include "app/commands/new_params.h"
+#include "app/console.h"
+#include "app/context.h"
+#include "app/context_access.h"
+#include "app/doc.h"
+#include "app/doc_undo.h"
+#include "base/mem_utils.h"
+#include "undo/undo_state.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace app {
+
+struct UndoMemoryUsageParams : public NewParams {
+  Param<int> count { this, 10, "count" };
+};
+
+// Prints the undo states of the active document that use more memory
+// (a tool for developers to find commands that could be optimized).
+class UndoMemoryUsageCommand : public CommandWithNewParams<UndoMemoryUsageParams> {
+public:
+  UndoMemoryUsageCommand();
+
+protected:
+  bool onEnabled(Context* ctx) override;
+  void onExecute(Context* ctx) override;
+};
+
+UndoMemoryUsageCommand::UndoMemoryUsageCommand()
+  : CommandWithNewParams<UndoMemoryUsageParams>(CommandId::UndoMemoryUsage(), CmdUIOnlyFlag)
+{
+}
+
+bool UndoMemoryUsageCommand::onEnabled(Context* ctx)
+{
+  return ctx->checkFlags(ContextFlags::ActiveDocumentIsReadable);
+}
+
+void UndoMemoryUsageCommand::onExecute(Context* ctx)
+{
+  const ContextReader reader(ctx);
+  const Doc* doc = reader.document();
+  if (!doc)
+    return;
+
+  struct Item {
+    int index;
+    const CmdTransaction* cmd;
+  };
+
+  const DocUndo* undo = doc->undoHistory();
+  std::vector<Item> items;
+  int index = 0;
+  for (const undo::UndoState* state = undo->firstState();
+       state; state = state->next()) {
+    items.push_back(Item{ ++index, static_cast<const CmdTransaction*>(state->cmd()) });
+  }
+
+  const int count = std::clamp(params().count(), 0, int(items.size()));
+  std::partial_sort(
+    items.begin(), items.begin() + count, items.end(),
+    [](const Item& a, const Item& b){
+      return a.cmd->memSize() > b.cmd->memSize();
+    });
+
+  Console console(ctx);
+  console.printf("Undo history of \"%s\": %d states, %s\n",
+                 doc->name().c_str(), int(items.size()),
+                 base::get_pretty_memory_size(undo->totalUndoSize()).c_str());
+  for (int i=0; i<count; ++i) {
+    const Item& item = items[i];
+    console.printf("  #%d %s: %s\n",
+                   item.index,
+                   item.cmd->label().c_str(),
+                   base::get_pretty_memory_size(item.cmd->memSize()).c_str());
+  }
+}
+
+Command* CommandFactory::createUndoMemoryUsageCommand()
+{
+  return new UndoMemoryUsageCommand;
+}
+
+} // namespace app
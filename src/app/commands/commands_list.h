@@ -186,6 +186,11 @@ FOR_EACH_COMMAND(Zoom)
     FOR_EACH_COMMAND(Debugger)
     FOR_EACH_COMMAND(DeveloperConsole)
     FOR_EACH_COMMAND(OpenScriptFolder)
+    FOR_EACH_COMMAND(UndoMemoryUsage)
   #endif
 FOR_EACH_COMMAND(RunScript)
 #endif  // ENABLE_SCRIPTING
+
+#ifdef ENABLE_TRACING
+FOR_EACH_COMMAND(TraceRecording)
+#endif
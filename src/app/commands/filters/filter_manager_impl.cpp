@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,7 +20,9 @@
 #include "app/doc.h"
 #include "app/ini_file.h"
 #include "app/modules/palettes.h"
+#include "app/progress_scope.h"
 #include "app/site.h"
+#include "app/trace.h"
 #include "app/transaction.h"
 #include "app/ui/color_bar.h"
 #include "app/ui/editor/editor.h"
@@ -35,12 +37,16 @@
 #include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/mask.h"
+#include "doc/parallel.h"
 #include "doc/sprite.h"
 #include "filters/filter.h"
+#include "gfx/region.h"
 #include "ui/manager.h"
 #include "ui/view.h"
 #include "ui/widget.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <set>
@@ -50,6 +56,119 @@ namespace app {
 using namespace std;
 using namespace ui;
 
+// Size of the tiles used to save the modified area in the undo
+// history
+static const int kUndoTileSize = 64;
+
+// Minimum number of pixels to apply a filter in parallel, and number
+// of rows that each thread filters each time it takes a new band.
+static const int kParallelMinPixels = 256*256;
+static const int kRowsPerBand = 16;
+
+#ifdef ENABLE_UI
+// The preview filters one row of each kPreviewRowStep rows first
+// (copying each one in the next rows), so the user can see a coarse
+// version of the whole preview quickly, and then the rest of rows.
+static const int kPreviewRowStep = 4;
+#endif
+
+// A FilterManager with its own current row, and source/destination
+// images, so several bands of rows (or several cels) can be filtered
+// at the same time. The palette and indexed data are shared with its
+// FilterManagerImpl.
+class FilterManagerImpl::RowBand : public FilterManager {
+public:
+  RowBand(FilterManagerImpl* mgr,
+          base::task_token& token,
+          const Image* src,
+          Image* dst,
+          const gfx::Rect& bounds,
+          const Target target,
+          const Mask* mask)
+    : m_mgr(mgr)
+    , m_token(&token)
+    , m_src(src)
+    , m_dst(dst)
+    , m_bounds(bounds)
+    , m_target(target)
+    , m_mask(mask && mask->bitmap() ? mask: nullptr)
+    , m_row(0)
+    , m_firstRow(0) {
+  }
+
+  // Applies the filter to the rows [row1, row2)
+  void apply(const int row1, const int row2) {
+    m_firstRow = row1;
+    for (m_row=row1; m_row<row2 && !m_token->canceled(); ++m_row) {
+      if (m_mask) {
+        int x = m_bounds.x - m_mask->bounds().x;
+        int y = m_bounds.y - m_mask->bounds().y + m_row;
+        if ((x >= m_bounds.w) ||
+            (y >= m_bounds.h))
+          return;
+
+        m_maskBits = m_mask->bitmap()
+          ->lockBits<BitmapTraits>(Image::ReadLock,
+            gfx::Rect(x, y, m_bounds.w - x, m_bounds.h - y));
+
+        m_maskIterator = m_maskBits.begin();
+      }
+
+      switch (pixelFormat()) {
+        case IMAGE_RGB:       m_mgr->m_filter->applyToRgba(this); break;
+        case IMAGE_GRAYSCALE: m_mgr->m_filter->applyToGrayscale(this); break;
+        default:
+          ASSERT(false);
+          break;
+      }
+    }
+    m_maskBits.unlock();
+  }
+
+  // FilterManager implementation
+  doc::PixelFormat pixelFormat() const override { return m_mgr->pixelFormat(); }
+  const void* getSourceAddress() override {
+    return m_src->getPixelAddress(m_bounds.x, y());
+  }
+  void* getDestinationAddress() override {
+    return m_dst->getPixelAddress(m_bounds.x, y());
+  }
+  int getWidth() override { return m_bounds.w; }
+  Target getTarget() override { return m_target; }
+  FilterIndexedData* getIndexedData() override { return m_mgr; }
+  bool skipPixel() override {
+    bool skip = false;
+    if (m_mask) {
+      if (!*m_maskIterator)
+        skip = true;
+
+      ++m_maskIterator;
+    }
+    return skip;
+  }
+  const doc::Image* getSourceImage() override { return m_src; }
+  int x() const override { return m_bounds.x; }
+  int y() const override { return m_bounds.y+m_row; }
+  // Each band is filtered as a new image (filters cannot expect rows
+  // of the previous band as the previous row).
+  bool isFirstRow() const override { return m_row == m_firstRow; }
+  bool isMaskActive() const override { return m_mgr->isMaskActive(); }
+  base::task_token& taskToken() const override { return *m_token; }
+
+private:
+  FilterManagerImpl* m_mgr;
+  base::task_token* m_token;
+  const Image* m_src;
+  Image* m_dst;
+  gfx::Rect m_bounds;
+  Target m_target;
+  const Mask* m_mask;
+  int m_row;
+  int m_firstRow;
+  doc::ImageBits<doc::BitmapTraits> m_maskBits;
+  doc::ImageBits<doc::BitmapTraits>::iterator m_maskIterator;
+};
+
 FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   : m_reader(context)
   , m_site(*const_cast<Site*>(m_reader.site()))
@@ -58,6 +177,11 @@ FilterManagerImpl::FilterManagerImpl(Context* context, Filter* filter)
   , m_src(nullptr)
   , m_dst(nullptr)
   , m_row(0)
+#ifdef ENABLE_UI
+  , m_previewPass(PreviewPass::None)
+  , m_flushRow1(0)
+  , m_flushRow2(0)
+#endif
   , m_mask(nullptr)
   , m_previewMask(nullptr)
   , m_targetOrig(TARGET_ALL_CHANNELS)
@@ -121,6 +245,9 @@ void FilterManagerImpl::begin()
   Doc* document = m_site.document();
 
   m_row = 0;
+#ifdef ENABLE_UI
+  m_previewPass = PreviewPass::None;
+#endif
   m_mask = (document->isMaskVisible() ? document->mask(): nullptr);
   m_taskToken = &m_noToken; // Don't use the preview token (which can be canceled)
   updateBounds(m_mask);
@@ -139,7 +266,9 @@ void FilterManagerImpl::beginForPreview()
     m_previewMask->replace(m_site.sprite()->bounds());
   }
 
-  m_row = m_nextRowToFlush = 0;
+  m_row = 0;
+  m_flushRow1 = m_flushRow2 = 0;
+  m_previewPass = PreviewPass::Coarse;
   m_mask = m_previewMask.get();
 
   // If we have a tiled mode enabled, we'll apply the filter to the whole areaes
@@ -182,8 +311,17 @@ bool FilterManagerImpl::applyStep()
     int x = m_bounds.x - m_mask->bounds().x;
     int y = m_bounds.y - m_mask->bounds().y + m_row;
     if ((x >= m_bounds.w) ||
-        (y >= m_bounds.h))
+        (y >= m_bounds.h)) {
+#ifdef ENABLE_UI
+      // Continue with the rows skipped in the coarse pass
+      if (m_previewPass == PreviewPass::Coarse) {
+        m_previewPass = PreviewPass::Fine;
+        m_row = 1;
+        return true;
+      }
+#endif
       return false;
+    }
 
     m_maskBits = m_mask->bitmap()
       ->lockBits<BitmapTraits>(Image::ReadLock,
@@ -201,64 +339,77 @@ bool FilterManagerImpl::applyStep()
     case IMAGE_GRAYSCALE: m_filter->applyToGrayscale(this); break;
     case IMAGE_INDEXED:   m_filter->applyToIndexed(this); break;
   }
+
+#ifdef ENABLE_UI
+  switch (m_previewPass) {
+
+    case PreviewPass::None:
+      ++m_row;
+      break;
+
+    case PreviewPass::Coarse: {
+      const int rows = std::min(kPreviewRowStep, m_bounds.h-m_row);
+      for (int i=1; i<rows; ++i)
+        copyPreviewRow(m_row, m_row+i);
+      addRowsToFlush(m_row, m_row+rows);
+
+      m_row += kPreviewRowStep;
+      if (m_row >= m_bounds.h) {
+        m_previewPass = PreviewPass::Fine;
+        m_row = 1;
+      }
+      break;
+    }
+
+    // Rows skipped in the coarse pass
+    case PreviewPass::Fine:
+      addRowsToFlush(m_row, m_row+1);
+      if ((++m_row % kPreviewRowStep) == 0)
+        ++m_row;
+      break;
+  }
+#else
   ++m_row;
+#endif
 
   return true;
 }
 
 void FilterManagerImpl::apply()
 {
+  APP_TRACE_ZONE("Apply filter");
   CommandResult result;
   bool cancelled = false;
 
   begin();
-  while (!cancelled && applyStep()) {
-    if (m_progressDelegate) {
-      // Report progress.
-      m_progressDelegate->reportProgress(m_progressBase + m_progressWidth * (m_row+1) / m_bounds.h);
-
-      // Does the user cancelled the whole process?
-      cancelled = m_progressDelegate->isCancelled();
-    }
+  if (canApplyInParallel() &&
+      m_bounds.w*m_bounds.h >= kParallelMinPixels) {
+    cancelled = !applyInParallel();
+  }
+  else {
+    // Report progress and check if the user cancelled the whole
+    // process only each N rows.
+    ProgressScope progress(
+      m_bounds.h,
+      [this](double f){
+        if (m_progressDelegate)
+          m_progressDelegate->reportProgress(m_progressBase + m_progressWidth * f);
+      },
+      [this]{
+        return (m_progressDelegate && m_progressDelegate->isCancelled());
+      });
+
+    while (!cancelled && applyStep())
+      cancelled = !progress.next();
   }
 
   if (!cancelled) {
-    gfx::Rect output;
-    if (algorithm::shrink_bounds2(m_src.get(), m_dst.get(),
-                                  m_bounds, output)) {
-      if (m_cel->layer()->isTilemap()) {
-        modify_tilemap_cel_region(
-          *m_tx,
-          m_cel, nullptr,
-          gfx::Region(output),
-          m_site.tilesetMode(),
-          [this](const doc::ImageRef& origTile,
-                 const gfx::Rect& tileBoundsInCanvas) -> doc::ImageRef {
-            return ImageRef(
-              crop_image(m_dst.get(),
-                         tileBoundsInCanvas.x,
-                         tileBoundsInCanvas.y,
-                         tileBoundsInCanvas.w,
-                         tileBoundsInCanvas.h,
-                         m_dst->maskColor()));
-          });
-      }
-      else if (m_cel->layer()->isBackground()) {
-        (*m_tx)(
-          new cmd::CopyRegion(
-            m_cel->image(),
-            m_dst.get(),
-            gfx::Region(output),
-            position()));
-      }
-      else {
-        // Patch "m_cel"
-        (*m_tx)(
-          new cmd::PatchCel(
-            m_cel, m_dst.get(),
-            gfx::Region(output),
-            position()));
-      }
+    // Only the modified tiles of the image are saved in the undo
+    // history (not the whole bounds of the modified pixels)
+    gfx::Region output;
+    if (algorithm::shrink_region2(m_src.get(), m_dst.get(),
+                                  m_bounds, kUndoTileSize, output)) {
+      patchCel(m_cel, m_dst, output);
     }
 
     result = CommandResult(CommandResult::kOk);
@@ -271,6 +422,108 @@ void FilterManagerImpl::apply()
   m_reader.context()->setCommandResult(result);
 }
 
+// Adds the commands to the transaction to copy the "output" region
+// from the filtered "dst" image to the given cel.
+void FilterManagerImpl::patchCel(doc::Cel* cel,
+                                 const doc::ImageRef& dst,
+                                 const gfx::Region& output)
+{
+  if (cel->layer()->isTilemap()) {
+    modify_tilemap_cel_region(
+      *m_tx,
+      cel, nullptr,
+      output,
+      m_site.tilesetMode(),
+      [dst](const doc::ImageRef& origTile,
+            const gfx::Rect& tileBoundsInCanvas) -> doc::ImageRef {
+        return ImageRef(
+          crop_image(dst.get(),
+                     tileBoundsInCanvas.x,
+                     tileBoundsInCanvas.y,
+                     tileBoundsInCanvas.w,
+                     tileBoundsInCanvas.h,
+                     dst->maskColor()));
+      });
+  }
+  else if (cel->layer()->isBackground()) {
+    (*m_tx)(
+      new cmd::CopyRegion(
+        cel->image(),
+        dst.get(),
+        output,
+        position()));
+  }
+  else {
+    // Patch "cel"
+    (*m_tx)(
+      new cmd::PatchCel(
+        cel, dst.get(),
+        output,
+        position()));
+  }
+}
+
+bool FilterManagerImpl::canApplyInParallel() const
+{
+  const doc::PixelFormat pf = pixelFormat();
+  return (m_filter->canApplyInParallel() &&
+          // Indexed images use the RgbMap, which isn't thread-safe
+          (pf == IMAGE_RGB || pf == IMAGE_GRAYSCALE) &&
+          doc::parallel_threads() > 1);
+}
+
+// Applies the filter to bands of kRowsPerBand rows in the thread
+// pool, while this thread reports the progress and checks if the
+// process was cancelled. Returns false if it was cancelled.
+bool FilterManagerImpl::applyInParallel()
+{
+  applyToPaletteIfNeeded();
+
+  // Make a private copy of the destination pixels (if they are
+  // shared) from this thread, before the bands start writing them.
+  m_dst->getPixelAddress(m_bounds.x, m_bounds.y);
+
+  const int h = m_bounds.h;
+  const int bands = (h + kRowsPerBand - 1) / kRowsPerBand;
+  const int tasks = std::min(doc::parallel_threads(), bands);
+
+  base::task_token token;
+  std::atomic<int> nextBand(0);
+  std::atomic<int> doneRows(0);
+  bool cancelled = false;
+
+  doc::parallel_for(
+    tasks,
+    [this, &token, &nextBand, &doneRows, bands, h](int){
+      RowBand band(this, token, m_src.get(), m_dst.get(),
+                   m_bounds, m_target, m_mask);
+      int i;
+      while (!token.canceled() && (i = nextBand++) < bands) {
+        const int row1 = i*kRowsPerBand;
+        const int row2 = std::min(row1+kRowsPerBand, h);
+        band.apply(row1, row2);
+        doneRows += row2-row1;
+      }
+    },
+    [this, &token, &doneRows, h, &cancelled]{
+      if (m_progressDelegate && !cancelled) {
+        m_progressDelegate->reportProgress(m_progressBase + m_progressWidth * doneRows / h);
+
+        if (m_progressDelegate->isCancelled()) {
+          cancelled = true;
+          token.cancel();
+        }
+      }
+    });
+
+  m_row = h;
+  if (m_progressDelegate && !cancelled) {
+    m_progressDelegate->reportProgress(m_progressBase + m_progressWidth);
+    cancelled = m_progressDelegate->isCancelled();
+  }
+  return !cancelled;
+}
+
 void FilterManagerImpl::applyToTarget()
 {
   applyToPaletteIfNeeded();
@@ -325,30 +578,137 @@ void FilterManagerImpl::applyToTarget()
                           m_site.frame(), &newPalette));
   }
 
-  // For each target image
-  for (auto it = cels.begin();
-       it != cels.end() && !cancelled;
-       ++it) {
-    Image* image = (*it)->image();
+  // Filter several cels at the same time
+  if (cels.size() > 1 && canApplyInParallel()) {
+    cancelled = !applyToCelsInParallel(cels);
 
-    // Avoid applying the filter two times to the same image
-    if (visited.find(image->id()) == visited.end()) {
-      visited.insert(image->id());
-      applyToCel(*it);
-    }
+    ASSERT(m_reader.context());
+    m_reader.context()->setCommandResult(
+      CommandResult(cancelled ? CommandResult::kCanceled:
+                                CommandResult::kOk));
+  }
+  else {
+    // For each target image
+    for (auto it = cels.begin();
+         it != cels.end() && !cancelled;
+         ++it) {
+      Image* image = (*it)->image();
+
+      // Avoid applying the filter two times to the same image
+      if (visited.find(image->id()) == visited.end()) {
+        visited.insert(image->id());
+        applyToCel(*it);
+      }
 
-    // Is there a delegate to know if the process was cancelled by the user?
-    if (m_progressDelegate)
-      cancelled = m_progressDelegate->isCancelled();
+      // Is there a delegate to know if the process was cancelled by the user?
+      if (m_progressDelegate)
+        cancelled = m_progressDelegate->isCancelled();
 
-    // Make progress
-    m_progressBase += m_progressWidth;
+      // Make progress
+      m_progressBase += m_progressWidth;
+    }
   }
 
   // Reset m_oldPalette to avoid restoring the color palette
   m_oldPalette.reset(nullptr);
 }
 
+// Filters groups of cels in the thread pool (each cel in one
+// thread), and then adds the commands to patch each cel in the
+// transaction from this thread. Returns false if the process was
+// cancelled.
+bool FilterManagerImpl::applyToCelsInParallel(const CelList& cels)
+{
+  Doc* doc = document();
+  Mask* mask = (doc->isMaskVisible() ? doc->mask(): nullptr);
+  if (!updateBounds(mask))
+    throw InvalidAreaException();
+
+  struct CelJob {
+    Cel* cel;
+    ImageRef src;
+    ImageRef dst;
+    gfx::Region output;
+    bool modified = false;
+    CelJob(Cel* cel) : cel(cel) { }
+  };
+
+  // Avoid applying the filter two times to the same image
+  std::vector<CelJob> jobs;
+  std::set<ObjectId> visited;
+  for (Cel* cel : cels) {
+    if (visited.insert(cel->image()->id()).second)
+      jobs.emplace_back(cel);
+  }
+
+  // Only a group of cels is filtered at the same time, so we don't
+  // need to keep a copy of all the images in memory.
+  const int groupSize = 2*doc::parallel_threads();
+  const float progressWidth = 1.0f / jobs.size();
+  const gfx::Rect bounds = m_bounds;
+
+  base::task_token token;
+  bool cancelled = false;
+
+  for (int g=0; g<int(jobs.size()) && !cancelled; g+=groupSize) {
+    const int n = std::min(groupSize, int(jobs.size())-g);
+    std::atomic<int> doneJobs(0);
+
+    doc::parallel_for(
+      n,
+      [this, &jobs, g, &bounds, mask, &token, &doneJobs](const int i){
+        CelJob& job = jobs[g+i];
+        if (!token.canceled()) {
+          job.src = crop_cel_image(job.cel, 0);
+          job.dst.reset(Image::createCopy(job.src.get()));
+
+          // The alpha channel of the background layer can't be modified
+          Target target = m_targetOrig;
+          if (job.cel->layer()->isBackground())
+            target &= ~TARGET_ALPHA_CHANNEL;
+
+          RowBand band(this, token, job.src.get(), job.dst.get(),
+                       bounds, target, mask);
+          band.apply(0, bounds.h);
+
+          if (!token.canceled()) {
+            job.modified =
+              algorithm::shrink_region2(job.src.get(), job.dst.get(),
+                                        bounds, kUndoTileSize, job.output);
+          }
+        }
+        ++doneJobs;
+      },
+      [this, &token, &doneJobs, g, progressWidth, &cancelled]{
+        if (m_progressDelegate && !cancelled) {
+          m_progressDelegate->reportProgress(progressWidth * (g + doneJobs));
+
+          if (m_progressDelegate->isCancelled()) {
+            cancelled = true;
+            token.cancel();
+          }
+        }
+      });
+
+    if (m_progressDelegate && !cancelled) {
+      m_progressDelegate->reportProgress(progressWidth * (g + n));
+      cancelled = m_progressDelegate->isCancelled();
+    }
+
+    // Patch the cels in the same order as the sequential version
+    for (int i=g; i<g+n; ++i) {
+      CelJob& job = jobs[i];
+      if (!cancelled && job.modified)
+        patchCel(job.cel, job.dst, job.output);
+
+      job.src.reset();
+      job.dst.reset();
+    }
+  }
+
+  return !cancelled;
+}
+
 void FilterManagerImpl::initTransaction()
 {
   ASSERT(!m_tx);
@@ -376,23 +736,23 @@ void FilterManagerImpl::commitTransaction()
 
 void FilterManagerImpl::flush()
 {
-  int h = m_row - m_nextRowToFlush;
+  int h = m_flushRow2 - m_flushRow1;
 
   if (m_row >= 0 && h > 0) {
     // Redraw the color palette
-    if (m_nextRowToFlush == 0 && paletteHasChanged())
+    if (m_flushRow1 == 0 && paletteHasChanged())
       redrawColorPalette();
 
     for (Editor* editor : UIContext::instance()->getAllEditorsIncludingPreview(document())) {
       // We expand the region one pixel at the top and bottom of the
-      // region [m_row,m_nextRowToFlush) to be updated on the screen to
-      // avoid screen artifacts when we apply filters like convolution
-      // matrices.
+      // region [m_flushRow1,m_flushRow2) to be updated on the screen
+      // to avoid screen artifacts when we apply filters like
+      // convolution matrices.
       gfx::Rect rect(
         editor->editorToScreen(
           gfx::Point(
             m_bounds.x,
-            m_bounds.y+m_nextRowToFlush-1)),
+            m_bounds.y+m_flushRow1-1)),
         gfx::Size(
           editor->projection().applyX(m_bounds.w),
           (editor->projection().scaleY() >= 1 ? editor->projection().applyY(h+2):
@@ -408,7 +768,35 @@ void FilterManagerImpl::flush()
       editor->invalidateRegion(reg1);
     }
 
-    m_nextRowToFlush = m_row+1;
+    m_flushRow1 = m_flushRow2 = 0;
+  }
+}
+
+void FilterManagerImpl::addRowsToFlush(const int row1, const int row2)
+{
+  if (m_flushRow1 < m_flushRow2) {
+    m_flushRow1 = std::min(m_flushRow1, row1);
+    m_flushRow2 = std::max(m_flushRow2, row2);
+  }
+  else {
+    m_flushRow1 = row1;
+    m_flushRow2 = row2;
+  }
+}
+
+// Copies the filtered pixels of the "fromRow" row to the selected
+// pixels of the "toRow" row (used in the coarse pass of the preview,
+// the fine pass will filter these pixels again).
+void FilterManagerImpl::copyPreviewRow(const int fromRow, const int toRow)
+{
+  const int bpp = m_dst->bytesPerPixel();
+  const int y = m_bounds.y+toRow;
+  const uint8_t* src = (const uint8_t*)m_dst->getPixelAddress(m_bounds.x, m_bounds.y+fromRow);
+  uint8_t* dst = (uint8_t*)m_dst->getPixelAddress(m_bounds.x, y);
+
+  for (int x=m_bounds.x; x<m_bounds.x+m_bounds.w; ++x, src+=bpp, dst+=bpp) {
+    if (!m_mask || m_mask->containsPoint(x, y))
+      std::memcpy(dst, src, bpp);
   }
 }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,12 +15,14 @@
 #include "app/tx.h"
 #include "base/exception.h"
 #include "base/task.h"
+#include "doc/cel_list.h"
 #include "doc/image_impl.h"
 #include "doc/image_ref.h"
 #include "doc/pixel_format.h"
 #include "filters/filter_indexed_data.h"
 #include "filters/filter_manager.h"
 #include "gfx/rect.h"
+#include "gfx/region.h"
 
 #include <cstring>
 #include <memory>
@@ -130,9 +132,19 @@ namespace app {
     doc::PalettePicks getPalettePicks() override;
 
   private:
+    // FilterManager used by each thread to apply the filter to a band
+    // of rows in parallel.
+    class RowBand;
+
     void init(doc::Cel* cel);
     void apply();
+    bool canApplyInParallel() const;
+    bool applyInParallel();
     void applyToCel(doc::Cel* cel);
+    bool applyToCelsInParallel(const doc::CelList& cels);
+    void patchCel(doc::Cel* cel,
+                  const doc::ImageRef& dst,
+                  const gfx::Region& output);
     bool updateBounds(doc::Mask* mask);
 
     // Returns true if the palette was changed (true when the filter
@@ -143,6 +155,8 @@ namespace app {
 
 #ifdef ENABLE_UI
     void redrawColorPalette();
+    void addRowsToFlush(const int row1, const int row2);
+    void copyPreviewRow(const int fromRow, const int toRow);
 #endif
 
     ContextReader m_reader;
@@ -154,7 +168,9 @@ namespace app {
     doc::ImageRef m_dst;
     int m_row;
 #ifdef ENABLE_UI
-    int m_nextRowToFlush;
+    enum class PreviewPass { None, Coarse, Fine };
+    PreviewPass m_previewPass;
+    int m_flushRow1, m_flushRow2; // Rows filtered since the last flush()
 #endif
     gfx::Rect m_bounds;
     doc::Mask* m_mask;
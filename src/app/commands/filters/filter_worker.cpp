@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,17 +15,18 @@
 #include "app/i18n/strings.h"
 #include "app/ini_file.h"
 #include "app/modules/gui.h"
+#include "app/task_scheduler.h"
 #include "app/ui/editor/editor.h"
 #include "app/ui/status_bar.h"
 #include "base/thread.h"
 #include "doc/sprite.h"
 #include "ui/ui.h"
 
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
 #include <functional>
-#include <mutex>
-#include <thread>
+#include <future>
 
 namespace app {
 
@@ -95,11 +96,11 @@ private:
 #endif
 
   FilterManagerImpl* m_filterMgr; // Effect to be applied.
-  std::mutex m_mutex;           // Mutex to access to 'pos', 'done' and 'cancelled' fields in different threads.
-  float m_pos;                  // Current progress position
-  bool m_done;                  // Was the effect completely applied?
-  bool m_cancelled;             // Was the effect cancelled by the user?
-  bool m_abort;                 // An exception was thrown
+  // These fields are accessed from different threads
+  std::atomic<float> m_pos;     // Current progress position
+  std::atomic<bool> m_done;     // Was the effect completely applied?
+  std::atomic<bool> m_cancelled; // Was the effect cancelled by the user?
+  std::atomic<bool> m_abort;    // An exception was thrown
   std::string m_error;
 #ifdef ENABLE_UI
   std::unique_ptr<FilterWorkerAlert> m_alert;
@@ -136,11 +137,12 @@ void FilterWorker::run()
   m_filterMgr->initTransaction();
 
 #ifdef ENABLE_UI
-  std::thread thread;
+  std::future<void> future;
   // Open the alert window in foreground (this is modal, locks the main thread)
   if (m_alert) {
-    // Launch the thread to apply the effect in background
-    thread = std::thread([this]{ applyFilterInBackground(); });
+    // Apply the effect in background
+    future = TaskScheduler::instance().execute(
+      TaskPriority::UserJob, [this]{ applyFilterInBackground(); });
     m_alert->openAndWait();
   }
   else
@@ -150,18 +152,15 @@ void FilterWorker::run()
     applyFilterInBackground();
   }
 
-  {
-    const std::lock_guard lock(m_mutex);
-    if (m_done && m_filterMgr->isTransaction())
-      m_filterMgr->commitTransaction();
-    else
-      m_cancelled = true;
-  }
+  if (m_done && m_filterMgr->isTransaction())
+    m_filterMgr->commitTransaction();
+  else
+    m_cancelled = true;
 
 #ifdef ENABLE_UI
-  // Wait the `effect_bg' thread
-  if (thread.joinable())
-    thread.join();
+  // Wait the background task
+  if (future.valid())
+    future.wait();
 
   if (!m_error.empty()) {
     Console console;
@@ -180,7 +179,6 @@ void FilterWorker::run()
 //
 void FilterWorker::reportProgress(float progress)
 {
-  const std::lock_guard lock(m_mutex);
   m_pos = progress;
 }
 
@@ -190,12 +188,7 @@ void FilterWorker::reportProgress(float progress)
 //
 bool FilterWorker::isCancelled()
 {
-  bool cancelled;
-
-  const std::lock_guard lock(m_mutex);
-  cancelled = (m_cancelled || m_abort);
-
-  return cancelled;
+  return (m_cancelled || m_abort);
 }
 
 // Applies the effect to the sprite in a background thread.
@@ -209,7 +202,6 @@ void FilterWorker::applyFilterInBackground()
     m_filterMgr->applyToTarget();
 
     // Mark the work as 'done'.
-    const std::lock_guard lock(m_mutex);
     m_done = true;
   }
   catch (std::exception& e) {
@@ -224,8 +216,6 @@ void FilterWorker::applyFilterInBackground()
 // every 100 milliseconds).
 void FilterWorker::onMonitoringTick()
 {
-  const std::lock_guard lock(m_mutex);
-
   if (m_alert) {
     m_alert->setProgress(m_pos);
 
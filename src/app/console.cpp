@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "app/console.h"
 
 #include "app/app.h"
+#include "app/cli/cli_output_cache.h"
 #include "app/context.h"
 #include "app/i18n/strings.h"
 #include "app/modules/gui.h"
@@ -244,6 +245,10 @@ void Console::printf(const char* format, ...)
   va_end(ap);
 
   if (!m_withUI) {
+    // Messages in batch mode are errors/warnings, the outputs of
+    // this execution cannot be restored from the cache
+    CliOutputCache::notifyError();
+
     fputs(msg.c_str(), stdout);
     fflush(stdout);
     return;
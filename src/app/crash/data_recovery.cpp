@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -24,6 +24,7 @@
 
 #include <algorithm>
 #include <chrono>
+#include <functional>
 #include <thread>
 
 namespace app {
@@ -113,7 +114,6 @@ void DataRecovery::launchSearch()
     [this]{
       base::this_thread::set_name("search-sessions");
       searchForSessions();
-      m_searching = false;
     });
 }
 
@@ -139,11 +139,21 @@ DataRecovery::Sessions DataRecovery::sessions()
 
 void DataRecovery::searchForSessions()
 {
-  Sessions sessions;
+  {
+    std::unique_lock<std::mutex> lock(m_sessionsMutex);
+    m_sessions.clear();
+  }
+
+  // Sort sessions from the most recent one to the oldest one (the
+  // name of each folder starts with the date/time of the session), so
+  // sessions can be added at the end of the list as they are loaded
+  base::paths itemnames = base::list_files(m_sessionsDir);
+  std::sort(itemnames.begin(), itemnames.end(),
+            std::greater<std::string>());
 
   // Existent sessions
   RECO_TRACE("RECO: Listing sessions from '%s'\n", m_sessionsDir.c_str());
-  for (auto& itemname : base::list_files(m_sessionsDir)) {
+  for (auto& itemname : itemnames) {
     std::string itempath = base::join_path(m_sessionsDir, itemname);
     if (base::is_directory(itempath)) {
       RECO_TRACE("RECO: Session '%s'\n", itempath.c_str());
@@ -160,7 +170,16 @@ void DataRecovery::searchForSessions()
         }
         else {
           RECO_TRACE("RECO:  - to be loaded\n");
-          sessions.push_back(session);
+
+          // Load the information of each backup in this thread (so
+          // the UI thread doesn't need to read any file)
+          session->backups();
+
+          {
+            std::unique_lock<std::mutex> lock(m_sessionsMutex);
+            m_sessions.push_back(session);
+          }
+          notifySessionsList();
         }
       }
       else
@@ -168,18 +187,12 @@ void DataRecovery::searchForSessions()
     }
   }
 
-  // Sort sessions from the most recent one to the oldest one
-  std::sort(sessions.begin(), sessions.end(),
-            [](const SessionPtr& a, const SessionPtr& b) {
-              return a->name() > b->name();
-            });
-
-  // Assign m_sessions=sessions
-  {
-    std::unique_lock<std::mutex> lock(m_sessionsMutex);
-    std::swap(m_sessions, sessions);
-  }
+  m_searching = false;
+  notifySessionsList();
+}
 
+void DataRecovery::notifySessionsList()
+{
   ui::execute_from_ui_thread(
     [this]{
       if (g_stillAliveFlag)
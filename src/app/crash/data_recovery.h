@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -42,17 +42,20 @@ namespace crash {
 
     Session* activeSession() { return m_inProgress.get(); }
 
-    // Returns a copy of the list of sessions that can be recovered.
+    // Returns a copy of the list of sessions that can be recovered
+    // (while isSearching() is true, the sessions found until now).
     Sessions sessions();
 
     // Triggered in the UI-thread from the m_thread using an
-    // ui::execute_from_ui_thread() when the list of sessions is ready
-    // to be used.
+    // ui::execute_from_ui_thread() each time a new session (with its
+    // backups already loaded) is added to the list, and when the
+    // search finishes.
     obs::signal<void()> SessionsListIsReady;
 
   private:
     // Executed from m_thread to search for the list of sessions.
     void searchForSessions();
+    void notifySessionsList();
 
     std::string m_sessionsDir;
     mutable std::mutex m_sessionsMutex;
@@ -0,0 +1,174 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/crash/image_delta.h"
+
+#include "base/serialization.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/primitives.h"
+
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+namespace app {
+namespace crash {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+using namespace doc;
+
+// Written in the place of the pixel format of doc::write_image(), so
+// read_image() fails for deltas (e.g. in older versions of the
+// program) and they are skipped as corrupted versions of the image.
+static const int kImageDeltaMarker = 0xff;
+
+static gfx::Rect tile_bounds(const int width, const int height, const int index)
+{
+  const int cols = (width + kImageDeltaTileSize - 1) / kImageDeltaTileSize;
+  const gfx::Rect bounds((index % cols) * kImageDeltaTileSize,
+                         (index / cols) * kImageDeltaTileSize,
+                         kImageDeltaTileSize,
+                         kImageDeltaTileSize);
+  return (bounds & gfx::Rect(0, 0, width, height));
+}
+
+// Hash of the raw pixels of the given tile. It's not a cryptographic
+// hash, but we process 8 bytes in each step so it's fast enough to be
+// calculated for each new version of big images.
+static uint64_t tile_hash(const Image* image, const gfx::Rect& bounds)
+{
+  const int widthBytes = bounds.w * image->bytesPerPixel();
+  uint64_t h = 14695981039346656037ull;
+  for (int y=bounds.y; y<bounds.y2(); ++y) {
+    const uint8_t* p = image->getPixelAddress(bounds.x, y);
+    int n = widthBytes;
+    for (; n >= 8; n-=8, p+=8) {
+      uint64_t v;
+      std::memcpy(&v, p, 8);
+      h = (h ^ v) * 1099511628211ull;
+      h ^= (h >> 32);
+    }
+    for (; n > 0; --n, ++p)
+      h = (h ^ *p) * 1099511628211ull;
+  }
+  return h;
+}
+
+bool calculate_image_tiles(const Image* image, ImageTiles& tiles)
+{
+  // Bitmaps use less than one byte per pixel
+  if (image->pixelFormat() == IMAGE_BITMAP)
+    return false;
+
+  tiles.pixelFormat = image->pixelFormat();
+  tiles.width = image->width();
+  tiles.height = image->height();
+
+  const int cols = (tiles.width + kImageDeltaTileSize - 1) / kImageDeltaTileSize;
+  const int rows = (tiles.height + kImageDeltaTileSize - 1) / kImageDeltaTileSize;
+  tiles.hashes.resize(cols * rows);
+  for (int i=0; i<cols*rows; ++i)
+    tiles.hashes[i] = tile_hash(image, tile_bounds(tiles.width,
+                                                   tiles.height, i));
+  return true;
+}
+
+bool get_modified_tiles(const ImageTiles& base,
+                        const ImageTiles& tiles,
+                        std::vector<int>& modified)
+{
+  if (base.pixelFormat != tiles.pixelFormat ||
+      base.width != tiles.width ||
+      base.height != tiles.height ||
+      base.hashes.size() != tiles.hashes.size())
+    return false;
+
+  modified.clear();
+  for (int i=0; i<int(tiles.hashes.size()); ++i) {
+    if (base.hashes[i] != tiles.hashes[i])
+      modified.push_back(i);
+  }
+  return true;
+}
+
+bool write_image_delta(std::ostream& os,
+                       const Image* image,
+                       const ObjectId id,
+                       const ObjectVersion baseVersion,
+                       const std::vector<int>& modified,
+                       const int compressionLevel)
+{
+  write32(os, id);
+  write8(os, kImageDeltaMarker);
+  write32(os, baseVersion);
+  write8(os, image->pixelFormat());
+  write16(os, image->width());
+  write16(os, image->height());
+  write32(os, image->maskColor());
+
+  write32(os, modified.size());
+  for (const int i : modified) {
+    const gfx::Rect bounds = tile_bounds(image->width(), image->height(), i);
+    std::unique_ptr<Image> tile(crop_image(image, bounds, image->maskColor()));
+
+    write32(os, i);
+    if (!write_image(os, tile.get(), 0, nullptr, compressionLevel))
+      return false;
+  }
+  return true;
+}
+
+Image* read_backup_image(
+  std::istream& is,
+  const std::function<Image*(ObjectId, ObjectVersion)>& loadBase)
+{
+  const auto pos = is.tellg();
+  const ObjectId id = read32(is);
+  if (read8(is) != kImageDeltaMarker) {
+    is.seekg(pos);
+    return read_image(is, false);
+  }
+
+  const ObjectVersion baseVersion = read32(is);
+  const int pixelFormat = read8(is);
+  const int width = read16(is);
+  const int height = read16(is);
+  const uint32_t maskColor = read32(is);
+  const int ntiles = read32(is);
+  if (!is)
+    return nullptr;
+
+  std::unique_ptr<Image> image(loadBase(id, baseVersion));
+  if (!image ||
+      image->pixelFormat() != pixelFormat ||
+      image->width() != width ||
+      image->height() != height)
+    return nullptr;
+  image->setMaskColor(maskColor);
+
+  for (int j=0; j<ntiles; ++j) {
+    const int i = read32(is);
+    std::unique_ptr<Image> tile(read_image(is, false));
+    if (!is || !tile || tile->pixelFormat() != pixelFormat)
+      return nullptr;
+
+    const gfx::Rect bounds = tile_bounds(width, height, i);
+    if (bounds.isEmpty() || bounds.size() != tile->size())
+      return nullptr;
+
+    copy_image(image.get(), tile.get(), bounds.x, bounds.y);
+  }
+  return image.release();
+}
+
+} // namespace crash
+} // namespace app
@@ -0,0 +1,70 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_CRASH_IMAGE_DELTA_H_INCLUDED
+#define APP_CRASH_IMAGE_DELTA_H_INCLUDED
+#pragma once
+
+#include "doc/image_ref.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+#include "doc/pixel_format.h"
+
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <vector>
+
+namespace app {
+namespace crash {
+
+  // Size of the tiles used to compare two versions of an image.
+  const int kImageDeltaTileSize = 64;
+
+  // Hash of each tile of the last full version of an image saved in
+  // the backup (the "base" version). The next versions of the image
+  // are saved as deltas of this base version: only the tiles with a
+  // different hash.
+  struct ImageTiles {
+    doc::ObjectVersion baseVersion = 0;
+    doc::PixelFormat pixelFormat = doc::IMAGE_RGB;
+    int width = 0;
+    int height = 0;
+    std::vector<uint64_t> hashes;
+    // Number of deltas saved from the base version
+    int deltas = 0;
+  };
+
+  // Returns false if the image format doesn't support deltas.
+  bool calculate_image_tiles(const doc::Image* image, ImageTiles& tiles);
+
+  // Returns the indexes of the tiles which are different in both
+  // images, or false if the images cannot be compared (different
+  // size or pixel format).
+  bool get_modified_tiles(const ImageTiles& base,
+                          const ImageTiles& tiles,
+                          std::vector<int>& modified);
+
+  // Writes the given "modified" tiles of the image as a delta of the
+  // "baseVersion". The result can be read with read_backup_image().
+  bool write_image_delta(std::ostream& os,
+                         const doc::Image* image,
+                         const doc::ObjectId id,
+                         const doc::ObjectVersion baseVersion,
+                         const std::vector<int>& modified,
+                         const int compressionLevel);
+
+  // Reads an image written with doc::write_image() or
+  // write_image_delta(). "loadBase" is used to read the full base
+  // version of a delta.
+  doc::Image* read_backup_image(
+    std::istream& is,
+    const std::function<doc::Image*(doc::ObjectId, doc::ObjectVersion)>& loadBase);
+
+} // namespace crash
+} // namespace app
+
+#endif
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -19,6 +20,11 @@ namespace crash {
 
   const uint32_t MAGIC_NUMBER = 0x454E4946; // 'FINE' in ASCII
 
+  // File in each backup directory with the DocumentInfo precalculated
+  // (so we don't need to read the document objects to list backups)
+  const char* const INDEX_FILENAME = "index";
+  const int INDEX_VERSION = 1;
+
   class ObjVersions {
   public:
     ObjVersions() {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 
 #include "app/console.h"
 #include "app/crash/doc_format.h"
+#include "app/crash/image_delta.h"
 #include "app/crash/internals.h"
 #include "app/crash/log.h"
 #include "app/doc.h"
@@ -22,6 +23,7 @@
 #include "base/fstream_path.h"
 #include "base/serialization.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
 #include "doc/cel.h"
 #include "doc/cel_data_io.h"
 #include "doc/cel_io.h"
@@ -45,9 +47,14 @@
 #include "doc/user_data_io.h"
 #include "doc/util.h"
 #include "fixmath/fixmath.h"
+#include "fmt/format.h"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <mutex>
+#include <set>
+#include <thread>
 
 namespace app {
 namespace crash {
@@ -58,6 +65,80 @@ using namespace doc;
 
 namespace {
 
+// Reads the DocumentInfo from the index file of the backup
+bool read_document_index(const std::string& dir, DocumentInfo& info)
+{
+  std::ifstream s(FSTREAM_PATH(base::join_path(dir, INDEX_FILENAME)),
+                  std::ifstream::binary);
+  if (!s ||
+      read32(s) != MAGIC_NUMBER ||
+      read16(s) != INDEX_VERSION)
+    return false;
+
+  const ObjectId sprId = read32(s);
+  const ObjectVersion sprVer = read32(s);
+  const int mode = read8(s);
+  const int width = read32(s);
+  const int height = read32(s);
+  const frame_t frames = read32(s);
+  std::string filename = read_string(s);
+  if (!s)
+    return false;
+
+  // The last backup wasn't completely written
+  if (!base::is_file(base::join_path(dir, fmt::format("spr-{}.{}", sprId, sprVer))))
+    return false;
+
+  info.mode = ColorMode(mode);
+  info.width = width;
+  info.height = height;
+  info.frames = frames;
+  info.filename = std::move(filename);
+  return true;
+}
+
+// Reads the full version of an image used as base of its deltas
+Image* read_base_image(const std::string& dir,
+                       const ObjectId id,
+                       const ObjectVersion ver)
+{
+  std::string fn = "img-";
+  fn += base::convert_to<std::string>(id);
+  fn.push_back('.');
+  fn += base::convert_to<std::string>(ver);
+
+  std::ifstream s(FSTREAM_PATH(base::join_path(dir, fn)), std::ifstream::binary);
+  if (s && read32(s) == MAGIC_NUMBER)
+    return read_image(s, false);
+  return nullptr;
+}
+
+// Reads an "img" object (a full image or a delta)
+Image* read_image_object(std::istream& s, const std::string& dir)
+{
+  return read_backup_image(
+    s, [&dir](ObjectId id, ObjectVersion ver){
+      return read_base_image(dir, id, ver);
+    });
+}
+
+// Calls func(i) for each i in [0, n) using all the available CPUs
+template<typename Func>
+void parallel_for_each_index(const std::size_t n, Func&& func)
+{
+  const int threads = int(std::min<std::size_t>(n, std::thread::hardware_concurrency()));
+  if (threads > 1) {
+    base::thread_pool pool(threads);
+    for (std::size_t i=0; i<n; ++i)
+      pool.execute([&func, i]{ func(i); });
+    // The pool destructor waits all the tasks
+  }
+  else {
+    for (std::size_t i=0; i<n; ++i)
+      func(i);
+  }
+}
+
 class Reader : public SubObjectsIO {
 public:
   Reader(const std::string& dir,
@@ -95,10 +176,17 @@ public:
 
         m_docVersions = &versions;
       }
+      else if (fn.compare(0, 4, "img-") == 0) {
+        m_imageIds.insert(id);
+      }
     }
   }
 
   Doc* loadDocument() {
+    // All images are decoded in parallel before loading the object
+    // graph (decoding images takes most of the time)
+    loadImagesInParallel();
+
     Doc* doc = loadObject<Doc*>("doc", m_docId, &Reader::readDocument);
     if (doc)
       fixUndetectedDocumentIssues(doc);
@@ -144,10 +232,71 @@ private:
     return m_celdatas[celdataId] = celData;
   }
 
+  void loadImagesInParallel() {
+    const std::vector<ObjectId> ids(m_imageIds.begin(), m_imageIds.end());
+    std::vector<Image*> images(ids.size(), nullptr);
+
+    parallel_for_each_index(
+      ids.size(),
+      [this, &ids, &images](const std::size_t i){
+        if (canceled())
+          return;
+        try {
+          images[i] = tryLoadObject<Image*>("img", ids[i], &Reader::readImage);
+        }
+        catch (const std::exception&) {
+          // The image will be loaded again from getImageRef() (to
+          // report the error)
+        }
+      });
+
+    for (std::size_t i=0; i<ids.size(); ++i) {
+      if (images[i])
+        m_images[ids[i]].reset(images[i]);
+    }
+  }
+
+  void loadTilesetsInParallel(const std::vector<ObjectId>& ids,
+                              std::vector<Tileset*>& tilesets) {
+    tilesets.resize(ids.size(), nullptr);
+
+    parallel_for_each_index(
+      ids.size(),
+      [this, &ids, &tilesets](const std::size_t i){
+        if (canceled())
+          return;
+        try {
+          tilesets[i] = tryLoadObject<Tileset*>("tset", ids[i], &Reader::readTileset);
+        }
+        catch (const std::exception&) {
+          // Loaded again from the main thread (to report the error)
+        }
+      });
+  }
+
   template<typename T>
   T loadObject(const char* prefix, ObjectId id, T (Reader::*readMember)(std::ifstream&)) {
-    const ObjVersions& versions = m_objVersions[id];
+    T obj = tryLoadObject<T>(prefix, id, readMember);
+    if (obj)
+      return obj;
+
+    // Show error only if we've failed to load all versions
+    if (!m_loadInfo)
+      Console().printf("Error loading object %s #%d\n", prefix, id);
+
+    return nullptr;
+  }
 
+  // Tries to load all the versions of the given object (from the
+  // newest one to the oldest). It doesn't modify m_objVersions so it
+  // can be called from several threads at the same time.
+  template<typename T>
+  T tryLoadObject(const char* prefix, ObjectId id, T (Reader::*readMember)(std::ifstream&)) {
+    auto itVersions = m_objVersions.find(id);
+    if (itVersions == m_objVersions.end())
+      return nullptr;
+
+    const ObjVersions& versions = itVersions->second;
     for (size_t i=0; i<versions.size(); ++i) {
       ObjectVersion ver = versions[i];
       if (!ver)
@@ -174,11 +323,6 @@ private:
         RECO_TRACE("RECO: %s #%d v%d was not restored\n", prefix, id, ver);
       }
     }
-
-    // Show error only if we've failed to load all versions
-    if (!m_loadInfo)
-      Console().printf("Error loading object %s #%d\n", prefix, id);
-
     return nullptr;
   }
 
@@ -258,9 +402,17 @@ private:
     if (m_docFormatVer >= DOC_FORMAT_VERSION_1) {
       int ntilesets = read32(s);
       if (ntilesets > 0 && ntilesets < 0xffffff) {
+        std::vector<ObjectId> tilesetIds(ntilesets);
+        for (int i=0; i<ntilesets; ++i)
+          tilesetIds[i] = read32(s);
+
+        std::vector<Tileset*> tilesets;
+        loadTilesetsInParallel(tilesetIds, tilesets);
+
         for (int i=0; i<ntilesets; ++i) {
-          ObjectId tilesetId = read32(s);
-          Tileset* tileset = loadObject<Tileset*>("tset", tilesetId, &Reader::readTileset);
+          Tileset* tileset = tilesets[i];
+          if (!tileset && !canceled())
+            tileset = loadObject<Tileset*>("tset", tilesetIds[i], &Reader::readTileset);
           if (tileset)
             spr->tilesets()->add(tileset);
           else
@@ -501,7 +653,7 @@ private:
   }
 
   Image* readImage(std::ifstream& s) {
-    return read_image(s, false);
+    return read_image_object(s, m_dir);
   }
 
   Palette* readPalette(std::ifstream& s) {
@@ -511,8 +663,11 @@ private:
   Tileset* readTileset(std::ifstream& s) {
     uint32_t tilesetVer;
     Tileset* tileset = read_tileset(s, m_sprite, false, &tilesetVer, m_docFormatVer);
-    if (tileset && tilesetVer < TILESET_VER1)
+    if (tileset && tilesetVer < TILESET_VER1) {
+      // Tilesets are read from several threads
+      const std::lock_guard lock(m_mutex);
       m_updateOldTilemapWithTileset.insert(tileset->id());
+    }
     return tileset;
   }
 
@@ -581,11 +736,13 @@ private:
   ObjVersions* m_docVersions;
   DocumentInfo* m_loadInfo;
   std::vector<std::pair<ObjectId, ObjectId> > m_celsToLoad;
+  std::set<ObjectId> m_imageIds;
   std::map<ObjectId, ImageRef> m_images;
   std::map<ObjectId, CelDataRef> m_celdatas;
   // Each ObjectId is a tileset ID that didn't contain the empty tile
   // as the first tile (this was an old format used in internal betas)
   std::set<ObjectId> m_updateOldTilemapWithTileset;
+  std::mutex m_mutex;
   base::task_token* m_taskToken;
 };
 
@@ -596,6 +753,10 @@ private:
 
 bool read_document_info(const std::string& dir, DocumentInfo& info)
 {
+  if (read_document_index(dir, info))
+    return true;
+
+  // Backups created with older versions don't have an index
   return Reader(dir, nullptr).loadDocumentInfo(info);
 }
 
@@ -642,7 +803,7 @@ Doc* read_document_with_raw_images(const std::string& dir,
 
     ImageRef img;
     if (read32(s) == MAGIC_NUMBER)
-      img.reset(read_image(s, false));
+      img.reset(read_image_object(s, dir));
 
     if (img) {
       lay->addCel(new Cel(frame, img));
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -24,6 +24,7 @@
 #include "base/convert_to.h"
 #include "base/fs.h"
 #include "base/fstream_path.h"
+#include "base/mem_utils.h"
 #include "base/process.h"
 #include "base/split_string.h"
 #include "base/string.h"
@@ -42,19 +43,24 @@ static const char* kOpenFilename = "open"; // File that indicates if the documen
 
 Session::Backup::Backup(const std::string& dir)
   : m_dir(dir)
+  , m_size(0)
 {
   DocumentInfo info;
   read_document_info(dir, info);
 
+  for (const auto& fn : base::list_files(dir))
+    m_size += base::file_size(base::join_path(dir, fn));
+
   m_fn = info.filename;
   m_desc =
-    fmt::format("{} Sprite {}x{}, {} {}",
+    fmt::format("{} Sprite {}x{}, {} {}, {}",
                 info.mode == ColorMode::RGB ? "RGB":
                 info.mode == ColorMode::GRAYSCALE ? "Grayscale":
                 info.mode == ColorMode::INDEXED ? "Indexed":
                 info.mode == ColorMode::BITMAP ? "Bitmap": "Unknown",
                 info.width, info.height, info.frames,
-                info.frames == 1 ? "frame": "frames");
+                info.frames == 1 ? "frame": "frames",
+                base::get_pretty_memory_size(m_size));
 }
 
 std::string Session::Backup::description(const bool withFullPath) const
@@ -228,9 +234,19 @@ public:
 
 bool Session::saveDocumentChanges(Doc* doc)
 {
-  CustomWeakDocReader reader(doc);
-  if (!reader.isLocked())
-    return false;
+  // The document is locked only to copy its modified objects, the
+  // snapshot is written to disk without the lock (so the user can
+  // continue editing the document)
+  std::unique_ptr<DocSnapshot> snapshot;
+  {
+    CustomWeakDocReader reader(doc);
+    if (!reader.isLocked())
+      return false;
+
+    snapshot = snapshot_document(doc, &reader);
+    if (!snapshot)
+      return false;
+  }
 
   app::Context ctx;
   std::string dir = base::join_path(m_path,
@@ -252,7 +268,7 @@ bool Session::saveDocumentChanges(Doc* doc)
   }
 
   // Save document information
-  return write_document(dir, doc, &reader);
+  return write_document_snapshot(dir, snapshot.get());
 }
 
 void Session::removeDocument(Doc* doc)
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -33,8 +33,11 @@ namespace crash {
       Backup(const std::string& dir);
       const std::string& dir() const { return m_dir; }
       std::string description(const bool withFullPath) const;
+      // Size in bytes of all the files in the backup directory
+      std::size_t size() const { return m_size; }
     private:
       std::string m_dir;
+      std::size_t m_size;
       std::string m_desc;
       std::string m_fn;
     };
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "app/crash/write_document.h"
 
 #include "app/crash/doc_format.h"
+#include "app/crash/image_delta.h"
 #include "app/crash/internals.h"
 #include "app/crash/log.h"
 #include "app/doc.h"
@@ -20,12 +21,14 @@
 #include "base/fstream_path.h"
 #include "base/serialization.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
 #include "doc/cancel_io.h"
 #include "doc/cel.h"
 #include "doc/cel_data_io.h"
 #include "doc/cel_io.h"
 #include "doc/cels_range.h"
 #include "doc/frame.h"
+#include "doc/image.h"
 #include "doc/image_io.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
@@ -43,8 +46,11 @@
 #include "doc/user_data_io.h"
 #include "fixmath/fixmath.h"
 
+#include <algorithm>
 #include <fstream>
 #include <map>
+#include <sstream>
+#include <thread>
 
 namespace app {
 namespace crash {
@@ -57,15 +63,26 @@ namespace {
 
 static std::map<ObjectId, ObjVersionsMap> g_docVersions;
 static std::map<ObjectId, base::paths> g_deleteFiles;
+static std::map<ObjectId, std::map<ObjectId, ImageTiles>> g_docImageTiles;
 
-class Writer {
+// zlib level used to compress the images in backups (Z_BEST_SPEED)
+static const int kBackupCompressionLevel = 1;
+
+// After this number of deltas a full version of the image is saved
+// again (so the deltas don't reference old files forever)
+static const int kMaxImageDeltas = 16;
+
+// Copies the modified objects of a document in a DocSnapshot. Images
+// are copied as they are (they are compressed later), and the rest of
+// objects (which are small) are serialized in memory.
+class SnapshotBuilder {
 public:
-  Writer(const std::string& dir, Doc* doc, doc::CancelIO* cancel)
-    : m_dir(dir)
-    , m_doc(doc)
+  SnapshotBuilder(Doc* doc, DocSnapshot* snapshot, doc::CancelIO* cancel)
+    : m_doc(doc)
+    , m_snapshot(snapshot)
     , m_objVersions(g_docVersions[doc->id()])
-    , m_deleteFiles(g_deleteFiles[doc->id()])
     , m_cancel(cancel) {
+    m_snapshot->docId = doc->id();
   }
 
   bool saveDocument() {
@@ -75,7 +92,7 @@ public:
     // objects (e.g. cels, layers, etc.)
 
     for (Palette* pal : spr->getPalettes())
-      if (!saveObject("pal", pal, &Writer::writePalette))
+      if (!saveObject("pal", pal, &SnapshotBuilder::writePalette))
         return false;
 
     if (spr->hasTilesets()) {
@@ -83,18 +100,18 @@ public:
         // The tileset can be nullptr if it was erased (as we keep
         // empty spaces in the Tilesets array)
         if (tset) {
-          if (!saveObject("tset", tset, &Writer::writeTileset))
+          if (!saveObject("tset", tset, &SnapshotBuilder::writeTileset))
             return false;
         }
       }
     }
 
     for (Tag* frtag : spr->tags())
-      if (!saveObject("frtag", frtag, &Writer::writeFrameTag))
+      if (!saveObject("frtag", frtag, &SnapshotBuilder::writeFrameTag))
         return false;
 
     for (Slice* slice : spr->slices())
-      if (!saveObject("slice", slice, &Writer::writeSlice))
+      if (!saveObject("slice", slice, &SnapshotBuilder::writeSlice))
         return false;
 
     // Get all layers (visible, hidden, subchildren, etc.)
@@ -109,10 +126,10 @@ public:
         if (cel->link())        // Skip link
           continue;
 
-        if (!saveObject("img", cel->image(), &Writer::writeImage))
+        if (!saveImage("img", cel->image()))
           return false;
 
-        if (!saveObject("celdata", cel->data(), &Writer::writeCelData))
+        if (!saveObject("celdata", cel->data(), &SnapshotBuilder::writeCelData))
           return false;
       }
     }
@@ -123,23 +140,30 @@ public:
       lay->getCels(cels);
 
       for (Cel* cel : cels)
-        if (!saveObject("cel", cel, &Writer::writeCel))
+        if (!saveObject("cel", cel, &SnapshotBuilder::writeCel))
           return false;
     }
 
     // Save all layers (top level, groups, children, etc.)
     for (Layer* lay : layers)
-      if (!saveObject("lay", lay, &Writer::writeLayerStructure))
+      if (!saveObject("lay", lay, &SnapshotBuilder::writeLayerStructure))
         return false;
 
-    if (!saveObject("spr", spr, &Writer::writeSprite))
+    if (!saveObject("spr", spr, &SnapshotBuilder::writeSprite))
       return false;
 
-    if (!saveObject("doc", m_doc, &Writer::writeDocumentFile))
+    if (!saveObject("doc", m_doc, &SnapshotBuilder::writeDocumentFile))
       return false;
 
-    // Delete old files after all files are correctly saved.
-    deleteOldVersions();
+    // The index is updated only if the saved information could change
+    for (const DocSnapshot::Object& obj : m_snapshot->objects) {
+      if (obj.prefix == "spr" || obj.prefix == "doc") {
+        std::ostringstream s(std::ios::binary);
+        writeIndex(s, m_doc);
+        m_snapshot->index = s.str();
+        break;
+      }
+    }
     return true;
   }
 
@@ -149,14 +173,28 @@ private:
     return (m_cancel && m_cancel->isCanceled());
   }
 
-  bool writeDocumentFile(std::ofstream& s, Doc* doc) {
+  // The sprite ID/version are used to know if the index is valid (if
+  // the "spr" file of this version exists)
+  void writeIndex(std::ostream& s, Doc* doc) {
+    const Sprite* spr = doc->sprite();
+    write16(s, INDEX_VERSION);
+    write32(s, spr->id());
+    write32(s, spr->version());
+    write8(s, int(spr->colorMode()));
+    write32(s, spr->width());
+    write32(s, spr->height());
+    write32(s, spr->totalFrames());
+    write_string(s, doc->filename());
+  }
+
+  bool writeDocumentFile(std::ostream& s, Doc* doc) {
     write32(s, doc->sprite()->id());
     write_string(s, doc->filename());
     write16(s, DOC_FORMAT_VERSION_LAST);
     return true;
   }
 
-  bool writeSprite(std::ofstream& s, Sprite* spr) {
+  bool writeSprite(std::ostream& s, Sprite* spr) {
     // Header
     write8(s, int(spr->colorMode()));
     write16(s, spr->width());
@@ -210,7 +248,7 @@ private:
     return true;
   }
 
-  bool writeGridBounds(std::ofstream& s, const gfx::Rect& grid) {
+  bool writeGridBounds(std::ostream& s, const gfx::Rect& grid) {
     write16(s, (int16_t)grid.x);
     write16(s, (int16_t)grid.y);
     write16(s, grid.w);
@@ -218,7 +256,7 @@ private:
     return true;
   }
 
-  bool writeColorSpace(std::ofstream& s, const gfx::ColorSpaceRef& colorSpace) {
+  bool writeColorSpace(std::ostream& s, const gfx::ColorSpaceRef& colorSpace) {
     write16(s, colorSpace->type());
     write16(s, colorSpace->flags());
     write32(s, fixmath::ftofix(colorSpace->gamma()));
@@ -232,7 +270,7 @@ private:
     return true;
   }
 
-  void writeAllLayersID(std::ofstream& s, ObjectId parentId, const LayerGroup* group) {
+  void writeAllLayersID(std::ostream& s, ObjectId parentId, const LayerGroup* group) {
     for (const Layer* lay : group->layers()) {
       write32(s, lay->id());
       write32(s, parentId);
@@ -242,7 +280,7 @@ private:
     }
   }
 
-  bool writeLayerStructure(std::ofstream& s, Layer* lay) {
+  bool writeLayerStructure(std::ostream& s, Layer* lay) {
     write32(s, static_cast<int>(lay->flags())); // Flags
     write16(s, static_cast<int>(lay->type()));  // Type
     write_string(s, lay->name());
@@ -282,64 +320,252 @@ private:
     return true;
   }
 
-  bool writeCel(std::ofstream& s, Cel* cel) {
+  bool writeCel(std::ostream& s, Cel* cel) {
     write_cel(s, cel);
     return true;
   }
 
-  bool writeCelData(std::ofstream& s, CelData* celdata) {
+  bool writeCelData(std::ostream& s, CelData* celdata) {
     write_celdata(s, celdata);
     return true;
   }
 
-  bool writeImage(std::ofstream& s, Image* img) {
-    return write_image(s, img, m_cancel);
-  }
-
-  bool writePalette(std::ofstream& s, Palette* pal) {
+  bool writePalette(std::ostream& s, Palette* pal) {
     write_palette(s, pal);
     return true;
   }
 
-  bool writeTileset(std::ofstream& s, Tileset* tileset) {
+  bool writeTileset(std::ostream& s, Tileset* tileset) {
     write_tileset(s, tileset);
     return true;
   }
 
-  bool writeFrameTag(std::ofstream& s, Tag* frameTag) {
+  bool writeFrameTag(std::ostream& s, Tag* frameTag) {
     write_tag(s, frameTag);
     return true;
   }
 
-  bool writeSlice(std::ofstream& s, Slice* slice) {
+  bool writeSlice(std::ostream& s, Slice* slice) {
     write_slice(s, slice);
     return true;
   }
 
+  // Returns true if the object must be saved in the snapshot
   template<typename T>
-  bool saveObject(const char* prefix, T* obj, bool (Writer::*writeMember)(std::ofstream&, T*)) {
-    if (isCanceled())
-      return false;
-
+  bool isModified(T* obj) {
     if (!obj->version())
       obj->incrementVersion();
 
     ObjVersions& versions = m_objVersions[obj->id()];
-    if (versions.newer() == obj->version())
+    return (versions.newer() != obj->version());
+  }
+
+  template<typename T>
+  bool saveObject(const char* prefix, T* obj, bool (SnapshotBuilder::*writeMember)(std::ostream&, T*)) {
+    if (isCanceled())
+      return false;
+
+    if (!isModified(obj))
+      return true;
+
+    std::ostringstream s(std::ios::binary);
+    if (!(this->*writeMember)(s, obj)) // Write the object
+      return false;
+
+    m_snapshot->objects.push_back(
+      DocSnapshot::Object{ prefix, obj->id(), obj->version(), s.str() });
+    return true;
+  }
+
+  bool saveImage(const char* prefix, Image* img) {
+    if (isCanceled())
+      return false;
+
+    if (!isModified(img))
+      return true;
+
+    // The snapshot shares the pixels with the document image, so the
+    // document is locked just a little time. The backup thread only
+    // reads these pixels, and the document image makes its own copy
+    // (Image::detachBits()) if it's modified before the backup is
+    // written.
+    m_snapshot->objects.push_back(
+      DocSnapshot::Object{ prefix, img->id(), img->version(),
+                           std::string(),
+                           ImageRef(Image::createSharedCopy(img)) });
+    return true;
+  }
+
+  Doc* m_doc;
+  DocSnapshot* m_snapshot;
+  ObjVersionsMap& m_objVersions;
+  doc::CancelIO* m_cancel;
+};
+
+// Writes the image as a delta of its last full version (if only some
+// tiles were modified), or as a full image. "tiles" is updated with
+// the new state of the image tiles.
+bool write_backup_image(std::ostream& s,
+                        const DocSnapshot::Object& obj,
+                        ImageTiles& tiles)
+{
+  const Image* image = obj.image.get();
+
+  ImageTiles newTiles;
+  if (calculate_image_tiles(image, newTiles)) {
+    std::vector<int> modified;
+    if (tiles.baseVersion &&
+        tiles.deltas < kMaxImageDeltas &&
+        get_modified_tiles(tiles, newTiles, modified) &&
+        modified.size() <= newTiles.hashes.size() / 2) {
+      // Deltas are always relative to the base version, so only the
+      // base and the last delta are needed to restore the image
+      if (!write_image_delta(s, image, obj.id, tiles.baseVersion,
+                             modified, kBackupCompressionLevel))
+        return false;
+      ++tiles.deltas;
       return true;
+    }
+  }
+
+  // Backups are saved frequently, so we prefer speed over size
+  if (!write_image(s, image, obj.id, nullptr, kBackupCompressionLevel))
+    return false;
+
+  newTiles.baseVersion = obj.version;
+  tiles = std::move(newTiles);
+  return true;
+}
+
+void delete_old_versions(base::paths& deleteFiles)
+{
+  while (!deleteFiles.empty()) {
+    std::string file = deleteFiles.back();
+    deleteFiles.erase(deleteFiles.end()-1);
+
+    try {
+      RECO_TRACE(" - Deleting <%s>\n", file.c_str());
+      base::delete_file(file);
+    }
+    catch (const std::exception&) {
+      RECO_TRACE(" - Cannot delete <%s>\n", file.c_str());
+    }
+  }
+}
 
-    std::string fn = prefix;
+} // anonymous namespace
+
+//////////////////////////////////////////////////////////////////////
+// Public API
+
+std::unique_ptr<DocSnapshot> snapshot_document(Doc* doc,
+                                               doc::CancelIO* cancel)
+{
+  auto snapshot = std::make_unique<DocSnapshot>();
+  SnapshotBuilder builder(doc, snapshot.get(), cancel);
+  if (!builder.saveDocument())
+    return nullptr;
+  return snapshot;
+}
+
+bool write_document_snapshot(const std::string& dir,
+                             const DocSnapshot* snapshot)
+{
+  ObjVersionsMap& objVersions = g_docVersions[snapshot->docId];
+  base::paths& deleteFiles = g_deleteFiles[snapshot->docId];
+  auto& imageTiles = g_docImageTiles[snapshot->docId];
+
+  // Compress all the images in parallel (the compression takes most
+  // of the time of a backup)
+  std::vector<std::string> compressedImages(snapshot->objects.size());
+  std::vector<ImageTiles> newTiles(snapshot->objects.size());
+  for (std::size_t i=0; i<snapshot->objects.size(); ++i) {
+    const DocSnapshot::Object& obj = snapshot->objects[i];
+    if (obj.image) {
+      auto it = imageTiles.find(obj.id);
+      if (it != imageTiles.end())
+        newTiles[i] = it->second;
+    }
+  }
+  {
+    int nimages = 0;
+    for (const DocSnapshot::Object& obj : snapshot->objects) {
+      if (obj.image)
+        ++nimages;
+    }
+
+    const int threads = std::min<int>(nimages,
+                                      std::thread::hardware_concurrency());
+    if (threads > 1) {
+      base::thread_pool pool(threads);
+      for (std::size_t i=0; i<snapshot->objects.size(); ++i) {
+        const DocSnapshot::Object* obj = &snapshot->objects[i];
+        if (!obj->image)
+          continue;
+
+        std::string* output = &compressedImages[i];
+        ImageTiles* tiles = &newTiles[i];
+        pool.execute([obj, output, tiles]{
+          try {
+            std::ostringstream s(std::ios::binary);
+            ImageTiles t = *tiles;
+            if (write_backup_image(s, *obj, t)) {
+              *output = s.str();
+              *tiles = std::move(t);
+            }
+          }
+          catch (const std::exception&) {
+            // The image will be written again from the backup thread
+            // (to report the error)
+          }
+        });
+      }
+    }
+  }
+
+  // The index is written before the objects, so if the backup is not
+  // completely saved, the index references a "spr" file that doesn't
+  // exist and it's ignored by read_document_info()
+  if (!snapshot->index.empty()) {
+    std::ofstream s(FSTREAM_PATH(base::join_path(dir, INDEX_FILENAME)),
+                    std::ofstream::binary);
+    write32(s, 0);
+    s.write(snapshot->index.c_str(), snapshot->index.size());
+    s.flush();
+    s.seekp(0);
+    write32(s, MAGIC_NUMBER);
+  }
+
+  // Objects are saved in the same order they were added to the
+  // snapshot: from objects without children (e.g. images), to
+  // aggregated objects (e.g. cels, layers, etc.)
+  for (std::size_t i=0; i<snapshot->objects.size(); ++i) {
+    const DocSnapshot::Object& obj = snapshot->objects[i];
+    ObjVersions& versions = objVersions[obj.id];
+
+    std::string fn = obj.prefix;
     fn.push_back('-');
-    fn += base::convert_to<std::string>(obj->id());
+    fn += base::convert_to<std::string>(obj.id);
 
-    std::string fullfn = base::join_path(m_dir, fn);
+    std::string fullfn = base::join_path(dir, fn);
     std::string oldfn = fullfn + "." + base::convert_to<std::string>(versions.older());
-    fullfn += "." + base::convert_to<std::string>(obj->version());
+    fullfn += "." + base::convert_to<std::string>(obj.version);
 
     std::ofstream s(FSTREAM_PATH(fullfn), std::ofstream::binary);
     write32(s, 0);                // Leave a room for the magic number
-    if (!(this->*writeMember)(s, obj)) // Write the object
-      return false;
+
+    // Write the object
+    if (!compressedImages[i].empty()) {
+      s.write(compressedImages[i].c_str(), compressedImages[i].size());
+      compressedImages[i] = std::string(); // Free memory
+    }
+    else if (obj.image) {
+      if (!write_backup_image(s, obj, newTiles[i]))
+        return false;
+    }
+    else {
+      s.write(obj.data.c_str(), obj.data.size());
+    }
 
     // Flush all data. In this way we ensure that the magic number is
     // the last thing being written in the file.
@@ -349,50 +575,51 @@ private:
     s.seekp(0);
     write32(s, MAGIC_NUMBER);
 
+    // The base version of the image deltas cannot be deleted
+    ObjectVersion oldBase = 0, newBase = 0;
+    if (obj.image) {
+      ImageTiles& tiles = imageTiles[obj.id];
+      oldBase = tiles.baseVersion;
+      tiles = std::move(newTiles[i]);
+      newBase = tiles.baseVersion;
+    }
+
     // Remove the older version
-    if (versions.older() && base::is_file(oldfn))
-      m_deleteFiles.push_back(oldfn);
+    if (versions.older() && versions.older() != newBase &&
+        base::is_file(oldfn))
+      deleteFiles.push_back(oldfn);
+
+    // Remove the previous base version if it was kept only for the
+    // deltas
+    if (oldBase && oldBase != newBase &&
+        oldBase != versions[0] &&
+        oldBase != versions[1] &&
+        oldBase != versions[2]) {
+      const std::string basefn =
+        base::join_path(dir, fn + "." + base::convert_to<std::string>(oldBase));
+      if (base::is_file(basefn))
+        deleteFiles.push_back(basefn);
+    }
 
     // Rotate versions and add the latest one
-    versions.rotateRevisions(obj->version());
+    versions.rotateRevisions(obj.version);
 
-    RECO_TRACE(" - Saved %s #%d v%d\n", prefix, obj->id(), obj->version());
-    return true;
+    RECO_TRACE(" - Saved %s #%d v%d\n", obj.prefix.c_str(), obj.id, obj.version);
   }
 
-  void deleteOldVersions() {
-    while (!m_deleteFiles.empty() && !isCanceled()) {
-      std::string file = m_deleteFiles.back();
-      m_deleteFiles.erase(m_deleteFiles.end()-1);
-
-      try {
-        RECO_TRACE(" - Deleting <%s>\n", file.c_str());
-        base::delete_file(file);
-      }
-      catch (const std::exception&) {
-        RECO_TRACE(" - Cannot delete <%s>\n", file.c_str());
-      }
-    }
-  }
-
-  std::string m_dir;
-  Doc* m_doc;
-  ObjVersionsMap& m_objVersions;
-  base::paths& m_deleteFiles;
-  doc::CancelIO* m_cancel;
-};
-
-} // anonymous namespace
-
-//////////////////////////////////////////////////////////////////////
-// Public API
+  // Delete old files after all files are correctly saved.
+  delete_old_versions(deleteFiles);
+  return true;
+}
 
 bool write_document(const std::string& dir,
                     Doc* doc,
                     doc::CancelIO* cancel)
 {
-  Writer writer(dir, doc, cancel);
-  return writer.saveDocument();
+  std::unique_ptr<DocSnapshot> snapshot = snapshot_document(doc, cancel);
+  if (!snapshot)
+    return false;
+  return write_document_snapshot(dir, snapshot.get());
 }
 
 void delete_document_internals(Doc* doc)
@@ -411,6 +638,11 @@ void delete_document_internals(Doc* doc)
     if (it != g_deleteFiles.end())
       g_deleteFiles.erase(it);
   }
+  {
+    auto it = g_docImageTiles.find(doc->id());
+    if (it != g_docImageTiles.end())
+      g_docImageTiles.erase(it);
+  }
 }
 
 } // namespace crash
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -8,7 +9,13 @@
 #define APP_CRASH_WRITE_DOCUMENT_H_INCLUDED
 #pragma once
 
+#include "doc/image_ref.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+
+#include <memory>
 #include <string>
+#include <vector>
 
 namespace doc {
   class CancelIO;
@@ -19,6 +26,32 @@ namespace app {
 
   namespace crash {
 
+    // Copy of the objects of a document that were modified since the
+    // last backup, so they can be written without locking the
+    // document.
+    struct DocSnapshot {
+      struct Object {
+        std::string prefix;
+        doc::ObjectId id;
+        doc::ObjectVersion version;
+        std::string data;       // Serialized object
+        doc::ImageRef image;    // Shared copy of the image pixels (for "img" objects)
+      };
+      doc::ObjectId docId;
+      std::vector<Object> objects;
+      std::string index;        // Serialized index file (if the sprite
+                                // or the document were modified)
+    };
+
+    // Copies the modified objects of the document (it must be locked
+    // for reading, but only while this function is executed). Returns
+    // nullptr if the operation was canceled.
+    std::unique_ptr<DocSnapshot> snapshot_document(Doc* doc, doc::CancelIO* cancel);
+
+    // Writes the snapshot in the given directory (it doesn't access
+    // the document).
+    bool write_document_snapshot(const std::string& dir, const DocSnapshot* snapshot);
+
     bool write_document(const std::string& dir, Doc* doc, doc::CancelIO* cancel);
     void delete_document_internals(Doc* doc);
 
@@ -0,0 +1,181 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/context.h"
+#include "app/crash/read_document.h"
+#include "app/crash/write_document.h"
+#include "app/doc.h"
+#include "base/fs.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+using namespace app;
+using namespace doc;
+
+TEST(WriteDocument, SnapshotIsNotModifiedByTheDocument)
+{
+  const std::string dir = "test_write_document";
+  if (!base::is_directory(dir))
+    base::make_directory(dir);
+
+  app::Context ctx;
+  std::unique_ptr<Doc> doc(
+    ctx.documents().add(4, 4, ColorMode::RGB, 256));
+  Image* image = doc->sprite()->root()->firstLayer()
+    ->cel(frame_t(0))->image();
+  clear_image(image, rgba(255, 0, 0, 255));
+
+  auto snapshot = crash::snapshot_document(doc.get(), nullptr);
+  ASSERT_TRUE(snapshot != nullptr);
+
+  // Changes after the snapshot are not included in the backup
+  clear_image(image, rgba(0, 0, 255, 255));
+  image->incrementVersion();
+
+  ASSERT_TRUE(crash::write_document_snapshot(dir, snapshot.get()));
+  {
+    std::unique_ptr<Doc> copy(crash::read_document(dir, nullptr));
+    ASSERT_TRUE(copy != nullptr);
+    const Image* copyImage = copy->sprite()->root()->firstLayer()
+      ->cel(frame_t(0))->image();
+    EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(copyImage, 0, 0));
+  }
+
+  // The next snapshot contains only the modified image
+  snapshot = crash::snapshot_document(doc.get(), nullptr);
+  ASSERT_TRUE(snapshot != nullptr);
+  ASSERT_EQ(1, snapshot->objects.size());
+  EXPECT_EQ("img", snapshot->objects[0].prefix);
+  EXPECT_EQ(image->id(), snapshot->objects[0].id);
+  EXPECT_EQ(rgba(0, 0, 255, 255),
+            get_pixel(snapshot->objects[0].image.get(), 0, 0));
+
+  crash::delete_document_internals(doc.get());
+  doc->close();
+}
+
+TEST(WriteDocument, ModifiedTilesAreSavedAsDeltas)
+{
+  const std::string dir = "test_write_document_deltas";
+  if (!base::is_directory(dir))
+    base::make_directory(dir);
+
+  app::Context ctx;
+  std::unique_ptr<Doc> doc(
+    ctx.documents().add(256, 256, ColorMode::RGB, 256));
+  Image* image = doc->sprite()->root()->firstLayer()
+    ->cel(frame_t(0))->image();
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      put_pixel(image, x, y, rgba(x, y, 0, 255));
+  image->incrementVersion();
+
+  ASSERT_TRUE(crash::write_document(dir, doc.get(), nullptr));
+  const ObjectVersion baseVersion = image->version();
+  const std::string fn = base::join_path(
+    dir, "img-" + std::to_string(image->id()) + ".");
+  const auto baseSize = base::file_size(fn + std::to_string(baseVersion));
+
+  // More versions than the ones we keep for each object, the base
+  // version must be kept anyway
+  for (int i=0; i<5; ++i) {
+    put_pixel(image, i, 0, rgba(0, 0, 255, 255));
+    image->incrementVersion();
+    ASSERT_TRUE(crash::write_document(dir, doc.get(), nullptr));
+
+    EXPECT_LT(base::file_size(fn + std::to_string(image->version())),
+              baseSize);
+    EXPECT_TRUE(base::is_file(fn + std::to_string(baseVersion)));
+  }
+
+  {
+    std::unique_ptr<Doc> copy(crash::read_document(dir, nullptr));
+    ASSERT_TRUE(copy != nullptr);
+    const Image* copyImage = copy->sprite()->root()->firstLayer()
+      ->cel(frame_t(0))->image();
+    for (int i=0; i<5; ++i)
+      EXPECT_EQ(rgba(0, 0, 255, 255), get_pixel(copyImage, i, 0));
+    EXPECT_EQ(rgba(5, 0, 0, 255), get_pixel(copyImage, 5, 0));
+    EXPECT_EQ(rgba(200, 100, 0, 255), get_pixel(copyImage, 200, 100));
+  }
+
+  crash::delete_document_internals(doc.get());
+  doc->close();
+}
+
+TEST(WriteDocument, DocumentInfoFromIndex)
+{
+  const std::string dir = "test_write_document_index";
+  if (!base::is_directory(dir))
+    base::make_directory(dir);
+
+  app::Context ctx;
+  std::unique_ptr<Doc> doc(
+    ctx.documents().add(32, 16, ColorMode::INDEXED, 256));
+  doc->setFilename("sprite.aseprite");
+  doc->sprite()->setTotalFrames(3);
+
+  ASSERT_TRUE(crash::write_document(dir, doc.get(), nullptr));
+  EXPECT_TRUE(base::is_file(base::join_path(dir, "index")));
+
+  crash::DocumentInfo info;
+  ASSERT_TRUE(crash::read_document_info(dir, info));
+  EXPECT_EQ(ColorMode::INDEXED, info.mode);
+  EXPECT_EQ(32, info.width);
+  EXPECT_EQ(16, info.height);
+  EXPECT_EQ(3, info.frames);
+  EXPECT_EQ("sprite.aseprite", info.filename);
+
+  crash::delete_document_internals(doc.get());
+  doc->close();
+}
+
+TEST(WriteDocument, ReadManyImages)
+{
+  const std::string dir = "test_write_document_many_images";
+  if (!base::is_directory(dir))
+    base::make_directory(dir);
+
+  // Images are decoded in parallel by read_document()
+  const frame_t nframes = 32;
+  app::Context ctx;
+  std::unique_ptr<Doc> doc(
+    ctx.documents().add(8, 8, ColorMode::RGB, 256));
+  Sprite* sprite = doc->sprite();
+  auto layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+  sprite->setTotalFrames(nframes);
+  for (frame_t fr=0; fr<nframes; ++fr) {
+    ImageRef image;
+    if (fr == 0)
+      image = layer->cel(fr)->imageRef();
+    else {
+      image.reset(Image::create(IMAGE_RGB, 8, 8));
+      layer->addCel(new Cel(fr, image));
+    }
+    clear_image(image.get(), rgba(fr, 0, 0, 255));
+  }
+
+  ASSERT_TRUE(crash::write_document(dir, doc.get(), nullptr));
+  {
+    std::unique_ptr<Doc> copy(crash::read_document(dir, nullptr));
+    ASSERT_TRUE(copy != nullptr);
+    ASSERT_EQ(nframes, copy->sprite()->totalFrames());
+    const Layer* copyLayer = copy->sprite()->root()->firstLayer();
+    for (frame_t fr=0; fr<nframes; ++fr) {
+      const Cel* cel = copyLayer->cel(fr);
+      ASSERT_TRUE(cel != nullptr);
+      EXPECT_EQ(rgba(fr, 0, 0, 255), get_pixel(cel->image(), 7, 7));
+    }
+  }
+
+  crash::delete_document_internals(doc.get());
+  doc->close();
+}
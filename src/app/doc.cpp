@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "app/doc.h"
 
 #include "app/app.h"
+#include "app/cels_index.h"
 #include "app/color_target.h"
 #include "app/color_utils.h"
 #include "app/context.h"
@@ -38,6 +39,7 @@
 #include "os/window.h"
 #include "ui/system.h"
 
+#include <algorithm>
 #include <limits>
 #include <map>
 
@@ -52,6 +54,7 @@ Doc::Doc(Sprite* sprite)
   : m_ctx(nullptr)
   , m_flags(kMaskVisible)
   , m_undo(new DocUndo)
+  , m_celsIndex(new CelsIndex(this))
   , m_transaction(nullptr)
   // Information about the file format used to load/save this document
   , m_format_options(nullptr)
@@ -230,19 +233,29 @@ void Doc::notifyPaletteChanged()
 
 void Doc::notifySpritePixelsModified(Sprite* sprite, const gfx::Region& region, frame_t frame)
 {
+  const auto observers = std::atomic_load(&m_pixelsObservers);
+  if (!observers)
+    return;
+
   DocEvent ev(this);
   ev.sprite(sprite);
   ev.region(region);
   ev.frame(frame);
-  notify_observers<DocEvent&>(&DocObserver::onSpritePixelsModified, ev);
+  for (DocObserver* observer : *observers)
+    observer->onSpritePixelsModified(ev);
 }
 
 void Doc::notifyExposeSpritePixels(Sprite* sprite, const gfx::Region& region)
 {
+  const auto observers = std::atomic_load(&m_pixelsObservers);
+  if (!observers)
+    return;
+
   DocEvent ev(this);
   ev.sprite(sprite);
   ev.region(region);
-  notify_observers<DocEvent&>(&DocObserver::onExposeSpritePixels, ev);
+  for (DocObserver* observer : *observers)
+    observer->onExposeSpritePixels(ev);
 }
 
 void Doc::notifyLayerMergedDown(Layer* srcLayer, Layer* targetLayer)
@@ -327,6 +340,51 @@ void Doc::notifyAfterAddTile(LayerTilemap* layer, frame_t frame, tile_index ti)
   notify_observers<DocEvent&>(&DocObserver::onAfterAddTile, ev);
 }
 
+void Doc::subscribeToPixelsEvents(DocObserver* observer)
+{
+  const std::lock_guard lock(m_pixelsObserversMutex);
+  auto observers = (m_pixelsObservers ?
+                    std::make_shared<DocObservers>(*m_pixelsObservers):
+                    std::make_shared<DocObservers>());
+  ASSERT(std::find(observers->begin(), observers->end(), observer) == observers->end());
+  observers->push_back(observer);
+  std::atomic_store(&m_pixelsObservers,
+                    std::shared_ptr<const DocObservers>(std::move(observers)));
+}
+
+void Doc::unsubscribeFromPixelsEvents(DocObserver* observer)
+{
+  const std::lock_guard lock(m_pixelsObserversMutex);
+  if (!m_pixelsObservers)
+    return;
+
+  auto observers = std::make_shared<DocObservers>(*m_pixelsObservers);
+  auto it = std::find(observers->begin(), observers->end(), observer);
+  if (it == observers->end())
+    return;
+
+  observers->erase(it);
+  std::atomic_store(&m_pixelsObservers,
+                    (observers->empty() ? nullptr:
+                     std::shared_ptr<const DocObservers>(std::move(observers))));
+}
+
+void Doc::beginBatchUpdate()
+{
+  ++m_batchUpdates;
+}
+
+void Doc::endBatchUpdate()
+{
+  ASSERT(m_batchUpdates > 0);
+  if (--m_batchUpdates > 0)
+    return;
+
+  DocEvent ev(this);
+  ev.sprite(sprite());
+  notify_observers<DocEvent&>(&DocObserver::onAfterBatchUpdate, ev);
+}
+
 bool Doc::isModified() const
 {
   return !m_undo->isInSavedStateOrSimilar();
@@ -418,23 +476,24 @@ void Doc::destroyMaskBoundaries()
 
 void Doc::generateMaskBoundaries(const Mask* mask)
 {
-  m_maskBoundaries.reset();
-
   // No mask specified? Use the current one in the document
   if (!mask) {
-    if (!isMaskVisible())       // The mask is hidden
+    if (!isMaskVisible()) {     // The mask is hidden
+      m_maskBoundaries.reset();
       return;                   // Done, without boundaries
+    }
     else
       mask = this->mask();      // Use the document mask
   }
 
   ASSERT(mask);
 
-  if (!mask->isEmpty()) {
-    m_maskBoundaries.regen(mask->bitmap());
-    m_maskBoundaries.offset(mask->bounds().x,
-                            mask->bounds().y);
-  }
+  // The boundaries are regenerated incrementally (only the rows that
+  // changed from the previous mask are scanned again)
+  if (!mask->isEmpty())
+    m_maskBoundaries.regen(mask->bitmap(), mask->bounds().origin());
+  else
+    m_maskBoundaries.reset();
 
   notifySelectionBoundariesChanged();
 }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -27,7 +27,9 @@
 
 #include <atomic>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 namespace doc {
   class Cel;
@@ -44,6 +46,7 @@ namespace gfx {
 
 namespace app {
 
+  class CelsIndex;
   class Context;
   class DocApi;
   class DocUndo;
@@ -100,6 +103,9 @@ namespace app {
     const DocUndo* undoHistory() const { return m_undo.get(); }
     DocUndo* undoHistory() { return m_undo.get(); }
 
+    // Index to find the cels under a position of the sprite.
+    CelsIndex* celsIndex() const { return m_celsIndex.get(); }
+
     bool isUndoing() const;
 
     color_t bgColor() const;
@@ -134,6 +140,25 @@ namespace app {
     void notifyLayerGroupCollapseChange(Layer* layer);
     void notifyAfterAddTile(LayerTilemap* layer, frame_t frame, tile_index ti);
 
+    //////////////////////////////////////////////////////////////////////
+    // Batch updates
+
+    // A batch of modifications (e.g. a script transaction that
+    // modifies hundreds of cels) where the UI observers can skip
+    // expensive updates for each notification and do one update when
+    // the batch ends. They can be nested.
+    void beginBatchUpdate();
+    void endBatchUpdate();
+    bool isInBatchUpdate() const { return m_batchUpdates > 0; }
+
+    // Pixels events (DocObserver::onSpritePixelsModified() and
+    // onExposeSpritePixels()) are notified very often (e.g. for each
+    // mouse movement to draw the brush preview), so they are notified
+    // only to the observers subscribed with these functions (instead
+    // of all the DocObservers of the document).
+    void subscribeToPixelsEvents(DocObserver* observer);
+    void unsubscribeFromPixelsEvents(DocObserver* observer);
+
     //////////////////////////////////////////////////////////////////////
     // File related properties
 
@@ -267,6 +292,10 @@ namespace app {
     // Undo and redo information about the document.
     std::unique_ptr<DocUndo> m_undo;
 
+    // Bounds of the cels in each frame (it observes m_undo, so it's
+    // destroyed first).
+    std::unique_ptr<CelsIndex> m_celsIndex;
+
     // Current transaction for this document (when this is commit(), a
     // new undo command is added to m_undo).
     Transaction* m_transaction;
@@ -291,9 +320,33 @@ namespace app {
     // Last used color space to render a sprite.
     os::ColorSpaceRef m_osColorSpace;
 
+    // Number of nested beginBatchUpdate() calls.
+    int m_batchUpdates = 0;
+
+    // Copy-on-write list of observers subscribed to pixels events.
+    // The list is replaced when an observer is (un)subscribed, so
+    // notifications can iterate a snapshot without locking a mutex.
+    using DocObservers = std::vector<DocObserver*>;
+    std::shared_ptr<const DocObservers> m_pixelsObservers;
+    std::mutex m_pixelsObserversMutex;
+
     DISABLE_COPYING(Doc);
   };
 
+  class DocBatchUpdate {
+  public:
+    DocBatchUpdate(Doc* doc) : m_doc(doc) {
+      if (m_doc)
+        m_doc->beginBatchUpdate();
+    }
+    ~DocBatchUpdate() {
+      if (m_doc)
+        m_doc->endBatchUpdate();
+    }
+  private:
+    Doc* m_doc;
+  };
+
 } // namespace app
 
 #endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,6 +21,7 @@
 #include "app/cmd/flip_image.h"
 #include "app/cmd/move_cel.h"
 #include "app/cmd/move_layer.h"
+#include "app/cmd/remap_frames.h"
 #include "app/cmd/remove_cel.h"
 #include "app/cmd/remove_frame.h"
 #include "app/cmd/remove_layer.h"
@@ -53,6 +54,8 @@
 #include "doc/cel.h"
 #include "doc/mask.h"
 #include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/remap.h"
 #include "doc/slice.h"
 #include "doc/tag.h"
 #include "doc/tags.h"
@@ -60,6 +63,7 @@
 
 #include <algorithm>
 #include <iterator>
+#include <numeric>
 #include <set>
 #include <vector>
 
@@ -461,6 +465,143 @@ void DocApi::moveFrame(Sprite* sprite,
   }
 }
 
+void DocApi::moveFrames(Sprite* sprite,
+                        const std::vector<FrameMove>& moves,
+                        const TagsHandling tagsHandling)
+{
+  // Current position of each original frame
+  std::vector<frame_t> order(sprite->totalFrames());
+  std::iota(order.begin(), order.end(), frame_t(0));
+
+  for (const FrameMove& move : moves) {
+    const frame_t frame = move.frame;
+    frame_t targetFrame = move.targetFrame;
+    const frame_t beforeFrame =
+      (move.dropFramePlace == kDropBeforeFrame ? targetFrame: targetFrame+1);
+
+    // Same conditions as in moveFrame()
+    if (frame       >= 0 && frame       <= sprite->lastFrame()   &&
+        beforeFrame >= 0 && beforeFrame <= sprite->lastFrame()+1 &&
+        ((frame != beforeFrame) ||
+         (!sprite->tags().empty() &&
+          tagsHandling != kDontAdjustTags))) {
+      if (tagsHandling != kDontAdjustTags) {
+        adjustTags(sprite, frame, -1, move.dropFramePlace, tagsHandling);
+        if (targetFrame >= frame)
+          --targetFrame;
+        adjustTags(sprite, targetFrame, +1, move.dropFramePlace, tagsHandling);
+      }
+
+      if (frame != beforeFrame) {
+        const frame_t original = order[frame];
+        order.erase(order.begin()+frame);
+        order.insert(order.begin()+(frame < beforeFrame ? beforeFrame-1:
+                                                          beforeFrame),
+                     original);
+      }
+    }
+  }
+
+  Remap remap(sprite->totalFrames());
+  for (frame_t i=0; i<frame_t(order.size()); ++i)
+    remap.map(order[i], i);
+  remapFrames(sprite, remap);
+}
+
+void DocApi::copyFrames(Sprite* sprite,
+                        const std::vector<FrameCopy>& copies,
+                        const TagsHandling tagsHandling)
+{
+  ASSERT(sprite);
+  if (copies.empty())
+    return;
+
+  // Original frame in each position, "copy" is the index of the new
+  // frame (in the order they are added) or -1 for original frames.
+  struct Slot {
+    frame_t frame;
+    int copy;
+  };
+  const frame_t total = sprite->totalFrames();
+  std::vector<Slot> order(total);
+  for (frame_t i=0; i<total; ++i)
+    order[i] = Slot{ i, -1 };
+
+  int ncopies = 0;
+  for (const FrameCopy& copy : copies) {
+    const frame_t newFrame =
+      (copy.dropFramePlace == kDropBeforeFrame ? copy.targetFrame:
+                                                 copy.targetFrame+1);
+    ASSERT(copy.frame >= 0 && copy.frame < frame_t(order.size()));
+    ASSERT(newFrame >= 0 && newFrame <= frame_t(order.size()));
+
+    order.insert(order.begin()+newFrame,
+                 Slot{ order[copy.frame].frame, ncopies++ });
+
+    adjustTags(sprite, copy.targetFrame, +1,
+               copy.dropFramePlace,
+               tagsHandling);
+  }
+
+  // Add all the empty frames at the end and move them to their
+  // final positions
+  setTotalFrames(sprite, total+ncopies);
+
+  Remap remap(total+ncopies);
+  for (frame_t i=0; i<frame_t(order.size()); ++i)
+    remap.map(order[i].copy < 0 ? order[i].frame: total+order[i].copy, i);
+  remapFrames(sprite, remap);
+
+  LayerList layers = sprite->allLayers();
+  for (frame_t newFrame=0; newFrame<frame_t(order.size()); ++newFrame) {
+    if (order[newFrame].copy < 0)
+      continue;
+
+    const frame_t fromFrame = remap[order[newFrame].frame];
+    const int msecs = sprite->frameDuration(fromFrame);
+    if (sprite->frameDuration(newFrame) != msecs)
+      setFrameDuration(sprite, newFrame, msecs);
+
+    for (Layer* layer : layers) {
+      if (!layer->isImage())
+        continue;
+
+      auto imageLayer = static_cast<LayerImage*>(layer);
+
+      // The new frames don't have a background cel (as in
+      // cmd::AddFrame), so we add it directly (sharing the pixels of
+      // the source cel until one of them is modified).
+      if (layer->isBackground()) {
+        Cel* cel;
+        if (Cel* srcCel = imageLayer->cel(fromFrame)) {
+          if (layer->isContinuous())
+            cel = Cel::MakeLink(newFrame, srcCel);
+          else
+            cel = Cel::MakeCopy(newFrame, srcCel);
+        }
+        else {
+          ImageRef bgimage(Image::create(sprite->pixelFormat(),
+                                         sprite->width(), sprite->height()));
+          clear_image(bgimage.get(), m_document->bgColor(imageLayer));
+          cel = new Cel(newFrame, bgimage);
+        }
+        addCel(imageLayer, cel);
+      }
+      else {
+        copyCel(imageLayer, fromFrame,
+                imageLayer, newFrame);
+      }
+    }
+  }
+}
+
+void DocApi::remapFrames(Sprite* sprite, const Remap& remap)
+{
+  ASSERT(remap.size() == sprite->totalFrames());
+  if (!remap.isIdentity())
+    m_transaction.execute(new cmd::RemapFrames(sprite, remap));
+}
+
 void DocApi::moveFrameLayer(Layer* layer, frame_t frame, frame_t beforeFrame)
 {
   ASSERT(layer);
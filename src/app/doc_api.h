@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,6 +18,7 @@
 #include "gfx/rect.h"
 
 #include <map>
+#include <vector>
 
 namespace doc {
   class Cel;
@@ -28,6 +29,7 @@ namespace doc {
   class LayerImage;
   class Mask;
   class Palette;
+  class Remap;
   class Sprite;
 }
 
@@ -72,6 +74,29 @@ namespace app {
                    const DropFramePlace dropFramePlace,
                    const TagsHandling tagsHandling);
 
+    // Same result as calling moveFrame() for each element of "moves"
+    // (in order), but all frames are moved with one cmd::RemapFrames
+    // (instead of one cmd::SetCelFrame for each moved cel).
+    struct FrameMove {
+      frame_t frame;
+      frame_t targetFrame;
+      DropFramePlace dropFramePlace;
+    };
+    void moveFrames(Sprite* sprite,
+                    const std::vector<FrameMove>& moves,
+                    const TagsHandling tagsHandling);
+
+    // Same result as calling copyFrame() for each element of "copies"
+    // (in order), but the new frames are added with one
+    // cmd::SetTotalFrames and placed with one cmd::RemapFrames
+    // (instead of moving the cels of all the next frames for each
+    // copied frame).
+    using FrameCopy = FrameMove;
+    void copyFrames(Sprite* sprite,
+                    const std::vector<FrameCopy>& copies,
+                    const TagsHandling tagsHandling);
+    void remapFrames(Sprite* sprite, const Remap& remap);
+
     // Cels API
     void addCel(LayerImage* layer, Cel* cel);
     Cel* addCel(LayerImage* layer, frame_t frameNumber, const ImageRef& image);
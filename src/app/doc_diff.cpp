@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,6 +17,7 @@
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/palette.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "doc/tag.h"
@@ -24,6 +25,9 @@
 #include "doc/tilesets.h"
 #include "doc/user_data.h"
 
+#include <algorithm>
+#include <vector>
+
 #ifdef _DEBUG
 namespace doc {
 
@@ -45,6 +49,69 @@ namespace app {
   #define TRACEDIFF(a, b)
 #endif
 
+// Minimum number of pixels to compare images in parallel (for
+// smaller documents it's faster to compare them in this thread)
+static const int64_t kMinPixelsToCompareInParallel = 1024*1024;
+
+namespace {
+
+struct CelImages {
+  DocDiff::CelDiff diff;
+  const Image* a;
+  const Image* b;
+};
+
+// Returns true if both images have the same pixels. Images created
+// with Image::createSharedCopy() that still share the same buffer
+// are equal without comparing their pixels.
+bool same_images(const Image* a, const Image* b)
+{
+  if (a == b)
+    return true;
+
+  if (a->pixelFormat() != b->pixelFormat() ||
+      a->bounds() != b->bounds())
+    return false;
+
+  if (a->isSharingBits() &&
+      b->isSharingBits() &&
+      a->rowBytes() == b->rowBytes() &&
+      a->getPixelAddress(0, 0) == b->getPixelAddress(0, 0))
+    return true;
+
+  return is_same_image(a, b);
+}
+
+// Compares the images of all the given cels, sets the
+// CelDiff::image field of the cels with different pixels.
+void compare_cel_images(std::vector<CelImages>& cels)
+{
+  int64_t pixels = 0;
+  for (const CelImages& cel : cels)
+    pixels += int64_t(cel.a->width()) * cel.a->height();
+
+  const int n = int(cels.size());
+  if (n < 2 || pixels < kMinPixelsToCompareInParallel) {
+    for (CelImages& cel : cels)
+      cel.diff.image = !same_images(cel.a, cel.b);
+    return;
+  }
+
+  // The results are saved in a vector (and then in the CelDiff
+  // bit-fields from this thread)
+  std::vector<char> different(n, 0);
+  doc::parallel_for(
+    n,
+    [&cels, &different](const int i){
+      different[i] = !same_images(cels[i].a, cels[i].b);
+    });
+
+  for (int i=0; i<n; ++i)
+    cels[i].diff.image = (different[i] != 0);
+}
+
+} // anonymous namespace
+
 DocDiff compare_docs(const Doc* a,
                      const Doc* b)
 {
@@ -116,6 +183,9 @@ DocDiff compare_docs(const Doc* a,
 
   // Palettes
   if (a->sprite()->getPalettes().size() != b->sprite()->getPalettes().size()) {
+    diff.anything = diff.palettes = true;
+  }
+  else {
     const PalettesList& aPals = a->sprite()->getPalettes();
     const PalettesList& bPals = b->sprite()->getPalettes();
     auto aIt = aPals.begin(), aEnd = aPals.end();
@@ -163,8 +233,8 @@ DocDiff compare_docs(const Doc* a,
       }
       else {
         for (tile_index ti=0; ti<aTileset->size(); ++ti) {
-          if (!is_same_image(aTileset->get(ti).get(),
-                             bTileset->get(ti).get())) {
+          if (!same_images(aTileset->get(ti).get(),
+                           bTileset->get(ti).get())) {
             diff.anything = diff.tilesets = true;
             goto done;
           }
@@ -184,7 +254,11 @@ DocDiff compare_docs(const Doc* a,
     auto aIt = aLayers.begin(), aEnd = aLayers.end();
     auto bIt = bLayers.begin(), bEnd = bLayers.end();
 
-    for (; aIt != aEnd && bIt != bEnd; ++aIt, ++bIt) {
+    // Cels that exist in both documents, their images are compared
+    // at the end (all together)
+    std::vector<CelImages> celImages;
+
+    for (int layerIndex=0; aIt != aEnd && bIt != bEnd; ++aIt, ++bIt, ++layerIndex) {
       const Layer* aLay = *aIt;
       const Layer* bLay = *bIt;
 
@@ -206,9 +280,13 @@ DocDiff compare_docs(const Doc* a,
           const Cel* aCel = aLay->cel(f);
           const Cel* bCel = bLay->cel(f);
 
+          DocDiff::CelDiff celDiff{ layerIndex, f, false, false };
+
           if ((!aCel && bCel) ||
               (aCel && !bCel)) {
             diff.anything = diff.cels = true;
+            celDiff.properties = true;
+            diff.celDiffs.push_back(celDiff);
           }
           else if (aCel && bCel) {
             if (aCel->frame() != bCel->frame() ||
@@ -216,6 +294,7 @@ DocDiff compare_docs(const Doc* a,
                 aCel->opacity() != bCel->opacity() ||
                 aCel->data()->userData() != bCel->data()->userData()) {
               diff.anything = diff.cels = true;
+              celDiff.properties = true;
 
               TRACEDIFF(aCel->frame(), bCel->frame());
               TRACEDIFF(aCel->bounds(), bCel->bounds());
@@ -223,17 +302,36 @@ DocDiff compare_docs(const Doc* a,
               TRACEDIFF(aCel->data()->userData(), bCel->data()->userData());
             }
             if (aCel->image() && bCel->image()) {
-              if (aCel->image()->bounds() != bCel->image()->bounds() ||
-                  !is_same_image(aCel->image(), bCel->image()))
+              celImages.push_back(CelImages{ celDiff, aCel->image(), bCel->image() });
+            }
+            else {
+              // In case one is nullptr and the other not
+              if (aCel->image() != bCel->image()) {
                 diff.anything = diff.images = true;
+                celDiff.image = true;
+              }
+              if (celDiff.properties || celDiff.image)
+                diff.celDiffs.push_back(celDiff);
             }
-            // In case one is nullptr and the other not
-            else if (aCel->image() != bCel->image())
-              diff.anything = diff.images = true;
           }
         }
       }
     }
+
+    compare_cel_images(celImages);
+    for (const CelImages& cel : celImages) {
+      if (cel.diff.image)
+        diff.anything = diff.images = true;
+      if (cel.diff.properties || cel.diff.image)
+        diff.celDiffs.push_back(cel.diff);
+    }
+
+    // Sort cels by layer and frame
+    std::sort(diff.celDiffs.begin(), diff.celDiffs.end(),
+              [](const DocDiff::CelDiff& a, const DocDiff::CelDiff& b) {
+                return (a.layer < b.layer ||
+                        (a.layer == b.layer && a.frame < b.frame));
+              });
   }
 
   // Compare color spaces
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,10 +9,24 @@
 #define APP_DOC_DIFF_H_INCLUDED
 #pragma once
 
+#include "doc/frame.h"
+
+#include <vector>
+
 namespace app {
   class Doc;
 
   struct DocDiff {
+    // A cel that is different in both documents, "layer" is the
+    // index of the layer in Sprite::allLayers().
+    struct CelDiff {
+      int layer;
+      doc::frame_t frame;
+      bool properties : 1;      // Bounds, opacity, user data, or one
+                                // of the cels doesn't exist
+      bool image : 1;           // Pixels
+    };
+
     bool anything : 1;
     bool canvas : 1;
     bool totalFrames : 1;
@@ -40,10 +54,19 @@ namespace app {
       colorProfiles(false),
       gridBounds(false) {
     }
+
+    // Details of the "cels" and "images" fields (only when both
+    // sprites have the same layers and number of frames)
+    std::vector<CelDiff> celDiffs;
   };
 
   // Useful for testing purposes to detect if two documents (after
   // some kind of operation) are equivalent.
+  //
+  // Images that share their pixels (e.g. cels of a document created
+  // with Doc::duplicate() that weren't modified) are not compared
+  // pixel by pixel, and the rest of the images of big documents are
+  // compared in parallel.
   DocDiff compare_docs(const Doc* a,
                        const Doc* b);
 
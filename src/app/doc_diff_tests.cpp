@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_diff.h"
+#include "app/test_context.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+using namespace app;
+using namespace doc;
+
+typedef std::unique_ptr<Doc> DocPtr;
+
+TEST(DocDiff, DuplicatedDoc)
+{
+  TestContextT<Context> ctx;
+  DocPtr doc(ctx.documents().add(32, 16));
+  Sprite* sprite = doc->sprite();
+  sprite->setTotalFrames(3);
+
+  LayerImage* layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+  for (frame_t f=1; f<3; ++f) {
+    ImageRef image(Image::create(sprite->spec()));
+    clear_image(image.get(), rgba(f*10, 0, 0, 255));
+    layer->addCel(new Cel(f, image));
+  }
+
+  DocPtr copy(doc->duplicate(DuplicateExactCopy));
+  DocDiff diff = compare_docs(doc.get(), copy.get());
+  EXPECT_FALSE(diff.anything);
+  EXPECT_TRUE(diff.celDiffs.empty());
+
+  // Modify the pixels of the second cel and the opacity of the third
+  // one in the copy
+  Sprite* spriteCopy = copy->sprite();
+  LayerImage* layerCopy = static_cast<LayerImage*>(spriteCopy->root()->firstLayer());
+  put_pixel(layerCopy->cel(1)->image(), 2, 3, rgba(255, 255, 255, 255));
+  layerCopy->cel(2)->setOpacity(128);
+
+  diff = compare_docs(doc.get(), copy.get());
+  EXPECT_TRUE(diff.anything);
+  EXPECT_TRUE(diff.cels);
+  EXPECT_TRUE(diff.images);
+  EXPECT_FALSE(diff.layers);
+  ASSERT_EQ(2u, diff.celDiffs.size());
+  EXPECT_EQ(0, diff.celDiffs[0].layer);
+  EXPECT_EQ(1, diff.celDiffs[0].frame);
+  EXPECT_FALSE(diff.celDiffs[0].properties);
+  EXPECT_TRUE(diff.celDiffs[0].image);
+  EXPECT_EQ(0, diff.celDiffs[1].layer);
+  EXPECT_EQ(2, diff.celDiffs[1].frame);
+  EXPECT_TRUE(diff.celDiffs[1].properties);
+  EXPECT_FALSE(diff.celDiffs[1].image);
+
+  copy->close();
+  doc->close();
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,13 +12,17 @@
 #include "app/doc_exporter.h"
 
 #include "app/app.h"
+#include "app/cli/cli_output_cache.h"
 #include "app/cmd/set_pixel_format.h"
 #include "app/console.h"
 #include "app/context.h"
 #include "app/doc.h"
 #include "app/file/file.h"
 #include "app/filename_formatter.h"
+#include "app/max_rects_packer.h"
+#include "app/phase_profiler.h"
 #include "app/restore_visible_layers.h"
+#include "app/sheet_sample_cache.h"
 #include "app/snap_to_grid.h"
 #include "app/util/autocrop.h"
 #include "base/convert_to.h"
@@ -26,11 +30,11 @@
 #include "base/fstream_path.h"
 #include "base/replace_string.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
 #include "doc/images_map.h"
-#include "doc/images_map.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
@@ -39,7 +43,6 @@
 #include "doc/slice.h"
 #include "doc/sprite.h"
 #include "doc/tag.h"
-#include "gfx/packing_rects.h"
 #include "gfx/rect_io.h"
 #include "gfx/size.h"
 #include "render/dithering.h"
@@ -48,12 +51,19 @@
 #include "ver/info.h"
 
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <condition_variable>
 #include <cstdio>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <map>
 #include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 #include <vector>
 
 #define DX_TRACE(...) // TRACEARGS
@@ -88,11 +98,151 @@ std::ostream& operator<<(std::ostream& os, const doc::UserData& data)
   return os;
 }
 
+// Accumulates the text of the data file in a buffer to write it in
+// big chunks (the "frames" of a sprite sheet with thousands of
+// samples can use several MB). Integers are formatted without the
+// std::ostream locale overhead.
+class DataFileWriter {
+public:
+  static constexpr size_t kChunkSize = 256*1024;
+
+  DataFileWriter(std::ostream& os) : m_os(os) {
+    m_buf.reserve(kChunkSize + 1024);
+  }
+
+  ~DataFileWriter() {
+    flush();
+  }
+
+  DataFileWriter& operator<<(const char* s) {
+    m_buf.append(s);
+    return check();
+  }
+
+  DataFileWriter& operator<<(const std::string& s) {
+    m_buf.append(s);
+    return check();
+  }
+
+  DataFileWriter& operator<<(const int value) {
+    char tmp[16];
+    const auto res = std::to_chars(tmp, tmp+sizeof(tmp), value);
+    m_buf.append(tmp, res.ptr);
+    return check();
+  }
+
+  // Text written with the same escape sequences as
+  // escape_for_json() (but without temporary strings)
+  struct Escaped {
+    const std::string& text;
+  };
+
+  DataFileWriter& operator<<(const Escaped& s) {
+    for (const char chr : s.text) {
+      if (chr == '\\' || chr == '"')
+        m_buf.push_back('\\');
+      m_buf.push_back(chr);
+    }
+    return check();
+  }
+
+  void flush() {
+    if (!m_buf.empty()) {
+      m_os.write(m_buf.data(), m_buf.size());
+      m_buf.clear();
+    }
+  }
+
+private:
+  DataFileWriter& check() {
+    if (m_buf.size() >= kChunkSize)
+      flush();
+    return *this;
+  }
+
+  std::ostream& m_os;
+  std::string m_buf;
+};
+
+// Calls func(render, i) for each i in [0, n) from several threads
+// (each thread with its own render::Render instance), and reports
+// the progress in the [progressFrom, progressTo] range from the
+// calling thread.
+template<typename Func>
+void render_in_parallel(const int n,
+                        base::task_token& token,
+                        const float progressFrom,
+                        const float progressTo,
+                        Func&& func)
+{
+  const int threads = std::min(int(std::thread::hardware_concurrency()), n);
+  if (threads < 2) {
+    render::Render render;
+    for (int i=0; i<n && !token.canceled(); ++i) {
+      func(render, i);
+      token.set_progress(progressFrom + (progressTo-progressFrom) * (i+1) / n);
+    }
+    return;
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<int> next(0);
+  std::exception_ptr error;
+  int done = 0;
+  int running = threads;
+
+  base::thread_pool pool(threads);
+  for (int t=0; t<threads; ++t) {
+    pool.execute([&]{
+      try {
+        render::Render render;
+        int i;
+        while (!token.canceled() && (i = next++) < n) {
+          func(render, i);
+
+          const std::lock_guard lock(mutex);
+          ++done;
+          cv.notify_one();
+        }
+      }
+      catch (...) {
+        const std::lock_guard lock(mutex);
+        if (!error)
+          error = std::current_exception();
+        next = n;               // Stop the other threads
+      }
+      const std::lock_guard lock(mutex);
+      --running;
+      cv.notify_one();
+    });
+  }
+
+  {
+    std::unique_lock lock(mutex);
+    while (running > 0) {
+      cv.wait(lock);
+      token.set_progress(progressFrom + (progressTo-progressFrom) * done / n);
+    }
+  }
+
+  if (error)
+    std::rethrow_exception(error);
+}
+
 } // anonymous namespace
 
 namespace app {
 
-typedef std::shared_ptr<gfx::Rect> SharedRectPtr;
+// Position of a sample in the texture, it's shared between linked
+// and duplicated samples.
+struct InTextureBounds {
+  gfx::Rect bounds;
+  int page = 0;                 // Page of the texture (or atlas)
+
+  InTextureBounds(const gfx::Rect& bounds) : bounds(bounds) { }
+};
+typedef std::shared_ptr<InTextureBounds> SharedBoundsPtr;
 
 DocExporter::Item::Item(Doc* doc,
                         const doc::Tag* tag,
@@ -172,7 +322,7 @@ public:
     m_isDuplicated(false),
     m_originalSize(size),
     m_trimmedBounds(size),
-    m_inTextureBounds(std::make_shared<gfx::Rect>(size)) {
+    m_inTextureBounds(std::make_shared<InTextureBounds>(size)) {
   }
 
   Doc* document() const { return m_document; }
@@ -187,8 +337,9 @@ public:
   std::string filename() const { return m_filename; }
   const gfx::Size& originalSize() const { return m_originalSize; }
   const gfx::Rect& trimmedBounds() const { return m_trimmedBounds; }
-  const gfx::Rect& inTextureBounds() const { return *m_inTextureBounds; }
-  const SharedRectPtr& sharedBounds() const { return m_inTextureBounds; }
+  const gfx::Rect& inTextureBounds() const { return m_inTextureBounds->bounds; }
+  int page() const { return m_inTextureBounds->page; }
+  const SharedBoundsPtr& sharedBounds() const { return m_inTextureBounds; }
 
   gfx::Size requiredSize() const {
     // if extrude option is enabled, an extra pixel is needed for each side
@@ -214,12 +365,13 @@ public:
     m_trimmedBounds = bounds;
   }
 
-  void setInTextureBounds(const gfx::Rect& bounds) {
+  void setInTextureBounds(const gfx::Rect& bounds, const int page = 0) {
     ASSERT(!bounds.isEmpty());
-    *m_inTextureBounds = bounds;
+    m_inTextureBounds->bounds = bounds;
+    m_inTextureBounds->page = page;
   }
 
-  void setSharedBounds(const SharedRectPtr& bounds) {
+  void setSharedBounds(const SharedBoundsPtr& bounds) {
     m_inTextureBounds = bounds;
   }
 
@@ -235,7 +387,30 @@ public:
   void setLinked() { m_isLinked = true; }
   void setDuplicated() { m_isDuplicated = true; }
 
+  // Pixels of the sample already rendered in the given bounds (e.g.
+  // from the samples cache), they are used instead of rendering the
+  // sprite again while the trimmed bounds are the same.
+  void setCachedRender(const gfx::Rect& bounds, const ImageRef& image) {
+    ASSERT(!image || image->size() == bounds.size());
+    m_cachedBounds = bounds;
+    m_cachedRender = image;
+  }
+
   ImageRef createRender(ImageBufferPtr& imageBuf) {
+    RestoreVisibleLayers layersVisibility;
+    if (m_selLayers)
+      layersVisibility.showSelectedLayers(m_sprite,
+                                          *m_selLayers);
+
+    render::Render render;
+    return createRender(render, imageBuf);
+  }
+
+  // Creates the render of this sample with the current visibility of
+  // the sprite layers (so it can be used from several threads at the
+  // same time, with one render::Render for each thread).
+  ImageRef createRender(render::Render& render,
+                        ImageBufferPtr& imageBuf) const {
     ASSERT(m_sprite);
 
     // We use the m_image as it is, it doesn't require a special
@@ -243,15 +418,18 @@ public:
     if (m_image)
       return m_image;
 
-    ImageRef render(
+    if (m_cachedRender && m_cachedBounds == m_trimmedBounds)
+      return m_cachedRender;
+
+    ImageRef image(
       Image::create(m_sprite->pixelFormat(),
                     m_trimmedBounds.w,
                     m_trimmedBounds.h,
                     imageBuf));
-    render->setMaskColor(m_sprite->transparentColor());
-    clear_image(render.get(), m_sprite->transparentColor());
-    renderSample(render.get(), 0, 0, false);
-    return render;
+    image->setMaskColor(m_sprite->transparentColor());
+    clear_image(image.get(), m_sprite->transparentColor());
+    renderSample(render, image.get(), 0, 0, false);
+    return image;
   }
 
   void renderSample(doc::Image* dst, int x, int y, bool extrude) const {
@@ -261,11 +439,36 @@ public:
                                           *m_selLayers);
 
     render::Render render;
+    renderSample(render, dst, x, y, extrude);
+  }
 
+  // Renders the sample with the current visibility of the sprite
+  // layers, samples in disjoint rectangles of "dst" can be rendered
+  // from several threads.
+  void renderSample(render::Render& render,
+                    doc::Image* dst, int x, int y, bool extrude) const {
     // 1) We cannot use the Preferences because this is called from a non-UI thread
     // 2) We should use the new blend mode always when we're saving files
     //render.setNewBlend(Preferences::instance().experimental.newBlend());
 
+    const bool useCachedRender =
+      (m_cachedRender &&
+       m_cachedBounds == m_trimmedBounds &&
+       m_cachedRender->pixelFormat() == dst->pixelFormat());
+
+    auto renderArea = [&](gfx::Clip clip) {
+      if (m_image) {
+        dst->copy(m_image.get(), clip);
+      }
+      else if (useCachedRender) {
+        clip.src.offset(-m_cachedBounds.origin());
+        dst->copy(m_cachedRender.get(), clip);
+      }
+      else {
+        render.renderSprite(dst, m_sprite, m_frame, clip);
+      }
+    };
+
     if (extrude) {
       const gfx::Rect& trim = m_trimmedBounds;
 
@@ -287,24 +490,13 @@ public:
       // side.
       for (int j=0; j<3; ++j) {
         for (int i=0; i<3; ++i) {
-          gfx::Clip clip(x+dx[i], y+dy[j], gfx::RectT<int>(srcx[i], srcy[j], szx[i], szy[j]));
-          if (m_image) {
-            dst->copy(m_image.get(), clip);
-          }
-          else {
-            render.renderSprite(dst, m_sprite, m_frame, clip);
-          }
+          renderArea(gfx::Clip(x+dx[i], y+dy[j],
+                               gfx::RectT<int>(srcx[i], srcy[j], szx[i], szy[j])));
         }
       }
     }
     else {
-      gfx::Clip clip(x, y, m_trimmedBounds);
-      if (m_image) {
-        dst->copy(m_image.get(), clip);
-      }
-      else {
-        render.renderSprite(dst, m_sprite, m_frame, clip);
-      }
+      renderArea(gfx::Clip(x, y, m_trimmedBounds));
     }
   }
 
@@ -324,7 +516,9 @@ private:
   bool m_isDuplicated;
   gfx::Size m_originalSize;
   gfx::Rect m_trimmedBounds;
-  SharedRectPtr m_inTextureBounds;
+  SharedBoundsPtr m_inTextureBounds;
+  gfx::Rect m_cachedBounds;
+  ImageRef m_cachedRender;
 };
 
 class DocExporter::Samples {
@@ -344,6 +538,45 @@ public:
     return m_samples[i];
   }
 
+  // Calls func(render, sample, i) for each sample index in "indices"
+  // from several threads. Consecutive samples with the same sprite
+  // and selected layers are processed in parallel (changing the
+  // visibility of layers just one time for all of them from the
+  // calling thread).
+  template<typename Func>
+  void renderInParallel(const std::vector<int>& indices,
+                        base::task_token& token,
+                        const float progressFrom,
+                        const float progressTo,
+                        Func&& func) const {
+    const int n = int(indices.size());
+    int i = 0;
+    while (i < n && !token.canceled()) {
+      const int first = i;
+      const Sample& firstSample = m_samples[indices[i]];
+      for (++i; i<n; ++i) {
+        const Sample& sample = m_samples[indices[i]];
+        if (sample.sprite() != firstSample.sprite() ||
+            sample.selectedLayers() != firstSample.selectedLayers())
+          break;
+      }
+
+      RestoreVisibleLayers layersVisibility;
+      if (firstSample.selectedLayers())
+        layersVisibility.showSelectedLayers(firstSample.sprite(),
+                                            *firstSample.selectedLayers());
+
+      render_in_parallel(
+        i - first, token,
+        progressFrom + (progressTo-progressFrom) * first / n,
+        progressFrom + (progressTo-progressFrom) * i / n,
+        [this, &indices, &func, first](render::Render& render, const int j){
+          const int k = indices[first+j];
+          func(render, m_samples[k], k);
+        });
+    }
+  }
+
   iterator begin() { return m_samples.begin(); }
   iterator end() { return m_samples.end(); }
   const_iterator begin() const { return m_samples.begin(); }
@@ -361,6 +594,56 @@ public:
                              int shapePadding,
                              int& width, int& height,
                              base::task_token& token) = 0;
+
+protected:
+  // Returns the index of the first sample with the same pixels for
+  // each duplicated sample (or -1 for unique samples or samples that
+  // are not included). Samples are rendered and hashed in parallel,
+  // and then indexed in a doc::ImagesMap (which only compares with
+  // is_same_image() the images with the same hash), so this is
+  // close to linear in the number of samples.
+  template<typename Include>
+  static std::vector<int> findDuplicates(const Samples& samples,
+                                         Include&& include,
+                                         base::task_token& token) {
+    std::vector<int> indices;
+    for (int i=0; i<samples.size(); ++i) {
+      const Sample& sample = samples[i];
+      if (!sample.isEmpty() && include(sample))
+        indices.push_back(i);
+    }
+
+    std::vector<ImageRef> renders(samples.size());
+    samples.renderInParallel(
+      indices, token, 0.2f, 0.3f,
+      [&renders](render::Render& render, const Sample& sample, const int i){
+        // We have to use one ImageBuffer for each image because we're
+        // going to store all images in the "duplicates" map.
+        doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
+        ImageRef sampleRender(sample.createRender(render, sampleBuf));
+
+        // Calculate (and cache) the hash in this thread
+        calculate_image_hash(sampleRender.get(), sampleRender->bounds());
+        renders[i] = sampleRender;
+      });
+
+    std::vector<int> duplicateOf(samples.size(), -1);
+    if (token.canceled())
+      return duplicateOf;
+
+    doc::ImagesMap duplicates;
+    for (const int i : indices) {
+      auto it = duplicates.find(renders[i]);
+      if (it != duplicates.end()) {
+        duplicateOf[i] = it->second;
+        renders[i].reset();
+      }
+      else {
+        duplicates[renders[i]] = i;
+      }
+    }
+    return duplicateOf;
+  }
 };
 
 class DocExporter::SimpleLayoutSamples : public DocExporter::LayoutSamples {
@@ -392,7 +675,11 @@ public:
     const Layer* oldLayer = nullptr;
     const Tag* oldTag = nullptr;
 
-    doc::ImagesMap duplicates;
+    const std::vector<int> duplicates =
+      findDuplicates(samples,
+                     [this](const Sample& sample){
+                       return (m_mergeDups || sample.isLinked());
+                     }, token);
     gfx::Point framePt(borderPadding, borderPadding);
     gfx::Size rowSize(0, 0);
 
@@ -409,7 +696,7 @@ public:
     for (auto& sample : samples) {
       if (token.canceled())
         return;
-      token.set_progress(0.2f + 0.2f * i / samples.size());
+      token.set_progress(0.3f + 0.1f * i / samples.size());
 
       if (sample.isEmpty()) {
         sample.setInTextureBounds(gfx::Rect(0, 0, 0, 0));
@@ -417,21 +704,11 @@ public:
         continue;
       }
 
-      if (m_mergeDups || sample.isLinked()) {
-        doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
-        doc::ImageRef sampleRender(sample.createRender(sampleBuf));
-        auto it = duplicates.find(sampleRender);
-        if (it != duplicates.end()) {
-          const uint32_t j = it->second;
-
-          sample.setDuplicated();
-          sample.setSharedBounds(samples[j].sharedBounds());
-          ++i;
-          continue;
-        }
-        else {
-          duplicates[sampleRender] = i;
-        }
+      if (duplicates[i] >= 0) {
+        sample.setDuplicated();
+        sample.setSharedBounds(samples[duplicates[i]].sharedBounds());
+        ++i;
+        continue;
       }
 
       const Sprite* sprite = sample.sprite();
@@ -528,46 +805,48 @@ private:
 
 class DocExporter::BestFitLayoutSamples : public DocExporter::LayoutSamples {
 public:
+  // If maxPageSize is not empty, samples are distributed in several
+  // pages (textures) of that maximum size.
+  BestFitLayoutSamples(const gfx::Size& maxPageSize)
+    : m_maxPageSize(maxPageSize) {
+  }
+
   void layoutSamples(Samples& samples,
                      int borderPadding,
                      int shapePadding,
                      int& width, int& height,
                      base::task_token& token) override {
-    gfx::PackingRects pr(borderPadding, shapePadding);
-    doc::ImagesMap duplicates;
+    MaxRectsPacker pr(borderPadding, shapePadding);
+    const std::vector<int> duplicates =
+      findDuplicates(samples,
+                     [](const Sample&){ return true; },
+                     token);
+    if (token.canceled())
+      return;
 
-    uint32_t i = 0;
+    int i = 0;
     for (auto& sample : samples) {
-      if (token.canceled())
-        return;
-      token.set_progress_range(0.2f, 0.3f);
-      token.set_progress(float(i) / samples.size());
-
       if (sample.isEmpty()) {
         ++i;
         continue;
       }
 
-      // We have to use one ImageBuffer for each image because we're
-      // going to store all images in the "duplicates" map.
-      doc::ImageBufferPtr sampleBuf = std::make_shared<doc::ImageBuffer>();
-      doc::ImageRef sampleRender(sample.createRender(sampleBuf));
-      auto it = duplicates.find(sampleRender);
-      if (it != duplicates.end()) {
-        const uint32_t j = it->second;
-
+      if (duplicates[i] >= 0) {
         sample.setDuplicated();
-        sample.setSharedBounds(samples[j].sharedBounds());
+        sample.setSharedBounds(samples[duplicates[i]].sharedBounds());
       }
       else {
-        duplicates[sampleRender] = i;
         pr.add(sample.requiredSize());
       }
       ++i;
     }
 
     token.set_progress_range(0.3f, 0.4f);
-    if (width == 0 || height == 0) {
+    if (width == 0 && height == 0 &&
+        m_maxPageSize.w > 0 && m_maxPageSize.h > 0) {
+      pr.packPages(m_maxPageSize, token);
+    }
+    else if (width == 0 || height == 0) {
       gfx::Size sz = pr.bestFit(token, width, height);
       width = sz.w;
       height = sz.h;
@@ -585,9 +864,13 @@ public:
         continue;
 
       ASSERT(it != pr.end());
-      sample.setInTextureBounds(*(it++));
+      sample.setInTextureBounds(*it, pr.page(it - pr.begin()));
+      ++it;
     }
   }
+
+private:
+  gfx::Size m_maxPageSize;
 };
 
 DocExporter::DocExporter()
@@ -619,6 +902,8 @@ void DocExporter::reset()
   m_trimCels = false;
   m_trimByGrid = false;
   m_extrude = false;
+  m_sampleCacheDir.clear();
+  m_maxPageSize = gfx::Size(0, 0);
   m_splitLayers = false;
   m_splitTags = false;
   m_listTags = false;
@@ -632,6 +917,34 @@ void DocExporter::setDocImageBuffer(const doc::ImageBufferPtr& docBuf)
   m_docBuf = docBuf;
 }
 
+std::string DocExporter::pageFilename(const int page, const int pages) const
+{
+  // Just one texture
+  if (pages == 1)
+    return m_textureFilename;
+
+  // "sheet{page}.png" or "sheet.png" -> "sheet-0.png"
+  std::string fn = m_textureFilename;
+  if (fn.find("{page}") != std::string::npos)
+    base::replace_string(fn, "{page}", base::convert_to<std::string>(page));
+  else {
+    fn = base::get_file_title_with_path(fn) + "-" +
+         base::convert_to<std::string>(page) + "." +
+         base::get_file_extension(fn);
+  }
+  return fn;
+}
+
+// Name used to identify the whole sprite sheet in --profile
+std::string DocExporter::sheetName() const
+{
+  if (!m_textureFilename.empty())
+    return m_textureFilename;
+  if (!m_dataFilename.empty())
+    return m_dataFilename;
+  return "sprite sheet";
+}
+
 Doc* DocExporter::exportSheet(Context* ctx, base::task_token& token)
 {
   // We output the metadata to std::cout if the user didn't specify a file.
@@ -678,49 +991,76 @@ Doc* DocExporter::exportSheet(Context* ctx, base::task_token& token)
   token.set_progress(0.2f);
 
   // 2) Layout those samples in a texture field.
-  layoutSamples(samples, token);
+  {
+    ScopedPhase phase(PhaseProfiler::Phase::SheetPack, sheetName());
+    layoutSamples(samples, token);
+  }
   if (token.canceled())
     return nullptr;
   token.set_progress(0.4f);
 
-  // 3) Create and render the texture.
-  std::unique_ptr<Doc> textureDocument(
-    createEmptyTexture(samples, token));
-  if (token.canceled())
-    return nullptr;
-  token.set_progress(0.6f);
+  // 3) Create and render the texture of each page (there is only
+  //    one page if a maximum page size wasn't specified).
+  int pages = 1;
+  for (const auto& sample : samples)
+    pages = std::max(pages, sample.page()+1);
 
-  Sprite* texture = textureDocument->sprite();
-  Image* textureImage = texture->root()->firstLayer()
-    ->cel(frame_t(0))->image();
+  std::vector<std::unique_ptr<Doc>> textureDocuments;
+  std::vector<Sprite*> textures;
+  for (int page=0; page<pages; ++page) {
+    token.set_progress_range(0.4f + 0.5f * page / pages,
+                             0.4f + 0.5f * (page+1) / pages);
 
-  renderTexture(ctx, samples, textureImage, token);
-  if (token.canceled())
-    return nullptr;
-  token.set_progress(0.8f);
+    std::unique_ptr<Doc> textureDocument(
+      createEmptyTexture(samples, page, token));
+    if (token.canceled())
+      return nullptr;
+    token.set_progress(0.6f);
+
+    Sprite* texture = textureDocument->sprite();
+    Image* textureImage = texture->root()->firstLayer()
+      ->cel(frame_t(0))->image();
 
-  // Trim texture
-  if (m_trimSprite || m_trimCels)
-    trimTexture(samples, texture);
+    renderTexture(ctx, samples, page, textureImage, token);
+    if (token.canceled())
+      return nullptr;
+    token.set_progress(0.8f);
+
+    // Trim texture
+    if (m_trimSprite || m_trimCels)
+      trimTexture(samples, page, texture);
+
+    textures.push_back(texture);
+    textureDocuments.push_back(std::move(textureDocument));
+  }
+  token.set_progress_range(0.0f, 1.0f);
   token.set_progress(0.9f);
 
   // Save the metadata.
-  if (osbuf)
-    createDataFile(samples, os, texture);
+  if (osbuf) {
+    ScopedPhase phase(PhaseProfiler::Phase::DataFile, sheetName());
+    createDataFile(samples, os, textures);
+    if (!m_dataFilename.empty())
+      CliOutputCache::notifySavedFile(m_dataFilename);
+  }
   token.set_progress(0.95f);
 
   // Save the image files.
   if (!m_textureFilename.empty()) {
-    DX_TRACE("DX: exportSheet", m_textureFilename);
-    textureDocument->setFilename(m_textureFilename.c_str());
-    int ret = save_document(ctx, textureDocument.get());
-    if (ret == 0)
-      textureDocument->markAsSaved();
+    for (int page=0; page<pages; ++page) {
+      Doc* textureDocument = textureDocuments[page].get();
+      const std::string fn = pageFilename(page, pages);
+      DX_TRACE("DX: exportSheet", fn);
+      textureDocument->setFilename(fn.c_str());
+      int ret = save_document(ctx, textureDocument);
+      if (ret == 0)
+        textureDocument->markAsSaved();
+    }
   }
 
   token.set_progress(1.0f);
 
-  return textureDocument.release();
+  return textureDocuments[0].release();
 }
 
 gfx::Size DocExporter::calculateSheetSize()
@@ -729,7 +1069,7 @@ gfx::Size DocExporter::calculateSheetSize()
   Samples samples;
   captureSamples(samples, token);
   layoutSamples(samples, token);
-  return calculateSheetSize(samples, token);
+  return calculateSheetSize(samples, 0, token);
 }
 
 void DocExporter::addDocument(
@@ -884,7 +1224,13 @@ void DocExporter::captureSamples(Samples& samples,
 {
   DX_TRACE("DX: Capture samples");
 
+  std::unique_ptr<SheetSampleCache> sampleCache;
+  if (!m_sampleCacheDir.empty())
+    sampleCache = std::make_unique<SheetSampleCache>(m_sampleCacheDir);
+
+  int itemIndex = -1;
   for (auto& item : m_documents) {
+    ++itemIndex;
     if (token.canceled())
       return;
 
@@ -940,6 +1286,103 @@ void DocExporter::captureSamples(Samples& samples,
       }
     }
 
+    const gfx::Size sampleSize =
+      (item.image ? item.image->size():
+       item.splitGrid ? sprite->gridBounds().size():
+                        sprite->size());
+
+    // Reference color to trim cels/ignore empty cels
+    const bool refColorFromFirstPixel =
+      (m_trimCels &&
+       ((layer &&
+         layer->isBackground()) ||
+        (!layer &&
+         sprite->backgroundLayer() &&
+         sprite->backgroundLayer()->isVisible())));
+
+    // Returns false if the whole sample render is transparent
+    auto shrinkSample = [&](const Image* sampleRender,
+                            gfx::Rect& frameBounds) -> bool {
+      const doc::color_t refColor =
+        (refColorFromFirstPixel ? get_pixel(sampleRender, 0, 0):
+                                  sprite->transparentColor());
+      return algorithm::shrink_bounds(sampleRender,
+                                      refColor,
+                                      nullptr,        // layer
+                                      spriteBounds,   // startBounds
+                                      frameBounds);   // output bounds
+    };
+
+    // Render and shrink the samples of this item in parallel (all of
+    // them need the same visible layers). Linked cels are not
+    // included as they will probably re-use the previous sample.
+    // Samples found in the cache are not rendered at all.
+    std::map<frame_t, SheetSample> shrunkSamples;
+    if ((m_ignoreEmptyCels || m_trimCels) &&
+        !item.isOneImageOnly()) {
+      std::vector<frame_t> frames;
+      for (frame_t frame : item.getSelectedFrames()) {
+        if (layer && layer->isImage()) {
+          const Cel* cel = layer->cel(frame);
+          if ((!cel && m_ignoreEmptyCels) ||
+              (cel && cel->link() && m_mergeDuplicates))
+            continue;
+        }
+        frames.push_back(frame);
+      }
+
+      std::vector<SheetSample> shrunk(frames.size());
+      {
+        RestoreVisibleLayers layersVisibility;
+        if (item.selLayers)
+          layersVisibility.showSelectedLayers(sprite, *item.selLayers);
+
+        render_in_parallel(
+          int(frames.size()), token,
+          0.2f * itemIndex / m_documents.size(),
+          0.2f * (itemIndex+1) / m_documents.size(),
+          [&](render::Render& render, const int i){
+            SheetSample& result = shrunk[i];
+            SheetSampleCache::Key key = 0;
+            if (sampleCache) {
+              key = SheetSampleCache::sampleKey(
+                doc->filename(), sprite, frames[i],
+                sampleSize, spriteBounds, refColorFromFirstPixel);
+              if (key && sampleCache->load(key, result)) {
+                if (result.image)
+                  result.image->setMaskColor(sprite->transparentColor());
+                return;
+              }
+            }
+
+            Sample tmp(sampleSize, doc, sprite, nullptr, item.selLayers.get(),
+                       frames[i], nullptr, std::string(),
+                       m_innerPadding, m_extrude);
+            doc::ImageBufferPtr buf = std::make_shared<doc::ImageBuffer>();
+            ImageRef sampleRender(tmp.createRender(render, buf));
+            result.nonEmpty = shrinkSample(sampleRender.get(), result.bounds);
+
+            if (sampleCache) {
+              // Keep the trimmed pixels so this sample is not
+              // rendered again to create the texture
+              if (result.nonEmpty) {
+                result.image.reset(
+                  crop_image(sampleRender.get(), result.bounds,
+                             sprite->transparentColor()));
+                result.image->setMaskColor(sprite->transparentColor());
+              }
+              if (key)
+                sampleCache->save(key, result);
+            }
+          });
+      }
+      if (token.canceled())
+        return;
+
+      for (size_t i=0; i<frames.size(); ++i)
+        shrunkSamples[frames[i]] = std::move(shrunk[i]);
+    }
+
     frame_t outputFrame = 0;
     for (frame_t frame : item.getSelectedFrames()) {
       if (token.canceled())
@@ -963,9 +1406,7 @@ void DocExporter::captureSamples(Samples& samples,
       std::string filename = filename_formatter(format, fnInfo);
 
       Sample sample(
-        (item.image ? item.image->size():
-         item.splitGrid ? sprite->gridBounds().size():
-                          sprite->size()),
+        sampleSize,
         doc, sprite, item.image, item.selLayers.get(),
         frame, innerTag, filename,
         m_innerPadding, m_extrude);
@@ -1011,31 +1452,21 @@ void DocExporter::captureSamples(Samples& samples,
         if (layer && layer->isImage() && !cel && m_ignoreEmptyCels)
           continue;
 
-        ImageRef sampleRender(sample.createRender(m_sampleBuf));
-
         gfx::Rect frameBounds;
-        doc::color_t refColor = 0;
-
-        if (m_trimCels) {
-          if ((layer &&
-               layer->isBackground()) ||
-              (!layer &&
-               sprite->backgroundLayer() &&
-               sprite->backgroundLayer()->isVisible())) {
-            refColor = get_pixel(sampleRender.get(), 0, 0);
-          }
-          else {
-            refColor = sprite->transparentColor();
-          }
+        bool nonEmpty;
+        auto it = shrunkSamples.find(frame);
+        if (it != shrunkSamples.end()) {
+          nonEmpty = it->second.nonEmpty;
+          frameBounds = it->second.bounds;
+          if (it->second.image)
+            sample.setCachedRender(frameBounds, it->second.image);
+        }
+        else {
+          ImageRef sampleRender(sample.createRender(m_sampleBuf));
+          nonEmpty = shrinkSample(sampleRender.get(), frameBounds);
         }
-        else if (m_ignoreEmptyCels)
-          refColor = sprite->transparentColor();
 
-        if (!algorithm::shrink_bounds(sampleRender.get(),
-                                      refColor,
-                                      nullptr,        // layer
-                                      spriteBounds,   // startBounds
-                                      frameBounds)) { // output bounds
+        if (!nonEmpty) {
           // If shrink_bounds() returns false, it's because the whole
           // image is transparent (equal to the mask color).
 
@@ -1088,7 +1519,7 @@ void DocExporter::captureSamples(Samples& samples,
           for (pos.x=initPos.x; pos.x+gridBounds.w <= spriteBounds.w; pos.x+=gridBounds.w) {
             const gfx::Rect cellBounds(pos, gridBounds.size());
             sample.setTrimmedBounds(cellBounds);
-            sample.setSharedBounds(std::make_shared<gfx::Rect>(sample.inTextureBounds()));
+            sample.setSharedBounds(std::make_shared<InTextureBounds>(*sample.sharedBounds()));
             samples.addSample(sample);
           }
         }
@@ -1114,7 +1545,7 @@ void DocExporter::layoutSamples(Samples& samples,
 
   switch (m_sheetType) {
     case SpriteSheetType::Packed: {
-      BestFitLayoutSamples layout;
+      BestFitLayoutSamples layout(m_maxPageSize);
       layout.layoutSamples(
         samples, m_borderPadding, m_shapePadding,
         width, height, token);
@@ -1135,6 +1566,7 @@ void DocExporter::layoutSamples(Samples& samples,
 }
 
 gfx::Size DocExporter::calculateSheetSize(const Samples& samples,
+                                          const int page,
                                           base::task_token& token) const
 {
   DX_TRACE("DX: calculateSheetSize predefined texture size",
@@ -1148,7 +1580,8 @@ gfx::Size DocExporter::calculateSheetSize(const Samples& samples,
 
     if (sample.isLinked() ||
         sample.isDuplicated() ||
-        sample.isEmpty())
+        sample.isEmpty() ||
+        sample.page() != page)
       continue;
 
     gfx::Rect sampleBounds = sample.inTextureBounds();
@@ -1178,6 +1611,7 @@ gfx::Size DocExporter::calculateSheetSize(const Samples& samples,
 }
 
 Doc* DocExporter::createEmptyTexture(const Samples& samples,
+                                     const int page,
                                      base::task_token& token) const
 {
   ColorMode colorMode = ColorMode::INDEXED;
@@ -1242,7 +1676,10 @@ Doc* DocExporter::createEmptyTexture(const Samples& samples,
     }
   }
 
-  gfx::Size textureSize = calculateSheetSize(samples, token);
+  // All pages use the same color mode/palette (so they are created
+  // from all samples), but the texture size is calculated only from
+  // the samples in the given page.
+  gfx::Size textureSize = calculateSheetSize(samples, page, token);
   if (token.canceled())
     return nullptr;
 
@@ -1267,27 +1704,27 @@ Doc* DocExporter::createEmptyTexture(const Samples& samples,
 
 void DocExporter::renderTexture(Context* ctx,
                                 const Samples& samples,
+                                const int page,
                                 Image* textureImage,
                                 base::task_token& token) const
 {
   textureImage->clear(textureImage->maskColor());
 
-  int i = 0;
+  // Make the sprites compatible with the texture so the render()
+  // works correctly (this must be done before rendering samples in
+  // parallel).
   for (const auto& sample : samples) {
     if (token.canceled())
       return;
-    token.set_progress(0.6f + 0.2f * i / int(samples.size()));
 
     if (sample.isLinked() ||
         sample.isDuplicated() ||
-        sample.isEmpty()) {
-      ++i;
+        sample.isEmpty())
       continue;
-    }
 
-    // Make the sprite compatible with the texture so the render()
-    // works correctly.
     if (sample.sprite()->pixelFormat() != textureImage->pixelFormat()) {
+      ScopedPhase phase(PhaseProfiler::Phase::Quantize,
+                        sample.document()->filename());
       cmd::SetPixelFormat(
         sample.sprite(),
         textureImage->pixelFormat(),
@@ -1297,17 +1734,36 @@ void DocExporter::renderTexture(Context* ctx,
         nullptr) // TODO add a delegate to show progress
         .execute(ctx);
     }
+  }
 
-    sample.renderSample(
-      textureImage,
-      sample.inTextureBounds().x+m_innerPadding,
-      sample.inTextureBounds().y+m_innerPadding,
-      m_extrude);
-    ++i;
+  // Each sample is rendered in a disjoint rectangle of the texture,
+  // so they can be rendered in parallel.
+  std::vector<int> indices;
+  for (int i=0; i<samples.size(); ++i) {
+    const Sample& sample = samples[i];
+    if (!sample.isLinked() &&
+        !sample.isDuplicated() &&
+        !sample.isEmpty() &&
+        sample.page() == page)
+      indices.push_back(i);
   }
+
+  samples.renderInParallel(
+    indices, token, 0.6f, 0.8f,
+    [this, textureImage](render::Render& render, const Sample& sample, int){
+      ScopedPhase phase(PhaseProfiler::Phase::Render,
+                        sample.document()->filename());
+      sample.renderSample(
+        render,
+        textureImage,
+        sample.inTextureBounds().x+m_innerPadding,
+        sample.inTextureBounds().y+m_innerPadding,
+        m_extrude);
+    });
 }
 
 void DocExporter::trimTexture(const Samples& samples,
+                              const int page,
                               doc::Sprite* texture) const
 {
   if (m_textureWidth > 0 && m_textureHeight > 0)
@@ -1319,7 +1775,8 @@ void DocExporter::trimTexture(const Samples& samples,
   for (const auto& sample : samples) {
     if (sample.isLinked() ||
         sample.isDuplicated() ||
-        sample.isEmpty())
+        sample.isEmpty() ||
+        sample.page() != page)
       continue;
 
     // We add the border padding in the sample size to do an union
@@ -1344,8 +1801,12 @@ void DocExporter::trimTexture(const Samples& samples,
 
 void DocExporter::createDataFile(const Samples& samples,
                                  std::ostream& os,
-                                 doc::Sprite* texture)
+                                 const std::vector<doc::Sprite*>& textures)
 {
+  ASSERT(!textures.empty());
+  const doc::Sprite* texture = textures[0];
+  const int pages = int(textures.size());
+
   std::string frames_begin;
   std::string frames_end;
   bool filename_as_key = false;
@@ -1377,7 +1838,10 @@ void DocExporter::createDataFile(const Samples& samples,
       break;
   }
 
-  os << "{ \"frames\": " << frames_begin << "\n";
+  // The frames are written with a DataFileWriter as they are the
+  // biggest part of the data file.
+  DataFileWriter w(os);
+  w << "{ \"frames\": " << frames_begin << "\n";
   for (Samples::const_iterator
          it = samples.begin(),
          end = samples.end(); it != end; ) {
@@ -1387,34 +1851,38 @@ void DocExporter::createDataFile(const Samples& samples,
     gfx::Rect frameBounds = sample.inTextureBounds();
 
     if (filename_as_key)
-      os << "   \"" << escape_for_json(sample.filename()) << "\": {\n";
+      w << "   \"" << DataFileWriter::Escaped{ sample.filename() } << "\": {\n";
     else if (filename_as_attr)
-      os << "   {\n"
-         << "    \"filename\": \"" << escape_for_json(sample.filename()) << "\",\n";
-
-    os << "    \"frame\": { "
-       << "\"x\": " << frameBounds.x + nonExtrudedPosition << ", "
-       << "\"y\": " << frameBounds.y + nonExtrudedPosition << ", "
-       << "\"w\": " << frameBounds.w + nonExtrudedSize << ", "
-       << "\"h\": " << frameBounds.h + nonExtrudedSize << " },\n"
-       << "    \"rotated\": false,\n"
-       << "    \"trimmed\": " << (sample.trimmed() ? "true": "false") << ",\n"
-       << "    \"spriteSourceSize\": { "
-       << "\"x\": " << spriteSourceBounds.x << ", "
-       << "\"y\": " << spriteSourceBounds.y << ", "
-       << "\"w\": " << spriteSourceBounds.w << ", "
-       << "\"h\": " << spriteSourceBounds.h << " },\n"
-       << "    \"sourceSize\": { "
-       << "\"w\": " << srcSize.w << ", "
-       << "\"h\": " << srcSize.h << " },\n"
-       << "    \"duration\": " << sample.sprite()->frameDuration(sample.frame()) << "\n"
-       << "   }";
+      w << "   {\n"
+        << "    \"filename\": \"" << DataFileWriter::Escaped{ sample.filename() } << "\",\n";
+
+    w << "    \"frame\": { "
+      << "\"x\": " << frameBounds.x + nonExtrudedPosition << ", "
+      << "\"y\": " << frameBounds.y + nonExtrudedPosition << ", "
+      << "\"w\": " << frameBounds.w + nonExtrudedSize << ", "
+      << "\"h\": " << frameBounds.h + nonExtrudedSize << " },\n";
+    if (pages > 1)
+      w << "    \"page\": " << sample.page() << ",\n";
+    w << "    \"rotated\": false,\n"
+      << "    \"trimmed\": " << (sample.trimmed() ? "true": "false") << ",\n"
+      << "    \"spriteSourceSize\": { "
+      << "\"x\": " << spriteSourceBounds.x << ", "
+      << "\"y\": " << spriteSourceBounds.y << ", "
+      << "\"w\": " << spriteSourceBounds.w << ", "
+      << "\"h\": " << spriteSourceBounds.h << " },\n"
+      << "    \"sourceSize\": { "
+      << "\"w\": " << srcSize.w << ", "
+      << "\"h\": " << srcSize.h << " },\n"
+      << "    \"duration\": " << sample.sprite()->frameDuration(sample.frame()) << "\n"
+      << "   }";
 
     if (++it != samples.end())
-      os << ",\n";
+      w << ",\n";
     else
-      os << "\n";
+      w << "\n";
   }
+  w.flush();
+
   os << " " << frames_end;
 
   // "meta" property
@@ -1434,6 +1902,44 @@ void DocExporter::createDataFile(const Samples& samples,
      << "\"h\": " << texture->height() << " },\n"
      << "  \"scale\": \"1\"";
 
+  // meta.pages (the first page is the "image" of the meta data too)
+  if (pages > 1) {
+    os << ",\n"
+       << "  \"pages\": [";
+    for (int page=0; page<pages; ++page) {
+      os << (page > 0 ? ",": "") << "\n   { ";
+      if (!m_textureFilename.empty())
+        os << "\"image\": \""
+           << escape_for_json(base::get_file_name(pageFilename(page, pages)))
+           << "\", ";
+      os << "\"size\": { "
+         << "\"w\": " << textures[page]->width() << ", "
+         << "\"h\": " << textures[page]->height() << " } }";
+    }
+    os << "\n  ]";
+  }
+
+  // meta.density (ratio of the texture area used by samples)
+  int64_t textureArea = 0;
+  for (const doc::Sprite* page : textures)
+    textureArea += int64_t(page->width()) * page->height();
+  if (m_sheetType == SpriteSheetType::Packed && textureArea > 0) {
+    int64_t area = 0;
+    for (const auto& sample : samples) {
+      if (!sample.isLinked() &&
+          !sample.isDuplicated() &&
+          !sample.isEmpty()) {
+        const gfx::Rect& rc = sample.inTextureBounds();
+        area += int64_t(rc.w) * rc.h;
+      }
+    }
+    const double density = double(area) / double(textureArea);
+    const auto oldPrecision = os.precision(4);
+    os << ",\n"
+       << "  \"density\": " << std::fixed << density << std::defaultfloat;
+    os.precision(oldPrecision);
+  }
+
   // meta.frameTags
   if (m_listTags) {
     os << ",\n"
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,7 @@
 #include "doc/object_version.h"
 #include "gfx/fwd.h"
 #include "gfx/rect.h"
+#include "gfx/size.h"
 
 #include <iosfwd>
 #include <memory>
@@ -71,6 +72,9 @@ namespace app {
     void setTrimCels(bool trim) { m_trimCels = trim; }
     void setTrimByGrid(bool trimByGrid) { m_trimByGrid = trimByGrid; }
     void setExtrude(bool extrude) { m_extrude = extrude; }
+    void setSampleCacheDir(const std::string& dir) { m_sampleCacheDir = dir; }
+    // Splits packed sheets in several textures (pages) of this maximum size
+    void setMaxPageSize(const gfx::Size& size) { m_maxPageSize = size; }
     void setFilenameFormat(const std::string& format) { m_filenameFormat = format; }
     void setTagnameFormat(const std::string& format) { m_tagnameFormat = format; }
     void setSplitLayers(bool splitLayers) { m_splitLayers = splitLayers; }
@@ -117,15 +121,21 @@ namespace app {
     void layoutSamples(Samples& samples,
                        base::task_token& token);
     gfx::Size calculateSheetSize(const Samples& samples,
+                                 const int page,
                                  base::task_token& token) const;
     Doc* createEmptyTexture(const Samples& samples,
+                            const int page,
                             base::task_token& token) const;
     void renderTexture(Context* ctx,
                        const Samples& samples,
+                       const int page,
                        doc::Image* textureImage,
                        base::task_token& token) const;
-    void trimTexture(const Samples& samples, doc::Sprite* texture) const;
-    void createDataFile(const Samples& samples, std::ostream& os, doc::Sprite* texture);
+    void trimTexture(const Samples& samples, const int page, doc::Sprite* texture) const;
+    void createDataFile(const Samples& samples, std::ostream& os,
+                        const std::vector<doc::Sprite*>& textures);
+    std::string pageFilename(const int page, const int pages) const;
+    std::string sheetName() const;
 
     class Item {
     public:
@@ -176,6 +186,8 @@ namespace app {
     bool m_trimCels;
     bool m_trimByGrid;
     bool m_extrude;
+    std::string m_sampleCacheDir;
+    gfx::Size m_maxPageSize;
     bool m_splitLayers;
     bool m_splitTags;
     bool m_listTags;
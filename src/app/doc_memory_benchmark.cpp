@@ -0,0 +1,308 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+// Measures the memory used by common document operations (open,
+// duplicate sprite, convert color mode, export sprite sheet, and
+// undo a filter applied to the whole sprite) with fixture documents
+// of different sizes. Each benchmark reports these counters:
+//
+//   allocs      Number of allocations per operation
+//   alloc_bytes Allocated bytes per operation
+//   peak_bytes  Peak of heap memory in use during one operation
+//   peak_rss    Peak resident set size of the whole process
+//
+// The same information is available for real files from the CLI
+// with --profile-memory.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/copy_region.h"
+#include "app/cmd/set_pixel_format.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_exporter.h"
+#include "app/doc_undo.h"
+#include "app/file/file.h"
+#include "app/memory_profiler.h"
+#include "app/sprite_sheet_type.h"
+#include "app/test_context.h"
+#include "app/tx.h"
+#include "base/fs.h"
+#include "base/task.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "render/dithering.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+enum Arg {
+  kCanvasSize,
+  kLayers,
+  kFrames,
+};
+
+// Accumulates the memory used by the measured part of each
+// iteration.
+class MemoryCounters {
+public:
+  void add(const MemoryProfiler::Stats& stats) {
+    m_total.allocs += stats.allocs;
+    m_total.allocBytes += stats.allocBytes;
+    m_total.peakBytes = std::max(m_total.peakBytes, stats.peakBytes);
+  }
+
+  void setCounters(benchmark::State& state) const {
+    state.counters["allocs"] =
+      benchmark::Counter(double(m_total.allocs), benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] =
+      benchmark::Counter(double(m_total.allocBytes), benchmark::Counter::kAvgIterations,
+                         benchmark::Counter::kIs1024);
+    state.counters["peak_bytes"] =
+      benchmark::Counter(double(m_total.peakBytes), benchmark::Counter::kDefaults,
+                         benchmark::Counter::kIs1024);
+    state.counters["peak_rss"] =
+      benchmark::Counter(double(MemoryProfiler::peakRss()), benchmark::Counter::kDefaults,
+                         benchmark::Counter::kIs1024);
+  }
+
+private:
+  MemoryProfiler::Stats m_total;
+};
+
+// Fills the image with runs of random colors
+void fill_image(Image* image, const int seed)
+{
+  std::srand(seed);
+  color_t c = 0;
+  for (int y=0; y<image->height(); ++y) {
+    for (int x=0; x<image->width(); ++x) {
+      if ((std::rand() & 7) == 0) {
+        const int v = std::rand() & 0xff;
+        c = rgba(v, 255-v, (v*7) & 0xff, 255);
+      }
+      put_pixel(image, x, y, c);
+    }
+  }
+}
+
+// A RGB document with the given number of layers and frames (all
+// cels have an image of the canvas size)
+class DocFixture {
+public:
+  DocFixture(const benchmark::State& state)
+    : m_doc(m_ctx.documents().add(state.range(kCanvasSize),
+                                  state.range(kCanvasSize),
+                                  ColorMode::RGB, 256)) {
+    Sprite* sprite = m_doc->sprite();
+    const int layers = state.range(kLayers);
+    const int frames = state.range(kFrames);
+
+    sprite->setTotalFrames(frames);
+    for (int i=1; i<layers; ++i)
+      sprite->root()->addLayer(new LayerImage(sprite));
+
+    int seed = 1;
+    for (Layer* layer : sprite->root()->layers()) {
+      auto layerImage = static_cast<LayerImage*>(layer);
+      for (frame_t frame=0; frame<frames; ++frame) {
+        Cel* cel = layerImage->cel(frame);
+        if (!cel) {
+          cel = new Cel(frame, ImageRef(Image::create(sprite->spec())));
+          layerImage->addCel(cel);
+        }
+        fill_image(cel->image(), seed++);
+      }
+    }
+  }
+
+  ~DocFixture() {
+    m_doc->close();
+  }
+
+  Context* context() { return &m_ctx; }
+  Doc* doc() { return m_doc.get(); }
+  Sprite* sprite() { return m_doc->sprite(); }
+
+private:
+  TestContextT<Context> m_ctx;
+  std::unique_ptr<Doc> m_doc;
+};
+
+} // anonymous namespace
+
+void BM_Open(benchmark::State& state) {
+  DocFixture fixture(state);
+  const std::string filename = "_memory_benchmark.aseprite";
+  fixture.doc()->setFilename(filename);
+  if (save_document(fixture.context(), fixture.doc()) != 0) {
+    state.SkipWithError("Error saving the file");
+    return;
+  }
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    ScopedMemoryStats memory;
+    std::unique_ptr<Doc> loaded(load_document(fixture.context(), filename));
+    if (!loaded) {
+      state.SkipWithError("Error loading the file");
+      break;
+    }
+    loaded->close();
+    counters.add(memory.stats());
+  }
+  counters.setCounters(state);
+
+  base::delete_file(filename);
+}
+
+void BM_DuplicateSprite(benchmark::State& state) {
+  DocFixture fixture(state);
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    ScopedMemoryStats memory;
+    std::unique_ptr<Doc> copy(fixture.doc()->duplicate(Doc::DuplicateExactCopy));
+    copy.reset();
+    counters.add(memory.stats());
+  }
+  counters.setCounters(state);
+}
+
+void BM_ConvertColorMode(benchmark::State& state) {
+  DocFixture fixture(state);
+  Sprite* sprite = fixture.sprite();
+  DocUndo* undo = fixture.doc()->undoHistory();
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    {
+      ScopedMemoryStats memory;
+      Tx tx(sprite, "Convert");
+      tx(new cmd::SetPixelFormat(sprite, IMAGE_INDEXED,
+                                 render::Dithering(),
+                                 Sprite::DefaultRgbMapAlgorithm(),
+                                 nullptr, nullptr));
+      tx.commit();
+      counters.add(memory.stats());
+    }
+
+    // Go back to RGB (without measuring it)
+    state.PauseTiming();
+    undo->undo();
+    undo->clearRedo();
+    state.ResumeTiming();
+  }
+  counters.setCounters(state);
+}
+
+void BM_ExportSheet(benchmark::State& state) {
+  DocFixture fixture(state);
+  const std::string dataFilename = "_memory_benchmark.json";
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    ScopedMemoryStats memory;
+    DocExporter exporter;
+    exporter.setDataFilename(dataFilename);
+    exporter.setSpriteSheetType(SpriteSheetType::Packed);
+    exporter.addDocumentSamples(fixture.doc(), nullptr,
+                                false, false, false,
+                                nullptr, nullptr);
+
+    base::task_token token;
+    std::unique_ptr<Doc> sheet(exporter.exportSheet(fixture.context(), token));
+    if (!sheet) {
+      state.SkipWithError("Error exporting the sprite sheet");
+      break;
+    }
+    sheet.reset();
+    counters.add(memory.stats());
+  }
+  counters.setCounters(state);
+
+  base::delete_file(dataFilename);
+}
+
+void BM_UndoFilter(benchmark::State& state) {
+  DocFixture fixture(state);
+  Sprite* sprite = fixture.sprite();
+  DocUndo* undo = fixture.doc()->undoHistory();
+
+  // Apply an "invert colors" filter to all cels in one transaction
+  // (the same commands used by FilterManagerImpl)
+  {
+    Tx tx(sprite, "Invert Color");
+    for (Cel* cel : sprite->cels()) {
+      Image* image = cel->image();
+      ImageRef dst(Image::createCopy(image));
+      for (int y=0; y<dst->height(); ++y) {
+        for (int x=0; x<dst->width(); ++x) {
+          const color_t c = get_pixel(dst.get(), x, y);
+          put_pixel(dst.get(), x, y,
+                    rgba(255-rgba_getr(c),
+                         255-rgba_getg(c),
+                         255-rgba_getb(c),
+                         rgba_geta(c)));
+        }
+      }
+      tx(new cmd::CopyRegion(image, dst.get(),
+                             gfx::Region(image->bounds()),
+                             gfx::Point(0, 0)));
+    }
+    tx.commit();
+  }
+
+  MemoryCounters counters;
+  for (auto _ : state) {
+    {
+      ScopedMemoryStats memory;
+      undo->undo();
+      counters.add(memory.stats());
+    }
+
+    state.PauseTiming();
+    undo->redo();
+    state.ResumeTiming();
+  }
+  counters.setCounters(state);
+}
+
+// Canvas size, layers, frames
+#define DOC_FIXTURES()                          \
+  Args({ 256, 4, 8 })                           \
+  ->Args({ 1024, 2, 4 })                        \
+  ->Args({ 2048, 8, 1 })                        \
+  ->Unit(benchmark::kMillisecond)               \
+  ->UseRealTime()
+
+BENCHMARK(BM_Open)->DOC_FIXTURES();
+BENCHMARK(BM_DuplicateSprite)->DOC_FIXTURES();
+BENCHMARK(BM_ConvertColorMode)->DOC_FIXTURES();
+BENCHMARK(BM_ExportSheet)->DOC_FIXTURES();
+BENCHMARK(BM_UndoFilter)->DOC_FIXTURES();
+
+int app_main(int argc, char* argv[])
+{
+  MemoryProfiler::setEnabled(true);
+
+  ::benchmark::Initialize(&argc, argv);
+  return ::benchmark::RunSpecifiedBenchmarks();
+}
@@ -0,0 +1,73 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/doc_memory_usage.h"
+
+#include "app/doc.h"
+#include "app/doc_undo.h"
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/mask.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+
+namespace app {
+
+using namespace doc;
+
+DocMemoryUsage& DocMemoryUsage::operator+=(const DocMemoryUsage& other)
+{
+  images += other.images;
+  tilesets += other.tilesets;
+  tilesetsCache += other.tilesetsCache;
+  celsCache += other.celsCache;
+  undo += other.undo;
+  render += other.render;
+  return *this;
+}
+
+DocMemoryUsage calculate_doc_memory_usage(const Doc* doc)
+{
+  DocMemoryUsage usage;
+  const Sprite* sprite = doc->sprite();
+
+  // Linked cels share the same image, so we count unique cels only
+  for (const Cel* cel : sprite->uniqueCels()) {
+    usage.images += cel->image()->getMemSize();
+    usage.celsCache += cel->data()->compressedData().size();
+  }
+
+  if (sprite->hasTilesets()) {
+    for (const Tileset* tileset : *sprite->tilesets()) {
+      if (!tileset)
+        continue;
+      usage.tilesets += tileset->getMemSize();
+      usage.tilesetsCache += tileset->compressedData().size();
+    }
+  }
+
+  if (const DocUndo* undo = doc->undoHistory())
+    usage.undo = undo->totalUndoSize();
+
+  if (const ExtraCelRef extraCel = doc->extraCel()) {
+    // The image of a TRANSFORM extra cel is not a copy
+    const Image* image = extraCel->image();
+    if (image && extraCel->type() != render::ExtraType::TRANSFORM)
+      usage.render += image->getMemSize();
+  }
+  if (const Mask* mask = doc->mask())
+    usage.render += mask->getMemSize();
+
+  return usage;
+}
+
+} // namespace app
@@ -0,0 +1,42 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_DOC_MEMORY_USAGE_H_INCLUDED
+#define APP_DOC_MEMORY_USAGE_H_INCLUDED
+#pragma once
+
+#include <cstddef>
+
+namespace app {
+  class Doc;
+
+  // Approximated memory used by a document (in bytes) by category.
+  struct DocMemoryUsage {
+    std::size_t images = 0;        // Cel images (including tilemaps)
+    std::size_t tilesets = 0;      // Tile images
+    std::size_t tilesetsCache = 0; // Compressed tilesets read from .aseprite files
+    std::size_t celsCache = 0;     // Compressed cels read from/written to .aseprite files
+    std::size_t undo = 0;          // Undo history
+    std::size_t render = 0;        // Extra cel used to preview tools and the selection mask
+
+    std::size_t total() const {
+      return images + tilesets + tilesetsCache + celsCache + undo + render;
+    }
+
+    // Memory that can be released without losing information
+    std::size_t caches() const {
+      return tilesetsCache + celsCache;
+    }
+
+    DocMemoryUsage& operator+=(const DocMemoryUsage& other);
+  };
+
+  // The document must be locked for reading.
+  DocMemoryUsage calculate_doc_memory_usage(const Doc* doc);
+
+} // namespace app
+
+#endif
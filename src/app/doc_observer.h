@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -72,6 +72,8 @@ namespace app {
     virtual void onFrameDurationChanged(DocEvent& ev) { }
 
     virtual void onImagePixelsModified(DocEvent& ev) { }
+
+    // Only for observers subscribed with Doc::subscribeToPixelsEvents()
     virtual void onSpritePixelsModified(DocEvent& ev) { }
     virtual void onExposeSpritePixels(DocEvent& ev) { }
 
@@ -120,6 +122,11 @@ namespace app {
     // scripts will listen this event).
     virtual void onAfterAddTile(DocEvent& ev) { }
 
+    // Called at the end of a batch update (Doc::endBatchUpdate()),
+    // observers that deferred their UI updates during the batch
+    // (checking Doc::isInBatchUpdate()) must do them here.
+    virtual void onAfterBatchUpdate(DocEvent& ev) { }
+
   };
 
 } // namespace app
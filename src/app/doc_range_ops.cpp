@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,14 +16,17 @@
 
 #include "app/app.h"
 #include "app/context_access.h"
+#include "app/doc.h"
 #include "app/doc_api.h"
 #include "app/doc_range.h"
 #include "app/transaction.h"
 #include "app/tx.h"
 #include "doc/layer.h"
+#include "doc/remap.h"
 #include "doc/sprite.h"
 
 #include <stdexcept>
+#include <vector>
 
 #ifdef TRACE_RANGE_OPS
 #include <iostream>
@@ -107,6 +110,10 @@ static DocRange move_or_copy_frames(
     (place == kDocRangeBefore ? dstFrame:
                                 dstFrame+1);
 
+  // Moved/copied frames are remapped at the end in one step
+  std::vector<DocApi::FrameMove> moves;
+  std::vector<DocApi::FrameCopy> copies;
+
   for (; srcFrame != srcFrameEnd; ++srcFrame) {
     frame_t fromFrame = (*srcFrame)+srcDelta;
 
@@ -143,10 +150,9 @@ static DocRange move_or_copy_frames(
     switch (op) {
 
       case Move:
-        api.moveFrame(sprite, fromFrame, dstFrame,
-                      (place == kDocRangeBefore ? kDropBeforeFrame:
-                                                  kDropAfterFrame),
-                      tagsHandling);
+        moves.push_back({ fromFrame, dstFrame,
+                          (place == kDocRangeBefore ? kDropBeforeFrame:
+                                                      kDropAfterFrame) });
 
         if (fromFrame < dstBeforeFrame-1) {
           --srcDelta;
@@ -158,10 +164,9 @@ static DocRange move_or_copy_frames(
         break;
 
       case Copy:
-        api.copyFrame(sprite, fromFrame, dstFrame,
-                      (place == kDocRangeBefore ? kDropBeforeFrame:
-                                                  kDropAfterFrame),
-                      tagsHandling);
+        copies.push_back({ fromFrame, dstFrame,
+                           (place == kDocRangeBefore ? kDropBeforeFrame:
+                                                       kDropAfterFrame) });
 
         if (fromFrame < dstBeforeFrame-1) {
           ++firstCopiedBlock;
@@ -183,6 +188,11 @@ static DocRange move_or_copy_frames(
 #endif
   }
 
+  if (!moves.empty())
+    api.moveFrames(sprite, moves, tagsHandling);
+  if (!copies.empty())
+    api.copyFrames(sprite, copies, tagsHandling);
+
   DocRange result;
   if (!srcRange.selectedLayers().empty())
     result.selectLayers(srcRange.selectedLayers());
@@ -333,13 +343,13 @@ static DocRange drop_range_op(
     const app::Context* context = static_cast<app::Context*>(doc->context());
     const ContextReader reader(context);
     ContextWriter writer(reader);
+
+    // UI updates of each moved/copied cel/layer/frame are deferred
+    // until the end of the whole operation
+    DocBatchUpdate batch(doc);
     Tx tx(writer, undoLabel, ModifyDocument);
     DocApi api = doc->getApi(tx);
 
-    // TODO Try to add the range with just one call to DocApi
-    // methods, to avoid generating a lot of cmd::SetCelFrame (see
-    // DocApi::setCelFramePosition() function).
-
     switch (from.type()) {
 
       case DocRange::kCels: {
@@ -490,6 +500,7 @@ void reverse_frames(Doc* doc, const DocRange& range)
   const app::Context* context = static_cast<app::Context*>(doc->context());
   const ContextReader reader(context);
   ContextWriter writer(reader);
+  DocBatchUpdate batch(doc);
   Tx tx(writer, "Reverse Frames");
   DocApi api = doc->getApi(tx);
   Sprite* sprite = doc->sprite();
@@ -520,13 +531,14 @@ void reverse_frames(Doc* doc, const DocRange& range)
   }
 
   if (moveFrames) {
-    for (frame_t frameRev = frameEnd+1;
-         frameRev > frameBegin;
-         --frameRev) {
-      api.moveFrame(sprite, frameBegin, frameRev,
-                    kDropBeforeFrame,
-                    kDontAdjustTags);
+    Remap remap(sprite->totalFrames());
+    for (frame_t frame=0; frame<sprite->totalFrames(); ++frame) {
+      if (frame >= frameBegin && frame <= frameEnd)
+        remap.map(frame, frameBegin+frameEnd-frame);
+      else
+        remap.map(frame, frame);
     }
+    api.remapFrames(sprite, remap);
   }
   else if (swapCels) {
     for (Layer* layer : layers) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,11 +18,15 @@
 #include "app/context.h"
 #include "app/doc_undo_observer.h"
 #include "app/pref/preferences.h"
+#include "app/trace.h"
+#include "app/undo_payload.h"
+#include "base/chrono.h"
 #include "base/mem_utils.h"
 #include "base/scoped_value.h"
 #include "undo/undo_history.h"
 #include "undo/undo_state.h"
 
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
@@ -63,8 +67,17 @@ void DocUndo::add(CmdTransaction* cmd)
 
   m_undoHistory.add(cmd);
   m_totalUndoSize += cmd->memSize();
+  APP_TRACE_COUNTER("Undo size", m_totalUndoSize);
 
   notify_observers(&DocUndoObserver::onAddUndoState, this);
+
+  compactOldStates();
+
+  // Old states were compressed in the background thread since the
+  // last time we calculated the size
+  if (m_payloadGeneration != UndoPayload::generation())
+    updateTotalUndoSize();
+
   notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
 
   if (App::instance()) {
@@ -105,15 +118,19 @@ bool DocUndo::canRedo() const
 void DocUndo::undo()
 {
   ASSERT(!m_undoing);
+  APP_TRACE_ZONE("Undo");
   base::ScopedValue undoing(m_undoing, true);
   const size_t oldSize = m_totalUndoSize;
   {
+    base::Chrono chrono;
     const undo::UndoState* state = nextUndo();
     ASSERT(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
     m_undoHistory.undo();
     m_totalUndoSize += cmd->memSize();
+    UNDO_TRACE("UNDO: Undo <%s> %.16g secs\n",
+               cmd->label().c_str(), chrono.elapsed());
   }
   // This notification could execute a script that modifies the sprite
   // again (e.g. a script that is listening the "change" event, check
@@ -127,15 +144,19 @@ void DocUndo::undo()
 void DocUndo::redo()
 {
   ASSERT(!m_undoing);
+  APP_TRACE_ZONE("Redo");
   base::ScopedValue undoing(m_undoing, true);
   const size_t oldSize = m_totalUndoSize;
   {
+    base::Chrono chrono;
     const undo::UndoState* state = nextRedo();
     ASSERT(state);
     const Cmd* cmd = STATE_CMD(state);
     m_totalUndoSize -= cmd->memSize();
     m_undoHistory.redo();
     m_totalUndoSize += cmd->memSize();
+    UNDO_TRACE("UNDO: Redo <%s> %.16g secs\n",
+               cmd->label().c_str(), chrono.elapsed());
   }
   notify_observers(&DocUndoObserver::onCurrentUndoStateChange, this);
   if (m_totalUndoSize != oldSize)
@@ -281,7 +302,9 @@ void DocUndo::moveToState(const undo::UndoState* state)
   ASSERT(!m_undoing);
   base::ScopedValue undoing(m_undoing, true);
 
+  base::Chrono chrono;
   m_undoHistory.moveTo(state);
+  UNDO_TRACE("UNDO: Move to state %p %.16g secs\n", state, chrono.elapsed());
 
   // After onCurrentUndoStateChange don't use the "state" argument, it
   // might be deleted because some script might have modified the
@@ -290,14 +313,50 @@ void DocUndo::moveToState(const undo::UndoState* state)
 
   // Recalculate the total undo size
   size_t oldSize = m_totalUndoSize;
+  updateTotalUndoSize();
+  if (m_totalUndoSize != oldSize)
+    notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
+}
+
+void DocUndo::compactOldStates()
+{
+  if (!App::instance())
+    return;
+
+  auto& pref = App::instance()->preferences();
+  const int steps = pref.undo.compressAfterSteps();
+  if (steps <= 0)
+    return;
+
+  UndoPayload::setMemoryBudget(
+    std::size_t(std::max(0, pref.undo.memoryBudget())) * 1024 * 1024);
+
+  // Compress the states older than the latest N steps (states that
+  // were uncompressed to undo/redo them are compressed again here)
+  const undo::UndoState* state = currentState();
+  for (int i=0; state && i<steps; ++i)
+    state = state->prev();
+  for (; state; state = state->prev())
+    STATE_CMD(state)->compactMemory();
+}
+
+void DocUndo::compactMemory()
+{
+  for (const undo::UndoState* state = m_undoHistory.firstState();
+       state; state = state->next()) {
+    STATE_CMD(state)->compactMemory();
+  }
+}
+
+void DocUndo::updateTotalUndoSize()
+{
+  m_payloadGeneration = UndoPayload::generation();
   m_totalUndoSize = 0;
   const undo::UndoState* s = m_undoHistory.firstState();
   while (s) {
     m_totalUndoSize += STATE_CMD(s)->memSize();
     s = s->next();
   }
-  if (m_totalUndoSize != oldSize)
-    notify_observers(&DocUndoObserver::onTotalUndoSizeChange, this);
 }
 
 const undo::UndoState* DocUndo::nextUndo() const
@@ -324,7 +383,9 @@ void DocUndo::onDeleteUndoState(undo::UndoState* state)
              base::get_pretty_memory_size(cmd->memSize()).c_str(),
              base::get_pretty_memory_size(m_totalUndoSize).c_str());
 
-  m_totalUndoSize -= cmd->memSize();
+  // The size of the command could be different from the size when it
+  // was added (if it was compressed in the background thread)
+  m_totalUndoSize -= std::min(m_totalUndoSize, cmd->memSize());
   notify_observers(&DocUndoObserver::onDeleteUndoState, this, state);
 
   // Mark this document as impossible to match the version on disk
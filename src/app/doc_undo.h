@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -100,10 +100,17 @@ namespace app {
 
     void moveToState(const undo::UndoState* state);
 
+    // Compresses the payloads of all undo states (e.g. used when the
+    // document is closed and kept in memory by ClosedDocs).
+    void compactMemory();
+
   private:
     const undo::UndoState* nextUndo() const;
     const undo::UndoState* nextRedo() const;
 
+    void compactOldStates();
+    void updateTotalUndoSize();
+
     // undo::UndoHistoryDelegate impl
     void onDeleteUndoState(undo::UndoState* state) override;
 
@@ -112,6 +119,9 @@ namespace app {
     Context* m_ctx = nullptr;
     size_t m_totalUndoSize = 0;
 
+    // UndoPayload::generation() when m_totalUndoSize was calculated
+    int m_payloadGeneration = 0;
+
     // True when we are undoing/redoing. Used to avoid adding new undo
     // information when we are moving through the undo history.
     bool m_undoing = false;
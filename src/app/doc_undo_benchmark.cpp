@@ -0,0 +1,156 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/cmd/copy_region.h"
+#include "app/cmd/set_cel_opacity.h"
+#include "app/cmd/set_cel_position.h"
+#include "app/cmd/set_layer_name.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_undo.h"
+#include "app/test_context.h"
+#include "app/tx.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "undo/undo_state.h"
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+// A document with an undo history of "n" transactions, each one
+// with a different kind of command (pixels, cel properties, and
+// layer properties)
+class UndoFixture {
+public:
+  UndoFixture(const int n)
+    : m_doc(m_ctx.documents().add(256, 256)) {
+    Sprite* sprite = m_doc->sprite();
+    Layer* layer = sprite->root()->firstLayer();
+    Cel* cel = layer->cel(0);
+    Image* image = cel->image();
+    ImageRef src(Image::create(image->pixelFormat(), 16, 16));
+
+    for (int i=0; i<n; ++i) {
+      Tx tx(sprite, "Benchmark");
+      switch (i % 4) {
+        case 0: {
+          clear_image(src.get(), rgba(i & 0xff, 0, 0, 255));
+          const gfx::Point pos((i*16) % 256, ((i/16)*16) % 256);
+          tx(new cmd::CopyRegion(image, src.get(),
+                                 gfx::Region(gfx::Rect(pos, src->size())),
+                                 gfx::Point(0, 0)));
+          break;
+        }
+        case 1:
+          tx(new cmd::SetCelPosition(cel, i % 32, i % 16));
+          break;
+        case 2:
+          tx(new cmd::SetCelOpacity(cel, i & 0xff));
+          break;
+        case 3:
+          tx(new cmd::SetLayerName(layer, std::to_string(i)));
+          break;
+      }
+      tx.commit();
+    }
+  }
+
+  ~UndoFixture() {
+    m_doc->close();
+  }
+
+  DocUndo* undo() { return m_doc->undoHistory(); }
+
+private:
+  TestContextT<Context> m_ctx;
+  std::unique_ptr<Doc> m_doc;
+};
+
+} // anonymous namespace
+
+void BM_UndoRedoAll(benchmark::State& state) {
+  const int n = state.range(0);
+  UndoFixture fixture(n);
+  DocUndo* undo = fixture.undo();
+
+  while (state.KeepRunning()) {
+    while (undo->canUndo())
+      undo->undo();
+    while (undo->canRedo())
+      undo->redo();
+  }
+  state.SetItemsProcessed(2 * n * state.iterations());
+}
+
+void BM_MoveToState(benchmark::State& state) {
+  const int n = state.range(0);
+  UndoFixture fixture(n);
+  DocUndo* undo = fixture.undo();
+
+  // Jump between the first state, the middle of the history, and the
+  // last state
+  const undo::UndoState* first = undo->firstState();
+  const undo::UndoState* last = undo->lastState();
+  const undo::UndoState* middle = first;
+  for (int i=0; i<n/2 && middle; ++i)
+    middle = middle->next();
+
+  while (state.KeepRunning()) {
+    undo->moveToState(first);
+    undo->moveToState(last);
+    undo->moveToState(middle);
+    undo->moveToState(last);
+  }
+}
+
+void BM_UndoHistoryTraversal(benchmark::State& state) {
+  const int n = state.range(0);
+  UndoFixture fixture(n);
+  DocUndo* undo = fixture.undo();
+
+  while (state.KeepRunning()) {
+    int count = 0;
+    for (const undo::UndoState* s = undo->firstState(); s; s = s->next())
+      ++count;
+    benchmark::DoNotOptimize(count);
+  }
+}
+
+BENCHMARK(BM_UndoRedoAll)
+  ->Arg(100)
+  ->Arg(1000)
+  ->Arg(10000)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_MoveToState)
+  ->Arg(100)
+  ->Arg(1000)
+  ->Arg(10000)
+  ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_UndoHistoryTraversal)
+  ->Arg(10000)
+  ->Unit(benchmark::kMicrosecond);
+
+int app_main(int argc, char* argv[])
+{
+  ::benchmark::Initialize(&argc, argv);
+  return ::benchmark::RunSpecifiedBenchmarks();
+}
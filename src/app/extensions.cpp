@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2023  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2017-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,8 @@
 #include "app/commands/command.h"
 #include "app/commands/commands.h"
 #include "app/console.h"
+#include "app/context.h"
+#include "app/doc.h"
 #include "app/ini_file.h"
 #include "app/load_matrix.h"
 #include "app/pref/preferences.h"
@@ -25,6 +27,7 @@
 #include "base/file_handle.h"
 #include "base/fs.h"
 #include "base/fstream_path.h"
+#include "base/string.h"
 #include "render/dithering_matrix.h"
 #include "ui/widget.h"
 
@@ -33,6 +36,7 @@
 #endif
 
 #ifdef ENABLE_SCRIPTING
+  #include "app/script/chunk_cache.h"
   #include "app/script/engine.h"
   #include "app/script/luacpp.h"
   #include "app/script/require.h"
@@ -200,6 +204,17 @@ void write_json_file(const std::string& path, const json11::Json& json)
   out.write(text.c_str(), text.size());
 }
 
+// Command IDs, file extensions, and event names of activation events
+// are case insensitive (e.g. "onCommand:MyCommand" is stored as
+// "onCommand:mycommand").
+std::string normalize_activation_event(const std::string& event)
+{
+  const auto i = event.find(':');
+  if (i == std::string::npos)
+    return event;
+  return event.substr(0, i+1) + base::string_to_lower(event.substr(i+1));
+}
+
 } // anonymous namespace
 
 //////////////////////////////////////////////////////////////////////
@@ -252,7 +267,7 @@ Extension::~Extension()
 void Extension::executeInitActions()
 {
 #ifdef ENABLE_SCRIPTING
-  if (isEnabled() && hasScripts())
+  if (isEnabled() && hasScripts() && activatesOnStartup())
     initScripts();
 #endif
 }
@@ -260,7 +275,7 @@ void Extension::executeInitActions()
 void Extension::executeExitActions()
 {
 #ifdef ENABLE_SCRIPTING
-  if (isEnabled() && hasScripts())
+  if (isEnabled() && hasScripts() && isActive())
     exitScripts();
 #endif // ENABLE_SCRIPTING
 }
@@ -383,9 +398,12 @@ void Extension::enable(const bool state)
 #ifdef ENABLE_SCRIPTING
   if (hasScripts()) {
     if (m_isEnabled) {
-      initScripts();
+      // Extensions with activation events are initialized when the
+      // first event is received
+      if (!m_isActive && activatesOnStartup())
+        initScripts();
     }
-    else {
+    else if (m_isActive) {
       exitScripts();
     }
   }
@@ -410,6 +428,11 @@ void Extension::uninstall(const DeletePluginPref delPref)
   // Remove all files inside the extension path
   uninstallFiles(m_path, delPref);
 
+#ifdef ENABLE_SCRIPTING
+  // Remove the precompiled chunks of the extension scripts
+  script::ChunkCache(chunkCachePath()).clear();
+#endif
+
   m_isEnabled = false;
   m_isInstalled = false;
 }
@@ -628,6 +651,8 @@ void Extension::initScripts()
   script::Engine* engine = App::instance()->scriptEngine();
   lua_State* L = engine->luaState();
 
+  m_isActive = true;
+
   // Put a new "plugin" object for init()/exit() functions
   script::push_plugin(L, this);
   m_plugin.pluginRef = luaL_ref(L, LUA_REGISTRYINDEX);
@@ -636,6 +661,11 @@ void Extension::initScripts()
   // plugin path.
   script::SetPluginForRequire setPlugin(L, m_plugin.pluginRef);
 
+  // Scripts (and modules loaded with require()) are loaded from the
+  // precompiled chunks of this extension when they are up to date.
+  script::ChunkCache chunkCache(chunkCachePath());
+  script::SetChunkCache setChunkCache(engine, &chunkCache);
+
   // Read plugin.preferences value
   {
     std::string fn = base::join_path(m_path, kPrefLua);
@@ -687,11 +717,20 @@ void Extension::initScripts()
   }
 }
 
+std::string Extension::chunkCachePath() const
+{
+  ResourceFinder rf;
+  rf.includeUserDir(base::join_path("cache/extensions", m_name).c_str());
+  return rf.defaultFilename();
+}
+
 void Extension::exitScripts()
 {
   script::Engine* engine = App::instance()->scriptEngine();
   lua_State* L = engine->luaState();
 
+  m_isActive = false;
+
   // Call the exit() function of each script
   for (auto& script : m_plugin.scripts) {
     if (script.exitFunctionRef != LUA_REFNIL) {
@@ -786,6 +825,28 @@ void Extension::addScript(const std::string& fn)
   updateCategory(Category::Scripts);
 }
 
+void Extension::addActivationEvent(const std::string& event)
+{
+  m_activationEvents.insert(normalize_activation_event(event));
+}
+
+bool Extension::hasActivationEvent(const std::string& event) const
+{
+  return (m_activationEvents.find(event) != m_activationEvents.end());
+}
+
+bool Extension::activatesOnStartup() const
+{
+  return (m_activationEvents.empty() ||
+          hasActivationEvent("*"));
+}
+
+void Extension::activate()
+{
+  if (isEnabled() && hasScripts() && !m_isActive)
+    initScripts();
+}
+
 #endif // ENABLE_SCRIPTING
 
 //////////////////////////////////////////////////////////////////////
@@ -856,17 +917,76 @@ void Extensions::executeInitActions()
   for (auto& ext : m_extensions)
     ext->executeInitActions();
 
+#ifdef ENABLE_SCRIPTING
+  // Observe the context to activate extensions on demand
+  auto ctx = App::instance()->context();
+  if (ctx && !m_observing) {
+    ctx->add_observer(this);
+    ctx->documents().add_observer(this);
+    m_beforeCmdConn = ctx->BeforeCommandExecution.connect(
+      [this]{ activateExtensions("onEvent:beforecommand"); });
+    m_afterCmdConn = ctx->AfterCommandExecution.connect(
+      [this]{ activateExtensions("onEvent:aftercommand"); });
+    m_observing = true;
+  }
+#endif
+
   ScriptsChange(nullptr);
 }
 
 void Extensions::executeExitActions()
 {
+  if (m_observing) {
+    auto ctx = App::instance()->context();
+    ctx->remove_observer(this);
+    ctx->documents().remove_observer(this);
+    m_beforeCmdConn.disconnect();
+    m_afterCmdConn.disconnect();
+    m_observing = false;
+  }
+
   for (auto& ext : m_extensions)
     ext->executeExitActions();
 
   ScriptsChange(nullptr);
 }
 
+void Extensions::activateExtensions(const std::string& event)
+{
+#ifdef ENABLE_SCRIPTING
+  const std::string normalizedEvent = normalize_activation_event(event);
+
+  // Copy the list as the activated scripts could install new
+  // extensions
+  const List extensions = m_extensions;
+  for (auto ext : extensions) {
+    if (!ext->isEnabled() ||
+        !ext->hasScripts() ||
+        ext->isActive() ||
+        !ext->hasActivationEvent(normalizedEvent))
+      continue;
+
+    LOG("EXT: Activating extension '%s' by '%s'\n",
+        ext->name().c_str(), normalizedEvent.c_str());
+
+    ext->activate();
+    ScriptsChange(ext);
+  }
+#endif
+}
+
+void Extensions::onAddDocument(Doc* doc)
+{
+  const std::string ext = base::get_file_extension(doc->filename());
+  if (!ext.empty())
+    activateExtensions("onFileType:" + ext);
+}
+
+void Extensions::onActiveSiteChange(const Site& site)
+{
+  activateExtensions("onEvent:sitechange");
+}
+
 std::string Extensions::languagePath(const std::string& langId)
 {
   for (auto ext : m_extensions) {
@@ -1258,6 +1378,23 @@ Extension* Extensions::loadExtension(const std::string& path,
 #endif // ENABLE_SCRIPTING
   }
 
+#ifdef ENABLE_SCRIPTING
+  // Activation events, e.g.
+  // "activationEvents": [ "onCommand:MyCommand", "onFileType:png" ]
+  auto activationEvents = json["activationEvents"];
+  if (activationEvents.is_array()) {
+    for (const auto& event : activationEvents.array_items()) {
+      std::string eventName = event.string_value();
+      if (eventName.empty())
+        continue;
+
+      LOG("EXT: New activation event %s\n", eventName.c_str());
+
+      extension->addActivationEvent(eventName);
+    }
+  }
+#endif // ENABLE_SCRIPTING
+
   if (extension)
     m_extensions.push_back(extension.get());
   return extension.release();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2023  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2017-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,11 +9,15 @@
 #define APP_EXTENSIONS_H_INCLUDED
 #pragma once
 
+#include "app/context_observer.h"
+#include "app/docs_observer.h"
 #include "app/i18n/lang_info.h"
+#include "obs/connection.h"
 #include "obs/signal.h"
 #include "render/dithering_matrix.h"
 
 #include <map>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -141,6 +145,21 @@ namespace app {
 #ifdef ENABLE_SCRIPTING
     bool hasScripts() const { return !m_plugin.scripts.empty(); }
     void addScript(const std::string& fn);
+
+    // Activation events from the "activationEvents" field of the
+    // package.json file ("onCommand:<id>", "onFileType:<ext>",
+    // "onEvent:<name>", or "*"). Scripts of an extension without
+    // activation events (or with "*") are initialized at startup,
+    // in other case they are initialized when the first event is
+    // received (see Extensions::activateExtensions()).
+    void addActivationEvent(const std::string& event);
+    bool hasActivationEvent(const std::string& event) const;
+    bool activatesOnStartup() const;
+    bool isActive() const { return m_isActive; }
+
+    // Initializes the scripts of the extension if they weren't
+    // initialized yet.
+    void activate();
 #endif
 
     bool isCurrentTheme() const;
@@ -155,6 +174,7 @@ namespace app {
 #ifdef ENABLE_SCRIPTING
     void initScripts();
     void exitScripts();
+    std::string chunkCachePath() const;
 #endif
 
     ExtensionItems m_keys;
@@ -180,6 +200,8 @@ namespace app {
       std::vector<ScriptItem> scripts;
       std::vector<PluginItem> items;
     } m_plugin;
+    std::set<std::string> m_activationEvents;
+    bool m_isActive = false;
 #endif
 
     std::string m_path;
@@ -192,7 +214,8 @@ namespace app {
     bool m_isBuiltinExtension;
   };
 
-  class Extensions {
+  class Extensions : private DocsObserver
+                   , private ContextObserver {
   public:
     typedef std::vector<Extension*> List;
     typedef List::iterator iterator;
@@ -203,6 +226,10 @@ namespace app {
     void executeInitActions();
     void executeExitActions();
 
+    // Activates the enabled extensions that are waiting for the given
+    // activation event (e.g. "onCommand:<id>").
+    void activateExtensions(const std::string& event);
+
     iterator begin() { return m_extensions.begin(); }
     iterator end() { return m_extensions.end(); }
 
@@ -229,6 +256,12 @@ namespace app {
     obs::signal<void(Extension*)> ScriptsChange;
 
   private:
+    // DocsObserver impl
+    void onAddDocument(Doc* doc) override;
+
+    // ContextObserver impl
+    void onActiveSiteChange(const Site& site) override;
+
     Extension* loadExtension(const std::string& path,
                              const std::string& fullPackageFilename,
                              const bool isBuiltinExtension);
@@ -236,6 +269,9 @@ namespace app {
 
     List m_extensions;
     std::string m_userExtensionsPath;
+    obs::scoped_connection m_beforeCmdConn;
+    obs::scoped_connection m_afterCmdConn;
+    bool m_observing = false;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -36,7 +36,10 @@ void ExtraCel::create(const TilemapMode tilemapMode,
   else
     pixelFormat = sprite->pixelFormat();
 
+  // The image of a TRANSFORM extra cel is not ours (it's the
+  // original image), so we cannot reuse it
   if (!m_image ||
+      m_type == render::ExtraType::TRANSFORM ||
       m_image->pixelFormat() != pixelFormat ||
       m_image->width() != imageSize.w ||
       m_image->height() != imageSize.h) {
@@ -56,6 +59,32 @@ void ExtraCel::create(const TilemapMode tilemapMode,
   m_cel->setBounds(bounds);
   m_cel->setOpacity(opacity);
   m_cel->setFrame(frame);
+
+  m_transformMask.reset();
+  m_transform = render::ExtraTransform();
+}
+
+void ExtraCel::createTransform(const doc::ImageRef& image,
+                               const doc::ImageRef& mask,
+                               const render::ExtraTransform& transform,
+                               const gfx::Rect& bounds,
+                               const doc::frame_t frame,
+                               const int opacity)
+{
+  ASSERT(image);
+
+  m_type = render::ExtraType::TRANSFORM;
+  m_image = image;
+  m_transformMask = mask;
+  m_transform = transform;
+  m_transform.mask = mask.get();
+
+  if (!m_cel)
+    m_cel.reset(new doc::Cel(doc::frame_t(0), doc::ImageRef(nullptr)));
+
+  m_cel->setBounds(bounds);
+  m_cel->setOpacity(opacity);
+  m_cel->setFrame(frame);
 }
 
 void ExtraCel::reset()
@@ -63,6 +92,8 @@ void ExtraCel::reset()
   m_type = render::ExtraType::NONE;
   m_image.reset();
   m_cel.reset();
+  m_transformMask.reset();
+  m_transform = render::ExtraTransform();
 }
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -37,6 +37,17 @@ namespace app {
                 const gfx::Size& imageSize,
                 const doc::frame_t frame,
                 const int opacity);
+
+    // Uses the given image (without copying it) as an
+    // ExtraType::TRANSFORM extra cel, i.e. the image is drawn by the
+    // renderer transformed to the given parallelogram. The "bounds"
+    // are the bounds of the parallelogram in the sprite.
+    void createTransform(const doc::ImageRef& image,
+                         const doc::ImageRef& mask,
+                         const render::ExtraTransform& transform,
+                         const gfx::Rect& bounds,
+                         const doc::frame_t frame,
+                         const int opacity);
     void reset();
 
     render::ExtraType type() const { return m_type; }
@@ -44,6 +55,7 @@ namespace app {
 
     doc::Cel* cel() const { return m_cel.get(); }
     doc::Image* image() const { return m_image.get(); }
+    const render::ExtraTransform& transform() const { return m_transform; }
 
     doc::BlendMode blendMode() const { return m_blendMode; }
     void setBlendMode(doc::BlendMode mode) { m_blendMode = mode; }
@@ -55,6 +67,10 @@ namespace app {
     doc::ImageBufferPtr m_imageBuffer;
     doc::BlendMode m_blendMode;
 
+    // Mask used by m_transform (only for ExtraType::TRANSFORM)
+    doc::ImageRef m_transformMask;
+    render::ExtraTransform m_transform;
+
     DISABLE_COPYING(ExtraCel);
   };
 
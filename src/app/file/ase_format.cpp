@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,7 @@
 #include "config.h"
 #endif
 
+#include "app/console.h"
 #include "app/context.h"
 #include "app/doc.h"
 #include "app/file/file.h"
@@ -18,7 +19,9 @@
 #include "base/exception.h"
 #include "base/file_handle.h"
 #include "base/fs.h"
+#include "base/log.h"
 #include "base/mem_utils.h"
+#include "base/thread_pool.h"
 #include "dio/aseprite_common.h"
 #include "dio/aseprite_decoder.h"
 #include "dio/decode_delegate.h"
@@ -30,8 +33,13 @@
 #include "ver/info.h"
 #include "zlib.h"
 
+#include <condition_variable>
 #include <cstdio>
 #include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
 #include <variant>
 
 #define ASEFILE_TRACE(...) // TRACE(__VA_ARGS__)
@@ -88,6 +96,22 @@ public:
     return m_fop->config().cacheCompressedTilesets;
   }
 
+  bool cacheCompressedCels() const override {
+    return m_fop->config().cacheCompressedCels;
+  }
+
+  std::string lazyLoadCelsFilename() const override {
+    if (m_fop->config().lazyLoadCels)
+      return base::get_absolute_path(m_fop->filename());
+    return std::string();
+  }
+
+  std::function<void(const std::string&)> lazyLoadCelsErrorHandler() const override {
+    return [](const std::string& msg) {
+      Console::showException(base::Exception(msg));
+    };
+  }
+
 private:
   FileOp* m_fop;
   doc::Sprite* m_sprite;
@@ -144,6 +168,278 @@ public:
 
 } // anonymous namespace
 
+static void write_compressed_image(FILE* f,
+                                   ScanlinesGen* gen,
+                                   PixelFormat pixelFormat,
+                                   int compressionLevel,
+                                   base::buffer* compressedOutput = nullptr);
+
+namespace {
+
+// Finds cels with the same pixels, position, opacity, and user data
+// of a previous cel in the same layer (e.g. after duplicating frames),
+// so they are saved as linked cels (FileOpConfig::linkIdenticalCels)
+// instead of compressing and writing the same pixels again.
+class IdenticalCels {
+public:
+  IdenticalCels(FileOp* fop, const Sprite* sprite) {
+    if (!fop->config().linkIdenticalCels)
+      return;
+
+    for (const Layer* layer : sprite->allLayers()) {
+      // Reference layers are skipped because links share the
+      // precise bounds too
+      if (layer->isImage() && !layer->isReference())
+        collectCels(fop, static_cast<const LayerImage*>(layer));
+    }
+
+    if (!m_links.empty()) {
+      LOG("ASE: %d identical cels saved as links (%zu bytes of pixels)\n",
+          int(m_links.size()), m_savedBytes);
+    }
+  }
+
+  // Returns the previous cel that is identical to the given one (to
+  // save the given cel as a link to it), or nullptr.
+  const Cel* link(const Cel* cel) const {
+    auto it = m_links.find(cel);
+    return (it != m_links.end() ? it->second: nullptr);
+  }
+
+private:
+  void collectCels(FileOp* fop, const LayerImage* layer) {
+    std::unordered_multimap<uint32_t, const Cel*> hashes;
+
+    for (frame_t frame : fop->roi().framesSequence()) {
+      // Cels that are already links are saved as links anyway
+      const Cel* cel = layer->cel(frame);
+      if (!cel || cel->link())
+        continue;
+
+      const Image* image = cel->image();
+      if (!image)
+        continue;
+
+      const uint32_t hash = calculate_image_hash(image, image->bounds());
+      const auto range = hashes.equal_range(hash);
+      auto it = range.first;
+      for (; it != range.second; ++it) {
+        if (isIdentical(it->second, cel))
+          break;
+      }
+
+      if (it != range.second) {
+        m_links[cel] = it->second;
+        m_savedBytes += std::size_t(image->rowBytes()) * image->height();
+      }
+      else {
+        hashes.emplace(hash, cel);
+      }
+    }
+  }
+
+  // The cel "b" can be loaded as a link to the cel "a" (see
+  // AsepriteDecoder::readCelChunk()).
+  static bool isIdentical(const Cel* a, const Cel* b) {
+    return (a->frame() < b->frame() &&
+            a->position() == b->position() &&
+            a->opacity() == b->opacity() &&
+            a->data()->userData() == b->data()->userData() &&
+            is_same_image(a->image(), b->image()));
+  }
+
+  std::unordered_map<const Cel*, const Cel*> m_links;
+  std::size_t m_savedBytes = 0;
+};
+
+// Compresses the cel images in a thread pool in the same order they
+// are written in the file, a few images ahead of the writer, so the
+// compressed data is ready (or almost ready) when we need it.
+//
+// If it's enabled (FileOpConfig::cacheCompressedCels), the compressed
+// data is cached in each doc::CelData, so the next time we save the
+// file, only modified cels are compressed again. The cache is used
+// only with the default compression level.
+class CompressedCels {
+public:
+  CompressedCels(FileOp* fop, const Sprite* sprite,
+                 const IdenticalCels& identicalCels)
+    : m_level(fop->config().compressionLevel)
+    , m_cache(fop->config().cacheCompressedCels &&
+              m_level == Z_DEFAULT_COMPRESSION) {
+    for (frame_t frame : fop->roi().framesSequence())
+      collectCels(sprite->root(), frame, identicalCels);
+
+    const int threads = std::thread::hardware_concurrency();
+    if (threads < 2 || m_items.size() < 2 || m_totalBytes < kMinTotalBytes) {
+      // Not worth it, images are compressed in the writer thread
+      m_items.clear();
+      m_index.clear();
+      return;
+    }
+
+    m_pool = std::make_unique<base::thread_pool>(threads);
+    m_window = kImagesPerThread * threads;
+    scheduleNext();
+  }
+
+  ~CompressedCels() {
+    // Wait the compression of the scheduled images (e.g. if the
+    // saving process was stopped)
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this]{ return m_pending == 0; });
+  }
+
+  // zlib compression level
+  int level() const { return m_level; }
+
+  // Writes the compressed pixels of the cel image in the file.
+  // Returns false if the image must be compressed by the caller.
+  bool write(FILE* f, const Cel* cel) {
+    const CelData* celData = cel->data();
+    auto it = m_index.find(celData);
+    if (it == m_index.end()) {
+      if (!m_cache)
+        return false;
+
+      base::buffer tmp;
+      writeData(f, compress(celData, tmp));
+      return true;
+    }
+
+    const std::size_t i = it->second;
+    m_index.erase(it);
+
+    // In case that images were not written in the expected order
+    while (m_next <= i)
+      scheduleItem();
+
+    Item& item = m_items[i];
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [&item]{ return item.done; });
+    }
+    if (!item.error.empty())
+      throw base::Exception(item.error);
+
+    writeData(f, m_cache ? celData->compressedData(): item.data);
+
+    // Release memory and compress more images
+    base::buffer().swap(item.data);
+    ++m_written;
+    scheduleNext();
+    return true;
+  }
+
+private:
+  // Minimum total of pixel data to use the thread pool
+  static constexpr std::size_t kMinTotalBytes = 256*1024;
+
+  // Maximum number of images compressed ahead of the writer (by
+  // thread) to limit the memory used by compressed buffers
+  static constexpr int kImagesPerThread = 4;
+
+  struct Item {
+    const CelData* celData;
+    base::buffer data;
+    std::string error;
+    bool done = false;
+  };
+
+  void collectCels(const Layer* layer, const frame_t frame,
+                   const IdenticalCels& identicalCels) {
+    if (layer->isImage()) {
+      // Only the first cel of linked/identical cels is written with
+      // pixels
+      const Cel* cel = layer->cel(frame);
+      if (cel && !identicalCels.link(cel)) {
+        const CelData* celData = cel->data();
+        const Image* image = celData->image();
+        if (image && m_index.find(celData) == m_index.end()) {
+          m_index[celData] = m_items.size();
+          m_items.push_back(Item{ celData });
+          m_totalBytes += std::size_t(image->widthBytes()) * image->height();
+        }
+      }
+    }
+    if (layer->isGroup()) {
+      for (const Layer* child : static_cast<const LayerGroup*>(layer)->layers())
+        collectCels(child, frame, identicalCels);
+    }
+  }
+
+  // Returns the compressed pixels of the cel image, from the cache
+  // of the CelData or compressing the image in "tmp".
+  const base::buffer& compress(const CelData* celData, base::buffer& tmp) const {
+    const Image* image = celData->image();
+    if (m_cache) {
+      if (!celData->hasCompressedData()) {
+        base::buffer data;
+        ImageScanlines scan(image);
+        write_compressed_image(nullptr, &scan, image->pixelFormat(), m_level, &data);
+        celData->setCompressedData(std::move(data));
+      }
+      return celData->compressedData();
+    }
+    ImageScanlines scan(image);
+    write_compressed_image(nullptr, &scan, image->pixelFormat(), m_level, &tmp);
+    return tmp;
+  }
+
+  static void writeData(FILE* f, const base::buffer& data) {
+    if (!data.empty() &&
+        ((fwrite(&data[0], 1, data.size(), f) != data.size())
+         || ferror(f)))
+      throw base::Exception("Error writing compressed image pixels.\n");
+  }
+
+  void scheduleNext() {
+    while (m_next < m_items.size() &&
+           m_next < m_written + m_window)
+      scheduleItem();
+  }
+
+  void scheduleItem() {
+    Item* item = &m_items[m_next++];
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool->execute([this, item]{
+      base::buffer data;
+      std::string error;
+      try {
+        compress(item->celData, data);
+      }
+      catch (const std::exception& ex) {
+        error = ex.what();
+      }
+
+      const std::lock_guard lock(m_mutex);
+      item->data = std::move(data);
+      item->error = std::move(error);
+      item->done = true;
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  const int m_level;
+  const bool m_cache;
+  std::vector<Item> m_items;
+  std::unordered_map<const CelData*, std::size_t> m_index;
+  std::size_t m_totalBytes = 0;
+  std::size_t m_next = 0;
+  std::size_t m_written = 0;
+  std::size_t m_window = 0;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  int m_pending = 0;
+  std::unique_ptr<base::thread_pool> m_pool;
+};
+
+} // anonymous namespace
+
 static void ase_file_prepare_header(FILE* f, dio::AsepriteHeader* header, const Sprite* sprite,
                                     const frame_t firstFrame, const frame_t totalFrames);
 static void ase_file_write_header(FILE* f, dio::AsepriteHeader* header);
@@ -161,7 +457,9 @@ static layer_t ase_file_write_cels(FILE* f,  FileOp* fop,
                                    const dio::AsepriteExternalFiles& ext_files,
                                    const Sprite* sprite, const Layer* layer,
                                    layer_t layer_index,
-                                   const frame_t frame);
+                                   const frame_t frame,
+                                   const IdenticalCels* identicalCels,
+                                   CompressedCels* compressedCels);
 
 static void ase_file_write_padding(FILE* f, int bytes);
 static void ase_file_write_string(FILE* f, const std::string& string);
@@ -177,7 +475,9 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
                                      const LayerImage* layer,
                                      const layer_t layer_index,
                                      const Sprite* sprite,
-                                     const frame_t firstFrame);
+                                     const frame_t firstFrame,
+                                     const IdenticalCels* identicalCels,
+                                     CompressedCels* compressedCels);
 static void ase_file_write_cel_extra_chunk(FILE* f, dio::AsepriteFrameHeader* frame_header,
                                            const Cel* cel);
 static void ase_file_write_color_profile(FILE* f,
@@ -280,12 +580,25 @@ FileFormat* CreateAseFormat()
 
 bool AseFormat::onLoad(FileOp* fop)
 {
-  FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
-  dio::StdioFileInterface fileInterface(handle.get());
+  FileHandle handle;
+  std::unique_ptr<dio::FileInterface> fileInterface;
+
+  // Map the file in memory so the decoder can read it without
+  // copying its bytes (e.g. compressed cels are inflated directly
+  // from the mapped memory)
+  if (fop->config().memoryMappedFiles) {
+    auto mmapFile = std::make_unique<dio::MmapFileInterface>(fop->filename());
+    if (mmapFile->isMapped())
+      fileInterface = std::move(mmapFile);
+  }
+  if (!fileInterface) {
+    handle = open_file_with_exception(fop->filename(), "rb");
+    fileInterface = std::make_unique<dio::StdioFileInterface>(handle.get());
+  }
 
   DecodeDelegate delegate(fop);
   dio::AsepriteDecoder decoder;
-  decoder.initialize(&delegate, &fileInterface);
+  decoder.initialize(&delegate, fileInterface.get());
   if (!decoder.decode())
     return false;
 
@@ -353,6 +666,10 @@ bool AseFormat::onSave(FileOp* fop)
                           fop->roi().frames());
   ase_file_write_header(f, &header);
 
+  // Compress the cel images in parallel while we write the file
+  IdenticalCels identicalCels(fop, sprite);
+  CompressedCels compressedCels(fop, sprite, identicalCels);
+
   bool require_new_palette_chunk = false;
   for (Palette* pal : sprite->getPalettes()) {
     if (pal->size() > 256 || pal->hasAlpha()) {
@@ -440,7 +757,7 @@ bool AseFormat::onSave(FileOp* fop)
     // Write cel chunks
     ase_file_write_cels(f, fop, &frame_header, ext_files,
                         sprite, sprite->root(),
-                        0, frame);
+                        0, frame, &identicalCels, &compressedCels);
 
     // Write the frame header
     ase_file_write_frame_header(f, &frame_header);
@@ -588,19 +905,23 @@ static layer_t ase_file_write_cels(FILE* f, FileOp* fop,
                                    const dio::AsepriteExternalFiles& ext_files,
                                    const Sprite* sprite, const Layer* layer,
                                    layer_t layer_index,
-                                   const frame_t frame)
+                                   const frame_t frame,
+                                   const IdenticalCels* identicalCels,
+                                   CompressedCels* compressedCels)
 {
   if (layer->isImage()) {
     const Cel* cel = layer->cel(frame);
     if (cel) {
       ase_file_write_cel_chunk(f, frame_header, cel,
                                static_cast<const LayerImage*>(layer),
-                               layer_index, sprite, fop->roi().fromFrame());
+                               layer_index, sprite, fop->roi().fromFrame(),
+                               identicalCels, compressedCels);
 
       if (layer->isReference())
         ase_file_write_cel_extra_chunk(f, frame_header, cel);
 
       if (!cel->link() &&
+          !identicalCels->link(cel) &&
           !cel->data()->userData().isEmpty()) {
         ase_file_write_user_data_chunk(f, fop, frame_header, ext_files,
                                        &cel->data()->userData());
@@ -615,7 +936,7 @@ static layer_t ase_file_write_cels(FILE* f, FileOp* fop,
     for (const Layer* child : static_cast<const LayerGroup*>(layer)->layers()) {
       layer_index =
         ase_file_write_cels(f, fop, frame_header, ext_files, sprite, child,
-                            layer_index, frame);
+                            layer_index, frame, identicalCels, compressedCels);
     }
   }
 
@@ -869,6 +1190,7 @@ static void write_raw_image(FILE* f, ScanlinesGen* gen, PixelFormat pixelFormat)
 template<typename ImageTraits>
 static void write_compressed_image_templ(FILE* f,
                                          ScanlinesGen* gen,
+                                         const int compressionLevel,
                                          base::buffer* compressedOutput)
 {
   PixelIO<ImageTraits> pixel_io;
@@ -878,7 +1200,7 @@ static void write_compressed_image_templ(FILE* f,
   zstream.zalloc = (alloc_func)0;
   zstream.zfree  = (free_func)0;
   zstream.opaque = (voidpf)0;
-  err = deflateInit(&zstream, Z_DEFAULT_COMPRESSION);
+  err = deflateInit(&zstream, compressionLevel);
   if (err != Z_OK)
     throw base::Exception("ZLib error %d in deflateInit().", err);
 
@@ -907,8 +1229,10 @@ static void write_compressed_image_templ(FILE* f,
 
       int output_bytes = compressed.size() - zstream.avail_out;
       if (output_bytes > 0) {
-        if ((fwrite(&compressed[0], 1, output_bytes, f) != (size_t)output_bytes)
-            || ferror(f))
+        // "f" can be nullptr to compress the image in memory only
+        if (f &&
+            ((fwrite(&compressed[0], 1, output_bytes, f) != (size_t)output_bytes)
+             || ferror(f)))
           throw base::Exception("Error writing compressed image pixels.\n");
 
         // Save the whole compressed buffer to re-use in following
@@ -933,23 +1257,24 @@ static void write_compressed_image_templ(FILE* f,
 static void write_compressed_image(FILE* f,
                                    ScanlinesGen* gen,
                                    PixelFormat pixelFormat,
-                                   base::buffer* compressedOutput = nullptr)
+                                   int compressionLevel,
+                                   base::buffer* compressedOutput)
 {
   switch (pixelFormat) {
     case IMAGE_RGB:
-      write_compressed_image_templ<RgbTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<RgbTraits>(f, gen, compressionLevel, compressedOutput);
       break;
 
     case IMAGE_GRAYSCALE:
-      write_compressed_image_templ<GrayscaleTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<GrayscaleTraits>(f, gen, compressionLevel, compressedOutput);
       break;
 
     case IMAGE_INDEXED:
-      write_compressed_image_templ<IndexedTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<IndexedTraits>(f, gen, compressionLevel, compressedOutput);
       break;
 
     case IMAGE_TILEMAP:
-      write_compressed_image_templ<TilemapTraits>(f, gen, compressedOutput);
+      write_compressed_image_templ<TilemapTraits>(f, gen, compressionLevel, compressedOutput);
       break;
   }
 }
@@ -963,11 +1288,15 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
                                      const LayerImage* layer,
                                      const layer_t layer_index,
                                      const Sprite* sprite,
-                                     const frame_t firstFrame)
+                                     const frame_t firstFrame,
+                                     const IdenticalCels* identicalCels,
+                                     CompressedCels* compressedCels)
 {
   ChunkWriter chunk(f, frame_header, ASE_FILE_CHUNK_CEL);
 
   const Cel* link = cel->link();
+  if (!link)
+    link = identicalCels->link(cel);
 
   // In case the original link is outside the ROI, we've to find the
   // first linked cel that is inside the ROI.
@@ -1029,8 +1358,11 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
         fputw(image->width(), f);
         fputw(image->height(), f);
 
-        ImageScanlines scan(image);
-        write_compressed_image(f, &scan, image->pixelFormat());
+        if (!compressedCels->write(f, cel)) {
+          ImageScanlines scan(image);
+          write_compressed_image(f, &scan, image->pixelFormat(),
+                                 compressedCels->level());
+        }
       }
       else {
         // Width and height
@@ -1054,8 +1386,11 @@ static void ase_file_write_cel_chunk(FILE* f, dio::AsepriteFrameHeader* frame_he
       fputl(tile_f_dflip, f);
       ase_file_write_padding(f, 10);
 
-      ImageScanlines scan(image);
-      write_compressed_image(f, &scan, IMAGE_TILEMAP);
+      if (!compressedCels->write(f, cel)) {
+        ImageScanlines scan(image);
+        write_compressed_image(f, &scan, IMAGE_TILEMAP,
+                               compressedCels->level());
+      }
     }
   }
 }
@@ -1478,8 +1813,11 @@ static void ase_file_write_tileset_chunk(FILE* f, FileOp* fop,
   if (flags & ASE_TILESET_FLAG_EMBEDDED) {
     size_t beg = ftell(f);
 
-    // Save the cached tileset compressed data
-    if (!tileset->compressedData().empty() &&
+    // Save the cached tileset compressed data (it's compressed with
+    // the default level)
+    const int level = fop->config().compressionLevel;
+    if (level == Z_DEFAULT_COMPRESSION &&
+        !tileset->compressedData().empty() &&
         tileset->compressedDataVersion() == tileset->version()) {
       const base::buffer& data = tileset->compressedData();
 
@@ -1498,11 +1836,12 @@ static void ase_file_write_tileset_chunk(FILE* f, FileOp* fop,
 
       base::buffer compressedData;
       base::buffer* compressedDataPtr = nullptr;
-      if (fop->config().cacheCompressedTilesets)
+      if (fop->config().cacheCompressedTilesets &&
+          level == Z_DEFAULT_COMPRESSION)
         compressedDataPtr = &compressedData;
 
       write_compressed_image(f, &gen, tileset->sprite()->pixelFormat(),
-                             compressedDataPtr);
+                             level, compressedDataPtr);
 
       // As we've just compressed the tileset, we can cache this same
       // data (so saving the file again will not need recompressing).
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "config.h"
 #endif
 
+#include "app/file/bmp_pixels.h"
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
@@ -24,6 +25,9 @@
 #include "doc/doc.h"
 #include "fmt/format.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 // Max supported .bmp size (to filter out invalid image sizes)
@@ -75,7 +79,8 @@ class BmpFormat : public FileFormat {
       FILE_SUPPORT_GRAY |
       FILE_SUPPORT_INDEXED |
       FILE_SUPPORT_SEQUENCES |
-      FILE_ENCODE_ABSTRACT_IMAGE;
+      FILE_ENCODE_ABSTRACT_IMAGE |
+      FILE_ENCODE_SCANLINES;
   }
 
   bool onLoad(FileOp* fop) override;
@@ -508,198 +513,48 @@ static void read_bmicolors(FileOp* fop, int bytes, FILE *f, bool win_flag)
     fgetc(f);
 }
 
-/* read_1bit_line:
- *  Support function for reading the 1 bit bitmap file format.
- */
-static void read_1bit_line(int length, FILE *f, Image *image, int line)
-{
-  unsigned char b[32];
-  unsigned long n;
-  int i, j, k;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 32;
-    if (j == 0) {
-      n = fgetl(f);
-      n =
-        ((n&0x000000ff)<<24) |
-        ((n&0x0000ff00)<< 8) |
-        ((n&0x00ff0000)>> 8) |
-        ((n&0xff000000)>>24);
-      for (k=0; k<32; k++) {
-        b[31-k] = (char)(n & 1);
-        n = n >> 1;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
-}
-
-/* read_2bit_line (not standard):
- *  Support function for reading the 2 bit bitmap file format.
- */
-static void read_2bit_line(int length, FILE *f, Image *image, int line)
-{
-  unsigned char b[16];
-  unsigned long n;
-  int i, j, k;
-  int temp;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 16;
-    if (j == 0) {
-      n = fgetl(f);
-      for (k=0; k<4; k++) {
-        temp = n & 255;
-        b[k*4+3] = temp & 3;
-        temp = temp >> 2;
-        b[k*4+2] = temp & 3;
-        temp = temp >> 2;
-        b[k*4+1] = temp & 3;
-        temp = temp >> 2;
-        b[k*4] = temp & 3;
-        n = n >> 8;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
-}
-
-/* read_4bit_line:
- *  Support function for reading the 4 bit bitmap file format.
- */
-static void read_4bit_line(int length, FILE *f, Image *image, int line)
-{
-  unsigned char b[8];
-  unsigned long n;
-  int i, j, k;
-  int temp;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 8;
-    if (j == 0) {
-      n = fgetl(f);
-      for (k=0; k<4; k++) {
-        temp = n & 255;
-        b[k*2+1] = temp & 15;
-        temp = temp >> 4;
-        b[k*2] = temp & 15;
-        n = n >> 8;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
-}
-
-/* read_8bit_line:
- *  Support function for reading the 8 bit bitmap file format.
- */
-static void read_8bit_line(int length, FILE *f, Image *image, int line)
-{
-  unsigned char b[4];
-  unsigned long n;
-  int i, j, k;
-  int pix;
-
-  for (i=0; i<length; i++) {
-    j = i % 4;
-    if (j == 0) {
-      n = fgetl(f);
-      for (k=0; k<4; k++) {
-        b[k] = (char)(n & 255);
-        n = n >> 8;
-      }
-    }
-    pix = b[j];
-    put_pixel(image, i, line, pix);
-  }
-}
-
-static void read_16bit_line(int length, FILE *f, Image *image, int line, bool& withAlpha)
-{
-  int i, r, g, b, a, word;
-
-  for (i=0; i<length; i++) {
-    word = fgetw(f);
-
-    r = (word >> 10) & 0x1f;
-    g = (word >> 5) & 0x1f;
-    b = (word) & 0x1f;
-    a = (word & 0x8000 ? 255 : 0);
-    if (a)
-      withAlpha = true;
-    put_pixel(image, i, line,
-              rgba(scale_5bits_to_8bits(r),
-                   scale_5bits_to_8bits(g),
-                   scale_5bits_to_8bits(b), a));
-  }
-
-  i = (2*i) % 4;
-  if (i > 0)
-    while (i++ < 4)
-      fgetc(f);
-}
-
-static void read_24bit_line(int length, FILE *f, Image *image, int line)
-{
-  int i, r, g, b;
-
-  for (i=0; i<length; i++) {
-    b = fgetc(f);
-    g = fgetc(f);
-    r = fgetc(f);
-    put_pixel(image, i, line, rgba(r, g, b, 255));
-  }
-
-  i = (3*i) % 4;
-  if (i > 0)
-    while (i++ < 4)
-      fgetc(f);
-}
-
-static void read_32bit_line(int length, FILE *f, Image *image, int line,
-                            bool& withAlpha)
-{
-  int i, r, g, b, a;
-
-  for (i=0; i<length; i++) {
-    b = fgetc(f);
-    g = fgetc(f);
-    r = fgetc(f);
-    a = fgetc(f);
-    if (a)
-      withAlpha = true;
-    put_pixel(image, i, line, rgba(r, g, b, a));
-  }
-}
-
 /* read_image:
- *  For reading the noncompressed BMP image format.
+ *  For reading the noncompressed BMP image format. Each row is read
+ *  with one fread() call and then converted to the image pixels.
  */
 static void read_image(FILE *f, Image *image, const BITMAPINFOHEADER *infoheader, FileOp *fop, bool& withAlpha)
 {
   int i, line, height, dir;
+  const int width = infoheader->biWidth;
+  const int bpp = infoheader->biBitCount;
 
   height = (int)infoheader->biHeight;
   line   = height < 0 ? 0: height-1;
   dir    = height < 0 ? 1: -1;
   height = ABS(height);
 
+  std::vector<uint8_t> row(bmp::row_size(width, bpp));
+
   for (i=0; i<height; i++, line+=dir) {
-    switch (infoheader->biBitCount) {
-      case 1: read_1bit_line(infoheader->biWidth, f, image, line); break;
-      case 2: read_2bit_line(infoheader->biWidth, f, image, line); break;
-      case 4: read_4bit_line(infoheader->biWidth, f, image, line); break;
-      case 8: read_8bit_line(infoheader->biWidth, f, image, line); break;
-      case 16: read_16bit_line(infoheader->biWidth, f, image, line, withAlpha); break;
-      case 24: read_24bit_line(infoheader->biWidth, f, image, line); break;
-      case 32: read_32bit_line(infoheader->biWidth, f, image, line, withAlpha); break;
+    // Rows of truncated files are filled with zeros
+    const size_t n = fread(row.data(), 1, row.size(), f);
+    if (n < row.size())
+      std::fill(row.begin()+n, row.end(), 0);
+
+    uint8_t* dst = image->getPixelAddress(0, line);
+    switch (bpp) {
+      case 1:
+      case 2:
+      case 4:
+      case 8:
+        bmp::unpack_indexes(row.data(), dst, width, bpp);
+        break;
+      case 16:
+        if (bmp::rgb555_to_rgba(row.data(), (uint32_t*)dst, width))
+          withAlpha = true;
+        break;
+      case 24:
+        bmp::bgr_to_rgba(row.data(), (uint32_t*)dst, width);
+        break;
+      case 32:
+        if (bmp::bgra_to_rgba(row.data(), (uint32_t*)dst, width))
+          withAlpha = true;
+        break;
     }
 
     fop->setProgress((float)(i+1) / (float)(height));
@@ -908,6 +763,7 @@ static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infohea
   int i, j, k, line, height, dir, r, g, b, a;
   int bits_per_pixel;
   int bytes_per_pixel;
+  const int width = infoheader->biWidth;
 
   height = (int)infoheader->biHeight;
   line   = height < 0 ? 0: height-1;
@@ -925,12 +781,33 @@ static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infohea
   bytes_per_pixel = ((bits_per_pixel / 8) +
                      ((bits_per_pixel % 8) > 0 ? 1: 0));
 
+  // BGRA with 8 bits per component can be converted with a swizzle
+  const bool bgra =
+    (bits_per_pixel == 32 &&
+     rmask == 0x00ff0000 && gmask == 0x0000ff00 &&
+     bmask == 0x000000ff && amask == 0xff000000);
+
+  std::vector<uint8_t> row(bmp::row_size(width, 8*bytes_per_pixel));
+
   for (i=0; i<height; i++, line+=dir) {
-    for (j=0; j<(int)infoheader->biWidth; j++) {
+    // Rows of truncated files are filled with zeros
+    const size_t n = fread(row.data(), 1, row.size(), f);
+    if (n < row.size())
+      std::fill(row.begin()+n, row.end(), 0);
+
+    auto dst = (uint32_t*)image->getPixelAddress(0, line);
+    if (bgra) {
+      if (bmp::bgra_to_rgba(row.data(), dst, width))
+        withAlpha = true;
+      continue;
+    }
+
+    const uint8_t* src = row.data();
+    for (j=0; j<width; j++, src+=bytes_per_pixel) {
       /* read the DWORD, WORD or BYTE in little-endian order */
       buffer = 0;
       for (k=0; k<bytes_per_pixel; k++)
-        buffer |= fgetc(f) << (k<<3);
+        buffer |= uint32_t(src[k]) << (k<<3);
 
       r = (buffer & rmask) >> rshift;
       g = (buffer & gmask) >> gshift;
@@ -944,13 +821,8 @@ static int read_bitfields_image(FILE *f, Image *image, BITMAPINFOHEADER *infohea
 
       if (a)
         withAlpha = true;
-      put_pixel_fast<RgbTraits>(image, j, line, rgba(r, g, b, a));
+      *(dst++) = rgba(r, g, b, a);
     }
-
-    j = (bytes_per_pixel*j) % 4;
-    if (j > 0)
-      while (j++ < 4)
-        fgetc(f);
   }
 
   if (!withAlpha) {
@@ -1205,7 +1077,7 @@ bool BmpFormat::onSave(FileOp *fop)
   }
 
   int filler = int((32 - ((w*bpp-1) & 31)-1) / 8);
-  int c, i, j, r, g, b;
+  int i, j, r, g, b;
 
   if (bpp <= 8) {
     biSizeImage = (w + filler)*bpp/8 * h;
@@ -1285,55 +1157,33 @@ bool BmpFormat::onSave(FileOp *fop)
     }
   }
 
-  // Only used in indexed mode
-  int colorsPerByte = std::max(1, 8/bpp);
-  int colorMask;
-  switch (bpp) {
-    case 8: colorMask = 0xFF; break;
-    case 4: colorMask = 0x0F; break;
-    case 1: colorMask = 0x01; break;
-    default: colorMask = 0; break;
-  }
-
-  // Save image pixels (from bottom to top)
+  // Save image pixels (from bottom to top), each row is converted
+  // in a buffer (with the filler bytes = 0) and written with one
+  // fwrite() call.
+  std::vector<uint8_t> row(bmp::row_size(w, bpp), 0);
   for (i=h-1; i>=0; i--) {
     switch (spec.colorMode()) {
       case ColorMode::RGB: {
         auto scanline = (const uint32_t*)img->getScanline(i);
-        for (j=0; j<w; ++j) {
-          c = scanline[j];
-          fputc(rgba_getb(c), f);
-          fputc(rgba_getg(c), f);
-          fputc(rgba_getr(c), f);
-          if (withAlpha)
-            fputc(rgba_geta(c), f);
-        }
+        if (withAlpha)
+          bmp::rgba_to_bgra(scanline, row.data(), w);
+        else
+          bmp::rgba_to_bgr(scanline, row.data(), w);
         break;
       }
       case ColorMode::GRAYSCALE: {
         auto scanline = (const uint16_t*)img->getScanline(i);
-        for (j=0; j<w; ++j) {
-          c = scanline[j];
-          fputc(graya_getv(c), f);
-        }
+        for (j=0; j<w; ++j)
+          row[j] = graya_getv(scanline[j]);
         break;
       }
       case ColorMode::INDEXED: {
         auto scanline = (const uint8_t*)img->getScanline(i);
-        for (j=0; j<w; ) {
-          uint8_t value = 0;
-          for (int k=colorsPerByte-1; k>=0 && j<w; --k, ++j) {
-            c = scanline[j];
-            value |= (c & colorMask) << (bpp*k);
-          }
-          fputc(value, f);
-        }
+        bmp::pack_indexes(scanline, row.data(), w, bpp);
         break;
       }
     }
-
-    for (j=0; j<filler; j++)
-      fputc(0, f);
+    fwrite(row.data(), 1, row.size(), f);
 
     fop->setProgress((float)(h-i) / (float)h);
   }
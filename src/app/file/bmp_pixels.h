@@ -0,0 +1,186 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_FILE_BMP_PIXELS_H_INCLUDED
+#define APP_FILE_BMP_PIXELS_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+#include "doc/color_scales.h"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define APP_BMP_PIXELS_NEON 1
+#elif defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define APP_BMP_PIXELS_SSE2 1
+#endif
+
+// Conversion of rows of BMP/ICO pixels (BGR/BGRA bytes, or 16-bit
+// words) from/to rows of RGB doc::Image pixels, so the file formats
+// can read/write a whole row with one fread()/fwrite() call.
+
+namespace app {
+namespace bmp {
+
+  // Number of bytes of each row in the file (rows are 32-bit aligned)
+  inline int row_size(int width, int bpp) {
+    return ((width*bpp + 31) / 32) * 4;
+  }
+
+#if APP_BMP_PIXELS_SSE2
+  // Swaps the R and B components of 4 pixels (BGRA <-> RGBA)
+  inline __m128i swap_rb128(__m128i v) {
+    const __m128i ga = _mm_set1_epi32(int(0xff00ff00));
+    const __m128i rb = _mm_andnot_si128(ga, v);
+    return _mm_or_si128(_mm_and_si128(v, ga),
+                        _mm_or_si128(_mm_slli_epi32(rb, 16),
+                                     _mm_srli_epi32(rb, 16)));
+  }
+#endif
+
+  // 24-bit BGR -> RGB image pixels (opaque)
+  inline void bgr_to_rgba(const uint8_t* src, uint32_t* dst, int n) {
+    int i = 0;
+#if APP_BMP_PIXELS_NEON
+    const uint8x16_t alpha = vdupq_n_u8(255);
+    for (; i+16<=n; i+=16, src+=48, dst+=16) {
+      const uint8x16x3_t bgr = vld3q_u8(src);
+      uint8x16x4_t rgba;
+      rgba.val[0] = bgr.val[2];
+      rgba.val[1] = bgr.val[1];
+      rgba.val[2] = bgr.val[0];
+      rgba.val[3] = alpha;
+      vst4q_u8((uint8_t*)dst, rgba);
+    }
+#endif
+    for (; i<n; ++i, src+=3)
+      *(dst++) = doc::rgba(src[2], src[1], src[0], 255);
+  }
+
+  // 32-bit BGRA -> RGB image pixels. Returns true if some pixel has
+  // alpha != 0 (in other case the alpha channel is probably unused).
+  inline bool bgra_to_rgba(const uint8_t* src, uint32_t* dst, int n) {
+    int i = 0;
+    uint8_t alpha = 0;
+#if APP_BMP_PIXELS_NEON
+    uint8x16_t alphaAcc = vdupq_n_u8(0);
+    for (; i+16<=n; i+=16, src+=64, dst+=16) {
+      uint8x16x4_t v = vld4q_u8(src);
+      const uint8x16_t b = v.val[0];
+      v.val[0] = v.val[2];
+      v.val[2] = b;
+      alphaAcc = vorrq_u8(alphaAcc, v.val[3]);
+      vst4q_u8((uint8_t*)dst, v);
+    }
+    alpha = vmaxvq_u8(alphaAcc);
+#elif APP_BMP_PIXELS_SSE2
+    __m128i acc = _mm_setzero_si128();
+    for (; i+4<=n; i+=4, src+=16, dst+=4) {
+      const __m128i v = _mm_loadu_si128((const __m128i*)src);
+      acc = _mm_or_si128(acc, v);
+      _mm_storeu_si128((__m128i*)dst, swap_rb128(v));
+    }
+    acc = _mm_srli_epi32(acc, 24);
+    alpha = (_mm_movemask_epi8(_mm_cmpeq_epi32(acc, _mm_setzero_si128())) != 0xffff ? 1: 0);
+#endif
+    for (; i<n; ++i, src+=4) {
+      alpha |= src[3];
+      *(dst++) = doc::rgba(src[2], src[1], src[0], src[3]);
+    }
+    return (alpha != 0);
+  }
+
+  // 16-bit X1R5G5B5 (or A1R5G5B5) -> RGB image pixels. Returns true
+  // if some pixel has the alpha bit.
+  inline bool rgb555_to_rgba(const uint8_t* src, uint32_t* dst, int n) {
+    int alpha = 0;
+    for (int i=0; i<n; ++i, src+=2) {
+      const int word = src[0] | (src[1] << 8);
+      alpha |= word;
+      *(dst++) = doc::rgba(doc::scale_5bits_to_8bits((word >> 10) & 0x1f),
+                           doc::scale_5bits_to_8bits((word >> 5) & 0x1f),
+                           doc::scale_5bits_to_8bits(word & 0x1f),
+                           (word & 0x8000 ? 255: 0));
+    }
+    return ((alpha & 0x8000) != 0);
+  }
+
+  // RGB image pixels -> 24-bit BGR
+  inline void rgba_to_bgr(const uint32_t* src, uint8_t* dst, int n) {
+    for (int i=0; i<n; ++i, dst+=3) {
+      const uint32_t c = *(src++);
+      dst[0] = doc::rgba_getb(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getr(c);
+    }
+  }
+
+  // RGB image pixels -> 32-bit BGRA
+  inline void rgba_to_bgra(const uint32_t* src, uint8_t* dst, int n) {
+    int i = 0;
+#if APP_BMP_PIXELS_NEON
+    for (; i+16<=n; i+=16, src+=16, dst+=64) {
+      uint8x16x4_t v = vld4q_u8((const uint8_t*)src);
+      const uint8x16_t r = v.val[0];
+      v.val[0] = v.val[2];
+      v.val[2] = r;
+      vst4q_u8(dst, v);
+    }
+#elif APP_BMP_PIXELS_SSE2
+    for (; i+4<=n; i+=4, src+=4, dst+=16) {
+      const __m128i v = _mm_loadu_si128((const __m128i*)src);
+      _mm_storeu_si128((__m128i*)dst, swap_rb128(v));
+    }
+#endif
+    for (; i<n; ++i, dst+=4) {
+      const uint32_t c = *(src++);
+      dst[0] = doc::rgba_getb(c);
+      dst[1] = doc::rgba_getg(c);
+      dst[2] = doc::rgba_getr(c);
+      dst[3] = doc::rgba_geta(c);
+    }
+  }
+
+  // Unpacks 1/2/4/8-bit indexes (most significant bits first) into
+  // one byte per pixel.
+  inline void unpack_indexes(const uint8_t* src, uint8_t* dst, int n, int bpp) {
+    if (bpp == 8) {
+      std::copy(src, src+n, dst);
+      return;
+    }
+    const int perByte = 8 / bpp;
+    const int mask = (1 << bpp) - 1;
+    for (int i=0; i<n; ++src) {
+      const int byte = *src;
+      for (int k=perByte-1; k>=0 && i<n; --k, ++i)
+        *(dst++) = (byte >> (bpp*k)) & mask;
+    }
+  }
+
+  // Packs indexes into 1/2/4/8-bit values (the inverse of unpack_indexes())
+  inline void pack_indexes(const uint8_t* src, uint8_t* dst, int n, int bpp) {
+    if (bpp == 8) {
+      std::copy(src, src+n, dst);
+      return;
+    }
+    const int perByte = 8 / bpp;
+    const int mask = (1 << bpp) - 1;
+    for (int i=0; i<n; ++dst) {
+      int byte = 0;
+      for (int k=perByte-1; k>=0 && i<n; --k, ++i)
+        byte |= (*(src++) & mask) << (bpp*k);
+      *dst = byte;
+    }
+  }
+
+} // namespace bmp
+} // namespace app
+
+#endif
@@ -0,0 +1,104 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/file/bmp_pixels.h"
+
+#include <vector>
+
+using namespace app;
+
+// Sizes to test the SIMD loops and the remaining pixels
+static const int kSizes[] = { 0, 1, 3, 4, 5, 15, 16, 17, 33, 64, 67 };
+
+TEST(BmpPixels, BgraToRgba)
+{
+  for (int n : kSizes) {
+    std::vector<uint8_t> src(4*n);
+    for (int i=0; i<int(src.size()); ++i)
+      src[i] = uint8_t(i*37 + 5);
+
+    std::vector<uint32_t> dst(n);
+    bool alpha = false;
+    EXPECT_EQ(n > 0, bmp::bgra_to_rgba(src.data(), dst.data(), n));
+    for (int i=0; i<n; ++i) {
+      EXPECT_EQ(doc::rgba(src[4*i+2], src[4*i+1], src[4*i], src[4*i+3]), dst[i]);
+      alpha |= (src[4*i+3] != 0);
+    }
+    EXPECT_EQ(n > 0, alpha);
+
+    std::vector<uint8_t> back(4*n);
+    bmp::rgba_to_bgra(dst.data(), back.data(), n);
+    EXPECT_EQ(src, back);
+  }
+}
+
+TEST(BmpPixels, BgraWithoutAlpha)
+{
+  for (int n : kSizes) {
+    std::vector<uint8_t> src(4*n, 128);
+    for (int i=0; i<n; ++i)
+      src[4*i+3] = 0;
+
+    std::vector<uint32_t> dst(n);
+    EXPECT_FALSE(bmp::bgra_to_rgba(src.data(), dst.data(), n));
+  }
+}
+
+TEST(BmpPixels, BgrToRgba)
+{
+  for (int n : kSizes) {
+    std::vector<uint8_t> src(3*n);
+    for (int i=0; i<int(src.size()); ++i)
+      src[i] = uint8_t(i*11 + 3);
+
+    std::vector<uint32_t> dst(n);
+    bmp::bgr_to_rgba(src.data(), dst.data(), n);
+    for (int i=0; i<n; ++i)
+      EXPECT_EQ(doc::rgba(src[3*i+2], src[3*i+1], src[3*i], 255), dst[i]);
+
+    std::vector<uint8_t> back(3*n);
+    bmp::rgba_to_bgr(dst.data(), back.data(), n);
+    EXPECT_EQ(src, back);
+  }
+}
+
+TEST(BmpPixels, Rgb555ToRgba)
+{
+  const uint8_t src[] = { 0x1f, 0x7c,   // Red + Blue (no alpha bit)
+                          0xe0, 0x83 }; // Green + alpha bit
+  uint32_t dst[2];
+  EXPECT_TRUE(bmp::rgb555_to_rgba(src, dst, 2));
+  EXPECT_EQ(doc::rgba(255, 0, 255, 0), dst[0]);
+  EXPECT_EQ(doc::rgba(0, 255, 0, 255), dst[1]);
+
+  EXPECT_FALSE(bmp::rgb555_to_rgba(src, dst, 1));
+}
+
+TEST(BmpPixels, PackIndexes)
+{
+  for (int bpp : { 1, 2, 4, 8 }) {
+    for (int n : kSizes) {
+      std::vector<uint8_t> indexes(n);
+      for (int i=0; i<n; ++i)
+        indexes[i] = (i*7) & ((1 << bpp) - 1);
+
+      std::vector<uint8_t> packed(bmp::row_size(n, bpp));
+      bmp::pack_indexes(indexes.data(), packed.data(), n, bpp);
+
+      std::vector<uint8_t> unpacked(n);
+      bmp::unpack_indexes(packed.data(), unpacked.data(), n, bpp);
+      EXPECT_EQ(indexes, unpacked);
+    }
+  }
+
+  // Most significant bits first
+  const uint8_t indexes[] = { 1, 0, 1, 1 };
+  uint8_t packed = 0;
+  bmp::pack_indexes(indexes, &packed, 4, 1);
+  EXPECT_EQ(0xb0, packed);
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2018-2023  Igara Studio S.A.
+// Copyright (c) 2018-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -15,6 +15,7 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/pixel_rects.h"
 #include "app/pref/preferences.h"
 #include "base/convert_to.h"
 #include "base/cfile.h"
@@ -35,11 +36,13 @@ class CssFormat : public FileFormat {
   public:
     CssOptions() : pixelScale(1), gutterSize(0),
                    generateHtml(false),
-                   withVars(false) { }
+                   withVars(false),
+                   mergeRects(false) { }
     int pixelScale;
     int gutterSize;
     bool generateHtml;
     bool withVars;
+    bool mergeRects;
   };
 
   const char* onGetName() const override {
@@ -89,10 +92,14 @@ bool CssFormat::onLoad(FileOp* fop)
 bool CssFormat::onSave(FileOp* fop)
 {
   const ImageRef image = fop->sequenceImageToSave();
-  int x, y, c, r, g, b, a, alpha;
+  int y, r, g, b, a;
   const auto css_options = std::static_pointer_cast<CssOptions>(fop->formatOptions());
+  // Merged rectangles are painted with background layers instead of
+  // shadows (all shadows have the size of the .pixel-art element)
+  const bool merge = css_options->mergeRects;
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
+  setvbuf(f, nullptr, _IOFBF, kTextFormatBufferSize);
   auto print_color = [f](int r, int g, int b, int a) {
     if (a == 255) {
       fprintf(f, "#%02X%02X%02X", r, g, b);
@@ -121,6 +128,47 @@ bool CssFormat::onSave(FileOp* fop)
     fprintf(f, "\tcalc(%d*var(--shadow-mult)) calc(%d*var(--shadow-mult)) var(--blur) var(--spread) var(--color-%d)",
             x, y, i);
   };
+  auto print_length = [f, css_options](int v) {
+    if (css_options->withVars)
+      fprintf(f, "calc(%d*var(--pixel-size))", v);
+    else
+      fprintf(f, "%dpx", v * css_options->pixelScale);
+  };
+  // Prints the position/size of a background layer
+  auto print_layer_bounds = [f, print_length](const PixelRect& rc) {
+    fprintf(f, " ");
+    print_length(rc.x);
+    fprintf(f, " ");
+    print_length(rc.y);
+    fprintf(f, " / ");
+    print_length(rc.w);
+    fprintf(f, " ");
+    print_length(rc.h);
+    fprintf(f, " no-repeat");
+  };
+  auto print_rect_color = [&](const PixelRect& rc, int r, int g, int b, int a,
+                              bool comma) {
+    if (!merge) {
+      print_shadow_color(rc.x, rc.y, r, g, b, a, comma);
+      return;
+    }
+    fprintf(f, comma?",\n":"\n");
+    fprintf(f, "\tlinear-gradient(");
+    print_color(r, g, b, a);
+    fprintf(f, ", ");
+    print_color(r, g, b, a);
+    fprintf(f, ")");
+    print_layer_bounds(rc);
+  };
+  auto print_rect_index = [&](const PixelRect& rc, int i, bool comma) {
+    if (!merge) {
+      print_shadow_index(rc.x, rc.y, i, comma);
+      return;
+    }
+    fprintf(f, comma?",\n":"\n");
+    fprintf(f, "\tlinear-gradient(var(--color-%d), var(--color-%d))", i, i);
+    print_layer_bounds(rc);
+  };
   if (css_options->withVars) {
     fprintf(f, ":root {\n"
                "\t--blur: 0px;\n"
@@ -146,7 +194,14 @@ bool CssFormat::onSave(FileOp* fop)
   fprintf(f, "\tposition: relative;\n");
   fprintf(f, "\ttop: 0;\n");
   fprintf(f, "\tleft: 0;\n");
-  if (css_options->withVars) {
+  if (merge) {
+    fprintf(f, "\theight: ");
+    print_length(image->height());
+    fprintf(f, ";\n\twidth: ");
+    print_length(image->width());
+    fprintf(f, ";\n");
+  }
+  else if (css_options->withVars) {
     fprintf(f, "\theight: var(--pixel-size);\n");
     fprintf(f, "\twidth: var(--pixel-size);\n");
   }
@@ -154,37 +209,31 @@ bool CssFormat::onSave(FileOp* fop)
     fprintf(f, "\theight: %dpx;\n", css_options->pixelScale);
     fprintf(f, "\twidth: %dpx;\n", css_options->pixelScale);
   }
-  fprintf(f, "\tbox-shadow:\n");
+  fprintf(f, merge ? "\tbackground:": "\tbox-shadow:");
   int num_printed_pixels = 0;
   switch (image->pixelFormat()) {
     case IMAGE_RGB: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<RgbTraits>(image.get(), x, y);
-          alpha = rgba_geta(c);
-          if (alpha != 0x00) {
-            print_shadow_color(x, y, rgba_getr(c), rgba_getg(c), rgba_getb(c),
-                               alpha, num_printed_pixels>0);
-            num_printed_pixels ++;
-          }
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+      for_each_pixel_rect<RgbTraits>(
+        image.get(), merge,
+        [](color_t c){ return rgba_geta(c) != 0x00; },
+        [&](const PixelRect& rc){
+          print_rect_color(rc, rgba_getr(rc.color), rgba_getg(rc.color),
+                           rgba_getb(rc.color), rgba_geta(rc.color),
+                           num_printed_pixels>0);
+          num_printed_pixels ++;
+        }, fop);
       break;
     }
     case IMAGE_GRAYSCALE: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<GrayscaleTraits>(image.get(), x, y);
-          auto v = graya_getv(c);
-          alpha = graya_geta(c);
-          if (alpha != 0x00) {
-            print_shadow_color(x, y, v, v, v, alpha, num_printed_pixels>0);
-            num_printed_pixels ++;
-          }
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+      for_each_pixel_rect<GrayscaleTraits>(
+        image.get(), merge,
+        [](color_t c){ return graya_geta(c) != 0x00; },
+        [&](const PixelRect& rc){
+          const int v = graya_getv(rc.color);
+          print_rect_color(rc, v, v, v, graya_geta(rc.color),
+                           num_printed_pixels>0);
+          num_printed_pixels ++;
+        }, fop);
       break;
     }
     case IMAGE_INDEXED: {
@@ -202,29 +251,29 @@ bool CssFormat::onSave(FileOp* fop)
           !fop->document()->sprite()->backgroundLayer()->isVisible()) {
         mask_color = fop->document()->sprite()->transparentColor();
       }
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<IndexedTraits>(image.get(), x, y);
-          if (c != mask_color) {
-            if (css_options->withVars) {
-              print_shadow_index(x, y, c, num_printed_pixels>0);
-            }
-            else {
-              print_shadow_color(x, y,
-                     image_palette[c][0] & 0xff,
-                     image_palette[c][1] & 0xff,
-                     image_palette[c][2] & 0xff,
-                     image_palette[c][3] & 0xff,
-                     num_printed_pixels>0);
-            }
-            num_printed_pixels ++;
+      for_each_pixel_rect<IndexedTraits>(
+        image.get(), merge,
+        [mask_color](color_t c){ return c != mask_color; },
+        [&](const PixelRect& rc){
+          const int c = rc.color;
+          if (css_options->withVars) {
+            print_rect_index(rc, c, num_printed_pixels>0);
           }
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+          else {
+            print_rect_color(rc,
+                             image_palette[c][0] & 0xff,
+                             image_palette[c][1] & 0xff,
+                             image_palette[c][2] & 0xff,
+                             image_palette[c][3] & 0xff,
+                             num_printed_pixels>0);
+          }
+          num_printed_pixels ++;
+        }, fop);
       break;
     }
   }
+  if (merge && num_printed_pixels == 0)
+    fprintf(f, " none");
   fprintf(f, ";\n}\n");
   if (ferror(f)) {
     fop->setError("Error writing file.\n");
@@ -268,11 +317,15 @@ FormatOptionsPtr CssFormat::onAskUserForFormatOptions(FileOp* fop)
       if (pref.isSet(pref.css.generateHtml))
         opts->generateHtml = pref.css.generateHtml();
 
+      if (pref.isSet(pref.css.mergeRects))
+        opts->mergeRects = pref.css.mergeRects();
+
       if (pref.css.showAlert()) {
         app::gen::CssOptions win;
         win.pixelScale()->setTextf("%d", opts->pixelScale);
         win.withVars()->setSelected(opts->withVars);
         win.generateHtml()->setSelected(opts->generateHtml);
+        win.mergeRects()->setSelected(opts->mergeRects);
         win.openWindowInForeground();
 
         if (win.closer() == win.ok()) {
@@ -280,10 +333,12 @@ FormatOptionsPtr CssFormat::onAskUserForFormatOptions(FileOp* fop)
           pref.css.pixelScale((int)win.pixelScale()->textInt());
           pref.css.withVars(win.withVars()->isSelected());
           pref.css.generateHtml(win.generateHtml()->isSelected());
+          pref.css.mergeRects(win.mergeRects()->isSelected());
 
           opts->generateHtml = pref.css.generateHtml();
           opts->withVars = pref.css.withVars();
           opts->pixelScale = pref.css.pixelScale();
+          opts->mergeRects = pref.css.mergeRects();
         }
         else {
           opts.reset();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,6 +11,7 @@
 
 #include "app/file/file.h"
 
+#include "app/cli/cli_output_cache.h"
 #include "app/cmd/convert_color_profile.h"
 #include "app/color_spaces.h"
 #include "app/console.h"
@@ -26,13 +27,16 @@
 #include "app/i18n/strings.h"
 #include "app/modules/gui.h"
 #include "app/modules/palettes.h"
+#include "app/phase_profiler.h"
 #include "app/pref/preferences.h"
+#include "app/trace.h"
 #include "app/tx.h"
 #include "app/ui/incompat_file_window.h"
 #include "app/ui/optional_alert.h"
 #include "app/ui/status_bar.h"
 #include "base/fs.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
 #include "dio/detect_format.h"
 #include "doc/algorithm/resize_image.h"
 #include "doc/doc.h"
@@ -48,13 +52,21 @@
 #include "open_sequence.xml.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstring>
 #include <cstdarg>
+#include <deque>
+#include <mutex>
+#include <thread>
 
 namespace app {
 
 using namespace base;
 
+// Frames of this size (in bytes) or bigger are rendered in bands to
+// save them with formats that support FILE_ENCODE_SCANLINES
+static constexpr std::size_t kMinImageSizeToRenderInBands = 64*1024*1024;
+
 class FileOp::FileAbstractImageImpl : public FileAbstractImage {
 public:
   FileAbstractImageImpl(FileOp* fop)
@@ -81,6 +93,8 @@ public:
 
   void setUnscaledImageToSave(const doc::frame_t frame,
                               const doc::ImageRef& image) {
+    m_bandImage.reset();
+
     // If we don't need to rescale the input "image", we can just
     // reference the same exact image to encode (as we don't need to
     // call resize_image()).
@@ -95,12 +109,15 @@ public:
         m_tmpScaledImage.reset(doc::Image::create(m_spec));
       }
 
+      // Sprite::rgbMap() is not used as sequences can be saved
+      // from several threads (and it's not needed for the nearest
+      // neighbor method)
       doc::algorithm::resize_image(
         image.get(),
         m_tmpScaledImage.get(),
         doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR,
         palette(frame),
-        m_sprite->rgbMap(frame),
+        nullptr,
         image->maskColor());
     }
   }
@@ -145,61 +162,284 @@ public:
   }
 
   const uint8_t* getScanline(int y) const override {
+    if (m_bandImage) {
+      if (m_bandY < 0 ||
+          y < m_bandY ||
+          y >= m_bandY + m_bandImage->height()) {
+        renderBand(y);
+      }
+      return m_bandImage->getPixelAddress(0, y - m_bandY);
+    }
     return m_tmpScaledImage->getPixelAddress(0, y);
   }
 
+  // Instead of rendering the whole frame in an image, the rows
+  // requested with getScanline() are rendered in horizontal bands
+  // of a few rows (so the memory used depends on the frame width).
+  void setFrameToRenderInBands(const doc::frame_t frame,
+                               const gfx::Rect& frameBounds) {
+    ASSERT(!needResize());
+
+    const int rowBytes = m_sprite->spec().bytesPerPixel() * frameBounds.w;
+    const int bandHeight =
+      std::clamp(int(kBandSize / rowBytes), 1, frameBounds.h);
+
+    m_tmpScaledImage.reset();
+    m_bandImage.reset(doc::Image::create(m_sprite->pixelFormat(),
+                                         frameBounds.w, bandHeight));
+    m_bandFrame = frame;
+    m_bandBounds = frameBounds;
+    m_bandY = -1;
+  }
+
+  // This function can be called from several threads at the same
+  // time (e.g. the GIF encoder renders frames ahead in a thread
+  // pool), so it cannot modify members or the sprite.
   void renderFrame(const doc::frame_t frame,
                    const gfx::Rect& frameBounds,
                    doc::Image* dst) const override {
     const bool needResize = this->needResize();
 
-    if (needResize &&
-        (!m_tmpUnscaledRender ||
-         m_tmpUnscaledRender->size() != frameBounds.size())) {
+    doc::ImageRef unscaledRender;
+    if (needResize) {
       auto spec = m_sprite->spec();
       spec.setSize(frameBounds.size());
       spec.setColorMode(dst->colorMode());
-      m_tmpUnscaledRender.reset(doc::Image::create(spec));
+      unscaledRender.reset(doc::Image::create(spec));
     }
 
     render::Render render;
     render.setNewBlend(m_newBlend);
     render.setBgOptions(render::BgOptions::MakeNone());
     render.renderSprite(
-      (needResize ? m_tmpUnscaledRender.get(): dst),
+      (needResize ? unscaledRender.get(): dst),
       m_sprite, frame,
       gfx::Clip(gfx::Point(0, 0), frameBounds));
 
     if (needResize) {
+      // The nearest neighbor method doesn't need a RgbMap (and
+      // Sprite::rgbMap() is not thread-safe)
       doc::algorithm::resize_image(
-        m_tmpUnscaledRender.get(),
+        unscaledRender.get(),
         dst,
         doc::algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR,
         palette(frame),
-        m_sprite->rgbMap(frame),
-        m_tmpUnscaledRender->maskColor());
+        nullptr,
+        unscaledRender->maskColor());
     }
   }
 
+  const gfx::PointF& scale() const {
+    return m_scale;
+  }
+
   void setScale(const gfx::PointF& scale) {
     m_scale = scale;
     m_spec.setWidth(m_spec.width() * m_scale.x);
     m_spec.setHeight(m_spec.height() * m_scale.y);
   }
 
+  bool canRenderInBands() const {
+    return !needResize();
+  }
+
 private:
+  // Approximated number of bytes of each band
+  static constexpr std::size_t kBandSize = 4*1024*1024;
+
   bool needResize() const {
     return (m_scale != gfx::PointF(1.0, 1.0));
   }
 
+  void renderBand(const int y) const {
+    const int h = m_bandImage->height();
+
+    // Rows can be requested from top to bottom or from bottom to top
+    // (e.g. BMP files)
+    int bandY = (m_bandY >= 0 && y < m_bandY ? y-h+1: y);
+    bandY = std::clamp(bandY, 0, m_bandBounds.h-h);
+
+    render::Render render;
+    render.setNewBlend(m_newBlend);
+    render.setBgOptions(render::BgOptions::MakeNone());
+    render.renderSprite(
+      m_bandImage.get(), m_sprite, m_bandFrame,
+      gfx::Clip(gfx::Point(0, 0),
+                gfx::Rect(m_bandBounds.x, m_bandBounds.y+bandY,
+                          m_bandBounds.w, h)));
+    m_bandY = bandY;
+  }
+
   const Doc* m_doc;
   const doc::Sprite* m_sprite;
   doc::ImageSpec m_spec;
   const bool m_supportAnimation;
   const bool m_newBlend;
   doc::ImageRef m_tmpScaledImage = nullptr;
-  mutable doc::ImageRef m_tmpUnscaledRender = nullptr;
   gfx::PointF m_scale = gfx::PointF(1.0, 1.0);
+
+  // Rows rendered in bands (see setFrameToRenderInBands())
+  doc::ImageRef m_bandImage = nullptr;
+  doc::frame_t m_bandFrame = 0;
+  gfx::Rect m_bandBounds;
+  mutable int m_bandY = -1;
+};
+
+// Decodes the files of a sequence (after the first one, which
+// creates the document) in a thread pool, a few files ahead of
+// FileOp::operate(). Each file is decoded with its own FileOp (and
+// temporary document), and then the result (image, palette, flags,
+// errors) is merged in the original FileOp in the sequence order.
+class FileOp::SequenceDecoder {
+public:
+  SequenceDecoder(FileOp* fop)
+    : m_fop(fop)
+    , m_palette(*fop->m_seq.palette)
+    , m_window(kFilesPerThread * std::thread::hardware_concurrency())
+    , m_next(1)
+    , m_pool(std::thread::hardware_concurrency()) {
+  }
+
+  ~SequenceDecoder() {
+    // Wait the scheduled files (e.g. if there was an error loading
+    // a previous file)
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this]{ return m_pending == 0; });
+  }
+
+  // Loads the file "index" of the sequence in the FileOp, it's like
+  // calling FileFormat::load() with the FileOp.
+  bool load(const std::size_t index) {
+    const base::paths& filenames = m_fop->m_seq.filename_list;
+    while (m_next < filenames.size() &&
+           m_next < index + m_window &&
+           !m_fop->isStop())
+      schedule(filenames[m_next++]);
+
+    if (m_items.empty())
+      return false;
+
+    std::unique_ptr<Item> item = std::move(m_items.front());
+    m_items.pop_front();
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [&item]{ return item->done; });
+    }
+    return merge(item->fop.get(), item->result);
+  }
+
+private:
+  // Maximum number of files decoded ahead by thread
+  static constexpr int kFilesPerThread = 2;
+
+  struct Item {
+    std::unique_ptr<FileOp> fop;
+    bool result = false;        // Result of FileFormat::load()
+    bool done = false;
+
+    ~Item() {
+      if (fop) {
+        delete fop->m_seq.last_cel;
+        delete fop->releaseDocument();
+      }
+    }
+  };
+
+  void schedule(const std::string& filename) {
+    FileOp* fop = new FileOp(FileOpLoad, m_fop->m_context, &m_fop->m_config);
+    m_items.push_back(std::make_unique<Item>());
+    Item* item = m_items.back().get();
+    item->fop.reset(fop);
+    fop->m_format = m_fop->m_format;
+    fop->m_filename = filename;
+    fop->m_oneframe = m_fop->m_oneframe;
+    fop->m_createPaletteFromRgba = m_fop->m_createPaletteFromRgba;
+    fop->m_previewSize = m_fop->m_previewSize;
+    fop->m_seq.palette = new Palette(m_palette);
+    fop->m_seq.flags = m_fop->m_seq.flags;
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool.execute([this, item]{
+      FileOp* fop = item->fop.get();
+      bool result = false;
+      try {
+        result = fop->m_format->load(fop);
+      }
+      catch (const std::exception& ex) {
+        fop->setError("%s\n", ex.what());
+      }
+
+      const std::lock_guard lock(m_mutex);
+      item->result = result;
+      item->done = true;
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  // Merges the result of the decoded file in the original FileOp,
+  // like if FileFormat::load() was called with it.
+  bool merge(FileOp* src, bool result) {
+    FileOp* dst = m_fop;
+    if (src->hasError())
+      dst->setError("%s", src->error().c_str());
+    if (src->hasIncompatibilityError())
+      dst->setIncompatibilityError(src->m_incompatibilityError);
+
+    if (!src->m_document || !src->m_seq.image)
+      return false;
+
+    Sprite* dstSprite = dst->m_document->sprite();
+    const Sprite* srcSprite = src->m_document->sprite();
+    const ImageRef image = src->m_seq.image;
+    if (image->pixelFormat() != dstSprite->pixelFormat()) {
+      dst->setError("Error: image does not match color mode\n");
+      return false;
+    }
+
+    ASSERT(!dst->m_seq.last_cel);
+    dst->m_seq.image = image;
+    dst->m_seq.last_cel = new Cel(dst->m_seq.frame++, ImageRef(nullptr));
+
+    // Decoders of indexed images set the whole palette, other
+    // decoders could keep the palette of the previous file
+    if (image->pixelFormat() == IMAGE_INDEXED ||
+        *src->m_seq.palette != m_palette) {
+      src->m_seq.palette->copyColorsTo(dst->m_seq.palette);
+    }
+
+    if (src->m_seq.has_alpha)
+      dst->m_seq.has_alpha = true;
+    if (srcSprite->transparentColor() != 0)
+      dstSprite->setTransparentColor(srcSprite->transparentColor());
+    if (dstSprite->colorSpace()->type() == gfx::ColorSpace::None &&
+        srcSprite->colorSpace()->type() != gfx::ColorSpace::None) {
+      dstSprite->setColorSpace(srcSprite->colorSpace());
+      dst->m_document->notifyColorSpaceChanged();
+    }
+    if (src->m_embeddedColorProfile)
+      dst->m_embeddedColorProfile = true;
+    if (src->m_embeddedGridBounds)
+      dst->m_embeddedGridBounds = true;
+    if (src->m_formatOptions)
+      dst->setLoadedFormatOptions(src->m_formatOptions);
+
+    dst->setProgress(1.0);
+    return result;
+  }
+
+  FileOp* m_fop;
+  // Palette of the first file, used as the initial palette of each file
+  const Palette m_palette;
+  const std::size_t m_window;
+  std::size_t m_next;
+  std::deque<std::unique_ptr<Item>> m_items;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  int m_pending = 0;
+  base::thread_pool m_pool;
 };
 
 base::paths get_readable_extensions()
@@ -389,9 +629,10 @@ FileOp* FileOp::createLoadDocumentOperation(Context* context,
     goto done;
   }
 
-  // Get the format through the extension of the filename
+  // Get the format through the content/extension of the filename
+  // (cached, so the file selector doesn't read the header again)
   fop->m_format = FileFormatsManager::instance()->getFileFormat(
-    dio::detect_format(filename));
+    dio::detect_format_cached(filename));
   if (!fop->m_format ||
       !fop->m_format->support(FILE_SUPPORT_LOAD)) {
     fop->setError("%s can't load \"%s\" file (\"%s\")\n", get_app_name(),
@@ -841,6 +1082,7 @@ bool FileOp::checkIfFormatSupportResizeOnTheFly(const std::string& filename)
 void FileOp::operate(IFileOpProgress* progress)
 {
   ASSERT(!isDone());
+  APP_TRACE_ZONE(m_type == FileOpLoad ? "File load": "File save");
 
   m_progressInterface = progress;
 
@@ -848,6 +1090,8 @@ void FileOp::operate(IFileOpProgress* progress)
   if (m_type == FileOpLoad &&
       m_format != NULL &&
       m_format->support(FILE_SUPPORT_LOAD)) {
+    ScopedPhase phase(PhaseProfiler::Phase::Decode, m_filename);
+
     // Load a sequence
     if (isSequence()) {
       // Default palette
@@ -882,13 +1126,20 @@ void FileOp::operate(IFileOpProgress* progress)
       m_seq.progress_offset = 0.0f;
       m_seq.progress_fraction = 1.0f / (double)frames;
 
+      std::unique_ptr<SequenceDecoder> decoder;
+
       auto it = m_seq.filename_list.begin(),
            end = m_seq.filename_list.end();
       for (; it != end; ++it) {
         m_filename = it->c_str();
 
-        // Call the "load" procedure to read the first bitmap.
-        bool loadres = m_format->load(this);
+        bool loadres;
+        if (decoder)
+          loadres = decoder->load(it - m_seq.filename_list.begin());
+        else {
+          // Call the "load" procedure to read the first bitmap.
+          loadres = m_format->load(this);
+        }
         if (!loadres) {
           setError("Error loading frame %d from file \"%s\"\n",
                    frame+1, m_filename.c_str());
@@ -944,7 +1195,13 @@ void FileOp::operate(IFileOpProgress* progress)
 
         ++frame;
         m_seq.progress_offset += m_seq.progress_fraction;
+
+        // The first file creates the document, the rest of the files
+        // can be decoded in parallel
+        if (frame == 1 && canLoadSequenceInParallel())
+          decoder = std::make_unique<SequenceDecoder>(this);
       }
+      decoder.reset();
       m_filename = *m_seq.filename_list.begin();
 
       // Final setup
@@ -994,6 +1251,8 @@ void FileOp::operate(IFileOpProgress* progress)
            m_format != NULL &&
            m_format->support(FILE_SUPPORT_SAVE)) {
 #ifdef ENABLE_SAVE
+    ScopedPhase phase(PhaseProfiler::Phase::Encode,
+                      m_document->filename());
 
 #if defined(ENABLE_TRIAL_MODE)
     DRM_INVALID{
@@ -1009,15 +1268,31 @@ void FileOp::operate(IFileOpProgress* progress)
     //      and only in UI mode (so the CLI still works)
 
     // Save a sequence
-    if (isSequence()) {
+    if (isSequence() && canSaveSequenceInParallel()) {
+      saveSequenceInParallel();
+    }
+    else if (isSequence()) {
       ASSERT(m_format->support(FILE_SUPPORT_SEQUENCES));
 
       Sprite* sprite = m_document->sprite();
 
+      // Huge frames are rendered in bands while they are encoded
+      // (empty frames cannot be detected without the whole image)
+      const bool renderInBands =
+        (m_abstractImage &&
+         m_abstractImage->canRenderInBands() &&
+         m_format->support(FILE_ENCODE_SCANLINES) &&
+         !m_ignoreEmpty &&
+         std::size_t(sprite->spec().bytesPerPixel()) *
+         m_roi.fileCanvasSize().w *
+         m_roi.fileCanvasSize().h >= kMinImageSizeToRenderInBands);
+
       // Create a temporary bitmap
-      m_seq.image.reset(Image::create(sprite->pixelFormat(),
-                                      m_roi.fileCanvasSize().w,
-                                      m_roi.fileCanvasSize().h));
+      if (!renderInBands) {
+        m_seq.image.reset(Image::create(sprite->pixelFormat(),
+                                        m_roi.fileCanvasSize().w,
+                                        m_roi.fileCanvasSize().h));
+      }
 
       m_seq.progress_offset = 0.0f;
       m_seq.progress_fraction = 1.0f / (double)sprite->totalFrames();
@@ -1038,9 +1313,14 @@ void FileOp::operate(IFileOpProgress* progress)
         }
 
         // Render the (unscaled) sequenced image.
-        render.renderSprite(
-          m_seq.image.get(), sprite, frame,
-          gfx::Clip(gfx::Point(0, 0), bounds));
+        if (renderInBands) {
+          m_abstractImage->setFrameToRenderInBands(frame, bounds);
+        }
+        else {
+          render.renderSprite(
+            m_seq.image.get(), sprite, frame,
+            gfx::Clip(gfx::Point(0, 0), bounds));
+        }
 
         bool save = true;
 
@@ -1067,6 +1347,7 @@ void FileOp::operate(IFileOpProgress* progress)
                      outputFrame+1, m_filename.c_str());
             break;
           }
+          CliOutputCache::notifySavedFile(m_filename);
         }
 
         m_seq.progress_offset += m_seq.progress_fraction;
@@ -1080,6 +1361,15 @@ void FileOp::operate(IFileOpProgress* progress)
     }
     // Direct save to a file.
     else {
+      // Load the pixels of cels that are still in the original file
+      // (lazy loading mode) as we could be overwriting it
+      if (m_document && m_document->sprite()) {
+        for (Cel* cel : m_document->sprite()->uniqueCels()) {
+          if (cel->image()->hasBitsLoader())
+            cel->image()->prefetchBits();
+        }
+      }
+
       makeDirectories();
 
       if (m_abstractImage) {
@@ -1092,6 +1382,8 @@ void FileOp::operate(IFileOpProgress* progress)
         setError("Error saving the sprite in the file \"%s\"\n",
                  m_filename.c_str());
       }
+      else
+        CliOutputCache::notifySavedFile(m_filename);
     }
 
     // Save special data from .aseprite-data file
@@ -1101,6 +1393,7 @@ void FileOp::operate(IFileOpProgress* progress)
         !m_dataFilename.empty()) {
       try {
         save_aseprite_data_file(m_dataFilename, m_document);
+        CliOutputCache::notifySavedFile(m_dataFilename);
       }
       catch (const std::exception& ex) {
         setError("Error loading data file: %s\n", ex.what());
@@ -1122,13 +1415,11 @@ void FileOp::operate(IFileOpProgress* progress)
 void FileOp::done()
 {
   // Finally done.
-  const std::lock_guard lock(m_mutex);
   m_done = true;
 }
 
 void FileOp::stop()
 {
-  const std::lock_guard lock(m_mutex);
   if (!m_done)
     m_stop = true;
 }
@@ -1418,10 +1709,12 @@ FileAbstractImage* FileOp::abstractImageToSave()
 
   makeAbstractImage();
 
-  // Use sequenceImageToSave() to fill the current image
+  // Use sequenceImageToSave() to fill the current image (without
+  // image the frame was prepared to be rendered in bands)
   if (m_format->support(FILE_SUPPORT_SEQUENCES)) {
-    m_abstractImage->setUnscaledImageToSave(m_seq.frame++,
-                                            m_seq.image);
+    if (m_seq.image)
+      m_abstractImage->setUnscaledImageToSave(m_seq.frame, m_seq.image);
+    ++m_seq.frame;
   }
 
   return m_abstractImage.get();
@@ -1433,6 +1726,21 @@ void FileOp::setOnTheFlyScale(const gfx::PointF& scale)
   m_abstractImage->setScale(scale);
 }
 
+void FileOp::setCompressionLevel(const int level)
+{
+  m_config.compressionLevel = std::clamp(level, -1, 9);
+}
+
+void FileOp::setLinkIdenticalCels(const bool state)
+{
+  m_config.linkIdenticalCels = state;
+}
+
+void FileOp::setPngPreset(const gen::PngPreset preset)
+{
+  m_config.pngPreset = preset;
+}
+
 void FileOp::setError(const char *format, ...)
 {
   char buf_error[4096];         // TODO possible stack overflow
@@ -1465,8 +1773,6 @@ void FileOp::setIncompatibilityError(const std::string& msg)
 
 void FileOp::setProgress(double progress)
 {
-  const std::lock_guard lock(m_mutex);
-
   if (isSequence()) {
     m_progress =
       m_seq.progress_offset +
@@ -1492,34 +1798,19 @@ void FileOp::getFilenameList(base::paths& output) const
 
 double FileOp::progress() const
 {
-  double progress;
-  {
-    const std::lock_guard lock(m_mutex);
-    progress = m_progress;
-  }
-  return progress;
+  return m_progress;
 }
 
 // Returns true when the file operation has finished, this means, when
 // the FileOp::operate() routine ends.
 bool FileOp::isDone() const
 {
-  bool done;
-  {
-    const std::lock_guard lock(m_mutex);
-    done = m_done;
-  }
-  return done;
+  return m_done;
 }
 
 bool FileOp::isStop() const
 {
-  bool stop;
-  {
-    std::scoped_lock lock(m_mutex);
-    stop = m_stop;
-  }
-  return stop;
+  return m_stop;
 }
 
 FileOp::FileOp(FileOpType type,
@@ -1536,6 +1827,7 @@ FileOp::FileOp(FileOpType type,
   , m_oneframe(false)
   , m_createPaletteFromRgba(false)
   , m_ignoreEmpty(false)
+  , m_previewSize(0)
   , m_embeddedColorProfile(false)
   , m_embeddedGridBounds(false)
 {
@@ -1564,6 +1856,171 @@ void FileOp::prepareForSequence()
   m_formatOptions.reset();
 }
 
+bool FileOp::canLoadSequenceInParallel() const
+{
+  ASSERT(isSequence());
+  return (m_format->support(FILE_DECODE_PARALLEL_SEQUENCES) &&
+          m_document &&
+          std::thread::hardware_concurrency() >= 2 &&
+          m_seq.filename_list.size() > 2);
+}
+
+bool FileOp::canSaveSequenceInParallel() const
+{
+  ASSERT(isSequence());
+  return (m_format->support(FILE_ENCODE_PARALLEL_SEQUENCES) &&
+          std::thread::hardware_concurrency() >= 2 &&
+          m_roi.frames() >= 2);
+}
+
+// Saves each frame of the sequence with a FileOp for each file, so
+// several frames can be rendered/encoded at the same time in a thread
+// pool. The number of frames in progress is limited to avoid keeping
+// too many images in memory, and the results (errors) are reported in
+// the same order of the sequence.
+void FileOp::saveSequenceInParallel()
+{
+  ASSERT(m_format->support(FILE_SUPPORT_SEQUENCES));
+
+  struct FrameOp {
+    std::unique_ptr<FileOp> fop;
+    frame_t outputFrame;
+    bool result = true;       // Result of FileFormat::save()
+    bool done = false;
+  };
+
+  // Maximum number of frames in progress by thread
+  constexpr int kFramesPerThread = 2;
+
+  const Sprite* sprite = m_document->sprite();
+  const int threads = std::thread::hardware_concurrency();
+  const std::size_t window = kFramesPerThread * threads;
+  const gfx::Size canvasSize = m_roi.fileCanvasSize();
+
+  m_seq.progress_offset = 0.0f;
+  m_seq.progress_fraction = 1.0f / (double)sprite->totalFrames();
+
+  std::deque<std::unique_ptr<FrameOp>> frameOps;
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool failed = false;
+
+  // Waits the oldest frame and reports its errors
+  auto finishFrameOp = [&]{
+    std::unique_ptr<FrameOp> frameOp = std::move(frameOps.front());
+    frameOps.pop_front();
+    {
+      std::unique_lock lock(mutex);
+      cv.wait(lock, [&frameOp]{ return frameOp->done; });
+    }
+
+    // Non-fatal errors (e.g. warnings of the file format)
+    if (frameOp->fop->hasError())
+      setError("%s", frameOp->fop->error().c_str());
+
+    if (!frameOp->result) {
+      setError("Error saving frame %d in the file \"%s\"\n",
+               frameOp->outputFrame+1, frameOp->fop->filename().c_str());
+      failed = true;
+    }
+
+    setProgress(1.0);
+    m_seq.progress_offset += m_seq.progress_fraction;
+  };
+
+  {
+    base::thread_pool pool(threads);
+
+    frame_t outputFrame = 0;
+    for (frame_t frame : m_roi.framesSequence()) {
+      if (failed || isStop())
+        break;
+
+      gfx::Rect bounds = m_roi.frameBounds(frame);
+      if (bounds.isEmpty())
+        continue; // Skip frame because there is no slice key
+
+      auto frameOp = std::make_unique<FrameOp>();
+      frameOp->outputFrame = outputFrame;
+
+      // The FileOp of each file shares the document and options with
+      // this one, but it has its own image/palette/filename.
+      FileOp* fop = new FileOp(FileOpSave, m_context, &m_config);
+      frameOp->fop.reset(fop);
+      fop->m_format = m_format;
+      fop->m_document = m_document;
+      fop->m_roi = m_roi;
+      fop->m_formatOptions = m_formatOptions;
+      fop->m_filename = m_seq.filename_list[outputFrame];
+      fop->m_seq.palette = new Palette(frame_t(0), 256);
+      fop->m_seq.image.reset(Image::create(sprite->pixelFormat(),
+                                           canvasSize.w,
+                                           canvasSize.h));
+      fop->m_seq.frame = frame;
+      if (m_format->support(FILE_ENCODE_ABSTRACT_IMAGE)) {
+        fop->makeAbstractImage();
+        if (m_abstractImage)
+          fop->m_abstractImage->setScale(m_abstractImage->scale());
+        fop->m_abstractImage->setSpecSize(canvasSize, bounds.size());
+      }
+      sprite->palette(frame)->copyColorsTo(fop->m_seq.palette);
+
+      const bool ignoreEmpty = m_ignoreEmpty;
+      FrameOp* frameOpPtr = frameOp.get();
+      pool.execute([frameOpPtr, sprite, frame, bounds, ignoreEmpty, &mutex, &cv]{
+        FileOp* fop = frameOpPtr->fop.get();
+        bool result = true;
+        try {
+          render::Render render;
+          render.setNewBlend(fop->m_config.newBlend);
+          render.renderSprite(
+            fop->m_seq.image.get(), sprite, frame,
+            gfx::Clip(gfx::Point(0, 0), bounds));
+
+          // Check if we have to ignore empty frames
+          if (!ignoreEmpty ||
+              sprite->isOpaque() ||
+              !doc::is_empty_image(fop->m_seq.image.get())) {
+            // Directories are created one at a time
+            {
+              const std::lock_guard lock(mutex);
+              fop->makeDirectories();
+            }
+            result = fop->m_format->save(fop);
+            if (result)
+              CliOutputCache::notifySavedFile(fop->m_filename);
+          }
+        }
+        catch (const std::exception& ex) {
+          fop->setError("%s\n", ex.what());
+          result = false;
+        }
+
+        // The image is not needed anymore
+        fop->m_seq.image.reset();
+
+        const std::lock_guard lock(mutex);
+        frameOpPtr->result = result;
+        frameOpPtr->done = true;
+        cv.notify_all();
+      });
+      frameOps.push_back(std::move(frameOp));
+
+      // Limit the number of frames in memory
+      if (frameOps.size() >= window)
+        finishFrameOp();
+
+      ++outputFrame;
+    }
+
+    // Wait the remaining frames
+    while (!frameOps.empty())
+      finishFrameOp();
+  }
+
+  m_filename = *m_seq.filename_list.begin();
+}
+
 void FileOp::makeDirectories()
 {
   std::string dir = base::get_file_path(m_filename);
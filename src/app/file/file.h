@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,6 +21,7 @@
 #include "doc/frames_sequence.h"
 #include "os/color_space.h"
 
+#include <atomic>
 #include <cstdio>
 #include <memory>
 #include <mutex>
@@ -134,11 +135,14 @@ namespace app {
     // In case that the file format can encode scanline by scanline
     // (e.g. PNG format) we can request each row to encode (without
     // the need to call getScaledImage()). Each scanline depends on
-    // the spec() width.
+    // the spec() width. The returned pointer is valid until the next
+    // call (the rows of huge images are rendered in bands as they are
+    // requested, see FILE_ENCODE_SCANLINES).
     virtual const uint8_t* getScanline(int y) const = 0;
 
     // In case that the encoder supports animation and needs to render
-    // a full frame renders.
+    // a full frame renders. It can be called from several threads at
+    // the same time (to render different frames).
     virtual void renderFrame(const doc::frame_t frame,
                              const gfx::Rect& frameBounds,
                              doc::Image* dst) const = 0;
@@ -169,6 +173,7 @@ namespace app {
 
     bool isSequence() const { return !m_seq.filename_list.empty(); }
     bool isOneFrame() const { return m_oneframe; }
+    int previewSize() const { return m_previewSize; }
     bool preserveColorProfile() const { return m_config.preserveColorProfile; }
     const FileFormat* fileFormat() const { return m_format; }
 
@@ -196,6 +201,12 @@ namespace app {
     // Does extra post-load processing which may require user intervention.
     void postLoad();
 
+    // The loaded document will be used just to render a preview of
+    // the given size (e.g. a thumbnail), so formats that can decode a
+    // reduced version of the image faster (e.g. JPEG) can load an
+    // image with a size near to this one (but not smaller).
+    void setPreviewSize(int size) { m_previewSize = size; }
+
     // Special options specific to the file format.
     FormatOptionsPtr formatOptions() const {
       return m_formatOptions;
@@ -265,6 +276,12 @@ namespace app {
     FileAbstractImage* abstractImageToSave();
     void setOnTheFlyScale(const gfx::PointF& scale);
 
+    // Overrides the compression level of the config() (e.g. to save
+    // files faster or smaller from the CLI).
+    void setCompressionLevel(const int level);
+    void setLinkIdenticalCels(const bool state);
+    void setPngPreset(const gen::PngPreset preset);
+
     const std::string& error() const { return m_error; }
     void setError(const char *error, ...);
     bool hasError() const { return !m_error.empty(); }
@@ -301,19 +318,21 @@ namespace app {
     std::string m_dataFilename; // File-name for a special XML .aseprite-data where extra sprite data can be stored
     FileOpROI m_roi;
 
-    // Shared fields between threads.
-    mutable std::mutex m_mutex; // Mutex to access to the next two fields.
-    double m_progress;          // Progress (1.0 is ready).
+    // Shared fields between threads (progress and flags are atomic,
+    // so formats can check them in each row/frame without locks).
+    std::atomic<double> m_progress; // Progress (1.0 is ready).
     IFileOpProgress* m_progressInterface;
+    mutable std::mutex m_mutex; // Mutex to access to the next two fields.
     std::string m_error;        // Error string.
     std::string m_incompatibilityError; // Incompatibility error string.
-    bool m_done;                // True if the operation finished.
-    bool m_stop;                // Force the break of the operation.
+    std::atomic<bool> m_done;   // True if the operation finished.
+    std::atomic<bool> m_stop;   // Force the break of the operation.
     bool m_oneframe;            // Load just one frame (in formats
                                 // that support animation like
                                 // GIF/FLI/ASE).
     bool m_createPaletteFromRgba;
     bool m_ignoreEmpty;
+    int m_previewSize;          // Size of the preview (0 = full image)
 
     // True if the file contained a color profile when it was loaded.
     bool m_embeddedColorProfile;
@@ -347,7 +366,12 @@ namespace app {
     class FileAbstractImageImpl;
     std::unique_ptr<FileAbstractImageImpl> m_abstractImage;
 
+    class SequenceDecoder;
+
     void prepareForSequence();
+    bool canLoadSequenceInParallel() const;
+    bool canSaveSequenceInParallel() const;
+    void saveSequenceInParallel();
     void makeAbstractImage();
     void makeDirectories();
   };
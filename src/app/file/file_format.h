@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +32,9 @@
 #define FILE_SUPPORT_PALETTE_WITH_ALPHA 0x00004000
 #define FILE_ENCODE_ABSTRACT_IMAGE      0x00008000 // Use the new FileAbstractImage
 #define FILE_GIF_ANI_LIMITATIONS        0x00010000
+#define FILE_ENCODE_PARALLEL_SEQUENCES  0x00020000 // save() can be called from several threads for sequences
+#define FILE_DECODE_PARALLEL_SEQUENCES  0x00040000 // load() can be called from several threads for sequences
+#define FILE_ENCODE_SCANLINES           0x00080000 // save() only uses FileAbstractImage::getScanline() (rows can be rendered in bands)
 
 namespace app {
 
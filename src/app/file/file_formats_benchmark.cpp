@@ -0,0 +1,267 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "app/file/file_format.h"
+#include "app/file/file_formats_manager.h"
+#include "app/memory_profiler.h"
+#include "base/fs.h"
+#include "dio/detect_format.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "fmt/format.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+struct SpriteParams {
+  int size;
+  int frames;
+};
+
+// Sprites generated for each format and color mode: small/medium/big
+// static images and an animation.
+const SpriteParams kSprites[] = {
+  { 64, 1 },
+  { 512, 1 },
+  { 2048, 1 },
+  { 256, 32 },
+};
+
+// Extensions of all the file formats to test (the ones that are not
+// available in this build, or cannot load/save files, are skipped).
+const char* kExtensions[] = {
+  "ase", "png", "gif", "webp", "jpg", "bmp",
+  "tga", "pcx", "qoi", "psd", "flc",
+};
+
+const ColorMode kColorModes[] = {
+  ColorMode::RGB,
+  ColorMode::GRAYSCALE,
+  ColorMode::INDEXED,
+};
+
+const char* color_mode_name(const ColorMode colorMode)
+{
+  switch (colorMode) {
+    case ColorMode::RGB: return "rgb";
+    case ColorMode::GRAYSCALE: return "gray";
+    case ColorMode::INDEXED: return "indexed";
+    default: break;
+  }
+  return "";
+}
+
+bool format_supports(const FileFormat* format,
+                     const ColorMode colorMode,
+                     const int frames)
+{
+  if (!format->support(FILE_SUPPORT_LOAD | FILE_SUPPORT_SAVE))
+    return false;
+
+  // Formats without frames would save a sequence of files
+  if (frames > 1 && !format->support(FILE_SUPPORT_FRAMES))
+    return false;
+
+  switch (colorMode) {
+    case ColorMode::RGB: return format->support(FILE_SUPPORT_RGB);
+    case ColorMode::GRAYSCALE: return format->support(FILE_SUPPORT_GRAY);
+    case ColorMode::INDEXED: return format->support(FILE_SUPPORT_INDEXED);
+    default: break;
+  }
+  return false;
+}
+
+// Fills the image with runs of random colors (so it's not trivial to
+// compress, but it's not just noise)
+void fill_image(Image* image, const int seed)
+{
+  std::srand(seed);
+  color_t c = 0;
+  for (int y=0; y<image->height(); ++y) {
+    for (int x=0; x<image->width(); ++x) {
+      if ((std::rand() & 7) == 0) {
+        const int v = std::rand() & 0xff;
+        switch (image->pixelFormat()) {
+          case IMAGE_RGB: c = rgba(v, 255-v, (v*7) & 0xff, 255); break;
+          case IMAGE_GRAYSCALE: c = graya(v, 255); break;
+          case IMAGE_INDEXED: c = v; break;
+          default: break;
+        }
+      }
+      put_pixel(image, x, y, c);
+    }
+  }
+}
+
+std::unique_ptr<Doc> create_doc(Context* ctx,
+                                const ColorMode colorMode,
+                                const SpriteParams& params)
+{
+  std::unique_ptr<Doc> doc(
+    ctx->documents().add(params.size, params.size, colorMode, 256));
+  Sprite* sprite = doc->sprite();
+  auto layer = static_cast<LayerImage*>(sprite->root()->firstLayer());
+
+  sprite->setTotalFrames(params.frames);
+  for (frame_t frame=0; frame<params.frames; ++frame) {
+    Cel* cel = layer->cel(frame);
+    if (!cel) {
+      ImageRef image(Image::create(sprite->spec()));
+      cel = new Cel(frame, image);
+      layer->addCel(cel);
+    }
+    fill_image(cel->image(), frame+1);
+  }
+  return doc;
+}
+
+int64_t raw_size(const Doc* doc)
+{
+  const Sprite* sprite = doc->sprite();
+  return int64_t(sprite->width()) * sprite->height()
+    * bytes_per_pixel_for_colormode(sprite->colorMode())
+    * sprite->totalFrames();
+}
+
+void set_counters(benchmark::State& state,
+                  const Doc* doc,
+                  const std::string& filename,
+                  const MemoryProfiler::Stats& memory)
+{
+  // MB/s of pixels data (uncompressed)
+  state.SetBytesProcessed(state.iterations() * raw_size(doc));
+
+  state.counters["file_size"] = double(base::file_size(filename));
+  state.counters["allocs"] =
+    benchmark::Counter(double(memory.allocs), benchmark::Counter::kAvgIterations);
+  state.counters["alloc_bytes"] =
+    benchmark::Counter(double(memory.allocBytes), benchmark::Counter::kAvgIterations,
+                       benchmark::Counter::kIs1024);
+  state.counters["peak_bytes"] =
+    benchmark::Counter(double(memory.peakBytes), benchmark::Counter::kDefaults,
+                       benchmark::Counter::kIs1024);
+}
+
+void BM_Save(benchmark::State& state,
+             const std::string& ext,
+             const ColorMode colorMode,
+             const SpriteParams params)
+{
+  Context ctx;
+  std::unique_ptr<Doc> doc = create_doc(&ctx, colorMode, params);
+  const std::string filename = "_benchmark." + ext;
+  doc->setFilename(filename);
+
+  ScopedMemoryStats memory;
+  for (auto _ : state) {
+    if (save_document(&ctx, doc.get()) != 0) {
+      state.SkipWithError("Error saving the file");
+      break;
+    }
+  }
+  set_counters(state, doc.get(), filename, memory.stats());
+
+  doc->close();
+  base::delete_file(filename);
+}
+
+void BM_Load(benchmark::State& state,
+             const std::string& ext,
+             const ColorMode colorMode,
+             const SpriteParams params)
+{
+  Context ctx;
+  std::unique_ptr<Doc> doc = create_doc(&ctx, colorMode, params);
+  const std::string filename = "_benchmark." + ext;
+  doc->setFilename(filename);
+  if (save_document(&ctx, doc.get()) != 0) {
+    state.SkipWithError("Error saving the file");
+    doc->close();
+    return;
+  }
+
+  ScopedMemoryStats memory;
+  for (auto _ : state) {
+    std::unique_ptr<Doc> loaded(load_document(&ctx, filename));
+    if (!loaded) {
+      state.SkipWithError("Error loading the file");
+      break;
+    }
+    loaded->close();
+  }
+  set_counters(state, doc.get(), filename, memory.stats());
+
+  doc->close();
+  base::delete_file(filename);
+}
+
+// Registers a Save/Load benchmark for each combination of format,
+// color mode, and sprite size/frames supported by the format.
+void register_benchmarks()
+{
+  for (const char* ext : kExtensions) {
+    const FileFormat* format =
+      FileFormatsManager::instance()->getFileFormat(
+        dio::detect_format_by_file_extension(std::string("x.") + ext));
+    if (!format)
+      continue;
+
+    for (const ColorMode colorMode : kColorModes) {
+      for (const SpriteParams& params : kSprites) {
+        if (!format_supports(format, colorMode, params.frames))
+          continue;
+
+        const std::string name =
+          fmt::format("{}/{}/{}x{}/frames:{}", ext,
+                      color_mode_name(colorMode),
+                      params.size, params.size, params.frames);
+
+        benchmark::RegisterBenchmark(
+          ("BM_Save/" + name).c_str(),
+          [ext = std::string(ext), colorMode, params](benchmark::State& state){
+            BM_Save(state, ext, colorMode, params);
+          })
+          ->Unit(benchmark::kMillisecond);
+
+        benchmark::RegisterBenchmark(
+          ("BM_Load/" + name).c_str(),
+          [ext = std::string(ext), colorMode, params](benchmark::State& state){
+            BM_Load(state, ext, colorMode, params);
+          })
+          ->Unit(benchmark::kMillisecond);
+      }
+    }
+  }
+}
+
+} // anonymous namespace
+
+int app_main(int argc, char* argv[])
+{
+  MemoryProfiler::setEnabled(true);
+  register_benchmarks();
+
+  ::benchmark::Initialize(&argc, argv);
+  return ::benchmark::RunSpecifiedBenchmarks();
+}
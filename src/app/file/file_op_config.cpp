@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -12,6 +12,8 @@
 
 #include "app/color_spaces.h"
 
+#include <algorithm>
+
 namespace app {
 
 void FileOpConfig::fillFromPreferences()
@@ -26,6 +28,13 @@ void FileOpConfig::fillFromPreferences()
   workingCS = get_working_rgb_space_from_preferences();
   rgbMapAlgorithm = pref.quantization.rgbmapAlgorithm();
   cacheCompressedTilesets = pref.tileset.cacheCompressedTilesets();
+  cacheCompressedCels = pref.experimental.cacheCompressedCels();
+  lazyLoadCels = pref.experimental.lazyLoadCels();
+  memoryMappedFiles = pref.experimental.memoryMappedFiles();
+  compressionLevel = std::clamp(pref.saveFile.compressionLevel(), -1, 9);
+  linkIdenticalCels = pref.saveFile.linkIdenticalCels();
+  pngPreset = pref.saveFile.pngPreset();
+  psdSkipHiddenLayers = pref.experimental.psdSkipHiddenLayers();
 }
 
 } // namespace app
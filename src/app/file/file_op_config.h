@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -42,6 +42,38 @@ namespace app {
     // compressed data that was loaded as-is).
     bool cacheCompressedTilesets = true;
 
+    // Cache the compressed pixels of each cel (read from or written
+    // to .aseprite files), so the next save operation only compresses
+    // the modified cels (see doc::CelData::compressedData()).
+    bool cacheCompressedCels = true;
+
+    // Load the pixels of big cels from .aseprite files on demand
+    // (when they are rendered, exported, or edited the first time),
+    // so huge files can be opened faster.
+    bool lazyLoadCels = false;
+
+    // Read .aseprite files mapping them in memory.
+    bool memoryMappedFiles = true;
+
+    // zlib compression level (from 0 to 9, or -1 to use the default
+    // level) of the cels and tilesets saved in .aseprite files, to
+    // save faster (e.g. 1) or smaller files (e.g. 9).
+    int compressionLevel = -1;
+
+    // Save cels with the same pixels, position, opacity, and user
+    // data of a previous cel in the same layer as linked cels of
+    // that cel in .aseprite files (so the pixels are saved only once).
+    bool linkIdenticalCels = false;
+
+    // Speed vs size of the PNG encoder: FAST doesn't filter the rows
+    // and uses a fast zlib level (e.g. for previews), SMALL uses
+    // adaptive filters and the best zlib level (e.g. for shipping).
+    app::gen::PngPreset pngPreset = app::gen::PngPreset::DEFAULT;
+
+    // Don't load the hidden layers of .psd files (their channels are
+    // not even converted), useful to open big files faster.
+    bool psdSkipHiddenLayers = false;
+
     void fillFromPreferences();
   };
 
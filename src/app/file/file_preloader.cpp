@@ -0,0 +1,138 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/file/file_preloader.h"
+
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "base/fs.h"
+
+#include <algorithm>
+
+namespace app {
+
+FilePreloader::FilePreloader(Context* ctx,
+                             const base::paths& filenames,
+                             const int flags,
+                             const int threads)
+  : m_ctx(ctx)
+  , m_filenames(filenames)
+  , m_next(0)
+  , m_flags(flags)
+  , m_maxEntries(2*std::max(1, threads))
+  , m_pool(std::max(1, threads))
+{
+  fill();
+}
+
+FilePreloader::~FilePreloader()
+{
+  std::unique_lock lock(m_mutex);
+  for (auto& entry : m_entries) {
+    if (!entry.ready)
+      entry.fop->stop();
+  }
+  m_cv.wait(lock, [this]{
+    return std::all_of(m_entries.begin(), m_entries.end(),
+                       [](const Entry& entry){ return entry.ready; });
+  });
+
+  // Delete the documents that were not used
+  for (auto& entry : m_entries) {
+    if (entry.fop->document())
+      delete entry.fop->releaseDocument();
+  }
+}
+
+std::unique_ptr<FileOp> FilePreloader::take(const std::string& filename,
+                                            const int flags)
+{
+  if (flags != m_flags)
+    return nullptr;
+
+  std::unique_ptr<FileOp> fop;
+  {
+    const std::string fn = base::normalize_path(filename);
+    std::unique_lock lock(m_mutex);
+    auto it = std::find_if(m_entries.begin(), m_entries.end(),
+                           [&fn](const Entry& entry){
+                             return entry.filename == fn;
+                           });
+    if (it == m_entries.end())
+      return nullptr;
+
+    Entry& entry = *it;
+    m_cv.wait(lock, [&entry]{ return entry.ready; });
+    fop = std::move(entry.fop);
+    m_entries.erase(it);
+  }
+
+  // Start loading the next files
+  fill();
+  return fop;
+}
+
+void FilePreloader::fill()
+{
+  while (m_next < m_filenames.size()) {
+    {
+      const std::lock_guard lock(m_mutex);
+      if (int(m_entries.size()) >= m_maxEntries)
+        break;
+    }
+
+    const std::string fn = base::normalize_path(m_filenames[m_next++]);
+    if (m_usedFiles.find(fn) != m_usedFiles.end())
+      continue;
+
+    // The FileOp is created from the main thread (it can access the
+    // preferences)
+    std::unique_ptr<FileOp> fop(
+      FileOp::createLoadDocumentOperation(m_ctx, fn, m_flags));
+    if (!fop)
+      continue;
+
+    // Don't load the files that will be part of this sequence again
+    for (const auto& seqFn : fop->filenames())
+      m_usedFiles.insert(base::normalize_path(seqFn));
+
+    Entry* entry;
+    {
+      const std::lock_guard lock(m_mutex);
+      m_entries.push_back(Entry());
+      entry = &m_entries.back();
+      entry->filename = fn;
+      entry->fop = std::move(fop);
+
+      // Errors are reported when the file is taken
+      if (entry->fop->hasError()) {
+        entry->ready = true;
+        continue;
+      }
+    }
+
+    FileOp* entryFop = entry->fop.get();
+    m_pool.execute([this, entry, entryFop]{
+      try {
+        entryFop->operate(nullptr);
+      }
+      catch (const std::exception& e) {
+        entryFop->setError("Error loading file:\n%s", e.what());
+      }
+      entryFop->done();
+
+      const std::lock_guard lock(m_mutex);
+      entry->ready = true;
+      m_cv.notify_all();
+    });
+  }
+}
+
+} // namespace app
@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_FILE_FILE_PRELOADER_H_INCLUDED
+#define APP_FILE_FILE_PRELOADER_H_INCLUDED
+#pragma once
+
+#include "base/paths.h"
+#include "base/thread_pool.h"
+
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+
+namespace app {
+  class Context;
+  class FileOp;
+
+  // Loads a list of files in background threads (several files at
+  // the same time) before they are needed, in the same order they
+  // will be opened. Only a few files are loaded ahead of the next
+  // file to be taken, so the memory is not filled with documents.
+  class FilePreloader {
+  public:
+    FilePreloader(Context* ctx,
+                  const base::paths& filenames,
+                  const int flags,
+                  const int threads);
+    ~FilePreloader();
+
+    // Returns the load operation of the given file (waiting it to be
+    // finished) to be post-processed as any other FileOp::operate(),
+    // or nullptr if the file wasn't preloaded with the given flags.
+    std::unique_ptr<FileOp> take(const std::string& filename,
+                                 const int flags);
+
+  private:
+    struct Entry {
+      std::string filename;
+      std::unique_ptr<FileOp> fop;
+      bool ready = false;
+    };
+
+    void fill();
+
+    Context* m_ctx;
+    base::paths m_filenames;
+    size_t m_next;
+    int m_flags;
+    int m_maxEntries;
+    // Files included in sequences of other files
+    std::set<std::string> m_usedFiles;
+    std::list<Entry> m_entries;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    base::thread_pool m_pool;
+  };
+
+} // namespace app
+
+#endif
@@ -0,0 +1,95 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/file/file_save_queue.h"
+
+#include "app/console.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "base/debug.h"
+
+#include <algorithm>
+
+namespace app {
+
+FileSaveQueue* FileSaveQueue::m_instance = nullptr;
+
+FileSaveQueue::FileSaveQueue(const int threads)
+  : m_pending(0)
+  , m_pool(std::max(1, threads))
+{
+  ASSERT(m_instance == nullptr);
+  m_instance = this;
+}
+
+FileSaveQueue::~FileSaveQueue()
+{
+  wait();
+
+  ASSERT(m_instance == this);
+  m_instance = nullptr;
+}
+
+void FileSaveQueue::save(std::unique_ptr<FileOp>&& fop, Doc* document)
+{
+  // Two operations writing the same file must be saved in order
+  // (the filename of the FileOp can change while it's operated, so
+  // we compare the original filenames)
+  const std::string filename = fop->filename();
+  for (const Entry& entry : m_entries) {
+    if (entry.filename == filename) {
+      wait();
+      break;
+    }
+  }
+
+  FileOp* op = fop.get();
+  m_entries.push_back(Entry{ std::move(fop), document, filename });
+  {
+    const std::lock_guard lock(m_mutex);
+    ++m_pending;
+  }
+  m_pool.execute([this, op]{
+    try {
+      op->operate(nullptr);
+    }
+    catch (const std::exception& e) {
+      op->setError("Error saving file:\n%s", e.what());
+    }
+    op->done();
+
+    const std::lock_guard lock(m_mutex);
+    --m_pending;
+    m_cv.notify_all();
+  });
+}
+
+void FileSaveQueue::wait()
+{
+  {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this]{ return m_pending == 0; });
+  }
+
+  // Errors are reported in the same order the files were queued
+  for (const Entry& entry : m_entries) {
+    if (entry.fop->hasError()) {
+      Console console;
+      console.printf(entry.fop->error().c_str());
+
+      // Same as SaveFileBaseCommand::saveDocumentInBackground()
+      if (!entry.document->isReadOnly())
+        entry.document->impossibleToBackToSavedState();
+    }
+  }
+  m_entries.clear();
+}
+
+} // namespace app
@@ -0,0 +1,59 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_FILE_FILE_SAVE_QUEUE_H_INCLUDED
+#define APP_FILE_FILE_SAVE_QUEUE_H_INCLUDED
+#pragma once
+
+#include "base/thread_pool.h"
+
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace app {
+  class Doc;
+  class FileOp;
+
+  // While a queue is active, the save operations created by the
+  // SaveFileCopyAs command are operated in background threads
+  // instead of waiting them (e.g. to export several tags/slices of
+  // the same document at the same time from the CLI). The documents
+  // must not be modified until wait() is called.
+  class FileSaveQueue {
+  public:
+    // Returns the active queue or nullptr.
+    static FileSaveQueue* instance() { return m_instance; }
+
+    FileSaveQueue(const int threads);
+    ~FileSaveQueue();
+
+    // Starts saving the given operation in a background thread.
+    void save(std::unique_ptr<FileOp>&& fop, Doc* document);
+
+    // Waits all the queued operations and prints their errors.
+    void wait();
+
+  private:
+    struct Entry {
+      std::unique_ptr<FileOp> fop;
+      Doc* document;
+      std::string filename;
+    };
+
+    static FileSaveQueue* m_instance;
+    std::vector<Entry> m_entries;
+    int m_pending;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    base::thread_pool m_pool;
+  };
+
+} // namespace app
+
+#endif
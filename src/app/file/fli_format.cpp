@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,13 +15,21 @@
 #include "app/file/format_options.h"
 #include "app/modules/palettes.h"
 #include "app/pref/preferences.h"
+#include "base/exception.h"
 #include "base/file_handle.h"
+#include "base/thread_pool.h"
 #include "doc/doc.h"
 #include "flic/flic.h"
-#include "render/render.h"
 
 #include <algorithm>
+#include <condition_variable>
 #include <cstdio>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace app {
 
@@ -204,6 +212,121 @@ static int get_time_precision(const FileAbstractImage* sprite,
   return precision;
 }
 
+namespace {
+
+// Renders the frames to save in a thread pool ahead of the encoder.
+// The encoder must receive the frames in order (each FLC frame is
+// encoded as the delta of the previous one), so next() returns the
+// rendered frames in the same order of the given sequence.
+class FliFramesRenderer {
+public:
+  // Maximum number of frames rendered ahead of the encoder (by
+  // thread) to limit the memory used by the frame images.
+  static constexpr int kFramesPerThread = 2;
+
+  FliFramesRenderer(FileOp* fop,
+                    const FileAbstractImage* sprite,
+                    const std::vector<frame_t>& frames)
+    : m_fop(fop)
+    , m_sprite(sprite)
+    , m_frames(frames) {
+    const int threads = std::thread::hardware_concurrency();
+    if (threads >= 2 && m_frames.size() >= 2) {
+      m_pool = std::make_unique<base::thread_pool>(threads);
+      m_window = kFramesPerThread * threads;
+    }
+  }
+
+  ~FliFramesRenderer() {
+    // Wait pending renders (e.g. if the encoder throws an exception)
+    if (m_pool) {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this]{ return m_pending == 0; });
+    }
+  }
+
+  ImageRef next() {
+    if (!m_pool) {
+      ImageRef image(createImage());
+      renderFrame(m_frames[m_next++], image.get());
+      return image;
+    }
+
+    while (m_next < m_frames.size() &&
+           m_rendered.size() < m_window)
+      scheduleRender(m_frames[m_next++]);
+
+    ASSERT(!m_rendered.empty());
+    std::unique_ptr<RenderedFrame> rendered = std::move(m_rendered.front());
+    m_rendered.pop_front();
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [&rendered]{ return rendered->done; });
+    }
+    if (!rendered->error.empty())
+      throw base::Exception(rendered->error);
+
+    return rendered->image;
+  }
+
+private:
+  struct RenderedFrame {
+    ImageRef image;
+    std::string error;
+    bool done = false;
+  };
+
+  ImageRef createImage() const {
+    return ImageRef(Image::create(IMAGE_INDEXED,
+                                  m_sprite->width(),
+                                  m_sprite->height()));
+  }
+
+  void renderFrame(const frame_t frame, Image* dst) const {
+    m_sprite->renderFrame(frame, m_fop->roi().frameBounds(frame), dst);
+  }
+
+  void scheduleRender(const frame_t frame) {
+    m_rendered.push_back(std::make_unique<RenderedFrame>());
+    RenderedFrame* rendered = m_rendered.back().get();
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool->execute([this, rendered, frame]{
+      ImageRef image;
+      std::string error;
+      try {
+        image = createImage();
+        renderFrame(frame, image.get());
+      }
+      catch (const std::exception& ex) {
+        error = ex.what();
+      }
+
+      const std::lock_guard lock(m_mutex);
+      rendered->image = std::move(image);
+      rendered->error = std::move(error);
+      rendered->done = true;
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  FileOp* m_fop;
+  const FileAbstractImage* m_sprite;
+  const std::vector<frame_t>& m_frames;
+  std::size_t m_next = 0;
+  std::deque<std::unique_ptr<RenderedFrame>> m_rendered;
+  std::size_t m_window = 1;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  int m_pending = 0;
+  std::unique_ptr<base::thread_pool> m_pool;
+};
+
+} // anonymous namespace
+
 bool FliFormat::onSave(FileOp* fop)
 {
   const FileAbstractImage* sprite = fop->abstractImageToSave();
@@ -221,25 +344,20 @@ bool FliFormat::onSave(FileOp* fop)
   header.speed = get_time_precision(sprite, fop->roi().framesSequence());
   encoder.writeHeader(header);
 
-  // Create the bitmaps
-  ImageRef bmp(Image::create(IMAGE_INDEXED, sprite->width(), sprite->height()));
-  render::Render render;
-  render.setNewBlend(fop->newBlend());
+  // Frames are rendered in parallel, and this thread writes them in
+  // order (the encoder calculates the delta with the previous frame)
+  std::vector<frame_t> frames;
+  for (frame_t frame : fop->roi().framesSequence())
+    frames.push_back(frame);
+  FliFramesRenderer renderer(fop, sprite, frames);
 
   // Write frame by frame
   flic::Frame fliFrame;
-  fliFrame.pixels = bmp->getPixelAddress(0, 0);
-  fliFrame.rowstride = bmp->rowBytes();
-
-  auto frame_beg = fop->roi().framesSequence().begin();
-  auto frame_end = fop->roi().framesSequence().end();
-  auto frame_it = frame_beg;
-  frame_t nframes = fop->roi().frames();
-  for (frame_t f=0; f<=nframes; ++f, ++frame_it) {
-    if (frame_it == frame_end)
-      frame_it = frame_beg;
-
-    frame_t frame = *frame_it;
+  ImageRef firstBmp;
+  const frame_t nframes = frame_t(frames.size());
+  for (frame_t f=0; f<=nframes; ++f) {
+    // The last frame is the ring frame (the first frame again)
+    const frame_t frame = frames[f < nframes ? f: 0];
     const Palette* pal = sprite->palette(frame);
     int size = std::min(256, pal->size());
 
@@ -250,8 +368,12 @@ bool FliFormat::onSave(FileOp* fop)
       fliFrame.colormap[c].b = rgba_getb(color);
     }
 
-    // Render the frame in the bitmap
-    sprite->renderFrame(frame, fop->roi().frameBounds(frame), bmp.get());
+    // The first frame is used again in the ring frame
+    ImageRef bmp = (f < nframes ? renderer.next(): firstBmp);
+    if (f == 0)
+      firstBmp = bmp;
+    fliFrame.pixels = bmp->getPixelAddress(0, 0);
+    fliFrame.rowstride = bmp->rowBytes();
 
     // How many times this frame should be written to get the same
     // time that it has in the sprite
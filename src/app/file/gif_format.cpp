@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -19,12 +19,15 @@
 #include "app/file/gif_format.h"
 #include "app/file/gif_options.h"
 #include "app/modules/gui.h"
+#include "app/phase_profiler.h"
 #include "app/pref/preferences.h"
 #include "app/util/autocrop.h"
 #include "base/file_handle.h"
 #include "base/fs.h"
+#include "base/thread_pool.h"
 #include "doc/doc.h"
 #include "doc/octree_map.h"
+#include "doc/rgbmap_rgb5a3.h"
 #include "gfx/clip.h"
 #include "render/dithering.h"
 #include "render/ordered_dither.h"
@@ -35,6 +38,14 @@
 #include "gif_options.xml.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
 
 #include <gif_lib.h>
 
@@ -191,7 +202,7 @@ static void process_disposal_method(const Image* previous,
   }
 }
 
-static inline doc::color_t colormap2rgba(ColorMapObject* colormap, int i) {
+static inline doc::color_t colormap2rgba(const ColorMapObject* colormap, int i) {
   return doc::rgba(
     colormap->Colors[i].Red,
     colormap->Colors[i].Green,
@@ -207,8 +218,38 @@ static inline doc::color_t colormap2rgba(ColorMapObject* colormap, int i) {
 // and combinations of local colormaps can output any number of
 // colors, not just 256. So previous RGB colors must be kept and
 // merged with new colormaps.
+//
+// The LZW data is decoded in the calling thread, while the decoded
+// frames are analyzed (used colors, RGB conversion) in a thread pool
+// and composed over the previous frame (in order) ahead of the
+// reader.
 class GifDecoder {
 public:
+  // Maximum number of decoded frames waiting to be composed (by
+  // thread) to limit the memory used by the frame images.
+  static constexpr int kFramesPerThread = 4;
+
+  // GIF frame decoded from the file with the values of its graphics
+  // control extension.
+  struct DecodedFrame {
+    gfx::Rect bounds;
+    std::unique_ptr<Image> image; // Indexes (nullptr if bounds are empty)
+    ColorMapObject* localColormap = nullptr; // Copy of the local colormap
+    DisposalMethod disposal = DisposalMethod::NONE;
+    int transparentIndex = -1;
+    int delay = 1;
+
+    // Output of analyzeFrame()
+    PalettePicks usedIndexes{256};
+    std::unique_ptr<Image> rgbImage; // Frame in RGB (transparent pixels with alpha=0)
+    bool analyzed = false;
+
+    ~DecodedFrame() {
+      if (localColormap)
+        GifFreeMapObject(localColormap);
+    }
+  };
+
   GifDecoder(FileOp* fop, GifFileType* gifFile, int fd, size_t filesize)
     : m_fop(fop)
     , m_gifFile(gifFile)
@@ -222,6 +263,7 @@ public:
     , m_bgIndex(m_gifFile->SBackGroundColor >= 0 ? m_gifFile->SBackGroundColor: 0)
     , m_localTransparentIndex(-1)
     , m_frameDelay(1)
+    , m_frameColormap(nullptr)
     , m_remap(256)
     , m_hasLocalColormaps(false)
     , m_firstLocalColormap(nullptr) {
@@ -229,9 +271,24 @@ public:
     GIF_TRACE("GIF: global colormap=%d, ncolors=%d\n",
               (m_gifFile->SColorMap ? 1: 0),
               (m_gifFile->SColorMap ? m_gifFile->SColorMap->ColorCount: 0));
+
+    const int threads = std::thread::hardware_concurrency();
+    if (threads >= 2 && !m_fop->isOneFrame()) {
+      m_pool = std::make_unique<base::thread_pool>(threads);
+      m_window = kFramesPerThread * threads;
+    }
   }
 
   ~GifDecoder() {
+    // Wait the tasks in the thread pool (e.g. if we are here because
+    // an exception was thrown reading the file)
+    if (m_pool) {
+      std::unique_lock lock(m_mutex);
+      m_canceled = true;
+      m_cv.wait(lock, [this]{ return m_pending == 0; });
+    }
+    m_frames.clear();
+
     if (m_firstLocalColormap)
       GifFreeMapObject(m_firstLocalColormap);
   }
@@ -248,7 +305,7 @@ public:
       readRecord(recType);
 
       // Just one frame?
-      if (m_fop->isOneFrame() && m_frameNum > 0)
+      if (m_fop->isOneFrame() && m_readFrames > 0)
         break;
 
       if (m_fop->isStop())
@@ -260,6 +317,14 @@ public:
       }
     }
 
+    // Wait until all frames are composed
+    if (m_pool) {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this]{ return m_pending == 0; });
+    }
+    if (!m_error.empty())
+      throw Exception(m_error);
+
     if (m_sprite) {
       // Add entries to include the transparent color
       if (m_bgIndex >= m_sprite->palette(0)->size())
@@ -327,8 +392,10 @@ private:
     if (DGifGetImageDesc(m_gifFile) == GIF_ERROR)
       throw Exception("Invalid GIF image descriptor.\n");
 
+    auto decFrame = std::make_unique<DecodedFrame>();
+
     // These are the bounds of the image to read.
-    gfx::Rect frameBounds(
+    const gfx::Rect frameBounds(
       m_gifFile->Image.Left,
       m_gifFile->Image.Top,
       m_gifFile->Image.Width,
@@ -341,28 +408,189 @@ private:
       // to load the GIF file anyway (which is what is done by other
       // apps).
     if (!m_spriteBounds.contains(frameBounds))
-      throw Exception("Image %d is out of sprite bounds.\n", (int)m_frameNum);
+      throw Exception("Image %d is out of sprite bounds.\n", (int)m_readFrames);
 #endif
 
-    // Create sprite if this is the first frame
-    if (!m_sprite)
-      createSprite();
-
-    // Add a frame if it's necessary
-    if (m_sprite->lastFrame() < m_frameNum)
-      m_sprite->addFrame(m_frameNum);
+    decFrame->bounds = frameBounds;
 
     // Create a temporary image loading the frame pixels from the GIF file
-    std::unique_ptr<Image> frameImage;
     // We don't know if a GIF file could contain empty bounds (width
     // or height=0), but we check this just in case.
     if (!frameBounds.isEmpty())
-      frameImage.reset(readFrameIndexedImage(frameBounds));
+      decFrame->image.reset(readFrameIndexedImage(frameBounds));
+
+    // Copy the local colormap because m_gifFile->Image is reused for
+    // the next frame
+    if (ColorMapObject* colormap = m_gifFile->Image.ColorMap) {
+      decFrame->localColormap = GifMakeMapObject(colormap->ColorCount,
+                                                 colormap->Colors);
+      if (!decFrame->localColormap)
+        throw Exception("Not enough memory for the local colormap.\n");
+    }
 
     GIF_TRACE("GIF: Frame[%d] transparentIndex=%d localMap=%d\n",
-              (int)m_frameNum, m_localTransparentIndex,
+              (int)m_readFrames, m_ext.transparentIndex,
               m_gifFile->Image.ColorMap ? m_gifFile->Image.ColorMap->ColorCount: 0);
 
+    decFrame->disposal = m_ext.disposal;
+    decFrame->transparentIndex = m_ext.transparentIndex;
+    decFrame->delay = m_ext.delay;
+
+    // Reset extension variables
+    m_ext = Extension();
+
+    ++m_readFrames;
+    processFrame(std::move(decFrame));
+  }
+
+  // Analyzes and composes the frame in the same thread, or schedules
+  // it in the thread pool.
+  void processFrame(std::unique_ptr<DecodedFrame>&& decFrame) {
+    if (!m_pool) {
+      analyzeFrame(*decFrame);
+      composeFrame(*decFrame);
+      return;
+    }
+
+    DecodedFrame* frame = decFrame.get();
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this]{
+        return m_frames.size() < m_window || !m_error.empty();
+      });
+      if (!m_error.empty())
+        throw Exception(m_error);
+
+      m_frames.push_back(std::move(decFrame));
+      ++m_pending;
+    }
+
+    m_pool->execute([this, frame]{
+      std::string error;
+      try {
+        analyzeFrame(*frame);
+      }
+      catch (const std::exception& ex) {
+        error = ex.what();
+      }
+
+      bool compose = false;
+      {
+        const std::lock_guard lock(m_mutex);
+        if (!error.empty() && m_error.empty())
+          m_error = std::move(error);
+        frame->analyzed = true;
+
+        // This task composes the frames if there is no other task
+        // composing and the first frame in the queue is ready.
+        if (!m_composing && m_frames.front()->analyzed) {
+          m_composing = true;
+          compose = true;
+        }
+      }
+      if (compose)
+        composeFrames();
+
+      const std::lock_guard lock(m_mutex);
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  // Composes (in order) the analyzed frames at the front of the
+  // queue. Only one task can compose frames at the same time.
+  void composeFrames() {
+    while (true) {
+      DecodedFrame* frame;
+      bool skip;
+      {
+        const std::lock_guard lock(m_mutex);
+        if (m_frames.empty() || !m_frames.front()->analyzed) {
+          m_composing = false;
+          return;
+        }
+        frame = m_frames.front().get();
+        skip = (m_canceled || !m_error.empty());
+      }
+
+      std::string error;
+      if (!skip) {
+        try {
+          composeFrame(*frame);
+        }
+        catch (const std::exception& ex) {
+          error = ex.what();
+        }
+      }
+
+      const std::lock_guard lock(m_mutex);
+      if (!error.empty() && m_error.empty())
+        m_error = std::move(error);
+      m_frames.pop_front();
+      m_cv.notify_all();
+    }
+  }
+
+  // Collects the used indexes of the frame, and converts it to RGB
+  // if the sprite is already in RGB format. It's called from the
+  // thread pool, so it can only modify the given frame.
+  void analyzeFrame(DecodedFrame& frame) const {
+    if (!frame.image || m_canceled)
+      return;
+
+    const Image* image = frame.image.get();
+    for (int y=0; y<image->height(); ++y) {
+      auto it = (IndexedTraits::const_address_t)image->getPixelAddress(0, y);
+      for (int x=0; x<image->width(); ++x, ++it)
+        frame.usedIndexes[*it] = true;
+    }
+
+    if (m_rgb) {
+      const ColorMapObject* colormap =
+        (frame.localColormap ? frame.localColormap: m_gifFile->SColorMap);
+      if (!colormap)
+        return;
+
+      // Colors of each index (the transparent index has alpha=0)
+      color_t colors[256];
+      for (int i=0; i<256; ++i) {
+        if (i == frame.transparentIndex)
+          colors[i] = 0;
+        else if (i < colormap->ColorCount)
+          colors[i] = colormap2rgba(colormap, i);
+        else
+          colors[i] = rgba(0, 0, 0, 255);
+      }
+
+      frame.rgbImage.reset(Image::create(IMAGE_RGB, image->width(), image->height()));
+      for (int y=0; y<image->height(); ++y) {
+        auto src = (IndexedTraits::const_address_t)image->getPixelAddress(0, y);
+        auto dst = (RgbTraits::address_t)frame.rgbImage->getPixelAddress(0, y);
+        for (int x=0; x<image->width(); ++x)
+          *(dst++) = colors[*(src++)];
+      }
+    }
+  }
+
+  // Composes the frame over the previous one and creates its cel.
+  // Frames must be composed in order.
+  void composeFrame(const DecodedFrame& frame) {
+    const gfx::Rect& frameBounds = frame.bounds;
+    const Image* frameImage = frame.image.get();
+
+    m_disposalMethod = frame.disposal;
+    m_localTransparentIndex = frame.transparentIndex;
+    m_frameDelay = frame.delay;
+    m_frameColormap = frame.localColormap;
+
+    // Create sprite if this is the first frame
+    if (!m_sprite)
+      createSprite();
+
+    // Add a frame if it's necessary
+    if (m_sprite->lastFrame() < m_frameNum)
+      m_sprite->addFrame(m_frameNum);
+
     if (m_frameNum == 0) {
       if (m_localTransparentIndex >= 0)
         m_opaque = false;
@@ -372,7 +600,7 @@ private:
 
     // Merge this frame colors with the current palette
     if (frameImage && m_sprite->palette(m_frameNum)->size() <= 256)
-      updatePalette(frameImage.get());
+      updatePalette(frame.usedIndexes);
 
     // Convert the sprite to RGB if we have more than 256 colors
     if ((m_sprite->pixelFormat() == IMAGE_INDEXED) &&
@@ -386,10 +614,13 @@ private:
     // Composite frame with previous frame
     if (frameImage) {
       if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
-        compositeIndexedImageToIndexed(frameBounds, frameImage.get());
+        compositeIndexedImageToIndexed(frameBounds, frameImage);
+      }
+      else if (frame.rgbImage) {
+        compositeRgbImageToRgb(frameBounds, frame.rgbImage.get());
       }
       else {
-        compositeIndexedImageToRgb(frameBounds, frameImage.get());
+        compositeIndexedImageToRgb(frameBounds, frameImage);
       }
     }
 
@@ -410,12 +641,8 @@ private:
     if (m_frameDelay >= 0)
       m_sprite->setFrameDuration(m_frameNum, m_frameDelay*10);
 
-    // Reset extension variables
-    m_disposalMethod = DisposalMethod::NONE;
-    m_localTransparentIndex = -1;
-    m_frameDelay = 1;
-
     // Next frame
+    m_frameColormap = nullptr;
     ++m_frameNum;
   }
 
@@ -453,7 +680,7 @@ private:
 
   ColorMapObject* getFrameColormap() {
     ColorMapObject* global = m_gifFile->SColorMap;
-    ColorMapObject* colormap = m_gifFile->Image.ColorMap;
+    ColorMapObject* colormap = m_frameColormap;
 
     if (!colormap) {
       // Doesn't have local map, use the global one
@@ -502,10 +729,10 @@ private:
   // Note that the order of colors in the resulting palette will be
   // very different from the order of the local palette of the
   // corresponding GIF, since the unused colors will be discarded.
-  void updatePalette(const Image* frameImage) {
+  void updatePalette(const PalettePicks& usedIndexes) {
     ColorMapObject* colormap = getFrameColormap();
     int ncolors = colormap->ColorCount;
-    bool isLocalColormap = (m_gifFile->Image.ColorMap ? true: false);
+    bool isLocalColormap = (m_frameColormap ? true: false);
 
     GIF_TRACE("GIF: Local colormap=%d, ncolors=%d\n", isLocalColormap, ncolors);
 
@@ -519,10 +746,9 @@ private:
       // Mark all entries as used if the colormap is global.
       usedEntries.all();
     else {
-      for (const auto& i : LockImageBits<IndexedTraits>(frameImage)) {
-        if (i >= 0 && i < ncolors) {
+      for (int i=0; i<ncolors && i<usedIndexes.size(); ++i) {
+        if (usedIndexes[i])
           usedEntries[i] = true;
-        }
       }
       // GIF Case: unnamed.gif. If a pixel is equal to
       // m_localtransparentindex in a frame > 0 in a sprite
@@ -715,6 +941,30 @@ private:
     ASSERT(dstIt == dstEnd);
   }
 
+  // Same as compositeIndexedImageToRgb() with a frame already
+  // converted to RGB in analyzeFrame()
+  void compositeRgbImageToRgb(const gfx::Rect& frameBounds,
+                              const Image* frameImage) {
+    gfx::Clip clip(frameBounds.x, frameBounds.y, 0, 0,
+                   frameBounds.w, frameBounds.h);
+    if (!clip.clip(m_currentImage->width(),
+                   m_currentImage->height(),
+                   frameImage->width(),
+                   frameImage->height()))
+      return;
+
+    for (int y=0; y<clip.size.h; ++y) {
+      auto src = (RgbTraits::const_address_t)
+        frameImage->getPixelAddress(clip.src.x, clip.src.y+y);
+      auto dst = (RgbTraits::address_t)
+        m_currentImage->getPixelAddress(clip.dst.x, clip.dst.y+y);
+      for (int x=0; x<clip.size.w; ++x, ++src, ++dst) {
+        if (rgba_geta(*src))
+          *dst = *src;
+      }
+    }
+  }
+
   void createCel() {
     Cel* cel = new Cel(m_frameNum, ImageRef(0));
     try {
@@ -741,12 +991,12 @@ private:
 
     if (extCode == GRAPHICS_EXT_FUNC_CODE) {
       if (extension[0] >= 4) {
-        m_disposalMethod        = (DisposalMethod)((extension[1] >> 2) & 7);
-        m_localTransparentIndex = (extension[1] & 1) ? extension[4]: -1;
-        m_frameDelay            = (extension[3] << 8) | extension[2];
+        m_ext.disposal         = (DisposalMethod)((extension[1] >> 2) & 7);
+        m_ext.transparentIndex = (extension[1] & 1) ? extension[4]: -1;
+        m_ext.delay            = (extension[3] << 8) | extension[2];
 
         GIF_TRACE("GIF: Disposal method: %d\n  Transparent index: %d\n  Frame delay: %d\n",
-                  m_disposalMethod, m_localTransparentIndex, m_frameDelay);
+                  m_ext.disposal, m_ext.transparentIndex, m_ext.delay);
       }
     }
 
@@ -761,8 +1011,8 @@ private:
     if (m_gifFile->SColorMap) {
       colormap = m_gifFile->SColorMap;
     }
-    else if (m_gifFile->Image.ColorMap) {
-      colormap = m_gifFile->Image.ColorMap;
+    else if (m_frameColormap) {
+      colormap = m_frameColormap;
     }
     int ncolors = (colormap ? colormap->ColorCount: 1);
     int w = m_spriteBounds.w;
@@ -827,6 +1077,9 @@ private:
 
     m_sprite->setPixelFormat(IMAGE_RGB);
     m_sprite->setTransparentColor(0);
+
+    // Next frames can be converted to RGB in analyzeFrame()
+    m_rgb = true;
   }
 
   void remapToGlobalColormap(ColorMapObject* colormap) {
@@ -869,12 +1122,13 @@ private:
   std::unique_ptr<Sprite> m_sprite;
   gfx::Rect m_spriteBounds;
   LayerImage* m_layer;
-  int m_frameNum;
+  int m_frameNum;               // Frame being composed
   bool m_opaque;
   DisposalMethod m_disposalMethod;
   int m_bgIndex;
   int m_localTransparentIndex;
   int m_frameDelay;
+  ColorMapObject* m_frameColormap; // Local colormap of the frame being composed
   ImageRef m_currentImage;
   ImageRef m_previousImage;
   Remap m_remap;
@@ -884,6 +1138,29 @@ private:
   // all local colormaps are the same, so we can use it as a global
   // colormap.
   ColorMapObject* m_firstLocalColormap;
+
+  // Values of the last graphics control extension (for the next
+  // frame to be read)
+  struct Extension {
+    DisposalMethod disposal = DisposalMethod::NONE;
+    int transparentIndex = -1;
+    int delay = 1;
+  };
+  Extension m_ext;
+  int m_readFrames = 0;
+
+  // Frames read from the file and not composed yet (at most
+  // m_window frames to limit the memory usage)
+  std::deque<std::unique_ptr<DecodedFrame>> m_frames;
+  std::size_t m_window = 1;
+  std::atomic<bool> m_rgb { false }; // The sprite was converted to RGB
+  bool m_composing = false;
+  std::atomic<bool> m_canceled { false };
+  int m_pending = 0;
+  std::string m_error;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::unique_ptr<base::thread_pool> m_pool;
 };
 
 bool GifFormat::onLoad(FileOp* fop)
@@ -950,6 +1227,41 @@ class GifEncoder {
 public:
   typedef int gifframe_t;
 
+  // Maximum number of frames rendered/quantized ahead of the encoder
+  // (by thread) to limit the memory used by the frame images.
+  static constexpr int kFramesPerThread = 2;
+
+  // Sprite frame rendered in the thread pool.
+  struct RenderedFrame {
+    ImageRef image;
+    std::string error;
+    bool done = false;
+  };
+
+  // GIF frame quantized in the thread pool and written (in order) in
+  // the encoder thread.
+  struct EncodedFrame {
+    gifframe_t gifFrame = 0;
+    frame_t frame = 0;
+    gfx::Rect frameBounds;
+    DisposalMethod disposal = DisposalMethod::DO_NOT_DISPOSE;
+    bool fixDuration = false;
+    std::unique_ptr<Image> deltaImage;
+
+    // Output of quantizeFrame()
+    ImageRef frameImage;
+    ColorMapObject* localColormap = nullptr; // nullptr to use the global colormap
+    int localTransparent = -1;
+    Remap remap{256};
+    std::string error;
+    bool done = false;
+
+    ~EncodedFrame() {
+      if (localColormap)
+        GifFreeMapObject(localColormap);
+    }
+  };
+
   GifEncoder(FileOp* fop, GifFileType* gifFile)
     : m_fop(fop)
     , m_gifFile(gifFile)
@@ -961,7 +1273,8 @@ public:
     , m_bitsPerPixel(1)
     , m_globalColormap(nullptr)
     , m_globalColormapPalette(*m_sprite->palette(0))
-    , m_preservePaletteOrder(false) {
+    , m_preservePaletteOrder(false)
+    , m_rgbMapAlgorithm(fop->config().rgbMapAlgorithm) {
 
     const auto gifOptions = std::static_pointer_cast<GifOptions>(fop->formatOptions());
 
@@ -1070,7 +1383,7 @@ public:
           &newPalette,
           nullptr,
           m_fop->newBlend(),
-          RgbMapAlgorithm::OCTREE, // TODO configurable?
+          m_rgbMapAlgorithm,
           false); // Do not add the transparent color yet
 
         m_transparentIndex = 0;
@@ -1081,13 +1394,22 @@ public:
 
     // Create the 3 temporary images (previous/current/next) to
     // compare pixels between them.
-    for (int i=0; i<3; ++i)
-      m_images[i].reset(Image::create((m_preservePaletteOrder)? IMAGE_INDEXED : IMAGE_RGB,
-                                      m_spriteBounds.w,
-                                      m_spriteBounds.h));
+    for (int i=0; i<3; ++i) {
+      m_images[i] = createFrameImage();
+      clear_image(m_images[i].get(), 0);
+    }
   }
 
   ~GifEncoder() {
+    // Wait the scheduled tasks (e.g. if there was an error writing
+    // the file)
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [this]{ return m_pending == 0; });
+    }
+    m_frames.clear();
+    m_rendered.clear();
+
     if (m_globalColormap)
       GifFreeMapObject(m_globalColormap);
   }
@@ -1097,39 +1419,49 @@ public:
     if (m_loop >= 0)
       writeLoopExtension();
 
+    // In this code "gifFrame" will be the GIF frame, and "frame" will
+    // be the doc::Sprite frame.
+    for (frame_t frame : m_fop->roi().framesSequence())
+      m_spriteFrames.push_back(frame);
+
+    gifframe_t nframes = totalFrames();
+    ASSERT(nframes == gifframe_t(m_spriteFrames.size()));
+
+    // Frames are rendered and quantized in a thread pool ahead of
+    // the encoder, this thread only calculates the delta images/frame
+    // bounds/disposal methods (which depend on the previous frame)
+    // and writes the LZW compressed pixels.
+    const int threads = std::thread::hardware_concurrency();
+    if (threads >= 2 && nframes >= 2) {
+      m_pool = std::make_unique<base::thread_pool>(threads);
+      m_window = kFramesPerThread * threads;
+    }
+
     // Previous and next images are used to decide the best disposal
     // method (e.g. if it's more convenient to restore the background
     // color or to restore the previous frame to reach the next one).
-    m_previousImage = m_images[0].get();
-    m_currentImage = m_images[1].get();
-    m_nextImage = m_images[2].get();
-
-    auto frame_beg = m_fop->roi().framesSequence().begin();
-#if _DEBUG
-    auto frame_end = m_fop->roi().framesSequence().end();
-#endif
-    auto frame_it = frame_beg;
+    m_previousImage = m_images[0];
+    m_currentImage = m_images[1];
+    m_nextImage = m_images[2];
 
-    // In this code "gifFrame" will be the GIF frame, and "frame" will
-    // be the doc::Sprite frame.
-    gifframe_t nframes = totalFrames();
     for (gifframe_t gifFrame=0; gifFrame<nframes; ++gifFrame) {
-      ASSERT(frame_it != frame_end);
-      frame_t frame = *frame_it;
-      ++frame_it;
-
       if (gifFrame == 0)
-        renderFrame(frame, m_nextImage);
+        m_nextImage = nextRenderedFrame();
       else
         std::swap(m_previousImage, m_currentImage);
 
       // Render next frame
       std::swap(m_currentImage, m_nextImage);
       if (gifFrame+1 < nframes)
-        renderFrame(*frame_it, m_nextImage);
+        m_nextImage = nextRenderedFrame();
 
-      gfx::Rect frameBounds = m_spriteBounds;
-      DisposalMethod disposal = DisposalMethod::DO_NOT_DISPOSE;
+      auto encFrame = std::make_unique<EncodedFrame>();
+      encFrame->gifFrame = gifFrame;
+      encFrame->frame = m_spriteFrames[gifFrame];
+      encFrame->frameBounds = m_spriteBounds;
+      encFrame->disposal = DisposalMethod::DO_NOT_DISPOSE;
+      // Only the last frame in the animation needs the fix
+      encFrame->fixDuration = (fix_last_frame_duration && gifFrame == nframes-1);
 
       // Creation of the deltaImage (difference image result respect
       // to current VS previous frame image).  At the same time we
@@ -1138,13 +1470,20 @@ public:
       // method of the current image to RESTORE_BG.  Further, at the
       // same time, we must check if we can go without color zero (0).
 
-      calculateDeltaImageFrameBoundsDisposal(gifFrame, frameBounds, disposal);
+      calculateDeltaImageFrameBoundsDisposal(gifFrame,
+                                             encFrame->frameBounds,
+                                             encFrame->disposal);
+      encFrame->deltaImage = std::move(m_deltaImage);
 
-      writeImage(gifFrame, frame, frameBounds, disposal,
-                 // Only the last frame in the animation needs the fix
-                 (fix_last_frame_duration && gifFrame == nframes-1));
+      if (m_pool)
+        scheduleQuantization(encFrame.get());
+      else {
+        quantizeFrame(*encFrame);
+        encFrame->done = true;
+      }
+      m_frames.push_back(std::move(encFrame));
 
-      m_fop->setProgress(double(gifFrame+1) / double(nframes));
+      writeFrames(gifFrame+1 == nframes);
     }
     return true;
   }
@@ -1155,7 +1494,7 @@ private:
                                               gfx::Rect& frameBounds,
                                               DisposalMethod& disposal) {
     if (gifFrame == 0) {
-      m_deltaImage.reset(Image::createCopy(m_currentImage));
+      m_deltaImage.reset(Image::createCopy(m_currentImage.get()));
       frameBounds = m_spriteBounds;
 
       // The first frame (frame 0) is good to force to disposal = DO_NOT_DISPOSE,
@@ -1164,8 +1503,8 @@ private:
 
       // "Pixel clearing" detection:
       if (!m_hasBackground && !m_preservePaletteOrder) {
-        const LockImageBits<RgbTraits> bits2(m_currentImage);
-        const LockImageBits<RgbTraits> bits3(m_nextImage);
+        const LockImageBits<RgbTraits> bits2(m_currentImage.get());
+        const LockImageBits<RgbTraits> bits3(m_nextImage.get());
         typename LockImageBits<RgbTraits>::const_iterator it2, it3, end2, end3;
         for (it2 = bits2.begin(), end2 = bits2.end(),
              it3 = bits3.begin(), end3 = bits3.end();
@@ -1205,9 +1544,9 @@ private:
 
         int i = 0;
         int x, y;
-        const LockImageBits<RgbTraits> bits1(m_previousImage);
-        LockImageBits<RgbTraits> bits2(m_currentImage);
-        const LockImageBits<RgbTraits> bits3(m_nextImage);
+        const LockImageBits<RgbTraits> bits1(m_previousImage.get());
+        LockImageBits<RgbTraits> bits2(m_currentImage.get());
+        const LockImageBits<RgbTraits> bits3(m_nextImage.get());
         m_deltaImage.reset(Image::create(PixelFormat::IMAGE_RGB, m_spriteBounds.w, m_spriteBounds.h));
         clear_image(m_deltaImage.get(), 0);
         LockImageBits<RgbTraits> deltaBits(m_deltaImage.get());
@@ -1257,7 +1596,7 @@ private:
       // In the other hand, if disposal is still DO_NOT_DISPOSAL, delta image will be a cropped image
       // from itself in frameBounds.
       if (disposal == DisposalMethod::RESTORE_BGCOLOR || m_lastDisposal == DisposalMethod::RESTORE_BGCOLOR) {
-        m_deltaImage.reset(crop_image(m_currentImage, frameBounds, 0));
+        m_deltaImage.reset(crop_image(m_currentImage.get(), frameBounds, 0));
       }
       else {
         m_deltaImage.reset(crop_image(m_deltaImage.get(), frameBounds, 0));
@@ -1366,35 +1705,39 @@ private:
   }
 
 
-  void writeImage(const gifframe_t gifFrame,
-                  const frame_t frame,
-                  const gfx::Rect& frameBounds,
-                  const DisposalMethod disposal,
-                  const bool fixDuration) {
+  // Converts the delta image of the frame to an indexed image and
+  // calculates the colormap/transparent index to write it. This
+  // function is called from the thread pool, so it can only modify
+  // the given frame.
+  void quantizeFrame(EncodedFrame& encFrame) const {
+    ScopedPhase phase(PhaseProfiler::Phase::Quantize,
+                      m_fop->document()->filename());
+    const gfx::Rect& frameBounds = encFrame.frameBounds;
+    int transparentIndex = m_transparentIndex;
+
     Palette framePalette;
     if (m_globalColormap)
       framePalette = m_globalColormapPalette;
     else
-      framePalette = calculatePalette();
+      framePalette = calculatePalette(encFrame.deltaImage.get(), transparentIndex);
 
-    OctreeMap octree;
-    octree.regenerateMap(&framePalette, m_transparentIndex);
+    std::unique_ptr<RgbMap> rgbmap = createRgbMap();
+    rgbmap->regenerateMap(&framePalette, transparentIndex);
     ImageRef frameImage(Image::create(IMAGE_INDEXED,
                                       frameBounds.w,
-                                      frameBounds.h,
-                                      m_frameImageBuf));
+                                      frameBounds.h));
 
     // Every frame might use a small portion of the global palette,
     // to optimize the gif file size, we will analize which colors
     // will be used in each processed frame.
     PalettePicks usedColors(framePalette.size());
 
-    int localTransparent = m_transparentIndex;
-    ColorMapObject* colormap = m_globalColormap;
-    Remap remap(256);
+    int localTransparent = transparentIndex;
+    ColorMapObject* localColormap = nullptr;
+    Remap& remap = encFrame.remap;
 
     if (!m_preservePaletteOrder) {
-      const LockImageBits<RgbTraits> srcBits(m_deltaImage.get());
+      const LockImageBits<RgbTraits> srcBits(encFrame.deltaImage.get());
       LockImageBits<IndexedTraits> dstBits(frameImage.get());
 
       auto srcIt = srcBits.begin();
@@ -1414,13 +1757,13 @@ private:
               rgba_getg(color),
               rgba_getb(color),
               255,
-              m_transparentIndex);
+              transparentIndex);
             if (i < 0)
-              i = octree.mapColor(color | rgba_a_mask); // alpha=255
+              i = rgbmap->mapColor(color | rgba_a_mask); // alpha=255
           }
           else {
-            if (m_transparentIndex >= 0)
-              i = m_transparentIndex;
+            if (transparentIndex >= 0)
+              i = transparentIndex;
             else
               i = m_bgIndex;
           }
@@ -1443,7 +1786,7 @@ private:
       for (int i=0; i<remap.size(); ++i)
         remap.map(i, i);
 
-      if (!colormap) {
+      if (!m_globalColormap) {
         Palette reducedPalette(0, usedNColors);
 
         for (int i=0, j=0; i<framePalette.size(); ++i) {
@@ -1454,30 +1797,44 @@ private:
           }
         }
 
-        colormap = createColorMap(&reducedPalette);
+        localColormap = createColorMap(&reducedPalette);
         if (localTransparent >= 0)
           localTransparent = remap[localTransparent];
       }
 
-      if (localTransparent >= 0 && m_transparentIndex != localTransparent)
-        remap.map(m_transparentIndex, localTransparent);
+      if (localTransparent >= 0 && transparentIndex != localTransparent)
+        remap.map(transparentIndex, localTransparent);
     }
     else {
-      frameImage.reset(Image::createCopy(m_deltaImage.get()));
-      for (int i=0; i<colormap->ColorCount; ++i)
+      frameImage.reset(Image::createCopy(encFrame.deltaImage.get()));
+      for (int i=0; i<m_globalColormap->ColorCount; ++i)
         remap.map(i, i);
     }
 
+    encFrame.frameImage = frameImage;
+    encFrame.localColormap = localColormap;
+    encFrame.localTransparent = localTransparent;
+
+    // The delta image is not needed anymore
+    encFrame.deltaImage.reset();
+  }
+
+  void writeImage(const EncodedFrame& encFrame) {
+    const gifframe_t gifFrame = encFrame.gifFrame;
+    const gfx::Rect& frameBounds = encFrame.frameBounds;
+    const Image* frameImage = encFrame.frameImage.get();
+    const Remap& remap = encFrame.remap;
+
     // Write extension record.
-    writeExtension(gifFrame, frame, localTransparent,
-                   disposal, fixDuration);
+    writeExtension(gifFrame, encFrame.frame, encFrame.localTransparent,
+                   encFrame.disposal, encFrame.fixDuration);
 
     // Write the image record.
     if (EGifPutImageDesc(m_gifFile,
                          frameBounds.x, frameBounds.y,
                          frameBounds.w, frameBounds.h,
                          m_interlaced ? 1: 0,
-                         (colormap != m_globalColormap ? colormap: nullptr)) == GIF_ERROR) {
+                         encFrame.localColormap) == GIF_ERROR) {
       throw Exception("Error writing GIF frame %d.\n", gifFrame);
     }
 
@@ -1488,8 +1845,8 @@ private:
       // Need to perform 4 passes on the images.
       for (int i=0; i<4; ++i)
         for (int y=interlaced_offset[i]; y<frameBounds.h; y+=interlaced_jumps[i]) {
-          IndexedTraits::address_t addr =
-            (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
+          IndexedTraits::const_address_t addr =
+            (IndexedTraits::const_address_t)frameImage->getPixelAddress(0, y);
 
           for (int i=0; i<frameBounds.w; ++i, ++addr)
             scanline[i] = remap[*addr];
@@ -1501,8 +1858,8 @@ private:
     else {
       // Write all image scanlines (not interlaced in this case).
       for (int y=0; y<frameBounds.h; ++y) {
-        IndexedTraits::address_t addr =
-          (IndexedTraits::address_t)frameImage->getPixelAddress(0, y);
+        IndexedTraits::const_address_t addr =
+          (IndexedTraits::const_address_t)frameImage->getPixelAddress(0, y);
 
         for (int i=0; i<frameBounds.w; ++i, ++addr)
           scanline[i] = remap[*addr];
@@ -1511,14 +1868,109 @@ private:
           throw Exception("Error writing GIF image scanlines for frame %d.\n", gifFrame);
       }
     }
+  }
+
+  // Writes the quantized frames in order. If "all" is false, it
+  // waits only if there are too many frames in the queue.
+  void writeFrames(const bool all) {
+    while (!m_frames.empty()) {
+      EncodedFrame* encFrame = m_frames.front().get();
+      {
+        std::unique_lock lock(m_mutex);
+        if (!encFrame->done && !all && m_frames.size() < m_window)
+          return;
+        m_cv.wait(lock, [encFrame]{ return encFrame->done; });
+      }
+      if (!encFrame->error.empty())
+        throw Exception(encFrame->error);
+
+      writeImage(*encFrame);
+      m_frames.pop_front();
+
+      ++m_written;
+      m_fop->setProgress(double(m_written) / double(totalFrames()));
+    }
+  }
+
+  void scheduleQuantization(EncodedFrame* encFrame) {
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool->execute([this, encFrame]{
+      std::string error;
+      try {
+        quantizeFrame(*encFrame);
+      }
+      catch (const std::exception& ex) {
+        error = ex.what();
+      }
+
+      const std::lock_guard lock(m_mutex);
+      encFrame->error = std::move(error);
+      encFrame->done = true;
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  // Returns the next frame of the sequence rendered, and schedules
+  // the rendering of the following frames in the thread pool.
+  ImageRef nextRenderedFrame() {
+    if (!m_pool) {
+      ImageRef image(createFrameImage());
+      renderFrame(m_spriteFrames[m_nextRender++], image.get());
+      return image;
+    }
+
+    while (m_nextRender < m_spriteFrames.size() &&
+           m_rendered.size() < m_window)
+      scheduleRender(m_spriteFrames[m_nextRender++]);
+
+    ASSERT(!m_rendered.empty());
+    std::unique_ptr<RenderedFrame> rendered = std::move(m_rendered.front());
+    m_rendered.pop_front();
+    {
+      std::unique_lock lock(m_mutex);
+      m_cv.wait(lock, [&rendered]{ return rendered->done; });
+    }
+    if (!rendered->error.empty())
+      throw Exception(rendered->error);
+
+    return rendered->image;
+  }
+
+  void scheduleRender(const frame_t frame) {
+    m_rendered.push_back(std::make_unique<RenderedFrame>());
+    RenderedFrame* rendered = m_rendered.back().get();
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
+    }
+    m_pool->execute([this, rendered, frame]{
+      ImageRef image;
+      std::string error;
+      try {
+        image = createFrameImage();
+        renderFrame(frame, image.get());
+      }
+      catch (const std::exception& ex) {
+        error = ex.what();
+      }
 
-    if (colormap && colormap != m_globalColormap)
-      GifFreeMapObject(colormap);
+      const std::lock_guard lock(m_mutex);
+      rendered->image = std::move(image);
+      rendered->error = std::move(error);
+      rendered->done = true;
+      --m_pending;
+      m_cv.notify_all();
+    });
   }
 
-  Palette calculatePalette() {
+  Palette calculatePalette(const Image* deltaImage,
+                           int& transparentIndex) const {
     OctreeMap octree;
-    const LockImageBits<RgbTraits> imageBits(m_deltaImage.get());
+    const LockImageBits<RgbTraits> imageBits(deltaImage);
     auto it = imageBits.begin(), end = imageBits.end();
     bool maskColorFounded = false;
     for (; it != end; ++it) {
@@ -1534,7 +1986,7 @@ private:
       // If there is a mask color, the OctreeMap::makePalette adds it
       // by default at entry == 0.
       octree.makePalette(&palette, 256, 8);
-      m_transparentIndex = 0;
+      transparentIndex = 0;
       return palette;
     }
     else {
@@ -1544,12 +1996,26 @@ private:
       Palette paletteWithoutMask(0, palette.size() - 1);
       for (int i=0; i < paletteWithoutMask.size(); i++)
         paletteWithoutMask.setEntry(i, palette.entry(i+1));
-      m_transparentIndex = -1;
+      transparentIndex = -1;
       return paletteWithoutMask;
     }
   }
 
-  void renderFrame(frame_t frame, Image* dst) {
+  // RgbMap used to find the palette entry of the colors that are
+  // not in the palette (see FileOpConfig::rgbMapAlgorithm).
+  std::unique_ptr<RgbMap> createRgbMap() const {
+    if (m_rgbMapAlgorithm == RgbMapAlgorithm::RGB5A3)
+      return std::make_unique<RgbMapRGB5A3>();
+    return std::make_unique<OctreeMap>();
+  }
+
+  ImageRef createFrameImage() const {
+    return ImageRef(Image::create((m_preservePaletteOrder)? IMAGE_INDEXED : IMAGE_RGB,
+                                  m_spriteBounds.w,
+                                  m_spriteBounds.h));
+  }
+
+  void renderFrame(frame_t frame, Image* dst) const {
     if (m_preservePaletteOrder)
       clear_image(dst, m_bgIndex);
     else
@@ -1559,7 +2025,7 @@ private:
 
 private:
 
-  ColorMapObject* createColorMap(const Palette* palette) {
+  ColorMapObject* createColorMap(const Palette* palette) const {
     int n = 1 << GifBitSizeLimited(palette->size());
     ColorMapObject* colormap = GifMakeMapObject(n, nullptr);
 
@@ -1602,12 +2068,27 @@ private:
   bool m_preservePaletteOrder;
   gfx::Rect m_lastFrameBounds;
   DisposalMethod m_lastDisposal;
-  ImageBufferPtr m_frameImageBuf;
+  RgbMapAlgorithm m_rgbMapAlgorithm;
   ImageRef m_images[3];
-  Image* m_previousImage;
-  Image* m_currentImage;
-  Image* m_nextImage;
+  ImageRef m_previousImage;
+  ImageRef m_currentImage;
+  ImageRef m_nextImage;
   std::unique_ptr<Image> m_deltaImage;
+
+  // Frames to encode (the sprite frame of each GIF frame)
+  std::vector<frame_t> m_spriteFrames;
+  std::size_t m_nextRender = 0;
+  std::size_t m_written = 0;
+
+  // Rendered and quantized frames in the thread pool (at most
+  // m_window frames of each kind to limit the memory usage)
+  std::deque<std::unique_ptr<RenderedFrame>> m_rendered;
+  std::deque<std::unique_ptr<EncodedFrame>> m_frames;
+  std::size_t m_window = 1;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  int m_pending = 0;
+  std::unique_ptr<base::thread_pool> m_pool;
 };
 
 bool GifFormat::onSave(FileOp* fop)
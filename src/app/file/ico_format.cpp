@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2019  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #endif
 
 #include "app/doc.h"
+#include "app/file/bmp_pixels.h"
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
@@ -21,6 +22,9 @@
 #include "doc/doc.h"
 #include "render/render.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace base;
@@ -182,54 +186,40 @@ bool IcoFormat::onLoad(FileOp* fop)
     delete pal;
   }
 
-  // Read XOR MASK
-  int x, y, c, r, g, b;
+  // Read XOR MASK (each 32-bit aligned scanline with one fread() call)
+  int x, y;
+  std::vector<uint8_t> row(bmp::row_size(width, entry.bpp));
   for (y=image->height()-1; y>=0; --y) {
-    for (x=0; x<image->width(); ++x) {
-      switch (entry.bpp) {
-
-        case 8:
-          c = fgetc(f);
-          ASSERT(c >= 0 && c < numcolors);
-          if (c >= 0 && c < numcolors)
-            put_pixel(image.get(), x, y, c);
-          else
-            put_pixel(image.get(), x, y, 0);
-          break;
+    if (fread(row.data(), 1, row.size(), f) != row.size())
+      break;
 
-        case 24:
-          b = fgetc(f);
-          g = fgetc(f);
-          r = fgetc(f);
-          put_pixel(image.get(), x, y, rgba(r, g, b, 255));
-          break;
+    switch (entry.bpp) {
+
+      case 8: {
+        uint8_t* dst = image->getPixelAddress(0, y);
+        for (x=0; x<width; ++x) {
+          const int c = row[x];
+          ASSERT(c < numcolors);
+          dst[x] = (c < numcolors ? c: 0);
+        }
+        break;
       }
-    }
 
-    // every scanline must be 32-bit aligned
-    while (x & 3) {
-      fgetc(f);
-      x++;
+      case 24:
+        bmp::bgr_to_rgba(row.data(), (uint32_t*)image->getPixelAddress(0, y), width);
+        break;
     }
   }
 
   // AND mask
-  int m, v;
+  row.resize(bmp::row_size(width, 1));
   for (y=image->height()-1; y>=0; --y) {
-    for (x=0; x<(image->width()+7)/8; ++x) {
-      m = fgetc(f);
-      v = 128;
-      for (b=0; b<8; b++) {
-        if ((m & v) == v)
-          put_pixel(image.get(), x*8+b, y, 0); // TODO mask color
-        v >>= 1;
-      }
-    }
+    if (fread(row.data(), 1, row.size(), f) != row.size())
+      break;
 
-    // every scanline must be 32-bit aligned
-    while (x & 3) {
-      fgetc(f);
-      x++;
+    for (x=0; x<width; ++x) {
+      if (row[x/8] & (128 >> (x%8)))
+        put_pixel(image.get(), x, y, 0); // TODO mask color
     }
   }
 
@@ -243,7 +233,7 @@ bool IcoFormat::onSave(FileOp* fop)
   const Sprite* sprite = fop->document()->sprite();
   int bpp, bw, bitsw;
   int size, offset, i;
-  int c, x, y, b, m, v;
+  int c, x, y;
   frame_t n, num = sprite->totalFrames();
 
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
@@ -325,77 +315,58 @@ bool IcoFormat::onSave(FileOp* fop)
       }
     }
 
-    // XOR MASK
+    // XOR MASK (each scanline is converted in a 32-bit aligned
+    // buffer and written with one fwrite() call)
+    std::vector<uint8_t> row(bw, 0);
     for (y=image->height()-1; y>=0; --y) {
-      for (x=0; x<image->width(); ++x) {
-        switch (image->pixelFormat()) {
+      const uint8_t* src = image->getPixelAddress(0, y);
+      switch (image->pixelFormat()) {
 
-          case IMAGE_RGB:
-            c = get_pixel(image.get(), x, y);
-            fputc(rgba_getb(c), f);
-            fputc(rgba_getg(c), f);
-            fputc(rgba_getr(c), f);
-            break;
-
-          case IMAGE_GRAYSCALE:
-            c = get_pixel(image.get(), x, y);
-            fputc(graya_getv(c), f);
-            fputc(graya_getv(c), f);
-            fputc(graya_getv(c), f);
-            break;
+        case IMAGE_RGB:
+          bmp::rgba_to_bgr((const uint32_t*)src, row.data(), image->width());
+          break;
 
-          case IMAGE_INDEXED:
-            c = get_pixel(image.get(), x, y);
-            fputc(c, f);
-            break;
-        }
-      }
+        case IMAGE_GRAYSCALE:
+          for (x=0; x<image->width(); ++x) {
+            c = graya_getv(((const uint16_t*)src)[x]);
+            row[3*x] = row[3*x+1] = row[3*x+2] = c;
+          }
+          break;
 
-      // every scanline must be 32-bit aligned
-      while (x & 3) {
-        fputc(0, f);
-        x++;
+        case IMAGE_INDEXED:
+          std::copy(src, src+image->width(), row.begin());
+          break;
       }
+      fwrite(row.data(), 1, row.size(), f);
     }
 
     // AND MASK
+    row.assign(bitsw, 0);
     for (y=image->height()-1; y>=0; --y) {
-      for (x=0; x<(image->width()+7)/8; ++x) {
-        m = 0;
-        v = 128;
+      const uint8_t* src = image->getPixelAddress(0, y);
+      std::fill(row.begin(), row.end(), 0);
 
-        for (b=0; b<8; b++) {
-          c = get_pixel(image.get(), x*8+b, y);
-
-          switch (image->pixelFormat()) {
-
-            case IMAGE_RGB:
-              if (rgba_geta(c) == 0)
-                m |= v;
-              break;
+      for (x=0; x<image->width(); ++x) {
+        bool transparent = false;
+        switch (image->pixelFormat()) {
 
-            case IMAGE_GRAYSCALE:
-              if (graya_geta(c) == 0)
-                m |= v;
-              break;
+          case IMAGE_RGB:
+            transparent = (rgba_geta(((const uint32_t*)src)[x]) == 0);
+            break;
 
-            case IMAGE_INDEXED:
-              if (c == 0) // TODO configurable background color (or nothing as background)
-                m |= v;
-              break;
-          }
+          case IMAGE_GRAYSCALE:
+            transparent = (graya_geta(((const uint16_t*)src)[x]) == 0);
+            break;
 
-          v >>= 1;
+          case IMAGE_INDEXED:
+            // TODO configurable background color (or nothing as background)
+            transparent = (src[x] == 0);
+            break;
         }
-
-        fputc(m, f);
-      }
-
-        // every scanline must be 32-bit aligned
-      while (x & 3) {
-        fputc(0, f);
-        x++;
+        if (transparent)
+          row[x/8] |= (128 >> (x%8));
       }
+      fwrite(row.data(), 1, row.size(), f);
     }
   }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -32,6 +32,13 @@
 
 #include "jpeglib.h"
 
+// libjpeg-turbo can decode/encode RGB scanlines with the same layout
+// of RGB doc::Image pixels (R, G, B, A bytes in little-endian), so we
+// can use the image rows directly without an intermediate buffer.
+#ifdef JCS_EXTENSIONS
+#define JPEG_RGBA_ROWS 1
+#endif
+
 namespace app {
 
 using namespace base;
@@ -65,7 +72,10 @@ class JpegFormat : public FileFormat {
       FILE_SUPPORT_GRAY |
       FILE_SUPPORT_SEQUENCES |
       FILE_SUPPORT_GET_FORMAT_OPTIONS |
-      FILE_ENCODE_ABSTRACT_IMAGE;
+      FILE_ENCODE_ABSTRACT_IMAGE |
+      FILE_ENCODE_PARALLEL_SEQUENCES |
+      FILE_DECODE_PARALLEL_SEQUENCES |
+      FILE_ENCODE_SCANLINES;
   }
 
   bool onLoad(FileOp* fop) override;
@@ -169,18 +179,38 @@ bool JpegFormat::onLoad(FileOp* fop)
   // Read file header, set default decompression parameters.
   jpeg_read_header(&dinfo, true);
 
-  if (dinfo.jpeg_color_space == JCS_GRAYSCALE)
+  const PixelFormat pixelFormat =
+    (dinfo.jpeg_color_space == JCS_GRAYSCALE ? IMAGE_GRAYSCALE:
+                                               IMAGE_RGB);
+  if (pixelFormat == IMAGE_GRAYSCALE)
     dinfo.out_color_space = JCS_GRAYSCALE;
-  else
+  else {
+#ifdef JPEG_RGBA_ROWS
+    dinfo.out_color_space = JCS_EXT_RGBA;
+#else
     dinfo.out_color_space = JCS_RGB;
+#endif
+  }
+
+  // If we need just a preview (e.g. a thumbnail), we can use the DCT
+  // scaling to decode an image of 1/2, 1/4, or 1/8 of the original
+  // size, which is a lot faster than decoding the whole image.
+  if (const int previewSize = fop->previewSize()) {
+    const int size = std::max<int>(dinfo.image_width, dinfo.image_height);
+    int denom = 8;
+    while (denom > 1 && (size + denom - 1) / denom < previewSize)
+      denom /= 2;
+    dinfo.scale_num = 1;
+    dinfo.scale_denom = denom;
+    dinfo.dct_method = JDCT_IFAST;
+  }
 
   // Start decompressor.
   jpeg_start_decompress(&dinfo);
 
   // Create the image.
   ImageRef image = fop->sequenceImageToLoad(
-    (dinfo.out_color_space == JCS_RGB ? IMAGE_RGB:
-                                        IMAGE_GRAYSCALE),
+    pixelFormat,
     dinfo.output_width,
     dinfo.output_height);
   if (!image) {
@@ -188,7 +218,8 @@ bool JpegFormat::onLoad(FileOp* fop)
     return false;
   }
 
-  // Create the buffer.
+  // Create the buffer (just the array of rows when we decode RGB
+  // scanlines directly in the image).
   buffer_height = dinfo.rec_outbuf_height;
   buffer = (JSAMPARRAY)base_malloc(sizeof(JSAMPROW) * buffer_height);
   if (!buffer) {
@@ -196,7 +227,13 @@ bool JpegFormat::onLoad(FileOp* fop)
     return false;
   }
 
-  for (c=0; c<(int)buffer_height; c++) {
+#ifdef JPEG_RGBA_ROWS
+  const bool rgbaRows = (pixelFormat == IMAGE_RGB);
+#else
+  const bool rgbaRows = false;
+#endif
+
+  for (c=0; c<(int)buffer_height && !rgbaRows; c++) {
     buffer[c] = (JSAMPROW)base_malloc(sizeof(JSAMPLE) *
                                       dinfo.output_width * dinfo.output_components);
     if (!buffer[c]) {
@@ -215,10 +252,20 @@ bool JpegFormat::onLoad(FileOp* fop)
 
   // Read each scan line.
   while (dinfo.output_scanline < dinfo.output_height) {
-    num_scanlines = jpeg_read_scanlines(&dinfo, buffer, buffer_height);
+    // RGB decoded directly in the image rows
+    if (rgbaRows) {
+      const int y = dinfo.output_scanline;
+      num_scanlines = std::min<JDIMENSION>(buffer_height,
+                                           dinfo.output_height - y);
+      for (c=0; c<(int)num_scanlines; c++)
+        buffer[c] = (JSAMPROW)image->getPixelAddress(0, y+c);
+      jpeg_read_scanlines(&dinfo, buffer, num_scanlines);
+    }
+    else
+      num_scanlines = jpeg_read_scanlines(&dinfo, buffer, buffer_height);
 
     // RGB
-    if (image->pixelFormat() == IMAGE_RGB) {
+    if (!rgbaRows && image->pixelFormat() == IMAGE_RGB) {
       uint8_t* src_address;
       uint32_t* dst_address;
       int x, y, r, g, b;
@@ -236,7 +283,7 @@ bool JpegFormat::onLoad(FileOp* fop)
       }
     }
     // Grayscale
-    else {
+    else if (image->pixelFormat() == IMAGE_GRAYSCALE) {
       uint8_t* src_address;
       uint16_t* dst_address;
       int x, y;
@@ -268,7 +315,7 @@ bool JpegFormat::onLoad(FileOp* fop)
     fop->document()->notifyColorSpaceChanged();
   }
 
-  for (c=0; c<(int)buffer_height; c++)
+  for (c=0; c<(int)buffer_height && !rgbaRows; c++)
     base_free(buffer[c]);
   base_free(buffer);
 
@@ -387,8 +434,14 @@ bool JpegFormat::onSave(FileOp* fop)
     cinfo.in_color_space = JCS_GRAYSCALE;
   }
   else {
+#ifdef JPEG_RGBA_ROWS
+    // The alpha channel is ignored
+    cinfo.input_components = 4;
+    cinfo.in_color_space = JCS_EXT_RGBA;
+#else
     cinfo.input_components = 3;
     cinfo.in_color_space = JCS_RGB;
+#endif
   }
 
   jpeg_set_defaults(&cinfo);
@@ -404,7 +457,8 @@ bool JpegFormat::onSave(FileOp* fop)
       fop->document()->sprite()->colorSpace())
     saveColorSpace(fop, &cinfo, fop->document()->sprite()->colorSpace().get());
 
-  // CREATE the buffer.
+  // CREATE the buffer (just the array of rows when we encode the
+  // RGB scanlines of the image directly).
   buffer_height = 1;
   buffer = (JSAMPARRAY)base_malloc(sizeof(JSAMPROW) * buffer_height);
   if (!buffer) {
@@ -413,7 +467,13 @@ bool JpegFormat::onSave(FileOp* fop)
     return false;
   }
 
-  for (c=0; c<(int)buffer_height; c++) {
+#ifdef JPEG_RGBA_ROWS
+  const bool rgbaRows = (spec.colorMode() == ColorMode::RGB);
+#else
+  const bool rgbaRows = false;
+#endif
+
+  for (c=0; c<(int)buffer_height && !rgbaRows; c++) {
     buffer[c] = (JSAMPROW)base_malloc(sizeof(JSAMPLE) *
                                       cinfo.image_width * cinfo.num_components);
     if (!buffer[c]) {
@@ -428,8 +488,13 @@ bool JpegFormat::onSave(FileOp* fop)
 
   // Write each scan line.
   while (cinfo.next_scanline < cinfo.image_height) {
+    // RGB (without conversion)
+    if (rgbaRows) {
+      for (c=0; c<(int)buffer_height; c++)
+        buffer[c] = (JSAMPROW)img->getScanline(cinfo.next_scanline+c);
+    }
     // RGB
-    if (spec.colorMode() == ColorMode::RGB) {
+    else if (spec.colorMode() == ColorMode::RGB) {
       uint32_t* src_address;
       uint8_t* dst_address;
       int x, y;
@@ -463,7 +528,7 @@ bool JpegFormat::onSave(FileOp* fop)
   }
 
   // Destroy all data.
-  for (c=0; c<(int)buffer_height; c++)
+  for (c=0; c<(int)buffer_height && !rgbaRows; c++)
     base_free(buffer[c]);
   base_free(buffer);
 
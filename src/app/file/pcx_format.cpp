@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,10 +18,97 @@
 #include "base/file_handle.h"
 #include "doc/doc.h"
 
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
 namespace app {
 
 using namespace base;
 
+namespace {
+
+// Reads the RLE encoded scanlines in chunks (instead of calling
+// fgetc() for each byte).
+class PcxReader {
+public:
+  PcxReader(FILE* f) : m_f(f) { }
+
+  ~PcxReader() {
+    // Return the unused bytes to the file (to read the palette)
+    if (m_pos < m_end)
+      fseek(m_f, -long(m_end - m_pos), SEEK_CUR);
+  }
+
+  int getc() {
+    if (m_pos == m_end) {
+      m_pos = 0;
+      m_end = fread(m_buf, 1, sizeof(m_buf), m_f);
+      if (m_end == 0)
+        return EOF;
+    }
+    return m_buf[m_pos++];
+  }
+
+private:
+  FILE* m_f;
+  uint8_t m_buf[4096];
+  size_t m_pos = 0;
+  size_t m_end = 0;
+};
+
+// Decodes a whole scanline (all its color planes) in "dst". Runs
+// that go beyond the end of the scanline are discarded.
+void decode_rle_scanline(PcxReader& reader, uint8_t* dst, const int n)
+{
+  int x = 0;
+  while (x < n) {
+    int ch = reader.getc();
+    int c = 1;
+    if ((ch & 0xC0) == 0xC0) {
+      c = (ch & 0x3F);
+      ch = reader.getc();
+    }
+    c = std::min(c, n - x);
+    std::memset(dst + x, uint8_t(ch), c);
+    x += c;
+  }
+}
+
+// Returns the number of bytes equal to p[0] (up to n), comparing 8
+// bytes at a time.
+int run_length(const uint8_t* p, const int n)
+{
+  const uint8_t ch = p[0];
+  const uint64_t pattern = 0x0101010101010101ull * ch;
+  int i = 1;
+  for (; i+8 <= n; i += 8) {
+    uint64_t v;
+    std::memcpy(&v, p+i, sizeof(v));
+    if (v != pattern)
+      break;
+  }
+  while (i < n && p[i] == ch)
+    ++i;
+  return i;
+}
+
+void encode_rle_scanline(const uint8_t* src, const int n,
+                         std::vector<uint8_t>& out)
+{
+  out.clear();
+  for (int x=0; x<n; ) {
+    const uint8_t ch = src[x];
+    const int c = run_length(src+x, std::min(n-x, 0x3f));
+    if ((c > 1) || ((ch & 0xC0) == 0xC0))
+      out.push_back(0xC0 | c);
+    out.push_back(ch);
+    x += c;
+  }
+}
+
+} // anonymous namespace
+
 class PcxFormat : public FileFormat {
 
   const char* onGetName() const override {
@@ -64,9 +151,7 @@ bool PcxFormat::onLoad(FileOp* fop)
   int c, r, g, b;
   int width, height;
   int bpp, bytes_per_line;
-  int xx, po;
-  int x, y;
-  char ch = 0;
+  int y;
 
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
   FILE* f = handle.get();
@@ -102,6 +187,10 @@ bool PcxFormat::onLoad(FileOp* fop)
   }
 
   bytes_per_line = fgetw(f);
+  if (bytes_per_line <= 0) {
+    fop->setError("Invalid number of bytes per scanline.\n");
+    return false;
+  }
 
   for (c=0; c<60; c++)             /* skip some more junk */
     fgetc(f);
@@ -114,54 +203,32 @@ bool PcxFormat::onLoad(FileOp* fop)
     return false;
   }
 
-  if (bpp == 24)
-    clear_image(image.get(), rgba(0, 0, 0, 255));
-
-  for (y=0; y<height; y++) {       /* read RLE encoded PCX data */
-    x = xx = 0;
-    po = rgba_r_shift;
-
-    while (x < bytes_per_line*bpp/8) {
-      ch = fgetc(f);
-      if ((ch & 0xC0) == 0xC0) {
-        c = (ch & 0x3F);
-        ch = fgetc(f);
-      }
-      else
-        c = 1;
+  // One buffer for all the color planes of the scanline
+  const int planes = bpp/8;
+  std::vector<uint8_t> scanline(bytes_per_line*planes);
+  const int w = std::min(image->width(), bytes_per_line);
+  {
+    PcxReader reader(f);
+    for (y=0; y<height; y++) {       /* read RLE encoded PCX data */
+      decode_rle_scanline(reader, scanline.data(), int(scanline.size()));
 
       if (bpp == 8) {
-        while (c--) {
-          if (x < image->width())
-            put_pixel_fast<IndexedTraits>(image.get(), x, y, ch);
-
-          x++;
-        }
+        std::copy(scanline.begin(), scanline.begin()+w,
+                  (IndexedTraits::address_t)image->getPixelAddress(0, y));
       }
       else {
-        while (c--) {
-          if (xx < image->width())
-            put_pixel_fast<RgbTraits>(image.get(), xx, y,
-                                      get_pixel_fast<RgbTraits>(image.get(), xx, y) | ((ch & 0xff) << po));
-
-          x++;
-          if (x == bytes_per_line) {
-            xx = 0;
-            po = rgba_g_shift;
-          }
-          else if (x == bytes_per_line*2) {
-            xx = 0;
-            po = rgba_b_shift;
-          }
-          else
-            xx++;
-        }
+        const uint8_t* rs = scanline.data();
+        const uint8_t* gs = rs + bytes_per_line;
+        const uint8_t* bs = gs + bytes_per_line;
+        auto dst = (RgbTraits::address_t)image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x)
+          dst[x] = rgba(rs[x], gs[x], bs[x], 255);
       }
-    }
 
-    fop->setProgress((float)(y+1) / (float)(height));
-    if (fop->isStop())
-      break;
+      fop->setProgress((float)(y+1) / (float)(height));
+      if (fop->isStop())
+        break;
+    }
   }
 
   if (!fop->isStop()) {
@@ -196,10 +263,7 @@ bool PcxFormat::onSave(FileOp* fop)
   const ImageSpec spec = img->spec();
   int c, r, g, b;
   int x, y;
-  int runcount;
   int depth, planes;
-  char runchar;
-  char ch = 0;
 
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
@@ -240,56 +304,33 @@ bool PcxFormat::onSave(FileOp* fop)
   for (c=0; c<54; c++)              /* filler */
     fputc(0, f);
 
-  for (y=0; y<spec.height(); y++) {           /* for each scanline... */
-    runcount = 0;
-    runchar = 0;
+  std::vector<uint8_t> planesBuf(spec.width()*planes);
+  std::vector<uint8_t> rle;
 
+  for (y=0; y<spec.height(); y++) {           /* for each scanline... */
     const uint8_t* scanline = img->getScanline(y);
+    uint8_t* dst = planesBuf.data();
 
-    for (x=0; x<spec.width()*planes; x++) {  /* for each pixel... */
-      if (depth == 8) {
-        if (spec.colorMode() == ColorMode::INDEXED)
-          ch = scanline[x];
-        else if (spec.colorMode() == ColorMode::GRAYSCALE) {
-          c = ((const uint16_t*)scanline)[x];
-          ch = graya_getv(c);
-        }
-      }
-      else {
-        if (x < spec.width()) {
-          c = ((const uint32_t*)scanline)[x];
-          ch = rgba_getr(c);
-        }
-        else if (x<spec.width()*2) {
-          c = ((const uint32_t*)scanline)[x-spec.width()];
-          ch = rgba_getg(c);
-        }
-        else {
-          c = ((const uint32_t*)scanline)[x-spec.width()*2];
-          ch = rgba_getb(c);
-        }
-      }
-      if (runcount == 0) {
-        runcount = 1;
-        runchar = ch;
-      }
-      else {
-        if ((ch != runchar) || (runcount >= 0x3f)) {
-          if ((runcount > 1) || ((runchar & 0xC0) == 0xC0))
-            fputc(0xC0 | runcount, f);
-          fputc(runchar, f);
-          runcount = 1;
-          runchar = ch;
-        }
-        else
-          runcount++;
+    if (spec.colorMode() == ColorMode::INDEXED) {
+      std::copy(scanline, scanline+spec.width(), dst);
+    }
+    else if (spec.colorMode() == ColorMode::GRAYSCALE) {
+      auto src = (const uint16_t*)scanline;
+      for (x=0; x<spec.width(); x++)
+        dst[x] = graya_getv(src[x]);
+    }
+    else {
+      auto src = (const uint32_t*)scanline;
+      for (x=0; x<spec.width(); x++) {
+        c = src[x];
+        dst[x] = rgba_getr(c);
+        dst[x+spec.width()] = rgba_getg(c);
+        dst[x+spec.width()*2] = rgba_getb(c);
       }
     }
 
-    if ((runcount > 1) || ((runchar & 0xC0) == 0xC0))
-      fputc(0xC0 | runcount, f);
-
-    fputc(runchar, f);
+    encode_rle_scanline(dst, int(planesBuf.size()), rle);
+    fwrite(rle.data(), 1, rle.size(), f);
 
     fop->setProgress((float)(y+1) / (float)(spec.height()));
   }
@@ -0,0 +1,110 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_FILE_PIXEL_RECTS_H_INCLUDED
+#define APP_FILE_PIXEL_RECTS_H_INCLUDED
+#pragma once
+
+#include "app/file/file.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+
+namespace app {
+
+  // Size of the stdio buffer for text formats (SVG/CSS) that write a
+  // lot of small strings, so the file is written in big chunks.
+  constexpr std::size_t kTextFormatBufferSize = 256*1024;
+
+  struct PixelRect {
+    int x, y, w, h;
+    doc::color_t color;
+  };
+
+  // Calls addRect(const PixelRect&) for each visible pixel of the
+  // image (1x1 rectangles in row order), or if "merge" is true, for
+  // each rectangle of pixels with the same color: pixels are merged
+  // in horizontal runs, and runs of consecutive rows with the same
+  // position/width/color are merged in one rectangle (in this case
+  // rectangles are not reported in a specific order).
+  template<typename ImageTraits, typename IsVisible, typename AddRect>
+  void for_each_pixel_rect(const doc::Image* image,
+                           const bool merge,
+                           IsVisible isVisible,
+                           AddRect addRect,
+                           FileOp* fop) {
+    using address_t = typename ImageTraits::const_address_t;
+    const int w = image->width();
+    const int h = image->height();
+
+    if (!merge) {
+      for (int y=0; y<h; ++y) {
+        auto it = (address_t)image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x) {
+          if (isVisible(it[x]))
+            addRect(PixelRect{ x, y, 1, 1, doc::color_t(it[x]) });
+        }
+        fop->setProgress((float)y / (float)h);
+        if (fop->isStop())
+          return;
+      }
+      return;
+    }
+
+    // Rectangles that can be extended with runs of the next row
+    // (sorted by x)
+    std::vector<PixelRect> open, next;
+
+    for (int y=0; y<h; ++y) {
+      auto it = (address_t)image->getPixelAddress(0, y);
+      auto o = open.begin();
+      next.clear();
+
+      for (int x=0; x<w; ) {
+        const doc::color_t c = it[x];
+        if (!isVisible(c)) {
+          ++x;
+          continue;
+        }
+
+        const int x0 = x;
+        while (x < w && it[x] == c)
+          ++x;
+
+        // Close the rectangles of the previous row at the left of
+        // this run
+        for (; o != open.end() && o->x < x0; ++o)
+          addRect(*o);
+
+        if (o != open.end() &&
+            o->x == x0 && o->w == x-x0 && o->color == c) {
+          ++o->h;
+          next.push_back(*o);
+          ++o;
+        }
+        else
+          next.push_back(PixelRect{ x0, y, x-x0, 1, c });
+      }
+
+      for (; o != open.end(); ++o)
+        addRect(*o);
+      std::swap(open, next);
+
+      fop->setProgress((float)y / (float)h);
+      if (fop->isStop())
+        return;
+    }
+
+    for (const PixelRect& rc : open)
+      addRect(rc);
+  }
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,14 +16,17 @@
 #include "app/file/format_options.h"
 #include "app/file/png_format.h"
 #include "app/file/png_options.h"
+#include "app/pref/preferences.h"
 #include "base/file_handle.h"
 #include "doc/doc.h"
 #include "gfx/color_space.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <vector>
 
 #include "png.h"
+#include "zlib.h"
 
 #define PNG_TRACE(...) // TRACE
 
@@ -55,7 +58,10 @@ class PngFormat : public FileFormat {
       FILE_SUPPORT_INDEXED |
       FILE_SUPPORT_SEQUENCES |
       FILE_SUPPORT_PALETTE_WITH_ALPHA |
-      FILE_ENCODE_ABSTRACT_IMAGE;
+      FILE_ENCODE_ABSTRACT_IMAGE |
+      FILE_ENCODE_PARALLEL_SEQUENCES |
+      FILE_DECODE_PARALLEL_SEQUENCES |
+      FILE_ENCODE_SCANLINES;
   }
 
   bool onLoad(FileOp* fop) override;
@@ -584,6 +590,24 @@ bool PngFormat::onSave(FileOp* fop)
   png_set_IHDR(png, info, width, height, 8, color_type,
                PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
 
+  // Speed vs size (the default preset uses the libpng defaults)
+  switch (fop->config().pngPreset) {
+    case gen::PngPreset::FAST:
+      png_set_filter(png, PNG_FILTER_TYPE_BASE, PNG_FILTER_NONE);
+      png_set_compression_level(png, Z_BEST_SPEED);
+      break;
+    case gen::PngPreset::SMALL:
+      // Indexed images are usually smaller without filters
+      png_set_filter(png, PNG_FILTER_TYPE_BASE,
+                     (color_type == PNG_COLOR_TYPE_PALETTE ? PNG_FILTER_NONE:
+                                                             PNG_ALL_FILTERS));
+      png_set_compression_level(png, Z_BEST_COMPRESSION);
+      png_set_compression_mem_level(png, MAX_MEM_LEVEL);
+      break;
+    default:
+      break;
+  }
+
   // User chunks
   auto opts = fop->formatOptionsOfDocument<PngOptions>();
   if (opts && !opts->isEmpty()) {
@@ -665,8 +689,23 @@ bool PngFormat::onSave(FileOp* fop)
 
   row_pointer = (png_bytep)png_malloc(png, png_get_rowbytes(png, info));
 
+  // Palette of indexed images converted to RGBA (to fix one alpha
+  // pixel), so we don't need to get each pixel color from the FileOp.
+  std::vector<color_t> rgba_palette;
+  if (spec.colorMode() == ColorMode::INDEXED &&
+      color_type == PNG_COLOR_TYPE_RGB_ALPHA) {
+    rgba_palette.resize(256);
+    for (int c=0; c<256; ++c) {
+      int r, g, b, a;
+      fop->sequenceGetColor(c, &r, &g, &b);
+      fop->sequenceGetAlpha(c, &a);
+      rgba_palette[c] = rgba(r, g, b, a);
+    }
+  }
+
   for (png_uint_32 y=0; y<height; ++y) {
     uint8_t* dst_address = row_pointer;
+    png_bytep row = row_pointer;
 
     if (png_get_color_type(png, info) == PNG_COLOR_TYPE_RGB_ALPHA) {
       unsigned int x, c, a;
@@ -696,14 +735,14 @@ bool PngFormat::onSave(FileOp* fop)
       // to convert one pixel with alpha=254.
       else if (spec.colorMode() == ColorMode::INDEXED) {
         auto src_address = (const uint8_t*)img->getScanline(y);
-        unsigned int x, c;
-        int r, g, b, a;
+        unsigned int x;
+        color_t c;
+        int a;
         bool opaque = true;
 
         for (x=0; x<width; ++x) {
-          c = *(src_address++);
-          fop->sequenceGetColor(c, &r, &g, &b);
-          fop->sequenceGetAlpha(c, &a);
+          c = rgba_palette[*(src_address++)];
+          a = rgba_geta(c);
 
           if (opaque) {
             if (a < 255)
@@ -712,9 +751,9 @@ bool PngFormat::onSave(FileOp* fop)
               a = 254;
           }
 
-          *(dst_address++) = r;
-          *(dst_address++) = g;
-          *(dst_address++) = b;
+          *(dst_address++) = rgba_getr(c);
+          *(dst_address++) = rgba_getg(c);
+          *(dst_address++) = rgba_getb(c);
           *(dst_address++) = a;
         }
       }
@@ -760,14 +799,12 @@ bool PngFormat::onSave(FileOp* fop)
       }
     }
     else if (png_get_color_type(png, info) == PNG_COLOR_TYPE_PALETTE) {
-      auto src_address = (const uint8_t*)img->getScanline(y);
-      unsigned int x;
-
-      for (x=0; x<width; ++x)
-        *(dst_address++) = *(src_address++);
+      // Indexed rows are written directly from the image (libpng
+      // copies the row, it's not modified)
+      row = (png_bytep)img->getScanline(y);
     }
 
-    png_write_rows(png, &row_pointer, 1);
+    png_write_rows(png, &row, 1);
 
     fop->setProgress((double)(y+1) / (double)(height));
   }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -7,6 +7,7 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "base/file_handle.h"
+#include "base/thread_pool.h"
 #include "doc/blend_mode.h"
 #include "doc/image_impl.h"
 #include "doc/layer.h"
@@ -15,6 +16,12 @@
 #include "doc/sprite.h"
 #include "psd/psd.h"
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 namespace app {
 
 doc::PixelFormat psd_cmode_to_ase_format(const psd::ColorMode mode)
@@ -97,9 +104,117 @@ FileFormat* CreatePsdFormat()
   return new PsdFormat();
 }
 
+static std::uint8_t get_normalized_pixel_value(const std::uint8_t*& data,
+                                               const int depth)
+{
+  if (depth == 1 || depth == 8) {
+    return *(data++);
+  }
+  else if (depth == 16) {
+    const uint16_t value = int(data[0]) | int(data[1] << 8);
+    data += 2;
+    return value >> 8;
+  }
+  else if (depth == 32) {
+    const uint32_t value = int(data[0] << 24) | int(data[1] << 16) |
+                           int(data[2] << 8) | int(data[3]);
+    data += 4;
+    return value >> 24;
+  }
+  else
+    throw std::runtime_error("invalid image depth");
+}
+
+// Channel scanlines of one layer image as they come from the PSD
+// decoder. They are copied to the doc::Image later (and in other
+// thread) when all the channels of the layer were read.
+struct PsdLayerPixels {
+  struct Row {
+    int y;
+    int depth;
+    psd::ChannelID chanID;
+    std::vector<uint8_t> data;
+  };
+
+  doc::ImageRef image;
+  bool hasTransparentChannel = false;
+  std::vector<Row> rows;
+
+  void convert() const
+  {
+    for (const Row& row : rows)
+      convertRow(row);
+  }
+
+private:
+  void convertRow(const Row& row) const
+  {
+    const int dataCount =
+      int(row.data.size()) / (row.depth >= 8 ? (row.depth / 8) : 1);
+    const int width = std::min(dataCount, image->width());
+    const uint8_t* data = row.data.data();
+    uint8_t* dstGenericAddress = image->getPixelAddress(0, row.y);
+
+    if (image->pixelFormat() == doc::PixelFormat::IMAGE_INDEXED) {
+      IndexedTraits::address_t dstAddress =
+        (IndexedTraits::address_t)dstGenericAddress;
+      for (int x = 0; x < width; ++x) {
+        *(dstAddress)++ = get_normalized_pixel_value(data, row.depth);
+      }
+    }
+    else if (image->pixelFormat() == doc::PixelFormat::IMAGE_GRAYSCALE) {
+      GrayscaleTraits::address_t dstAddress =
+        (GrayscaleTraits::address_t)dstGenericAddress;
+      uint8_t v = 0, a = 0;
+      for (int x = 0; x < width; ++x) {
+        const GrayscaleTraits::pixel_t pixel = *dstAddress;
+        const uint8_t newPixelValue =
+          get_normalized_pixel_value(data, row.depth);
+        if (row.chanID == psd::ChannelID::Red) {
+          v = newPixelValue;
+          a = hasTransparentChannel ? graya_geta(pixel) : 255;
+        }
+        else if (row.chanID == psd::ChannelID::Alpha ||
+                 row.chanID == psd::ChannelID::TransparencyMask) {
+          a = newPixelValue;
+          v = graya_getv(pixel);
+        }
+        *(dstAddress++) = graya(v, a);
+      }
+    }
+    else if (image->pixelFormat() == doc::PixelFormat::IMAGE_RGB) {
+      RgbTraits::address_t dstAddress = (RgbTraits::address_t)dstGenericAddress;
+      uint8_t r, g, b, a;
+      for (int x = 0; x < width; ++x) {
+        const uint8_t newPixelValue =
+          get_normalized_pixel_value(data, row.depth);
+        const color_t c = *(dstAddress);
+        r = rgba_getr(c);
+        g = rgba_getg(c);
+        b = rgba_getb(c);
+        a = hasTransparentChannel ? rgba_geta(c) : 255;
+        if (row.chanID == psd::ChannelID::Red) {
+          r = newPixelValue;
+        }
+        else if (row.chanID == psd::ChannelID::Green) {
+          g = newPixelValue;
+        }
+        else if (row.chanID == psd::ChannelID::Blue) {
+          b = newPixelValue;
+        }
+        else if (row.chanID == psd::ChannelID::Alpha ||
+                 row.chanID == psd::ChannelID::TransparencyMask) {
+          a = newPixelValue;
+        }
+        *(dstAddress++) = rgba(r, g, b, a);
+      }
+    }
+  }
+};
+
 class PsdDecoderDelegate : public psd::DecoderDelegate {
 public:
-  PsdDecoderDelegate()
+  PsdDecoderDelegate(const bool skipHiddenLayers)
     : m_currentImage(nullptr)
     , m_currentLayer(nullptr)
     , m_layerGroup(nullptr)
@@ -107,9 +222,28 @@ public:
     , m_activeFrameIndex(0)
     , m_pixelFormat(PixelFormat::IMAGE_INDEXED)
     , m_layerHasTransparentChannel(false)
-  { }
+    , m_skipHiddenLayers(skipHiddenLayers)
+    , m_skipLayer(false)
+  {
+    // The channels of each layer are converted to doc::Images in a
+    // thread pool while the decoder reads the next layers.
+    const int threads = std::thread::hardware_concurrency();
+    if (threads >= 2)
+      m_pool = std::make_unique<base::thread_pool>(threads);
+  }
+
+  ~PsdDecoderDelegate() { waitPendingPixels(); }
+
+  Sprite* getSprite()
+  {
+    flushPixels();
+    waitPendingPixels();
+    return assembleDocument();
+  }
 
-  Sprite* getSprite() { return assembleDocument(); }
+  // Error converting some layer in the thread pool (e.g. invalid
+  // image depth), must be checked after getSprite().
+  const std::string& error() const { return m_error; }
 
   void onFileHeader(const psd::FileHeader& header) override
   {
@@ -182,10 +316,16 @@ public:
       else
         m_layerGroup = m_groups.back();
     }
+    else if (m_skipHiddenLayers && !layerRecord.isVisible()) {
+      // Keep a null entry so the records in onLayersAndMask() still
+      // match the m_layers indexes
+      m_layers.push_back(nullptr);
+      m_skipLayer = true;
+    }
     else {
       auto findIter = std::find_if(
         m_layers.begin(), m_layers.end(), [&layerRecord](doc::Layer* layer) {
-          return layer->name() == layerRecord.name;
+          return layer && layer->name() == layerRecord.name;
         });
       if (findIter == m_layers.end()) {
         if (!m_layerGroup)  // In this case, there are no layer groups
@@ -199,12 +339,19 @@ public:
       else {
         m_currentLayer = *findIter;
         m_currentImage = m_currentLayer->cel(frame_t(0))->imageRef();
+
+        // The image might be being converted in the thread pool
+        waitPendingPixels();
       }
     }
   }
 
   void onEndLayer(const psd::LayerRecord& layerRecord) override
   {
+    // Cels in other frames share the pixels of this image, so the
+    // conversion can continue in background
+    flushPixels();
+
     if (!m_framesInfo.empty() &&
         (layerRecord.inFrames.size() == m_framesInfo.size()) &&
         m_currentImage) {
@@ -232,6 +379,7 @@ public:
     m_currentImage.reset();
     m_currentLayer = nullptr;
     m_layerHasTransparentChannel = false;
+    m_skipLayer = false;
   }
 
   // Emitted only if there's a palette in an image
@@ -248,6 +396,9 @@ public:
   // Emitted when an image data is about to be transmitted
   void onBeginImage(const psd::ImageData& imageData) override
   {
+    if (m_skipLayer)
+      return;
+
     if (!m_currentImage) {
       // Only occurs where there's an image with no layer
       if (m_layers.empty()) {
@@ -271,6 +422,9 @@ public:
         const psd::LayerRecord& layerRecord = layersInfo.layers[i];
 
         LayerImage* layer = static_cast<LayerImage*>(m_layers[i]);
+        if (!layer)  // Skipped hidden layer
+          continue;
+
         layer->setBlendMode(psd_blendmode_to_ase(layerRecord.blendMode));
 
         for (size_t i = 0; i < m_sprite->totalFrames(); ++i) {
@@ -293,61 +447,16 @@ public:
     if (!m_currentImage || y >= m_currentImage->height())
       return;
 
-    const int dataCount = bytes / (img.depth >= 8 ? (img.depth / 8) : 1);
-    uint8_t* dstGenericAddress = m_currentImage->getPixelAddress(0, y);
-
-    if (m_pixelFormat == doc::PixelFormat::IMAGE_INDEXED) {
-      IndexedTraits::address_t dstAddress =
-        (IndexedTraits::address_t)dstGenericAddress;
-      for (int x = 0; x < dataCount && x < m_currentImage->width(); ++x) {
-        *(dstAddress)++ = getNormalizedPixelValue(data, img.depth);
-      }
-    }
-    else if (m_pixelFormat == doc::PixelFormat::IMAGE_GRAYSCALE) {
-      GrayscaleTraits::address_t dstAddress =
-        (GrayscaleTraits::address_t)dstGenericAddress;
-      uint8_t v = 0, a = 0;
-      for (int x = 0; x < dataCount && x < m_currentImage->width(); ++x) {
-        const GrayscaleTraits::pixel_t pixel = *dstAddress;
-        const uint8_t newPixelValue = getNormalizedPixelValue(data, img.depth);
-        if (chanID == psd::ChannelID::Red) {
-          v = newPixelValue;
-          a = m_layerHasTransparentChannel ? graya_geta(pixel) : 255;
-        }
-        else if (chanID == psd::ChannelID::Alpha ||
-                 chanID == psd::ChannelID::TransparencyMask) {
-          a = newPixelValue;
-          v = graya_getv(pixel);
-        }
-        *(dstAddress++) = graya(v, a);
-      }
-    }
-    else if (m_pixelFormat == doc::PixelFormat::IMAGE_RGB) {
-      RgbTraits::address_t dstAddress = (RgbTraits::address_t)dstGenericAddress;
-      uint8_t r, g, b, a;
-      for (int x = 0; x < dataCount && x < m_currentImage->width(); ++x) {
-        const uint8_t newPixelValue = getNormalizedPixelValue(data, img.depth);
-        const color_t c = *(dstAddress);
-        r = rgba_getr(c);
-        g = rgba_getg(c);
-        b = rgba_getb(c);
-        a = m_layerHasTransparentChannel ? rgba_geta(c) : 255;
-        if (chanID == psd::ChannelID::Red) {
-          r = newPixelValue;
-        }
-        else if (chanID == psd::ChannelID::Green) {
-          g = newPixelValue;
-        }
-        else if (chanID == psd::ChannelID::Blue) {
-          b = newPixelValue;
-        }
-        else if (chanID == psd::ChannelID::Alpha ||
-                 chanID == psd::ChannelID::TransparencyMask) {
-          a = newPixelValue;
-        }
-        *(dstAddress++) = rgba(r, g, b, a);
-      }
+    // Only the decoder thread collects the channel scanlines, the
+    // conversion to doc::Image pixels is done in flushPixels()
+    if (!m_pixels) {
+      m_pixels = std::make_shared<PsdLayerPixels>();
+      m_pixels->image = m_currentImage;
+      m_pixels->hasTransparentChannel = m_layerHasTransparentChannel;
     }
+    m_pixels->rows.push_back(
+      PsdLayerPixels::Row{ y, img.depth, chanID,
+                           std::vector<uint8_t>(data, data + bytes) });
   }
 
 private:
@@ -388,25 +497,46 @@ private:
     return m_sprite;
   }
 
-  std::uint8_t getNormalizedPixelValue(const std::uint8_t*& data,
-                                       const int depth)
+  // Converts the collected channels of the current image in the
+  // thread pool (or in this same thread if there is no pool).
+  void flushPixels()
   {
-    if (depth == 1 || depth == 8) {
-      return *(data++);
-    }
-    else if (depth == 16) {
-      const uint16_t value = int(data[0]) | int(data[1] << 8);
-      data += 2;
-      return value >> 8;
+    if (!m_pixels)
+      return;
+
+    std::shared_ptr<PsdLayerPixels> pixels;
+    std::swap(pixels, m_pixels);
+
+    if (!m_pool) {
+      pixels->convert();
+      return;
     }
-    else if (depth == 32) {
-      const uint32_t value = int(data[0] << 24) | int(data[1] << 16) |
-                             int(data[2] << 8) | int(data[3]);
-      data += 4;
-      return value >> 24;
+
+    {
+      const std::lock_guard lock(m_mutex);
+      ++m_pending;
     }
-    else
-      throw std::runtime_error("invalid image depth");
+    m_pool->execute([this, pixels]{
+      std::string error;
+      try {
+        pixels->convert();
+      }
+      catch (const std::exception& e) {
+        error = e.what();
+      }
+
+      const std::lock_guard lock(m_mutex);
+      if (!error.empty() && m_error.empty())
+        m_error = error;
+      --m_pending;
+      m_cv.notify_all();
+    });
+  }
+
+  void waitPendingPixels()
+  {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this]{ return m_pending == 0; });
   }
 
   void createNewImage(const int width, const int height)
@@ -429,6 +559,15 @@ private:
   std::vector<psd::FrameInformation> m_framesInfo;
   Palette m_palette;
   bool m_layerHasTransparentChannel;
+  bool m_skipHiddenLayers;
+  bool m_skipLayer;
+
+  std::shared_ptr<PsdLayerPixels> m_pixels;
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  int m_pending = 0;
+  std::string m_error;
+  std::unique_ptr<base::thread_pool> m_pool;
 };
 
 bool PsdFormat::onLoad(FileOp* fop)
@@ -437,7 +576,7 @@ bool PsdFormat::onLoad(FileOp* fop)
     base::open_file_with_exception(fop->filename(), "rb");
   FILE* f = fileHandle.get();
   psd::StdioFileInterface fileInterface(f);
-  PsdDecoderDelegate pDelegate;
+  PsdDecoderDelegate pDelegate(fop->config().psdSkipHiddenLayers);
   psd::Decoder decoder(&fileInterface, &pDelegate);
 
   if (!decoder.readFileHeader()) {
@@ -466,7 +605,14 @@ bool PsdFormat::onLoad(FileOp* fop)
     return false;
   }
 
-  fop->createDocument(pDelegate.getSprite());
+  Sprite* sprite = pDelegate.getSprite();
+  if (!pDelegate.error().empty()) {
+    fop->setError("%s\n", pDelegate.error().c_str());
+    delete sprite;
+    return false;
+  }
+
+  fop->createDocument(sprite);
   return true;
 }
 
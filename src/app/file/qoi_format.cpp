@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -16,10 +16,94 @@
 #define QOI_IMPLEMENTATION
 #include "qoi.h"
 
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
 namespace app {
 
 using namespace base;
 
+namespace {
+
+// The QOI pixels are decoded/encoded directly from/to the doc::Image
+// rows, reading/writing the file in chunks, so we don't need a buffer
+// for the whole encoded file nor for the whole decoded image (as
+// qoi_decode()/qoi_encode() do).
+
+const int kChunkSize = 64*1024;
+
+struct QoiPixel {
+  uint8_t r = 0, g = 0, b = 0, a = 255;
+
+  bool operator==(const QoiPixel& o) const {
+    return r == o.r && g == o.g && b == o.b && a == o.a;
+  }
+  bool operator!=(const QoiPixel& o) const { return !operator==(o); }
+
+  int hash() const { return (r*3 + g*5 + b*7 + a*11) % 64; }
+};
+
+class QoiReader {
+public:
+  QoiReader(FILE* f) : m_f(f), m_buf(kChunkSize) { }
+
+  uint8_t read8() {
+    if (m_pos == m_end) {
+      m_pos = 0;
+      m_end = fread(m_buf.data(), 1, m_buf.size(), m_f);
+      if (m_end == 0)
+        throw std::runtime_error("Unexpected end of file");
+    }
+    return m_buf[m_pos++];
+  }
+
+  uint32_t read32() {
+    uint32_t v = read8() << 24;
+    v |= read8() << 16;
+    v |= read8() << 8;
+    return v | read8();
+  }
+
+private:
+  FILE* m_f;
+  std::vector<uint8_t> m_buf;
+  size_t m_pos = 0;
+  size_t m_end = 0;
+};
+
+class QoiWriter {
+public:
+  QoiWriter(FILE* f) : m_f(f) { m_buf.reserve(kChunkSize); }
+  ~QoiWriter() { flush(); }
+
+  void write8(const uint8_t v) {
+    m_buf.push_back(v);
+    if (m_buf.size() >= kChunkSize)
+      flush();
+  }
+
+  void write32(const uint32_t v) {
+    write8((v >> 24) & 0xff);
+    write8((v >> 16) & 0xff);
+    write8((v >> 8) & 0xff);
+    write8(v & 0xff);
+  }
+
+  void flush() {
+    if (!m_buf.empty()) {
+      fwrite(m_buf.data(), 1, m_buf.size(), m_f);
+      m_buf.clear();
+    }
+  }
+
+private:
+  FILE* m_f;
+  std::vector<uint8_t> m_buf;
+};
+
+} // anonymous namespace
+
 class QoiFormat : public FileFormat {
   const char* onGetName() const override {
     return "qoi";
@@ -40,7 +124,9 @@ class QoiFormat : public FileFormat {
       FILE_SUPPORT_RGB |
       FILE_SUPPORT_RGBA |
       FILE_SUPPORT_SEQUENCES |
-      FILE_ENCODE_ABSTRACT_IMAGE;
+      FILE_ENCODE_ABSTRACT_IMAGE |
+      FILE_ENCODE_PARALLEL_SEQUENCES |
+      FILE_DECODE_PARALLEL_SEQUENCES;
   }
 
   bool onLoad(FileOp* fop) override;
@@ -58,22 +144,26 @@ bool QoiFormat::onLoad(FileOp* fop)
 {
   FileHandle handle(open_file_with_exception(fop->filename(), "rb"));
   FILE* f = handle.get();
+  QoiReader reader(f);
 
-  fseek(f, 0, SEEK_END);
-  auto size = ftell(f);
-  if (size <= 0)
-    return false;
-  fseek(f, 0, SEEK_SET);
-
-  auto data = QOI_MALLOC(size);
-  if (!data)
+  qoi_desc desc;
+  try {
+    if (reader.read32() != QOI_MAGIC)
+      return false;
+
+    desc.width = reader.read32();
+    desc.height = reader.read32();
+    desc.channels = reader.read8();
+    desc.colorspace = reader.read8();
+  }
+  catch (const std::runtime_error&) {
     return false;
+  }
 
-  qoi_desc desc;
-  auto bytes_read = fread(data, 1, size, f);
-  auto pixels = qoi_decode(data, bytes_read, &desc, 0);
-  QOI_FREE(data);
-  if (!pixels)
+  if (desc.width == 0 || desc.height == 0 ||
+      desc.channels < 3 || desc.channels > 4 ||
+      desc.colorspace > 1 ||
+      desc.height >= QOI_PIXELS_MAX / desc.width)
     return false;
 
   ImageRef image = fop->sequenceImageToLoad(
@@ -83,26 +173,64 @@ bool QoiFormat::onLoad(FileOp* fop)
   if (!image)
     return false;
 
-  auto src = (const uint8_t*)pixels;
-  for (int y=0; y<desc.height; ++y) {
-    auto dst = (uint32_t*)image->getPixelAddress(0, y);
-    switch (desc.channels) {
-      case 4:
-        for (int x=0; x<desc.width; ++x, ++dst) {
-          *dst = doc::rgba(src[0], src[1], src[2], src[3]);
-          src += 4;
+  QoiPixel index[64];
+  std::fill(std::begin(index), std::end(index), QoiPixel{ 0, 0, 0, 0 });
+  QoiPixel px;
+  int run = 0;
+
+  try {
+    for (int y=0; y<int(desc.height); ++y) {
+      auto dst = (uint32_t*)image->getPixelAddress(0, y);
+      for (int x=0; x<int(desc.width); ++x, ++dst) {
+        if (run > 0) {
+          --run;
         }
-        break;
-      case 3:
-        for (int x=0; x<desc.width; ++x, ++dst) {
-          *dst = doc::rgba(src[0], src[1], src[2], 255);
-          src += 3;
+        else {
+          const int b1 = reader.read8();
+          if (b1 == QOI_OP_RGB) {
+            px.r = reader.read8();
+            px.g = reader.read8();
+            px.b = reader.read8();
+          }
+          else if (b1 == QOI_OP_RGBA) {
+            px.r = reader.read8();
+            px.g = reader.read8();
+            px.b = reader.read8();
+            px.a = reader.read8();
+          }
+          else if ((b1 & QOI_MASK_2) == QOI_OP_INDEX) {
+            px = index[b1];
+          }
+          else if ((b1 & QOI_MASK_2) == QOI_OP_DIFF) {
+            px.r += ((b1 >> 4) & 0x03) - 2;
+            px.g += ((b1 >> 2) & 0x03) - 2;
+            px.b += ( b1       & 0x03) - 2;
+          }
+          else if ((b1 & QOI_MASK_2) == QOI_OP_LUMA) {
+            const int b2 = reader.read8();
+            const int vg = (b1 & 0x3f) - 32;
+            px.r += vg - 8 + ((b2 >> 4) & 0x0f);
+            px.g += vg;
+            px.b += vg - 8 +  (b2       & 0x0f);
+          }
+          else if ((b1 & QOI_MASK_2) == QOI_OP_RUN) {
+            run = (b1 & 0x3f);
+          }
+          index[px.hash()] = px;
         }
+        *dst = doc::rgba(px.r, px.g, px.b,
+                         desc.channels == 4 ? px.a: 255);
+      }
+
+      fop->setProgress(float(y+1) / float(desc.height));
+      if (fop->isStop())
         break;
     }
   }
-
-  QOI_FREE(pixels);
+  catch (const std::runtime_error& e) {
+    fop->setError("%s\n", e.what());
+    return false;
+  }
 
   if (desc.channels == 4)
     fop->sequenceSetHasAlpha(true);
@@ -140,7 +268,6 @@ bool QoiFormat::onSave(FileOp* fop)
   const FileAbstractImage* img = fop->abstractImageToSave();
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
-  doc::ImageRef image = img->getScaledImage();
 
   qoi_desc desc;
   desc.width = img->width();
@@ -156,44 +283,94 @@ bool QoiFormat::onSave(FileOp* fop)
     desc.colorspace = QOI_LINEAR;
   }
 
-  auto pixels = (uint8_t*)QOI_MALLOC(desc.width * desc.height * desc.channels);
-  if (!pixels)
-    return false;
-
-  auto dst = pixels;
-  for (int y=0; y<desc.height; ++y) {
-    auto src = (uint32_t*)image->getPixelAddress(0, y);
-    switch (desc.channels) {
-      case 4:
-        for (int x=0; x<desc.width; ++x, ++src) {
-          uint32_t c = *src;
-          dst[0] = doc::rgba_getr(c);
-          dst[1] = doc::rgba_getg(c);
-          dst[2] = doc::rgba_getb(c);
-          dst[3] = doc::rgba_geta(c);
-          dst += 4;
+  QoiWriter writer(f);
+  writer.write32(QOI_MAGIC);
+  writer.write32(desc.width);
+  writer.write32(desc.height);
+  writer.write8(desc.channels);
+  writer.write8(desc.colorspace);
+
+  QoiPixel index[64];
+  std::fill(std::begin(index), std::end(index), QoiPixel{ 0, 0, 0, 0 });
+  QoiPixel prev;
+  int run = 0;
+
+  for (int y=0; y<int(desc.height); ++y) {
+    auto src = (const uint32_t*)img->getScanline(y);
+    const bool lastRow = (y == int(desc.height)-1);
+
+    for (int x=0; x<int(desc.width); ++x, ++src) {
+      const uint32_t c = *src;
+      QoiPixel px;
+      px.r = doc::rgba_getr(c);
+      px.g = doc::rgba_getg(c);
+      px.b = doc::rgba_getb(c);
+      if (desc.channels == 4)
+        px.a = doc::rgba_geta(c);
+
+      if (px == prev) {
+        ++run;
+        if (run == 62 || (lastRow && x == int(desc.width)-1)) {
+          writer.write8(QOI_OP_RUN | (run - 1));
+          run = 0;
         }
-        break;
-      case 3:
-        for (int x=0; x<desc.width; ++x, ++src) {
-          uint32_t c = *src;
-          dst[0] = doc::rgba_getr(c);
-          dst[1] = doc::rgba_getg(c);
-          dst[2] = doc::rgba_getb(c);
-          dst += 3;
+        continue;
+      }
+
+      if (run > 0) {
+        writer.write8(QOI_OP_RUN | (run - 1));
+        run = 0;
+      }
+
+      const int i = px.hash();
+      if (index[i] == px) {
+        writer.write8(QOI_OP_INDEX | i);
+      }
+      else {
+        index[i] = px;
+
+        if (px.a == prev.a) {
+          const int8_t vr = px.r - prev.r;
+          const int8_t vg = px.g - prev.g;
+          const int8_t vb = px.b - prev.b;
+          const int8_t vg_r = vr - vg;
+          const int8_t vg_b = vb - vg;
+
+          if (vr > -3 && vr < 2 &&
+              vg > -3 && vg < 2 &&
+              vb > -3 && vb < 2) {
+            writer.write8(QOI_OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2));
+          }
+          else if (vg_r >  -9 && vg_r <  8 &&
+                   vg   > -33 && vg   < 32 &&
+                   vg_b >  -9 && vg_b <  8) {
+            writer.write8(QOI_OP_LUMA | (vg + 32));
+            writer.write8((vg_r + 8) << 4 | (vg_b + 8));
+          }
+          else {
+            writer.write8(QOI_OP_RGB);
+            writer.write8(px.r);
+            writer.write8(px.g);
+            writer.write8(px.b);
+          }
         }
-        break;
+        else {
+          writer.write8(QOI_OP_RGBA);
+          writer.write8(px.r);
+          writer.write8(px.g);
+          writer.write8(px.b);
+          writer.write8(px.a);
+        }
+      }
+      prev = px;
     }
-  }
 
-  int size = 0;
-  auto encoded = qoi_encode(pixels, &desc, &size);
-  QOI_FREE(pixels);
-  if (!encoded)
-    return false;
+    fop->setProgress(float(y+1) / float(desc.height));
+  }
 
-  fwrite(encoded, 1, size, f);
-  QOI_FREE(encoded);
+  for (int i=0; i<int(sizeof(qoi_padding)); ++i)
+    writer.write8(qoi_padding[i]);
+  writer.flush();
 
   if (ferror(handle.get())) {
     fop->setError("Error writing file.\n");
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2018-2023  Igara Studio S.A.
+// Copyright (c) 2018-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -15,6 +15,7 @@
 #include "app/file/file.h"
 #include "app/file/file_format.h"
 #include "app/file/format_options.h"
+#include "app/file/pixel_rects.h"
 #include "app/pref/preferences.h"
 #include "base/cfile.h"
 #include "base/file_handle.h"
@@ -31,8 +32,9 @@ class SvgFormat : public FileFormat {
   // Data for SVG files
   class SvgOptions : public FormatOptions {
   public:
-    SvgOptions() : pixelScale(1) { }
+    SvgOptions() : pixelScale(1), mergeRects(true) { }
     int pixelScale;
+    bool mergeRects;
   };
 
   const char* onGetName() const override {
@@ -82,14 +84,16 @@ bool SvgFormat::onLoad(FileOp* fop)
 bool SvgFormat::onSave(FileOp* fop)
 {
   const ImageRef image = fop->sequenceImageToSave();
-  int x, y, c, r, g, b, a, alpha;
+  int y, r, g, b, a;
   const auto svg_options = std::static_pointer_cast<SvgOptions>(fop->formatOptions());
   const int pixelScaleValue = std::clamp(svg_options->pixelScale, 0, 10000);
+  const bool merge = svg_options->mergeRects;
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
   FILE* f = handle.get();
-  auto printcol = [f](int x, int y,int r, int g, int b, int a, int pxScale) {
+  setvbuf(f, nullptr, _IOFBF, kTextFormatBufferSize);
+  auto printrect = [f](const PixelRect& rc, int r, int g, int b, int a, int pxScale) {
     fprintf(f, "<rect x=\"%d\" y=\"%d\" width=\"%d\" height=\"%d\" fill=\"#%02X%02X%02X\" ",
-            x*pxScale, y*pxScale, pxScale, pxScale, r, g, b);
+            rc.x*pxScale, rc.y*pxScale, rc.w*pxScale, rc.h*pxScale, r, g, b);
     if (a != 255)
       fprintf(f, "opacity=\"%f\" ", (float)a / 255.0);
     fprintf(f, "/>\n");
@@ -101,28 +105,23 @@ bool SvgFormat::onSave(FileOp* fop)
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<RgbTraits>(image.get(), x, y);
-          alpha = rgba_geta(c);
-          if (alpha != 0x00)
-            printcol(x, y, rgba_getr(c), rgba_getg(c), rgba_getb(c), alpha, pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+      for_each_pixel_rect<RgbTraits>(
+        image.get(), merge,
+        [](color_t c){ return rgba_geta(c) != 0x00; },
+        [&](const PixelRect& rc){
+          printrect(rc, rgba_getr(rc.color), rgba_getg(rc.color), rgba_getb(rc.color),
+                    rgba_geta(rc.color), pixelScaleValue);
+        }, fop);
       break;
     }
     case IMAGE_GRAYSCALE: {
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<GrayscaleTraits>(image.get(), x, y);
-          auto v = graya_getv(c);
-          alpha = graya_geta(c);
-          if (alpha != 0x00)
-            printcol(x, y, v, v, v, alpha, pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+      for_each_pixel_rect<GrayscaleTraits>(
+        image.get(), merge,
+        [](color_t c){ return graya_geta(c) != 0x00; },
+        [&](const PixelRect& rc){
+          const int v = graya_getv(rc.color);
+          printrect(rc, v, v, v, graya_geta(rc.color), pixelScaleValue);
+        }, fop);
       break;
     }
     case IMAGE_INDEXED: {
@@ -140,18 +139,13 @@ bool SvgFormat::onSave(FileOp* fop)
           !fop->document()->sprite()->backgroundLayer()->isVisible()) {
         mask_color = fop->document()->sprite()->transparentColor();
       }
-      for (y=0; y<image->height(); y++) {
-        for (x=0; x<image->width(); x++) {
-          c = get_pixel_fast<IndexedTraits>(image.get(), x, y);
-          if (c != mask_color)
-            printcol(x, y, image_palette[c][0] & 0xff,
-                     image_palette[c][1] & 0xff,
-                     image_palette[c][2] & 0xff,
-                     image_palette[c][3] & 0xff,
-                     pixelScaleValue);
-        }
-        fop->setProgress((float)y / (float)(image->height()));
-      }
+      for_each_pixel_rect<IndexedTraits>(
+        image.get(), merge,
+        [mask_color](color_t c){ return c != mask_color; },
+        [&](const PixelRect& rc){
+          const unsigned char* col = image_palette[rc.color];
+          printrect(rc, col[0], col[1], col[2], col[3], pixelScaleValue);
+        }, fop);
       break;
     }
   }
@@ -178,16 +172,22 @@ FormatOptionsPtr SvgFormat::onAskUserForFormatOptions(FileOp* fop)
       if (pref.isSet(pref.svg.pixelScale))
         opts->pixelScale = pref.svg.pixelScale();
 
+      if (pref.isSet(pref.svg.mergeRects))
+        opts->mergeRects = pref.svg.mergeRects();
+
      if (pref.svg.showAlert()) {
         app::gen::SvgOptions win;
         win.pxsc()->setTextf("%d", opts->pixelScale);
+        win.mergeRects()->setSelected(opts->mergeRects);
         win.openWindowInForeground();
 
         if (win.closer() == win.ok()) {
           pref.svg.pixelScale((int)win.pxsc()->textInt());
+          pref.svg.mergeRects(win.mergeRects()->isSelected());
           pref.svg.showAlert(!win.dontShow()->isSelected());
 
           opts->pixelScale = pref.svg.pixelScale();
+          opts->mergeRects = pref.svg.mergeRects();
         }
         else {
           opts.reset();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 // Copyright (C) 2015  Gabriel Rauter
 //
@@ -22,6 +22,7 @@
 #include "app/pref/preferences.h"
 #include "base/convert_to.h"
 #include "base/file_handle.h"
+#include "base/thread_pool.h"
 #include "doc/doc.h"
 #include "ui/manager.h"
 
@@ -30,7 +31,12 @@
 #include <cstdio>
 #include <cstdlib>
 #include <algorithm>
+#include <condition_variable>
+#include <cstring>
 #include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 #include <webp/demux.h>
 #include <webp/mux.h>
@@ -255,6 +261,152 @@ static int progress_report(int percent, const WebPPicture* pic)
     return true;
 }
 
+// Renders the frame to be encoded by libwebp
+static void render_frame(const FileAbstractImage* sprite,
+                         const FileOp* fop,
+                         const frame_t frame,
+                         Image* image)
+{
+  clear_image(image, image->maskColor());
+  sprite->renderFrame(frame, fop->roi().frameBounds(frame), image);
+
+  // Switch R <-> B channels because WebPAnimEncoderAssemble()
+  // expects MODE_BGRA pictures.
+  LockImageBits<RgbTraits> bits(image, Image::ReadWriteLock);
+  auto it = bits.begin(), end = bits.end();
+  for (; it != end; ++it) {
+    auto c = *it;
+    *it = rgba(rgba_getb(c), // Use blue in red channel
+               rgba_getg(c),
+               rgba_getr(c), // Use red in blue channel
+               rgba_geta(c));
+  }
+}
+
+// Encodes each frame in a thread pool as an independent keyframe
+// (full canvas, without blending with the previous frame), and then
+// the frames are assembled with the WebPMux API.
+static bool save_keyframes_in_parallel(FileOp* fop,
+                                       FILE* fp,
+                                       const FileAbstractImage* sprite,
+                                       const WebPConfig& config,
+                                       const WebPOptions& opts)
+{
+  struct Keyframe {
+    frame_t frame;
+    WebPMemoryWriter writer;
+    bool ok = false;
+  };
+
+  const int w = sprite->width();
+  const int h = sprite->height();
+
+  std::vector<Keyframe> keyframes;
+  for (frame_t frame : fop->roi().framesSequence()) {
+    keyframes.push_back(Keyframe{ frame });
+    WebPMemoryWriterInit(&keyframes.back().writer);
+  }
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::size_t done = 0;
+  {
+    base::thread_pool pool(std::thread::hardware_concurrency());
+    for (Keyframe& keyframe : keyframes) {
+      Keyframe* kf = &keyframe;
+      pool.execute([&, kf]{
+        bool ok = false;
+        if (!fop->isStop()) {
+          ImageRef image(Image::create(IMAGE_RGB, w, h));
+          render_frame(sprite, fop, kf->frame, image.get());
+
+          WebPPicture pic;
+          WebPPictureInit(&pic);
+          pic.width = w;
+          pic.height = h;
+          pic.use_argb = true;
+          pic.argb = (uint32_t*)image->getPixelAddress(0, 0);
+          pic.argb_stride = image->rowPixels(); // Stride in pixels (not bytes)
+          pic.writer = WebPMemoryWrite;
+          pic.custom_ptr = &kf->writer;
+          ok = WebPEncode(&config, &pic);
+          WebPPictureFree(&pic);
+        }
+
+        const std::lock_guard lock(mutex);
+        kf->ok = ok;
+        ++done;
+        cv.notify_all();
+      });
+    }
+
+    std::unique_lock lock(mutex);
+    while (done < keyframes.size()) {
+      cv.wait(lock);
+      fop->setProgress(double(done) / double(keyframes.size()));
+    }
+  }
+
+  bool result = true;
+  WebPMux* mux = WebPMuxNew();
+
+  WebPMuxAnimParams anim_params;
+  anim_params.bgcolor = 0;
+  anim_params.loop_count =
+    (opts.loop() ? 0:  // 0 = infinite
+                   1); // 1 = loop once
+  if (WebPMuxSetCanvasSize(mux, w, h) != WEBP_MUX_OK ||
+      WebPMuxSetAnimationParams(mux, &anim_params) != WEBP_MUX_OK) {
+    fop->setError("Error in WebP animation parameters\n");
+    result = false;
+  }
+
+  for (const Keyframe& keyframe : keyframes) {
+    if (!result)
+      break;
+
+    if (!keyframe.ok) {
+      if (!fop->isStop())
+        fop->setError("Error saving frame %d info\n", keyframe.frame);
+      result = false;
+      break;
+    }
+
+    WebPMuxFrameInfo info;
+    memset(&info, 0, sizeof(info));
+    info.bitstream.bytes = keyframe.writer.mem;
+    info.bitstream.size = keyframe.writer.size;
+    info.id = WEBP_CHUNK_ANMF;
+    info.duration = sprite->frameDuration(keyframe.frame);
+    info.dispose_method = WEBP_MUX_DISPOSE_NONE;
+    info.blend_method = WEBP_MUX_NO_BLEND;
+    if (WebPMuxPushFrame(mux, &info, 1) != WEBP_MUX_OK) {
+      fop->setError("Error adding frame %d to the WebP animation\n", keyframe.frame);
+      result = false;
+    }
+  }
+
+  WebPData webp_data;
+  WebPDataInit(&webp_data);
+  if (result && WebPMuxAssemble(mux, &webp_data) != WEBP_MUX_OK) {
+    fop->setError("Error assembling the WebP animation\n");
+    result = false;
+  }
+  WebPMuxDelete(mux);
+
+  for (Keyframe& keyframe : keyframes)
+    WebPMemoryWriterClear(&keyframe.writer);
+
+  if (result &&
+      fwrite(webp_data.bytes, 1, webp_data.size, fp) != webp_data.size) {
+    fop->setError("Error saving content into file\n");
+    result = false;
+  }
+
+  WebPDataClear(&webp_data);
+  return result;
+}
+
 bool WebPFormat::onSave(FileOp* fop)
 {
   FileHandle handle(open_file_with_exception_sync_on_close(fop->filename(), "wb"));
@@ -297,6 +449,30 @@ bool WebPFormat::onSave(FileOp* fop)
       break;
   }
 
+  switch (opts->speed()) {
+    case WebPOptions::Speed::Default:
+      break;
+    case WebPOptions::Speed::Fast:
+      config.method = 0;
+      if (config.lossless)
+        config.quality = 0.0f;  // Effort in lossless mode
+      break;
+    case WebPOptions::Speed::Best:
+      config.method = 6;
+      if (config.lossless)
+        config.quality = 100.0f;
+      break;
+  }
+
+  // Use several threads in each frame encoding (when it's possible)
+  config.thread_level = 1;
+
+  if (opts->parallelKeyframes() &&
+      fop->roi().frames() > 1 &&
+      std::thread::hardware_concurrency() >= 2) {
+    return save_keyframes_in_parallel(fop, fp, sprite, config, *opts);
+  }
+
   WebPAnimEncoderOptions enc_options;
   WebPAnimEncoderOptionsInit(&enc_options);
   enc_options.anim_params.loop_count =
@@ -321,22 +497,7 @@ bool WebPFormat::onSave(FileOp* fop)
   int timestamp_ms = 0;
   for (frame_t frame : fop->roi().framesSequence()) {
     // Render the frame in the bitmap
-    clear_image(image.get(), image->maskColor());
-    sprite->renderFrame(frame, fop->roi().frameBounds(frame), image.get());
-
-    // Switch R <-> B channels because WebPAnimEncoderAssemble()
-    // expects MODE_BGRA pictures.
-    {
-      LockImageBits<RgbTraits> bits(image.get(), Image::ReadWriteLock);
-      auto it = bits.begin(), end = bits.end();
-      for (; it != end; ++it) {
-        auto c = *it;
-        *it = rgba(rgba_getb(c), // Use blue in red channel
-                   rgba_getg(c),
-                   rgba_getr(c), // Use red in blue channel
-                   rgba_geta(c));
-      }
-    }
+    render_frame(sprite, fop, frame, image.get());
 
     if (!WebPAnimEncoderAdd(enc, &pic, timestamp_ms, &config)) {
       if (!fop->isStop()) {
@@ -372,6 +533,14 @@ bool WebPFormat::onSave(FileOp* fop)
 FormatOptionsPtr WebPFormat::onAskUserForFormatOptions(FileOp* fop)
 {
   auto opts = fop->formatOptionsOfDocument<WebPOptions>();
+
+  // Speed options are used from the CLI too
+  if (opts) {
+    auto& pref = Preferences::instance();
+    opts->setSpeed(WebPOptions::Speed(std::clamp(pref.webp.speed(), 0, 2)));
+    opts->setParallelKeyframes(pref.webp.parallelKeyframes());
+  }
+
 #ifdef ENABLE_UI
   if (fop->context() && fop->context()->isUIAvailable()) {
     try {
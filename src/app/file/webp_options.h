@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 // Copyright (C) 2015  Gabriel Rauter
 //
@@ -21,6 +22,10 @@ namespace app {
   public:
     enum Type { Simple, Lossless, Lossy };
 
+    // Speed of the encoder (over the lossless/lossy options): Fast
+    // uses the fastest method, Best the slowest one (smaller files).
+    enum class Speed { Default, Fast, Best };
+
     // By default we use 6, because 9 is too slow
     const int kDefaultCompression = 6;
 
@@ -29,7 +34,9 @@ namespace app {
                     m_compression(kDefaultCompression),
                     m_imageHint(WEBP_HINT_DEFAULT),
                     m_quality(100),
-                    m_imagePreset(WEBP_PRESET_DEFAULT) { }
+                    m_imagePreset(WEBP_PRESET_DEFAULT),
+                    m_speed(Speed::Default),
+                    m_parallelKeyframes(false) { }
 
     bool loop() const { return m_loop; }
     Type type() const { return m_type; }
@@ -37,6 +44,11 @@ namespace app {
     WebPImageHint imageHint() const { return m_imageHint; }
     int quality() const { return m_quality; }
     WebPPreset imagePreset() const { return m_imagePreset; }
+    Speed speed() const { return m_speed; }
+
+    // Encodes the frames of animations in parallel as independent
+    // keyframes (full canvas frames, so files are bigger).
+    bool parallelKeyframes() const { return m_parallelKeyframes; }
 
     void setLoop(const bool loop) {
       m_loop = loop;
@@ -71,6 +83,14 @@ namespace app {
       m_imagePreset = imagePreset;
     }
 
+    void setSpeed(const Speed speed) {
+      m_speed = speed;
+    }
+
+    void setParallelKeyframes(const bool state) {
+      m_parallelKeyframes = state;
+    }
+
   private:
     bool m_loop;
     Type m_type;
@@ -80,6 +100,8 @@ namespace app {
     // Lossy options
     int m_quality;      // Between 0 (smallest file) and 100 (biggest)
     WebPPreset m_imagePreset;  // Image Preset for lossy webp.
+    Speed m_speed;
+    bool m_parallelKeyframes;
   };
 
 } // namespace app
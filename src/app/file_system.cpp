@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -19,13 +19,18 @@
 
 #include "base/fs.h"
 #include "base/string.h"
+#include "base/thread_pool.h"
+#include "base/time.h"
 #include "os/surface.h"
 #include "os/system.h"
 #include "os/window.h"
 
 #include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <ctime>
 #include <map>
+#include <memory>
 #include <utility>
 #include <vector>
 
@@ -70,6 +75,31 @@ unsigned int current_file_system_version = 0;
   base::ComPtr<IShellFolder> shl_idesktop;
 #endif
 
+// Entries of a folder found by a background thread. The background
+// thread doesn't touch FileItems, it just reads the folder content
+// and sorts it in runs that are merged in the children list from the
+// UI thread (FileItem::updateChildren()).
+struct ChildrenLoader {
+  struct Entry {
+    std::string name;
+    bool isFolder;
+  };
+  using Run = std::vector<Entry>;
+
+  // Input
+  std::string path;
+  time_t knownMtime = 0;   // Modification time of the loaded children
+
+  // Output (protected by the mutex)
+  std::mutex mutex;
+  std::vector<Run> runs;
+  time_t mtime = 0;
+  bool unchanged = false;
+  bool done = false;
+
+  std::atomic<bool> canceled { false };
+};
+
 // a position in the file-system
 class FileItem final : public IFileItem {
 public:
@@ -81,6 +111,9 @@ public:
   FileItemList m_children;
   unsigned int m_version;
   bool m_removed;
+  std::shared_ptr<ChildrenLoader> m_loader;
+  time_t m_mtime;               // Modification time of the folder when
+                                // m_children was loaded (0 if unknown)
   mutable bool m_is_folder;
   std::atomic<double> m_thumbnailProgress;
   std::atomic<os::Surface*> m_thumbnail;
@@ -95,6 +128,7 @@ public:
   ~FileItem();
 
   void insertChildSorted(FileItem* child);
+  void cancelLoadingChildren();
   int compare(const FileItem& that) const;
 
   bool operator<(const FileItem& that) const { return compare(that) < 0; }
@@ -115,6 +149,9 @@ public:
   IFileItem* parent() const override;
   const FileItemList& children() override;
   void createDirectory(const std::string& dirname) override;
+  void loadChildrenAsync() override;
+  bool isLoadingChildren() const override { return m_loader != nullptr; }
+  bool updateChildren() override;
 
   bool hasExtension(const base::paths& extensions) override;
 
@@ -433,6 +470,10 @@ const FileItemList& FileItem::children()
     FileItemList::iterator it;
     FileItem* child;
 
+    // The list is loaded synchronously right now
+    cancelLoadingChildren();
+    m_mtime = 0;
+
     // we have to mark current items as deprecated
     for (it=m_children.begin();
          it!=m_children.end(); ++it) {
@@ -583,6 +624,233 @@ void FileItem::createDirectory(const std::string& dirname)
   m_version = 0;
 }
 
+static base::thread_pool& children_loader_thread_pool()
+{
+  static base::thread_pool pool(2);
+  return pool;
+}
+
+#ifndef _WIN32
+
+static bool compare_entries(const ChildrenLoader::Entry& a,
+                            const ChildrenLoader::Entry& b)
+{
+  if (a.isFolder != b.isFolder)
+    return a.isFolder;
+  return base::compare_filenames(a.name, b.name) < 0;
+}
+
+// Reads the folder content in a background thread.
+static void load_children(ChildrenLoader* loader)
+{
+  // Entries are sent to the UI thread in runs of this size (or each
+  // 100ms when the file system is slow, e.g. network shares)
+  const int kEntriesPerRun = 512;
+
+  struct stat dirStat;
+  time_t mtime = 0;
+  if (stat(loader->path.c_str(), &dirStat) == 0)
+    mtime = dirStat.st_mtime;
+
+  // The folder wasn't modified since the last time
+  if (loader->knownMtime != 0 &&
+      loader->knownMtime == mtime) {
+    const std::lock_guard lock(loader->mutex);
+    loader->unchanged = true;
+    loader->done = true;
+    return;
+  }
+
+  // st_mtime has a resolution of one second, so we cannot trust a
+  // modification time from the last second (the folder could be
+  // modified again in the same second).
+  if (mtime >= std::time(nullptr)-1)
+    mtime = 0;
+
+  ChildrenLoader::Run run;
+  base::tick_t runTick = base::current_tick();
+
+  auto sendRun = [loader, &run, &runTick]{
+    std::sort(run.begin(), run.end(), compare_entries);
+
+    const std::lock_guard lock(loader->mutex);
+    loader->runs.push_back(std::move(run));
+    run = ChildrenLoader::Run();
+    runTick = base::current_tick();
+  };
+
+  DIR* dir = opendir(loader->path.c_str());
+  if (dir) {
+    dirent* entry;
+    while (!loader->canceled &&
+           (entry = readdir(dir)) != NULL) {
+      std::string fn = entry->d_name;
+      if (fn == "." || fn == "..")
+        continue;
+
+      std::string fullfn = base::join_path(loader->path, fn);
+      bool is_folder;
+      struct stat fileStat;
+
+      stat(fullfn.c_str(), &fileStat);
+
+      if ((fileStat.st_mode & S_IFMT) == S_IFLNK) {
+        is_folder = base::is_directory(fullfn);
+      }
+      else {
+        is_folder = ((fileStat.st_mode & S_IFMT) == S_IFDIR);
+      }
+
+      run.push_back(ChildrenLoader::Entry{ std::move(fn), is_folder });
+
+      if (int(run.size()) >= kEntriesPerRun ||
+          base::current_tick() - runTick > 100)
+        sendRun();
+    }
+    closedir(dir);
+  }
+  else
+    mtime = 0;
+
+  if (!run.empty())
+    sendRun();
+
+  const std::lock_guard lock(loader->mutex);
+  loader->mtime = mtime;
+  loader->done = true;
+}
+
+#endif // !_WIN32
+
+void FileItem::loadChildrenAsync()
+{
+#ifdef _WIN32
+  // TODO enumerate shell folders (PIDLs) in a background thread
+  children();
+#else
+  if (!isFolder() ||
+      m_loader ||
+      (!m_children.empty() &&
+       current_file_system_version <= m_version))
+    return;
+
+  // Mark current items as deprecated, they are kept in the list
+  // until the loader finishes.
+  for (auto ichild : m_children)
+    static_cast<FileItem*>(ichild)->m_removed = true;
+
+  m_loader = std::make_shared<ChildrenLoader>();
+  m_loader->path = m_filename;
+  m_loader->knownMtime = (m_children.empty() ? 0: m_mtime);
+
+  // The list is being updated, so children() must not load it again
+  m_version = current_file_system_version;
+
+  children_loader_thread_pool().execute(
+    [loader = m_loader]{
+      load_children(loader.get());
+    });
+#endif
+}
+
+bool FileItem::updateChildren()
+{
+#ifdef _WIN32
+  return false;
+#else
+  if (!m_loader)
+    return false;
+
+  std::vector<ChildrenLoader::Run> runs;
+  bool done;
+  {
+    const std::lock_guard lock(m_loader->mutex);
+    std::swap(runs, m_loader->runs);
+    done = m_loader->done;
+  }
+
+  bool changed = false;
+  for (const auto& run : runs) {
+    FileItemList added;
+    for (const auto& entry : run) {
+      std::string fullfn = base::join_path(m_filename, entry.name);
+      FileItem* child = nullptr;
+
+      // We don't use get_fileitem_by_path() to avoid checking if the
+      // file exists again.
+      auto it = fileitems_map->find(get_key_for_filename(fullfn));
+      if (it != fileitems_map->end()) {
+        child = it->second;
+        child->m_removed = false;
+
+        // Already in the list
+        if (std::binary_search(m_children.begin(), m_children.end(), child,
+                               [](const IFileItem* a, const IFileItem* b){
+                                 return *static_cast<const FileItem*>(a) <
+                                        *static_cast<const FileItem*>(b);
+                               }) ||
+            std::find(m_children.begin(), m_children.end(), child) != m_children.end())
+          continue;
+      }
+      else {
+        child = new FileItem(this);
+        child->m_filename = fullfn;
+        child->m_displayname = entry.name;
+        child->m_is_folder = entry.isFolder;
+        put_fileitem(child);
+      }
+      added.push_back(child);
+    }
+
+    // Each run is already sorted, we just merge it with the children
+    if (!added.empty()) {
+      const auto mid = m_children.size();
+      m_children.insert(m_children.end(), added.begin(), added.end());
+      std::inplace_merge(m_children.begin(),
+                         m_children.begin()+mid,
+                         m_children.end(),
+                         [](const IFileItem* a, const IFileItem* b){
+                           return *static_cast<const FileItem*>(a) <
+                                  *static_cast<const FileItem*>(b);
+                         });
+      changed = true;
+    }
+  }
+
+  if (done) {
+    if (m_loader->unchanged) {
+      for (auto ichild : m_children)
+        static_cast<FileItem*>(ichild)->m_removed = false;
+    }
+    else {
+      // Remove old file-items (maybe removed directories or files)
+      for (auto it=m_children.begin(); it!=m_children.end(); ) {
+        FileItem* child = static_cast<FileItem*>(*it);
+        if (child->m_removed) {
+          it = m_children.erase(it);
+          child->m_parent = nullptr;
+          child->deleteItem();
+          changed = true;
+        }
+        else
+          ++it;
+      }
+      m_mtime = m_loader->mtime;
+    }
+    m_loader.reset();
+  }
+  return changed;
+#endif
+}
+
+void FileItem::cancelLoadingChildren()
+{
+  if (m_loader) {
+    m_loader->canceled = true;
+    m_loader.reset();
+  }
+}
+
 bool FileItem::hasExtension(const base::paths& extensions)
 {
   ASSERT(m_filename != NOTINITIALIZED);
@@ -619,6 +887,7 @@ FileItem::FileItem(FileItem* parent)
   m_parent = parent;
   m_version = current_file_system_version;
   m_removed = false;
+  m_mtime = 0;
   m_is_folder = false;
   m_thumbnailProgress = 0.0;
   m_thumbnail = nullptr;
@@ -632,6 +901,8 @@ FileItem::~FileItem()
 {
   FS_TRACE("FS: Destroying FileItem() with parent %p\n", m_parent);
 
+  cancelLoadingChildren();
+
   m_thumbnail.exchange(nullptr);
 
 #ifdef _WIN32
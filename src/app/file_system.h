@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -82,6 +82,16 @@ namespace app {
     virtual const FileItemList& children() = 0;
     virtual void createDirectory(const std::string& dirname) = 0;
 
+    // Starts loading the children of this folder in a background
+    // thread if the list is outdated. Meanwhile children() returns
+    // the previously loaded list (it works as a cache of the folder
+    // content), and updateChildren() must be called from the UI
+    // thread to add/remove the entries found by the background
+    // thread. Returns true if the children list was modified.
+    virtual void loadChildrenAsync() = 0;
+    virtual bool isLoadingChildren() const = 0;
+    virtual bool updateChildren() = 0;
+
     virtual bool hasExtension(const base::paths& extensions) = 0;
 
     virtual double getThumbnailProgress() = 0;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019 Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,7 @@
 #include "config.h"
 #endif
 
+#include "base/thread_pool.h"
 #include "doc/cel.h"
 #include "doc/frame.h"
 #include "doc/image.h"
@@ -17,7 +18,12 @@
 #include "gfx/rect.h"
 #include "render/render.h"
 
+#include <algorithm>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace app {
 
@@ -31,22 +37,57 @@ LayerImage* create_flatten_layer_copy(Sprite* dstSprite, const Layer* srcLayer,
                                       const bool newBlend)
 {
   std::unique_ptr<LayerImage> flatLayer(new LayerImage(dstSprite));
-  render::Render render;
-  render.setNewBlend(newBlend);
 
+  // Frames with cels to render
+  std::vector<frame_t> frames;
   for (frame_t frame=frmin; frame<=frmax; ++frame) {
-    // Does this frame have cels to render?
-    if (has_cels(srcLayer, frame)) {
-      // Create a new image to render each frame.
-      ImageRef image(Image::create(flatLayer->sprite()->pixelFormat(), bounds.w, bounds.h));
+    if (has_cels(srcLayer, frame))
+      frames.push_back(frame);
+  }
 
+  // Render the frames in parallel, a few frames at a time (to limit
+  // the memory used by the rendered images).
+  const int threads = std::clamp(int(std::thread::hardware_concurrency()), 1, 16);
+  std::vector<ImageRef> images(threads);
+  base::thread_pool pool(threads);
+
+  for (int first=0; first<int(frames.size()); first+=threads) {
+    const int n = std::min<int>(threads, int(frames.size())-first);
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending = n;
+
+    for (int i=0; i<n; ++i) {
+      ImageRef* image = &images[i];
+      const frame_t frame = frames[first+i];
+      const PixelFormat pixelFormat = flatLayer->sprite()->pixelFormat();
+      pool.execute(
+        [image, srcLayer, frame, pixelFormat, bounds, newBlend,
+         &mutex, &cv, &pending]{
+          // Create a new image to render each frame.
+          image->reset(Image::create(pixelFormat, bounds.w, bounds.h));
+
+          // Render this frame.
+          render::Render render;
+          render.setNewBlend(newBlend);
+          render.renderLayer(image->get(), srcLayer, frame,
+                             gfx::Clip(0, 0, bounds));
+
+          const std::lock_guard lock(mutex);
+          if (--pending == 0)
+            cv.notify_one();
+        });
+    }
+    {
+      std::unique_lock lock(mutex);
+      cv.wait(lock, [&pending]{ return pending == 0; });
+    }
+
+    for (int i=0; i<n; ++i) {
       // Create the new cel for the output layer.
-      std::unique_ptr<Cel> cel(new Cel(frame, image));
+      std::unique_ptr<Cel> cel(new Cel(frames[first+i], images[i]));
       cel->setPosition(bounds.x, bounds.y);
-
-      // Render this frame.
-      render.renderLayer(image.get(), srcLayer, frame,
-        gfx::Clip(0, 0, bounds));
+      images[i].reset();
 
       // Add the cel (and release the std::unique_ptr).
       flatLayer->addCel(cel.get());
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023-2024  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,15 +18,25 @@
 #include "app/xml_document.h"
 #include "app/xml_exception.h"
 #include "base/fs.h"
+#include "base/fstream_path.h"
 #include "cfg/cfg.h"
 
 #include <algorithm>
+#include <fstream>
+#include <iterator>
 
 namespace app {
 
 static Strings* singleton = nullptr;
 static const char* kDefLanguage = "en";
 
+static std::string strings_cache_dir()
+{
+  ResourceFinder rf;
+  rf.includeUserDir("cache/strings");
+  return rf.defaultFilename();
+}
+
 // static
 void Strings::createInstance(Preferences& pref,
                              Extensions& exts)
@@ -45,6 +55,7 @@ Strings::Strings(Preferences& pref,
                  Extensions& exts)
   : m_pref(pref)
   , m_exts(exts)
+  , m_cache(strings_cache_dir())
 {
   loadLanguage(currentLanguage());
 }
@@ -148,6 +159,28 @@ void Strings::loadStringsFromExtension(const std::string& langId)
 }
 
 void Strings::loadStringsFromFile(const std::string& fn)
+{
+  // The content of the file is used to validate the cached strings
+  std::string content;
+  {
+    std::ifstream f(FSTREAM_PATH(fn), std::ifstream::binary);
+    content.assign(std::istreambuf_iterator<char>(f),
+                   std::istreambuf_iterator<char>());
+  }
+
+  StringsCache::Strings strings;
+  if (!m_cache.load(fn, content, strings)) {
+    parseStringsFile(fn, strings);
+    m_cache.save(fn, content, strings);
+  }
+
+  for (auto& str : strings)
+    m_strings[str.first] = std::move(str.second);
+}
+
+// static
+void Strings::parseStringsFile(const std::string& fn,
+                               StringsCache::Strings& strings)
 {
   cfg::CfgFile cfg;
   cfg.load(fn);
@@ -186,9 +219,9 @@ void Strings::loadStringsFromFile(const std::string& fn)
           ++i;
         }
       }
-      m_strings[textId] = value;
+      strings.emplace_back(textId, value);
 
-      //TRACE("I18N: Reading string %s -> %s\n", textId.c_str(), m_strings[textId].c_str());
+      //TRACE("I18N: Reading string %s -> %s\n", textId.c_str(), value.c_str());
 
       textId.erase(section.size()+1);
     }
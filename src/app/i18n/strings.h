@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,6 +10,7 @@
 #pragma once
 
 #include "app/i18n/lang_info.h"
+#include "app/i18n/strings_cache.h"
 #include "obs/signal.h"
 #include "strings.ini.h"
 
@@ -45,9 +46,12 @@ namespace app {
     void loadStringsFromDataDir(const std::string& langId);
     void loadStringsFromExtension(const std::string& langId);
     void loadStringsFromFile(const std::string& fn);
+    static void parseStringsFile(const std::string& fn,
+                                 StringsCache::Strings& strings);
 
     Preferences& m_pref;
     Extensions& m_exts;
+    StringsCache m_cache;
     mutable std::unordered_map<std::string, std::string> m_strings;
   };
 
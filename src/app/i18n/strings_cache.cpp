@@ -0,0 +1,172 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/i18n/strings_cache.h"
+
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/log.h"
+#include "fmt/format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace app {
+
+namespace {
+
+const char kMagic[8] = "ASESTRS";
+
+// Increment this number if the format of the cache files or the
+// parsing of .ini files change.
+const uint32_t kVersion = 1;
+
+struct Header {
+  char magic[8];
+  uint32_t version;
+  uint32_t count;
+  uint64_t sourceSize;
+  uint64_t sourceHash;
+  uint64_t dataSize;
+  uint64_t dataHash;
+};
+
+// FNV-1a
+uint64_t hash_bytes(const void* data, size_t size)
+{
+  auto p = (const uint8_t*)data;
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i=0; i<size; ++i) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+Header make_header(const std::string& content)
+{
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.sourceSize = content.size();
+  header.sourceHash = hash_bytes(content.data(), content.size());
+  return header;
+}
+
+void write_string(std::string& data, const std::string& str)
+{
+  const uint32_t size = uint32_t(str.size());
+  data.append((const char*)&size, sizeof(size));
+  data.append(str);
+}
+
+bool read_string(const std::string& data, size_t& pos, std::string& str)
+{
+  uint32_t size;
+  if (pos + sizeof(size) > data.size())
+    return false;
+  std::memcpy(&size, data.data()+pos, sizeof(size));
+  pos += sizeof(size);
+
+  if (pos + size > data.size())
+    return false;
+  str.assign(data.data()+pos, size);
+  pos += size;
+  return true;
+}
+
+} // anonymous namespace
+
+StringsCache::StringsCache(const std::string& dir)
+  : m_dir(dir)
+{
+}
+
+bool StringsCache::load(const std::string& fn,
+                        const std::string& content,
+                        Strings& strings) const
+{
+  if (m_dir.empty())
+    return false;
+
+  const Header header = make_header(content);
+
+  std::ifstream f(FSTREAM_PATH(cacheFilename(fn)), std::ifstream::binary);
+  Header cached;
+  if (!f || !f.read((char*)&cached, sizeof(cached)) ||
+      std::memcmp(cached.magic, header.magic, sizeof(header.magic)) != 0 ||
+      cached.version != header.version ||
+      cached.sourceSize != header.sourceSize ||
+      cached.sourceHash != header.sourceHash) {
+    return false;
+  }
+
+  std::string data(cached.dataSize, 0);
+  if (!f.read(data.data(), data.size()) ||
+      hash_bytes(data.data(), data.size()) != cached.dataHash) {
+    return false;
+  }
+
+  strings.clear();
+  strings.reserve(cached.count);
+
+  size_t pos = 0;
+  for (uint32_t i=0; i<cached.count; ++i) {
+    std::string id, value;
+    if (!read_string(data, pos, id) ||
+        !read_string(data, pos, value)) {
+      strings.clear();
+      return false;
+    }
+    strings.emplace_back(std::move(id), std::move(value));
+  }
+  return true;
+}
+
+void StringsCache::save(const std::string& fn,
+                        const std::string& content,
+                        const Strings& strings) const
+{
+  if (m_dir.empty())
+    return;
+
+  std::string data;
+  for (const auto& str : strings) {
+    write_string(data, str.first);
+    write_string(data, str.second);
+  }
+
+  Header header = make_header(content);
+  header.count = uint32_t(strings.size());
+  header.dataSize = data.size();
+  header.dataHash = hash_bytes(data.data(), data.size());
+
+  if (!base::is_directory(m_dir))
+    base::make_all_directories(m_dir);
+
+  const std::string cacheFn = cacheFilename(fn);
+  std::ofstream f(FSTREAM_PATH(cacheFn), std::ofstream::binary);
+  f.write((const char*)&header, sizeof(header));
+  f.write(data.data(), data.size());
+  if (!f)
+    LOG(ERROR, "I18N: Cannot write strings cache %s\n", cacheFn.c_str());
+}
+
+std::string StringsCache::cacheFilename(const std::string& fn) const
+{
+  return base::join_path(
+    m_dir,
+    fmt::format("{:016x}.strings", hash_bytes(fn.data(), fn.size())));
+}
+
+} // namespace app
@@ -0,0 +1,47 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_I18N_STRINGS_CACHE_H_INCLUDED
+#define APP_I18N_STRINGS_CACHE_H_INCLUDED
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace app {
+
+  // Cache of the parsed strings of each .ini file in a directory (one
+  // binary file for each .ini file), so the .ini files don't need to
+  // be parsed on each launch. A cache file is valid only when the
+  // size and the hash of the .ini file content are the same.
+  class StringsCache {
+  public:
+    // List of (text ID, text) pairs in the same order as in the .ini
+    // file, with escaped chars already processed.
+    using Strings = std::vector<std::pair<std::string, std::string>>;
+
+    explicit StringsCache(const std::string& dir);
+
+    // Returns true if the strings of the given .ini file (with the
+    // given content) were loaded from the cache.
+    bool load(const std::string& fn,
+              const std::string& content,
+              Strings& strings) const;
+
+    void save(const std::string& fn,
+              const std::string& content,
+              const Strings& strings) const;
+
+  private:
+    std::string cacheFilename(const std::string& fn) const;
+
+    std::string m_dir;
+  };
+
+} // namespace app
+
+#endif
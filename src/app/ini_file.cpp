@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -12,7 +12,10 @@
 #include "app/ini_file.h"
 
 #include "app/resource_finder.h"
+#include "app/task_scheduler.h"
+#include "base/file_content.h"
 #include "base/fs.h"
+#include "base/log.h"
 #include "base/split_string.h"
 #include "base/string.h"
 #include "cfg/cfg.h"
@@ -27,15 +30,92 @@
   #include "base/fs.h"
 #endif
 
+#include <condition_variable>
 #include <cstdlib>
+#include <map>
+#include <mutex>
 #include <vector>
 
 namespace app {
 
 using namespace gfx;
 
+namespace {
+
+// Writes configuration files in a background task. The content of
+// each file is serialized in the calling thread (which is fast as the
+// whole configuration is in memory), and if the same file is flushed
+// several times before it's written, only the last content is
+// written to disk.
+class ConfigWriter {
+public:
+  void write(const std::string& filename, std::string&& content) {
+    {
+      const std::lock_guard lock(m_mutex);
+      m_pending[filename] = std::move(content);
+      if (m_scheduled)
+        return;
+      m_scheduled = true;
+    }
+    TaskScheduler::instance().execute(
+      TaskPriority::Background,
+      [this]{ writePendingFiles(); });
+  }
+
+  // Waits until the given file is written (e.g. to load it again)
+  void wait(const std::string& filename) {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this, &filename]{
+      return (m_pending.find(filename) == m_pending.end() &&
+              m_writing != filename);
+    });
+  }
+
+  void waitAll() {
+    std::unique_lock lock(m_mutex);
+    m_cv.wait(lock, [this]{ return !m_scheduled; });
+  }
+
+private:
+  void writePendingFiles() {
+    std::unique_lock lock(m_mutex);
+    while (!m_pending.empty()) {
+      auto it = m_pending.begin();
+      const std::string filename = it->first;
+      const std::string content = std::move(it->second);
+      m_pending.erase(it);
+      m_writing = filename;
+      lock.unlock();
+
+      try {
+        base::write_file_content(
+          filename, (const uint8_t*)content.c_str(), content.size());
+      }
+      catch (const std::exception& ex) {
+        LOG(ERROR, "CFG: Error saving configuration into %s: %s\n",
+            filename.c_str(), ex.what());
+      }
+
+      lock.lock();
+      m_writing.clear();
+      m_cv.notify_all();
+    }
+    m_scheduled = false;
+    m_cv.notify_all();
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_cv;
+  std::map<std::string, std::string> m_pending;
+  std::string m_writing;
+  bool m_scheduled = false;
+};
+
+} // anonymous namespace
+
 static std::string g_configFilename;
 static std::vector<cfg::CfgFile*> g_configs;
+static ConfigWriter g_configWriter;
 
 ConfigModule::ConfigModule()
 {
@@ -100,6 +180,7 @@ ConfigModule::ConfigModule()
 ConfigModule::~ConfigModule()
 {
   flush_config_file();
+  g_configWriter.waitAll();
 
   for (auto cfg : g_configs)
     delete cfg;
@@ -126,7 +207,12 @@ void flush_config_file()
 {
   ASSERT(!g_configs.empty());
 
-  g_configs.back()->save();
+  const cfg::CfgFile* cfg = g_configs.back();
+  if (cfg->filename().empty())
+    return;
+
+  // The file is written in background
+  g_configWriter.write(cfg->filename(), cfg->saveToString());
 }
 
 void set_config_file(const char* filename)
@@ -134,6 +220,9 @@ void set_config_file(const char* filename)
   if (g_configs.empty())
     g_configs.push_back(new cfg::CfgFile());
 
+  // Wait a pending write of this same file
+  g_configWriter.wait(filename);
+
   g_configs.back()->load(filename);
 }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2019  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -25,6 +25,9 @@ namespace app {
 
   void push_config_state();
   void pop_config_state();
+  // Queues the current configuration file to be written in a
+  // background thread (set_config_file() waits this write to load
+  // the same file again).
   void flush_config_file();
   void set_config_file(const char* filename);
 
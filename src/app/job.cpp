@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,6 +15,8 @@
 #include "app/console.h"
 #include "app/context.h"
 #include "app/i18n/strings.h"
+#include "app/task_scheduler.h"
+#include "app/trace.h"
 #include "fmt/format.h"
 #include "ui/alert.h"
 #include "ui/widget.h"
@@ -62,18 +64,17 @@ Job::~Job()
 
 void Job::startJob()
 {
-  m_thread = std::thread(&Job::thread_proc, this);
+  m_future = TaskScheduler::instance().execute(
+    TaskPriority::UserJob, [this]{ thread_proc(this); });
   ++g_runningJobs;
+  APP_TRACE_COUNTER("Running jobs", g_runningJobs);
 
   if (m_alert_window) {
     m_alert_window->openWindowInForeground();
 
     // The job was canceled by the user?
-    {
-      std::unique_lock<std::mutex> hold(m_mutex);
-      if (!m_done_flag)
-        m_canceled_flag = true;
-    }
+    if (!m_done_flag)
+      m_canceled_flag = true;
 
     // In case of error, take the "cancel" path (i.e. it's like the
     // user canceled the operation).
@@ -98,10 +99,12 @@ void Job::waitJob()
   if (m_timer && m_timer->isRunning())
     m_timer->stop();
 
-  if (m_thread.joinable()) {
-    m_thread.join();
+  if (m_future.valid()) {
+    m_future.wait();
+    m_future = std::future<void>();
 
     --g_runningJobs;
+    APP_TRACE_COUNTER("Running jobs", g_runningJobs);
   }
 }
 
@@ -117,8 +120,6 @@ bool Job::isCanceled()
 
 void Job::onMonitoringTick()
 {
-  std::unique_lock<std::mutex> hold(m_mutex);
-
   // update progress
   m_alert_window->setProgress(m_last_progress);
 
@@ -131,14 +132,14 @@ void Job::onMonitoringTick()
 
 void Job::done()
 {
-  std::unique_lock<std::mutex> hold(m_mutex);
   m_done_flag = true;
 }
 
-// Called to start the worker thread.
+// Called from the TaskScheduler thread.
 void Job::thread_proc(Job* self)
 {
   try {
+    APP_TRACE_ZONE("Job");
     self->onJob();
   }
   catch (...) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -14,8 +14,7 @@
 
 #include <atomic>
 #include <exception>
-#include <mutex>
-#include <thread>
+#include <future>
 
 namespace app {
 
@@ -26,8 +25,8 @@ namespace app {
     Job(const char* jobName);
     virtual ~Job();
 
-    // Starts the job calling onJob() event in another thread and
-    // monitoring the progress with onMonitorTick() event.
+    // Starts the job calling onJob() event in a TaskScheduler thread
+    // and monitoring the progress with onMonitorTick() event.
     void startJob();
 
     void waitJob();
@@ -39,11 +38,14 @@ namespace app {
     // Returns true if the job was canceled by the user (in case he
     // pressed a "Cancel" button in the GUI). The onJob() thread should
     // check this variable periodically to stop working.
+    //
+    // Both jobProgress() and isCanceled() are lock-free, anyway tight
+    // loops can use a ProgressScope to call them from time to time.
     bool isCanceled();
 
   protected:
 
-    // This member function is called from another dedicated thread
+    // This member function is called from a TaskScheduler thread
     // outside the GUI one, so you can do some image processing here.
     // Remember that you cannot use any GUI element in this handler.
     virtual void onJob() = 0;
@@ -59,13 +61,12 @@ namespace app {
     static void monitor_proc(void* data);
     static void monitor_free(void* data);
 
-    std::thread m_thread;
+    std::future<void> m_future;
     std::unique_ptr<ui::Timer> m_timer;
-    std::mutex m_mutex;
     ui::AlertPtr m_alert_window;
     std::atomic<double> m_last_progress;
-    bool m_done_flag;
-    bool m_canceled_flag;
+    std::atomic<bool> m_done_flag;
+    std::atomic<bool> m_canceled_flag;
     std::exception_ptr m_error;
 
     // these methods are privated and not defined
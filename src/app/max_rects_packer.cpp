@@ -0,0 +1,408 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/max_rects_packer.h"
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <numeric>
+#include <thread>
+
+namespace app {
+
+namespace {
+
+// Packs the rectangles (with the shape padding already added to
+// their sizes) in a bin of the given size, returns false if some
+// rectangle doesn't fit. "order" is the order in which rectangles are
+// inserted (from big to small ones). If "placed" is not nullptr, the
+// rectangles that don't fit are skipped (and marked as not placed).
+bool pack_maxrects(const std::vector<gfx::Size>& sizes,
+                   const std::vector<int>& order,
+                   const gfx::Size& binSize,
+                   base::task_token& token,
+                   std::vector<gfx::Point>& positions,
+                   std::vector<char>* placedRects = nullptr)
+{
+  std::vector<gfx::Rect> freeRects;
+  freeRects.push_back(gfx::Rect(binSize));
+  positions.resize(sizes.size());
+
+  for (const int i : order) {
+    if (token.canceled())
+      return false;
+
+    const gfx::Size& sz = sizes[i];
+
+    // Bottom-left rule: place the rectangle with the minimum bottom
+    // side (and then the minimum x)
+    int bestY2 = std::numeric_limits<int>::max();
+    int bestX = std::numeric_limits<int>::max();
+    gfx::Rect placed;
+    for (const auto& fr : freeRects) {
+      if (fr.w >= sz.w && fr.h >= sz.h) {
+        const int y2 = fr.y + sz.h;
+        if (y2 < bestY2 || (y2 == bestY2 && fr.x < bestX)) {
+          bestY2 = y2;
+          bestX = fr.x;
+          placed = gfx::Rect(fr.x, fr.y, sz.w, sz.h);
+        }
+      }
+    }
+    if (placed.isEmpty()) {
+      if (!placedRects)
+        return false;
+      (*placedRects)[i] = false;
+      continue;
+    }
+
+    positions[i] = placed.origin();
+    if (placedRects)
+      (*placedRects)[i] = true;
+
+    // Split the free rectangles that intersect the placed one
+    std::vector<gfx::Rect> newRects;
+    for (auto it=freeRects.begin(); it!=freeRects.end(); ) {
+      const gfx::Rect fr = *it;
+      if (!fr.intersects(placed)) {
+        ++it;
+        continue;
+      }
+      it = freeRects.erase(it);
+
+      if (placed.x > fr.x)
+        newRects.push_back(gfx::Rect(fr.x, fr.y, placed.x - fr.x, fr.h));
+      if (placed.x2() < fr.x2())
+        newRects.push_back(gfx::Rect(placed.x2(), fr.y, fr.x2() - placed.x2(), fr.h));
+      if (placed.y > fr.y)
+        newRects.push_back(gfx::Rect(fr.x, fr.y, fr.w, placed.y - fr.y));
+      if (placed.y2() < fr.y2())
+        newRects.push_back(gfx::Rect(fr.x, placed.y2(), fr.w, fr.y2() - placed.y2()));
+    }
+
+    // Add the new free rectangles that are not contained in other ones
+    for (size_t j=0; j<newRects.size(); ++j) {
+      const gfx::Rect& rc = newRects[j];
+      bool contained = false;
+      for (const auto& fr : freeRects) {
+        if (fr.contains(rc)) {
+          contained = true;
+          break;
+        }
+      }
+      for (size_t k=0; k<newRects.size() && !contained; ++k) {
+        if (k != j && newRects[k].contains(rc) &&
+            (newRects[k] != rc || k < j))
+          contained = true;
+      }
+      if (!contained)
+        freeRects.push_back(rc);
+    }
+  }
+  return true;
+}
+
+// Returns the order to insert the rectangles (from big to small ones)
+std::vector<int> sorted_order(const std::vector<gfx::Size>& sizes)
+{
+  std::vector<int> order(sizes.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(),
+                   [&sizes](const int a, const int b){
+                     return (std::max(sizes[a].w, sizes[a].h) >
+                             std::max(sizes[b].w, sizes[b].h));
+                   });
+  return order;
+}
+
+} // anonymous namespace
+
+MaxRectsPacker::MaxRectsPacker(const int borderPadding,
+                               const int shapePadding)
+  : m_borderPadding(borderPadding)
+  , m_shapePadding(shapePadding)
+{
+}
+
+void MaxRectsPacker::add(const gfx::Size& sz)
+{
+  m_rects.push_back(gfx::Rect(sz));
+}
+
+gfx::Size MaxRectsPacker::bestFit(base::task_token& token,
+                                  const int fixedWidth,
+                                  const int fixedHeight)
+{
+  // Nothing to do, the texture size is fixed
+  if (fixedWidth > 0 && fixedHeight > 0) {
+    const gfx::Size size(fixedWidth, fixedHeight);
+    pack(size, token);
+    return size;
+  }
+
+  if (m_rects.empty()) {
+    m_bounds = gfx::Rect(0, 0, 2*m_borderPadding, 2*m_borderPadding);
+    return m_bounds.size();
+  }
+
+  // If the width is fixed, we pack the transposed rectangles (so we
+  // always look for the best height of a fixed width).
+  const bool transposed = (fixedHeight > 0);
+  const int extra = 2*m_borderPadding - m_shapePadding;
+
+  std::vector<gfx::Size> sizes(m_rects.size());
+  int64_t area = 0;
+  int maxW = 0;
+  int sumH = 0;
+  for (size_t i=0; i<m_rects.size(); ++i) {
+    gfx::Size sz = m_rects[i].size();
+    if (transposed)
+      std::swap(sz.w, sz.h);
+    sz.w += m_shapePadding;
+    sz.h += m_shapePadding;
+    sizes[i] = sz;
+    area += int64_t(sz.w) * sz.h;
+    maxW = std::max(maxW, sz.w);
+    sumH += sz.h;
+  }
+
+  const std::vector<int> order = sorted_order(sizes);
+
+  // Candidate widths of the bin (the height is not limited)
+  std::vector<int> candidates;
+  const int fixed = (transposed ? fixedHeight: fixedWidth);
+  if (fixed > 0) {
+    candidates.push_back(fixed - extra);
+  }
+  else {
+    const double side = std::sqrt(double(area));
+    for (int f=50; f<=200; f+=10) {
+      const int w = std::max(maxW, int(side * f / 100.0));
+      if (std::find(candidates.begin(), candidates.end(), w) == candidates.end())
+        candidates.push_back(w);
+    }
+  }
+
+  struct Result {
+    bool ok = false;
+    gfx::Size size;
+    std::vector<gfx::Point> positions;
+  };
+  std::vector<Result> results(candidates.size());
+
+  auto tryCandidate = [&](const int c) {
+    Result& res = results[c];
+    const gfx::Size binSize(candidates[c], sumH);
+    res.ok = pack_maxrects(sizes, order, binSize, token, res.positions);
+    if (res.ok) {
+      for (size_t i=0; i<sizes.size(); ++i) {
+        res.size.w = std::max(res.size.w, res.positions[i].x + sizes[i].w);
+        res.size.h = std::max(res.size.h, res.positions[i].y + sizes[i].h);
+      }
+    }
+  };
+
+  const int threads = std::min(int(std::thread::hardware_concurrency()),
+                               int(candidates.size()));
+  if (threads < 2) {
+    for (int c=0; c<int(candidates.size()); ++c)
+      tryCandidate(c);
+  }
+  else {
+    std::mutex mutex;
+    std::condition_variable cv;
+    int pending = int(candidates.size());
+    base::thread_pool pool(threads);
+    for (int c=0; c<int(candidates.size()); ++c) {
+      pool.execute([&, c]{
+        tryCandidate(c);
+
+        const std::lock_guard lock(mutex);
+        --pending;
+        cv.notify_one();
+      });
+    }
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&pending]{ return pending == 0; });
+  }
+
+  // Choose the smallest texture (and the most squared one if there
+  // are two textures with the same area)
+  const Result* best = nullptr;
+  for (const auto& res : results) {
+    if (!res.ok)
+      continue;
+    if (!best) {
+      best = &res;
+      continue;
+    }
+    const int64_t a = int64_t(res.size.w) * res.size.h;
+    const int64_t b = int64_t(best->size.w) * best->size.h;
+    if (a < b ||
+        (a == b && std::abs(res.size.w - res.size.h) <
+                   std::abs(best->size.w - best->size.h)))
+      best = &res;
+  }
+  if (!best)
+    return gfx::Size(0, 0);
+
+  for (size_t i=0; i<m_rects.size(); ++i) {
+    gfx::Point pt = best->positions[i];
+    if (transposed)
+      std::swap(pt.x, pt.y);
+    m_rects[i].setOrigin(gfx::Point(pt.x + m_borderPadding,
+                                    pt.y + m_borderPadding));
+  }
+
+  gfx::Size size = best->size;
+  if (transposed)
+    std::swap(size.w, size.h);
+  size.w += extra;
+  size.h += extra;
+  if (fixedWidth > 0) size.w = fixedWidth;
+  if (fixedHeight > 0) size.h = fixedHeight;
+
+  m_bounds = gfx::Rect(size);
+  m_pages.clear();
+  m_pageSizes.clear();
+  return size;
+}
+
+bool MaxRectsPacker::pack(const gfx::Size& size,
+                          base::task_token& token)
+{
+  const int extra = 2*m_borderPadding - m_shapePadding;
+  std::vector<gfx::Size> sizes(m_rects.size());
+  for (size_t i=0; i<m_rects.size(); ++i)
+    sizes[i] = gfx::Size(m_rects[i].w + m_shapePadding,
+                         m_rects[i].h + m_shapePadding);
+
+  const std::vector<int> order = sorted_order(sizes);
+
+  std::vector<gfx::Point> positions;
+  if (!pack_maxrects(sizes, order,
+                     gfx::Size(size.w - extra, size.h - extra),
+                     token, positions)) {
+    m_bounds = gfx::Rect();
+    return false;
+  }
+
+  for (size_t i=0; i<m_rects.size(); ++i)
+    m_rects[i].setOrigin(gfx::Point(positions[i].x + m_borderPadding,
+                                    positions[i].y + m_borderPadding));
+  m_bounds = gfx::Rect(size);
+  m_pages.clear();
+  m_pageSizes.clear();
+  return true;
+}
+
+int MaxRectsPacker::packPages(const gfx::Size& maxSize,
+                              base::task_token& token)
+{
+  m_pages.assign(m_rects.size(), 0);
+  m_pageSizes.clear();
+
+  const int extra = 2*m_borderPadding - m_shapePadding;
+  std::vector<gfx::Size> sizes(m_rects.size());
+  for (size_t i=0; i<m_rects.size(); ++i)
+    sizes[i] = gfx::Size(m_rects[i].w + m_shapePadding,
+                         m_rects[i].h + m_shapePadding);
+
+  // 1) Fill each page with the biggest rectangles that fit in it,
+  //    the rest of rectangles go to the next page.
+  std::vector<int> remaining = sorted_order(sizes);
+  std::vector<std::vector<int>> pageRects;
+  std::vector<gfx::Point> positions;
+  std::vector<char> placed(m_rects.size(), false);
+  while (!remaining.empty()) {
+    if (token.canceled())
+      return 0;
+
+    const int page = int(pageRects.size());
+    pack_maxrects(sizes, remaining,
+                  gfx::Size(maxSize.w - extra, maxSize.h - extra),
+                  token, positions, &placed);
+
+    std::vector<int> rects, next;
+    for (const int i : remaining) {
+      if (placed[i]) {
+        m_rects[i].setOrigin(gfx::Point(positions[i].x + m_borderPadding,
+                                        positions[i].y + m_borderPadding));
+        rects.push_back(i);
+      }
+      else
+        next.push_back(i);
+    }
+
+    // The biggest rectangle doesn't fit in a page, so it goes alone
+    // in a bigger page
+    if (rects.empty()) {
+      const int i = remaining.front();
+      m_rects[i].setOrigin(gfx::Point(m_borderPadding, m_borderPadding));
+      rects.push_back(i);
+      next.erase(next.begin());
+    }
+
+    for (const int i : rects)
+      m_pages[i] = page;
+    pageRects.push_back(std::move(rects));
+    remaining = std::move(next);
+  }
+
+  // 2) Try to reduce the size of each page packing its rectangles
+  //    again (trying several sizes in parallel).
+  m_pageSizes.resize(pageRects.size());
+  for (size_t page=0; page<pageRects.size(); ++page) {
+    if (token.canceled())
+      return 0;
+
+    const std::vector<int>& rects = pageRects[page];
+    gfx::Rect bounds = m_rects[rects.front()];
+    for (const int i : rects)
+      bounds |= m_rects[i];
+    gfx::Size size(bounds.x2() + m_borderPadding,
+                   bounds.y2() + m_borderPadding);
+
+    MaxRectsPacker pagePacker(m_borderPadding, m_shapePadding);
+    for (const int i : rects)
+      pagePacker.add(m_rects[i].size());
+
+    const gfx::Size bestSize = pagePacker.bestFit(token);
+    if (bestSize.w > 0 && bestSize.h > 0 &&
+        bestSize.w <= maxSize.w && bestSize.h <= maxSize.h &&
+        int64_t(bestSize.w) * bestSize.h < int64_t(size.w) * size.h) {
+      for (size_t j=0; j<rects.size(); ++j)
+        m_rects[rects[j]] = pagePacker[j];
+      size = bestSize;
+    }
+    m_pageSizes[page] = size;
+  }
+
+  m_bounds = gfx::Rect(maxSize);
+  return int(m_pageSizes.size());
+}
+
+double MaxRectsPacker::density() const
+{
+  if (m_bounds.isEmpty())
+    return 0.0;
+
+  int64_t area = 0;
+  for (const auto& rc : m_rects)
+    area += int64_t(rc.w) * rc.h;
+  return double(area) / (double(m_bounds.w) * m_bounds.h);
+}
+
+} // namespace app
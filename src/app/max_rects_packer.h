@@ -0,0 +1,88 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_MAX_RECTS_PACKER_H_INCLUDED
+#define APP_MAX_RECTS_PACKER_H_INCLUDED
+#pragma once
+
+#include "base/task.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace app {
+
+  // Packs rectangles in a texture using the MaxRects algorithm (a
+  // list of maximal free rectangles, placing each rectangle in the
+  // bottom-left position). It's an alternative to gfx::PackingRects
+  // with the same interface, but bestFit() tries several candidate
+  // texture sizes in parallel.
+  class MaxRectsPacker {
+  public:
+    typedef std::vector<gfx::Rect> Rects;
+    typedef Rects::const_iterator const_iterator;
+
+    MaxRectsPacker(const int borderPadding = 0,
+                   const int shapePadding = 0);
+
+    // Iterate over the packed rectangles (in the same order they
+    // were added).
+    const_iterator begin() const { return m_rects.begin(); }
+    const_iterator end() const { return m_rects.end(); }
+    bool empty() const { return m_rects.empty(); }
+    int size() const { return int(m_rects.size()); }
+    const gfx::Rect& operator[](int i) const { return m_rects[i]; }
+
+    void add(const gfx::Size& sz);
+
+    // Finds the smallest (by area) texture size to pack all the
+    // rectangles. If fixedWidth or fixedHeight are > 0, that
+    // dimension of the texture is not modified.
+    gfx::Size bestFit(base::task_token& token,
+                      const int fixedWidth = 0,
+                      const int fixedHeight = 0);
+
+    // Returns false if all rectangles cannot be packed in the given
+    // texture size.
+    bool pack(const gfx::Size& size,
+              base::task_token& token);
+
+    // Packs the rectangles in pages of the given maximum size (only
+    // the needed pages are used), returns the number of pages. The
+    // position of each rectangle is relative to its page.
+    int packPages(const gfx::Size& maxSize,
+                  base::task_token& token);
+
+    int pages() const { return std::max(1, int(m_pageSizes.size())); }
+    int page(int i) const { return (m_pages.empty() ? 0: m_pages[i]); }
+
+    // Size of the given page after packPages() (it can be smaller
+    // than the maximum size).
+    gfx::Size pageSize(int page) const {
+      return (m_pageSizes.empty() ? m_bounds.size(): m_pageSizes[page]);
+    }
+
+    // Bounds of the packed rectangles (including the border padding).
+    const gfx::Rect& bounds() const { return m_bounds; }
+
+    // Ratio between the area of the packed rectangles and the area of
+    // the texture (from 0.0 to 1.0).
+    double density() const;
+
+  private:
+    int m_borderPadding;
+    int m_shapePadding;
+    Rects m_rects;
+    gfx::Rect m_bounds;
+    std::vector<int> m_pages;
+    std::vector<gfx::Size> m_pageSizes;
+  };
+
+} // namespace app
+
+#endif
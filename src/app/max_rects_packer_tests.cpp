@@ -0,0 +1,129 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/max_rects_packer.h"
+
+using namespace app;
+
+static bool no_overlaps(const MaxRectsPacker& pr, const int shapePadding)
+{
+  for (int i=0; i<pr.size(); ++i) {
+    gfx::Rect a = pr[i];
+    a.w += shapePadding;
+    a.h += shapePadding;
+    for (int j=i+1; j<pr.size(); ++j) {
+      if (a.intersects(pr[j]))
+        return false;
+    }
+  }
+  return true;
+}
+
+TEST(MaxRectsPacker, Empty)
+{
+  base::task_token token;
+  MaxRectsPacker pr;
+  EXPECT_EQ(gfx::Size(0, 0), pr.bestFit(token));
+  EXPECT_TRUE(pr.empty());
+}
+
+TEST(MaxRectsPacker, SameSizes)
+{
+  base::task_token token;
+  MaxRectsPacker pr;
+  for (int i=0; i<16; ++i)
+    pr.add(gfx::Size(8, 8));
+
+  EXPECT_EQ(gfx::Size(32, 32), pr.bestFit(token));
+  EXPECT_TRUE(no_overlaps(pr, 0));
+  EXPECT_DOUBLE_EQ(1.0, pr.density());
+}
+
+TEST(MaxRectsPacker, Padding)
+{
+  base::task_token token;
+  MaxRectsPacker pr(2, 1);
+  for (int i=0; i<4; ++i)
+    pr.add(gfx::Size(10, 10));
+
+  // 2 + 10 + 1 + 10 + 2
+  EXPECT_EQ(gfx::Size(25, 25), pr.bestFit(token));
+  EXPECT_TRUE(no_overlaps(pr, 1));
+  for (const auto& rc : pr) {
+    EXPECT_TRUE(gfx::Rect(2, 2, 21, 21).contains(rc));
+  }
+}
+
+TEST(MaxRectsPacker, FixedWidth)
+{
+  base::task_token token;
+  MaxRectsPacker pr;
+  for (int i=0; i<10; ++i)
+    pr.add(gfx::Size(4, 3+i));
+
+  const gfx::Size size = pr.bestFit(token, 8, 0);
+  EXPECT_EQ(8, size.w);
+  EXPECT_TRUE(no_overlaps(pr, 0));
+  for (const auto& rc : pr) {
+    EXPECT_TRUE(gfx::Rect(size).contains(rc));
+  }
+}
+
+TEST(MaxRectsPacker, FixedSize)
+{
+  base::task_token token;
+  MaxRectsPacker pr;
+  pr.add(gfx::Size(6, 4));
+  pr.add(gfx::Size(4, 6));
+  pr.add(gfx::Size(2, 2));
+  EXPECT_TRUE(pr.pack(gfx::Size(10, 6), token));
+  EXPECT_TRUE(no_overlaps(pr, 0));
+
+  pr.add(gfx::Size(8, 8));
+  EXPECT_FALSE(pr.pack(gfx::Size(10, 6), token));
+}
+
+TEST(MaxRectsPacker, Pages)
+{
+  base::task_token token;
+  MaxRectsPacker pr(1, 1);
+  for (int i=0; i<10; ++i)
+    pr.add(gfx::Size(8, 8));
+  pr.add(gfx::Size(40, 4));     // Bigger than the page
+
+  // 1 + 8 + 1 + 8 + 1 = 19 (4 rectangles per page)
+  const gfx::Size maxSize(20, 20);
+  EXPECT_EQ(4, pr.packPages(maxSize, token));
+  EXPECT_EQ(4, pr.pages());
+
+  std::vector<int> count(pr.pages(), 0);
+  for (int i=0; i<pr.size(); ++i) {
+    const int page = pr.page(i);
+    ++count[page];
+    EXPECT_TRUE(gfx::Rect(pr.pageSize(page)).contains(pr[i]));
+
+    gfx::Rect a = pr[i];
+    a.w += 1;
+    a.h += 1;
+    for (int j=i+1; j<pr.size(); ++j) {
+      if (pr.page(j) == page)
+        EXPECT_FALSE(a.intersects(pr[j]));
+    }
+  }
+
+  EXPECT_EQ(4, count[0]);
+  EXPECT_EQ(4, count[1]);
+  EXPECT_EQ(2, count[2]);
+  EXPECT_EQ(gfx::Size(19, 19), pr.pageSize(0));
+  EXPECT_EQ(gfx::Size(19, 19), pr.pageSize(1));
+
+  // The big rectangle goes alone in the last page
+  EXPECT_EQ(1, count[3]);
+  EXPECT_EQ(3, pr.page(10));
+  EXPECT_EQ(gfx::Size(42, 6), pr.pageSize(3));
+}
@@ -0,0 +1,145 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/memory_budget.h"
+
+#include "app/doc.h"
+#include "app/i18n/strings.h"
+#include "app/pref/preferences.h"
+#include "app/site.h"
+#include "app/ui/status_bar.h"
+#include "app/ui_context.h"
+#include "base/log.h"
+#include "base/mem_utils.h"
+#include "doc/cel.h"
+#include "doc/cel_data.h"
+#include "doc/image.h"
+#include "doc/image_buffer_pool.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+#include "fmt/format.h"
+
+namespace app {
+
+using namespace doc;
+
+// Check the memory usage each 10 seconds
+static const int kCheckInterval = 10 * 1000;
+
+MemoryBudget::MemoryBudget()
+  : m_timer(kCheckInterval)
+{
+  m_timer.Tick.connect([this]{ check(); });
+  m_timer.start();
+}
+
+MemoryBudget::~MemoryBudget()
+{
+  m_timer.stop();
+}
+
+bool MemoryBudget::check()
+{
+  const std::size_t limit = budget();
+  if (limit == 0)
+    return true;
+
+  DocMemoryUsage usage = calculateUsage();
+  if (usage.total() <= limit) {
+    m_warned = false;
+    return true;
+  }
+
+  LOG(VERBOSE, "MEM: Memory usage %s is over the budget %s, releasing memory\n",
+      base::get_pretty_memory_size(usage.total()).c_str(),
+      base::get_pretty_memory_size(limit).c_str());
+
+  ImageBufferPool::instance()->clear();
+  for (Doc* doc : UIContext::instance()->documents())
+    releaseDocMemory(doc);
+
+  usage = calculateUsage();
+  if (usage.total() <= limit) {
+    m_warned = false;
+    return true;
+  }
+
+  // Warn only once each time the budget is exceeded
+  if (!m_warned) {
+    m_warned = true;
+    LOG(WARNING, "MEM: Memory usage %s is over the budget %s\n",
+        base::get_pretty_memory_size(usage.total()).c_str(),
+        base::get_pretty_memory_size(limit).c_str());
+
+    if (auto statusBar = StatusBar::instance()) {
+      statusBar->showTip(
+        5000,
+        fmt::format(Strings::statusbar_tips_memory_budget_exceeded(),
+                    base::get_pretty_memory_size(usage.total()),
+                    base::get_pretty_memory_size(limit)));
+    }
+  }
+  return false;
+}
+
+std::size_t MemoryBudget::budget() const
+{
+  const int mb = Preferences::instance().experimental.memoryBudget();
+  return (mb > 0 ? std::size_t(mb) * 1024 * 1024: 0);
+}
+
+DocMemoryUsage MemoryBudget::calculateUsage() const
+{
+  DocMemoryUsage usage;
+  for (Doc* doc : UIContext::instance()->documents()) {
+    // We don't want to wait if the document is being modified (the
+    // document is not counted in this check)
+    const Doc::LockResult res = doc->readLock(0);
+    if (res == Doc::LockResult::Fail)
+      continue;
+
+    usage += calculate_doc_memory_usage(doc);
+    doc->unlock(res);
+  }
+  return usage;
+}
+
+void MemoryBudget::releaseDocMemory(Doc* doc)
+{
+  const Doc::LockResult res = doc->writeLock(0);
+  if (res == Doc::LockResult::Fail)
+    return;
+
+  Sprite* sprite = doc->sprite();
+
+  // The compressed tilesets are used to save the file faster, they
+  // are calculated again if they are needed
+  if (sprite->hasTilesets()) {
+    for (Tileset* tileset : *sprite->tilesets()) {
+      if (tileset)
+        tileset->discardCompressedData();
+    }
+  }
+
+  // Compress all cels except the ones in the active frame (the
+  // compressed cels cached to save the file are discarded too)
+  const Site site = UIContext::instance()->activeSite();
+  const frame_t activeFrame = (site.document() == doc ? site.frame(): -1);
+  for (Cel* cel : sprite->uniqueCels()) {
+    cel->data()->discardCompressedData();
+    if (cel->frame() != activeFrame)
+      cel->image()->compressBits();
+  }
+
+  doc->unlock(res);
+}
+
+} // namespace app
@@ -0,0 +1,44 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_MEMORY_BUDGET_H_INCLUDED
+#define APP_MEMORY_BUDGET_H_INCLUDED
+#pragma once
+
+#include "app/doc_memory_usage.h"
+#include "ui/timer.h"
+
+#include <cstddef>
+
+namespace app {
+  class Doc;
+
+  // Checks periodically the memory used by all open documents, and
+  // when it's over the budget (experimental.memory_budget in MB),
+  // releases caches and compresses the cels that are not visible in
+  // the editor (see doc::Image::compressBits()). If that is not
+  // enough, a warning is shown in the status bar.
+  class MemoryBudget {
+  public:
+    MemoryBudget();
+    ~MemoryBudget();
+
+    // Checks the budget now, returns true if the memory used is
+    // inside the budget (or there is no budget).
+    bool check();
+
+  private:
+    std::size_t budget() const;
+    DocMemoryUsage calculateUsage() const;
+    void releaseDocMemory(Doc* doc);
+
+    ui::Timer m_timer;
+    bool m_warned = false;
+  };
+
+} // namespace app
+
+#endif
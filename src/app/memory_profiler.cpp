@@ -0,0 +1,148 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/memory_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+  #include <windows.h>
+
+  #include <malloc.h>
+  #include <psapi.h>
+#elif defined(__APPLE__)
+  #include <malloc/malloc.h>
+  #include <sys/resource.h>
+#else
+  #include <malloc.h>
+  #include <sys/resource.h>
+#endif
+
+namespace {
+
+std::atomic<bool> g_enabled(false);
+std::atomic<int64_t> g_allocs(0);
+std::atomic<int64_t> g_allocBytes(0);
+std::atomic<int64_t> g_liveBytes(0);
+std::atomic<int64_t> g_peakBytes(0);
+
+// Real size of the memory block (it's used to know how many bytes
+// are released in operator delete)
+inline int64_t block_size(void* p)
+{
+#ifdef _WIN32
+  return int64_t(_msize(p));
+#elif defined(__APPLE__)
+  return int64_t(malloc_size(p));
+#else
+  return int64_t(malloc_usable_size(p));
+#endif
+}
+
+inline void update_peak(const int64_t bytes)
+{
+  int64_t peak = g_peakBytes.load(std::memory_order_relaxed);
+  while (bytes > peak &&
+         !g_peakBytes.compare_exchange_weak(peak, bytes,
+                                            std::memory_order_relaxed)) {
+    // Try again
+  }
+}
+
+} // anonymous namespace
+
+void* operator new(std::size_t size)
+{
+  void* p = std::malloc(size ? size: 1);
+  if (!p)
+    throw std::bad_alloc();
+
+  if (g_enabled.load(std::memory_order_relaxed)) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_allocBytes.fetch_add(int64_t(size), std::memory_order_relaxed);
+    const int64_t bytes = block_size(p);
+    update_peak(g_liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes);
+  }
+  return p;
+}
+
+void operator delete(void* p) noexcept
+{
+  if (p && g_enabled.load(std::memory_order_relaxed))
+    g_liveBytes.fetch_sub(block_size(p), std::memory_order_relaxed);
+  std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept
+{
+  operator delete(p);
+}
+
+namespace app {
+
+// static
+void MemoryProfiler::setEnabled(bool state)
+{
+  g_enabled = state;
+}
+
+// static
+bool MemoryProfiler::isEnabled()
+{
+  return g_enabled;
+}
+
+// static
+uint64_t MemoryProfiler::peakRss()
+{
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS pmc;
+  if (::GetProcessMemoryInfo(::GetCurrentProcess(), &pmc, sizeof(pmc)))
+    return uint64_t(pmc.PeakWorkingSetSize);
+#else
+  struct rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+  #ifdef __APPLE__
+    return uint64_t(usage.ru_maxrss);       // In bytes
+  #else
+    return uint64_t(usage.ru_maxrss) * 1024; // In kilobytes
+  #endif
+  }
+#endif
+  return 0;
+}
+
+ScopedMemoryStats::ScopedMemoryStats()
+  : m_allocs(g_allocs)
+  , m_allocBytes(g_allocBytes)
+  , m_liveBytes(g_liveBytes)
+  , m_oldPeak(g_peakBytes.exchange(m_liveBytes))
+{
+}
+
+ScopedMemoryStats::~ScopedMemoryStats()
+{
+  // Restore the peak of the outer scope (in case that it was bigger)
+  update_peak(m_oldPeak);
+}
+
+MemoryProfiler::Stats ScopedMemoryStats::stats() const
+{
+  MemoryProfiler::Stats stats;
+  stats.allocs = g_allocs - m_allocs;
+  stats.allocBytes = g_allocBytes - m_allocBytes;
+  stats.peakBytes = std::max<int64_t>(0, g_peakBytes - m_liveBytes);
+  return stats;
+}
+
+} // namespace app
@@ -0,0 +1,54 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_MEMORY_PROFILER_H_INCLUDED
+#define APP_MEMORY_PROFILER_H_INCLUDED
+#pragma once
+
+#include <cstdint>
+
+namespace app {
+
+  // Counts the allocations done with the global operator new/delete
+  // (see --profile-memory and the memory benchmarks). Allocations
+  // are counted only while the profiler is enabled (it's disabled by
+  // default, in that case the hook just calls malloc/free).
+  class MemoryProfiler {
+  public:
+    struct Stats {
+      int64_t allocs = 0;       // Number of allocations
+      int64_t allocBytes = 0;   // Total of allocated bytes
+      int64_t peakBytes = 0;    // Peak of heap bytes in use (relative
+                                // to the bytes in use at the start)
+    };
+
+    static void setEnabled(bool state);
+    static bool isEnabled();
+
+    // Peak resident set size of the process in bytes (or 0 if it's
+    // not available in the current platform).
+    static uint64_t peakRss();
+  };
+
+  // Measures the allocations done (from any thread) since this
+  // object was created. Scopes can be nested in the same thread.
+  class ScopedMemoryStats {
+  public:
+    ScopedMemoryStats();
+    ~ScopedMemoryStats();
+
+    MemoryProfiler::Stats stats() const;
+
+  private:
+    int64_t m_allocs;
+    int64_t m_allocBytes;
+    int64_t m_liveBytes;
+    int64_t m_oldPeak;
+  };
+
+} // namespace app
+
+#endif
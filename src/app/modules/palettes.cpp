@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -30,6 +30,18 @@ static Palette* ase_default_palette = NULL;
 // Palette in current sprite frame.
 static Palette* ase_current_palette = NULL;
 
+// True if the default palette must be loaded the first time it's
+// used (see load_default_palette_lazily()).
+static bool ase_default_palette_pending = false;
+
+static void load_pending_default_palette()
+{
+  if (ase_default_palette_pending) {
+    ase_default_palette_pending = false;
+    load_default_palette();
+  }
+}
+
 int init_module_palette()
 {
   ase_default_palette = new Palette(frame_t(0), 256);
@@ -43,7 +55,17 @@ void exit_module_palette()
   delete ase_current_palette;
 }
 
+void load_default_palette_lazily()
+{
+  ase_default_palette_pending = true;
+}
+
 void load_default_palette()
+{
+  load_default_palette(read_default_palette().get());
+}
+
+std::unique_ptr<Palette> read_default_palette()
 {
   std::unique_ptr<Palette> pal;
   std::string defaultPalName = get_preset_palette_filename(
@@ -114,8 +136,15 @@ void load_default_palette()
     }
   }
 
+  return pal;
+}
+
+void load_default_palette(const Palette* pal)
+{
+  ase_default_palette_pending = false;
+
   if (pal)
-    set_default_palette(pal.get());
+    set_default_palette(pal);
 
   set_current_palette(nullptr, true);
 }
@@ -125,16 +154,19 @@ void load_default_palette()
 //      function and use the active Site palette.
 Palette* get_current_palette()
 {
+  load_pending_default_palette();
   return ase_current_palette;
 }
 
 Palette* get_default_palette()
 {
+  load_pending_default_palette();
   return ase_default_palette;
 }
 
 void set_default_palette(const Palette* palette)
 {
+  load_pending_default_palette();
   palette->copyColorsTo(ase_default_palette);
 }
 
@@ -144,6 +176,8 @@ void set_default_palette(const Palette* palette)
 // If "_palette" is nullptr the default palette is set.
 bool set_current_palette(const Palette *_palette, bool forced)
 {
+  load_pending_default_palette();
+
   const Palette* palette = (_palette ? _palette: ase_default_palette);
   bool ret = false;
 
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -8,6 +9,7 @@
 #define APP_MODULES_PALETTES_H_INCLUDED
 #pragma once
 
+#include <memory>
 #include <string>
 
 namespace doc {
@@ -24,6 +26,19 @@ namespace app {
   // palette if the palette format changes, etc.
   void load_default_palette();
 
+  // Same as load_default_palette() but in two steps: the palette
+  // file is read (or created) with read_default_palette() (which can
+  // be called from a background thread), and then it's used as the
+  // default palette with load_default_palette(pal) from the main
+  // thread.
+  std::unique_ptr<Palette> read_default_palette();
+  void load_default_palette(const Palette* pal);
+
+  // Same as load_default_palette() but the palette is loaded the
+  // first time it's used (e.g. in batch mode we don't need the
+  // default palette to convert or export files).
+  void load_default_palette_lazily();
+
   Palette* get_default_palette();
   Palette* get_current_palette();
 
@@ -0,0 +1,184 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/phase_profiler.h"
+
+#include "base/debug.h"
+#include "base/fstream_path.h"
+#include "fmt/format.h"
+
+#include "json11.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <ostream>
+
+namespace app {
+
+PhaseProfiler* PhaseProfiler::m_instance = nullptr;
+
+// static
+const char* PhaseProfiler::phaseName(Phase phase)
+{
+  switch (phase) {
+    case Phase::Decode:    return "decode";
+    case Phase::Render:    return "render";
+    case Phase::Quantize:  return "quantize";
+    case Phase::Encode:    return "encode";
+    case Phase::SheetPack: return "sheet pack";
+    case Phase::DataFile:  return "data file";
+    case Phase::Count:     break;
+  }
+  return "";
+}
+
+PhaseProfiler::PhaseProfiler(const bool profileMemory)
+  : m_profileMemory(profileMemory)
+{
+  ASSERT(m_instance == nullptr);
+  m_instance = this;
+
+  if (m_profileMemory)
+    MemoryProfiler::setEnabled(true);
+}
+
+PhaseProfiler::~PhaseProfiler()
+{
+  ASSERT(m_instance == this);
+  m_instance = nullptr;
+
+  if (m_profileMemory)
+    MemoryProfiler::setEnabled(false);
+}
+
+void PhaseProfiler::addEvent(Phase phase,
+                             const std::string& filename,
+                             double start,
+                             double duration,
+                             const MemoryProfiler::Stats& memory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_events.push_back(Event{ phase, filename, start, duration, memory,
+                            std::this_thread::get_id() });
+}
+
+void PhaseProfiler::print(std::ostream& os) const
+{
+  const std::lock_guard lock(m_mutex);
+
+  struct Total {
+    double duration = -1.0;     // < 0 for a not used phase
+    MemoryProfiler::Stats memory;
+  };
+
+  // Files in the same order they were processed
+  std::vector<std::string> filenames;
+  std::map<std::string, std::vector<Total>> totals;
+  for (const Event& ev : m_events) {
+    auto it = totals.find(ev.filename);
+    if (it == totals.end()) {
+      filenames.push_back(ev.filename);
+      it = totals.insert(
+        std::make_pair(ev.filename,
+                       std::vector<Total>(int(Phase::Count)))).first;
+    }
+    Total& total = it->second[int(ev.phase)];
+    total.duration = std::max(total.duration, 0.0) + ev.duration;
+    total.memory.allocs += ev.memory.allocs;
+    total.memory.allocBytes += ev.memory.allocBytes;
+    total.memory.peakBytes = std::max(total.memory.peakBytes,
+                                      ev.memory.peakBytes);
+  }
+
+  const double MB = 1024.0 * 1024.0;
+  for (const std::string& fn : filenames) {
+    os << fn << "\n";
+    const auto& phases = totals[fn];
+    for (int i=0; i<int(Phase::Count); ++i) {
+      const Total& total = phases[i];
+      if (total.duration < 0.0)
+        continue;
+      os << fmt::format("  {:<12} {:10.2f} ms",
+                        phaseName(Phase(i)), total.duration * 1000.0);
+      if (m_profileMemory) {
+        os << fmt::format(" {:10} allocs {:10.2f} MB allocated {:10.2f} MB peak",
+                          total.memory.allocs,
+                          total.memory.allocBytes / MB,
+                          total.memory.peakBytes / MB);
+      }
+      os << "\n";
+    }
+  }
+  if (m_profileMemory)
+    os << fmt::format("Peak RSS: {:.2f} MB\n", MemoryProfiler::peakRss() / MB);
+  os.flush();
+}
+
+void PhaseProfiler::saveTrace(const std::string& filename) const
+{
+  const std::lock_guard lock(m_mutex);
+
+  // Small thread IDs in the order they appear
+  std::map<std::thread::id, int> threads;
+  json11::Json::array events;
+  for (const Event& ev : m_events) {
+    auto it = threads.find(ev.thread);
+    if (it == threads.end())
+      it = threads.insert(std::make_pair(ev.thread, int(threads.size())+1)).first;
+
+    events.push_back(json11::Json::object{
+      { "name", phaseName(ev.phase) },
+      { "cat", "cli" },
+      { "ph", "X" },
+      { "ts", ev.start * 1000000.0 },
+      { "dur", ev.duration * 1000000.0 },
+      { "pid", 1 },
+      { "tid", it->second },
+      { "args", m_profileMemory ?
+          json11::Json::object{
+            { "file", ev.filename },
+            { "allocs", double(ev.memory.allocs) },
+            { "allocBytes", double(ev.memory.allocBytes) },
+            { "peakBytes", double(ev.memory.peakBytes) } }:
+          json11::Json::object{ { "file", ev.filename } } }
+    });
+  }
+
+  std::ofstream f(FSTREAM_PATH(filename), std::ios::out);
+  f << json11::Json(json11::Json::object{ { "traceEvents", events } }).dump()
+    << "\n";
+}
+
+ScopedPhase::ScopedPhase(PhaseProfiler::Phase phase,
+                         const std::string& filename)
+  : m_profiler(PhaseProfiler::instance())
+  , m_phase(phase)
+  , m_start(0.0)
+{
+  if (m_profiler) {
+    m_filename = filename;
+    if (m_profiler->profileMemory())
+      m_memory.emplace();
+    m_start = m_profiler->now();
+  }
+}
+
+ScopedPhase::~ScopedPhase()
+{
+  if (m_profiler) {
+    m_profiler->addEvent(m_phase, m_filename, m_start,
+                         m_profiler->now() - m_start,
+                         m_memory ? m_memory->stats():
+                                    MemoryProfiler::Stats());
+  }
+}
+
+} // namespace app
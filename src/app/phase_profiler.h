@@ -0,0 +1,102 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_PHASE_PROFILER_H_INCLUDED
+#define APP_PHASE_PROFILER_H_INCLUDED
+#pragma once
+
+#include "app/memory_profiler.h"
+#include "base/chrono.h"
+
+#include <iosfwd>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace app {
+
+  // Collects the time spent in each phase of the CLI operations for
+  // each file (see --profile). Phases can be measured from any
+  // thread, and nested phases (e.g. quantize inside encode) are
+  // counted in both phases. With --profile-memory the allocations of
+  // each phase are counted too (allocations from other threads
+  // running at the same time are included).
+  class PhaseProfiler {
+  public:
+    enum class Phase {
+      Decode,
+      Render,
+      Quantize,
+      Encode,
+      SheetPack,
+      DataFile,
+      Count
+    };
+
+    // Returns nullptr if there is no active profiler (the default
+    // case without --profile).
+    static PhaseProfiler* instance() { return m_instance; }
+    static const char* phaseName(Phase phase);
+
+    explicit PhaseProfiler(const bool profileMemory = false);
+    ~PhaseProfiler();
+
+    bool profileMemory() const { return m_profileMemory; }
+
+    // Seconds since the profiler was created.
+    double now() const { return m_chrono.elapsed(); }
+
+    void addEvent(Phase phase,
+                  const std::string& filename,
+                  double start,
+                  double duration,
+                  const MemoryProfiler::Stats& memory = MemoryProfiler::Stats());
+
+    // Prints the total time (and memory) of each phase per file.
+    void print(std::ostream& os) const;
+
+    // Saves all the events in the Chrome trace event format (it can
+    // be loaded in chrome://tracing or https://ui.perfetto.dev/).
+    void saveTrace(const std::string& filename) const;
+
+  private:
+    struct Event {
+      Phase phase;
+      std::string filename;
+      double start;
+      double duration;
+      MemoryProfiler::Stats memory;
+      std::thread::id thread;
+    };
+
+    static PhaseProfiler* m_instance;
+    bool m_profileMemory;
+    base::Chrono m_chrono;
+    mutable std::mutex m_mutex;
+    std::vector<Event> m_events;
+  };
+
+  // Measures the time spent in the current scope. It does nothing if
+  // there is no active profiler.
+  class ScopedPhase {
+  public:
+    ScopedPhase(PhaseProfiler::Phase phase,
+                const std::string& filename);
+    ~ScopedPhase();
+
+  private:
+    PhaseProfiler* m_profiler;
+    PhaseProfiler::Phase m_phase;
+    std::string m_filename;
+    double m_start;
+    std::optional<ScopedMemoryStats> m_memory;
+  };
+
+} // namespace app
+
+#endif
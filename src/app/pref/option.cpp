@@ -0,0 +1,74 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/pref/option.h"
+
+#include "base/debug.h"
+
+#include <algorithm>
+
+namespace app {
+
+int OptionsBatch::s_level = 0;
+std::vector<Section*> OptionsBatch::s_sections;
+
+Section::~Section()
+{
+  auto& sections = OptionsBatch::s_sections;
+  auto it = std::find(sections.begin(), sections.end(), this);
+  if (it != sections.end())
+    sections.erase(it);
+}
+
+void Section::notifyBeforeChange()
+{
+  if (OptionsBatch::s_level > 0) {
+    auto& sections = OptionsBatch::s_sections;
+    // BeforeChange is emitted only for the first change of this
+    // section in the batch
+    if (std::find(sections.begin(), sections.end(), this) != sections.end())
+      return;
+  }
+  BeforeChange();
+}
+
+void Section::notifyAfterChange()
+{
+  if (OptionsBatch::s_level > 0) {
+    auto& sections = OptionsBatch::s_sections;
+    if (std::find(sections.begin(), sections.end(), this) == sections.end())
+      sections.push_back(this);
+    return;
+  }
+  AfterChange();
+}
+
+OptionsBatch::OptionsBatch()
+{
+  ++s_level;
+}
+
+OptionsBatch::~OptionsBatch()
+{
+  ASSERT(s_level > 0);
+  if (--s_level > 0)
+    return;
+
+  // Emit AfterChange of each modified section (a signal handler could
+  // modify other options, so sections are removed from the list
+  // before emitting the signal)
+  while (!s_sections.empty()) {
+    Section* section = s_sections.front();
+    s_sections.erase(s_sections.begin());
+    section->AfterChange();
+  }
+}
+
+} // namespace app
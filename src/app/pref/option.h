@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,7 +10,9 @@
 #pragma once
 
 #include "obs/signal.h"
+
 #include <string>
+#include <vector>
 
 #ifdef ENABLE_SCRIPTING
   #include "app/script/values.h"
@@ -23,12 +25,17 @@ namespace app {
   class Section {
   public:
     Section(const std::string& name) : m_name(name) { }
-    virtual ~Section() { }
+    virtual ~Section();
     const char* name() const { return m_name.c_str(); }
 
     virtual Section* section(const char* id) = 0;
     virtual OptionBase* option(const char* id) = 0;
 
+    // Emit BeforeChange/AfterChange signals, or just one time for
+    // all the changes inside an OptionsBatch.
+    void notifyBeforeChange();
+    void notifyAfterChange();
+
     obs::signal<void()> BeforeChange;
     obs::signal<void()> AfterChange;
 
@@ -36,6 +43,32 @@ namespace app {
     std::string m_name;
   };
 
+  // Groups the changes of several options (e.g. to reset the
+  // preferences of a document) so the BeforeChange/AfterChange
+  // signals of each modified Section are emitted only once (the
+  // AfterChange is emitted when the outermost batch is destroyed).
+  // The signals of each Option are still emitted for each change.
+  //
+  // Preferences are used only from the UI thread, so batches are not
+  // thread-safe.
+  class OptionsBatch {
+  public:
+    OptionsBatch();
+    ~OptionsBatch();
+
+  private:
+    friend class Section;
+
+    // Number of nested batches
+    static int s_level;
+
+    // Sections modified inside the current batch
+    static std::vector<Section*> s_sections;
+
+    OptionsBatch(const OptionsBatch&) = delete;
+    OptionsBatch& operator=(const OptionsBatch&) = delete;
+  };
+
   class OptionBase {
   public:
     OptionBase(Section* section, const char* id)
@@ -112,14 +145,14 @@ namespace app {
 
       BeforeChange(newValue);
       if (m_section)
-        m_section->BeforeChange();
+        m_section->notifyBeforeChange();
 
       m_value = newValue;
       m_dirty = true;
 
       AfterChange(newValue);
       if (m_section)
-        m_section->AfterChange();
+        m_section->notifyAfterChange();
     }
 
     void clearValue() {
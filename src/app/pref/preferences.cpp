@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -120,6 +120,7 @@ Preferences::~Preferences()
 
 void Preferences::load()
 {
+  OptionsBatch batch;
   app::gen::GlobalPref::load();
 }
 
@@ -291,7 +292,9 @@ void Preferences::serializeDocPref(const Doc* doc, app::DocumentPreferences* doc
     docPref->save();
   }
   else {
-    // Load default preferences, or preferences from .ini file.
+    // Load default preferences, or preferences from .ini file (one
+    // AfterChange signal for each modified section).
+    OptionsBatch batch;
     docPref->load();
   }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -58,6 +58,8 @@ namespace app {
     Preferences();
     ~Preferences();
 
+    // Serializes all the options and queues the configuration files
+    // to be written in background (see flush_config_file()).
     void save();
 
     // Returns true if the given option was set by the user or false
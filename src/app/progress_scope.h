@@ -0,0 +1,84 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_PROGRESS_SCOPE_H_INCLUDED
+#define APP_PROGRESS_SCOPE_H_INCLUDED
+#pragma once
+
+#include <algorithm>
+#include <functional>
+
+namespace app {
+
+  // Reports the progress of a loop of "total" steps and checks if the
+  // loop must be stopped (e.g. the user canceled the job), but only
+  // each certain number of steps, so tight loops (e.g. rows of an
+  // image) don't touch the shared progress/cancel state of the job
+  // in each iteration.
+  //
+  //   ProgressScope progress(
+  //     image->height(),
+  //     [this](double f){ jobProgress(f); },
+  //     [this]{ return isCanceled(); });
+  //   for (int y=0; y<image->height(); ++y) {
+  //     ...
+  //     if (!progress.next())
+  //       break;
+  //   }
+  class ProgressScope {
+  public:
+    using ReportFunc = std::function<void(double)>;
+    using CanceledFunc = std::function<bool()>;
+
+    // Maximum number of times that the progress is reported/the
+    // cancellation is checked in the whole loop.
+    static constexpr int kMaxChecks = 100;
+
+    ProgressScope(const int total,
+                  ReportFunc&& report,
+                  CanceledFunc&& canceled = nullptr)
+      : m_total(std::max(total, 1))
+      , m_interval(std::max(m_total / kMaxChecks, 1))
+      , m_step(0)
+      , m_nextCheck(m_interval)
+      , m_canceled(false)
+      , m_report(std::move(report))
+      , m_isCanceled(std::move(canceled)) {
+    }
+
+    // Advances "n" steps of the loop. Returns false if the loop must
+    // be stopped.
+    bool next(const int n = 1) {
+      m_step += n;
+      if (m_step < m_nextCheck)
+        return !m_canceled;
+      return check();
+    }
+
+    bool canceled() const { return m_canceled; }
+
+  private:
+    bool check() {
+      m_nextCheck = m_step + m_interval;
+      if (m_report)
+        m_report(double(std::min(m_step, m_total)) / double(m_total));
+      if (m_isCanceled && !m_canceled)
+        m_canceled = m_isCanceled();
+      return !m_canceled;
+    }
+
+    const int m_total;
+    const int m_interval;
+    int m_step;
+    int m_nextCheck;
+    bool m_canceled;
+    ReportFunc m_report;
+    CanceledFunc m_isCanceled;
+  };
+
+} // namespace app
+
+#endif
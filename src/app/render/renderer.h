@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -19,6 +19,12 @@ namespace os {
   class Surface;
 }
 
+namespace render {
+  class MipmapCache;
+  class ReferenceCache;
+  struct RenderStats;
+}
+
 namespace app {
 
   // Abstract class to render images from any editor to be displayed
@@ -59,6 +65,20 @@ namespace app {
     virtual void setBgOptions(const render::BgOptions& bg) = 0;
     virtual void setProjection(const render::Projection& projection) = 0;
 
+    // Cache of reduced images to render zoomed out sprites.
+    virtual void setMipmapCache(render::MipmapCache* cache) = 0;
+
+    // Cache of reduced images to render scaled down reference layers.
+    virtual void setReferenceCache(render::ReferenceCache* cache) = 0;
+
+    // Renders bands of rows of the sprite in parallel (see
+    // render::Render::setParallel()).
+    virtual void setParallel(const bool parallel) = 0;
+
+    // Counters of composited cels and cache lookups (nullptr to
+    // disable them).
+    virtual void setStats(render::RenderStats* stats) = 0;
+
     // ----------------------------------------------------------------------
     // Advance configuration (for preview/brushes purposes)
 
@@ -76,6 +96,7 @@ namespace app {
                                const doc::BlendMode blendMode,
                                const doc::Layer* currentLayer,
                                const doc::frame_t currentFrame) = 0;
+    virtual void setExtraTransform(const render::ExtraTransform& transform) = 0;
     virtual void removeExtraImage() = 0;
     virtual void setOnionskin(const render::OnionskinOptions& options) = 0;
     virtual void disableOnionskin() = 0;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -15,10 +15,13 @@
 #include "app/color_utils.h"
 #include "app/util/shader_helpers.h"
 #include "doc/render_plan.h"
+#include "render/render_stats.h"
 #include "os/skia/skia_surface.h"
 
 #include "include/core/SkCanvas.h"
 #include "include/effects/SkRuntimeEffect.h"
+#include "include/gpu/GrDirectContext.h"
+#include "include/gpu/GrRecordingContext.h"
 
 namespace app {
 
@@ -26,6 +29,9 @@ using namespace doc;
 
 namespace {
 
+// Default GPU memory used to keep textures of cel images
+const std::size_t kDefaultTextureBudget = 256*1024*1024;
+
 const char* kBgShaderCode = R"(
 uniform half4 iBg1, iBg2;
 uniform half2 iStripeSize;
@@ -83,6 +89,7 @@ inline SkBlendMode to_skia(const doc::BlendMode bm) {
 } // anonymous namespace
 
 ShaderRenderer::ShaderRenderer()
+  : m_textureBudget(kDefaultTextureBudget)
 {
   m_properties.renderBgOnScreen = true;
   m_properties.requiresRgbaBackbuffer = true;
@@ -104,6 +111,12 @@ ShaderRenderer::ShaderRenderer()
 
 ShaderRenderer::~ShaderRenderer() = default;
 
+void ShaderRenderer::setTextureBudget(const std::size_t bytes)
+{
+  m_textureBudget = bytes;
+  shrinkTextures();
+}
+
 void ShaderRenderer::setRefLayersVisiblity(const bool visible)
 {
   // TODO impl
@@ -129,6 +142,26 @@ void ShaderRenderer::setProjection(const render::Projection& projection)
   m_proj = projection;
 }
 
+void ShaderRenderer::setMipmapCache(render::MipmapCache* cache)
+{
+  // Not needed, Skia samples the images on the GPU
+}
+
+void ShaderRenderer::setReferenceCache(render::ReferenceCache* cache)
+{
+  // Not needed, Skia samples the images on the GPU
+}
+
+void ShaderRenderer::setParallel(const bool parallel)
+{
+  // Do nothing (layers are composited in the GPU)
+}
+
+void ShaderRenderer::setStats(render::RenderStats* stats)
+{
+  m_stats = stats;
+}
+
 void ShaderRenderer::setSelectedLayer(const doc::Layer* layer)
 {
   // TODO impl
@@ -165,6 +198,11 @@ void ShaderRenderer::setExtraImage(render::ExtraType type,
   // TODO impl
 }
 
+void ShaderRenderer::setExtraTransform(const render::ExtraTransform& transform)
+{
+  // TODO impl
+}
+
 void ShaderRenderer::removeExtraImage()
 {
   // TODO impl
@@ -416,6 +454,9 @@ void ShaderRenderer::drawImage(SkCanvas* canvas,
                                const int opacity,
                                const doc::BlendMode blendMode)
 {
+  if (m_stats)
+    ++m_stats->cels;
+
   auto skData = SkData::MakeWithoutCopy(
     (const void*)srcImage->getPixelAddress(0, 0),
     srcImage->rowBytes() * srcImage->height());
@@ -430,6 +471,7 @@ void ShaderRenderer::drawImage(SkCanvas* canvas,
                           kUnpremul_SkAlphaType),
         skData,
         srcImage->rowBytes());
+      skImg = getTexture(canvas, srcImage, skImg);
 
       SkPaint p;
       p.setAlpha(opacity);
@@ -451,6 +493,7 @@ void ShaderRenderer::drawImage(SkCanvas* canvas,
                           kOpaque_SkAlphaType),
         skData,
         srcImage->rowBytes());
+      skImg = getTexture(canvas, srcImage, skImg);
 
       SkRuntimeShaderBuilder builder(m_grayscaleEffect);
       builder.child("iImg") = skImg->makeRawShader(SkSamplingOptions(SkFilterMode::kNearest));
@@ -479,6 +522,7 @@ void ShaderRenderer::drawImage(SkCanvas* canvas,
                           kUnpremul_SkAlphaType),
         skData,
         srcImage->rowBytes());
+      skImg = getTexture(canvas, srcImage, skImg);
 
       // Use the palette data as an "width x height" image where
       // width=number of palette colors, and height=1
@@ -534,6 +578,58 @@ bool ShaderRenderer::checkIfWeShouldUsePreview(const doc::Cel* cel) const
   return false;
 }
 
+sk_sp<SkImage> ShaderRenderer::getTexture(SkCanvas* canvas,
+                                          const doc::Image* srcImage,
+                                          const sk_sp<SkImage>& rasterImage)
+{
+  // We can only keep textures with a GPU backend, and the preview
+  // image is modified without updating its version.
+  GrRecordingContext* recordingContext = canvas->recordingContext();
+  GrDirectContext* context = (recordingContext ? recordingContext->asDirectContext(): nullptr);
+  if (!context || srcImage == m_previewImage)
+    return rasterImage;
+
+  const doc::ObjectId id = srcImage->id();
+  auto it = m_texturesMap.find(id);
+  if (it != m_texturesMap.end()) {
+    if (it->second->version == srcImage->version() &&
+        it->second->context == context) {
+      m_textures.splice(m_textures.begin(), m_textures, it->second);
+      if (m_stats)
+        ++m_stats->textureHits;
+      return it->second->image;
+    }
+    // The image was modified (or the GPU context changed)
+    m_texturesSize -= it->second->size;
+    m_textures.erase(it->second);
+    m_texturesMap.erase(it);
+  }
+
+  if (m_stats)
+    ++m_stats->textureMisses;
+
+  sk_sp<SkImage> texture = rasterImage->makeTextureImage(context);
+  if (!texture)
+    return rasterImage;
+
+  const std::size_t size = std::size_t(srcImage->rowBytes()) * srcImage->height();
+  m_textures.push_front(Texture{ id, srcImage->version(), context, texture, size });
+  m_texturesMap[id] = m_textures.begin();
+  m_texturesSize += size;
+  shrinkTextures();
+  return texture;
+}
+
+void ShaderRenderer::shrinkTextures()
+{
+  while (m_texturesSize > m_textureBudget && !m_textures.empty()) {
+    const Texture& texture = m_textures.back();
+    m_texturesSize -= texture.size;
+    m_texturesMap.erase(texture.id);
+    m_textures.pop_back();
+  }
+}
+
 void ShaderRenderer::afterBackgroundLayerIsPainted()
 {
   if (m_sprite && m_sprite->pixelFormat() == IMAGE_INDEXED) {
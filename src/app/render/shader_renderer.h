@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -11,10 +11,18 @@
 #if SK_ENABLE_SKSL
 
 #include "app/render/renderer.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
 #include "doc/palette.h"
 
+#include "include/core/SkImage.h"
 #include "include/core/SkRefCnt.h"
 
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+
+class GrDirectContext;
 class SkCanvas;
 class SkRuntimeEffect;
 
@@ -28,12 +36,21 @@ namespace app {
   // SkSL VM) or GPU-accelerated (with native OpenGL/Metal/etc. shaders).
   //
   // TODO This is an ongoing effort, not yet ready for production, and
-  //      only accessible when ENABLE_DEVMODE is defined.
+  //      only accessible when ENABLE_DEVMODE is defined. It doesn't
+  //      cache the composite of unchanged layer groups or the layers
+  //      below the current layer while drawing, and tiles are drawn
+  //      one by one (see SimpleRenderer::setCompositeCache(),
+  //      cacheLayersBelow(), and setTilemapCache()).
   class ShaderRenderer : public Renderer {
   public:
     ShaderRenderer();
     ~ShaderRenderer();
 
+    // Maximum number of bytes of GPU memory used to keep the cel
+    // images uploaded as textures between renders.
+    std::size_t textureBudget() const { return m_textureBudget; }
+    void setTextureBudget(const std::size_t bytes);
+
     const Properties& properties() const override { return m_properties; }
 
     void setRefLayersVisiblity(const bool visible) override;
@@ -41,6 +58,10 @@ namespace app {
     void setNewBlendMethod(const bool newBlend) override;
     void setBgOptions(const render::BgOptions& bg) override;
     void setProjection(const render::Projection& projection) override;
+    void setMipmapCache(render::MipmapCache* cache) override;
+    void setReferenceCache(render::ReferenceCache* cache) override;
+    void setParallel(const bool parallel) override;
+    void setStats(render::RenderStats* stats) override;
 
     void setSelectedLayer(const doc::Layer* layer) override;
     void setPreviewImage(const doc::Layer* layer,
@@ -56,6 +77,7 @@ namespace app {
                        const doc::BlendMode blendMode,
                        const doc::Layer* currentLayer,
                        const doc::frame_t currentFrame) override;
+    void setExtraTransform(const render::ExtraTransform& transform) override;
     void removeExtraImage() override;
     void setOnionskin(const render::OnionskinOptions& options) override;
     void disableOnionskin() override;
@@ -91,6 +113,21 @@ namespace app {
     bool checkIfWeShouldUsePreview(const doc::Cel* cel) const;
     void afterBackgroundLayerIsPainted();
 
+    sk_sp<SkImage> getTexture(SkCanvas* canvas,
+                              const doc::Image* srcImage,
+                              const sk_sp<SkImage>& rasterImage);
+    void shrinkTextures();
+
+    // Cel images uploaded to the GPU (the most recently used first)
+    struct Texture {
+      doc::ObjectId id;
+      doc::ObjectVersion version;
+      GrDirectContext* context;
+      sk_sp<SkImage> image;
+      std::size_t size;
+    };
+    using Textures = std::list<Texture>;
+
     Properties m_properties;
     render::BgOptions m_bgOptions;
     render::Projection m_proj;
@@ -111,6 +148,12 @@ namespace app {
     // Palette of 256 colors (useful for the indexed shader to set all
     // colors outside the valid range as transparent RGBA=0 values)
     doc::Palette m_palette;
+
+    Textures m_textures;
+    std::unordered_map<doc::ObjectId, Textures::iterator> m_texturesMap;
+    std::size_t m_texturesSize = 0;
+    std::size_t m_textureBudget;
+    render::RenderStats* m_stats = nullptr;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -47,6 +47,36 @@ void SimpleRenderer::setProjection(const render::Projection& projection)
   m_render.setProjection(projection);
 }
 
+void SimpleRenderer::setCompositeCache(render::CompositeCache* cache)
+{
+  m_render.setCompositeCache(cache);
+}
+
+void SimpleRenderer::setMipmapCache(render::MipmapCache* cache)
+{
+  m_render.setMipmapCache(cache);
+}
+
+void SimpleRenderer::setReferenceCache(render::ReferenceCache* cache)
+{
+  m_render.setReferenceCache(cache);
+}
+
+void SimpleRenderer::setTilemapCache(render::TilemapCache* cache)
+{
+  m_render.setTilemapCache(cache);
+}
+
+void SimpleRenderer::setParallel(const bool parallel)
+{
+  m_render.setParallel(parallel);
+}
+
+void SimpleRenderer::setStats(render::RenderStats* stats)
+{
+  m_render.setStats(stats);
+}
+
 void SimpleRenderer::setSelectedLayer(const doc::Layer* layer)
 {
   m_render.setSelectedLayer(layer);
@@ -79,6 +109,11 @@ void SimpleRenderer::setExtraImage(render::ExtraType type,
                          currentLayer, currentFrame);
 }
 
+void SimpleRenderer::setExtraTransform(const render::ExtraTransform& transform)
+{
+  m_render.setExtraTransform(transform);
+}
+
 void SimpleRenderer::removeExtraImage()
 {
   m_render.removeExtraImage();
@@ -94,6 +129,13 @@ void SimpleRenderer::disableOnionskin()
   m_render.disableOnionskin();
 }
 
+void SimpleRenderer::cacheLayersBelow(const doc::Sprite* sprite,
+                                      const doc::frame_t frame,
+                                      const doc::Layer* layer)
+{
+  m_render.cacheLayersBelow(sprite, frame, layer);
+}
+
 void SimpleRenderer::renderSprite(os::Surface* dstSurface,
                                   const doc::Sprite* sprite,
                                   const doc::frame_t frame,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022-2023  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -19,6 +19,24 @@ namespace app {
   public:
     SimpleRenderer();
 
+    // Cache to reuse the composite of layer groups that didn't change
+    // between renders (it can be shared between renderers). Only the
+    // CPU renderer supports it, ShaderRenderer composites all the
+    // layers in each render.
+    void setCompositeCache(render::CompositeCache* cache);
+
+    // Cache of pre-rendered chunks of tiles to render zoomed out
+    // tilemap layers.
+    void setTilemapCache(render::TilemapCache* cache);
+
+    // Called when the user starts drawing in the given layer (the
+    // layer will be rendered with an extra cel several times), so
+    // the renderer can cache everything below it (it requires a
+    // composite cache).
+    void cacheLayersBelow(const doc::Sprite* sprite,
+                          const doc::frame_t frame,
+                          const doc::Layer* layer);
+
     const Properties& properties() const override { return m_properties; }
 
     void setRefLayersVisiblity(const bool visible) override;
@@ -26,6 +44,10 @@ namespace app {
     void setNewBlendMethod(const bool newBlend) override;
     void setBgOptions(const render::BgOptions& bg) override;
     void setProjection(const render::Projection& projection) override;
+    void setMipmapCache(render::MipmapCache* cache) override;
+    void setReferenceCache(render::ReferenceCache* cache) override;
+    void setParallel(const bool parallel) override;
+    void setStats(render::RenderStats* stats) override;
 
     void setSelectedLayer(const doc::Layer* layer) override;
     void setPreviewImage(const doc::Layer* layer,
@@ -41,6 +63,7 @@ namespace app {
                        const doc::BlendMode blendMode,
                        const doc::Layer* currentLayer,
                        const doc::frame_t currentFrame) override;
+    void setExtraTransform(const render::ExtraTransform& transform) override;
     void removeExtraImage() override;
     void setOnionskin(const render::OnionskinOptions& options) override;
     void disableOnionskin() override;
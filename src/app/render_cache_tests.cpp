@@ -0,0 +1,172 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/cmd/clear_mask.h"
+#include "app/cmd/clear_rect.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/test_context.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "render/composite_cache.h"
+#include "render/mipmap_cache.h"
+#include "render/onionskin_options.h"
+#include "render/render.h"
+
+#include <memory>
+
+using namespace app;
+using namespace doc;
+
+typedef std::unique_ptr<Doc> DocPtr;
+
+// Commands that modify the pixels of a cel must increment the image
+// version, in other case the render caches (keyed by the versions of
+// the layers/cels/images) return the pixels before the modification.
+class RenderCacheTest : public ::testing::Test {
+public:
+  RenderCacheTest()
+    : doc(ctx.documents().add(32, 24))
+    , sprite(doc->sprite())
+    , cel(sprite->root()->firstLayer()->cel(0))
+    , cache(16*1024*1024)
+    , mipmaps(16*1024*1024)
+  {
+    clear_image(cel->image(), rgba(255, 0, 0, 255));
+
+    Mask mask;
+    mask.replace(gfx::Rect(4, 4, 8, 8));
+    doc->setMask(&mask);
+  }
+
+  ~RenderCacheTest() {
+    doc->close();
+  }
+
+  // Renders the sprite with the composite cache several times (so
+  // the snapshots are stored and then restored) and compares the
+  // result with a render without cache.
+  void expectSameAsUncached(const frame_t frame = 0,
+                            const render::OnionskinOptions* onionskin = nullptr) {
+    const int w = sprite->width();
+    const int h = sprite->height();
+    std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, w, h));
+    std::unique_ptr<Image> result(Image::create(IMAGE_RGB, w, h));
+
+    render::Render render;
+    if (onionskin)
+      render.setOnionskin(*onionskin);
+    render.renderSprite(expected.get(), sprite, frame);
+    render.setCompositeCache(&cache);
+    for (int i=0; i<3; ++i) {
+      clear_image(result.get(), 0);
+      render.renderSprite(result.get(), sprite, frame);
+      EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " i=" << i;
+    }
+  }
+
+  // Same with the zoomed-out levels of the images (the mipmaps must
+  // be regenerated when the image is modified).
+  void expectMipmapsSameAsUncached() {
+    for (int den : { 2, 4 }) {
+      const render::Zoom zoom(1, den);
+      const int w = zoom.apply(sprite->width());
+      const int h = zoom.apply(sprite->height());
+      const gfx::Clip area(0, 0, 0, 0, w, h);
+      std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, w, h));
+      std::unique_ptr<Image> result(Image::create(IMAGE_RGB, w, h));
+      clear_image(expected.get(), 0);
+      clear_image(result.get(), 0);
+
+      render::Render render;
+      render.setProjection(render::Projection(PixelRatio(1, 1), zoom));
+      render.renderSprite(expected.get(), sprite, frame_t(0), area);
+      render.setMipmapCache(&mipmaps);
+      render.renderSprite(result.get(), sprite, frame_t(0), area);
+      EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " zoom=1/" << den;
+    }
+  }
+
+  TestContextT<Context> ctx;
+  DocPtr doc;
+  Sprite* sprite;
+  Cel* cel;
+  render::CompositeCache cache;
+  render::MipmapCache mipmaps;
+};
+
+TEST_F(RenderCacheTest, ClearMask)
+{
+  expectSameAsUncached();
+
+  cmd::ClearMask cmd(cel);
+  cmd.execute(&ctx);
+  EXPECT_EQ(0, get_pixel(cel->image(), 5, 5));
+  expectSameAsUncached();
+
+  cmd.undo();
+  EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(cel->image(), 5, 5));
+  expectSameAsUncached();
+
+  cmd.redo();
+  EXPECT_EQ(0, get_pixel(cel->image(), 5, 5));
+  expectSameAsUncached();
+}
+
+TEST_F(RenderCacheTest, ClearRect)
+{
+  expectSameAsUncached();
+
+  cmd::ClearRect cmd(cel, gfx::Rect(2, 2, 10, 4));
+  cmd.execute(&ctx);
+  EXPECT_EQ(0, get_pixel(cel->image(), 3, 3));
+  expectSameAsUncached();
+
+  cmd.undo();
+  EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(cel->image(), 3, 3));
+  expectSameAsUncached();
+}
+
+TEST_F(RenderCacheTest, ClearMaskWithMipmaps)
+{
+  expectMipmapsSameAsUncached();
+
+  cmd::ClearMask cmd(cel);
+  cmd.execute(&ctx);
+  expectMipmapsSameAsUncached();
+
+  cmd.undo();
+  expectMipmapsSameAsUncached();
+}
+
+// Onion skin frames are flattened and stored in the composite cache
+TEST_F(RenderCacheTest, ClearMaskInOnionskinFrame)
+{
+  sprite->setTotalFrames(frame_t(2));
+  ImageRef image(Image::create(IMAGE_RGB, sprite->width(), sprite->height()));
+  clear_image(image.get(), rgba(0, 0, 255, 255));
+  static_cast<LayerImage*>(sprite->root()->firstLayer())
+    ->addCel(new Cel(frame_t(1), image));
+
+  render::OnionskinOptions onionskin(render::OnionskinType::MERGE);
+  onionskin.prevFrames(1);
+  onionskin.opacityBase(128);
+  expectSameAsUncached(frame_t(1), &onionskin);
+
+  // Clear the cel in the previous frame
+  cmd::ClearMask cmd(cel);
+  cmd.execute(&ctx);
+  expectSameAsUncached(frame_t(1), &onionskin);
+
+  cmd.undo();
+  expectSameAsUncached(frame_t(1), &onionskin);
+}
@@ -0,0 +1,116 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/res/palette_resource.h"
+
+#include "app/file/palette_file.h"
+#include "app/res/palettes_index.h"
+#include "app/task_scheduler.h"
+#include "base/debug.h"
+#include "doc/palette.h"
+#include "ui/system.h"
+
+namespace app {
+
+PaletteResource::PaletteResource(const std::string& id,
+                                 const std::string& path,
+                                 const std::shared_ptr<const FileOpConfig>& config,
+                                 const std::shared_ptr<PalettesIndex>& index)
+  : m_id(id)
+  , m_path(path)
+  , m_config(config)
+  , m_index(index)
+  , m_state(std::make_shared<State>())
+{
+}
+
+PaletteResource::~PaletteResource()
+{
+  m_state->alive = false;
+}
+
+const doc::Palette* PaletteResource::palette()
+{
+  {
+    const std::lock_guard lock(m_state->mutex);
+    if (m_state->palette)
+      return m_state->palette.get();
+  }
+
+  // Decode the palette from the file (the preview from the index
+  // doesn't contain all the palette information, e.g. the names of
+  // the colors)
+  std::unique_ptr<doc::Palette> palette =
+    decode(m_path, m_config.get(), m_index.get());
+
+  const std::lock_guard lock(m_state->mutex);
+  if (!m_state->palette)
+    m_state->palette = std::move(palette);
+  return m_state->palette.get();
+}
+
+const doc::Palette* PaletteResource::preview() const
+{
+  const std::lock_guard lock(m_state->mutex);
+  if (m_state->palette)
+    return m_state->palette.get();
+  return m_state->preview.get();
+}
+
+void PaletteResource::loadPreview(std::function<void()>&& onReady)
+{
+  {
+    const std::lock_guard lock(m_state->mutex);
+    if (m_state->loading || m_state->palette || m_state->preview)
+      return;
+    m_state->loading = true;
+  }
+
+  TaskScheduler::instance().execute(
+    TaskPriority::Interactive,
+    [state = m_state, path = m_path, config = m_config, index = m_index,
+     onReady = std::move(onReady)]{
+      std::unique_ptr<doc::Palette> preview;
+      std::unique_ptr<doc::Palette> palette;
+      if (index)
+        preview = index->get(path);
+      if (!preview)
+        palette = decode(path, config.get(), index.get());
+
+      {
+        const std::lock_guard lock(state->mutex);
+        if (!state->palette)
+          state->palette = std::move(palette);
+        state->preview = std::move(preview);
+      }
+
+      ui::execute_from_ui_thread(
+        [state, onReady]{
+          if (state->alive && onReady)
+            onReady();
+        });
+    });
+}
+
+// static
+std::unique_ptr<doc::Palette> PaletteResource::decode(
+  const std::string& path,
+  const FileOpConfig* config,
+  PalettesIndex* index)
+{
+  TRACE("RESLOAD: Loading palette from '%s'...\n", path.c_str());
+
+  std::unique_ptr<doc::Palette> palette = load_palette(path.c_str(), config);
+  if (palette && index)
+    index->set(path, palette.get());
+  return palette;
+}
+
+} // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -12,32 +12,66 @@
 #include "app/res/resource.h"
 #include "doc/palette.h"
 
+#include <functional>
 #include <memory>
+#include <mutex>
 
 namespace doc {
   class Palette;
 }
 
 namespace app {
+  class PalettesIndex;
+  struct FileOpConfig;
 
+  // Palette file of the palettes library. The palette is decoded on
+  // demand (e.g. when its item is visible in the PalettesListBox).
   class PaletteResource : public Resource {
   public:
     PaletteResource(const std::string& id,
                     const std::string& path,
-                    std::unique_ptr<doc::Palette>&& palette)
-      : m_id(id)
-      , m_path(path)
-      , m_palette(std::move(palette)) {
-    }
-    virtual ~PaletteResource() { }
+                    const std::shared_ptr<const FileOpConfig>& config,
+                    const std::shared_ptr<PalettesIndex>& index);
+    virtual ~PaletteResource();
     virtual const std::string& id() const override { return m_id; }
     virtual const std::string& path() const override { return m_path; }
-    virtual const doc::Palette* palette() { return m_palette.get(); }
+
+    // Returns the palette decoded from the file (it's decoded from
+    // the calling thread if it wasn't decoded yet).
+    virtual const doc::Palette* palette();
+
+    // Returns a palette to preview the colors and the comment of the
+    // palette file (which can come from the PalettesIndex), or
+    // nullptr if it's not available yet (see loadPreview()).
+    const doc::Palette* preview() const;
+
+    // Starts decoding the palette in background (if it's not decoded
+    // yet). "onReady" is called from the UI thread when preview() is
+    // available (it's not called if this resource is deleted).
+    void loadPreview(std::function<void()>&& onReady);
 
   private:
+    // State shared with the background task that decodes the palette
+    struct State {
+      std::mutex mutex;
+      std::unique_ptr<doc::Palette> palette;
+      std::unique_ptr<doc::Palette> preview;
+      bool loading = false;
+      // Set to false when the resource is deleted (only accessed from
+      // the UI thread)
+      bool alive = true;
+    };
+
+    static std::unique_ptr<doc::Palette> decode(
+      const std::string& path,
+      const FileOpConfig* config,
+      PalettesIndex* index);
+
     std::string m_id;
     std::string m_path;
-    std::unique_ptr<doc::Palette> m_palette;
+    std::shared_ptr<const FileOpConfig> m_config;
+    std::shared_ptr<PalettesIndex> m_index;
+    std::shared_ptr<State> m_state;
   };
 
 } // namespace app
@@ -0,0 +1,160 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/res/palettes_index.h"
+
+#include "app/resource_finder.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/log.h"
+#include "base/serialization.h"
+#include "doc/palette.h"
+#include "doc/palette_io.h"
+#include "doc/string_io.h"
+
+#include <fstream>
+
+namespace app {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+
+static const uint32_t kIndexMagic = 0x58494150; // "PAIX"
+
+// Increment this version when the format of the index file changes
+static const uint16_t kIndexVersion = 1;
+
+static void write_time(std::ostream& os, const base::Time& time)
+{
+  write16(os, time.year);
+  write8(os, time.month);
+  write8(os, time.day);
+  write8(os, time.hour);
+  write8(os, time.minute);
+  write8(os, time.second);
+}
+
+static base::Time read_time(std::istream& is)
+{
+  base::Time time;
+  time.year = read16(is);
+  time.month = read8(is);
+  time.day = read8(is);
+  time.hour = read8(is);
+  time.minute = read8(is);
+  time.second = read8(is);
+  return time;
+}
+
+PalettesIndex::PalettesIndex()
+  : m_loaded(false)
+  , m_modified(false)
+{
+  ResourceFinder rf;
+  rf.includeUserDir("cache/palettes.index");
+  m_filename = rf.defaultFilename();
+}
+
+PalettesIndex::~PalettesIndex()
+{
+  if (m_modified)
+    save();
+}
+
+std::unique_ptr<doc::Palette> PalettesIndex::get(const std::string& path)
+{
+  const std::lock_guard lock(m_mutex);
+  load();
+
+  auto it = m_entries.find(path);
+  if (it == m_entries.end())
+    return nullptr;
+
+  const Entry& entry = it->second;
+  if (entry.size != base::file_size(path) ||
+      !(entry.time == base::get_modification_time(path)))
+    return nullptr;
+
+  return std::make_unique<doc::Palette>(*entry.palette);
+}
+
+void PalettesIndex::set(const std::string& path, const doc::Palette* palette)
+{
+  const std::lock_guard lock(m_mutex);
+  load();
+
+  Entry& entry = m_entries[path];
+  entry.size = base::file_size(path);
+  entry.time = base::get_modification_time(path);
+  entry.palette = std::make_unique<doc::Palette>(*palette);
+  m_modified = true;
+}
+
+void PalettesIndex::load()
+{
+  if (m_loaded)
+    return;
+  m_loaded = true;
+
+  if (!base::is_file(m_filename))
+    return;
+
+  try {
+    std::ifstream s(FSTREAM_PATH(m_filename), std::ifstream::binary);
+    if (read32(s) != kIndexMagic ||
+        read16(s) != kIndexVersion)
+      return;
+
+    const uint32_t n = read32(s);
+    for (uint32_t i=0; i<n && s.good(); ++i) {
+      const std::string path = doc::read_string(s);
+      Entry entry;
+      entry.size = read32(s);
+      entry.size |= uint64_t(read32(s)) << 32;
+      entry.time = read_time(s);
+      entry.palette.reset(doc::read_palette(s));
+      entry.palette->setComment(doc::read_string(s));
+      if (s.good())
+        m_entries[path] = std::move(entry);
+    }
+  }
+  catch (const std::exception& ex) {
+    // The index is corrupted, palettes will be decoded again
+    LOG(ERROR, "RESLOAD: Error reading palettes index: %s\n", ex.what());
+    m_entries.clear();
+  }
+}
+
+void PalettesIndex::save()
+{
+  try {
+    const std::string dir = base::get_file_path(m_filename);
+    if (!base::is_directory(dir))
+      base::make_all_directories(dir);
+
+    std::ofstream s(FSTREAM_PATH(m_filename), std::ofstream::binary);
+    write32(s, kIndexMagic);
+    write16(s, kIndexVersion);
+    write32(s, uint32_t(m_entries.size()));
+    for (const auto& [path, entry] : m_entries) {
+      doc::write_string(s, path);
+      write32(s, uint32_t(entry.size & 0xffffffff));
+      write32(s, uint32_t(entry.size >> 32));
+      write_time(s, entry.time);
+      doc::write_palette(s, entry.palette.get());
+      doc::write_string(s, entry.palette->comment());
+    }
+  }
+  catch (const std::exception& ex) {
+    LOG(ERROR, "RESLOAD: Error writing palettes index: %s\n", ex.what());
+  }
+}
+
+} // namespace app
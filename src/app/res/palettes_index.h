@@ -0,0 +1,67 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_RES_PALETTES_INDEX_H_INCLUDED
+#define APP_RES_PALETTES_INDEX_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/time.h"
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace doc {
+  class Palette;
+}
+
+namespace app {
+
+  // Persistent cache (one file in the user dir) with the colors and
+  // the comment of each palette file of the palettes library, so the
+  // list of palettes can be displayed without decoding all the
+  // palette files each time. An entry is valid while the size and
+  // the modification time of its palette file are the same.
+  //
+  // It can be used from several threads. The index file is read the
+  // first time it's needed, and written when the index is destroyed
+  // (if it was modified).
+  class PalettesIndex {
+  public:
+    PalettesIndex();
+    ~PalettesIndex();
+
+    // Returns a copy of the cached palette of the given file, or
+    // nullptr if the file is not in the index or it was modified.
+    std::unique_ptr<doc::Palette> get(const std::string& path);
+
+    void set(const std::string& path, const doc::Palette* palette);
+
+  private:
+    struct Entry {
+      uint64_t size = 0;
+      base::Time time;
+      std::unique_ptr<doc::Palette> palette;
+    };
+
+    void load();
+    void save();
+
+    std::mutex m_mutex;
+    std::string m_filename;
+    std::map<std::string, Entry> m_entries;
+    bool m_loaded;
+    bool m_modified;
+
+    DISABLE_COPYING(PalettesIndex);
+  };
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "app/file/palette_file.h"
 #include "app/file_system.h"
 #include "app/res/palette_resource.h"
+#include "app/res/palettes_index.h"
 #include "app/resource_finder.h"
 #include "base/fs.h"
 #include "base/scoped_value.h"
@@ -25,10 +26,12 @@
 namespace app {
 
 PalettesLoaderDelegate::PalettesLoaderDelegate()
+  : m_config(std::make_shared<FileOpConfig>())
+  , m_index(std::make_shared<PalettesIndex>())
 {
   // Necessary to load preferences in the UI-thread which will be used
   // in a FileOp executed in a background thread.
-  m_config.fillFromPreferences();
+  m_config->fillFromPreferences();
 }
 
 void PalettesLoaderDelegate::getResourcesPaths(std::map<std::string, std::string>& idAndPath) const
@@ -63,11 +66,9 @@ void PalettesLoaderDelegate::getResourcesPaths(std::map<std::string, std::string
 Resource* PalettesLoaderDelegate::loadResource(const std::string& id,
                                                const std::string& path)
 {
-  auto palette = load_palette(path.c_str(), &m_config);
-  if (palette)
-    return new PaletteResource(id, path, std::move(palette));
-  else
-    return nullptr;
+  // Only the name and the path are listed here, the palette file is
+  // decoded when it's needed
+  return new PaletteResource(id, path, m_config, m_index);
 }
 
 } // namespace app
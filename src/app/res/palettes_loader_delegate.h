@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -12,7 +12,13 @@
 #include "app/file/file_op_config.h"
 #include "app/res/resources_loader_delegate.h"
 
+#include <memory>
+
 namespace app {
+  class PalettesIndex;
+
+  // Lists the palette files of the palettes library. Palettes are
+  // decoded on demand (see PaletteResource).
 
   class PalettesLoaderDelegate : public ResourcesLoaderDelegate {
   public:
@@ -24,7 +30,8 @@ namespace app {
                                    const std::string& path) override;
 
   private:
-    FileOpConfig m_config;
+    std::shared_ptr<FileOpConfig> m_config;
+    std::shared_ptr<PalettesIndex> m_index;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,6 +15,7 @@
 #include "app/commands/new_params.h"
 #include "app/commands/params.h"
 #include "app/context.h"
+#include "app/extensions.h"
 #include "app/script/luacpp.h"
 
 namespace app {
@@ -71,8 +72,16 @@ int AppCommand_index(lua_State* L)
     return luaL_error(L, "id in app.command.id() must be a string");
 
   Command* cmd = Commands::instance()->byId(id);
-  if (!cmd)
-    return luaL_error(L, "command '%s' not found", id);
+  if (!cmd) {
+    // The command might be defined by an extension that is waiting
+    // for this command to be activated
+    App::instance()->extensions().activateExtensions(
+      std::string("onCommand:") + id);
+
+    cmd = Commands::instance()->byId(id);
+    if (!cmd)
+      return luaL_error(L, "command '%s' not found", id);
+  }
 
   push_ptr(L, cmd);
   return 1;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -157,23 +157,34 @@ int App_transaction(lua_State* L)
     if (!ctx)
       return luaL_error(L, "no context");
 
+    bool ok = true;
     try {
       // We lock the document in the whole transaction because the
       // RWLock now is re-entrant and we are able to call commands
       // inside the app.transaction() (creating inner ContextWriters).
       ContextWriter writer(ctx);
+
+      // UI updates are deferred until the end of the transaction
+      // (after the commit/rollback)
+      DocBatchUpdate batch(writer.document());
       Tx tx(writer, label);
 
       lua_pushvalue(L, -1);
-      if (lua_pcall(L, 0, LUA_MULTRET, 0) == LUA_OK)
+      ok = (lua_pcall(L, 0, LUA_MULTRET, 0) == LUA_OK);
+      if (ok) {
         tx.commit();
-      else
-        return lua_error(L); // pcall already put an error object on the stack
-      nresults = lua_gettop(L) - top;
+        nresults = lua_gettop(L) - top;
+      }
     }
     catch (const LockedDocException& ex) {
       return luaL_error(L, "cannot lock document for transaction\n%s", ex.what());
     }
+
+    // The error is raised outside the previous block because
+    // lua_error() doesn't return (it would skip the rollback of the
+    // transaction, the document unlock and the end of the batch)
+    if (!ok)
+      return lua_error(L); // pcall already put an error object on the stack
   }
   return nresults;
 }
@@ -0,0 +1,118 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/app.h"
+#include "app/script/engine.h"
+#include "app/script/luacpp.h"
+#include "app/script/profiler.h"
+#include "app/script/security.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+
+#include <fstream>
+
+namespace app {
+namespace script {
+
+namespace {
+
+struct AppProfiler { };
+
+Engine* engine()
+{
+  return App::instance()->scriptEngine();
+}
+
+// app.profiler.start([instructionsPerSample])
+int AppProfiler_start(lua_State* L)
+{
+  const int instructions =
+    luaL_optinteger(L, 1, Profiler::kDefaultInstructions);
+  if (!engine()->startProfiler(instructions))
+    return luaL_error(L, "the profiler cannot be used with the debugger");
+  return 0;
+}
+
+int AppProfiler_stop(lua_State* L)
+{
+  engine()->stopProfiler();
+  return 0;
+}
+
+int AppProfiler_reset(lua_State* L)
+{
+  if (Profiler* profiler = engine()->profiler())
+    profiler->reset();
+  return 0;
+}
+
+int AppProfiler_isRunning(lua_State* L)
+{
+  Profiler* profiler = engine()->profiler();
+  lua_pushboolean(L, profiler && profiler->isRunning());
+  return 1;
+}
+
+// app.profiler.report([maxRows]) returns the report as a string
+// (e.g. to print it in the developer console)
+int AppProfiler_report(lua_State* L)
+{
+  const int maxRows = luaL_optinteger(L, 1, 0);
+  if (Profiler* profiler = engine()->profiler())
+    lua_pushstring(L, profiler->report(maxRows).c_str());
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
+// app.profiler.saveFlameGraph(filename)
+int AppProfiler_saveFlameGraph(lua_State* L)
+{
+  const std::string absFn =
+    base::get_absolute_path(luaL_checkstring(L, 1));
+  if (!ask_access(L, absFn.c_str(), FileAccessMode::Write, ResourceType::File))
+    return luaL_error(L, "script doesn't have access to write file %s",
+                      absFn.c_str());
+
+  Profiler* profiler = engine()->profiler();
+  std::ofstream f(FSTREAM_PATH(absFn), std::ofstream::binary);
+  if (profiler && f)
+    profiler->writeFlameGraph(f);
+  lua_pushboolean(L, profiler && f.good());
+  return 1;
+}
+
+const luaL_Reg AppProfiler_methods[] = {
+  { "start", AppProfiler_start },
+  { "stop", AppProfiler_stop },
+  { "reset", AppProfiler_reset },
+  { "isRunning", AppProfiler_isRunning },
+  { "report", AppProfiler_report },
+  { "saveFlameGraph", AppProfiler_saveFlameGraph },
+  { nullptr, nullptr }
+};
+
+} // anonymous namespace
+
+DEF_MTNAME(AppProfiler);
+
+void register_app_profiler_object(lua_State* L)
+{
+  REG_CLASS(L, AppProfiler);
+
+  lua_getglobal(L, "app");
+  lua_pushstring(L, "profiler");
+  push_new<AppProfiler>(L);
+  lua_rawset(L, -3);
+  lua_pop(L, 1);
+}
+
+} // namespace script
+} // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,7 +18,9 @@
 #include "doc/sprite.h"
 
 #include <algorithm>
+#include <cstdint>
 #include <iterator>
+#include <vector>
 
 namespace app {
 namespace script {
@@ -27,21 +29,88 @@ using namespace doc;
 
 namespace {
 
+// Cels of a sprite/layer are calculated lazily (when the collection
+// is indexed) and recalculated only when the version of the
+// sprite/layers change, so "sprite.cels[i]" in a loop doesn't create
+// a new list of cels each time.
 struct CelsObj {
+  ObjectId spriteId = 0;
+  ObjectId layerId = 0;
   ObjectIds cels;
-  CelsObj(CelsRange& range) {
-    for (const Cel* cel : range)
-      cels.push_back(cel->id());
+  bool valid = false;
+
+  // IDs/versions of the sprite and layers used to calculate "cels"
+  std::vector<uint32_t> key;
+  std::vector<uint32_t> newKey;
+
+  CelsObj(Sprite* sprite)
+    : spriteId(sprite->id()) {
   }
-  CelsObj(CelList& list) {
-    for (Cel* cel : list)
-      cels.push_back(cel->id());
+  CelsObj(Layer* layer)
+    : layerId(layer->id()) {
   }
   CelsObj(const ObjectIds& cels)
-    : cels(cels) {
+    : cels(cels)
+    , valid(true) {
   }
   CelsObj(const CelsObj&) = delete;
   CelsObj& operator=(const CelsObj&) = delete;
+
+  const ObjectIds& get(lua_State* L) {
+    if (spriteId) {
+      auto sprite = check_docobj(L, doc::get<Sprite>(spriteId));
+      newKey.clear();
+      newKey.push_back(sprite->version());
+      newKey.push_back(sprite->totalFrames());
+      addLayersKey(sprite->root());
+      if (updateKey()) {
+        for (const Cel* cel : sprite->cels())
+          cels.push_back(cel->id());
+      }
+    }
+    else if (layerId) {
+      auto layer = check_docobj(L, doc::get<Layer>(layerId));
+      newKey.clear();
+      addLayerKey(layer);
+      if (updateKey() && layer->isImage()) {
+        auto layerImage = static_cast<const LayerImage*>(layer);
+        cels.reserve(layerImage->getCelsCount());
+        for (auto it=layerImage->getCelBegin(),
+                  end=layerImage->getCelEnd(); it!=end; ++it)
+          cels.push_back((*it)->id());
+      }
+    }
+    return cels;
+  }
+
+private:
+  void addLayerKey(const Layer* layer) {
+    newKey.push_back(layer->id());
+    newKey.push_back(layer->version());
+    newKey.push_back(layer->isImage() ?
+                     static_cast<const LayerImage*>(layer)->getCelsCount(): 0);
+  }
+
+  void addLayersKey(const LayerGroup* group) {
+    addLayerKey(group);
+    for (const Layer* child : group->layers()) {
+      if (child->isGroup())
+        addLayersKey(static_cast<const LayerGroup*>(child));
+      else
+        addLayerKey(child);
+    }
+  }
+
+  // Returns true if the list of cels must be recalculated (the list
+  // is cleared in that case)
+  bool updateKey() {
+    if (valid && key == newKey)
+      return false;
+    std::swap(key, newKey);
+    cels.clear();
+    valid = true;
+    return true;
+  }
 };
 
 int Cels_gc(lua_State* L)
@@ -53,16 +122,17 @@ int Cels_gc(lua_State* L)
 int Cels_len(lua_State* L)
 {
   auto obj = get_obj<CelsObj>(L, 1);
-  lua_pushinteger(L, obj->cels.size());
+  lua_pushinteger(L, obj->get(L).size());
   return 1;
 }
 
 int Cels_index(lua_State* L)
 {
   auto obj = get_obj<CelsObj>(L, 1);
+  const ObjectIds& cels = obj->get(L);
   const int i = lua_tointeger(L, 2);
-  if (i >= 1 && i <= obj->cels.size())
-    push_docobj<Cel>(L, obj->cels[i-1]);
+  if (i >= 1 && i <= cels.size())
+    push_docobj<Cel>(L, cels[i-1]);
   else
     lua_pushnil(L);
   return 1;
@@ -85,18 +155,24 @@ void register_cels_class(lua_State* L)
   REG_CLASS(L, Cels);
 }
 
+// The same collection is returned for each sprite/layer while it's
+// referenced from Lua
+static const char kCelsCache = 0;
+
 void push_cels(lua_State* L, Sprite* sprite)
 {
-  CelsRange cels = sprite->cels();
-  push_new<CelsObj>(L, cels);
+  if (!get_cached(L, &kCelsCache, sprite->id())) {
+    push_new<CelsObj>(L, sprite);
+    set_cached(L, &kCelsCache, sprite->id());
+  }
 }
 
 void push_cels(lua_State* L, Layer* layer)
 {
-  CelList cels;
-  if (layer->isImage())
-    static_cast<LayerImage*>(layer)->getCels(cels);
-  push_new<CelsObj>(L, cels);
+  if (!get_cached(L, &kCelsCache, layer->id())) {
+    push_new<CelsObj>(L, layer);
+    set_cached(L, &kCelsCache, layer->id());
+  }
 }
 
 void push_cels(lua_State* L, const ObjectIds& cels)
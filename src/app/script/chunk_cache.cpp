@@ -0,0 +1,149 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/script/chunk_cache.h"
+
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/log.h"
+#include "fmt/format.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace app {
+namespace script {
+
+namespace {
+
+const char kMagic[8] = "ASELUAC";
+
+// Header of each cache file. The Lua version is included because the
+// bytecode is not compatible between Lua releases, and the bytecode
+// hash is used to detect truncated/corrupted files (Lua doesn't
+// verify the bytecode).
+struct Header {
+  char magic[8];
+  char luaVersion[32];
+  uint64_t sourceSize;
+  uint64_t sourceHash;
+  uint64_t bytecodeSize;
+  uint64_t bytecodeHash;
+};
+
+// FNV-1a
+uint64_t hash_bytes(const void* data, size_t size)
+{
+  auto p = (const uint8_t*)data;
+  uint64_t hash = 0xcbf29ce484222325ull;
+  for (size_t i=0; i<size; ++i) {
+    hash ^= p[i];
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+
+Header make_header(const char* code, size_t size)
+{
+  Header header;
+  std::memset(&header, 0, sizeof(header));
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  std::strncpy(header.luaVersion, LUA_RELEASE, sizeof(header.luaVersion)-1);
+  header.sourceSize = size;
+  header.sourceHash = hash_bytes(code, size);
+  return header;
+}
+
+int writer(lua_State* L, const void* p, size_t sz, void* ud)
+{
+  ((std::string*)ud)->append((const char*)p, sz);
+  return 0;
+}
+
+} // anonymous namespace
+
+ChunkCache::ChunkCache(const std::string& dir)
+  : m_dir(dir)
+{
+}
+
+int ChunkCache::load(lua_State* L,
+                     const char* code, size_t size,
+                     const char* chunkname)
+{
+  // Only script files are cached (code evaluated from strings can
+  // be different each time)
+  if (m_dir.empty() || !chunkname || chunkname[0] != '@')
+    return luaL_loadbuffer(L, code, size, chunkname);
+
+  Header header = make_header(code, size);
+  const std::string fn =
+    base::join_path(
+      m_dir,
+      fmt::format("{:016x}.luac",
+                  hash_bytes(chunkname, std::strlen(chunkname))));
+
+  // Load the bytecode from the cache
+  {
+    std::ifstream f(FSTREAM_PATH(fn), std::ifstream::binary);
+    Header cached;
+    if (f && f.read((char*)&cached, sizeof(cached)) &&
+        std::memcmp(&cached, &header, offsetof(Header, bytecodeSize)) == 0) {
+      std::string bytecode(cached.bytecodeSize, 0);
+      if (f.read(bytecode.data(), bytecode.size()) &&
+          hash_bytes(bytecode.data(), bytecode.size()) == cached.bytecodeHash) {
+        if (luaL_loadbufferx(L, bytecode.data(), bytecode.size(),
+                             chunkname, "b") == LUA_OK) {
+          return LUA_OK;
+        }
+        lua_pop(L, 1);          // Pop error message
+      }
+    }
+  }
+
+  const int status = luaL_loadbuffer(L, code, size, chunkname);
+  if (status != LUA_OK)
+    return status;
+
+  // Save the bytecode in the cache (including debug information for
+  // error messages and the debugger)
+  std::string bytecode;
+  if (lua_dump(L, writer, &bytecode, 0) == 0) {
+    header.bytecodeSize = bytecode.size();
+    header.bytecodeHash = hash_bytes(bytecode.data(), bytecode.size());
+
+    if (!base::is_directory(m_dir))
+      base::make_all_directories(m_dir);
+
+    std::ofstream f(FSTREAM_PATH(fn), std::ofstream::binary);
+    f.write((const char*)&header, sizeof(header));
+    f.write(bytecode.data(), bytecode.size());
+    if (!f)
+      LOG(ERROR, "SCRIPT: Cannot write compiled chunk %s\n", fn.c_str());
+  }
+  return LUA_OK;
+}
+
+void ChunkCache::clear()
+{
+  if (!base::is_directory(m_dir))
+    return;
+
+  for (const auto& fn : base::list_files(m_dir)) {
+    if (base::get_file_extension(fn) == "luac")
+      base::delete_file(base::join_path(m_dir, fn));
+  }
+  base::remove_directory(m_dir);
+}
+
+} // namespace script
+} // namespace app
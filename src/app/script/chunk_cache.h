@@ -0,0 +1,44 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_SCRIPT_CHUNK_CACHE_H_INCLUDED
+#define APP_SCRIPT_CHUNK_CACHE_H_INCLUDED
+#pragma once
+
+#include "app/script/luacpp.h"
+
+#include <string>
+
+namespace app {
+namespace script {
+
+  // Cache of precompiled Lua chunks (bytecode generated with
+  // lua_dump()) in a directory. There is one file for each script
+  // file (chunk names starting with '@'), which is regenerated when
+  // the source code or the Lua version changes.
+  class ChunkCache {
+  public:
+    explicit ChunkCache(const std::string& dir);
+
+    const std::string& dir() const { return m_dir; }
+
+    // Same as luaL_loadbuffer(), but it tries to load the bytecode
+    // from the cache first.
+    int load(lua_State* L,
+             const char* code, size_t size,
+             const char* chunkname);
+
+    // Deletes all the files in the cache directory
+    void clear();
+
+  private:
+    std::string m_dir;
+  };
+
+} // namespace script
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -304,6 +304,29 @@ int Editor_get_mousePos(lua_State* L)
   return 1;
 }
 
+int Editor_get_paintStats(lua_State* L)
+{
+  auto obj = get_obj<EditorObj>(L, 1);
+  const Editor::PaintStats& st = obj->editor()->paintStats();
+  lua_newtable(L);
+  lua_pushnumber(L, st.paintTime);
+  lua_setfield(L, -2, "paintTime");
+  lua_pushnumber(L, st.renderTime);
+  lua_setfield(L, -2, "renderTime");
+  setfield_integer(L, "cels", st.cels);
+  lua_pushinteger(L, st.dirtyPixels);
+  lua_setfield(L, -2, "dirtyPixels");
+  setfield_integer(L, "compositeHits", st.compositeHits);
+  setfield_integer(L, "compositeMisses", st.compositeMisses);
+  setfield_integer(L, "mipmapHits", st.mipmapHits);
+  setfield_integer(L, "mipmapMisses", st.mipmapMisses);
+  setfield_integer(L, "tilemapHits", st.tilemapHits);
+  setfield_integer(L, "tilemapMisses", st.tilemapMisses);
+  setfield_integer(L, "textureHits", st.textureHits);
+  setfield_integer(L, "textureMisses", st.textureMisses);
+  return 1;
+}
+
 const luaL_Reg Editor_methods[] = {
   { "__gc", Editor_gc },
   { "__eq", Editor_eq },
@@ -316,6 +339,7 @@ const Property Editor_properties[] = {
   { "sprite", Editor_get_sprite, nullptr },
   { "spritePos", Editor_get_spritePos, nullptr },
   { "mousePos", Editor_get_mousePos, nullptr },
+  { "paintStats", Editor_get_paintStats, nullptr },
   { nullptr, nullptr, nullptr }
 };
 
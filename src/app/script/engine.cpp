@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,13 +17,16 @@
 #include "app/doc_range.h"
 #include "app/pref/preferences.h"
 #include "app/script/blend_mode.h"
+#include "app/script/chunk_cache.h"
 #include "app/script/luacpp.h"
+#include "app/script/profiler.h"
 #include "app/script/require.h"
 #include "app/script/security.h"
 #include "app/sprite_sheet_type.h"
 #include "app/tilemap_mode.h"
 #include "app/tileset_mode.h"
 #include "app/tools/ink_type.h"
+#include "app/trace.h"
 #include "base/chrono.h"
 #include "base/file_handle.h"
 #include "base/fs.h"
@@ -120,7 +123,7 @@ int dofile(lua_State *L)
   }
 
   lua_settop(L, 1);
-  if (luaL_loadfile(L, fname.c_str()) != LUA_OK)
+  if (load_file(L, fname) != LUA_OK)
     return lua_error(L);
   {
     AddScriptFilename add(fname);
@@ -154,6 +157,7 @@ int unsupported(lua_State* L)
 void register_app_object(lua_State* L);
 void register_app_pixel_color_object(lua_State* L);
 void register_app_fs_object(lua_State* L);
+void register_app_profiler_object(lua_State* L);
 void register_app_command_object(lua_State* L);
 void register_app_preferences_object(lua_State* L);
 void register_json_object(lua_State* L);
@@ -173,6 +177,7 @@ void register_events_class(lua_State* L);
 void register_frame_class(lua_State* L);
 void register_frames_class(lua_State* L);
 void register_grid_class(lua_State* L);
+void register_image_buffer_class(lua_State* L);
 void register_image_class(lua_State* L);
 void register_image_iterator_class(lua_State* L);
 void register_image_spec_class(lua_State* L);
@@ -204,6 +209,7 @@ void register_tool_class(lua_State* L);
 void register_uuid_class(lua_State* L);
 void register_version_class(lua_State* L);
 void register_websocket_class(lua_State* L);
+void register_worker_class(lua_State* L);
 
 void set_app_params(lua_State* L, const Params& params);
 
@@ -270,6 +276,7 @@ Engine::Engine()
   register_app_object(L);
   register_app_pixel_color_object(L);
   register_app_fs_object(L);
+  register_app_profiler_object(L);
   register_app_command_object(L);
   register_app_preferences_object(L);
   register_json_object(L);
@@ -496,6 +503,7 @@ Engine::Engine()
   register_frame_class(L);
   register_frames_class(L);
   register_grid_class(L);
+  register_image_buffer_class(L);
   register_image_class(L);
   register_image_iterator_class(L);
   register_image_spec_class(L);
@@ -526,6 +534,7 @@ Engine::Engine()
   register_tool_class(L);
   register_uuid_class(L);
   register_version_class(L);
+  register_worker_class(L);
 #if ENABLE_WEBSOCKET
   register_websocket_class(L);
 #endif
@@ -544,6 +553,7 @@ void Engine::destroy()
 #ifdef ENABLE_UI
   close_all_dialogs();
 #endif
+  stopProfiler();
   lua_close(L);
   L = nullptr;
 }
@@ -556,9 +566,10 @@ void Engine::printLastResult()
 bool Engine::evalCode(const std::string& code,
                       const std::string& filename)
 {
+  APP_TRACE_ZONE("Run script");
   bool ok = true;
   try {
-    if (luaL_loadbuffer(L, code.c_str(), code.size(), filename.c_str()) ||
+    if (load_chunk(L, code, filename) ||
         lua_pcall(L, 0, 1, 0)) {
       const char* s = lua_tostring(L, -1);
       if (s)
@@ -648,6 +659,7 @@ bool Engine::evalUserFile(const std::string& filename,
 
 void Engine::startDebugger(DebuggerDelegate* debuggerDelegate)
 {
+  stopProfiler();
   g_debuggerDelegate = debuggerDelegate;
 
   lua_Hook hook = [](lua_State* L, lua_Debug* ar) {
@@ -664,6 +676,24 @@ void Engine::startDebugger(DebuggerDelegate* debuggerDelegate)
 void Engine::stopDebugger()
 {
   lua_sethook(L, nullptr, 0, 0);
+  g_debuggerDelegate = nullptr;
+}
+
+bool Engine::startProfiler(const int instructions)
+{
+  if (g_debuggerDelegate)
+    return false;
+
+  if (!m_profiler)
+    m_profiler = std::make_unique<Profiler>();
+  m_profiler->start(L, instructions);
+  return true;
+}
+
+void Engine::stopProfiler()
+{
+  if (m_profiler)
+    m_profiler->stop(L);
 }
 
 void Engine::onConsoleError(const char* text)
@@ -687,5 +717,29 @@ void Engine::onConsolePrint(const char* text)
   }
 }
 
+int load_chunk(lua_State* L,
+               const std::string& code,
+               const std::string& chunkname)
+{
+  Engine* engine = App::instance()->scriptEngine();
+  if (ChunkCache* chunkCache = (engine ? engine->chunkCache(): nullptr))
+    return chunkCache->load(L, code.c_str(), code.size(), chunkname.c_str());
+  return luaL_loadbuffer(L, code.c_str(), code.size(), chunkname.c_str());
+}
+
+int load_file(lua_State* L, const std::string& filename)
+{
+  std::stringstream buf;
+  {
+    std::ifstream s(FSTREAM_PATH(filename), std::ifstream::binary);
+    if (!s) {
+      lua_pushfstring(L, "cannot open %s", filename.c_str());
+      return LUA_ERRFILE;
+    }
+    buf << s.rdbuf();
+  }
+  return load_chunk(L, buf.str(), "@" + filename);
+}
+
 } // namespace script
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -27,6 +27,7 @@
 #include <cstdio>
 #include <functional>
 #include <map>
+#include <memory>
 #include <string>
 
 struct lua_State;
@@ -69,6 +70,9 @@ namespace app {
 
   namespace script {
 
+  class ChunkCache;
+  class Profiler;
+
   class EngineDelegate {
   public:
     virtual ~EngineDelegate() { }
@@ -107,6 +111,13 @@ namespace app {
 
     void handleException(const std::exception& ex);
 
+    // Precompiled chunks of the scripts that are being evaluated
+    // (e.g. the cache of the extension which is being initialized)
+    ChunkCache* chunkCache() const { return m_chunkCache; }
+    void setChunkCache(ChunkCache* chunkCache) {
+      m_chunkCache = chunkCache;
+    }
+
     void consolePrint(const char* text) {
       onConsolePrint(text);
     }
@@ -120,6 +131,12 @@ namespace app {
     void startDebugger(DebuggerDelegate* debuggerDelegate);
     void stopDebugger();
 
+    // The profiler uses the same hook as the debugger, so it cannot
+    // be started while the debugger is running (returns false).
+    bool startProfiler(int instructions);
+    void stopProfiler();
+    Profiler* profiler() { return m_profiler.get(); }
+
   private:
     void onConsoleError(const char* text);
     void onConsolePrint(const char* text);
@@ -128,6 +145,23 @@ namespace app {
     EngineDelegate* m_delegate;
     bool m_printLastResult;
     int m_returnCode;
+    std::unique_ptr<Profiler> m_profiler;
+    ChunkCache* m_chunkCache = nullptr;
+  };
+
+  class SetChunkCache {
+  public:
+    SetChunkCache(Engine* engine, ChunkCache* chunkCache)
+      : m_engine(engine),
+        m_oldChunkCache(engine->chunkCache()) {
+      m_engine->setChunkCache(chunkCache);
+    }
+    ~SetChunkCache() {
+      m_engine->setChunkCache(m_oldChunkCache);
+    }
+  private:
+    Engine* m_engine;
+    ChunkCache* m_oldChunkCache;
   };
 
   class ScopedEngineDelegate {
@@ -146,8 +180,15 @@ namespace app {
   };
 
   void push_app_events(lua_State* L);
+
+  // Loads the given code/file as a Lua function in the stack (or an
+  // error message) using the chunk cache of the engine if it's set.
+  // Returns the status (LUA_OK, LUA_ERRSYNTAX, etc.) as
+  // luaL_loadbuffer().
+  int load_chunk(lua_State* L, const std::string& code, const std::string& chunkname);
+  int load_file(lua_State* L, const std::string& filename);
   void push_app_theme(lua_State* L, int uiscale = 1);
-  int push_image_iterator_function(lua_State* L, const doc::Image* image, int extraArgIndex);
+  int push_image_iterator_function(lua_State* L, doc::Image* image, int extraArgIndex);
   void push_brush(lua_State* L, const doc::BrushRef& brush);
   void push_cel_image(lua_State* L, doc::Cel* cel);
   void push_cel_images(lua_State* L, const doc::ObjectIds& cels);
@@ -159,6 +200,7 @@ namespace app {
   void push_editor(lua_State* L, Editor* editor);
   void push_group_layers(lua_State* L, doc::LayerGroup* group);
   void push_image(lua_State* L, doc::Image* image);
+  void push_image_buffer(lua_State* L, doc::Image* image, doc::Tileset* tileset, doc::tile_index ti);
   void push_layers(lua_State* L, const doc::ObjectIds& layers);
   void push_palette(lua_State* L, doc::Palette* palette);
   void push_plugin(lua_State* L, Extension* ext);
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021-2023  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -20,6 +20,7 @@
 #include "app/script/docobj.h"
 #include "app/script/engine.h"
 #include "app/script/luacpp.h"
+#include "app/script/profiler.h"
 #include "app/script/values.h"
 #include "app/site.h"
 #include "app/ui/main_window.h"
@@ -76,9 +77,13 @@ public:
     return false;
   }
 
-  void add(EventType eventType, EventListener callbackRef) {
-    if (eventType >= m_listeners.size())
+  void add(EventType eventType, const char* eventName,
+           EventListener callbackRef) {
+    if (eventType >= m_listeners.size()) {
       m_listeners.resize(eventType+1);
+      m_eventNames.resize(eventType+1);
+    }
+    m_eventNames[eventType] = eventName;
 
     auto& listeners = m_listeners[eventType];
     listeners.push_back(callbackRef);
@@ -120,6 +125,9 @@ protected:
         // Get user-defined callback function
         lua_rawgeti(L, LUA_REGISTRYINDEX, callbackRef);
 
+        Profiler::ListenerScope profile(engine->profiler(), L,
+                                        m_eventNames[eventType].c_str());
+
         int callbackArgs = 0;
         if (args.size() > 0) {
           ++callbackArgs;
@@ -147,6 +155,7 @@ private:
 
   using EventListeners = std::vector<EventListener>;
   std::vector<EventListeners> m_listeners;
+  std::vector<std::string> m_eventNames; // Used by the profiler
 };
 
 // Used in BeforeCommand
@@ -465,7 +474,7 @@ int Events_on(lua_State* L)
   // Copy the callback function to add it to the global registry
   lua_pushvalue(L, 3);
   int callbackRef = luaL_ref(L, LUA_REGISTRYINDEX);
-  evs->add(type, callbackRef);
+  evs->add(type, eventName, callbackRef);
 
   // Return the callback ref (this is an EventListener easier to use
   // in Events_off())
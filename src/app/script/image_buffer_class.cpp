@@ -0,0 +1,253 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/script/docobj.h"
+#include "app/script/engine.h"
+#include "app/script/luacpp.h"
+#include "doc/image.h"
+#include "doc/tileset.h"
+
+#include <cstring>
+
+namespace app {
+namespace script {
+
+namespace {
+
+// Mutable view of the pixels of an image (Image.buffer). It accesses
+// the image rows directly (without copying them to a Lua string as
+// Image.bytes does). Offsets are 0-based, u8() uses byte offsets
+// and u32() indexes of 32-bit values.
+struct ImageBufferObj {
+  doc::ObjectId imageId = 0;
+  doc::ObjectId tilesetId = 0;
+  doc::tile_index ti = 0;
+
+  ImageBufferObj(doc::Image* image,
+                 doc::Tileset* tileset,
+                 doc::tile_index ti)
+    : imageId(image->id())
+    , tilesetId(tileset ? tileset->id(): 0)
+    , ti(ti) {
+  }
+  ImageBufferObj(const ImageBufferObj&) = delete;
+  ImageBufferObj& operator=(const ImageBufferObj&) = delete;
+
+  doc::Image* image(lua_State* L) {
+    return check_docobj(L, doc::get<doc::Image>(imageId));
+  }
+
+  static size_t size(const doc::Image* img) {
+    return img->rowBytes() * img->height();
+  }
+
+  const uint8_t* data(lua_State* L, size_t& size) {
+    const doc::Image* img = image(L);
+    size = ImageBufferObj::size(img);
+    return img->getPixelAddress(0, 0);
+  }
+
+  // Returns the pixels to be modified (detaching the pixels shared
+  // with other images) and increments the image version.
+  uint8_t* writableData(lua_State* L, size_t& size) {
+    doc::Image* img = image(L);
+    size = ImageBufferObj::size(img);
+    uint8_t* bits = img->getPixelAddress(0, 0);
+    img->incrementVersion();
+
+    // Rehash tileset
+    if (tilesetId) {
+      if (auto ts = doc::get<doc::Tileset>(tilesetId)) {
+        ts->incrementVersion();
+        ts->notifyTileContentChange(ti);
+      }
+    }
+    return bits;
+  }
+};
+
+void check_range(lua_State* L, const lua_Integer offset,
+                 const lua_Integer count, const size_t size)
+{
+  if (offset < 0 || count < 0 || offset + count > lua_Integer(size))
+    luaL_error(L, "out of bounds access (offset %d, count %d, size %d)",
+               int(offset), int(count), int(size));
+}
+
+int ImageBuffer_gc(lua_State* L)
+{
+  get_obj<ImageBufferObj>(L, 1)->~ImageBufferObj();
+  return 0;
+}
+
+int ImageBuffer_len(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  lua_pushinteger(L, ImageBufferObj::size(obj->image(L)));
+  return 1;
+}
+
+int ImageBuffer_u8(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const lua_Integer i = luaL_checkinteger(L, 2);
+  size_t size;
+  const uint8_t* bits = obj->data(L, size);
+  check_range(L, i, 1, size);
+  lua_pushinteger(L, bits[i]);
+  return 1;
+}
+
+int ImageBuffer_setU8(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const lua_Integer i = luaL_checkinteger(L, 2);
+  const lua_Integer value = luaL_checkinteger(L, 3);
+  size_t size;
+  uint8_t* bits = obj->writableData(L, size);
+  check_range(L, i, 1, size);
+  bits[i] = uint8_t(value);
+  return 0;
+}
+
+int ImageBuffer_u32(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const lua_Integer i = luaL_checkinteger(L, 2);
+  size_t size;
+  const uint8_t* bits = obj->data(L, size);
+  check_range(L, i*4, 4, size);
+  uint32_t value;
+  std::memcpy(&value, bits + i*4, 4);
+  lua_pushinteger(L, value);
+  return 1;
+}
+
+int ImageBuffer_setU32(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const lua_Integer i = luaL_checkinteger(L, 2);
+  const uint32_t value = uint32_t(luaL_checkinteger(L, 3));
+  size_t size;
+  uint8_t* bits = obj->writableData(L, size);
+  check_range(L, i*4, 4, size);
+  std::memcpy(bits + i*4, &value, 4);
+  return 0;
+}
+
+// buffer:fill(byte [, offset [, count]])
+int ImageBuffer_fill(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const int value = int(luaL_checkinteger(L, 2));
+  size_t size;
+  uint8_t* bits = obj->writableData(L, size);
+  const lua_Integer offset = luaL_optinteger(L, 3, 0);
+  const lua_Integer count = luaL_optinteger(L, 4, lua_Integer(size) - offset);
+  check_range(L, offset, count, size);
+  std::memset(bits + offset, value, count);
+  return 0;
+}
+
+// buffer:fillU32(value [, index [, count]])
+int ImageBuffer_fillU32(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const uint32_t value = uint32_t(luaL_checkinteger(L, 2));
+  size_t size;
+  uint8_t* bits = obj->writableData(L, size);
+  const lua_Integer index = luaL_optinteger(L, 3, 0);
+  const lua_Integer count = luaL_optinteger(L, 4, lua_Integer(size/4) - index);
+  check_range(L, index*4, count*4, size);
+  uint8_t* p = bits + index*4;
+  for (lua_Integer i=0; i<count; ++i, p+=4)
+    std::memcpy(p, &value, 4);
+  return 0;
+}
+
+// buffer:copy(offset, src [, srcOffset [, count]]) where src is a
+// string or another buffer (it can be the same buffer)
+int ImageBuffer_copy(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  const lua_Integer offset = luaL_checkinteger(L, 2);
+
+  const uint8_t* src;
+  size_t srcSize;
+  if (auto srcObj = may_get_obj<ImageBufferObj>(L, 3))
+    src = srcObj->data(L, srcSize);
+  else
+    src = (const uint8_t*)luaL_checklstring(L, 3, &srcSize);
+
+  const lua_Integer srcOffset = luaL_optinteger(L, 4, 0);
+  const lua_Integer count = luaL_optinteger(L, 5, lua_Integer(srcSize) - srcOffset);
+  check_range(L, srcOffset, count, srcSize);
+
+  size_t size;
+  uint8_t* bits = obj->writableData(L, size);
+  check_range(L, offset, count, size);
+
+  // The source pointer could be from the same image (and it can be
+  // relocated when the pixels are detached from a shared copy)
+  if (auto srcObj = may_get_obj<ImageBufferObj>(L, 3)) {
+    if (srcObj->imageId == obj->imageId)
+      src = bits;
+  }
+  std::memmove(bits + offset, src + srcOffset, count);
+  return 0;
+}
+
+// buffer:read([offset [, count]]) returns a string
+int ImageBuffer_read(lua_State* L)
+{
+  auto obj = get_obj<ImageBufferObj>(L, 1);
+  size_t size;
+  const uint8_t* bits = obj->data(L, size);
+  const lua_Integer offset = luaL_optinteger(L, 2, 0);
+  const lua_Integer count = luaL_optinteger(L, 3, lua_Integer(size) - offset);
+  check_range(L, offset, count, size);
+  lua_pushlstring(L, (const char*)bits + offset, count);
+  return 1;
+}
+
+const luaL_Reg ImageBuffer_methods[] = {
+  { "__gc", ImageBuffer_gc },
+  { "__len", ImageBuffer_len },
+  { "u8", ImageBuffer_u8 },
+  { "setU8", ImageBuffer_setU8 },
+  { "u32", ImageBuffer_u32 },
+  { "setU32", ImageBuffer_setU32 },
+  { "fill", ImageBuffer_fill },
+  { "fillU32", ImageBuffer_fillU32 },
+  { "copy", ImageBuffer_copy },
+  { "read", ImageBuffer_read },
+  { nullptr, nullptr }
+};
+
+} // anonymous namespace
+
+DEF_MTNAME(ImageBufferObj);
+
+void register_image_buffer_class(lua_State* L)
+{
+  using ImageBuffer = ImageBufferObj;
+  REG_CLASS(L, ImageBuffer);
+}
+
+void push_image_buffer(lua_State* L,
+                       doc::Image* image,
+                       doc::Tileset* tileset,
+                       doc::tile_index ti)
+{
+  push_new<ImageBufferObj>(L, image, tileset, ti);
+}
+
+} // namespace script
+} // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -31,22 +31,24 @@
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/cel.h"
 #include "doc/image.h"
+#include "doc/image_traits.h"
 #include "doc/image_ref.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "render/render.h"
 
 #include <algorithm>
+#include <cmath>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
+#include <unordered_map>
 
 namespace app {
 namespace script {
 
 namespace {
 
-static ImageBufferPtr buf; // TODO non-thread safe
-
 struct ImageObj {
   doc::ObjectId imageId = 0;
   doc::ObjectId celId = 0;
@@ -253,6 +255,10 @@ int Image_clear(lua_State* L)
     color = convert_args_into_pixel_color(L, i, img->pixelFormat());
 
   doc::fill_rect(img, rc, color); // Clips the rectangle to the image bounds
+
+  // Render caches (e.g. composite snapshots or mipmaps) are keyed by
+  // the image version
+  img->incrementVersion();
   return 0;
 }
 
@@ -268,6 +274,7 @@ int Image_drawPixel(lua_State* L)
   else
     color = convert_args_into_pixel_color(L, 4, img->pixelFormat());
   doc::put_pixel(img, x, y, color);
+  img->incrementVersion();
 
   // Rehash tileset
   if (obj->tilesetId) {
@@ -313,11 +320,10 @@ int Image_drawImage(lua_State* L)
 
   if (auto cel = obj->cel(L)) {
     gfx::Rect bounds(0, 0, src->size().w, src->size().h);
-    buf.reset(new doc::ImageBuffer);
     ImageRef tmp_src(
       doc::crop_image(dst,
                       gfx::Rect(pos.x, pos.y, src->size().w, src->size().h),
-                      0, buf));
+                      0));
     doc::blend_image(tmp_src.get(), src, 0, 0, opacity, blendMode);
     // TODO Use something similar to doc::algorithm::shrink_bounds2()
     //      but we need something that does the render and compares
@@ -334,6 +340,7 @@ int Image_drawImage(lua_State* L)
     doc::blend_image(dst, src,
                      pos.x, pos.y,
                      opacity, blendMode);
+    dst->incrementVersion();
   }
   return 0;
 }
@@ -368,6 +375,7 @@ int Image_drawSprite(lua_State* L)
   // the source image without undo information.
   else {
     render_sprite(dst, sprite, frame, pos.x, pos.y);
+    dst->incrementVersion();
   }
   return 0;
 }
@@ -634,6 +642,452 @@ int Image_flip(lua_State* L)
   }
   else {
     doc::algorithm::flip_image(img, img->bounds(), flipType);
+    img->incrementVersion();
+  }
+  return 0;
+}
+
+// Bulk pixel operations. They process whole rows in C++ so scripts
+// don't need a Lua call for each pixel (e.g. with Image:pixels() or
+// Image:getPixel()/drawPixel()).
+
+// Channels of each pixel format used by the bulk operations.
+template<typename ImageTraits>
+struct PixelChannels;
+
+template<>
+struct PixelChannels<doc::RgbTraits> {
+  static constexpr int n = 4;
+  static void get(const uint32_t c, int* v) {
+    v[0] = doc::rgba_getr(c);
+    v[1] = doc::rgba_getg(c);
+    v[2] = doc::rgba_getb(c);
+    v[3] = doc::rgba_geta(c);
+  }
+  static uint32_t make(const int* v) {
+    return doc::rgba(v[0], v[1], v[2], v[3]);
+  }
+};
+
+template<>
+struct PixelChannels<doc::GrayscaleTraits> {
+  static constexpr int n = 2;
+  static void get(const uint16_t c, int* v) {
+    v[0] = doc::graya_getv(c);
+    v[1] = doc::graya_geta(c);
+  }
+  static uint16_t make(const int* v) {
+    return doc::graya(v[0], v[1]);
+  }
+};
+
+template<>
+struct PixelChannels<doc::IndexedTraits> {
+  static constexpr int n = 1;
+  static void get(const uint8_t c, int* v) { v[0] = c; }
+  static uint8_t make(const int* v) { return v[0]; }
+};
+
+template<>
+struct PixelChannels<doc::TilemapTraits> {
+  static constexpr int n = 1;
+  static void get(const uint32_t c, int* v) { v[0] = int(c); }
+  static uint32_t make(const int* v) { return uint32_t(v[0]); }
+};
+
+// Calls func(pixel) for each pixel of the image, row by row.
+template<typename ImageTraits, typename Func>
+void for_each_pixel(doc::Image* img, Func&& func)
+{
+  const int w = img->width();
+  const int h = img->height();
+  for (int y=0; y<h; ++y) {
+    auto p = (typename ImageTraits::address_t)img->getPixelAddress(0, y);
+    for (int x=0; x<w; ++x, ++p)
+      func(*p);
+  }
+}
+
+// Calls the given generic lambda with the traits of the image pixel
+// format (bitmap images are not supported).
+template<typename Func>
+void dispatch_pixel_format(doc::Image* img, Func&& func)
+{
+  switch (img->pixelFormat()) {
+    case IMAGE_RGB:       func(doc::RgbTraits()); break;
+    case IMAGE_GRAYSCALE: func(doc::GrayscaleTraits()); break;
+    case IMAGE_INDEXED:   func(doc::IndexedTraits()); break;
+    case IMAGE_TILEMAP:   func(doc::TilemapTraits()); break;
+    default:
+      ASSERT(false);
+      break;
+  }
+}
+
+// Checks the color mode before modifying the image (a Lua error
+// inside modify_image() would leak the temporary image).
+void check_pixel_format(lua_State* L, const doc::Image* img,
+                        const bool channels)
+{
+  switch (img->pixelFormat()) {
+    case IMAGE_RGB:
+    case IMAGE_GRAYSCALE:
+    case IMAGE_INDEXED:
+      break;
+    case IMAGE_TILEMAP:
+      if (!channels)
+        break;
+      [[fallthrough]];
+    default:
+      luaL_error(L, "unsupported image color mode");
+      break;
+  }
+}
+
+// Applies the given function to modify the image. If the image is
+// from a cel, the function modifies a copy of it and the modified
+// area is copied back with undo information.
+template<typename Func>
+void modify_image(lua_State* L, ImageObj* obj, Func&& func)
+{
+  doc::Image* img = obj->image(L);
+
+  if (auto cel = obj->cel(L)) {
+    ImageRef tmp(Image::createCopy(img));
+    func(tmp.get());
+
+    int x1, y1, x2, y2;
+    if (get_shrink_rect2(&x1, &y1, &x2, &y2, img, tmp.get())) {
+      Tx tx(cel->sprite());
+      tx(new cmd::CopyRect(
+           img, tmp.get(),
+           gfx::Clip(x1, y1, x1, y1, x2-x1+1, y2-y1+1)));
+      tx.commit();
+    }
+  }
+  else {
+    func(img);
+    img->incrementVersion();
+
+    // Rehash tileset
+    if (obj->tilesetId) {
+      if (doc::Tileset* ts = obj->tileset(L)) {
+        ts->incrementVersion();
+        ts->notifyTileContentChange(obj->ti);
+      }
+    }
+  }
+}
+
+// One lookup table for each channel (for grayscale images "r" is
+// used for the gray value, and for indexed images for the index).
+struct ChannelLuts {
+  uint8_t r[256], g[256], b[256], a[256];
+  ChannelLuts() {
+    for (int i=0; i<256; ++i)
+      r[i] = g[i] = b[i] = a[i] = i;
+  }
+};
+
+void apply_channel_luts(doc::Image* img, const ChannelLuts& luts)
+{
+  switch (img->pixelFormat()) {
+    case IMAGE_RGB:
+      for_each_pixel<doc::RgbTraits>(
+        img, [&luts](uint32_t& c){
+          c = doc::rgba(luts.r[doc::rgba_getr(c)],
+                        luts.g[doc::rgba_getg(c)],
+                        luts.b[doc::rgba_getb(c)],
+                        luts.a[doc::rgba_geta(c)]);
+        });
+      break;
+    case IMAGE_GRAYSCALE:
+      for_each_pixel<doc::GrayscaleTraits>(
+        img, [&luts](uint16_t& c){
+          c = doc::graya(luts.r[doc::graya_getv(c)],
+                         luts.a[doc::graya_geta(c)]);
+        });
+      break;
+    case IMAGE_INDEXED:
+      for_each_pixel<doc::IndexedTraits>(
+        img, [&luts](uint8_t& c){ c = luts.r[c]; });
+      break;
+    default:
+      ASSERT(false);
+      break;
+  }
+}
+
+// Reads a lookup table indexed by channel value (from 0 to 255),
+// missing entries keep the same value.
+void read_lut(lua_State* L, const int index, uint8_t* lut)
+{
+  for (int i=0; i<256; ++i) {
+    if (lua_geti(L, index, i) != LUA_TNIL)
+      lut[i] = std::clamp(int(lua_tointeger(L, -1)), 0, 255);
+    lua_pop(L, 1);
+  }
+}
+
+// Channel fields of a table for each pixel format, returns the
+// number of fields.
+int channel_fields(const doc::Image* img, const char** names, uint8_t** luts,
+                   ChannelLuts& channelLuts)
+{
+  switch (img->pixelFormat()) {
+    case IMAGE_RGB:
+      names[0] = "r"; luts[0] = channelLuts.r;
+      names[1] = "g"; luts[1] = channelLuts.g;
+      names[2] = "b"; luts[2] = channelLuts.b;
+      names[3] = "a"; luts[3] = channelLuts.a;
+      return 4;
+    case IMAGE_GRAYSCALE:
+      names[0] = "v"; luts[0] = channelLuts.r;
+      names[1] = "a"; luts[1] = channelLuts.a;
+      return 2;
+    default:
+      return 0;
+  }
+}
+
+int Image_mapPixels(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  doc::Image* img = obj->image(L);
+  check_pixel_format(L, img, true);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  // Image:mapPixels{ r=lut, g=lut, b=lut, a=lut } (or v/a for
+  // grayscale images), or Image:mapPixels(lut) to map the color
+  // channels (or the indexes of an indexed image) with the same
+  // lookup table
+  ChannelLuts luts;
+  const char* names[4];
+  uint8_t* channelLuts[4];
+  const int n = channel_fields(img, names, channelLuts, luts);
+  bool named = false;
+  for (int i=0; i<n; ++i) {
+    if (lua_getfield(L, 2, names[i]) == LUA_TTABLE) {
+      read_lut(L, -1, channelLuts[i]);
+      named = true;
+    }
+    lua_pop(L, 1);
+  }
+  if (!named) {
+    read_lut(L, 2, luts.r);
+    std::copy(luts.r, luts.r+256, luts.g);
+    std::copy(luts.r, luts.r+256, luts.b);
+  }
+
+  modify_image(L, obj, [&luts](doc::Image* img){
+    apply_channel_luts(img, luts);
+  });
+  return 0;
+}
+
+int Image_adjustChannels(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  doc::Image* img = obj->image(L);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  // Image:adjustChannels{ multiply=m, add=a } where each value is a
+  // number for all color channels or a table with r/g/b/a (or v/a)
+  // fields.
+  const char* names[4];
+  uint8_t* channelLuts[4];
+  ChannelLuts luts;
+  const int n = channel_fields(img, names, channelLuts, luts);
+  if (n == 0)
+    return luaL_error(L, "adjustChannels() is not supported in this color mode");
+
+  double mul[4] = { 1.0, 1.0, 1.0, 1.0 };
+  double add[4] = { 0.0, 0.0, 0.0, 0.0 };
+  auto readValues = [L, n, &names](const char* field, double* values) {
+    const int type = lua_getfield(L, 2, field);
+    if (type == LUA_TNUMBER) {
+      // The alpha channel is not modified
+      for (int i=0; i<n-1; ++i)
+        values[i] = lua_tonumber(L, -1);
+    }
+    else if (type == LUA_TTABLE) {
+      for (int i=0; i<n; ++i) {
+        if (lua_getfield(L, -1, names[i]) != LUA_TNIL)
+          values[i] = lua_tonumber(L, -1);
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+  };
+  readValues("multiply", mul);
+  readValues("add", add);
+
+  for (int i=0; i<n; ++i) {
+    for (int j=0; j<256; ++j)
+      channelLuts[i][j] = std::clamp(int(std::round(j*mul[i] + add[i])), 0, 255);
+  }
+
+  modify_image(L, obj, [&luts](doc::Image* img){
+    apply_channel_luts(img, luts);
+  });
+  return 0;
+}
+
+int Image_replaceColors(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  check_pixel_format(L, obj->image(L), false);
+  luaL_checktype(L, 2, LUA_TTABLE);
+
+  // Image:replaceColors{ [from1]=to1, [from2]=to2, ... } with the
+  // pixel values
+  std::unordered_map<doc::color_t, doc::color_t> colors;
+  lua_pushnil(L);
+  while (lua_next(L, 2) != 0) {
+    colors[doc::color_t(lua_tointeger(L, -2))] = doc::color_t(lua_tointeger(L, -1));
+    lua_pop(L, 1);
+  }
+
+  int count = 0;
+  if (!colors.empty()) {
+    modify_image(L, obj, [&colors, &count](doc::Image* img){
+      dispatch_pixel_format(img, [img, &colors, &count](auto traits){
+        using ImageTraits = decltype(traits);
+        using pixel_t = typename ImageTraits::pixel_t;
+        for_each_pixel<ImageTraits>(img, [&colors, &count](pixel_t& c){
+          auto it = colors.find(c);
+          if (it != colors.end()) {
+            c = pixel_t(it->second);
+            ++count;
+          }
+        });
+      });
+    });
+  }
+  lua_pushinteger(L, count);
+  return 1;
+}
+
+int Image_fillWhere(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  doc::Image* img = obj->image(L);
+  check_pixel_format(L, img, false);
+
+  // Image:fillWhere(matchColor, fillColor [, tolerance]) fills the
+  // pixels that are similar to matchColor (the difference of each
+  // channel is less or equal than the tolerance)
+  doc::color_t match, color;
+  if (lua_isinteger(L, 2))
+    match = lua_tointeger(L, 2);
+  else
+    match = convert_args_into_pixel_color(L, 2, img->pixelFormat());
+  if (lua_isinteger(L, 3))
+    color = lua_tointeger(L, 3);
+  else
+    color = convert_args_into_pixel_color(L, 3, img->pixelFormat());
+  const int tolerance = std::max(0, int(luaL_optinteger(L, 4, 0)));
+
+  int count = 0;
+  modify_image(L, obj, [match, color, tolerance, &count](doc::Image* img){
+    dispatch_pixel_format(img, [=, &count](auto traits){
+      using ImageTraits = decltype(traits);
+      using Channels = PixelChannels<ImageTraits>;
+      using pixel_t = typename ImageTraits::pixel_t;
+      int m[Channels::n];
+      Channels::get(pixel_t(match), m);
+      for_each_pixel<ImageTraits>(img, [&](pixel_t& c){
+        int v[Channels::n];
+        Channels::get(c, v);
+        for (int i=0; i<Channels::n; ++i)
+          if (std::abs(v[i] - m[i]) > tolerance)
+            return;
+        c = pixel_t(color);
+        ++count;
+      });
+    });
+  });
+  lua_pushinteger(L, count);
+  return 1;
+}
+
+// Convolution of all channels with a 3x3 kernel (the edge pixels are
+// repeated outside the image).
+template<typename ImageTraits>
+void apply_kernel_3x3(doc::Image* img, const double* kernel,
+                      const double divisor, const double bias)
+{
+  using Channels = PixelChannels<ImageTraits>;
+  using const_address_t = typename ImageTraits::const_address_t;
+  constexpr int n = Channels::n;
+
+  const ImageRef src(Image::createCopy(img));
+  const int w = img->width();
+  const int h = img->height();
+  for (int y=0; y<h; ++y) {
+    const const_address_t rows[3] = {
+      (const_address_t)src->getPixelAddress(0, std::max(y-1, 0)),
+      (const_address_t)src->getPixelAddress(0, y),
+      (const_address_t)src->getPixelAddress(0, std::min(y+1, h-1))
+    };
+    auto dst = (typename ImageTraits::address_t)img->getPixelAddress(0, y);
+
+    for (int x=0; x<w; ++x, ++dst) {
+      const int xs[3] = { std::max(x-1, 0), x, std::min(x+1, w-1) };
+      double sum[n] = { };
+      for (int ky=0; ky<3; ++ky) {
+        for (int kx=0; kx<3; ++kx) {
+          int v[n];
+          Channels::get(rows[ky][xs[kx]], v);
+          const double k = kernel[ky*3+kx];
+          for (int i=0; i<n; ++i)
+            sum[i] += k * v[i];
+        }
+      }
+      int v[n];
+      for (int i=0; i<n; ++i)
+        v[i] = std::clamp(int(std::round(sum[i] / divisor + bias)), 0, 255);
+      *dst = Channels::make(v);
+    }
+  }
+}
+
+int Image_applyKernel(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  doc::Image* img = obj->image(L);
+
+  // Image:applyKernel({ k1, k2, ..., k9 } [, divisor [, bias]])
+  luaL_checktype(L, 2, LUA_TTABLE);
+  if (luaL_len(L, 2) != 9)
+    return luaL_error(L, "the kernel must have 9 values (3x3 matrix)");
+
+  double kernel[9];
+  double sum = 0.0;
+  for (int i=0; i<9; ++i) {
+    lua_geti(L, 2, i+1);
+    kernel[i] = lua_tonumber(L, -1);
+    sum += kernel[i];
+    lua_pop(L, 1);
+  }
+  double divisor = luaL_optnumber(L, 3, sum != 0.0 ? sum: 1.0);
+  if (divisor == 0.0)
+    divisor = 1.0;
+  const double bias = luaL_optnumber(L, 4, 0.0);
+
+  switch (img->pixelFormat()) {
+    case IMAGE_RGB:
+      modify_image(L, obj, [&](doc::Image* img){
+        apply_kernel_3x3<doc::RgbTraits>(img, kernel, divisor, bias);
+      });
+      break;
+    case IMAGE_GRAYSCALE:
+      modify_image(L, obj, [&](doc::Image* img){
+        apply_kernel_3x3<doc::GrayscaleTraits>(img, kernel, divisor, bias);
+      });
+      break;
+    default:
+      return luaL_error(L, "applyKernel() is not supported in this color mode");
   }
   return 0;
 }
@@ -682,6 +1136,7 @@ int Image_set_bytes(lua_State* L)
 
   if (bytes_size == bytes_needed) {
     std::memcpy(img->getPixelAddress(0, 0), bytes, bytes_size);
+    img->incrementVersion();
   }
   else {
     lua_pushfstring(L, "Data size does not match: given %d, needed %d.", bytes_size, bytes_needed);
@@ -691,6 +1146,13 @@ int Image_set_bytes(lua_State* L)
   return 0;
 }
 
+int Image_get_buffer(lua_State* L)
+{
+  auto obj = get_obj<ImageObj>(L, 1);
+  push_image_buffer(L, obj->image(L), obj->tileset(L), obj->ti);
+  return 1;
+}
+
 int Image_get_width(lua_State* L)
 {
   const auto obj = get_obj<ImageObj>(L, 1);
@@ -748,6 +1210,11 @@ const luaL_Reg Image_methods[] = {
   { "resize", Image_resize },
   { "shrinkBounds", Image_shrinkBounds },
   { "flip", Image_flip },
+  { "mapPixels", Image_mapPixels },
+  { "adjustChannels", Image_adjustChannels },
+  { "replaceColors", Image_replaceColors },
+  { "fillWhere", Image_fillWhere },
+  { "applyKernel", Image_applyKernel },
   { "__gc", Image_gc },
   { "__eq", Image_eq },
   { nullptr, nullptr }
@@ -759,6 +1226,7 @@ const Property Image_properties[] = {
   { "rowStride", Image_get_rowStride, nullptr },
   { "bytesPerPixel", Image_get_bytesPerPixel, nullptr },
   { "bytes", Image_get_bytes, Image_set_bytes },
+  { "buffer", Image_get_buffer, nullptr },
   { "width", Image_get_width, nullptr },
   { "height", Image_get_height, nullptr },
   { "bounds", Image_get_bounds, nullptr },
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2023  Igara Studio S.A.
+// Copyright (C) 2023-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -9,9 +9,24 @@
 #endif
 
 #include "app/script/luacpp.h"
+#include "app/script/security.h"
 #include "app/script/values.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
 
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
 #include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "json11.hpp"
 
@@ -232,32 +247,744 @@ int JsonArrayIterator_gc(lua_State* L)
   return 0;
 }
 
+// ----------------------------------------------------------------------
+// Lazy JSON decoding
+//
+// json.decode(text, { lazy=true }) validates the text without
+// creating any object, and returns read-only proxies that decode
+// only the accessed values. The offsets of the members of each
+// object/array are calculated the first time it's accessed (and
+// shared between all proxies of the same document).
+
+// Max nesting level of arrays/objects
+const int kMaxJsonDepth = 512;
+
+const char* skip_ws(const char* p, const char* end)
+{
+  while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+    ++p;
+  return p;
+}
+
+// "p" must point to the opening quote, returns the position after
+// the closing quote (or nullptr if the string is invalid)
+const char* skip_string(const char* p, const char* end)
+{
+  ++p;
+  while (p < end) {
+    const char c = *p++;
+    if (c == '"')
+      return p;
+    else if (c == '\\') {
+      if (p == end)
+        return nullptr;
+      switch (*p++) {
+        case '"': case '\\': case '/':
+        case 'b': case 'f': case 'n': case 'r': case 't':
+          break;
+        case 'u':
+          for (int i=0; i<4; ++i, ++p) {
+            if (p == end || !std::isxdigit((unsigned char)*p))
+              return nullptr;
+          }
+          break;
+        default:
+          return nullptr;
+      }
+    }
+    else if ((unsigned char)c < 0x20)
+      return nullptr;
+  }
+  return nullptr;
+}
+
+const char* skip_digits(const char* p, const char* end)
+{
+  const char* start = p;
+  while (p < end && *p >= '0' && *p <= '9')
+    ++p;
+  return (p > start ? p: nullptr);
+}
+
+const char* skip_number(const char* p, const char* end)
+{
+  if (*p == '-')
+    ++p;
+  if (p < end && *p == '0')
+    ++p;
+  else if (!(p = skip_digits(p, end)))
+    return nullptr;
+  if (p < end && *p == '.') {
+    if (!(p = skip_digits(p+1, end)))
+      return nullptr;
+  }
+  if (p < end && (*p == 'e' || *p == 'E')) {
+    ++p;
+    if (p < end && (*p == '+' || *p == '-'))
+      ++p;
+    if (!(p = skip_digits(p, end)))
+      return nullptr;
+  }
+  return p;
+}
+
+const char* skip_literal(const char* p, const char* end, const char* literal)
+{
+  const size_t n = std::strlen(literal);
+  if (size_t(end - p) < n || std::strncmp(p, literal, n) != 0)
+    return nullptr;
+  return p + n;
+}
+
+// Returns the position after the value (or nullptr if it's invalid)
+const char* skip_value(const char* p, const char* end, const int depth = 0)
+{
+  p = skip_ws(p, end);
+  if (p == end)
+    return nullptr;
+
+  switch (*p) {
+    case '{':
+    case '[': {
+      if (depth >= kMaxJsonDepth)
+        return nullptr;
+      const char close = (*p == '{' ? '}': ']');
+      const bool isObject = (*p == '{');
+      p = skip_ws(p+1, end);
+      if (p < end && *p == close)
+        return p+1;
+      while (true) {
+        if (isObject) {
+          p = skip_ws(p, end);
+          if (p == end || *p != '"' || !(p = skip_string(p, end)))
+            return nullptr;
+          p = skip_ws(p, end);
+          if (p == end || *p != ':')
+            return nullptr;
+          ++p;
+        }
+        if (!(p = skip_value(p, end, depth+1)))
+          return nullptr;
+        p = skip_ws(p, end);
+        if (p == end)
+          return nullptr;
+        else if (*p == ',')
+          ++p;
+        else if (*p == close)
+          return p+1;
+        else
+          return nullptr;
+      }
+    }
+    case '"': return skip_string(p, end);
+    case 't': return skip_literal(p, end, "true");
+    case 'f': return skip_literal(p, end, "false");
+    case 'n': return skip_literal(p, end, "null");
+    default:
+      if (*p == '-' || (*p >= '0' && *p <= '9'))
+        return skip_number(p, end);
+      return nullptr;
+  }
+}
+
+void append_utf8(std::string& out, uint32_t cp)
+{
+  if (cp < 0x80)
+    out.push_back(char(cp));
+  else if (cp < 0x800) {
+    out.push_back(char(0xC0 | (cp >> 6)));
+    out.push_back(char(0x80 | (cp & 0x3F)));
+  }
+  else if (cp < 0x10000) {
+    out.push_back(char(0xE0 | (cp >> 12)));
+    out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(char(0x80 | (cp & 0x3F)));
+  }
+  else {
+    out.push_back(char(0xF0 | (cp >> 18)));
+    out.push_back(char(0x80 | ((cp >> 12) & 0x3F)));
+    out.push_back(char(0x80 | ((cp >> 6) & 0x3F)));
+    out.push_back(char(0x80 | (cp & 0x3F)));
+  }
+}
+
+// Decodes a valid string ("p" points to the opening quote, "end" to
+// the position after the closing quote)
+void decode_string(const char* p, const char* end, std::string& out)
+{
+  out.clear();
+  for (++p, --end; p < end; ) {
+    if (*p != '\\') {
+      out.push_back(*p++);
+      continue;
+    }
+    ++p;
+    switch (*p++) {
+      case 'b': out.push_back('\b'); break;
+      case 'f': out.push_back('\f'); break;
+      case 'n': out.push_back('\n'); break;
+      case 'r': out.push_back('\r'); break;
+      case 't': out.push_back('\t'); break;
+      case 'u': {
+        uint32_t cp = std::strtoul(std::string(p, 4).c_str(), nullptr, 16);
+        p += 4;
+        // Surrogate pair
+        if (cp >= 0xD800 && cp <= 0xDBFF &&
+            end - p >= 6 && p[0] == '\\' && p[1] == 'u') {
+          const uint32_t lo = std::strtoul(std::string(p+2, 4).c_str(), nullptr, 16);
+          if (lo >= 0xDC00 && lo <= 0xDFFF) {
+            cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+            p += 6;
+          }
+        }
+        append_utf8(out, cp);
+        break;
+      }
+      default:
+        out.push_back(p[-1]);
+        break;
+    }
+  }
+}
+
+struct JsonLazyIndex {
+  std::vector<size_t> values;           // Offsets of the values
+  std::vector<std::string> keys;        // Keys of the values (objects only)
+  std::unordered_map<std::string, size_t> byKey; // Key -> index in "values"
+};
+
+struct JsonLazyDoc {
+  std::string text;
+  std::unordered_map<size_t, std::unique_ptr<JsonLazyIndex>> indexes;
+
+  // Returns the members of the object/array in the given offset
+  const JsonLazyIndex& index(const size_t begin) {
+    auto& result = indexes[begin];
+    if (result)
+      return *result;
+
+    result = std::make_unique<JsonLazyIndex>();
+    const char* start = text.c_str();
+    const char* end = start + text.size();
+    const char* p = start + begin;
+    const bool isObject = (*p == '{');
+    const char close = (isObject ? '}': ']');
+    p = skip_ws(p+1, end);
+    while (*p != close) {
+      if (isObject) {
+        const char* keyEnd = skip_string(p, end);
+        std::string key;
+        decode_string(p, keyEnd, key);
+        result->byKey[key] = result->values.size(); // Last key wins
+        result->keys.push_back(std::move(key));
+        p = skip_ws(keyEnd, end) + 1;           // Skip ':'
+      }
+      p = skip_ws(p, end);
+      result->values.push_back(p - start);
+      p = skip_ws(skip_value(p, end), end);
+      if (*p == ',')
+        p = skip_ws(p+1, end);
+    }
+    return *result;
+  }
+};
+
+using JsonLazyDocPtr = std::shared_ptr<JsonLazyDoc>;
+
+// Proxy to an object/array of a lazy JSON document
+struct JsonLazy {
+  JsonLazyDocPtr doc;
+  size_t begin;
+  JsonLazy(const JsonLazyDocPtr& doc, size_t begin)
+    : doc(doc), begin(begin) { }
+  bool isObject() const { return doc->text[begin] == '{'; }
+  const JsonLazyIndex& index() const { return doc->index(begin); }
+};
+
+void push_json_lazy_value(lua_State* L, const JsonLazyDocPtr& doc, const size_t offset)
+{
+  const char* p = doc->text.c_str() + offset;
+  switch (*p) {
+    case '{':
+    case '[':
+      push_new<JsonLazy>(L, doc, offset);
+      break;
+    case '"': {
+      const char* end = skip_string(p, doc->text.c_str() + doc->text.size());
+      if (std::find(p, end, '\\') == end) {
+        lua_pushlstring(L, p+1, end-p-2);
+      }
+      else {
+        std::string str;
+        decode_string(p, end, str);
+        lua_pushlstring(L, str.c_str(), str.size());
+      }
+      break;
+    }
+    case 't': lua_pushboolean(L, true); break;
+    case 'f': lua_pushboolean(L, false); break;
+    case 'n': lua_pushnil(L); break;
+    default:
+      lua_pushnumber(L, std::strtod(p, nullptr));
+      break;
+  }
+}
+
+int JsonLazy_gc(lua_State* L)
+{
+  get_obj<JsonLazy>(L, 1)->~JsonLazy();
+  return 0;
+}
+
+int JsonLazy_eq(lua_State* L)
+{
+  auto a = get_obj<JsonLazy>(L, 1);
+  auto b = get_obj<JsonLazy>(L, 2);
+  lua_pushboolean(L, a->doc == b->doc && a->begin == b->begin);
+  return 1;
+}
+
+int JsonLazy_len(lua_State* L)
+{
+  auto obj = get_obj<JsonLazy>(L, 1);
+  lua_pushinteger(L, obj->index().values.size());
+  return 1;
+}
+
+int JsonLazy_index(lua_State* L)
+{
+  auto obj = get_obj<JsonLazy>(L, 1);
+  const JsonLazyIndex& index = obj->index();
+  if (obj->isObject()) {
+    size_t len;
+    if (const char* key = lua_tolstring(L, 2, &len)) {
+      auto it = index.byKey.find(std::string(key, len));
+      if (it != index.byKey.end()) {
+        push_json_lazy_value(L, obj->doc, index.values[it->second]);
+        return 1;
+      }
+    }
+  }
+  else {
+    int isnum;
+    const lua_Integer i = lua_tointegerx(L, 2, &isnum);
+    if (isnum && i >= 1 && i <= lua_Integer(index.values.size())) {
+      push_json_lazy_value(L, obj->doc, index.values[i-1]);
+      return 1;
+    }
+  }
+  lua_pushnil(L);
+  return 1;
+}
+
+int JsonLazy_newindex(lua_State* L)
+{
+  return luaL_error(L, "lazy JSON values are read-only");
+}
+
+// Iterates object members (or array elements) in the document order
+int JsonLazy_pairs_next(lua_State* L)
+{
+  auto obj = get_obj<JsonLazy>(L, 1);
+  const JsonLazyIndex& index = obj->index();
+  const lua_Integer i = lua_tointeger(L, lua_upvalueindex(1));
+  if (i >= lua_Integer(index.values.size()))
+    return 0;
+
+  lua_pushinteger(L, i+1);
+  lua_replace(L, lua_upvalueindex(1));
+
+  if (obj->isObject())
+    lua_pushlstring(L, index.keys[i].c_str(), index.keys[i].size());
+  else
+    lua_pushinteger(L, i+1);
+  push_json_lazy_value(L, obj->doc, index.values[i]);
+  return 2;
+}
+
+int JsonLazy_pairs(lua_State* L)
+{
+  get_obj<JsonLazy>(L, 1);
+  lua_pushinteger(L, 0);
+  lua_pushcclosure(L, JsonLazy_pairs_next, 1);
+  lua_pushvalue(L, 1);
+  return 2;
+}
+
+// Returns the original JSON text of the object/array
+int JsonLazy_tostring(lua_State* L)
+{
+  auto obj = get_obj<JsonLazy>(L, 1);
+  const std::string& text = obj->doc->text;
+  const char* p = text.c_str() + obj->begin;
+  const char* end = skip_value(p, text.c_str() + text.size());
+  lua_pushlstring(L, p, end-p);
+  return 1;
+}
+
+// Pushes the root value of a lazy document, returns false (pushing
+// an error message) if the JSON text is invalid
+bool push_json_lazy_doc(lua_State* L, const JsonLazyDocPtr& doc)
+{
+  const char* start = doc->text.c_str();
+  const char* end = start + doc->text.size();
+  const char* p = skip_ws(start, end);
+  const char* valueEnd = skip_value(p, end);
+  if (!valueEnd) {
+    lua_pushstring(L, "invalid JSON");
+    return false;
+  }
+  if (skip_ws(valueEnd, end) != end) {
+    lua_pushfstring(L, "unexpected trailing characters at offset %d",
+                    int(valueEnd - start));
+    return false;
+  }
+  push_json_lazy_value(L, doc, p - start);
+  return true;
+}
+
+// ----------------------------------------------------------------------
+// Streaming JSON encoder
+//
+// Writes Lua values directly to a std::ostream (a file or a string)
+// without creating an intermediate json11 object. The output is the
+// same as json11::Json::dump().
+
+class JsonWriter {
+public:
+  JsonWriter(std::ostream& os) : m_os(os) { }
+
+  const std::string& error() const { return m_error; }
+
+  bool write(lua_State* L, const int index) {
+    writeLua(L, lua_absindex(L, index), 0);
+    return m_error.empty();
+  }
+
+  void writeJson11(const JsonObj& value) {
+    switch (value.type()) {
+      case json11::Json::NUL:
+        m_os << "null";
+        break;
+      case json11::Json::NUMBER:
+        writeNumber(value.number_value());
+        break;
+      case json11::Json::BOOL:
+        m_os << (value.bool_value() ? "true": "false");
+        break;
+      case json11::Json::STRING:
+        writeString(value.string_value().c_str(), value.string_value().size());
+        break;
+      case json11::Json::ARRAY: {
+        bool first = true;
+        m_os.put('[');
+        for (const auto& item : value.array_items()) {
+          if (!first)
+            m_os << ", ";
+          writeJson11(item);
+          first = false;
+        }
+        m_os.put(']');
+        break;
+      }
+      case json11::Json::OBJECT: {
+        bool first = true;
+        m_os.put('{');
+        for (const auto& kv : value.object_items()) {
+          if (!first)
+            m_os << ", ";
+          writeString(kv.first.c_str(), kv.first.size());
+          m_os << ": ";
+          writeJson11(kv.second);
+          first = false;
+        }
+        m_os.put('}');
+        break;
+      }
+    }
+  }
+
+private:
+  void writeLua(lua_State* L, const int index, const int depth) {
+    if (!m_error.empty())
+      return;
+
+    switch (lua_type(L, index)) {
+
+      case LUA_TBOOLEAN:
+        m_os << (lua_toboolean(L, index) ? "true": "false");
+        break;
+
+      case LUA_TNUMBER:
+        writeNumber(lua_tonumber(L, index));
+        break;
+
+      case LUA_TSTRING: {
+        size_t len;
+        const char* s = lua_tolstring(L, index, &len);
+        writeString(s, len);
+        break;
+      }
+
+      case LUA_TTABLE:
+        if (depth >= kMaxJsonDepth) {
+          m_error = "table is too deep or contains cycles";
+          return;
+        }
+        if (is_array_table(L, index))
+          writeLuaArray(L, index, depth);
+        else
+          writeLuaObject(L, index, depth);
+        break;
+
+      case LUA_TUSERDATA:
+        if (auto obj = may_get_obj<JsonObj>(L, index)) {
+          writeJson11(*obj);
+          break;
+        }
+        else if (auto obj = may_get_obj<JsonLazy>(L, index)) {
+          const std::string& text = obj->doc->text;
+          const char* p = text.c_str() + obj->begin;
+          m_os.write(p, skip_value(p, text.c_str() + text.size()) - p);
+          break;
+        }
+        // TODO convert rectangles, point, size, uuids?
+        [[fallthrough]];
+
+      default:
+        m_os << "null";
+        break;
+    }
+  }
+
+  void writeLuaArray(lua_State* L, const int index, const int depth) {
+    bool first = true;
+    m_os.put('[');
+    lua_pushnil(L);
+    while (lua_next(L, index) != 0) {
+      if (!first)
+        m_os << ", ";
+      writeLua(L, lua_gettop(L), depth+1);
+      lua_pop(L, 1);
+      first = false;
+    }
+    m_os.put(']');
+  }
+
+  // Keys are sorted (as in json11::Json::object, which is a std::map)
+  void writeLuaObject(lua_State* L, const int index, const int depth) {
+    // Table with the original keys, "keys" contains the string
+    // version of each key and its index in this table
+    lua_newtable(L);
+    const int keysTable = lua_gettop(L);
+    std::vector<std::pair<std::string, int>> keys;
+
+    lua_pushnil(L);
+    while (lua_next(L, index) != 0) {
+      lua_pop(L, 1);
+      if (lua_type(L, -1) == LUA_TSTRING ||
+          lua_type(L, -1) == LUA_TNUMBER) {
+        lua_pushvalue(L, -1);
+        size_t len;
+        const char* k = lua_tolstring(L, -1, &len); // Converts the copy
+        keys.emplace_back(std::string(k, len), int(keys.size()+1));
+        lua_pop(L, 1);
+        lua_pushvalue(L, -1);
+        lua_rawseti(L, keysTable, keys.size());
+      }
+    }
+
+    // Sort keys, with repeated keys (e.g. 1 and "1") the last one wins
+    std::stable_sort(keys.begin(), keys.end(),
+                     [](const auto& a, const auto& b){ return a.first < b.first; });
+
+    bool first = true;
+    m_os.put('{');
+    for (size_t i=0; i<keys.size(); ++i) {
+      if (i+1 < keys.size() && keys[i].first == keys[i+1].first)
+        continue;
+      if (!first)
+        m_os << ", ";
+      writeString(keys[i].first.c_str(), keys[i].first.size());
+      m_os << ": ";
+      lua_rawgeti(L, keysTable, keys[i].second);
+      lua_rawget(L, index);
+      writeLua(L, lua_gettop(L), depth+1);
+      lua_pop(L, 1);
+      first = false;
+    }
+    m_os.put('}');
+    lua_pop(L, 1);              // Pop keys table
+  }
+
+  void writeNumber(const double value) {
+    if (std::isfinite(value)) {
+      char buf[32];
+      std::snprintf(buf, sizeof(buf), "%.17g", value);
+      m_os << buf;
+    }
+    else
+      m_os << "null";
+  }
+
+  void writeString(const char* s, const size_t len) {
+    m_os.put('"');
+    for (size_t i=0; i<len; ++i) {
+      const char ch = s[i];
+      switch (ch) {
+        case '\\': m_os << "\\\\"; break;
+        case '"': m_os << "\\\""; break;
+        case '\b': m_os << "\\b"; break;
+        case '\f': m_os << "\\f"; break;
+        case '\n': m_os << "\\n"; break;
+        case '\r': m_os << "\\r"; break;
+        case '\t': m_os << "\\t"; break;
+        default:
+          if ((unsigned char)ch <= 0x1f) {
+            char buf[8];
+            std::snprintf(buf, sizeof(buf), "\\u%04x", ch);
+            m_os << buf;
+          }
+          // U+2028 and U+2029 are escaped as in json11
+          else if ((unsigned char)ch == 0xe2 && i+2 < len &&
+                   (unsigned char)s[i+1] == 0x80 &&
+                   ((unsigned char)s[i+2] == 0xa8 ||
+                    (unsigned char)s[i+2] == 0xa9)) {
+            m_os << ((unsigned char)s[i+2] == 0xa8 ? "\\u2028": "\\u2029");
+            i += 2;
+          }
+          else
+            m_os.put(ch);
+          break;
+      }
+    }
+    m_os.put('"');
+  }
+
+  std::ostream& m_os;
+  std::string m_error;
+};
+
+bool is_lazy_option(lua_State* L, int index)
+{
+  return (lua_istable(L, index) && lua_is_key_true(L, index, "lazy"));
+}
+
+// json.decode(text [, { lazy=true }])
 int Json_decode(lua_State* L)
 {
-  if (const char* s = lua_tostring(L, 1)) {
-    std::string err;
-    auto json = json11::Json::parse(s, std::strlen(s), err);
-    if (!err.empty())
-      return luaL_error(L, err.c_str());
-    push_obj(L, json);
-    return 1;
+  size_t len;
+  if (const char* s = lua_tolstring(L, 1, &len)) {
+    if (is_lazy_option(L, 2)) {
+      bool ok;
+      {
+        auto doc = std::make_shared<JsonLazyDoc>();
+        doc->text.assign(s, len);
+        ok = push_json_lazy_doc(L, doc);
+      }
+      return (ok ? 1: lua_error(L));
+    }
+
+    bool ok;
+    {
+      std::string err;
+      auto json = json11::Json::parse(s, len, err);
+      ok = err.empty();
+      if (ok)
+        push_obj(L, json);
+      else
+        lua_pushstring(L, err.c_str());
+    }
+    return (ok ? 1: lua_error(L));
   }
   return 0;
 }
 
+// json.decodeFile(filename [, { lazy=true }]) reads the file directly
+// (without creating a Lua string with its content)
+int Json_decodeFile(lua_State* L)
+{
+  const std::string absFn = base::get_absolute_path(luaL_checkstring(L, 1));
+  if (!ask_access(L, absFn.c_str(), FileAccessMode::Read, ResourceType::File))
+    return luaL_error(L, "script doesn't have access to open file %s",
+                      absFn.c_str());
+
+  const bool lazy = is_lazy_option(L, 2);
+  bool ok;
+  {
+    auto doc = std::make_shared<JsonLazyDoc>();
+    std::ifstream f(FSTREAM_PATH(absFn), std::ifstream::binary);
+    if (f) {
+      std::ostringstream buf;
+      buf << f.rdbuf();
+      doc->text = std::move(buf).str();
+    }
+
+    if (!f) {
+      lua_pushfstring(L, "cannot read file %s", absFn.c_str());
+      ok = false;
+    }
+    else if (lazy) {
+      ok = push_json_lazy_doc(L, doc);
+    }
+    else {
+      std::string err;
+      auto json = json11::Json::parse(doc->text, err);
+      ok = err.empty();
+      if (ok)
+        push_obj(L, json);
+      else
+        lua_pushstring(L, err.c_str());
+    }
+  }
+  return (ok ? 1: lua_error(L));
+}
+
 int Json_encode(lua_State* L)
 {
-  // Encode a JsonObj, we deep copy it (create a deep copy)
-  if (auto obj = may_get_obj<JsonObj>(L, 1)) {
-    lua_pushstring(L, obj->dump().c_str());
-    return 1;
+  if (!may_get_obj<JsonObj>(L, 1) &&
+      !may_get_obj<JsonLazy>(L, 1) &&
+      !lua_istable(L, 1)) {
+    return 0;
   }
-  // Encode a Lua table
-  else if (lua_istable(L, 1)) {
-    lua_pushstring(L, get_json_value(L, 1).dump().c_str());
-    return 1;
+
+  bool ok;
+  {
+    std::ostringstream os;
+    JsonWriter writer(os);
+    ok = writer.write(L, 1);
+    if (ok)
+      lua_pushstring(L, os.str().c_str());
+    else
+      lua_pushstring(L, writer.error().c_str());
   }
-  return 0;
+  return (ok ? 1: lua_error(L));
+}
+
+// json.encodeFile(filename, value) writes the JSON text directly to
+// the file (without creating the whole text in memory)
+int Json_encodeFile(lua_State* L)
+{
+  const std::string absFn = base::get_absolute_path(luaL_checkstring(L, 1));
+  if (!ask_access(L, absFn.c_str(), FileAccessMode::Write, ResourceType::File))
+    return luaL_error(L, "script doesn't have access to write file %s",
+                      absFn.c_str());
+
+  bool ok;
+  {
+    std::ofstream f(FSTREAM_PATH(absFn), std::ofstream::binary);
+    JsonWriter writer(f);
+    ok = (f && writer.write(L, 2));
+    if (ok)
+      f.close();
+    if (!ok || !f) {
+      lua_pushfstring(L, "cannot write file %s%s%s", absFn.c_str(),
+                      (writer.error().empty() ? "": ": "),
+                      writer.error().c_str());
+      ok = false;
+    }
+  }
+  return (ok ? 0: lua_error(L));
 }
 
 const luaL_Reg JsonObj_methods[] = {
@@ -281,9 +1008,22 @@ const luaL_Reg JsonArrayIterator_methods[] = {
   { nullptr,      nullptr }
 };
 
+const luaL_Reg JsonLazy_methods[] = {
+  { "__gc",       JsonLazy_gc },
+  { "__eq",       JsonLazy_eq },
+  { "__len",      JsonLazy_len },
+  { "__index",    JsonLazy_index },
+  { "__newindex", JsonLazy_newindex },
+  { "__pairs",    JsonLazy_pairs },
+  { "__tostring", JsonLazy_tostring },
+  { nullptr,      nullptr }
+};
+
 const luaL_Reg Json_methods[] = {
   { "decode",     Json_decode },
+  { "decodeFile", Json_decodeFile },
   { "encode",     Json_encode },
+  { "encodeFile", Json_encodeFile },
   { nullptr,      nullptr }
 };
 
@@ -291,12 +1031,14 @@ const luaL_Reg Json_methods[] = {
 
 DEF_MTNAME(Json);
 DEF_MTNAME(JsonObj);
+DEF_MTNAME(JsonLazy);
 DEF_MTNAME(JsonObjectIterator);
 DEF_MTNAME(JsonArrayIterator);
 
 void register_json_object(lua_State* L)
 {
   REG_CLASS(L, JsonObj);
+  REG_CLASS(L, JsonLazy);
   REG_CLASS(L, JsonObjectIterator);
   REG_CLASS(L, JsonArrayIterator);
   REG_CLASS(L, Json);
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2019  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -24,23 +24,41 @@ using namespace doc;
 
 namespace {
 
+// Layers of a group (or the sprite root) are calculated lazily and
+// recalculated only when the group version changes (see CelsObj).
 struct LayersObj {
+  ObjectId groupId = 0;
   ObjectIds layers;
+  bool valid = false;
+  ObjectVersion version = 0;
 
-  LayersObj(Sprite* sprite) {
-    for (const Layer* layer : sprite->root()->layers())
-      layers.push_back(layer->id());
-  }
-  LayersObj(LayerGroup* group) {
-    for (const Layer* layer : group->layers())
-      layers.push_back(layer->id());
+  LayersObj(LayerGroup* group)
+    : groupId(group->id()) {
   }
   LayersObj(const ObjectIds& layers)
-    : layers(layers) {
+    : layers(layers)
+    , valid(true) {
   }
 
   LayersObj(const LayersObj&) = delete;
   LayersObj& operator=(const LayersObj&) = delete;
+
+  const ObjectIds& get(lua_State* L) {
+    if (groupId) {
+      auto group = static_cast<LayerGroup*>(
+        check_docobj(L, doc::get<Layer>(groupId)));
+      if (!valid ||
+          version != group->version() ||
+          int(layers.size()) != group->layersCount()) {
+        layers.clear();
+        for (const Layer* layer : group->layers())
+          layers.push_back(layer->id());
+        version = group->version();
+        valid = true;
+      }
+    }
+    return layers;
+  }
 };
 
 int Layers_gc(lua_State* L)
@@ -52,18 +70,19 @@ int Layers_gc(lua_State* L)
 int Layers_len(lua_State* L)
 {
   auto obj = get_obj<LayersObj>(L, 1);
-  lua_pushinteger(L, obj->layers.size());
+  lua_pushinteger(L, obj->get(L).size());
   return 1;
 }
 
 int Layers_index(lua_State* L)
 {
   auto obj = get_obj<LayersObj>(L, 1);
+  const ObjectIds& layers = obj->get(L);
 
   // Index by layer name
   if (lua_type(L, 2) == LUA_TSTRING) {
     if (const char* name = lua_tostring(L, 2)) {
-      for (ObjectId layerId : obj->layers) {
+      for (ObjectId layerId : layers) {
         Layer* layer = doc::get<Layer>(layerId);
         if (layer &&
             base::utf8_icmp(layer->name(), name) == 0) {
@@ -75,8 +94,8 @@ int Layers_index(lua_State* L)
   }
 
   const int i = lua_tonumber(L, 2);
-  if (i >= 1 && i <= int(obj->layers.size()))
-    push_docobj<Layer>(L, obj->layers[i-1]);
+  if (i >= 1 && i <= int(layers.size()))
+    push_docobj<Layer>(L, layers[i-1]);
   else
     lua_pushnil(L);
   return 1;
@@ -99,14 +118,21 @@ void register_layers_class(lua_State* L)
   REG_CLASS(L, Layers);
 }
 
+// The same collection is returned for each sprite/group while it's
+// referenced from Lua
+static const char kLayersCache = 0;
+
 void push_sprite_layers(lua_State* L, Sprite* sprite)
 {
-  push_new<LayersObj>(L, sprite);
+  push_group_layers(L, sprite->root());
 }
 
 void push_group_layers(lua_State* L, LayerGroup* group)
 {
-  push_new<LayersObj>(L, group);
+  if (!get_cached(L, &kLayersCache, group->id())) {
+    push_new<LayersObj>(L, group);
+    set_cached(L, &kLayersCache, group->id());
+  }
 }
 
 void push_layers(lua_State* L, const ObjectIds& layers)
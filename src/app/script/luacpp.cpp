@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -105,5 +105,39 @@ bool lua_is_key_true(lua_State* L, int tableIndex, const char* keyName)
   return result;
 }
 
+static void push_cache_table(lua_State* L, const void* cacheKey)
+{
+  if (lua_rawgetp(L, LUA_REGISTRYINDEX, cacheKey) == LUA_TTABLE)
+    return;
+  lua_pop(L, 1);
+
+  lua_newtable(L);
+  lua_newtable(L);              // Metatable
+  lua_pushstring(L, "v");
+  lua_setfield(L, -2, "__mode");
+  lua_setmetatable(L, -2);
+  lua_pushvalue(L, -1);
+  lua_rawsetp(L, LUA_REGISTRYINDEX, cacheKey);
+}
+
+bool get_cached(lua_State* L, const void* cacheKey, lua_Integer key)
+{
+  push_cache_table(L, cacheKey);
+  if (lua_rawgeti(L, -1, key) == LUA_TNIL) {
+    lua_pop(L, 2);
+    return false;
+  }
+  lua_remove(L, -2);
+  return true;
+}
+
+void set_cached(lua_State* L, const void* cacheKey, lua_Integer key)
+{
+  push_cache_table(L, cacheKey);
+  lua_pushvalue(L, -2);
+  lua_rawseti(L, -2, key);
+  lua_pop(L, 1);
+}
+
 } // namespace script
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -136,6 +136,14 @@ void create_mt_getters_setters(lua_State* L,
 
 bool lua_is_key_true(lua_State* L, int tableIndex, const char* keyName);
 
+// Table in the registry (identified by "cacheKey") with weak values
+// to reuse objects (e.g. collections) between accesses. get_cached()
+// pushes the cached value and returns true, or returns false (pushing
+// nothing) if there is no value for the key. set_cached() stores the
+// value at the top of the stack (without popping it).
+bool get_cached(lua_State* L, const void* cacheKey, lua_Integer key);
+void set_cached(lua_State* L, const void* cacheKey, lua_Integer key);
+
 #define REG_CLASS_PROPERTIES(L, T) {                                \
     luaL_getmetatable(L, get_mtname<T>());                          \
     create_mt_getters_setters(L, get_mtname<T>(), T##_properties);  \
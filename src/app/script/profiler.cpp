@@ -0,0 +1,249 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/script/profiler.h"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <set>
+#include <vector>
+
+namespace app {
+namespace script {
+
+using Clock = std::chrono::steady_clock;
+
+namespace {
+
+// Just one profiler can be running (the hook doesn't have user data)
+Profiler* g_profiler = nullptr;
+
+double seconds_since(const Clock::time_point& t)
+{
+  return std::chrono::duration<double>(Clock::now() - t).count();
+}
+
+std::string frame_name(const lua_Debug& ar)
+{
+  std::string name;
+  if (std::strcmp(ar.what, "C") == 0) {
+    name = fmt::format("{} [C]", ar.name ? ar.name: "?");
+  }
+  else if (std::strcmp(ar.what, "main") == 0) {
+    name = fmt::format("main chunk ({})", ar.short_src);
+  }
+  else {
+    name = fmt::format("{} ({}:{})",
+                       ar.name ? ar.name: "function",
+                       ar.short_src, ar.linedefined);
+  }
+  // ';' is the separator of frames in the folded stacks
+  std::replace(name.begin(), name.end(), ';', ':');
+  return name;
+}
+
+} // anonymous namespace
+
+Profiler::ListenerScope::ListenerScope(Profiler* profiler,
+                                       lua_State* L,
+                                       const char* eventName)
+  : m_profiler(profiler && profiler->isRunning() ? profiler: nullptr)
+{
+  if (!m_profiler)
+    return;
+
+  // The listener function is in the top of the stack
+  lua_Debug ar;
+  lua_pushvalue(L, -1);
+  lua_getinfo(L, ">S", &ar);
+
+  m_listener = fmt::format("{}: {}:{}", eventName, ar.short_src, ar.linedefined);
+  m_oldEvent = m_profiler->m_event;
+  m_profiler->m_event = fmt::format("{} event", eventName);
+  m_start = Clock::now();
+}
+
+Profiler::ListenerScope::~ListenerScope()
+{
+  if (!m_profiler)
+    return;
+
+  const double t = seconds_since(m_start);
+  ListenerStats& stats = m_profiler->m_listeners[m_listener];
+  ++stats.calls;
+  stats.total += t;
+  stats.max = std::max(stats.max, t);
+  m_profiler->m_event = m_oldEvent;
+}
+
+void Profiler::start(lua_State* L, const int instructions)
+{
+  g_profiler = this;
+  m_running = true;
+  m_lastSample = Clock::now();
+  lua_sethook(L, &Profiler::hook,
+              LUA_MASKCALL | LUA_MASKRET | LUA_MASKCOUNT,
+              std::max(1, instructions));
+}
+
+void Profiler::stop(lua_State* L)
+{
+  if (!m_running)
+    return;
+
+  lua_sethook(L, nullptr, 0, 0);
+  m_running = false;
+  if (g_profiler == this)
+    g_profiler = nullptr;
+}
+
+void Profiler::reset()
+{
+  m_stacks.clear();
+  m_samples = 0;
+  m_listeners.clear();
+  m_lastSample = Clock::now();
+}
+
+// static
+void Profiler::hook(lua_State* L, lua_Debug* ar)
+{
+  Profiler* profiler = g_profiler;
+  if (!profiler)
+    return;
+
+  lua_Debug caller;
+  switch (ar->event) {
+    case LUA_HOOKCOUNT:
+      profiler->sample(L);
+      break;
+    case LUA_HOOKCALL:
+      // Lua code called from C++ (e.g. a script or an event
+      // listener), the time since the last sample wasn't spent
+      // running Lua code.
+      if (!lua_getstack(L, 1, &caller))
+        profiler->m_lastSample = Clock::now();
+      break;
+    case LUA_HOOKRET:
+      // Returning to C++, the rest of the time goes to this stack
+      if (!lua_getstack(L, 1, &caller))
+        profiler->sample(L);
+      break;
+  }
+}
+
+void Profiler::sample(lua_State* L)
+{
+  const Clock::time_point now = Clock::now();
+  const double t = std::chrono::duration<double>(now - m_lastSample).count();
+  m_lastSample = now;
+
+  // Frames from the innermost to the outermost one
+  std::vector<std::string> frames;
+  lua_Debug ar;
+  for (int level=0; lua_getstack(L, level, &ar); ++level) {
+    lua_getinfo(L, "Sn", &ar);
+    frames.push_back(frame_name(ar));
+  }
+
+  std::string stack = m_event;
+  for (auto it=frames.rbegin(); it!=frames.rend(); ++it) {
+    if (!stack.empty())
+      stack.push_back(';');
+    stack += *it;
+  }
+  m_stacks[stack] += t;
+  ++m_samples;
+}
+
+std::string Profiler::report(const int maxRows) const
+{
+  struct FuncStats {
+    double self = 0.0;
+    double total = 0.0;
+  };
+  std::map<std::string, FuncStats> funcs;
+  double total = 0.0;
+
+  for (const auto& [stack, t] : m_stacks) {
+    std::set<std::string> seen; // Count recursive calls once
+    std::size_t i = 0;
+    while (i <= stack.size()) {
+      std::size_t j = stack.find(';', i);
+      if (j == std::string::npos)
+        j = stack.size();
+      std::string frame = stack.substr(i, j-i);
+      if (!frame.empty()) {
+        if (j == stack.size())
+          funcs[frame].self += t;
+        if (seen.insert(frame).second)
+          funcs[frame].total += t;
+      }
+      i = j+1;
+    }
+    total += t;
+  }
+
+  std::vector<std::pair<std::string, FuncStats>> sorted(funcs.begin(), funcs.end());
+  std::sort(sorted.begin(), sorted.end(),
+            [](const auto& a, const auto& b){
+              return a.second.total > b.second.total;
+            });
+
+  std::string result =
+    fmt::format("Lua profile: {} samples, {:.2f} ms\n"
+                "{:>10} {:>10}  Function\n",
+                m_samples, total * 1000.0, "Total ms", "Self ms");
+  int rows = 0;
+  for (const auto& [name, stats] : sorted) {
+    if (maxRows > 0 && rows++ == maxRows)
+      break;
+    result += fmt::format("{:10.2f} {:10.2f}  {}\n",
+                          stats.total * 1000.0,
+                          stats.self * 1000.0,
+                          name);
+  }
+
+  if (!m_listeners.empty()) {
+    std::vector<std::pair<std::string, ListenerStats>>
+      listeners(m_listeners.begin(), m_listeners.end());
+    std::sort(listeners.begin(), listeners.end(),
+              [](const auto& a, const auto& b){
+                return a.second.total > b.second.total;
+              });
+
+    result += fmt::format("\nEvent listeners\n"
+                          "{:>6} {:>10} {:>10}  Listener\n",
+                          "Calls", "Total ms", "Max ms");
+    for (const auto& [name, stats] : listeners) {
+      result += fmt::format("{:6} {:10.2f} {:10.2f}  {}\n",
+                            stats.calls,
+                            stats.total * 1000.0,
+                            stats.max * 1000.0,
+                            name);
+    }
+  }
+  return result;
+}
+
+void Profiler::writeFlameGraph(std::ostream& os) const
+{
+  for (const auto& [stack, t] : m_stacks) {
+    const long long us = (long long)(t * 1000000.0);
+    if (us > 0)
+      os << stack << ' ' << us << '\n';
+  }
+}
+
+} // namespace script
+} // namespace app
@@ -0,0 +1,84 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_SCRIPT_PROFILER_H_INCLUDED
+#define APP_SCRIPT_PROFILER_H_INCLUDED
+#pragma once
+
+#include "app/script/luacpp.h"
+
+#include <chrono>
+#include <iosfwd>
+#include <map>
+#include <string>
+
+namespace app {
+namespace script {
+
+// Sampling profiler for Lua scripts. It uses a count hook to take a
+// sample of the Lua stack each N instructions, and the time since
+// the previous sample is accumulated to the sampled stack. Calls
+// to app/sprite events listeners are measured separately.
+class Profiler {
+public:
+  static constexpr int kDefaultInstructions = 1000;
+
+  // Measures the time of one event listener call (and adds the
+  // event name as the root of the samples taken meanwhile).
+  class ListenerScope {
+  public:
+    ListenerScope(Profiler* profiler,
+                  lua_State* L,
+                  const char* eventName);
+    ~ListenerScope();
+  private:
+    Profiler* m_profiler;
+    std::string m_listener;
+    std::string m_oldEvent;
+    std::chrono::steady_clock::time_point m_start;
+  };
+
+  bool isRunning() const { return m_running; }
+
+  void start(lua_State* L, int instructions);
+  void stop(lua_State* L);
+  void reset();
+
+  // Text report with the time per function and per event listener
+  std::string report(int maxRows) const;
+
+  // Writes the samples in the "folded stacks" format used by flame
+  // graph tools (each line is "root;caller;callee microseconds").
+  void writeFlameGraph(std::ostream& os) const;
+
+private:
+  struct ListenerStats {
+    int calls = 0;
+    double total = 0.0;
+    double max = 0.0;
+  };
+
+  static void hook(lua_State* L, lua_Debug* ar);
+  void sample(lua_State* L);
+
+  bool m_running = false;
+  std::chrono::steady_clock::time_point m_lastSample;
+
+  // Event that is being processed (root frame of the samples)
+  std::string m_event;
+
+  // Seconds for each sampled stack (frames separated with ';')
+  std::map<std::string, double> m_stacks;
+  int m_samples = 0;
+
+  // Stats for each "event: listener source"
+  std::map<std::string, ListenerStats> m_listeners;
+};
+
+} // namespace script
+} // namespace app
+
+#endif
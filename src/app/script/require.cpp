@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -11,6 +11,7 @@
 #include "app/script/require.h"
 
 #include "app/extensions.h"
+#include "app/script/engine.h"
 
 #include <cstring>
 
@@ -30,8 +31,26 @@ static void eval_code(lua_State* L, const char* code)
   }
 }
 
+// package.loadcached(filename) loads a Lua file using the chunk cache
+// (if it's available), returns the function or nil and the error
+static int package_loadcached(lua_State* L)
+{
+  const char* filename = luaL_checkstring(L, 1);
+  if (load_file(L, filename) != LUA_OK) {
+    lua_pushnil(L);
+    lua_insert(L, -2);
+    return 2;
+  }
+  return 1;
+}
+
 void custom_require_function(lua_State* L)
 {
+  lua_getglobal(L, "package");
+  lua_pushcfunction(L, package_loadcached);
+  lua_setfield(L, -2, "loadcached");
+  lua_pop(L, 1);
+
   eval_code(L, R"(
 _PACKAGE_PATH_STACK = {}
 
@@ -44,12 +63,20 @@ function require(name)
   return origRequire(name)
 end
 
-local origLuaSearcher = package.searchers[2]
 package.searchers[2] = function(name)
   if _PLUGIN then
     name = name:sub(#_PLUGIN.name+2)
   end
-  return origLuaSearcher(name)
+  local filename, err = package.searchpath(name, package.path)
+  if not filename then
+    return "\n\t" .. err
+  end
+  local func, err = package.loadcached(filename)
+  if not func then
+    error(string.format("error loading module '%s' from file '%s':\n\t%s",
+                        name, filename, err), 2)
+  end
+  return func, filename
 end
 )");
 }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2015-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -39,32 +39,43 @@
 #include "app/doc.h"
 #include "app/doc_access.h"
 #include "app/doc_api.h"
+#include "app/doc_memory_usage.h"
 #include "app/doc_range.h"
 #include "app/doc_undo.h"
 #include "app/doc_undo_observer.h"
 #include "app/file/palette_file.h"
+#include "app/restore_visible_layers.h"
 #include "app/script/docobj.h"
 #include "app/script/engine.h"
 #include "app/script/luacpp.h"
 #include "app/script/security.h"
 #include "app/script/userdata.h"
 #include "app/site.h"
+#include "app/task_scheduler.h"
 #include "app/transaction.h"
 #include "app/tx.h"
 #include "app/ui/doc_view.h"
 #include "base/convert_to.h"
 #include "base/fs.h"
+#include "doc/image.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
 #include "doc/mask.h"
 #include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/selected_layers.h"
 #include "doc/slice.h"
 #include "doc/sprite.h"
 #include "doc/tag.h"
 #include "doc/tileset.h"
 #include "doc/tilesets.h"
+#include "render/projection.h"
+#include "render/render.h"
 
 #include <algorithm>
+#include <future>
+#include <memory>
+#include <vector>
 
 namespace app {
 namespace script {
@@ -344,6 +355,145 @@ int Sprite_flatten(lua_State* L)
   return 0;
 }
 
+// sprite:renderFrames{ frames, scale, layers, parallel } renders
+// several frames in one call and returns an array of images (one per
+// frame). "frames" can be an array of frames or a tag (all frames by
+// default), "scale" a zoom factor for the output images (1 by
+// default), and "layers" an array of layers to render (the visible
+// layers by default). Frames are rendered in parallel unless
+// parallel=false.
+int Sprite_renderFrames(lua_State* L)
+{
+  auto sprite = get_docobj<Sprite>(L, 1);
+
+  std::vector<doc::frame_t> frames;
+  doc::SelectedLayers layers;
+  double scale = 1.0;
+  bool parallel = true;
+
+  if (lua_istable(L, 2)) {
+    int type = lua_getfield(L, 2, "frames");
+    if (auto tag = may_get_docobj<doc::Tag>(L, -1)) {
+      for (doc::frame_t f=tag->fromFrame(); f<=tag->toFrame(); ++f)
+        frames.push_back(f);
+    }
+    else if (type == LUA_TTABLE) {
+      lua_pushnil(L);
+      while (lua_next(L, -2) != 0) {
+        frames.push_back(get_frame_number_from_arg(L, -1));
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    type = lua_getfield(L, 2, "scale");
+    if (type != LUA_TNIL)
+      scale = lua_tonumber(L, -1);
+    lua_pop(L, 1);
+
+    type = lua_getfield(L, 2, "layers");
+    if (type == LUA_TTABLE) {
+      lua_pushnil(L);
+      while (lua_next(L, -2) != 0) {
+        if (auto layer = may_get_docobj<doc::Layer>(L, -1)) {
+          if (layer->sprite() == sprite)
+            layers.insert(layer);
+        }
+        lua_pop(L, 1);
+      }
+    }
+    lua_pop(L, 1);
+
+    type = lua_getfield(L, 2, "parallel");
+    if (type != LUA_TNIL)
+      parallel = lua_toboolean(L, -1);
+    lua_pop(L, 1);
+  }
+  else if (!lua_isnoneornil(L, 2)) {
+    return luaL_error(L, "renderFrames() expects a table of options");
+  }
+
+  if (frames.empty()) {
+    for (doc::frame_t f=0; f<sprite->totalFrames(); ++f)
+      frames.push_back(f);
+  }
+
+  bool ok = true;
+  for (const doc::frame_t f : frames) {
+    if (f < 0 || f > sprite->lastFrame()) {
+      lua_pushfstring(L, "frame %d out of range", int(f+1));
+      ok = false;
+      break;
+    }
+  }
+  if (ok && scale <= 0.0) {
+    lua_pushfstring(L, "invalid scale %f", scale);
+    ok = false;
+  }
+  if (!ok) {
+    // Free the memory of the vectors before the longjmp
+    frames = std::vector<doc::frame_t>();
+    layers = doc::SelectedLayers();
+    return lua_error(L);
+  }
+
+  const render::Projection proj(doc::PixelRatio(1, 1),
+                                render::Zoom::fromScale(scale));
+  const int w = std::max(1, int(sprite->width() * proj.scaleX()));
+  const int h = std::max(1, int(sprite->height() * proj.scaleY()));
+
+  std::vector<std::unique_ptr<doc::Image>> images(frames.size());
+  for (auto& image : images) {
+    image.reset(doc::Image::create(sprite->pixelFormat(), w, h));
+    doc::clear_image(image.get(), sprite->transparentColor());
+  }
+
+  {
+    // Only the given layers are visible while we render the frames
+    std::unique_ptr<RestoreVisibleLayers> restore;
+    if (!layers.empty()) {
+      restore = std::make_unique<RestoreVisibleLayers>();
+      restore->showSelectedLayers(sprite, layers);
+    }
+
+    // Each frame has its own render::Render instance, so they can be
+    // rendered at the same time (the sprite is not modified while we
+    // wait here).
+    auto renderFrame = [sprite, &proj, &frames, &images, w, h](const int i) {
+      render::Render render;
+      render.setNewBlend(true);
+      render.setProjection(proj);
+      render.renderSprite(images[i].get(), sprite, frames[i],
+                          gfx::Clip(0, 0, 0, 0, w, h));
+    };
+
+    const int n = int(frames.size());
+    if (parallel && n > 1) {
+      std::vector<std::future<void>> futures;
+      futures.reserve(n);
+      for (int i=0; i<n; ++i) {
+        futures.push_back(
+          TaskScheduler::instance().execute(
+            TaskPriority::Interactive,
+            [&renderFrame, i]{ renderFrame(i); }));
+      }
+      for (std::future<void>& future : futures)
+        future.wait();
+    }
+    else {
+      for (int i=0; i<n; ++i)
+        renderFrame(i);
+    }
+  }
+
+  lua_createtable(L, int(images.size()), 0);
+  for (int i=0; i<int(images.size()); ++i) {
+    push_image(L, images[i].release());
+    lua_rawseti(L, -2, i+1);
+  }
+  return 1;
+}
+
 int Sprite_newLayer(lua_State* L)
 {
   auto sprite = get_docobj<Sprite>(L, 1);
@@ -455,6 +605,41 @@ int Sprite_deleteFrame(lua_State* L)
   return 0;
 }
 
+doc::Layer* find_layer_by_name(const doc::LayerGroup* group, const char* name)
+{
+  for (doc::Layer* child : group->layers()) {
+    if (child->name() == name)
+      return child;
+    if (child->isGroup()) {
+      if (doc::Layer* layer = find_layer_by_name(static_cast<doc::LayerGroup*>(child), name))
+        return layer;
+    }
+  }
+  return nullptr;
+}
+
+// sprite:cel(layer, frame) where layer can be a Layer or a layer
+// name, it returns the cel directly without creating the collection
+// of cels of the sprite.
+int Sprite_cel(lua_State* L)
+{
+  auto sprite = get_docobj<Sprite>(L, 1);
+  auto layer = may_get_docobj<doc::Layer>(L, 2);
+  if (!layer && lua_type(L, 2) == LUA_TSTRING)
+    layer = find_layer_by_name(sprite->root(), lua_tostring(L, 2));
+  if (!layer)
+    return luaL_error(L, "layer not found");
+  if (sprite != layer->sprite())
+    return luaL_error(L, "the layer doesn't belong to the sprite");
+
+  const doc::frame_t frame = get_frame_number_from_arg(L, 3);
+  if (auto cel = layer->cel(frame))
+    push_docobj<doc::Cel>(L, cel);
+  else
+    lua_pushnil(L);
+  return 1;
+}
+
 int Sprite_newCel(lua_State* L)
 {
   auto sprite = get_docobj<Sprite>(L, 1);
@@ -947,6 +1132,22 @@ int Sprite_set_selection(lua_State* L)
   return 0;
 }
 
+int Sprite_get_memoryUsage(lua_State* L)
+{
+  auto sprite = get_docobj<Sprite>(L, 1);
+  const Doc* doc = static_cast<Doc*>(sprite->document());
+  const DocMemoryUsage usage = calculate_doc_memory_usage(doc);
+  lua_newtable(L);
+  setfield_uinteger(L, "images", usage.images);
+  setfield_uinteger(L, "tilesets", usage.tilesets);
+  setfield_uinteger(L, "tilesetsCache", usage.tilesetsCache);
+  setfield_uinteger(L, "celsCache", usage.celsCache);
+  setfield_uinteger(L, "undo", usage.undo);
+  setfield_uinteger(L, "render", usage.render);
+  setfield_uinteger(L, "total", usage.total());
+  return 1;
+}
+
 int Sprite_get_bounds(lua_State* L)
 {
   const auto sprite = get_docobj<Sprite>(L, 1);
@@ -1025,6 +1226,7 @@ const luaL_Reg Sprite_methods[] = {
   { "assignColorSpace", Sprite_assignColorSpace },
   { "convertColorSpace", Sprite_convertColorSpace },
   { "flatten", Sprite_flatten },
+  { "renderFrames", Sprite_renderFrames },
   // Layers
   { "newLayer", Sprite_newLayer },
   { "newGroup", Sprite_newGroup },
@@ -1034,6 +1236,7 @@ const luaL_Reg Sprite_methods[] = {
   { "newEmptyFrame", Sprite_newEmptyFrame },
   { "deleteFrame", Sprite_deleteFrame },
   // Cel
+  { "cel", Sprite_cel },
   { "newCel", Sprite_newCel },
   { "deleteCel", Sprite_deleteCel },
   // Tag
@@ -1077,6 +1280,7 @@ const Property Sprite_properties[] = {
   { "pixelRatio", Sprite_get_pixelRatio, Sprite_set_pixelRatio },
   { "events", Sprite_get_events, nullptr },
   { "tileManagementPlugin", Sprite_get_tileManagementPlugin, Sprite_set_tileManagementPlugin },
+  { "memoryUsage", Sprite_get_memoryUsage, nullptr },
   { nullptr, nullptr, nullptr }
 };
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -13,14 +13,22 @@
 #include "app/script/engine.h"
 #include "app/script/luacpp.h"
 #include "app/script/security.h"
+#include "doc/image.h"
 #include "ui/timer.h"
 #include "ui/manager.h"
 #include "ui/system.h"
 
 #include <ixwebsocket/IXNetSystem.h>
 #include <ixwebsocket/IXWebSocket.h>
+#include <ixwebsocket/IXWebSocketSendData.h>
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <sstream>
 #include <set>
+#include <utility>
 
 namespace app {
 namespace script {
@@ -33,6 +41,54 @@ namespace {
 static std::unique_ptr<ui::Timer> g_timer;
 static std::set<ix::WebSocket*> g_connections;
 
+// Messages received in the WebSocket thread waiting to be processed
+// in the UI thread. Only one UI callback is queued to process all
+// pending messages (instead of one callback for each message).
+struct MessageQueue {
+  std::mutex mutex;
+  std::deque<std::pair<int, std::string>> messages;
+
+  // Max number of data (text/binary) messages in the queue, older
+  // messages are discarded when the script cannot process them as
+  // fast as they are received (e.g. a live preview where only the
+  // latest frame is needed). 0 means no limit.
+  size_t maxDataMessages = 0;
+  size_t dataMessages = 0;
+
+  static bool isData(const int msgType) {
+    return (msgType == (int)ix::WebSocketMessageType::Message ||
+            msgType == MESSAGE_TYPE_BINARY);
+  }
+
+  // Returns true if the queue was empty (so the UI callback must be
+  // queued to process the messages)
+  bool push(const int msgType, const std::string& data) {
+    const std::lock_guard lock(mutex);
+    const bool wasEmpty = messages.empty();
+    if (isData(msgType)) {
+      if (maxDataMessages > 0 && dataMessages >= maxDataMessages) {
+        auto it = std::find_if(messages.begin(), messages.end(),
+                               [](const auto& m){ return isData(m.first); });
+        if (it != messages.end()) {
+          messages.erase(it);
+          --dataMessages;
+        }
+      }
+      ++dataMessages;
+    }
+    messages.emplace_back(msgType, data);
+    return wasEmpty;
+  }
+
+  std::deque<std::pair<int, std::string>> take() {
+    std::deque<std::pair<int, std::string>> result;
+    const std::lock_guard lock(mutex);
+    std::swap(result, messages);
+    dataMessages = 0;
+    return result;
+  }
+};
+
 static void close_ws(ix::WebSocket* ws)
 {
   ws->stop();
@@ -82,25 +138,38 @@ int WebSocket_new(lua_State* L)
     }
     lua_pop(L, 1);
 
+    auto queue = std::make_shared<MessageQueue>();
+    type = lua_getfield(L, 1, "maxqueuedmessages");
+    if (type == LUA_TNUMBER) {
+      queue->maxDataMessages = std::max<lua_Integer>(0, lua_tointeger(L, -1));
+    }
+    lua_pop(L, 1);
+
     type = lua_getfield(L, 1, "onreceive");
     if (type == LUA_TFUNCTION) {
       int onreceiveRef = luaL_ref(L, LUA_REGISTRYINDEX);
 
       ws->setOnMessageCallback(
-        [L, ws, onreceiveRef](const ix::WebSocketMessagePtr& msg) {
+        [L, ws, onreceiveRef, queue](const ix::WebSocketMessagePtr& msg) {
           int msgType =
             (msg->binary ? MESSAGE_TYPE_BINARY : static_cast<int>(msg->type));
-          std::string msgData = msg->str;
-
-          ui::execute_from_ui_thread([=]() {
-            lua_rawgeti(L, LUA_REGISTRYINDEX, onreceiveRef);
-            lua_pushinteger(L, msgType);
-            lua_pushlstring(L, msgData.c_str(), msgData.length());
 
-            if (lua_pcall(L, 2, 0, 0)) {
-              if (const char* s = lua_tostring(L, -1)) {
-                App::instance()->scriptEngine()->consolePrint(s);
-                ws->stop();
+          if (!queue->push(msgType, msg->str))
+            return;
+
+          ui::execute_from_ui_thread([L, ws, onreceiveRef, queue]() {
+            for (const auto& [type, data] : queue->take()) {
+              lua_rawgeti(L, LUA_REGISTRYINDEX, onreceiveRef);
+              lua_pushinteger(L, type);
+              lua_pushlstring(L, data.c_str(), data.length());
+
+              if (lua_pcall(L, 2, 0, 0)) {
+                if (const char* s = lua_tostring(L, -1)) {
+                  App::instance()->scriptEngine()->consolePrint(s);
+                  ws->stop();
+                }
+                lua_pop(L, 1);
+                break;
               }
             }
           });
@@ -147,6 +216,9 @@ int WebSocket_sendText(lua_State* L)
   return 0;
 }
 
+// ws:sendBinary(...) where each argument can be a string or an
+// Image (its pixels are sent without creating a Lua string). One
+// image is sent directly from its pixels buffer.
 int WebSocket_sendBinary(lua_State* L)
 {
   auto ws = get_ptr<ix::WebSocket>(L, 1);
@@ -155,16 +227,35 @@ int WebSocket_sendBinary(lua_State* L)
     return luaL_error(L, "WebSocket is not connected, can't send data");
   }
 
-  std::stringstream data;
+  bool success;
   int argc = lua_gettop(L);
 
-  for (int i = 2; i <= argc; i++) {
-    size_t bufLen;
-    const char* buf = lua_tolstring(L, i, &bufLen);
-    data.write(buf, bufLen);
+  const doc::Image* image = (argc == 2 ? may_get_image_from_arg(L, 2): nullptr);
+  if (image &&
+      image->rowBytes() == image->width() * image->bytesPerPixel()) {
+    const size_t size = size_t(image->rowBytes()) * image->height();
+    success = ws->sendBinary(
+      ix::IXWebSocketSendData(
+        (const char*)image->getPixelAddress(0, 0), size)).success;
+  }
+  else {
+    std::stringstream data;
+    for (int i = 2; i <= argc; i++) {
+      if (const doc::Image* image = may_get_image_from_arg(L, i)) {
+        const size_t rowSize = image->width() * image->bytesPerPixel();
+        for (int y = 0; y < image->height(); ++y)
+          data.write((const char*)image->getPixelAddress(0, y), rowSize);
+      }
+      else {
+        size_t bufLen;
+        const char* buf = lua_tolstring(L, i, &bufLen);
+        data.write(buf, bufLen);
+      }
+    }
+    success = ws->sendBinary(data.str()).success;
   }
 
-  if (!ws->sendBinary(data.str()).success) {
+  if (!success) {
     return luaL_error(L, "WebSocket failed to send data");
   }
   return 0;
@@ -0,0 +1,646 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/app.h"
+#include "app/script/engine.h"
+#include "app/script/luacpp.h"
+#include "app/task_scheduler.h"
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+#include "ui/system.h"
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace app {
+namespace script {
+
+namespace {
+
+// Nested tables deeper than this are considered cycles
+const int kMaxTableDepth = 64;
+
+// Instructions between checks of the "canceled" flag
+const int kCancelCheckInstructions = 1000;
+
+// Value copied between the main Lua state and a worker state. Only
+// plain data is supported (nil, booleans, numbers, strings, tables,
+// and images that are passed as read-only snapshots).
+struct WorkerValue {
+  int type = LUA_TNIL;
+  bool boolean = false;
+  bool isInteger = false;
+  lua_Integer integer = 0;
+  lua_Number number = 0.0;
+  std::string string;
+  std::vector<WorkerValue> keys;
+  std::vector<WorkerValue> values;
+  doc::ImageRef image;          // type == LUA_TUSERDATA
+};
+
+// Shared state between the Worker object (main thread) and the
+// TaskScheduler task that runs the function.
+struct Job {
+  // Main Lua state, it's set to nullptr when the Worker object is
+  // garbage collected (e.g. the script engine is closed) so results
+  // are not delivered anymore. Only accessed from the main thread.
+  lua_State* L = nullptr;
+
+  // Function to run (binary chunk from lua_dump() or source code)
+  std::string code;
+  bool binary = false;
+
+  std::vector<WorkerValue> args;
+  std::vector<WorkerValue> results;
+  std::string error;
+  std::vector<std::string> output;
+
+  std::atomic<bool> canceled = false;
+
+  std::mutex mutex;
+  std::condition_variable cv;
+  bool done = false;            // Guarded by "mutex"
+
+  // Main thread state
+  bool delivered = false;
+  int selfRef = LUA_NOREF;
+  int onresultRef = LUA_NOREF;
+  int onerrorRef = LUA_NOREF;
+};
+
+using JobPtr = std::shared_ptr<Job>;
+
+struct Worker {
+  JobPtr job;
+  Worker() : job(std::make_shared<Job>()) { }
+};
+
+// Image received/created in a worker state
+struct WorkerImage {
+  doc::ImageRef image;
+  bool readOnly;
+  WorkerImage(const doc::ImageRef& image, bool readOnly)
+    : image(image)
+    , readOnly(readOnly) { }
+};
+
+Job* get_job(lua_State* W)
+{
+  return *(Job**)lua_getextraspace(W);
+}
+
+// ----------------------------------------------------------------------
+// Copy values between states
+
+using GetImage = doc::ImageRef (*)(lua_State* L, int index);
+using PushImage = void (*)(lua_State* L, const doc::ImageRef& image);
+
+// Fills "value" in-place (it's already owned by the Job) so Lua
+// errors don't leak memory.
+void to_value(lua_State* L, int index, WorkerValue& value,
+              GetImage getImage, const int depth = 0)
+{
+  index = lua_absindex(L, index);
+  value.type = lua_type(L, index);
+  switch (value.type) {
+    case LUA_TNIL:
+      break;
+    case LUA_TBOOLEAN:
+      value.boolean = lua_toboolean(L, index);
+      break;
+    case LUA_TNUMBER:
+      value.isInteger = lua_isinteger(L, index);
+      if (value.isInteger)
+        value.integer = lua_tointeger(L, index);
+      else
+        value.number = lua_tonumber(L, index);
+      break;
+    case LUA_TSTRING: {
+      size_t len;
+      const char* s = lua_tolstring(L, index, &len);
+      value.string.assign(s, len);
+      break;
+    }
+    case LUA_TTABLE:
+      if (depth >= kMaxTableDepth)
+        luaL_error(L, "table is too deep or contains cycles");
+      lua_pushnil(L);
+      while (lua_next(L, index) != 0) {
+        switch (lua_type(L, -2)) {
+          case LUA_TBOOLEAN:
+          case LUA_TNUMBER:
+          case LUA_TSTRING:
+            break;
+          default:
+            luaL_error(L, "table keys must be booleans, numbers or strings");
+        }
+        value.keys.emplace_back();
+        to_value(L, -2, value.keys.back(), getImage, depth+1);
+        value.values.emplace_back();
+        to_value(L, -1, value.values.back(), getImage, depth+1);
+        lua_pop(L, 1);
+      }
+      break;
+    case LUA_TUSERDATA:
+      value.image = getImage(L, index);
+      if (value.image)
+        break;
+      [[fallthrough]];
+    default:
+      luaL_error(L, "cannot copy a %s value between Lua states",
+                 luaL_typename(L, index));
+      break;
+  }
+}
+
+void push_value(lua_State* L, const WorkerValue& value,
+                PushImage pushImage)
+{
+  switch (value.type) {
+    case LUA_TBOOLEAN:
+      lua_pushboolean(L, value.boolean);
+      break;
+    case LUA_TNUMBER:
+      if (value.isInteger)
+        lua_pushinteger(L, value.integer);
+      else
+        lua_pushnumber(L, value.number);
+      break;
+    case LUA_TSTRING:
+      lua_pushlstring(L, value.string.c_str(), value.string.size());
+      break;
+    case LUA_TTABLE:
+      lua_createtable(L, 0, int(value.keys.size()));
+      for (size_t i=0; i<value.keys.size(); ++i) {
+        push_value(L, value.keys[i], pushImage);
+        push_value(L, value.values[i], pushImage);
+        lua_rawset(L, -3);
+      }
+      break;
+    case LUA_TUSERDATA:
+      pushImage(L, value.image);
+      break;
+    default:
+      lua_pushnil(L);
+      break;
+  }
+}
+
+// Images from the main state are copied as snapshots sharing the
+// pixels (copy-on-write), so the main thread can keep modifying the
+// original image while the worker reads the snapshot.
+doc::ImageRef get_main_image(lua_State* L, int index)
+{
+  if (doc::Image* image = may_get_image_from_arg(L, index))
+    return doc::ImageRef(doc::Image::createSharedCopy(image));
+  return nullptr;
+}
+
+void push_main_image(lua_State* L, const doc::ImageRef& image)
+{
+  push_image(L, doc::Image::createSharedCopy(image.get()));
+}
+
+doc::ImageRef get_worker_image(lua_State* W, int index)
+{
+  if (auto obj = may_get_obj<WorkerImage>(W, index))
+    return obj->image;
+  return nullptr;
+}
+
+void push_worker_image(lua_State* W, const doc::ImageRef& image)
+{
+  push_new<WorkerImage>(W, image, true);
+}
+
+// ----------------------------------------------------------------------
+// Worker state (runs in a thread of the TaskScheduler)
+
+int WorkerImage_new(lua_State* W)
+{
+  const int w = luaL_checkinteger(W, 1);
+  const int h = luaL_checkinteger(W, 2);
+  const auto colorMode = (doc::ColorMode)luaL_optinteger(W, 3, int(doc::ColorMode::RGB));
+  if (w < 1 || h < 1)
+    return luaL_error(W, "invalid image size %dx%d", w, h);
+  switch (colorMode) {
+    case doc::ColorMode::RGB:
+    case doc::ColorMode::GRAYSCALE:
+    case doc::ColorMode::INDEXED:
+    case doc::ColorMode::TILEMAP:
+      break;
+    default:
+      return luaL_error(W, "invalid color mode");
+  }
+  doc::ImageRef image(doc::Image::create(doc::ImageSpec(colorMode, w, h)));
+  doc::clear_image(image.get(), 0);
+  push_new<WorkerImage>(W, image, false);
+  return 1;
+}
+
+int WorkerImage_gc(lua_State* W)
+{
+  get_obj<WorkerImage>(W, 1)->~WorkerImage();
+  return 0;
+}
+
+int WorkerImage_getPixel(lua_State* W)
+{
+  const doc::Image* image = get_obj<WorkerImage>(W, 1)->image.get();
+  const int x = luaL_checkinteger(W, 2);
+  const int y = luaL_checkinteger(W, 3);
+  if (x < 0 || y < 0 || x >= image->width() || y >= image->height())
+    return luaL_error(W, "pixel (%d, %d) out of bounds", x, y);
+  lua_pushinteger(W, doc::get_pixel(image, x, y));
+  return 1;
+}
+
+int WorkerImage_putPixel(lua_State* W)
+{
+  auto obj = get_obj<WorkerImage>(W, 1);
+  if (obj->readOnly)
+    return luaL_error(W, "image snapshots are read-only");
+  const int x = luaL_checkinteger(W, 2);
+  const int y = luaL_checkinteger(W, 3);
+  const doc::color_t c = doc::color_t(luaL_checkinteger(W, 4));
+  doc::put_pixel(obj->image.get(), x, y, c);
+  return 0;
+}
+
+int WorkerImage_get_width(lua_State* W)
+{
+  lua_pushinteger(W, get_obj<WorkerImage>(W, 1)->image->width());
+  return 1;
+}
+
+int WorkerImage_get_height(lua_State* W)
+{
+  lua_pushinteger(W, get_obj<WorkerImage>(W, 1)->image->height());
+  return 1;
+}
+
+int WorkerImage_get_colorMode(lua_State* W)
+{
+  lua_pushinteger(W, int(get_obj<WorkerImage>(W, 1)->image->colorMode()));
+  return 1;
+}
+
+int WorkerImage_get_bytes(lua_State* W)
+{
+  const doc::Image* image = get_obj<WorkerImage>(W, 1)->image.get();
+  const size_t rowBytes = image->width() * image->bytesPerPixel();
+  luaL_Buffer b;
+  luaL_buffinit(W, &b);
+  for (int y=0; y<image->height(); ++y)
+    luaL_addlstring(&b, (const char*)image->getPixelAddress(0, y), rowBytes);
+  luaL_pushresult(&b);
+  return 1;
+}
+
+const luaL_Reg WorkerImage_methods[] = {
+  { "__gc", WorkerImage_gc },
+  { "getPixel", WorkerImage_getPixel },
+  { "putPixel", WorkerImage_putPixel },
+  { nullptr, nullptr }
+};
+
+const Property WorkerImage_properties[] = {
+  { "width", WorkerImage_get_width, nullptr },
+  { "height", WorkerImage_get_height, nullptr },
+  { "colorMode", WorkerImage_get_colorMode, nullptr },
+  { "bytes", WorkerImage_get_bytes, nullptr },
+  { nullptr, nullptr, nullptr }
+};
+
+// print() output is collected and printed in the console of the
+// main thread with the results
+int worker_print(lua_State* W)
+{
+  luaL_Buffer b;
+  luaL_buffinit(W, &b);
+  const int n = lua_gettop(W);
+  for (int i=1; i<=n; ++i) {
+    if (i > 1)
+      luaL_addchar(&b, '\t');
+    luaL_tolstring(W, i, nullptr);
+    luaL_addvalue(&b);
+  }
+  luaL_pushresult(&b);
+
+  size_t len;
+  const char* s = lua_tolstring(W, -1, &len);
+  get_job(W)->output.emplace_back(s, len);
+  return 0;
+}
+
+void worker_hook(lua_State* W, lua_Debug* ar)
+{
+  if (get_job(W)->canceled)
+    luaL_error(W, "worker canceled");
+}
+
+// Called in protected mode, loads and calls the function with the
+// arguments, and copies the results to the Job
+int worker_main(lua_State* W)
+{
+  Job* job = get_job(W);
+  if (luaL_loadbufferx(W, job->code.c_str(), job->code.size(), "=worker",
+                       job->binary ? "b": "t") != LUA_OK) {
+    return lua_error(W);
+  }
+
+  // Functions from the main state can only use globals as upvalues
+  // (_ENV), which are the globals of the worker state
+  for (int i=1; lua_getupvalue(W, -1, i); ++i) {
+    lua_pop(W, 1);
+    lua_rawgeti(W, LUA_REGISTRYINDEX, LUA_RIDX_GLOBALS);
+    lua_setupvalue(W, -2, i);
+  }
+
+  for (const WorkerValue& arg : job->args)
+    push_value(W, arg, push_worker_image);
+
+  const int base = lua_gettop(W) - int(job->args.size());
+  lua_call(W, int(job->args.size()), LUA_MULTRET);
+
+  const int n = lua_gettop(W) - base + 1;
+  job->results.resize(n);
+  for (int i=0; i<n; ++i)
+    to_value(W, base+i, job->results[i], get_worker_image);
+  return 0;
+}
+
+lua_State* create_worker_state(Job* job)
+{
+  lua_State* W = luaL_newstate();
+  *(Job**)lua_getextraspace(W) = job;
+
+  // Only libraries without access to the file system/OS
+  luaL_requiref(W, LUA_GNAME, luaopen_base, 1);
+  luaL_requiref(W, LUA_TABLIBNAME, luaopen_table, 1);
+  luaL_requiref(W, LUA_STRLIBNAME, luaopen_string, 1);
+  luaL_requiref(W, LUA_MATHLIBNAME, luaopen_math, 1);
+  luaL_requiref(W, LUA_UTF8LIBNAME, luaopen_utf8, 1);
+  luaL_requiref(W, LUA_DBLIBNAME, luaopen_debug, 1);
+  lua_pop(W, 6);
+
+  for (const char* name : { "dofile", "loadfile" }) {
+    lua_pushnil(W);
+    lua_setglobal(W, name);
+  }
+  lua_register(W, "print", worker_print);
+
+  run_mt_index_code(W);
+
+  REG_CLASS(W, WorkerImage);
+  REG_CLASS_PROPERTIES(W, WorkerImage);
+  lua_register(W, "Image", WorkerImage_new);
+
+  lua_newtable(W);
+  lua_pushvalue(W, -1);
+  lua_setglobal(W, "ColorMode");
+  setfield_integer(W, "RGB", doc::ColorMode::RGB);
+  setfield_integer(W, "GRAY", doc::ColorMode::GRAYSCALE);
+  setfield_integer(W, "GRAYSCALE", doc::ColorMode::GRAYSCALE);
+  setfield_integer(W, "INDEXED", doc::ColorMode::INDEXED);
+  setfield_integer(W, "TILEMAP", doc::ColorMode::TILEMAP);
+  lua_pop(W, 1);
+
+  lua_sethook(W, worker_hook, LUA_MASKCOUNT, kCancelCheckInstructions);
+  return W;
+}
+
+void deliver_results(const JobPtr& job);
+
+void run_job(const JobPtr& job)
+{
+  if (!job->canceled) {
+    lua_State* W = create_worker_state(job.get());
+    lua_pushcfunction(W, worker_main);
+    if (lua_pcall(W, 0, 0, 0) != LUA_OK) {
+      const char* s = lua_tostring(W, -1);
+      job->error = (s ? s: "unknown error");
+      job->results.clear();
+    }
+    lua_close(W);
+  }
+  else {
+    job->error = "worker canceled";
+  }
+
+  {
+    const std::lock_guard lock(job->mutex);
+    job->done = true;
+  }
+  job->cv.notify_all();
+
+  ui::execute_from_ui_thread([job]{ deliver_results(job); });
+}
+
+// ----------------------------------------------------------------------
+// Main thread
+
+void call_callback(lua_State* L, const int ref, const int nargs)
+{
+  lua_rawgeti(L, LUA_REGISTRYINDEX, ref);
+  lua_insert(L, -nargs-1);
+  if (lua_pcall(L, nargs, 0, 0) != LUA_OK) {
+    if (const char* s = lua_tostring(L, -1))
+      App::instance()->scriptEngine()->consolePrint(s);
+    lua_pop(L, 1);
+  }
+}
+
+void deliver_results(const JobPtr& job)
+{
+  lua_State* L = job->L;
+  if (!L || job->delivered)
+    return;
+  job->delivered = true;
+
+  Engine* engine = App::instance()->scriptEngine();
+  for (const std::string& line : job->output)
+    engine->consolePrint(line.c_str());
+
+  if (!job->error.empty()) {
+    if (job->onerrorRef != LUA_NOREF) {
+      lua_pushstring(L, job->error.c_str());
+      call_callback(L, job->onerrorRef, 1);
+    }
+    else
+      engine->consolePrint(job->error.c_str());
+  }
+  else if (job->onresultRef != LUA_NOREF) {
+    for (const WorkerValue& result : job->results)
+      push_value(L, result, push_main_image);
+    call_callback(L, job->onresultRef, int(job->results.size()));
+  }
+
+  // The Worker object can be garbage collected now
+  for (int* ref : { &job->onresultRef, &job->onerrorRef, &job->selfRef }) {
+    luaL_unref(L, LUA_REGISTRYINDEX, *ref);
+    *ref = LUA_NOREF;
+  }
+}
+
+// app.worker{ func=function or string,
+//             args={ ... },
+//             onresult=function(...) end,
+//             onerror=function(msg) end }
+int Worker_new(lua_State* L)
+{
+  luaL_checktype(L, 1, LUA_TTABLE);
+
+  // The Worker object owns the Job from the beginning, so it's
+  // released if there is an error copying the arguments.
+  auto worker = push_new<Worker>(L);
+  const int workerIndex = lua_gettop(L);
+  Job* job = worker->job.get();
+
+  switch (lua_getfield(L, 1, "func")) {
+    case LUA_TFUNCTION: {
+      if (lua_iscfunction(L, -1))
+        return luaL_error(L, "a C function cannot be used as a worker");
+      for (int i=1; const char* name = lua_getupvalue(L, -1, i); ++i) {
+        if (std::strcmp(name, "_ENV") != 0)
+          return luaL_error(L, "worker function cannot use the local variable '%s', pass it in 'args'", name);
+        lua_pop(L, 1);
+      }
+      lua_dump(L, [](lua_State*, const void* p, size_t sz, void* ud) -> int {
+        ((std::string*)ud)->append((const char*)p, sz);
+        return 0;
+      }, &job->code, 0);
+      job->binary = true;
+      break;
+    }
+    case LUA_TSTRING:
+      job->code = lua_tostring(L, -1);
+      job->binary = false;
+      break;
+    default:
+      return luaL_error(L, "'func' must be a function or a string with Lua code");
+  }
+  lua_pop(L, 1);
+
+  if (lua_getfield(L, 1, "args") == LUA_TTABLE) {
+    const int n = luaL_len(L, -1);
+    job->args.resize(n);
+    for (int i=0; i<n; ++i) {
+      lua_geti(L, -1, i+1);
+      to_value(L, -1, job->args[i], get_main_image);
+      lua_pop(L, 1);
+    }
+  }
+  lua_pop(L, 1);
+
+  if (lua_getfield(L, 1, "onresult") == LUA_TFUNCTION)
+    job->onresultRef = luaL_ref(L, LUA_REGISTRYINDEX);
+  else
+    lua_pop(L, 1);
+
+  if (lua_getfield(L, 1, "onerror") == LUA_TFUNCTION)
+    job->onerrorRef = luaL_ref(L, LUA_REGISTRYINDEX);
+  else
+    lua_pop(L, 1);
+
+  // Keep the Worker alive until the results are delivered
+  lua_pushvalue(L, workerIndex);
+  job->selfRef = luaL_ref(L, LUA_REGISTRYINDEX);
+  job->L = L;
+
+  TaskScheduler::instance().execute(
+    TaskPriority::Script, [job = worker->job]{ run_job(job); });
+  return 1;
+}
+
+int Worker_gc(lua_State* L)
+{
+  auto worker = get_obj<Worker>(L, 1);
+  worker->job->L = nullptr;
+  worker->job->canceled = true;
+  worker->~Worker();
+  return 0;
+}
+
+// Waits the worker to finish and calls the callbacks (if they were
+// not called yet). Returns true and the results of the function, or
+// false and the error message.
+int Worker_wait(lua_State* L)
+{
+  auto worker = get_obj<Worker>(L, 1);
+  Job* job = worker->job.get();
+  {
+    std::unique_lock lock(job->mutex);
+    job->cv.wait(lock, [job]{ return job->done; });
+  }
+  deliver_results(worker->job);
+
+  if (!job->error.empty()) {
+    lua_pushboolean(L, false);
+    lua_pushstring(L, job->error.c_str());
+    return 2;
+  }
+  lua_pushboolean(L, true);
+  for (const WorkerValue& result : job->results)
+    push_value(L, result, push_main_image);
+  return 1 + int(job->results.size());
+}
+
+int Worker_cancel(lua_State* L)
+{
+  get_obj<Worker>(L, 1)->job->canceled = true;
+  return 0;
+}
+
+int Worker_get_isDone(lua_State* L)
+{
+  Job* job = get_obj<Worker>(L, 1)->job.get();
+  const std::lock_guard lock(job->mutex);
+  lua_pushboolean(L, job->done);
+  return 1;
+}
+
+const luaL_Reg Worker_methods[] = {
+  { "__gc", Worker_gc },
+  { "wait", Worker_wait },
+  { "cancel", Worker_cancel },
+  { nullptr, nullptr }
+};
+
+const Property Worker_properties[] = {
+  { "isDone", Worker_get_isDone, nullptr },
+  { nullptr, nullptr, nullptr }
+};
+
+} // anonymous namespace
+
+DEF_MTNAME(Worker);
+DEF_MTNAME(WorkerImage);
+
+void register_worker_class(lua_State* L)
+{
+  REG_CLASS(L, Worker);
+  REG_CLASS_PROPERTIES(L, Worker);
+
+  lua_getglobal(L, "app");
+  lua_pushcfunction(L, Worker_new);
+  lua_setfield(L, -2, "worker");
+  lua_pop(L, 1);
+}
+
+} // namespace script
+} // namespace app
@@ -0,0 +1,226 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/sheet_sample_cache.h"
+
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/serialization.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/layer.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "fmt/format.h"
+
+#include <fstream>
+
+namespace app {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+using namespace doc;
+
+static const uint32_t kSampleMagic = 0x53535341; // "ASSS"
+
+// Increment this version when the format of the cached files or the
+// way the keys are calculated changes
+static const uint16_t kSampleVersion = 1;
+
+namespace {
+
+// FNV-1a hash, it must give the same result in each execution of the
+// program (std::hash doesn't guarantee that)
+class KeyHasher {
+public:
+  void add(const void* data, const size_t n) {
+    auto p = (const uint8_t*)data;
+    for (size_t i=0; i<n; ++i) {
+      m_value ^= p[i];
+      m_value *= 1099511628211ull;
+    }
+  }
+
+  void add(const int value) {
+    const int32_t v = value;
+    add(&v, sizeof(v));
+  }
+
+  void add(const gfx::Rect& rc) {
+    add(rc.x);
+    add(rc.y);
+    add(rc.w);
+    add(rc.h);
+  }
+
+  void add(const std::string& str) {
+    add(int(str.size()));
+    add(str.c_str(), str.size());
+  }
+
+  SheetSampleCache::Key value() const {
+    // 0 is used as "no key"
+    return (m_value ? m_value: 1);
+  }
+
+private:
+  uint64_t m_value = 14695981039346656037ull;
+};
+
+// Returns false if the layer cannot be cached
+bool add_layer(KeyHasher& h, const Layer* layer, const frame_t frame)
+{
+  if (layer->isTilemap())
+    return false;
+
+  h.add(int(layer->type()));
+  h.add(int(layer->flags()));
+
+  if (layer->isImage()) {
+    auto imgLayer = static_cast<const LayerImage*>(layer);
+    h.add(int(imgLayer->blendMode()));
+    h.add(imgLayer->opacity());
+
+    if (const Cel* cel = layer->cel(frame)) {
+      const Image* image = cel->image();
+      h.add(cel->bounds());
+      h.add(cel->opacity());
+      h.add(cel->zIndex());
+      h.add(int(image->pixelFormat()));
+      h.add(int(calculate_image_hash(image, image->bounds())));
+    }
+    else
+      h.add(-1);
+  }
+  else if (layer->isGroup()) {
+    auto group = static_cast<const LayerGroup*>(layer);
+    h.add(group->layersCount());
+    for (const Layer* child : group->layers()) {
+      if (!add_layer(h, child, frame))
+        return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+SheetSampleCache::SheetSampleCache(const std::string& dir)
+  : m_dir(dir)
+{
+  // Created here as the samples are saved from several threads
+  try {
+    if (!base::is_directory(m_dir))
+      base::make_all_directories(m_dir);
+  }
+  catch (const std::exception&) {
+    // Ignore errors, the samples will not be cached
+  }
+}
+
+// static
+SheetSampleCache::Key SheetSampleCache::sampleKey(
+  const std::string& filename,
+  const Sprite* sprite,
+  const frame_t frame,
+  const gfx::Size& renderSize,
+  const gfx::Rect& startBounds,
+  const bool refColorFromFirstPixel)
+{
+  KeyHasher h;
+  h.add(filename);
+  h.add(frame);
+  h.add(gfx::Rect(renderSize));
+  h.add(startBounds);
+  h.add(refColorFromFirstPixel);
+  h.add(int(sprite->pixelFormat()));
+  h.add(sprite->bounds());
+  h.add(int(sprite->transparentColor()));
+
+  const Palette* palette = sprite->palette(frame);
+  h.add(palette->size());
+  for (int i=0; i<palette->size(); ++i)
+    h.add(int(palette->getEntry(i)));
+
+  if (!add_layer(h, sprite->root(), frame))
+    return 0;
+
+  return h.value();
+}
+
+bool SheetSampleCache::load(const Key key, SheetSample& sample) const
+{
+  const std::string fn = cacheFilename(key);
+  if (!base::is_file(fn))
+    return false;
+
+  try {
+    std::ifstream s(FSTREAM_PATH(fn), std::ifstream::binary);
+    if (read32(s) != kSampleMagic ||
+        read16(s) != kSampleVersion)
+      return false;
+
+    uint64_t fileKey = read32(s);
+    fileKey |= uint64_t(read32(s)) << 32;
+    if (fileKey != key)
+      return false;
+
+    sample.nonEmpty = (read8(s) != 0);
+    sample.bounds.x = int32_t(read32(s));
+    sample.bounds.y = int32_t(read32(s));
+    sample.bounds.w = int32_t(read32(s));
+    sample.bounds.h = int32_t(read32(s));
+    if (sample.nonEmpty) {
+      sample.image.reset(read_image(s, false));
+      if (!sample.image ||
+          sample.image->size() != sample.bounds.size())
+        return false;
+    }
+    else
+      sample.image.reset();
+    return s.good();
+  }
+  catch (const std::exception&) {
+    // The cached file is corrupted, the sample will be rendered again
+    return false;
+  }
+}
+
+void SheetSampleCache::save(const Key key, const SheetSample& sample) const
+{
+  ASSERT(!sample.nonEmpty || sample.image);
+  try {
+    std::ofstream s(FSTREAM_PATH(cacheFilename(key)),
+                    std::ofstream::binary);
+    write32(s, kSampleMagic);
+    write16(s, kSampleVersion);
+    write32(s, uint32_t(key & 0xffffffff));
+    write32(s, uint32_t(key >> 32));
+    write8(s, sample.nonEmpty ? 1: 0);
+    write32(s, uint32_t(sample.bounds.x));
+    write32(s, uint32_t(sample.bounds.y));
+    write32(s, uint32_t(sample.bounds.w));
+    write32(s, uint32_t(sample.bounds.h));
+    if (sample.nonEmpty)
+      write_image(s, sample.image.get());
+  }
+  catch (const std::exception&) {
+    // Ignore errors, the sample will not be cached
+  }
+}
+
+std::string SheetSampleCache::cacheFilename(const Key key) const
+{
+  return base::join_path(m_dir, fmt::format("{:016x}.sample", key));
+}
+
+} // namespace app
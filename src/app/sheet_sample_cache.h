@@ -0,0 +1,66 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_SHEET_SAMPLE_CACHE_H_INCLUDED
+#define APP_SHEET_SAMPLE_CACHE_H_INCLUDED
+#pragma once
+
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <cstdint>
+#include <string>
+
+namespace doc {
+  class Sprite;
+}
+
+namespace app {
+
+  // Trimmed sample of a sprite sheet: the result of shrinking the
+  // render of one frame and the pixels inside the trimmed bounds.
+  struct SheetSample {
+    bool nonEmpty = false;
+    gfx::Rect bounds;
+    doc::ImageRef image;        // Can be nullptr if the sample is empty
+  };
+
+  // Persistent (on disk) cache of trimmed sprite sheet samples, so
+  // exporting the same sheet again only renders the frames that were
+  // modified. Each sample is keyed by the document path, the frame,
+  // and the content of the frame (cels, layers, and palette). It can
+  // be used from several threads.
+  class SheetSampleCache {
+  public:
+    typedef uint64_t Key;
+
+    explicit SheetSampleCache(const std::string& dir);
+
+    // Returns the key of the frame with the current visibility of the
+    // sprite layers, or 0 if the frame cannot be cached (e.g. it
+    // contains tilemaps).
+    static Key sampleKey(const std::string& filename,
+                         const doc::Sprite* sprite,
+                         const doc::frame_t frame,
+                         const gfx::Size& renderSize,
+                         const gfx::Rect& startBounds,
+                         const bool refColorFromFirstPixel);
+
+    // Returns false if the sample is not in the cache.
+    bool load(const Key key, SheetSample& sample) const;
+    void save(const Key key, const SheetSample& sample) const;
+
+  private:
+    std::string cacheFilename(const Key key) const;
+
+    std::string m_dir;
+  };
+
+} // namespace app
+
+#endif
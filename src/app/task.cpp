@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -10,16 +10,17 @@
 
 #include "app/task.h"
 
+#include "base/log.h"
 #include "base/task.h"
-#include "base/thread.h"
-#include "base/thread_pool.h"
 
-namespace app {
+#include <exception>
 
-static base::thread_pool tasks_pool(4);
+namespace app {
 
-Task::Task()
-  : m_token(nullptr)
+Task::Task(const TaskPriority priority)
+  : m_priority(priority)
+  , m_running(false)
+  , m_completed(false)
 {
 }
 
@@ -29,17 +30,32 @@ Task::~Task()
 
 void Task::run(base::task::func_t&& func)
 {
-  const std::lock_guard lock(m_token_mutex);
-  m_task.on_execute(std::move(func));
-  m_token = &m_task.start(tasks_pool);
+  auto token = std::make_shared<base::task_token>();
+  {
+    const std::lock_guard lock(m_token_mutex);
+    m_token = token;
+  }
+
+  m_completed = false;
+  m_running = true;
+  m_future = TaskScheduler::instance().execute(
+    m_priority,
+    [this, token, func = std::move(func)]{
+      try {
+        func(*token);
+      }
+      catch (const std::exception& ex) {
+        LOG(ERROR, "TASK: %s\n", ex.what());
+      }
+      m_running = false;
+      m_completed = true;
+    });
 }
 
 void Task::wait()
 {
-  // TODO wait a condition variable
-  while (!m_task.completed()) {
-    base::this_thread::sleep_for(0.1);
-  }
+  if (m_future.valid())
+    m_future.wait();
 }
 
 } // namespace app
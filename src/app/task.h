@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -8,16 +8,22 @@
 #define APP_TASK_H_INCLUDED
 #pragma once
 
+#include "app/task_scheduler.h"
 #include "base/task.h"
 
+#include <atomic>
 #include <functional>
+#include <future>
+#include <memory>
 #include <mutex>
 
 namespace app {
 
+  // Task with progress and cancellation executed in the
+  // TaskScheduler with the given priority.
   class Task {
   public:
-    Task();
+    explicit Task(const TaskPriority priority = TaskPriority::UserJob);
     ~Task();
 
     void run(base::task::func_t&& func);
@@ -26,11 +32,11 @@ namespace app {
     // Returns true when the task is completed (whether it was
     // canceled or not)
     bool completed() const {
-      return m_task.completed();
+      return m_completed;
     }
 
     bool running() const {
-      return m_task.running();
+      return m_running;
     }
 
     bool canceled() const {
@@ -60,9 +66,14 @@ namespace app {
     }
 
   private:
-    base::task m_task;
+    TaskPriority m_priority;
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_completed;
+    std::future<void> m_future;
     mutable std::mutex m_token_mutex;
-    base::task_token* m_token;
+    // The token is shared with the function running in the scheduler
+    // (so it's alive until the function ends)
+    std::shared_ptr<base::task_token> m_token;
   };
 
 } // namespace app
@@ -0,0 +1,138 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/task_scheduler.h"
+
+#include "base/debug.h"
+#include "base/thread.h"
+
+#include <algorithm>
+
+namespace app {
+
+// static
+TaskScheduler& TaskScheduler::instance()
+{
+  static TaskScheduler scheduler(
+    std::max(4, int(std::thread::hardware_concurrency())));
+  return scheduler;
+}
+
+TaskScheduler::TaskScheduler(const int threads)
+  : m_running{ 0, 0, 0, 0 }
+  , m_stop(false)
+{
+  ASSERT(threads >= 3);
+  m_threads.reserve(threads);
+  for (int i=0; i<threads; ++i)
+    m_threads.emplace_back([this]{ workerThread(); });
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  {
+    const std::lock_guard lock(m_mutex);
+    m_stop = true;
+  }
+  m_cv.notify_all();
+
+  // Running tasks are completed, queued tasks are discarded
+  for (std::thread& thread : m_threads)
+    thread.join();
+}
+
+int TaskScheduler::maxRunning(const TaskPriority priority) const
+{
+  switch (priority) {
+    case TaskPriority::Interactive: return threads();
+    case TaskPriority::UserJob:     return threads()-1;
+    case TaskPriority::Script:
+    case TaskPriority::Background:  return std::max(1, threads()/2);
+  }
+  return 1;
+}
+
+std::future<void> TaskScheduler::execute(const TaskPriority priority,
+                                         std::function<void()>&& func)
+{
+  std::packaged_task<void()> task(std::move(func));
+  std::future<void> future = task.get_future();
+  {
+    const std::lock_guard lock(m_mutex);
+    m_queues[int(priority)].push_back(std::move(task));
+  }
+  m_cv.notify_one();
+  return future;
+}
+
+// Returns the priority of the next task that can be started, or -1
+// if there is no task (or the tasks in the queues cannot be started
+// yet). Must be called with m_mutex locked.
+int TaskScheduler::nextPriority() const
+{
+  const int interactive = int(TaskPriority::Interactive);
+  const int userJob = int(TaskPriority::UserJob);
+  const int script = int(TaskPriority::Script);
+  const int background = int(TaskPriority::Background);
+
+  if (!m_queues[interactive].empty())
+    return interactive;
+
+  // Keep one thread for interactive tasks
+  if (m_running[userJob] + m_running[script] + m_running[background] >= threads()-1)
+    return -1;
+
+  if (!m_queues[userJob].empty())
+    return userJob;
+
+  // Keep other thread for user jobs
+  if (m_running[script] + m_running[background] >= threads()-2)
+    return -1;
+
+  if (!m_queues[script].empty() &&
+      m_running[script] < maxRunning(TaskPriority::Script))
+    return script;
+
+  if (!m_queues[background].empty() &&
+      m_running[background] < maxRunning(TaskPriority::Background))
+    return background;
+
+  return -1;
+}
+
+void TaskScheduler::workerThread()
+{
+  base::this_thread::set_name("tasks");
+
+  std::unique_lock lock(m_mutex);
+  while (true) {
+    int priority = -1;
+    m_cv.wait(lock, [this, &priority]{
+      priority = nextPriority();
+      return (m_stop || priority >= 0);
+    });
+    if (m_stop)
+      break;
+
+    std::packaged_task<void()> task = std::move(m_queues[priority].front());
+    m_queues[priority].pop_front();
+    ++m_running[priority];
+
+    lock.unlock();
+    task();
+    lock.lock();
+
+    // A task that couldn't be started (because of the limits of its
+    // priority) can be started now by this same thread.
+    --m_running[priority];
+  }
+}
+
+} // namespace app
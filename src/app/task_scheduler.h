@@ -0,0 +1,79 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_TASK_SCHEDULER_H_INCLUDED
+#define APP_TASK_SCHEDULER_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace app {
+
+  enum class TaskPriority {
+    Interactive,    // Renders/previews that the user is waiting for
+    UserJob,        // Commands started by the user (modal jobs, filters)
+    Script,         // Long-running script workers (app.worker())
+    Background,     // Thumbnails and other work nobody is waiting for
+  };
+
+  // App-wide pool of worker threads (one per core, with a minimum of
+  // 4 threads) shared by all the background work of the app, so the
+  // number of threads is bounded.
+  //
+  // Tasks are started in priority order, and tasks that are not
+  // Interactive can use all the threads except one, so there is
+  // always a thread available to start interactive renders. Script
+  // and Background tasks can use half of the threads at most (each
+  // one), and together they always leave a thread for UserJob tasks,
+  // so scripts and thumbnails cannot delay the jobs started by the
+  // user (e.g. a modal Job waiting for its thread).
+  class TaskScheduler {
+  public:
+    static TaskScheduler& instance();
+
+    explicit TaskScheduler(const int threads);
+    ~TaskScheduler();
+
+    int threads() const { return int(m_threads.size()); }
+
+    // Maximum number of tasks with the given priority that can be
+    // running at the same time.
+    int maxRunning(const TaskPriority priority) const;
+
+    // Adds a task to the queue of the given priority. The returned
+    // future can be used to wait the task (it contains the exception
+    // thrown by "func" if there is one).
+    std::future<void> execute(const TaskPriority priority,
+                              std::function<void()>&& func);
+
+  private:
+    static constexpr int kPriorities = 4;
+
+    int nextPriority() const;
+    void workerThread();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::deque<std::packaged_task<void()>> m_queues[kPriorities];
+    // Number of running tasks of each priority
+    int m_running[kPriorities];
+    bool m_stop;
+
+    DISABLE_COPYING(TaskScheduler);
+  };
+
+} // namespace app
+
+#endif
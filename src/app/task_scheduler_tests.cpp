@@ -0,0 +1,44 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/task_scheduler.h"
+
+#include <chrono>
+#include <future>
+#include <vector>
+
+using namespace app;
+
+// Blocked scripts and background tasks cannot use all the threads,
+// so jobs started by the user and interactive renders can still run.
+TEST(TaskScheduler, ScriptsDontStarveUserJobs)
+{
+  TaskScheduler scheduler(4);
+  std::promise<void> release;
+  std::shared_future<void> released = release.get_future().share();
+
+  std::vector<std::future<void>> tasks;
+  for (int i=0; i<8; ++i) {
+    tasks.push_back(scheduler.execute(TaskPriority::Script,
+                                      [released]{ released.wait(); }));
+    tasks.push_back(scheduler.execute(TaskPriority::Background,
+                                      [released]{ released.wait(); }));
+  }
+
+  std::future<void> job = scheduler.execute(TaskPriority::UserJob, []{});
+  EXPECT_EQ(std::future_status::ready,
+            job.wait_for(std::chrono::seconds(10)));
+
+  std::future<void> render = scheduler.execute(TaskPriority::Interactive, []{});
+  EXPECT_EQ(std::future_status::ready,
+            render.wait_for(std::chrono::seconds(10)));
+
+  release.set_value();
+  for (auto& task : tasks)
+    task.wait();
+}
@@ -0,0 +1,145 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/thumbnail_cache.h"
+
+#include "app/resource_finder.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/serialization.h"
+#include "base/time.h"
+#include "doc/image.h"
+#include "doc/image_io.h"
+#include "doc/palette.h"
+#include "doc/palette_io.h"
+#include "doc/string_io.h"
+#include "fmt/format.h"
+
+#include <fstream>
+#include <functional>
+
+namespace app {
+
+using namespace base::serialization;
+using namespace base::serialization::little_endian;
+using namespace doc;
+
+static const uint32_t kThumbnailMagic = 0x4d485441; // "ATHM"
+
+// Increment this version when the format of the cached files changes
+static const uint16_t kThumbnailVersion = 1;
+
+namespace {
+
+struct FileKey {
+  std::string filename;
+  uint64_t size = 0;
+  base::Time time;
+
+  FileKey(const std::string& fn)
+    : filename(fn)
+    , size(base::file_size(fn))
+    , time(base::get_modification_time(fn)) {
+  }
+
+  void write(std::ostream& os) const {
+    write_string(os, filename);
+    write32(os, uint32_t(size & 0xffffffff));
+    write32(os, uint32_t(size >> 32));
+    write16(os, time.year);
+    write8(os, time.month);
+    write8(os, time.day);
+    write8(os, time.hour);
+    write8(os, time.minute);
+    write8(os, time.second);
+  }
+
+  bool matches(std::istream& is) const {
+    if (read_string(is) != filename)
+      return false;
+
+    uint64_t fileSize = read32(is);
+    fileSize |= uint64_t(read32(is)) << 32;
+    base::Time fileTime;
+    fileTime.year = read16(is);
+    fileTime.month = read8(is);
+    fileTime.day = read8(is);
+    fileTime.hour = read8(is);
+    fileTime.minute = read8(is);
+    fileTime.second = read8(is);
+    return (is.good() &&
+            fileSize == size &&
+            fileTime == time);
+  }
+};
+
+} // anonymous namespace
+
+ThumbnailCache::ThumbnailCache()
+{
+  ResourceFinder rf;
+  rf.includeUserDir(base::join_path("thumbnails", ".").c_str());
+  m_dir = rf.getFirstOrCreateDefault();
+}
+
+bool ThumbnailCache::load(const std::string& filename,
+                          std::unique_ptr<Image>& image,
+                          std::unique_ptr<Palette>& palette) const
+{
+  const std::string fn = cacheFilename(filename);
+  if (!base::is_file(fn))
+    return false;
+
+  try {
+    std::ifstream s(FSTREAM_PATH(fn), std::ifstream::binary);
+    if (read32(s) != kThumbnailMagic ||
+        read16(s) != kThumbnailVersion ||
+        !FileKey(filename).matches(s))
+      return false;
+
+    image.reset(read_image(s, false));
+    palette.reset(read_palette(s));
+    return (image && palette && s.good());
+  }
+  catch (const std::exception&) {
+    // The cached file is corrupted, it will be generated again
+    return false;
+  }
+}
+
+void ThumbnailCache::save(const std::string& filename,
+                          const Image* image,
+                          const Palette* palette) const
+{
+  try {
+    if (!base::is_directory(m_dir))
+      base::make_all_directories(m_dir);
+
+    std::ofstream s(FSTREAM_PATH(cacheFilename(filename)),
+                    std::ofstream::binary);
+    write32(s, kThumbnailMagic);
+    write16(s, kThumbnailVersion);
+    FileKey(filename).write(s);
+    write_image(s, image);
+    write_palette(s, palette);
+  }
+  catch (const std::exception&) {
+    // Ignore errors, the thumbnail will not be cached
+  }
+}
+
+std::string ThumbnailCache::cacheFilename(const std::string& filename) const
+{
+  // The full path is saved in the file too (to discard collisions)
+  const size_t hash = std::hash<std::string>()(filename);
+  return base::join_path(m_dir, fmt::format("{:016x}.thumb", hash));
+}
+
+} // namespace app
@@ -0,0 +1,49 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_THUMBNAIL_CACHE_H_INCLUDED
+#define APP_THUMBNAIL_CACHE_H_INCLUDED
+#pragma once
+
+#include <memory>
+#include <string>
+
+namespace doc {
+  class Image;
+  class Palette;
+}
+
+namespace app {
+
+  // Persistent (on disk) cache of the thumbnails generated for the
+  // file selector. Each thumbnail is keyed by the file path, and it's
+  // valid only while the file size and modification time are the
+  // same, so browsing the same folder again doesn't need to decode
+  // all its files again. It can be used from several threads.
+  class ThumbnailCache {
+  public:
+    // Uses the "thumbnails" directory in the user folder.
+    ThumbnailCache();
+
+    // Returns false if there is no valid thumbnail for the given
+    // file in the cache.
+    bool load(const std::string& filename,
+              std::unique_ptr<doc::Image>& image,
+              std::unique_ptr<doc::Palette>& palette) const;
+
+    void save(const std::string& filename,
+              const doc::Image* image,
+              const doc::Palette* palette) const;
+
+  private:
+    std::string cacheFilename(const std::string& filename) const;
+
+    std::string m_dir;
+  };
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,9 +15,16 @@
 #include "app/cmd/convert_color_profile.h"
 #include "app/doc.h"
 #include "app/file/file.h"
+#include "app/file/file_format.h"
+#include "app/file/file_formats_manager.h"
 #include "app/file_system.h"
+#include "app/pref/preferences.h"
+#include "app/task_scheduler.h"
+#include "app/thumbnail_cache.h"
 #include "app/util/conversion_to_surface.h"
+#include "base/fs.h"
 #include "base/thread.h"
+#include "dio/detect_format.h"
 #include "doc/algorithm/rotate.h"
 #include "doc/image.h"
 #include "doc/palette.h"
@@ -30,21 +37,95 @@
 
 #include <algorithm>
 #include <atomic>
+#include <future>
 #include <memory>
-#include <thread>
 
 #define MAX_THUMBNAIL_SIZE   128
 #define THUMB_TRACE(...)
 
 namespace app {
 
+// Renders the first frame of the sprite in a small image
+// (thumbnailImage) with its palette.
+static void render_thumbnail(const Sprite* sprite,
+                             const bool convertToSRGB,
+                             std::unique_ptr<Image>& thumbnailImage,
+                             std::unique_ptr<Palette>& palette)
+{
+  // The palette to convert the Image
+  palette.reset(new Palette(*sprite->palette(frame_t(0))));
+
+  // Special case for indexed images:
+  // If the sprite is transparent -> set the transparent color index alpha = 0
+  if (sprite->colorMode() == ColorMode::INDEXED &&
+      !sprite->backgroundLayer()) {
+    int i = sprite->transparentColor();
+    if (i >= 0 && i < int(palette->size()))
+      palette->setEntry(i, doc::rgba(0, 0, 0, 0));
+  }
+
+  const int w = sprite->width()*sprite->pixelRatio().w;
+  const int h = sprite->height()*sprite->pixelRatio().h;
+
+  // Calculate the thumbnail size
+  int thumb_w = MAX_THUMBNAIL_SIZE * w / std::max(w, h);
+  int thumb_h = MAX_THUMBNAIL_SIZE * h / std::max(w, h);
+  if (std::max(thumb_w, thumb_h) > std::max(w, h)) {
+    thumb_w = w;
+    thumb_h = h;
+  }
+  thumb_w = std::clamp(thumb_w, 1, MAX_THUMBNAIL_SIZE);
+  thumb_h = std::clamp(thumb_h, 1, MAX_THUMBNAIL_SIZE);
+
+  // Stretch the 'image'
+  thumbnailImage.reset(
+    Image::create(
+      sprite->pixelFormat(), thumb_w, thumb_h));
+
+  render::Projection proj(sprite->pixelRatio(),
+                          render::Zoom(thumb_w, w));
+  render::Render render;
+  render.setBgOptions(render::BgOptions::MakeTransparent());
+  render.setProjection(proj);
+  render.renderSprite(
+    thumbnailImage.get(), sprite, frame_t(0),
+    gfx::Clip(0, 0, 0, 0, w, h));
+
+  // Convert the image to sRGB color space
+  auto cs = sprite->colorSpace();
+  if (convertToSRGB &&
+      cs && !cs->nearlyEqual(*gfx::ColorSpace::MakeSRGB())) {
+    app::cmd::convert_color_profile(
+      thumbnailImage.get(), palette.get(),
+      cs, gfx::ColorSpace::MakeSRGB());
+  }
+}
+
+static os::SurfaceRef make_thumbnail_surface(const Image* thumbnailImage,
+                                             const Palette* palette)
+{
+  os::SurfaceRef thumbnail =
+    os::instance()->makeRgbaSurface(
+      thumbnailImage->width(),
+      thumbnailImage->height());
+
+  convert_image_to_surface(
+    thumbnailImage, palette, thumbnail.get(),
+    0, 0, 0, 0, thumbnailImage->width(), thumbnailImage->height());
+
+  return thumbnail;
+}
+
 class ThumbnailGenerator::Worker {
 public:
-  Worker(base::concurrent_queue<ThumbnailGenerator::Item>& queue)
+  Worker(base::concurrent_queue<ThumbnailGenerator::Item>& queue,
+         const ThumbnailCache* cache)
     : m_queue(queue)
+    , m_cache(cache)
     , m_fop(nullptr)
     , m_isDone(false)
-    , m_thread([this]{ loadBgThread(); }) {
+    , m_future(TaskScheduler::instance().execute(
+                 TaskPriority::Background, [this]{ loadBgThread(); })) {
   }
 
   ~Worker() {
@@ -53,7 +134,7 @@ public:
       if (m_fop)
         m_fop->stop();
     }
-    m_thread.join();
+    m_future.wait();
   }
 
   void stop() const {
@@ -88,68 +169,21 @@ private:
       THUMB_TRACE("FOP loading thumbnail: %s\n",
                   m_item.fileitem->fileName().c_str());
 
-      // Load the file
-      m_fop->operate(nullptr);
-
-      // Don't call post-load because postLoad() needs user interaction.
-      //m_fop->postLoad();
-
-      // Convert the loaded document into the os::Surface.
-      const Sprite* sprite =
-        (m_fop->document() &&
-         m_fop->document()->sprite() ?
-         m_fop->document()->sprite(): nullptr);
-
       std::unique_ptr<Image> thumbnailImage;
       std::unique_ptr<Palette> palette;
-      if (!m_fop->isStop() && sprite) {
-        // The palette to convert the Image
-        palette.reset(new Palette(*sprite->palette(frame_t(0))));
-
-        // Special case for indexed images:
-        // If the sprite is transparent -> set the transparent color index alpha = 0
-        if (sprite->colorMode() == ColorMode::INDEXED &&
-            !sprite->backgroundLayer()) {
-          int i = sprite->transparentColor();
-          if (i >= 0 && i < int(palette->size()))
-            palette->setEntry(i, doc::rgba(0, 0, 0, 0));
-        }
 
-        const int w = sprite->width()*sprite->pixelRatio().w;
-        const int h = sprite->height()*sprite->pixelRatio().h;
+      // Check if we already have this thumbnail in the disk cache
+      if (m_cache && m_cache->load(m_fop->filename(), thumbnailImage, palette)) {
+        THUMB_TRACE("FOP thumbnail from cache: %s\n",
+                    m_item.fileitem->fileName().c_str());
+      }
+      else {
+        thumbnailImage.reset();
+        palette.reset();
+        loadThumbnail(thumbnailImage, palette);
 
-        // Calculate the thumbnail size
-        int thumb_w = MAX_THUMBNAIL_SIZE * w / std::max(w, h);
-        int thumb_h = MAX_THUMBNAIL_SIZE * h / std::max(w, h);
-        if (std::max(thumb_w, thumb_h) > std::max(w, h)) {
-          thumb_w = w;
-          thumb_h = h;
-        }
-        thumb_w = std::clamp(thumb_w, 1, MAX_THUMBNAIL_SIZE);
-        thumb_h = std::clamp(thumb_h, 1, MAX_THUMBNAIL_SIZE);
-
-        // Stretch the 'image'
-        thumbnailImage.reset(
-          Image::create(
-            sprite->pixelFormat(), thumb_w, thumb_h));
-
-        render::Projection proj(sprite->pixelRatio(),
-                                render::Zoom(thumb_w, w));
-        render::Render render;
-        render.setBgOptions(render::BgOptions::MakeTransparent());
-        render.setProjection(proj);
-        render.renderSprite(
-          thumbnailImage.get(), sprite, frame_t(0),
-          gfx::Clip(0, 0, 0, 0, w, h));
-
-        // Convert the image to sRGB color space
-        auto cs = sprite->colorSpace();
-        if (m_fop->preserveColorProfile() &&
-            cs && !cs->nearlyEqual(*gfx::ColorSpace::MakeSRGB())) {
-          app::cmd::convert_color_profile(
-            thumbnailImage.get(), palette.get(),
-            cs, gfx::ColorSpace::MakeSRGB());
-        }
+        if (m_cache && thumbnailImage && !m_fop->isStop() && !m_fop->hasError())
+          m_cache->save(m_fop->filename(), thumbnailImage.get(), palette.get());
       }
 
       // Close file
@@ -158,13 +192,7 @@ private:
       // Set the thumbnail of the file-item.
       if (thumbnailImage) {
         os::SurfaceRef thumbnail =
-          os::instance()->makeRgbaSurface(
-            thumbnailImage->width(),
-            thumbnailImage->height());
-
-        convert_image_to_surface(
-          thumbnailImage.get(), palette.get(), thumbnail.get(),
-          0, 0, 0, 0, thumbnailImage->width(), thumbnailImage->height());
+          make_thumbnail_surface(thumbnailImage.get(), palette.get());
 
         {
           const std::lock_guard lock(m_mutex);
@@ -205,9 +233,29 @@ private:
     ASSERT(!m_fop);
   }
 
-  void loadBgThread() {
-    base::this_thread::set_name("thumbnails");
+  // Loads the first frame of the file and renders it in a small
+  // image (thumbnailImage) with its palette.
+  void loadThumbnail(std::unique_ptr<Image>& thumbnailImage,
+                     std::unique_ptr<Palette>& palette) {
+    // Load the file
+    m_fop->operate(nullptr);
+
+    // Don't call post-load because postLoad() needs user interaction.
+    //m_fop->postLoad();
+
+    // Convert the loaded document into the os::Surface.
+    const Sprite* sprite =
+      (m_fop->document() &&
+       m_fop->document()->sprite() ?
+       m_fop->document()->sprite(): nullptr);
+
+    if (!m_fop->isStop() && sprite) {
+      render_thumbnail(sprite, m_fop->preserveColorProfile(),
+                       thumbnailImage, palette);
+    }
+  }
 
+  void loadBgThread() {
     while (!m_queue.empty()) {
       bool success = true;
       while (success) {
@@ -224,11 +272,12 @@ private:
   }
 
   base::concurrent_queue<Item>& m_queue;
+  const ThumbnailCache* m_cache;
   app::ThumbnailGenerator::Item m_item;
   FileOp* m_fop;
   mutable std::mutex m_mutex;
   std::atomic<bool> m_isDone;
-  std::thread m_thread;
+  std::future<void> m_future;
 };
 
 ThumbnailGenerator* ThumbnailGenerator::instance()
@@ -246,9 +295,17 @@ ThumbnailGenerator* ThumbnailGenerator::instance()
 
 ThumbnailGenerator::ThumbnailGenerator()
 {
-  int n = std::thread::hardware_concurrency()-1;
-  if (n < 1) n = 1;
-  m_maxWorkers = n;
+  // More workers would wait in the TaskScheduler queue
+  m_maxWorkers = TaskScheduler::instance().maxRunning(TaskPriority::Background);
+
+  if (Preferences::instance().fileSelector.thumbnailsCache())
+    m_cache = std::make_shared<ThumbnailCache>();
+}
+
+ThumbnailGenerator::~ThumbnailGenerator()
+{
+  // Workers must be destroyed before the cache
+  m_workers.clear();
 }
 
 bool ThumbnailGenerator::checkWorkers()
@@ -318,12 +375,42 @@ void ThumbnailGenerator::generateThumbnail(IFileItem* fileitem)
     return;
   }
 
+  // The document is used only to render the thumbnail
+  fop->setPreviewSize(MAX_THUMBNAIL_SIZE);
+
   m_remainingItems.push(Item(fileitem, fop.get()));
   fop.release();
 
   startWorker();
 }
 
+void ThumbnailGenerator::generateThumbnails(const std::vector<IFileItem*>& fileitems)
+{
+  // Probe the files that weren't queued yet (the detected formats
+  // are cached, so FileOp::createLoadDocumentOperation() doesn't read
+  // the files again)
+  std::vector<IFileItem*> newItems;
+  std::vector<std::string> filenames;
+  for (IFileItem* fileitem : fileitems) {
+    if (fileitem->needThumbnail() &&
+        fileitem->getThumbnailProgress() == 0.0) {
+      newItems.push_back(fileitem);
+      filenames.push_back(fileitem->fileName());
+    }
+  }
+
+  const std::vector<dio::FileFormat> formats = dio::detect_formats(filenames);
+  auto* formatsManager = FileFormatsManager::instance();
+  for (std::size_t i=0; i<newItems.size(); ++i) {
+    const FileFormat* format = formatsManager->getFileFormat(formats[i]);
+    if (!format || !format->support(FILE_SUPPORT_LOAD))
+      newItems[i]->setThumbnail(nullptr);
+  }
+
+  for (IFileItem* fileitem : fileitems)
+    generateThumbnail(fileitem);
+}
+
 void ThumbnailGenerator::stopAllWorkers()
 {
   Item item;
@@ -344,11 +431,55 @@ void ThumbnailGenerator::stopAllWorkers()
     worker->stop();
 }
 
+void ThumbnailGenerator::cacheThumbnail(const Doc* doc,
+                                        const std::string& filename)
+{
+  if (!m_cache || !doc || !doc->sprite() || !base::is_file(filename))
+    return;
+
+  // Rendering the thumbnail is fast (it's a small image), but
+  // writing it in the cache is done in background.
+  auto thumbnailImage = std::make_shared<std::unique_ptr<Image>>();
+  auto palette = std::make_shared<std::unique_ptr<Palette>>();
+  render_thumbnail(doc->sprite(),
+                   Preferences::instance().color.manage(),
+                   *thumbnailImage, *palette);
+
+  TaskScheduler::instance().execute(
+    TaskPriority::Background,
+    [cache = m_cache, filename, thumbnailImage, palette]{
+      cache->save(filename, thumbnailImage->get(), palette->get());
+    });
+}
+
+void ThumbnailGenerator::loadCachedThumbnail(
+  const std::string& filename,
+  std::function<void(const os::SurfaceRef&)>&& onReady)
+{
+  if (!m_cache)
+    return;
+
+  TaskScheduler::instance().execute(
+    TaskPriority::Background,
+    [cache = m_cache, filename, onReady = std::move(onReady)]{
+      std::unique_ptr<Image> thumbnailImage;
+      std::unique_ptr<Palette> palette;
+      if (!cache->load(filename, thumbnailImage, palette))
+        return;
+
+      os::SurfaceRef thumbnail =
+        make_thumbnail_surface(thumbnailImage.get(), palette.get());
+
+      ui::execute_from_ui_thread(
+        [thumbnail, onReady]{ onReady(thumbnail); });
+    });
+}
+
 void ThumbnailGenerator::startWorker()
 {
   const std::lock_guard lock(m_workersAccess);
   if (m_workers.size() < m_maxWorkers) {
-    m_workers.push_back(std::make_unique<Worker>(m_remainingItems));
+    m_workers.push_back(std::make_unique<Worker>(m_remainingItems, m_cache.get()));
   }
 }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,9 +10,12 @@
 #pragma once
 
 #include "base/concurrent_queue.h"
+#include "os/surface.h"
 
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <string>
 #include <vector>
 
 namespace base {
@@ -20,18 +23,26 @@ namespace base {
 }
 
 namespace app {
+  class Doc;
   class FileOp;
   class IFileItem;
+  class ThumbnailCache;
 
   class ThumbnailGenerator {
     ThumbnailGenerator();
   public:
+    ~ThumbnailGenerator();
     static ThumbnailGenerator* instance();
 
     // Generate a thumbnail for the given file-item.  It must be called
     // from the GUI thread.
     void generateThumbnail(IFileItem* fileitem);
 
+    // Same as generateThumbnail() for several file-items, the format
+    // of all files is detected at once (items with an unsupported
+    // format get a nullptr thumbnail without creating a FileOp).
+    void generateThumbnails(const std::vector<IFileItem*>& fileitems);
+
     // Checks the status of workers. If there are workers that already
     // done its job, we've to destroy them. This function must be called
     // from the GUI thread (because a thread is joint to it).
@@ -43,6 +54,18 @@ namespace app {
     // thread.
     void stopAllWorkers();
 
+    // Renders a thumbnail of the given document (e.g. just after
+    // saving it in "filename") and saves it in the thumbnails cache
+    // in background, so the recent files list can show it without
+    // decoding the file again.
+    void cacheThumbnail(const Doc* doc, const std::string& filename);
+
+    // Loads the thumbnail of the given file from the thumbnails cache
+    // in background. "onReady" is called from the UI thread only if
+    // there is a valid thumbnail in the cache.
+    void loadCachedThumbnail(const std::string& filename,
+                             std::function<void(const os::SurfaceRef&)>&& onReady);
+
   private:
     void startWorker();
 
@@ -64,6 +87,9 @@ namespace app {
     WorkerList m_workers;
     std::mutex m_workersAccess;
     base::concurrent_queue<Item> m_remainingItems;
+    // Shared with background tasks that can be running after the
+    // generator is destroyed.
+    std::shared_ptr<ThumbnailCache> m_cache;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 // Copyright (C) 2016  Carlo Caputo
 //
@@ -10,20 +10,36 @@
 #include "config.h"
 #endif
 
+#include "app/thumbnails.h"
+
+#include "app/doc.h"
+#include "app/doc_access.h"
 #include "app/util/conversion_to_surface.h"
+#include "base/thread_pool.h"
 #include "doc/blend_mode.h"
 #include "doc/cel.h"
 #include "doc/layer.h"
+#include "doc/layer_tilemap.h"
+#include "doc/palette.h"
 #include "doc/sprite.h"
+#include "doc/tileset.h"
 #include "os/surface.h"
 #include "os/system.h"
 #include "render/render.h"
+#include "ui/system.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 namespace app {
 namespace thumb {
 
-os::SurfaceRef get_cel_thumbnail(const doc::Cel* cel,
-                                 const gfx::Size& fitInSize)
+static doc::ImageRef render_cel_thumbnail(const doc::Cel* cel,
+                                          const gfx::Size& fitInSize)
 {
   gfx::Size newSize;
 
@@ -58,11 +74,17 @@ os::SurfaceRef get_cel_thumbnail(const doc::Cel* cel,
     gfx::Clip(gfx::Rect(gfx::Point(0, 0), newSize)),
     255, doc::BlendMode::NORMAL);
 
+  return thumbnailImage;
+}
+
+static os::SurfaceRef convert_thumbnail_to_surface(const doc::Image* thumbnailImage)
+{
   if (os::SurfaceRef thumbnail = os::instance()->makeRgbaSurface(
         thumbnailImage->width(),
         thumbnailImage->height())) {
+    // The thumbnail is an RGB image, so we don't need the palette
     convert_image_to_surface(
-      thumbnailImage.get(), palette, thumbnail.get(),
+      thumbnailImage, nullptr, thumbnail.get(),
       0, 0, 0, 0, thumbnailImage->width(), thumbnailImage->height());
     return thumbnail;
   }
@@ -70,5 +92,208 @@ os::SurfaceRef get_cel_thumbnail(const doc::Cel* cel,
     return nullptr;
 }
 
+os::SurfaceRef get_cel_thumbnail(const doc::Cel* cel,
+                                 const gfx::Size& fitInSize)
+{
+  if (doc::ImageRef thumbnailImage = render_cel_thumbnail(cel, fitInSize))
+    return convert_thumbnail_to_surface(thumbnailImage.get());
+  else
+    return nullptr;
+}
+
+//////////////////////////////////////////////////////////////////////
+// CelThumbnails
+
+// Maximum number of thumbnails in the cache of each CelThumbnails,
+// when this limit is reached the least recently used half is removed.
+static const int kMaxCachedThumbnails = 2048;
+
+static base::thread_pool& thumbnails_thread_pool()
+{
+  static base::thread_pool pool(
+    std::clamp(int(std::thread::hardware_concurrency())-1, 1, 4));
+  return pool;
+}
+
+namespace {
+
+// Everything that changes the rendered thumbnail of a cel.
+struct Stamp {
+  doc::ObjectId imageId = doc::NullId;
+  doc::ObjectVersion imageVersion = 0;
+  doc::ObjectVersion paletteVersion = 0;
+  doc::ObjectVersion tilesetVersion = 0;
+  gfx::Size celSize;
+
+  Stamp() { }
+  explicit Stamp(const doc::Cel* cel)
+    : imageId(cel->image()->id())
+    , imageVersion(cel->image()->version())
+    , paletteVersion(cel->sprite()->palette(cel->frame())->version())
+    , celSize(cel->bounds().size()) {
+    if (cel->layer()->isTilemap()) {
+      if (auto tileset = static_cast<const doc::LayerTilemap*>(cel->layer())->tileset())
+        tilesetVersion = tileset->version();
+    }
+  }
+
+  bool operator==(const Stamp& o) const {
+    return (imageId == o.imageId &&
+            imageVersion == o.imageVersion &&
+            paletteVersion == o.paletteVersion &&
+            tilesetVersion == o.tilesetVersion &&
+            celSize == o.celSize);
+  }
+  bool operator!=(const Stamp& o) const { return !operator==(o); }
+};
+
+struct Key {
+  doc::ObjectId celId;
+  int w, h;
+
+  bool operator<(const Key& o) const {
+    return (celId < o.celId ||
+            (celId == o.celId && (w < o.w || (w == o.w && h < o.h))));
+  }
+};
+
+struct Entry {
+  Stamp stamp;
+  os::SurfaceRef surface;
+  bool pending = false;
+  int lastUse = 0;
+};
+
+} // anonymous namespace
+
+struct CelThumbnails::State {
+  std::function<void()> onReady;
+  std::map<Key, Entry> entries;
+  int useCounter = 0;
+
+  // Incremented each time the thumbnails are cleared, so the results
+  // (and pending jobs) of a previous generation are discarded.
+  int generation = 0;
+
+  // Number of background jobs using a document.
+  std::mutex mutex;
+  std::condition_variable cv;
+  int running = 0;
+};
+
+CelThumbnails::CelThumbnails(std::function<void()>&& onReady)
+  : m_state(std::make_shared<State>())
+{
+  m_state->onReady = std::move(onReady);
+}
+
+CelThumbnails::~CelThumbnails()
+{
+  clear();
+}
+
+os::SurfaceRef CelThumbnails::get(Doc* doc,
+                                  const doc::Cel* cel,
+                                  const gfx::Size& fitInSize)
+{
+  State* state = m_state.get();
+  const Key key = { cel->id(), fitInSize.w, fitInSize.h };
+  const Stamp stamp(cel);
+
+  Entry& entry = state->entries[key];
+  entry.lastUse = ++state->useCounter;
+  if ((entry.surface && entry.stamp == stamp) || entry.pending)
+    return entry.surface;
+
+  entry.pending = true;
+
+  // Render the thumbnail in a background thread, we lock the
+  // document to read it (if it's locked by other thread, e.g. a
+  // filter is being applied, we try again in the next paint).
+  std::weak_ptr<State> weakState(m_state);
+  const int generation = state->generation;
+  thumbnails_thread_pool().execute(
+    [weakState, generation, doc, key, stamp, fitInSize]{
+      auto state = weakState.lock();
+      if (!state)
+        return;
+      {
+        const std::lock_guard lock(state->mutex);
+        if (state->generation != generation)
+          return;
+        ++state->running;
+      }
+
+      doc::ImageRef thumbnailImage;
+      try {
+        const DocReader reader(doc, 0);
+        const auto cel = doc::get<doc::Cel>(key.celId);
+        if (cel && cel->sprite() == doc->sprite() &&
+            Stamp(cel) == stamp) {
+          thumbnailImage = render_cel_thumbnail(cel, fitInSize);
+        }
+      }
+      catch (const LockedDocException&) {
+        // Do nothing
+      }
+
+      {
+        const std::lock_guard lock(state->mutex);
+        --state->running;
+        state->cv.notify_all();
+      }
+
+      ui::execute_from_ui_thread(
+        [weakState, generation, key, stamp, thumbnailImage]{
+          auto state = weakState.lock();
+          if (!state || state->generation != generation)
+            return;
+
+          auto it = state->entries.find(key);
+          if (it == state->entries.end())
+            return;
+
+          Entry& entry = it->second;
+          entry.pending = false;
+          if (thumbnailImage) {
+            entry.stamp = stamp;
+            entry.surface = convert_thumbnail_to_surface(thumbnailImage.get());
+          }
+          if (state->onReady)
+            state->onReady();
+        });
+    });
+
+  os::SurfaceRef surface = entry.surface;
+
+  // Remove the least recently used half of the thumbnails
+  if (int(state->entries.size()) > kMaxCachedThumbnails) {
+    std::vector<int> uses;
+    uses.reserve(state->entries.size());
+    for (const auto& kv : state->entries)
+      uses.push_back(kv.second.lastUse);
+    auto mid = uses.begin() + uses.size()/2;
+    std::nth_element(uses.begin(), mid, uses.end());
+    const int minUse = *mid;
+    for (auto it=state->entries.begin(); it!=state->entries.end(); ) {
+      if (it->second.lastUse < minUse)
+        it = state->entries.erase(it);
+      else
+        ++it;
+    }
+  }
+
+  return surface;
+}
+
+void CelThumbnails::clear()
+{
+  State* state = m_state.get();
+  std::unique_lock lock(state->mutex);
+  ++state->generation;
+  state->entries.clear();
+  state->cv.wait(lock, [state]{ return state->running == 0; });
+}
+
 } // thumb
 } // app
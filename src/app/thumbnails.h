@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2020  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2016  Carlo Caputo
 //
 // This program is distributed under the terms of
@@ -12,6 +12,9 @@
 #include "gfx/size.h"
 #include "os/surface.h"
 
+#include <functional>
+#include <memory>
+
 namespace doc {
   class Cel;
 }
@@ -21,11 +24,41 @@ namespace os {
 }
 
 namespace app {
+  class Doc;
+
 namespace thumb {
 
   os::SurfaceRef get_cel_thumbnail(const doc::Cel* cel,
                                    const gfx::Size& fitInSize);
 
+  // Cache of cel thumbnails generated in background threads, so the
+  // timeline doesn't need to render each visible cel in each paint.
+  // It must be used from the UI thread.
+  class CelThumbnails {
+  public:
+    // "onReady" is called from the UI thread each time a new
+    // thumbnail is available.
+    CelThumbnails(std::function<void()>&& onReady);
+    ~CelThumbnails();
+
+    // Returns the thumbnail for the given cel. If the cel was
+    // modified (or it's the first time we ask for its thumbnail), a
+    // new one is generated in a background thread, and meanwhile we
+    // return the previous thumbnail (or nullptr if there is no
+    // previous thumbnail).
+    os::SurfaceRef get(Doc* doc,
+                       const doc::Cel* cel,
+                       const gfx::Size& fitInSize);
+
+    // Removes all thumbnails, cancels the pending ones, and waits the
+    // background threads that are using the document of the cels.
+    void clear();
+
+  private:
+    struct State;
+    std::shared_ptr<State> m_state;
+  };
+
 } // thumb
 } // app
 
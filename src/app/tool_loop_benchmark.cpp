@@ -0,0 +1,400 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+// Replays strokes through the ToolLoopManager (without UI) to measure
+// the latency of each pointer event with different tools, inks,
+// brush sizes, symmetry, and tilemap modes.
+//
+// Recorded strokes can be replayed with --stroke=<file> (it can be
+// used several times). Each line of a stroke file is an event with
+// the time in milliseconds, the position in the canvas, and the
+// pressure from 0.0 to 1.0:
+//
+//   # time x y pressure
+//   0 10 10 0.2
+//   4.1 12 11 0.35
+//   ...
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/app.h"
+#include "app/cli/app_options.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/doc_undo.h"
+#include "app/pref/preferences.h"
+#include "app/site.h"
+#include "app/tools/active_tool.h"
+#include "app/tools/tool_box.h"
+#include "app/tools/tool_loop_manager.h"
+#include "app/ui/editor/tool_loop_impl.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/pi.h"
+#include "doc/brush.h"
+#include "doc/cel.h"
+#include "doc/grid.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/layer_tilemap.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "doc/tile.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+#include "fmt/format.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace app;
+using namespace doc;
+
+namespace {
+
+const int kCanvasSize = 512;
+const int kTileSize = 16;
+
+struct StrokeEvent {
+  double time;                  // Milliseconds since the first event
+  gfx::Point pos;
+  float pressure;
+};
+
+struct Stroke {
+  std::string name;
+  std::vector<StrokeEvent> events;
+};
+
+enum class LayerKind { Image, TilemapManual, TilemapAuto };
+
+struct ToolLoopCase {
+  const Stroke* stroke;
+  const char* toolId;
+  tools::InkType inkType;
+  int brushSize;
+  gen::SymmetryMode symmetry;
+  LayerKind layerKind;
+};
+
+std::vector<Stroke> g_strokes;
+
+// A fast zig-zag stroke (sampled at 240Hz) that crosses the whole
+// canvas several times.
+Stroke make_zigzag_stroke()
+{
+  Stroke stroke;
+  stroke.name = "zigzag";
+  const int n = 2000;
+  for (int i=0; i<n; ++i) {
+    const double t = double(i) / n;
+    const double phase = std::fmod(t * 16.0, 2.0);
+    const int x = int((phase < 1.0 ? phase: 2.0-phase) * (kCanvasSize-1));
+    const int y = int(t * (kCanvasSize-1));
+    stroke.events.push_back(
+      StrokeEvent{ i * 1000.0 / 240.0, gfx::Point(x, y), 0.5f });
+  }
+  return stroke;
+}
+
+// A slow spiral from the center with increasing pressure (sampled at
+// 120Hz, with several events in the same pixel).
+Stroke make_spiral_stroke()
+{
+  Stroke stroke;
+  stroke.name = "spiral";
+  const int n = 2000;
+  const double c = kCanvasSize / 2.0;
+  for (int i=0; i<n; ++i) {
+    const double t = double(i) / n;
+    const double a = t * 6.0 * 2.0 * PI;
+    const double r = t * (c - 8.0);
+    stroke.events.push_back(
+      StrokeEvent{ i * 1000.0 / 120.0,
+                   gfx::Point(int(c + r*std::cos(a)), int(c + r*std::sin(a))),
+                   float(0.1 + 0.9*t) });
+  }
+  return stroke;
+}
+
+bool load_stroke(const std::string& filename, Stroke& stroke)
+{
+  std::ifstream f(FSTREAM_PATH(filename));
+  if (!f)
+    return false;
+
+  stroke.name = base::get_file_title(filename);
+  std::string line;
+  while (std::getline(f, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+
+    std::istringstream s(line);
+    StrokeEvent ev;
+    if (s >> ev.time >> ev.pos.x >> ev.pos.y >> ev.pressure)
+      stroke.events.push_back(ev);
+  }
+  return !stroke.events.empty();
+}
+
+Doc* create_doc(Context* ctx, const LayerKind layerKind)
+{
+  const ImageSpec spec(ColorMode::RGB, kCanvasSize, kCanvasSize);
+  Sprite* sprite;
+
+  if (layerKind == LayerKind::Image) {
+    sprite = Sprite::MakeStdSprite(spec);
+  }
+  else {
+    sprite = new Sprite(spec);
+    // One empty tile and one tile used in the whole tilemap (so the
+    // manual tileset mode modifies the same tile)
+    auto tileset = new Tileset(sprite, Grid(gfx::Size(kTileSize, kTileSize)), 2);
+    const tileset_index tsi = sprite->tilesets()->add(tileset);
+
+    auto layer = new LayerTilemap(sprite, tsi);
+    sprite->root()->addLayer(layer);
+
+    const int cols = kCanvasSize / kTileSize;
+    ImageRef map(Image::create(IMAGE_TILEMAP, cols, cols));
+    clear_image(map.get(), tile(1, 0));
+    layer->addCel(new Cel(0, map));
+  }
+
+  Doc* doc = new Doc(sprite);
+  doc->setContext(ctx);
+  return doc;
+}
+
+// Converts the stroke events to pointers (the velocity is calculated
+// from the timing of the recorded events)
+std::vector<tools::Pointer> make_pointers(const Stroke& stroke)
+{
+  std::vector<tools::Pointer> pointers;
+  pointers.reserve(stroke.events.size());
+  const StrokeEvent* prev = nullptr;
+  for (const StrokeEvent& ev : stroke.events) {
+    tools::Vec2 velocity(0.0f, 0.0f);
+    if (prev && ev.time > prev->time) {
+      const float dt = float(ev.time - prev->time);
+      velocity.x = (ev.pos.x - prev->pos.x) / dt;
+      velocity.y = (ev.pos.y - prev->pos.y) / dt;
+    }
+    pointers.push_back(
+      tools::Pointer(ev.pos, velocity,
+                     tools::Pointer::Button::Left,
+                     tools::Pointer::Type::Pen,
+                     ev.pressure));
+    prev = &ev;
+  }
+  return pointers;
+}
+
+double percentile(std::vector<double>& values, const double p)
+{
+  if (values.empty())
+    return 0.0;
+  const std::size_t i =
+    std::min(values.size()-1, std::size_t(p * values.size()));
+  std::nth_element(values.begin(), values.begin()+i, values.end());
+  return values[i];
+}
+
+// ToolLoops without UI are created with create_tool_loop_for_script()
+#ifdef ENABLE_SCRIPTING
+
+void BM_ToolLoop(benchmark::State& state, const ToolLoopCase tc)
+{
+  App* app = App::instance();
+  Context* ctx = app->context();
+  std::unique_ptr<Doc> doc(create_doc(ctx, tc.layerKind));
+  Sprite* sprite = doc->sprite();
+
+  auto& pref = Preferences::instance();
+  auto& docPref = pref.document(doc.get());
+  pref.symmetryMode.enabled(tc.symmetry != gen::SymmetryMode::NONE);
+  docPref.symmetry.mode(tc.symmetry);
+  docPref.symmetry.xAxis(kCanvasSize / 2.0);
+  docPref.symmetry.yAxis(kCanvasSize / 2.0);
+
+  Site site;
+  site.document(doc.get());
+  site.sprite(sprite);
+  site.layer(sprite->root()->firstLayer());
+  site.frame(0);
+  site.tilemapMode(TilemapMode::Pixels);
+  site.tilesetMode(tc.layerKind == LayerKind::TilemapAuto ? TilesetMode::Auto:
+                                                            TilesetMode::Manual);
+
+  ToolLoopParams params;
+  params.tool = app->toolBox()->getToolById(tc.toolId);
+  params.ink = params.tool->getInk(0);
+  params.controller = params.tool->getController(0);
+  params.inkType = tc.inkType;
+  params.fg = app::Color::fromRgb(255, 0, 0, 128);
+  params.bg = app::Color::fromRgb(0, 0, 255, 255);
+  params.ink = app->activeToolManager()->adjustToolInkDependingOnSelectedInkType(
+    params.ink, params.inkType, params.fg);
+  params.brush = std::make_shared<Brush>(BrushType::kCircleBrushType, tc.brushSize, 0);
+
+  const std::vector<tools::Pointer> pointers = make_pointers(*tc.stroke);
+  std::vector<double> latencies; // In microseconds
+  latencies.reserve(pointers.size() * 16);
+
+  using clock = std::chrono::steady_clock;
+  auto measure = [&latencies](auto&& fn){
+    const auto t0 = clock::now();
+    fn();
+    latencies.push_back(
+      std::chrono::duration<double, std::micro>(clock::now() - t0).count());
+  };
+
+  for (auto _ : state) {
+    std::unique_ptr<tools::ToolLoop> loop(
+      create_tool_loop_for_script(ctx, site, params));
+    if (!loop) {
+      state.SkipWithError("Cannot create the tool loop");
+      break;
+    }
+
+    {
+      tools::ToolLoopManager manager(loop.get());
+      manager.prepareLoop(pointers.front());
+      measure([&]{ manager.pressButton(pointers.front()); });
+      for (std::size_t i=1; i<pointers.size(); ++i)
+        measure([&]{ manager.movement(pointers[i]); });
+      measure([&]{ manager.releaseButton(pointers.back()); });
+      manager.end();
+    }
+    loop.reset();
+
+    // Restore the original pixels for the next iteration
+    state.PauseTiming();
+    if (doc->undoHistory()->canUndo())
+      doc->undoHistory()->undo();
+    state.ResumeTiming();
+  }
+
+  state.SetItemsProcessed(state.iterations() * pointers.size());
+  state.counters["p50_us"] = percentile(latencies, 0.50);
+  state.counters["p90_us"] = percentile(latencies, 0.90);
+  state.counters["p99_us"] = percentile(latencies, 0.99);
+  state.counters["max_us"] =
+    (latencies.empty() ? 0.0: *std::max_element(latencies.begin(), latencies.end()));
+
+  pref.symmetryMode.enabled(false);
+  doc->close();
+}
+
+void register_benchmarks()
+{
+  struct ToolInk {
+    const char* id;
+    tools::InkType inkType;
+    const char* inkName;
+  };
+  const ToolInk toolInks[] = {
+    { "pencil", tools::InkType::SIMPLE, "simple" },
+    { "pencil", tools::InkType::ALPHA_COMPOSITING, "alpha" },
+    { "pencil", tools::InkType::LOCK_ALPHA, "lock_alpha" },
+    { "pencil", tools::InkType::SHADING, "shading" },
+    { "eraser", tools::InkType::SIMPLE, "simple" },
+    { "spray", tools::InkType::ALPHA_COMPOSITING, "alpha" },
+    { "blur", tools::InkType::SIMPLE, "simple" },
+  };
+  const int brushSizes[] = { 1, 8, 32, 64 };
+
+  struct LayerParams {
+    LayerKind kind;
+    const char* name;
+  };
+  const LayerParams layers[] = {
+    { LayerKind::Image, "image" },
+    { LayerKind::TilemapManual, "tilemap_manual" },
+    { LayerKind::TilemapAuto, "tilemap_auto" },
+  };
+
+  for (const Stroke& stroke : g_strokes) {
+    for (const ToolInk& tool : toolInks) {
+      for (const int brushSize : brushSizes) {
+        for (const bool symmetry : { false, true }) {
+          for (const LayerParams& layer : layers) {
+            const ToolLoopCase tc = {
+              &stroke, tool.id, tool.inkType, brushSize,
+              (symmetry ? gen::SymmetryMode::BOTH: gen::SymmetryMode::NONE),
+              layer.kind
+            };
+            const std::string name =
+              fmt::format("BM_ToolLoop/{}/{}/{}/brush:{}/symmetry:{}/{}",
+                          stroke.name, tool.id, tool.inkName, brushSize,
+                          int(symmetry), layer.name);
+
+            benchmark::RegisterBenchmark(
+              name.c_str(),
+              [tc](benchmark::State& state){ BM_ToolLoop(state, tc); })
+              ->Unit(benchmark::kMillisecond);
+          }
+        }
+      }
+    }
+  }
+}
+
+#endif // ENABLE_SCRIPTING
+
+} // anonymous namespace
+
+int app_main(int argc, char* argv[])
+{
+  // Load recorded strokes (--stroke=<file> arguments are removed
+  // before the benchmark library parses the arguments)
+  const char* kStrokeArg = "--stroke=";
+  int argc2 = 1;
+  for (int i=1; i<argc; ++i) {
+    if (std::strncmp(argv[i], kStrokeArg, std::strlen(kStrokeArg)) == 0) {
+      Stroke stroke;
+      const std::string filename = argv[i] + std::strlen(kStrokeArg);
+      if (load_stroke(filename, stroke))
+        g_strokes.push_back(std::move(stroke));
+      else
+        std::fprintf(stderr, "Error loading stroke from '%s'\n", filename.c_str());
+    }
+    else
+      argv[argc2++] = argv[i];
+  }
+  argc = argc2;
+
+  if (g_strokes.empty()) {
+    g_strokes.push_back(make_zigzag_stroke());
+    g_strokes.push_back(make_spiral_stroke());
+  }
+
+  App app;
+  const char* argv2[] = { argv[0], "--batch" };
+  app.initialize(AppOptions(2, { argv2 }));
+
+#ifdef ENABLE_SCRIPTING
+  register_benchmarks();
+#endif
+
+  ::benchmark::Initialize(&argc, argv);
+  const int status = ::benchmark::RunSpecifiedBenchmarks();
+
+  app.close();
+  return status;
+}
@@ -0,0 +1,76 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/tools/brush_stamp_cache.h"
+
+#include "base/debug.h"
+
+namespace app {
+namespace tools {
+
+// static
+BrushStampCache* BrushStampCache::instance()
+{
+  static BrushStampCache cache;
+  return &cache;
+}
+
+BrushStampCache::BrushStampCache()
+{
+}
+
+BrushStampRef BrushStampCache::get(const doc::BrushType type,
+                                   const int size,
+                                   const int angle)
+{
+  // The angle of circles doesn't change the brush
+  const Key key = makeKey(type, size,
+                          (type == doc::kCircleBrushType ? 0: angle));
+
+  auto it = m_map.find(key);
+  if (it != m_map.end()) {
+    // Move the entry to the beginning of the list
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    return it->second->stamp;
+  }
+
+  auto stamp = std::make_shared<BrushStamp>();
+  stamp->brush = std::make_shared<doc::Brush>(type, size, angle);
+
+  m_entries.push_front(Entry{ key, stamp });
+  m_map[key] = m_entries.begin();
+
+  while (m_entries.size() > kMaxStamps) {
+    m_map.erase(m_entries.back().key);
+    m_entries.pop_back();
+  }
+  return stamp;
+}
+
+void BrushStampCache::clear()
+{
+  m_map.clear();
+  m_entries.clear();
+}
+
+// static
+BrushStampCache::Key BrushStampCache::makeKey(const doc::BrushType type,
+                                              const int size,
+                                              const int angle)
+{
+  ASSERT(size >= 0 && size < 256);
+  ASSERT(angle >= -180 && angle <= 180);
+  return ((Key(type) & 0xff) << 24) |
+         ((Key(size) & 0xff) << 16) |
+         (Key(angle + 180) & 0xffff);
+}
+
+} // namespace tools
+} // namespace app
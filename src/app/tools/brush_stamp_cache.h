@@ -0,0 +1,77 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_TOOLS_BRUSH_STAMP_CACHE_H_INCLUDED
+#define APP_TOOLS_BRUSH_STAMP_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/brush.h"
+#include "doc/compressed_image.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+
+namespace app {
+namespace tools {
+
+  // A brush generated for a specific size/angle and its scanlines
+  // (one CompressedImage for each gen::SymmetryMode, created lazily
+  // by BrushPointShape).
+  struct BrushStamp {
+    doc::BrushRef brush;
+    std::array<std::shared_ptr<doc::CompressedImage>, 4> compressedImages;
+  };
+  using BrushStampRef = std::shared_ptr<BrushStamp>;
+
+  // LRU cache of brushes created by strokes with dynamics (where the
+  // size/angle of the brush changes for each point of the stroke), so
+  // the same brush is not rasterized again in the same stroke or in
+  // the following strokes. It's used only from the UI thread.
+  class BrushStampCache {
+  public:
+    static constexpr std::size_t kMaxStamps = 256;
+
+    static BrushStampCache* instance();
+
+    BrushStampCache();
+
+    // Returns the brush of the given type, size and angle, creating
+    // it if it's not in the cache.
+    BrushStampRef get(const doc::BrushType type,
+                      const int size,
+                      const int angle);
+
+    std::size_t size() const { return m_entries.size(); }
+    void clear();
+
+  private:
+    using Key = uint32_t;
+    struct Entry {
+      Key key;
+      BrushStampRef stamp;
+    };
+    using Entries = std::list<Entry>;
+
+    static Key makeKey(const doc::BrushType type,
+                       const int size,
+                       const int angle);
+
+    // Most recently used entries at the beginning of the list
+    Entries m_entries;
+    std::unordered_map<Key, Entries::iterator> m_map;
+
+    DISABLE_COPYING(BrushStampCache);
+  };
+
+} // namespace tools
+} // namespace app
+
+#endif
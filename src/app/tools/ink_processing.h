@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -10,6 +10,7 @@
 #include "app/util/wrap_value.h"
 #include "doc/blend_funcs.h"
 #include "doc/blend_internals.h"
+#include "doc/blend_span.h"
 #include "doc/image_impl.h"
 #include "doc/layer.h"
 #include "doc/palette.h"
@@ -22,6 +23,9 @@
 #include "render/dithering.h"
 #include "render/gradient.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 namespace tools {
 
@@ -93,6 +97,32 @@ public:
   }
 };
 
+// Blends a solid color in the [x1,x2] range of the "y" row of the
+// destination image using the source image as backdrop. The whole
+// scanline is processed at once with a span blender (which handles
+// several pixels at the same time).
+template<typename ImageTraits, typename SpanFunc>
+void blend_color_scanline(ToolLoop* loop, int x1, int y, int x2,
+                          const color_t color,
+                          const int opacity,
+                          std::vector<typename ImageTraits::pixel_t>& colorScanline,
+                          SpanFunc spanFunc)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  const int n = x2 - x1 + 1;
+  auto src = (const pixel_t*)loop->getSrcImage()->getPixelAddress(x1, y);
+  auto dst = (pixel_t*)loop->getDstImage()->getPixelAddress(x1, y);
+  if (src != dst)
+    std::copy(src, src+n, dst);
+
+  if (int(colorScanline.size()) < n)
+    colorScanline.resize(n);
+  std::fill(colorScanline.begin(), colorScanline.begin()+n, pixel_t(color));
+
+  spanFunc(dst, colorScanline.data(), n, opacity);
+}
+
 template<typename Derived, typename ImageTraits>
 class SimpleInkProcessing : public InkProcessing<Derived> {
 public:
@@ -133,9 +163,23 @@ protected:
 template<typename ImageTraits>
 class CopyInkProcessing : public SimpleInkProcessing<CopyInkProcessing<ImageTraits>, ImageTraits> {
 public:
+  typedef SimpleInkProcessing<CopyInkProcessing<ImageTraits>, ImageTraits> base;
+
   CopyInkProcessing(ToolLoop* loop) {
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    if (loop->useMask() || x2 < x1) {
+      base::processScanline(x1, y, x2, loop);
+      return;
+    }
+
+    // Fill the whole scanline at once
+    using pixel_t = typename ImageTraits::pixel_t;
+    auto dst = (pixel_t*)loop->getDstImage()->getPixelAddress(x1, y);
+    std::fill(dst, dst+x2-x1+1, pixel_t(m_color));
+  }
+
   void prepareForPointShape(ToolLoop* loop, bool firstPoint, int x, int y) override {
     m_color = loop->getPrimaryColor();
 
@@ -162,10 +206,16 @@ private:
 template<typename ImageTraits>
 class LockAlphaInkProcessing : public DoubleInkProcessing<LockAlphaInkProcessing<ImageTraits>, ImageTraits> {
 public:
+  typedef DoubleInkProcessing<LockAlphaInkProcessing<ImageTraits>, ImageTraits> base;
+
   LockAlphaInkProcessing(ToolLoop* loop)
     : m_opacity(loop->getOpacity()) {
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    base::processScanline(x1, y, x2, loop);
+  }
+
   void prepareForPointShape(ToolLoop* loop, bool firstPoint, int x, int y) override {
     m_color = loop->getPrimaryColor();
   }
@@ -177,8 +227,44 @@ public:
 private:
   color_t m_color;
   const int m_opacity;
+  // Scanline filled with m_color to use span blenders
+  std::vector<typename ImageTraits::pixel_t> m_colorScanline;
 };
 
+template<>
+void LockAlphaInkProcessing<RgbTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (loop->useMask() || x2 < x1) {
+    base::processScanline(x1, y, x2, loop);
+    return;
+  }
+
+  blend_color_scanline<RgbTraits>(loop, x1, y, x2, m_color, m_opacity,
+                                  m_colorScanline, rgba_blender_normal_span);
+
+  // Restore the original alpha
+  auto src = (const color_t*)loop->getSrcImage()->getPixelAddress(x1, y);
+  auto dst = (color_t*)loop->getDstImage()->getPixelAddress(x1, y);
+  for (int x=x1; x<=x2; ++x, ++src, ++dst)
+    *dst = (*dst & rgba_rgb_mask) | (*src & rgba_a_mask);
+}
+
+template<>
+void LockAlphaInkProcessing<GrayscaleTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (loop->useMask() || x2 < x1) {
+    base::processScanline(x1, y, x2, loop);
+    return;
+  }
+
+  blend_color_scanline<GrayscaleTraits>(loop, x1, y, x2, m_color, m_opacity,
+                                        m_colorScanline, graya_blender_normal_span);
+
+  // Restore the original alpha
+  auto src = (const uint16_t*)loop->getSrcImage()->getPixelAddress(x1, y);
+  auto dst = (uint16_t*)loop->getDstImage()->getPixelAddress(x1, y);
+  for (int x=x1; x<=x2; ++x, ++src, ++dst)
+    *dst = (*dst & graya_v_mask) | (*src & graya_a_mask);
+}
+
 template<>
 void LockAlphaInkProcessing<RgbTraits>::processPixel(int x, int y) {
   color_t result = rgba_blender_normal(*m_srcAddress, m_color, m_opacity);
@@ -260,9 +346,39 @@ private:
 };
 
 template<>
-void TransparentInkProcessing<RgbTraits>::processPixel(int x, int y) {
-  *m_dstAddress = rgba_blender_normal(*m_srcAddress, m_color, m_opacity);
-}
+class TransparentInkProcessing<RgbTraits> : public DoubleInkProcessing<TransparentInkProcessing<RgbTraits>, RgbTraits> {
+public:
+  typedef DoubleInkProcessing<TransparentInkProcessing<RgbTraits>, RgbTraits> base;
+
+  TransparentInkProcessing(ToolLoop* loop) {
+    m_opacity = loop->getOpacity();
+  }
+
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    if (loop->useMask() || x2 < x1) {
+      base::processScanline(x1, y, x2, loop);
+      return;
+    }
+
+    // Blend the whole scanline at once
+    blend_color_scanline<RgbTraits>(loop, x1, y, x2, m_color, m_opacity,
+                                    m_colorScanline, rgba_blender_normal_span);
+  }
+
+  void prepareForPointShape(ToolLoop* loop, bool firstPoint, int x, int y) override {
+    m_color = loop->getPrimaryColor();
+  }
+
+  void processPixel(int x, int y) {
+    *m_dstAddress = rgba_blender_normal(*m_srcAddress, m_color, m_opacity);
+  }
+
+private:
+  color_t m_color;
+  int m_opacity;
+  // Scanline filled with m_color to use span blenders
+  std::vector<RgbTraits::pixel_t> m_colorScanline;
+};
 
 template<>
 void TransparentInkProcessing<GrayscaleTraits>::processPixel(int x, int y) {
@@ -314,10 +430,16 @@ private:
 template<typename ImageTraits>
 class MergeInkProcessing : public DoubleInkProcessing<MergeInkProcessing<ImageTraits>, ImageTraits> {
 public:
+  typedef DoubleInkProcessing<MergeInkProcessing<ImageTraits>, ImageTraits> base;
+
   MergeInkProcessing(ToolLoop* loop) {
     m_opacity = loop->getOpacity();
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    base::processScanline(x1, y, x2, loop);
+  }
+
   void prepareForPointShape(ToolLoop* loop, bool firstPoint, int x, int y) override {
     m_color = loop->getPrimaryColor();
   }
@@ -329,8 +451,32 @@ public:
 private:
   color_t m_color;
   int m_opacity;
+  // Scanline filled with m_color to use span blenders
+  std::vector<typename ImageTraits::pixel_t> m_colorScanline;
 };
 
+template<>
+void MergeInkProcessing<RgbTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (loop->useMask() || x2 < x1) {
+    base::processScanline(x1, y, x2, loop);
+    return;
+  }
+
+  blend_color_scanline<RgbTraits>(loop, x1, y, x2, m_color, m_opacity,
+                                  m_colorScanline, rgba_blender_merge_span);
+}
+
+template<>
+void MergeInkProcessing<GrayscaleTraits>::processScanline(int x1, int y, int x2, ToolLoop* loop) {
+  if (loop->useMask() || x2 < x1) {
+    base::processScanline(x1, y, x2, loop);
+    return;
+  }
+
+  blend_color_scanline<GrayscaleTraits>(loop, x1, y, x2, m_color, m_opacity,
+                                        m_colorScanline, graya_blender_merge_span);
+}
+
 template<>
 void MergeInkProcessing<RgbTraits>::processPixel(int x, int y) {
   *m_dstAddress = rgba_blender_merge(*m_srcAddress, m_color, m_opacity);
@@ -380,6 +526,64 @@ private:
 // Blur Ink
 //////////////////////////////////////////////////////////////////////
 
+// Sums the 3x3 neighborhood of each pixel of the [x1,x2] range of
+// the "y" row keeping the sums of the three last columns (a sliding
+// window), so each pixel reads 3 new pixels instead of 9. It gives
+// the same results as calling get_neighboring_pixels() for each
+// pixel (edge pixels are repeated, or wrapped in tiled mode).
+//
+// The Delegate must have reset(), add(const Delegate&), and
+// operator()(pixel_t) members, and "blendPixel(area)" is called for
+// each pixel from x1 to x2.
+template<typename ImageTraits, typename Delegate, typename BlendPixel>
+void blur_scanline(const Image* srcImage,
+                   const TiledMode tiledMode,
+                   const int x1, const int y, const int x2,
+                   BlendPixel&& blendPixel)
+{
+  const int w = srcImage->width();
+  const int h = srcImage->height();
+  const bool tiledX = (int(tiledMode) & int(TiledMode::X_AXIS));
+  const bool tiledY = (int(tiledMode) & int(TiledMode::Y_AXIS));
+
+  auto mapCoord = [](int c, int size, bool tiled) {
+    if (c < 0)
+      return (tiled ? size - (-(c+1) % size) - 1: 0);
+    else if (c >= size)
+      return (tiled ? c % size: size-1);
+    return c;
+  };
+
+  typename ImageTraits::const_address_t rows[3];
+  for (int i=0; i<3; ++i) {
+    rows[i] = (typename ImageTraits::const_address_t)
+      srcImage->getPixelAddress(0, mapCoord(y-1+i, h, tiledY));
+  }
+
+  auto column = [&](Delegate& col, int x) {
+    col.reset();
+    x = mapCoord(x, w, tiledX);
+    for (int i=0; i<3; ++i)
+      col(rows[i][x]);
+  };
+
+  Delegate cols[3];
+  column(cols[0], x1-1);
+  column(cols[1], x1);
+  int next = 0;                 // Index of the left column
+  for (int x=x1; x<=x2; ++x) {
+    column(cols[(next+2) % 3], x+1);
+
+    Delegate area;
+    area.reset();
+    for (const Delegate& col : cols)
+      area.add(col);
+    blendPixel(area);
+
+    next = (next+1) % 3;
+  }
+}
+
 template<typename ImageTraits>
 class BlurInkProcessing : public DoubleInkProcessing<BlurInkProcessing<ImageTraits>, ImageTraits> {
 public:
@@ -393,16 +597,38 @@ public:
 template<>
 class BlurInkProcessing<RgbTraits> : public DoubleInkProcessing<BlurInkProcessing<RgbTraits>, RgbTraits> {
 public:
+  typedef DoubleInkProcessing<BlurInkProcessing<RgbTraits>, RgbTraits> base;
+
   BlurInkProcessing(ToolLoop* loop) :
     m_opacity(loop->getOpacity()),
     m_tiledMode(loop->getTiledMode()),
     m_srcImage(loop->getSrcImage()) {
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    if (loop->useMask() || x2 < x1) {
+      base::processScanline(x1, y, x2, loop);
+      return;
+    }
+
+    initIterators(loop, x1, y);
+    blur_scanline<RgbTraits, GetPixelsDelegate>(
+      m_srcImage, m_tiledMode, x1, y, x2,
+      [this](GetPixelsDelegate& area){
+        m_area = area;
+        blendPixel();
+        moveIterators();
+      });
+  }
+
   void processPixel(int x, int y) {
     m_area.reset();
     get_neighboring_pixels<RgbTraits>(m_srcImage, x, y, 3, 3, 1, 1, m_tiledMode, m_area);
+    blendPixel();
+  }
 
+private:
+  void blendPixel() {
     if (m_area.count > 0) {
       m_area.r /= m_area.count;
       m_area.g /= m_area.count;
@@ -418,12 +644,19 @@ public:
     }
   }
 
-private:
   struct GetPixelsDelegate {
     int count, r, g, b, a;
 
     void reset() { count = r = g = b = a = 0; }
 
+    void add(const GetPixelsDelegate& o) {
+      count += o.count;
+      r += o.r;
+      g += o.g;
+      b += o.b;
+      a += o.a;
+    }
+
     void operator()(RgbTraits::pixel_t color) {
       if (rgba_geta(color) != 0) {
         r += rgba_getr(color);
@@ -444,16 +677,38 @@ private:
 template<>
 class BlurInkProcessing<GrayscaleTraits> : public DoubleInkProcessing<BlurInkProcessing<GrayscaleTraits>, GrayscaleTraits> {
 public:
+  typedef DoubleInkProcessing<BlurInkProcessing<GrayscaleTraits>, GrayscaleTraits> base;
+
   BlurInkProcessing(ToolLoop* loop) :
     m_opacity(loop->getOpacity()),
     m_tiledMode(loop->getTiledMode()),
     m_srcImage(loop->getSrcImage()) {
   }
 
+  void processScanline(int x1, int y, int x2, ToolLoop* loop) override {
+    if (loop->useMask() || x2 < x1) {
+      base::processScanline(x1, y, x2, loop);
+      return;
+    }
+
+    initIterators(loop, x1, y);
+    blur_scanline<GrayscaleTraits, GetPixelsDelegate>(
+      m_srcImage, m_tiledMode, x1, y, x2,
+      [this](GetPixelsDelegate& area){
+        m_area = area;
+        blendPixel();
+        moveIterators();
+      });
+  }
+
   void processPixel(int x, int y) {
     m_area.reset();
     get_neighboring_pixels<GrayscaleTraits>(m_srcImage, x, y, 3, 3, 1, 1, m_tiledMode, m_area);
+    blendPixel();
+  }
 
+private:
+  void blendPixel() {
     if (m_area.count > 0) {
       m_area.v /= m_area.count;
       m_area.a /= 9;
@@ -467,12 +722,17 @@ public:
     }
   }
 
-private:
   struct GetPixelsDelegate {
     int count, v, a;
 
     void reset() { count = v = a = 0; }
 
+    void add(const GetPixelsDelegate& o) {
+      count += o.count;
+      v += o.v;
+      a += o.a;
+    }
+
     void operator()(GrayscaleTraits::pixel_t color)
     {
       if (graya_geta(color) > 0) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2020  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -68,18 +68,13 @@ void Intertwine::doPointshapeStrokePt(const Stroke::Pt& pt, ToolLoop* loop)
 {
   Symmetry* symmetry = loop->getSymmetry();
   if (symmetry) {
-    // Convert the point to the sprite position so we can apply the
-    // symmetry transformation.
-    Stroke main_stroke;
-    main_stroke.addPoint(pt);
-
-    Strokes strokes;
-    symmetry->generateStrokes(main_stroke, strokes, loop);
-    for (const auto& stroke : strokes) {
-      // We call transformPoint() moving back each point to the cel
-      // origin.
-      doTransformPoint(stroke[0], loop);
-    }
+    // Generate the symmetrical points (the mirrored brush scanlines
+    // are cached by the point shape, so each point just stamps them
+    // in a different position).
+    Stroke::Pt pts[Symmetry::kMaxPoints];
+    const int n = symmetry->generatePoints(pt, pts, loop);
+    for (int i=0; i<n; ++i)
+      doTransformPoint(pts[i], loop);
   }
   else {
     doTransformPoint(pt, loop);
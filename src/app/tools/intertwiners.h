@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -442,14 +442,25 @@ class IntertwineAsPixelPerfect : public Intertwine {
     gfx::Rect r;
   };
   // Holds the areas saved by savePointshapeStrokePtArea method and restored by
-  // restoreLastPts method.
+  // restoreLastPts method. Only the first m_nSavedAreas are used, the
+  // other ones are kept to re-use their images for the next point.
   std::vector<SavedArea> m_savedAreas;
+  int m_nSavedAreas = 0;
   // When a SavedArea is restored we add its Rect to this Region, then we use
   // this to expand the modified region when editing a tilemap manually.
   gfx::Region m_restoredRegion;
   // Last point index.
   int m_lastPti;
 
+  // When the stroke doesn't need to be filled, we keep only the last
+  // points in m_pts (the pixel-perfect algorithm only checks the last
+  // 3 points), so each joinStroke() doesn't depend on the length of
+  // the stroke. This is the number of removed points from the
+  // beginning of m_pts.
+  int m_trimmedPts = 0;
+  static constexpr int kMaxPtsWithoutFill = 256;
+  static constexpr int kKeptPts = 4;
+
   // Temporal tileset with latest changes to be used by pixel perfect only when
   // modifying a tilemap in Manual mode.
   std::unique_ptr<Tileset> m_tempTileset;
@@ -464,6 +475,7 @@ public:
 
   void prepareIntertwine(ToolLoop* loop) override {
     m_pts.reset();
+    m_trimmedPts = 0;
     m_retainedTracePolicyLast = false;
     m_grid = m_dstGrid = m_celGrid = loop->getGrid();
     m_restoredRegion.clear();
@@ -494,6 +506,7 @@ public:
     if (loop->getTracePolicy() == TracePolicy::Last) {
       m_retainedTracePolicyLast = true;
       m_pts.reset();
+      m_trimmedPts = 0;
     }
 
     int thirdFromLastPt = 0, nextPt = 0;
@@ -557,7 +570,7 @@ public:
       // a joinStroke pass with a retained "Last" trace policy
       // (i.e. the user confirms draw a line while he is holding
       // the SHIFT key))
-      if (c == 0 && m_retainedTracePolicyLast)
+      if (c+m_trimmedPts == 0 && m_retainedTracePolicyLast)
         continue;
 
       // For the last point we need to store the source image content at that
@@ -571,6 +584,9 @@ public:
       }
       doPointshapeStrokePt(m_pts[c], loop);
     }
+
+    if (m_pts.size() > kMaxPtsWithoutFill && !loop->getFilled())
+      trimPts();
   }
 
   void fillStroke(ToolLoop* loop, const Stroke& stroke) override {
@@ -600,8 +616,20 @@ protected:
   }
 
 private:
+  // Removes the first points of m_pts that cannot be modified by the
+  // pixel-perfect algorithm anymore.
+  void trimPts() {
+    const int n = m_pts.size() - kKeptPts;
+    Stroke pts;
+    for (int c=n; c<m_pts.size(); ++c)
+      pts.addPoint(m_pts[c]);
+    m_pts = std::move(pts);
+    m_trimmedPts += n;
+    m_lastPti -= n;
+  }
+
   void clearPointshapeStrokePtAreas() {
-    m_savedAreas.clear();
+    m_nSavedAreas = 0;
   }
 
   void setLastPtIndex(const int pti) {
@@ -642,8 +670,28 @@ private:
           });
       }
 
-      ImageRef i(crop_image(loop->getDstImage(), a, loop->getDstImage()->maskColor()));
-      m_savedAreas.push_back(SavedArea{ i, pt, a });
+      // Re-use the image of a previous point if it has the same size
+      // (generally all points use the same brush size)
+      const Image* dstImage = loop->getDstImage();
+      if (m_nSavedAreas < int(m_savedAreas.size()) &&
+          m_savedAreas[m_nSavedAreas].img->width() == a.w &&
+          m_savedAreas[m_nSavedAreas].img->height() == a.h &&
+          m_savedAreas[m_nSavedAreas].img->pixelFormat() == dstImage->pixelFormat()) {
+        SavedArea& saved = m_savedAreas[m_nSavedAreas];
+        saved.img->setMaskColor(dstImage->maskColor());
+        clear_image(saved.img.get(), dstImage->maskColor());
+        saved.img->copy(dstImage, gfx::Clip(0, 0, a.x, a.y, a.w, a.h));
+        saved.pos = pt;
+        saved.r = a;
+      }
+      else {
+        ImageRef i(crop_image(dstImage, a, dstImage->maskColor()));
+        if (m_nSavedAreas < int(m_savedAreas.size()))
+          m_savedAreas[m_nSavedAreas] = SavedArea{ i, pt, a };
+        else
+          m_savedAreas.push_back(SavedArea{ i, pt, a });
+      }
+      ++m_nSavedAreas;
     }
   }
 
@@ -653,13 +701,13 @@ private:
   // image. This method is used by IntertwineAsPixelPerfect.joinStroke()
   // method.
   void restoreLastPts(ToolLoop* loop, const int pti, const tools::Stroke::Pt& pt) {
-    if (m_savedAreas.empty() || pti != m_lastPti || m_savedAreas[0].pos != pt)
+    if (m_nSavedAreas == 0 || pti != m_lastPti || m_savedAreas[0].pos != pt)
       return;
 
     m_restoredRegion.clear();
 
     tools::Stroke::Pt pos;
-    for (int i=0; i<m_savedAreas.size(); ++i) {
+    for (int i=0; i<m_nSavedAreas; ++i) {
       loop->getDstImage()->copy(
         m_savedAreas[i].img.get(),
         gfx::Clip(m_savedAreas[i].r.origin(),
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -7,12 +7,15 @@
 
 #include "app/util/wrap_point.h"
 
+#include "app/tools/brush_stamp_cache.h"
 #include "app/tools/ink.h"
 #include "doc/algorithm/flip_image.h"
 #include "render/gradient.h"
 
+#include <algorithm>
 #include <array>
 #include <memory>
+#include <vector>
 
 namespace app {
 namespace tools {
@@ -66,6 +69,9 @@ class BrushPointShape : public PointShape {
   Brush* m_lastBrush;
   BrushType m_origBrushType;
   std::array<std::shared_ptr<CompressedImage>, 4> m_compressedImages;
+  // Brush from the BrushStampCache used in the last point (its
+  // compressed images are shared between strokes)
+  BrushStampRef m_stamp;
   // For dynamics
   DynamicsOptions m_dynamics;
   bool m_useDynamics;
@@ -79,6 +85,7 @@ public:
   void preparePointShape(ToolLoop* loop) override {
     m_firstPoint = true;
     m_lastBrush = nullptr;
+    m_stamp.reset();
     m_origBrushType = loop->getBrush()->type();
 
     m_dynamics = loop->getDynamics();
@@ -177,15 +184,17 @@ public:
       if ((brush->size() != size) ||
           (brush->angle() != angle && m_origBrushType != kCircleBrushType) ||
           (m_hasDynamicGradient && pt.gradient != m_lastGradientValue)) {
-        // TODO cache brushes
-        BrushRef newBrush = std::make_shared<Brush>(
-          m_origBrushType, size, angle);
+        BrushRef newBrush;
 
         // Dynamic gradient with dithering
         bool prepareInk = false;
         if (m_hasDynamicGradient && !ink->isEraser() &&
             (m_dynamics.ditheringMatrix.rows() > 1 ||
              m_dynamics.ditheringMatrix.cols() > 1)) {
+          // The dithering brush depends on the gradient value, so it
+          // cannot be cached
+          m_stamp.reset();
+          newBrush = std::make_shared<Brush>(m_origBrushType, size, angle);
           convert_bitmap_brush_to_dithering_brush(
             newBrush.get(),
             loop->sprite()->pixelFormat(),
@@ -195,6 +204,10 @@ public:
             m_primaryColor);
           prepareInk = true;
         }
+        else {
+          m_stamp = BrushStampCache::instance()->get(m_origBrushType, size, angle);
+          newBrush = m_stamp->brush;
+        }
         m_lastGradientValue = pt.gradient;
 
         loop->setBrush(newBrush);
@@ -207,10 +220,12 @@ public:
       }
     }
 
-    // TODO cache compressed images (or remove them completelly)
     if (m_lastBrush != brush) {
       m_lastBrush = brush;
-      m_compressedImages.fill(nullptr);
+      if (m_stamp && m_stamp->brush.get() == brush)
+        m_compressedImages = m_stamp->compressedImages;
+      else
+        m_compressedImages.fill(nullptr);
     }
 
     x += brush->bounds().x;
@@ -295,6 +310,10 @@ private:
           break;
         }
       }
+
+      // Keep the scanlines in the cache for the next points/strokes
+      if (m_stamp && m_stamp->brush.get() == m_lastBrush)
+        m_stamp->compressedImages[int(symmetryMode)] = compressPtr;
     }
     return *compressPtr;
   }
@@ -377,6 +396,9 @@ private:
 class SprayPointShape : public PointShape {
   BrushPointShape m_subPointShape;
   float m_pointRemainder = 0;
+  // Scratch list of dabs generated in each transformPoint() (re-used
+  // to avoid allocating memory for each point).
+  std::vector<Stroke::Pt> m_dabs;
 
 public:
 
@@ -405,8 +427,27 @@ public:
     m_pointRemainder = points_to_spray - integral_points;
     ASSERT(m_pointRemainder >= 0 && m_pointRemainder < 1.0f);
 
-    double angle, radius;
+    // Dabs that cannot touch the destination image are discarded
+    // (only when the brush bounds cannot change between dabs and we
+    // are not in tiled mode, where dabs are wrapped).
+    gfx::Rect dstBounds;
+    const bool cull = (loop->getTiledMode() == TiledMode::NONE &&
+                       !loop->getDynamics().isDynamic());
+    if (cull) {
+      const gfx::Rect brushBounds = loop->getBrush()->bounds();
+      const Image* dstImage = loop->getDstImage();
+      dstBounds = gfx::Rect(-brushBounds.x - brushBounds.w,
+                            -brushBounds.y - brushBounds.h,
+                            dstImage->width() + brushBounds.w,
+                            dstImage->height() + brushBounds.h);
+      if (loop->needsCelCoordinates())
+        dstBounds.offset(loop->getCelOrigin());
+    }
 
+    // Generate all the dabs first
+    double angle, radius;
+    m_dabs.clear();
+    m_dabs.reserve(integral_points);
     for (int c=0; c<integral_points; c++) {
       angle = 360.0 * rand() / RAND_MAX;
       radius = double(spray_width) * rand() / RAND_MAX;
@@ -414,8 +455,19 @@ public:
       Stroke::Pt pt2(pt);
       pt2.x += double(radius * std::cos(angle));
       pt2.y += double(radius * std::sin(angle));
-      m_subPointShape.transformPoint(loop, pt2);
+      if (!cull || dstBounds.contains(pt2.x, pt2.y))
+        m_dabs.push_back(pt2);
     }
+
+    // Paint them in scanline order, so consecutive dabs modify near
+    // rows of the destination image.
+    std::sort(m_dabs.begin(), m_dabs.end(),
+              [](const Stroke::Pt& a, const Stroke::Pt& b){
+                return (a.y < b.y || (a.y == b.y && a.x < b.x));
+              });
+
+    for (const Stroke::Pt& dab : m_dabs)
+      m_subPointShape.transformPoint(loop, dab);
   }
 
   void getModifiedArea(ToolLoop* loop, int x, int y, Rect& area) override {
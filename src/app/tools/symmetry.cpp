@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -49,10 +49,65 @@ void Symmetry::generateStrokes(const Stroke& stroke, Strokes& strokes,
   }
 }
 
+int Symmetry::generatePoints(const Stroke::Pt& pt, Stroke::Pt* pts,
+                             ToolLoop* loop)
+{
+  const bool isDynamic = loop->getDynamics().isDynamic();
+  int brushSize, brushCenter;
+  int n = 0;
+
+  pts[n++] = pt;
+  gen::SymmetryMode symmetryMode = loop->getSymmetry()->mode();
+  switch (symmetryMode) {
+    case gen::SymmetryMode::NONE:
+      ASSERT(false);
+      break;
+
+    case gen::SymmetryMode::HORIZONTAL:
+    case gen::SymmetryMode::VERTICAL:
+      getBrushSizeAndCenter(loop, symmetryMode, brushSize, brushCenter);
+      pts[n++] = calculateSymmetricalPoint(pt, symmetryMode,
+                                           brushSize, brushCenter, isDynamic);
+      break;
+
+    case gen::SymmetryMode::BOTH: {
+      getBrushSizeAndCenter(loop, gen::SymmetryMode::HORIZONTAL, brushSize, brushCenter);
+      pts[n++] = calculateSymmetricalPoint(pt, gen::SymmetryMode::HORIZONTAL,
+                                           brushSize, brushCenter, isDynamic);
+
+      getBrushSizeAndCenter(loop, gen::SymmetryMode::VERTICAL, brushSize, brushCenter);
+      const Stroke::Pt pt3 =
+        calculateSymmetricalPoint(pt, gen::SymmetryMode::VERTICAL,
+                                  brushSize, brushCenter, isDynamic);
+      pts[n++] = pt3;
+
+      getBrushSizeAndCenter(loop, gen::SymmetryMode::BOTH, brushSize, brushCenter);
+      pts[n++] = calculateSymmetricalPoint(pt3, gen::SymmetryMode::BOTH,
+                                           brushSize, brushCenter, isDynamic);
+      break;
+    }
+  }
+  ASSERT(n <= kMaxPoints);
+  return n;
+}
+
 void Symmetry::calculateSymmetricalStroke(const Stroke& refStroke, Stroke& stroke,
                                           ToolLoop* loop, gen::SymmetryMode symmetryMode)
 {
   int brushSize, brushCenter;
+  getBrushSizeAndCenter(loop, symmetryMode, brushSize, brushCenter);
+
+  const bool isDynamic = loop->getDynamics().isDynamic();
+  for (const auto& pt : refStroke) {
+    stroke.addPoint(
+      calculateSymmetricalPoint(pt, symmetryMode,
+                                brushSize, brushCenter, isDynamic));
+  }
+}
+
+void Symmetry::getBrushSizeAndCenter(ToolLoop* loop, gen::SymmetryMode symmetryMode,
+                                     int& brushSize, int& brushCenter) const
+{
   if (loop->getPointShape()->isFloodFill()) {
     brushSize = 1;
     brushCenter = 0;
@@ -70,21 +125,24 @@ void Symmetry::calculateSymmetricalStroke(const Stroke& refStroke, Stroke& strok
       brushCenter = brush->center().y;
     }
   }
+}
 
-  const bool isDynamic = loop->getDynamics().isDynamic();
-  for (const auto& pt : refStroke) {
-    if (isDynamic) {
-      brushSize = pt.size;
-      brushCenter = (brushSize - brushSize % 2) / 2;
-    }
-    Stroke::Pt pt2 = pt;
-    pt2.symmetry = symmetryMode;
-    if (symmetryMode == gen::SymmetryMode::HORIZONTAL || symmetryMode == gen::SymmetryMode::BOTH)
-      pt2.x = 2 * (m_x + brushCenter) - pt2.x - brushSize;
-    else
-      pt2.y = 2 * (m_y + brushCenter) - pt2.y - brushSize;
-    stroke.addPoint(pt2);
+Stroke::Pt Symmetry::calculateSymmetricalPoint(const Stroke::Pt& pt,
+                                               gen::SymmetryMode symmetryMode,
+                                               int brushSize, int brushCenter,
+                                               const bool isDynamic) const
+{
+  if (isDynamic) {
+    brushSize = pt.size;
+    brushCenter = (brushSize - brushSize % 2) / 2;
   }
+  Stroke::Pt pt2 = pt;
+  pt2.symmetry = symmetryMode;
+  if (symmetryMode == gen::SymmetryMode::HORIZONTAL || symmetryMode == gen::SymmetryMode::BOTH)
+    pt2.x = 2 * (m_x + brushCenter) - pt2.x - brushSize;
+  else
+    pt2.y = 2 * (m_y + brushCenter) - pt2.y - brushSize;
+  return pt2;
 }
 
 } // namespace tools
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 // Copyright (C) 2015  David Capello
 //
 // This program is distributed under the terms of
@@ -25,13 +25,28 @@ public:
     , m_y(y) {
   }
 
+  // Maximum number of points generated from one point (BOTH mode)
+  static constexpr int kMaxPoints = 4;
+
   void generateStrokes(const Stroke& stroke, Strokes& strokes, ToolLoop* loop);
 
+  // Same as generateStrokes() for just one point, but without
+  // allocating strokes (it's called for each point of the point
+  // shape). Returns the number of points stored in "pts", which must
+  // have space for kMaxPoints.
+  int generatePoints(const Stroke::Pt& pt, Stroke::Pt* pts, ToolLoop* loop);
+
   gen::SymmetryMode mode() const { return m_symmetryMode; }
 
 private:
   void calculateSymmetricalStroke(const Stroke& refStroke, Stroke& stroke,
                                   ToolLoop* loop, gen::SymmetryMode symmetryMode);
+  void getBrushSizeAndCenter(ToolLoop* loop, gen::SymmetryMode symmetryMode,
+                             int& brushSize, int& brushCenter) const;
+  Stroke::Pt calculateSymmetricalPoint(const Stroke::Pt& pt,
+                                       gen::SymmetryMode symmetryMode,
+                                       int brushSize, int brushCenter,
+                                       const bool isDynamic) const;
 
   gen::SymmetryMode m_symmetryMode;
   double m_x, m_y;
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 
 #include "app/context.h"
 #include "app/snap_to_grid.h"
+#include "app/trace.h"
 #include "app/tools/controller.h"
 #include "app/tools/ink.h"
 #include "app/tools/intertwine.h"
@@ -166,44 +167,62 @@ bool ToolLoopManager::releaseButton(const Pointer& pointer)
   return res;
 }
 
-void ToolLoopManager::movement(Pointer pointer)
+void ToolLoopManager::movement(const Pointer& pointer)
 {
-  // Filter points with the stabilizer
-  if (m_dynamics.stabilizer && m_dynamics.stabilizerFactor > 0) {
-    const double f = m_dynamics.stabilizerFactor;
-    const gfx::Point delta = (pointer.point() - m_stabilizerCenter);
-    const double distance = std::sqrt(delta.x*delta.x + delta.y*delta.y);
-
-    const double angle = std::atan2(delta.y, delta.x);
-    const gfx::PointF newPoint(m_stabilizerCenter.x + distance/f*std::cos(angle),
-                               m_stabilizerCenter.y + distance/f*std::sin(angle));
-
-    m_stabilizerCenter = newPoint;
-
-    pointer = Pointer(gfx::Point(newPoint),
-                      pointer.velocity(),
-                      pointer.button(),
-                      pointer.type(),
-                      pointer.pressure());
-  }
+  movement(std::vector<Pointer>{ pointer });
+}
 
-  m_lastPointer = pointer;
+void ToolLoopManager::movement(const std::vector<Pointer>& pointers)
+{
+  gfx::Region dirtyArea;
+
+  for (Pointer pointer : pointers) {
+    // Filter points with the stabilizer
+    if (m_dynamics.stabilizer && m_dynamics.stabilizerFactor > 0) {
+      const double f = m_dynamics.stabilizerFactor;
+      const gfx::Point delta = (pointer.point() - m_stabilizerCenter);
+      const double distance = std::sqrt(delta.x*delta.x + delta.y*delta.y);
+
+      const double angle = std::atan2(delta.y, delta.x);
+      const gfx::PointF newPoint(m_stabilizerCenter.x + distance/f*std::cos(angle),
+                                 m_stabilizerCenter.y + distance/f*std::sin(angle));
+
+      m_stabilizerCenter = newPoint;
+
+      pointer = Pointer(gfx::Point(newPoint),
+                        pointer.velocity(),
+                        pointer.button(),
+                        pointer.type(),
+                        pointer.pressure());
+    }
 
-  if (isCanceled())
-    return;
+    m_lastPointer = pointer;
 
-  Stroke::Pt spritePoint = getSpriteStrokePt(pointer);
-  m_toolLoop->getController()->movement(m_toolLoop, m_stroke, spritePoint);
+    if (isCanceled())
+      return;
+
+    Stroke::Pt spritePoint = getSpriteStrokePt(pointer);
+    m_toolLoop->getController()->movement(m_toolLoop, m_stroke, spritePoint);
+
+    doLoopStep(false, &dirtyArea);
+  }
+
+  if (pointers.empty())
+    return;
 
   std::string statusText;
   m_toolLoop->getController()->getStatusBarText(m_toolLoop, m_stroke, statusText);
   m_toolLoop->updateStatusBar(statusText.c_str());
 
-  doLoopStep(false);
+  // Only one update of the editors for all the pointers
+  if (!dirtyArea.isEmpty())
+    m_toolLoop->updateDirtyArea(dirtyArea);
 }
 
-void ToolLoopManager::doLoopStep(bool lastStep)
+void ToolLoopManager::doLoopStep(bool lastStep, gfx::Region* batchDirtyArea)
 {
+  APP_TRACE_ZONE("Tool loop step");
+
   // Original set of points to interwine (original user stroke,
   // relative to sprite origin).
   Stroke main_stroke;
@@ -282,7 +301,10 @@ void ToolLoopManager::doLoopStep(bool lastStep)
 
   if (!m_dirtyArea.isEmpty()) {
     m_toolLoop->validateDstTileset(m_dirtyArea);
-    m_toolLoop->updateDirtyArea(m_dirtyArea);
+    if (batchDirtyArea)
+      batchDirtyArea->createUnion(*batchDirtyArea, m_dirtyArea);
+    else
+      m_toolLoop->updateDirtyArea(m_dirtyArea);
   }
 
   TOOL_TRACE("ToolLoopManager::doLoopStep dirtyArea", m_dirtyArea.bounds());
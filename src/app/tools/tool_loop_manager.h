@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -76,12 +76,17 @@ public:
   bool releaseButton(const Pointer& pointer);
 
   // Should be called each time the user moves the mouse inside the editor.
-  void movement(Pointer pointer);
+  void movement(const Pointer& pointer);
+
+  // Same as movement() for several pointers received in the same
+  // frame. Each pointer is processed as a step of the stroke, but
+  // the modified area is notified just one time.
+  void movement(const std::vector<Pointer>& pointers);
 
   const Pointer& lastPointer() const { return m_lastPointer; }
 
 private:
-  void doLoopStep(bool lastStep);
+  void doLoopStep(bool lastStep, gfx::Region* batchDirtyArea = nullptr);
   void snapToGrid(Stroke::Pt& pt);
   Stroke::Pt getSpriteStrokePt(const Pointer& pointer);
   bool useDynamics() const;
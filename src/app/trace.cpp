@@ -0,0 +1,136 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/trace.h"
+
+#include "base/fs.h"
+#include "base/fstream_path.h"
+
+#include "json11.hpp"
+
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace app {
+namespace trace {
+
+std::atomic<bool> g_recording(false);
+
+namespace {
+
+struct Event {
+  const char* name;
+  char phase;                   // 'X' = complete zone, 'C' = counter
+  int tid;
+  int64_t ts;
+  int64_t dur;
+  double value;
+};
+
+std::mutex g_mutex;             // Protects all the following fields
+std::vector<Event> g_events;
+int64_t g_startTime = 0;
+int g_mainTid = 0;
+
+std::atomic<int> g_nextTid(1);
+
+// Small sequential IDs are easier to read in the trace viewer than
+// std::thread::id values.
+int thread_id()
+{
+  thread_local const int tid = g_nextTid++;
+  return tid;
+}
+
+} // anonymous namespace
+
+void start_recording()
+{
+  const std::lock_guard lock(g_mutex);
+  g_events.clear();
+  g_startTime = now();
+  g_mainTid = thread_id();
+  g_recording = true;
+}
+
+bool stop_recording(const std::string& filename)
+{
+  std::vector<Event> events;
+  int64_t startTime;
+  int mainTid;
+  {
+    const std::lock_guard lock(g_mutex);
+    g_recording = false;
+    std::swap(events, g_events);
+    startTime = g_startTime;
+    mainTid = g_mainTid;
+  }
+
+  json11::Json::array traceEvents;
+  traceEvents.push_back(json11::Json::object{
+    { "name", "thread_name" },
+    { "ph", "M" },
+    { "pid", 1 },
+    { "tid", mainTid },
+    { "args", json11::Json::object{ { "name", "Main" } } }
+  });
+  for (const Event& ev : events) {
+    json11::Json::object obj{
+      { "name", ev.name },
+      { "ph", std::string(1, ev.phase) },
+      { "ts", double(ev.ts - startTime) },
+      { "pid", 1 },
+      { "tid", ev.tid }
+    };
+    if (ev.phase == 'X')
+      obj["dur"] = double(ev.dur);
+    else
+      obj["args"] = json11::Json::object{ { "value", ev.value } };
+    traceEvents.push_back(obj);
+  }
+
+  const std::string dir = base::get_file_path(filename);
+  if (!dir.empty() && !base::is_directory(dir))
+    base::make_all_directories(dir);
+
+  std::ofstream f(FSTREAM_PATH(filename), std::ios::out);
+  f << json11::Json(json11::Json::object{ { "traceEvents", traceEvents } }).dump()
+    << "\n";
+  return f.good();
+}
+
+int64_t now()
+{
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void add_zone(const char* name, int64_t begin, int64_t end)
+{
+  const int tid = thread_id();
+  const std::lock_guard lock(g_mutex);
+  // The recording could be stopped while the zone was running
+  if (g_recording)
+    g_events.push_back(Event{ name, 'X', tid, begin, end-begin, 0.0 });
+}
+
+void add_counter(const char* name, double value)
+{
+  const int64_t ts = now();
+  const int tid = thread_id();
+  const std::lock_guard lock(g_mutex);
+  if (g_recording)
+    g_events.push_back(Event{ name, 'C', tid, ts, 0, value });
+}
+
+} // namespace trace
+} // namespace app
@@ -0,0 +1,91 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_TRACE_H_INCLUDED
+#define APP_TRACE_H_INCLUDED
+#pragma once
+
+// Performance trace recorder for developers. Subsystems mark zones of
+// code with APP_TRACE_ZONE("name") (the zone is the rest of the C++
+// scope) and values with APP_TRACE_COUNTER("name", value). Events are
+// recorded only while the TraceRecording command is running, and they
+// are saved in the Chrome trace event format (which can be opened
+// with https://ui.perfetto.dev/ or chrome://tracing).
+//
+// This is compiled only with ENABLE_TRACING, in other case the
+// macros expand to nothing.
+
+#ifdef ENABLE_TRACING
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace app {
+namespace trace {
+
+  extern std::atomic<bool> g_recording;
+
+  inline bool is_recording() {
+    return g_recording.load(std::memory_order_relaxed);
+  }
+
+  void start_recording();
+
+  // Stops the recording and writes the recorded events in the given
+  // file. Returns false if the file cannot be written.
+  bool stop_recording(const std::string& filename);
+
+  // Returns the current time in microseconds.
+  int64_t now();
+
+  // The name must be a string literal (only the pointer is saved).
+  void add_zone(const char* name, int64_t begin, int64_t end);
+  void add_counter(const char* name, double value);
+
+  class Zone {
+  public:
+    Zone(const char* name)
+      : m_name(is_recording() ? name: nullptr)
+      , m_begin(m_name ? now(): 0) {
+    }
+
+    ~Zone() {
+      if (m_name)
+        add_zone(m_name, m_begin, now());
+    }
+
+  private:
+    const char* m_name;
+    int64_t m_begin;
+
+    Zone(const Zone&) = delete;
+    Zone& operator=(const Zone&) = delete;
+  };
+
+} // namespace trace
+} // namespace app
+
+#define APP_TRACE_CONCAT_(a, b) a##b
+#define APP_TRACE_CONCAT(a, b) APP_TRACE_CONCAT_(a, b)
+
+#define APP_TRACE_ZONE(name)                                    \
+  app::trace::Zone APP_TRACE_CONCAT(trace_zone_, __LINE__)(name)
+
+#define APP_TRACE_COUNTER(name, value)                          \
+  do {                                                          \
+    if (app::trace::is_recording())                             \
+      app::trace::add_counter(name, double(value));             \
+  } while (0)
+
+#else  // ENABLE_TRACING
+
+#define APP_TRACE_ZONE(name) ((void)0)
+#define APP_TRACE_COUNTER(name, value) ((void)0)
+
+#endif // ENABLE_TRACING
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -172,6 +172,10 @@ void Transaction::execute(Cmd* cmd)
     delete cmd;
     throw;
   }
+
+  // Consecutive commands of the same kind modifying the same object
+  // (e.g. from a script) are joined in just one command
+  m_cmds->mergeLastCmd();
 }
 
 void Transaction::onSelectionChanged(DocEvent& ev)
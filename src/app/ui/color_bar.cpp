@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -901,10 +901,8 @@ void ColorBar::onRemapPalButtonClick()
       if (remap.isFor8bit()) {
         PalettePicks usedEntries(256);
 
-        for (ImageRef& image : images) {
-          for (const auto& i : LockImageBits<IndexedTraits>(image.get()))
-            usedEntries[i] = true;
-        }
+        for (ImageRef& image : images)
+          doc::get_used_entries(image.get(), usedEntries);
 
         if (remap.isInvertible(usedEntries)) {
           for (int i=0; i<remap.size(); ++i) {
@@ -964,13 +962,11 @@ void ColorBar::onRemapTilesButtonClick()
     PalettePicks usedTiles(n);
 
     if (n > 0) {
-      for (const ImageRef& tilemap : tilemaps) {
-        for (const doc::tile_t t : LockImageBits<TilemapTraits>(tilemap.get())) {
-          const doc::tile_index ti = doc::tile_geti(t);
-          if (ti > 0 && ti < n)
-            usedTiles[ti] = true;
-        }
-      }
+      for (const ImageRef& tilemap : tilemaps)
+        doc::get_used_entries(tilemap.get(), usedTiles);
+
+      // The empty tile is always available
+      usedTiles[0] = false;
     }
 
     // Remap all tiles in the same order as in newTileset
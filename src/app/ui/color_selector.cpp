@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -38,6 +38,8 @@
 #include <cmath>
 #include <condition_variable>
 #include <cstdio>
+#include <list>
+#include <string>
 #include <thread>
 
 #if SK_ENABLE_SKSL
@@ -52,6 +54,80 @@ namespace app {
 using namespace app::skin;
 using namespace ui;
 
+// Main areas already painted in the background thread, shared
+// between all color selectors (e.g. the color bar and the color
+// popup show the same main area for the same color). The key is
+// given by ColorSelector::getMainAreaCacheKey() plus the size and
+// the color space of the surface. It's used only from the UI thread.
+class MainAreaCache {
+public:
+  // Returns a surface with the same key, if it doesn't have the
+  // exact same size, the surface can be scaled as a preview of the
+  // main area (until the background thread paints the real one).
+  os::SurfaceRef find(const std::string& key,
+                      const gfx::Size& size,
+                      const os::ColorSpaceRef& cs,
+                      bool& exact) {
+    auto preview = m_entries.end();
+    for (auto it=m_entries.begin(); it!=m_entries.end(); ++it) {
+      if (it->key != key || it->cs != cs)
+        continue;
+
+      if (it->size == size) {
+        // Move to the front (most recently used)
+        m_entries.splice(m_entries.begin(), m_entries, it);
+        exact = true;
+        return m_entries.front().surface;
+      }
+      if (preview == m_entries.end())
+        preview = it;
+    }
+    exact = false;
+    if (preview != m_entries.end())
+      return preview->surface;
+    return nullptr;
+  }
+
+  void add(const std::string& key,
+           const os::SurfaceRef& canvas,
+           const gfx::Rect& bounds) {
+    if (bounds.w*bounds.h > kMaxPixels)
+      return;
+
+    const os::ColorSpaceRef& cs = canvas->colorSpace();
+    os::SurfaceRef surface =
+      os::instance()->makeSurface(bounds.w, bounds.h, cs);
+    surface->drawSurface(canvas.get(), bounds,
+                         gfx::Rect(0, 0, bounds.w, bounds.h),
+                         os::Sampling(), nullptr);
+
+    m_entries.remove_if([&key, &bounds, &cs](const Entry& e){
+      return (e.key == key && e.size == bounds.size() && e.cs == cs);
+    });
+    m_entries.push_front(Entry{ key, bounds.size(), cs, surface });
+    if (m_entries.size() > kMaxEntries)
+      m_entries.pop_back();
+  }
+
+  void clear() {
+    m_entries.clear();
+  }
+
+private:
+  static constexpr size_t kMaxEntries = 16;
+  static constexpr int kMaxPixels = 1024*1024;
+
+  struct Entry {
+    std::string key;
+    gfx::Size size;
+    os::ColorSpaceRef cs;
+    os::SurfaceRef surface;
+  };
+  std::list<Entry> m_entries;
+};
+
+static MainAreaCache main_area_cache;
+
 // TODO This logic could be used to redraw any widget:
 // 1. We send a onPaintSurfaceInBgThread() to paint the widget on a
 //    offscreen buffer
@@ -105,40 +181,13 @@ public:
       m_paintingThread.join();
       if (m_canvas)
         m_canvas.reset();
-    }
-  }
-
-  os::Surface* getCanvas(int w, int h, gfx::Color bgColor) {
-    assert_ui_thread();
-
-    auto activeCS = get_current_color_space();
 
-    if (!m_canvas ||
-        m_canvas->width() != w ||
-        m_canvas->height() != h ||
-        m_canvas->colorSpace() != activeCS) {
-      std::unique_lock<std::mutex> lock(m_mutex);
-      stopCurrentPainting(lock);
-
-      os::SurfaceRef oldCanvas = m_canvas;
-      m_canvas = os::instance()->makeSurface(w, h, activeCS);
-      os::Paint paint;
-      paint.color(bgColor);
-      paint.style(os::Paint::Fill);
-      m_canvas->drawRect(gfx::Rect(0, 0, w, h), paint);
-      if (oldCanvas) {
-        m_canvas->drawSurface(
-          oldCanvas.get(),
-          gfx::Rect(0, 0, oldCanvas->width(), oldCanvas->height()),
-          gfx::Rect(0, 0, w, h),
-          os::Sampling(),
-          nullptr);
-      }
+      main_area_cache.clear();
     }
-    return m_canvas.get();
   }
 
   void startBgPainting(ColorSelector* colorSelector,
+                       const os::SurfaceRef& canvas,
                        const gfx::Rect& mainBounds,
                        const gfx::Rect& bottomBarBounds,
                        const gfx::Rect& alphaBarBounds) {
@@ -149,6 +198,7 @@ public:
     stopCurrentPainting(lock);
 
     m_colorSelector = colorSelector;
+    m_canvas = canvas;
     m_manager = colorSelector->manager();
     m_mainBounds = mainBounds;
     m_bottomBarBounds = bottomBarBounds;
@@ -158,6 +208,17 @@ public:
     m_paintingCV.notify_one();
   }
 
+  // Stops the background painting of the given color selector (if
+  // it's being painted right now), so we can modify its canvas or
+  // delete it.
+  void stopBgPainting(ColorSelector* colorSelector) {
+    assert_ui_thread();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (m_colorSelector == colorSelector)
+      stopCurrentPainting(lock);
+  }
+
 private:
 
   void stopCurrentPainting(std::unique_lock<std::mutex>& lock) {
@@ -256,6 +317,7 @@ ColorSelector::ColorSelector()
 
 ColorSelector::~ColorSelector()
 {
+  painter.stopBgPainting(this);
   painter.releaseRef();
 }
 
@@ -396,6 +458,7 @@ bool ColorSelector::onProcessMessage(ui::Message* msg)
     case kTimerMessage:
       if (m_paintFlags & DoneFlag) {
         m_timer.stop();
+        addMainAreaToCache();
         invalidate();
         return true;
       }
@@ -513,7 +576,10 @@ void ColorSelector::onPaint(ui::PaintEvent& ev)
   else
 #endif // SK_ENABLE_SKSL
   {
-    painterSurface = painter.getCanvas(rc.w, rc.h, theme->colors.workspace());
+    painterSurface = getCanvas(rc.w, rc.h, theme->colors.workspace());
+    updateMainAreaFromCache(
+      gfx::Rect(0, 0, rc.w,
+                std::max(0, rc.h-bottomBarBounds.h-alphaBarBounds.h)));
   }
 
   if (painterSurface)
@@ -540,8 +606,89 @@ void ColorSelector::onPaint(ui::PaintEvent& ev)
     rc.offset(d);
     if (!bottomBarBounds.isEmpty()) bottomBarBounds.offset(d);
     if (!alphaBarBounds.isEmpty()) alphaBarBounds.offset(d);
-    painter.startBgPainting(this, rc, bottomBarBounds, alphaBarBounds);
+    painter.startBgPainting(this, m_canvas,
+                            rc, bottomBarBounds, alphaBarBounds);
+  }
+}
+
+os::Surface* ColorSelector::getCanvas(int w, int h, gfx::Color bgColor)
+{
+  auto activeCS = get_current_color_space();
+
+  if (!m_canvas ||
+      m_canvas->width() != w ||
+      m_canvas->height() != h ||
+      m_canvas->colorSpace() != activeCS) {
+    painter.stopBgPainting(this);
+
+    os::SurfaceRef oldCanvas = m_canvas;
+    m_canvas = os::instance()->makeSurface(w, h, activeCS);
+    os::Paint paint;
+    paint.color(bgColor);
+    paint.style(os::Paint::Fill);
+    m_canvas->drawRect(gfx::Rect(0, 0, w, h), paint);
+    if (oldCanvas) {
+      m_canvas->drawSurface(
+        oldCanvas.get(),
+        gfx::Rect(0, 0, oldCanvas->width(), oldCanvas->height()),
+        gfx::Rect(0, 0, w, h),
+        os::Sampling(),
+        nullptr);
+    }
+  }
+  return m_canvas.get();
+}
+
+void ColorSelector::updateMainAreaFromCache(const gfx::Rect& main)
+{
+  if ((m_paintFlags & MainAreaFlag) == 0 || main.isEmpty())
+    return;
+
+  // Already painting this same main area
+  const std::string key = getMainAreaCacheKey();
+  if (key.empty() ||
+      (key == m_pendingMainAreaKey && main == m_pendingMainArea))
+    return;
+
+  // Stop the background thread as we might modify the canvas (and
+  // the painting flags)
+  painter.stopBgPainting(this);
+
+  bool exact;
+  os::SurfaceRef cached =
+    main_area_cache.find(key, main.size(), m_canvas->colorSpace(), exact);
+  if (cached) {
+    m_canvas->drawSurface(
+      cached.get(),
+      gfx::Rect(0, 0, cached->width(), cached->height()),
+      main, os::Sampling(), nullptr);
+  }
+
+  if (cached && exact) {
+    m_paintFlags &= ~MainAreaFlag;
+    m_pendingMainAreaKey.clear();
+  }
+  else {
+    // The main area will be added to the cache when the background
+    // thread finishes (if the key is still the same)
+    m_pendingMainAreaKey = key;
+    m_pendingMainArea = main;
+  }
+}
+
+void ColorSelector::addMainAreaToCache()
+{
+  if (m_pendingMainAreaKey.empty())
+    return;
+
+  if (m_canvas &&
+      (m_paintFlags & MainAreaFlag) == 0 &&
+      m_pendingMainAreaKey == getMainAreaCacheKey() &&
+      gfx::Rect(0, 0, m_canvas->width(), m_canvas->height())
+        .contains(m_pendingMainArea)) {
+    main_area_cache.add(m_pendingMainAreaKey, m_canvas, m_pendingMainArea);
   }
+  m_pendingMainAreaKey.clear();
 }
 
 void ColorSelector::onPaintAlphaBar(ui::Graphics* g, const gfx::Rect& rc)
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -20,6 +20,7 @@
 
 #include <atomic>
 #include <cmath>
+#include <string>
 
 // TODO We should wrap the SkRuntimeEffect in laf-os, SkRuntimeEffect
 //      and SkRuntimeShaderBuilder might change in future Skia
@@ -86,6 +87,12 @@ namespace app {
     virtual int onNeedsSurfaceRepaint(const app::Color& newColor);
     virtual bool subColorPicked() { return false; }
 
+    // Returns a string that identifies the content of the main area
+    // (without the size), used to share main areas painted in the
+    // background thread between color selectors. An empty string
+    // means that the main area cannot be cached.
+    virtual std::string getMainAreaCacheKey() { return std::string(); }
+
     void paintColorIndicator(ui::Graphics* g,
                              const gfx::Point& pos,
                              const bool white);
@@ -118,6 +125,10 @@ namespace app {
 
     void updateColorSpace();
 
+    os::Surface* getCanvas(int w, int h, gfx::Color bgColor);
+    void updateMainAreaFromCache(const gfx::Rect& main);
+    void addMainAreaToCache();
+
 #if SK_ENABLE_SKSL
     static const char* getAlphaBarShader();
     bool buildEffects();
@@ -139,6 +150,14 @@ namespace app {
 
     ui::Timer m_timer;
 
+    // Surface where the background thread paints this color selector
+    os::SurfaceRef m_canvas;
+
+    // Key and bounds of the main area that is being painted in the
+    // background thread, to add it to the cache when it's done
+    std::string m_pendingMainAreaKey;
+    gfx::Rect m_pendingMainArea;
+
     obs::scoped_connection m_appConn;
 
 #if SK_ENABLE_SKSL
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,6 +15,7 @@
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui/status_bar.h"
 #include "app/util/shader_helpers.h"
+#include "fmt/format.h"
 #include "os/surface.h"
 #include "ui/graphics.h"
 #include "ui/message.h"
@@ -185,4 +186,10 @@ int ColorSpectrum::onNeedsSurfaceRepaint(const app::Color& newColor)
     ColorSelector::onNeedsSurfaceRepaint(newColor);
 }
 
+std::string ColorSpectrum::getMainAreaCacheKey()
+{
+  // The main area depends only on the saturation
+  return fmt::format("spectrum:{:.3f}", m_color.getHslSaturation());
+}
+
 } // namespace app
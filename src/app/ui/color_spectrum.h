@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -34,6 +34,7 @@ namespace app {
                                   const gfx::Rect& alpha,
                                   bool& stop) override;
     int onNeedsSurfaceRepaint(const app::Color& newColor) override;
+    std::string getMainAreaCacheKey() override;
 
   private:
     std::string m_mainShader;
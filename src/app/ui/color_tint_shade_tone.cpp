@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,6 +15,7 @@
 #include "app/pref/preferences.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/util/shader_helpers.h"
+#include "fmt/format.h"
 #include "ui/graphics.h"
 
 #include <algorithm>
@@ -226,4 +227,10 @@ int ColorTintShadeTone::onNeedsSurfaceRepaint(const app::Color& newColor)
   return flags;
 }
 
+std::string ColorTintShadeTone::getMainAreaCacheKey()
+{
+  // The main area depends only on the hue
+  return fmt::format("tst:{:.3f}", m_color.getHsvHue());
+}
+
 } // namespace app
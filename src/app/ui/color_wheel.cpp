@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -18,6 +18,7 @@
 #include "app/ui/status_bar.h"
 #include "app/util/shader_helpers.h"
 #include "base/pi.h"
+#include "fmt/format.h"
 #include "os/surface.h"
 #include "ui/graphics.h"
 #include "ui/menu.h"
@@ -471,6 +472,21 @@ int ColorWheel::onNeedsSurfaceRepaint(const app::Color& newColor)
     ColorSelector::onNeedsSurfaceRepaint(newColor);
 }
 
+std::string ColorWheel::getMainAreaCacheKey()
+{
+  // The main area includes the harmonies of the current color
+  return fmt::format("wheel:{}:{}:{}:{}:{:08x}:{:.3f}:{:.3f}:{:.3f}:{}",
+                     int(m_colorModel),
+                     m_discrete,
+                     int(m_harmony),
+                     hasCaptureInMainArea(),
+                     uint32_t(m_bgColor),
+                     m_color.getHsvHue(),
+                     m_color.getHsvSaturation(),
+                     m_color.getHsvValue(),
+                     m_color.getAlpha() > 0);
+}
+
 void ColorWheel::setDiscrete(bool state)
 {
   if (m_discrete != state)
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2021-2022  Igara Studio S.A.
+// Copyright (C) 2021-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -60,6 +60,7 @@ namespace app {
                                   bool& stop) override;
     int onNeedsSurfaceRepaint(const app::Color& newColor) override;
     bool subColorPicked() override { return m_harmonyPicked; }
+    std::string getMainAreaCacheKey() override;
 
   private:
     void onResize(ui::ResizeEvent& ev) override;
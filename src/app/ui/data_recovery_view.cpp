@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -309,12 +309,12 @@ void DataRecoveryView::fillList()
 {
   clearList();
 
+  // Sessions are added incrementally while they are found
+  fillListWith(true);
+  fillListWith(false);
+
   if (m_dataRecovery->isSearching())
     m_listBox.addChild(new ListItem(Strings::recover_files_loading()));
-  else {
-    fillListWith(true);
-    fillListWith(false);
-  }
 }
 
 void DataRecoveryView::fillListWith(const bool crashes)
@@ -365,7 +365,7 @@ void DataRecoveryView::fillListWith(const bool crashes)
   }
 
   // If there are no crash items, we call Empty() signal
-  if (crashes && first)
+  if (crashes && first && !m_dataRecovery->isSearching())
     Empty();
 }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -235,10 +235,12 @@ DocView::DocView(Doc* document, Type type,
 
   m_editor->setDocView(this);
   m_document->add_observer(this);
+  m_document->subscribeToPixelsEvents(this);
 }
 
 DocView::~DocView()
 {
+  m_document->unsubscribeFromPixelsEvents(this);
   m_document->remove_observer(this);
   delete m_editor;
 }
@@ -408,7 +410,7 @@ void DocView::onSpritePixelsModified(DocEvent& ev)
 {
   if (m_editor->isVisible() &&
       m_editor->frame() == ev.frame())
-    m_editor->drawSpriteClipped(ev.region());
+    m_editor->invalidateSpritePixels(ev.region());
 }
 
 void DocView::onLayerMergedDown(DocEvent& ev)
@@ -455,6 +457,10 @@ void DocView::onTagChange(DocEvent& ev)
 
 void DocView::onAddCel(DocEvent& ev)
 {
+  if (ev.document()->isInBatchUpdate()) {
+    m_batchSiteChange = true;
+    return;
+  }
   UIContext::instance()->notifyActiveSiteChanged();
 }
 
@@ -466,9 +472,21 @@ void DocView::onAfterRemoveCel(DocEvent& ev)
   if (!ui::is_ui_thread())
     return;
 
+  if (ev.document()->isInBatchUpdate()) {
+    m_batchSiteChange = true;
+    return;
+  }
   UIContext::instance()->notifyActiveSiteChanged();
 }
 
+void DocView::onAfterBatchUpdate(DocEvent& ev)
+{
+  if (m_batchSiteChange) {
+    m_batchSiteChange = false;
+    UIContext::instance()->notifyActiveSiteChanged();
+  }
+}
+
 void DocView::onTotalFramesChanged(DocEvent& ev)
 {
   if (m_editor->frame() >= m_editor->sprite()->totalFrames()) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -92,6 +92,7 @@ namespace app {
     void onLayerRestacked(DocEvent& ev) override;
     void onAfterLayerVisibilityChange(DocEvent& ev) override;
     void onTilesetChanged(DocEvent& ev) override;
+    void onAfterBatchUpdate(DocEvent& ev) override;
 
     // InputChainElement impl
     void onNewInputPriority(InputChainElement* element,
@@ -118,6 +119,10 @@ namespace app {
     DocViewPreviewDelegate* m_previewDelegate;
     Editor* m_editor;
     gfx::Point m_timelineScroll;
+
+    // The active site changed in a batch update (notified when the
+    // batch ends).
+    bool m_batchSiteChange = false;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -136,8 +136,10 @@ color_t BrushPreview::getBrushColor(Sprite* sprite, Layer* layer)
 //      a way to simplify all possibilities
 void BrushPreview::show(const gfx::Point& screenPos)
 {
+  // The extra cel of the previous position is kept to reuse it if
+  // the preview is the same
   if (m_onScreen)
-    hide();
+    hide(true);
 
   Doc* document = m_editor->document();
   Sprite* sprite = m_editor->sprite();
@@ -347,68 +349,101 @@ void BrushPreview::show(const gfx::Point& screenPos)
     if (cel) opacity = MUL_UN8(opacity, cel->opacity(), t);
     if (layer) opacity = MUL_UN8(opacity, static_cast<LayerImage*>(layer)->opacity(), t);
 
-    if (!m_extraCel)
-      m_extraCel.reset(new ExtraCel);
-
-    m_extraCel->create(
-      tilemapMode,
-      document->sprite(),
-      extraCelBoundsInCanvas,
-      extraCelBounds.size(),
-      site.frame(),
-      opacity);
-    m_extraCel->setType(render::ExtraType::NONE);
-    m_extraCel->setBlendMode(
-      (layer ? static_cast<LayerImage*>(layer)->blendMode():
-               BlendMode::NORMAL));
-
-    document->setExtraCel(m_extraCel);
-
-    Image* extraImage = m_extraCel->image();
-    if (extraImage->pixelFormat() == IMAGE_TILEMAP) {
-      extraImage->setMaskColor(notile);
-      clear_image(extraImage, notile);
+    PreviewKey key;
+    key.bounds = extraCelBoundsInCanvas;
+    key.brushPos = brushBounds.origin();
+    key.frame = site.frame();
+    key.layer = layer;
+    key.tilemapMode = tilemapMode;
+    key.brushGen = brush->gen();
+    key.brushColor = brush_color;
+    key.tool = tool;
+    key.ink = ink;
+    key.opacity = opacity;
+    if (cel && cel->image()) {
+      key.imageId = cel->image()->id();
+      key.imageVersion = cel->image()->version();
     }
-    else {
-      extraImage->setMaskColor(mask_index);
-      clear_image(extraImage,
-                  (extraImage->pixelFormat() == IMAGE_INDEXED ? mask_index: 0));
+    key.stamp = DocStamp(document);
+
+    if (m_withRealPreview &&
+        m_previewKey == key &&
+        m_extraCel &&
+        document->extraCel() == m_extraCel) {
+      // Nothing to do, the same preview is still in the document
+      BP_TRACE("BrushPreview: reusing extra cel", extraCelBoundsInCanvas);
     }
+    else {
+      if (m_withRealPreview)
+        clearRealPreview();
+      m_previewKey = key;
+
+      if (!m_extraCel)
+        m_extraCel.reset(new ExtraCel);
+
+      m_extraCel->create(
+        tilemapMode,
+        document->sprite(),
+        extraCelBoundsInCanvas,
+        extraCelBounds.size(),
+        site.frame(),
+        opacity);
+      m_extraCel->setType(render::ExtraType::NONE);
+      m_extraCel->setBlendMode(
+        (layer ? static_cast<LayerImage*>(layer)->blendMode():
+                 BlendMode::NORMAL));
+
+      document->setExtraCel(m_extraCel);
+
+      Image* extraImage = m_extraCel->image();
+      if (extraImage->pixelFormat() == IMAGE_TILEMAP) {
+        extraImage->setMaskColor(notile);
+        clear_image(extraImage, notile);
+      }
+      else {
+        extraImage->setMaskColor(mask_index);
+        clear_image(extraImage,
+                    (extraImage->pixelFormat() == IMAGE_INDEXED ? mask_index: 0));
+      }
 
-    if (layer) {
-      render::Render().renderLayer(
-        extraImage, layer, site.frame(),
-        gfx::Clip(0, 0, extraCelBoundsInCanvas),
-        BlendMode::SRC);
+      if (layer) {
+        render::Render().renderLayer(
+          extraImage, layer, site.frame(),
+          gfx::Clip(0, 0, extraCelBoundsInCanvas),
+          BlendMode::SRC);
 
-      // This extra cel is a patch for the current layer/frame
-      m_extraCel->setType(render::ExtraType::PATCH);
-    }
+        // This extra cel is a patch for the current layer/frame
+        m_extraCel->setType(render::ExtraType::PATCH);
+      }
 
-    {
-      std::unique_ptr<tools::ToolLoop> loop(
-        create_tool_loop_preview(
-          m_editor, brush, extraImage,
-          extraCelBounds.origin()));
-      if (loop) {
-        loop->getInk()->prepareInk(loop.get());
-        loop->getController()->prepareController(loop.get());
-        loop->getIntertwine()->prepareIntertwine(loop.get());
-        loop->getPointShape()->preparePointShape(loop.get());
-
-        tools::Stroke::Pt pt(brushBounds.x-origBrushBounds.x,
-                             brushBounds.y-origBrushBounds.y);
-        pt.size = brush->size();
-        pt.angle = brush->angle();
-        loop->getPointShape()->transformPoint(loop.get(), pt);
+      {
+        std::unique_ptr<tools::ToolLoop> loop(
+          create_tool_loop_preview(
+            m_editor, brush, extraImage,
+            extraCelBounds.origin()));
+        if (loop) {
+          loop->getInk()->prepareInk(loop.get());
+          loop->getController()->prepareController(loop.get());
+          loop->getIntertwine()->prepareIntertwine(loop.get());
+          loop->getPointShape()->preparePointShape(loop.get());
+
+          tools::Stroke::Pt pt(brushBounds.x-origBrushBounds.x,
+                               brushBounds.y-origBrushBounds.y);
+          pt.size = brush->size();
+          pt.angle = brush->angle();
+          loop->getPointShape()->transformPoint(loop.get(), pt);
+        }
       }
-    }
 
-    document->notifySpritePixelsModified(
-      sprite, gfx::Region(m_lastBounds = extraCelBoundsInCanvas),
-      m_lastFrame = site.frame());
+      document->notifySpritePixelsModified(
+        sprite, gfx::Region(m_lastBounds = extraCelBoundsInCanvas),
+        m_lastFrame = site.frame());
 
-    m_withRealPreview = true;
+      m_withRealPreview = true;
+    }
+  }
+  else if (m_withRealPreview) {
+    clearRealPreview();
   }
 
   // Save area and draw the cursor
@@ -447,6 +482,11 @@ void BrushPreview::show(const gfx::Point& screenPos)
 // (m_cursorEditor). So you must to use this routine only if you
 // called showBrushPreview() before.
 void BrushPreview::hide()
+{
+  hide(false);
+}
+
+void BrushPreview::hide(const bool keepRealPreview)
 {
   if (!m_onScreen)
     return;
@@ -473,21 +513,8 @@ void BrushPreview::hide()
   }
 
   // Clean pixel/brush preview
-  if (m_withRealPreview) {
-    Doc* document = m_editor->document();
-    doc::Sprite* sprite = m_editor->sprite();
-
-    ASSERT(document);
-    ASSERT(sprite);
-
-    if (document && sprite) {
-      document->setExtraCel(ExtraCelRef(nullptr));
-      document->notifySpritePixelsModified(
-        sprite, gfx::Region(m_lastBounds), m_lastFrame);
-    }
-
-    m_withRealPreview = false;
-  }
+  if (m_withRealPreview && !keepRealPreview)
+    clearRealPreview();
 
   m_onScreen = false;
 
@@ -495,6 +522,23 @@ void BrushPreview::hide()
   m_oldClippingRegion.clear();
 }
 
+void BrushPreview::clearRealPreview()
+{
+  Doc* document = m_editor->document();
+  doc::Sprite* sprite = m_editor->sprite();
+
+  ASSERT(document);
+  ASSERT(sprite);
+
+  if (document && sprite) {
+    document->setExtraCel(ExtraCelRef(nullptr));
+    document->notifySpritePixelsModified(
+      sprite, gfx::Region(m_lastBounds), m_lastFrame);
+  }
+
+  m_withRealPreview = false;
+}
+
 void BrushPreview::discardBrushPreview()
 {
   Doc* document = m_editor->document();
@@ -535,11 +579,15 @@ void BrushPreview::generateBoundaries(const Site& site,
   BrushRef brush = getCurrentBrush();
   Layer* currentLayer = site.layer();
   TilemapMode tilemapMode = site.tilemapMode();
+  const bool isOnePixel =
+    (m_editor->getCurrentEditorTool()->getPointShape(0)->isPixel() ||
+     m_editor->getCurrentEditorTool()->getPointShape(0)->isFloodFill());
 
   if (tilemapMode == TilemapMode::Pixels &&
       tilemapMode == m_lastTilemapMode &&
       !m_brushBoundaries.isEmpty() &&
-      m_brushGen == brush->gen()) {
+      m_brushGen == brush->gen() &&
+      m_brushOnePixel == isOnePixel) {
     return;
   }
   else if (tilemapMode == TilemapMode::Tiles &&
@@ -552,11 +600,9 @@ void BrushPreview::generateBoundaries(const Site& site,
     return;
   }
 
-  const bool isOnePixel =
-    (m_editor->getCurrentEditorTool()->getPointShape(0)->isPixel() ||
-     m_editor->getCurrentEditorTool()->getPointShape(0)->isFloodFill());
   Image* brushImage = brush->image();
   m_brushGen = brush->gen();
+  m_brushOnePixel = isOnePixel;
 
   Image* mask = nullptr;
   bool deleteMask = true;
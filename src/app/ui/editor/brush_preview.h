@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -10,10 +10,13 @@
 #pragma once
 
 #include "app/extra_cel.h"
+#include "app/ui/editor/doc_stamp.h"
 #include "doc/brush.h"
 #include "doc/color.h"
 #include "doc/frame.h"
 #include "doc/mask_boundaries.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
 #include "gfx/color.h"
 #include "gfx/point.h"
 #include "gfx/rect.h"
@@ -36,6 +39,11 @@ namespace app {
   class Editor;
   class Site;
 
+  namespace tools {
+    class Ink;
+    class Tool;
+  }
+
   class BrushPreview {
   public:
     // Brush type
@@ -88,6 +96,47 @@ namespace app {
   private:
     typedef void (BrushPreview::*PixelDelegate)(ui::Graphics*, const gfx::Point&, gfx::Color);
 
+    // Everything that modifies the pixels of the real preview (the
+    // extra cel). If it doesn't change between two calls to show()
+    // (e.g. the mouse is moved inside the same sprite pixel) the same
+    // extra cel is used, and the sprite is not rendered again.
+    struct PreviewKey {
+      gfx::Rect bounds;         // Bounds of the extra cel in the canvas
+      gfx::Point brushPos;
+      doc::frame_t frame = 0;
+      const doc::Layer* layer = nullptr;
+      TilemapMode tilemapMode = TilemapMode::Pixels;
+      int brushGen = 0;
+      doc::color_t brushColor = 0;
+      const tools::Tool* tool = nullptr;
+      const tools::Ink* ink = nullptr;
+      int opacity = 0;
+      doc::ObjectId imageId = doc::NullId;
+      doc::ObjectVersion imageVersion = 0;
+      DocStamp stamp;
+
+      bool operator==(const PreviewKey& o) const {
+        return (bounds == o.bounds &&
+                brushPos == o.brushPos &&
+                frame == o.frame &&
+                layer == o.layer &&
+                tilemapMode == o.tilemapMode &&
+                brushGen == o.brushGen &&
+                brushColor == o.brushColor &&
+                tool == o.tool &&
+                ink == o.ink &&
+                opacity == o.opacity &&
+                imageId == o.imageId &&
+                imageVersion == o.imageVersion &&
+                stamp == o.stamp);
+      }
+    };
+
+    // Hides the brush preview, "keepRealPreview" can be true to keep
+    // the extra cel in the document (it's used in show() to reuse it).
+    void hide(const bool keepRealPreview);
+    void clearRealPreview();
+
     doc::BrushRef getCurrentBrush();
     static doc::color_t getBrushColor(doc::Sprite* sprite, doc::Layer* layer);
 
@@ -129,9 +178,11 @@ namespace app {
     gfx::Point m_screenPosition; // Position in the screen (view)
     gfx::Point m_editorPosition; // Position in the editor (model)
 
-    // Information about current brush
+    // Information about current brush (the boundaries are generated
+    // again only if the brush or the kind of tool changes)
     doc::MaskBoundaries m_brushBoundaries;
     int m_brushGen;
+    bool m_brushOnePixel = false;
 
     // True if we've modified pixels in the display surface
     // (e.g. drawing the selection crosshair or the brush edges).
@@ -152,6 +203,7 @@ namespace app {
     TilemapMode m_lastTilemapMode;
 
     ExtraCelRef m_extraCel;
+    PreviewKey m_previewKey;
   };
 
   class HideBrushPreview {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -11,6 +11,8 @@
 #include "app/ui/editor/delayed_mouse_move.h"
 
 #include "app/ui/editor/editor.h"
+#include "ui/manager.h"
+#include "ui/message.h"
 
 namespace app {
 
@@ -27,6 +29,11 @@ DelayedMouseMove::DelayedMouseMove(DelayedMouseMoveDelegate* delegate,
   m_timer.Tick.connect([this] { commitMouseMove(); });
 }
 
+DelayedMouseMove::~DelayedMouseMove()
+{
+  cancelFrameTick();
+}
+
 void DelayedMouseMove::initSpritePos(const gfx::PointF& pos)
 {
   m_spritePos = pos;
@@ -47,8 +54,8 @@ bool DelayedMouseMove::onMouseMove(const ui::MouseMessage* msg)
       m_timer.start();
     }
     else {
-      // Commit immediately
-      commitMouseMove();
+      // Commit after the other mouse messages of this frame
+      enqueueFrameTick();
     }
   }
   return true;
@@ -56,7 +63,7 @@ bool DelayedMouseMove::onMouseMove(const ui::MouseMessage* msg)
 
 void DelayedMouseMove::onMouseUp(const ui::MouseMessage* msg)
 {
-  if (updateSpritePos(msg))
+  if (updateSpritePos(msg) || m_frameTickPending)
     commitMouseMove();
 }
 
@@ -64,12 +71,14 @@ void DelayedMouseMove::stopTimer()
 {
   if (m_timer.isRunning())
     m_timer.stop();
+  cancelFrameTick();
 }
 
 void DelayedMouseMove::commitMouseMove()
 {
   if (m_timer.isRunning())
     m_timer.stop();
+  cancelFrameTick();
 
   try {
     m_delegate->onCommitMouseMove(m_editor, spritePos());
@@ -103,4 +112,29 @@ bool DelayedMouseMove::updateSpritePos(const ui::MouseMessage* msg)
     return false;
 }
 
+// The tick message is added at the end of the queue, so it's
+// processed after all the mouse messages received in this frame
+// (which are already in the queue) and before the paint messages.
+void DelayedMouseMove::enqueueFrameTick()
+{
+  if (m_frameTickPending)
+    return;
+
+  auto manager = ui::Manager::getDefault();
+  auto msg = new ui::TimerMessage(1, &m_timer);
+  msg->setRecipient(manager);
+  manager->enqueueMessage(msg);
+  m_frameTickPending = true;
+}
+
+void DelayedMouseMove::cancelFrameTick()
+{
+  if (m_frameTickPending) {
+    // m_timer is not running (it has no interval), so
+    // Timer::stop() will not remove this message.
+    ui::Manager::getDefault()->removeMessagesForTimer(&m_timer);
+    m_frameTickPending = false;
+  }
+}
+
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -36,10 +36,13 @@ namespace app {
   class DelayedMouseMove {
   public:
     // The "interval" is given in milliseconds, and can be zero if we
-    // want to disable the delay between onMouseMove() -> onCommitMouseMove()
+    // want to commit the movement once per frame, i.e. after all the
+    // mouse messages already in the queue are processed and before
+    // the screen is redrawn (without an extra delay).
     DelayedMouseMove(DelayedMouseMoveDelegate* delegate,
                      Editor* editor,
                      const int interval);
+    ~DelayedMouseMove();
 
     // In case the event wasn't started with onMouseDown() we can
     // initialize the sprite position directly (e.g. starting a line
@@ -60,11 +63,17 @@ namespace app {
   private:
     void commitMouseMove();
     bool updateSpritePos(const ui::MouseMessage* msg);
+    void enqueueFrameTick();
+    void cancelFrameTick();
 
     DelayedMouseMoveDelegate* m_delegate;
     Editor* m_editor;
     ui::Timer m_timer;
 
+    // True if there is a tick message of m_timer in the queue to
+    // commit the movement at the end of this frame.
+    bool m_frameTickPending = false;
+
     // Position of the mouse in the canvas to avoid redrawing when the
     // mouse position changes (only we redraw when the canvas position
     // changes).
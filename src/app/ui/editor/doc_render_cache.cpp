@@ -0,0 +1,167 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/doc_render_cache.h"
+
+#include "app/doc.h"
+#include "app/doc_event.h"
+
+#include <map>
+
+namespace app {
+
+// Caches of the documents that are being used by editors (only
+// accessed from the UI thread).
+static std::map<Doc*, std::weak_ptr<DocRenderCache>> g_caches;
+
+// static
+std::shared_ptr<DocRenderCache> DocRenderCache::get(Doc* doc)
+{
+  std::shared_ptr<DocRenderCache> cache = g_caches[doc].lock();
+  if (!cache) {
+    cache.reset(new DocRenderCache(doc));
+    g_caches[doc] = cache;
+  }
+  return cache;
+}
+
+DocRenderCache::DocRenderCache(Doc* doc)
+  : m_doc(doc)
+{
+  m_doc->add_observer(this);
+  m_doc->subscribeToPixelsEvents(this);
+}
+
+DocRenderCache::~DocRenderCache()
+{
+  m_doc->unsubscribeFromPixelsEvents(this);
+  m_doc->remove_observer(this);
+
+  auto it = g_caches.find(m_doc);
+  if (it != g_caches.end() && it->second.expired())
+    g_caches.erase(it);
+}
+
+os::SurfaceRef DocRenderCache::frameSurface(const doc::frame_t frame,
+                                            const Options& options) const
+{
+  const DocStamp stamp(m_doc);
+  for (const Entry& entry : m_entries) {
+    if (entry.frame == frame &&
+        entry.surface &&
+        entry.stamp == stamp &&
+        entry.options == options &&
+        entry.surface->colorSpace() == m_doc->osColorSpace())
+      return entry.surface;
+  }
+  return nullptr;
+}
+
+void DocRenderCache::setFrameSurface(const doc::frame_t frame,
+                                     const Options& options,
+                                     const os::SurfaceRef& surface)
+{
+  // Replace the same frame or the oldest one
+  Entry* entry = &m_entries[0];
+  for (Entry& e : m_entries) {
+    if (e.frame == frame) {
+      entry = &e;
+      break;
+    }
+    if (e.age < entry->age)
+      entry = &e;
+  }
+
+  entry->frame = frame;
+  entry->stamp = DocStamp(m_doc);
+  entry->options = options;
+  entry->surface = surface;
+  entry->age = ++m_age;
+}
+
+void DocRenderCache::invalidateFrame(const doc::frame_t frame)
+{
+  for (Entry& entry : m_entries) {
+    if (entry.frame == frame)
+      entry = Entry();
+  }
+}
+
+void DocRenderCache::invalidate()
+{
+  for (Entry& entry : m_entries)
+    entry = Entry();
+}
+
+// Some of these changes are not undoable (e.g. layer visibility) or
+// are notified before the undo state changes (e.g. the preview of a
+// tool loop), so we cannot only rely on the DocStamp.
+
+void DocRenderCache::onGeneralUpdate(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onColorSpaceChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onPixelFormatChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onPaletteChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onSpriteSizeChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onLayerOpacityChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onLayerBlendModeChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onCelOpacityChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onSpritePixelsModified(DocEvent& ev)
+{
+  invalidateFrame(ev.frame());
+}
+
+void DocRenderCache::onTilesetChanged(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onAfterLayerVisibilityChange(DocEvent& ev)
+{
+  invalidate();
+}
+
+void DocRenderCache::onAfterBatchUpdate(DocEvent& ev)
+{
+  invalidate();
+}
+
+} // namespace app
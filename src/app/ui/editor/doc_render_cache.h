@@ -0,0 +1,89 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UI_EDITOR_DOC_RENDER_CACHE_H_INCLUDED
+#define APP_UI_EDITOR_DOC_RENDER_CACHE_H_INCLUDED
+#pragma once
+
+#include "app/doc_observer.h"
+#include "app/ui/editor/doc_stamp.h"
+#include "app/ui/editor/playback_render_ahead.h"
+#include "doc/frame.h"
+#include "os/surface.h"
+
+#include <memory>
+
+namespace app {
+  class Doc;
+
+  // Frames of a document rendered at 100% (sprite resolution) shared
+  // by all editors of the same document (e.g. views created with
+  // "Duplicate View" and the preview window), so each editor only
+  // has to scale the cached surface to its own zoom level instead of
+  // rendering the whole sprite again. Frames are discarded when the
+  // document is modified. It must be used from the UI thread only.
+  class DocRenderCache : public DocObserver {
+  public:
+    // The same options used to render frames in advance.
+    using Options = PlaybackRenderAhead::Options;
+
+    // Maximum number of cached frames per document.
+    static const int kMaxFrames = 4;
+
+    // Returns the cache of the given document, it's created if
+    // there is no other editor using it.
+    static std::shared_ptr<DocRenderCache> get(Doc* doc);
+
+    ~DocRenderCache();
+
+    // Returns the cached frame, or nullptr if it's not available (it
+    // was rendered with other options, in other color space, or
+    // before the last modification of the document).
+    os::SurfaceRef frameSurface(const doc::frame_t frame,
+                                const Options& options) const;
+
+    // Saves the rendered frame (a surface of the sprite size) in the
+    // cache, it replaces the least recently cached frame.
+    void setFrameSurface(const doc::frame_t frame,
+                         const Options& options,
+                         const os::SurfaceRef& surface);
+
+    void invalidateFrame(const doc::frame_t frame);
+    void invalidate();
+
+  private:
+    struct Entry {
+      doc::frame_t frame = -1;
+      DocStamp stamp;
+      Options options;
+      os::SurfaceRef surface;
+      int age = 0;
+    };
+
+    DocRenderCache(Doc* doc);
+
+    // DocObserver impl
+    void onGeneralUpdate(DocEvent& ev) override;
+    void onColorSpaceChanged(DocEvent& ev) override;
+    void onPixelFormatChanged(DocEvent& ev) override;
+    void onPaletteChanged(DocEvent& ev) override;
+    void onSpriteSizeChanged(DocEvent& ev) override;
+    void onLayerOpacityChange(DocEvent& ev) override;
+    void onLayerBlendModeChange(DocEvent& ev) override;
+    void onCelOpacityChange(DocEvent& ev) override;
+    void onSpritePixelsModified(DocEvent& ev) override;
+    void onTilesetChanged(DocEvent& ev) override;
+    void onAfterLayerVisibilityChange(DocEvent& ev) override;
+    void onAfterBatchUpdate(DocEvent& ev) override;
+
+    Doc* m_doc;
+    Entry m_entries[kMaxFrames];
+    int m_age = 0;
+  };
+
+} // namespace app
+
+#endif
@@ -0,0 +1,40 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UI_EDITOR_DOC_STAMP_H_INCLUDED
+#define APP_UI_EDITOR_DOC_STAMP_H_INCLUDED
+#pragma once
+
+#include "app/doc.h"
+#include "app/doc_undo.h"
+#include "doc/object_version.h"
+#include "doc/sprite.h"
+
+namespace app {
+
+  // Identifies the state of the document, a frame rendered in
+  // advance or cached is valid only if the document is in the same
+  // state.
+  struct DocStamp {
+    const undo::UndoState* undoState = nullptr;
+    doc::ObjectVersion spriteVersion = 0;
+
+    DocStamp() { }
+    explicit DocStamp(const Doc* doc)
+      : undoState(doc->undoHistory()->currentState())
+      , spriteVersion(doc->sprite()->version()) {
+    }
+
+    bool operator==(const DocStamp& o) const {
+      return (undoState == o.undoState &&
+              spriteVersion == o.spriteVersion);
+    }
+    bool operator!=(const DocStamp& o) const { return !operator==(o); }
+  };
+
+} // namespace app
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -258,13 +258,6 @@ bool DrawingState::onMouseMove(Editor* editor, MouseMessage* msg)
   // Update velocity sensor.
   m_velocity.updateWithDisplayPoint(msg->position());
 
-  // Update pointer with new mouse position
-  m_lastPointer = tools::Pointer(gfx::Point(m_delayedMouseMove.spritePos()),
-                                 m_velocity.velocity(),
-                                 button_from_msg(msg),
-                                 msg->pointerType(),
-                                 msg->pressure());
-
   // Indicate that we've received a real mouse movement event here
   // (used in the Rectangular Marquee to deselect when we just do a
   // simple click without moving the mouse).
@@ -275,18 +268,44 @@ bool DrawingState::onMouseMove(Editor* editor, MouseMessage* msg)
 
   // Use DelayedMouseMove for tools like line, rectangle, etc. (that
   // use the only the last mouse position) to filter out rapid mouse
-  // movement.
-  m_delayedMouseMove.onMouseMove(msg);
+  // movement, and to process all the movements of freehand tools
+  // once per frame.
+  const bool moved = m_delayedMouseMove.onMouseMove(msg);
+
+  // Update pointer with new mouse position
+  m_lastPointer = tools::Pointer(gfx::Point(m_delayedMouseMove.spritePos()),
+                                 m_velocity.velocity(),
+                                 button_from_msg(msg),
+                                 msg->pointerType(),
+                                 msg->pressure());
+  if (moved)
+    m_pendingPointers.push_back(m_lastPointer);
   return true;
 }
 
 void DrawingState::onCommitMouseMove(Editor* editor,
                                      const gfx::PointF& spritePos)
 {
+  std::vector<tools::Pointer> pointers;
+  std::swap(pointers, m_pendingPointers);
+
   if (m_toolLoop &&
       m_toolLoopManager &&
       !m_toolLoopManager->isCanceled()) {
-    handleMouseMovement();
+    // Tools that use only the last position don't need the
+    // intermediate pointers.
+    if (m_toolLoop->getTracePolicy() == tools::TracePolicy::Last ||
+        pointers.empty()) {
+      handleMouseMovement();
+    }
+    else {
+      // The last pointer can be a different one (e.g. from
+      // onMouseUp())
+      if (pointers.back().point() != m_lastPointer.point())
+        pointers.push_back(m_lastPointer);
+
+      m_toolLoopManager->movement(pointers);
+    }
   }
 }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "base/time.h"
 #include "obs/connection.h"
 #include <memory>
+#include <vector>
 
 namespace app {
   namespace tools {
@@ -100,6 +101,11 @@ namespace app {
     // button when onScrollChange() event is received.
     tools::Pointer m_lastPointer;
 
+    // Pointers received since the last onCommitMouseMove(), all of
+    // them are sent to the ToolLoopManager in one batch (one per
+    // frame).
+    std::vector<tools::Pointer> m_pendingPointers;
+
     // Used to calculate the velocity of the mouse (whch is a sensor
     // to generate dynamic parameters).
     tools::VelocitySensor m_velocity;
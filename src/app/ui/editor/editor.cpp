@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -44,6 +44,7 @@
 #include "app/ui/editor/moving_pixels_state.h"
 #include "app/ui/editor/pixels_movement.h"
 #include "app/ui/editor/play_state.h"
+#include "app/ui/editor/playback_render_ahead.h"
 #include "app/ui/editor/scrolling_state.h"
 #include "app/ui/editor/standby_state.h"
 #include "app/ui/editor/zooming_state.h"
@@ -53,6 +54,7 @@
 #include "app/ui/timeline/timeline.h"
 #include "app/ui/toolbar.h"
 #include "app/ui_context.h"
+#include "app/util/conversion_to_surface.h"
 #include "app/util/layer_utils.h"
 #include "app/util/tile_flags_utils.h"
 #include "base/chrono.h"
@@ -71,8 +73,10 @@
 #include <algorithm>
 #include <cmath>
 #include <cstdio>
+#include <iterator>
 #include <limits>
 #include <memory>
+#include <string>
 
 namespace app {
 
@@ -85,6 +89,61 @@ using namespace render;
 static base::Chrono renderChrono;
 static double renderElapsed = 0.0;
 
+// Minimum size of the surfaces used to draw grids, each one contains
+// the lines of several cells of the grid, so a grid can be drawn
+// with a few blits instead of one line per row/column.
+static const int kGridPatternMinSize = 256;
+
+namespace {
+
+struct GridPattern {
+  gfx::Size cell;
+  gfx::Color color = gfx::ColorNone;
+  os::SurfaceRef surface;
+};
+
+} // anonymous namespace
+
+// Recently used grid patterns (the pixel grid and the grid of a
+// couple of editors).
+static GridPattern g_gridPatterns[4];
+static int g_nextGridPattern = 0;
+
+static os::Surface* get_grid_pattern(const gfx::Size& cell,
+                                     const gfx::Color color)
+{
+  for (const GridPattern& pattern : g_gridPatterns) {
+    if (pattern.surface &&
+        pattern.cell == cell &&
+        pattern.color == color)
+      return pattern.surface.get();
+  }
+
+  const int w = cell.w * ((kGridPatternMinSize+cell.w-1) / cell.w);
+  const int h = cell.h * ((kGridPatternMinSize+cell.h-1) / cell.h);
+  os::SurfaceRef surface = os::instance()->makeRgbaSurface(w, h);
+  {
+    // Same lines drawn by Editor::drawGrid() (first the horizontal
+    // ones, then the vertical ones, so the intersections are blended
+    // twice)
+    os::SurfaceLock lock(surface.get());
+    os::Paint paint;
+    paint.color(color);
+    surface->clear();
+    for (int y=0; y<h; y+=cell.h)
+      surface->drawRect(gfx::Rect(0, y, w, 1), paint);
+    for (int x=0; x<w; x+=cell.w)
+      surface->drawRect(gfx::Rect(x, 0, 1, h), paint);
+  }
+
+  GridPattern& pattern = g_gridPatterns[g_nextGridPattern];
+  g_nextGridPattern = (g_nextGridPattern+1) % int(std::size(g_gridPatterns));
+  pattern.cell = cell;
+  pattern.color = color;
+  pattern.surface = surface;
+  return surface.get();
+}
+
 class EditorPostRenderImpl : public EditorPostRender {
 public:
   EditorPostRenderImpl(Editor* editor, Graphics* g)
@@ -155,6 +214,7 @@ Editor::Editor(Doc* document, EditorFlags flags, EditorStatePtr state)
   , m_padding(0, 0)
   , m_antsTimer(100, this)
   , m_antsOffset(0)
+  , m_damageTimer(0, this)
   , m_customizationDelegate(NULL)
   , m_docView(NULL)
   , m_flags(flags)
@@ -214,6 +274,9 @@ Editor::Editor(Doc* document, EditorFlags flags, EditorStatePtr state)
       [this]{ onShowExtrasChange(); });
 
   m_document->add_observer(this);
+  m_document->subscribeToPixelsEvents(this);
+
+  m_renderCache = DocRenderCache::get(m_document);
 
   m_state->onEnterState(this);
 }
@@ -229,12 +292,14 @@ Editor::~Editor()
   }
 
   m_observers.notifyDestroyEditor(this);
+  m_document->unsubscribeFromPixelsEvents(this);
   m_document->remove_observer(this);
   App::instance()->activeToolManager()->remove_observer(this);
 
   setCustomizationDelegate(NULL);
 
   m_antsTimer.stop();
+  m_damageTimer.stop();
 }
 
 void Editor::destroyEditorSharedInternals()
@@ -242,6 +307,8 @@ void Editor::destroyEditorSharedInternals()
   BrushPreview::destroyInternals();
   if (m_renderEngine)
     m_renderEngine.reset();
+  for (GridPattern& pattern : g_gridPatterns)
+    pattern = GridPattern();
 }
 
 bool Editor::isUsingNewRenderEngine() const
@@ -349,6 +416,11 @@ void Editor::getInvalidDecoratoredRegion(gfx::Region& region)
       region |= gfx::Region(m_perfInfoBounds);
   }
 #endif // ENABLE_DEVMODE
+
+  if (Preferences::instance().perf.showStats()) {
+    if (!m_statsBounds.isEmpty())
+      region |= gfx::Region(m_statsBounds);
+  }
 }
 
 void Editor::setLayer(const Layer* layer)
@@ -644,6 +716,8 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
   if (expose.isEmpty())
     return;
 
+  m_dirtyPixels += int64_t(expose.w) * int64_t(expose.h);
+
   // rc2 is the rectangle used to create a temporal rendered image of the sprite
   const auto& pref = Preferences::instance();
   const bool newEngine = isUsingNewRenderEngine();
@@ -663,6 +737,7 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
 
   // Convert the render to a os::Surface
   static os::SurfaceRef rendered = nullptr; // TODO move this to other centralized place
+  os::SurfaceRef cached;
   const auto& renderProperties = m_renderEngine->properties();
   try {
     // Generate a "expose sprite pixels" notification. This is used by
@@ -670,37 +745,8 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
     // the original cel) before it can be used by the RenderEngine.
     m_document->notifyExposeSpritePixels(m_sprite, gfx::Region(expose));
 
-    m_renderEngine->setNewBlendMethod(pref.experimental.newBlend());
-    m_renderEngine->setRefLayersVisiblity(true);
-    m_renderEngine->setSelectedLayer(m_layer);
-    m_renderEngine->setNonactiveLayersOpacity(otherLayersOpacity());
-    m_renderEngine->setupBackground(m_document, IMAGE_RGB);
-    m_renderEngine->disableOnionskin();
-
-    if ((m_flags & kShowOnionskin) == kShowOnionskin) {
-      if (m_docPref.onionskin.active()) {
-        OnionskinOptions opts(
-          (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
-           render::OnionskinType::MERGE:
-           (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
-            render::OnionskinType::RED_BLUE_TINT:
-            render::OnionskinType::NONE)));
-
-        opts.position(m_docPref.onionskin.position());
-        opts.prevFrames(m_docPref.onionskin.prevFrames());
-        opts.nextFrames(m_docPref.onionskin.nextFrames());
-        opts.opacityBase(m_docPref.onionskin.opacityBase());
-        opts.opacityStep(m_docPref.onionskin.opacityStep());
-        opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
-
-        Tag* tag = nullptr;
-        if (m_docPref.onionskin.loopTag())
-          tag = m_sprite->tags().innerTag(m_frame);
-        opts.loopTag(tag);
-
-        m_renderEngine->setOnionskin(opts);
-      }
-    }
+    m_renderEngine->setStats(&m_renderStats);
+    setupRenderEngine();
 
     ExtraCelRef extraCel = m_document->extraCel();
     if (extraCel &&
@@ -711,6 +757,9 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
         extraCel->image(),
         extraCel->blendMode(),
         m_layer, m_frame);
+
+      if (extraCel->type() == render::ExtraType::TRANSFORM)
+        m_renderEngine->setExtraTransform(extraCel->transform());
     }
 
     // Render background first (e.g. new ShaderRenderer will paint the
@@ -737,10 +786,91 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
         maxw, maxh, m_document->osColorSpace());
     }
 
-    m_renderEngine->setProjection(
-      newEngine ? render::Projection(): m_proj);
-    m_renderEngine->renderSprite(
-      rendered.get(), m_sprite, m_frame, gfx::Clip(0, 0, rc2));
+    // True if the whole frame can be rendered at 100% without
+    // anything specific to this editor (onion skin, extra cel,
+    // preview image, etc.), so it can be rendered in advance or
+    // shared with other editors.
+    const bool plainFrame =
+      (newEngine &&
+       m_renderEngine->type() == EditorRender::Type::kSimpleRenderer &&
+       !renderProperties.renderBgOnScreen &&
+       !(((m_flags & kShowOnionskin) == kShowOnionskin) &&
+         m_docPref.onionskin.active()) &&
+       !(extraCel && extraCel->type() != render::ExtraType::NONE) &&
+       !m_renderEngine->hasPreviewImage());
+
+    // Use the frame rendered in advance (e.g. when the animation is
+    // being played) if it was rendered with the same options.
+    doc::ImageRef renderedAhead;
+    if (m_renderAhead && plainFrame) {
+      renderedAhead = m_renderAhead->frameImage(m_frame,
+                                                renderAheadOptions());
+    }
+
+    // If other editors are showing the same document (e.g. a
+    // duplicated view or the preview window), use the frame rendered
+    // by them, or render the whole frame to share it with them (each
+    // editor just scales the cached surface to its zoom level). In
+    // tiled mode the whole frame is needed for all repetitions anyway.
+    if (!renderedAhead && plainFrame &&
+        (m_renderCache.use_count() > 1 || m_tiledComposite)) {
+      const DocRenderCache::Options options = renderAheadOptions();
+      cached = m_renderCache->frameSurface(m_frame, options);
+      if (!cached) {
+        cached = os::instance()->makeRgbaSurface(
+          m_sprite->width(), m_sprite->height(), m_document->osColorSpace());
+
+        m_document->notifyExposeSpritePixels(
+          m_sprite, gfx::Region(m_sprite->bounds()));
+        m_renderEngine->setProjection(render::Projection());
+        m_renderEngine->renderSprite(
+          cached.get(), m_sprite, m_frame, gfx::Clip(0, 0, m_sprite->bounds()));
+
+        m_renderCache->setFrameSurface(m_frame, options, cached);
+      }
+    }
+    // In tiled mode with an extra cel/preview image (e.g. painting a
+    // seamless texture), the exposed area is rendered only once in
+    // the current paint for all the repetitions of the sprite.
+    else if (!renderedAhead && newEngine && m_tiledComposite &&
+             !renderProperties.renderBgOnScreen) {
+      if (!m_tiledSurface ||
+          m_tiledSurface->width() != m_sprite->width() ||
+          m_tiledSurface->height() != m_sprite->height() ||
+          m_tiledSurface->colorSpace() != m_document->osColorSpace()) {
+        m_tiledSurface = os::instance()->makeRgbaSurface(
+          m_sprite->width(), m_sprite->height(), m_document->osColorSpace());
+        m_tiledRegion.clear();
+      }
+
+      gfx::Region region(rc2);
+      region.createSubtraction(region, m_tiledRegion);
+      if (!region.isEmpty()) {
+        m_renderEngine->setProjection(render::Projection());
+        for (const gfx::Rect& rect : region) {
+          m_renderEngine->renderSprite(
+            m_tiledSurface.get(), m_sprite, m_frame,
+            gfx::Clip(rect.x, rect.y, rect));
+        }
+        m_tiledRegion.createUnion(m_tiledRegion, region);
+      }
+      cached = m_tiledSurface;
+    }
+
+    if (renderedAhead) {
+      convert_image_to_surface(renderedAhead.get(),
+                               m_sprite->palette(m_frame),
+                               rendered.get(),
+                               rc2.x, rc2.y, 0, 0, rc2.w, rc2.h);
+    }
+    // The cached surface is drawn directly (without copying it to the
+    // "rendered" surface)
+    else if (!cached) {
+      m_renderEngine->setProjection(
+        newEngine ? render::Projection(): m_proj);
+      m_renderEngine->renderSprite(
+        rendered.get(), m_sprite, m_frame, gfx::Clip(0, 0, rc2));
+    }
 
     m_renderEngine->removeExtraImage();
 
@@ -752,8 +882,13 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
   catch (const std::exception& e) {
     Console::showException(e);
   }
+  m_renderEngine->setStats(nullptr);
+
+  // Source surface to be drawn in the screen
+  os::Surface* src = (cached ? cached.get(): rendered.get());
+  const gfx::Rect srcBounds = (cached ? rc2: gfx::Rect(0, 0, rc2.w, rc2.h));
 
-  if (rendered && rendered->nativeHandle()) {
+  if (src && src->nativeHandle()) {
     if (newEngine) {
       os::Sampling sampling;
       if (m_proj.scaleX() < 1.0) {
@@ -781,14 +916,14 @@ void Editor::drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& sprite
       else
         p.blendMode(os::BlendMode::Src);
 
-      g->drawSurface(rendered.get(),
-                     gfx::Rect(0, 0, rc2.w, rc2.h),
+      g->drawSurface(src,
+                     srcBounds,
                      dest,
                      sampling,
                      &p);
     }
     else {
-      g->blit(rendered.get(), 0, 0, dest.x, dest.y, dest.w, dest.h);
+      g->blit(src, 0, 0, dest.x, dest.y, dest.w, dest.h);
     }
   }
 
@@ -874,6 +1009,52 @@ void Editor::drawBackground(ui::Graphics* g)
   g->drawHLine(theme->colors.editorSpriteBottomBorder(), rc.x, rc.y2(), rc.w);
 }
 
+void Editor::setupRenderEngine()
+{
+  m_renderEngine->setNewBlendMethod(Preferences::instance().experimental.newBlend());
+  m_renderEngine->setRefLayersVisiblity(true);
+  m_renderEngine->setSelectedLayer(m_layer);
+  m_renderEngine->setNonactiveLayersOpacity(otherLayersOpacity());
+  m_renderEngine->setupBackground(m_document, IMAGE_RGB);
+  m_renderEngine->disableOnionskin();
+
+  if ((m_flags & kShowOnionskin) == kShowOnionskin) {
+    if (m_docPref.onionskin.active()) {
+      OnionskinOptions opts(
+        (m_docPref.onionskin.type() == app::gen::OnionskinType::MERGE ?
+         render::OnionskinType::MERGE:
+         (m_docPref.onionskin.type() == app::gen::OnionskinType::RED_BLUE_TINT ?
+          render::OnionskinType::RED_BLUE_TINT:
+          render::OnionskinType::NONE)));
+
+      opts.position(m_docPref.onionskin.position());
+      opts.prevFrames(m_docPref.onionskin.prevFrames());
+      opts.nextFrames(m_docPref.onionskin.nextFrames());
+      opts.opacityBase(m_docPref.onionskin.opacityBase());
+      opts.opacityStep(m_docPref.onionskin.opacityStep());
+      opts.layer(m_docPref.onionskin.currentLayer() ? m_layer: nullptr);
+
+      Tag* tag = nullptr;
+      if (m_docPref.onionskin.loopTag())
+        tag = m_sprite->tags().innerTag(m_frame);
+      opts.loopTag(tag);
+
+      m_renderEngine->setOnionskin(opts);
+    }
+  }
+}
+
+void Editor::cacheLayersBelowActiveLayer()
+{
+  if (!m_sprite || !m_layer)
+    return;
+
+  setupRenderEngine();
+  m_renderEngine->setProjection(
+    isUsingNewRenderEngine() ? render::Projection(): m_proj);
+  m_renderEngine->cacheLayersBelow(m_sprite, m_frame, m_layer);
+}
+
 void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
 {
   gfx::Rect rc = _rc;
@@ -890,6 +1071,13 @@ void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
     m_proj.applyY(m_sprite->height()));
   gfx::Rect enclosingRect = spriteRect;
 
+  // In tiled mode the sprite is rendered once (in sprite coordinates)
+  // and drawn in each repetition (only with the new engine, the old
+  // one renders the sprite already scaled).
+  m_tiledComposite = (m_docPref.tiled.mode() != filters::TiledMode::NONE &&
+                      isUsingNewRenderEngine());
+  m_tiledRegion.clear();
+
   // Draw the main sprite at the center.
   drawOneSpriteUnclippedRect(g, rc, 0, 0);
 
@@ -919,6 +1107,8 @@ void Editor::drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& _rc)
       spriteRect.w*3, spriteRect.h*3);
   }
 
+  m_tiledComposite = false;
+
   // Draw slices
   if (m_docPref.show.slices())
     drawSlices(g);
@@ -1002,6 +1192,150 @@ void Editor::drawSpriteClipped(const gfx::Region& updateRegion)
   }
 }
 
+void Editor::invalidateSpritePixels(const gfx::Region& spriteRegion)
+{
+  if (spriteRegion.isEmpty())
+    return;
+
+  m_spriteDamage |= spriteRegion;
+  if (!m_damageTimer.isRunning())
+    m_damageTimer.start();
+}
+
+void Editor::drawSpriteDamage()
+{
+  m_damageTimer.stop();
+
+  gfx::Region damage;
+  std::swap(damage, m_spriteDamage);
+  if (!isVisible() || !m_sprite)
+    return;
+
+  damage &= gfx::Region(m_sprite->bounds());
+  if (damage.isEmpty())
+    return;
+
+  try {
+    // Here we don't wait if the document is locked (e.g. a filter is
+    // being applied in a background thread)
+    const DocReader reader(m_document, 0);
+
+    base::Chrono chrono;
+    m_renderStats.reset();
+    m_dirtyPixels = 0;
+    drawSpriteClipped(damage);
+    const double elapsed = chrono.elapsed();
+    updatePaintStats(elapsed, elapsed);
+
+    // The damage could be drawn over the statistics overlay
+    if (Preferences::instance().perf.showStats()) {
+      Region region;
+      getDrawableRegion(region, kCutTopWindows);
+      region.offset(-bounds().origin());
+
+      GraphicsPtr g = getGraphics(clientBounds());
+      for (const gfx::Rect& rc : region) {
+        IntersectClip clip(g.get(), rc);
+        if (clip)
+          drawPaintStats(g.get());
+      }
+    }
+
+#if ENABLE_DEVMODE
+    // Show the damaged rectangles
+    if (Preferences::instance().perf.showDamage()) {
+      Region region;
+      getDrawableRegion(region, kCutTopWindows);
+      region.offset(-bounds().origin());
+
+      GraphicsPtr g = getGraphics(clientBounds());
+      for (const gfx::Rect& rc : region) {
+        IntersectClip clip(g.get(), rc);
+        if (clip) {
+          for (const gfx::Rect& damageRect : damage) {
+            g->drawRect(gfx::rgba(255, 0, 0),
+                        editorToScreen(damageRect).offset(-bounds().origin()));
+          }
+        }
+      }
+    }
+#endif // ENABLE_DEVMODE
+  }
+  catch (const LockedDocException&) {
+    // Defer the rendering using the regular paint messages
+    for (const gfx::Rect& damageRect : damage)
+      defer_invalid_rect(editorToScreen(damageRect));
+  }
+}
+
+void Editor::updatePaintStats(const double renderTime, const double paintTime)
+{
+  // Keep the statistics of the last paint with sprite pixels (e.g. a
+  // paint of the overlay itself doesn't count)
+  if (m_dirtyPixels == 0)
+    return;
+
+  m_paintStats.paintTime = paintTime;
+  m_paintStats.renderTime = renderTime;
+  m_paintStats.cels = m_renderStats.cels;
+  m_paintStats.dirtyPixels = m_dirtyPixels;
+  m_paintStats.compositeHits = m_renderStats.compositeHits;
+  m_paintStats.compositeMisses = m_renderStats.compositeMisses;
+  m_paintStats.mipmapHits = m_renderStats.mipmapHits;
+  m_paintStats.mipmapMisses = m_renderStats.mipmapMisses;
+  m_paintStats.tilemapHits = m_renderStats.tilemapHits;
+  m_paintStats.tilemapMisses = m_renderStats.tilemapMisses;
+  m_paintStats.textureHits = m_renderStats.textureHits;
+  m_paintStats.textureMisses = m_renderStats.textureMisses;
+}
+
+// Draws the statistics of the last paint in the top-right corner of
+// the viewport.
+void Editor::drawPaintStats(ui::Graphics* g)
+{
+  View* view = View::getView(this);
+  if (!view)
+    return;
+
+  auto hitRate = [](const int hits, const int misses) -> std::string {
+    if (hits + misses == 0)
+      return "-";
+    return fmt::format("{}%", 100 * hits / (hits + misses));
+  };
+
+  const PaintStats& st = m_paintStats;
+  const std::string lines[] = {
+    fmt::format("Paint {:.2f}ms Render {:.2f}ms",
+                st.paintTime * 1000.0, st.renderTime * 1000.0),
+    fmt::format("Cels {} Dirty {}px", st.cels, st.dirtyPixels),
+    fmt::format("Hits Composite {} Mipmap {} Tilemap {} Texture {}",
+                hitRate(st.compositeHits, st.compositeMisses),
+                hitRate(st.mipmapHits, st.mipmapMisses),
+                hitRate(st.tilemapHits, st.tilemapMisses),
+                hitRate(st.textureHits, st.textureMisses))
+  };
+
+  gfx::Size size(0, 0);
+  for (const auto& line : lines) {
+    const gfx::Size lineSize = g->measureUIText(line);
+    size.w = std::max(size.w, lineSize.w);
+    size.h += lineSize.h;
+  }
+
+  const gfx::Rect vp = view->viewportBounds();
+  m_statsBounds = gfx::Rect(vp.x2() - size.w, vp.y, size.w, size.h);
+
+  gfx::Point pt = m_statsBounds.origin() - bounds().origin();
+  g->fillRect(gfx::rgba(0, 0, 0, 255), gfx::Rect(pt, size));
+  for (const auto& line : lines) {
+    g->drawText(line,
+                gfx::rgba(255, 255, 255, 255),
+                gfx::rgba(0, 0, 0, 255),
+                pt);
+    pt.y += g->measureUIText(line).h;
+  }
+}
+
 /**
  * Draws the boundaries, really this routine doesn't use the "mask"
  * field of the sprite, only the "bound" field (so you can have other
@@ -1017,13 +1351,7 @@ void Editor::drawMask(Graphics* g)
 
   ASSERT(m_document->hasMaskBoundaries());
 
-  gfx::Point pt = mainTilePosition();
-  pt.x = m_padding.x + m_proj.applyX(pt.x);
-  pt.y = m_padding.y + m_proj.applyY(pt.y);
-
-  // Create the mask boundaries path
-  auto& segs = m_document->maskBoundaries();
-  segs.createPathIfNeeeded();
+  updateAntsPath();
 
   ui::Paint paint;
   paint.style(ui::Paint::Stroke);
@@ -1031,12 +1359,40 @@ void Editor::drawMask(Graphics* g)
                            gfx::rgba(0, 0, 0, 255),
                            gfx::rgba(255, 255, 255, 255));
 
+  g->drawPath(m_antsPath, paint);
+}
+
+void Editor::updateAntsPath()
+{
+  gfx::Point pt = mainTilePosition();
+  pt.x = m_padding.x + m_proj.applyX(pt.x);
+  pt.y = m_padding.y + m_proj.applyY(pt.y);
+
+  auto& segs = m_document->maskBoundaries();
+  if (m_antsVersion == segs.version() &&
+      m_antsScaleX == m_proj.scaleX() &&
+      m_antsScaleY == m_proj.scaleY() &&
+      m_antsOrigin == pt)
+    return;
+
+  // Create the mask boundaries path
+  segs.createPathIfNeeeded();
+
   // We translate the path instead of applying a matrix to the
   // ui::Graphics so the "checkered" pattern is not scaled too.
-  gfx::Path path;
-  segs.path().transform(m_proj.scaleMatrix(), &path);
-  path.offset(pt.x, pt.y);
-  g->drawPath(path, paint);
+  m_antsPath.rewind();
+  segs.path().transform(m_proj.scaleMatrix(), &m_antsPath);
+  m_antsPath.offset(pt.x, pt.y);
+
+  // Bounds of the path (plus one pixel for the stroke)
+  m_antsBounds = m_proj.apply(segs.bounds());
+  m_antsBounds.offset(pt);
+  m_antsBounds.enlarge(1);
+
+  m_antsVersion = segs.version();
+  m_antsScaleX = m_proj.scaleX();
+  m_antsScaleY = m_proj.scaleY();
+  m_antsOrigin = pt;
 }
 
 void Editor::drawMaskSafe()
@@ -1047,9 +1403,15 @@ void Editor::drawMaskSafe()
   if (isVisible() &&
       m_document &&
       m_document->hasMaskBoundaries()) {
+    // Only the area of the selection boundaries is drawn again
+    updateAntsPath();
+
     Region region;
     getDrawableRegion(region, kCutTopWindows);
     region.offset(-bounds().origin());
+    region.createIntersection(region, gfx::Region(m_antsBounds));
+    if (region.isEmpty())
+      return;
 
     HideBrushPreview hide(m_brushPreview);
     GraphicsPtr g = getGraphics(clientBounds());
@@ -1102,6 +1464,48 @@ void Editor::drawGrid(Graphics* g, const gfx::Rect& spriteBounds, const Rect& gr
     gfx::getg(grid_color),
     gfx::getb(grid_color), alpha);
 
+  // Grids with integer cells in screen coordinates (the most common
+  // case) are drawn blitting a cached pattern of lines in the visible
+  // area.
+  if (gridF.x == std::floor(gridF.x) &&
+      gridF.y == std::floor(gridF.y) &&
+      gridF.w == std::floor(gridF.w) &&
+      gridF.h == std::floor(gridF.h) &&
+      gridF.w <= kGridPatternMinSize &&
+      gridF.h <= kGridPatternMinSize) {
+    const gfx::Size cell(int(gridF.w), int(gridF.h));
+    os::Surface* pattern = get_grid_pattern(cell, grid_color);
+    const int pw = pattern->width();
+    const int ph = pattern->height();
+    const int x0 = int(gridF.x);
+    const int y0 = int(gridF.y);
+
+    gfx::Rect area = spriteBounds & g->getClipBounds();
+    if (!area.isEmpty()) {
+      // Align the first pattern with the grid lines
+      const int sx = area.x - (((area.x - x0) % pw) + pw) % pw;
+      const int sy = area.y - (((area.y - y0) % ph) + ph) % ph;
+
+      for (int ty=sy; ty<area.y2(); ty+=ph) {
+        for (int tx=sx; tx<area.x2(); tx+=pw) {
+          const gfx::Rect dst = gfx::Rect(tx, ty, pw, ph) & area;
+          g->drawRgbaSurface(pattern,
+                             dst.x-tx, dst.y-ty,
+                             dst.x, dst.y, dst.w, dst.h);
+        }
+      }
+    }
+
+    // Lines in the right/bottom edge of the sprite
+    const int x2 = spriteBounds.x2();
+    const int y2 = spriteBounds.y2();
+    if (y2 >= y0 && (y2 - y0) % cell.h == 0)
+      g->drawHLine(grid_color, spriteBounds.x, y2, spriteBounds.w);
+    if (x2 >= x0 && (x2 - x0) % cell.w == 0)
+      g->drawVLine(grid_color, x2, spriteBounds.y, spriteBounds.h);
+    return;
+  }
+
   // Draw horizontal lines
   int x1 = spriteBounds.x;
   int y1 = gridF.y;
@@ -1593,6 +1997,21 @@ void Editor::setCustomizationDelegate(EditorCustomizationDelegate* delegate)
   m_customizationDelegate = delegate;
 }
 
+void Editor::setRenderAhead(PlaybackRenderAhead* renderAhead)
+{
+  m_renderAhead = renderAhead;
+}
+
+PlaybackRenderAhead::Options Editor::renderAheadOptions() const
+{
+  PlaybackRenderAhead::Options options;
+  options.newBlend = Preferences::instance().experimental.newBlend();
+  options.selectedLayer = m_layer;
+  options.nonactiveLayersOpacity = otherLayersOpacity();
+  options.bg = EditorRender::bgOptions(m_document, IMAGE_RGB);
+  return options;
+}
+
 Rect Editor::getViewportBounds()
 {
   ui::View* view = View::getView(this);
@@ -1869,11 +2288,11 @@ void Editor::selectSlice(const doc::Slice* slice)
 bool Editor::selectSliceBox(const gfx::Rect& box)
 {
   m_selectedSlices.clear();
-  for (auto slice : m_sprite->slices()) {
-    auto key = slice->getByFrame(m_frame);
-    if (key && key->bounds().intersects(box))
-      m_selectedSlices.insert(slice->id());
-  }
+
+  std::vector<doc::Slice*> slices;
+  m_sprite->slices().pick(m_frame, box, slices);
+  for (auto slice : slices)
+    m_selectedSlices.insert(slice->id());
   invalidate();
 
   if (isActive())
@@ -1924,7 +2343,10 @@ bool Editor::onProcessMessage(Message* msg)
   switch (msg->type()) {
 
     case kTimerMessage:
-      if (static_cast<TimerMessage*>(msg)->timer() == &m_antsTimer) {
+      if (static_cast<TimerMessage*>(msg)->timer() == &m_damageTimer) {
+        drawSpriteDamage();
+      }
+      else if (static_cast<TimerMessage*>(msg)->timer() == &m_antsTimer) {
         if (isVisible() && m_sprite) {
           drawMaskSafe();
 
@@ -2234,6 +2656,16 @@ void Editor::onResize(ui::ResizeEvent& ev)
 
 void Editor::onPaint(ui::PaintEvent& ev)
 {
+  base::Chrono paintChrono;
+
+  // If the whole editor is painted, the accumulated damage is
+  // already included in this paint.
+  if (!m_spriteDamage.isEmpty() &&
+      ev.graphics()->getClipBounds().contains(clientBounds())) {
+    m_spriteDamage.clear();
+    m_damageTimer.stop();
+  }
+
   std::unique_ptr<HideBrushPreview> hide;
   if (m_flashing == Flashing::None) {
     // If we are drawing the editor for a tooltip background or any
@@ -2266,6 +2698,8 @@ void Editor::onPaint(ui::PaintEvent& ev)
 
       // Draw the sprite in the editor
       renderChrono.reset();
+      m_renderStats.reset();
+      m_dirtyPixels = 0;
       drawBackground(g);
       drawSpriteUnclippedRect(g, gfx::Rect(0, 0, m_sprite->width(), m_sprite->height()));
       renderElapsed = renderChrono.elapsed();
@@ -2298,6 +2732,10 @@ void Editor::onPaint(ui::PaintEvent& ev)
       else {
         m_antsTimer.stop();
       }
+
+      updatePaintStats(renderElapsed, paintChrono.elapsed());
+      if (Preferences::instance().perf.showStats())
+        drawPaintStats(g);
     }
     catch (const LockedDocException&) {
       // The sprite is locked, so we cannot render it, we can draw an
@@ -2516,7 +2954,21 @@ EditorHit Editor::calcHit(const gfx::Point& mouseScreenPos)
       if (m_docPref.show.slices()) {
         gfx::Point mainOffset(mainTilePosition());
 
-        for (auto slice : m_sprite->slices()) {
+        // Slices near the mouse position (all hits are inside the
+        // slice bounds, the area is a little bigger to include
+        // rounding errors of editorToScreen())
+        std::vector<doc::Slice*> slices;
+        {
+          const int border = 3*guiscale();
+          gfx::Rect area = screenToEditor(
+            gfx::Rect(mouseScreenPos.x-border, mouseScreenPos.y-border,
+                      2*border+1, 2*border+1));
+          area.offset(-mainOffset);
+          area.enlarge(1);
+          m_sprite->slices().pick(m_frame, area, slices);
+        }
+
+        for (auto slice : slices) {
           auto key = slice->getByFrame(m_frame);
           if (key) {
             gfx::Rect bounds = key->bounds();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,10 +17,12 @@
 #include "app/tools/tool_loop_modifiers.h"
 #include "app/ui/color_source.h"
 #include "app/ui/editor/brush_preview.h"
+#include "app/ui/editor/doc_render_cache.h"
 #include "app/ui/editor/editor_hit.h"
 #include "app/ui/editor/editor_observers.h"
 #include "app/ui/editor/editor_state.h"
 #include "app/ui/editor/editor_states_history.h"
+#include "app/ui/editor/playback_render_ahead.h"
 #include "app/ui/tile_source.h"
 #include "app/util/tiled_mode.h"
 #include "doc/algorithm/flip_type.h"
@@ -29,9 +31,13 @@
 #include "doc/selected_objects.h"
 #include "filters/tiled_mode.h"
 #include "gfx/fwd.h"
+#include "gfx/path.h"
+#include "gfx/region.h"
 #include "obs/connection.h"
 #include "os/color_space.h"
+#include "os/surface.h"
 #include "render/projection.h"
+#include "render/render_stats.h"
 #include "render/zoom.h"
 #include "ui/base.h"
 #include "ui/cursor_type.h"
@@ -39,6 +45,7 @@
 #include "ui/timer.h"
 #include "ui/widget.h"
 
+#include <cstdint>
 #include <memory>
 #include <set>
 
@@ -118,6 +125,29 @@ namespace app {
     bool isActive() const { return (m_activeEditor == this); }
     bool isUsingNewRenderEngine() const;
 
+    // Caches everything below the active layer in the render engine
+    // (called when a ToolLoop starts, so each repaint of the stroke
+    // only blends the active layer and the layers above it).
+    void cacheLayersBelowActiveLayer();
+
+    // Statistics of the last paint that rendered sprite pixels (shown
+    // with the "perf.show_stats" option and available to scripts).
+    struct PaintStats {
+      double paintTime = 0.0;   // Seconds painting the whole editor
+      double renderTime = 0.0;  // Seconds rendering the sprite
+      int cels = 0;
+      int64_t dirtyPixels = 0;  // Sprite pixels rendered
+      int compositeHits = 0;
+      int compositeMisses = 0;
+      int mipmapHits = 0;
+      int mipmapMisses = 0;
+      int tilemapHits = 0;
+      int tilemapMisses = 0;
+      int textureHits = 0;
+      int textureMisses = 0;
+    };
+    const PaintStats& paintStats() const { return m_paintStats; }
+
     DocView* getDocView() { return m_docView; }
     void setDocView(DocView* docView) { m_docView = docView; }
 
@@ -175,6 +205,13 @@ namespace app {
     // Draws the sprite taking care of the whole clipping region.
     void drawSpriteClipped(const gfx::Region& updateRegion);
 
+    // Accumulates the given region (in sprite coordinates) that must
+    // be redrawn. All the regions modified by different sources
+    // (e.g. several notifications of the same command) are drawn
+    // just once with drawSpriteClipped() in the next UI loop
+    // iteration.
+    void invalidateSpritePixels(const gfx::Region& spriteRegion);
+
     void flashCurrentLayer();
 
     // Convert ui::Display coordinates (pixel relative to the top-left
@@ -200,6 +237,11 @@ namespace app {
       return m_customizationDelegate;
     }
 
+    // Frames rendered in advance (e.g. by the PlayState) that can be
+    // used instead of rendering the sprite in each paint.
+    void setRenderAhead(PlaybackRenderAhead* renderAhead);
+    PlaybackRenderAhead::Options renderAheadOptions() const;
+
     // Returns the visible area of the viewport in sprite coordinates.
     gfx::Rect getViewportBounds();
 
@@ -370,7 +412,11 @@ namespace app {
     void drawBackground(ui::Graphics* g);
     void drawSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& rc);
     void drawMaskSafe();
+    void drawSpriteDamage();
+    void drawPaintStats(ui::Graphics* g);
+    void updatePaintStats(const double renderTime, const double paintTime);
     void drawMask(ui::Graphics* g);
+    void updateAntsPath();
     void drawGrid(ui::Graphics* g, const gfx::Rect& spriteBounds, const gfx::Rect& gridBounds,
                   const app::Color& color, int alpha);
     void drawSlices(ui::Graphics* g);
@@ -395,6 +441,7 @@ namespace app {
     // You should setup the clip of the screen before calling this
     // routine.
     void drawOneSpriteUnclippedRect(ui::Graphics* g, const gfx::Rect& rc, int dx, int dy);
+    void setupRenderEngine();
 
     gfx::Point calcExtraPadding(const render::Projection& proj);
 
@@ -436,6 +483,22 @@ namespace app {
     ui::Timer m_antsTimer;
     int m_antsOffset;
 
+    // Selection boundaries in client coordinates (and its bounds),
+    // generated again only when the boundaries, the zoom, or the
+    // position of the sprite change, so each tick of m_antsTimer
+    // only has to draw the path with other dash offset.
+    gfx::Path m_antsPath;
+    gfx::Rect m_antsBounds;
+    int m_antsVersion = -1;
+    double m_antsScaleX = 0.0;
+    double m_antsScaleY = 0.0;
+    gfx::Point m_antsOrigin;
+
+    // Region of the sprite (in sprite coordinates) that must be
+    // redrawn when m_damageTimer ticks.
+    gfx::Region m_spriteDamage;
+    ui::Timer m_damageTimer;
+
     obs::scoped_connection m_samplingChangeConn;
     obs::scoped_connection m_fgColorChangeConn;
     obs::scoped_connection m_contextBarBrushChangeConn;
@@ -454,6 +517,19 @@ namespace app {
 
     EditorCustomizationDelegate* m_customizationDelegate;
 
+    PlaybackRenderAhead* m_renderAhead = nullptr;
+
+    // Frames rendered at 100% shared with other editors of the same
+    // document.
+    std::shared_ptr<DocRenderCache> m_renderCache;
+
+    // In tiled mode, all the repetitions of the sprite are drawn from
+    // this surface (of the sprite size). "m_tiledRegion" is the part
+    // of the sprite already rendered in the current paint.
+    bool m_tiledComposite = false;
+    os::SurfaceRef m_tiledSurface;
+    gfx::Region m_tiledRegion;
+
     DocView* m_docView;
 
     // Last known mouse position received by this editor when the
@@ -488,6 +564,14 @@ namespace app {
     gfx::Rect m_perfInfoBounds;
 #endif
 
+    // Counters of the current paint, and the statistics of the last
+    // one (m_statsBounds is the area of the overlay in screen
+    // coordinates).
+    render::RenderStats m_renderStats;
+    int64_t m_dirtyPixels = 0;
+    PaintStats m_paintStats;
+    gfx::Rect m_statsBounds;
+
     // For slices
     doc::SelectedObjects m_selectedSlices;
 
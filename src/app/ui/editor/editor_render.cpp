@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -15,17 +15,48 @@
 #include "app/pref/preferences.h"
 #include "app/render/shader_renderer.h"
 #include "app/render/simple_renderer.h"
+#include "app/trace.h"
+#include "render/composite_cache.h"
+#include "render/mipmap_cache.h"
+#include "render/reference_cache.h"
+#include "render/tilemap_cache.h"
 
 namespace app {
 
+// Maximum memory used to cache composites of layer groups, reduced
+// images, reference layers, and chunks of tilemaps for zoomed out
+// sprites
+static const std::size_t kCompositeCacheMaxMemory = 128*1024*1024;
+static const std::size_t kMipmapCacheMaxMemory = 128*1024*1024;
+static const std::size_t kReferenceCacheMaxMemory = 64*1024*1024;
+static const std::size_t kTilemapCacheMaxMemory = 64*1024*1024;
+
 static doc::ImageBufferPtr g_renderBuffer;
+static render::CompositeCache g_compositeCache(kCompositeCacheMaxMemory);
+static render::MipmapCache g_mipmapCache(kMipmapCacheMaxMemory);
+static render::ReferenceCache g_referenceCache(kReferenceCacheMaxMemory);
+static render::TilemapCache g_tilemapCache(kTilemapCacheMaxMemory);
+
+// Creates the CPU renderer with the caches that only this renderer
+// supports.
+static std::unique_ptr<SimpleRenderer> create_simple_renderer()
+{
+  auto renderer = std::make_unique<SimpleRenderer>();
+  renderer->setCompositeCache(&g_compositeCache);
+  renderer->setTilemapCache(&g_tilemapCache);
+  return renderer;
+}
 
 EditorRender::EditorRender()
   // TODO create a switch in the preferences
-  : m_renderer(std::make_unique<SimpleRenderer>())
+  : m_renderer(create_simple_renderer())
 {
   m_renderer->setNewBlendMethod(
     Preferences::instance().experimental.newBlend());
+  m_renderer->setMipmapCache(&g_mipmapCache);
+  m_renderer->setReferenceCache(&g_referenceCache);
+  m_renderer->setParallel(true);
+  m_renderer->setStats(m_stats);
 }
 
 EditorRender::~EditorRender()
@@ -50,11 +81,21 @@ void EditorRender::setType(const Type type)
   else
 #endif
   {
-    m_renderer = std::make_unique<SimpleRenderer>();
+    m_renderer = create_simple_renderer();
   }
 
   m_renderer->setNewBlendMethod(
     Preferences::instance().experimental.newBlend());
+  m_renderer->setMipmapCache(&g_mipmapCache);
+  m_renderer->setReferenceCache(&g_referenceCache);
+  m_renderer->setParallel(true);
+  m_hasPreviewImage = false;
+}
+
+void EditorRender::setStats(render::RenderStats* stats)
+{
+  m_stats = stats;
+  m_renderer->setStats(stats);
 }
 
 void EditorRender::setRefLayersVisiblity(const bool visible)
@@ -78,6 +119,12 @@ void EditorRender::setProjection(const render::Projection& projection)
 }
 
 void EditorRender::setupBackground(Doc* doc, doc::PixelFormat pixelFormat)
+{
+  m_renderer->setBgOptions(bgOptions(doc, pixelFormat));
+}
+
+// static
+render::BgOptions EditorRender::bgOptions(Doc* doc, doc::PixelFormat pixelFormat)
 {
   DocumentPreferences& docPref = Preferences::instance().document(doc);
   render::BgType bgType;
@@ -120,7 +167,7 @@ void EditorRender::setupBackground(Doc* doc, doc::PixelFormat pixelFormat)
   bg.color1 = color_utils::color_for_image_without_alpha(docPref.bg.color1(), pixelFormat);
   bg.color2 = color_utils::color_for_image_without_alpha(docPref.bg.color2(), pixelFormat);
   bg.stripeSize = tile;
-  m_renderer->setBgOptions(bg);
+  return bg;
 }
 
 void EditorRender::setTransparentBackground()
@@ -142,11 +189,13 @@ void EditorRender::setPreviewImage(const doc::Layer* layer,
 {
   m_renderer->setPreviewImage(layer, frame, image, tileset,
                               pos, blendMode);
+  m_hasPreviewImage = true;
 }
 
 void EditorRender::removePreviewImage()
 {
   m_renderer->removePreviewImage();
+  m_hasPreviewImage = false;
 }
 
 void EditorRender::setExtraImage(
@@ -161,6 +210,11 @@ void EditorRender::setExtraImage(
                           currentLayer, currentFrame);
 }
 
+void EditorRender::setExtraTransform(const render::ExtraTransform& transform)
+{
+  m_renderer->setExtraTransform(transform);
+}
+
 void EditorRender::removeExtraImage()
 {
   m_renderer->removeExtraImage();
@@ -176,12 +230,25 @@ void EditorRender::disableOnionskin()
   m_renderer->disableOnionskin();
 }
 
+void EditorRender::cacheLayersBelow(
+  const doc::Sprite* sprite,
+  doc::frame_t frame,
+  const doc::Layer* layer)
+{
+  // Only the CPU renderer caches the layers below
+  if (auto renderer = dynamic_cast<SimpleRenderer*>(m_renderer.get())) {
+    APP_TRACE_ZONE("Cache layers below");
+    renderer->cacheLayersBelow(sprite, frame, layer);
+  }
+}
+
 void EditorRender::renderSprite(
   os::Surface* dstSurface,
   const doc::Sprite* sprite,
   doc::frame_t frame,
   const gfx::ClipF& area)
 {
+  APP_TRACE_ZONE("Render sprite");
   m_renderer->renderSprite(dstSurface, sprite, frame, area);
 }
 
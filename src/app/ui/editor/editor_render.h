@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,6 +17,7 @@
 #include "doc/pixel_format.h"
 #include "gfx/clip.h"
 #include "gfx/point.h"
+#include "render/bg_options.h"
 #include "render/extra_type.h"
 #include "render/onionskin_options.h"
 #include "render/projection.h"
@@ -58,9 +59,14 @@ namespace app {
     void setNonactiveLayersOpacity(const int opacity);
     void setNewBlendMethod(const bool newBlend);
 
+    // Counters used by the Editor statistics (it's kept when the
+    // renderer type is changed).
+    void setStats(render::RenderStats* stats);
+
     void setProjection(const render::Projection& projection);
 
     void setupBackground(Doc* doc, doc::PixelFormat pixelFormat);
+    static render::BgOptions bgOptions(Doc* doc, doc::PixelFormat pixelFormat);
     void setTransparentBackground();
 
     void setSelectedLayer(const doc::Layer* layer);
@@ -72,6 +78,7 @@ namespace app {
                          const gfx::Point& pos,
                          const doc::BlendMode blendMode);
     void removePreviewImage();
+    bool hasPreviewImage() const { return m_hasPreviewImage; }
 
     void setExtraImage(
       render::ExtraType type,
@@ -80,11 +87,16 @@ namespace app {
       doc::BlendMode blendMode,
       const doc::Layer* currentLayer,
       doc::frame_t currentFrame);
+    void setExtraTransform(const render::ExtraTransform& transform);
     void removeExtraImage();
 
     void setOnionskin(const render::OnionskinOptions& options);
     void disableOnionskin();
 
+    void cacheLayersBelow(
+      const doc::Sprite* sprite,
+      doc::frame_t frame,
+      const doc::Layer* layer);
     void renderSprite(
       os::Surface* dstSurface,
       const doc::Sprite* sprite,
@@ -107,6 +119,8 @@ namespace app {
 
   private:
     std::unique_ptr<Renderer> m_renderer;
+    render::RenderStats* m_stats = nullptr;
+    bool m_hasPreviewImage = false;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -129,7 +129,7 @@ PixelsMovement::PixelsMovement(
   , m_maskColor(m_site.sprite()->transparentColor())
   , m_canHandleFrameChange(false)
   , m_fastMode(false)
-  , m_needsRotSpriteRedraw(false)
+  , m_needsExactRedraw(false)
 {
   double cornerThick = (m_site.tilemapMode() == TilemapMode::Tiles) ?
                           CORNER_THICK_FOR_TILEMAP_MODE :
@@ -189,10 +189,10 @@ void PixelsMovement::setFastMode(const bool fastMode)
 {
   bool redraw = (m_fastMode && !fastMode);
   m_fastMode = fastMode;
-  if (m_needsRotSpriteRedraw && redraw) {
+  if (m_needsExactRedraw && redraw) {
     redrawExtraImage();
     update_screen_for_document(m_document);
-    m_needsRotSpriteRedraw = false;
+    m_needsExactRedraw = false;
   }
 }
 
@@ -269,7 +269,10 @@ void PixelsMovement::setTransformationBase(const Transformation& t)
   m_currentData = t;
   auto newCorners = m_currentData.transformedCorners();
 
-  redrawExtraImage();
+  if (m_fastMode && canPreviewTransformation())
+    redrawExtraPreview();
+  else
+    redrawExtraImage();
 
   m_document->setTransformation(m_currentData);
 
@@ -1031,6 +1034,57 @@ void PixelsMovement::redrawExtraImage(Transformation* transformation)
   }
 }
 
+// Instead of drawing the transformed pixels in the extra cel, the
+// original image is used as an ExtraType::TRANSFORM extra cel, so
+// the renderer draws it transformed at display resolution. The exact
+// image (with the selected rotation algorithm) is drawn when the
+// fast mode is disabled.
+void PixelsMovement::redrawExtraPreview()
+{
+  int t, opacity = static_cast<LayerImage*>(m_site.layer())->opacity();
+  Cel* cel = m_site.cel();
+  if (cel) opacity = MUL_UN8(opacity, cel->opacity(), t);
+
+  if (!m_extraCel)
+    m_extraCel.reset(new ExtraCel);
+
+  const gfx::Rect bounds = m_currentData.transformedBounds();
+  if (!bounds.isEmpty()) {
+    const auto corners = m_currentData.transformedCorners();
+    render::ExtraTransform transform;
+    transform.leftTop = corners.leftTop();
+    transform.rightTop = corners.rightTop();
+    transform.leftBottom = corners.leftBottom();
+
+    // Same mask color used by drawImage()
+    color_t maskColor = m_maskColor;
+    if (m_opaque)
+      maskColor = (m_originalImage->pixelFormat() == IMAGE_INDEXED ? -1: 0);
+    m_originalImage->setMaskColor(maskColor);
+
+    const Image* maskBitmap = m_initialMask->bitmap();
+    m_extraCel->createTransform(
+      m_originalImage,
+      ImageRef(maskBitmap ? Image::createSharedCopy(maskBitmap): nullptr),
+      transform, bounds, m_site.frame(), opacity);
+    m_extraCel->setBlendMode(
+      static_cast<LayerImage*>(m_site.layer())->blendMode());
+  }
+  else
+    m_extraCel->reset();
+
+  m_document->setExtraCel(m_extraCel);
+  m_needsExactRedraw = true;
+}
+
+bool PixelsMovement::canPreviewTransformation() const
+{
+  return (m_site.tilemapMode() == TilemapMode::Pixels &&
+          m_site.layer() &&
+          m_site.layer()->isImage() &&
+          !m_site.layer()->isTilemap());
+}
+
 void PixelsMovement::redrawCurrentMask()
 {
   drawMask(m_currentMask.get(), true);
@@ -1091,7 +1145,8 @@ void PixelsMovement::drawImage(
     drawParallelogram(
       transformation,
       dst, m_originalImage.get(),
-      m_initialMask.get(), corners, pt);
+      m_initialMask.get(), corners, pt,
+      &m_rotspriteCache);
   }
 }
 
@@ -1114,7 +1169,8 @@ void PixelsMovement::drawMask(doc::Mask* mask, bool shrink)
                     m_initialMask->bitmap(),
                     nullptr,
                     corners,
-                    gfx::PointF(bounds.origin()));
+                    gfx::PointF(bounds.origin()),
+                    &m_rotspriteMaskCache);
   if (shrink)
     mask->unfreeze();
 }
@@ -1123,7 +1179,8 @@ void PixelsMovement::drawParallelogram(
   const Transformation& transformation,
   doc::Image* dst, const doc::Image* src, const doc::Mask* mask,
   const Transformation::Corners& corners,
-  const gfx::PointF& leftTop)
+  const gfx::PointF& leftTop,
+  doc::algorithm::RotSpriteCache* rotspriteCache)
 {
   tools::RotationAlgorithm rotAlgo = Preferences::instance().selection.rotationAlgorithm();
 
@@ -1140,7 +1197,7 @@ void PixelsMovement::drawParallelogram(
 
   // Don't use RotSprite if we are in "fast mode"
   if (rotAlgo == tools::RotationAlgorithm::ROTSPRITE && m_fastMode) {
-    m_needsRotSpriteRedraw = true;
+    m_needsExactRedraw = true;
     rotAlgo = tools::RotationAlgorithm::FAST;
   }
 
@@ -1173,7 +1230,8 @@ retry:;      // In case that we don't have enough memory for RotSprite
           int(corners.rightBottom().x-leftTop.x),
           int(corners.rightBottom().y-leftTop.y),
           int(corners.leftBottom().x-leftTop.x),
-          int(corners.leftBottom().y-leftTop.y));
+          int(corners.leftBottom().y-leftTop.y),
+          rotspriteCache);
       }
       catch (const std::bad_alloc&) {
         StatusBar::instance()->showTip(
@@ -1274,6 +1332,10 @@ void PixelsMovement::hideDocumentMask()
 
 void PixelsMovement::flipOriginalImage(const doc::algorithm::FlipType flipType)
 {
+  // The pixels are modified in place
+  m_rotspriteCache.invalidate();
+  m_rotspriteMaskCache.invalidate();
+
   // Flip the image.
   doc::algorithm::flip_image(
     m_originalImage.get(),
@@ -1292,6 +1354,7 @@ void PixelsMovement::flipOriginalImage(const doc::algorithm::FlipType flipType)
 void PixelsMovement::shiftOriginalImage(const int dx, const int dy,
                                         const double angle)
 {
+  m_rotspriteCache.invalidate();
   doc::algorithm::shift_image(
     m_originalImage.get(), dx, dy, angle);
 }
@@ -1408,6 +1471,8 @@ void PixelsMovement::reproduceAllTransformationsWithInnerCmds()
 
   m_document->setMask(m_initialMask0.get());
   m_initialMask->copyFrom(m_initialMask0.get());
+  m_rotspriteCache.invalidate();
+  m_rotspriteMaskCache.invalidate();
   m_originalImage.reset(
     new_image_from_mask(
       m_site, m_initialMask.get(),
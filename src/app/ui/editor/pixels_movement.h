@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -16,6 +16,7 @@
 #include "app/tx.h"
 #include "app/ui/editor/handle_type.h"
 #include "doc/algorithm/flip_type.h"
+#include "doc/algorithm/rotsprite.h"
 #include "doc/frame.h"
 #include "doc/image_ref.h"
 #include "gfx/size.h"
@@ -139,6 +140,8 @@ namespace app {
     void onPivotChange();
     void onRotationAlgorithmChange();
     void redrawExtraImage(Transformation* transformation = nullptr);
+    void redrawExtraPreview();
+    bool canPreviewTransformation() const;
     void redrawCurrentMask();
     void drawImage(
       const Transformation& transformation,
@@ -149,7 +152,8 @@ namespace app {
       const Transformation& transformation,
       doc::Image* dst, const doc::Image* src, const doc::Mask* mask,
       const Transformation::Corners& corners,
-      const gfx::PointF& leftTop);
+      const gfx::PointF& leftTop,
+      doc::algorithm::RotSpriteCache* rotspriteCache);
     void drawTransformedTilemap(
       const Transformation& transformation,
       doc::Image* dst, const doc::Image* src, const doc::Mask* mask);
@@ -188,9 +192,16 @@ namespace app {
     bool m_canHandleFrameChange;
 
     // Fast mode is used to give a faster feedback to the user
-    // avoiding RotSprite on each mouse movement.
+    // avoiding RotSprite and drawing the transformed image on each
+    // mouse movement (the renderer previews the transformation).
     bool m_fastMode;
-    bool m_needsRotSpriteRedraw;
+    bool m_needsExactRedraw;
+
+    // Upscaled copies of m_originalImage/m_initialMask (and of the
+    // mask bitmap for drawMask()) reused by RotSprite on each step of
+    // the transformation.
+    doc::algorithm::RotSpriteCache m_rotspriteCache;
+    doc::algorithm::RotSpriteCache m_rotspriteMaskCache;
 
     // Commands used in the interaction with the transformed pixels.
     // This is used to re-create the whole interaction on each
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2023  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -26,6 +26,9 @@
 #include "ui/message.h"
 #include "ui/system.h"
 
+#include <algorithm>
+#include <vector>
+
 namespace app {
 
 using namespace ui;
@@ -118,6 +121,11 @@ void PlayState::onEnterState(Editor* editor)
     m_curFrameTick = base::current_tick();
     m_playTimer.start();
   }
+
+  if (!m_renderAhead)
+    m_renderAhead = std::make_unique<PlaybackRenderAhead>(m_editor->document());
+  m_editor->setRenderAhead(m_renderAhead.get());
+  renderNextFrames();
 }
 
 EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* newState)
@@ -127,6 +135,9 @@ EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* ne
   if (!m_toScroll) {
     m_playTimer.stop();
 
+    m_editor->setRenderAhead(nullptr);
+    m_renderAhead.reset();
+
     if (m_playOnce || Preferences::instance().general.rewindOnStop())
       m_editor->setFrame(m_refFrame);
   }
@@ -136,6 +147,10 @@ EditorState::LeaveAction PlayState::onLeaveState(Editor* editor, EditorState* ne
 void PlayState::onBeforePopState(Editor* editor)
 {
   m_ctxConn.disconnect();
+  if (m_renderAhead) {
+    editor->setRenderAhead(nullptr);
+    m_renderAhead.reset();
+  }
   StateWithWheelBehavior::onBeforePopState(editor);
 }
 
@@ -221,6 +236,7 @@ void PlayState::onPlaybackTick()
 
   m_nextFrameTime -= (base::current_tick() - m_curFrameTick);
 
+  const doc::frame_t oldFrame = m_editor->frame();
   while (m_nextFrameTime <= 0) {
     doc::frame_t frame = m_playback.nextFrame();
     if (m_playback.isStopped() ||
@@ -236,6 +252,35 @@ void PlayState::onPlaybackTick()
   }
 
   m_curFrameTick = base::current_tick();
+
+  if (m_playTimer.isRunning() && m_editor->frame() != oldFrame)
+    renderNextFrames();
+}
+
+// Renders the frames that will be displayed after the current one
+// in background threads, so the editor doesn't need to render them
+// when it's painted.
+void PlayState::renderNextFrames()
+{
+  if (!m_renderAhead)
+    return;
+
+  const doc::frame_t lastFrame = m_editor->sprite()->lastFrame();
+  std::vector<doc::frame_t> frames;
+  frames.push_back(m_editor->frame());
+
+  doc::Playback playback = m_playback;
+  while (int(frames.size()) < PlaybackRenderAhead::kMaxFrames) {
+    const doc::frame_t frame = playback.nextFrame();
+    if (playback.isStopped() ||
+        frame < 0 || frame > lastFrame ||
+        // The animation is looping (e.g. a short tag)
+        std::find(frames.begin(), frames.end(), frame) != frames.end())
+      break;
+    frames.push_back(frame);
+  }
+
+  m_renderAhead->renderFrames(frames, m_editor->renderAheadOptions());
 }
 
 // Before executing any command, we stop the animation
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2022  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -9,6 +9,7 @@
 #define APP_UI_EDITOR_PLAY_STATE_H_INCLUDED
 #pragma once
 
+#include "app/ui/editor/playback_render_ahead.h"
 #include "app/ui/editor/state_with_wheel_behavior.h"
 #include "base/time.h"
 #include "doc/frame.h"
@@ -16,6 +17,8 @@
 #include "obs/connection.h"
 #include "ui/timer.h"
 
+#include <memory>
+
 namespace doc {
   class Tag;
 }
@@ -45,6 +48,7 @@ namespace app {
 
   private:
     void onPlaybackTick();
+    void renderNextFrames();
 
     // ContextObserver
     void onBeforeCommandExecution(CommandExecutionEvent& ev);
@@ -68,6 +72,9 @@ namespace app {
     doc::Tag* m_tag;
 
     obs::scoped_connection m_ctxConn;
+
+    // Next frames of the animation rendered in background threads.
+    std::unique_ptr<PlaybackRenderAhead> m_renderAhead;
   };
 
 } // namespace app
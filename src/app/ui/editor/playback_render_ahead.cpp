@@ -0,0 +1,208 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/ui/editor/playback_render_ahead.h"
+
+#include "app/doc.h"
+#include "app/doc_access.h"
+#include "app/ui/editor/doc_stamp.h"
+#include "base/thread_pool.h"
+#include "doc/image.h"
+#include "doc/sprite.h"
+#include "render/render.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace app {
+
+static base::thread_pool& render_ahead_thread_pool()
+{
+  static base::thread_pool pool(
+    std::clamp(int(std::thread::hardware_concurrency())-1, 1, 4));
+  return pool;
+}
+
+namespace {
+
+struct Slot {
+  doc::frame_t frame = -1;
+  bool rendering = false;
+  doc::ImageRef image;
+  DocStamp stamp;
+  PlaybackRenderAhead::Options options;
+};
+
+} // anonymous namespace
+
+bool PlaybackRenderAhead::Options::operator==(const Options& o) const
+{
+  return (newBlend == o.newBlend &&
+          selectedLayer == o.selectedLayer &&
+          nonactiveLayersOpacity == o.nonactiveLayersOpacity &&
+          bg.type == o.bg.type &&
+          bg.zoom == o.bg.zoom &&
+          bg.colorPixelFormat == o.bg.colorPixelFormat &&
+          bg.color1 == o.bg.color1 &&
+          bg.color2 == o.bg.color2 &&
+          bg.stripeSize == o.bg.stripeSize);
+}
+
+struct PlaybackRenderAhead::State {
+  Doc* doc;
+
+  // Ring of rendered frames, all fields are protected by the mutex.
+  std::mutex mutex;
+  std::condition_variable cv;
+  Slot slots[kMaxFrames];
+
+  // Incremented each time the frames are cleared, so the results of
+  // the background threads of a previous generation are discarded.
+  int generation = 0;
+
+  // Number of background threads using the document.
+  int running = 0;
+
+  State(Doc* doc) : doc(doc) { }
+};
+
+PlaybackRenderAhead::PlaybackRenderAhead(Doc* doc)
+  : m_state(std::make_shared<State>(doc))
+{
+}
+
+PlaybackRenderAhead::~PlaybackRenderAhead()
+{
+  clear();
+}
+
+void PlaybackRenderAhead::renderFrames(const std::vector<doc::frame_t>& frames,
+                                       const Options& options)
+{
+  State* state = m_state.get();
+  const DocStamp stamp(state->doc);
+  const std::lock_guard lock(state->mutex);
+
+  for (const doc::frame_t frame : frames) {
+    Slot* slot = nullptr;
+    for (Slot& s : state->slots) {
+      if (s.frame == frame) {
+        slot = &s;
+        break;
+      }
+    }
+
+    if (slot) {
+      // Already rendered (or being rendered) with the same state
+      if (slot->rendering ||
+          (slot->stamp == stamp && slot->options == options))
+        continue;
+    }
+    else {
+      // Re-use a slot that is not needed anymore
+      for (Slot& s : state->slots) {
+        if (!s.rendering &&
+            std::find(frames.begin(), frames.end(), s.frame) == frames.end()) {
+          slot = &s;
+          break;
+        }
+      }
+      if (!slot)
+        break;
+    }
+
+    slot->frame = frame;
+    slot->rendering = true;
+    slot->image.reset();
+    slot->stamp = stamp;
+    slot->options = options;
+
+    std::weak_ptr<State> weakState(m_state);
+    render_ahead_thread_pool().execute(
+      [weakState, generation = state->generation,
+       slot, frame, stamp, options]{
+        auto state = weakState.lock();
+        if (!state)
+          return;
+        {
+          const std::lock_guard lock(state->mutex);
+          if (state->generation != generation)
+            return;
+          ++state->running;
+        }
+
+        doc::ImageRef image;
+        try {
+          const DocReader reader(state->doc, 0);
+          const doc::Sprite* sprite = state->doc->sprite();
+          if (DocStamp(state->doc) == stamp &&
+              frame >= 0 && frame <= sprite->lastFrame()) {
+            image.reset(doc::Image::create(doc::IMAGE_RGB,
+                                           sprite->width(),
+                                           sprite->height()));
+
+            // Same render options used by the editor (SimpleRenderer)
+            render::Render render;
+            render.setNewBlend(options.newBlend);
+            render.setRefLayersVisiblity(true);
+            render.setSelectedLayer(options.selectedLayer);
+            render.setNonactiveLayersOpacity(options.nonactiveLayersOpacity);
+            render.setBgOptions(options.bg);
+            render.renderSprite(image.get(), sprite, frame);
+          }
+        }
+        catch (const LockedDocException&) {
+          // Do nothing, we'll try again in the next tick
+        }
+
+        const std::lock_guard lock(state->mutex);
+        if (state->generation == generation) {
+          slot->rendering = false;
+          if (image)
+            slot->image = image;
+          else
+            slot->frame = -1;
+        }
+        --state->running;
+        state->cv.notify_all();
+      });
+  }
+}
+
+doc::ImageRef PlaybackRenderAhead::frameImage(const doc::frame_t frame,
+                                              const Options& options)
+{
+  State* state = m_state.get();
+  const DocStamp stamp(state->doc);
+  const std::lock_guard lock(state->mutex);
+  for (const Slot& slot : state->slots) {
+    if (slot.frame == frame &&
+        !slot.rendering &&
+        slot.image &&
+        slot.stamp == stamp &&
+        slot.options == options)
+      return slot.image;
+  }
+  return nullptr;
+}
+
+void PlaybackRenderAhead::clear()
+{
+  State* state = m_state.get();
+  std::unique_lock lock(state->mutex);
+  ++state->generation;
+  for (Slot& slot : state->slots)
+    slot = Slot();
+  state->cv.wait(lock, [state]{ return state->running == 0; });
+}
+
+} // namespace app
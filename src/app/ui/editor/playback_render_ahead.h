@@ -0,0 +1,71 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UI_EDITOR_PLAYBACK_RENDER_AHEAD_H_INCLUDED
+#define APP_UI_EDITOR_PLAYBACK_RENDER_AHEAD_H_INCLUDED
+#pragma once
+
+#include "doc/frame.h"
+#include "doc/image_ref.h"
+#include "render/bg_options.h"
+
+#include <memory>
+#include <vector>
+
+namespace doc {
+  class Layer;
+}
+
+namespace app {
+  class Doc;
+
+  // Renders the next frames of the animation in background threads
+  // while the editor is playing it, so complex frames are ready when
+  // PlayState changes the frame in the playback tick. Frames are
+  // rendered at 100% (the editor scales the rendered sprite to the
+  // current zoom), and are discarded when the document is modified.
+  class PlaybackRenderAhead {
+  public:
+    // Render options used by the editor that must be used to render
+    // the frames in advance.
+    struct Options {
+      bool newBlend = false;
+      const doc::Layer* selectedLayer = nullptr;
+      int nonactiveLayersOpacity = 255;
+      render::BgOptions bg;
+
+      bool operator==(const Options& o) const;
+      bool operator!=(const Options& o) const { return !operator==(o); }
+    };
+
+    // Maximum number of frames rendered in advance.
+    static const int kMaxFrames = 8;
+
+    PlaybackRenderAhead(Doc* doc);
+    ~PlaybackRenderAhead();
+
+    // Starts rendering the given frames (the next ones to be played)
+    // with the given options, other frames are discarded.
+    void renderFrames(const std::vector<doc::frame_t>& frames,
+                      const Options& options);
+
+    // Returns the rendered frame, or nullptr if it's not ready yet (or
+    // it was rendered with other options or before the last
+    // modification of the document).
+    doc::ImageRef frameImage(const doc::frame_t frame,
+                             const Options& options);
+
+    // Discards all rendered frames and waits the background threads.
+    void clear();
+
+  private:
+    struct State;
+    std::shared_ptr<State> m_state;
+  };
+
+} // namespace app
+
+#endif
@@ -621,19 +621,19 @@ bool StandbyState::onUpdateStatusBar(Editor* editor)
 
     if (editor->docPref().show.slices()) {
       int count = 0;
-      for (auto slice : editor->document()->sprite()->slices()) {
-        auto key = slice->getByFrame(editor->frame());
-        if (key &&
-            key->bounds().contains(
-              int(std::floor(spritePos.x)),
-              int(std::floor(spritePos.y)))) {
-          if (++count == 3) {
-            buf += fmt::format(" :slice: ...");
-            break;
-          }
-
-          buf += fmt::format(" :slice: {}", slice->name());
+      std::vector<doc::Slice*> slices;
+      editor->document()->sprite()->slices().pick(
+        editor->frame(),
+        gfx::Point(int(std::floor(spritePos.x)),
+                   int(std::floor(spritePos.y))),
+        slices);
+      for (auto slice : slices) {
+        if (++count == 3) {
+          buf += fmt::format(" :slice: ...");
+          break;
         }
+
+        buf += fmt::format(" :slice: {}", slice->name());
       }
     }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -584,8 +584,10 @@ public:
                                          gfx::Point(0, 0));
 
 #ifdef ENABLE_UI
-    if (m_editor)
+    if (m_editor) {
       m_editor->add_observer(this);
+      m_editor->cacheLayersBelowActiveLayer();
+    }
 #endif
   }
 
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -23,6 +23,7 @@
 #include <algorithm>
 #include <cctype>
 #include <cstring>
+#include <vector>
 
 #define ISEARCH_KEYPRESS_INTERVAL_MSECS 500
 
@@ -44,6 +45,7 @@ FileList::FileList()
   , m_multiselect(false)
   , m_zoom(1.0)
   , m_itemsPerRow(0)
+  , m_lastChildrenUpdate(0)
 {
   setFocusStop(true);
   setDoubleBuffered(true);
@@ -52,6 +54,9 @@ FileList::FileList()
   m_monitoringTimer.Tick.connect(&FileList::onMonitoringTick, this);
   m_monitoringTimer.start();
 
+  m_itemRemovedConn = FileSystemModule::instance()->ItemRemoved.connect(
+    &FileList::onFileItemRemoved, this);
+
   regenerateList();
 }
 
@@ -83,6 +88,11 @@ void FileList::setCurrentFolder(IFileItem* folder)
   m_req_valid = false;
   m_selected = nullptr;
 
+  // Load the folder content in background, meanwhile we show the
+  // content that was loaded the last time (if any)
+  m_currentFolder->loadChildrenAsync();
+  m_lastChildrenUpdate = base::current_tick();
+
   regenerateList();
 
   // As now we are in other folder, we can stop the generation of all
@@ -661,19 +671,66 @@ void FileList::onCurrentFolderChanged()
 
 void FileList::onMonitoringTick()
 {
+  if (m_currentFolder->isLoadingChildren())
+    updateCurrentFolderChildren();
+
+  // Launch thumbnail generators in small batches (the formats of
+  // each batch are probed at once)
+  const std::size_t kBatchSize = 16;
+  std::vector<IFileItem*> batch;
   auto start = base::current_tick();
   while (!m_generateThumbnailsForTheseItems.empty() &&
          // No more than 200ms launching thumbnail generators
          base::current_tick() - start < 200) {
-    auto fi = m_generateThumbnailsForTheseItems.front();
-    m_generateThumbnailsForTheseItems.pop_front();
-    ThumbnailGenerator::instance()->generateThumbnail(fi);
+    batch.clear();
+    while (!m_generateThumbnailsForTheseItems.empty() &&
+           batch.size() < kBatchSize) {
+      batch.push_back(m_generateThumbnailsForTheseItems.front());
+      m_generateThumbnailsForTheseItems.pop_front();
+    }
+    ThumbnailGenerator::instance()->generateThumbnails(batch);
   }
 
   if (ThumbnailGenerator::instance()->checkWorkers())
     invalidate();
 }
 
+void FileList::onFileItemRemoved(IFileItem* fi)
+{
+  if (m_selected == fi)
+    m_selected = nullptr;
+  if (m_itemToGenerateThumbnail == fi)
+    m_itemToGenerateThumbnail = nullptr;
+
+  auto it = std::find(m_generateThumbnailsForTheseItems.begin(),
+                      m_generateThumbnailsForTheseItems.end(), fi);
+  if (it != m_generateThumbnailsForTheseItems.end())
+    m_generateThumbnailsForTheseItems.erase(it);
+}
+
+void FileList::updateCurrentFolderChildren()
+{
+  // Don't regenerate the whole list too frequently while the
+  // entries are being loaded (each regeneration measures all items)
+  if (m_currentFolder->isLoadingChildren() &&
+      base::current_tick() - m_lastChildrenUpdate < 250)
+    return;
+
+  if (!m_currentFolder->updateChildren())
+    return;
+
+  m_lastChildrenUpdate = base::current_tick();
+  m_req_valid = false;
+  regenerateList();
+
+  // Select the first folder (like in setCurrentFolder())
+  if (!m_selected && !m_list.empty() && m_list.front()->isBrowsable())
+    selectIndex(0);
+
+  invalidate();
+  View::getView(this)->updateView();
+}
+
 void FileList::onGenerateThumbnailTick()
 {
   m_generateThumbnailTimer.stop();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "app/file_system.h"
 #include "base/paths.h"
 #include "base/time.h"
+#include "obs/connection.h"
 #include "obs/signal.h"
 #include "ui/animated_widget.h"
 #include "ui/timer.h"
@@ -82,6 +83,8 @@ namespace app {
     void paintItem(ui::Graphics* g, IFileItem* fi, const int i);
     void onGenerateThumbnailTick();
     void onMonitoringTick();
+    void onFileItemRemoved(IFileItem* fi);
+    void updateCurrentFolderChildren();
     void recalcAllFileItemInfo();
     ItemInfo calcFileItemInfo(int i) const;
     ItemInfo getFileItemInfo(int i) const;
@@ -137,6 +140,12 @@ namespace app {
     double m_toZoom;
 
     int m_itemsPerRow;
+
+    // Last time the list was regenerated with the entries loaded in
+    // background for the current folder.
+    base::tick_t m_lastChildrenUpdate;
+
+    obs::scoped_connection m_itemRemovedConn;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2022  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -36,6 +36,7 @@
 #include "fmt/format.h"
 #include "gfx/color.h"
 #include "gfx/point.h"
+#include "gfx/region.h"
 #include "os/font.h"
 #include "os/surface.h"
 #include "os/surface.h"
@@ -53,13 +54,18 @@
 #include <algorithm>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <set>
+#include <vector>
 
 namespace app {
 
 using namespace ui;
 using namespace app::skin;
 
+// Max number of pixels of the PaletteView cached surface (32MB)
+static constexpr int kMaxEntriesSurfacePixels = 8*1024*1024;
+
 // Interface used to adapt the PaletteView widget to see tilesets too.
 class AbstractPaletteViewAdapter {
 public:
@@ -88,6 +94,10 @@ public:
                          const int childSpacing,
                          gfx::Rect& box,
                          gfx::Color& negColor) = 0;
+  // Fills the stamp of the first "n" entries, used to know which
+  // entries must be redrawn in the cached surface.
+  virtual void entryStamps(const int n,
+                           std::vector<PaletteView::EntryStamp>& stamps) = 0;
   virtual doc::Tileset* tileset() const { return nullptr; }
 };
 
@@ -190,6 +200,15 @@ public:
       rgba_geta(palColor));
     negColor = color_utils::blackandwhite_neg(gfxColor);
   }
+  void entryStamps(const int n,
+                   std::vector<PaletteView::EntryStamp>& stamps) override {
+    const doc::Palette* palette = this->palette();
+    stamps.resize(n);
+    for (int i=0; i<n; ++i) {
+      stamps[i].color =
+        (i < palette->size() ? palette->getEntry(i): rgba(0, 0, 0, 255));
+    }
+  }
 private:
   doc::Palette* palette() const {
     return get_current_palette();
@@ -210,10 +229,20 @@ public:
     // Do nothing
   }
   void activeSiteChange(const Site& site, doc::PalettePicks& picks) override {
-    if (auto tileset = this->tileset())
+    auto tileset = this->tileset();
+    if (tileset)
       picks.resize(tileset->size());
     else
       picks.clear();
+
+    // Release thumbnails of tiles that don't exist anymore
+    const int n = (tileset ? tileset->size(): 0);
+    for (int i=n; i<int(m_thumbnails.size()); ++i) {
+      if (const os::SurfaceRef& surface = m_thumbnails[i].surface)
+        m_thumbnailsPixels -= surface->width() * surface->height();
+    }
+    if (n < int(m_thumbnails.size()))
+      m_thumbnails.resize(n);
   }
   void clearSelection(PaletteView* paletteView,
                       doc::PalettePicks& picks) override {
@@ -311,9 +340,7 @@ public:
     if (tileImage) {
       int w = tileImage->width();
       int h = tileImage->height();
-      os::SurfaceRef surface = os::instance()->makeRgbaSurface(w, h);
-      convert_image_to_surface(tileImage.get(), get_current_palette(),
-                               surface.get(), 0, 0, 0, 0, w, h);
+      os::SurfaceRef surface = thumbnail(palIdx, tileImage.get());
 
       ui::Paint paint;
       paint.blendMode(os::BlendMode::SrcOver);
@@ -329,6 +356,24 @@ public:
     }
     negColor = gfx::rgba(255, 255, 255);
   }
+  void entryStamps(const int n,
+                   std::vector<PaletteView::EntryStamp>& stamps) override {
+    const doc::Tileset* tileset = this->tileset();
+    const int palModifications = get_current_palette()->getModifications();
+    stamps.resize(n);
+    for (int i=0; i<n; ++i) {
+      PaletteView::EntryStamp& stamp = stamps[i];
+      stamp = PaletteView::EntryStamp();
+      if (!tileset)
+        continue;
+
+      if (const doc::ImageRef tileImage = tileset->get(i)) {
+        stamp.imageId = tileImage->id();
+        stamp.imageVersion = tileImage->version();
+        stamp.palModifications = palModifications;
+      }
+    }
+  }
   doc::Tileset* tileset() const override {
     Site site = App::instance()->context()->activeSite();
     if (site.layer() &&
@@ -339,6 +384,69 @@ public:
       return nullptr;
   }
 private:
+  // Returns the tile image converted to a RGBA surface. Thumbnails
+  // are cached by tile image version (and palette modifications, as
+  // indexed tiles depend on the palette), so we convert each tile
+  // again only when its pixels are modified.
+  os::SurfaceRef thumbnail(const doc::tile_index ti,
+                           const doc::Image* tileImage) {
+    const doc::Palette* palette = get_current_palette();
+    const int w = tileImage->width();
+    const int h = tileImage->height();
+
+    if (ti >= int(m_thumbnails.size()))
+      m_thumbnails.resize(ti+1);
+
+    Thumbnail& thumb = m_thumbnails[ti];
+    if (thumb.surface &&
+        thumb.imageId == tileImage->id() &&
+        thumb.imageVersion == tileImage->version() &&
+        thumb.palModifications == palette->getModifications()) {
+      return thumb.surface;
+    }
+
+    os::SurfaceRef surface;
+    if (thumb.surface &&
+        thumb.surface->width() == w &&
+        thumb.surface->height() == h) {
+      surface = thumb.surface;
+    }
+    else {
+      surface = os::instance()->makeRgbaSurface(w, h);
+    }
+    convert_image_to_surface(tileImage, palette,
+                             surface.get(), 0, 0, 0, 0, w, h);
+
+    if (thumb.surface != surface) {
+      if (thumb.surface) {
+        m_thumbnailsPixels -= thumb.surface->width() * thumb.surface->height();
+        thumb.surface.reset();
+      }
+      // Don't keep more thumbnails if the cache is already full
+      if (m_thumbnailsPixels + w*h > kMaxThumbnailsPixels)
+        return surface;
+      m_thumbnailsPixels += w*h;
+    }
+
+    thumb.imageId = tileImage->id();
+    thumb.imageVersion = tileImage->version();
+    thumb.palModifications = palette->getModifications();
+    thumb.surface = surface;
+    return surface;
+  }
+
+  struct Thumbnail {
+    doc::ObjectId imageId = doc::NullId;
+    doc::ObjectVersion imageVersion = 0;
+    int palModifications = 0;
+    os::SurfaceRef surface;
+  };
+
+  // Max number of pixels of all cached thumbnails (32MB)
+  static constexpr int kMaxThumbnailsPixels = 8*1024*1024;
+
+  std::vector<Thumbnail> m_thumbnails;
+  int m_thumbnailsPixels = 0;
 };
 
 PaletteView::PaletteView(bool editable, PaletteViewStyle style, PaletteViewDelegate* delegate, int boxsize)
@@ -362,7 +470,10 @@ PaletteView::PaletteView(bool editable, PaletteViewStyle style, PaletteViewDeleg
 
   m_palConn = App::instance()->PaletteChange.connect(&PaletteView::onAppPaletteChange, this);
   m_csConn = App::instance()->ColorSpaceChange.connect(
-    [this]{ invalidate(); });
+    [this]{
+      invalidateEntriesSurface();
+      invalidate();
+    });
 
   {
     auto& entriesSep = Preferences::instance().colorBar.entriesSeparator;
@@ -774,8 +885,12 @@ bool PaletteView::onProcessMessage(Message* msg)
         // Redraw only when we put the mouse in other part of the
         // widget (e.g. if we move from color to color, we don't want
         // to redraw the whole widget if we're on WAITING state).
-        if ((m_state == State::WAITING && hit.part != m_hot.part) ||
-            (m_state != State::WAITING && hit != m_hot)) {
+        if (m_state == State::WAITING && hit.part != m_hot.part) {
+          // Only the selection outline depends on the hot part
+          if (hit.part == Hit::OUTLINE || m_hot.part == Hit::OUTLINE)
+            invalidateSelectedEntries();
+        }
+        else if (m_state != State::WAITING && hit != m_hot) {
           invalidate();
         }
         m_hot = hit;
@@ -831,8 +946,6 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
     }
   }
 
-  g->fillRect(theme->colors.editorFace(), bounds);
-
   // Draw palette/tileset entries
   int picksCount = m_selectedEntries.picks();
   int idxOffset = 0;
@@ -841,6 +954,31 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
   if (dragging && !m_copy) palSize -= picksCount;
   if (resizing) palSize = m_hot.color;
 
+  if (!dragging && !resizing &&
+      updateEntriesSurface(theme, palSize)) {
+    // Copy the entries from the cached surface and draw the marks
+    // only for the entries that have one
+    const gfx::Rect rc = (g->getClipBounds() & bounds);
+    if (!rc.isEmpty())
+      g->drawSurface(m_entriesSurface.get(), rc, rc, os::Sampling(), nullptr);
+
+    const int marked[] = { m_currentEntry, fgIndex, bgIndex, transparentIndex };
+    for (int j=0; j<int(std::size(marked)); ++j) {
+      const int i = marked[j];
+      if (i < 0 || i >= palSize ||
+          std::find(marked, marked+j, i) != marked+j)
+        continue;
+
+      drawEntryMarks(g, i, getPaletteEntryBounds(i),
+                     m_cachedEntries[i].negColor,
+                     fgIndex, bgIndex, transparentIndex);
+    }
+    palSize = 0;
+  }
+  else {
+    g->fillRect(theme->colors.editorFace(), bounds);
+  }
+
   for (int i=0; i<palSize; ++i) {
     if (dragging) {
       if (!m_copy) {
@@ -857,40 +995,7 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
     gfx::Color negColor;
     m_adapter->drawEntry(g, theme, i + idxOffset, i + boxOffset,
                          childSpacing(), box, negColor);
-    const int boxsize = boxSizePx();
-    const int scale = guiscale();
-
-    switch (m_style) {
-
-      case SelectOneColor:
-        if (m_currentEntry == i)
-          g->fillRect(negColor, gfx::Rect(box.center(), gfx::Size(scale, scale)));
-        break;
-
-      case FgBgColors:
-      case FgBgTiles:
-        if (!m_delegate || m_delegate->onIsPaletteViewActive(this)) {
-          if (fgIndex == i) {
-            for (int i=0; i<int(boxsize/2); i += scale) {
-              g->fillRect(negColor,
-                          gfx::Rect(box.x, box.y+i, int(boxsize/2)-i, scale));
-            }
-          }
-
-          if (bgIndex == i) {
-            for (int i=0; i<int(boxsize/4); i += scale) {
-              g->fillRect(negColor,
-                          gfx::Rect(box.x+box.w-(i+scale),
-                                    box.y+box.h-int(boxsize/4)+i,
-                                    i+scale, scale));
-            }
-          }
-
-          if (transparentIndex == i)
-            g->fillRect(negColor, gfx::Rect(box.center(), gfx::Size(scale, scale)));
-        }
-        break;
-    }
+    drawEntryMarks(g, i, box, negColor, fgIndex, bgIndex, transparentIndex);
   }
 
   // Handle to resize palette
@@ -987,6 +1092,123 @@ void PaletteView::onPaint(ui::PaintEvent& ev)
   }
 }
 
+bool PaletteView::updateEntriesSurface(SkinTheme* theme, const int palSize)
+{
+  const gfx::Size size = clientBounds().size();
+  if (size.w < 1 || size.h < 1 ||
+      size.w*size.h > kMaxEntriesSurfacePixels) {
+    invalidateEntriesSurface();
+    return false;
+  }
+
+  // Redraw all entries when the layout of the entries is changed
+  const gfx::Rect firstBox = getPaletteEntryBounds(0);
+  if (!m_entriesSurface ||
+      m_entriesSurface->width() != size.w ||
+      m_entriesSurface->height() != size.h ||
+      m_cachedFirstBox != firstBox ||
+      m_cachedColumns != m_columns ||
+      int(m_cachedEntries.size()) != palSize) {
+    if (!m_entriesSurface ||
+        m_entriesSurface->width() != size.w ||
+        m_entriesSurface->height() != size.h) {
+      m_entriesSurface = os::instance()->makeRgbaSurface(size.w, size.h);
+    }
+    m_cachedEntries.clear();
+    m_cachedEntries.resize(palSize);
+    m_cachedFirstBox = firstBox;
+    m_cachedColumns = m_columns;
+
+    ui::Graphics g(display(), m_entriesSurface, 0, 0);
+    g.fillRect(theme->colors.editorFace(), gfx::Rect(size));
+  }
+
+  std::vector<EntryStamp> stamps;
+  m_adapter->entryStamps(palSize, stamps);
+
+  ui::Graphics g(display(), m_entriesSurface, 0, 0);
+  for (int i=0; i<palSize; ++i) {
+    CachedEntry& entry = m_cachedEntries[i];
+    if (entry.valid && entry.stamp == stamps[i])
+      continue;
+
+    gfx::Rect box = getPaletteEntryBounds(i);
+    m_adapter->drawEntry(&g, theme, i, i, childSpacing(),
+                         box, entry.negColor);
+    entry.stamp = stamps[i];
+    entry.valid = true;
+  }
+  return true;
+}
+
+void PaletteView::drawEntryMarks(ui::Graphics* g,
+                                 const int i,
+                                 const gfx::Rect& box,
+                                 const gfx::Color negColor,
+                                 const int fgIndex,
+                                 const int bgIndex,
+                                 const int transparentIndex)
+{
+  const int boxsize = boxSizePx();
+  const int scale = guiscale();
+
+  switch (m_style) {
+
+    case SelectOneColor:
+      if (m_currentEntry == i)
+        g->fillRect(negColor, gfx::Rect(box.center(), gfx::Size(scale, scale)));
+      break;
+
+    case FgBgColors:
+    case FgBgTiles:
+      if (!m_delegate || m_delegate->onIsPaletteViewActive(this)) {
+        if (fgIndex == i) {
+          for (int i=0; i<int(boxsize/2); i += scale) {
+            g->fillRect(negColor,
+                        gfx::Rect(box.x, box.y+i, int(boxsize/2)-i, scale));
+          }
+        }
+
+        if (bgIndex == i) {
+          for (int i=0; i<int(boxsize/4); i += scale) {
+            g->fillRect(negColor,
+                        gfx::Rect(box.x+box.w-(i+scale),
+                                  box.y+box.h-int(boxsize/4)+i,
+                                  i+scale, scale));
+          }
+        }
+
+        if (transparentIndex == i)
+          g->fillRect(negColor, gfx::Rect(box.center(), gfx::Size(scale, scale)));
+      }
+      break;
+  }
+}
+
+void PaletteView::invalidateEntriesSurface()
+{
+  m_entriesSurface.reset();
+  m_cachedEntries.clear();
+}
+
+void PaletteView::invalidateSelectedEntries()
+{
+  auto theme = SkinTheme::get(this);
+  const int outlineWidth = theme->dimensions.paletteOutlineWidth();
+  const gfx::Point origin = bounds().origin();
+
+  gfx::Region rgn;
+  for (int i=0; i<m_selectedEntries.size(); ++i) {
+    if (!m_selectedEntries[i])
+      continue;
+
+    gfx::Rect box, clip;
+    getEntryBoundsAndClip(i, m_selectedEntries, outlineWidth, box, clip);
+    rgn |= gfx::Region(box.offset(origin));
+  }
+  invalidateRegion(rgn);
+}
+
 void PaletteView::onResize(ui::ResizeEvent& ev)
 {
   if (!m_isUpdatingColumns) {
@@ -1365,6 +1587,7 @@ void PaletteView::updateBorderAndChildSpacing()
   const int dim = theme->dimensions.paletteEntriesSeparator();
   setBorder(gfx::Border(dim));
   setChildSpacing(m_withSeparator ? dim: 0);
+  invalidateEntriesSurface();
 
   View* view = View::getView(this);
   if (view)
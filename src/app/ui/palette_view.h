@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2021  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -14,10 +14,16 @@
 #include "app/ui/color_source.h"
 #include "app/ui/marching_ants.h"
 #include "app/ui/tile_source.h"
+#include "doc/color.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
 #include "doc/palette_picks.h"
 #include "doc/tile.h"
+#include "gfx/color.h"
+#include "gfx/rect.h"
 #include "obs/connection.h"
 #include "obs/signal.h"
+#include "os/surface.h"
 #include "ui/event.h"
 #include "ui/mouse_button.h"
 #include "ui/widget.h"
@@ -30,6 +36,10 @@ namespace doc {
   class Tileset;
 }
 
+namespace ui {
+  class Graphics;
+}
+
 namespace app {
 
   enum class PaletteViewModification {
@@ -38,6 +48,10 @@ namespace app {
     RESIZE,
   };
 
+  namespace skin {
+    class SkinTheme;
+  }
+
   class PaletteView;
 
   class PaletteViewDelegate {
@@ -72,6 +86,7 @@ namespace app {
                     , public IColorSource
                     , public ITileSource
                     , public ContextObserver {
+    friend class AbstractPaletteViewAdapter;
     friend class PaletteViewAdapter;
     friend class TilesetViewAdapter;
   public:
@@ -166,6 +181,32 @@ namespace app {
       }
     };
 
+    // Identifies the content of one entry (the color, or the version
+    // of the tile image and the palette used to draw it). When the
+    // stamp changes, the entry is redrawn in m_entriesSurface.
+    struct EntryStamp {
+      doc::color_t color = 0;
+      doc::ObjectId imageId = doc::NullId;
+      doc::ObjectVersion imageVersion = 0;
+      int palModifications = 0;
+
+      bool operator==(const EntryStamp& o) const {
+        return (color == o.color &&
+                imageId == o.imageId &&
+                imageVersion == o.imageVersion &&
+                palModifications == o.palModifications);
+      }
+      bool operator!=(const EntryStamp& o) const {
+        return !operator==(o);
+      }
+    };
+
+    struct CachedEntry {
+      EntryStamp stamp;
+      gfx::Color negColor = gfx::ColorNone;
+      bool valid = false;
+    };
+
     void update_scroll(int color);
     void onAppPaletteChange();
     gfx::Rect getPaletteEntryBounds(int index) const;
@@ -185,6 +226,12 @@ namespace app {
                        PaletteViewModification mod);
     int boxSizePx() const;
     void updateBorderAndChildSpacing();
+    bool updateEntriesSurface(skin::SkinTheme* theme, int palSize);
+    void drawEntryMarks(ui::Graphics* g, int i, const gfx::Rect& box,
+                        gfx::Color negColor,
+                        int fgIndex, int bgIndex, int transparentIndex);
+    void invalidateEntriesSurface();
+    void invalidateSelectedEntries();
 
     State m_state;
     bool m_editable;
@@ -203,6 +250,15 @@ namespace app {
     Hit m_hot;
     bool m_copy;
     bool m_withSeparator;
+
+    // Backing surface with all entries already drawn, so we don't
+    // need to draw each color/tile again when the widget is repainted
+    // (e.g. on hover changes). Only entries with a different stamp
+    // are redrawn.
+    os::SurfaceRef m_entriesSurface;
+    std::vector<CachedEntry> m_cachedEntries;
+    gfx::Rect m_cachedFirstBox;
+    int m_cachedColumns = 0;
   };
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2024  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -91,17 +91,43 @@ class PalettesListItem : public ResourceListItem {
 public:
   PalettesListItem(Resource* resource, TooltipManager* tooltips)
     : ResourceListItem(resource)
+    , m_tooltips(tooltips)
     , m_comment(nullptr)
   {
-    std::string comment = static_cast<PaletteResource*>(resource)->palette()->comment();
+  }
+
+private:
+  PaletteResource* paletteResource() const {
+    return static_cast<PaletteResource*>(resource());
+  }
+
+  // Adds the comment button when the palette preview is available
+  void updateComment() {
+    const doc::Palette* palette = paletteResource()->preview();
+    if (m_comment || !palette)
+      return;
+
+    std::string comment = palette->comment();
     if (!comment.empty()) {
       addChild(m_comment = new CommentButton(comment));
 
-      tooltips->addTooltipFor(m_comment, comment, LEFT);
+      m_tooltips->addTooltipFor(m_comment, comment, LEFT);
+      layout();
     }
   }
 
-private:
+  void onPaint(PaintEvent& ev) override {
+    // The palette file is decoded (or read from the palettes index)
+    // only when its item is painted the first time
+    paletteResource()->loadPreview(
+      [this]{
+        updateComment();
+        invalidate();
+      });
+
+    ResourceListItem::onPaint(ev);
+  }
+
   void onResize(ResizeEvent& ev) override {
     ResourceListItem::onResize(ev);
 
@@ -114,6 +140,7 @@ private:
     }
   }
 
+  TooltipManager* m_tooltips;
   CommentButton* m_comment;
 };
 
@@ -149,15 +176,23 @@ ResourceListItem* PalettesListBox::onCreateResourceItem(Resource* resource)
 void PalettesListBox::onResourceChange(Resource* resource)
 {
   const doc::Palette* palette = static_cast<PaletteResource*>(resource)->palette();
-  PalChange(palette);
+  if (palette)
+    PalChange(palette);
 }
 
 void PalettesListBox::onPaintResource(Graphics* g, gfx::Rect& bounds, Resource* resource)
 {
   auto theme = SkinTheme::get(this);
-  const doc::Palette* palette = static_cast<PaletteResource*>(resource)->palette();
+  const doc::Palette* palette = static_cast<PaletteResource*>(resource)->preview();
   os::Surface* tick = theme->parts.checkSelected()->bitmap(0);
 
+  // The palette is still being loaded in background
+  if (!palette) {
+    bounds.x += tick->width();
+    bounds.w -= tick->width();
+    return;
+  }
+
   // Draw tick (to say "this palette matches the active sprite
   // palette").
   auto view = UIContext::instance()->activeView();
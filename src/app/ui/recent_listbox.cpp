@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -17,16 +17,20 @@
 #include "app/i18n/strings.h"
 #include "app/pref/preferences.h"
 #include "app/recent_files.h"
+#include "app/thumbnail_generator.h"
 #include "app/ui/draggable_widget.h"
 #include "app/ui/skin/skin_theme.h"
 #include "app/ui_context.h"
 #include "base/fs.h"
+#include "os/sampling.h"
+#include "os/surface.h"
 #include "ui/alert.h"
 #include "ui/graphics.h"
 #include "ui/link_label.h"
 #include "ui/listitem.h"
 #include "ui/message.h"
 #include "ui/paint_event.h"
+#include "ui/scale.h"
 #include "ui/scroll_region_event.h"
 #include "ui/size_hint_event.h"
 #include "ui/system.h"
@@ -41,15 +45,42 @@ using namespace skin;
 // RecentFileItem
 
 class RecentFileItem : public DraggableWidget<LinkLabel> {
+  // Thumbnail loaded from the thumbnails cache in background
+  struct Thumbnail {
+    os::SurfaceRef surface;
+    RecentFileItem* item = nullptr;
+  };
+
 public:
   RecentFileItem(const std::string& file,
-                 const bool pinned)
+                 const bool pinned,
+                 const bool withThumbnail = false)
     : DraggableWidget<LinkLabel>("")
     , m_fullpath(file)
     , m_name(base::get_file_name(file))
     , m_path(base::get_file_path(file))
     , m_pinned(pinned) {
     initTheme();
+
+    if (withThumbnail) {
+      m_thumbnail = std::make_shared<Thumbnail>();
+      m_thumbnail->item = this;
+
+      // Only cached thumbnails are displayed (generated when the
+      // file was saved or opened), the file itself is not decoded
+      ThumbnailGenerator::instance()->loadCachedThumbnail(
+        file,
+        [thumbnail = m_thumbnail](const os::SurfaceRef& surface){
+          thumbnail->surface = surface;
+          if (thumbnail->item)
+            thumbnail->item->invalidate();
+        });
+    }
+  }
+
+  ~RecentFileItem() {
+    if (m_thumbnail)
+      m_thumbnail->item = nullptr;
   }
 
   const std::string& fullpath() const { return m_fullpath; }
@@ -82,7 +113,11 @@ protected:
     setTextQuiet(m_path);
     gfx::Size sz2 = theme->calcSizeHint(this, styleDetail);
 
-    ev.setSizeHint(gfx::Size(sz1.w+sz2.w, std::max(sz1.h, sz2.h)));
+    gfx::Size sz(sz1.w+sz2.w, std::max(sz1.h, sz2.h));
+    if (m_thumbnail)
+      sz.w += sz.h + 2*guiscale();
+
+    ev.setSizeHint(sz);
   }
 
   bool onProcessMessage(Message* msg) override {
@@ -139,6 +174,19 @@ protected:
     ui::Style* style = theme->styles.recentFile();
     ui::Style* styleDetail = theme->styles.recentFileDetail();
 
+    if (m_thumbnail) {
+      const gfx::Rect thumbBounds(bounds.x, bounds.y, bounds.h, bounds.h);
+      bounds.x += thumbBounds.w + 2*guiscale();
+      bounds.w -= thumbBounds.w + 2*guiscale();
+
+      // Background of the thumbnail
+      setTextQuiet("");
+      theme->paintWidget(g, this, style, thumbBounds);
+
+      if (m_thumbnail->surface)
+        paintThumbnail(g, m_thumbnail->surface.get(), thumbBounds);
+    }
+
     setTextQuiet(m_name.c_str());
     theme->paintWidget(g, this, style, bounds);
 
@@ -204,6 +252,30 @@ protected:
   }
 
 private:
+  void paintThumbnail(Graphics* g,
+                      os::Surface* thumbnail,
+                      const gfx::Rect& bounds) {
+    // Fit the thumbnail in the given bounds keeping its aspect ratio
+    const int w = thumbnail->width();
+    const int h = thumbnail->height();
+    gfx::Rect dst(bounds);
+    if (w > h)
+      dst.h = std::max(1, bounds.w * h / w);
+    else
+      dst.w = std::max(1, bounds.h * w / h);
+    dst.x += (bounds.w - dst.w) / 2;
+    dst.y += (bounds.h - dst.h) / 2;
+
+    ui::Paint paint;
+    paint.blendMode(os::BlendMode::SrcOver);
+
+    os::Sampling sampling(os::Sampling::Filter::Linear,
+                          os::Sampling::Mipmap::Nearest);
+
+    g->drawSurface(thumbnail, gfx::Rect(0, 0, w, h), dst,
+                   sampling, &paint);
+  }
+
   gfx::Rect pinBounds(const gfx::Rect& bounds) {
     auto theme = SkinTheme::get(this);
     ui::Style* pinStyle = theme->styles.recentFilePin();
@@ -236,6 +308,7 @@ private:
   std::string m_name;
   std::string m_path;
   bool m_pinned;
+  std::shared_ptr<Thumbnail> m_thumbnail;
 };
 
 //////////////////////////////////////////////////////////////////////
@@ -303,9 +376,9 @@ void RecentFilesListBox::onRebuildList()
 {
   auto recent = App::instance()->recentFiles();
   for (const auto& fn : recent->pinnedFiles())
-    addChild(new RecentFileItem(fn, true));
+    addChild(new RecentFileItem(fn, true, true));
   for (const auto& fn : recent->recentFiles())
-    addChild(new RecentFileItem(fn, false));
+    addChild(new RecentFileItem(fn, false, true));
 }
 
 void RecentFilesListBox::onClick(const std::string& path)
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -255,6 +255,8 @@ Timeline::Timeline(TooltipManager* tooltipManager)
   , m_scroll(false)
   , m_fromTimeline(false)
   , m_aniControls(tooltipManager)
+  , m_celThumbnails(std::make_unique<thumb::CelThumbnails>(
+                      [this]{ invalidateRect(getCelsBounds().offset(origin())); }))
 {
   enableFlags(CTRL_RIGHT_CLICK);
 
@@ -407,6 +409,7 @@ void Timeline::detachDocument()
 
   if (m_document) {
     m_thumbnailsPrefConn.disconnect();
+    m_celThumbnails->clear();
     m_document->remove_observer(this);
     m_document = nullptr;
   }
@@ -458,8 +461,13 @@ void Timeline::setLayer(Layer* layer)
 {
   ASSERT(m_editor != NULL);
 
-  invalidateLayer(m_layer);
-  invalidateLayer(layer);
+  // In a batch update the rows are regenerated when it ends (m_rows
+  // can be outdated in the meantime)
+  const bool batch = (m_document && m_document->isInBatchUpdate());
+  if (!batch) {
+    invalidateLayer(m_layer);
+    invalidateLayer(layer);
+  }
 
   m_layer = layer;
 
@@ -471,8 +479,13 @@ void Timeline::setLayer(Layer* layer)
       group->setCollapsed(false);
       group = group->parent();
     }
-    regenerateRows();
-    invalidate();
+    if (batch) {
+      m_batchUpdate = true;
+    }
+    else {
+      regenerateRows();
+      invalidate();
+    }
   }
 
   if (m_editor->layer() != layer)
@@ -1724,6 +1737,9 @@ void Timeline::onPaint(ui::PaintEvent& ev)
 
     getDrawableLayers(&firstLayer, &lastLayer);
     getDrawableFrames(&firstFrame, &lastFrame);
+    clipDrawableLayersAndFrames(g->getClipBounds(),
+                                &firstLayer, &lastLayer,
+                                &firstFrame, &lastFrame);
 
     drawTop(g);
 
@@ -1907,6 +1923,11 @@ void Timeline::onAddLayer(DocEvent& ev)
 
   setLayer(ev.layer());
 
+  if (ev.document()->isInBatchUpdate()) {
+    m_batchUpdate = true;
+    return;
+  }
+
   regenerateRows();
   showCurrentCel();
   clearClipboardRange();
@@ -1944,6 +1965,11 @@ void Timeline::onAddFrame(DocEvent& ev)
 {
   setFrame(ev.frame(), false);
 
+  if (ev.document()->isInBatchUpdate()) {
+    m_batchUpdate = true;
+    return;
+  }
+
   showCurrentCel();
   clearClipboardRange();
   invalidate();
@@ -1975,12 +2001,18 @@ void Timeline::onRemoveFrame(DocEvent& ev)
 
 void Timeline::onAddCel(DocEvent& ev)
 {
-  invalidateLayer(ev.layer());
+  if (ev.document()->isInBatchUpdate())
+    m_batchUpdate = true;
+  else
+    invalidateLayer(ev.layer());
 }
 
 void Timeline::onAfterRemoveCel(DocEvent& ev)
 {
-  invalidateLayer(ev.layer());
+  if (ev.document()->isInBatchUpdate())
+    m_batchUpdate = true;
+  else
+    invalidateLayer(ev.layer());
 }
 
 void Timeline::onLayerNameChange(DocEvent& ev)
@@ -2026,6 +2058,18 @@ void Timeline::onAfterLayerVisibilityChange(DocEvent& ev)
                    .offset(origin()));
 }
 
+void Timeline::onAfterBatchUpdate(DocEvent& ev)
+{
+  if (!m_batchUpdate)
+    return;
+
+  m_batchUpdate = false;
+  regenerateRows();
+  showCurrentCel();
+  clearClipboardRange();
+  invalidate();
+}
+
 void Timeline::onStateChanged(Editor* editor)
 {
   m_aniControls.updateUsingEditor(editor);
@@ -2131,6 +2175,40 @@ void Timeline::getDrawableFrames(frame_t* firstFrame, frame_t* lastFrame)
       + getCelsBounds().w) / frameBoxWidth());
 }
 
+// Reduces the range of drawable layers/frames to the rows/columns
+// that intersect the given clip bounds (e.g. when only one cel is
+// invalidated, we don't need to iterate all visible layers/frames).
+void Timeline::clipDrawableLayersAndFrames(const gfx::Rect& clipBounds,
+                                           layer_t* firstDrawableLayer,
+                                           layer_t* lastDrawableLayer,
+                                           frame_t* firstDrawableFrame,
+                                           frame_t* lastDrawableFrame) const
+{
+  if (clipBounds.isEmpty()) {
+    *lastDrawableLayer = *firstDrawableLayer - 1;
+    *lastDrawableFrame = *firstDrawableFrame - 1;
+    return;
+  }
+
+  // Frame columns (at the same "x" position as the frame headers)
+  const int x0 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), 0)).x;
+  const int fw = frameBoxWidth();
+  *firstDrawableFrame = std::max(*firstDrawableFrame,
+                                 frame_t((clipBounds.x - x0) / fw));
+  *lastDrawableFrame = std::min(*lastDrawableFrame,
+                                frame_t((clipBounds.x2()-1 - x0) / fw));
+
+  // Layer rows (from the last layer at the top to the first one)
+  if (validLayer(lastLayer())) {
+    const int y0 = getPartBounds(Hit(PART_ROW, lastLayer())).y;
+    const int lh = layerBoxHeight();
+    *lastDrawableLayer = std::min(*lastDrawableLayer,
+                                  lastLayer() - (clipBounds.y - y0) / lh);
+    *firstDrawableLayer = std::max(*firstDrawableLayer,
+                                   lastLayer() - (clipBounds.y2()-1 - y0) / lh);
+  }
+}
+
 void Timeline::drawPart(ui::Graphics* g, const gfx::Rect& bounds,
                         const std::string* text, ui::Style* style,
                         const bool is_active,
@@ -2475,7 +2553,8 @@ void Timeline::drawCel(ui::Graphics* g,
         skinTheme()->calcBorder(this, style));
 
     if (!thumb_bounds.isEmpty()) {
-      if (os::SurfaceRef surface = thumb::get_cel_thumbnail(cel, thumb_bounds.size())) {
+      if (os::SurfaceRef surface = m_celThumbnails->get(m_document, cel,
+                                                        thumb_bounds.size())) {
         const int t = std::clamp(thumb_bounds.w/8, 4, 16);
         draw_checkered_grid(g, thumb_bounds, gfx::Size(t, t), docPref());
 
@@ -2595,14 +2674,18 @@ void Timeline::drawCelLinkDecorators(ui::Graphics* g, const gfx::Rect& bounds,
   bool right = (data->lastLink != data->end ? frame < (*data->lastLink)->frame(): false);
 
   if (cel && cel->image()->id() == imageId) {
+    // The previous/next cels in the layer are already known (we don't
+    // need to search them with m_layer->cel())
     if (left) {
-      Cel* prevCel = m_layer->cel(cel->frame()-1);
-      if (!prevCel || prevCel->image()->id() != imageId)
+      const Cel* prevCel = (data->prevIt != data->end ? *data->prevIt: nullptr);
+      if (!prevCel || prevCel->frame() != frame-1 ||
+          prevCel->image()->id() != imageId)
         style1 = styles.timelineLeftLink();
     }
     if (right) {
-      Cel* nextCel = m_layer->cel(cel->frame()+1);
-      if (!nextCel || nextCel->image()->id() != imageId)
+      const Cel* nextCel = (data->nextIt != data->end ? *data->nextIt: nullptr);
+      if (!nextCel || nextCel->frame() != frame+1 ||
+          nextCel->image()->id() != imageId)
         style2 = styles.timelineRightLink();
     }
   }
@@ -2640,6 +2723,7 @@ void Timeline::drawTags(ui::Graphics* g)
     g->fillRect(theme->colors.timelineBandHighlight(), bandBounds);
   }
 
+  const gfx::Rect clipBounds = g->getClipBounds();
   int passes = (m_tagFocusBand >= 0 ? 2: 1);
   for (int pass=0; pass<passes; ++pass) {
     for (Tag* tag : m_sprite->tags()) {
@@ -2662,6 +2746,13 @@ void Timeline::drawTags(ui::Graphics* g)
       }
 
       gfx::Rect bounds1 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), fromFrame));
+
+      // Tags starting after the clipped area aren't visible (neither
+      // the braces nor the text), so we can skip them without
+      // calculating the bounds of the text.
+      if (bounds1.x > clipBounds.x2())
+        continue;
+
       gfx::Rect bounds2 = getPartBounds(Hit(PART_HEADER_FRAME, firstLayer(), toFrame));
       gfx::Rect bounds = bounds1.createUnion(bounds2);
       gfx::Rect tagBounds = getPartBounds(Hit(PART_TAG, 0, 0, tag->id()));
@@ -2697,6 +2788,10 @@ void Timeline::drawTags(ui::Graphics* g)
       bounds.w += dw;
       tagBounds.x += dx;
 
+      if (!bounds.intersects(clipBounds) &&
+          !tagBounds.intersects(clipBounds))
+        continue;
+
       const gfx::Color tagColor =
         (m_tagFocusBand < 0 || pass == 1) ?
         tag->color(): theme->colors.timelineBandBg();
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2018-2024  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -54,6 +54,10 @@ namespace app {
     class SkinTheme;
   }
 
+  namespace thumb {
+    class CelThumbnails;
+  }
+
   using namespace doc;
 
   class CommandExecutionEvent;
@@ -164,6 +168,7 @@ namespace app {
     void onTagRename(DocEvent& ev) override;
     void onLayerCollapsedChanged(DocEvent& ev) override;
     void onAfterLayerVisibilityChange(DocEvent& ev) override;
+    void onAfterBatchUpdate(DocEvent& ev) override;
 
     // app::Context slots.
     void onBeforeCommandExecution(CommandExecutionEvent& ev);
@@ -280,6 +285,9 @@ namespace app {
     void setCursor(ui::Message* msg, const Hit& hit);
     void getDrawableLayers(layer_t* firstLayer, layer_t* lastLayer);
     void getDrawableFrames(frame_t* firstFrame, frame_t* lastFrame);
+    void clipDrawableLayersAndFrames(const gfx::Rect& clipBounds,
+                                     layer_t* firstLayer, layer_t* lastLayer,
+                                     frame_t* firstFrame, frame_t* lastFrame) const;
     void drawPart(ui::Graphics* g, const gfx::Rect& bounds,
                   const std::string* text,
                   ui::Style* style,
@@ -422,6 +430,10 @@ namespace app {
     int m_tagFocusBand;
     std::map<Tag*, int> m_tagBand;
 
+    // Rows must be regenerated and the timeline invalidated when the
+    // batch update of the document ends.
+    bool m_batchUpdate = false;
+
     int m_separator_x;
     int m_separator_w;
     int m_origFrames;
@@ -454,6 +466,7 @@ namespace app {
     Hit m_thumbnailsOverlayHit;
     gfx::Point m_thumbnailsOverlayDirection;
     obs::connection m_thumbnailsPrefConn;
+    std::unique_ptr<thumb::CelThumbnails> m_celThumbnails;
 
     // Temporal data used to move the range.
     struct MoveRange {
@@ -0,0 +1,325 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/undo_payload.h"
+
+#include "base/exception.h"
+#include "base/fs.h"
+#include "base/fstream_path.h"
+#include "base/process.h"
+#include "base/thread_pool.h"
+#include "doc/image_impl.h"
+#include "fmt/format.h"
+#include "ver/info.h"
+
+#include <atomic>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+namespace app {
+
+namespace {
+
+enum class State {
+  Raw,                          // Uncompressed buffer
+  Compressing,                  // Waiting the background thread
+  Compressed,                   // Compressed in memory
+  Spilled,                      // Compressed in the temporary file
+};
+
+} // anonymous namespace
+
+struct UndoPayload::Data {
+  std::mutex mutex;
+  State state = State::Raw;
+  base::buffer raw;
+  std::size_t rawSize = 0;
+  std::vector<uint8_t> compressed;
+  std::size_t fileOffset = 0;
+  std::size_t fileSize = 0;
+  std::atomic<std::size_t> memSize = 0;
+};
+
+namespace {
+
+// Background thread to compress payloads, and the temporary file
+// where payloads are moved when the memory budget is exceeded.
+//
+// Locking order: first Data::mutex and then m_fileMutex or
+// m_queueMutex (the queue mutex is never held while a Data::mutex is
+// locked to avoid deadlocks).
+class PayloadStore {
+public:
+  static PayloadStore& instance() {
+    static PayloadStore store;
+    return store;
+  }
+
+  PayloadStore() : m_pool(1) { }
+
+  std::atomic<int> generation = 0;
+  std::atomic<std::size_t> budget = 0;
+
+  void compress(const std::shared_ptr<UndoPayload::Data>& data) {
+    m_pool.execute([this, data]{
+      {
+        const std::lock_guard lock(data->mutex);
+        // buffer() was called before we started
+        if (data->state != State::Compressing)
+          return;
+
+        std::vector<uint8_t> c =
+          doc::compress_image_bits(data->raw.data(), data->raw.size());
+        if (c.empty() || c.size() >= data->raw.size()) {
+          data->state = State::Raw;
+          return;
+        }
+
+        data->rawSize = data->raw.size();
+        data->compressed = std::move(c);
+        base::buffer().swap(data->raw);
+        data->state = State::Compressed;
+        data->memSize = data->compressed.size();
+        m_compressedSize += data->compressed.size();
+      }
+      {
+        const std::lock_guard lock(m_queueMutex);
+        m_queue.push_back(data);
+      }
+      ++generation;
+
+      spillOldPayloads();
+    });
+  }
+
+  // Called when a compressed buffer is uncompressed from buffer()
+  void removeCompressed(const std::size_t size) {
+    m_compressedSize -= size;
+  }
+
+  void write(UndoPayload::Data* data) {
+    const std::lock_guard lock(m_fileMutex);
+    if (!m_file.is_open() && !m_file.open())
+      throw base::Exception("Cannot create temporary file for undo data");
+
+    m_file.stream.seekp(m_fileEnd);
+    m_file.stream.write((const char*)data->compressed.data(), data->compressed.size());
+    if (!m_file.stream)
+      throw base::Exception("Error writing undo data");
+
+    data->fileOffset = m_fileEnd;
+    data->fileSize = data->compressed.size();
+    m_fileEnd += data->fileSize;
+    ++m_spilled;
+  }
+
+  void read(UndoPayload::Data* data) {
+    const std::lock_guard lock(m_fileMutex);
+    data->compressed.resize(data->fileSize);
+    m_file.stream.seekg(data->fileOffset);
+    m_file.stream.read((char*)data->compressed.data(), data->fileSize);
+    if (!m_file.stream)
+      throw base::Exception("Error reading undo data");
+
+    releaseFileSpace();
+  }
+
+  // Called when a payload in the file is deleted or loaded again
+  void release() {
+    const std::lock_guard lock(m_fileMutex);
+    releaseFileSpace();
+  }
+
+private:
+  void spillOldPayloads() {
+    while (budget > 0 && m_compressedSize > budget) {
+      std::shared_ptr<UndoPayload::Data> data;
+      {
+        const std::lock_guard lock(m_queueMutex);
+        if (m_queue.empty())
+          break;
+        data = m_queue.front().lock();
+        m_queue.pop_front();
+      }
+      if (!data)
+        continue;
+
+      const std::lock_guard lock(data->mutex);
+      if (data->state != State::Compressed)
+        continue;
+
+      try {
+        write(data.get());
+      }
+      catch (const std::exception&) {
+        // Keep the payload in memory
+        break;
+      }
+
+      m_compressedSize -= data->compressed.size();
+      std::vector<uint8_t>().swap(data->compressed);
+      data->state = State::Spilled;
+      data->memSize = 0;
+      ++generation;
+    }
+  }
+
+  // The space in the file is reused only when all its payloads were
+  // released (the file is used as a stack of old undo states, so
+  // generally they are released from the oldest ones)
+  void releaseFileSpace() {
+    ASSERT(m_spilled > 0);
+    if (--m_spilled == 0)
+      m_fileEnd = 0;
+  }
+
+  // Temporary file deleted when the program exits
+  struct TempFile {
+    std::fstream stream;
+    std::string filename;
+
+    ~TempFile() {
+      if (stream.is_open()) {
+        stream.close();
+        try {
+          base::delete_file(filename);
+        }
+        catch (const std::exception&) {
+          // Ignore
+        }
+      }
+    }
+
+    bool is_open() const { return stream.is_open(); }
+
+    bool open() {
+      filename = base::join_path(
+        base::get_temp_path(),
+        fmt::format("{}-undo-{}.tmp", get_app_name(),
+                    base::get_current_process_id()));
+      stream.open(FSTREAM_PATH(filename),
+                  std::ios::in | std::ios::out |
+                  std::ios::trunc | std::ios::binary);
+      return stream.is_open();
+    }
+  };
+
+  std::atomic<std::size_t> m_compressedSize = 0;
+  std::mutex m_queueMutex;
+  std::deque<std::weak_ptr<UndoPayload::Data>> m_queue;
+  std::mutex m_fileMutex;
+  TempFile m_file;
+  std::size_t m_fileEnd = 0;
+  int m_spilled = 0;
+  // The pool is the last member, so it's destroyed (and its thread
+  // joined) before the rest of members
+  base::thread_pool m_pool;
+};
+
+} // anonymous namespace
+
+UndoPayload::UndoPayload()
+  : m_data(std::make_shared<Data>())
+{
+}
+
+UndoPayload::~UndoPayload()
+{
+  const std::lock_guard lock(m_data->mutex);
+  switch (m_data->state) {
+    case State::Compressed:
+      PayloadStore::instance().removeCompressed(m_data->compressed.size());
+      break;
+    case State::Spilled:
+      PayloadStore::instance().release();
+      break;
+    case State::Compressing:
+      // Avoid compressing the buffer in the background thread
+      m_data->state = State::Raw;
+      break;
+    default:
+      break;
+  }
+}
+
+base::buffer& UndoPayload::buffer()
+{
+  const std::lock_guard lock(m_data->mutex);
+  switch (m_data->state) {
+
+    case State::Raw:
+      break;
+
+    case State::Compressing:
+      m_data->state = State::Raw;
+      break;
+
+    case State::Spilled:
+      PayloadStore::instance().read(m_data.get());
+      [[fallthrough]];
+
+    case State::Compressed: {
+      if (m_data->state == State::Compressed)
+        PayloadStore::instance().removeCompressed(m_data->compressed.size());
+
+      m_data->raw.resize(m_data->rawSize);
+      doc::uncompress_image_bits(m_data->compressed,
+                                 m_data->raw.data(),
+                                 m_data->rawSize);
+      std::vector<uint8_t>().swap(m_data->compressed);
+      m_data->state = State::Raw;
+      break;
+    }
+  }
+  m_data->memSize = m_data->raw.size();
+  return m_data->raw;
+}
+
+void UndoPayload::compress()
+{
+  {
+    const std::lock_guard lock(m_data->mutex);
+    // Small buffers are not worth it
+    if (m_data->state != State::Raw ||
+        m_data->raw.size() < 4096)
+      return;
+
+    m_data->state = State::Compressing;
+    m_data->memSize = m_data->raw.size();
+  }
+  PayloadStore::instance().compress(m_data);
+}
+
+std::size_t UndoPayload::memSize() const
+{
+  // The buffer can be modified after buffer() is called (e.g. to save
+  // the pixels of the command), so we use its current size if it's
+  // not being compressed
+  std::unique_lock lock(m_data->mutex, std::try_to_lock);
+  if (lock.owns_lock() && m_data->state == State::Raw)
+    return m_data->raw.size();
+  return m_data->memSize;
+}
+
+// static
+int UndoPayload::generation()
+{
+  return PayloadStore::instance().generation;
+}
+
+// static
+void UndoPayload::setMemoryBudget(const std::size_t budget)
+{
+  PayloadStore::instance().budget = budget;
+}
+
+} // namespace app
@@ -0,0 +1,61 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UNDO_PAYLOAD_H_INCLUDED
+#define APP_UNDO_PAYLOAD_H_INCLUDED
+#pragma once
+
+#include "base/buffer.h"
+#include "base/disable_copying.h"
+
+#include <cstddef>
+#include <memory>
+
+namespace app {
+
+  // Buffer with the data of an undo command (e.g. the pixels saved by
+  // cmd::CopyRegion). When the command is old, the buffer can be
+  // compressed in a background thread (compress()), and if the
+  // compressed buffers of all commands exceed the memory budget
+  // (setMemoryBudget()), the oldest ones are moved to a temporary
+  // file. The buffer is loaded again transparently when it's
+  // accessed (e.g. to undo the command).
+  class UndoPayload {
+  public:
+    UndoPayload();
+    ~UndoPayload();
+
+    // Returns the uncompressed buffer (it waits the background thread
+    // if the buffer is being compressed right now).
+    base::buffer& buffer();
+
+    // Schedules the compression of the buffer in the background
+    // thread. It does nothing if the buffer is already compressed.
+    void compress();
+
+    // Memory used by the buffer (the compressed size, or 0 if it's in
+    // the temporary file).
+    std::size_t memSize() const;
+
+    // Incremented each time the background thread changes the
+    // memSize() of some payload, so the DocUndo can recalculate its
+    // total size.
+    static int generation();
+
+    // Maximum number of bytes of compressed buffers kept in memory (0
+    // means that buffers are never moved to the temporary file).
+    static void setMemoryBudget(const std::size_t budget);
+
+  private:
+    struct Data;
+    std::shared_ptr<Data> m_data;
+
+    DISABLE_COPYING(UndoPayload);
+  };
+
+} // namespace app
+
+#endif
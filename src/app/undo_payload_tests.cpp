@@ -0,0 +1,77 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/undo_payload.h"
+
+#include <chrono>
+#include <thread>
+
+using namespace app;
+
+static void fill(base::buffer& buf)
+{
+  buf.resize(256*1024);
+  for (std::size_t i=0; i<buf.size(); ++i)
+    buf[i] = uint8_t(i / 1024);
+}
+
+static bool is_filled(const base::buffer& buf)
+{
+  if (buf.size() != 256*1024)
+    return false;
+  for (std::size_t i=0; i<buf.size(); ++i)
+    if (buf[i] != uint8_t(i / 1024))
+      return false;
+  return true;
+}
+
+// Waits the background thread
+static void wait_size_change(const UndoPayload& payload, const std::size_t size)
+{
+  for (int i=0; i<500 && payload.memSize() == size; ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+}
+
+TEST(UndoPayload, CompressAndUncompress)
+{
+  UndoPayload::setMemoryBudget(0);
+
+  UndoPayload payload;
+  fill(payload.buffer());
+  EXPECT_EQ(256*1024, payload.memSize());
+
+  payload.compress();
+  wait_size_change(payload, 256*1024);
+  EXPECT_LT(payload.memSize(), 256*1024);
+
+  EXPECT_TRUE(is_filled(payload.buffer()));
+  EXPECT_EQ(256*1024, payload.memSize());
+}
+
+TEST(UndoPayload, SpillToTempFile)
+{
+  UndoPayload::setMemoryBudget(1);
+
+  UndoPayload a, b;
+  fill(a.buffer());
+  fill(b.buffer());
+  a.compress();
+  b.compress();
+  wait_size_change(a, 256*1024);
+  wait_size_change(b, 256*1024);
+  // Wait until both payloads are moved to the file
+  for (int i=0; i<500 && (a.memSize() > 0 || b.memSize() > 0); ++i)
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  EXPECT_EQ(0, a.memSize());
+  EXPECT_EQ(0, b.memSize());
+
+  EXPECT_TRUE(is_filled(b.buffer()));
+  EXPECT_TRUE(is_filled(a.buffer()));
+
+  UndoPayload::setMemoryBudget(0);
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "app/util/autocrop.h"
 
 #include "app/snap_to_grid.h"
+#include "base/thread_pool.h"
 #include "doc/algorithm/shrink_bounds.h"
 #include "doc/image.h"
 #include "doc/mask.h"
@@ -19,7 +20,11 @@
 #include "render/render.h"
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace app {
 
@@ -265,34 +270,68 @@ gfx::Rect get_trimmed_bounds(
 {
   gfx::Rect bounds;
 
-  std::unique_ptr<Image> image_wrap(Image::create(sprite->spec()));
-  Image* image = image_wrap.get();
-
-  render::Render render;
+  // Each thread renders and shrinks the next frame that wasn't
+  // processed yet, and the union of the bounds of its frames is
+  // merged at the end (the union doesn't depend on the order).
+  const frame_t nframes = sprite->totalFrames();
+  const int threads = std::clamp(int(std::thread::hardware_concurrency()), 1, int(nframes));
+  std::mutex mutex;
+  std::condition_variable cv;
+  std::atomic<frame_t> next(0);
+  int running = threads;
+
+  auto trimFrames = [sprite, nframes, &next, &bounds, &mutex]{
+    std::unique_ptr<Image> image(Image::create(sprite->spec()));
+    render::Render render;
+    gfx::Rect threadBounds;
+
+    frame_t frame;
+    while ((frame = next++) < nframes) {
+      render.renderSprite(image.get(), sprite, frame);
+
+      gfx::Rect frameBounds;
+      doc::color_t refColor;
+      if (get_best_refcolor_for_trimming(image.get(), refColor) &&
+          doc::algorithm::shrink_bounds(image.get(), refColor, nullptr, frameBounds)) {
+        threadBounds |= frameBounds;
+      }
+    }
 
-  for (frame_t frame(0); frame<sprite->totalFrames(); ++frame) {
-    render.renderSprite(image, sprite, frame);
+    const std::lock_guard lock(mutex);
+    bounds |= threadBounds;
+  };
 
-    gfx::Rect frameBounds;
-    doc::color_t refColor;
-    if (get_best_refcolor_for_trimming(image, refColor) &&
-        doc::algorithm::shrink_bounds(image, refColor, nullptr, frameBounds)) {
-      bounds = bounds.createUnion(frameBounds);
+  if (threads < 2) {
+    trimFrames();
+  }
+  else {
+    base::thread_pool pool(threads);
+    for (int t=0; t<threads; ++t) {
+      pool.execute([&trimFrames, &mutex, &cv, &running]{
+        trimFrames();
+
+        const std::lock_guard lock(mutex);
+        if (--running == 0)
+          cv.notify_one();
+      });
     }
 
-    // TODO merge this code with the code in DocExporter::captureSamples()
-    if (byGrid) {
-      const gfx::Rect& gridBounds = sprite->gridBounds();
-      gfx::Point posTopLeft =
-        snap_to_grid(gridBounds,
-                     bounds.origin(),
-                     PreferSnapTo::FloorGrid);
-      gfx::Point posBottomRight =
-        snap_to_grid(gridBounds,
-                     bounds.point2(),
-                     PreferSnapTo::CeilGrid);
-      bounds = gfx::Rect(posTopLeft, posBottomRight);
-    }
+    std::unique_lock lock(mutex);
+    cv.wait(lock, [&running]{ return running == 0; });
+  }
+
+  // TODO merge this code with the code in DocExporter::captureSamples()
+  if (byGrid) {
+    const gfx::Rect& gridBounds = sprite->gridBounds();
+    gfx::Point posTopLeft =
+      snap_to_grid(gridBounds,
+                   bounds.origin(),
+                   PreferSnapTo::FloorGrid);
+    gfx::Point posBottomRight =
+      snap_to_grid(gridBounds,
+                   bounds.point2(),
+                   PreferSnapTo::CeilGrid);
+    bounds = gfx::Rect(posTopLeft, posBottomRight);
   }
   return bounds;
 }
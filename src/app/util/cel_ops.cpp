@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -33,6 +33,7 @@
 #include "doc/layer_tilemap.h"
 #include "doc/mask.h"
 #include "doc/palette.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/sprite.h"
 #include "doc/tileset.h"
@@ -83,6 +84,27 @@ void mask_image(Image* image, Image* bitmap)
   }
 }
 
+// Minimum number of tiles to cut/hash the tiles of an image in
+// parallel
+const int kParallelMinTiles = 256;
+
+// Number of bands of tiles per thread
+const int kBandsPerThread = 4;
+
+// Maximum number of tiles cut at the same time
+const int kTilesPerChunk = 4096;
+
+// Calls func(i1, i2) for bands of tiles in [0, n) (in parallel when
+// there are enough tiles).
+template<typename Func>
+void for_each_tiles_band(const int n, Func&& func)
+{
+  parallel_for_bands(0, n,
+                     (n >= kParallelMinTiles ?
+                      parallel_threads()*kBandsPerThread: 1),
+                     func);
+}
+
 template<typename ImageTraits>
 void create_region_with_differences_templ(const Image* a,
                                           const Image* b,
@@ -120,136 +142,6 @@ struct Mod {
   gfx::Region tileRgn;
 };
 
-class DoFlip {
-public:
-  DoFlip(const doc::ImageRef& image,
-         const doc::algorithm::FlipType flipType)
-    : m_image(image.get())
-    , m_flipType(flipType) {
-  }
-  ~DoFlip() {
-    reset();
-  }
-  void flip() {
-    m_flipped = !m_flipped;
-    doc::algorithm::flip_image(m_image,
-                               m_image->bounds(),
-                               m_flipType);
-  }
-  void reset() {
-    if (m_flipped)
-      flip();
-  }
-  bool operator!() const {
-    return !m_flipped;
-  }
-private:
-  doc::Image* m_image;
-  bool m_flipped = false;
-  doc::algorithm::FlipType m_flipType;
-};
-
-// This is a terrible way to find tiles, i.e. flipping several times
-// the image, instead of searching for flipped hashes. In the future
-// we could try to improve it.
-bool find_tile(doc::Tileset* tileset,
-               doc::ImageRef& tileImage,
-               doc::tile_index& tileIndex,
-               doc::tile_flags& tileFlags)
-{
-  // Find without flags
-  if (tileset->findTileIndex(tileImage, tileIndex)) {
-    tileFlags = 0;
-    return true;
-  }
-
-  if (tileset->matchFlags() == 0) // In case we don't allow flipped tiles
-    return false;
-
-  DoFlip x(tileImage, doc::algorithm::FlipHorizontal);
-
-  // Find with X flip
-  if (tileset->matchFlags() & doc::tile_f_xflip) {
-    x.flip();
-    if (tileset->findTileIndex(tileImage, tileIndex)) {
-      tileFlags = doc::tile_f_xflip;
-      return true;
-    }
-    x.reset();
-  }
-
-  // Find with Y flip
-  DoFlip y(tileImage, doc::algorithm::FlipVertical);
-  if (tileset->matchFlags() & doc::tile_f_yflip) {
-    y.flip();
-    if (tileset->findTileIndex(tileImage, tileIndex)) {
-      tileFlags = doc::tile_f_yflip;
-      return true;
-    }
-
-    if (tileset->matchFlags() & doc::tile_f_xflip) {
-      // Find with X+Y flip
-      x.flip();
-      if (tileset->findTileIndex(tileImage, tileIndex)) {
-        tileFlags = doc::tile_f_xflip | doc::tile_f_yflip;
-        return true;
-      }
-      x.reset();
-    }
-    y.reset();
-  }
-
-  // Check if we can match diagonal flips
-  if ((tileset->matchFlags() & doc::tile_f_dflip) == 0)
-    return false;
-
-  // Find with D flip
-  DoFlip d(tileImage, doc::algorithm::FlipDiagonal);
-  d.flip();
-  if (tileset->findTileIndex(tileImage, tileIndex)) {
-    tileFlags = doc::tile_f_dflip;
-    return true;
-  }
-
-  // Find with X+D flip
-  if (tileset->matchFlags() & doc::tile_f_xflip) {
-    d.reset();
-    x.flip();
-    d.flip();
-    if (tileset->findTileIndex(tileImage, tileIndex)) {
-      tileFlags = doc::tile_f_xflip | doc::tile_f_dflip;
-      return true;
-    }
-
-    // Find with X+Y+D flip
-    if (tileset->matchFlags() & doc::tile_f_yflip) {
-      d.reset();
-      y.flip();
-      d.flip();
-      if (tileset->findTileIndex(tileImage, tileIndex)) {
-        tileFlags = doc::tile_f_xflip | doc::tile_f_yflip | doc::tile_f_dflip;
-        return true;
-      }
-    }
-  }
-
-  // Find with Y+D flip only
-  if (tileset->matchFlags() & doc::tile_f_yflip) {
-    d.reset();
-    x.reset();
-    if (!y)
-      y.flip();
-    d.flip();
-    if (tileset->findTileIndex(tileImage, tileIndex)) {
-      tileFlags =  doc::tile_f_yflip | doc::tile_f_dflip;
-      return true;
-    }
-  }
-
-  // DoFlip destructors will reset the image.
-  return false;
-}
-
 } // anonymous namespace
 
 void create_region_with_differences(const Image* a,
@@ -334,9 +226,30 @@ Cel* create_cel_copy(CmdSequence* cmds,
     dstSize = tilemapBounds.size();
   }
 
+  // Image -> Image with a different pixel format, or indexed images
+  // with different palettes (we have to convert the pixels).
+  const bool convertImage =
+    (!srcCel->layer()->isTilemap() &&
+     !dstLayer->isTilemap() &&
+     ((dstSprite->pixelFormat() != srcImage->pixelFormat()) ||
+      // If both images are indexed but with different palette, we can
+      // convert the source cel to RGB first.
+      (dstSprite->pixelFormat() == IMAGE_INDEXED &&
+       srcImage->pixelFormat() == IMAGE_INDEXED &&
+       srcCel->sprite()->palette(srcCel->frame())->countDiff(
+         dstSprite->palette(dstFrame), nullptr, nullptr))));
+
+  // If the pixels are copied as they are (Image -> Image, or Tilemap
+  // -> Tilemap in the same layer), the new image shares the pixels
+  // with the source image until one of them is modified.
+  const bool shareImage =
+    (srcCel->layer()->isTilemap() ? srcCel->layer() == dstLayer:
+                                    !dstLayer->isTilemap() && !convertImage);
+
   // New cel
   auto dstCel = std::make_unique<Cel>(
-    dstFrame, ImageRef(Image::create(dstPixelFormat, dstSize.w, dstSize.h)));
+    dstFrame, ImageRef(shareImage ? Image::createSharedCopy(srcImage):
+                                    Image::create(dstPixelFormat, dstSize.w, dstSize.h)));
 
   dstCel->setOpacity(srcCel->opacity());
   dstCel->setZIndex(srcCel->zIndex());
@@ -347,9 +260,9 @@ Cel* create_cel_copy(CmdSequence* cmds,
     if (dstLayer->isTilemap()) {
       // Tilemap -> Tilemap (with same tileset)
       // Best case, copy a cel in the same layer (we have the same
-      // tileset available, so we just copy the tilemap as it is).
-      if (srcCel->layer() == dstLayer) {
-        dstCel->image()->copy(srcImage, gfx::Clip(0, 0, srcImage->bounds()));
+      // tileset available, so the tilemap is shared as it is).
+      if (shareImage) {
+        ASSERT(srcCel->layer() == dstLayer);
       }
       // Tilemap -> Tilemap (with different tilesets)
       else {
@@ -417,13 +330,7 @@ Cel* create_cel_copy(CmdSequence* cmds,
       srcCel->bounds(),
       tilemap);
   }
-  else if ((dstSprite->pixelFormat() != srcImage->pixelFormat()) ||
-           // If both images are indexed but with different palette, we can
-           // convert the source cel to RGB first.
-           (dstSprite->pixelFormat() == IMAGE_INDEXED &&
-            srcImage->pixelFormat() == IMAGE_INDEXED &&
-            srcCel->sprite()->palette(srcCel->frame())->countDiff(
-              dstSprite->palette(dstFrame), nullptr, nullptr))) {
+  else if (convertImage) {
     ImageRef tmpImage(Image::create(IMAGE_RGB, srcImage->width(), srcImage->height()));
     tmpImage->clear(0);
 
@@ -447,13 +354,9 @@ Cel* create_cel_copy(CmdSequence* cmds,
       srcCel->layer()->isBackground(),
       dstSprite->transparentColor());
   }
-  // Simple case, where we copy both images
+  // Simple case, where both images share the same pixels
   else {
-    render::composite_image(
-      dstCel->image(),
-      srcImage,
-      srcCel->sprite()->palette(srcCel->frame()),
-      0, 0, 255, BlendMode::SRC);
+    ASSERT(shareImage);
   }
 
   // Resize a referece cel to a non-reference layer
@@ -519,49 +422,84 @@ void draw_image_into_new_tilemap_cel(
     ASSERT(tilemapBounds.h == newTilemap->height());
   }
 
-  for (const gfx::Point& tilePt : grid.tilesInCanvasRegion(gfx::Region(canvasBounds))) {
-    const gfx::Point tilePtInCanvas = grid.tileToCanvas(tilePt);
-    doc::ImageRef tileImage(
-      doc::crop_image(srcImage,
-                      tilePtInCanvas.x-srcImagePos.x,
-                      tilePtInCanvas.y-srcImagePos.y,
-                      tileSize.w, tileSize.h,
-                      srcImage->maskColor()));
-    if (grid.hasMask())
-      mask_image(tileImage.get(), grid.mask().get());
+  const std::vector<gfx::Point> tilePts =
+    grid.tilesInCanvasRegion(gfx::Region(canvasBounds));
+  const int ntiles = int(tilePts.size());
+
+  srcImage->prefetchBits();
+  const doc::ImageRef gridMask = (grid.hasMask() ? grid.mask(): nullptr);
+  if (gridMask)
+    gridMask->prefetchBits();
+
+  // Tiles are processed in chunks to avoid keeping all the cut tiles
+  // of a big image in memory
+  std::vector<doc::ImageRef> tileImages(std::min(ntiles, kTilesPerChunk));
+
+  for (int chunk=0; chunk<ntiles; chunk+=kTilesPerChunk) {
+    const int n = std::min(kTilesPerChunk, ntiles-chunk);
+
+    // Cut and hash the tiles (in parallel for big images), the hash
+    // is cached in each tile image so the tileset hash table doesn't
+    // need to calculate it again.
+    for_each_tiles_band(
+      n,
+      [&](const int i1, const int i2) {
+        for (int i=i1; i<i2; ++i) {
+          const gfx::Point tilePtInCanvas = grid.tileToCanvas(tilePts[chunk+i]);
+          doc::ImageRef tileImage(
+            doc::crop_image(srcImage,
+                            tilePtInCanvas.x-srcImagePos.x,
+                            tilePtInCanvas.y-srcImagePos.y,
+                            tileSize.w, tileSize.h,
+                            srcImage->maskColor()));
+          if (gridMask)
+            mask_image(tileImage.get(), gridMask.get());
+
+          preprocess_transparent_pixels(tileImage.get());
+          calculate_image_hash(tileImage.get(), tileImage->bounds());
+
+          tileImages[i] = tileImage;
+        }
+      });
 
-    preprocess_transparent_pixels(tileImage.get());
+    // Add the new tiles to the tileset in the same order as the
+    // tiles in the tilemap, so we get the same tile indexes as
+    // processing each tile in one thread.
+    for (int i=0; i<n; ++i) {
+      const gfx::Point& tilePt = tilePts[chunk+i];
+      doc::ImageRef tileImage = std::move(tileImages[i]);
 
-    doc::tile_index tileIndex;
-    doc::tile_flags tileFlag = 0;
+      doc::tile_index tileIndex;
+      doc::tile_flags tileFlag = 0;
 
-    if (!find_tile(tileset, tileImage, tileIndex, tileFlag)) {
-      auto addTile = new cmd::AddTile(tileset, tileImage);
+      if (!tileset->findTileIndexWithFlags(tileImage, tileIndex, tileFlag)) {
+        auto addTile = new cmd::AddTile(tileset, tileImage);
 
-      if (cmds)
-        cmds->executeAndAdd(addTile);
-      else {
-        // TODO a little hacky
-        addTile->execute(doc->context());
-      }
+        if (cmds)
+          cmds->executeAndAdd(addTile);
+        else {
+          // TODO a little hacky
+          addTile->execute(doc->context());
+        }
 
-      tileIndex = addTile->tileIndex();
+        tileIndex = addTile->tileIndex();
 
-      if (!cmds)
-        delete addTile;
+        if (!cmds)
+          delete addTile;
 
-      doc->notifyAfterAddTile(dstLayer, dstCel->frame(), tileIndex);
-    }
+        doc->notifyAfterAddTile(dstLayer, dstCel->frame(), tileIndex);
+      }
 
-    // We were using newTilemap->putPixel() directly but received a
-    // crash report about an "access violation". So now we've added
-    // some checks to the operation.
-    {
-      const int u = tilePt.x-tilemapBounds.x;
-      const int v = tilePt.y-tilemapBounds.y;
-      ASSERT((u >= 0) && (v >= 0) && (u < newTilemap->width()) && (v < newTilemap->height()));
-      doc::put_pixel(newTilemap.get(), u, v,
-                     doc::tile(tileIndex, tileFlag));
+      // We were using newTilemap->putPixel() directly but received a
+      // crash report about an "access violation". So now we've added
+      // some checks to the operation.
+      {
+        const int u = tilePt.x-tilemapBounds.x;
+        const int v = tilePt.y-tilemapBounds.y;
+        ASSERT((u >= 0) && (v >= 0) && (u < newTilemap->width()) && (v < newTilemap->height()));
+        doc::put_pixel(newTilemap.get(), u, v,
+                       doc::tile(tileIndex, tileFlag));
+      }
     }
   }
 
@@ -683,7 +621,7 @@ void modify_tilemap_cel_region(
       doc::tile_index tileIndex;
       doc::tile_flags tileFlag = 0;
 
-      if (find_tile(tileset, tileImage, tileIndex, tileFlag)) {
+      if (tileset->findTileIndexWithFlags(tileImage, tileIndex, tileFlag)) {
         // We can re-use an existent tile (tileIndex) from the tileset
       }
       else if (tilesetMode == TilesetMode::Auto &&
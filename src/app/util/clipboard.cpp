@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -229,25 +229,12 @@ void Clipboard::setData(Image* image,
 
   if (set_native_clipboard &&
       use_native_clipboard()) {
-    // Copy tilemap to the native clipboard
-    if (isTilemap) {
-      ASSERT(tileset);
-      setNativeBitmap(image, mask, palette, tileset);
-    }
-    // Copy non-tilemap images to the native clipboard
-    else {
-      color_t oldMask = 0;
-      if (image) {
-        oldMask = image->maskColor();
-        if (!image_source_is_transparent)
-          image->setMaskColor(-1);
-      }
-
-      setNativeBitmap(image, mask, palette);
-
-      if (image && !image_source_is_transparent)
-        image->setMaskColor(oldMask);
-    }
+    ASSERT(!isTilemap || tileset);
+    setNativeBitmap((isTilemap ? m_data->tilemap: m_data->image),
+                    m_data->mask,
+                    m_data->palette,
+                    m_data->tileset,
+                    image_source_is_transparent);
   }
 }
 
@@ -298,8 +285,8 @@ bool Clipboard::copyFromDocument(const Site& site, bool merged)
 
 ClipboardFormat Clipboard::format() const
 {
-  // Check if the native clipboard has an image
-  if (use_native_clipboard() && hasNativeBitmap()) {
+  // Check if the native clipboard has an image (from other app)
+  if (use_native_clipboard() && hasNativeBitmap() && !hasOwnNativeContent()) {
     return ClipboardFormat::Image;
   }
   else {
@@ -782,8 +769,9 @@ void Clipboard::paste(Context* ctx,
 
 ImageRef Clipboard::getImage(Palette* palette)
 {
-  // Get the image from the native clipboard.
-  if (use_native_clipboard()) {
+  // Get the image from the native clipboard (only if it's from other
+  // app, we don't need to decode our own content).
+  if (use_native_clipboard() && !hasOwnNativeContent()) {
     Image* native_image = nullptr;
     Mask* native_mask = nullptr;
     Palette* native_palette = nullptr;
@@ -807,7 +795,9 @@ ImageRef Clipboard::getImage(Palette* palette)
 
 bool Clipboard::getImageSize(gfx::Size& size)
 {
-  if (use_native_clipboard() && getNativeBitmapSize(&size))
+  if (use_native_clipboard() &&
+      !hasOwnNativeContent() &&
+      getNativeBitmapSize(&size))
     return true;
 
   if (m_data->image) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -104,10 +104,17 @@ namespace app {
     void clearNativeContent();
     void registerNativeFormats();
     bool hasNativeBitmap() const;
-    bool setNativeBitmap(const doc::Image* image,
-                         const doc::Mask* mask,
-                         const doc::Palette* palette,
-                         const doc::Tileset* tileset = nullptr);
+    // Returns true if the native clipboard still has the last
+    // content set with setNativeBitmap() (so m_data can be used
+    // directly).
+    bool hasOwnNativeContent() const;
+    // Encodes the image for other apps in a background thread (the
+    // native clipboard is updated from the UI thread when it's ready).
+    void setNativeBitmap(const doc::ImageRef& image,
+                         const std::shared_ptr<doc::Mask>& mask,
+                         const std::shared_ptr<doc::Palette>& palette,
+                         const std::shared_ptr<doc::Tileset>& tileset,
+                         const bool image_source_is_transparent);
     bool getNativeBitmap(doc::Image** image,
                          doc::Mask** mask,
                          doc::Palette** palette,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2024  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2016-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 
 #include "app/i18n/strings.h"
 #include "base/serialization.h"
+#include "base/thread_pool.h"
 #include "clip/clip.h"
 #include "doc/color_scales.h"
 #include "doc/file/hex_file.h"
@@ -26,7 +27,11 @@
 #include "os/system.h"
 #include "os/window.h"
 #include "ui/alert.h"
+#include "ui/system.h"
 
+#include <atomic>
+#include <memory>
+#include <random>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -52,6 +57,147 @@ namespace {
     }
   };
 
+  // Format with the ID of the content that this Aseprite instance
+  // put in the native clipboard (the high 32 bits are random for
+  // each instance, and the low bits a counter), so we know when we
+  // can paste the m_data directly without decoding the native data.
+  clip::format owner_format = 0;
+  uint64_t native_session_id = 0;
+  uint32_t native_counter = 0;
+  std::atomic<uint64_t> native_id(0);
+
+  // The custom format is temporary data, we prefer speed over size
+  const int kNativeCompressionLevel = 1;
+
+  // Image/custom formats encoded in a background thread
+  struct NativeBitmap {
+    std::vector<char> data;
+    clip::image image;
+    bool hasImage = false;
+    // Keeps the pixels used by "image" (it can reference the RGB
+    // image data directly)
+    doc::ImageRef source;
+  };
+
+  base::thread_pool& native_thread_pool() {
+    // Only one thread so the images are encoded in the same order
+    // they were copied
+    static base::thread_pool pool(1);
+    return pool;
+  }
+
+  bool has_owner_id(clip::lock& l, const uint64_t id) {
+    uint64_t ownerId = 0;
+    return (l.is_convertible(owner_format) &&
+            l.get_data_length(owner_format) == sizeof(ownerId) &&
+            l.get_data(owner_format, (char*)&ownerId, sizeof(ownerId)) &&
+            ownerId == id);
+  }
+
+  NativeBitmap encode_native_bitmap(doc::ImageRef image,
+                                    const doc::Mask* mask,
+                                    const doc::Palette* palette,
+                                    const doc::Tileset* tileset,
+                                    const bool image_source_is_transparent) {
+    NativeBitmap bitmap;
+
+    // Use a copy of the image to save it without mask color (the
+    // original image is shared with the clipboard m_data)
+    if (!image->isTilemap() &&
+        !image_source_is_transparent &&
+        image->maskColor() != doc::color_t(-1)) {
+      image.reset(doc::Image::createCopy(image.get()));
+      image->setMaskColor(-1);
+    }
+    bitmap.source = image;
+
+    // Set custom clipboard formats
+    if (custom_image_format) {
+      std::stringstream os;
+      write32(os,
+              1 |
+              (mask    ? 2: 0) |
+              (palette ? 4: 0) |
+              (tileset ? 8: 0));
+      doc::write_image(os, image.get(), nullptr, kNativeCompressionLevel);
+      if (mask) doc::write_mask(os, mask);
+      if (palette) doc::write_palette(os, palette);
+      if (tileset) doc::write_tileset(os, tileset);
+
+      if (os.good()) {
+        size_t size = (size_t)os.tellp();
+        if (size > 0) {
+          bitmap.data.resize(size);
+          os.seekp(0);
+          os.read(&bitmap.data[0], size);
+        }
+      }
+    }
+
+    clip::image_spec spec;
+    spec.width = image->width();
+    spec.height = image->height();
+    spec.bits_per_pixel = 32;
+    spec.bytes_per_row = (image->pixelFormat() == doc::IMAGE_RGB ?
+                          image->rowBytes(): 4*spec.width);
+    spec.red_mask    = doc::rgba_r_mask;
+    spec.green_mask  = doc::rgba_g_mask;
+    spec.blue_mask   = doc::rgba_b_mask;
+    spec.alpha_mask  = doc::rgba_a_mask;
+    spec.red_shift   = doc::rgba_r_shift;
+    spec.green_shift = doc::rgba_g_shift;
+    spec.blue_shift  = doc::rgba_b_shift;
+    spec.alpha_shift = doc::rgba_a_shift;
+
+    switch (image->pixelFormat()) {
+      case doc::IMAGE_RGB: {
+        // We use the RGB image data directly
+        bitmap.image = clip::image(image->getPixelAddress(0, 0), spec);
+        bitmap.hasImage = true;
+        break;
+      }
+      case doc::IMAGE_GRAYSCALE: {
+        clip::image img(spec);
+        const doc::LockImageBits<doc::GrayscaleTraits> bits(image.get());
+        auto it = bits.begin();
+        uint32_t* dst = (uint32_t*)img.data();
+        for (int y=0; y<image->height(); ++y) {
+          for (int x=0; x<image->width(); ++x, ++it) {
+            doc::color_t c = *it;
+            *(dst++) = doc::rgba(doc::graya_getv(c),
+                                 doc::graya_getv(c),
+                                 doc::graya_getv(c),
+                                 doc::graya_geta(c));
+          }
+        }
+        bitmap.image = std::move(img);
+        bitmap.hasImage = true;
+        break;
+      }
+      case doc::IMAGE_INDEXED: {
+        clip::image img(spec);
+        const doc::LockImageBits<doc::IndexedTraits> bits(image.get());
+        auto it = bits.begin();
+        uint32_t* dst = (uint32_t*)img.data();
+        for (int y=0; y<image->height(); ++y) {
+          for (int x=0; x<image->width(); ++x, ++it) {
+            doc::color_t c = palette->getEntry(*it);
+
+            // Use alpha=0 for mask color
+            if (*it == image->maskColor())
+              c &= doc::rgba_rgb_mask;
+
+            *(dst++) = c;
+          }
+        }
+        bitmap.image = std::move(img);
+        bitmap.hasImage = true;
+        break;
+      }
+    }
+    return bitmap;
+  }
+
   void* native_window_handle() {
     return os::instance()->defaultWindow()->nativeHandle();
   }
@@ -82,6 +228,8 @@ void Clipboard::registerNativeFormats()
 {
   clip::set_error_handler(custom_error_handler);
   custom_image_format = clip::register_format("org.aseprite.Image");
+  owner_format = clip::register_format("org.aseprite.Owner");
+  native_session_id = (uint64_t(std::random_device()()) << 32);
 }
 
 bool Clipboard::hasNativeBitmap() const
@@ -90,106 +238,68 @@ bool Clipboard::hasNativeBitmap() const
   return clip::has(clip::image_format());
 }
 
-bool Clipboard::setNativeBitmap(const doc::Image* image,
-                                const doc::Mask* mask,
-                                const doc::Palette* palette,
-                                const doc::Tileset* tileset)
+void Clipboard::setNativeBitmap(const doc::ImageRef& image,
+                                const std::shared_ptr<doc::Mask>& mask,
+                                const std::shared_ptr<doc::Palette>& palette,
+                                const std::shared_ptr<doc::Tileset>& tileset,
+                                const bool image_source_is_transparent)
 {
+  const uint64_t id = (native_session_id | ++native_counter);
+  native_id = id;
+
   clip::lock l(native_window_handle());
   if (!l.locked())
-    return false;
+    return;
 
   l.clear();
 
   if (!image)
-    return false;
-
-  // Set custom clipboard formats
-  if (custom_image_format) {
-    std::stringstream os;
-    write32(os,
-            (image   ? 1: 0) |
-            (mask    ? 2: 0) |
-            (palette ? 4: 0) |
-            (tileset ? 8: 0));
-    if (image) doc::write_image(os, image);
-    if (mask) doc::write_mask(os, mask);
-    if (palette) doc::write_palette(os, palette);
-    if (tileset) doc::write_tileset(os, tileset);
-
-    if (os.good()) {
-      size_t size = (size_t)os.tellp();
-      if (size > 0) {
-        std::vector<char> data(size);
-        os.seekp(0);
-        os.read(&data[0], size);
-
-        l.set_data(custom_image_format, &data[0], size);
-      }
-    }
-  }
-
-  clip::image_spec spec;
-  spec.width = image->width();
-  spec.height = image->height();
-  spec.bits_per_pixel = 32;
-  spec.bytes_per_row = (image->pixelFormat() == doc::IMAGE_RGB ?
-                        image->rowBytes(): 4*spec.width);
-  spec.red_mask    = doc::rgba_r_mask;
-  spec.green_mask  = doc::rgba_g_mask;
-  spec.blue_mask   = doc::rgba_b_mask;
-  spec.alpha_mask  = doc::rgba_a_mask;
-  spec.red_shift   = doc::rgba_r_shift;
-  spec.green_shift = doc::rgba_g_shift;
-  spec.blue_shift  = doc::rgba_b_shift;
-  spec.alpha_shift = doc::rgba_a_shift;
-
-  switch (image->pixelFormat()) {
-    case doc::IMAGE_RGB: {
-      // We use the RGB image data directly
-      clip::image img(image->getPixelAddress(0, 0), spec);
-      l.set_image(img);
-      break;
-    }
-    case doc::IMAGE_GRAYSCALE: {
-      clip::image img(spec);
-      const doc::LockImageBits<doc::GrayscaleTraits> bits(image);
-      auto it = bits.begin();
-      uint32_t* dst = (uint32_t*)img.data();
-      for (int y=0; y<image->height(); ++y) {
-        for (int x=0; x<image->width(); ++x, ++it) {
-          doc::color_t c = *it;
-          *(dst++) = doc::rgba(doc::graya_getv(c),
-                               doc::graya_getv(c),
-                               doc::graya_getv(c),
-                               doc::graya_geta(c));
-        }
-      }
-      l.set_image(img);
-      break;
-    }
-    case doc::IMAGE_INDEXED: {
-      clip::image img(spec);
-      const doc::LockImageBits<doc::IndexedTraits> bits(image);
-      auto it = bits.begin();
-      uint32_t* dst = (uint32_t*)img.data();
-      for (int y=0; y<image->height(); ++y) {
-        for (int x=0; x<image->width(); ++x, ++it) {
-          doc::color_t c = palette->getEntry(*it);
-
-          // Use alpha=0 for mask color
-          if (*it == image->maskColor())
-            c &= doc::rgba_rgb_mask;
+    return;
+
+  // We take the ownership of the native clipboard right now (so
+  // pasting in Aseprite uses the m_data directly), and the image
+  // formats are added when they are ready.
+  if (owner_format)
+    l.set_data(owner_format, (const char*)&id, sizeof(id));
+
+  native_thread_pool().execute(
+    [id, image, mask, palette, tileset, image_source_is_transparent]{
+      // Skip old images if the clipboard was set again
+      if (native_id != id)
+        return;
+
+      auto bitmap = std::make_shared<NativeBitmap>(
+        encode_native_bitmap(image, mask.get(), palette.get(), tileset.get(),
+                             image_source_is_transparent));
+
+      ui::execute_from_ui_thread(
+        [id, bitmap]{
+          if (native_id != id || !Clipboard::instance())
+            return;
+
+          clip::lock l(native_window_handle());
+          if (!l.locked() || !has_owner_id(l, id))
+            return;
+
+          // Add the custom/image formats keeping the owner ID
+          l.clear();
+          l.set_data(owner_format, (const char*)&id, sizeof(id));
+          if (!bitmap->data.empty())
+            l.set_data(custom_image_format, &bitmap->data[0], bitmap->data.size());
+          if (bitmap->hasImage)
+            l.set_image(bitmap->image);
+        });
+    });
+}
 
-          *(dst++) = c;
-        }
-      }
-      l.set_image(img);
-      break;
-    }
-  }
+bool Clipboard::hasOwnNativeContent() const
+{
+  if (!owner_format || !native_id)
+    return false;
 
-  return true;
+  InhibitClipErrors ice;
+  clip::lock l(native_window_handle());
+  return (l.locked() && has_owner_id(l, native_id));
 }
 
 bool Clipboard::getNativeBitmap(doc::Image** image,
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -212,8 +212,8 @@ ExpandCelCanvas::~ExpandCelCanvas()
 void ExpandCelCanvas::commit()
 {
   EXP_TRACE("ExpandCelCanvas::commit",
-            "validSrcRegion", m_validSrcRegion.bounds(),
-            "validDstRegion", m_validDstRegion.bounds());
+            "validSrcRegion", m_validSrcTiles.region().bounds(),
+            "validDstRegion", m_validDstTiles.region().bounds());
 
   ASSERT(!m_closed);
   ASSERT(!m_committed);
@@ -295,13 +295,14 @@ void ExpandCelCanvas::commit()
     }
 #endif
 
-    gfx::Region* regionToPatch = &m_validDstRegion;
+    gfx::Region validDstRegion = m_validDstTiles.region();
+    gfx::Region* regionToPatch = &validDstRegion;
     gfx::Region reduced;
 
     if (m_canCompareSrcVsDst) {
-      ASSERT(gfx::Region().createSubtraction(m_validDstRegion, m_validSrcRegion).isEmpty());
+      ASSERT(m_validDstTiles.isSubsetOf(m_validSrcTiles));
 
-      for (gfx::Rect rc : m_validDstRegion) {
+      for (gfx::Rect rc : validDstRegion) {
         if (algorithm::shrink_bounds2(getSourceCanvas(),
                                       getDestCanvas(), rc, rc)) {
           reduced |= gfx::Region(rc);
@@ -349,8 +350,11 @@ void ExpandCelCanvas::commit()
         ASSERT(srcTileset);
         ASSERT(srcTileset->size() == m_dstTileset->size());
 
-        // Patch tiles
+        // Patch tiles (only modified tiles can be different)
         for (tile_index ti=1; ti<srcTileset->size(); ++ti) {
+          if (ti >= m_modifiedDstTiles.size() || !m_modifiedDstTiles[ti])
+            continue;
+
           gfx::Region diffRgn;
           create_region_with_differences(srcTileset->get(ti).get(),
                                          m_dstTileset->get(ti).get(),
@@ -472,6 +476,7 @@ Image* ExpandCelCanvas::getSourceCanvas()
       m_srcImage->setMaskColor(m_sprite->transparentColor());
     }
     m_srcImage->clear(m_srcImage->maskColor());
+    m_validSrcTiles.reset(m_srcImage->size());
   }
   return m_srcImage.get();
 }
@@ -490,6 +495,7 @@ Image* ExpandCelCanvas::getDestCanvas()
       m_dstImage->setMaskColor(m_sprite->transparentColor());
     }
     m_dstImage->clear(m_dstImage->maskColor());
+    m_validDstTiles.reset(m_dstImage->size());
   }
   return m_dstImage.get();
 }
@@ -509,6 +515,7 @@ Tileset* ExpandCelCanvas::getDestTileset()
 
     ASSERT(srcTileset);
     m_dstTileset.reset(Tileset::MakeCopyWithoutImages(srcTileset));
+    m_modifiedDstTiles.assign(srcTileset->size(), true);
     copySourceTilestToDestTileset();
   }
   return m_dstTileset.get();
@@ -520,148 +527,122 @@ void ExpandCelCanvas::validateSourceCanvas(const gfx::Region& rgn)
 
   getSourceCanvas();
 
-  gfx::Region rgnToValidate;
+  const bool tiles = (m_tilemapMode == TilemapMode::Tiles);
   gfx::Point origCelPos;
   gfx::Point zeroPos;
-  if (m_tilemapMode == TilemapMode::Tiles) {
+  if (tiles) {
     // Position of the tilemap cel inside the m_dstImage tilemap
     origCelPos = m_grid.canvasToTile(m_origCelPos);
-    rgnToValidate = m_grid.canvasToTile(rgn);
   }
   else {
     origCelPos = m_origCelPos;
-    rgnToValidate = rgn;
     zeroPos = -m_bounds.origin();
   }
-  EXP_TRACE(" ->", rgnToValidate.bounds());
 
-  rgnToValidate.offset(zeroPos);
-  rgnToValidate.createSubtraction(rgnToValidate, m_validSrcRegion);
-  rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_srcImage->bounds()));
+  const bool fromCel = (m_celImage && previewSpecificLayerChanges());
+  gfx::Rect celBounds;
+  if (fromCel) {
+    celBounds = m_celImage->bounds()
+      .offset(origCelPos)
+      .offset(zeroPos);
+  }
+
+  render::Render subRender;
 
-  if (m_celImage && previewSpecificLayerChanges()) {
-    gfx::Region rgnToClear;
-    rgnToClear.createSubtraction(
-      rgnToValidate,
-      gfx::Region(m_celImage->bounds()
-                  .offset(origCelPos)
-                  .offset(zeroPos)));
-    for (const auto& rc : rgnToClear)
+  // Called for each run of tiles that must be copied from the cel
+  // image to m_srcImage.
+  auto validateRect = [&](const gfx::Rect& rc) {
+    if (!fromCel) {
       fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
+      return;
+    }
+
+    if (!celBounds.contains(rc)) {
+      gfx::Region rgnToClear(rc);
+      rgnToClear.createSubtraction(rgnToClear, gfx::Region(celBounds));
+      for (const auto& rc2 : rgnToClear)
+        fill_rect(m_srcImage.get(), rc2, m_srcImage->maskColor());
+    }
 
     if (m_celImage->pixelFormat() == IMAGE_TILEMAP &&
         m_srcImage->pixelFormat() != IMAGE_TILEMAP) {
       ASSERT(m_tilemapMode == TilemapMode::Pixels);
 
       // For tilemaps, we can use the Render class to render visible
-      // tiles in the rgnToValidate of this cel.
-      render::Render subRender;
-      for (const auto& rc : rgnToValidate) {
-        subRender.renderCel(
-          m_srcImage.get(),
-          m_cel,
-          m_sprite,
-          m_celImage.get(),
-          m_layer,
-          m_sprite->palette(m_frame),
-          gfx::RectF(0, 0, m_bounds.w, m_bounds.h),
-          gfx::Clip(rc.x, rc.y,
-                    rc.x+m_bounds.x-origCelPos.x,
-                    rc.y+m_bounds.y-origCelPos.y, rc.w, rc.h),
-          255, BlendMode::NORMAL);
-      }
+      // tiles in the rc of this cel.
+      subRender.renderCel(
+        m_srcImage.get(),
+        m_cel,
+        m_sprite,
+        m_celImage.get(),
+        m_layer,
+        m_sprite->palette(m_frame),
+        gfx::RectF(0, 0, m_bounds.w, m_bounds.h),
+        gfx::Clip(rc.x, rc.y,
+                  rc.x+m_bounds.x-origCelPos.x,
+                  rc.y+m_bounds.y-origCelPos.y, rc.w, rc.h),
+        255, BlendMode::NORMAL);
     }
     else if (m_celImage->pixelFormat() == IMAGE_TILEMAP &&
              m_srcImage->pixelFormat() == IMAGE_TILEMAP) {
       ASSERT(m_tilemapMode == TilemapMode::Tiles);
 
       // We can copy the cel image directly
-      for (const auto& rc : rgnToValidate) {
-        m_srcImage->copy(
-          m_celImage.get(),
-          gfx::Clip(rc.x, rc.y,
-                    rc.x-origCelPos.x,
-                    rc.y-origCelPos.y, rc.w, rc.h));
-      }
+      m_srcImage->copy(
+        m_celImage.get(),
+        gfx::Clip(rc.x, rc.y,
+                  rc.x-origCelPos.x,
+                  rc.y-origCelPos.y, rc.w, rc.h));
     }
     else {
       ASSERT(m_celImage->pixelFormat() != IMAGE_TILEMAP ||
              m_tilemapMode == TilemapMode::Tiles);
 
       // We can copy the cel image directly
-      for (const auto& rc : rgnToValidate)
-        m_srcImage->copy(
-          m_celImage.get(),
-          gfx::Clip(rc.x, rc.y,
-                    rc.x+m_bounds.x-origCelPos.x,
-                    rc.y+m_bounds.y-origCelPos.y, rc.w, rc.h));
+      m_srcImage->copy(
+        m_celImage.get(),
+        gfx::Clip(rc.x, rc.y,
+                  rc.x+m_bounds.x-origCelPos.x,
+                  rc.y+m_bounds.y-origCelPos.y, rc.w, rc.h));
     }
-  }
-  else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_srcImage.get(), rc, m_srcImage->maskColor());
-  }
+  };
+
+  for (const auto& rc : rgn) {
+    gfx::Rect rcToValidate = (tiles ? m_grid.canvasToTile(rc): rc);
+    rcToValidate.offset(zeroPos);
+    EXP_TRACE(" ->", rcToValidate);
 
-  m_validSrcRegion.createUnion(m_validSrcRegion, rgnToValidate);
+    m_validSrcTiles.validate(rcToValidate, validateRect);
+  }
 }
 
 void ExpandCelCanvas::validateDestCanvas(const gfx::Region& rgn)
 {
   EXP_TRACE("ExpandCelCanvas::validateDestCanvas", rgn.bounds());
 
-  Image* src;
-  int src_x, src_y;
-  if ((m_flags & NeedsSource) == NeedsSource) {
+  if ((m_flags & NeedsSource) == NeedsSource)
     validateSourceCanvas(rgn);
-    src = m_srcImage.get();
-    src_x = m_bounds.x;
-    src_y = m_bounds.y;
-  }
-  else {
-    src = m_cel->image();
-    src_x = m_origCelPos.x;
-    src_y = m_origCelPos.y;
-  }
 
-  getDestCanvas();              // Create m_dstImage
+  gfx::Point srcPos;
+  const Image* src = getSourceForDestCanvas(srcPos);
 
-  gfx::Region rgnToValidate;
-  if (m_tilemapMode == TilemapMode::Tiles) {
-    for (const auto& rc : rgn)
-      rgnToValidate |= gfx::Region(m_grid.canvasToTile(rc));
-  }
-  else {
-    rgnToValidate = rgn;
-  }
-  EXP_TRACE(" ->", rgnToValidate.bounds());
-
-  if (m_tilemapMode != TilemapMode::Tiles)
-    rgnToValidate.offset(-m_bounds.origin());
-  rgnToValidate.createSubtraction(rgnToValidate, m_validDstRegion);
-  rgnToValidate.createIntersection(rgnToValidate, gfx::Region(m_dstImage->bounds()));
+  getDestCanvas();              // Create m_dstImage
 
-  // ASSERT(src);                  // TODO is it always true?
-  if (src) {
-    gfx::Region rgnToClear;
-    rgnToClear.createSubtraction(rgnToValidate,
-      gfx::Region(src->bounds()
-        .offset(src_x, src_y)
-        .offset(-m_bounds.origin())));
-    for (const auto& rc : rgnToClear)
-      fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
-
-    for (const auto& rc : rgnToValidate)
-      m_dstImage->copy(src,
-        gfx::Clip(rc.x, rc.y,
-          rc.x+m_bounds.x-src_x,
-          rc.y+m_bounds.y-src_y, rc.w, rc.h));
-  }
-  else {
-    for (const auto& rc : rgnToValidate)
-      fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
+  const bool tiles = (m_tilemapMode == TilemapMode::Tiles);
+  for (const auto& rc : rgn) {
+    gfx::Rect rcToValidate;
+    if (tiles)
+      rcToValidate = m_grid.canvasToTile(rc);
+    else
+      rcToValidate = gfx::Rect(rc).offset(-m_bounds.origin());
+    EXP_TRACE(" ->", rcToValidate);
+
+    m_validDstTiles.validate(
+      rcToValidate,
+      [this, src, &srcPos](const gfx::Rect& rc2) {
+        copySourceToDestCanvas(src, srcPos, rc2);
+      });
   }
-
-  m_validDstRegion.createUnion(m_validDstRegion, rgnToValidate);
 }
 
 void ExpandCelCanvas::validateDestTileset(const gfx::Region& rgn, const gfx::Region& forceRgn)
@@ -681,16 +662,17 @@ void ExpandCelCanvas::validateDestTileset(const gfx::Region& rgn, const gfx::Reg
         return trimDstImage(tileBoundsInCanvas);
       },
       forceRgn);
+
+    markModifiedDestTiles(rgn);
   }
 }
 
 void ExpandCelCanvas::invalidateDestCanvas()
 {
   EXP_TRACE("ExpandCelCanvas::invalidateDestCanvas");
-  m_validDstRegion.clear();
+  m_validDstTiles.invalidateAll();
 
-  // Copy tileset for preview again
-  // TODO Is there a way to avoid copying tiles that weren't modified? comparing versions maybe?
+  // Copy modified tiles of the tileset for preview again
   if (m_dstTileset)
     copySourceTilestToDestTileset();
 }
@@ -699,22 +681,33 @@ void ExpandCelCanvas::invalidateDestCanvas(const gfx::Region& rgn)
 {
   EXP_TRACE("ExpandCelCanvas::invalidateDestCanvas", rgn.bounds());
 
-  gfx::Region rgnToInvalidate(rgn);
-  rgnToInvalidate.offset(-m_bounds.origin());
-  m_validDstRegion.createSubtraction(m_validDstRegion, rgnToInvalidate);
+  gfx::Point srcPos;
+  const Image* src = getSourceForDestCanvas(srcPos);
+
+  // Tiles partially inside the region are still valid, so we restore
+  // the invalidated pixels from the source.
+  for (const auto& rc : rgn) {
+    m_validDstTiles.invalidate(
+      gfx::Rect(rc).offset(-m_bounds.origin()),
+      [this, src, &srcPos](const gfx::Rect& rc2) {
+        copySourceToDestCanvas(src, srcPos, rc2);
+      });
+  }
 }
 
 void ExpandCelCanvas::copyValidDestToSourceCanvas(const gfx::Region& rgn)
 {
   EXP_TRACE("ExpandCelCanvas::copyValidDestToSourceCanvas", rgn.bounds());
 
-  gfx::Region rgn2(rgn);
-  rgn2.offset(-m_bounds.origin());
-  rgn2.createIntersection(rgn2, m_validSrcRegion);
-  rgn2.createIntersection(rgn2, m_validDstRegion);
-  for (const auto& rc : rgn2)
-    m_srcImage->copy(m_dstImage.get(),
-      gfx::Clip(rc.x, rc.y, rc.x, rc.y, rc.w, rc.h));
+  for (const auto& rc : rgn) {
+    m_validSrcTiles.forEachValid(
+      gfx::Rect(rc).offset(-m_bounds.origin()),
+      m_validDstTiles,
+      [this](const gfx::Rect& rc2) {
+        m_srcImage->copy(m_dstImage.get(),
+          gfx::Clip(rc2.x, rc2.y, rc2.x, rc2.y, rc2.w, rc2.h));
+      });
+  }
 
   // We cannot compare src vs dst in this case (e.g. on tools like
   // spray and jumble that updated the source image from the modified
@@ -722,6 +715,47 @@ void ExpandCelCanvas::copyValidDestToSourceCanvas(const gfx::Region& rgn)
   m_canCompareSrcVsDst = false;
 }
 
+// Returns the image used to validate m_dstImage and its position in
+// canvas coordinates.
+const Image* ExpandCelCanvas::getSourceForDestCanvas(gfx::Point& srcPos) const
+{
+  if ((m_flags & NeedsSource) == NeedsSource) {
+    srcPos = m_bounds.origin();
+    return m_srcImage.get();
+  }
+  else {
+    srcPos = m_origCelPos;
+    return m_cel->image();
+  }
+}
+
+// Copies the "rc" rectangle (in m_dstImage coordinates) from "src"
+// to m_dstImage, clearing the pixels outside "src".
+void ExpandCelCanvas::copySourceToDestCanvas(const Image* src,
+                                             const gfx::Point& srcPos,
+                                             const gfx::Rect& rc)
+{
+  // ASSERT(src);                  // TODO is it always true?
+  if (!src) {
+    fill_rect(m_dstImage.get(), rc, m_dstImage->maskColor());
+    return;
+  }
+
+  const gfx::Rect srcBounds =
+    src->bounds().offset(srcPos).offset(-m_bounds.origin());
+  if (!srcBounds.contains(rc)) {
+    gfx::Region rgnToClear(rc);
+    rgnToClear.createSubtraction(rgnToClear, gfx::Region(srcBounds));
+    for (const auto& rc2 : rgnToClear)
+      fill_rect(m_dstImage.get(), rc2, m_dstImage->maskColor());
+  }
+
+  m_dstImage->copy(src,
+    gfx::Clip(rc.x, rc.y,
+      rc.x+m_bounds.x-srcPos.x,
+      rc.y+m_bounds.y-srcPos.y, rc.w, rc.h));
+}
+
 gfx::Rect ExpandCelCanvas::getTrimDstImageBounds() const
 {
   if (m_layer->isBackground())
@@ -750,12 +784,41 @@ void ExpandCelCanvas::copySourceTilestToDestTileset()
   const Tileset* srcTileset = static_cast<LayerTilemap*>(m_layer)->tileset();
 
   for (tile_index i=0; i<srcTileset->size(); ++i) {
+    if (i < m_modifiedDstTiles.size() && !m_modifiedDstTiles[i])
+      continue;
+
     doc::copy_image(m_dstTileset->get(i).get(),
                     srcTileset->get(i).get());
     m_dstTileset->setTileData(i, srcTileset->getTileData(i));
-    // To rehash the tileset
+    // To rehash the tile
     m_dstTileset->notifyTileContentChange(i);
   }
+  m_modifiedDstTiles.assign(srcTileset->size(), false);
+}
+
+// Marks the tiles of m_dstTileset used in the given region of the
+// tilemap (in canvas coordinates) as modified, so they are the only
+// ones restored in invalidateDestCanvas() and patched in commit().
+void ExpandCelCanvas::markModifiedDestTiles(const gfx::Region& rgn)
+{
+  const Image* tilemap = m_cel->image();
+  ASSERT(tilemap->pixelFormat() == IMAGE_TILEMAP);
+
+  doc::Grid grid = m_dstTileset->grid();
+  grid.origin(grid.origin() + m_cel->position());
+
+  for (const gfx::Point& tilePt : grid.tilesInCanvasRegion(rgn)) {
+    if (!tilemap->bounds().contains(tilePt))
+      continue;
+
+    const doc::tile_t t = tilemap->getPixel(tilePt.x, tilePt.y);
+    if (t == doc::notile)
+      continue;
+
+    const doc::tile_index ti = doc::tile_geti(t);
+    if (ti < m_modifiedDstTiles.size())
+      m_modifiedDstTiles[ti] = true;
+  }
 }
 
 } // namespace app
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,6 +11,7 @@
 
 #include "app/tilemap_mode.h"
 #include "app/tileset_mode.h"
+#include "app/util/valid_tiles.h"
 #include "doc/frame.h"
 #include "doc/grid.h"
 #include "doc/image_ref.h"
@@ -21,6 +22,8 @@
 #include "gfx/region.h"
 #include "gfx/size.h"
 
+#include <vector>
+
 namespace doc {
   class Cel;
   class Image;
@@ -97,6 +100,11 @@ namespace app {
     gfx::Rect getTrimDstImageBounds() const;
     ImageRef trimDstImage(const gfx::Rect& bounds) const;
     void copySourceTilestToDestTileset();
+    void markModifiedDestTiles(const gfx::Region& rgn);
+    const Image* getSourceForDestCanvas(gfx::Point& srcPos) const;
+    void copySourceToDestCanvas(const Image* src,
+                                const gfx::Point& srcPos,
+                                const gfx::Rect& rc);
 
     bool isTilesetPreview() const {
       return ((m_flags & TilesetPreview) == TilesetPreview);
@@ -127,11 +135,16 @@ namespace app {
     ImageRef m_srcImage;
     ImageRef m_dstImage;
     std::unique_ptr<Tileset> m_dstTileset;
+    // Tiles of m_dstTileset that can be different from the original
+    // tileset (tiles that were modified since they were copied).
+    std::vector<bool> m_modifiedDstTiles;
     bool m_closed;
     bool m_committed;
     CmdSequence* m_cmds;
-    gfx::Region m_validSrcRegion;
-    gfx::Region m_validDstRegion;
+    // Tiles of m_srcImage/m_dstImage that were already copied from
+    // the original cel.
+    ValidTiles m_validSrcTiles;
+    ValidTiles m_validDstTiles;
 
     // True if we can compare src image with dst image to patch the
     // cel. This is false when dst is copied to the src, so we cannot
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2022  Igara Studio S.A.
+// Copyright (C) 2022-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,24 +21,90 @@
 #include "ft/hb_shaper.h"
 #include "ft/lib.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
+#include <tuple>
 
 namespace app {
 
+namespace {
+
+// Opened font faces, so we don't need to load the font file again
+// each time we render a text (e.g. the FontPopup renders a preview
+// for each font), and the glyphs already loaded by each face are
+// re-used. There is one face for each size/antialias combination so
+// changing the size doesn't invalidate the glyphs of other sizes.
+class FaceCache {
+public:
+  static const int kMaxFaces = 16;
+
+  // Returns nullptr if the font cannot be loaded.
+  ft::Face* get(const std::string& fontfile,
+                const int fontsize,
+                const bool antialias) {
+    const Key key(fontfile, fontsize, antialias);
+    auto it = m_faces.find(key);
+    if (it != m_faces.end()) {
+      it->second.lastUse = ++m_useCounter;
+      return it->second.face.get();
+    }
+
+    auto face = std::make_unique<ft::Face>(m_lib.open(fontfile));
+    if (!face->isValid())
+      return nullptr;
+
+    face->setSize(fontsize);
+    face->setAntialias(antialias);
+
+    // Remove the least recently used face
+    if (int(m_faces.size()) >= kMaxFaces) {
+      auto lru = m_faces.begin();
+      for (auto it2=m_faces.begin(); it2!=m_faces.end(); ++it2) {
+        if (it2->second.lastUse < lru->second.lastUse)
+          lru = it2;
+      }
+      m_faces.erase(lru);
+    }
+
+    ft::Face* result = face.get();
+    m_faces[key] = Entry{ std::move(face), ++m_useCounter };
+    return result;
+  }
+
+  std::mutex& mutex() { return m_mutex; }
+
+private:
+  using Key = std::tuple<std::string, int, bool>;
+
+  struct Entry {
+    std::unique_ptr<ft::Face> face;
+    int lastUse = 0;
+  };
+
+  std::mutex m_mutex;
+  // The library must be destroyed after the faces
+  ft::Lib m_lib;
+  std::map<Key, Entry> m_faces;
+  int m_useCounter = 0;
+};
+
+FaceCache g_faces;
+
+} // anonymous namespace
+
 doc::Image* render_text(const std::string& fontfile, int fontsize,
                         const std::string& text,
                         doc::color_t color,
                         bool antialias)
 {
   std::unique_ptr<doc::Image> image(nullptr);
-  ft::Lib ft;
 
-  ft::Face face(ft.open(fontfile));
-  if (face.isValid()) {
-    // Set font size
-    face.setSize(fontsize);
-    face.setAntialias(antialias);
+  const std::lock_guard lock(g_faces.mutex());
+  ft::Face* facePtr = g_faces.get(fontfile, fontsize, antialias);
+  if (facePtr) {
+    ft::Face& face = *facePtr;
 
     // Calculate text size
     gfx::Rect bounds = ft::calc_text_bounds(face, text);
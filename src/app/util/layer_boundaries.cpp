@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -24,78 +24,190 @@
 #include "doc/layer.h"
 #include "doc/mask.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <unordered_map>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define APP_LAYER_BOUNDARIES_SSE2 1
+#endif
+
 using namespace doc;
 
 namespace app {
 
-void select_layer_boundaries(Layer* layer,
-                             const frame_t frame,
-                             const SelectLayerBoundariesOp op)
-{
-  Mask newMask;
+namespace {
 
-  const Cel* cel = layer->cel(frame);
-  if (cel) {
-    const Image* image = cel->image();
-    if (image) {
-      newMask.replace(cel->bounds());
-      newMask.freeze();
-      {
-        LockImageBits<BitmapTraits> maskBits(newMask.bitmap());
-        auto maskIt = maskBits.begin();
-        auto maskEnd = maskBits.end();
-
-        switch (image->pixelFormat()) {
-
-          case IMAGE_RGB: {
-            LockImageBits<RgbTraits> rgbBits(image);
-            auto rgbIt = rgbBits.begin();
-#if _DEBUG
-            auto rgbEnd = rgbBits.end();
+// Opaque bounds (relative to the image) of the last used cel images
+struct OpaqueBounds {
+  ObjectVersion version;
+  gfx::Rect bounds;
+};
+
+const std::size_t kMaxCachedBounds = 256;
+std::unordered_map<ObjectId, OpaqueBounds> g_opaqueBounds;
+
+// Functions to convert a row of "w" pixels to a row of a bitmap (one
+// bit for each pixel, the least significant bit first). A pixel is
+// selected if its alpha is >= 128 (the most significant bit of the
+// alpha) or if it's not the mask color in indexed images.
+// TODO configurable threshold
+
+void rgb_row_to_bits(const uint32_t* src, uint8_t* dst, const int w, color_t)
+{
+  int x = 0;
+#if APP_LAYER_BOUNDARIES_SSE2
+  for (; x+16<=w; x+=16, src+=16, dst+=2) {
+    const __m128i a0 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)src), 24);
+    const __m128i a1 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src+4)), 24);
+    const __m128i a2 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src+8)), 24);
+    const __m128i a3 = _mm_srli_epi32(_mm_loadu_si128((const __m128i*)(src+12)), 24);
+    const __m128i a = _mm_packus_epi16(_mm_packs_epi32(a0, a1),
+                                       _mm_packs_epi32(a2, a3));
+    const int bits = _mm_movemask_epi8(a);
+    dst[0] = uint8_t(bits);
+    dst[1] = uint8_t(bits >> 8);
+  }
 #endif
-            for (; maskIt != maskEnd; ++maskIt, ++rgbIt) {
-              ASSERT(rgbIt != rgbEnd);
-              color_t c = *rgbIt;
-              *maskIt = (rgba_geta(c) >= 128); // TODO configurable threshold
-            }
-            break;
-          }
-
-          case IMAGE_GRAYSCALE: {
-            LockImageBits<GrayscaleTraits> grayBits(image);
-            auto grayIt = grayBits.begin();
-#if _DEBUG
-            auto grayEnd = grayBits.end();
+  for (; x<w; x+=8, src+=8, ++dst) {
+    const int n = std::min(8, w-x);
+    uint8_t bits = 0;
+    for (int i=0; i<n; ++i) {
+      if (rgba_geta(src[i]) >= 128)
+        bits |= (1 << i);
+    }
+    *dst = bits;
+  }
+}
+
+void gray_row_to_bits(const uint16_t* src, uint8_t* dst, const int w, color_t)
+{
+  int x = 0;
+#if APP_LAYER_BOUNDARIES_SSE2
+  for (; x+16<=w; x+=16, src+=16, dst+=2) {
+    const __m128i a0 = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)src), 8);
+    const __m128i a1 = _mm_srli_epi16(_mm_loadu_si128((const __m128i*)(src+8)), 8);
+    const int bits = _mm_movemask_epi8(_mm_packus_epi16(a0, a1));
+    dst[0] = uint8_t(bits);
+    dst[1] = uint8_t(bits >> 8);
+  }
 #endif
-            for (; maskIt != maskEnd; ++maskIt, ++grayIt) {
-              ASSERT(grayIt != grayEnd);
-              color_t c = *grayIt;
-              *maskIt = (graya_geta(c) >= 128); // TODO configurable threshold
-            }
-            break;
-          }
-
-          case IMAGE_INDEXED: {
-            const doc::color_t maskColor = image->maskColor();
-            LockImageBits<IndexedTraits> idxBits(image);
-            auto idxIt = idxBits.begin();
-#if _DEBUG
-            auto idxEnd = idxBits.end();
+  for (; x<w; x+=8, src+=8, ++dst) {
+    const int n = std::min(8, w-x);
+    uint8_t bits = 0;
+    for (int i=0; i<n; ++i) {
+      if (graya_geta(src[i]) >= 128)
+        bits |= (1 << i);
+    }
+    *dst = bits;
+  }
+}
+
+void indexed_row_to_bits(const uint8_t* src, uint8_t* dst, const int w, color_t maskColor)
+{
+  int x = 0;
+#if APP_LAYER_BOUNDARIES_SSE2
+  const __m128i mask = _mm_set1_epi8(char(maskColor));
+  for (; x+16<=w; x+=16, src+=16, dst+=2) {
+    const __m128i v = _mm_loadu_si128((const __m128i*)src);
+    const int bits = ~_mm_movemask_epi8(_mm_cmpeq_epi8(v, mask));
+    dst[0] = uint8_t(bits);
+    dst[1] = uint8_t(bits >> 8);
+  }
 #endif
-            for (; maskIt != maskEnd; ++maskIt, ++idxIt) {
-              ASSERT(idxIt != idxEnd);
-              color_t c = *idxIt;
-              *maskIt = (c != maskColor);
-            }
-            break;
-          }
+  for (; x<w; x+=8, src+=8, ++dst) {
+    const int n = std::min(8, w-x);
+    uint8_t bits = 0;
+    for (int i=0; i<n; ++i) {
+      if (src[i] != maskColor)
+        bits |= (1 << i);
+    }
+    *dst = bits;
+  }
+}
 
-        }
-      }
-      newMask.unfreeze();
+template<typename ImageTraits, typename RowToBits>
+void image_to_mask(const Image* image,
+                   const gfx::Rect& bounds,
+                   Image* bitmap,
+                   RowToBits rowToBits)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const color_t maskColor = image->maskColor();
+  for (int y=0; y<bounds.h; ++y) {
+    rowToBits((const pixel_t*)image->getPixelAddress(bounds.x, bounds.y+y),
+              bitmap->getPixelAddress(0, y),
+              bounds.w, maskColor);
+  }
+}
+
+} // anonymous namespace
+
+void create_cel_boundaries_mask(const Cel* cel, Mask& mask)
+{
+  mask.clear();
+
+  const Image* image = cel->image();
+  if (!image)
+    return;
+
+  // Other kind of images (tilemaps) select the whole cel
+  if (image->pixelFormat() != IMAGE_RGB &&
+      image->pixelFormat() != IMAGE_GRAYSCALE &&
+      image->pixelFormat() != IMAGE_INDEXED) {
+    mask.replace(cel->bounds());
+    return;
+  }
+
+  // Scan only the opaque bounds of the image if we've already
+  // scanned it before
+  gfx::Rect bounds = image->bounds();
+  auto it = g_opaqueBounds.find(image->id());
+  if (it != g_opaqueBounds.end() &&
+      it->second.version == image->version()) {
+    bounds = it->second.bounds;
+  }
+
+  if (!bounds.isEmpty()) {
+    mask.replace(gfx::Rect(bounds).offset(cel->position()));
+    mask.freeze();
+    Image* bitmap = mask.bitmap();
+    switch (image->pixelFormat()) {
+      case IMAGE_RGB:
+        image_to_mask<RgbTraits>(image, bounds, bitmap, rgb_row_to_bits);
+        break;
+      case IMAGE_GRAYSCALE:
+        image_to_mask<GrayscaleTraits>(image, bounds, bitmap, gray_row_to_bits);
+        break;
+      case IMAGE_INDEXED:
+        image_to_mask<IndexedTraits>(image, bounds, bitmap, indexed_row_to_bits);
+        break;
     }
+    // Shrinks the mask to the selected pixels
+    mask.unfreeze();
   }
 
+  if (g_opaqueBounds.size() >= kMaxCachedBounds &&
+      it == g_opaqueBounds.end())
+    g_opaqueBounds.clear();
+
+  g_opaqueBounds[image->id()] =
+    OpaqueBounds{ image->version(),
+                  (mask.isEmpty() ? gfx::Rect():
+                                    gfx::Rect(mask.bounds()).offset(-cel->position())) };
+}
+
+void select_layer_boundaries(Layer* layer,
+                             const frame_t frame,
+                             const SelectLayerBoundariesOp op)
+{
+  Mask newMask;
+
+  const Cel* cel = layer->cel(frame);
+  if (cel)
+    create_cel_boundaries_mask(cel, newMask);
+
   try {
     ContextWriter writer(UIContext::instance());
     Doc* doc = writer.document();
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,7 +12,9 @@
 #include "doc/frame.h"
 
 namespace doc {
+  class Cel;
   class Layer;
+  class Mask;
 }
 
 namespace app {
@@ -20,6 +23,12 @@ namespace app {
     REPLACE, ADD, SUBTRACT, INTERSECT
   };
 
+  // Replaces "mask" with the visible pixels of the cel (alpha >= 128
+  // or non-transparent indexes). The opaque bounds of the last used
+  // images are cached, so the next time only that area is scanned.
+  void create_cel_boundaries_mask(const doc::Cel* cel,
+                                  doc::Mask& mask);
+
   void select_layer_boundaries(doc::Layer* layer,
                                const doc::frame_t frame,
                                const SelectLayerBoundariesOp op);
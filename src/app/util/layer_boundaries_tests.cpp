@@ -0,0 +1,125 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/cmd/clear_mask.h"
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/test_context.h"
+#include "app/util/layer_boundaries.h"
+#include "doc/cel.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+
+#include <cstdlib>
+#include <memory>
+
+using namespace app;
+using namespace doc;
+
+// Checks that the mask contains exactly the selected pixels of the cel
+static void expect_cel_mask(const Cel* cel, const Mask& mask,
+                            bool (*selected)(color_t))
+{
+  const Image* image = cel->image();
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      EXPECT_EQ(selected(get_pixel(image, x, y)),
+                mask.containsPoint(cel->x()+x, cel->y()+y))
+        << " x=" << x << " y=" << y;
+}
+
+TEST(LayerBoundaries, RgbMask)
+{
+  // Width with 16-pixel blocks plus some remaining pixels
+  ImageRef image(Image::create(IMAGE_RGB, 37, 9));
+  clear_image(image.get(), 0);
+  for (int y=2; y<7; ++y)
+    for (int x=3; x<35; ++x)
+      put_pixel(image.get(), x, y, rgba(x, y, 0, std::rand() % 256));
+
+  Cel cel(0, image);
+  cel.setPosition(5, 3);
+
+  auto selected = [](color_t c) { return rgba_geta(c) >= 128; };
+  Mask mask;
+  create_cel_boundaries_mask(&cel, mask);
+  expect_cel_mask(&cel, mask, selected);
+
+  // The second time only the cached opaque bounds are scanned
+  create_cel_boundaries_mask(&cel, mask);
+  expect_cel_mask(&cel, mask, selected);
+
+  // A modified image is scanned completely again
+  put_pixel(image.get(), 36, 8, rgba(0, 0, 0, 255));
+  image->incrementVersion();
+  create_cel_boundaries_mask(&cel, mask);
+  expect_cel_mask(&cel, mask, selected);
+  EXPECT_TRUE(mask.containsPoint(5+36, 3+8));
+
+  // Transparent image
+  clear_image(image.get(), rgba(255, 255, 255, 127));
+  image->incrementVersion();
+  create_cel_boundaries_mask(&cel, mask);
+  EXPECT_TRUE(mask.isEmpty());
+}
+
+TEST(LayerBoundaries, IndexedMask)
+{
+  ImageRef image(Image::create(IMAGE_INDEXED, 21, 4));
+  image->setMaskColor(3);
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<21; ++x)
+      put_pixel(image.get(), x, y, (x+y) % 4);
+
+  Cel cel(0, image);
+  Mask mask;
+  create_cel_boundaries_mask(&cel, mask);
+  expect_cel_mask(&cel, mask, [](color_t c) { return c != 3; });
+}
+
+// The cached opaque bounds must be discarded when a command modifies
+// the pixels, e.g. when Edit > Clear is undone the restored pixels
+// are outside the cached bounds.
+TEST(LayerBoundaries, ClearMaskAndUndo)
+{
+  TestContextT<Context> ctx;
+  std::unique_ptr<Doc> doc(ctx.documents().add(32, 16));
+  Cel* cel = doc->sprite()->root()->firstLayer()->cel(0);
+  Image* image = cel->image();
+  clear_image(image, 0);
+  fill_rect(image, 2, 2, 9, 9, rgba(255, 0, 0, 255));
+  fill_rect(image, 20, 4, 29, 12, rgba(0, 0, 255, 255));
+  image->incrementVersion();
+
+  auto selected = [](color_t c) { return rgba_geta(c) >= 128; };
+  Mask mask;
+  create_cel_boundaries_mask(cel, mask);
+  expect_cel_mask(cel, mask, selected);
+
+  // Clear the right block, so the cached bounds contain only the
+  // left one
+  Mask clearMask;
+  clearMask.replace(gfx::Rect(16, 0, 16, 16));
+  doc->setMask(&clearMask);
+
+  cmd::ClearMask cmd(cel);
+  cmd.execute(&ctx);
+  create_cel_boundaries_mask(cel, mask);
+  expect_cel_mask(cel, mask, selected);
+  EXPECT_EQ(gfx::Rect(2, 2, 8, 8), mask.bounds());
+
+  cmd.undo();
+  create_cel_boundaries_mask(cel, mask);
+  expect_cel_mask(cel, mask, selected);
+  EXPECT_TRUE(mask.containsPoint(25, 8));
+
+  doc->close();
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020-2021  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -19,6 +19,10 @@ namespace app {
   // elements)
   class OpenBatchOfFiles {
   public:
+    void setPreloader(FilePreloader* preloader) {
+      m_cmd.setPreloader(preloader);
+    }
+
     void open(Context* ctx,
               const std::string& fn,
               const bool oneFrame) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2019-2022  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -50,11 +50,47 @@ doc::Image* resize_image(
   return newImage.release();
 }
 
+doc::ImageRef create_resized_cel_image(
+  doc::Cel* cel,
+  const gfx::SizeF& scale,
+  const doc::algorithm::ResizeMethod method)
+{
+  doc::Image* image = cel->image();
+  if (!image || cel->link() || cel->layer()->isReference())
+    return nullptr;
+
+  doc::Sprite* sprite = cel->sprite();
+  const int w = std::max(1, int(scale.w*image->width()));
+  const int h = std::max(1, int(scale.h*image->height()));
+  doc::ImageRef newImage(
+    doc::Image::create(image->pixelFormat(), w, h));
+  newImage->setMaskColor(image->maskColor());
+
+  // The palette and RgbMap are only needed to interpolate indexed
+  // colors (and Sprite::rgbMap() regenerates the shared map).
+  const doc::Palette* pal = nullptr;
+  const doc::RgbMap* rgbmap = nullptr;
+  if (image->pixelFormat() == doc::IMAGE_INDEXED &&
+      method == doc::algorithm::RESIZE_METHOD_BILINEAR) {
+    pal = sprite->palette(cel->frame());
+    rgbmap = sprite->rgbMap(cel->frame());
+  }
+
+  doc::algorithm::fixup_image_transparent_colors(image);
+  doc::algorithm::resize_image(
+    image, newImage.get(),
+    method, pal, rgbmap,
+    (cel->layer()->isBackground() ? -1: sprite->transparentColor()));
+
+  return newImage;
+}
+
 void resize_cel_image(
   Tx& tx, doc::Cel* cel,
   const gfx::SizeF& scale,
   const doc::algorithm::ResizeMethod method,
-  const gfx::PointF& pivot)
+  const gfx::PointF& pivot,
+  doc::ImageRef newImage)
 {
   // Get cel's image
   doc::Image* image = cel->image();
@@ -77,20 +113,8 @@ void resize_cel_image(
         tx(new cmd::SetCelPosition(cel, x, y));
 
       // Resize the image
-      const int w = std::max(1, int(scale.w*image->width()));
-      const int h = std::max(1, int(scale.h*image->height()));
-      doc::ImageRef newImage(
-        doc::Image::create(
-          image->pixelFormat(), std::max(1, w), std::max(1, h)));
-      newImage->setMaskColor(image->maskColor());
-
-      doc::algorithm::fixup_image_transparent_colors(image);
-      doc::algorithm::resize_image(
-        image, newImage.get(),
-        method,
-        sprite->palette(cel->frame()),
-        sprite->rgbMap(cel->frame()),
-        (cel->layer()->isBackground() ? -1: sprite->transparentColor()));
+      if (!newImage)
+        newImage = create_resized_cel_image(cel, scale, method);
 
       tx(new cmd::ReplaceImage(sprite, cel->imageRef(), newImage));
     }
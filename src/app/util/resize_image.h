@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2019-2021  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 //
 // This program is distributed under the terms of
 // the End-User License Agreement for Aseprite.
@@ -10,6 +10,7 @@
 
 #include "doc/algorithm/resize_image.h"
 #include "doc/color.h"
+#include "doc/image_ref.h"
 #include "gfx/point.h"
 #include "gfx/size.h"
 
@@ -30,11 +31,25 @@ namespace app {
     const doc::Palette* pal,
     const doc::RgbMap* rgbmap);
 
+  // Returns the resized image that resize_cel_image() uses to
+  // replace the cel image (nullptr for reference layers, which only
+  // change the cel bounds). It doesn't add undo information, so it
+  // can be called from several threads for different cels (except in
+  // indexed sprites with RESIZE_METHOD_BILINEAR, which use the shared
+  // RgbMap of the sprite).
+  doc::ImageRef create_resized_cel_image(
+    doc::Cel* cel,
+    const gfx::SizeF& scale,
+    const doc::algorithm::ResizeMethod method);
+
+  // Resizes the cel image with undo information. If "newImage" is
+  // given, it must be the result of create_resized_cel_image().
   void resize_cel_image(
     Tx& tx, doc::Cel* cel,
     const gfx::SizeF& scale,
     const doc::algorithm::ResizeMethod method,
-    const gfx::PointF& pivot);
+    const gfx::PointF& pivot,
+    doc::ImageRef newImage = nullptr);
 
 } // namespace app
 
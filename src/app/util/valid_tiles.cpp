@@ -0,0 +1,33 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "app/util/valid_tiles.h"
+
+namespace app {
+
+gfx::Region ValidTiles::region() const
+{
+  gfx::Region rgn;
+  for (int ty=0; ty<m_rows; ++ty) {
+    for (int tx=0; tx<m_cols; ) {
+      if (!isValid(tx, ty)) {
+        ++tx;
+        continue;
+      }
+      const int begin = tx;
+      for (; tx<m_cols && isValid(tx, ty); ++tx)
+        ;
+      rgn |= gfx::Region(runBounds(begin, tx, ty));
+    }
+  }
+  return rgn;
+}
+
+} // namespace app
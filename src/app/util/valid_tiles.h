@@ -0,0 +1,155 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef APP_UTIL_VALID_TILES_H_INCLUDED
+#define APP_UTIL_VALID_TILES_H_INCLUDED
+#pragma once
+
+#include "gfx/rect.h"
+#include "gfx/region.h"
+#include "gfx/size.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+namespace app {
+
+  // Tracks which parts of an image are valid (e.g. were already
+  // copied from other image) with one flag for each tile of
+  // kTileSize x kTileSize pixels. It's used by ExpandCelCanvas to
+  // know what must be copied on each mouse movement without region
+  // operations (the cost depends only on the number of touched tiles).
+  class ValidTiles {
+  public:
+    static constexpr int kTileSize = 64;
+
+    ValidTiles() { }
+
+    // Resets the tracker for an image of the given size (all tiles
+    // are invalid).
+    void reset(const gfx::Size& imageSize) {
+      m_size = imageSize;
+      m_cols = (imageSize.w + kTileSize - 1) / kTileSize;
+      m_rows = (imageSize.h + kTileSize - 1) / kTileSize;
+      m_tiles.assign(m_cols * m_rows, 0);
+    }
+
+    void invalidateAll() {
+      std::fill(m_tiles.begin(), m_tiles.end(), 0);
+    }
+
+    bool isValid(const int tx, const int ty) const {
+      return m_tiles[ty*m_cols + tx] != 0;
+    }
+
+    // Marks as valid all tiles that intersect "rc", and calls
+    // func(rect) for each horizontal run of tiles that were invalid
+    // (clipped to the image bounds) so the caller can validate them.
+    template<typename Func>
+    void validate(const gfx::Rect& rc, Func&& func) {
+      const gfx::Rect range = tileRange(rc);
+      for (int ty=range.y; ty<range.y2(); ++ty) {
+        for (int tx=range.x; tx<range.x2(); ) {
+          if (isValid(tx, ty)) {
+            ++tx;
+            continue;
+          }
+          const int begin = tx;
+          for (; tx<range.x2() && !isValid(tx, ty); ++tx)
+            m_tiles[ty*m_cols + tx] = 1;
+          func(runBounds(begin, tx, ty));
+        }
+      }
+    }
+
+    // Marks as invalid the tiles completely inside "rc". For valid
+    // tiles partially inside "rc" (which are still valid), calls
+    // partialFunc(rect) with the part of the tile inside "rc", so
+    // the caller can restore those pixels.
+    template<typename Func>
+    void invalidate(const gfx::Rect& rc, Func&& partialFunc) {
+      const gfx::Rect clipped = rc.createIntersection(gfx::Rect(m_size));
+      const gfx::Rect range = tileRange(clipped);
+      for (int ty=range.y; ty<range.y2(); ++ty) {
+        for (int tx=range.x; tx<range.x2(); ++tx) {
+          if (!isValid(tx, ty))
+            continue;
+          const gfx::Rect tile = tileBounds(tx, ty);
+          if (clipped.contains(tile))
+            m_tiles[ty*m_cols + tx] = 0;
+          else
+            partialFunc(tile.createIntersection(clipped));
+        }
+      }
+    }
+
+    // Calls func(rect) for each part of "rc" inside a tile that is
+    // valid in this tracker and in "other" (which must track an image
+    // of the same size).
+    template<typename Func>
+    void forEachValid(const gfx::Rect& rc,
+                      const ValidTiles& other,
+                      Func&& func) const {
+      const gfx::Rect clipped = rc.createIntersection(gfx::Rect(m_size));
+      const gfx::Rect range = tileRange(clipped);
+      for (int ty=range.y; ty<range.y2(); ++ty) {
+        for (int tx=range.x; tx<range.x2(); ++tx) {
+          if (isValid(tx, ty) && other.isValid(tx, ty))
+            func(tileBounds(tx, ty).createIntersection(clipped));
+        }
+      }
+    }
+
+    // Returns true if all valid tiles of this tracker are valid in
+    // "other" too.
+    bool isSubsetOf(const ValidTiles& other) const {
+      if (other.m_tiles.size() != m_tiles.size())
+        return false;
+      for (std::size_t i=0; i<m_tiles.size(); ++i) {
+        if (m_tiles[i] && !other.m_tiles[i])
+          return false;
+      }
+      return true;
+    }
+
+    // Returns the valid area as a region (one rectangle for each
+    // horizontal run of valid tiles).
+    gfx::Region region() const;
+
+  private:
+    // Returns the range of tiles that intersect "rc"
+    gfx::Rect tileRange(gfx::Rect rc) const {
+      rc &= gfx::Rect(m_size);
+      if (rc.isEmpty())
+        return gfx::Rect();
+      const int tx1 = rc.x / kTileSize;
+      const int ty1 = rc.y / kTileSize;
+      const int tx2 = (rc.x2() - 1) / kTileSize;
+      const int ty2 = (rc.y2() - 1) / kTileSize;
+      return gfx::Rect(tx1, ty1, tx2 - tx1 + 1, ty2 - ty1 + 1);
+    }
+
+    gfx::Rect tileBounds(const int tx, const int ty) const {
+      return runBounds(tx, tx+1, ty);
+    }
+
+    // Bounds of the tiles [tx1,tx2) of the "ty" row
+    gfx::Rect runBounds(const int tx1, const int tx2, const int ty) const {
+      return gfx::Rect(tx1*kTileSize, ty*kTileSize,
+                       (tx2-tx1)*kTileSize, kTileSize)
+        .createIntersection(gfx::Rect(m_size));
+    }
+
+    gfx::Size m_size;
+    int m_cols = 0;
+    int m_rows = 0;
+    std::vector<uint8_t> m_tiles;
+  };
+
+} // namespace app
+
+#endif
@@ -0,0 +1,79 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "app/util/valid_tiles.h"
+
+#include <vector>
+
+using namespace app;
+
+static const int T = ValidTiles::kTileSize;
+
+TEST(ValidTiles, ValidateRuns)
+{
+  ValidTiles vt;
+  vt.reset(gfx::Size(3*T+10, 2*T));
+
+  std::vector<gfx::Rect> runs;
+  auto add = [&runs](const gfx::Rect& rc){ runs.push_back(rc); };
+
+  // One pixel touches one tile
+  vt.validate(gfx::Rect(T+1, 1, 1, 1), add);
+  ASSERT_EQ(1u, runs.size());
+  EXPECT_EQ(gfx::Rect(T, 0, T, T), runs[0]);
+
+  // Already valid tiles are skipped and runs are clipped to the image
+  runs.clear();
+  vt.validate(gfx::Rect(0, 0, 4*T, 1), add);
+  ASSERT_EQ(2u, runs.size());
+  EXPECT_EQ(gfx::Rect(0, 0, T, T), runs[0]);
+  EXPECT_EQ(gfx::Rect(2*T, 0, T+10, T), runs[1]);
+
+  runs.clear();
+  vt.validate(gfx::Rect(0, 0, 10, 10), add);
+  EXPECT_TRUE(runs.empty());
+
+  EXPECT_EQ(gfx::Rect(0, 0, 3*T+10, T), vt.region().bounds());
+}
+
+TEST(ValidTiles, Invalidate)
+{
+  ValidTiles vt;
+  vt.reset(gfx::Size(2*T, T));
+  vt.validate(gfx::Rect(0, 0, 2*T, T), [](const gfx::Rect&){ });
+
+  // The first tile is fully inside, the second one partially
+  std::vector<gfx::Rect> partial;
+  vt.invalidate(gfx::Rect(0, 0, T+2, T),
+                [&partial](const gfx::Rect& rc){ partial.push_back(rc); });
+  ASSERT_EQ(1u, partial.size());
+  EXPECT_EQ(gfx::Rect(T, 0, 2, T), partial[0]);
+  EXPECT_FALSE(vt.isValid(0, 0));
+  EXPECT_TRUE(vt.isValid(1, 0));
+
+  vt.invalidateAll();
+  EXPECT_TRUE(vt.region().isEmpty());
+}
+
+TEST(ValidTiles, ForEachValidAndSubset)
+{
+  ValidTiles a, b;
+  a.reset(gfx::Size(2*T, 2*T));
+  b.reset(gfx::Size(2*T, 2*T));
+  a.validate(gfx::Rect(0, 0, 2*T, 1), [](const gfx::Rect&){ });
+  b.validate(gfx::Rect(T, 0, 1, 1), [](const gfx::Rect&){ });
+
+  EXPECT_TRUE(b.isSubsetOf(a));
+  EXPECT_FALSE(a.isSubsetOf(b));
+
+  std::vector<gfx::Rect> rcs;
+  a.forEachValid(gfx::Rect(0, 0, 2*T, 5), b,
+                 [&rcs](const gfx::Rect& rc){ rcs.push_back(rc); });
+  ASSERT_EQ(1u, rcs.size());
+  EXPECT_EQ(gfx::Rect(T, 0, T, 5), rcs[0]);
+}
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -16,6 +16,8 @@
 #include "base/file_handle.h"
 #include "base/fs.h"
 #include "base/mask_shift.h"
+#include "base/thread_pool.h"
+#include "base/time.h"
 #include "dio/aseprite_common.h"
 #include "dio/decode_delegate.h"
 #include "dio/file_interface.h"
@@ -27,11 +29,66 @@
 #include "gfx/color_space.h"
 #include "zlib.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdio>
+#include <thread>
 #include <vector>
 
 namespace dio {
 
+// Minimum size of uncompressed pixels to inflate a cel image in the
+// thread pool (smaller images are inflated directly)
+static const size_t kParallelInflateMinSize = 64*1024;
+
+// Minimum size of the cel images (in bytes) that are loaded on demand
+// in lazy loading mode (smaller cels are read when the file is
+// decoded)
+static const size_t kLazyLoadMinSize = 64*1024;
+
+// Original file from where the pixels of big cels are loaded on
+// demand. Its size and modification time are saved when it's
+// decoded, so we don't read pixels from a modified file.
+struct AsepriteLazyFile {
+  std::string filename;
+  size_t size = 0;
+  base::Time time;
+  std::function<void(const std::string&)> errorHandler;
+  std::atomic<bool> errorReported = false;
+
+  AsepriteLazyFile(const std::string& filename,
+                   std::function<void(const std::string&)>&& errorHandler)
+    : filename(filename)
+    , size(base::file_size(filename))
+    , time(base::get_modification_time(filename))
+    , errorHandler(std::move(errorHandler)) { }
+
+  bool isModified() const {
+    return (base::file_size(filename) != size ||
+            !(base::get_modification_time(filename) == time));
+  }
+
+  // Reports only the first error, as all the cels from the same file
+  // will fail for the same reason.
+  void reportError(const std::string& msg) {
+    if (errorHandler && !errorReported.exchange(true))
+      errorHandler(msg);
+  }
+};
+
+AsepriteDecoder::AsepriteDecoder()
+{
+}
+
+AsepriteDecoder::~AsepriteDecoder()
+{
+  // In case that decode() was interrupted by an exception
+  if (m_inflatePool) {
+    std::unique_lock lock(m_inflateMutex);
+    m_inflateCV.wait(lock, [this]{ return m_inflatePending == 0; });
+  }
+}
+
 bool AsepriteDecoder::decode()
 {
   bool ignore_old_color_chunks = false;
@@ -58,6 +115,16 @@ bool AsepriteDecoder::decode()
     return false;
   }
 
+  // Big cels are loaded on demand in lazy loading mode (but not if we
+  // are reading just one frame, e.g. to generate a thumbnail)
+  if (!delegate()->decodeOneFrame()) {
+    const std::string fn = delegate()->lazyLoadCelsFilename();
+    if (!fn.empty()) {
+      m_lazyFile = std::make_shared<AsepriteLazyFile>(
+        fn, delegate()->lazyLoadCelsErrorHandler());
+    }
+  }
+
   // Create the new sprite
   std::unique_ptr<doc::Sprite> sprite(
     std::make_unique<doc::Sprite>(doc::ImageSpec(header.depth == 32 ? doc::ColorMode::RGB:
@@ -310,6 +377,8 @@ bool AsepriteDecoder::decode()
       break;
   }
 
+  waitCompressedCelImages();
+
   delegate()->onSprite(sprite.release());
   return true;
 }
@@ -739,7 +808,13 @@ void read_compressed_image_templ(FileInterface* f,
       input_bytes = compressed.size();
     }
 
-    size_t bytes_read = f->readBytes(&compressed[0], input_bytes);
+    // Inflate directly from the file data if it's in memory
+    const uint8_t* input = f->readSpan(input_bytes);
+    size_t bytes_read = input_bytes;
+    if (!input) {
+      bytes_read = f->readBytes(&compressed[0], input_bytes);
+      input = &compressed[0];
+    }
 
     // Error reading "input_bytes" bytes, broken file? chunk without
     // enough compressed data?
@@ -750,7 +825,7 @@ void read_compressed_image_templ(FileInterface* f,
       break;
     }
 
-    zstream.next_in = (Bytef*)&compressed[0];
+    zstream.next_in = (Bytef*)input;
     zstream.avail_in = bytes_read;
 
     do {
@@ -839,8 +914,170 @@ void read_compressed_image(FileInterface* f,
   }
 }
 
+// Collects the errors from a worker thread to report them later
+// from the decoding thread.
+class CollectErrorsDelegate : public DecodeDelegate {
+public:
+  void error(const std::string& msg) override { errors.push_back(msg); }
+  std::vector<std::string> errors;
+};
+
+// Loads the pixels of a compressed cel from the original file the
+// first time they are accessed (lazy loading mode).
+class CelBitsLoader : public doc::ImageBitsLoader {
+public:
+  CelBitsLoader(const std::shared_ptr<AsepriteLazyFile>& file,
+                const size_t pos,
+                const size_t size,
+                const AsepriteHeader& header)
+    : m_file(file)
+    , m_pos(pos)
+    , m_size(size)
+    , m_header(header) { }
+
+  bool loadBits(const doc::Image* image, uint8_t* bits, size_t size) override {
+    try {
+      if (m_file->isModified())
+        throw base::Exception("The file was modified after it was opened.");
+
+      base::FileHandle handle(base::open_file(m_file->filename, "rb"));
+      FILE* file = handle.get();
+      if (!file || fseek(file, long(m_pos), SEEK_SET) != 0)
+        throw base::Exception("The file cannot be read.");
+
+      std::vector<uint8_t> buffer(m_size);
+      if (fread(buffer.data(), 1, m_size, file) != m_size)
+        throw base::Exception("The file cannot be read.");
+
+      // Inflate the pixels in a temporary image as "image" is locked
+      MemoryFileInterface f(buffer.data(), buffer.size());
+      CollectErrorsDelegate errors;
+      doc::ImageRef tmp(doc::Image::create(image->spec()));
+      read_compressed_image(&f, &errors, tmp.get(), &m_header, buffer.size());
+      if (!errors.errors.empty())
+        throw base::Exception(errors.errors.front());
+
+      ASSERT(size == size_t(tmp->rowBytes()) * tmp->height());
+      const uint8_t* src = tmp->getPixelAddress(0, 0);
+      std::copy(src, src+size, bits);
+      return true;
+    }
+    catch (const std::exception& e) {
+      m_file->reportError(
+        fmt::format("Error loading the pixels of a cel from {0}:\n{1}\n"
+                    "The cel will be empty, re-open the file to load it again.",
+                    m_file->filename, e.what()));
+      return false;
+    }
+  }
+
+private:
+  std::shared_ptr<AsepriteLazyFile> m_file;
+  size_t m_pos;
+  size_t m_size;
+  AsepriteHeader m_header;
+};
+
 } // anonymous namespace
 
+void AsepriteDecoder::readCompressedCelImage(const doc::CelDataRef& celData,
+                                             const AsepriteHeader* header,
+                                             const size_t chunk_end)
+{
+  const doc::ImageRef image = celData->imageRef();
+  const bool cache = delegate()->cacheCompressedCels();
+  const size_t imageSize = size_t(image->widthBytes()) * image->height();
+
+  // Lazy loading mode, we only remember where the compressed pixels
+  // are to read them when they are needed
+  if (m_lazyFile && imageSize >= kLazyLoadMinSize) {
+    const size_t pos = f()->tell();
+    if (chunk_end > pos &&
+        image->setBitsLoader(
+          std::make_shared<CelBitsLoader>(m_lazyFile, pos,
+                                          chunk_end - pos, *header))) {
+      f()->seek(chunk_end);
+      return;
+    }
+  }
+
+  const bool parallel = (imageSize >= kParallelInflateMinSize &&
+                         std::thread::hardware_concurrency() >= 2);
+  if (!cache && !parallel) {
+    read_compressed_image(f(), delegate(), image.get(), header, chunk_end);
+    return;
+  }
+
+  // Get all the compressed data of the chunk here, so we can
+  // continue reading the next chunks while this one is inflated (and
+  // keep the same data in the cel to re-use it when the file is
+  // saved again). If the file is in memory (e.g. memory-mapped) we
+  // can inflate the pixels directly from it when the data is not
+  // cached.
+  const size_t pos = f()->tell();
+  const size_t size = (chunk_end > pos ? chunk_end - pos: 0);
+  const uint8_t* data = f()->readSpan(size);
+  std::shared_ptr<std::vector<uint8_t>> buffer;
+  if (!data || cache) {
+    if (data)
+      buffer = std::make_shared<std::vector<uint8_t>>(data, data+size);
+    else {
+      buffer = std::make_shared<std::vector<uint8_t>>(size);
+      buffer->resize(f()->readBytes(buffer->data(), buffer->size()));
+    }
+    data = buffer->data();
+  }
+  const size_t dataSize = (buffer ? buffer->size(): size);
+
+  if (!parallel) {
+    MemoryFileInterface file(data, dataSize);
+    CollectErrorsDelegate errors;
+    read_compressed_image(&file, &errors, image.get(), header, dataSize);
+    if (errors.errors.empty())
+      celData->setCompressedData(std::move(*buffer));
+    for (const std::string& msg : errors.errors)
+      delegate()->error(msg);
+    return;
+  }
+
+  if (!m_inflatePool)
+    m_inflatePool = std::make_unique<base::thread_pool>(std::thread::hardware_concurrency());
+
+  {
+    const std::lock_guard lock(m_inflateMutex);
+    ++m_inflatePending;
+  }
+  // The file (and the data if it's in memory) is alive until we call
+  // waitCompressedCelImages() (or the decoder is destroyed)
+  m_inflatePool->execute(
+    [this, celData, image, data, dataSize, buffer, cache, header = *header]{
+      MemoryFileInterface file(data, dataSize);
+      CollectErrorsDelegate errors;
+      read_compressed_image(&file, &errors, image.get(), &header, dataSize);
+      if (cache && errors.errors.empty())
+        celData->setCompressedData(std::move(*buffer));
+
+      const std::lock_guard lock(m_inflateMutex);
+      m_inflateErrors.insert(m_inflateErrors.end(),
+                             errors.errors.begin(),
+                             errors.errors.end());
+      if (--m_inflatePending == 0)
+        m_inflateCV.notify_one();
+    });
+}
+
+void AsepriteDecoder::waitCompressedCelImages()
+{
+  {
+    std::unique_lock lock(m_inflateMutex);
+    m_inflateCV.wait(lock, [this]{ return m_inflatePending == 0; });
+  }
+
+  for (const std::string& msg : m_inflateErrors)
+    delegate()->error(msg);
+  m_inflateErrors.clear();
+}
+
 //////////////////////////////////////////////////////////////////////
 // Cel Chunk
 //////////////////////////////////////////////////////////////////////
@@ -913,6 +1150,9 @@ doc::Cel* AsepriteDecoder::readCelChunk(doc::Sprite* sprite,
           cel.reset(doc::Cel::MakeLink(frame, link));
         }
         else {
+          // The pixels of the linked cel must be ready to copy them
+          waitCompressedCelImages();
+
           cel.reset(doc::Cel::MakeCopy(frame, link));
           cel->setPosition(x, y);
           cel->setOpacity(opacity);
@@ -933,9 +1173,9 @@ doc::Cel* AsepriteDecoder::readCelChunk(doc::Sprite* sprite,
 
       if (w > 0 && h > 0) {
         doc::ImageRef image(doc::Image::create(pixelFormat, w, h));
-        read_compressed_image(f(), delegate(), image.get(), header, chunk_end);
-
         cel = std::make_unique<doc::Cel>(frame, image);
+        readCompressedCelImage(cel->dataRef(), header, chunk_end);
+
         cel->setPosition(x, y);
         cel->setOpacity(opacity);
         cel->setZIndex(zIndex);
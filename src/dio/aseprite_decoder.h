@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,7 +10,9 @@
 #pragma once
 
 #include "dio/decoder.h"
+#include "doc/cel_data.h"
 #include "doc/frame.h"
+#include "doc/image_ref.h"
 #include "doc/layer_list.h"
 #include "doc/pixel_format.h"
 #include "doc/slices.h"
@@ -18,9 +20,16 @@
 #include "doc/tileset.h"
 #include "doc/user_data.h"
 
+#include <condition_variable>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
+namespace base {
+  class thread_pool;
+}
+
 namespace doc {
   class Cel;
   class Layer;
@@ -36,9 +45,13 @@ namespace dio {
 struct AsepriteHeader;
 struct AsepriteFrameHeader;
 class AsepriteExternalFiles;
+struct AsepriteLazyFile;
 
 class AsepriteDecoder : public Decoder {
 public:
+  AsepriteDecoder();
+  ~AsepriteDecoder();
+
   bool decode() override;
 
 private:
@@ -74,8 +87,28 @@ private:
   const doc::UserData::Variant readPropertyValue(uint16_t type);
   void readTilesData(doc::Tileset* tileset, const AsepriteExternalFiles& extFiles);
 
+  // Reads the compressed pixels of a cel image in memory and inflates
+  // them in a thread pool (or in this thread for small images). The
+  // compressed data can be cached in the cel data (see
+  // DecodeDelegate::cacheCompressedCels()).
+  void readCompressedCelImage(const doc::CelDataRef& celData,
+                              const AsepriteHeader* header,
+                              const size_t chunk_end);
+  void waitCompressedCelImages();
+
   doc::LayerList m_allLayers;
   std::vector<uint32_t> m_tilesetFlags;
+
+  // File used to load the pixels of big cels on demand (nullptr if
+  // the lazy loading mode is disabled)
+  std::shared_ptr<AsepriteLazyFile> m_lazyFile;
+
+  // Compressed cel images being inflated in m_inflatePool
+  std::unique_ptr<base::thread_pool> m_inflatePool;
+  std::mutex m_inflateMutex;
+  std::condition_variable m_inflateCV;
+  int m_inflatePending = 0;
+  std::vector<std::string> m_inflateErrors;
 };
 
 } // namespace dio
@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2026 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,6 +13,7 @@
 #include "doc/frame.h"
 #include "doc/sprite.h"
 
+#include <functional>
 #include <string>
 
 namespace dio {
@@ -56,6 +57,27 @@ public:
   virtual bool cacheCompressedTilesets() const {
     return false;
   }
+
+  // Returns true if we want to cache the read compressed data of
+  // cels (see doc::CelData::setCompressedData()).
+  virtual bool cacheCompressedCels() const {
+    return false;
+  }
+
+  // Returns the name of the file being decoded to load the pixels of
+  // big cels on demand (see doc::Image::setBitsLoader()), or an empty
+  // string to read all the pixels when the file is decoded.
+  virtual std::string lazyLoadCelsFilename() const {
+    return std::string();
+  }
+
+  // Returns a function to report (from any thread) that the pixels
+  // of a cel cannot be loaded on demand (e.g. the file was modified
+  // after it was decoded). It's called after the decoding finished,
+  // so it cannot reference the delegate.
+  virtual std::function<void(const std::string& msg)> lazyLoadCelsErrorHandler() const {
+    return nullptr;
+  }
 };
 
 } // namespace dio
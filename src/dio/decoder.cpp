@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2018 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,6 +12,32 @@
 
 namespace dio {
 
+namespace {
+
+// Reads a little endian value with one call to the FileInterface
+// (instead of one read8() call for each byte). Returns 0 in case of
+// error.
+template<typename T>
+T read_le(FileInterface* f)
+{
+  uint8_t buf[sizeof(T)];
+  const uint8_t* p = f->readSpan(sizeof(T));
+  if (!p) {
+    if (f->readBytes(buf, sizeof(T)) != sizeof(T))
+      return 0;
+    p = buf;
+  }
+  if (!f->ok())
+    return 0;
+
+  T value = 0;
+  for (size_t i=0; i<sizeof(T); ++i)
+    value |= T(p[i]) << (8*i);
+  return value;
+}
+
+} // anonymous namespace
+
 Decoder::Decoder()
   : m_delegate(nullptr)
   , m_f(nullptr)
@@ -35,55 +61,17 @@ uint8_t Decoder::read8()
 
 uint16_t Decoder::read16()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-
-  if (m_f->ok()) {
-    return ((b2 << 8) | b1); // Little endian
-  }
-  else
-    return 0;
+  return read_le<uint16_t>(m_f);
 }
 
 uint32_t Decoder::read32()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-  int b3 = m_f->read8();
-  int b4 = m_f->read8();
-
-  if (m_f->ok()) {
-    // Little endian
-    return ((b4 << 24) | (b3 << 16) | (b2 << 8) | b1);
-  }
-  else
-    return 0;
+  return read_le<uint32_t>(m_f);
 }
 
 uint64_t Decoder::read64()
 {
-  int b1 = m_f->read8();
-  int b2 = m_f->read8();
-  int b3 = m_f->read8();
-  int b4 = m_f->read8();
-  int b5 = m_f->read8();
-  int b6 = m_f->read8();
-  int b7 = m_f->read8();
-  int b8 = m_f->read8();
-
-  if (m_f->ok()) {
-    // Little endian
-    return (((long long)b8 << 56) |
-            ((long long)b7 << 48) |
-            ((long long)b6 << 40) |
-            ((long long)b5 << 32) |
-            ((long long)b4 << 24) |
-            ((long long)b3 << 16) |
-            ((long long)b2 << 8) |
-            (long long)b1);
-  }
-  else
-    return 0;
+  return read_le<uint64_t>(m_f);
 }
 
 size_t Decoder::readBytes(uint8_t* buf, size_t n)
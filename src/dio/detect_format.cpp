@@ -1,5 +1,5 @@
 // Aseprite Document IO Library
-// Copyright (c) 2021-2023 Igara Studio S.A.
+// Copyright (c) 2021-2026 Igara Studio S.A.
 // Copyright (c) 2016-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,9 +10,12 @@
 #include "base/file_handle.h"
 #include "base/fs.h"
 #include "base/string.h"
+#include "base/time.h"
 #include "flic/flic_details.h"
 
 #include <cstring>
+#include <mutex>
+#include <unordered_map>
 
 #define ASE_MAGIC_NUMBER 0xA5E0
 #define BMP_MAGIC_NUMBER 0x4D42 // "BM"
@@ -28,6 +31,22 @@
 
 namespace dio {
 
+namespace {
+
+struct CachedFormat {
+  base::Time time;
+  FileFormat format;
+};
+
+// Maximum number of cached entries, the whole cache is discarded
+// when it's full (it's refilled with the files that are in use)
+constexpr std::size_t kMaxCachedFormats = 8192;
+
+std::mutex g_cacheMutex;
+std::unordered_map<std::string, CachedFormat> g_cache;
+
+} // anonymous namespace
+
 FileFormat detect_format(const std::string& filename)
 {
   FileFormat ff = detect_format_by_file_content(filename);
@@ -36,6 +55,46 @@ FileFormat detect_format(const std::string& filename)
   return ff;
 }
 
+FileFormat detect_format_cached(const std::string& filename)
+{
+  const base::Time time = base::get_modification_time(filename);
+  if (!time.valid())
+    return detect_format(filename);
+
+  {
+    const std::lock_guard lock(g_cacheMutex);
+    auto it = g_cache.find(filename);
+    if (it != g_cache.end() && it->second.time == time)
+      return it->second.format;
+  }
+
+  // Read the file without locking the cache (other threads can probe
+  // other files in the meantime)
+  const FileFormat ff = detect_format(filename);
+  if (ff != FileFormat::ERROR) {
+    const std::lock_guard lock(g_cacheMutex);
+    if (g_cache.size() >= kMaxCachedFormats)
+      g_cache.clear();
+    g_cache[filename] = CachedFormat{ time, ff };
+  }
+  return ff;
+}
+
+std::vector<FileFormat> detect_formats(const std::vector<std::string>& filenames)
+{
+  std::vector<FileFormat> formats;
+  formats.reserve(filenames.size());
+  for (const std::string& filename : filenames)
+    formats.push_back(detect_format_cached(filename));
+  return formats;
+}
+
+void clear_detect_format_cache()
+{
+  const std::lock_guard lock(g_cacheMutex);
+  g_cache.clear();
+}
+
 FileFormat detect_format_by_file_content_bytes(const uint8_t* buf,
                                                const int n)
 {
@@ -98,8 +157,14 @@ FileFormat detect_format_by_file_content(const std::string& filename)
     return FileFormat::ERROR;
 
   FILE* f = handle.get();
-  uint8_t buf[12];
-  int n = (int)fread(buf, 1, 12, f);
+
+  // Unbuffered, so we read only the header bytes from disk (instead
+  // of filling the whole stdio buffer, which is slow on network
+  // folders).
+  std::setvbuf(f, nullptr, _IONBF, 0);
+
+  uint8_t buf[kDetectFormatHeaderSize];
+  int n = (int)fread(buf, 1, kDetectFormatHeaderSize, f);
 
   return detect_format_by_file_content_bytes(buf, n);
 }
@@ -1,4 +1,5 @@
 // Aseprite Document IO Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2016-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,10 +13,28 @@
 
 #include <cstdint>
 #include <string>
+#include <vector>
 
 namespace dio {
 
+// Number of bytes read from the beginning of a file to detect its
+// format from its content.
+constexpr int kDetectFormatHeaderSize = 12;
+
 FileFormat detect_format(const std::string& filename);
+
+// Same as detect_format() but the result is cached by filename and
+// modification time, so probing the same file again (e.g. each time
+// the file selector shows a folder) doesn't need to read it.
+FileFormat detect_format_cached(const std::string& filename);
+
+// Detects the format of several files (e.g. the visible entries of
+// the file selector) using the cache, returns one format for each
+// filename.
+std::vector<FileFormat> detect_formats(const std::vector<std::string>& filenames);
+
+void clear_detect_format_cache();
+
 FileFormat detect_format_by_file_content_bytes(const uint8_t* buf,
                                                const int n);
 FileFormat detect_format_by_file_content(const std::string& filename);
@@ -1,4 +1,5 @@
 // Aseprite Document IO Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2017-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +12,7 @@
 #include <cstddef>
 #include <cstdint>
 #include <cstdio>
+#include <string>
 
 namespace dio {
 
@@ -31,6 +33,13 @@ public:
   virtual uint8_t read8() = 0;
   virtual size_t readBytes(uint8_t* buf, size_t n) = 0;
 
+  // Returns a pointer to the next "n" bytes (and advances the
+  // position) if the file is already in memory, so decoders can use
+  // the bytes without copying them. Returns nullptr if the file is
+  // not in memory or there are less than "n" bytes (use readBytes()
+  // in that case).
+  virtual const uint8_t* readSpan(size_t n) { return nullptr; }
+
   // Writes one byte in the file (or do nothing if ok() = false)
   virtual void write8(uint8_t value) = 0;
 
@@ -50,6 +59,45 @@ private:
   bool m_ok;
 };
 
+// Reads a file that is already in memory (the data must be alive
+// while this object is used).
+class MemoryFileInterface : public FileInterface {
+public:
+  MemoryFileInterface(const uint8_t* data, size_t size);
+  bool ok() const override;
+  size_t tell() override;
+  void seek(size_t absPos) override;
+  uint8_t read8() override;
+  size_t readBytes(uint8_t* buf, size_t n) override;
+  const uint8_t* readSpan(size_t n) override;
+  void write8(uint8_t value) override;
+protected:
+  const uint8_t* m_data;
+  size_t m_size;
+  size_t m_pos;
+  bool m_ok;
+};
+
+// Maps a whole file in memory (read-only) so decoders can read it
+// without copying its bytes through the stdio buffers.
+class MmapFileInterface : public MemoryFileInterface {
+public:
+  explicit MmapFileInterface(const std::string& filename);
+  ~MmapFileInterface();
+
+  // Returns false if the file cannot be mapped (e.g. it doesn't exist
+  // or it's empty), in that case a StdioFileInterface can be used.
+  bool isMapped() const { return m_data != nullptr; }
+
+private:
+  MmapFileInterface(const MmapFileInterface&) = delete;
+  MmapFileInterface& operator=(const MmapFileInterface&) = delete;
+
+#ifdef _WIN32
+  void* m_mapping;
+#endif
+};
+
 } // namespace dio
 
 #endif
@@ -0,0 +1,93 @@
+// Aseprite Document IO Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "dio/file_interface.h"
+
+#ifdef _WIN32
+  #include "base/string.h"
+  #include <windows.h>
+#else
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+#endif
+
+namespace dio {
+
+#ifdef _WIN32
+
+MmapFileInterface::MmapFileInterface(const std::string& filename)
+  : MemoryFileInterface(nullptr, 0)
+  , m_mapping(nullptr)
+{
+  HANDLE file = CreateFileW(base::from_utf8(filename).c_str(),
+                            GENERIC_READ, FILE_SHARE_READ, nullptr,
+                            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return;
+
+  LARGE_INTEGER size;
+  if (GetFileSizeEx(file, &size) && size.QuadPart > 0 &&
+      uint64_t(size.QuadPart) <= uint64_t(SIZE_MAX)) {
+    m_mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping) {
+      m_data = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+      if (m_data)
+        m_size = size_t(size.QuadPart);
+      else {
+        CloseHandle(m_mapping);
+        m_mapping = nullptr;
+      }
+    }
+  }
+
+  // The mapping keeps a reference to the file
+  CloseHandle(file);
+}
+
+MmapFileInterface::~MmapFileInterface()
+{
+  if (m_data)
+    UnmapViewOfFile(m_data);
+  if (m_mapping)
+    CloseHandle(m_mapping);
+}
+
+#else  // POSIX
+
+MmapFileInterface::MmapFileInterface(const std::string& filename)
+  : MemoryFileInterface(nullptr, 0)
+{
+  const int fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0)
+    return;
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+    void* data = mmap(nullptr, size_t(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    if (data != MAP_FAILED) {
+      // The file is read sequentially by the decoders
+      madvise(data, size_t(st.st_size), MADV_SEQUENTIAL);
+
+      m_data = (const uint8_t*)data;
+      m_size = size_t(st.st_size);
+    }
+  }
+
+  // The mapping keeps a reference to the file
+  close(fd);
+}
+
+MmapFileInterface::~MmapFileInterface()
+{
+  if (m_data)
+    munmap((void*)m_data, m_size);
+}
+
+#endif
+
+} // namespace dio
@@ -0,0 +1,233 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_ALGORITHM_COLOR_MATCH_H_INCLUDED
+#define DOC_ALGORITHM_COLOR_MATCH_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+#include "doc/image_traits.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <type_traits>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define DOC_USE_SSE2_COLOR_MATCH 1
+#endif
+
+namespace doc {
+namespace algorithm {
+
+  // Compares pixels with a color using a tolerance for each channel
+  // (a pixel matches if |pixel channel - color channel| <= tolerance
+  // in all compared channels). Used by the flood fill/magic wand,
+  // Mask by Color, and Replace Color, so all of them give the same
+  // results for the same color and tolerance.
+  //
+  // "channels" has the bits of the channels to compare (0xff in each
+  // byte of a compared channel, e.g. rgba_rgb_mask ignores the alpha
+  // channel). If "transparentEqual" is true, two pixels with alpha=0
+  // are always equal (only for RGB and grayscale images).
+  //
+  // Tilemaps are compared without tolerance.
+  template<typename ImageTraits>
+  class ColorMatch {
+  public:
+    using pixel_t = typename ImageTraits::pixel_t;
+
+    // Number of pixels compared at once by the SIMD functions
+    static constexpr int N = 16 / sizeof(pixel_t);
+
+    ColorMatch(const color_t color,
+               const int tolerance,
+               const bool transparentEqual = false,
+               const color_t channels = 0xffffffff)
+      : m_color(color)
+      , m_tolerance(std::clamp(tolerance, 0, 255))
+      , m_channels(channels)
+      , m_transparent(false) {
+      if constexpr (std::is_same_v<ImageTraits, RgbTraits>)
+        m_transparent = (transparentEqual && rgba_geta(color) == 0);
+      else if constexpr (std::is_same_v<ImageTraits, GrayscaleTraits>)
+        m_transparent = (transparentEqual && graya_geta(color) == 0);
+
+#if DOC_USE_SSE2_COLOR_MATCH
+      m_tolerance128 = _mm_set1_epi8(char(m_tolerance));
+      if constexpr (sizeof(pixel_t) == 4) {
+        m_color128 = _mm_set1_epi32(int(color));
+        m_channels128 = _mm_set1_epi32(int(channels));
+        m_alpha128 = _mm_set1_epi32(int(rgba_a_mask));
+      }
+      else if constexpr (sizeof(pixel_t) == 2) {
+        m_color128 = _mm_set1_epi16(short(color));
+        m_channels128 = _mm_set1_epi16(short(channels));
+        m_alpha128 = _mm_set1_epi16(short(graya_a_mask));
+      }
+      else {
+        m_color128 = _mm_set1_epi8(char(color));
+        m_channels128 = _mm_set1_epi8(char(channels));
+        m_alpha128 = _mm_setzero_si128();
+      }
+#endif
+    }
+
+    bool match(const color_t c) const {
+      if constexpr (std::is_same_v<ImageTraits, TilemapTraits>) {
+        return (c == m_color);
+      }
+      else {
+        if constexpr (std::is_same_v<ImageTraits, RgbTraits>) {
+          if (m_transparent && rgba_geta(c) == 0)
+            return true;
+        }
+        else if constexpr (std::is_same_v<ImageTraits, GrayscaleTraits>) {
+          if (m_transparent && graya_geta(c) == 0)
+            return true;
+        }
+
+        for (int i=0; i<int(sizeof(pixel_t)); ++i) {
+          const int shift = 8*i;
+          if (((m_channels >> shift) & 0xff) &&
+              std::abs(int((c >> shift) & 0xff) -
+                       int((m_color >> shift) & 0xff)) > m_tolerance)
+            return false;
+        }
+        return true;
+      }
+    }
+
+    // Returns the first pixel in row[x..x2) where the result of
+    // match() is different from "equal", or x2 if there is no such
+    // pixel.
+    int findFirst(const pixel_t* row, int x, const int x2,
+                  const bool equal) const {
+#if DOC_USE_SSE2_COLOR_MATCH
+      const int skip = (equal ? 0xffff: 0);
+      while (x+N <= x2 && bytes(row+x) == skip)
+        x += N;
+#endif
+      for (; x<x2; ++x) {
+        if (match(row[x]) != equal)
+          return x;
+      }
+      return x2;
+    }
+
+    // Returns the last pixel in row[x1..x] that doesn't match, or
+    // x1-1 if all pixels match.
+    int findLastDifferent(const pixel_t* row, const int x1, int x) const {
+#if DOC_USE_SSE2_COLOR_MATCH
+      while (x-N+1 >= x1 && bytes(row+x-N+1) == 0xffff)
+        x -= N;
+#endif
+      for (; x>=x1; --x) {
+        if (!match(row[x]))
+          return x;
+      }
+      return x1-1;
+    }
+
+    // Writes the result of match() for each pixel of row[0..w) in
+    // "bits" as a row of a bitmap (pixel x in the bit x%8 of the
+    // byte x/8, bits after "w" in the last byte are cleared).
+    void matchRow(const pixel_t* row, const int w, uint8_t* bits) const {
+      uint32_t acc = 0;
+      int n = 0;
+      int x = 0;
+
+#if DOC_USE_SSE2_COLOR_MATCH
+      for (; x+N <= w; x += N) {
+        acc |= uint32_t(pixels(row+x)) << n;
+        n += N;
+        for (; n >= 8; n -= 8, acc >>= 8)
+          *(bits++) = uint8_t(acc);
+      }
+#endif
+      for (; x<w; ++x) {
+        if (match(row[x]))
+          acc |= (1 << n);
+        if (++n == 8) {
+          *(bits++) = uint8_t(acc);
+          acc = 0;
+          n = 0;
+        }
+      }
+      if (n > 0)
+        *bits = uint8_t(acc);
+    }
+
+  private:
+#if DOC_USE_SSE2_COLOR_MATCH
+    // Returns all bits set in the bytes of the N pixels in "p" that
+    // match the color.
+    __m128i equal(const pixel_t* p) const {
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i a = _mm_loadu_si128((const __m128i*)p);
+
+      if constexpr (std::is_same_v<ImageTraits, TilemapTraits>)
+        return _mm_cmpeq_epi32(a, m_color128);
+
+      // Bytes with a difference greater than the tolerance are != 0
+      const __m128i diff = _mm_or_si128(_mm_subs_epu8(a, m_color128),
+                                        _mm_subs_epu8(m_color128, a));
+      const __m128i over = _mm_and_si128(_mm_subs_epu8(diff, m_tolerance128),
+                                         m_channels128);
+
+      __m128i eq;
+      if constexpr (sizeof(pixel_t) == 4) {
+        eq = _mm_cmpeq_epi32(over, zero);
+        if (m_transparent)
+          eq = _mm_or_si128(eq, _mm_cmpeq_epi32(_mm_and_si128(a, m_alpha128), zero));
+      }
+      else if constexpr (sizeof(pixel_t) == 2) {
+        eq = _mm_cmpeq_epi16(over, zero);
+        if (m_transparent)
+          eq = _mm_or_si128(eq, _mm_cmpeq_epi16(_mm_and_si128(a, m_alpha128), zero));
+      }
+      else {
+        eq = _mm_cmpeq_epi8(over, zero);
+      }
+      return eq;
+    }
+
+    // Returns a 16-bit mask with the bytes of the N pixels in "p"
+    // that match the color.
+    int bytes(const pixel_t* p) const {
+      return _mm_movemask_epi8(equal(p));
+    }
+
+    // Returns a N-bit mask with the pixels in "p" that match the
+    // color.
+    int pixels(const pixel_t* p) const {
+      const __m128i eq = equal(p);
+      if constexpr (sizeof(pixel_t) == 4)
+        return _mm_movemask_ps(_mm_castsi128_ps(eq));
+      else if constexpr (sizeof(pixel_t) == 2)
+        return _mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128()));
+      else
+        return _mm_movemask_epi8(eq);
+    }
+#endif
+
+    color_t m_color;
+    int m_tolerance;
+    color_t m_channels;
+    bool m_transparent;
+#if DOC_USE_SSE2_COLOR_MATCH
+    __m128i m_color128;
+    __m128i m_tolerance128;
+    __m128i m_channels128;
+    __m128i m_alpha128;
+#endif
+  };
+
+} // namespace algorithm
+} // namespace doc
+
+#endif
@@ -0,0 +1,107 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/algorithm/color_match.h"
+
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace doc;
+using namespace doc::algorithm;
+
+namespace {
+
+// Pixel by pixel comparison used as reference
+template<typename ImageTraits>
+bool match_ref(const color_t c, const color_t color, const int tolerance,
+               const bool transparentEqual, const color_t channels)
+{
+  constexpr int n = sizeof(typename ImageTraits::pixel_t);
+  if (transparentEqual) {
+    if (n == 4 && rgba_geta(c) == 0 && rgba_geta(color) == 0)
+      return true;
+    if (n == 2 && graya_geta(c) == 0 && graya_geta(color) == 0)
+      return true;
+  }
+  for (int i=0; i<n; ++i) {
+    const int shift = 8*i;
+    if (((channels >> shift) & 0xff) &&
+        std::abs(int((c >> shift) & 0xff) - int((color >> shift) & 0xff)) > tolerance)
+      return false;
+  }
+  return true;
+}
+
+template<typename ImageTraits>
+void test_color_match()
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const color_t valueMask = (sizeof(pixel_t) == 4 ? 0xffffffff:
+                             (1 << (8*sizeof(pixel_t))) - 1);
+
+  std::mt19937 rand(2026);
+  for (int i=0; i<500; ++i) {
+    const int w = 1 + rand() % 100;
+    const color_t color = rand() & valueMask;
+    const int tolerance = (rand() % 3 == 0 ? 0: rand() % 20);
+    const bool transparentEqual = (rand() % 2 == 0);
+    const color_t channels = (rand() % 2 == 0 ? 0xffffffff: 0xff00ff00);
+
+    std::vector<pixel_t> row(w);
+    for (pixel_t& p : row) {
+      color_t c = (rand() % 3 == 0 ? color: color_t(rand()));
+      if (rand() % 4 == 0)
+        c ^= (rand() % 8) << (8 * (rand() % sizeof(pixel_t)));
+      if (rand() % 5 == 0)
+        c &= 0x00ff00ff;        // Transparent pixels
+      p = pixel_t(c & valueMask);
+    }
+
+    const ColorMatch<ImageTraits> match(color, tolerance, transparentEqual, channels);
+    std::vector<uint8_t> bits((w+7)/8 + 1, 0xcc);
+    match.matchRow(row.data(), w, bits.data());
+
+    for (int x=0; x<w; ++x) {
+      const bool expected = match_ref<ImageTraits>(row[x], color, tolerance,
+                                                   transparentEqual, channels);
+      EXPECT_EQ(expected, match.match(row[x]));
+      EXPECT_EQ(expected, (bits[x/8] & (1 << (x%8))) != 0) << "x=" << x;
+    }
+    // Bits after the row are cleared, and the next byte is untouched
+    if (w % 8)
+      EXPECT_EQ(0, bits[w/8] >> (w % 8));
+    EXPECT_EQ(0xcc, bits[(w+7)/8]);
+
+    int first = w;
+    for (int x=0; x<w; ++x) {
+      if (!match_ref<ImageTraits>(row[x], color, tolerance, transparentEqual, channels)) {
+        first = x;
+        break;
+      }
+    }
+    EXPECT_EQ(first, match.findFirst(row.data(), 0, w, true));
+  }
+}
+
+} // anonymous namespace
+
+TEST(ColorMatch, Rgb)
+{
+  test_color_match<RgbTraits>();
+}
+
+TEST(ColorMatch, Grayscale)
+{
+  test_color_match<GrayscaleTraits>();
+}
+
+TEST(ColorMatch, Indexed)
+{
+  test_color_match<IndexedTraits>();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,6 +11,7 @@
 
 #include "doc/algorithm/flip_image.h"
 
+#include "doc/algorithm/reverse_pixels.h"
 #include "doc/dispatch.h"
 #include "doc/image.h"
 #include "doc/image_impl.h"
@@ -20,6 +21,7 @@
 #include "gfx/rect.h"
 
 #include <algorithm>
+#include <cstring>
 #include <memory>
 #include <utility>
 #include <vector>
@@ -30,6 +32,8 @@ namespace algorithm {
 template<typename ImageTraits>
 void flip_image_with_put_pixel_fast_templ(Image* image, const gfx::Rect& bounds, FlipType flipType)
 {
+  image->detachBits();
+
   switch (flipType) {
 
     case FlipHorizontal:
@@ -75,32 +79,33 @@ void flip_image_with_put_pixel_fast_templ(Image* image, const gfx::Rect& bounds,
 template<typename ImageTraits>
 void flip_image_with_rawptr_templ(Image* image, const gfx::Rect& bounds, FlipType flipType)
 {
-  using address_t = typename ImageTraits::address_t;
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  // Detach the bits just one time and then access the rows through
+  // the const image
+  image->detachBits();
+  const Image* constImage = image;
 
   switch (flipType) {
 
     case FlipHorizontal:
       for (int y=bounds.y; y<bounds.y2(); ++y) {
-        const int n = bounds.w/2;
-        auto l = (address_t)image->getPixelAddress(bounds.x, y);
-        auto r = (address_t)image->getPixelAddress(bounds.x2()-1, y);
-
-        for (int x=0; x<n; ++x, ++l, --r) {
-          std::swap(*l, *r);
-        }
+        auto row = (pixel_t*)constImage->getPixelAddress(bounds.x, y);
+        reverse_pixels(row, row+bounds.w);
       }
       break;
 
     case FlipVertical: {
-      const int n = bounds.w;
+      // Swap whole rows using a temporary row
+      const std::size_t rowBytes = sizeof(pixel_t) * bounds.w;
+      std::vector<uint8_t> tmp(rowBytes);
       int v = bounds.y2()-1;
       for (int y=bounds.y; y<bounds.y+bounds.h/2; ++y, --v) {
-        auto t = (address_t)image->getPixelAddress(bounds.x, y);
-        auto b = (address_t)image->getPixelAddress(bounds.x, v);
-
-        for (int x=0; x<n; ++x, ++t, ++b) {
-          std::swap(*t, *b);
-        }
+        uint8_t* t = constImage->getPixelAddress(bounds.x, y);
+        uint8_t* b = constImage->getPixelAddress(bounds.x, v);
+        std::memcpy(tmp.data(), t, rowBytes);
+        std::memcpy(t, b, rowBytes);
+        std::memcpy(b, tmp.data(), rowBytes);
       }
       break;
     }
@@ -111,6 +116,33 @@ void flip_image_with_rawptr_templ(Image* image, const gfx::Rect& bounds, FlipTyp
   }
 }
 
+// Flips the rows of a bitmap swapping the bytes of each row (the
+// bits outside the bounds in the first/last byte are kept).
+static void flip_bitmap_vertically(Image* image, const gfx::Rect& bounds)
+{
+  image->detachBits();
+  const Image* constImage = image;
+
+  const int i1 = bounds.x / 8;
+  const int i2 = (bounds.x2()-1) / 8;
+  const uint8_t firstMask = uint8_t(0xff << (bounds.x % 8));
+  const uint8_t lastMask = uint8_t(0xff >> (7 - (bounds.x2()-1) % 8));
+
+  int v = bounds.y2()-1;
+  for (int y=bounds.y; y<bounds.y+bounds.h/2; ++y, --v) {
+    uint8_t* t = constImage->getPixelAddress(0, y);
+    uint8_t* b = constImage->getPixelAddress(0, v);
+    for (int i=i1; i<=i2; ++i) {
+      uint8_t mask = 0xff;
+      if (i == i1) mask &= firstMask;
+      if (i == i2) mask &= lastMask;
+      const uint8_t diff = (t[i] ^ b[i]) & mask;
+      t[i] ^= diff;
+      b[i] ^= diff;
+    }
+  }
+}
+
 void flip_image_slow(Image* image, const gfx::Rect& bounds, FlipType flipType)
 {
   DOC_DISPATCH_BY_COLOR_MODE(
@@ -124,6 +156,9 @@ void flip_image(Image* image, const gfx::Rect& bounds, FlipType flipType)
   // Use get/put_pixel_fast for IMAGE_BITMAP as we cannot use the
   // rawptr to iterate through bits.
   if (image->colorMode() == ColorMode::BITMAP) {
+    if (flipType == FlipVertical && !bounds.isEmpty())
+      return flip_bitmap_vertically(image, bounds);
+
     return flip_image_with_put_pixel_fast_templ<BitmapTraits>(image, bounds, flipType);
   }
 
@@ -137,6 +172,7 @@ template<typename ImageTraits>
 void flip_image_with_mask_templ(Image* image, const Mask* mask, FlipType flipType, int bgcolor)
 {
   gfx::Rect bounds = mask->bounds();
+  image->detachBits();
 
   switch (flipType) {
 
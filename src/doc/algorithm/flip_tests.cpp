@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2026  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -51,6 +51,28 @@ TEST(Flip, Image)
   }
 }
 
+TEST(Flip, ImageBounds)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP, IMAGE_TILEMAP }) {
+    for (int w=3; w<100; w+=7) {
+      ImageRef b(Image::create(pf, w, 37));
+      doc::algorithm::random_image(b.get());
+      ImageRef c(Image::createCopy(b.get()));
+
+      const Rect bounds(1, 2, w-2, 33);
+      for (auto ft : { doc::algorithm::FlipHorizontal,
+                       doc::algorithm::FlipVertical }) {
+        doc::algorithm::flip_image(b.get(), bounds, ft);
+        doc::algorithm::flip_image_slow(c.get(), bounds, ft);
+
+        ASSERT_TRUE(is_same_image(b.get(), c.get()))
+          << "Pixel format=" << pf << " Width=" << w
+          << "\nFlip type=" << ft;
+      }
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -5,6 +5,7 @@
 // - Adapted to Aseprite
 // - Added non-contiguous mode
 // - Added mask parameter
+// - Added SSE2 scanline comparison and parallel non-contiguous mode
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -17,11 +18,14 @@
 
 #include "base/base.h"
 #include "doc/algo.h"
+#include "doc/algorithm/color_match.h"
 #include "doc/image.h"
 #include "doc/mask.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/primitives_fast.h"
 
+#include <algorithm>
 #include <climits>
 #include <cmath>
 #include <vector>
@@ -48,94 +52,56 @@ static int flood_count;          /* number of flooded segments */
 
 #define FLOOD_LINE(c)            (&flood_buf[c])
 
-static inline bool color_equal_32_raw(color_t c1, color_t c2)
+static inline bool is_masked(const Mask* mask, const int u, const int v)
 {
-  return (c1 == c2);
-}
-
-static inline bool color_equal_32(color_t c1, color_t c2, int tolerance)
-{
-  if (tolerance == 0)
-    return (c1 == c2) || (rgba_geta(c1) == 0 && rgba_geta(c2) == 0);
-  else {
-    int r1 = rgba_getr(c1);
-    int g1 = rgba_getg(c1);
-    int b1 = rgba_getb(c1);
-    int a1 = rgba_geta(c1);
-    int r2 = rgba_getr(c2);
-    int g2 = rgba_getg(c2);
-    int b2 = rgba_getb(c2);
-    int a2 = rgba_geta(c2);
-
-    if (a1 == 0 && a2 == 0)
-      return true;
-
-    return ((ABS(r1-r2) <= tolerance) &&
-            (ABS(g1-g2) <= tolerance) &&
-            (ABS(b1-b2) <= tolerance) &&
-            (ABS(a1-a2) <= tolerance));
-  }
-}
-
-static inline bool color_equal_16(color_t c1, color_t c2, int tolerance)
-{
-  if (tolerance == 0)
-    return (c1 == c2) || (graya_geta(c1) == 0 && graya_geta(c2) == 0);
-  else {
-    int k1 = graya_getv(c1);
-    int a1 = graya_geta(c1);
-    int k2 = graya_getv(c2);
-    int a2 = graya_geta(c2);
-
-    if (a1 == 0 && a2 == 0)
-      return true;
-
-    return ((ABS(k1-k2) <= tolerance) &&
-            (ABS(a1-a2) <= tolerance));
-  }
-}
-
-static inline bool color_equal_8(color_t c1, color_t c2, int tolerance)
-{
-  if (tolerance == 0)
-    return (c1 == c2);
-  else
-    return ABS((int)c1 - (int)c2) <= tolerance;
+  return (mask &&
+          (!mask->bounds().contains(u, v) ||
+           (mask->bitmap() &&
+            !get_pixel_fast<BitmapTraits>(mask->bitmap(),
+                                          u-mask->bounds().x,
+                                          v-mask->bounds().y))));
 }
 
+// Finds the run of pixels around x that are equal to the source
+// color. Returns false if the start pixel isn't equal, or the first
+// different pixels at both sides of x in "left" and "right".
 template<typename ImageTraits>
-static inline bool color_equal(color_t c1, color_t c2, int tolerance)
-{
-  static_assert(false && sizeof(ImageTraits), "Invalid color comparison");
-  return false;
-}
-
-template<>
-inline bool color_equal<RgbTraits>(color_t c1, color_t c2, int tolerance)
-{
-  return color_equal_32(c1, c2, tolerance);
-}
-
-template<>
-inline bool color_equal<GrayscaleTraits>(color_t c1, color_t c2, int tolerance)
-{
-  return color_equal_16(c1, c2, tolerance);
-}
-
-template<>
-inline bool color_equal<IndexedTraits>(color_t c1, color_t c2, int tolerance)
+static bool find_run(const Image* image,
+                     const Mask* mask,
+                     const int x, const int y,
+                     const gfx::Rect& bounds,
+                     const color_t src_color, const int tolerance,
+                     int& left, int& right)
 {
-  return color_equal_8(c1, c2, tolerance);
-}
-
-template<>
-inline bool color_equal<TilemapTraits>(color_t c1, color_t c2, int tolerance)
-{
-  return color_equal_32_raw(c1, c2);
+  auto row = reinterpret_cast<const typename ImageTraits::pixel_t*>(
+    image->getPixelAddress(0, y));
+  const ColorMatch<ImageTraits> match(src_color, tolerance, true);
+
+  // Check start pixel
+  if (!match.match(row[x]) || is_masked(mask, x, y))
+    return false;
+
+  left = match.findLastDifferent(row, bounds.x, x-1);
+  right = match.findFirst(row, x+1, bounds.x2(), true);
+
+  // The mask can reduce the run
+  if (mask) {
+    for (int u=x-1; u>left; --u) {
+      if (is_masked(mask, u, y)) {
+        left = u;
+        break;
+      }
+    }
+    for (int u=x+1; u<right; ++u) {
+      if (is_masked(mask, u, y)) {
+        right = u;
+        break;
+      }
+    }
+  }
+  return true;
 }
 
-
-
 /* flooder:
  *  Fills a horizontal line around the specified position, and adds it
  *  to the list of drawn segments. Returns the first x coordinate after
@@ -147,129 +113,57 @@ static int flooder(const Image* image,
                    const gfx::Rect& bounds,
                    color_t src_color, int tolerance, void *data, AlgoHLine proc)
 {
-#define MASKED(u, v)                                                    \
-        (mask &&                                                        \
-         (!mask->bounds().contains(u, v) ||                             \
-          (mask->bitmap() &&                                            \
-           !get_pixel_fast<BitmapTraits>(mask->bitmap(),                \
-                                         (u)-mask->bounds().x,          \
-                                         (v)-mask->bounds().y))))
-
   FLOODED_LINE *p;
   int left = 0, right = 0;
   int c;
+  bool found = false;
 
   switch (image->pixelFormat()) {
 
     case IMAGE_RGB:
-      {
-        uint32_t* address = reinterpret_cast<uint32_t*>(image->getPixelAddress(0, y));
-
-        // Check start pixel
-        if (!color_equal_32((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_32((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_32((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
+      found = find_run<RgbTraits>(image, mask, x, y, bounds,
+                                  src_color, tolerance, left, right);
       break;
 
     case IMAGE_GRAYSCALE:
-      {
-        uint16_t* address = reinterpret_cast<uint16_t*>(image->getPixelAddress(0, y));
-
-        // Check start pixel
-        if (!color_equal_16((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_16((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_16((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
+      found = find_run<GrayscaleTraits>(image, mask, x, y, bounds,
+                                        src_color, tolerance, left, right);
       break;
 
     case IMAGE_INDEXED:
-      {
-        uint8_t* address = image->getPixelAddress(0, y);
-
-        // Check start pixel
-        if (!color_equal_8((int)*(address+x), src_color, tolerance) || MASKED(x, y))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_8((int)*(address+left), src_color, tolerance) || MASKED(left, y))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_8((int)*(address+right), src_color, tolerance) || MASKED(right, y))
-            break;
-        }
-      }
+      found = find_run<IndexedTraits>(image, mask, x, y, bounds,
+                                      src_color, tolerance, left, right);
       break;
 
     case IMAGE_TILEMAP:
-      {
-        // TODO add support for mask
-
-        uint32_t* address = reinterpret_cast<uint32_t*>(image->getPixelAddress(0, y));
-
-        // Check start pixel
-        if (!color_equal_32_raw((int)*(address+x), src_color))
-          return x+1;
-
-        // Work left from starting point
-        for (left=x-1; left>=bounds.x; left--) {
-          if (!color_equal_32_raw((int)*(address+left), src_color))
-            break;
-        }
-
-        // Work right from starting point
-        for (right=x+1; right<bounds.x2(); right++) {
-          if (!color_equal_32_raw((int)*(address+right), src_color))
-            break;
-        }
-      }
+      // TODO add support for mask
+      found = find_run<TilemapTraits>(image, nullptr, x, y, bounds,
+                                      src_color, tolerance, left, right);
       break;
 
     default:
       // Check start pixel
-      if (get_pixel(image, x, y) != src_color || MASKED(x, y))
-        return x+1;
+      if (get_pixel(image, x, y) != src_color || is_masked(mask, x, y))
+        break;
 
       // Work left from starting point
       for (left=x-1; left>=bounds.x; left--) {
-        if (get_pixel(image, left, y) != src_color || MASKED(left, y))
+        if (get_pixel(image, left, y) != src_color || is_masked(mask, left, y))
           break;
       }
 
       // Work right from starting point
       for (right=x+1; right<bounds.x2(); right++) {
-        if (get_pixel(image, right, y) != src_color || MASKED(right, y))
+        if (get_pixel(image, right, y) != src_color || is_masked(mask, right, y))
           break;
       }
+      found = true;
       break;
   }
 
+  if (!found)
+    return x+1;
+
   left++;
   right--;
 
@@ -347,26 +241,80 @@ static int check_flood_line(const Image* image,
   return ret;
 }
 
-template<typename ImageTraits>
-static void replace_color(const Image* image, const gfx::Rect& bounds, int src_color, int tolerance, void* data, AlgoHLine proc)
+// Minimum number of pixels in the bounds to find the runs of the
+// non-contiguous mode in parallel
+const int kParallelMinPixels = 256*256;
+
+// Number of rows of each band processed in parallel
+const int kRowsPerBand = 64;
+
+struct HLine {
+  int x1, y, x2;
+};
+
+// Calls func(x1, y, x2) for each run of pixels equal to the source
+// color in the rows [y1, y2) of the given bounds.
+template<typename ImageTraits, typename Func>
+static void replace_color_rows(const Image* image, const gfx::Rect& bounds,
+                               const int y1, const int y2,
+                               int src_color, int tolerance, Func&& func)
 {
-  typename ImageTraits::address_t address;
+  const ColorMatch<ImageTraits> match(src_color, tolerance, true);
+  const int x2 = bounds.x2();
+  for (int y=y1; y<y2; ++y) {
+    auto row = reinterpret_cast<const typename ImageTraits::pixel_t*>(
+      image->getPixelAddress(0, y));
+
+    int x = bounds.x;
+    while (x < x2) {
+      x = match.findFirst(row, x, x2, false);
+      if (x == x2)
+        break;
 
-  for (int y=bounds.y; y<bounds.y2(); ++y) {
-    address = reinterpret_cast<typename ImageTraits::address_t>(image->getPixelAddress(bounds.x, y));
+      const int right = match.findFirst(row, x+1, x2, true);
+      func(x, y, right-1);
+      x = right+1;
+    }
+  }
+}
 
-    for (int x=bounds.x; x<bounds.x2(); ++x, ++address) {
-      int right = -1;
+// The runs of each band of rows are found in parallel, but "proc" is
+// always called from this thread, in the same order as in the
+// sequential version (from top to bottom).
+template<typename ImageTraits>
+static void replace_color(const Image* image, const gfx::Rect& bounds, int src_color, int tolerance, void* data, AlgoHLine proc)
+{
+  const int threads = parallel_threads();
+  if (threads == 1 ||
+      bounds.w*bounds.h < kParallelMinPixels ||
+      bounds.h < 2*kRowsPerBand) {
+    replace_color_rows<ImageTraits>(
+      image, bounds, bounds.y, bounds.y2(), src_color, tolerance,
+      [data, proc](int x1, int y, int x2) { (*proc)(x1, y, x2, data); });
+    return;
+  }
 
-      if (color_equal<ImageTraits>((int)(*address), src_color, tolerance)) {
-        ++address;
-        for (right=x+1; right<bounds.x2(); ++right, ++address) {
-          if (!color_equal<ImageTraits>((int)(*address), src_color, tolerance))
-            break;
-        }
-        (*proc)(x, y, right-1, data);
-        x = right;
-      }
+  // Each round processes one band per thread, so we keep the found
+  // runs of a limited number of rows in memory.
+  std::vector<std::vector<HLine>> bands(threads);
+
+  for (int y=bounds.y; y<bounds.y2(); y+=threads*kRowsPerBand) {
+    const int n = std::min(threads, (bounds.y2()-y+kRowsPerBand-1) / kRowsPerBand);
+    parallel_for(
+      n,
+      [image, &bounds, y, src_color, tolerance, &bands](const int i){
+        const int v1 = y + i*kRowsPerBand;
+        const int v2 = std::min(v1+kRowsPerBand, bounds.y2());
+        std::vector<HLine>& band = bands[i];
+        replace_color_rows<ImageTraits>(
+          image, bounds, v1, v2, src_color, tolerance,
+          [&band](int x1, int y, int x2) { band.push_back(HLine{ x1, y, x2 }); });
+      });
+
+    for (std::vector<HLine>& band : bands) {
+      for (const HLine& h : band)
+        (*proc)(h.x1, h.y, h.x2, data);
+      band.clear();
     }
   }
 }
@@ -0,0 +1,70 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/algorithm/floodfill.h"
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <benchmark/benchmark.h>
+
+using namespace doc;
+
+static void count_pixels(int x1, int y, int x2, void* data)
+{
+  *static_cast<int*>(data) += x2-x1+1;
+}
+
+// Image with a border of color 1 and vertical lines of color 1 every
+// 64 pixels (so there are a lot of small runs in each row).
+static Image* create_image(const PixelFormat pf, const int w, const int h)
+{
+  Image* img = Image::create(pf, w, h);
+  img->clear(0);
+  const color_t c = (pf == IMAGE_RGB ? rgba(255, 255, 255, 255):
+                     pf == IMAGE_GRAYSCALE ? graya(255, 255): 1);
+  draw_rect(img, 0, 0, w-1, h-1, c);
+  for (int x=64; x<w; x+=64)
+    draw_vline(img, x, 1, h-3, c);
+  return img;
+}
+
+void BM_FloodFill(benchmark::State& state) {
+  const auto pf = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+  const bool contiguous = state.range(3);
+  const int tolerance = state.range(4);
+  std::unique_ptr<Image> img(create_image(pf, w, h));
+  while (state.KeepRunning()) {
+    int pixels = 0;
+    algorithm::floodfill(img.get(), nullptr, 1, 1, img->bounds(),
+                         get_pixel(img.get(), 1, 1), tolerance,
+                         contiguous, false, &pixels, count_pixels);
+    benchmark::DoNotOptimize(pixels);
+  }
+}
+
+#define DEFARGS()                                       \
+  ->Args({ IMAGE_RGB, 8192, 8192, true, 0 })            \
+  ->Args({ IMAGE_RGB, 8192, 8192, true, 16 })           \
+  ->Args({ IMAGE_RGB, 8192, 8192, false, 0 })           \
+  ->Args({ IMAGE_RGB, 8192, 8192, false, 16 })          \
+  ->Args({ IMAGE_GRAYSCALE, 8192, 8192, true, 16 })     \
+  ->Args({ IMAGE_GRAYSCALE, 8192, 8192, false, 16 })    \
+  ->Args({ IMAGE_INDEXED, 8192, 8192, true, 0 })        \
+  ->Args({ IMAGE_INDEXED, 8192, 8192, false, 0 })
+
+BENCHMARK(BM_FloodFill)
+  DEFARGS()
+  ->Unit(benchmark::kMillisecond)
+  ->UseRealTime();
+
+BENCHMARK_MAIN();
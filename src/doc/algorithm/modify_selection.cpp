@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2021 Igara Studio S.A.
+// Copyright (c) 2021-2026 Igara Studio S.A.
 // Copyright (c) 2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,15 +13,83 @@
 
 #include "doc/image_impl.h"
 #include "doc/mask.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <memory>
+#include <vector>
 
 namespace doc {
 namespace algorithm {
 
-// TODO create morphological operators/functions in "doc" namespace
-// TODO the impl is not optimal, but is good enough as a first version
+namespace {
+
+// The selection is processed as rows of packed bits, 64 pixels per
+// word (bit "x" of a row is the bit x%64 of the word x/64).
+using Word = uint64_t;
+const int kWordBits = 64;
+
+// Minimum number of rows processed by each task
+const int kMinRowsPerBand = 16;
+
+// Number of bands of rows per thread
+const int kBandsPerThread = 4;
+
+// Minimum number of pixels to process the rows in parallel
+const int kParallelMinPixels = 256*256;
+
+// Calls func(y1, y2) for bands of rows in [0, h) (in parallel when
+// there are enough pixels).
+template<typename Func>
+void for_each_rows_band(const int w, const int h, Func&& func)
+{
+  parallel_for_bands(0, h,
+                     parallel_bands(w, h,
+                                    kParallelMinPixels,
+                                    kMinRowsPerBand,
+                                    kBandsPerThread),
+                     func);
+}
+
+inline int floor_div(const int a, const int b)
+{
+  return (a >= 0 ? a / b: -((-a + b - 1) / b));
+}
+
+// Returns the 64 bits of the row starting from the given bit (which
+// can be negative or after the end of the row, bits outside the row
+// are 0).
+inline Word read_word(const Word* row, const int words, const int bit)
+{
+  const int i = floor_div(bit, kWordBits);
+  const int b = bit - i*kWordBits;
+  const Word lo = (i >= 0 && i < words ? row[i]: 0);
+  if (b == 0)
+    return lo;
+  const Word hi = (i+1 >= 0 && i+1 < words ? row[i+1]: 0);
+  return (lo >> b) | (hi << (kWordBits-b));
+}
+
+// Horizontal span of pixels of one row of the kernel (relative to
+// the kernel center).
+struct KernelRow {
+  int dy;                       // Row offset
+  int dx;                       // First pixel offset
+  int n;                        // Number of pixels of the span
+  int level;                    // log2 of the biggest power of 2 <= n
+};
+
+} // anonymous namespace
+
+// The kernel is decomposed in horizontal spans. Each span is solved
+// with rows of precalculated "runs": the run table of level "l" has
+// in each bit the OR (or AND) of the 2^l source pixels starting at
+// that bit, so a span of n pixels is the combination of two
+// overlapping runs of the biggest 2^l <= n. The cost is
+// proportional to the number of kernel rows (not to radius^2), and
+// 64 pixels are processed at once.
 void modify_selection(const SelectionModifier modifier,
                       const Mask* srcMask,
                       Mask* dstMask,
@@ -34,8 +102,14 @@ void modify_selection(const SelectionModifier modifier,
     srcMask->bounds().origin() -
     dstMask->bounds().origin();
 
-  // Image bounds to clip get/put pixels
-  const gfx::Rect srcBounds = srcImage->bounds();
+  const int w = srcImage->width();
+  const int h = srcImage->height();
+
+  // Spans can start up to 2*radius pixels before the first source
+  // pixel, so the rows of run tables start with some padding words.
+  const int padWords = (2*radius + kWordBits - 1) / kWordBits;
+  const int pad = padWords * kWordBits;
+  const int words = padWords + (w + kWordBits - 1) / kWordBits;
 
   // Create a kernel
   const int size = 2*radius+1;
@@ -45,52 +119,148 @@ void modify_selection(const SelectionModifier modifier,
     doc::fill_ellipse(kernel.get(), 0, 0, size-1, size-1, 0, 0, 1);
   else
     doc::fill_rect(kernel.get(), 0, 0, size-1, size-1, 1);
-  doc::put_pixel(kernel.get(), radius, radius, 0);
-
-  int total = 0;                // Number of 1s in the kernel image
-  for (int v=0; v<size; ++v)
-    for (int u=0; u<size; ++u)
-      total += kernel->getPixel(u, v);
-
-  for (int y=-radius; y<srcBounds.h+radius; ++y) {
-    for (int x=-radius; x<srcBounds.w+radius; ++x) {
-      doc::color_t c;
-      if (srcBounds.contains(x, y))
-        c = srcImage->getPixel(x, y);
-      else
-        c = 0;
-
-      int accum = 0;
-      for (int v=0; v<size; ++v) {
-        for (int u=0; u<size; ++u) {
-          if (kernel->getPixel(u, v)) {
-            if (srcBounds.contains(x+u-radius, y+v-radius))
-              accum += srcImage->getPixel(x-radius+u, y-radius+v);
+
+  std::vector<KernelRow> kernelRows;
+  int levels = 1;
+  for (int v=0; v<size; ++v) {
+    int u1 = -1, u2 = -1;
+    for (int u=0; u<size; ++u) {
+      if (kernel->getPixel(u, v)) {
+        if (u1 < 0)
+          u1 = u;
+        u2 = u;
+      }
+    }
+    if (u1 < 0)
+      continue;
+
+    KernelRow row;
+    row.dy = v - radius;
+    row.dx = u1 - radius;
+    row.n = u2 - u1 + 1;
+    row.level = 0;
+    while ((2 << row.level) <= row.n)
+      ++row.level;
+    levels = std::max(levels, row.level+1);
+    kernelRows.push_back(row);
+  }
+
+  // Expand is a dilation (OR of the pixels in the kernel), contract
+  // and border use an erosion (AND of the pixels in the kernel,
+  // where pixels outside the selection are 0).
+  const bool erode = (modifier != SelectionModifier::Expand);
+
+  // Run tables for each level and row (level 0 is the source bitmap)
+  std::vector<Word> runs(std::size_t(levels) * h * words);
+  auto runsRow = [&runs, h, words](const int level, const int y) -> Word* {
+    return &runs[(std::size_t(level)*h + y) * words];
+  };
+
+  for_each_rows_band(
+    w, h,
+    [srcImage, w, words, padWords, levels, erode, &runsRow](const int y1, const int y2) {
+      const int bytes = (w + 7) / 8;
+
+      for (int y=y1; y<y2; ++y) {
+        const uint8_t* srcRow = srcImage->getPixelAddress(0, y);
+        Word* row = runsRow(0, y);
+
+        std::fill(row, row+padWords, Word(0));
+        for (int i=0; i<words-padWords; ++i) {
+          Word word = 0;
+          for (int j=0; j<8 && i*8+j<bytes; ++j)
+            word |= Word(srcRow[i*8+j]) << (8*j);
+          row[padWords+i] = word;
+        }
+        // Clear bits after the width of the image
+        if (w % kWordBits)
+          row[words-1] &= (Word(1) << (w % kWordBits)) - 1;
+
+        for (int l=1; l<levels; ++l) {
+          const Word* prev = runsRow(l-1, y);
+          Word* cur = runsRow(l, y);
+          const int step = 1 << (l-1);
+          for (int i=0; i<words; ++i) {
+            const Word next = read_word(prev, words, i*kWordBits + step);
+            cur[i] = (erode ? prev[i] & next: prev[i] | next);
           }
         }
       }
+    });
+
+  // Output rows/columns (in source coordinates) that are inside the
+  // destination bitmap.
+  const int outX = -radius;
+  const int outW = w + 2*radius;
+  const int outWords = (outW + kWordBits - 1) / kWordBits;
+  const int outY1 = std::max(-radius, -offset.y);
+  const int outY2 = std::min(h+radius, dstImage->height() - offset.y);
+  if (outY1 >= outY2)
+    return;
+
+  const int dstX1 = std::max(0, offset.x + outX);
+  const int dstX2 = std::min(dstImage->width(), offset.x + outX + outW);
+  if (dstX1 >= dstX2)
+    return;
+
+  // Detach the bits just one time before writing rows in parallel
+  dstImage->detachBits();
+  const doc::Image* constDstImage = dstImage;
+
+  for_each_rows_band(
+    outW, outY2 - outY1,
+    [&](const int y1, const int y2) {
+      std::vector<Word> out(outWords);
 
-      switch (modifier) {
-        case SelectionModifier::Border: {
-          c = (c && accum < total) ? 1: 0;
-          break;
+      for (int y=outY1+y1; y<outY1+y2; ++y) {
+        std::fill(out.begin(), out.end(), (erode ? ~Word(0): Word(0)));
+
+        for (const KernelRow& kr : kernelRows) {
+          const int sy = y + kr.dy;
+          if (sy < 0 || sy >= h) {
+            if (erode) {
+              std::fill(out.begin(), out.end(), Word(0));
+              break;
+            }
+            continue;
+          }
+
+          const Word* row = runsRow(kr.level, sy);
+          const int rest = kr.n - (1 << kr.level);
+          for (int i=0; i<outWords; ++i) {
+            const int bit = pad + i*kWordBits + outX + kr.dx;
+            const Word a = read_word(row, words, bit);
+            const Word b = (rest ? read_word(row, words, bit + rest): a);
+            if (erode)
+              out[i] &= a & b;
+            else
+              out[i] |= a | b;
+          }
         }
-        case SelectionModifier::Expand: {
-          c = (c || accum > 0) ? 1: 0;
-          break;
+
+        // Border = selection - contracted selection
+        if (modifier == SelectionModifier::Border) {
+          if (y >= 0 && y < h) {
+            const Word* row = runsRow(0, y);
+            for (int i=0; i<outWords; ++i)
+              out[i] = read_word(row, words, pad + i*kWordBits + outX) & ~out[i];
+          }
+          else
+            std::fill(out.begin(), out.end(), Word(0));
         }
-        case SelectionModifier::Contract: {
-          c = (c && accum == total) ? 1: 0;
-          break;
+
+        // Add the pixels to the destination bitmap
+        uint8_t* dstRow = constDstImage->getPixelAddress(0, offset.y+y);
+        for (int j=dstX1/8; j<=(dstX2-1)/8; ++j) {
+          int bits = int(read_word(out.data(), outWords, j*8 - offset.x - outX) & 0xff);
+          if (j*8 < dstX1)
+            bits &= (0xff << (dstX1 - j*8)) & 0xff;
+          if (j*8+8 > dstX2)
+            bits &= (1 << (dstX2 - j*8)) - 1;
+          dstRow[j] |= uint8_t(bits);
         }
       }
-
-      if (c)
-        doc::put_pixel(dstImage,
-                       offset.x+x,
-                       offset.y+y, 1);
-    }
-  }
+    });
 }
 
 } // namespace algorithm
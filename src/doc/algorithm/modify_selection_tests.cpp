@@ -0,0 +1,124 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/algorithm/modify_selection.h"
+#include "doc/image.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+
+#include <memory>
+
+using namespace doc;
+using namespace doc::algorithm;
+using namespace gfx;
+
+namespace {
+
+// Pixel by pixel implementation used as reference
+void modify_selection_ref(const SelectionModifier modifier,
+                          const Mask* srcMask,
+                          Mask* dstMask,
+                          const int radius,
+                          const BrushType brush)
+{
+  const Image* srcImage = srcMask->bitmap();
+  Image* dstImage = dstMask->bitmap();
+  const Point offset = srcMask->bounds().origin() - dstMask->bounds().origin();
+  const Rect srcBounds = srcImage->bounds();
+
+  const int size = 2*radius+1;
+  std::unique_ptr<Image> kernel(Image::create(IMAGE_BITMAP, size, size));
+  clear_image(kernel.get(), 0);
+  if (brush == kCircleBrushType)
+    fill_ellipse(kernel.get(), 0, 0, size-1, size-1, 0, 0, 1);
+  else
+    fill_rect(kernel.get(), 0, 0, size-1, size-1, 1);
+
+  for (int y=-radius; y<srcBounds.h+radius; ++y) {
+    for (int x=-radius; x<srcBounds.w+radius; ++x) {
+      const bool c = (srcBounds.contains(x, y) && srcImage->getPixel(x, y));
+      bool any = false, all = true;
+      for (int v=0; v<size; ++v) {
+        for (int u=0; u<size; ++u) {
+          if (kernel->getPixel(u, v)) {
+            const int px = x+u-radius;
+            const int py = y+v-radius;
+            const bool p = (srcBounds.contains(px, py) && srcImage->getPixel(px, py));
+            any |= p;
+            all &= p;
+          }
+        }
+      }
+
+      bool result = false;
+      switch (modifier) {
+        case SelectionModifier::Border: result = (c && !all); break;
+        case SelectionModifier::Expand: result = any; break;
+        case SelectionModifier::Contract: result = all; break;
+      }
+      if (result)
+        put_pixel(dstImage, offset.x+x, offset.y+y, 1);
+    }
+  }
+}
+
+void expect_same_result(const SelectionModifier modifier,
+                        const Mask* srcMask,
+                        const Rect& dstBounds,
+                        const int radius,
+                        const BrushType brush)
+{
+  Mask a, b;
+  a.reserve(dstBounds);
+  b.reserve(dstBounds);
+  modify_selection(modifier, srcMask, &a, radius, brush);
+  modify_selection_ref(modifier, srcMask, &b, radius, brush);
+  EXPECT_EQ(0, count_diff_between_images(a.bitmap(), b.bitmap()))
+    << "modifier=" << int(modifier)
+    << " radius=" << radius
+    << " brush=" << int(brush);
+}
+
+} // anonymous namespace
+
+TEST(ModifySelection, ExpandOnePixel)
+{
+  Mask src;
+  src.replace(Rect(1, 0, 1, 1));
+
+  Mask dst;
+  dst.reserve(Rect(-2, -1, 6, 3));
+  modify_selection(SelectionModifier::Expand, &src, &dst, 1, kSquareBrushType);
+
+  const Image* img = dst.bitmap();
+  for (int y=0; y<img->height(); ++y)
+    for (int x=0; x<img->width(); ++x)
+      EXPECT_EQ((x >= 2 && x <= 4 ? 1: 0), img->getPixel(x, y)) << x << "," << y;
+}
+
+TEST(ModifySelection, SameAsReference)
+{
+  Mask src;
+  src.replace(Rect(3, 5, 70, 40));
+  src.add(Rect(80, 2, 3, 90));
+  src.subtract(Rect(20, 20, 9, 4));
+  src.add(Rect(130, 60, 1, 1));
+
+  for (int radius : { 1, 2, 5, 17, 40 }) {
+    for (BrushType brush : { kCircleBrushType, kSquareBrushType }) {
+      for (SelectionModifier modifier : { SelectionModifier::Border,
+                                          SelectionModifier::Expand,
+                                          SelectionModifier::Contract }) {
+        // Destination with the same bounds (clipped result) and
+        // with bigger bounds
+        expect_same_result(modifier, &src, src.bounds(), radius, brush);
+        expect_same_result(modifier, &src, Rect(-50, -50, 250, 200), radius, brush);
+      }
+    }
+  }
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -14,34 +14,268 @@
 #include "doc/algorithm/rotsprite.h"
 #include "doc/image_impl.h"
 #include "doc/palette.h"
+#include "doc/parallel.h"
 #include "doc/primitives_fast.h"
 #include "doc/rgbmap.h"
 #include "gfx/point.h"
 
+#include <algorithm>
 #include <cmath>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define DOC_USE_SSE2_RESIZE 1
+#endif
 
 namespace doc {
 namespace algorithm {
 
+namespace {
+
+// Minimum number of destination pixels to split the resize in bands
+// of rows processed in parallel (smaller images are resized in the
+// caller thread).
+const int kParallelMinPixels = 256*256;
+const int kMinRowsPerBand = 16;
+const int kBandsPerThread = 4;
+
+// Calls func(y1, y2) for bands of rows [y1, y2) of the destination
+// image. Each band writes different rows of "dst" so they can be
+// processed at the same time.
+template<typename Func>
+void for_each_rows_band(const Image* dst, const bool parallel, Func&& func)
+{
+  const int h = dst->height();
+  parallel_for_bands(0, h,
+                     (parallel ? parallel_bands(dst->width(), h,
+                                                kParallelMinPixels,
+                                                kMinRowsPerBand,
+                                                kBandsPerThread): 1),
+                     func);
+}
+
 template<typename ImageTraits>
 void resize_image_nearest(const Image* src, Image* dst)
 {
-  double x_ratio = double(src->width()) / double(dst->width());
-  double y_ratio = double(src->height()) / double(dst->height());
-  double px, py;
-
-  LockImageBits<ImageTraits> dstBits(dst);
-  auto dstIt = dstBits.begin();
-
-  for (int y=0; y<dst->height(); ++y) {
-    py = std::floor(y * y_ratio);
-    for (int x=0; x<dst->width(); ++x, ++dstIt) {
-      px = std::floor(x * x_ratio);
-      *dstIt = get_pixel_fast<ImageTraits>(src, int(px), int(py));
+  const double x_ratio = double(src->width()) / double(dst->width());
+  const double y_ratio = double(src->height()) / double(dst->height());
+
+  // Source column for each destination column
+  std::vector<int> cols(dst->width());
+  for (int x=0; x<dst->width(); ++x)
+    cols[x] = int(std::floor(x * x_ratio));
+
+  for_each_rows_band(
+    dst, true,
+    [src, dst, y_ratio, &cols](const int y1, const int y2) {
+      using address_t = typename ImageTraits::address_t;
+      using const_address_t = typename ImageTraits::const_address_t;
+      const int w = dst->width();
+
+      for (int y=y1; y<y2; ++y) {
+        const int py = int(std::floor(y * y_ratio));
+        if constexpr (ImageTraits::pixel_format == IMAGE_BITMAP) {
+          for (int x=0; x<w; ++x)
+            put_pixel_fast<ImageTraits>(
+              dst, x, y, get_pixel_fast<ImageTraits>(src, cols[x], py));
+        }
+        else {
+          auto srcRow = (const_address_t)src->getPixelAddress(0, py);
+          auto dstRow = (address_t)dst->getPixelAddress(0, y);
+          for (int x=0; x<w; ++x)
+            dstRow[x] = srcRow[cols[x]];
+        }
+      }
+    });
+}
+
+// Source coordinates and weights of one destination column/row for
+// the bilinear interpolation.
+struct BilinearCoord {
+  int i1, i2;                   // Source coordinates to interpolate
+  double w1, w2;                // Weights of i2 and i1 (w2 = 1-w1)
+};
+
+std::vector<BilinearCoord> bilinear_coords(const int srcSize,
+                                           const int dstSize)
+{
+  const double d =
+    (dstSize > 1 ? (srcSize-1) * 1.0 / (dstSize-1): 0.0);
+
+  std::vector<BilinearCoord> coords(dstSize);
+  for (int i=0; i<dstSize; ++i) {
+    const double u = i * d;
+    int i1 = int(std::floor(u));
+    int i2;
+    if (i1 > srcSize-1) {
+      i1 = srcSize-1;
+      i2 = srcSize-1;
     }
+    else if (i1 == srcSize-1)
+      i2 = i1;
+    else
+      i2 = i1+1;
+
+    coords[i].i1 = i1;
+    coords[i].i2 = i2;
+    coords[i].w1 = u - i1;
+    coords[i].w2 = 1 - coords[i].w1;
   }
+  return coords;
+}
+
+inline int bilinear_channel(const int c0, const int c1,
+                            const int c2, const int c3,
+                            const double u1, const double u2,
+                            const double v1, const double v2)
+{
+  return int((c0*u2 + c1*u1)*v2 + (c2*u2 + c3*u1)*v1);
+}
+
+inline color_t bilinear_rgba(const color_t c0, const color_t c1,
+                             const color_t c2, const color_t c3,
+                             const double u1, const double u2,
+                             const double v1, const double v2)
+{
+#if DOC_USE_SSE2_RESIZE
+  // The four channels are interpolated with packed doubles (two
+  // channels per register), which gives the same result as the
+  // scalar version below.
+  const __m128i zero = _mm_setzero_si128();
+  auto unpack = [zero](const color_t c, __m128d& rg, __m128d& ba) {
+    __m128i x = _mm_cvtsi32_si128(int(c));
+    x = _mm_unpacklo_epi8(x, zero);
+    x = _mm_unpacklo_epi16(x, zero);
+    rg = _mm_cvtepi32_pd(x);
+    ba = _mm_cvtepi32_pd(_mm_shuffle_epi32(x, _MM_SHUFFLE(1, 0, 3, 2)));
+  };
+
+  __m128d rg0, ba0, rg1, ba1, rg2, ba2, rg3, ba3;
+  unpack(c0, rg0, ba0);
+  unpack(c1, rg1, ba1);
+  unpack(c2, rg2, ba2);
+  unpack(c3, rg3, ba3);
+
+  const __m128d mu1 = _mm_set1_pd(u1);
+  const __m128d mu2 = _mm_set1_pd(u2);
+  const __m128d mv1 = _mm_set1_pd(v1);
+  const __m128d mv2 = _mm_set1_pd(v2);
+  auto interp = [&](const __m128d a, const __m128d b,
+                    const __m128d c, const __m128d d) {
+    return _mm_add_pd(
+      _mm_mul_pd(_mm_add_pd(_mm_mul_pd(a, mu2), _mm_mul_pd(b, mu1)), mv2),
+      _mm_mul_pd(_mm_add_pd(_mm_mul_pd(c, mu2), _mm_mul_pd(d, mu1)), mv1));
+  };
+
+  const __m128i rg = _mm_cvttpd_epi32(interp(rg0, rg1, rg2, rg3));
+  const __m128i ba = _mm_cvttpd_epi32(interp(ba0, ba1, ba2, ba3));
+  __m128i x = _mm_unpacklo_epi64(rg, ba);
+  x = _mm_packs_epi32(x, x);
+  x = _mm_packus_epi16(x, x);
+  return color_t(_mm_cvtsi128_si32(x));
+#else
+  return rgba(
+    bilinear_channel(rgba_getr(c0), rgba_getr(c1), rgba_getr(c2), rgba_getr(c3), u1, u2, v1, v2),
+    bilinear_channel(rgba_getg(c0), rgba_getg(c1), rgba_getg(c2), rgba_getg(c3), u1, u2, v1, v2),
+    bilinear_channel(rgba_getb(c0), rgba_getb(c1), rgba_getb(c2), rgba_getb(c3), u1, u2, v1, v2),
+    bilinear_channel(rgba_geta(c0), rgba_geta(c1), rgba_geta(c2), rgba_geta(c3), u1, u2, v1, v2));
+#endif
+}
+
+void resize_image_bilinear(const Image* src,
+                           Image* dst,
+                           const Palette* pal,
+                           const RgbMap* rgbmap,
+                           const color_t maskColor)
+{
+  const std::vector<BilinearCoord> cols =
+    bilinear_coords(src->width(), dst->width());
+  const std::vector<BilinearCoord> rows =
+    bilinear_coords(src->height(), dst->height());
+
+  // Indexed images are resized in one thread because RgbMap
+  // implementations can generate entries lazily in mapColor().
+  const bool parallel = (dst->pixelFormat() != IMAGE_INDEXED);
+
+  for_each_rows_band(
+    dst, parallel,
+    [src, dst, pal, rgbmap, maskColor, &cols, &rows](const int y1, const int y2) {
+      const int w = dst->width();
+
+      for (int y=y1; y<y2; ++y) {
+        const BilinearCoord& row = rows[y];
+        const double v1 = row.w1;
+        const double v2 = row.w2;
+
+        switch (dst->pixelFormat()) {
+
+          case IMAGE_RGB: {
+            auto srcRow1 = (RgbTraits::const_address_t)src->getPixelAddress(0, row.i1);
+            auto srcRow2 = (RgbTraits::const_address_t)src->getPixelAddress(0, row.i2);
+            auto dstRow = (RgbTraits::address_t)dst->getPixelAddress(0, y);
+            for (int x=0; x<w; ++x) {
+              const BilinearCoord& col = cols[x];
+              dstRow[x] = bilinear_rgba(srcRow1[col.i1], srcRow1[col.i2],
+                                        srcRow2[col.i1], srcRow2[col.i2],
+                                        col.w1, col.w2, v1, v2);
+            }
+            break;
+          }
+
+          case IMAGE_GRAYSCALE: {
+            auto srcRow1 = (GrayscaleTraits::const_address_t)src->getPixelAddress(0, row.i1);
+            auto srcRow2 = (GrayscaleTraits::const_address_t)src->getPixelAddress(0, row.i2);
+            auto dstRow = (GrayscaleTraits::address_t)dst->getPixelAddress(0, y);
+            for (int x=0; x<w; ++x) {
+              const BilinearCoord& col = cols[x];
+              const color_t c0 = srcRow1[col.i1];
+              const color_t c1 = srcRow1[col.i2];
+              const color_t c2 = srcRow2[col.i1];
+              const color_t c3 = srcRow2[col.i2];
+              dstRow[x] = graya(
+                bilinear_channel(graya_getv(c0), graya_getv(c1),
+                                 graya_getv(c2), graya_getv(c3),
+                                 col.w1, col.w2, v1, v2),
+                bilinear_channel(graya_geta(c0), graya_geta(c1),
+                                 graya_geta(c2), graya_geta(c3),
+                                 col.w1, col.w2, v1, v2));
+            }
+            break;
+          }
+
+          case IMAGE_INDEXED: {
+            for (int x=0; x<w; ++x) {
+              const BilinearCoord& col = cols[x];
+              color_t color[4] = {
+                src->getPixel(col.i1, row.i1),
+                src->getPixel(col.i2, row.i1),
+                src->getPixel(col.i1, row.i2),
+                src->getPixel(col.i2, row.i2)
+              };
+
+              // Convert index to RGBA values
+              for (int i=0; i<4; ++i) {
+                if (color[i] == maskColor)
+                  color[i] = pal->getEntry(color[i]) & rgba_rgb_mask; // Set alpha = 0
+                else
+                  color[i] = pal->getEntry(color[i]);
+              }
+
+              const color_t c = bilinear_rgba(color[0], color[1],
+                                              color[2], color[3],
+                                              col.w1, col.w2, v1, v2);
+              dst->putPixel(x, y, rgbmap->mapColor(c));
+            }
+            break;
+          }
+        }
+      }
+    });
 }
 
+} // anonymous namespace
+
 void resize_image(const Image* src,
                   Image* dst,
                   const ResizeMethod method,
@@ -49,9 +283,12 @@ void resize_image(const Image* src,
                   const RgbMap* rgbmap,
                   const color_t maskColor)
 {
+  // Make the private copy of shared pixels here, before the bands of
+  // rows access the destination pixels from several threads.
+  dst->detachBits();
+
   switch (method) {
 
-    // TODO optimize this
     case RESIZE_METHOD_NEAREST_NEIGHBOR: {
       ASSERT(src->pixelFormat() == dst->pixelFormat());
 
@@ -64,14 +301,7 @@ void resize_image(const Image* src,
       break;
     }
 
-    // TODO optimize this
     case RESIZE_METHOD_BILINEAR: {
-      uint32_t color[4], dst_color = 0;
-      double u, v, du, dv;
-      int u_floor, u_floor2;
-      int v_floor, v_floor2;
-      int x, y;
-
       // We cannot do interpolations between RGB values on indexed
       // images without a palette/rgbmap.
       if (dst->pixelFormat() == IMAGE_INDEXED &&
@@ -83,93 +313,8 @@ void resize_image(const Image* src,
         return;
       }
 
-      u = v = 0.0;
-      du = (src->width()-1) * 1.0 / (dst->width()-1);
-      dv = (src->height()-1) * 1.0 / (dst->height()-1);
-      for (y=0; y<dst->height(); ++y) {
-        for (x=0; x<dst->width(); ++x) {
-          u_floor = (int)std::floor(u);
-          v_floor = (int)std::floor(v);
-
-          if (u_floor > src->width()-1) {
-            u_floor = src->width()-1;
-            u_floor2 = src->width()-1;
-          }
-          else if (u_floor == src->width()-1)
-            u_floor2 = u_floor;
-          else
-            u_floor2 = u_floor+1;
-
-          if (v_floor > src->height()-1) {
-            v_floor = src->height()-1;
-            v_floor2 = src->height()-1;
-          }
-          else if (v_floor == src->height()-1)
-            v_floor2 = v_floor;
-          else
-            v_floor2 = v_floor+1;
-
-          // get the four colors
-          color[0] = src->getPixel(u_floor,  v_floor);
-          color[1] = src->getPixel(u_floor2, v_floor);
-          color[2] = src->getPixel(u_floor,  v_floor2);
-          color[3] = src->getPixel(u_floor2, v_floor2);
-
-          // calculate the interpolated color
-          double u1 = u - u_floor;
-          double v1 = v - v_floor;
-          double u2 = 1 - u1;
-          double v2 = 1 - v1;
-
-          switch (dst->pixelFormat()) {
-            case IMAGE_RGB: {
-              int r = int((rgba_getr(color[0])*u2 + rgba_getr(color[1])*u1)*v2 +
-                          (rgba_getr(color[2])*u2 + rgba_getr(color[3])*u1)*v1);
-              int g = int((rgba_getg(color[0])*u2 + rgba_getg(color[1])*u1)*v2 +
-                          (rgba_getg(color[2])*u2 + rgba_getg(color[3])*u1)*v1);
-              int b = int((rgba_getb(color[0])*u2 + rgba_getb(color[1])*u1)*v2 +
-                          (rgba_getb(color[2])*u2 + rgba_getb(color[3])*u1)*v1);
-              int a = int((rgba_geta(color[0])*u2 + rgba_geta(color[1])*u1)*v2 +
-                          (rgba_geta(color[2])*u2 + rgba_geta(color[3])*u1)*v1);
-              dst_color = rgba(r, g, b, a);
-              break;
-            }
-            case IMAGE_GRAYSCALE: {
-              int v = int((graya_getv(color[0])*u2 + graya_getv(color[1])*u1)*v2 +
-                          (graya_getv(color[2])*u2 + graya_getv(color[3])*u1)*v1);
-              int a = int((graya_geta(color[0])*u2 + graya_geta(color[1])*u1)*v2 +
-                          (graya_geta(color[2])*u2 + graya_geta(color[3])*u1)*v1);
-              dst_color = graya(v, a);
-              break;
-            }
-            case IMAGE_INDEXED: {
-              // Convert index to RGBA values
-              for (int i=0; i<4; ++i) {
-                if (color[i] == maskColor)
-                  color[i] = pal->getEntry(color[i]) & rgba_rgb_mask; // Set alpha = 0
-                else
-                  color[i] = pal->getEntry(color[i]);
-              }
-
-              int r = int((rgba_getr(color[0])*u2 + rgba_getr(color[1])*u1)*v2 +
-                          (rgba_getr(color[2])*u2 + rgba_getr(color[3])*u1)*v1);
-              int g = int((rgba_getg(color[0])*u2 + rgba_getg(color[1])*u1)*v2 +
-                          (rgba_getg(color[2])*u2 + rgba_getg(color[3])*u1)*v1);
-              int b = int((rgba_getb(color[0])*u2 + rgba_getb(color[1])*u1)*v2 +
-                          (rgba_getb(color[2])*u2 + rgba_getb(color[3])*u1)*v1);
-              int a = int((rgba_geta(color[0])*u2 + rgba_geta(color[1])*u1)*v2 +
-                          (rgba_geta(color[2])*u2 + rgba_geta(color[3])*u1)*v1);
-              dst_color = rgbmap->mapColor(r, g, b, a);
-              break;
-            }
-          }
-
-          dst->putPixel(x, y, dst_color);
-          u += du;
-        }
-        u = 0.0;
-        v += dv;
-      }
+      ASSERT(src->pixelFormat() == dst->pixelFormat());
+      resize_image_bilinear(src, dst, pal, rgbmap, maskColor);
       break;
     }
 
@@ -0,0 +1,78 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_ALGORITHM_REVERSE_PIXELS_H_INCLUDED
+#define DOC_ALGORITHM_REVERSE_PIXELS_H_INCLUDED
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define DOC_USE_SSE2_REVERSE_PIXELS 1
+#endif
+
+namespace doc {
+namespace algorithm {
+
+#if DOC_USE_SSE2_REVERSE_PIXELS
+  // Reverses the order of the 8/16/32-bit pixels in "v"
+  template<typename T>
+  inline __m128i reverse_pixels128(__m128i v) {
+    static_assert(sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4,
+                  "Unsupported pixel size");
+    if constexpr (sizeof(T) == 4)
+      return _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+
+    v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(0, 1, 2, 3));
+    v = _mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2));
+    if constexpr (sizeof(T) == 1)
+      v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    return v;
+  }
+#endif
+
+  // Reverses the pixels in [begin, end) (e.g. to flip a row
+  // horizontally). The SSE2 version swaps 16 bytes from each side at
+  // the same time.
+  template<typename T>
+  void reverse_pixels(T* begin, T* end) {
+#if DOC_USE_SSE2_REVERSE_PIXELS
+    constexpr int N = 16 / sizeof(T);
+    while (end - begin >= 2*N) {
+      const __m128i a = _mm_loadu_si128((const __m128i*)begin);
+      const __m128i b = _mm_loadu_si128((const __m128i*)(end-N));
+      _mm_storeu_si128((__m128i*)begin, reverse_pixels128<T>(b));
+      _mm_storeu_si128((__m128i*)(end-N), reverse_pixels128<T>(a));
+      begin += N;
+      end -= N;
+    }
+#endif
+    std::reverse(begin, end);
+  }
+
+  // Copies the pixels in [begin, end) to "dst" in reverse order (dst
+  // cannot overlap the source pixels).
+  template<typename T>
+  void reverse_copy_pixels(const T* begin, const T* end, T* dst) {
+#if DOC_USE_SSE2_REVERSE_PIXELS
+    constexpr int N = 16 / sizeof(T);
+    while (end - begin >= N) {
+      end -= N;
+      const __m128i a = _mm_loadu_si128((const __m128i*)end);
+      _mm_storeu_si128((__m128i*)dst, reverse_pixels128<T>(a));
+      dst += N;
+    }
+#endif
+    std::reverse_copy(begin, end, dst);
+  }
+
+} // namespace algorithm
+} // namespace doc
+
+#endif
@@ -28,7 +28,8 @@ using namespace fixmath;
 
 static void ase_parallelogram_map_standard(
   Image* bmp, const Image* sprite, const Image* mask,
-  fixed xs[4], fixed ys[4]);
+  fixed xs[4], fixed ys[4],
+  const std::vector<int>* rows = nullptr);
 
 static void ase_rotate_scale_flip_coordinates(
   fixed w, fixed h,
@@ -188,6 +189,25 @@ void parallelogram(Image* bmp, const Image* sprite, const Image* mask,
   ase_parallelogram_map_standard(bmp, sprite, mask, xs, ys);
 }
 
+void parallelogram_rows(Image* bmp, const Image* sprite, const Image* mask,
+  int x1, int y1, int x2, int y2,
+  int x3, int y3, int x4, int y4,
+  const std::vector<int>& rows)
+{
+  fixed xs[4], ys[4];
+
+  xs[0] = itofix(x1);
+  ys[0] = itofix(y1);
+  xs[1] = itofix(x2);
+  ys[1] = itofix(y2);
+  xs[2] = itofix(x3);
+  ys[2] = itofix(y3);
+  xs[3] = itofix(x4);
+  ys[3] = itofix(y4);
+
+  ase_parallelogram_map_standard(bmp, sprite, mask, xs, ys, &rows);
+}
+
 // Scanline drawers.
 
 template<class Traits, class Delegate>
@@ -337,12 +357,16 @@ public:
  *  and last point in which the horizontal line passing through the centre is
  *  at least partly covered by the sprite. This is useful for doing
  *  anti-aliased blending.
+ *  If "rows" is specified, bmp contains only the rows of the
+ *  destination that are mapped to a row index >= 0 (see
+ *  parallelogram_rows()).
  */
 template<class Traits, class Delegate>
 static void ase_parallelogram_map(
   Image* bmp, const Image* spr, const Image* mask,
   fixed xs[4], fixed ys[4],
-  int sub_pixel_accuracy, Delegate delegate)
+  int sub_pixel_accuracy, Delegate delegate,
+  const std::vector<int>* rows)
 {
   /* Index in xs[] and ys[] to topmost point. */
   int top_index;
@@ -465,8 +489,9 @@ static void ase_parallelogram_map(
   else
     clip_bottom_i = (bottom_bmp_y + 0x8000) >> 16;
 
-  if (clip_bottom_i > bmp->height())
-    clip_bottom_i = bmp->height();
+  const int bmp_h = (rows ? int(rows->size()): bmp->height());
+  if (clip_bottom_i > bmp_h)
+    clip_bottom_i = bmp_h;
 
   /* Calculate y coordinate of first scanline. */
   if (sub_pixel_accuracy)
@@ -623,6 +648,10 @@ static void ase_parallelogram_map(
     if (r_bmp_x_rounded > clip_right)
       r_bmp_x_rounded = clip_right;
 
+    /* Skip rows that aren't in bmp. */
+    if (rows && (*rows)[bmp_y_i] < 0)
+      goto skip_draw;
+
     /* Draw! */
     if (l_bmp_x_rounded <= r_bmp_x_rounded) {
       if (!sub_pixel_accuracy) {
@@ -714,7 +743,7 @@ static void ase_parallelogram_map(
         }
       }
       draw_scanline<Traits, Delegate>(bmp, spr, mask,
-        l_bmp_x_rounded, bmp_y_i, r_bmp_x_rounded,
+        l_bmp_x_rounded, (rows ? (*rows)[bmp_y_i]: bmp_y_i), r_bmp_x_rounded,
         l_spr_x_rounded, l_spr_y_rounded,
         spr_dx, spr_dy, delegate);
 
@@ -746,31 +775,32 @@ static void ase_parallelogram_map(
  */
 static void ase_parallelogram_map_standard(
   Image* bmp, const Image* sprite, const Image* mask,
-  fixed xs[4], fixed ys[4])
+  fixed xs[4], fixed ys[4],
+  const std::vector<int>* rows)
 {
   switch (bmp->pixelFormat()) {
 
     case IMAGE_RGB: {
       RgbDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<RgbTraits, RgbDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map<RgbTraits, RgbDelegate>(bmp, sprite, mask, xs, ys, false, delegate, rows);
       break;
     }
 
     case IMAGE_GRAYSCALE: {
       GrayscaleDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<GrayscaleTraits, GrayscaleDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map<GrayscaleTraits, GrayscaleDelegate>(bmp, sprite, mask, xs, ys, false, delegate, rows);
       break;
     }
 
     case IMAGE_INDEXED: {
       IndexedDelegate delegate(sprite->maskColor());
-      ase_parallelogram_map<IndexedTraits, IndexedDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map<IndexedTraits, IndexedDelegate>(bmp, sprite, mask, xs, ys, false, delegate, rows);
       break;
     }
 
     case IMAGE_BITMAP: {
       BitmapDelegate delegate;
-      ase_parallelogram_map<BitmapTraits, BitmapDelegate>(bmp, sprite, mask, xs, ys, false, delegate);
+      ase_parallelogram_map<BitmapTraits, BitmapDelegate>(bmp, sprite, mask, xs, ys, false, delegate, rows);
       break;
     }
   }
@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,6 +9,8 @@
 #define DOC_ALGORITHM_ROTATE_H_INCLUDED
 #pragma once
 
+#include <vector>
+
 namespace doc {
   class Image;
 
@@ -25,6 +28,15 @@ namespace doc {
       int x1, int y1, int x2, int y2,
       int x3, int y3, int x4, int y4);
 
+    // Same as parallelogram() but "dst" contains only some rows of
+    // the destination area: the row "y" is drawn in the row "rows[y]"
+    // of "dst" (or it's skipped if rows[y] is -1), and rows.size() is
+    // the height of the whole destination area.
+    void parallelogram_rows(Image* dst, const Image* src, const Image* mask,
+      int x1, int y1, int x2, int y2,
+      int x3, int y3, int x4, int y4,
+      const std::vector<int>& rows);
+
   } // namespace algorithm
 } // namespace doc
 
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2023  Igara Studio S.A.
+// Copyright (c) 2020-2026  Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,128 +9,69 @@
 #include "config.h"
 #endif
 
+#include "doc/algorithm/rotsprite.h"
+
 #include "doc/algorithm/rotate.h"
 #include "doc/image_impl.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
+#include "doc/primitives_fast.h"
+#include "fixmath/fixmath.h"
 
 #include <algorithm>
 #include <memory>
+#include <vector>
 
 namespace doc {
 namespace algorithm {
 
+using namespace fixmath;
+
+namespace {
+
+// Minimum number of source pixels to upscale an image in bands of
+// rows processed in parallel.
+const int kParallelMinPixels = 128*128;
+const int kMinRowsPerBand = 8;
+const int kBandsPerThread = 4;
+
+// Writes a pixel without calling Image::detachBits() for each pixel
+// (it's called once before processing rows in parallel).
+template<typename ImageTraits>
+inline void put_pixel_detached(const Image* dst, int x, int y, color_t c)
+{
+  if constexpr (ImageTraits::pixel_format == IMAGE_BITMAP) {
+    uint8_t* p = dst->getPixelAddress(x, y);
+    if (c)
+      *p |= (1 << (x % 8));
+    else
+      *p &= ~(1 << (x % 8));
+  }
+  else {
+    *get_pixel_address_fast<ImageTraits>(dst, x, y) = c;
+  }
+}
+
 // More information about EPX/Scale2x:
 // http://en.wikipedia.org/wiki/Pixel_art_scaling_algorithms#EPX.2FScale2.C3.97.2FAdvMAME2.C3.97
 // http://scale2x.sourceforge.net/algorithm.html
 // http://scale2x.sourceforge.net/scale2xandepx.html
+//
+// Each source row "y" generates the destination rows 2*y and 2*y+1,
+// so bands of source rows can be processed in parallel.
 template<typename ImageTraits>
-static void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h)
+void image_scale2x_rows(const Image* dst, const Image* src,
+                        const int src_w, const int src_h,
+                        const int y1, const int y2)
 {
-#if 0      // TODO complete this implementation that should be faster
-           // than using a lot of get/put_pixel_fast calls.
-  int dst_w = src_w*2;
-  int dst_h = src_h*2;
-
-  LockImageBits<ImageTraits> dstBits(dst, Image::WriteLock, gfx::Rect(0, 0, dst_w, dst_h));
-  const LockImageBits<ImageTraits> srcBits(src);
-
-  LockImageBits<ImageTraits>::iterator dstRow0_it = dstBits.begin();
-  LockImageBits<ImageTraits>::iterator dstRow1_it = dstBits.begin();
-  LockImageBits<ImageTraits>::iterator dstRow0_end = dstBits.end();
-  LockImageBits<ImageTraits>::iterator dstRow1_end = dstBits.end();
-
-  // Iterators:
-  //   A
-  // C P B
-  //   D
-  //
-  // These iterators are displaced through src image and are modified in this way:
-  //
-  // P: is the simplest one, we just start from (0, 0) to srcEnd.
-  // A: starts from row 0 (so A = P in the first row), then we start
-  //    again from the row 0.
-  // B: It starts from (1, row) and in the last pixel we don't moved it.
-  // C: It starts from (0, 0) and then it is moved with a delay.
-  // D: It starts from row 1 and continues until we reach the last
-  //    row, in that case we start D iterator again.
-  //
-  LockImageBits<ImageTraits>::const_iterator itP, itA, itB, itC, itD, savedD;
-  LockImageBits<ImageTraits>::const_iterator srcEnd = srcBits.end();
-  color_t P, A, B, C, D;
-
-  // Adjust iterators
-  itP = itA = itB = itC = itD = savedD = srcBits.begin();
-  dstRow1_it += dst_w;
-  itD += src->width();
-
-  for (int y=0; y<src_h; ++y) {
-    if (y == 1) itA = srcBits.begin();
-    if (y == src_h-2) savedD = itD;
-    if (y == src_h-1) itD = savedD;
-    ++itB;
-
-    for (int x=0; x<src_w; ++x) {
-      ASSERT(itP != srcEnd);
-      ASSERT(itA != srcEnd);
-      ASSERT(itB != srcEnd);
-      ASSERT(itC != srcEnd);
-      ASSERT(itD != srcEnd);
-      ASSERT(dstRow0_it != dstRow0_end);
-      ASSERT(dstRow1_it != dstRow1_end);
-
-      P = *itP;
-      A = *itA;                 // y-1
-      B = *itB;                 // x+1
-      C = *itC;                 // x-1
-      D = *itD;                 // y+1
-
-      *dstRow0_it = (C == A && C != D && A != B ? A: P);
-      ++dstRow0_it;
-      *dstRow0_it = (A == B && A != C && B != D ? B: P);
-      ++dstRow0_it;
-
-      *dstRow1_it = (D == C && D != B && C != A ? C: P);
-      ++dstRow1_it;
-      *dstRow1_it = (B == D && B != A && D != C ? D: P);
-      ++dstRow1_it;
-
-      ++itP;
-      ++itA;
-      if (x < src_w-2) ++itB;
-      if (x > 0) ++itC;
-      ++itD;
-    }
-
-    // Adjust iterators for the next two rows.
-    ++itB;
-    ++itC;
-    dstRow0_it += dst_w;
-    if (y < src_h-1)
-      dstRow1_it += dst_w;
-  }
-
-  // ASSERT(itP == srcEnd);
-  // ASSERT(itA == srcEnd);
-  // ASSERT(itB == srcEnd);
-  // ASSERT(itC == srcEnd);
-  // ASSERT(itD == srcEnd);
-  ASSERT(dstRow0_it == dstRow0_end);
-  ASSERT(dstRow1_it == dstRow1_end);
-#else
-
 #define A c[0]
 #define B c[1]
 #define C c[2]
 #define D c[3]
 #define P c[4]
 
-  LockImageBits<ImageTraits> dstBits(dst, gfx::Rect(0, 0, src_w*2, src_h*2));
-  auto dstIt = dstBits.begin();
-  auto dstIt2 = dstIt;
-
   color_t c[5];
-  for (int y=0; y<src_h; ++y) {
-    dstIt2 += src_w*2;
+  for (int y=y1; y<y2; ++y) {
     for (int x=0; x<src_w; ++x) {
       P = get_pixel_fast<ImageTraits>(src, x, y);
       A = (y > 0 ? get_pixel_fast<ImageTraits>(src, x, y-1): P);
@@ -138,24 +79,40 @@ static void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h
       C = (x > 0 ? get_pixel_fast<ImageTraits>(src, x-1, y): P);
       D = (y < src_h-1 ? get_pixel_fast<ImageTraits>(src, x, y+1): P);
 
-      *dstIt = (C == A && C != D && A != B ? A: P);
-      ++dstIt;
-      *dstIt = (A == B && A != C && B != D ? B: P);
-      ++dstIt;
-
-      *dstIt2 = (D == C && D != B && C != A ? C: P);
-      ++dstIt2;
-      *dstIt2 = (B == D && B != A && D != C ? D: P);
-      ++dstIt2;
+      put_pixel_detached<ImageTraits>(dst, 2*x,   2*y,   (C == A && C != D && A != B ? A: P));
+      put_pixel_detached<ImageTraits>(dst, 2*x+1, 2*y,   (A == B && A != C && B != D ? B: P));
+      put_pixel_detached<ImageTraits>(dst, 2*x,   2*y+1, (D == C && D != B && C != A ? C: P));
+      put_pixel_detached<ImageTraits>(dst, 2*x+1, 2*y+1, (B == D && B != A && D != C ? D: P));
     }
-    dstIt += src_w*2;
   }
 
-#endif
+#undef A
+#undef B
+#undef C
+#undef D
+#undef P
 }
 
-static void image_scale2x(Image* dst, const Image* src, int src_w, int src_h)
+template<typename ImageTraits>
+void image_scale2x_tpl(Image* dst, const Image* src, int src_w, int src_h)
 {
+  const int bands = parallel_bands(src_w, src_h,
+                                   kParallelMinPixels,
+                                   kMinRowsPerBand,
+                                   kBandsPerThread);
+  parallel_for_bands(
+    0, src_h, bands,
+    [dst, src, src_w, src_h](const int y1, const int y2){
+      image_scale2x_rows<ImageTraits>(dst, src, src_w, src_h, y1, y2);
+    });
+}
+
+void image_scale2x(Image* dst, const Image* src, int src_w, int src_h)
+{
+  // Make the private copy of shared pixels before the bands of rows
+  // write the destination from several threads.
+  dst->detachBits();
+
   switch (src->pixelFormat()) {
     case IMAGE_RGB:       image_scale2x_tpl<RgbTraits>(dst, src, src_w, src_h); break;
     case IMAGE_GRAYSCALE: image_scale2x_tpl<GrayscaleTraits>(dst, src, src_w, src_h); break;
@@ -164,16 +121,89 @@ static void image_scale2x(Image* dst, const Image* src, int src_w, int src_h)
   }
 }
 
-void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
-  int x1, int y1, int x2, int y2,
-  int x3, int y3, int x4, int y4)
+// Upscales the image 8x applying Scale2x three times
+Image* create_upscaled_image(const Image* spr)
+{
+  std::unique_ptr<Image> spr_copy(Image::createCopy(spr));
+  for (int i=0; i<3; ++i) {
+    std::unique_ptr<Image> tmp_copy(
+      Image::create(spr->pixelFormat(),
+                    spr->width()*(2<<i),
+                    spr->height()*(2<<i)));
+    image_scale2x(tmp_copy.get(), spr_copy.get(),
+                  spr_copy->width(), spr_copy->height());
+    spr_copy = std::move(tmp_copy);
+  }
+  ASSERT(spr_copy->width() == spr->width()*8);
+  return spr_copy.release();
+}
+
+Image* create_upscaled_mask(const Image* mask)
+{
+  const int scale = 8;
+  std::unique_ptr<Image> msk_copy(
+    Image::create(IMAGE_BITMAP, mask->width()*scale, mask->height()*scale));
+  clear_image(msk_copy.get(), 0);
+  scale_image(msk_copy.get(), mask,
+              0, 0, msk_copy->width(), msk_copy->height(),
+              0, 0, mask->width(), mask->height());
+  return msk_copy.release();
+}
+
+} // anonymous namespace
+
+bool RotSpriteCache::Item::isValidFor(const Image* src) const
+{
+  return (image &&
+          this->src == src &&
+          id == src->id() &&
+          version == src->version() &&
+          image->width() == src->width()*8 &&
+          image->height() == src->height()*8);
+}
+
+void RotSpriteCache::Item::reset(const Image* src, Image* image)
+{
+  this->src = src;
+  id = src->id();
+  version = src->version();
+  this->image.reset(image);
+}
+
+RotSpriteCache::RotSpriteCache()
+  : m_buffer(std::make_shared<ImageBuffer>(1))
+{
+}
+
+RotSpriteCache::~RotSpriteCache()
 {
-  static ImageBufferPtr buf[3]; // TODO non-thread safe
+}
 
-  for (int i=0; i<3; ++i)
-    if (!buf[i])
-      buf[i].reset(new ImageBuffer(1));
+void RotSpriteCache::invalidate()
+{
+  m_image = Item();
+  m_mask = Item();
+}
 
+Image* RotSpriteCache::upscaledImage(const Image* src)
+{
+  if (!m_image.isValidFor(src))
+    m_image.reset(src, create_upscaled_image(src));
+  return m_image.image.get();
+}
+
+const Image* RotSpriteCache::upscaledMask(const Image* mask)
+{
+  if (!m_mask.isValidFor(mask))
+    m_mask.reset(mask, create_upscaled_mask(mask));
+  return m_mask.image.get();
+}
+
+void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
+  int x1, int y1, int x2, int y2,
+  int x3, int y3, int x4, int y4,
+  RotSpriteCache* cache)
+{
   int xmin = std::min(x1, std::min(x2, std::min(x3, x4)));
   int xmax = std::max(x1, std::max(x2, std::max(x3, x4)));
   int ymin = std::min(y1, std::min(y2, std::min(y3, y4)));
@@ -184,47 +214,68 @@ void rotsprite_image(Image* bmp, const Image* spr, const Image* mask,
   if (rot_width == 0 || rot_height == 0)
     return;
 
-  int scale = 8;
-  std::unique_ptr<Image> bmp_copy(Image::create(bmp->pixelFormat(), rot_width*scale, rot_height*scale, buf[0]));
-  std::unique_ptr<Image> tmp_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[1]));
-  std::unique_ptr<Image> spr_copy(Image::create(spr->pixelFormat(), spr->width()*scale, spr->height()*scale, buf[2]));
-  std::unique_ptr<Image> msk_copy;
+  // Area of "bmp" where the rotated image is drawn
+  const int scale = 8;
+  const int dst_x = std::max(0, xmin);
+  const int dst_y = std::max(0, ymin);
+  const int dst_w = std::clamp(rot_width, 0, std::max(0, bmp->width() - dst_x));
+  const int dst_h = std::clamp(rot_height, 0, std::max(0, bmp->height() - dst_y));
+  if (dst_w == 0 || dst_h == 0)
+    return;
 
-  color_t maskColor = spr->maskColor();
+  // The source image and mask upscaled 8x
+  std::unique_ptr<Image> spr_tmp, msk_tmp;
+  Image* spr_copy;
+  const Image* msk_copy = nullptr;
+  if (cache) {
+    spr_copy = cache->upscaledImage(spr);
+    if (mask)
+      msk_copy = cache->upscaledMask(mask);
+  }
+  else {
+    spr_tmp.reset(create_upscaled_image(spr));
+    spr_copy = spr_tmp.get();
+    if (mask) {
+      msk_tmp.reset(create_upscaled_mask(mask));
+      msk_copy = msk_tmp.get();
+    }
+  }
 
-  bmp_copy->setMaskColor(maskColor);
-  tmp_copy->setMaskColor(maskColor);
+  const color_t maskColor = spr->maskColor();
   spr_copy->setMaskColor(maskColor);
 
-  spr_copy->clear(maskColor);
-  spr_copy->copy(spr, gfx::Clip(spr->bounds()));
-
-  for (int i=0; i<3; ++i) {
-    // clear_image(tmp_copy, maskColor);
-    image_scale2x(tmp_copy.get(), spr_copy.get(), spr->width()*(1<<i), spr->height()*(1<<i));
-    spr_copy->copy(tmp_copy.get(), gfx::Clip(tmp_copy->bounds()));
-  }
-
-  if (mask) {
-    // Same ImageBuffer than tmp_copy
-    msk_copy.reset(Image::create(IMAGE_BITMAP, mask->width()*scale, mask->height()*scale, buf[1]));
-    clear_image(msk_copy.get(), 0);
-    scale_image(msk_copy.get(), mask,
-                0, 0, msk_copy->width(), msk_copy->height(),
-                0, 0, mask->width(), mask->height());
+  // The rotated image would be drawn 8x and then downscaled with
+  // scale_image() (which picks one row of each 8 rows). Here we draw
+  // only the rows that scale_image() would pick, each one in the row
+  // of the destination where it's used, so the downscaling is only
+  // horizontal.
+  const int src_h = rot_height*scale;
+  std::vector<int> rows(src_h, -1);
+  {
+    fixed y = itofix(0);
+    const fixed dy = fixdiv(itofix(src_h-1), itofix(dst_h-1));
+    for (int v=0; v<dst_h; ++v) {
+      const int row = fixtoi(y);
+      if (row >= 0 && row < src_h)
+        rows[row] = v;
+      y = fixadd(y, dy);
+    }
   }
 
+  std::unique_ptr<Image> bmp_copy(
+    Image::create(bmp->pixelFormat(), rot_width*scale, dst_h,
+                  (cache ? cache->buffer(): ImageBufferPtr())));
+  bmp_copy->setMaskColor(maskColor);
   clear_image(bmp_copy.get(), maskColor);
-  parallelogram(
-    bmp_copy.get(), spr_copy.get(), msk_copy.get(),
+
+  parallelogram_rows(
+    bmp_copy.get(), spr_copy, msk_copy,
     (x1-xmin)*scale, (y1-ymin)*scale, (x2-xmin)*scale, (y2-ymin)*scale,
-    (x3-xmin)*scale, (y3-ymin)*scale, (x4-xmin)*scale, (y4-ymin)*scale);
+    (x3-xmin)*scale, (y3-ymin)*scale, (x4-xmin)*scale, (y4-ymin)*scale,
+    rows);
 
   scale_image(bmp, bmp_copy.get(),
-              std::max(0, xmin),
-              std::max(0, ymin),
-              std::clamp(rot_width, 0, std::max(0, bmp->width() - std::max(0, xmin))),
-              std::clamp(rot_height, 0, std::max(0, bmp->height() - std::max(0, ymin))),
+              dst_x, dst_y, dst_w, dst_h,
               0, 0, bmp_copy->width(), bmp_copy->height());
 }
 
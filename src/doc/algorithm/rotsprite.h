@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,14 +9,56 @@
 #define DOC_ALGORITHM_ROTSPRITE_H_INCLUDED
 #pragma once
 
+#include "doc/image_buffer.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+
+#include <memory>
+
 namespace doc {
   class Image;
 
   namespace algorithm {
 
+    // Keeps the source image and mask upscaled 8x (Scale2x applied
+    // three times) between calls to rotsprite_image() with the same
+    // source, e.g. on each mouse movement while the user rotates the
+    // selection. The cached images are recreated when the source
+    // image ID/version/size changes, call invalidate() when the
+    // source pixels are modified in place (without a new version).
+    class RotSpriteCache {
+    public:
+      RotSpriteCache();
+      ~RotSpriteCache();
+
+      void invalidate();
+
+      Image* upscaledImage(const Image* src);
+      const Image* upscaledMask(const Image* mask);
+
+      // Buffer to reuse the memory of the rotated image
+      const ImageBufferPtr& buffer() const { return m_buffer; }
+
+    private:
+      struct Item {
+        const Image* src = nullptr;
+        ObjectId id = NullId;
+        ObjectVersion version = 0;
+        std::unique_ptr<Image> image;
+
+        bool isValidFor(const Image* src) const;
+        void reset(const Image* src, Image* image);
+      };
+
+      Item m_image;
+      Item m_mask;
+      ImageBufferPtr m_buffer;
+    };
+
     void rotsprite_image(Image* dst, const Image* src, const Image* mask,
       int x1, int y1, int x2, int y2,
-      int x3, int y3, int x4, int y4);
+      int x3, int y3, int x4, int y4,
+      RotSpriteCache* cache = nullptr);
 
   } // namespace algorithm
 } // namespace doc
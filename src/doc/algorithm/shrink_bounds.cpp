@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -17,11 +17,20 @@
 #include "doc/image_impl.h"
 #include "doc/layer.h"
 #include "doc/layer_tilemap.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/primitives_fast.h"
 #include "doc/tileset.h"
+#include "gfx/region.h"
 
-#include <thread>
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define DOC_USE_SSE2_SHRINK 1
+#endif
 
 namespace doc {
 namespace algorithm {
@@ -134,37 +143,203 @@ bool shrink_bounds_templ(const Image* image, gfx::Rect& bounds, color_t refpixel
 {
   // Pixels per row
   const int rowPixels = image->rowPixels();
-  const int canvasSize = image->width()*image->height();
-  if ((std::thread::hardware_concurrency() >= 4) &&
-      ((image->pixelFormat() == IMAGE_RGB && canvasSize >= 800*800) ||
-       (image->pixelFormat() != IMAGE_RGB && canvasSize >= 500*500))) {
-    gfx::Rect
-      leftBounds(bounds), rightBounds(bounds),
-      topBounds(bounds), bottomBounds(bounds);
-
-    // TODO use a base::thread_pool and a base::task for each border
-
-    std::thread left  ([&]{ shrink_bounds_left_templ  <ImageTraits>(image, leftBounds, refpixel, rowPixels); });
-    std::thread right ([&]{ shrink_bounds_right_templ <ImageTraits>(image, rightBounds, refpixel, rowPixels); });
-    std::thread top   ([&]{ shrink_bounds_top_templ   <ImageTraits>(image, topBounds, refpixel); });
-    std::thread bottom([&]{ shrink_bounds_bottom_templ<ImageTraits>(image, bottomBounds, refpixel); });
-    left.join();
-    right.join();
-    top.join();
-    bottom.join();
-    bounds = leftBounds;
-    bounds &= rightBounds;
-    bounds &= topBounds;
-    bounds &= bottomBounds;
-    return !bounds.isEmpty();
+  return
+    shrink_bounds_left_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
+    shrink_bounds_right_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
+    shrink_bounds_top_templ<ImageTraits>(image, bounds, refpixel) &&
+    shrink_bounds_bottom_templ<ImageTraits>(image, bounds, refpixel);
+}
+
+// Minimum number of pixels in the bounds to shrink them using the
+// thread pool
+const int kParallelMinPixels = 256*256;
+
+// Minimum number of rows processed by each task
+const int kMinRowsPerBlock = 16;
+
+// Each thread gets several blocks of rows, so threads that finish
+// their blocks (e.g. blocks with transparent rows only) can take the
+// remaining blocks from the pool queue.
+const int kBlocksPerThread = 4;
+
+#if DOC_USE_SSE2_SHRINK
+
+// Pixels are compared as (pixel & mask) == ref, where the mask only
+// includes the alpha channel when "refpixel" is transparent (so any
+// transparent pixel is the same as "refpixel" as in is_same_pixel()).
+template<typename ImageTraits>
+struct RefPixels {
+  __m128i mask;
+  __m128i ref;
+
+  explicit RefPixels(const color_t refpixel) {
+    if constexpr (std::is_same_v<ImageTraits, RgbTraits>) {
+      const color_t m = (rgba_geta(refpixel) == 0 ? rgba_a_mask: 0xffffffff);
+      mask = _mm_set1_epi32(int(m));
+      ref = _mm_set1_epi32(int(refpixel & m));
+    }
+    else if constexpr (std::is_same_v<ImageTraits, GrayscaleTraits>) {
+      const color_t m = (graya_geta(refpixel) == 0 ? graya_a_mask: 0xffff);
+      mask = _mm_set1_epi16(short(m));
+      ref = _mm_set1_epi16(short(refpixel & m));
+    }
+    else {
+      mask = _mm_set1_epi8(char(0xff));
+      ref = _mm_set1_epi8(char(refpixel));
+    }
   }
-  else {
-    return
-      shrink_bounds_left_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
-      shrink_bounds_right_templ<ImageTraits>(image, bounds, refpixel, rowPixels) &&
-      shrink_bounds_top_templ<ImageTraits>(image, bounds, refpixel) &&
-      shrink_bounds_bottom_templ<ImageTraits>(image, bounds, refpixel);
+
+  // Returns true if the 16 bytes in "p" are all "refpixel"
+  bool all(const void* p) const {
+    const __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)p), mask);
+    return (_mm_movemask_epi8(_mm_cmpeq_epi8(a, ref)) == 0xffff);
+  }
+};
+
+#endif
+
+// Returns the first pixel in row[x..x2) that is not "refpixel", or
+// x2 if all pixels are "refpixel".
+template<typename ImageTraits>
+int find_first_pixel(const typename ImageTraits::pixel_t* row,
+                     int x, const int x2,
+                     const color_t refpixel)
+{
+#if DOC_USE_SSE2_SHRINK
+  constexpr int N = 16 / sizeof(typename ImageTraits::pixel_t);
+  const RefPixels<ImageTraits> ref(refpixel);
+  while (x+N <= x2 && ref.all(row+x))
+    x += N;
+#endif
+  for (; x<x2; ++x) {
+    if (!is_same_pixel<ImageTraits>(row[x], refpixel))
+      return x;
+  }
+  return x2;
+}
+
+// Returns the last pixel in row[x..x2) that is not "refpixel", or
+// x-1 if all pixels are "refpixel".
+template<typename ImageTraits>
+int find_last_pixel(const typename ImageTraits::pixel_t* row,
+                    const int x, int x2,
+                    const color_t refpixel)
+{
+#if DOC_USE_SSE2_SHRINK
+  constexpr int N = 16 / sizeof(typename ImageTraits::pixel_t);
+  const RefPixels<ImageTraits> ref(refpixel);
+  while (x2-N >= x && ref.all(row+x2-N))
+    x2 -= N;
+#endif
+  for (; x2>x; --x2) {
+    if (!is_same_pixel<ImageTraits>(row[x2-1], refpixel))
+      return x2-1;
   }
+  return x-1;
+}
+
+// Bounds of the pixels that are not "refpixel" in a block of rows
+struct RowsBounds {
+  bool empty = true;
+  int x1, y1, x2, y2;
+};
+
+// Finds the bounds of the pixels that are not "refpixel" in the rows
+// [v1, v2) of "bounds". The first and last non-empty rows must be
+// scanned completely, but the rows between them only need to be
+// scanned outside the [x1, x2) range found so far.
+template<typename ImageTraits>
+void shrink_rows_templ(const Image* image,
+                       const gfx::Rect& bounds,
+                       const int v1, const int v2,
+                       const color_t refpixel,
+                       RowsBounds& r)
+{
+  const int u1 = bounds.x;
+  const int u2 = bounds.x2();
+  int v;
+
+  // First non-empty row
+  for (v=v1; v<v2; ++v) {
+    auto row = get_pixel_address_fast<ImageTraits>(image, 0, v);
+    const int u = find_first_pixel<ImageTraits>(row, u1, u2, refpixel);
+    if (u < u2) {
+      r.empty = false;
+      r.x1 = u;
+      r.x2 = find_last_pixel<ImageTraits>(row, u, u2, refpixel)+1;
+      r.y1 = v;
+      r.y2 = v+1;
+      break;
+    }
+  }
+  if (r.empty)
+    return;
+
+  // Last non-empty row
+  for (v=v2-1; v>r.y1; --v) {
+    auto row = get_pixel_address_fast<ImageTraits>(image, 0, v);
+    const int u = find_first_pixel<ImageTraits>(row, u1, u2, refpixel);
+    if (u < u2) {
+      r.x1 = std::min(r.x1, u);
+      r.x2 = std::max(r.x2, find_last_pixel<ImageTraits>(row, u, u2, refpixel)+1);
+      r.y2 = v+1;
+      break;
+    }
+  }
+
+  // Rows in the middle can only expand x1/x2
+  for (v=r.y1+1; v<r.y2-1 && (r.x1 > u1 || r.x2 < u2); ++v) {
+    auto row = get_pixel_address_fast<ImageTraits>(image, 0, v);
+    if (r.x1 > u1)
+      r.x1 = std::min(r.x1, find_first_pixel<ImageTraits>(row, u1, r.x1, refpixel));
+    if (r.x2 < u2)
+      r.x2 = std::max(r.x2, find_last_pixel<ImageTraits>(row, r.x2, u2, refpixel)+1);
+  }
+}
+
+// Shrinks the bounds processing blocks of rows, in parallel using a
+// thread pool for big images.
+template<typename ImageTraits>
+bool shrink_bounds_rows_templ(const Image* image, gfx::Rect& bounds, color_t refpixel)
+{
+  if (bounds.isEmpty())
+    return false;
+
+  const int blocks = parallel_bands(bounds.w, bounds.h,
+                                    kParallelMinPixels,
+                                    kMinRowsPerBlock,
+                                    kBlocksPerThread);
+
+  std::vector<RowsBounds> results(blocks);
+  parallel_for(
+    blocks,
+    [image, &bounds, blocks, refpixel, &results](const int i){
+      const int v1 = bounds.y + bounds.h*i/blocks;
+      const int v2 = bounds.y + bounds.h*(i+1)/blocks;
+      shrink_rows_templ<ImageTraits>(image, bounds, v1, v2,
+                                     refpixel, results[i]);
+    });
+
+  RowsBounds r;
+  for (const RowsBounds& b : results) {
+    if (b.empty)
+      continue;
+    if (r.empty) {
+      r = b;
+    }
+    else {
+      r.x1 = std::min(r.x1, b.x1);
+      r.x2 = std::max(r.x2, b.x2);
+      r.y2 = b.y2;
+    }
+  }
+
+  if (r.empty) {
+    bounds.w = bounds.h = 0;
+    return false;
+  }
+  bounds = gfx::Rect(r.x1, r.y1, r.x2-r.x1, r.y2-r.y1);
+  return true;
 }
 
 template<typename ImageTraits>
@@ -344,9 +519,9 @@ bool shrink_bounds(const Image* image,
 {
   bounds = (startBounds & image->bounds());
   switch (image->pixelFormat()) {
-    case IMAGE_RGB:       return shrink_bounds_templ<RgbTraits>(image, bounds, refpixel);
-    case IMAGE_GRAYSCALE: return shrink_bounds_templ<GrayscaleTraits>(image, bounds, refpixel);
-    case IMAGE_INDEXED:   return shrink_bounds_templ<IndexedTraits>(image, bounds, refpixel);
+    case IMAGE_RGB:       return shrink_bounds_rows_templ<RgbTraits>(image, bounds, refpixel);
+    case IMAGE_GRAYSCALE: return shrink_bounds_rows_templ<GrayscaleTraits>(image, bounds, refpixel);
+    case IMAGE_INDEXED:   return shrink_bounds_rows_templ<IndexedTraits>(image, bounds, refpixel);
     case IMAGE_BITMAP:    return shrink_bounds_templ<BitmapTraits>(image, bounds, refpixel);
     case IMAGE_TILEMAP:   return shrink_bounds_tilemap(image, refpixel, layer, bounds);
   }
@@ -408,5 +583,41 @@ bool shrink_bounds2(const Image* a,
   return false;
 }
 
+bool shrink_region2(const Image* a,
+                    const Image* b,
+                    const gfx::Rect& startBounds,
+                    const int tileSize,
+                    gfx::Region& region)
+{
+  ASSERT(tileSize > 0);
+
+  region.clear();
+
+  gfx::Rect bounds;
+  if (!shrink_bounds2(a, b, startBounds, bounds))
+    return false;
+
+  // It's not worth it to split small areas
+  if (bounds.w <= 2*tileSize && bounds.h <= 2*tileSize) {
+    region = gfx::Region(bounds);
+    return true;
+  }
+
+  // Tiles aligned to the image origin
+  const int x1 = bounds.x - (bounds.x % tileSize);
+  const int y1 = bounds.y - (bounds.y % tileSize);
+  for (int y=y1; y<bounds.y2(); y+=tileSize) {
+    for (int x=x1; x<bounds.x2(); x+=tileSize) {
+      gfx::Rect tileBounds;
+      if (shrink_bounds2(a, b,
+                         gfx::Rect(x, y, tileSize, tileSize) & bounds,
+                         tileBounds)) {
+        region |= gfx::Region(tileBounds);
+      }
+    }
+  }
+  return !region.isEmpty();
+}
+
 } // namespace algorithm
 } // namespace doc
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -41,6 +41,17 @@ namespace doc {
                         const gfx::Rect& startBounds,
                         gfx::Rect& bounds);
 
+    // Like shrink_bounds2() but returns the modified area as a region
+    // of tiles (of tileSize x tileSize pixels, each one shrunk to its
+    // different pixels), so two small modifications far from each
+    // other don't generate a big rectangle (e.g. to save the undo
+    // information of a filter).
+    bool shrink_region2(const Image* a,
+                        const Image* b,
+                        const gfx::Rect& startBounds,
+                        const int tileSize,
+                        gfx::Region& region);
+
   } // algorithm
 } // doc
 
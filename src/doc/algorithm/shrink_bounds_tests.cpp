@@ -0,0 +1,133 @@
+// Aseprite Document Library
+// Copyright (c) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/algorithm/shrink_bounds.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/primitives.h"
+#include "gfx/region.h"
+
+#include <random>
+
+using namespace doc;
+using namespace gfx;
+
+namespace {
+
+color_t test_color(const PixelFormat pf)
+{
+  switch (pf) {
+    case IMAGE_RGB:       return rgba(255, 0, 0, 255);
+    case IMAGE_GRAYSCALE: return graya(128, 255);
+    default:              return 1;
+  }
+}
+
+// Bounds of the pixels that are not "refpixel" checking pixel by pixel
+Rect expected_bounds(const Image* image, const color_t refpixel)
+{
+  Rect bounds;
+  for (int v=0; v<image->height(); ++v)
+    for (int u=0; u<image->width(); ++u)
+      if (get_pixel(image, u, v) != refpixel)
+        bounds |= Rect(u, v, 1, 1);
+  return bounds;
+}
+
+} // anonymous namespace
+
+TEST(ShrinkBounds, EmptyImage)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    for (int size : { 3, 40, 600 }) {
+      ImageRef a(Image::create(pf, size, size));
+      clear_image(a.get(), 0);
+      Rect bounds;
+      EXPECT_FALSE(algorithm::shrink_bounds(a.get(), 0, nullptr, bounds));
+      EXPECT_TRUE(bounds.isEmpty());
+    }
+  }
+}
+
+TEST(ShrinkBounds, RandomPixels)
+{
+  std::mt19937 gen(1);
+
+  // Big sizes are processed in parallel
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED }) {
+    for (auto size : { Size(1, 1), Size(17, 5), Size(33, 100),
+                       Size(300, 300), Size(1000, 700) }) {
+      std::uniform_int_distribution<int> distU(0, size.w-1);
+      std::uniform_int_distribution<int> distV(0, size.h-1);
+
+      for (int i=0; i<8; ++i) {
+        ImageRef a(Image::create(pf, size.w, size.h));
+        clear_image(a.get(), 0);
+        for (int j=0; j<=i; ++j)
+          put_pixel(a.get(), distU(gen), distV(gen), test_color(pf));
+
+        Rect bounds;
+        EXPECT_TRUE(algorithm::shrink_bounds(a.get(), 0, nullptr, bounds));
+        EXPECT_EQ(expected_bounds(a.get(), 0), bounds)
+          << "Pixel format=" << pf << " Size=" << size.w << "x" << size.h;
+      }
+    }
+  }
+}
+
+TEST(ShrinkBounds, TransparentPixelsWithColor)
+{
+  ImageRef a(Image::create(IMAGE_RGB, 512, 512));
+  clear_image(a.get(), 0);
+  put_pixel(a.get(), 10, 10, rgba(255, 255, 255, 0));
+  put_pixel(a.get(), 500, 500, rgba(255, 0, 0, 0));
+  put_pixel(a.get(), 100, 200, rgba(0, 255, 0, 1));
+  put_pixel(a.get(), 300, 400, rgba(0, 0, 255, 255));
+
+  Rect bounds;
+  EXPECT_TRUE(algorithm::shrink_bounds(a.get(), 0, nullptr, bounds));
+  EXPECT_EQ(Rect(100, 200, 201, 201), bounds);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
+
+TEST(ShrinkBounds, ShrinkRegion2)
+{
+  ImageRef a(Image::create(IMAGE_RGB, 256, 256));
+  clear_image(a.get(), rgba(0, 0, 0, 0));
+  ImageRef b(Image::createCopy(a.get()));
+
+  gfx::Region region;
+  EXPECT_FALSE(algorithm::shrink_region2(a.get(), b.get(), a->bounds(), 64, region));
+  EXPECT_TRUE(region.isEmpty());
+
+  // Two pixels in opposite corners generate two small rectangles
+  // instead of the whole image
+  put_pixel(b.get(), 1, 2, rgba(255, 0, 0, 255));
+  put_pixel(b.get(), 250, 251, rgba(255, 0, 0, 255));
+  EXPECT_TRUE(algorithm::shrink_region2(a.get(), b.get(), a->bounds(), 64, region));
+  EXPECT_EQ(2, region.size());
+  EXPECT_TRUE(region.contains(gfx::Point(1, 2)));
+  EXPECT_TRUE(region.contains(gfx::Point(250, 251)));
+  int area = 0;
+  for (const gfx::Rect& rc : region)
+    area += rc.w * rc.h;
+  EXPECT_EQ(2, area);
+
+  // Small areas are not split
+  put_pixel(b.get(), 250, 251, rgba(0, 0, 0, 0));
+  put_pixel(b.get(), 100, 100, rgba(255, 0, 0, 255));
+  EXPECT_TRUE(algorithm::shrink_region2(a.get(), b.get(), a->bounds(), 64, region));
+  EXPECT_EQ(1, region.size());
+  EXPECT_EQ(gfx::Rect(1, 2, 100, 99), region.bounds());
+}
@@ -9,9 +9,13 @@
 #endif
 
 #include "doc/blend_funcs.h"
+#include "doc/blend_span.h"
 
 #include <benchmark/benchmark.h>
 
+#include <cstdlib>
+#include <vector>
+
 using namespace doc;
 
 static void CustomArguments(benchmark::internal::Benchmark* b) {
@@ -53,4 +57,72 @@ BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_saturation)->Apply(CustomArguments)
 BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_color)->Apply(CustomArguments);
 BENCHMARK_TEMPLATE(BM_Rgba, rgba_blender_hsl_luminosity)->Apply(CustomArguments);
 
+// Scalar vs span blenders: blend a scanline of N pixels with random
+// colors using the BlendFunc per pixel and the BlendSpanFunc.
+
+static void make_scanlines(const int n,
+                           std::vector<color_t>& dst,
+                           std::vector<color_t>& src)
+{
+  std::srand(n);
+  dst.resize(n);
+  src.resize(n);
+  for (int i=0; i<n; ++i) {
+    dst[i] = rgba(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256);
+    src[i] = rgba(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256);
+  }
+}
+
+template<BlendMode M>
+void BM_RgbaScanline(benchmark::State& state) {
+  const int n = state.range(0);
+  const int opacity = state.range(1);
+  std::vector<color_t> dst, src;
+  make_scanlines(n, dst, src);
+  BlendFunc func = get_rgba_blender(M, true);
+  while (state.KeepRunning()) {
+    for (int i=0; i<n; ++i)
+      dst[i] = func(dst[i], src[i], opacity);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+template<BlendMode M>
+void BM_RgbaSpan(benchmark::State& state) {
+  const int n = state.range(0);
+  const int opacity = state.range(1);
+  std::vector<color_t> dst, src;
+  make_scanlines(n, dst, src);
+  BlendSpanFunc func = get_rgba_span_blender(M, true);
+  while (state.KeepRunning()) {
+    func(dst.data(), src.data(), n, opacity);
+    benchmark::DoNotOptimize(dst.data());
+  }
+  state.SetItemsProcessed(state.iterations() * n);
+}
+
+static void ScanlineArguments(benchmark::internal::Benchmark* b) {
+  b ->Args({ 1024, 255 })
+    ->Args({ 1024, 128 });
+}
+
+#define BENCHMARK_SCANLINE(mode)                                        \
+  BENCHMARK_TEMPLATE(BM_RgbaScanline, BlendMode::mode)->Apply(ScanlineArguments); \
+  BENCHMARK_TEMPLATE(BM_RgbaSpan, BlendMode::mode)->Apply(ScanlineArguments);
+
+BENCHMARK_SCANLINE(NORMAL)
+BENCHMARK_SCANLINE(MERGE)
+BENCHMARK_SCANLINE(MULTIPLY)
+BENCHMARK_SCANLINE(SCREEN)
+BENCHMARK_SCANLINE(OVERLAY)
+BENCHMARK_SCANLINE(DARKEN)
+BENCHMARK_SCANLINE(LIGHTEN)
+BENCHMARK_SCANLINE(HARD_LIGHT)
+BENCHMARK_SCANLINE(DIFFERENCE)
+BENCHMARK_SCANLINE(EXCLUSION)
+BENCHMARK_SCANLINE(ADDITION)
+BENCHMARK_SCANLINE(SUBTRACT)
+BENCHMARK_SCANLINE(SOFT_LIGHT)
+
 BENCHMARK_MAIN();
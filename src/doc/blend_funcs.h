@@ -64,6 +64,26 @@ namespace doc {
 
   color_t indexed_blender_src(color_t dst, color_t src, int opacity);
 
+  // New blending method versions
+  color_t rgba_blender_multiply_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_screen_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_overlay_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_darken_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_lighten_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_color_dodge_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_color_burn_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_hard_light_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_soft_light_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_difference_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_exclusion_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_hsl_color_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_hsl_hue_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_hsl_saturation_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_hsl_luminosity_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_addition_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_subtract_n(color_t backdrop, color_t src, int opacity);
+  color_t rgba_blender_divide_n(color_t backdrop, color_t src, int opacity);
+
   BlendFunc get_rgba_blender(BlendMode blendmode, const bool newBlend);
   BlendFunc get_graya_blender(BlendMode blendmode, const bool newBlend);
   BlendFunc get_indexed_blender(BlendMode blendmode, const bool newBlend);
@@ -0,0 +1,488 @@
+// Aseprite Document Library
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/blend_span.h"
+
+#include "base/debug.h"
+#include "doc/blend_funcs.h"
+
+#include <algorithm>
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #include <arm_neon.h>
+  #define DOC_BLEND_SPAN_NEON 1
+#elif defined(__x86_64__) || defined(_WIN64)
+  #include <emmintrin.h>
+  #define DOC_BLEND_SPAN_SSE2 1
+#endif
+
+#if DOC_BLEND_SPAN_SSE2 || DOC_BLEND_SPAN_NEON
+  #define DOC_BLEND_SPAN_SIMD 1
+#endif
+
+namespace doc {
+
+namespace {
+
+#if DOC_BLEND_SPAN_SIMD
+
+//////////////////////////////////////////////////////////////////////
+// Operations over 4 lanes of signed 32-bit integers (one lane per
+// pixel or per pixel component)
+
+#if DOC_BLEND_SPAN_SSE2
+
+using vi = __m128i;
+
+inline vi v_load(const color_t* p) { return _mm_loadu_si128((const __m128i*)p); }
+inline void v_store(color_t* p, const vi a) { _mm_storeu_si128((__m128i*)p, a); }
+inline vi v_set1(const uint32_t v) { return _mm_set1_epi32(int(v)); }
+inline vi v_and(const vi a, const vi b) { return _mm_and_si128(a, b); }
+inline vi v_or(const vi a, const vi b) { return _mm_or_si128(a, b); }
+inline vi v_add(const vi a, const vi b) { return _mm_add_epi32(a, b); }
+inline vi v_sub(const vi a, const vi b) { return _mm_sub_epi32(a, b); }
+inline vi v_eq(const vi a, const vi b) { return _mm_cmpeq_epi32(a, b); }
+inline vi v_lt(const vi a, const vi b) { return _mm_cmplt_epi32(a, b); }
+
+// Returns "a" in the lanes where "mask" is set, and "b" in the others
+inline vi v_select(const vi mask, const vi a, const vi b) {
+  return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+template<int n> inline vi v_shr(const vi a) { return _mm_srli_epi32(a, n); }
+template<int n> inline vi v_sra(const vi a) { return _mm_srai_epi32(a, n); }
+template<int n> inline vi v_shl(const vi a) { return _mm_slli_epi32(a, n); }
+
+// Min/max for values in the [-32768,32767] range (SSE2 doesn't have
+// 32-bit min/max, but the 16-bit versions give the same result for
+// sign-extended 16-bit values).
+inline vi v_min(const vi a, const vi b) { return _mm_min_epi16(a, b); }
+inline vi v_max(const vi a, const vi b) { return _mm_max_epi16(a, b); }
+
+// a*b where "a" is in the [-32768,32767] range and "b" in [0,32767]
+inline vi v_mul(const vi a, const vi b) {
+  return _mm_madd_epi16(_mm_and_si128(a, _mm_set1_epi32(0xffff)), b);
+}
+
+// trunc(a/b) (same as the integer division in C++) for |a| < 2^24
+// and b in [1,255]. The float division is correctly rounded, and the
+// distance between a non-integer quotient and the next integer is at
+// least 1/255, so the truncation always gives the integer quotient.
+inline vi v_div(const vi a, const vi b) {
+  return _mm_cvttps_epi32(_mm_div_ps(_mm_cvtepi32_ps(a), _mm_cvtepi32_ps(b)));
+}
+
+// Loads/stores 4 grayscale pixels (one pixel per lane)
+inline vi v_load16(const uint16_t* p) {
+  return _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)p), _mm_setzero_si128());
+}
+inline void v_store16(uint16_t* p, const vi a) {
+  // Sign-extend the 16-bit values so the saturation doesn't modify them
+  _mm_storel_epi64((__m128i*)p,
+                   _mm_packs_epi32(_mm_srai_epi32(_mm_slli_epi32(a, 16), 16),
+                                   _mm_setzero_si128()));
+}
+
+#elif DOC_BLEND_SPAN_NEON
+
+using vi = int32x4_t;
+
+inline vi v_load(const color_t* p) { return vreinterpretq_s32_u32(vld1q_u32(p)); }
+inline void v_store(color_t* p, const vi a) { vst1q_u32(p, vreinterpretq_u32_s32(a)); }
+inline vi v_set1(const uint32_t v) { return vdupq_n_s32(int(v)); }
+inline vi v_and(const vi a, const vi b) { return vandq_s32(a, b); }
+inline vi v_or(const vi a, const vi b) { return vorrq_s32(a, b); }
+inline vi v_add(const vi a, const vi b) { return vaddq_s32(a, b); }
+inline vi v_sub(const vi a, const vi b) { return vsubq_s32(a, b); }
+inline vi v_eq(const vi a, const vi b) { return vreinterpretq_s32_u32(vceqq_s32(a, b)); }
+inline vi v_lt(const vi a, const vi b) { return vreinterpretq_s32_u32(vcltq_s32(a, b)); }
+
+inline vi v_select(const vi mask, const vi a, const vi b) {
+  return vbslq_s32(vreinterpretq_u32_s32(mask), a, b);
+}
+
+template<int n> inline vi v_shr(const vi a) {
+  if constexpr (n == 0)
+    return a;
+  else
+    return vreinterpretq_s32_u32(vshrq_n_u32(vreinterpretq_u32_s32(a), n));
+}
+template<int n> inline vi v_sra(const vi a) { return vshrq_n_s32(a, n); }
+template<int n> inline vi v_shl(const vi a) { return vshlq_n_s32(a, n); }
+
+inline vi v_min(const vi a, const vi b) { return vminq_s32(a, b); }
+inline vi v_max(const vi a, const vi b) { return vmaxq_s32(a, b); }
+inline vi v_mul(const vi a, const vi b) { return vmulq_s32(a, b); }
+
+// Same as the SSE2 version (vcvtq_s32_f32() truncates too)
+inline vi v_div(const vi a, const vi b) {
+  return vcvtq_s32_f32(vdivq_f32(vcvtq_f32_s32(a), vcvtq_f32_s32(b)));
+}
+
+inline vi v_load16(const uint16_t* p) { return vreinterpretq_s32_u32(vmovl_u16(vld1_u16(p))); }
+inline void v_store16(uint16_t* p, const vi a) { vst1_u16(p, vmovn_u32(vreinterpretq_u32_s32(a))); }
+
+#endif
+
+// Same as MUL_UN8(a, b, t) for "a" in [-255,255] and "b" in [0,255]
+inline vi v_mul_un8(const vi a, const vi b) {
+  const vi t = v_add(v_mul(a, b), v_set1(0x80));
+  return v_sra<8>(v_add(v_sra<8>(t), t));
+}
+
+template<int shift>
+inline vi v_channel(const vi c) {
+  return v_and(v_shr<shift>(c), v_set1(0xff));
+}
+
+inline vi v_alpha(const vi c) {
+  return v_shr<rgba_a_shift>(c);
+}
+
+inline vi v_rgb(const vi r, const vi g, const vi b) {
+  return v_or(v_shl<rgba_r_shift>(r),
+              v_or(v_shl<rgba_g_shift>(g),
+                   v_shl<rgba_b_shift>(b)));
+}
+
+//////////////////////////////////////////////////////////////////////
+// Vectorized versions of the RGBA blenders (4 pixels at a time)
+
+template<int shift>
+inline vi v_normal_channel(const vi b, const vi s, const vi Sa, const vi Ra) {
+  const vi Bc = v_channel<shift>(b);
+  const vi Sc = v_channel<shift>(s);
+  return v_shl<shift>(v_add(Bc, v_div(v_mul(v_sub(Sc, Bc), Sa), Ra)));
+}
+
+// rgba_blender_normal()
+inline vi v_blend_normal(const vi b, const vi s, const vi opacity) {
+  const vi zero = v_set1(0);
+  const vi Ba = v_alpha(b);
+  const vi srcA = v_alpha(s);
+  const vi Sa = v_mul_un8(srcA, opacity);
+  const vi Ra = v_sub(v_add(Sa, Ba), v_mul_un8(Ba, Sa));
+
+  // Lanes with Ra=0 are discarded below, here we just avoid the
+  // division by zero.
+  const vi den = v_sub(Ra, v_eq(Ra, zero));
+
+  vi r = v_or(v_shl<rgba_a_shift>(Ra),
+              v_or(v_normal_channel<rgba_r_shift>(b, s, Sa, den),
+                   v_or(v_normal_channel<rgba_g_shift>(b, s, Sa, den),
+                        v_normal_channel<rgba_b_shift>(b, s, Sa, den))));
+
+  r = v_select(v_eq(srcA, zero), b, r);
+  r = v_select(v_eq(Ba, zero),
+               v_or(v_and(s, v_set1(rgba_rgb_mask)),
+                    v_shl<rgba_a_shift>(Sa)),
+               r);
+  return r;
+}
+
+template<int shift>
+inline vi v_merge_channel(const vi b, const vi s, const vi opacity) {
+  const vi Bc = v_channel<shift>(b);
+  const vi Sc = v_channel<shift>(s);
+  return v_shl<shift>(v_add(Bc, v_mul_un8(v_sub(Sc, Bc), opacity)));
+}
+
+// rgba_blender_merge() (the opacity can be different for each lane)
+inline vi v_blend_merge(const vi b, const vi s, const vi opacity) {
+  const vi zero = v_set1(0);
+  const vi rgbMask = v_set1(rgba_rgb_mask);
+  const vi Ba = v_alpha(b);
+  const vi Sa = v_alpha(s);
+  const vi Ra = v_add(Ba, v_mul_un8(v_sub(Sa, Ba), opacity));
+
+  vi rgb = v_or(v_merge_channel<rgba_r_shift>(b, s, opacity),
+                v_or(v_merge_channel<rgba_g_shift>(b, s, opacity),
+                     v_merge_channel<rgba_b_shift>(b, s, opacity)));
+  rgb = v_select(v_eq(Sa, zero), v_and(b, rgbMask), rgb);
+  rgb = v_select(v_eq(Ba, zero), v_and(s, rgbMask), rgb);
+  rgb = v_select(v_eq(Ra, zero), zero, rgb);
+  return v_or(rgb, v_shl<rgba_a_shift>(Ra));
+}
+
+// Grayscale pixels are blended as RGBA pixels with the gray value in
+// the red channel and green/blue channels = 0 (the graya_blender_*
+// functions use the same formulas of the rgba_blender_* functions)
+inline vi v_gray_to_rgba(const vi c) {
+  return v_or(v_and(c, v_set1(graya_v_mask)),
+              v_shl<rgba_a_shift - graya_a_shift>(v_and(c, v_set1(graya_a_mask))));
+}
+
+inline vi v_rgba_to_gray(const vi c) {
+  return v_or(v_and(c, v_set1(graya_v_mask)),
+              v_and(v_shr<rgba_a_shift - graya_a_shift>(c), v_set1(graya_a_mask)));
+}
+
+// Per-component operations of the separable blend modes (the same
+// macros/functions used at the beginning of blend_funcs.cpp), "b" and
+// "s" are in the [0,255] range.
+struct MultiplyOp {
+  static vi apply(const vi b, const vi s) { return v_mul_un8(b, s); }
+};
+
+struct ScreenOp {
+  static vi apply(const vi b, const vi s) {
+    return v_sub(v_add(b, s), v_mul_un8(b, s));
+  }
+};
+
+struct HardLightOp {
+  static vi apply(const vi b, const vi s) {
+    const vi s2 = v_shl<1>(s);
+    return v_select(v_lt(s, v_set1(128)),
+                    MultiplyOp::apply(b, s2),
+                    ScreenOp::apply(b, v_sub(s2, v_set1(255))));
+  }
+};
+
+struct OverlayOp {
+  static vi apply(const vi b, const vi s) { return HardLightOp::apply(s, b); }
+};
+
+struct DarkenOp {
+  static vi apply(const vi b, const vi s) { return v_min(b, s); }
+};
+
+struct LightenOp {
+  static vi apply(const vi b, const vi s) { return v_max(b, s); }
+};
+
+struct DifferenceOp {
+  static vi apply(const vi b, const vi s) { return v_sub(v_max(b, s), v_min(b, s)); }
+};
+
+struct ExclusionOp {
+  static vi apply(const vi b, const vi s) {
+    const vi t = v_mul_un8(b, s);
+    return v_sub(v_add(b, s), v_shl<1>(t));
+  }
+};
+
+struct AdditionOp {
+  static vi apply(const vi b, const vi s) { return v_min(v_add(b, s), v_set1(255)); }
+};
+
+struct SubtractOp {
+  static vi apply(const vi b, const vi s) { return v_max(v_sub(b, s), v_set1(0)); }
+};
+
+// rgba_blender_multiply(), rgba_blender_screen(), etc.
+template<typename Op>
+inline vi v_blend_separable(const vi b, const vi s, const vi opacity) {
+  const vi c = v_or(
+    v_rgb(Op::apply(v_channel<rgba_r_shift>(b), v_channel<rgba_r_shift>(s)),
+          Op::apply(v_channel<rgba_g_shift>(b), v_channel<rgba_g_shift>(s)),
+          Op::apply(v_channel<rgba_b_shift>(b), v_channel<rgba_b_shift>(s))),
+    v_and(s, v_set1(rgba_a_mask)));
+  return v_blend_normal(b, c, opacity);
+}
+
+// rgba_blender_multiply_n(), rgba_blender_screen_n(), etc. (see the
+// RGBA_BLENDER_N() macro)
+template<typename Op>
+inline vi v_blend_separable_n(const vi b, const vi s, const vi opacity) {
+  const vi Ba = v_alpha(b);
+  const vi normal = v_blend_normal(b, s, opacity);
+  const vi blend = v_blend_separable<Op>(b, s, opacity);
+  const vi normalToBlendMerge = v_blend_merge(normal, blend, Ba);
+  const vi srcTotalAlpha = v_mul_un8(v_alpha(s), opacity);
+  const vi compositeAlpha = v_mul_un8(Ba, srcTotalAlpha);
+  return v_select(v_eq(Ba, v_set1(0)),
+                  normal,
+                  v_blend_merge(normalToBlendMerge, blend, compositeAlpha));
+}
+
+#endif // DOC_BLEND_SPAN_SIMD
+
+//////////////////////////////////////////////////////////////////////
+// Span functions
+
+template<BlendFunc F>
+void rgba_scalar_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  for (int x=0; x<n; ++x)
+    dst[x] = F(dst[x], src[x], opacity);
+}
+
+void rgba_src_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  std::copy(src, src+n, dst);
+}
+
+template<bool kMasked>
+void rgba_normal_span_templ(color_t* dst, const color_t* src, int n, int opacity,
+                            const color_t maskColor)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  const vi mask = v_set1(maskColor);
+  for (; x+4<=n; x+=4) {
+    const vi b = v_load(dst+x);
+    const vi s = v_load(src+x);
+    vi r = v_blend_normal(b, s, op);
+    if constexpr (kMasked)
+      r = v_select(v_eq(s, mask), b, r);
+    v_store(dst+x, r);
+  }
+#endif
+  for (; x<n; ++x) {
+    if (!kMasked || src[x] != maskColor)
+      dst[x] = rgba_blender_normal(dst[x], src[x], opacity);
+  }
+}
+
+void rgba_merge_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  for (; x+4<=n; x+=4)
+    v_store(dst+x, v_blend_merge(v_load(dst+x), v_load(src+x), op));
+#endif
+  for (; x<n; ++x)
+    dst[x] = rgba_blender_merge(dst[x], src[x], opacity);
+}
+
+template<typename Op, BlendFunc F>
+void rgba_separable_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  for (; x+4<=n; x+=4)
+    v_store(dst+x, v_blend_separable<Op>(v_load(dst+x), v_load(src+x), op));
+#endif
+  for (; x<n; ++x)
+    dst[x] = F(dst[x], src[x], opacity);
+}
+
+template<typename Op, BlendFunc F>
+void rgba_separable_n_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  for (; x+4<=n; x+=4)
+    v_store(dst+x, v_blend_separable_n<Op>(v_load(dst+x), v_load(src+x), op));
+#endif
+  for (; x<n; ++x)
+    dst[x] = F(dst[x], src[x], opacity);
+}
+
+#if DOC_BLEND_SPAN_SIMD
+  #define SEPARABLE_SPAN(op, name)                              \
+    rgba_separable_span<op, rgba_blender_##name>
+  #define SEPARABLE_N_SPAN(op, name)                            \
+    rgba_separable_n_span<op, rgba_blender_##name##_n>
+#else
+  #define SEPARABLE_SPAN(op, name)   rgba_scalar_span<rgba_blender_##name>
+  #define SEPARABLE_N_SPAN(op, name) rgba_scalar_span<rgba_blender_##name##_n>
+#endif
+
+#define SEPARABLE_SPANS(op, name)                                       \
+  (newBlend ? SEPARABLE_N_SPAN(op, name): SEPARABLE_SPAN(op, name))
+
+#define SCALAR_SPANS(name)                                              \
+  (newBlend ? rgba_scalar_span<rgba_blender_##name##_n>:                \
+              rgba_scalar_span<rgba_blender_##name>)
+
+template<BlendFunc F>
+void graya_scalar_span(uint16_t* dst, const uint16_t* src, int n, int opacity)
+{
+  for (int x=0; x<n; ++x)
+    dst[x] = uint16_t(F(dst[x], src[x], opacity));
+}
+
+} // anonymous namespace
+
+void rgba_blender_merge_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  rgba_merge_span(dst, src, n, opacity);
+}
+
+void graya_blender_normal_span(uint16_t* dst, const uint16_t* src, int n, int opacity)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  for (; x+4<=n; x+=4) {
+    const vi b = v_gray_to_rgba(v_load16(dst+x));
+    const vi s = v_gray_to_rgba(v_load16(src+x));
+    v_store16(dst+x, v_rgba_to_gray(v_blend_normal(b, s, op)));
+  }
+#endif
+  graya_scalar_span<graya_blender_normal>(dst+x, src+x, n-x, opacity);
+}
+
+void graya_blender_merge_span(uint16_t* dst, const uint16_t* src, int n, int opacity)
+{
+  int x = 0;
+#if DOC_BLEND_SPAN_SIMD
+  const vi op = v_set1(opacity);
+  for (; x+4<=n; x+=4) {
+    const vi b = v_gray_to_rgba(v_load16(dst+x));
+    const vi s = v_gray_to_rgba(v_load16(src+x));
+    v_store16(dst+x, v_rgba_to_gray(v_blend_merge(b, s, op)));
+  }
+#endif
+  graya_scalar_span<graya_blender_merge>(dst+x, src+x, n-x, opacity);
+}
+
+void rgba_blender_normal_span(color_t* dst, const color_t* src, int n, int opacity)
+{
+  rgba_normal_span_templ<false>(dst, src, n, opacity, 0);
+}
+
+void rgba_blender_normal_masked_span(color_t* dst, const color_t* src, int n, int opacity,
+                                     const color_t maskColor)
+{
+  rgba_normal_span_templ<true>(dst, src, n, opacity, maskColor);
+}
+
+BlendSpanFunc get_rgba_span_blender(BlendMode blendmode, const bool newBlend)
+{
+  switch (blendmode) {
+    case BlendMode::SRC:            return rgba_src_span;
+    case BlendMode::MERGE:          return rgba_merge_span;
+    case BlendMode::NEG_BW:         return rgba_scalar_span<rgba_blender_neg_bw>;
+    case BlendMode::RED_TINT:       return rgba_scalar_span<rgba_blender_red_tint>;
+    case BlendMode::BLUE_TINT:      return rgba_scalar_span<rgba_blender_blue_tint>;
+    case BlendMode::DST_OVER:       return rgba_scalar_span<rgba_blender_normal_dst_over>;
+
+    case BlendMode::NORMAL:         return rgba_blender_normal_span;
+    case BlendMode::MULTIPLY:       return SEPARABLE_SPANS(MultiplyOp, multiply);
+    case BlendMode::SCREEN:         return SEPARABLE_SPANS(ScreenOp, screen);
+    case BlendMode::OVERLAY:        return SEPARABLE_SPANS(OverlayOp, overlay);
+    case BlendMode::DARKEN:         return SEPARABLE_SPANS(DarkenOp, darken);
+    case BlendMode::LIGHTEN:        return SEPARABLE_SPANS(LightenOp, lighten);
+    case BlendMode::COLOR_DODGE:    return SCALAR_SPANS(color_dodge);
+    case BlendMode::COLOR_BURN:     return SCALAR_SPANS(color_burn);
+    case BlendMode::HARD_LIGHT:     return SEPARABLE_SPANS(HardLightOp, hard_light);
+    case BlendMode::SOFT_LIGHT:     return SCALAR_SPANS(soft_light);
+    case BlendMode::DIFFERENCE:     return SEPARABLE_SPANS(DifferenceOp, difference);
+    case BlendMode::EXCLUSION:      return SEPARABLE_SPANS(ExclusionOp, exclusion);
+    case BlendMode::HSL_HUE:        return SCALAR_SPANS(hsl_hue);
+    case BlendMode::HSL_SATURATION: return SCALAR_SPANS(hsl_saturation);
+    case BlendMode::HSL_COLOR:      return SCALAR_SPANS(hsl_color);
+    case BlendMode::HSL_LUMINOSITY: return SCALAR_SPANS(hsl_luminosity);
+    case BlendMode::ADDITION:       return SEPARABLE_SPANS(AdditionOp, addition);
+    case BlendMode::SUBTRACT:       return SEPARABLE_SPANS(SubtractOp, subtract);
+    case BlendMode::DIVIDE:         return SCALAR_SPANS(divide);
+  }
+  ASSERT(false);
+  return rgba_src_span;
+}
+
+} // namespace doc
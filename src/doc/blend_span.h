@@ -0,0 +1,44 @@
+// Aseprite Document Library
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_BLEND_SPAN_H_INCLUDED
+#define DOC_BLEND_SPAN_H_INCLUDED
+#pragma once
+
+#include "doc/blend_mode.h"
+#include "doc/color.h"
+
+#include <cstdint>
+
+namespace doc {
+
+  // Blends "n" RGBA pixels of "src" into "dst" (in-place). The result
+  // of each pixel is the same as using the BlendFunc of the same blend
+  // mode (dst[i] = blender(dst[i], src[i], opacity)), but some modes
+  // process several pixels at the same time (SSE2/NEON).
+  typedef void (*BlendSpanFunc)(color_t* dst, const color_t* src, int n, int opacity);
+
+  void rgba_blender_normal_span(color_t* dst, const color_t* src, int n, int opacity);
+
+  // Same as rgba_blender_normal_span() but the "src" pixels equal to
+  // "maskColor" leave the "dst" pixel untouched (this is how
+  // render::Render composites RGB images).
+  void rgba_blender_normal_masked_span(color_t* dst, const color_t* src, int n, int opacity,
+                                       const color_t maskColor);
+
+  void rgba_blender_merge_span(color_t* dst, const color_t* src, int n, int opacity);
+
+  BlendSpanFunc get_rgba_span_blender(BlendMode blendmode, const bool newBlend);
+
+  // Same as rgba_blender_normal_span() and rgba_blender_merge_span()
+  // but for grayscale pixels (the result is the same as using
+  // graya_blender_normal() and graya_blender_merge()).
+  void graya_blender_normal_span(uint16_t* dst, const uint16_t* src, int n, int opacity);
+  void graya_blender_merge_span(uint16_t* dst, const uint16_t* src, int n, int opacity);
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,146 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/blend_funcs.h"
+#include "doc/blend_span.h"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+// Random color with more chances of being fully transparent/opaque
+color_t random_color()
+{
+  color_t c = rgba(std::rand() % 256, std::rand() % 256, std::rand() % 256, std::rand() % 256);
+  switch (std::rand() % 4) {
+    case 0: c &= rgba_rgb_mask; break;
+    case 1: c |= rgba_a_mask; break;
+  }
+  return c;
+}
+
+const BlendMode kBlendModes[] = {
+  BlendMode::SRC,
+  BlendMode::MERGE,
+  BlendMode::NEG_BW,
+  BlendMode::RED_TINT,
+  BlendMode::BLUE_TINT,
+  BlendMode::DST_OVER,
+  BlendMode::NORMAL,
+  BlendMode::MULTIPLY,
+  BlendMode::SCREEN,
+  BlendMode::OVERLAY,
+  BlendMode::DARKEN,
+  BlendMode::LIGHTEN,
+  BlendMode::COLOR_DODGE,
+  BlendMode::COLOR_BURN,
+  BlendMode::HARD_LIGHT,
+  BlendMode::SOFT_LIGHT,
+  BlendMode::DIFFERENCE,
+  BlendMode::EXCLUSION,
+  BlendMode::HSL_HUE,
+  BlendMode::HSL_SATURATION,
+  BlendMode::HSL_COLOR,
+  BlendMode::HSL_LUMINOSITY,
+  BlendMode::ADDITION,
+  BlendMode::SUBTRACT,
+  BlendMode::DIVIDE,
+};
+
+} // anonymous namespace
+
+TEST(BlendSpan, SameResultAsBlendFuncs)
+{
+  const int n = 67;             // Not a multiple of 4 to test the tail
+  std::vector<color_t> dst(n), src(n), expected(n);
+
+  for (const BlendMode mode : kBlendModes) {
+    for (const bool newBlend : { false, true }) {
+      const BlendFunc blender = get_rgba_blender(mode, newBlend);
+      const BlendSpanFunc spanBlender = get_rgba_span_blender(mode, newBlend);
+
+      for (int i=0; i<100; ++i) {
+        const int opacity = (i == 0 ? 255: i == 1 ? 0: std::rand() % 256);
+        for (int x=0; x<n; ++x) {
+          dst[x] = random_color();
+          src[x] = random_color();
+          expected[x] = blender(dst[x], src[x], opacity);
+        }
+
+        spanBlender(dst.data(), src.data(), n, opacity);
+        for (int x=0; x<n; ++x) {
+          EXPECT_EQ(expected[x], dst[x])
+            << " mode=" << blend_mode_to_string(mode)
+            << " newBlend=" << newBlend
+            << " opacity=" << opacity << " x=" << x;
+        }
+      }
+    }
+  }
+}
+
+TEST(BlendSpan, NormalMasked)
+{
+  const int n = 33;
+  const color_t maskColor = 0;
+  std::vector<color_t> dst(n), src(n), expected(n);
+
+  for (int i=0; i<100; ++i) {
+    const int opacity = std::rand() % 256;
+    for (int x=0; x<n; ++x) {
+      dst[x] = random_color();
+      src[x] = ((std::rand() % 3) == 0 ? maskColor: random_color());
+      expected[x] = (src[x] == maskColor ? dst[x]:
+                                           rgba_blender_normal(dst[x], src[x], opacity));
+    }
+
+    rgba_blender_normal_masked_span(dst.data(), src.data(), n, opacity, maskColor);
+    for (int x=0; x<n; ++x)
+      EXPECT_EQ(expected[x], dst[x]) << " opacity=" << opacity << " x=" << x;
+  }
+}
+
+TEST(BlendSpan, Grayscale)
+{
+  const int n = 35;
+  std::vector<uint16_t> dst(n), src(n), expectedNormal(n), expectedMerge(n);
+
+  for (int i=0; i<100; ++i) {
+    const int opacity = (i == 0 ? 255: i == 1 ? 0: std::rand() % 256);
+    for (int x=0; x<n; ++x) {
+      const color_t a = random_color();
+      const color_t b = random_color();
+      dst[x] = graya(rgba_getr(a), rgba_geta(a));
+      src[x] = graya(rgba_getr(b), rgba_geta(b));
+      expectedNormal[x] = graya_blender_normal(dst[x], src[x], opacity);
+      expectedMerge[x] = graya_blender_merge(dst[x], src[x], opacity);
+    }
+
+    std::vector<uint16_t> normal = dst;
+    std::vector<uint16_t> merge = dst;
+    graya_blender_normal_span(normal.data(), src.data(), n, opacity);
+    graya_blender_merge_span(merge.data(), src.data(), n, opacity);
+    for (int x=0; x<n; ++x) {
+      EXPECT_EQ(expectedNormal[x], normal[x]) << " opacity=" << opacity << " x=" << x;
+      EXPECT_EQ(expectedMerge[x], merge[x]) << " opacity=" << opacity << " x=" << x;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
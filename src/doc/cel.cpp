@@ -42,7 +42,7 @@ Cel* Cel::MakeCopy(const frame_t newFrame,
                    const Cel* other)
 {
   Cel* cel = new Cel(newFrame,
-                     ImageRef(Image::createCopy(other->image())));
+                     ImageRef(Image::createSharedCopy(other->image())));
 
   cel->setPosition(other->position());
   cel->setOpacity(other->opacity());
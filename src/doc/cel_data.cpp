@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2022 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -18,8 +18,31 @@
 #include "doc/tileset.h"
 #include "gfx/rect.h"
 
+#include <city.h>
+
 namespace doc {
 
+namespace {
+
+// Hash of all the pixels of the image (we don't use the cached image
+// hash as the cache of compressed data must detect any change in the
+// pixels, even if the image version wasn't incremented).
+uint64_t hash_image_pixels(const Image* image)
+{
+  const int widthBytes = image->widthBytes();
+  if (widthBytes == image->rowBytes())
+    return CityHash64((const char*)image->getPixelAddress(0, 0),
+                      std::size_t(widthBytes) * image->height());
+
+  uint64_t hash = 0;
+  for (int y=0; y<image->height(); ++y)
+    hash = CityHash64WithSeed((const char*)image->getPixelAddress(0, y),
+                              widthBytes, hash);
+  return hash;
+}
+
+} // anonymous namespace
+
 CelData::CelData(const ImageRef& image)
   : WithUserData(ObjectType::CelData)
   , m_image(image)
@@ -45,6 +68,30 @@ CelData::~CelData()
 {
 }
 
+bool CelData::hasCompressedData() const
+{
+  return (!m_compressedData.empty() &&
+          m_image &&
+          m_image->id() == m_compressedImageId &&
+          m_image->version() == m_compressedImageVersion &&
+          hash_image_pixels(m_image.get()) == m_compressedImageHash);
+}
+
+void CelData::setCompressedData(base::buffer&& buffer) const
+{
+  ASSERT(m_image);
+  m_compressedData = std::move(buffer);
+  m_compressedImageId = m_image->id();
+  m_compressedImageVersion = m_image->version();
+  m_compressedImageHash = hash_image_pixels(m_image.get());
+}
+
+void CelData::discardCompressedData() const
+{
+  base::buffer().swap(m_compressedData);
+  m_compressedImageId = NullId;
+}
+
 void CelData::setImage(const ImageRef& image, Layer* layer)
 {
   ASSERT(image.get());
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,11 +9,14 @@
 #define DOC_CEL_DATA_H_INCLUDED
 #pragma once
 
+#include "base/buffer.h"
 #include "doc/image_ref.h"
 #include "doc/object.h"
+#include "doc/object_version.h"
 #include "doc/with_user_data.h"
 #include "gfx/rect.h"
 
+#include <cstdint>
 #include <memory>
 
 namespace doc {
@@ -82,11 +85,21 @@ namespace doc {
 
     virtual int getMemSize() const override {
       ASSERT(m_image);
-      return sizeof(CelData) + m_image->getMemSize();
+      return sizeof(CelData) + m_image->getMemSize() + m_compressedData.size();
     }
 
     void adjustBounds(Layer* layer);
 
+    // Cached compressed pixels of the image as they are stored in
+    // .aseprite files, so unchanged cels are not compressed again
+    // each time the file is saved. The cache is valid only for the
+    // same image, version, and pixels (checked with a hash) that
+    // were used in setCompressedData().
+    bool hasCompressedData() const;
+    void setCompressedData(base::buffer&& buffer) const;
+    const base::buffer& compressedData() const { return m_compressedData; }
+    void discardCompressedData() const;
+
   private:
     ImageRef m_image;
     int m_opacity;
@@ -95,6 +108,11 @@ namespace doc {
     // Special bounds for reference layers that can have subpixel
     // position.
     mutable std::unique_ptr<gfx::RectF> m_boundsF;
+
+    mutable base::buffer m_compressedData;
+    mutable ObjectId m_compressedImageId = NullId;
+    mutable ObjectVersion m_compressedImageVersion = 0;
+    mutable uint64_t m_compressedImageHash = 0;
   };
 
   typedef std::shared_ptr<CelData> CelDataRef;
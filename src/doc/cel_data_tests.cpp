@@ -0,0 +1,56 @@
+// Aseprite Document Library
+// Copyright (c) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/cel_data.h"
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+using namespace doc;
+
+TEST(CelData, CompressedDataCache)
+{
+  ImageRef image(Image::create(IMAGE_RGB, 16, 16));
+  clear_image(image.get(), rgba(0, 0, 0, 0));
+  CelData celData(image);
+  EXPECT_FALSE(celData.hasCompressedData());
+
+  celData.setCompressedData(base::buffer{ 1, 2, 3 });
+  EXPECT_TRUE(celData.hasCompressedData());
+  EXPECT_EQ(3, celData.compressedData().size());
+
+  // Modifying the pixels without incrementing the version
+  // invalidates the cache anyway
+  put_pixel(image.get(), 2, 3, rgba(255, 0, 0, 255));
+  EXPECT_FALSE(celData.hasCompressedData());
+
+  celData.setCompressedData(base::buffer{ 1, 2, 3 });
+  EXPECT_TRUE(celData.hasCompressedData());
+  image->incrementVersion();
+  EXPECT_FALSE(celData.hasCompressedData());
+
+  celData.setCompressedData(base::buffer{ 1, 2, 3 });
+  EXPECT_TRUE(celData.hasCompressedData());
+  celData.setImage(ImageRef(Image::createCopy(image.get())), nullptr);
+  EXPECT_FALSE(celData.hasCompressedData());
+
+  celData.setCompressedData(base::buffer{ 1, 2, 3 });
+  celData.discardCompressedData();
+  EXPECT_FALSE(celData.hasCompressedData());
+  EXPECT_TRUE(celData.compressedData().empty());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2022 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,12 +11,15 @@
 
 #include "base/fstream_path.h"
 #include "base/serialization.h"
+#include "doc/file/text_reader.h"
 #include "doc/palette.h"
 
 #include <algorithm>
 #include <cctype>
 #include <fstream>
 #include <memory>
+#include <string>
+#include <vector>
 
 namespace doc {
 namespace file {
@@ -27,31 +30,32 @@ const int ActMaxColors = 256;
 
 std::unique_ptr<Palette> load_act_file(const char *filename)
 {
-  std::ifstream f(FSTREAM_PATH(filename), std::ios::binary);
-  if (f.bad())
+  std::string buf;
+  if (!read_whole_file(filename, buf))
     return nullptr;
 
-  // Each color is a 24-bit RGB value
-  uint8_t rgb[ActMaxColors * 3] = { 0 };
-  f.read(reinterpret_cast<char*>(&rgb), sizeof(rgb));
+  // Each color is a 24-bit RGB value (missing colors are black)
+  const std::size_t rgbSize = ActMaxColors * 3;
+  const std::size_t size = buf.size();
+  buf.resize(std::max(size, rgbSize + 2), 0);
+  const auto rgb = (const uint8_t*)buf.data();
 
   int colors = ActMaxColors;
   // If there's extra bytes, it's the number of colors to use
-  if (!f.eof()) {
-    colors = std::min(read16(f), (uint16_t)ActMaxColors);
+  if (size > rgbSize) {
+    colors = std::min((rgb[rgbSize] << 8) | rgb[rgbSize+1],
+                      ActMaxColors);
   }
 
-  std::unique_ptr<Palette> pal(new Palette(frame_t(0), colors));
-
-  uint8_t *c = rgb;
-  for (int i = 0; i < colors; ++i) {
-    uint8_t r = *(c++);
-    uint8_t g = *(c++);
-    uint8_t b = *(c++);
-
-    pal->setEntry(i, rgba(r, g, b, 255));
+  std::vector<color_t> entries(colors);
+  const uint8_t* c = rgb;
+  for (color_t& entry : entries) {
+    entry = rgba(c[0], c[1], c[2], 255);
+    c += 3;
   }
 
+  auto pal = std::make_unique<Palette>(frame_t(0), 0);
+  pal->setEntries(entries.data(), colors);
   return pal;
 }
 
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,12 +12,16 @@
 #include "base/base.h"
 #include "base/cfile.h"
 #include "doc/color_scales.h"
+#include "doc/file/text_reader.h"
 #include "doc/image.h"
 #include "doc/palette.h"
 
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <memory>
+#include <string>
+#include <vector>
 
 #define PROCOL_MAGIC_NUMBER     0xB123
 
@@ -29,71 +33,51 @@ using namespace base;
 // Loads a COL file (Animator and Animator Pro format)
 std::unique_ptr<Palette> load_col_file(const char* filename)
 {
-  int c, r, g, b;
-
-  FILE* f = std::fopen(filename, "rb");
-  if (!f)
+  std::string buf;
+  if (!read_whole_file(filename, buf))
     return nullptr;
 
-  // Get file size.
-  std::fseek(f, 0, SEEK_END);
-  std::size_t size = std::ftell(f);
-  std::div_t d = std::div(size-8, 3);
-  std::fseek(f, 0, SEEK_SET);
+  const auto data = (const uint8_t*)buf.data();
+  const std::size_t size = buf.size();
+  std::div_t d = std::div(int(size)-8, 3);
 
   bool pro = (size == 768)? false: true; // is Animator Pro format?
-  if (!(size) || (pro && d.rem)) {       // Invalid format
-    fclose(f);
-    return NULL;
-  }
+  if (!(size) || (pro && (size < 8 || d.rem))) // Invalid format
+    return nullptr;
+
+  std::vector<color_t> colors;
 
   // Animator format
-  std::unique_ptr<Palette> pal = nullptr;
   if (!pro) {
-    pal = std::make_unique<Palette>(frame_t(0), 256);
-
-    for (c=0; c<256; c++) {
-      r = fgetc(f);
-      g = fgetc(f);
-      b = fgetc(f);
-      if (ferror(f))
-        break;
-
-      pal->setEntry(c, rgba(scale_6bits_to_8bits(std::clamp(r, 0, 63)),
-                            scale_6bits_to_8bits(std::clamp(g, 0, 63)),
-                            scale_6bits_to_8bits(std::clamp(b, 0, 63)), 255));
+    const uint8_t* rgb = data;
+    colors.resize(256);
+    for (color_t& color : colors) {
+      color = rgba(scale_6bits_to_8bits(std::min<int>(rgb[0], 63)),
+                   scale_6bits_to_8bits(std::min<int>(rgb[1], 63)),
+                   scale_6bits_to_8bits(std::min<int>(rgb[2], 63)), 255);
+      rgb += 3;
     }
   }
   // Animator Pro format
   else {
-    int magic, version;
-
-    fgetl(f);                   // Skip file size
-    magic = fgetw(f);           // File format identifier
-    version = fgetw(f);         // Version file
+    // Skip file size
+    const int magic = data[4] | (data[5] << 8);   // File format identifier
+    const int version = data[6] | (data[7] << 8); // Version file
 
     // Unknown format
-    if (magic != PROCOL_MAGIC_NUMBER || version != 0) {
-      fclose(f);
+    if (magic != PROCOL_MAGIC_NUMBER || version != 0)
       return nullptr;
-    }
-
-    pal = std::make_unique<Palette>(frame_t(0), std::min(d.quot, 256));
 
-    for (c=0; c<pal->size(); c++) {
-      r = fgetc(f);
-      g = fgetc(f);
-      b = fgetc(f);
-      if (ferror(f))
-        break;
-
-      pal->setEntry(c, rgba(std::clamp(r, 0, 255),
-                            std::clamp(g, 0, 255),
-                            std::clamp(b, 0, 255), 255));
+    const uint8_t* rgb = data+8;
+    colors.resize(std::min(d.quot, 256));
+    for (color_t& color : colors) {
+      color = rgba(rgb[0], rgb[1], rgb[2], 255);
+      rgb += 3;
     }
   }
 
-  fclose(f);
+  auto pal = std::make_unique<Palette>(frame_t(0), 0);
+  pal->setEntries(colors.data(), int(colors.size()));
   return pal;
 }
 
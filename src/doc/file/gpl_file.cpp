@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020  Igara Studio S.A.
+// Copyright (c) 2020-2026  Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,87 +11,91 @@
 
 #include "base/fstream_path.h"
 #include "base/log.h"
-#include "base/split_string.h"
 #include "base/trim_string.h"
+#include "doc/file/text_reader.h"
 #include "doc/image.h"
 #include "doc/palette.h"
 
-#include <cctype>
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <utility>
+#include <vector>
 
 namespace doc {
 namespace file {
 
 std::unique_ptr<Palette> load_gpl_file(const char* filename)
 {
-  std::ifstream f(FSTREAM_PATH(filename));
-  if (f.bad()) return NULL;
+  std::string buf;
+  if (!read_whole_file(filename, buf))
+    return nullptr;
 
   // Read first line, it must be "GIMP Palette"
-  std::string line;
-  if (!std::getline(f, line)) return NULL;
-  base::trim_string(line, line);
-  if (line != "GIMP Palette") return NULL;
+  TextReader reader(buf);
+  std::string_view line;
+  if (!reader.nextLine(line) || line != "GIMP Palette")
+    return nullptr;
 
-  std::unique_ptr<Palette> pal(new Palette(frame_t(0), 0));
+  std::vector<color_t> colors;
+  std::vector<std::pair<int, std::string_view>> names;
   std::string comment;
   bool hasAlpha = false;
 
-  while (std::getline(f, line)) {
-    // Trim line.
-    base::trim_string(line, line);
-
+  while (reader.nextLine(line)) {
     // Remove empty lines
     if (line.empty())
       continue;
 
     // Concatenate comments
     if (line[0] == '#') {
-      line = line.substr(1);
-      base::trim_string(line, line);
+      line.remove_prefix(1);
+      trim(line);
       comment += line;
       comment.push_back('\n');
       continue;
     }
 
     // Remove properties (TODO add these properties in the palette)
-    if (!std::isdigit(line[0])) {
-      std::vector<std::string> parts;
-      base::split_string(line, parts, ":");
+    if (!is_digit(line[0])) {
       // Aseprite extension for palettes with alpha channel.
-      if (parts.size() == 2 &&
-          parts[0] == "Channels") {
-        base::trim_string(parts[1], parts[1]);
-        if (parts[1] == "RGBA")
+      const auto colon = line.find(':');
+      if (colon != std::string_view::npos &&
+          line.find(':', colon+1) == std::string_view::npos &&
+          line.substr(0, colon) == "Channels") {
+        std::string_view value = line.substr(colon+1);
+        trim(value);
+        if (value == "RGBA")
           hasAlpha = true;
       }
       continue;
     }
 
     int r, g, b, a = 255;
-    std::string entryName;
-    std::istringstream lineIn(line);
-    lineIn >> r >> g >> b;
-    if (hasAlpha) {
-      lineIn >> a;
-    }
-    lineIn >> entryName;
+    if (!parse_int(line, r) ||
+        !parse_int(line, g) ||
+        !parse_int(line, b) ||
+        (hasAlpha && !parse_int(line, a)))
+      continue;
 
-    if (lineIn.fail())
-        continue;
+    colors.push_back(rgba(std::clamp(r, 0, 255),
+                          std::clamp(g, 0, 255),
+                          std::clamp(b, 0, 255),
+                          std::clamp(a, 0, 255)));
 
-    pal->addEntry(rgba(r, g, b, a));
-    if (!entryName.empty()) {
-      base::trim_string(entryName, entryName);
-      if (!entryName.empty())
-        pal->setEntryName(pal->size()-1, entryName);
-    }
+    // The rest of the line is the entry name
+    trim(line);
+    if (!line.empty())
+      names.emplace_back(int(colors.size())-1, line);
   }
 
+  auto pal = std::make_unique<Palette>(frame_t(0), 0);
+  pal->setEntries(colors.data(), int(colors.size()));
+  for (const auto& name : names)
+    pal->setEntryName(name.first, std::string(name.second));
+
   base::trim_string(comment, comment);
   if (!comment.empty()) {
     LOG(VERBOSE, "PAL: %s comment: %s\n", filename, comment.c_str());
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022-2024 Igara Studio S.A.
+// Copyright (c) 2022-2026 Igara Studio S.A.
 // Copyright (c) 2016-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,61 +13,59 @@
 
 #include "base/fstream_path.h"
 #include "base/hex.h"
-#include "base/trim_string.h"
+#include "doc/file/text_reader.h"
 #include "doc/palette.h"
 #include "doc/palette_picks.h"
 
-#include <cctype>
 #include <fstream>
 #include <iomanip>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <vector>
 
 namespace doc {
 namespace file {
 
 std::unique_ptr<Palette> load_hex_file(const char *filename)
 {
-  std::ifstream f(FSTREAM_PATH(filename));
-  if (f.bad())
+  std::string buf;
+  if (!read_whole_file(filename, buf))
     return nullptr;
 
-  std::unique_ptr<Palette> pal(new Palette(frame_t(0), 0));
+  std::vector<color_t> colors;
 
   // Read line by line, each line one color, ignore everything that
   // doesn't look like a hex color.
-  std::string line;
-  while (std::getline(f, line)) {
-    // Trim line
-    base::trim_string(line, line);
-
-    // Remove comments
-    if (line.empty())
-      continue;
-
+  TextReader reader(buf);
+  std::string_view line;
+  while (reader.nextLine(line)) {
     // Find 6 consecutive hex digits
-    for (std::string::size_type i=0; i != line.size(); ++i) {
-      std::string::size_type j = i;
-      for (; j<i+6; ++j) {
-        if (!base::is_hex_digit(line[j]))
+    int hex = 0;
+    int digits = 0;
+    for (const char chr : line) {
+      if (base::is_hex_digit(chr)) {
+        const int v = (chr <= '9' ? chr - '0':
+                       chr <= 'F' ? chr - 'A' + 10:
+                                    chr - 'a' + 10);
+        hex = (hex << 4) | v;
+        if (++digits == 6)
           break;
       }
-      if (j-i != 6)
-        continue;
-
-      // Convert text (Base 16) to integer
-      int hex = std::strtol(line.substr(i, 6).c_str(), nullptr, 16);
-      int r = (hex & 0xff0000) >> 16;
-      int g = (hex & 0xff00) >> 8;
-      int b = (hex & 0xff);
-      pal->addEntry(rgba(r, g, b, 255));
-
-      // Done, one color per line
-      break;
+      else {
+        hex = digits = 0;
+      }
     }
+    if (digits != 6)
+      continue;
+
+    int r = (hex & 0xff0000) >> 16;
+    int g = (hex & 0xff00) >> 8;
+    int b = (hex & 0xff);
+    colors.push_back(rgba(r, g, b, 255));
   }
 
+  auto pal = std::make_unique<Palette>(frame_t(0), 0);
+  pal->setEntries(colors.data(), int(colors.size()));
   return pal;
 }
 
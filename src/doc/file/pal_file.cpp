@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,62 +10,61 @@
 #endif
 
 #include "base/fstream_path.h"
-#include "base/split_string.h"
-#include "base/trim_string.h"
+#include "doc/file/text_reader.h"
 #include "doc/image.h"
 #include "doc/palette.h"
 
-#include <cctype>
+#include <algorithm>
 #include <fstream>
 #include <iomanip>
 #include <memory>
-#include <sstream>
 #include <string>
+#include <vector>
 
 namespace doc {
 namespace file {
 
 std::unique_ptr<Palette> load_pal_file(const char *filename)
 {
-  std::ifstream f(FSTREAM_PATH(filename));
-  if (f.bad())
+  std::string buf;
+  if (!read_whole_file(filename, buf))
     return nullptr;
 
   // Read first line, it must be "JASC-PAL"
-  std::string line;
-  if (!std::getline(f, line))
-    return nullptr;
-  base::trim_string(line, line);
-  if (line != "JASC-PAL")
+  TextReader reader(buf);
+  std::string_view line;
+  if (!reader.nextLine(line) || line != "JASC-PAL")
     return nullptr;
 
   // Second line is the version (0100)
-  if (!std::getline(f, line))
-    return nullptr;
-  base::trim_string(line, line);
-  if (line != "0100")
+  if (!reader.nextLine(line) || line != "0100")
     return nullptr;
 
   // Ignore number of colors (we'll read line by line anyway)
-  if (!std::getline(f, line))
+  if (!reader.nextLine(line))
     return nullptr;
 
-  std::unique_ptr<Palette> pal(new Palette(frame_t(0), 0));
-
-  while (std::getline(f, line)) {
-    // Trim line
-    base::trim_string(line, line);
-
+  std::vector<color_t> colors;
+  while (reader.nextLine(line)) {
     // Remove comments
     if (line.empty())
       continue;
 
     int r, g, b, a=255;
-    std::istringstream lineIn(line);
-    lineIn >> r >> g >> b >> a;
-    pal->addEntry(rgba(r, g, b, a));
+    if (!parse_int(line, r) ||
+        !parse_int(line, g) ||
+        !parse_int(line, b))
+      continue;
+    parse_int(line, a);
+
+    colors.push_back(rgba(std::clamp(r, 0, 255),
+                          std::clamp(g, 0, 255),
+                          std::clamp(b, 0, 255),
+                          std::clamp(a, 0, 255)));
   }
 
+  auto pal = std::make_unique<Palette>(frame_t(0), 0);
+  pal->setEntries(colors.data(), int(colors.size()));
   return pal;
 }
 
@@ -0,0 +1,67 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/file/text_reader.h"
+
+#include "base/file_handle.h"
+
+#include <cstdio>
+
+namespace doc {
+namespace file {
+
+bool read_whole_file(const char* filename, std::string& buf)
+{
+  base::FileHandle handle(base::open_file(filename, "rb"));
+  FILE* f = handle.get();
+  if (!f)
+    return false;
+
+  if (std::fseek(f, 0, SEEK_END) != 0)
+    return false;
+  const long size = std::ftell(f);
+  if (size < 0 || std::fseek(f, 0, SEEK_SET) != 0)
+    return false;
+
+  buf.resize(size);
+  buf.resize(std::fread(buf.data(), 1, buf.size(), f));
+  return !std::ferror(f);
+}
+
+bool parse_int(std::string_view& s, int& value)
+{
+  std::size_t i = 0;
+  while (i < s.size() && is_space(s[i]))
+    ++i;
+
+  bool negative = false;
+  if (i < s.size() && (s[i] == '-' || s[i] == '+')) {
+    negative = (s[i] == '-');
+    ++i;
+  }
+
+  const std::size_t begin = i;
+  int v = 0;
+  for (; i < s.size() && is_digit(s[i]); ++i) {
+    // Avoid overflows with invalid values (they are clamped by the
+    // parsers anyway)
+    if (v < 100000000)
+      v = v*10 + (s[i] - '0');
+  }
+  if (i == begin)
+    return false;
+
+  value = (negative ? -v: v);
+  s.remove_prefix(i);
+  return true;
+}
+
+} // namespace file
+} // namespace doc
@@ -0,0 +1,72 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_FILE_TEXT_READER_H_INCLUDED
+#define DOC_FILE_TEXT_READER_H_INCLUDED
+#pragma once
+
+#include <string>
+#include <string_view>
+
+namespace doc {
+  namespace file {
+
+    // Reads the whole file in "buf" (palette files are small, so it's
+    // faster to parse them from memory than line by line with
+    // iostreams). Returns false if the file cannot be read.
+    bool read_whole_file(const char* filename, std::string& buf);
+
+    // Returns true for the same whitespace chars as std::isspace()
+    // in the "C" locale.
+    inline bool is_space(const char c) {
+      return (c == ' ' || (c >= '\t' && c <= '\r'));
+    }
+
+    inline bool is_digit(const char c) {
+      return (c >= '0' && c <= '9');
+    }
+
+    inline void trim(std::string_view& s) {
+      while (!s.empty() && is_space(s.front())) s.remove_prefix(1);
+      while (!s.empty() && is_space(s.back())) s.remove_suffix(1);
+    }
+
+    // Parses a decimal integer (with an optional sign) at the
+    // beginning of "s" (skipping leading whitespace), and removes it
+    // from "s". Returns false if there is no integer.
+    bool parse_int(std::string_view& s, int& value);
+
+    // Splits a text in trimmed lines (without the '\r' of CRLF lines).
+    class TextReader {
+    public:
+      TextReader(std::string_view text) : m_text(text) { }
+
+      // Returns false at the end of the text.
+      bool nextLine(std::string_view& line) {
+        if (m_text.empty())
+          return false;
+
+        const auto eol = m_text.find('\n');
+        if (eol == std::string_view::npos) {
+          line = m_text;
+          m_text = std::string_view();
+        }
+        else {
+          line = m_text.substr(0, eol);
+          m_text.remove_prefix(eol+1);
+        }
+        trim(line);
+        return true;
+      }
+
+    private:
+      std::string_view m_text;
+    };
+
+  } // namespace file
+} // namespace doc
+
+#endif
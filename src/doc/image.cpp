@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2020 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,17 +11,25 @@
 
 #include "doc/image.h"
 
+#include "base/exception.h"
 #include "doc/algo.h"
 #include "doc/brush.h"
 #include "doc/image_impl.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
 #include "doc/rgbmap.h"
+#include "zlib.h"
 
 namespace doc {
 
 Image::Image(const ImageSpec& spec)
   : Object(ObjectType::Image)
+  , m_sharedBits(false)
+  , m_hashValid(false)
+  , m_hash(0)
+  , m_hashVersion(0)
+  , m_usedEntriesValid(false)
+  , m_usedEntriesVersion(0)
   , m_spec(spec)
 {
 }
@@ -68,4 +76,40 @@ Image* Image::createCopy(const Image* image, const ImageBufferPtr& buffer)
                     image->maskColor(), buffer);
 }
 
+std::vector<uint8_t> compress_image_bits(const uint8_t* bits, std::size_t size)
+{
+  uLongf compressedSize = compressBound(uLong(size));
+  std::vector<uint8_t> data(compressedSize);
+  if (compress2((Bytef*)data.data(), &compressedSize,
+                (const Bytef*)bits, uLong(size), Z_BEST_SPEED) != Z_OK)
+    return std::vector<uint8_t>();
+
+  data.resize(compressedSize);
+  data.shrink_to_fit();
+  return data;
+}
+
+void uncompress_image_bits(const std::vector<uint8_t>& data, uint8_t* bits, std::size_t size)
+{
+  uLongf uncompressedSize = uLongf(size);
+  const int err = uncompress((Bytef*)bits, &uncompressedSize,
+                             (const Bytef*)data.data(), uLong(data.size()));
+  if (err != Z_OK || uncompressedSize != size)
+    throw base::Exception("ZLib error %d uncompressing image pixels.", err);
+}
+
+// static
+Image* Image::createSharedCopy(const Image* image)
+{
+  ASSERT(image);
+  switch (image->colorMode()) {
+    case ColorMode::RGB:       return new ImageImpl<RgbTraits>(static_cast<const ImageImpl<RgbTraits>*>(image));
+    case ColorMode::GRAYSCALE: return new ImageImpl<GrayscaleTraits>(static_cast<const ImageImpl<GrayscaleTraits>*>(image));
+    case ColorMode::INDEXED:   return new ImageImpl<IndexedTraits>(static_cast<const ImageImpl<IndexedTraits>*>(image));
+    case ColorMode::BITMAP:    return new ImageImpl<BitmapTraits>(static_cast<const ImageImpl<BitmapTraits>*>(image));
+    case ColorMode::TILEMAP:   return new ImageImpl<TilemapTraits>(static_cast<const ImageImpl<TilemapTraits>*>(image));
+  }
+  return nullptr;
+}
+
 } // namespace doc
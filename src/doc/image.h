@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -19,13 +19,37 @@
 #include "gfx/rect.h"
 #include "gfx/size.h"
 
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
 namespace doc {
 
   template<typename ImageTraits> class ImageBits;
+  class Image;
   class Palette;
+  class PalettePicks;
   class Pen;
   class RgbMap;
 
+  // Loads the pixels of an image on demand (e.g. from the original
+  // file, see Image::setBitsLoader()).
+  class ImageBitsLoader {
+  public:
+    virtual ~ImageBitsLoader() { }
+
+    // Fills "bits" (the "size" bytes of all rows of "image"). It's
+    // called with the pixels of the image locked, so it cannot access
+    // the pixels of "image" directly (use a temporary image). Returns
+    // false if the pixels cannot be loaded, in that case the loader
+    // is responsible of reporting the error to the user and the image
+    // is left empty.
+    virtual bool loadBits(const Image* image, uint8_t* bits, std::size_t size) = 0;
+  };
+
+  using ImageBitsLoaderPtr = std::shared_ptr<ImageBitsLoader>;
+
   class Image : public Object {
   public:
     enum LockType {
@@ -41,6 +65,16 @@ namespace doc {
     static Image* createCopy(const Image* image,
                              const ImageBufferPtr& buffer = ImageBufferPtr());
 
+    // Creates a copy of the image (with a new ID) that shares the
+    // pixels with the original one until any of both images is
+    // modified (copy-on-write). It's useful to duplicate cels or to
+    // keep undo data without copying the pixels. The first write in
+    // any of both images (through a non-const getPixelAddress(),
+    // lockBits(), clear(), put_pixel(), etc.) makes a private copy of
+    // the pixels, so it must be done with the document locked for
+    // writing as any other modification.
+    static Image* createSharedCopy(const Image* image);
+
     virtual ~Image();
 
     const ImageSpec& spec() const { return m_spec; }
@@ -72,8 +106,82 @@ namespace doc {
 
     virtual int getMemSize() const override;
 
+    // Returns true if the pixels are shared with other image (see
+    // createSharedCopy()).
+    bool isSharingBits() const { return m_sharedBits; }
+
+    // Called before modifying the pixels: makes a private copy of the
+    // pixels if they are shared with other image, and invalidates the
+    // cached hash and used entries.
+    void detachBits() {
+      m_hashValid.store(false, std::memory_order_relaxed);
+      m_usedEntriesValid.store(false, std::memory_order_relaxed);
+      if (m_sharedBits)
+        onDetachBits();
+    }
+
+    // Cached result of calculate_image_hash() for the whole image, so
+    // we don't need to calculate it again for images that weren't
+    // modified (e.g. tiles of a tileset each time the hash table is
+    // regenerated). It's invalidated when the pixels are modified
+    // through the non-const member functions or the version changes.
+    bool cachedHash(uint32_t& hash) const {
+      if (!m_hashValid.load(std::memory_order_acquire) ||
+          m_hashVersion.load(std::memory_order_relaxed) != version())
+        return false;
+      hash = m_hash.load(std::memory_order_relaxed);
+      return true;
+    }
+    void setCachedHash(const uint32_t hash) const {
+      m_hash.store(hash, std::memory_order_relaxed);
+      m_hashVersion.store(version(), std::memory_order_relaxed);
+      m_hashValid.store(true, std::memory_order_release);
+    }
+
+    // Cached palette entries (indexed images) or tile indexes
+    // (tilemaps) used in the image, calculated by get_used_entries()
+    // and invalidated in the same way as the cached hash. Returns
+    // nullptr if there is no valid cached value.
+    std::shared_ptr<const PalettePicks> cachedUsedEntries() const {
+      if (!m_usedEntriesValid.load(std::memory_order_acquire) ||
+          m_usedEntriesVersion.load(std::memory_order_relaxed) != version())
+        return nullptr;
+      return std::atomic_load(&m_usedEntries);
+    }
+    void setCachedUsedEntries(const std::shared_ptr<const PalettePicks>& usedEntries) const {
+      std::atomic_store(&m_usedEntries, usedEntries);
+      m_usedEntriesVersion.store(version(), std::memory_order_relaxed);
+      m_usedEntriesValid.store(true, std::memory_order_release);
+    }
+
+    // Compresses the pixels in memory (releasing the pixels buffer)
+    // to save memory for images that are not used in a long time
+    // (e.g. cels in frames that are not visible). The pixels are
+    // uncompressed automatically the first time they are accessed.
+    // Returns false if the image cannot be compressed (e.g. it shares
+    // its pixels with other image) or it's not worth it.
+    //
+    // It must be called with the document locked for writing, as any
+    // other modification.
+    virtual bool compressBits() = 0;
+    virtual bool isCompressed() const = 0;
+
+    // Releases the pixels buffer, the pixels will be loaded with the
+    // given "loader" the first time they are accessed (lazy loading,
+    // e.g. to open big files faster). isCompressed() returns true
+    // until the pixels are loaded. Returns false if the pixels are
+    // shared with other images.
+    virtual bool setBitsLoader(const ImageBitsLoaderPtr& loader) = 0;
+    virtual bool hasBitsLoader() const = 0;
+
+    // Uncompresses (or loads) the pixels now if they are compressed,
+    // so they are ready for the next access (e.g. to prefetch cels in
+    // a background thread).
+    virtual void prefetchBits() const = 0;
+
     template<typename ImageTraits>
     ImageBits<ImageTraits> lockBits(LockType lockType, const gfx::Rect& bounds) {
+      detachBits();
       return ImageBits<ImageTraits>(this, bounds);
     }
 
@@ -91,7 +199,13 @@ namespace doc {
     // bounds checks. Use the primitives defined in doc/primitives.h
     // in case that you need bounds check.
     virtual uint8_t* getPixelAddress(int x, int y) const = 0;
+    uint8_t* getPixelAddress(int x, int y) {
+      detachBits();
+      return static_cast<const Image*>(this)->getPixelAddress(x, y);
+    }
     virtual color_t getPixel(int x, int y) const = 0;
+    // putPixel() doesn't detach the pixels because it's called for
+    // each pixel, call detachBits() once before (put_pixel() does it).
     virtual void putPixel(int x, int y, color_t color) = 0;
     virtual void clear(color_t color) = 0;
     virtual void copy(const Image* src, gfx::Clip area) = 0;
@@ -102,10 +216,24 @@ namespace doc {
   protected:
     Image(const ImageSpec& spec);
 
+    virtual void onDetachBits() = 0;
+
     // Number of bytes for each row.
     size_t m_rowBytes;
 
+    // True if the pixels buffer was shared with other image using
+    // createSharedCopy(). It's mutable because the original image can
+    // be const.
+    mutable bool m_sharedBits;
+
   private:
+    mutable std::atomic<bool> m_hashValid;
+    mutable std::atomic<uint32_t> m_hash;
+    mutable std::atomic<ObjectVersion> m_hashVersion;
+    mutable std::atomic<bool> m_usedEntriesValid;
+    mutable std::atomic<ObjectVersion> m_usedEntriesVersion;
+    mutable std::shared_ptr<const PalettePicks> m_usedEntries;
+
     ImageSpec m_spec;
   };
 
@@ -121,6 +121,17 @@ namespace doc {
       : m_bits(image->lockBits<ImageTraits>(Image::ReadLock, bounds)) {
     }
 
+    // Non-const images can be modified through the iterators, so the
+    // pixels are detached if they are shared (see
+    // Image::createSharedCopy()).
+    explicit LockImageBits(Image* image)
+      : m_bits(image->lockBits<ImageTraits>(Image::ReadLock, image->bounds())) {
+    }
+
+    LockImageBits(Image* image, const gfx::Rect& bounds)
+      : m_bits(image->lockBits<ImageTraits>(Image::ReadLock, bounds)) {
+    }
+
     LockImageBits(Image* image, Image::LockType lockType)
       : m_bits(image->lockBits<ImageTraits>(lockType, image->bounds())) {
     }
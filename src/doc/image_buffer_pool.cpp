@@ -0,0 +1,145 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/image_buffer_pool.h"
+
+#include "base/debug.h"
+
+#include <iterator>
+
+namespace doc {
+
+// static
+ImageBufferPool* ImageBufferPool::instance()
+{
+  // The pool is never deleted because images (and their buffers) can
+  // be destroyed after it (e.g. static images).
+  static ImageBufferPool* pool = new ImageBufferPool(64*1024*1024);
+  return pool;
+}
+
+ImageBufferPool::ImageBufferPool(const std::size_t maxMemory)
+  : m_maxMemory(maxMemory)
+{
+}
+
+ImageBufferPool::~ImageBufferPool()
+{
+  clear();
+}
+
+ImageBufferPtr ImageBufferPool::get(const std::size_t size)
+{
+  const std::size_t alignedSize = doc_align_size(size);
+  ImageBuffer* buffer = nullptr;
+  {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_bySize.find(alignedSize);
+    if (it != m_bySize.end()) {
+      buffer = *it->second;
+      removeFree(it->second);
+      ++m_stats.hits;
+    }
+    else
+      ++m_stats.misses;
+  }
+
+  if (!buffer)
+    buffer = new ImageBuffer(alignedSize);
+
+  return ImageBufferPtr(buffer, [this](ImageBuffer* buffer){
+                                  release(buffer);
+                                });
+}
+
+std::size_t ImageBufferPool::maxMemory() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_maxMemory;
+}
+
+void ImageBufferPool::setMaxMemory(const std::size_t maxMemory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_maxMemory = maxMemory;
+  shrink();
+}
+
+ImageBufferPool::Stats ImageBufferPool::stats() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_stats;
+}
+
+void ImageBufferPool::resetStats()
+{
+  const std::lock_guard lock(m_mutex);
+  m_stats.hits = 0;
+  m_stats.misses = 0;
+}
+
+void ImageBufferPool::clear()
+{
+  const std::lock_guard lock(m_mutex);
+  while (!m_free.empty())
+    deleteFree(std::prev(m_free.end()));
+}
+
+void ImageBufferPool::release(ImageBuffer* buffer)
+{
+  const std::lock_guard lock(m_mutex);
+
+  // Buffers bigger than the whole pool are deleted directly
+  if (buffer->size() > m_maxMemory) {
+    delete buffer;
+    return;
+  }
+
+  m_free.push_front(buffer);
+  m_bySize.insert({ buffer->size(), m_free.begin() });
+  ++m_stats.freeBuffers;
+  m_stats.freeMemory += buffer->size();
+  shrink();
+}
+
+void ImageBufferPool::shrink()
+{
+  while (m_stats.freeMemory > m_maxMemory && !m_free.empty())
+    deleteFree(std::prev(m_free.end()));
+}
+
+void ImageBufferPool::deleteFree(FreeList::iterator it)
+{
+  ImageBuffer* buffer = *it;
+  removeFree(it);
+  delete buffer;
+}
+
+void ImageBufferPool::removeFree(FreeList::iterator it)
+{
+  ImageBuffer* buffer = *it;
+  const std::size_t size = buffer->size();
+
+  auto range = m_bySize.equal_range(size);
+  for (auto jt=range.first; jt!=range.second; ++jt) {
+    if (jt->second == it) {
+      m_bySize.erase(jt);
+      break;
+    }
+  }
+  m_free.erase(it);
+
+  ASSERT(m_stats.freeBuffers > 0);
+  ASSERT(m_stats.freeMemory >= size);
+  --m_stats.freeBuffers;
+  m_stats.freeMemory -= size;
+}
+
+} // namespace doc
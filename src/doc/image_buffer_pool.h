@@ -0,0 +1,82 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_IMAGE_BUFFER_POOL_H_INCLUDED
+#define DOC_IMAGE_BUFFER_POOL_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/image_buffer.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace doc {
+
+  // Keeps the recently freed image buffers to reuse them for new
+  // images of the same size (e.g. temporary images created each time
+  // we render the editor, draw with a brush, apply a filter, etc.)
+  // instead of asking memory to the system allocator each time.
+  //
+  // Image::create() uses it when no buffer is specified. Buffers are
+  // reused only with the exact same size, so there is no memory waste
+  // for long-lived images, and the total memory of free buffers is
+  // limited with setMaxMemory().
+  class ImageBufferPool {
+  public:
+    struct Stats {
+      std::size_t hits = 0;        // Buffers reused from the pool
+      std::size_t misses = 0;      // Buffers allocated from the system
+      std::size_t freeBuffers = 0; // Buffers waiting to be reused
+      std::size_t freeMemory = 0;  // Memory used by free buffers
+      double hitRate() const {
+        return (hits+misses > 0 ? double(hits) / double(hits+misses): 0.0);
+      }
+    };
+
+    static ImageBufferPool* instance();
+
+    explicit ImageBufferPool(const std::size_t maxMemory);
+    ~ImageBufferPool();
+
+    // Returns a buffer of at least "size" bytes (its content is
+    // undefined). The buffer goes back to the pool when the last
+    // reference to it is released, so the pool must outlive all the
+    // buffers returned by it.
+    ImageBufferPtr get(const std::size_t size);
+
+    std::size_t maxMemory() const;
+    void setMaxMemory(const std::size_t maxMemory);
+
+    Stats stats() const;
+    void resetStats();
+
+    // Deletes all free buffers
+    void clear();
+
+  private:
+    using FreeList = std::list<ImageBuffer*>;
+
+    void release(ImageBuffer* buffer);
+    void shrink();
+    void removeFree(FreeList::iterator it);
+    void deleteFree(FreeList::iterator it);
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxMemory;
+    Stats m_stats;
+    // Most recently freed buffers at the beginning of the list
+    FreeList m_free;
+    std::unordered_multimap<std::size_t, FreeList::iterator> m_bySize;
+
+    DISABLE_COPYING(ImageBufferPool);
+  };
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,84 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/image_buffer_pool.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(ImageBufferPool, ReuseBuffersOfTheSameSize)
+{
+  ImageBufferPool pool(1024);
+
+  ImageBufferPtr a = pool.get(100);
+  uint8_t* addr = a->buffer();
+  EXPECT_EQ(0u, pool.stats().hits);
+  EXPECT_EQ(1u, pool.stats().misses);
+
+  a.reset();
+  EXPECT_EQ(1u, pool.stats().freeBuffers);
+
+  // Different size
+  ImageBufferPtr b = pool.get(200);
+  EXPECT_EQ(0u, pool.stats().hits);
+  EXPECT_EQ(2u, pool.stats().misses);
+
+  // Same size
+  ImageBufferPtr c = pool.get(100);
+  EXPECT_EQ(addr, c->buffer());
+  EXPECT_EQ(1u, pool.stats().hits);
+  EXPECT_EQ(0u, pool.stats().freeBuffers);
+  EXPECT_DOUBLE_EQ(1.0/3.0, pool.stats().hitRate());
+}
+
+TEST(ImageBufferPool, MaxMemory)
+{
+  ImageBufferPool pool(1000);
+  {
+    ImageBufferPtr a = pool.get(400);
+    ImageBufferPtr b = pool.get(400);
+    ImageBufferPtr c = pool.get(400);
+    ImageBufferPtr d = pool.get(2000);
+  }
+  EXPECT_EQ(2u, pool.stats().freeBuffers);
+  EXPECT_EQ(800u, pool.stats().freeMemory);
+
+  pool.setMaxMemory(500);
+  EXPECT_EQ(1u, pool.stats().freeBuffers);
+
+  pool.clear();
+  EXPECT_EQ(0u, pool.stats().freeBuffers);
+  EXPECT_EQ(0u, pool.stats().freeMemory);
+}
+
+TEST(ImageBufferPool, ImagesUseTheDefaultPool)
+{
+  ImageBufferPool* pool = ImageBufferPool::instance();
+  pool->clear();
+  pool->resetStats();
+
+  std::unique_ptr<Image> a(Image::create(IMAGE_RGB, 32, 32));
+  a.reset();
+  std::unique_ptr<Image> b(Image::create(IMAGE_RGB, 32, 32));
+  EXPECT_EQ(1u, pool->stats().hits);
+
+  // The recycled buffer is cleared
+  EXPECT_EQ(0, b->getPixel(0, 0));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
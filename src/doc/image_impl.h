@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,12 +10,16 @@
 #pragma once
 
 #include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <cstring>
+#include <mutex>
+#include <vector>
 
 #include "doc/blend_funcs.h"
 #include "doc/image.h"
 #include "doc/image_bits.h"
+#include "doc/image_buffer_pool.h"
 #include "doc/image_iterator.h"
 #include "doc/palette.h"
 
@@ -23,6 +27,11 @@ namespace doc {
 
   template<typename ImageTraits> class LockImageBits;
 
+  // Helpers to compress the pixels of an ImageImpl in memory (see
+  // Image::compressBits()).
+  std::vector<uint8_t> compress_image_bits(const uint8_t* bits, std::size_t size);
+  void uncompress_image_bits(const std::vector<uint8_t>& data, uint8_t* bits, std::size_t size);
+
   template<class Traits>
   class ImageImpl : public Image {
   public:
@@ -31,18 +40,37 @@ namespace doc {
     using const_address_t = typename traits_t::const_address_t;
 
   private:
-    ImageBufferPtr m_buffer;
-    address_t* m_rows;
-    address_t m_bits;
+    // These fields are mutable because the pixels can be uncompressed
+    // from const member functions (the first time they are accessed
+    // after compressBits() or setBitsLoader()). m_rows is nullptr
+    // when the image is compressed or not loaded yet.
+    mutable ImageBufferPtr m_buffer;
+    mutable std::atomic<address_t*> m_rows;
+    mutable address_t m_bits;
+    mutable std::vector<uint8_t> m_compressedBits;
+    mutable ImageBitsLoaderPtr m_bitsLoader;
+
+    // Used to uncompress/load the pixels only once when several
+    // threads access them at the same time. It's a mutex per image,
+    // so loading a big image from disk doesn't block the access to
+    // other images.
+    mutable std::mutex m_uncompressMutex;
+
+    inline address_t* rows() const {
+      address_t* rows = m_rows.load(std::memory_order_acquire);
+      if (!rows)
+        rows = uncompressBits();
+      return rows;
+    }
 
     inline address_t getLineAddress(int y) {
       ASSERT(y >= 0 && y < height());
-      return m_rows[y];
+      return rows()[y];
     }
 
     inline const_address_t getLineAddress(int y) const {
       ASSERT(y >= 0 && y < height());
-      return m_rows[y];
+      return rows()[y];
     }
 
   public:
@@ -69,23 +97,91 @@ namespace doc {
       const std::size_t required_size = for_pixels + for_rows;
 
       if (!m_buffer)
-        m_buffer = std::make_shared<ImageBuffer>(required_size);
+        m_buffer = ImageBufferPool::instance()->get(required_size);
       else
         m_buffer->resizeIfNecessary(required_size);
 
       std::fill(m_buffer->buffer(),
                 m_buffer->buffer()+required_size, 0);
 
-      m_rows = (address_t*)m_buffer->buffer();
-      m_bits = (address_t)(m_buffer->buffer() + for_rows);
+      initRows();
+    }
 
-      auto addr = (uint8_t*)m_bits;
-      for (int y=0; y<height(); ++y) {
-        m_rows[y] = (address_t)addr;
-        addr += m_rowBytes;
+    // Creates an image that shares the pixels buffer of "src" (used
+    // by Image::createSharedCopy()).
+    explicit ImageImpl(const ImageImpl* src)
+      : Image(src->spec())
+    {
+      // Uncompress the pixels of "src" to share them
+      address_t* srcRows = src->rows();
+
+      m_buffer = src->m_buffer;
+      m_bits = src->m_bits;
+      m_rows.store(srcRows, std::memory_order_relaxed);
+      m_rowBytes = src->m_rowBytes;
+      m_sharedBits = src->m_sharedBits = true;
+    }
+
+    int getMemSize() const override {
+      if (isCompressed()) {
+        const std::lock_guard lock(m_uncompressMutex);
+        if (isCompressed())
+          return sizeof(*this) + int(m_compressedBits.size());
       }
+      return Image::getMemSize();
+    }
+
+    bool compressBits() override {
+      // We cannot release a buffer that is shared with other images
+      if (isCompressed() || m_buffer.use_count() > 1)
+        return false;
+
+      const std::size_t for_pixels = m_rowBytes * height();
+      std::vector<uint8_t> data =
+        compress_image_bits((const uint8_t*)m_bits, for_pixels);
+
+      // It's not worth to compress this image
+      if (data.empty() || data.size() > for_pixels/2)
+        return false;
+
+      m_compressedBits = std::move(data);
+      m_rows.store(nullptr, std::memory_order_release);
+      m_bits = nullptr;
+      m_buffer.reset();
+      m_sharedBits = false;
+      return true;
+    }
+
+    bool isCompressed() const override {
+      return (m_rows.load(std::memory_order_acquire) == nullptr);
+    }
+
+    bool setBitsLoader(const ImageBitsLoaderPtr& loader) override {
+      ASSERT(loader);
+      if (isCompressed() || m_buffer.use_count() > 1)
+        return false;
+
+      m_bitsLoader = loader;
+      m_rows.store(nullptr, std::memory_order_release);
+      m_bits = nullptr;
+      m_buffer.reset();
+      m_sharedBits = false;
+      return true;
+    }
+
+    bool hasBitsLoader() const override {
+      if (!isCompressed())
+        return false;
+      const std::lock_guard lock(m_uncompressMutex);
+      return (m_bitsLoader != nullptr);
+    }
+
+    void prefetchBits() const override {
+      rows();
     }
 
+    using Image::getPixelAddress;
+
     uint8_t* getPixelAddress(int x, int y) const override {
       ASSERT(x >= 0 && x < width());
       ASSERT(y >= 0 && y < height());
@@ -103,11 +199,13 @@ namespace doc {
     void putPixel(int x, int y, color_t color) override {
       ASSERT(x >= 0 && x < width());
       ASSERT(y >= 0 && y < height());
+      ASSERT(!isSharingBits());
 
       *address(x, y) = color;
     }
 
     void clear(color_t color) override {
+      detachBits();
       const int w = width();
       const int h = height();
       for (int y=0; y<h; ++y) {
@@ -124,6 +222,8 @@ namespace doc {
       if (!area.clip(width(), height(), src->width(), src->height()))
         return;
 
+      detachBits();
+
       for (int end_y=area.dst.y+area.size.h;
            area.dst.y<end_y;
            ++area.dst.y, ++area.src.y) {
@@ -146,6 +246,8 @@ namespace doc {
     }
 
     void fillRect(int x1, int y1, int x2, int y2, color_t color) override {
+      detachBits();
+
       // Fill the first line
       ImageImpl<Traits>::drawHLine(x1, y1, x2, color);
 
@@ -160,7 +262,71 @@ namespace doc {
       fillRect(x1, y1, x2, y2, color);
     }
 
+  protected:
+    void onDetachBits() override {
+      m_sharedBits = false;
+
+      // The other image could be already deleted or detached
+      if (m_buffer.use_count() <= 1)
+        return;
+
+      const std::size_t for_rows = doc_align_size(sizeof(address_t) * height());
+      const std::size_t for_pixels = m_rowBytes * height();
+      const auto oldBits = (const uint8_t*)m_bits;
+
+      m_buffer = ImageBufferPool::instance()->get(for_pixels + for_rows);
+      std::copy(oldBits, oldBits+for_pixels,
+                m_buffer->buffer() + for_rows);
+      initRows();
+    }
+
   private:
+    address_t* initRows() const {
+      const std::size_t for_rows = doc_align_size(sizeof(address_t) * height());
+
+      auto rows = (address_t*)m_buffer->buffer();
+      m_bits = (address_t)(m_buffer->buffer() + for_rows);
+
+      auto addr = (uint8_t*)m_bits;
+      for (int y=0; y<height(); ++y) {
+        rows[y] = (address_t)addr;
+        addr += m_rowBytes;
+      }
+
+      m_rows.store(rows, std::memory_order_release);
+      return rows;
+    }
+
+    // Called the first time that the pixels are accessed after
+    // compressBits() or setBitsLoader(), it can be called from several
+    // threads at the same time (e.g. render threads).
+    address_t* uncompressBits() const {
+      const std::lock_guard lock(m_uncompressMutex);
+
+      // Other thread could have uncompressed the pixels
+      address_t* rows = m_rows.load(std::memory_order_acquire);
+      if (rows)
+        return rows;
+
+      const std::size_t for_rows = doc_align_size(sizeof(address_t) * height());
+      const std::size_t for_pixels = m_rowBytes * height();
+
+      m_buffer = ImageBufferPool::instance()->get(for_pixels + for_rows);
+      uint8_t* bits = m_buffer->buffer() + for_rows;
+      if (m_bitsLoader) {
+        // If the pixels cannot be loaded (e.g. the file was modified)
+        // we keep an empty image (the loader reports the error)
+        if (!m_bitsLoader->loadBits(this, bits, for_pixels))
+          std::fill(bits, bits+for_pixels, 0);
+        m_bitsLoader.reset();
+      }
+      else {
+        uncompress_image_bits(m_compressedBits, bits, for_pixels);
+        m_compressedBits = std::vector<uint8_t>();
+      }
+      return initRows();
+    }
+
     bool clip_rects(const Image* src, int& dst_x, int& dst_y, int& src_x, int& src_y, int& w, int& h) const {
       // Clip with destionation image
       if (dst_x < 0) {
@@ -222,12 +388,14 @@ namespace doc {
 
   template<>
   inline void ImageImpl<IndexedTraits>::clear(color_t color) {
+    detachBits();
     uint8_t* p = address(0, 0);
     std::fill(p, p+rowBytes()*height(), color);
   }
 
   template<>
   inline void ImageImpl<BitmapTraits>::clear(color_t color) {
+    detachBits();
     uint8_t* p = address(0, 0);
     std::fill(p, p+rowBytes()*height(), (color ? 0xff: 0x00));
   }
@@ -245,6 +413,7 @@ namespace doc {
   inline void ImageImpl<BitmapTraits>::putPixel(int x, int y, color_t color) {
     ASSERT(x >= 0 && x < width());
     ASSERT(y >= 0 && y < height());
+    ASSERT(!isSharingBits());
 
     std::div_t d = std::div(x, 8);
     if (color)
@@ -276,6 +445,7 @@ namespace doc {
   void copy_bitmaps(Image* dst, const Image* src, gfx::Clip area);
   template<>
   inline void ImageImpl<BitmapTraits>::copy(const Image* src, gfx::Clip area) {
+    detachBits();
     copy_bitmaps(this, src, area);
   }
 
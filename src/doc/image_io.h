@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -8,6 +9,8 @@
 #define DOC_IMAGE_IO_H_INCLUDED
 #pragma once
 
+#include "doc/object_id.h"
+
 #include <iosfwd>
 
 namespace doc {
@@ -15,7 +18,16 @@ namespace doc {
   class CancelIO;
   class Image;
 
-  bool write_image(std::ostream& os, const Image* image, CancelIO* cancel = nullptr);
+  // "compressionLevel" is the zlib level (from 0 to 9, or -1 to use
+  // the default level)
+  bool write_image(std::ostream& os, const Image* image, CancelIO* cancel = nullptr,
+                   const int compressionLevel = -1);
+
+  // Writes the image with the given ID (e.g. to write a copy of
+  // other image with the ID of the original one).
+  bool write_image(std::ostream& os, const Image* image, const ObjectId id,
+                   CancelIO* cancel = nullptr,
+                   const int compressionLevel = -1);
   Image* read_image(std::istream& is, bool setId = true);
 
 } // namespace doc
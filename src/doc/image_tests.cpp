@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -225,6 +225,187 @@ TYPED_TEST(ImageAllTypes, FillRect)
   }
 }
 
+TYPED_TEST(ImageAllTypes, SharedCopyIsDetachedOnWrite)
+{
+  using ImageTraits = TypeParam;
+
+  std::unique_ptr<Image> a(Image::create(ImageTraits::pixel_format, 8, 6));
+  clear_image(a.get(), 0);
+  put_pixel(a.get(), 1, 2, 1);
+
+  std::unique_ptr<Image> b(Image::createSharedCopy(a.get()));
+  EXPECT_NE(a->id(), b->id());
+  EXPECT_TRUE(a->isSharingBits());
+  EXPECT_TRUE(b->isSharingBits());
+  EXPECT_EQ(static_cast<const Image*>(a.get())->getPixelAddress(0, 0),
+            static_cast<const Image*>(b.get())->getPixelAddress(0, 0));
+  EXPECT_TRUE(is_same_image(a.get(), b.get()));
+
+  // Writing in the copy doesn't modify the original image
+  put_pixel(b.get(), 3, 4, 1);
+  EXPECT_FALSE(b->isSharingBits());
+  EXPECT_EQ(0, get_pixel(a.get(), 3, 4));
+  EXPECT_EQ(1, get_pixel(b.get(), 3, 4));
+  EXPECT_EQ(1, get_pixel(b.get(), 1, 2));
+
+  // The original image isn't copied when it's written, it's the
+  // only owner of the pixels now
+  const uint8_t* addr = static_cast<const Image*>(a.get())->getPixelAddress(0, 0);
+  put_pixel(a.get(), 0, 0, 1);
+  EXPECT_FALSE(a->isSharingBits());
+  EXPECT_EQ(addr, a->getPixelAddress(0, 0));
+  EXPECT_EQ(0, get_pixel(b.get(), 0, 0));
+}
+
+TYPED_TEST(ImageAllTypes, SharedCopyIsDetachedByLockImageBits)
+{
+  using ImageTraits = TypeParam;
+
+  std::unique_ptr<Image> a(Image::create(ImageTraits::pixel_format, 5, 3));
+  clear_image(a.get(), 0);
+
+  std::unique_ptr<Image> b(Image::createSharedCopy(a.get()));
+  {
+    LockImageBits<ImageTraits> bits(a.get());
+    for (auto it=bits.begin(), end=bits.end(); it!=end; ++it)
+      *it = 1;
+  }
+  EXPECT_TRUE(is_plain_image(a.get(), 1));
+  EXPECT_TRUE(is_plain_image(b.get(), 0));
+}
+
+TYPED_TEST(ImageAllTypes, CompressBits)
+{
+  using ImageTraits = TypeParam;
+
+  std::unique_ptr<Image> a(Image::create(ImageTraits::pixel_format, 64, 64));
+  clear_image(a.get(), 0);
+  fill_rect(a.get(), 4, 5, 20, 30, 1);
+  std::unique_ptr<Image> b(Image::createCopy(a.get()));
+
+  const int memSize = a->getMemSize();
+  EXPECT_TRUE(a->compressBits());
+  EXPECT_TRUE(a->isCompressed());
+  EXPECT_LT(a->getMemSize(), memSize);
+  EXPECT_FALSE(a->compressBits());
+
+  // Pixels are uncompressed in the first access
+  EXPECT_EQ(1, get_pixel(a.get(), 4, 5));
+  EXPECT_FALSE(a->isCompressed());
+  EXPECT_EQ(memSize, a->getMemSize());
+  EXPECT_TRUE(is_same_image(a.get(), b.get()));
+
+  // Images that share pixels cannot be compressed
+  std::unique_ptr<Image> c(Image::createSharedCopy(a.get()));
+  EXPECT_FALSE(a->compressBits());
+  EXPECT_FALSE(c->compressBits());
+  c.reset();
+  EXPECT_TRUE(a->compressBits());
+
+  // Writing uncompresses the pixels too
+  put_pixel(a.get(), 0, 0, 1);
+  EXPECT_FALSE(a->isCompressed());
+  EXPECT_EQ(1, get_pixel(a.get(), 0, 0));
+  EXPECT_EQ(1, get_pixel(a.get(), 20, 30));
+  EXPECT_EQ(0, get_pixel(a.get(), 21, 30));
+}
+
+namespace {
+
+// Loads the pixels copying them from other image
+class CopyBitsLoader : public ImageBitsLoader {
+public:
+  CopyBitsLoader(const Image* src, bool ok) : m_src(Image::createCopy(src)), m_ok(ok) { }
+  bool loadBits(const Image* image, uint8_t* bits, std::size_t size) override {
+    ++calls;
+    if (!m_ok)
+      return false;
+    EXPECT_EQ(size, std::size_t(m_src->rowBytes()) * m_src->height());
+    std::copy(m_src->getPixelAddress(0, 0),
+              m_src->getPixelAddress(0, 0) + size, bits);
+    return true;
+  }
+  int calls = 0;
+private:
+  std::unique_ptr<Image> m_src;
+  bool m_ok;
+};
+
+} // anonymous namespace
+
+TYPED_TEST(ImageAllTypes, BitsLoader)
+{
+  using ImageTraits = TypeParam;
+
+  std::unique_ptr<Image> a(Image::create(ImageTraits::pixel_format, 64, 64));
+  clear_image(a.get(), 0);
+  fill_rect(a.get(), 4, 5, 20, 30, 1);
+  std::unique_ptr<Image> b(Image::create(ImageTraits::pixel_format, 64, 64));
+
+  auto loader = std::make_shared<CopyBitsLoader>(a.get(), true);
+  EXPECT_TRUE(b->setBitsLoader(loader));
+  EXPECT_TRUE(b->isCompressed());
+  EXPECT_TRUE(b->hasBitsLoader());
+  EXPECT_FALSE(b->compressBits());
+  EXPECT_EQ(0, loader->calls);
+
+  // Pixels are loaded in the first access (only once)
+  EXPECT_EQ(1, get_pixel(b.get(), 4, 5));
+  EXPECT_FALSE(b->isCompressed());
+  EXPECT_FALSE(b->hasBitsLoader());
+  EXPECT_TRUE(is_same_image(a.get(), b.get()));
+  EXPECT_EQ(1, loader->calls);
+
+  // An image that cannot be loaded is empty
+  std::unique_ptr<Image> c(Image::create(ImageTraits::pixel_format, 64, 64));
+  auto failLoader = std::make_shared<CopyBitsLoader>(a.get(), false);
+  EXPECT_TRUE(c->setBitsLoader(failLoader));
+  c->prefetchBits();
+  EXPECT_EQ(1, failLoader->calls);
+  EXPECT_FALSE(c->isCompressed());
+  EXPECT_EQ(0, get_pixel(c.get(), 4, 5));
+}
+
+namespace {
+
+// Loads the pixels reading them from other image (which can be
+// loaded on demand too)
+class ReadImageBitsLoader : public ImageBitsLoader {
+public:
+  ReadImageBitsLoader(const Image* src) : m_src(src) { }
+  bool loadBits(const Image* image, uint8_t* bits, std::size_t size) override {
+    std::copy(m_src->getPixelAddress(0, 0),
+              m_src->getPixelAddress(0, 0) + size, bits);
+    return true;
+  }
+private:
+  const Image* m_src;
+};
+
+} // anonymous namespace
+
+// Loading the pixels of one image doesn't lock the pixels of other
+// images
+TYPED_TEST(ImageAllTypes, BitsLoaderOfOtherImage)
+{
+  using ImageTraits = TypeParam;
+
+  std::unique_ptr<Image> a(Image::create(ImageTraits::pixel_format, 64, 64));
+  clear_image(a.get(), 0);
+  fill_rect(a.get(), 4, 5, 20, 30, 1);
+  std::unique_ptr<Image> b(Image::create(ImageTraits::pixel_format, 64, 64));
+  std::unique_ptr<Image> c(Image::create(ImageTraits::pixel_format, 64, 64));
+
+  EXPECT_TRUE(b->setBitsLoader(std::make_shared<CopyBitsLoader>(a.get(), true)));
+  EXPECT_TRUE(c->setBitsLoader(std::make_shared<ReadImageBitsLoader>(b.get())));
+
+  // Loads "c" which loads "b" from its loader
+  EXPECT_EQ(1, get_pixel(c.get(), 4, 5));
+  EXPECT_FALSE(b->isCompressed());
+  EXPECT_FALSE(c->isCompressed());
+  EXPECT_TRUE(is_same_image(a.get(), c.get()));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
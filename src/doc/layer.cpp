@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -15,6 +15,7 @@
 #include "doc/grid.h"
 #include "doc/image.h"
 #include "doc/primitives.h"
+#include "doc/remap.h"
 #include "doc/sprite.h"
 
 #include <algorithm>
@@ -270,13 +271,33 @@ void LayerImage::destroyAllCels()
     delete cel;
   }
   m_cels.clear();
+  m_celsByFrame.clear();
+}
+
+void LayerImage::indexCel(Cel* cel)
+{
+  const frame_t frame = cel->frame();
+  ASSERT(frame >= 0);
+  if (frame >= frame_t(m_celsByFrame.size()))
+    m_celsByFrame.resize(frame+1, nullptr);
+  m_celsByFrame[frame] = cel;
+}
+
+void LayerImage::unindexCel(Cel* cel)
+{
+  const frame_t frame = cel->frame();
+  if (frame >= 0 && frame < frame_t(m_celsByFrame.size()) &&
+      m_celsByFrame[frame] == cel) {
+    m_celsByFrame[frame] = nullptr;
+    while (!m_celsByFrame.empty() && !m_celsByFrame.back())
+      m_celsByFrame.pop_back();
+  }
 }
 
 Cel* LayerImage::cel(frame_t frame) const
 {
-  CelConstIterator it = findCelIterator(frame);
-  if (it != getCelEnd())
-    return *it;
+  if (frame >= 0 && frame < frame_t(m_celsByFrame.size()))
+    return m_celsByFrame[frame];
   else
     return nullptr;
 }
@@ -309,6 +330,10 @@ CelIterator LayerImage::findCelIterator(frame_t frame)
   auto first = getCelBegin();
   auto end = getCelEnd();
 
+  // There is no cel in this frame
+  if (!cel(frame))
+    return end;
+
   // Here we use a binary search to find the first cel equal to "frame" (or after frame)
   first = std::lower_bound(
     first, end, nullptr,
@@ -349,6 +374,7 @@ void LayerImage::addCel(Cel* cel)
 
   CelIterator it = findFirstCelIteratorAfter(cel->frame());
   m_cels.insert(it, cel);
+  indexCel(cel);
 
   cel->setParentLayer(this);
 }
@@ -366,6 +392,7 @@ void LayerImage::removeCel(Cel* cel)
   ASSERT(it != m_cels.end());
 
   m_cels.erase(it);
+  unindexCel(cel);
 
   cel->setParentLayer(NULL);
 }
@@ -414,6 +441,35 @@ void LayerImage::displaceFrames(frame_t fromThis, frame_t delta)
   }
 }
 
+void LayerImage::remapFrames(const Remap& remap)
+{
+  bool sorted = true;
+  frame_t prevFrame = -1;
+  for (Cel* cel : m_cels) {
+    const frame_t frame = remap[cel->frame()];
+    if (frame != cel->frame()) {
+      cel->setFrame(frame);
+      cel->incrementVersion();  // TODO this should be in app::cmd module
+    }
+    if (frame < prevFrame)
+      sorted = false;
+    prevFrame = frame;
+  }
+
+  // Sort the cels by frame again (instead of moving each cel with
+  // moveCel())
+  if (!sorted) {
+    std::sort(m_cels.begin(), m_cels.end(),
+              [](const Cel* a, const Cel* b) {
+                return a->frame() < b->frame();
+              });
+  }
+
+  m_celsByFrame.clear();
+  for (Cel* cel : m_cels)
+    indexCel(cel);
+}
+
 //////////////////////////////////////////////////////////////////////
 // LayerGroup class
 
@@ -590,4 +646,10 @@ void LayerGroup::displaceFrames(frame_t fromThis, frame_t delta)
     layer->displaceFrames(fromThis, delta);
 }
 
+void LayerGroup::remapFrames(const Remap& remap)
+{
+  for (Layer* layer : m_layers)
+    layer->remapFrames(remap);
+}
+
 } // namespace doc
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2021  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -26,6 +26,7 @@ namespace doc {
   class Layer;
   class LayerGroup;
   class LayerImage;
+  class Remap;
   class Sprite;
 
   //////////////////////////////////////////////////////////////////////
@@ -127,6 +128,10 @@ namespace doc {
     virtual void getCels(CelList& cels) const = 0;
     virtual void displaceFrames(frame_t fromThis, frame_t delta) = 0;
 
+    // Moves each cel from its frame to remap[frame] (remap must be a
+    // permutation of all sprite frames).
+    virtual void remapFrames(const Remap& remap) = 0;
+
   private:
     std::string m_name;           // layer name
     Sprite* m_sprite;             // owner of the layer
@@ -161,6 +166,7 @@ namespace doc {
     Cel* cel(frame_t frame) const override;
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void remapFrames(const Remap& remap) override;
 
     Cel* getLastCel() const;
     CelConstIterator findCelIterator(frame_t frame) const;
@@ -177,10 +183,17 @@ namespace doc {
 
   private:
     void destroyAllCels();
+    void indexCel(Cel* cel);
+    void unindexCel(Cel* cel);
 
     BlendMode m_blendmode;
     int m_opacity;
     CelList m_cels;   // List of all cels inside this layer used by frames.
+
+    // Cels indexed by frame (nullptr in frames without cel) to get
+    // the cel of a frame in O(1). Its size is the last frame with a
+    // cel + 1.
+    CelList m_celsByFrame;
   };
 
   //////////////////////////////////////////////////////////////////////
@@ -215,6 +228,7 @@ namespace doc {
 
     void getCels(CelList& cels) const override;
     void displaceFrames(frame_t fromThis, frame_t delta) override;
+    void remapFrames(const Remap& remap) override;
 
     bool isBrowsable() const override {
       return isGroup() && isExpanded() && !m_layers.empty();
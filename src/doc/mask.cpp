@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -12,35 +12,203 @@
 #include "doc/mask.h"
 
 #include "base/memory.h"
+#include "doc/algorithm/color_match.h"
 #include "doc/image_impl.h"
+#include "gfx/region.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 namespace doc {
 
 namespace {
 
+  // Rows of the bitmap are processed in words of 64 pixels (bit "x"
+  // of a word is the bit x%8 of the byte x/8 of the row).
+  using Word = uint64_t;
+  const int kWordBits = 64;
+  const int kWordBytes = 8;
+
+  inline int row_bytes(const int w) {
+    return (w + 7) / 8;
+  }
+
+  // Loads/stores the first "n" bytes (n <= 8) of a word.
+  inline Word load_word(const uint8_t* p, const int n) {
+    Word word = 0;
+    for (int j=0; j<n; ++j)
+      word |= Word(p[j]) << (8*j);
+    return word;
+  }
+
+  inline void store_word(uint8_t* p, const int n, const Word word) {
+    for (int j=0; j<n; ++j)
+      p[j] = uint8_t(word >> (8*j));
+  }
+
+  // Returns a word with the bits in [a, b) set (0 <= a <= b <= 64).
+  inline Word bits_range(const int a, const int b) {
+    if (a >= b)
+      return 0;
+    const Word hi = (b == kWordBits ? ~Word(0): (Word(1) << b) - 1);
+    return hi & ~((Word(1) << a) - 1);
+  }
+
+  // Returns the valid bits of the word "i" of a row of "w" pixels
+  // (bits after the width of the bitmap can contain anything).
+  inline Word row_word(const uint8_t* row, const int w, const int i) {
+    const int n = std::min(kWordBytes, row_bytes(w) - i*kWordBytes);
+    Word word = load_word(row + i*kWordBytes, n);
+    if ((i+1)*kWordBits > w)
+      word &= bits_range(0, w - i*kWordBits);
+    return word;
+  }
+
+  // Returns the 64 pixels of a row of "w" pixels starting from the
+  // pixel "x" (pixels outside the row are 0).
+  inline Word read_bits(const uint8_t* row, const int w, const int x) {
+    if (x >= 0 && x+kWordBits <= w) {
+      const int i = (x >> 3);
+      const int b = (x & 7);
+      const Word lo = load_word(row+i, kWordBytes);
+      if (b == 0)
+        return lo;
+      return (lo >> b) | (Word(row[i+kWordBytes]) << (kWordBits-b));
+    }
+
+    const int x1 = std::max(x, 0);
+    const int x2 = std::min(x+kWordBits, w);
+    if (x1 >= x2)
+      return 0;
+
+    Word word = 0;
+    for (int j=(x1 >> 3); j<=((x2-1) >> 3); ++j) {
+      const int s = 8*j - x;
+      if (s >= 0)
+        word |= Word(row[j]) << s;
+      else
+        word |= Word(row[j]) >> (-s);
+    }
+    return word & bits_range(x1-x, x2-x);
+  }
+
+  // Index of the first/last bit set in a non-zero word.
+  inline int first_bit(Word word) {
+    ASSERT(word);
+    int i = 0;
+    for (; (word & 0xff) == 0; word >>= 8) i += 8;
+    for (; (word & 1) == 0; word >>= 1) ++i;
+    return i;
+  }
+
+  inline int last_bit(Word word) {
+    ASSERT(word);
+    int i = kWordBits-1;
+    for (; (word >> 56) == 0; word <<= 8) i -= 8;
+    for (; (word >> 63) == 0; word <<= 1) --i;
+    return i;
+  }
+
+  // Sets (or clears) the pixels [x1, x2) of the row.
+  void fill_bits(uint8_t* row, const int x1, const int x2, const bool value) {
+    if (x1 >= x2)
+      return;
+
+    const int b1 = (x1 >> 3);
+    const int b2 = ((x2-1) >> 3);
+    uint8_t m1 = uint8_t(0xff << (x1 & 7));
+    const uint8_t m2 = uint8_t(0xff >> (7 - ((x2-1) & 7)));
+    if (b1 == b2)
+      m1 &= m2;
+
+    if (value)
+      row[b1] |= m1;
+    else
+      row[b1] &= ~m1;
+
+    if (b1 < b2) {
+      std::memset(row+b1+1, (value ? 0xff: 0), b2-b1-1);
+      if (value)
+        row[b2] |= m2;
+      else
+        row[b2] &= ~m2;
+    }
+  }
+
+  // Returns true if the row has some pixel set.
+  bool row_has_pixels(const uint8_t* row, const int w) {
+    const int words = (w + kWordBits - 1) / kWordBits;
+    for (int i=0; i<words; ++i) {
+      if (row_word(row, w, i))
+        return true;
+    }
+    return false;
+  }
+
+  // Calls f(aWord, bWord) for each word of each row of "a" (where
+  // bWord are the pixels of "b" in the same position of the canvas),
+  // and stores the result in "a".
   template<typename Func>
-  void for_each_mask_pixel(Mask& a, const Mask& b, Func f) {
-    a.reserve(b.bounds());
-
-    {
-      LockImageBits<BitmapTraits> aBits(a.bitmap());
-      auto aIt = aBits.begin();
-
-      auto bounds = a.bounds();
-      for (int y=0; y<bounds.h; ++y) {
-        for (int x=0; x<bounds.w; ++x, ++aIt) {
-          color_t aColor = *aIt;
-          color_t bColor = (b.containsPoint(bounds.x+x,
-                                            bounds.y+y) ? 1: 0);
-          *aIt = f(aColor, bColor);
-        }
+  void for_each_mask_word(Mask& a, const Mask& b, Func f) {
+    Image* aBitmap = a.bitmap();
+    const Image* bBitmap = b.bitmap();
+    const gfx::Rect aBounds = a.bounds();
+    const gfx::Rect bBounds = b.bounds();
+    const int bytes = row_bytes(aBounds.w);
+    const int words = (aBounds.w + kWordBits - 1) / kWordBits;
+    const int dx = aBounds.x - bBounds.x;
+
+    aBitmap->detachBits();
+    const Image* constBitmap = aBitmap;
+
+    for (int y=0; y<aBounds.h; ++y) {
+      uint8_t* aRow = constBitmap->getPixelAddress(0, y);
+      const int by = aBounds.y + y - bBounds.y;
+      const uint8_t* bRow =
+        (bBitmap && by >= 0 && by < bBounds.h ? bBitmap->getPixelAddress(0, by): nullptr);
+
+      for (int i=0; i<words; ++i) {
+        const int n = std::min(kWordBytes, bytes - i*kWordBytes);
+        const Word aWord = load_word(aRow + i*kWordBytes, n);
+        const Word bWord = (bRow ? read_bits(bRow, bBounds.w, i*kWordBits + dx): 0);
+        store_word(aRow + i*kWordBytes, n, f(aWord, bWord));
       }
     }
+  }
+
+  // Unites the given rectangles (sorted by rows) in a binary tree so
+  // each union merges regions of similar size.
+  gfx::Region union_of_rects(const std::vector<gfx::Rect>& rects,
+                             const std::size_t i,
+                             const std::size_t j) {
+    if (j - i == 1)
+      return gfx::Region(rects[i]);
+
+    const std::size_t k = (i + j) / 2;
+    gfx::Region rgn = union_of_rects(rects, i, k);
+    rgn |= union_of_rects(rects, k, j);
+    return rgn;
+  }
+
+  template<typename ImageTraits>
+  void mask_by_color_templ(const Image* src, Image* dst,
+                           const color_t color, const int fuzziness) {
+    using pixel_t = typename ImageTraits::pixel_t;
 
-    a.shrink();
+    const algorithm::ColorMatch<ImageTraits> match(color, fuzziness);
+    const int w = src->width();
+    const int h = src->height();
+
+    dst->detachBits();
+    const Image* constDst = dst;
+
+    for (int y=0; y<h; ++y) {
+      match.matchRow((const pixel_t*)src->getPixelAddress(0, y), w,
+                     constDst->getPixelAddress(0, y));
+    }
   }
 
 } // namespace namespace
@@ -100,12 +268,15 @@ bool Mask::isRectangular() const
   if (!m_bitmap)
     return false;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
-
-  for (; it != end; ++it) {
-    if (*it == 0)
-      return false;
+  const int w = m_bounds.w;
+  const int words = (w + kWordBits - 1) / kWordBits;
+  for (int y=0; y<m_bounds.h; ++y) {
+    const uint8_t* row = m_bitmap->getPixelAddress(0, y);
+    for (int i=0; i<words; ++i) {
+      const Word full = bits_range(0, std::min(kWordBits, w - i*kWordBits));
+      if (row_word(row, w, i) != full)
+        return false;
+    }
   }
 
   return true;
@@ -145,11 +316,22 @@ void Mask::invert()
   if (!m_bitmap)
     return;
 
-  LockImageBits<BitmapTraits> bits(m_bitmap.get());
-  LockImageBits<BitmapTraits>::iterator it = bits.begin(), end = bits.end();
+  const int bytes = row_bytes(m_bounds.w);
+  const int words = (m_bounds.w + kWordBits - 1) / kWordBits;
+
+  m_bitmap->detachBits();
+  const Image* bitmap = m_bitmap.get();
 
-  for (; it != end; ++it)
-    *it = (*it ? 0: 1);
+  for (int y=0; y<m_bounds.h; ++y) {
+    uint8_t* row = bitmap->getPixelAddress(0, y);
+    for (int i=0; i<words; ++i) {
+      const int n = std::min(kWordBytes, bytes - i*kWordBytes);
+      store_word(row + i*kWordBytes, n, ~load_word(row + i*kWordBytes, n));
+    }
+    // Keep the bits after the width of the bitmap cleared
+    if (m_bounds.w & 7)
+      row[bytes-1] &= uint8_t((1 << (m_bounds.w & 7)) - 1);
+  }
 
   shrink();
 }
@@ -169,32 +351,46 @@ void Mask::replace(const gfx::Rect& bounds)
 
 void Mask::add(const doc::Mask& mask)
 {
-  for_each_mask_pixel(
+  if (!mask.m_bitmap)
+    return;
+
+  reserve(mask.bounds());
+
+  for_each_mask_word(
     *this, mask,
-    [](color_t a, color_t b) -> color_t {
+    [](Word a, Word b) -> Word {
       return a | b;
     });
+
+  shrink();
 }
 
 void Mask::subtract(const doc::Mask& mask)
 {
-  for_each_mask_pixel(
+  if (!m_bitmap || !mask.m_bitmap)
+    return;
+
+  for_each_mask_word(
     *this, mask,
-    [](color_t a, color_t b) -> color_t {
-      if (a)
-        return a - b;
-      else
-        return 0;
+    [](Word a, Word b) -> Word {
+      return a & ~b;
     });
+
+  shrink();
 }
 
 void Mask::intersect(const doc::Mask& mask)
 {
-  for_each_mask_pixel(
+  if (!m_bitmap)
+    return;
+
+  for_each_mask_word(
     *this, mask,
-    [](color_t a, color_t b) -> color_t {
+    [](Word a, Word b) -> Word {
       return a & b;
     });
+
+  shrink();
 }
 
 void Mask::add(const gfx::Rect& bounds)
@@ -206,11 +402,15 @@ void Mask::add(const gfx::Rect& bounds)
   if (!m_bitmap)
     return;
 
-  fill_rect(m_bitmap.get(),
-            bounds.x-m_bounds.x,
-            bounds.y-m_bounds.y,
-            bounds.x-m_bounds.x+bounds.w-1,
-            bounds.y-m_bounds.y+bounds.h-1, 1);
+  gfx::Rect rc = bounds.createIntersection(m_bounds);
+  rc.offset(-m_bounds.x, -m_bounds.y);
+  if (rc.isEmpty())
+    return;
+
+  m_bitmap->detachBits();
+  const Image* bitmap = m_bitmap.get();
+  for (int y=rc.y; y<rc.y2(); ++y)
+    fill_bits(bitmap->getPixelAddress(0, y), rc.x, rc.x2(), true);
 }
 
 void Mask::subtract(const gfx::Rect& bounds)
@@ -218,11 +418,14 @@ void Mask::subtract(const gfx::Rect& bounds)
   if (!m_bitmap)
     return;
 
-  fill_rect(m_bitmap.get(),
-    bounds.x-m_bounds.x,
-    bounds.y-m_bounds.y,
-    bounds.x-m_bounds.x+bounds.w-1,
-    bounds.y-m_bounds.y+bounds.h-1, 0);
+  gfx::Rect rc = bounds.createIntersection(m_bounds);
+  rc.offset(-m_bounds.x, -m_bounds.y);
+  if (!rc.isEmpty()) {
+    m_bitmap->detachBits();
+    const Image* bitmap = m_bitmap.get();
+    for (int y=rc.y; y<rc.y2(); ++y)
+      fill_bits(bitmap->getPixelAddress(0, y), rc.x, rc.x2(), false);
+  }
 
   shrink();
 }
@@ -253,104 +456,31 @@ void Mask::intersect(const gfx::Rect& bounds)
 
 void Mask::byColor(const Image *src, int color, int fuzziness)
 {
-  replace(src->bounds());
+  if (src->bounds().isEmpty()) {
+    clear();
+    return;
+  }
+
+  // Each byte of the bitmap is completely written, so there is no
+  // need to clear the new bitmap.
+  m_bounds = src->bounds();
+  m_bitmap.reset(Image::create(IMAGE_BITMAP, m_bounds.w, m_bounds.h, m_buffer));
 
   Image* dst = m_bitmap.get();
 
   switch (src->pixelFormat()) {
-
-    case IMAGE_RGB: {
-      const LockImageBits<RgbTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<RgbTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_r, src_g, src_b, src_a;
-      int dst_r, dst_g, dst_b, dst_a;
-      color_t c;
-
-      dst_r = rgba_getr(color);
-      dst_g = rgba_getg(color);
-      dst_b = rgba_getb(color);
-      dst_a = rgba_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_r = rgba_getr(c);
-        src_g = rgba_getg(c);
-        src_b = rgba_getb(c);
-        src_a = rgba_geta(c);
-
-        if (!((src_r >= dst_r-fuzziness) && (src_r <= dst_r+fuzziness) &&
-              (src_g >= dst_g-fuzziness) && (src_g <= dst_g+fuzziness) &&
-              (src_b >= dst_b-fuzziness) && (src_b <= dst_b+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+    case IMAGE_RGB:
+      mask_by_color_templ<RgbTraits>(src, dst, color, fuzziness);
       break;
-    }
-
-    case IMAGE_GRAYSCALE: {
-      const LockImageBits<GrayscaleTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<GrayscaleTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      int src_k, src_a;
-      int dst_k, dst_a;
-      color_t c;
-
-      dst_k = graya_getv(color);
-      dst_a = graya_geta(color);
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        src_k = graya_getv(c);
-        src_a = graya_geta(c);
-
-        if (!((src_k >= dst_k-fuzziness) && (src_k <= dst_k+fuzziness) &&
-              (src_a >= dst_a-fuzziness) && (src_a <= dst_a+fuzziness)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+    case IMAGE_GRAYSCALE:
+      mask_by_color_templ<GrayscaleTraits>(src, dst, color, fuzziness);
       break;
-    }
-
-    case IMAGE_INDEXED: {
-      const LockImageBits<IndexedTraits> srcBits(src);
-      LockImageBits<BitmapTraits> dstBits(dst, Image::WriteLock);
-      LockImageBits<IndexedTraits>::const_iterator src_it = srcBits.begin(), src_end = srcBits.end();
-      LockImageBits<BitmapTraits>::iterator dst_it = dstBits.begin();
-#ifdef _DEBUG
-      LockImageBits<BitmapTraits>::iterator dst_end = dstBits.end();
-#endif
-      color_t c, min, max;
-
-      for (; src_it != src_end; ++src_it, ++dst_it) {
-        ASSERT(dst_it != dst_end);
-        c = *src_it;
-
-        if (color > fuzziness)
-          min = color-fuzziness;
-        else
-          min = 0;
-        max = color + fuzziness;
-
-        if (!((c >= min) && (c <= max)))
-          *dst_it = 0;
-      }
-      ASSERT(dst_it == dst_end);
+    case IMAGE_INDEXED:
+      mask_by_color_templ<IndexedTraits>(src, dst, color, fuzziness);
+      break;
+    default:
+      clear_image(dst, 1);
       break;
-    }
   }
 
   shrink();
@@ -452,50 +582,55 @@ void Mask::shrink()
   if (m_freeze_count > 0)
     return;
 
-#define SHRINK_SIDE(u_begin, u_op, u_final, u_add,                      \
-                    v_begin, v_op, v_final, v_add, U, V, var)           \
-  {                                                                     \
-    for (u = u_begin; u u_op u_final; u u_add) {                        \
-      for (v = v_begin; v v_op v_final; v v_add) {                      \
-        if (get_pixel_fast<BitmapTraits>(m_bitmap.get(), U, V))         \
-          break;                                                        \
-      }                                                                 \
-      if (v == v_final)                                                 \
-        var;                                                            \
-      else                                                              \
-        break;                                                          \
-    }                                                                   \
-  }
-
-  int u, v, x1, y1, x2, y2;
+  if (!m_bitmap)
+    return;
 
-  x1 = m_bounds.x;
-  y1 = m_bounds.y;
-  x2 = m_bounds.x+m_bounds.w-1;
-  y2 = m_bounds.y+m_bounds.h-1;
+  const Image* bitmap = m_bitmap.get();
+  const int w = m_bounds.w;
+  const int h = m_bounds.h;
+  const int words = (w + kWordBits - 1) / kWordBits;
 
-  SHRINK_SIDE(0, <, m_bounds.w, ++,
-              0, <, m_bounds.h, ++, u, v, x1++);
+  // First and last rows with pixels
+  int y1 = 0;
+  while (y1 < h && !row_has_pixels(bitmap->getPixelAddress(0, y1), w))
+    ++y1;
+  if (y1 == h) {
+    clear();
+    return;
+  }
 
-  SHRINK_SIDE(0, <, m_bounds.h, ++,
-              0, <, m_bounds.w, ++, v, u, y1++);
+  int y2 = h-1;
+  while (y2 > y1 && !row_has_pixels(bitmap->getPixelAddress(0, y2), w))
+    --y2;
 
-  SHRINK_SIDE(m_bounds.w-1, >, 0, --,
-              0, <, m_bounds.h, ++, u, v, x2--);
+  // First and last columns with pixels (each row is checked only
+  // before/after the columns that were already found)
+  int x1 = w, x2 = -1;
+  for (int y=y1; y<=y2; ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
 
-  SHRINK_SIDE(m_bounds.h-1, >, 0, --,
-              0, <, m_bounds.w, ++, v, u, y2--);
+    for (int i=0; i*kWordBits < x1; ++i) {
+      if (const Word word = row_word(row, w, i)) {
+        x1 = std::min(x1, i*kWordBits + first_bit(word));
+        break;
+      }
+    }
 
-  if ((x1 > x2) || (y1 > y2)) {
-    clear();
+    for (int i=words-1; i >= 0 && i*kWordBits+kWordBits-1 > x2; --i) {
+      if (const Word word = row_word(row, w, i)) {
+        x2 = std::max(x2, i*kWordBits + last_bit(word));
+        break;
+      }
+    }
   }
-  else if ((x1 != m_bounds.x) || (x2 != m_bounds.x+m_bounds.w-1) ||
-           (y1 != m_bounds.y) || (y2 != m_bounds.y+m_bounds.h-1)) {
-    u = m_bounds.x;
-    v = m_bounds.y;
+  ASSERT(x1 <= x2);
+
+  if (x1 != 0 || x2 != w-1 || y1 != 0 || y2 != h-1) {
+    const int u = m_bounds.x;
+    const int v = m_bounds.y;
 
-    m_bounds.x = x1;
-    m_bounds.y = y1;
+    m_bounds.x = u + x1;
+    m_bounds.y = v + y1;
     m_bounds.w = x2 - x1 + 1;
     m_bounds.h = y2 - y1 + 1;
 
@@ -505,8 +640,76 @@ void Mask::shrink()
       m_bounds.w, m_bounds.h, 0);
     m_bitmap.reset(image);
   }
+}
+
+void Mask::toRegion(gfx::Region& region) const
+{
+  region.clear();
+  if (!m_bitmap)
+    return;
+
+  const Image* bitmap = m_bitmap.get();
+  const int w = m_bounds.w;
+  const int words = (w + kWordBits - 1) / kWordBits;
+
+  // Runs of pixels of the current row, and the rectangles of the
+  // previous rows that are still growing (one for each run of the
+  // previous row, when it has the same runs as the current one).
+  std::vector<std::pair<int, int>> runs, prevRuns;
+  std::vector<gfx::Rect> rects;
+  std::size_t prevFirst = 0;
+
+  for (int y=0; y<m_bounds.h; ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    runs.clear();
+
+    // Find runs of 1s skipping words that are all 0s or all 1s
+    int start = -1;
+    for (int i=0; i<words; ++i) {
+      const int n = std::min(kWordBits, w - i*kWordBits);
+      const Word full = bits_range(0, n);
+      Word word = row_word(row, w, i);
+
+      if (word == (start >= 0 ? full: 0))
+        continue;
+
+      for (int b=0; b<n; ) {
+        if (start < 0) {
+          word &= bits_range(b, kWordBits);
+          if (!word)
+            break;
+          b = first_bit(word);
+          start = i*kWordBits + b;
+        }
+        else {
+          const Word zeros = ~word & bits_range(b, n);
+          if (!zeros)
+            break;
+          b = first_bit(zeros);
+          runs.emplace_back(start, i*kWordBits + b);
+          start = -1;
+        }
+      }
+    }
+    if (start >= 0)
+      runs.emplace_back(start, w);
+
+    // Same runs as the previous row, just grow its rectangles
+    if (y > 0 && runs == prevRuns) {
+      for (std::size_t i=prevFirst; i<rects.size(); ++i)
+        ++rects[i].h;
+      continue;
+    }
+
+    prevFirst = rects.size();
+    for (const auto& run : runs)
+      rects.push_back(gfx::Rect(m_bounds.x + run.first, m_bounds.y + y,
+                                run.second - run.first, 1));
+    std::swap(runs, prevRuns);
+  }
 
-#undef SHRINK_SIDE
+  if (!rects.empty())
+    region = union_of_rects(rects, 0, rects.size());
 }
 
 } // namespace doc
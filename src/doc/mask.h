@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -14,6 +14,7 @@
 #include "doc/image_ref.h"
 #include "doc/object.h"
 #include "doc/primitives.h"
+#include "gfx/fwd.h"
 #include "gfx/rect.h"
 
 #include <string>
@@ -106,6 +107,11 @@ namespace doc {
     // Displaces the mask bounds origin point.
     void offsetOrigin(int dx, int dy);
 
+    // Converts the selected pixels to a region (in sprite
+    // coordinates). Rows with the same runs of pixels are joined in
+    // the same rectangles.
+    void toRegion(gfx::Region& region) const;
+
   private:
     void initialize();
 
@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -10,333 +11,272 @@
 
 #include "doc/mask_boundaries.h"
 
-#include "doc/image_impl.h"
+#include "doc/image.h"
+#include "doc/parallel.h"
+#include "gfx/clip.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
 
 namespace doc {
 
+namespace {
+
+// Number of rows of each band of segments. Bands are aligned to
+// absolute coordinates, so they can be reused even when the origin
+// of the bitmap changes.
+const int kBandHeight = 64;
+
+// Minimum number of pixels to scan the modified bands in parallel
+const int kParallelMinPixels = 256*256;
+
+int floor_div(int a, int b)
+{
+  return (a >= 0 ? a / b: -((-a + b - 1) / b));
+}
+
+inline bool get_bit(const uint8_t* row, int x)
+{
+  return (row[x >> 3] & (1 << (x & 7))) ? true: false;
+}
+
+// Returns true if the absolute row "y" has the same pixels in both
+// bitmaps.
+bool same_row(const Image* a, const gfx::Point& aOrigin,
+              const Image* b, const gfx::Point& bOrigin,
+              int y)
+{
+  const int ay = y - aOrigin.y;
+  const int by = y - bOrigin.y;
+  const bool aInside = (ay >= 0 && ay < a->height());
+  const bool bInside = (by >= 0 && by < b->height());
+  if (!aInside && !bInside)
+    return true;
+
+  if (aInside && bInside &&
+      aOrigin.x == bOrigin.x &&
+      a->width() == b->width()) {
+    const uint8_t* aRow = a->getPixelAddress(0, ay);
+    const uint8_t* bRow = b->getPixelAddress(0, by);
+    const int w = a->width();
+    const int bytes = w / 8;
+    if (std::memcmp(aRow, bRow, bytes) != 0)
+      return false;
+
+    // Bits after the width of the image are ignored
+    if (w & 7) {
+      const int mask = (1 << (w & 7)) - 1;
+      return (((aRow[bytes] ^ bRow[bytes]) & mask) == 0);
+    }
+    return true;
+  }
+
+  // Compare pixel by pixel (the bounds of the bitmaps are different)
+  const uint8_t* aRow = (aInside ? a->getPixelAddress(0, ay): nullptr);
+  const uint8_t* bRow = (bInside ? b->getPixelAddress(0, by): nullptr);
+  const int x1 = std::min(aOrigin.x, bOrigin.x);
+  const int x2 = std::max(aOrigin.x + a->width(),
+                          bOrigin.x + b->width());
+  for (int x=x1; x<x2; ++x) {
+    const int ax = x - aOrigin.x;
+    const int bx = x - bOrigin.x;
+    const bool aColor = (aRow && ax >= 0 && ax < a->width() && get_bit(aRow, ax));
+    const bool bColor = (bRow && bx >= 0 && bx < b->width() && get_bit(bRow, bx));
+    if (aColor != bColor)
+      return false;
+  }
+  return true;
+}
+
+} // anonymous namespace
+
 void MaskBoundaries::reset()
 {
   m_segs.clear();
   if (!m_path.isEmpty())
     m_path.rewind();
+
+  m_bands.clear();
+  m_bitmap.reset();
+  ++m_version;
 }
 
 void MaskBoundaries::regen(const Image* bitmap)
 {
-  reset();
+  regen(bitmap, gfx::Point(0, 0));
+}
 
-  int x, y, w = bitmap->width(), h = bitmap->height();
+void MaskBoundaries::regen(const Image* bitmap, const gfx::Point& origin)
+{
+  ASSERT(bitmap->pixelFormat() == IMAGE_BITMAP);
 
-  const LockImageBits<BitmapTraits> bits(bitmap);
-  auto it = bits.begin();       // Current pixel iterator
-#if _DEBUG
-  auto prevIt = bits.begin();   // Previous row iterator (same X pos)
-#endif
+  const int w = bitmap->width();
+  const int h = bitmap->height();
 
-  // Vertical segments being expanded from the previous row.
-  std::vector<int> vertSegs(w+1, -1);
+  // Bands that include some boundary of this bitmap (the last
+  // horizontal line is in "origin.y + h")
+  const int b1 = floor_div(origin.y, kBandHeight);
+  const int b2 = floor_div(origin.y + h, kBandHeight);
+
+  std::map<int, list_type> bands;
+  std::vector<list_type*> dirtySegs;
+  std::vector<int> dirtyBands;
 
-  // Horizontal segment being expanded from the previous column.
-  int horzSeg;
+  for (int b=b1; b<=b2; ++b) {
+    list_type& segs = bands[b];
 
-#define new_hseg(open) {                                        \
-    m_segs.push_back(Segment(open, gfx::Rect(x, y, 1, 0)));     \
-    horzSeg = int(m_segs.size()-1);                             \
+    if (m_bitmap && sameBand(bitmap, origin, b)) {
+      auto it = m_bands.find(b);
+      if (it != m_bands.end())
+        segs = std::move(it->second);
+    }
+    else {
+      dirtySegs.push_back(&segs);
+      dirtyBands.push_back(b);
+    }
   }
-#define new_vseg(open) {                                        \
-    m_segs.push_back(Segment(open, gfx::Rect(x, y, 0, 1)));     \
-    vertSegs[x] = int(m_segs.size()-1);                         \
+
+  const int n = int(dirtyBands.size());
+  if (n > 1 && w*h >= kParallelMinPixels) {
+    parallel_for(
+      n,
+      [bitmap, origin, &dirtyBands, &dirtySegs](const int i){
+        scanBand(bitmap, origin, dirtyBands[i], *dirtySegs[i]);
+      });
   }
-#define expand_hseg() { \
-    ASSERT(hseg);       \
-    ++hseg->m_bounds.w; \
+  else {
+    for (int i=0; i<n; ++i)
+      scanBand(bitmap, origin, dirtyBands[i], *dirtySegs[i]);
   }
-#define expand_vseg() { \
-    ASSERT(vseg);       \
-    ++vseg->m_bounds.h; \
+
+  // Join the segments of all bands
+  std::size_t size = 0;
+  for (const auto& band : bands)
+    size += band.second.size();
+
+  m_segs.clear();
+  m_segs.reserve(size);
+  for (const auto& band : bands)
+    m_segs.insert(m_segs.end(), band.second.begin(), band.second.end());
+
+  if (!m_path.isEmpty())
+    m_path.rewind();
+  ++m_version;
+
+  // Keep a copy of the bitmap to compare it in the next regen()
+  m_bands = std::move(bands);
+  if (m_bitmap &&
+      m_bitmap->width() == w &&
+      m_bitmap->height() == h) {
+    m_bitmap->copy(bitmap, gfx::Clip(0, 0, 0, 0, w, h));
   }
-#define stop_expanding_hseg() {                 \
-    horzSeg = -1;                               \
+  else {
+    m_bitmap.reset(Image::createCopy(bitmap));
   }
-#define stop_expanding_vseg() {                 \
-    vertSegs[x] = -1;                           \
+  m_origin = origin;
+}
+
+// The boundaries of a band depend on its rows and the last row of
+// the previous band (for the horizontal segments in the first line
+// of the band).
+bool MaskBoundaries::sameBand(const Image* bitmap,
+                              const gfx::Point& origin,
+                              int band) const
+{
+  ASSERT(m_bitmap);
+
+  const int y1 = band*kBandHeight - 1;
+  const int y2 = (band+1)*kBandHeight;
+  for (int y=y1; y<y2; ++y) {
+    if (!same_row(bitmap, origin, m_bitmap.get(), m_origin, y))
+      return false;
   }
+  return true;
+}
 
-  for (y=0; y<=h; ++y) {
-    bool prevColor = false;         // Previous color (X-1) same Y row
-    horzSeg = -1;
+// Generates the segments of the given band. Each segment is a
+// maximal horizontal/vertical run of edges between 0 and 1 pixels
+// that enters (open) or leaves the boundaries. Vertical segments are
+// cut at the band limits.
+void MaskBoundaries::scanBand(const Image* bitmap,
+                              const gfx::Point& origin,
+                              int band,
+                              list_type& segs)
+{
+  const int w = bitmap->width();
+  const int h = bitmap->height();
 
-    for (x=0; x<=w; ++x) {
-      bool color = (x < w && y < h && *it ? true: false);
-#if _DEBUG
-      bool prevRowColor = (x < w && y > 0 && *prevIt ? true: false);
-#endif
-      Segment* hseg = (horzSeg >= 0 ? &m_segs[horzSeg]: nullptr);
-      Segment* vseg = (vertSegs[x] >= 0 ? &m_segs[vertSegs[x]]: nullptr);
-
-      //
-      // -   -
-      //
-      // -   1
-      //
-      if (color) {
-        //
-        // - | -
-        //   o
-        // -   1
-        //
-        if (vseg) {
-          //
-          // 0 | 1
-          //   o
-          // -   1
-          //
-          if (vseg->open()) {
-            ASSERT(prevRowColor);
-
-            //
-            // 0 | 1
-            // --x
-            // 1   1
-            //
-            if (hseg) {
-              ASSERT(hseg->open());
-              ASSERT(prevColor);
-              stop_expanding_hseg();
-              stop_expanding_vseg();
-            }
-            //
-            // 0 | 1
-            //   |
-            // 0 | 1
-            //   o
-            else {
-              ASSERT(!prevColor);
-              expand_vseg();
-            }
-          }
-          //
-          // 1 | 0
-          //   x--o
-          // -   1
-          //
-          else {
-            ASSERT(!prevRowColor);
-
-            //
-            // 1 | 0
-            // --x--o
-            // 0 | 1
-            //   o
-            if (hseg) {
-              ASSERT(!prevColor);
-              ASSERT(!hseg->open());
-              new_hseg(true);
-              new_vseg(true);
-            }
-            //
-            // 1 | 0
-            //   x--o
-            // 1   1
-            //
-            else {
-              ASSERT(prevColor);
-              new_hseg(true);
-              stop_expanding_vseg();
-            }
-          }
-        }
-        //
-        // -   -  (there is no vertical segment in this row, both colors are equal)
-        //
-        // -   1
-        //
+  // Lines of this band in bitmap coordinates
+  const int y1 = std::max(band*kBandHeight - origin.y, 0);
+  const int y2 = std::min((band+1)*kBandHeight - origin.y, h+1);
+
+  segs.clear();
+
+  // Horizontal segments (line "y" is between rows y-1 and y)
+  for (int y=y1; y<y2; ++y) {
+    const uint8_t* above = (y > 0 ? bitmap->getPixelAddress(0, y-1): nullptr);
+    const uint8_t* below = (y < h ? bitmap->getPixelAddress(0, y): nullptr);
+    int hseg = -1;
+
+    for (int x=0; x<w; ) {
+      // Skip 8 pixels without edges
+      if ((x & 7) == 0 && x+8 <= w &&
+          (above ? above[x >> 3]: 0) == (below ? below[x >> 3]: 0)) {
+        hseg = -1;
+        x += 8;
+        continue;
+      }
+
+      const bool a = (above && get_bit(above, x));
+      const bool c = (below && get_bit(below, x));
+      if (a != c) {
+        if (hseg >= 0 && segs[hseg].m_open == c)
+          ++segs[hseg].m_bounds.w;
         else {
-          //
-          // -   -
-          // --o
-          // -   1
-          //
-          if (hseg) {
-            //
-            // 0   0
-            // -----o
-            // 1   1
-            //
-            if (hseg->open()) {
-              ASSERT(prevColor);
-              expand_hseg();
-            }
-            //
-            // 1   1
-            // --x
-            // 0 | 1
-            //   o
-            else {
-              ASSERT(!prevColor);
-              stop_expanding_hseg();
-              new_vseg(true);
-            }
-          }
-          else {
-            //
-            // 1   1
-            //
-            // 1   1
-            //
-            if (prevColor) {
-              // Do nothing, we are inside boundaries
-            }
-            //
-            // 0   0
-            //    --o
-            // 0 | 1
-            //   o
-            else {
-              // First two segments of a corner
-              new_hseg(true);
-              new_vseg(true);
-            }
-          }
+          segs.push_back(Segment(c, gfx::Rect(origin.x+x, origin.y+y, 1, 0)));
+          hseg = int(segs.size()-1);
         }
       }
-      //
-      // -   -
-      //
-      // -   0
-      //
-      else {
-        //
-        // - | -
-        //   o
-        // -   0
-        //
-        if (vseg) {
-          //
-          // 0 | 1
-          //   o
-          // -   0
-          //
-          if (vseg->open()) {
-            ASSERT(prevRowColor);
-
-            //
-            // 0 | 1
-            // --x--o
-            // 1 | 0
-            //   o
-            if (hseg) {
-              ASSERT(hseg->open());
-              ASSERT(prevColor);
-              new_hseg(false);
-              new_vseg(false);
-            }
-            //
-            // 0 | 1
-            //   x--o
-            // 0   0
-            //
-            else {
-              ASSERT(!prevColor);
-              new_hseg(false);
-              stop_expanding_vseg();
-            }
-          }
-          //
-          // 1 | 0
-          //   o
-          // -   0
-          //
-          else {
-            ASSERT(!prevRowColor);
-
-            //
-            // 1 | 0
-            // --x
-            // 0   0
-            //
-            if (hseg) {
-              ASSERT(!prevColor);
-              stop_expanding_hseg();
-              stop_expanding_vseg();
-            }
-            //
-            // 1 | 0
-            //   |
-            // 1 | 0
-            //   o
-            else {
-              ASSERT(prevColor);
-              expand_vseg();
-            }
-          }
-        }
-        //
-        // -   -  (there is no vertical segment in this row, both colors are equal)
-        //
-        // -   0
-        //
+      else
+        hseg = -1;
+      ++x;
+    }
+  }
+
+  // Vertical segments (column "x" is between columns x-1 and x)
+  std::vector<int> vertSegs(w+1, -1);
+
+  for (int y=y1; y<std::min(y2, h); ++y) {
+    const uint8_t* row = bitmap->getPixelAddress(0, y);
+    bool prevColor = false;
+
+    for (int x=0; x<=w; ) {
+      // Skip 8 pixels of the same color as the previous one
+      if ((x & 7) == 0 && x+8 <= w &&
+          row[x >> 3] == (prevColor ? 0xff: 0)) {
+        std::fill(vertSegs.begin()+x, vertSegs.begin()+x+8, -1);
+        x += 8;
+        continue;
+      }
+
+      const bool color = (x < w && get_bit(row, x));
+      if (color != prevColor) {
+        int& vseg = vertSegs[x];
+        if (vseg >= 0 && segs[vseg].m_open == color)
+          ++segs[vseg].m_bounds.h;
         else {
-          //
-          // -   -
-          // --o
-          // -   0
-          //
-          if (hseg) {
-            //
-            // 0   0
-            // --x
-            // 1 | 0
-            //   o
-            if (hseg->open()) {
-              ASSERT(prevColor);
-              stop_expanding_hseg();
-              new_vseg(false);
-            }
-            //
-            // 1   1
-            // -----o
-            // 0   0
-            //
-            else {
-              ASSERT(!prevColor);
-              expand_hseg();
-            }
-          }
-          else {
-            //
-            // 1   1
-            //    --o
-            // 1 | 0
-            //   o
-            if (prevColor) {
-              new_hseg(false);
-              new_vseg(false);
-            }
-            //
-            // 0   0
-            //
-            // 0   0
-            //
-            else {
-              // Do nothing, we are inside boundaries
-            }
-          }
+          segs.push_back(Segment(color, gfx::Rect(origin.x+x, origin.y+y, 0, 1)));
+          vseg = int(segs.size()-1);
         }
       }
+      else
+        vertSegs[x] = -1;
 
       prevColor = color;
-      if (x < w) {
-#if _DEBUG
-        if (y > 0) ++prevIt;
-#endif
-        if (y < h) ++it;
-      }
+      ++x;
     }
   }
-
-  ASSERT(it == bits.end());
-  ASSERT(prevIt == bits.end());
 }
 
 void MaskBoundaries::offset(int x, int y)
@@ -345,6 +285,32 @@ void MaskBoundaries::offset(int x, int y)
     seg.offset(x, y);
 
   m_path.offset(x, y);
+  ++m_version;
+
+  // The cached bands are not valid anymore
+  m_bands.clear();
+  m_bitmap.reset();
+}
+
+gfx::Rect MaskBoundaries::bounds() const
+{
+  if (m_segs.empty())
+    return gfx::Rect();
+
+  // Segments have zero width or height, so we cannot use
+  // gfx::Rect::createUnion()
+  int x1 = std::numeric_limits<int>::max();
+  int y1 = std::numeric_limits<int>::max();
+  int x2 = std::numeric_limits<int>::min();
+  int y2 = std::numeric_limits<int>::min();
+  for (const Segment& seg : m_segs) {
+    const gfx::Rect& rc = seg.bounds();
+    x1 = std::min(x1, rc.x);
+    y1 = std::min(y1, rc.y);
+    x2 = std::max(x2, rc.x2());
+    y2 = std::max(y2, rc.y2());
+  }
+  return gfx::Rect(x1, y1, x2-x1, y2-y1);
 }
 
 void MaskBoundaries::createPathIfNeeeded()
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,9 +9,12 @@
 #define DOC_MASK_BOUNDARIES_H_INCLUDED
 #pragma once
 
+#include "doc/image_ref.h"
 #include "gfx/path.h"
+#include "gfx/point.h"
 #include "gfx/rect.h"
 
+#include <map>
 #include <vector>
 
 namespace doc {
@@ -47,6 +50,13 @@ namespace doc {
     void reset();
     void regen(const Image* bitmap);
 
+    // Generates the boundaries of the given bitmap placed at the
+    // given origin. The segments are generated in bands of rows, and
+    // the bands which rows are equal to the bitmap used in the
+    // previous call are reused (so a small change in a huge mask
+    // only scans the modified rows again).
+    void regen(const Image* bitmap, const gfx::Point& origin);
+
     const_iterator begin() const { return m_segs.begin(); }
     const_iterator end() const { return m_segs.end(); }
     iterator begin() { return m_segs.begin(); }
@@ -55,11 +65,37 @@ namespace doc {
     void offset(int x, int y);
     gfx::Path& path() { return m_path; }
 
+    // Incremented each time the segments change (reset(), regen(), or
+    // offset()), it can be used to know if the geometry of the
+    // boundaries (e.g. transformed to screen coordinates) must be
+    // generated again.
+    int version() const { return m_version; }
+
+    // Bounds of all segments.
+    gfx::Rect bounds() const;
+
     void createPathIfNeeeded();
 
   private:
+    static void scanBand(const Image* bitmap,
+                         const gfx::Point& origin,
+                         int band,
+                         list_type& segs);
+    bool sameBand(const Image* bitmap,
+                  const gfx::Point& origin,
+                  int band) const;
+
     list_type m_segs;
     gfx::Path m_path;
+    int m_version = 0;
+
+    // Segments of each band of rows (indexed by the band number in
+    // absolute coordinates), and a copy of the bitmap (and its
+    // origin) used to generate them. Bands that are not in the map
+    // don't have segments.
+    std::map<int, list_type> m_bands;
+    ImageRef m_bitmap;
+    gfx::Point m_origin;
   };
 
 } // namespace doc
@@ -0,0 +1,173 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/mask_boundaries.h"
+#include "doc/primitives.h"
+
+#include <algorithm>
+#include <set>
+#include <tuple>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+// Unit edge: x, y, vertical, open
+using Edge = std::tuple<int, int, bool, bool>;
+
+std::set<Edge> edges_from_boundaries(const MaskBoundaries& boundaries)
+{
+  std::set<Edge> edges;
+  for (const auto& seg : boundaries) {
+    const gfx::Rect rc = seg.bounds();
+    if (seg.vertical()) {
+      for (int y=rc.y; y<rc.y2(); ++y)
+        EXPECT_TRUE(edges.insert(Edge(rc.x, y, true, seg.open())).second);
+    }
+    else {
+      for (int x=rc.x; x<rc.x2(); ++x)
+        EXPECT_TRUE(edges.insert(Edge(x, rc.y, false, seg.open())).second);
+    }
+  }
+  return edges;
+}
+
+std::set<Edge> edges_from_bitmap(const Image* bitmap, const gfx::Point& origin)
+{
+  const int w = bitmap->width();
+  const int h = bitmap->height();
+  auto pixel = [bitmap, w, h](int x, int y) -> bool {
+    return (x >= 0 && y >= 0 && x < w && y < h && get_pixel(bitmap, x, y));
+  };
+
+  std::set<Edge> edges;
+  for (int y=0; y<=h; ++y) {
+    for (int x=0; x<=w; ++x) {
+      if (pixel(x, y-1) != pixel(x, y))
+        edges.insert(Edge(origin.x+x, origin.y+y, false, pixel(x, y)));
+      if (pixel(x-1, y) != pixel(x, y))
+        edges.insert(Edge(origin.x+x, origin.y+y, true, pixel(x, y)));
+    }
+  }
+  return edges;
+}
+
+std::vector<std::tuple<bool, int, int, int, int>> segments(const MaskBoundaries& boundaries)
+{
+  std::vector<std::tuple<bool, int, int, int, int>> result;
+  for (const auto& seg : boundaries) {
+    const gfx::Rect rc = seg.bounds();
+    result.emplace_back(seg.open(), rc.x, rc.y, rc.w, rc.h);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+void draw_pattern(Image* bitmap)
+{
+  clear_image(bitmap, 0);
+  for (int y=0; y<bitmap->height(); ++y)
+    for (int x=0; x<bitmap->width(); ++x)
+      if (((x/7) + (y/5)) % 3 == 0 || (x*x + y) % 11 == 0)
+        put_pixel(bitmap, x, y, 1);
+}
+
+} // anonymous namespace
+
+TEST(MaskBoundaries, OnePixel)
+{
+  ImageRef bitmap(Image::create(IMAGE_BITMAP, 1, 1));
+  clear_image(bitmap.get(), 1);
+
+  MaskBoundaries boundaries;
+  boundaries.regen(bitmap.get(), gfx::Point(3, 4));
+
+  auto expected = std::vector<std::tuple<bool, int, int, int, int>>{
+    { false, 3, 5, 1, 0 },
+    { false, 4, 4, 0, 1 },
+    { true, 3, 4, 0, 1 },
+    { true, 3, 4, 1, 0 } };
+  EXPECT_EQ(expected, segments(boundaries));
+  EXPECT_EQ(gfx::Rect(3, 4, 1, 1), boundaries.bounds());
+}
+
+TEST(MaskBoundaries, VersionAndBounds)
+{
+  ImageRef bitmap(Image::create(IMAGE_BITMAP, 20, 10));
+  clear_image(bitmap.get(), 0);
+  fill_rect(bitmap.get(), 2, 3, 7, 8, 1);
+
+  MaskBoundaries boundaries;
+  EXPECT_EQ(gfx::Rect(), boundaries.bounds());
+
+  int version = boundaries.version();
+  boundaries.regen(bitmap.get(), gfx::Point(10, 20));
+  EXPECT_NE(version, boundaries.version());
+  EXPECT_EQ(gfx::Rect(12, 23, 6, 6), boundaries.bounds());
+
+  version = boundaries.version();
+  boundaries.offset(-5, 1);
+  EXPECT_NE(version, boundaries.version());
+  EXPECT_EQ(gfx::Rect(7, 24, 6, 6), boundaries.bounds());
+
+  version = boundaries.version();
+  boundaries.reset();
+  EXPECT_NE(version, boundaries.version());
+  EXPECT_EQ(gfx::Rect(), boundaries.bounds());
+}
+
+TEST(MaskBoundaries, Edges)
+{
+  ImageRef bitmap(Image::create(IMAGE_BITMAP, 203, 301));
+  draw_pattern(bitmap.get());
+
+  MaskBoundaries boundaries;
+  boundaries.regen(bitmap.get(), gfx::Point(-70, 13));
+  EXPECT_EQ(edges_from_bitmap(bitmap.get(), gfx::Point(-70, 13)),
+            edges_from_boundaries(boundaries));
+}
+
+TEST(MaskBoundaries, IncrementalRegen)
+{
+  ImageRef bitmap(Image::create(IMAGE_BITMAP, 203, 301));
+  draw_pattern(bitmap.get());
+
+  MaskBoundaries boundaries;
+  boundaries.regen(bitmap.get(), gfx::Point(5, 10));
+
+  // Modify some rows
+  fill_rect(bitmap.get(), 20, 130, 80, 140, 1);
+  fill_rect(bitmap.get(), 100, 53, 110, 53, 0);
+  boundaries.regen(bitmap.get(), gfx::Point(5, 10));
+
+  MaskBoundaries full;
+  full.regen(bitmap.get(), gfx::Point(5, 10));
+  EXPECT_EQ(segments(full), segments(boundaries));
+  EXPECT_EQ(edges_from_bitmap(bitmap.get(), gfx::Point(5, 10)),
+            edges_from_boundaries(boundaries));
+
+  // Bigger bitmap with the same pixels in a different origin
+  ImageRef bigger(Image::create(IMAGE_BITMAP, 250, 400));
+  clear_image(bigger.get(), 0);
+  copy_image(bigger.get(), bitmap.get(), 30, 70);
+  put_pixel(bigger.get(), 0, 0, 1);
+  boundaries.regen(bigger.get(), gfx::Point(5-30, 10-70));
+
+  MaskBoundaries full2;
+  full2.regen(bigger.get(), gfx::Point(5-30, 10-70));
+  EXPECT_EQ(segments(full2), segments(boundaries));
+  EXPECT_EQ(edges_from_bitmap(bigger.get(), gfx::Point(5-30, 10-70)),
+            edges_from_boundaries(boundaries));
+}
@@ -0,0 +1,217 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/image.h"
+#include "doc/image_ref.h"
+#include "doc/mask.h"
+#include "doc/primitives.h"
+#include "gfx/region.h"
+
+#include <random>
+#include <vector>
+
+using namespace doc;
+using namespace gfx;
+
+namespace {
+
+// Pixels of the canvas in [-kOrigin, kSize-kOrigin)
+const int kSize = 600;
+const int kOrigin = 300;
+
+using Pixels = std::vector<char>;
+
+char& pixel(Pixels& pixels, int x, int y)
+{
+  return pixels[(y+kOrigin)*kSize + x+kOrigin];
+}
+
+Pixels pixels_from_mask(const Mask& mask)
+{
+  Pixels pixels(kSize*kSize, 0);
+  if (!mask.isEmpty()) {
+    const Rect bounds = mask.bounds();
+    for (int y=0; y<bounds.h; ++y)
+      for (int x=0; x<bounds.w; ++x)
+        if (get_pixel(mask.bitmap(), x, y))
+          pixel(pixels, bounds.x+x, bounds.y+y) = 1;
+  }
+  return pixels;
+}
+
+Pixels pixels_from_region(const Region& rgn)
+{
+  Pixels pixels(kSize*kSize, 0);
+  for (const Rect& rc : rgn)
+    for (int y=rc.y; y<rc.y2(); ++y)
+      for (int x=rc.x; x<rc.x2(); ++x)
+        pixel(pixels, x, y) = 1;
+  return pixels;
+}
+
+Rect random_rect(std::mt19937& rand)
+{
+  std::uniform_int_distribution<int> pos(-150, 150);
+  std::uniform_int_distribution<int> size(1, 140);
+  return Rect(pos(rand), pos(rand), size(rand), size(rand));
+}
+
+void add_rect(Mask& mask, Pixels& pixels, const Rect& rc)
+{
+  mask.add(rc);
+  for (int y=rc.y; y<rc.y2(); ++y)
+    for (int x=rc.x; x<rc.x2(); ++x)
+      pixel(pixels, x, y) = 1;
+}
+
+void expect_shrunk(const Mask& mask)
+{
+  if (mask.isEmpty())
+    return;
+
+  const Image* bitmap = mask.bitmap();
+  const Rect bounds = mask.bounds();
+  bool top = false, bottom = false, left = false, right = false;
+  for (int x=0; x<bounds.w; ++x) {
+    top |= (get_pixel(bitmap, x, 0) != 0);
+    bottom |= (get_pixel(bitmap, x, bounds.h-1) != 0);
+  }
+  for (int y=0; y<bounds.h; ++y) {
+    left |= (get_pixel(bitmap, 0, y) != 0);
+    right |= (get_pixel(bitmap, bounds.w-1, y) != 0);
+  }
+  EXPECT_TRUE(top && bottom && left && right);
+}
+
+} // anonymous namespace
+
+TEST(Mask, Invert)
+{
+  Mask mask;
+  mask.replace(Rect(2, 3, 70, 5));
+  mask.subtract(Rect(2, 3, 70, 1));
+  mask.subtract(Rect(10, 3, 60, 5));
+  EXPECT_EQ(Rect(2, 4, 8, 4), mask.bounds());
+
+  mask.invert();
+  EXPECT_TRUE(mask.isEmpty());
+
+  mask.replace(Rect(0, 0, 100, 3));
+  mask.subtract(Rect(1, 1, 98, 1));
+  mask.invert();
+  EXPECT_EQ(Rect(1, 1, 98, 1), mask.bounds());
+  EXPECT_TRUE(mask.isRectangular());
+}
+
+TEST(Mask, SetOperations)
+{
+  std::mt19937 rand(2026);
+  std::uniform_int_distribution<int> count(1, 3);
+  std::uniform_int_distribution<int> operation(0, 5);
+
+  for (int i=0; i<200; ++i) {
+    Mask a;
+    Pixels pixels(kSize*kSize, 0);
+    for (int j=count(rand); j>0; --j)
+      add_rect(a, pixels, random_rect(rand));
+
+    for (int j=0; j<5; ++j) {
+      const int op = operation(rand);
+      if (op <= 2) {
+        Mask b;
+        Pixels bPixels(kSize*kSize, 0);
+        for (int k=count(rand); k>0; --k)
+          add_rect(b, bPixels, random_rect(rand));
+
+        for (std::size_t k=0; k<pixels.size(); ++k) {
+          switch (op) {
+            case 0: pixels[k] |= bPixels[k]; break;
+            case 1: pixels[k] &= !bPixels[k]; break;
+            case 2: pixels[k] &= bPixels[k]; break;
+          }
+        }
+        switch (op) {
+          case 0: a.add(b); break;
+          case 1: a.subtract(b); break;
+          case 2: a.intersect(b); break;
+        }
+      }
+      else if (op == 3) {
+        add_rect(a, pixels, random_rect(rand));
+      }
+      else if (op == 4) {
+        const Rect rc = random_rect(rand);
+        for (int y=rc.y; y<rc.y2(); ++y)
+          for (int x=rc.x; x<rc.x2(); ++x)
+            pixel(pixels, x, y) = 0;
+        a.subtract(rc);
+      }
+      else {
+        const Rect bounds = a.bounds();
+        for (int y=bounds.y; y<bounds.y2(); ++y)
+          for (int x=bounds.x; x<bounds.x2(); ++x)
+            pixel(pixels, x, y) = !pixel(pixels, x, y);
+        a.invert();
+      }
+
+      ASSERT_EQ(pixels, pixels_from_mask(a)) << "op=" << op;
+      expect_shrunk(a);
+
+      Region rgn;
+      a.toRegion(rgn);
+      EXPECT_EQ(pixels, pixels_from_region(rgn));
+    }
+  }
+}
+
+TEST(Mask, ByColor)
+{
+  ImageRef image(Image::create(IMAGE_INDEXED, 131, 67));
+  for (int y=0; y<image->height(); ++y)
+    for (int x=0; x<image->width(); ++x)
+      put_pixel(image.get(), x, y, (x*7 + y*3) % 5);
+
+  Mask mask;
+  mask.byColor(image.get(), 2, 1);
+
+  for (int y=0; y<image->height(); ++y) {
+    for (int x=0; x<image->width(); ++x) {
+      const color_t c = get_pixel(image.get(), x, y);
+      EXPECT_EQ(c >= 1 && c <= 3, mask.containsPoint(x, y)) << x << "," << y;
+    }
+  }
+  expect_shrunk(mask);
+
+  // No pixel with the given color
+  mask.byColor(image.get(), 10, 0);
+  EXPECT_TRUE(mask.isEmpty());
+  EXPECT_EQ(Rect(0, 0, 0, 0), mask.bounds());
+}
+
+TEST(Mask, ToRegion)
+{
+  Mask mask;
+  mask.replace(Rect(10, 20, 100, 50));
+  mask.subtract(Rect(30, 30, 10, 10));
+
+  Region rgn;
+  mask.toRegion(rgn);
+
+  Region expected(Rect(10, 20, 100, 50));
+  expected.createSubtraction(expected, Region(Rect(30, 30, 10, 10)));
+
+  Region diff;
+  diff.createSubtraction(expected, rgn);
+  EXPECT_TRUE(diff.isEmpty());
+  diff.createSubtraction(rgn, expected);
+  EXPECT_TRUE(diff.isEmpty());
+
+  mask.clear();
+  mask.toRegion(rgn);
+  EXPECT_TRUE(rgn.isEmpty());
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,15 +13,80 @@
 
 #include "base/debug.h"
 
-#include <map>
+#include <memory>
 #include <mutex>
+#include <shared_mutex>
+#include <vector>
 
 namespace doc {
 
-static std::mutex g_mutex;
-static ObjectId newId = 0;
-// TODO Profile this and see if an unordered_map is better
-static std::map<ObjectId, Object*> objects;
+namespace {
+
+// Objects are stored in segments of kSegmentSize pointers indexed
+// directly by ID (IDs are assigned sequentially). A segment is
+// allocated when its first object is registered and deleted when all
+// its objects are unregistered (except the segment of the newest IDs,
+// to avoid allocating it again and again when temporary objects are
+// created and destroyed).
+constexpr int kSegmentBits = 12;
+constexpr ObjectId kSegmentSize = (1 << kSegmentBits);
+constexpr ObjectId kSegmentMask = (kSegmentSize - 1);
+
+struct Segment {
+  Object* objects[kSegmentSize] = { };
+  int count = 0;
+};
+
+// Lookups (get_object()) use a shared lock so worker threads can
+// resolve IDs concurrently, the exclusive lock is only needed to
+// register/unregister objects.
+std::shared_mutex g_mutex;
+ObjectId newId = 0;
+std::vector<std::unique_ptr<Segment>> segments;
+
+// Must be called with the shared or exclusive lock
+Object* find_object(const ObjectId id)
+{
+  const std::size_t s = (id >> kSegmentBits);
+  if (s < segments.size() && segments[s])
+    return segments[s]->objects[id & kSegmentMask];
+  return nullptr;
+}
+
+// Must be called with the exclusive lock
+void insert_object(const ObjectId id, Object* obj)
+{
+  const std::size_t s = (id >> kSegmentBits);
+  if (s >= segments.size())
+    segments.resize(s+1);
+
+  std::unique_ptr<Segment>& segment = segments[s];
+  if (!segment)
+    segment = std::make_unique<Segment>();
+
+  Object*& entry = segment->objects[id & kSegmentMask];
+  if (!entry)
+    ++segment->count;
+  entry = obj;
+}
+
+// Must be called with the exclusive lock
+void erase_object(const ObjectId id)
+{
+  const std::size_t s = (id >> kSegmentBits);
+  if (s >= segments.size() || !segments[s])
+    return;
+
+  std::unique_ptr<Segment>& segment = segments[s];
+  Object*& entry = segment->objects[id & kSegmentMask];
+  if (entry) {
+    entry = nullptr;
+    if (--segment->count == 0 && s != (newId >> kSegmentBits))
+      segment.reset();
+  }
+}
+
+} // anonymous namespace
 
 Object::Object(ObjectType type)
   : m_type(type)
@@ -51,46 +116,36 @@ int Object::getMemSize() const
 const ObjectId Object::id() const
 {
   // The first time the ID is request, we store the object in the
-  // "objects" hash table.
+  // objects table.
   if (!m_id) {
-    const std::lock_guard lock(g_mutex);
+    const std::unique_lock lock(g_mutex);
     m_id = ++newId;
-    objects.insert(std::make_pair(m_id, const_cast<Object*>(this)));
+    insert_object(m_id, const_cast<Object*>(this));
   }
   return m_id;
 }
 
 void Object::setId(ObjectId id)
 {
-  const std::lock_guard lock(g_mutex);
+  const std::unique_lock lock(g_mutex);
 
   if (m_id) {
-    auto it = objects.find(m_id);
-    ASSERT(it != objects.end());
-    ASSERT(it->second == this);
-    if (it != objects.end())
-      objects.erase(it);
+    ASSERT(find_object(m_id) == this);
+    erase_object(m_id);
   }
 
   m_id = id;
 
   if (m_id) {
 #ifdef _DEBUG
-    if (objects.find(m_id) != objects.end()) {
-      Object* obj = objects.find(m_id)->second;
-      if (obj) {
-        TRACEARGS("ASSERT FAILED: Object with id", m_id,
-                  "of kind", int(obj->type()),
-                  "version", obj->version(), "should not exist");
-      }
-      else {
-        TRACEARGS("ASSERT FAILED: Object with id", m_id,
-                  "registered as nullptr should not exist");
-      }
+    if (Object* obj = find_object(m_id)) {
+      TRACEARGS("ASSERT FAILED: Object with id", m_id,
+                "of kind", int(obj->type()),
+                "version", obj->version(), "should not exist");
     }
-    ASSERT(objects.find(m_id) == objects.end());
+    ASSERT(find_object(m_id) == nullptr);
 #endif
-    objects.insert(std::make_pair(m_id, this));
+    insert_object(m_id, this);
   }
 }
 
@@ -101,12 +156,8 @@ void Object::setVersion(ObjectVersion version)
 
 Object* get_object(ObjectId id)
 {
-  const std::lock_guard lock(g_mutex);
-  auto it = objects.find(id);
-  if (it != objects.end())
-    return it->second;
-  else
-    return nullptr;
+  const std::shared_lock lock(g_mutex);
+  return find_object(id);
 }
 
 } // namespace doc
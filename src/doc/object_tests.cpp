@@ -0,0 +1,113 @@
+// Aseprite Document Library
+// Copyright (c) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include <gtest/gtest.h>
+
+#include "doc/object.h"
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+class TestObject : public Object {
+public:
+  TestObject() : Object(ObjectType::Unknown) { }
+};
+
+} // anonymous namespace
+
+TEST(Object, GetById)
+{
+  TestObject a, b;
+  EXPECT_EQ(nullptr, get_object(NullId));
+  EXPECT_EQ(&a, get<TestObject>(a.id()));
+  EXPECT_EQ(&b, get<TestObject>(b.id()));
+  EXPECT_NE(a.id(), b.id());
+
+  ObjectId id;
+  {
+    TestObject c;
+    id = c.id();
+    EXPECT_EQ(&c, get_object(id));
+  }
+  EXPECT_EQ(nullptr, get_object(id));
+}
+
+TEST(Object, SetId)
+{
+  ObjectId id;
+  {
+    TestObject a;
+    id = a.id();
+  }
+
+  // Restore an object with an old ID (e.g. undoing a deleted object)
+  TestObject b;
+  b.setId(id);
+  EXPECT_EQ(&b, get_object(id));
+
+  b.setId(0);
+  EXPECT_EQ(nullptr, get_object(id));
+}
+
+TEST(Object, ManyObjects)
+{
+  std::vector<std::unique_ptr<TestObject>> objs;
+  for (int i=0; i<20000; ++i) {
+    objs.push_back(std::make_unique<TestObject>());
+    objs.back()->id();
+  }
+  for (auto& obj : objs)
+    EXPECT_EQ(obj.get(), get_object(obj->id()));
+
+  std::vector<ObjectId> ids;
+  for (auto& obj : objs)
+    ids.push_back(obj->id());
+  objs.clear();
+  for (ObjectId id : ids)
+    EXPECT_EQ(nullptr, get_object(id));
+}
+
+TEST(Object, ConcurrentLookups)
+{
+  std::vector<std::unique_ptr<TestObject>> objs;
+  for (int i=0; i<1000; ++i) {
+    objs.push_back(std::make_unique<TestObject>());
+    objs.back()->id();
+  }
+
+  std::atomic<int> errors(0);
+  std::vector<std::thread> threads;
+  for (int t=0; t<4; ++t) {
+    threads.emplace_back([&objs, &errors]{
+      for (int n=0; n<100; ++n)
+        for (auto& obj : objs)
+          if (get_object(obj->id()) != obj.get())
+            ++errors;
+    });
+  }
+
+  // Create and destroy objects while other threads look up IDs
+  for (int n=0; n<1000; ++n) {
+    TestObject tmp;
+    tmp.id();
+  }
+
+  for (auto& thread : threads)
+    thread.join();
+  EXPECT_EQ(0, errors);
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
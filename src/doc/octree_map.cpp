@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2020-2023 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -271,6 +271,22 @@ int OctreeMap::mapColor(color_t rgba) const
                          m_palette, 0);
 }
 
+void OctreeMap::mapColors(const color_t* in, uint8_t* out, const int n) const
+{
+  for (int i=0; i<n; ) {
+    const color_t c = in[i];
+    const uint8_t index = m_root.mapColor(rgba_getr(c),
+                                          rgba_getg(c),
+                                          rgba_getb(c),
+                                          rgba_geta(c),
+                                          m_maskIndex,
+                                          m_palette, 0);
+    do {
+      out[i++] = index;
+    } while (i < n && in[i] == c);
+  }
+}
+
 void OctreeMap::regenerateMap(const Palette* palette, const int maskIndex)
 {
   ASSERT(palette);
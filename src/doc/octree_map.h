@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (c) 2020-2022 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -137,6 +137,7 @@ public:
   // RgbMap impl
   void regenerateMap(const Palette* palette, const int maskIndex) override;
   int mapColor(color_t rgba) const override;
+  void mapColors(const color_t* in, uint8_t* out, const int n) const override;
   int maskIndex() const override { return m_maskIndex; }
   int mapColor(const int r, const int g,
                const int b, const int a) const
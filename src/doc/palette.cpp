@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2023 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -142,6 +142,14 @@ void Palette::setEntry(int i, color_t color)
   ++m_modifications;
 }
 
+void Palette::setEntries(const color_t* colors, int n)
+{
+  ASSERT(n >= 0);
+
+  m_colors.assign(colors, colors+n);
+  ++m_modifications;
+}
+
 void Palette::copyColorsTo(Palette* dst) const
 {
   dst->m_colors = m_colors;
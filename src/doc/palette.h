@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2020-2023  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -81,6 +81,10 @@ namespace doc {
     void setEntry(int i, color_t color);
     void addEntry(color_t color);
 
+    // Resizes the palette to "n" entries and copies the given colors
+    // (faster than adding the entries one by one).
+    void setEntries(const color_t* colors, int n);
+
     void copyColorsTo(Palette* dst) const;
 
     int countDiff(const Palette* other, int* from, int* to) const;
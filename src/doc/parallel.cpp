@@ -0,0 +1,143 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/parallel.h"
+
+#include "base/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+namespace doc {
+
+namespace {
+
+// State of one parallel_for() call. It's shared with the tasks
+// because a task can start after parallel_for() returns (when the
+// pool was busy and other threads processed all the items).
+struct ParallelFor {
+  const std::function<void(int)>* func;
+  int n;
+  std::atomic<int> next { 0 };
+  std::mutex mutex;
+  std::condition_variable cv;
+  int done = 0;
+
+  ParallelFor(const std::function<void(int)>* func, int n)
+    : func(func), n(n) { }
+
+  void run() {
+    int count = 0;
+    for (int i; (i = next++) < n; ++count)
+      (*func)(i);
+
+    if (count > 0) {
+      const std::lock_guard lock(mutex);
+      done += count;
+      if (done == n)
+        cv.notify_one();
+    }
+  }
+};
+
+base::thread_pool& parallel_thread_pool()
+{
+  static base::thread_pool pool(parallel_threads());
+  return pool;
+}
+
+// True in the threads of the pool, where we cannot just wait for
+// other tasks of the pool
+thread_local bool t_poolThread = false;
+
+} // anonymous namespace
+
+int parallel_threads()
+{
+  static const int threads = std::max(1, int(std::thread::hardware_concurrency()));
+  return threads;
+}
+
+void parallel_for(const int n,
+                  const std::function<void(int)>& func,
+                  const std::function<void()>& wait)
+{
+  const int threads = std::min(n, parallel_threads());
+  if (threads < 2) {
+    for (int i=0; i<n; ++i)
+      func(i);
+    return;
+  }
+
+  const bool waitOnly = (wait && !t_poolThread);
+  auto state = std::make_shared<ParallelFor>(&func, n);
+
+  base::thread_pool& pool = parallel_thread_pool();
+  for (int t=(waitOnly ? 0: 1); t<threads; ++t) {
+    pool.execute(
+      [state]{
+        t_poolThread = true;
+        state->run();
+      });
+  }
+
+  if (!waitOnly)
+    state->run();
+
+  std::unique_lock lock(state->mutex);
+  if (waitOnly) {
+    while (!state->cv.wait_for(lock, std::chrono::milliseconds(50),
+                               [&state]{ return state->done == state->n; })) {
+      lock.unlock();
+      wait();
+      lock.lock();
+    }
+  }
+  else {
+    state->cv.wait(lock, [&state]{ return state->done == state->n; });
+  }
+}
+
+void parallel_for_bands(const int begin, const int end, const int bands,
+                        const std::function<void(int, int)>& func)
+{
+  const int n = end - begin;
+  if (bands <= 1 || n < 2) {
+    func(begin, end);
+    return;
+  }
+
+  const int m = std::min(bands, n);
+  parallel_for(
+    m,
+    [begin, n, m, &func](const int i){
+      func(begin + int(int64_t(n)*i/m),
+           begin + int(int64_t(n)*(i+1)/m));
+    });
+}
+
+int parallel_bands(const int w, const int h,
+                   const int minPixels,
+                   const int minRowsPerBand,
+                   const int bandsPerThread)
+{
+  if (int64_t(w)*h < minPixels || parallel_threads() == 1)
+    return 1;
+  return std::clamp(h / minRowsPerBand,
+                    1, parallel_threads()*bandsPerThread);
+}
+
+} // namespace doc
@@ -0,0 +1,49 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_PARALLEL_H_INCLUDED
+#define DOC_PARALLEL_H_INCLUDED
+#pragma once
+
+#include <functional>
+
+namespace doc {
+
+  // Number of threads of the thread pool shared by all the
+  // algorithms that process images in parallel.
+  int parallel_threads();
+
+  // Calls func(i) for each i in [0, n) using the shared thread pool
+  // and returns when all the calls have finished.
+  //
+  // The calling thread takes items too, so this can be called from
+  // a task of the same pool (e.g. resizing the rows of each image in
+  // parallel when the images are resized in parallel) without
+  // deadlocks. If "wait" is given, the calling thread doesn't take
+  // items, and calls wait() each 50 milliseconds until all items are
+  // done (e.g. to report the progress or cancel the tasks).
+  void parallel_for(int n,
+                    const std::function<void(int)>& func,
+                    const std::function<void()>& wait = nullptr);
+
+  // Calls func(i1, i2) for "bands" consecutive sub-ranges of [begin,
+  // end) in parallel (or just func(begin, end) if bands <= 1).
+  void parallel_for_bands(int begin, int end, int bands,
+                          const std::function<void(int, int)>& func);
+
+  // Returns the number of bands of rows in which an area of w*h
+  // pixels should be split to process it in parallel: 1 band if it
+  // has less than "minPixels", in other case "bandsPerThread" bands
+  // per thread (so threads that finish first can take the remaining
+  // ones) with at least "minRowsPerBand" rows each.
+  int parallel_bands(int w, int h,
+                     int minPixels,
+                     int minRowsPerBand,
+                     int bandsPerThread);
+
+} // namespace doc
+
+#endif
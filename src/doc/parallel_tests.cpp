@@ -0,0 +1,77 @@
+// Aseprite Document Library
+// Copyright (c) 2026  Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#include "gtest/gtest.h"
+
+#include "doc/parallel.h"
+
+#include <atomic>
+#include <vector>
+
+using namespace doc;
+
+TEST(Parallel, CallsEachIndexOnce)
+{
+  for (int n : { 0, 1, 2, 3, 17, 1000 }) {
+    std::vector<std::atomic<int>> calls(n);
+    parallel_for(n, [&calls](const int i){ ++calls[i]; });
+    for (int i=0; i<n; ++i)
+      EXPECT_EQ(1, calls[i].load()) << "n=" << n << " i=" << i;
+  }
+}
+
+TEST(Parallel, BandsCoverTheRange)
+{
+  for (int bands : { 0, 1, 2, 7, 64, 200 }) {
+    std::vector<std::atomic<int>> rows(100);
+    parallel_for_bands(
+      10, 110, bands,
+      [&rows](const int y1, const int y2){
+        EXPECT_LE(y1, y2);
+        for (int y=y1; y<y2; ++y)
+          ++rows[y-10];
+      });
+    for (int y=0; y<100; ++y)
+      EXPECT_EQ(1, rows[y].load()) << "bands=" << bands << " y=" << y;
+  }
+}
+
+// Tasks of the thread pool can use parallel_for() again (e.g. to
+// resize each image in parallel bands when several images are resized
+// in parallel)
+TEST(Parallel, NestedCalls)
+{
+  const int n = 4*parallel_threads();
+  std::atomic<int> calls(0);
+  parallel_for(
+    n,
+    [&calls](int){
+      parallel_for(n, [&calls](int){ ++calls; });
+    });
+  EXPECT_EQ(n*n, calls.load());
+}
+
+TEST(Parallel, WaitFromCallingThread)
+{
+  const int n = 2*parallel_threads();
+  std::atomic<int> calls(0);
+  parallel_for(
+    n,
+    [&calls](int){ ++calls; },
+    []{ });
+  EXPECT_EQ(n, calls.load());
+}
+
+TEST(Parallel, Bands)
+{
+  EXPECT_EQ(1, parallel_bands(16, 16, 256*256, 16, 4));
+  EXPECT_EQ(1, parallel_bands(1024, 8, 256, 16, 4));
+
+  const int bands = parallel_bands(1024, 1024, 256*256, 16, 4);
+  EXPECT_LE(1, bands);
+  EXPECT_LE(bands, 4*parallel_threads());
+  EXPECT_LE(bands, 1024/16);
+}
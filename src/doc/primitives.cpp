@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,11 +11,15 @@
 
 #include "doc/primitives.h"
 
+#include "doc/algorithm/reverse_pixels.h"
 #include "doc/algo.h"
+#include "doc/blend_span.h"
 #include "doc/brush.h"
 #include "doc/dispatch.h"
 #include "doc/image_impl.h"
 #include "doc/palette.h"
+#include "doc/palette_picks.h"
+#include "doc/parallel.h"
 #include "doc/remap.h"
 #include "doc/rgbmap.h"
 #include "doc/tile.h"
@@ -23,10 +27,17 @@
 
 #include <city.h>
 
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #if defined(__x86_64__) || defined(_WIN64)
   #include <emmintrin.h>
+  #define DOC_USE_SSE2_COMPARISONS 1
 #endif
 
 namespace doc {
@@ -45,8 +56,10 @@ void put_pixel(Image* image, int x, int y, color_t color)
 {
   ASSERT(image);
 
-  if ((x >= 0) && (y >= 0) && (x < image->width()) && (y < image->height()))
+  if ((x >= 0) && (y >= 0) && (x < image->width()) && (y < image->height())) {
+    image->detachBits();
     image->putPixel(x, y, color);
+  }
 }
 
 void clear_image(Image* image, color_t color)
@@ -91,6 +104,27 @@ void blend_image_templ(Image* dst,
     *dstIt = blender(*dstIt, *srcIt, opacity);
 }
 
+// Specialized version for RGBA images which blends each scanline
+// with a span blender.
+static void blend_image_rgba(Image* dst,
+                             const Image* src,
+                             const int x, const int y,
+                             const int opacity,
+                             BlendSpanFunc blender)
+{
+  gfx::Clip area = gfx::Clip(x, y, 0, 0, src->width(), src->height());
+  if (!area.clip(dst->width(), dst->height(), src->width(), src->height()))
+    return;
+
+  // get_pixel_address_fast() doesn't detach the pixels
+  dst->detachBits();
+  for (int v=0; v<area.size.h; ++v) {
+    blender(get_pixel_address_fast<RgbTraits>(dst, area.dst.x, area.dst.y+v),
+            get_pixel_address_fast<RgbTraits>(src, area.src.x, area.src.y+v),
+            area.size.w, opacity);
+  }
+}
+
 void blend_image(Image* dst, const Image* src, const int x, const int y,
                  const int opacity,
                  const doc::BlendMode blendMode)
@@ -99,8 +133,8 @@ void blend_image(Image* dst, const Image* src, const int x, const int y,
   BlendFunc blender;
   switch (src->pixelFormat()) {
     case IMAGE_RGB:
-      blender = get_rgba_blender(blendMode, true);
-      return blend_image_templ<RgbTraits>(dst, src, x, y, opacity, blender);
+      return blend_image_rgba(dst, src, x, y, opacity,
+                              get_rgba_span_blender(blendMode, true));
     case IMAGE_GRAYSCALE:
       blender = get_graya_blender(blendMode, true);
       return blend_image_templ<GrayscaleTraits>(dst, src, x, y, opacity, blender);
@@ -139,18 +173,97 @@ Image* crop_image(const Image* image, const gfx::Rect& bounds, color_t bg, const
   return crop_image(image, bounds.x, bounds.y, bounds.w, bounds.h, bg, buffer);
 }
 
+// Size of the square blocks of pixels used to rotate 90 degrees (so
+// the source and destination rows of a block stay in the cache)
+const int kRotateBlockSize = 64;
+
+template<typename ImageTraits>
+static void rotate_image_templ(const Image* src, Image* dst, int angle)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  const int w = src->width();
+  const int h = src->height();
+
+  // Detach the bits just one time and then write the rows through the
+  // const image
+  dst->detachBits();
+  const Image* constDst = dst;
+
+  auto srcRow = [src](int y) { return (const pixel_t*)src->getPixelAddress(0, y); };
+  auto dstRow = [constDst](int y) { return (pixel_t*)constDst->getPixelAddress(0, y); };
+
+  if (angle == 180) {
+    for (int y=0; y<h; ++y)
+      algorithm::reverse_copy_pixels(srcRow(y), srcRow(y)+w, dstRow(h-y-1));
+    return;
+  }
+
+  const pixel_t* rows[kRotateBlockSize];
+  for (int by=0; by<h; by+=kRotateBlockSize) {
+    const int n = std::min(kRotateBlockSize, h-by);
+    for (int i=0; i<n; ++i)
+      rows[i] = srcRow(by+i);
+
+    for (int bx=0; bx<w; bx+=kRotateBlockSize) {
+      const int bx2 = std::min(bx+kRotateBlockSize, w);
+      for (int x=bx; x<bx2; ++x) {
+        if (angle == 90) {
+          // src(x, y) -> dst(h-y-1, x)
+          pixel_t* d = dstRow(x) + h-by-1;
+          for (int i=0; i<n; ++i)
+            *(d-i) = rows[i][x];
+        }
+        else {
+          // src(x, y) -> dst(y, w-x-1)
+          pixel_t* d = dstRow(w-x-1) + by;
+          for (int i=0; i<n; ++i)
+            d[i] = rows[i][x];
+        }
+      }
+    }
+  }
+}
+
 void rotate_image(const Image* src, Image* dst, int angle)
 {
   ASSERT(src);
   ASSERT(dst);
-  int x, y;
+  ASSERT(src->pixelFormat() == dst->pixelFormat());
 
   switch (angle) {
 
     case 180:
       ASSERT(dst->width() == src->width());
       ASSERT(dst->height() == src->height());
+      break;
+
+    case 90:
+    case -90:
+      ASSERT(dst->width() == src->height());
+      ASSERT(dst->height() == src->width());
+      break;
+
+    // bad angle
+    default:
+      throw std::invalid_argument("Invalid angle specified to rotate the image");
+  }
+
+  switch (src->pixelFormat()) {
+    case IMAGE_RGB:       rotate_image_templ<RgbTraits>(src, dst, angle); return;
+    case IMAGE_GRAYSCALE: rotate_image_templ<GrayscaleTraits>(src, dst, angle); return;
+    case IMAGE_INDEXED:   rotate_image_templ<IndexedTraits>(src, dst, angle); return;
+    case IMAGE_TILEMAP:   rotate_image_templ<TilemapTraits>(src, dst, angle); return;
+    default:
+      break;
+  }
 
+  // Bitmaps (e.g. the selection)
+  dst->detachBits();
+  int x, y;
+  switch (angle) {
+
+    case 180:
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(src->width() - x - 1,
@@ -158,26 +271,16 @@ void rotate_image(const Image* src, Image* dst, int angle)
       break;
 
     case 90:
-      ASSERT(dst->width() == src->height());
-      ASSERT(dst->height() == src->width());
-
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(src->height() - y - 1, x, src->getPixel(x, y));
       break;
 
     case -90:
-      ASSERT(dst->width() == src->height());
-      ASSERT(dst->height() == src->width());
-
       for (y=0; y<src->height(); ++y)
         for (x=0; x<src->width(); ++x)
           dst->putPixel(y, src->width() - x - 1, src->getPixel(x, y));
       break;
-
-    // bad angle
-    default:
-      throw std::invalid_argument("Invalid angle specified to rotate the image");
   }
 }
 
@@ -218,6 +321,7 @@ void draw_vline(Image* image, int x, int y1, int y2, color_t color)
   if (y1 < 0) y1 = 0;
   if (y2 >= image->height()) y2 = image->height()-1;
 
+  image->detachBits();
   for (t=y1; t<=y2; t++)
     image->putPixel(x, t, color);
 }
@@ -399,68 +503,119 @@ bool is_same_image_templ(const Image* i1, const Image* i2)
   return true;
 }
 
+#if DOC_USE_SSE2_COMPARISONS
+// Compares 16 bytes of "p" and "q" (unaligned) by pixels of the given
+// size, returns 0xffff if all pixels are equal.
+template<int BytesPerPixel>
+inline int cmpeq_16bytes(const void* p, const void* q)
+{
+  const __m128i a = _mm_loadu_si128((const __m128i*)p);
+  const __m128i b = _mm_loadu_si128((const __m128i*)q);
+  if constexpr (BytesPerPixel == 4)
+    return _mm_movemask_epi8(_mm_cmpeq_epi32(a, b));
+  else if constexpr (BytesPerPixel == 2)
+    return _mm_movemask_epi8(_mm_cmpeq_epi16(a, b));
+  else
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+#endif
+
+// The following functions compare whole rows of pixels, 16 bytes at
+// a time when SSE2 is available. Pixels that are not bitwise equal
+// are checked again with ImageTraits::same_color() (e.g. two
+// transparent RGBA pixels with different RGB values are the same
+// color). They cannot be used with BitmapTraits.
+
 template<typename ImageTraits>
-bool is_same_image_simd_templ(const Image* i1, const Image* i2)
+bool is_plain_image_rows_templ(const Image* img, const color_t color)
 {
-  using address_t = typename ImageTraits::address_t;
-  const int w = i1->width();
-  const int h = i1->height();
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = img->width();
+  const int h = img->height();
+  const pixel_t c = pixel_t(color);
+
+#if DOC_USE_SSE2_COMPARISONS
+  constexpr int N = 16 / sizeof(pixel_t);
+  pixel_t colors[N];
+  std::fill(colors, colors+N, c);
+#endif
+
   for (int y=0; y<h; ++y) {
-    auto p = (const address_t)i1->getPixelAddress(0, y);
-    auto q = (const address_t)i2->getPixelAddress(0, y);
+    auto p = (const pixel_t*)img->getPixelAddress(0, y);
     int x = 0;
 
-#if DOC_USE_ALIGNED_PIXELS
-#if defined(__x86_64__) || defined(_WIN64)
-    // Use SSE2
-
-    if constexpr (ImageTraits::bytes_per_pixel == 4) {
-      for (; x+4<=w; x+=4, p+=4, q+=4) {
-        __m128i r = _mm_cmpeq_epi32(*(const __m128i*)p, *(const __m128i*)q);
-        if (_mm_movemask_epi8(r) != 0xffff) { // !_mm_test_all_ones(r)
-          if (!ImageTraits::same_color(p[0], q[0]) ||
-              !ImageTraits::same_color(p[1], q[1]) ||
-              !ImageTraits::same_color(p[2], q[2]) ||
-              !ImageTraits::same_color(p[3], q[3]))
+#if DOC_USE_SSE2_COMPARISONS
+    for (; x+N<=w; x+=N, p+=N) {
+      if (cmpeq_16bytes<sizeof(pixel_t)>(p, colors) != 0xffff) {
+        for (int i=0; i<N; ++i)
+          if (!ImageTraits::same_color(p[i], c))
             return false;
-        }
       }
     }
-    else if constexpr (ImageTraits::bytes_per_pixel == 2) {
-      for (; x+8<=w; x+=8, p+=8, q+=8) {
-        __m128i r = _mm_cmpeq_epi16(*(const __m128i*)p, *(const __m128i*)q);
-        if (_mm_movemask_epi8(r) != 0xffff) { // !_mm_test_all_ones(r)
-          if (!ImageTraits::same_color(p[0], q[0]) ||
-              !ImageTraits::same_color(p[1], q[1]) ||
-              !ImageTraits::same_color(p[2], q[2]) ||
-              !ImageTraits::same_color(p[3], q[3]) ||
-              !ImageTraits::same_color(p[4], q[4]) ||
-              !ImageTraits::same_color(p[5], q[5]) ||
-              !ImageTraits::same_color(p[6], q[6]) ||
-              !ImageTraits::same_color(p[7], q[7]))
-            return false;
-        }
-      }
+#endif
+
+    for (; x<w; ++x, ++p) {
+      if (!ImageTraits::same_color(*p, c))
+        return false;
     }
-    else if constexpr (ImageTraits::bytes_per_pixel == 1) {
-      for (; x+16<=w; x+=16, p+=16, q+=16) {
-        __m128i r = _mm_cmpeq_epi8(*(const __m128i*)p, *(const __m128i*)q);
-        if (_mm_movemask_epi8(r) != 0xffff) { // !_mm_test_all_ones(r)
-          return false;
-        }
+  }
+  return true;
+}
+
+template<typename ImageTraits>
+int count_diff_between_images_rows_templ(const Image* i1, const Image* i2)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = i1->width();
+  const int h = i1->height();
+  int diff = 0;
+
+  for (int y=0; y<h; ++y) {
+    auto p = (const pixel_t*)i1->getPixelAddress(0, y);
+    auto q = (const pixel_t*)i2->getPixelAddress(0, y);
+    int x = 0;
+
+#if DOC_USE_SSE2_COMPARISONS
+    constexpr int N = 16 / sizeof(pixel_t);
+    for (; x+N<=w; x+=N, p+=N, q+=N) {
+      if (cmpeq_16bytes<sizeof(pixel_t)>(p, q) != 0xffff) {
+        for (int i=0; i<N; ++i)
+          if (!ImageTraits::same_color(p[i], q[i]))
+            ++diff;
       }
     }
 #endif
-#endif  // DOC_USE_ALIGNED_PIXELS
-    {
-      for (; x+4<=w; x+=4, p+=4, q+=4) {
-        if (!ImageTraits::same_color(p[0], q[0]) ||
-            !ImageTraits::same_color(p[1], q[1]) ||
-            !ImageTraits::same_color(p[2], q[2]) ||
-            !ImageTraits::same_color(p[3], q[3]))
-          return false;
+
+    for (; x<w; ++x, ++p, ++q) {
+      if (!ImageTraits::same_color(*p, *q))
+        ++diff;
+    }
+  }
+  return diff;
+}
+
+template<typename ImageTraits>
+bool is_same_image_simd_templ(const Image* i1, const Image* i2)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = i1->width();
+  const int h = i1->height();
+
+  for (int y=0; y<h; ++y) {
+    auto p = (const pixel_t*)i1->getPixelAddress(0, y);
+    auto q = (const pixel_t*)i2->getPixelAddress(0, y);
+    int x = 0;
+
+#if DOC_USE_SSE2_COMPARISONS
+    constexpr int N = 16 / sizeof(pixel_t);
+    for (; x+N<=w; x+=N, p+=N, q+=N) {
+      if (cmpeq_16bytes<sizeof(pixel_t)>(p, q) != 0xffff) {
+        for (int i=0; i<N; ++i)
+          if (!ImageTraits::same_color(p[i], q[i]))
+            return false;
       }
     }
+#endif
 
     for (; x<w; ++x, ++p, ++q) {
       if (!ImageTraits::same_color(*p, *q))
@@ -475,11 +630,11 @@ bool is_same_image_simd_templ(const Image* i1, const Image* i2)
 bool is_plain_image(const Image* img, color_t c)
 {
   switch (img->pixelFormat()) {
-    case IMAGE_RGB:       return is_plain_image_templ<RgbTraits>(img, c);
-    case IMAGE_GRAYSCALE: return is_plain_image_templ<GrayscaleTraits>(img, c);
-    case IMAGE_INDEXED:   return is_plain_image_templ<IndexedTraits>(img, c);
+    case IMAGE_RGB:       return is_plain_image_rows_templ<RgbTraits>(img, c);
+    case IMAGE_GRAYSCALE: return is_plain_image_rows_templ<GrayscaleTraits>(img, c);
+    case IMAGE_INDEXED:   return is_plain_image_rows_templ<IndexedTraits>(img, c);
     case IMAGE_BITMAP:    return is_plain_image_templ<BitmapTraits>(img, c);
-    case IMAGE_TILEMAP:   return is_plain_image_templ<TilemapTraits>(img, c);
+    case IMAGE_TILEMAP:   return is_plain_image_rows_templ<TilemapTraits>(img, c);
   }
   return false;
 }
@@ -500,11 +655,11 @@ int count_diff_between_images(const Image* i1, const Image* i2)
     return -1;
 
   switch (i1->pixelFormat()) {
-    case IMAGE_RGB:       return count_diff_between_images_templ<RgbTraits>(i1, i2);
-    case IMAGE_GRAYSCALE: return count_diff_between_images_templ<GrayscaleTraits>(i1, i2);
-    case IMAGE_INDEXED:   return count_diff_between_images_templ<IndexedTraits>(i1, i2);
+    case IMAGE_RGB:       return count_diff_between_images_rows_templ<RgbTraits>(i1, i2);
+    case IMAGE_GRAYSCALE: return count_diff_between_images_rows_templ<GrayscaleTraits>(i1, i2);
+    case IMAGE_INDEXED:   return count_diff_between_images_rows_templ<IndexedTraits>(i1, i2);
     case IMAGE_BITMAP:    return count_diff_between_images_templ<BitmapTraits>(i1, i2);
-    case IMAGE_TILEMAP:   return count_diff_between_images_templ<TilemapTraits>(i1, i2);
+    case IMAGE_TILEMAP:   return count_diff_between_images_rows_templ<TilemapTraits>(i1, i2);
   }
 
   ASSERT(false);
@@ -548,37 +703,220 @@ bool is_same_image(const Image* i1, const Image* i2)
   return false;
 }
 
-void remap_image(Image* image, const Remap& remap)
+namespace {
+
+// Minimum number of pixels to remap several images in parallel
+const int kRemapParallelMinPixels = 256*256;
+
+// Calls func(i) for each i in [0, n) in the shared thread pool (or
+// in this thread if "parallel" is false).
+template<typename Func>
+void for_each_remap_task(const int n, const bool parallel, Func&& func)
 {
-  ASSERT(image->pixelFormat() == IMAGE_INDEXED ||
-         image->pixelFormat() == IMAGE_TILEMAP);
+  if (parallel) {
+    parallel_for(n, func);
+    return;
+  }
+  for (int i=0; i<n; ++i)
+    func(i);
+}
+
+// Remap of indexed images as a look-up table
+struct IndexedRemap {
+  uint8_t lut[256];
+  bool changes[256];
+
+  IndexedRemap(const Remap& remap) {
+    for (int i=0; i<256; ++i) {
+      const int to = remap[i];
+      lut[i] = uint8_t(to != Remap::kUnused ? to: i);
+      changes[i] = (lut[i] != i);
+    }
+  }
+};
+
+inline color_t remap_tile(const Remap& remap, const color_t c)
+{
+  auto to = remap[tile_geti(c)];
+  if (c == notile || to == Remap::kNoTile)
+    return notile;
+  else if (to != Remap::kUnused)
+    return tile(to, tile_getf(c));
+  else
+    return c;
+}
+
+// Returns the palette entries/tile indexes used in the image (cached
+// in the image until its pixels are modified).
+std::shared_ptr<const PalettePicks> used_entries(const Image* image)
+{
+  if (auto usedEntries = image->cachedUsedEntries())
+    return usedEntries;
+
+  const int w = image->width();
+  const int h = image->height();
+  std::vector<char> used;
 
   switch (image->pixelFormat()) {
-    case IMAGE_INDEXED:
-      transform_image<IndexedTraits>(
-        image, [&remap](color_t c) -> color_t {
-          auto to = remap[c];
-          if (to != Remap::kUnused)
-            return to;
-          else
-            return c;
-        });
+    case IMAGE_INDEXED: {
+      used.resize(256, 0);
+      for (int y=0; y<h; ++y) {
+        const uint8_t* row = image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x)
+          used[row[x]] = 1;
+      }
       break;
-    case IMAGE_TILEMAP:
-      transform_image<TilemapTraits>(
-        image, [&remap](color_t c) -> color_t {
-          auto to = remap[tile_geti(c)];
-          if (c == notile || to == Remap::kNoTile)
-            return notile;
-          else if (to != Remap::kUnused)
-            return tile(to, tile_getf(c));
-          else
-            return c;
-        });
+    }
+    case IMAGE_TILEMAP: {
+      for (int y=0; y<h; ++y) {
+        auto row = (const TilemapTraits::pixel_t*)image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x) {
+          const tile_index ti = tile_geti(row[x]);
+          if (ti >= used.size())
+            used.resize(ti+1, 0);
+          used[ti] = 1;
+        }
+      }
+      break;
+    }
+  }
+
+  auto usedEntries = std::make_shared<PalettePicks>(int(used.size()));
+  for (int i=0; i<int(used.size()); ++i) {
+    if (used[i])
+      (*usedEntries)[i] = true;
+  }
+  image->setCachedUsedEntries(usedEntries);
+  return usedEntries;
+}
+
+// Returns true if the remap changes some pixel of the image, i.e. if
+// the image uses some entry that is remapped to other value.
+bool remap_changes_image(const Image* image, const Remap& remap)
+{
+  const auto usedEntries = used_entries(image);
+  const int n = usedEntries->size();
+
+  switch (image->pixelFormat()) {
+    case IMAGE_INDEXED: {
+      const IndexedRemap indexed(remap);
+      for (int i=0; i<n; ++i) {
+        if ((*usedEntries)[i] && indexed.changes[i])
+          return true;
+      }
+      break;
+    }
+    case IMAGE_TILEMAP: {
+      // Index 0 can be notile (which is never remapped) or the tile
+      // 0 with flags, so we consider it changed if it's remapped to
+      // other value.
+      for (int i=0; i<n; ++i) {
+        const int to = remap[i];
+        if ((*usedEntries)[i] && to != Remap::kUnused && to != i)
+          return true;
+      }
+      break;
+    }
+  }
+  return false;
+}
+
+// Remaps the pixels of the image, which must be already detached
+// (this can be called from several threads for different images).
+void remap_detached_image(const Image* image, const Remap& remap)
+{
+  const int w = image->width();
+  const int h = image->height();
+
+  switch (image->pixelFormat()) {
+    case IMAGE_INDEXED: {
+      const IndexedRemap indexed(remap);
+      for (int y=0; y<h; ++y) {
+        uint8_t* row = image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x)
+          row[x] = indexed.lut[row[x]];
+      }
+      break;
+    }
+    case IMAGE_TILEMAP: {
+      for (int y=0; y<h; ++y) {
+        auto row = (TilemapTraits::pixel_t*)image->getPixelAddress(0, y);
+        for (int x=0; x<w; ++x)
+          row[x] = remap_tile(remap, row[x]);
+      }
       break;
+    }
+  }
+}
+
+} // anonymous namespace
+
+void remap_image(Image* image, const Remap& remap)
+{
+  ASSERT(image->pixelFormat() == IMAGE_INDEXED ||
+         image->pixelFormat() == IMAGE_TILEMAP);
+
+  // Avoid detaching/modifying images that don't use remapped entries
+  if (!remap_changes_image(image, remap))
+    return;
+
+  image->detachBits();
+  remap_detached_image(image, remap);
+}
+
+void get_used_entries(const Image* image, PalettePicks& usedEntries)
+{
+  ASSERT(image->pixelFormat() == IMAGE_INDEXED ||
+         image->pixelFormat() == IMAGE_TILEMAP);
+
+  const auto used = used_entries(image);
+  const int n = std::min(used->size(), usedEntries.size());
+  for (int i=0; i<n; ++i) {
+    if ((*used)[i])
+      usedEntries[i] = true;
   }
 }
 
+void remap_images(std::vector<ImageRef>& images, const Remap& remap)
+{
+  const int n = int(images.size());
+
+  std::size_t pixels = 0;
+  for (const ImageRef& image : images) {
+    ASSERT(image->pixelFormat() == IMAGE_INDEXED ||
+           image->pixelFormat() == IMAGE_TILEMAP);
+    pixels += std::size_t(image->width()) * image->height();
+  }
+  const bool parallel = (pixels >= kRemapParallelMinPixels);
+
+  // Find the images that use some remapped entry (each image is
+  // only read)
+  std::vector<char> changes(n, 0);
+  for_each_remap_task(
+    n, parallel,
+    [&images, &remap, &changes](int i) {
+      changes[i] = remap_changes_image(images[i].get(), remap);
+    });
+
+  int j = 0;
+  for (int i=0; i<n; ++i) {
+    if (changes[i])
+      images[j++] = images[i];
+  }
+  images.erase(images.begin()+j, images.end());
+
+  // Images can share their bits (copy-on-write), so they are
+  // detached from this thread before remapping them in parallel.
+  for (ImageRef& image : images)
+    image->detachBits();
+
+  for_each_remap_task(
+    j, parallel,
+    [&images, &remap](int i) {
+      remap_detached_image(images[i].get(), remap);
+    });
+}
+
 // TODO test this hash routine and find a better alternative
 
 template <typename ImageTraits, uint32_t Mask>
@@ -612,16 +950,140 @@ static uint32_t calculate_image_hash_templ(const Image* image,
 
 uint32_t calculate_image_hash(const Image* img, const gfx::Rect& bounds)
 {
+  // Use the cached hash for the whole image
+  const bool wholeImage = (bounds == img->bounds());
+  uint32_t hash;
+  if (wholeImage && img->cachedHash(hash))
+    return hash;
+
   switch (img->pixelFormat()) {
-    case IMAGE_RGB:       return calculate_image_hash_templ<RgbTraits, rgba_rgb_mask>(img, bounds);
-    case IMAGE_GRAYSCALE: return calculate_image_hash_templ<GrayscaleTraits, graya_v_mask>(img, bounds);
-    case IMAGE_INDEXED:   return calculate_image_hash_templ<IndexedTraits, 0xff>(img, bounds);
-    case IMAGE_BITMAP:    return calculate_image_hash_templ<BitmapTraits, 1>(img, bounds);
+    case IMAGE_RGB:       hash = calculate_image_hash_templ<RgbTraits, rgba_rgb_mask>(img, bounds); break;
+    case IMAGE_GRAYSCALE: hash = calculate_image_hash_templ<GrayscaleTraits, graya_v_mask>(img, bounds); break;
+    case IMAGE_INDEXED:   hash = calculate_image_hash_templ<IndexedTraits, 0xff>(img, bounds); break;
+    case IMAGE_BITMAP:    hash = calculate_image_hash_templ<BitmapTraits, 1>(img, bounds); break;
+    default:
+      ASSERT(false);
+      return 0;
+  }
+
+  if (wholeImage)
+    img->setCachedHash(hash);
+  return hash;
+}
+
+namespace {
+
+inline uint64_t mix_flip_hash(uint64_t x)
+{
+  // splitmix64 finalizer
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ull;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebull;
+  x ^= x >> 31;
+  return x;
+}
+
+// Each pixel is hashed with its distance to the center of the image
+// (|dx|, |dy|), which doesn't change with horizontal/vertical flips
+// (and the pair is sorted for square images, so it doesn't change
+// with diagonal flips either). The hashes of all pixels are added,
+// so the order of the pixels doesn't matter.
+template<typename ImageTraits>
+uint32_t calculate_image_flip_hash_templ(const Image* image)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = image->width();
+  const int h = image->height();
+  const bool square = (w == h);
+  uint64_t hash = 0;
+
+  for (int y=0; y<h; ++y) {
+    auto row = (const pixel_t*)image->getPixelAddress(0, y);
+    const int ay = std::abs(2*y - (h-1));
+    for (int x=0; x<w; ++x) {
+      const int ax = std::abs(2*x - (w-1));
+      const int a = (square ? std::min(ax, ay): ax);
+      const int b = (square ? std::max(ax, ay): ay);
+
+      // Transparent pixels are equal (same as ImageTraits::same_color())
+      color_t c = row[x];
+      if constexpr (std::is_same_v<ImageTraits, RgbTraits>) {
+        if (rgba_geta(c) == 0) c = 0;
+      }
+      else if constexpr (std::is_same_v<ImageTraits, GrayscaleTraits>) {
+        if (graya_geta(c) == 0) c = 0;
+      }
+
+      hash += mix_flip_hash(uint64_t(c) | (uint64_t((a << 16) | b) << 32));
+    }
+  }
+  return uint32_t(mix_flip_hash(hash ^ (uint64_t(w) << 32 | h)));
+}
+
+template<typename ImageTraits>
+bool is_same_image_with_flags_templ(const Image* i1, const Image* i2,
+                                    const tile_flags flags)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = i1->width();
+  const int h = i1->height();
+
+  std::vector<const pixel_t*> rows2(i2->height());
+  for (int v=0; v<i2->height(); ++v)
+    rows2[v] = (const pixel_t*)i2->getPixelAddress(0, v);
+
+  for (int y=0; y<h; ++y) {
+    auto row = (const pixel_t*)i1->getPixelAddress(0, y);
+    for (int x=0; x<w; ++x) {
+      int u = ((flags & tile_f_xflip) ? w-x-1: x);
+      int v = ((flags & tile_f_yflip) ? h-y-1: y);
+      if (flags & tile_f_dflip)
+        std::swap(u, v);
+
+      if (!ImageTraits::same_color(row[x], rows2[v][u]))
+        return false;
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
+uint32_t calculate_image_flip_hash(const Image* image)
+{
+  switch (image->pixelFormat()) {
+    case IMAGE_RGB:       return calculate_image_flip_hash_templ<RgbTraits>(image);
+    case IMAGE_GRAYSCALE: return calculate_image_flip_hash_templ<GrayscaleTraits>(image);
+    case IMAGE_INDEXED:   return calculate_image_flip_hash_templ<IndexedTraits>(image);
+    case IMAGE_TILEMAP:   return calculate_image_flip_hash_templ<TilemapTraits>(image);
   }
   ASSERT(false);
   return 0;
 }
 
+bool is_same_image_with_flags(const Image* i1, const Image* i2,
+                              const tile_flags flags)
+{
+  if (flags == 0)
+    return is_same_image(i1, i2);
+
+  const bool dflip = ((flags & tile_f_dflip) != 0);
+  if ((i1->pixelFormat() != i2->pixelFormat()) ||
+      (i1->width() != (dflip ? i2->height(): i2->width())) ||
+      (i1->height() != (dflip ? i2->width(): i2->height())))
+    return false;
+
+  switch (i1->pixelFormat()) {
+    case IMAGE_RGB:       return is_same_image_with_flags_templ<RgbTraits>(i1, i2, flags);
+    case IMAGE_GRAYSCALE: return is_same_image_with_flags_templ<GrayscaleTraits>(i1, i2, flags);
+    case IMAGE_INDEXED:   return is_same_image_with_flags_templ<IndexedTraits>(i1, i2, flags);
+    case IMAGE_TILEMAP:   return is_same_image_with_flags_templ<TilemapTraits>(i1, i2, flags);
+  }
+  ASSERT(false);
+  return false;
+}
+
 void preprocess_transparent_pixels(Image* image)
 {
   switch (image->pixelFormat()) {
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2023 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,12 +13,17 @@
 #include "doc/blend_mode.h"
 #include "doc/color.h"
 #include "doc/image_buffer.h"
+#include "doc/image_ref.h"
+#include "doc/tile.h"
 #include "gfx/fwd.h"
 
+#include <vector>
+
 namespace doc {
   class Brush;
   class Image;
   class Palette;
+  class PalettePicks;
   class Remap;
 
   color_t get_pixel(const Image* image, int x, int y);
@@ -52,11 +57,36 @@ namespace doc {
   bool is_same_image(const Image* i1, const Image* i2);
   bool is_same_image_slow(const Image* i1, const Image* i2);
 
+  // Remaps the pixels of an indexed image or a tilemap. Images that
+  // don't use any remapped entry are not modified.
   void remap_image(Image* image, const Remap& remap);
 
+  // Remaps several images in parallel. Only the modified images are
+  // kept in the "images" vector.
+  void remap_images(std::vector<ImageRef>& images, const Remap& remap);
+
+  // Marks in "usedEntries" the palette entries (indexed images) or
+  // the tile indexes (tilemaps) used in the image (entries outside
+  // the "usedEntries" range are ignored). The result is cached in the
+  // image until its pixels are modified, so calling this again for an
+  // image that wasn't modified doesn't iterate its pixels.
+  void get_used_entries(const Image* image, PalettePicks& usedEntries);
+
   uint32_t calculate_image_hash(const Image* image,
                                 const gfx::Rect& bounds);
 
+  // Returns a hash of the whole image that is the same for all the
+  // flipped versions of the image (horizontal/vertical flips, and
+  // diagonal flips for square images), so flipped tiles can be found
+  // with just one hash.
+  uint32_t calculate_image_flip_hash(const Image* image);
+
+  // Returns true if "i1" flipped with the given tile flags (first the
+  // X flip, then the Y flip, and then the diagonal flip) is equal to
+  // "i2".
+  bool is_same_image_with_flags(const Image* i1, const Image* i2,
+                                const tile_flags flags);
+
   // Sets RGB values to 0 when alpha=0 (to match images with alpha=0
   // in tilesets/calculate_image_hash)
   void preprocess_transparent_pixels(Image* image);
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023 Igara Studio S.A.
+// Copyright (c) 2023-2026 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -41,6 +41,29 @@ void BM_IsSameImageNew(benchmark::State& state) {
   }
 }
 
+void BM_IsPlainImage(benchmark::State& state) {
+  const auto pf = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+  ImageRef a(Image::create(pf, w, h));
+  clear_image(a.get(), 1);
+  while (state.KeepRunning()) {
+    is_plain_image(a.get(), 1);
+  }
+}
+
+void BM_CountDiffBetweenImages(benchmark::State& state) {
+  const auto pf = (PixelFormat)state.range(0);
+  const int w = state.range(1);
+  const int h = state.range(2);
+  ImageRef a(Image::create(pf, w, h));
+  doc::algorithm::random_image(a.get());
+  ImageRef b(Image::createCopy(a.get()));
+  while (state.KeepRunning()) {
+    count_diff_between_images(a.get(), b.get());
+  }
+}
+
 #define DEFARGS()                                                \
    ->Args({ IMAGE_RGB, 16, 16 })                                 \
    ->Args({ IMAGE_RGB, 1024, 1024 })                             \
@@ -60,4 +83,12 @@ BENCHMARK(BM_IsSameImageNew)
   DEFARGS()
   ->UseRealTime();
 
+BENCHMARK(BM_IsPlainImage)
+  DEFARGS()
+  ->UseRealTime();
+
+BENCHMARK(BM_CountDiffBetweenImages)
+  DEFARGS()
+  ->UseRealTime();
+
 BENCHMARK_MAIN();
@@ -32,10 +32,13 @@ namespace doc {
     return *(((ImageImpl<Traits>*)image)->address(x, y));
   }
 
+  // Doesn't detach the pixels (see Image::detachBits()), it must be
+  // called once before writing the first pixel.
   template<class Traits>
   inline void put_pixel_fast(Image* image, int x, int y, typename Traits::pixel_t color) {
     ASSERT(x >= 0 && x < image->width());
     ASSERT(y >= 0 && y < image->height());
+    ASSERT(!image->isSharingBits());
 
     *(((ImageImpl<Traits>*)image)->address(x, y)) = color;
   }
@@ -55,11 +58,13 @@ namespace doc {
   inline void put_pixel_fast<BitmapTraits>(Image* image, int x, int y, BitmapTraits::pixel_t color) {
     ASSERT(x >= 0 && x < image->width());
     ASSERT(y >= 0 && y < image->height());
+    ASSERT(!image->isSharingBits());
 
+    uint8_t* p = static_cast<const Image*>(image)->getPixelAddress(x, y);
     if (color)
-      *image->getPixelAddress(x, y) |= (1 << (x % 8));
+      *p |= (1 << (x % 8));
     else
-      *image->getPixelAddress(x, y) &= ~(1 << (x % 8));
+      *p &= ~(1 << (x % 8));
   }
 
 } // namespace doc
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2023  Igara Studio S.A.
+// Copyright (c) 2023-2026  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -15,7 +15,10 @@
 #include "doc/algorithm/random_image.h"
 #include "doc/image_impl.h"
 #include "doc/image_ref.h"
+#include "doc/palette_picks.h"
 #include "doc/primitives_fast.h"
+#include "doc/remap.h"
+#include "doc/tile.h"
 
 #include <random>
 
@@ -80,6 +83,219 @@ TYPED_TEST(Primitives, IsSameImage)
   }
 }
 
+TYPED_TEST(Primitives, IsPlainImageAndCountDiff)
+{
+  using ImageTraits = TypeParam;
+
+  // Different widths to test the SIMD loop and the remaining pixels
+  for (int w : { 1, 3, 7, 15, 16, 17, 33, 100 }) {
+    const int h = 5;
+    ImageRef a(Image::create(ImageTraits::pixel_format, w, h));
+    clear_image(a.get(), 0);
+    ImageRef b(Image::createCopy(a.get()));
+
+    EXPECT_TRUE(is_plain_image(a.get(), 0));
+    EXPECT_FALSE(is_plain_image(a.get(), 1));
+    EXPECT_EQ(0, count_diff_between_images(a.get(), b.get()));
+
+    int diff = 0;
+    for (int v=0; v<h; ++v) {
+      put_pixel_fast<ImageTraits>(b.get(), w-1, v, 1);
+      ++diff;
+      if (w > 1) {
+        put_pixel_fast<ImageTraits>(b.get(), w/2, v, 1);
+        ++diff;
+      }
+    }
+    EXPECT_FALSE(is_plain_image(b.get(), 0));
+    EXPECT_EQ(diff, count_diff_between_images(a.get(), b.get()));
+  }
+}
+
+TEST(Primitives, TransparentPixelsAreTheSameColor)
+{
+  ImageRef a(Image::create(IMAGE_RGB, 37, 3));
+  ImageRef b(Image::create(IMAGE_RGB, 37, 3));
+  clear_image(a.get(), rgba(0, 0, 0, 0));
+  clear_image(b.get(), rgba(0, 0, 0, 0));
+  put_pixel(b.get(), 5, 1, rgba(255, 0, 0, 0));
+  put_pixel(b.get(), 36, 2, rgba(0, 255, 0, 0));
+
+  EXPECT_TRUE(is_plain_image(b.get(), rgba(0, 0, 0, 0)));
+  EXPECT_TRUE(is_same_image(a.get(), b.get()));
+  EXPECT_EQ(0, count_diff_between_images(a.get(), b.get()));
+
+  put_pixel(b.get(), 20, 0, rgba(0, 0, 255, 255));
+  EXPECT_FALSE(is_plain_image(b.get(), rgba(0, 0, 0, 0)));
+  EXPECT_FALSE(is_same_image(a.get(), b.get()));
+  EXPECT_EQ(1, count_diff_between_images(a.get(), b.get()));
+}
+
+TYPED_TEST(Primitives, CachedImageHash)
+{
+  using ImageTraits = TypeParam;
+  if (ImageTraits::pixel_format == IMAGE_TILEMAP)
+    return;
+
+  ImageRef a(Image::create(ImageTraits::pixel_format, 16, 16));
+  clear_image(a.get(), 0);
+
+  uint32_t hash;
+  EXPECT_FALSE(a->cachedHash(hash));
+  const uint32_t hash0 = calculate_image_hash(a.get(), a->bounds());
+  EXPECT_TRUE(a->cachedHash(hash));
+  EXPECT_EQ(hash0, hash);
+
+  // Sub-areas are not cached
+  calculate_image_hash(a.get(), gfx::Rect(0, 0, 8, 8));
+  EXPECT_TRUE(a->cachedHash(hash));
+  EXPECT_EQ(hash0, hash);
+
+  // Modifying the pixels invalidates the cached hash
+  put_pixel(a.get(), 3, 4, 1);
+  EXPECT_FALSE(a->cachedHash(hash));
+  const uint32_t hash1 = calculate_image_hash(a.get(), a->bounds());
+  EXPECT_NE(hash0, hash1);
+
+  ImageRef b(Image::createCopy(a.get()));
+  EXPECT_EQ(hash1, calculate_image_hash(b.get(), b->bounds()));
+
+  // Changing the version invalidates the cached hash
+  a->incrementVersion();
+  EXPECT_FALSE(a->cachedHash(hash));
+  EXPECT_EQ(hash1, calculate_image_hash(a.get(), a->bounds()));
+}
+
+TEST(Primitives, RemapImages)
+{
+  Remap remap(256);
+  for (int i=0; i<256; ++i)
+    remap.map(i, i);
+  remap.map(1, 2);
+  remap.map(2, 1);
+  remap.unused(3);
+
+  std::vector<ImageRef> images;
+  for (int i=0; i<20; ++i) {
+    ImageRef image(Image::create(IMAGE_INDEXED, 300, 200));
+    clear_image(image.get(), 4 + i);
+    // Only odd images use a remapped entry
+    if (i & 1)
+      put_pixel(image.get(), i, i, 1);
+    put_pixel(image.get(), 0, 0, 3);
+    images.push_back(image);
+  }
+
+  std::vector<ImageRef> changed = images;
+  remap_images(changed, remap);
+  ASSERT_EQ(10, int(changed.size()));
+  for (int i=0; i<20; ++i) {
+    const Image* image = images[i].get();
+    if (i & 1) {
+      EXPECT_EQ(images[i], changed[i/2]);
+      EXPECT_EQ(2, get_pixel(image, i, i));
+    }
+    EXPECT_EQ(3, get_pixel(image, 0, 0));
+    EXPECT_EQ(4 + i, get_pixel(image, 299, 199));
+  }
+
+  // Tilemaps
+  Remap tiles(4);
+  tiles.map(0, 0);
+  tiles.map(1, 3);
+  tiles.notile(2);
+  tiles.map(3, 1);
+
+  ImageRef tilemap(Image::create(IMAGE_TILEMAP, 4, 1));
+  put_pixel(tilemap.get(), 0, 0, notile);
+  put_pixel(tilemap.get(), 1, 0, tile(1, tile_f_xflip));
+  put_pixel(tilemap.get(), 2, 0, tile(2, 0));
+  put_pixel(tilemap.get(), 3, 0, tile(3, 0));
+
+  std::vector<ImageRef> tilemaps = { tilemap };
+  remap_images(tilemaps, tiles);
+  ASSERT_EQ(1, int(tilemaps.size()));
+  EXPECT_EQ(notile, get_pixel(tilemap.get(), 0, 0));
+  EXPECT_EQ(tile(3, tile_f_xflip), get_pixel(tilemap.get(), 1, 0));
+  EXPECT_EQ(notile, get_pixel(tilemap.get(), 2, 0));
+  EXPECT_EQ(tile(1, 0), get_pixel(tilemap.get(), 3, 0));
+
+  // Nothing to remap
+  tilemaps = { tilemap };
+  Remap identity(4);
+  for (int i=0; i<4; ++i)
+    identity.map(i, i);
+  remap_images(tilemaps, identity);
+  EXPECT_TRUE(tilemaps.empty());
+}
+
+TEST(Primitives, UsedEntries)
+{
+  ImageRef image(Image::create(IMAGE_INDEXED, 64, 32));
+  clear_image(image.get(), 5);
+  put_pixel(image.get(), 3, 4, 200);
+
+  PalettePicks used(256);
+  get_used_entries(image.get(), used);
+  EXPECT_EQ(2, used.picks());
+  EXPECT_TRUE(used[5]);
+  EXPECT_TRUE(used[200]);
+
+  // Entries outside the range are ignored
+  PalettePicks small(16);
+  get_used_entries(image.get(), small);
+  EXPECT_EQ(1, small.picks());
+  EXPECT_TRUE(small[5]);
+
+  // The cached entries are invalidated when the image is modified
+  put_pixel(image.get(), 0, 0, 7);
+  used.clear();
+  get_used_entries(image.get(), used);
+  EXPECT_EQ(3, used.picks());
+  EXPECT_TRUE(used[7]);
+
+  ImageRef tilemap(Image::create(IMAGE_TILEMAP, 3, 1));
+  put_pixel(tilemap.get(), 0, 0, notile);
+  put_pixel(tilemap.get(), 1, 0, tile(2, tile_f_yflip));
+  put_pixel(tilemap.get(), 2, 0, tile(9, 0));
+
+  PalettePicks tiles(10);
+  get_used_entries(tilemap.get(), tiles);
+  EXPECT_EQ(3, tiles.picks());
+  EXPECT_TRUE(tiles[0]);
+  EXPECT_TRUE(tiles[2]);
+  EXPECT_TRUE(tiles[9]);
+}
+
+TEST(Primitives, RotateImage)
+{
+  for (auto pf : { IMAGE_RGB, IMAGE_GRAYSCALE, IMAGE_INDEXED, IMAGE_BITMAP, IMAGE_TILEMAP }) {
+    for (const gfx::Size size : { gfx::Size(1, 1), gfx::Size(3, 70), gfx::Size(131, 67) }) {
+      const int w = size.w;
+      const int h = size.h;
+      ImageRef src(Image::create(pf, w, h));
+      doc::algorithm::random_image(src.get());
+
+      for (int angle : { 180, 90, -90 }) {
+        ImageRef dst(angle == 180 ? Image::create(pf, w, h):
+                                    Image::create(pf, h, w));
+        rotate_image(src.get(), dst.get(), angle);
+
+        for (int y=0; y<h; ++y) {
+          for (int x=0; x<w; ++x) {
+            const color_t c = get_pixel(src.get(), x, y);
+            switch (angle) {
+              case 180: ASSERT_EQ(c, get_pixel(dst.get(), w-x-1, h-y-1)); break;
+              case 90:  ASSERT_EQ(c, get_pixel(dst.get(), h-y-1, x)); break;
+              case -90: ASSERT_EQ(c, get_pixel(dst.get(), y, w-x-1)); break;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
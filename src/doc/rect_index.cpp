@@ -0,0 +1,97 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/rect_index.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace doc {
+
+RectIndex::RectIndex()
+  : m_cols(0)
+  , m_rows(0)
+{
+}
+
+RectIndex::RectIndex(const std::vector<gfx::Rect>& rects)
+  : m_rects(rects)
+  , m_cols(0)
+  , m_rows(0)
+{
+  int nrects = 0;
+  for (const gfx::Rect& rc : m_rects) {
+    if (!rc.isEmpty()) {
+      m_bounds |= rc;
+      ++nrects;
+    }
+  }
+  if (nrects == 0)
+    return;
+
+  const int n = std::max(1, int(std::sqrt(double(nrects))));
+  m_cellSize.w = std::max(1, (m_bounds.w + n - 1) / n);
+  m_cellSize.h = std::max(1, (m_bounds.h + n - 1) / n);
+  m_cols = (m_bounds.w + m_cellSize.w - 1) / m_cellSize.w;
+  m_rows = (m_bounds.h + m_cellSize.h - 1) / m_cellSize.h;
+  m_cells.resize(m_cols * m_rows);
+
+  int u1, v1, u2, v2;
+  for (int i=0; i<int(m_rects.size()); ++i) {
+    if (!cellsRange(m_rects[i], u1, v1, u2, v2))
+      continue;
+
+    for (int v=v1; v<=v2; ++v)
+      for (int u=u1; u<=u2; ++u)
+        m_cells[v*m_cols + u].push_back(i);
+  }
+}
+
+void RectIndex::pick(const gfx::Rect& rc, std::vector<int>& result) const
+{
+  int u1, v1, u2, v2;
+  if (!cellsRange(rc, u1, v1, u2, v2))
+    return;
+
+  std::vector<int> found;
+  for (int v=v1; v<=v2; ++v) {
+    for (int u=u1; u<=u2; ++u) {
+      const std::vector<int>& cell = m_cells[v*m_cols + u];
+      found.insert(found.end(), cell.begin(), cell.end());
+    }
+  }
+
+  // A rectangle can be in several cells
+  std::sort(found.begin(), found.end());
+  found.erase(std::unique(found.begin(), found.end()), found.end());
+
+  for (int i : found) {
+    if (m_rects[i].intersects(rc))
+      result.push_back(i);
+  }
+}
+
+// Returns the range of cells (inclusive) that intersect the given
+// rectangle.
+bool RectIndex::cellsRange(const gfx::Rect& rc,
+                           int& u1, int& v1, int& u2, int& v2) const
+{
+  const gfx::Rect area = (rc & m_bounds);
+  if (area.isEmpty())
+    return false;
+
+  u1 = (area.x - m_bounds.x) / m_cellSize.w;
+  v1 = (area.y - m_bounds.y) / m_cellSize.h;
+  u2 = (area.x2() - 1 - m_bounds.x) / m_cellSize.w;
+  v2 = (area.y2() - 1 - m_bounds.y) / m_cellSize.h;
+  return true;
+}
+
+} // namespace doc
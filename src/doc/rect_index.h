@@ -0,0 +1,46 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_RECT_INDEX_H_INCLUDED
+#define DOC_RECT_INDEX_H_INCLUDED
+#pragma once
+
+#include "gfx/rect.h"
+#include "gfx/size.h"
+
+#include <vector>
+
+namespace doc {
+
+  // Uniform grid of approximately sqrt(n) x sqrt(n) cells to find
+  // the rectangles that intersect a given area without iterating all
+  // of them (e.g. slice keys or cel bounds under the mouse). Each
+  // cell contains the indexes of the rectangles that intersect it.
+  class RectIndex {
+  public:
+    RectIndex();
+    explicit RectIndex(const std::vector<gfx::Rect>& rects);
+
+    // Adds to "result" the indexes (in the vector given to the
+    // constructor) of the non-empty rectangles that intersect "rc",
+    // in ascending order.
+    void pick(const gfx::Rect& rc, std::vector<int>& result) const;
+
+  private:
+    bool cellsRange(const gfx::Rect& rc,
+                    int& u1, int& v1, int& u2, int& v2) const;
+
+    std::vector<gfx::Rect> m_rects;
+    gfx::Rect m_bounds;
+    gfx::Size m_cellSize;
+    int m_cols;
+    int m_rows;
+    std::vector<std::vector<int>> m_cells;
+  };
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,85 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/rect_index.h"
+
+#include <vector>
+
+using namespace doc;
+
+TEST(RectIndex, Empty)
+{
+  std::vector<int> result;
+  RectIndex().pick(gfx::Rect(0, 0, 10, 10), result);
+  EXPECT_TRUE(result.empty());
+
+  RectIndex({ gfx::Rect(), gfx::Rect(5, 5, 0, 0) })
+    .pick(gfx::Rect(0, 0, 10, 10), result);
+  EXPECT_TRUE(result.empty());
+}
+
+TEST(RectIndex, PickInAscendingOrder)
+{
+  const RectIndex index({
+      gfx::Rect(200, 200, 50, 50),
+      gfx::Rect(0, 0, 10, 10),
+      gfx::Rect(),
+      gfx::Rect(-20, -20, 30, 30),
+      gfx::Rect(5, 5, 10, 10) });
+
+  std::vector<int> result;
+  index.pick(gfx::Rect(7, 7, 1, 1), result);
+  EXPECT_EQ((std::vector<int>{ 1, 3, 4 }), result);
+
+  result.clear();
+  index.pick(gfx::Rect(12, 12, 1, 1), result);
+  EXPECT_EQ((std::vector<int>{ 4 }), result);
+
+  result.clear();
+  index.pick(gfx::Rect(100, 100, 1, 1), result);
+  EXPECT_TRUE(result.empty());
+
+  result.clear();
+  index.pick(gfx::Rect(-100, -100, 400, 400), result);
+  EXPECT_EQ((std::vector<int>{ 0, 1, 3, 4 }), result);
+}
+
+// Compares the index with a linear search for a lot of rectangles
+TEST(RectIndex, SameResultsAsLinearSearch)
+{
+  std::vector<gfx::Rect> rects;
+  for (int i=0; i<500; ++i)
+    rects.push_back(gfx::Rect((i*37) % 1000 - 100,
+                              (i*91) % 700 - 50,
+                              1 + (i*13) % 90,
+                              1 + (i*7) % 60));
+  const RectIndex index(rects);
+
+  for (int y=-150; y<800; y+=23) {
+    for (int x=-150; x<1000; x+=31) {
+      const gfx::Rect rc(x, y, 1 + (x & 15), 1 + (y & 7));
+      std::vector<int> expected, result;
+      for (int i=0; i<int(rects.size()); ++i) {
+        if (rects[i].intersects(rc))
+          expected.push_back(i);
+      }
+      index.pick(rc, result);
+      EXPECT_EQ(expected, result) << "x=" << x << " y=" << y;
+    }
+  }
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
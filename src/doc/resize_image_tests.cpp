@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2022 Igara Studio S.A.
+// Copyright (c) 2022-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -17,6 +17,8 @@
 #include "doc/image_ref.h"
 #include "doc/primitives.h"
 
+#include <cmath>
+
 using namespace std;
 using namespace doc;
 
@@ -86,6 +88,70 @@ TEST(ResizeImage, NearestNeighborInterp)
   ASSERT_EQ(0, count_diff_between_images(src.get(), dst2.get()));
 }
 
+// Big images are resized in bands of rows from several threads
+TEST(ResizeImage, NearestNeighborInterpBigImage)
+{
+  ImageRef src(Image::create(IMAGE_RGB, 300, 200));
+  for (int y=0; y<src->height(); ++y)
+    for (int x=0; x<src->width(); ++x)
+      src->putPixel(x, y, rgba(x & 255, y & 255, (x*y) & 255, 255));
+
+  ImageRef dst(Image::create(IMAGE_RGB, 700, 500));
+  algorithm::resize_image(src.get(), dst.get(),
+                          algorithm::RESIZE_METHOD_NEAREST_NEIGHBOR,
+                          nullptr, nullptr, -1);
+
+  const double x_ratio = double(src->width()) / double(dst->width());
+  const double y_ratio = double(src->height()) / double(dst->height());
+  for (int y=0; y<dst->height(); ++y) {
+    for (int x=0; x<dst->width(); ++x) {
+      const int u = int(std::floor(x * x_ratio));
+      const int v = int(std::floor(y * y_ratio));
+      ASSERT_EQ(src->getPixel(u, v), dst->getPixel(x, y));
+    }
+  }
+}
+
+TEST(ResizeImage, BilinearInterpBigImage)
+{
+  ImageRef src(Image::create(IMAGE_RGB, 100, 80));
+  for (int y=0; y<src->height(); ++y)
+    for (int x=0; x<src->width(); ++x)
+      src->putPixel(x, y, rgba((x*7) & 255, (y*5) & 255, (x+y) & 255, (x*y) & 255));
+
+  ImageRef dst(Image::create(IMAGE_RGB, 400, 300));
+  algorithm::resize_image(src.get(), dst.get(),
+                          algorithm::RESIZE_METHOD_BILINEAR,
+                          nullptr, nullptr, -1);
+
+  const double du = (src->width()-1) * 1.0 / (dst->width()-1);
+  const double dv = (src->height()-1) * 1.0 / (dst->height()-1);
+  for (int y=0; y<dst->height(); ++y) {
+    for (int x=0; x<dst->width(); ++x) {
+      const double u = x * du;
+      const double v = y * dv;
+      const int u1 = std::min(int(std::floor(u)), src->width()-1);
+      const int v1 = std::min(int(std::floor(v)), src->height()-1);
+      const int u2 = std::min(u1+1, src->width()-1);
+      const int v2 = std::min(v1+1, src->height()-1);
+      const double a = u - u1;
+      const double b = v - v1;
+      const color_t c[4] = { src->getPixel(u1, v1), src->getPixel(u2, v1),
+                             src->getPixel(u1, v2), src->getPixel(u2, v2) };
+      auto interp = [&](color_t (*get)(color_t)) {
+        return int((get(c[0])*(1-a) + get(c[1])*a)*(1-b) +
+                   (get(c[2])*(1-a) + get(c[3])*a)*b);
+      };
+      const color_t expected =
+        rgba(interp([](color_t c){ return rgba_getr(c); }),
+             interp([](color_t c){ return rgba_getg(c); }),
+             interp([](color_t c){ return rgba_getb(c); }),
+             interp([](color_t c){ return rgba_geta(c); }));
+      ASSERT_EQ(expected, dst->getPixel(x, y));
+    }
+  }
+}
+
 #if 0                           // TODO complete this test
 TEST(ResizeImage, BilinearInterpRGBType)
 {
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2022 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -11,6 +11,8 @@
 #include "base/debug.h"
 #include "doc/color.h"
 
+#include <cstdint>
+
 namespace doc {
 
   class Palette;
@@ -22,11 +24,27 @@ namespace doc {
 
     virtual void regenerateMap(const Palette* palette, const int maskIndex) = 0;
 
-    // Should return the best index in a palette that matches the given RGBA values.
+    // Should return the best index in a palette that matches the given
+    // RGBA values. It can be called from several threads at the same
+    // time (but not while the map is regenerated).
     virtual int mapColor(const color_t rgba) const = 0;
 
     virtual int maskIndex() const = 0;
 
+    // Maps "n" colors from "in" to palette indexes in "out". It's
+    // faster than calling mapColor() for each pixel: implementations
+    // avoid the virtual call per pixel, and runs of the same color
+    // (really common in pixel art) are looked up only once.
+    virtual void mapColors(const color_t* in, uint8_t* out, const int n) const {
+      for (int i=0; i<n; ) {
+        const color_t c = in[i];
+        const uint8_t index = mapColor(c);
+        do {
+          out[i++] = index;
+        } while (i < n && in[i] == c);
+      }
+    }
+
     int mapColor(const int r,
                  const int g,
                  const int b,
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -43,18 +43,40 @@ void RgbMapRGB5A3::regenerateMap(const Palette* palette, int maskIndex)
   m_maskIndex = maskIndex;
 
   // Mark all entries as invalid (need to be regenerated)
-  for (uint16_t& entry : m_map)
-    entry |= INVALID;
+  for (auto& entry : m_map)
+    entry.store(entry.load(std::memory_order_relaxed) | INVALID,
+                std::memory_order_relaxed);
+}
+
+void RgbMapRGB5A3::mapColors(const color_t* in, uint8_t* out, const int n) const
+{
+  for (int j=0; j<n; ) {
+    const color_t c = in[j];
+    // Same index as in mapColor() but using the packed RGBA value
+    const int i =
+      ((c >> (rgba_a_shift+5)) & 0x7) |
+      (((c >> (rgba_b_shift+3)) & 0x1f) << 3) |
+      (((c >> (rgba_g_shift+3)) & 0x1f) << 8) |
+      (((c >> (rgba_r_shift+3)) & 0x1f) << 13);
+    int v = m_map[i].load(std::memory_order_relaxed);
+    if (v & INVALID)
+      v = generateEntry(i, rgba_getr(c), rgba_getg(c), rgba_getb(c), rgba_geta(c));
+    do {
+      out[j++] = v;
+    } while (j < n && in[j] == c);
+  }
 }
 
 int RgbMapRGB5A3::generateEntry(int i, int r, int g, int b, int a) const
 {
-  return m_map[i] =
+  const int index =
     m_palette->findBestfit(
       scale_5bits_to_8bits(r>>3),
       scale_5bits_to_8bits(g>>3),
       scale_5bits_to_8bits(b>>3),
       scale_3bits_to_8bits(a>>5), m_maskIndex);
+  m_map[i].store(index, std::memory_order_relaxed);
+  return index;
 }
 
 } // namespace doc
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2020-2022 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -14,6 +14,7 @@
 #include "doc/object.h"
 #include "doc/rgbmap.h"
 
+#include <atomic>
 #include <vector>
 
 namespace doc {
@@ -37,16 +38,19 @@ namespace doc {
       const int a = rgba_geta(rgba);
       // bits -> bbbbbgggggrrrrraaa
       const int i = (a>>5) | ((b>>3) << 3) | ((g>>3) << 8) | ((r>>3) << 13);
-      const int v = m_map[i];
+      const int v = m_map[i].load(std::memory_order_relaxed);
       return (v & INVALID) ? generateEntry(i, r, g, b, a): v;
     }
+    void mapColors(const color_t* in, uint8_t* out, const int n) const override;
 
     int maskIndex() const override { return m_maskIndex; }
 
   private:
     int generateEntry(int i, int r, int g, int b, int a) const;
 
-    mutable std::vector<uint16_t> m_map;
+    // Entries are atomic because they are generated lazily from
+    // mapColor(), which can be called from several threads.
+    mutable std::vector<std::atomic<uint16_t>> m_map;
     const Palette* m_palette;
     int m_modifications;
     int m_maskIndex;
@@ -63,11 +63,15 @@ int Slice::getMemSize() const
 void Slice::insert(const frame_t frame, const SliceKey& key)
 {
   m_keys.insert(frame, std::make_unique<SliceKey>(key));
+  if (m_owner)
+    m_owner->notifyKeysChange();
 }
 
 void Slice::remove(const frame_t frame)
 {
   m_keys.remove(frame);
+  if (m_owner)
+    m_owner->notifyKeysChange();
 }
 
 const SliceKey* Slice::getByFrame(const frame_t frame) const
@@ -1,4 +1,5 @@
 // Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,12 +12,47 @@
 #include "doc/slices.h"
 
 #include "base/debug.h"
+#include "doc/rect_index.h"
 #include "doc/slice.h"
 
 #include <algorithm>
 
 namespace doc {
 
+// Index with the key bounds of all slices in a specific frame.
+class Slices::Index {
+public:
+  Index(const Slices& slices, const frame_t frame)
+    : m_frame(frame)
+  {
+    std::vector<gfx::Rect> bounds;
+    for (Slice* slice : slices) {
+      const SliceKey* key = slice->getByFrame(frame);
+      if (key && !key->isEmpty()) {
+        m_slices.push_back(slice);
+        bounds.push_back(key->bounds());
+      }
+    }
+    m_index = RectIndex(bounds);
+  }
+
+  frame_t frame() const { return m_frame; }
+
+  void pick(const gfx::Rect& rc, std::vector<Slice*>& result) const {
+    // Indexes are returned in ascending order, so slices are in the
+    // same order as they are in the list
+    std::vector<int> found;
+    m_index.pick(rc, found);
+    for (int i : found)
+      result.push_back(m_slices[i]);
+  }
+
+private:
+  frame_t m_frame;
+  std::vector<Slice*> m_slices;
+  RectIndex m_index;
+};
+
 Slices::Slices(Sprite* sprite)
   : m_sprite(sprite)
 {
@@ -34,6 +70,7 @@ void Slices::add(Slice* slice)
 {
   m_slices.push_back(slice);
   slice->setOwner(this);
+  m_index.reset();
 }
 
 void Slices::remove(Slice* slice)
@@ -44,6 +81,24 @@ void Slices::remove(Slice* slice)
     m_slices.erase(it);
 
   slice->setOwner(nullptr);
+  m_index.reset();
+}
+
+void Slices::pick(const frame_t frame,
+                  const gfx::Point& pt,
+                  std::vector<Slice*>& result) const
+{
+  pick(frame, gfx::Rect(pt, gfx::Size(1, 1)), result);
+}
+
+void Slices::pick(const frame_t frame,
+                  const gfx::Rect& rc,
+                  std::vector<Slice*>& result) const
+{
+  if (!m_index || m_index->frame() != frame)
+    m_index = std::make_unique<Index>(*this, frame);
+
+  m_index->pick(rc, result);
 }
 
 Slice* Slices::getByName(const std::string& name) const
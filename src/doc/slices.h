@@ -9,8 +9,12 @@
 #pragma once
 
 #include "base/disable_copying.h"
+#include "doc/frame.h"
 #include "doc/object_id.h"
+#include "gfx/point.h"
+#include "gfx/rect.h"
 
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -45,9 +49,28 @@ namespace doc {
     std::size_t size() const { return m_slices.size(); }
     bool empty() const { return m_slices.empty(); }
 
+    // Adds to "result" the slices with a key in the given frame that
+    // contains the given point (or intersects the given rectangle),
+    // in the same order they are in this collection. It uses a grid
+    // of the keys in the last queried frame, so we don't have to
+    // iterate all slices e.g. each time the mouse is moved.
+    void pick(const frame_t frame,
+              const gfx::Point& pt,
+              std::vector<Slice*>& result) const;
+    void pick(const frame_t frame,
+              const gfx::Rect& rc,
+              std::vector<Slice*>& result) const;
+
+    // Called when a key of a slice is added/modified/removed to
+    // regenerate the index used by pick().
+    void notifyKeysChange() { m_index.reset(); }
+
   private:
+    class Index;
+
     Sprite* m_sprite;
     List m_slices;
+    mutable std::unique_ptr<Index> m_index;
 
     DISABLE_COPYING(Slices);
   };
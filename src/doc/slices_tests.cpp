@@ -0,0 +1,95 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/slice.h"
+#include "doc/slices.h"
+#include "doc/sprite.h"
+
+#include <memory>
+#include <vector>
+
+using namespace doc;
+
+namespace {
+
+Slice* add_slice(Sprite* spr, const frame_t frame, const gfx::Rect& bounds)
+{
+  Slice* slice = new Slice;
+  slice->insert(frame, SliceKey(bounds));
+  spr->slices().add(slice);
+  return slice;
+}
+
+} // anonymous namespace
+
+TEST(Slices, PickByPointAndRect)
+{
+  std::unique_ptr<Sprite> spr(Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 256, 256)));
+  Slice* a = add_slice(spr.get(), 0, gfx::Rect(0, 0, 10, 10));
+  Slice* b = add_slice(spr.get(), 0, gfx::Rect(5, 5, 10, 10));
+  Slice* c = add_slice(spr.get(), 0, gfx::Rect(200, 200, 50, 50));
+
+  std::vector<Slice*> result;
+  spr->slices().pick(0, gfx::Point(7, 7), result);
+  EXPECT_EQ((std::vector<Slice*>{ a, b }), result);
+
+  result.clear();
+  spr->slices().pick(0, gfx::Point(12, 12), result);
+  EXPECT_EQ((std::vector<Slice*>{ b }), result);
+
+  result.clear();
+  spr->slices().pick(0, gfx::Point(100, 100), result);
+  EXPECT_TRUE(result.empty());
+
+  result.clear();
+  spr->slices().pick(0, gfx::Rect(9, 9, 200, 200), result);
+  EXPECT_EQ((std::vector<Slice*>{ a, b, c }), result);
+}
+
+TEST(Slices, PickIsUpdatedWithKeyChanges)
+{
+  std::unique_ptr<Sprite> spr(Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 256, 256)));
+  spr->setTotalFrames(2);
+
+  Slice* a = add_slice(spr.get(), 0, gfx::Rect(0, 0, 10, 10));
+  a->insert(1, SliceKey(gfx::Rect(50, 50, 10, 10)));
+
+  std::vector<Slice*> result;
+  spr->slices().pick(0, gfx::Point(55, 55), result);
+  EXPECT_TRUE(result.empty());
+  spr->slices().pick(1, gfx::Point(55, 55), result);
+  EXPECT_EQ((std::vector<Slice*>{ a }), result);
+
+  // Move the key in frame 1
+  a->insert(1, SliceKey(gfx::Rect(100, 100, 10, 10)));
+  result.clear();
+  spr->slices().pick(1, gfx::Point(55, 55), result);
+  EXPECT_TRUE(result.empty());
+
+  // Add a new slice
+  Slice* b = add_slice(spr.get(), 1, gfx::Rect(50, 50, 10, 10));
+  spr->slices().pick(1, gfx::Point(55, 55), result);
+  EXPECT_EQ((std::vector<Slice*>{ b }), result);
+
+  // Remove it
+  spr->slices().remove(b);
+  delete b;
+  result.clear();
+  spr->slices().pick(1, gfx::Point(55, 55), result);
+  EXPECT_TRUE(result.empty());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,131 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "doc/sparse_image.h"
+
+#include "base/debug.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+namespace doc {
+
+SparseImage::SparseImage(const ImageSpec& spec)
+  : m_spec(spec)
+  , m_chunksX((spec.width() + kChunkSize - 1) / kChunkSize)
+  , m_chunksY((spec.height() + kChunkSize - 1) / kChunkSize)
+  , m_chunks(m_chunksX * m_chunksY)
+{
+}
+
+SparseImage::SparseImage(const Image* image)
+  : SparseImage(image->spec())
+{
+  const color_t mask = maskColor();
+  for (int v=0; v<m_chunksY; ++v) {
+    for (int u=0; u<m_chunksX; ++u) {
+      ImageRef c(crop_image(image, chunkBounds(u, v), mask));
+      if (!is_plain_image(c.get(), mask))
+        m_chunks[v*m_chunksX + u] = c;
+    }
+  }
+}
+
+gfx::Rect SparseImage::chunkBounds(const int u, const int v) const
+{
+  return gfx::Rect(u*kChunkSize, v*kChunkSize, kChunkSize, kChunkSize)
+    .createIntersection(gfx::Rect(0, 0, width(), height()));
+}
+
+Image* SparseImage::chunkForWrite(const int u, const int v)
+{
+  ASSERT(u >= 0 && u < m_chunksX);
+  ASSERT(v >= 0 && v < m_chunksY);
+
+  ImageRef& c = m_chunks[v*m_chunksX + u];
+  if (!c) {
+    const gfx::Rect bounds = chunkBounds(u, v);
+    ImageSpec spec = m_spec;
+    spec.setSize(bounds.w, bounds.h);
+    c.reset(Image::create(spec));
+    clear_image(c.get(), maskColor());
+  }
+  return c.get();
+}
+
+color_t SparseImage::getPixel(const int x, const int y) const
+{
+  ASSERT(x >= 0 && x < width());
+  ASSERT(y >= 0 && y < height());
+
+  const Image* c = chunk(x / kChunkSize, y / kChunkSize);
+  if (!c)
+    return maskColor();
+  return c->getPixel(x % kChunkSize, y % kChunkSize);
+}
+
+void SparseImage::putPixel(const int x, const int y, const color_t color)
+{
+  ASSERT(x >= 0 && x < width());
+  ASSERT(y >= 0 && y < height());
+
+  const int u = x / kChunkSize;
+  const int v = y / kChunkSize;
+  // Don't allocate a chunk to put the mask color
+  if (color == maskColor() && !chunk(u, v))
+    return;
+  chunkForWrite(u, v)->putPixel(x % kChunkSize, y % kChunkSize, color);
+}
+
+void SparseImage::shrink()
+{
+  for (ImageRef& c : m_chunks) {
+    if (c && is_plain_image(c.get(), maskColor()))
+      c.reset();
+  }
+}
+
+void SparseImage::copyTo(Image* dst) const
+{
+  ASSERT(dst->colorMode() == m_spec.colorMode());
+  ASSERT(dst->width() == width());
+  ASSERT(dst->height() == height());
+
+  clear_image(dst, maskColor());
+  forEachChunk([dst](const Image* c, const gfx::Rect& bounds){
+    copy_image(dst, c, bounds.x, bounds.y);
+  });
+}
+
+Image* SparseImage::toImage() const
+{
+  Image* image = Image::create(m_spec);
+  copyTo(image);
+  return image;
+}
+
+int SparseImage::allocatedChunks() const
+{
+  int n = 0;
+  for (const ImageRef& c : m_chunks)
+    if (c)
+      ++n;
+  return n;
+}
+
+std::size_t SparseImage::getMemSize() const
+{
+  std::size_t size = sizeof(SparseImage) + sizeof(ImageRef) * m_chunks.size();
+  for (const ImageRef& c : m_chunks)
+    if (c)
+      size += c->getMemSize();
+  return size;
+}
+
+} // namespace doc
@@ -0,0 +1,93 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef DOC_SPARSE_IMAGE_H_INCLUDED
+#define DOC_SPARSE_IMAGE_H_INCLUDED
+#pragma once
+
+#include "doc/color.h"
+#include "doc/image_ref.h"
+#include "doc/image_spec.h"
+#include "gfx/rect.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace doc {
+
+  class Image;
+
+  // Image stored in chunks of kChunkSize x kChunkSize pixels, where
+  // the chunks that only contain the mask color (e.g. the fully
+  // transparent parts of a big layer) are not allocated. It's useful
+  // to keep big and mostly empty images using less memory, but it's
+  // not an Image: it must be converted with toImage()/copyTo() to
+  // use it with the rest of primitives.
+  class SparseImage {
+  public:
+    static constexpr int kChunkSize = 64;
+
+    explicit SparseImage(const ImageSpec& spec);
+    explicit SparseImage(const Image* image);
+
+    const ImageSpec& spec() const { return m_spec; }
+    int width() const { return m_spec.width(); }
+    int height() const { return m_spec.height(); }
+    color_t maskColor() const { return m_spec.maskColor(); }
+
+    // Number of chunks in each axis
+    int chunksX() const { return m_chunksX; }
+    int chunksY() const { return m_chunksY; }
+
+    // Bounds of the chunk "u,v" in image coordinates (chunks in the
+    // right/bottom edges can be smaller than kChunkSize)
+    gfx::Rect chunkBounds(const int u, const int v) const;
+
+    // Returns nullptr if the chunk is empty (all pixels are the mask
+    // color).
+    const Image* chunk(const int u, const int v) const {
+      return m_chunks[v*m_chunksX + u].get();
+    }
+
+    // Returns the chunk to be modified, allocating it (filled with the
+    // mask color) if it was empty.
+    Image* chunkForWrite(const int u, const int v);
+
+    color_t getPixel(const int x, const int y) const;
+    void putPixel(const int x, const int y, const color_t color);
+
+    // Releases chunks that only contain the mask color (e.g. after
+    // erasing pixels with putPixel()/chunkForWrite()).
+    void shrink();
+
+    void copyTo(Image* dst) const;
+    Image* toImage() const;
+
+    // Number of allocated chunks and memory used by them
+    int allocatedChunks() const;
+    std::size_t getMemSize() const;
+
+    // Calls "f(const Image* chunk, const gfx::Rect& bounds)" for
+    // each allocated chunk, where "bounds" is the chunk position in
+    // image coordinates.
+    template<typename F>
+    void forEachChunk(F&& f) const {
+      for (int v=0; v<m_chunksY; ++v)
+        for (int u=0; u<m_chunksX; ++u)
+          if (const Image* c = chunk(u, v))
+            f(c, chunkBounds(u, v));
+    }
+
+  private:
+    ImageSpec m_spec;
+    int m_chunksX;
+    int m_chunksY;
+    std::vector<ImageRef> m_chunks;
+  };
+
+} // namespace doc
+
+#endif
@@ -0,0 +1,76 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/sparse_image.h"
+
+#include <memory>
+
+using namespace doc;
+
+TEST(SparseImage, EmptyChunksAreNotAllocated)
+{
+  const int w = 300;            // Not a multiple of kChunkSize
+  const int h = 200;
+  std::unique_ptr<Image> image(Image::create(IMAGE_RGB, w, h));
+  clear_image(image.get(), 0);
+  fill_rect(image.get(), 70, 70, 80, 75, rgba(255, 0, 0, 255));
+  put_pixel(image.get(), w-1, h-1, rgba(0, 0, 255, 128));
+
+  SparseImage sparse(image.get());
+  EXPECT_EQ(5, sparse.chunksX());
+  EXPECT_EQ(4, sparse.chunksY());
+  EXPECT_EQ(2, sparse.allocatedChunks());
+  EXPECT_NE(nullptr, sparse.chunk(1, 1));
+  EXPECT_NE(nullptr, sparse.chunk(4, 3));
+  EXPECT_EQ(nullptr, sparse.chunk(0, 0));
+  EXPECT_EQ(gfx::Rect(256, 192, 44, 8), sparse.chunkBounds(4, 3));
+  EXPECT_LT(sparse.getMemSize(), std::size_t(image->getMemSize()));
+
+  std::unique_ptr<Image> copy(sparse.toImage());
+  EXPECT_TRUE(is_same_image(image.get(), copy.get()));
+}
+
+TEST(SparseImage, PutPixelAndShrink)
+{
+  SparseImage sparse(ImageSpec(ColorMode::INDEXED, 130, 70, 5));
+  EXPECT_EQ(0, sparse.allocatedChunks());
+
+  // Putting the mask color doesn't allocate chunks
+  sparse.putPixel(10, 10, 5);
+  EXPECT_EQ(0, sparse.allocatedChunks());
+  EXPECT_EQ(5, sparse.getPixel(10, 10));
+
+  sparse.putPixel(129, 69, 2);
+  EXPECT_EQ(1, sparse.allocatedChunks());
+  EXPECT_EQ(2, sparse.getPixel(129, 69));
+  EXPECT_EQ(5, sparse.getPixel(128, 69));
+
+  int n = 0;
+  sparse.forEachChunk([&n](const Image* chunk, const gfx::Rect& bounds){
+    EXPECT_EQ(gfx::Rect(128, 64, 2, 6), bounds);
+    EXPECT_EQ(bounds.size(), chunk->size());
+    ++n;
+  });
+  EXPECT_EQ(1, n);
+
+  sparse.putPixel(129, 69, 5);
+  sparse.shrink();
+  EXPECT_EQ(0, sparse.allocatedChunks());
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -500,6 +500,18 @@ void Sprite::setTotalFrames(frame_t frames)
   m_frames = frames;
 }
 
+void Sprite::remapFrames(const Remap& remap)
+{
+  ASSERT(remap.size() == m_frames);
+
+  std::vector<int> frlens(m_frlens.size());
+  for (frame_t frame=0; frame<m_frames; ++frame)
+    frlens[remap[frame]] = m_frlens[frame];
+  m_frlens = std::move(frlens);
+
+  root()->remapFrames(remap);
+}
+
 int Sprite::frameDuration(frame_t frame) const
 {
   if (frame >= 0 && frame < m_frames)
@@ -648,19 +660,22 @@ void Sprite::remapImages(const Remap& remap)
 
   std::vector<ImageRef> images;
   getImages(images);
+  remap_images(images, remap);
+
+  // Only modified images are kept in the vector
   for (ImageRef& image : images)
-    remap_image(image.get(), remap);
+    image->incrementVersion();
 }
 
 void Sprite::remapTilemaps(const Tileset* tileset,
                            const Remap& remap)
 {
-  for (Cel* cel : uniqueCels()) {
-    if (cel->layer()->isTilemap() &&
-        static_cast<LayerTilemap*>(cel->layer())->tileset() == tileset) {
-      remap_image(cel->image(), remap);
-    }
-  }
+  std::vector<ImageRef> images;
+  getTilemapsByTileset(tileset, images);
+  remap_images(images, remap);
+
+  for (ImageRef& image : images)
+    image->incrementVersion();
 }
 
 //////////////////////////////////////////////////////////////////////
@@ -673,12 +688,21 @@ void Sprite::pickCels(const gfx::PointF& pos,
 {
   // Iterate cels in reversed order (from the front-most to the
   // bottom-most) so we pick first visible cel in the given position.
+  CelList candidates;
   const auto& planItems = plan.items();
   for (auto it=planItems.rbegin(), end=planItems.rend(); it!=end; ++it) {
-    const Cel* cel = it->cel;
-    if (!cel)
-      continue;
+    if (it->cel)
+      candidates.push_back(const_cast<Cel*>(it->cel));
+  }
+  pickCels(pos, opacityThreshold, candidates, cels);
+}
 
+void Sprite::pickCels(const gfx::PointF& pos,
+                      const int opacityThreshold,
+                      const CelList& candidates,
+                      CelList& cels) const
+{
+  for (const Cel* cel : candidates) {
     const Image* image = cel->image();
     if (!image)
       continue;
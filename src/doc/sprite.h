@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (C) 2018-2023  Igara Studio S.A.
+// Copyright (C) 2018-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -171,6 +171,10 @@ namespace doc {
     void removeFrame(frame_t frame);
     void setTotalFrames(frame_t frames);
 
+    // Moves each frame (its duration and cels) to remap[frame] in
+    // one step (remap must be a permutation of all frames).
+    void remapFrames(const Remap& remap);
+
     int frameDuration(frame_t frame) const;
     int totalAnimationDuration() const;
     void setFrameDuration(frame_t frame, int msecs);
@@ -202,6 +206,9 @@ namespace doc {
     void getTilemapsByTileset(const Tileset* tileset,
                               std::vector<ImageRef>& images) const;
 
+    // Remaps the images in parallel, incrementing the version of the
+    // images that were modified (images that don't use any remapped
+    // entry are skipped).
     void remapImages(const Remap& remap);
     void remapTilemaps(const Tileset* tileset,
                        const Remap& remap);
@@ -210,6 +217,14 @@ namespace doc {
                   const RenderPlan& plan,
                   CelList& cels) const;
 
+    // Same as pickCels() but only checking the given "candidates"
+    // cels, which must be sorted from the front-most to the
+    // bottom-most one (e.g. cels from an index of cel bounds).
+    void pickCels(const gfx::PointF& pos,
+                  const int opacityThreshold,
+                  const CelList& candidates,
+                  CelList& cels) const;
+
     ////////////////////////////////////////
     // Iterators
 
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2018-2022 Igara Studio S.A.
+// Copyright (c) 2018-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -15,6 +15,7 @@
 #include "doc/cels_range.h"
 #include "doc/layer.h"
 #include "doc/pixel_format.h"
+#include "doc/remap.h"
 #include "doc/sprite.h"
 
 #include <memory>
@@ -193,6 +194,102 @@ TEST(Sprite, CelsRange)
   EXPECT_EQ(3, i);
 }
 
+TEST(Sprite, RemapFrames)
+{
+  std::shared_ptr<Sprite> sprPtr(std::make_shared<Sprite>(
+                                   ImageSpec(ColorMode::RGB, 32, 32), 256));
+  Sprite* spr = sprPtr.get();
+  spr->setTotalFrames(4);
+  for (frame_t f=0; f<4; ++f)
+    spr->setFrameDuration(f, 100*(f+1));
+
+  LayerImage* lay1 = new LayerImage(spr);
+  LayerGroup* grp1 = new LayerGroup(spr);
+  LayerImage* lay2 = new LayerImage(spr);
+  spr->root()->addLayer(lay1);
+  spr->root()->addLayer(grp1);
+  grp1->addLayer(lay2);
+
+  ImageRef img(Image::create(IMAGE_RGB, 32, 32));
+  Cel* celA = new Cel(frame_t(0), img);
+  Cel* celB = new Cel(frame_t(1), img);
+  Cel* celC = new Cel(frame_t(3), img);
+  Cel* celD = new Cel(frame_t(2), img);
+  lay1->addCel(celA);
+  lay1->addCel(celB);
+  lay1->addCel(celC);
+  lay2->addCel(celD);
+
+  // Reverse the order of the frames
+  Remap remap(4);
+  for (int i=0; i<4; ++i)
+    remap.map(i, 3-i);
+  spr->remapFrames(remap);
+
+  for (frame_t f=0; f<4; ++f)
+    EXPECT_EQ(100*(4-f), spr->frameDuration(f));
+  EXPECT_EQ(celC, lay1->cel(0));
+  EXPECT_EQ(nullptr, lay1->cel(1));
+  EXPECT_EQ(celB, lay1->cel(2));
+  EXPECT_EQ(celA, lay1->cel(3));
+  EXPECT_EQ(celD, lay2->cel(1));
+
+  // Cels are sorted by frame
+  frame_t prev = -1;
+  for (auto it=lay1->getCelBegin(); it!=lay1->getCelEnd(); ++it) {
+    EXPECT_LT(prev, (*it)->frame());
+    prev = (*it)->frame();
+  }
+
+  // The inverse remap restores the original frames
+  spr->remapFrames(remap.invert());
+  for (frame_t f=0; f<4; ++f)
+    EXPECT_EQ(100*(f+1), spr->frameDuration(f));
+  EXPECT_EQ(celA, lay1->cel(0));
+  EXPECT_EQ(celB, lay1->cel(1));
+  EXPECT_EQ(celC, lay1->cel(3));
+  EXPECT_EQ(celD, lay2->cel(2));
+}
+
+TEST(Sprite, CelByFrame)
+{
+  std::shared_ptr<Sprite> sprPtr(std::make_shared<Sprite>(
+                                   ImageSpec(ColorMode::RGB, 32, 32), 256));
+  Sprite* spr = sprPtr.get();
+  spr->setTotalFrames(100);
+
+  LayerImage* lay = new LayerImage(spr);
+  spr->root()->addLayer(lay);
+
+  ImageRef img(Image::create(IMAGE_RGB, 32, 32));
+  Cel* celA = new Cel(frame_t(5), img);
+  Cel* celB = new Cel(frame_t(50), img);
+  lay->addCel(celA);
+  lay->addCel(celB);
+  EXPECT_EQ(celA, lay->cel(5));
+  EXPECT_EQ(celB, lay->cel(50));
+  EXPECT_EQ(nullptr, lay->cel(-1));
+  EXPECT_EQ(nullptr, lay->cel(6));
+  EXPECT_EQ(nullptr, lay->cel(99));
+  EXPECT_EQ(nullptr, lay->cel(1000));
+
+  lay->moveCel(celB, 20);
+  EXPECT_EQ(nullptr, lay->cel(50));
+  EXPECT_EQ(celB, lay->cel(20));
+  EXPECT_EQ(lay->getCelEnd(), lay->findCelIterator(50));
+  EXPECT_EQ(celB, *lay->findCelIterator(20));
+
+  lay->displaceFrames(0, 3);
+  EXPECT_EQ(celA, lay->cel(8));
+  EXPECT_EQ(celB, lay->cel(23));
+  EXPECT_EQ(nullptr, lay->cel(5));
+
+  lay->removeCel(celA);
+  delete celA;
+  EXPECT_EQ(nullptr, lay->cel(8));
+  EXPECT_EQ(celB, lay->cel(23));
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,52 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/file/text_reader.h"
+
+using namespace doc::file;
+
+TEST(TextReader, Lines)
+{
+  TextReader reader("GIMP Palette\r\n  Name: Test \r\n\n0 0 0\tBlack");
+  std::string_view line;
+
+  ASSERT_TRUE(reader.nextLine(line)); EXPECT_EQ("GIMP Palette", line);
+  ASSERT_TRUE(reader.nextLine(line)); EXPECT_EQ("Name: Test", line);
+  ASSERT_TRUE(reader.nextLine(line)); EXPECT_EQ("", line);
+  ASSERT_TRUE(reader.nextLine(line)); EXPECT_EQ("0 0 0\tBlack", line);
+  EXPECT_FALSE(reader.nextLine(line));
+}
+
+TEST(TextReader, ParseInt)
+{
+  std::string_view s = "  12 -3\t+45 x 99999999999";
+  int v = 0;
+
+  ASSERT_TRUE(parse_int(s, v)); EXPECT_EQ(12, v);
+  ASSERT_TRUE(parse_int(s, v)); EXPECT_EQ(-3, v);
+  ASSERT_TRUE(parse_int(s, v)); EXPECT_EQ(45, v);
+  EXPECT_FALSE(parse_int(s, v));
+  EXPECT_EQ(" x 99999999999", s);
+
+  s.remove_prefix(2);
+  ASSERT_TRUE(parse_int(s, v)); EXPECT_LT(255, v);
+  EXPECT_TRUE(s.empty());
+
+  s = "-";
+  EXPECT_FALSE(parse_int(s, v));
+}
+
+int main(int argc, char** argv)
+{
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -18,7 +18,9 @@
 #include "doc/remap.h"
 #include "doc/sprite.h"
 
+#include <algorithm>
 #include <memory>
+#include <vector>
 
 #define TS_TRACE(...) // TRACE(__VA_ARGS__)
 
@@ -83,8 +85,8 @@ Tileset* Tileset::MakeCopyCopyingImages(const Tileset* tileset)
   for (tile_index ti=0; ti<copy->size(); ++ti) {
     ImageRef image = tileset->get(ti);
     ASSERT(image);
-    // TODO can we avoid making a copy of this image
-    copy->set(ti, ImageRef(Image::createCopy(image.get())));
+    // Pixels are copied only when one of both images is modified
+    copy->set(ti, ImageRef(Image::createSharedCopy(image.get())));
     copy->setTileData(ti, tileset->getTileData(ti));
   }
   return copy.release();
@@ -127,6 +129,9 @@ void Tileset::resize(const tile_index ntiles)
   m_tiles.resize(ntiles);
   for (tile_index ti=oldSize; ti<ntiles; ++ti)
     m_tiles[ti].image = makeEmptyTile();
+
+  // The flip hash table will be re-generated when it's needed
+  m_flipHash.clear();
 }
 
 void Tileset::remap(const Remap& remap)
@@ -173,12 +178,15 @@ void Tileset::set(const tile_index ti,
 #endif
 
   removeFromHash(ti, false);
+  removeFromFlipHash(ti);
 
   preprocess_transparent_pixels(image.get());
   m_tiles[ti].image = image;
 
   if (!m_hash.empty())
     hashImage(ti, image);
+  if (!m_flipHash.empty())
+    flipHashImage(ti, image);
 }
 
 tile_index Tileset::add(const ImageRef& image,
@@ -194,6 +202,8 @@ tile_index Tileset::add(const ImageRef& image,
   const tile_index newIndex = tile_index(m_tiles.size()-1);
   if (!m_hash.empty())
     hashImage(newIndex, image);
+  if (!m_flipHash.empty())
+    flipHashImage(newIndex, image);
   return newIndex;
 }
 
@@ -224,6 +234,13 @@ void Tileset::insert(const tile_index ti,
     // And now we can add the new image with the "ti" index
     hashImage(ti, image);
   }
+
+  if (!m_flipHash.empty()) {
+    for (auto& it : m_flipHash)
+      if (it.second >= ti)
+        ++it.second;
+    flipHashImage(ti, image);
+  }
 }
 
 void Tileset::erase(const tile_index ti)
@@ -273,47 +290,106 @@ bool Tileset::findTileIndex(const ImageRef& tileImage,
   }
 }
 
-void Tileset::notifyTileContentChange(const tile_index ti)
+bool Tileset::findTileIndexWithFlags(const ImageRef& tileImage,
+                                     tile_index& ti,
+                                     tile_flags& tf)
 {
-#if 0 // TODO Try to do less work
+  tf = 0;
+  if (findTileIndex(tileImage, ti))
+    return true;
 
-  ASSERT(ti >= 0 && ti < size());
+  // In case we don't allow flipped tiles
+  if (m_matchFlags == 0 || !tileImage)
+    return false;
 
-  // If two or more tiles are exactly the same, they will have the
-  // same hash, so the m_hash table can be smaller than the m_tiles
-  // array.
-  if (m_hash.size() < m_tiles.size()) {
-    // Count how many hash elements are poiting to this tile index
-    int tilesWithSameHash = 0;
-    for (auto item : m_hash)
-      if (item.second == ti)
-        ++tilesWithSameHash;
-
-    // In this case we re-generate the whole hash table because one or
-    // more tiles tile are using the hash of the modified tile.
-    if (tilesWithSameHash >= 2) {
-      rehash();
-      return;
+  // Tiles that can be equal to a flipped version of the image
+  auto& h = flipHashTable();
+  const auto range = h.equal_range(calculate_image_flip_hash(tileImage.get()));
+  std::vector<tile_index> candidates;
+  for (auto it=range.first; it!=range.second; ++it)
+    candidates.push_back(it->second);
+  if (candidates.empty())
+    return false;
+  std::sort(candidates.begin(), candidates.end());
+
+  // Flips are tested in this order: first the X/Y flips, and then
+  // the diagonal flips
+  static const tile_flags kFlags[] = {
+    tile_f_xflip,
+    tile_f_yflip,
+    tile_f_xflip | tile_f_yflip,
+    tile_f_dflip,
+    tile_f_xflip | tile_f_dflip,
+    tile_f_xflip | tile_f_yflip | tile_f_dflip,
+    tile_f_yflip | tile_f_dflip,
+  };
+  for (const tile_flags flags : kFlags) {
+    if ((m_matchFlags & flags) != flags)
+      continue;
+
+    for (const tile_index tj : candidates) {
+      const ImageRef tile = get(tj);
+      if (tile &&
+          is_same_image_with_flags(tileImage.get(), tile.get(), flags)) {
+        ti = tj;
+        tf = flags;
+        return true;
+      }
     }
   }
+  return false;
+}
 
-  // In other case we can do a fast-path, just removing and
-  // re-adding the tile to the hash table.
-  removeFromHash(ti, false);
-  if (!m_hash.empty())
-    hashImage(ti, m_tiles[ti]);
+void Tileset::notifyTileContentChange(const tile_index ti)
+{
+  if (ti < 0 || ti >= size() || !m_tiles[ti].image) {
+    rehash();
+    return;
+  }
 
-#else // Regenerate the whole hash map (at the moment this is the
-      // only way to make it work correctly)
+  const ImageRef& image = m_tiles[ti].image;
+  preprocess_transparent_pixels(image.get());
+  discardCompressedData();
 
-  (void)ti;                     // unused
+  if (!m_flipHash.empty()) {
+    removeFromFlipHash(ti);
+    flipHashImage(ti, image);
+  }
 
-  if (ti >= 0 && ti < m_tiles.size() && m_tiles[ti].image)
-    preprocess_transparent_pixels(m_tiles[ti].image.get());
+  // The hash table will be re-generated when it's needed
+  if (m_hash.empty())
+    return;
 
-  rehash();
+  // Remove the entry of this tile (which is still using the hash of
+  // the old content). If it was the entry for the old content, we
+  // re-add other tiles with the same old content (two or more equal
+  // tiles use only one entry, the one with the lowest index).
+  uint32_t oldHash = 0;
+  bool removed = false;
+  for (auto it=m_hash.begin(), end=m_hash.end(); it!=end; ++it) {
+    if (it->second == ti) {
+      oldHash = it->first.hash;
+      m_hash.erase(it);
+      removed = true;
+      break;
+    }
+  }
+  if (removed) {
+    for (tile_index tj=0; tj<size(); ++tj) {
+      const ImageRef& tile = m_tiles[tj].image;
+      if (tj != ti && tile &&
+          calculate_image_hash(tile.get(), tile->bounds()) == oldHash) {
+        hashImage(tj, tile);
+      }
+    }
+  }
 
-#endif
+  // Add the new content
+  auto it = m_hash.find(image);
+  if (it == m_hash.end())
+    m_hash[image] = ti;
+  else if (it->second > ti)
+    it->second = ti;
 }
 
 void Tileset::notifyRegenerateEmptyTile()
@@ -363,7 +439,7 @@ void Tileset::assertValidHashTable()
       // If the hash doesn't match, it is because other tile is equal
       // to this one.
       if (it->second != ti) {
-        ASSERT(is_same_image(it->first.get(), m_tiles[it->second].image.get()));
+        ASSERT(is_same_image(it->first.image.get(), m_tiles[it->second].image.get()));
       }
     }
   }
@@ -389,9 +465,10 @@ void Tileset::hashImage(const tile_index ti,
 
 void Tileset::rehash()
 {
-  // Clear the hash table, we'll lazy-rehash it when
+  // Clear the hash tables, we'll lazy-rehash them when
   // hashTable()/findTileIndex() is used.
   m_hash.clear();
+  m_flipHash.clear();
 
   // Reset the compressed data (just in case we have cached the data
   // from a loaded .aseprite file or when saving the file).
@@ -409,6 +486,35 @@ TilesetHashTable& Tileset::hashTable()
   return m_hash;
 }
 
+void Tileset::flipHashImage(const tile_index ti,
+                            const ImageRef& tileImage)
+{
+  m_flipHash.emplace(calculate_image_flip_hash(tileImage.get()), ti);
+}
+
+void Tileset::removeFromFlipHash(const tile_index ti)
+{
+  for (auto it=m_flipHash.begin(); it!=m_flipHash.end(); ) {
+    if (it->second == ti)
+      it = m_flipHash.erase(it);
+    else
+      ++it;
+  }
+}
+
+TilesetFlipHashTable& Tileset::flipHashTable()
+{
+  if (m_flipHash.empty()) {
+    tile_index ti = 0;
+    for (auto& tile : m_tiles) {
+      if (tile.image)
+        flipHashImage(ti, tile.image);
+      ++ti;
+    }
+  }
+  return m_flipHash;
+}
+
 int Tileset::tilemapsCount() const {
   auto tsi = sprite()->tilesets()->getIndex(this);
   int count = 0;
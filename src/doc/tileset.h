@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2023  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -127,6 +127,16 @@ namespace doc {
     bool findTileIndex(const ImageRef& tileImage,
                        tile_index& ti);
 
+    // Same as findTileIndex() but it can match flipped versions of
+    // the tiles (with the flips enabled in matchFlags()). "tf" are
+    // the flags of the tile "ti" that generate the given
+    // "tileImage". Flipped tiles are looked up with one hash that
+    // doesn't depend on the orientation of the tile (see
+    // calculate_image_flip_hash()).
+    bool findTileIndexWithFlags(const ImageRef& tileImage,
+                                tile_index& ti,
+                                tile_flags& tf);
+
     // Must be called when a tile image was modified externally, so
     // the hash elements are re-calculated for that specific tile.
     void notifyTileContentChange(const tile_index ti);
@@ -149,11 +159,16 @@ namespace doc {
                    const ImageRef& tileImage);
     void rehash();
     TilesetHashTable& hashTable();
+    void flipHashImage(const tile_index ti,
+                       const ImageRef& tileImage);
+    void removeFromFlipHash(const tile_index ti);
+    TilesetFlipHashTable& flipHashTable();
 
     Sprite* m_sprite;
     Grid m_grid;
     Tiles m_tiles;
     TilesetHashTable m_hash;
+    TilesetFlipHashTable m_flipHash;
     std::string m_name;
     int m_baseIndex = 1;
     tile_flags m_matchFlags = 0;
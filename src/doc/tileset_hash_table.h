@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -18,11 +18,46 @@
 
 namespace doc {
 
+  // Key of the TilesetHashTable. It keeps the hash of the image
+  // calculated when the tile was added to the table, so we can remove
+  // the entry of a modified tile (whose pixels don't match the hash
+  // anymore) without re-hashing the whole tileset.
+  struct TilesetHashKey {
+    ImageRef image;
+    uint32_t hash;
+
+    TilesetHashKey(const ImageRef& image)
+      : image(image)
+      , hash(calculate_image_hash(image.get(), image->bounds())) { }
+  };
+
+  namespace details {
+
+    struct tileset_key_hash {
+      size_t operator()(const TilesetHashKey& k) const {
+        return k.hash;
+      }
+    };
+
+    struct tileset_key_eq {
+      bool operator()(const TilesetHashKey& a, const TilesetHashKey& b) const {
+        return (a.hash == b.hash &&
+                is_same_image(a.image.get(), b.image.get()));
+      }
+    };
+
+  }
+
   // A hash table used to match Image pixels data <-> tileset index
-  typedef std::unordered_map<ImageRef,
+  typedef std::unordered_map<TilesetHashKey,
                              tile_index,
-                             details::image_hash,
-                             details::image_eq> TilesetHashTable;
+                             details::tileset_key_hash,
+                             details::tileset_key_eq> TilesetHashTable;
+
+  // A hash table used to find tiles that can be equal to a flipped
+  // image, from calculate_image_flip_hash() -> tileset indexes with
+  // that hash.
+  typedef std::unordered_multimap<uint32_t, tile_index> TilesetFlipHashTable;
 
 } // namespace doc
 
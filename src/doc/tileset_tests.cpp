@@ -0,0 +1,139 @@
+// Aseprite Document Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <gtest/gtest.h>
+
+#include "doc/algorithm/flip_image.h"
+#include "doc/grid.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+
+#include <initializer_list>
+#include <memory>
+
+using namespace doc;
+
+static ImageRef make_tile(const Tileset& tileset, const color_t c)
+{
+  ImageRef tile(Image::create(IMAGE_RGB,
+                              tileset.grid().tileSize().w,
+                              tileset.grid().tileSize().h));
+  clear_image(tile.get(), c);
+  return tile;
+}
+
+TEST(Tileset, FindTileAfterContentChange)
+{
+  Sprite spr(ImageSpec(ColorMode::RGB, 32, 32), 256);
+  Tileset tileset(&spr, Grid(gfx::Size(4, 4)), 1);
+
+  const color_t red = rgba(255, 0, 0, 255);
+  const color_t blue = rgba(0, 0, 255, 255);
+  tileset.add(make_tile(tileset, red));  // 1
+  tileset.add(make_tile(tileset, red));  // 2 (same content as 1)
+  tileset.add(make_tile(tileset, blue)); // 3
+
+  tile_index ti;
+  EXPECT_TRUE(tileset.findTileIndex(make_tile(tileset, red), ti));
+  EXPECT_EQ(1, ti);
+
+  // Modify tile 1, tile 2 must be found as the red tile
+  clear_image(tileset.get(1).get(), rgba(0, 255, 0, 255));
+  tileset.notifyTileContentChange(1);
+
+  EXPECT_TRUE(tileset.findTileIndex(make_tile(tileset, red), ti));
+  EXPECT_EQ(2, ti);
+  EXPECT_TRUE(tileset.findTileIndex(make_tile(tileset, rgba(0, 255, 0, 255)), ti));
+  EXPECT_EQ(1, ti);
+
+  // Modify tile 3 to be equal to tile 2, the lowest index is used
+  clear_image(tileset.get(3).get(), red);
+  tileset.notifyTileContentChange(3);
+
+  EXPECT_TRUE(tileset.findTileIndex(make_tile(tileset, red), ti));
+  EXPECT_EQ(2, ti);
+  EXPECT_FALSE(tileset.findTileIndex(make_tile(tileset, blue), ti));
+
+#ifdef _DEBUG
+  tileset.assertValidHashTable();
+#endif
+}
+
+TEST(Tileset, FindFlippedTiles)
+{
+  Sprite spr(ImageSpec(ColorMode::RGB, 32, 32), 256);
+  Tileset tileset(&spr, Grid(gfx::Size(4, 4)), 1);
+  tileset.setMatchFlags(tile_f_xflip | tile_f_yflip | tile_f_dflip);
+
+  // A tile without symmetries
+  const color_t red = rgba(255, 0, 0, 255);
+  const color_t blue = rgba(0, 0, 255, 255);
+  ImageRef tile = make_tile(tileset, rgba(0, 0, 0, 255));
+  put_pixel(tile.get(), 0, 0, red);
+  put_pixel(tile.get(), 1, 0, blue);
+  tileset.add(make_tile(tileset, blue)); // 1
+  tileset.add(tile);                     // 2
+
+  auto flipped = [&tile](std::initializer_list<algorithm::FlipType> flips) {
+    ImageRef image(Image::createCopy(tile.get()));
+    for (auto flipType : flips)
+      algorithm::flip_image(image.get(), image->bounds(), flipType);
+    return image;
+  };
+
+  tile_index ti;
+  tile_flags tf;
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(0, tf);
+
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipHorizontal }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_xflip, tf);
+
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipVertical }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_yflip, tf);
+
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipHorizontal,
+                                                       algorithm::FlipVertical }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_xflip | tile_f_yflip, tf);
+
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipDiagonal }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_dflip, tf);
+
+  // The tile with flags is the image flipped in the inverse order
+  // (first the diagonal flip, then the Y flip).
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipDiagonal,
+                                                       algorithm::FlipVertical }), ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_yflip | tile_f_dflip, tf);
+
+  // Modified tiles are found with their new content
+  ImageRef query = flipped({ algorithm::FlipVertical });
+  clear_image(tileset.get(1).get(), red);
+  tileset.notifyTileContentChange(1);
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(query, ti, tf));
+  EXPECT_EQ(2, ti);
+  EXPECT_EQ(tile_f_yflip, tf);
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(make_tile(tileset, red), ti, tf));
+  EXPECT_EQ(1, ti);
+  EXPECT_EQ(0, tf);
+
+  // Disabled flips
+  tileset.setMatchFlags(tile_f_xflip);
+  EXPECT_FALSE(tileset.findTileIndexWithFlags(query, ti, tf));
+  EXPECT_TRUE(tileset.findTileIndexWithFlags(flipped({ algorithm::FlipHorizontal }), ti, tf));
+  EXPECT_EQ(tile_f_xflip, tf);
+}
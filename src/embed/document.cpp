@@ -0,0 +1,119 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "embed/document.h"
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "base/debug.h"
+#include "doc/image.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "render/render.h"
+
+#include <stdexcept>
+
+namespace embed {
+
+using namespace doc;
+
+// static
+std::unique_ptr<Document> Document::load(const std::string& filename)
+{
+  auto ctx = std::make_unique<app::Context>();
+
+  std::unique_ptr<app::FileOp> fop(
+    app::FileOp::createLoadDocumentOperation(
+      ctx.get(), filename,
+      FILE_LOAD_CREATE_PALETTE |
+      FILE_LOAD_SEQUENCE_NONE));
+  if (!fop)
+    throw std::runtime_error("Error loading file: " + filename);
+  // File not found or unsupported format
+  if (fop->hasError())
+    throw std::runtime_error(fop->error());
+
+  // Operate in this same thread
+  fop->operate();
+  fop->done();
+  fop->postLoad();
+
+  if (fop->hasError() && !fop->document())
+    throw std::runtime_error(fop->error());
+
+  app::Doc* doc = fop->releaseDocument();
+  if (!doc)
+    throw std::runtime_error("Error loading file: " + filename);
+
+  doc->setContext(ctx.get());
+  return std::unique_ptr<Document>(new Document(std::move(ctx), doc));
+}
+
+Document::Document(std::unique_ptr<app::Context>&& ctx, app::Doc* doc)
+  : m_ctx(std::move(ctx))
+  , m_doc(doc)
+  , m_render(std::make_unique<render::Render>())
+{
+}
+
+Document::~Document()
+{
+  m_doc->close();
+  delete m_doc;
+}
+
+int Document::width() const
+{
+  return m_doc->sprite()->width();
+}
+
+int Document::height() const
+{
+  return m_doc->sprite()->height();
+}
+
+int Document::frames() const
+{
+  return m_doc->sprite()->totalFrames();
+}
+
+int Document::frameDuration(const int frame) const
+{
+  return m_doc->sprite()->frameDuration(frame);
+}
+
+void Document::renderFrame(const int frame,
+                           uint8_t* pixels,
+                           const int stride) const
+{
+  const Sprite* sprite = m_doc->sprite();
+  const int w = sprite->width();
+  const int h = sprite->height();
+  ASSERT(stride >= w*4);
+
+  // All color modes are rendered in an RGB image
+  ImageRef image(Image::create(IMAGE_RGB, w, h));
+  clear_image(image.get(), rgba(0, 0, 0, 0));
+  m_render->renderSprite(image.get(), sprite, frame_t(frame));
+
+  for (int y=0; y<h; ++y) {
+    const color_t* src = (const color_t*)image->getPixelAddress(0, y);
+    uint8_t* dst = pixels + y*stride;
+    for (int x=0; x<w; ++x, ++src) {
+      *(dst++) = rgba_getr(*src);
+      *(dst++) = rgba_getg(*src);
+      *(dst++) = rgba_getb(*src);
+      *(dst++) = rgba_geta(*src);
+    }
+  }
+}
+
+} // namespace embed
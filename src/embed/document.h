@@ -0,0 +1,71 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef EMBED_DOCUMENT_H_INCLUDED
+#define EMBED_DOCUMENT_H_INCLUDED
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace app {
+  class Context;
+  class Doc;
+}
+
+namespace render {
+  class Render;
+}
+
+namespace embed {
+
+  // A document loaded to be rendered from other programs without UI
+  // and without temporary files (e.g. a previewer). The frames are
+  // rendered directly in memory provided by the caller.
+  //
+  // Example:
+  //
+  //   auto doc = embed::Document::load("sprite.aseprite");
+  //   std::vector<uint8_t> pixels(doc->width() * doc->height() * 4);
+  //   for (int frame=0; frame<doc->frames(); ++frame)
+  //     doc->renderFrame(frame, pixels.data(), doc->width() * 4);
+  //
+  class Document {
+  public:
+    // Loads the given file (any format supported by Aseprite, only
+    // the given file, it's not loaded as a sequence). Throws a
+    // std::runtime_error if the file cannot be loaded.
+    static std::unique_ptr<Document> load(const std::string& filename);
+
+    ~Document();
+
+    int width() const;
+    int height() const;
+    int frames() const;
+
+    // Duration of the given frame in milliseconds.
+    int frameDuration(const int frame) const;
+
+    // Renders the given frame with all visible layers in "pixels"
+    // as non-premultiplied RGBA with 8 bits per channel (R,G,B,A
+    // bytes in this order). "pixels" must have "stride" bytes per row
+    // (at least width()*4) and height() rows.
+    void renderFrame(const int frame,
+                     uint8_t* pixels,
+                     const int stride) const;
+
+  private:
+    Document(std::unique_ptr<app::Context>&& ctx, app::Doc* doc);
+
+    std::unique_ptr<app::Context> m_ctx;
+    app::Doc* m_doc;
+    std::unique_ptr<render::Render> m_render;
+  };
+
+} // namespace embed
+
+#endif
@@ -0,0 +1,74 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#include "tests/app_test.h"
+
+#include "embed/document.h"
+
+#include "app/context.h"
+#include "app/doc.h"
+#include "app/file/file.h"
+#include "doc/doc.h"
+#include "doc/primitives.h"
+
+#include <stdexcept>
+#include <vector>
+
+using namespace app;
+
+TEST(EmbedDocument, RenderFrames)
+{
+  const std::string fn = "test_embed.ase";
+  {
+    app::Context ctx;
+    std::unique_ptr<Doc> doc(
+      ctx.documents().add(4, 3, doc::ColorMode::RGB, 256));
+    doc->setFilename(fn);
+    doc->sprite()->setFrameDuration(0, 250);
+
+    Image* image = doc->sprite()->root()->firstLayer()
+      ->cel(frame_t(0))->image();
+    clear_image(image, rgba(0, 0, 0, 0));
+    put_pixel(image, 1, 2, rgba(255, 128, 64, 32));
+
+    ASSERT_EQ(0, save_document(&ctx, doc.get()));
+    doc->close();
+  }
+
+  auto doc = embed::Document::load(fn);
+  ASSERT_EQ(4, doc->width());
+  ASSERT_EQ(3, doc->height());
+  ASSERT_EQ(1, doc->frames());
+  EXPECT_EQ(250, doc->frameDuration(0));
+
+  // Rows with some extra padding bytes that must not be modified
+  const int stride = 4*4 + 3;
+  std::vector<uint8_t> pixels(3*stride, 7);
+  doc->renderFrame(0, pixels.data(), stride);
+
+  for (int y=0; y<3; ++y) {
+    for (int x=0; x<4; ++x) {
+      const uint8_t* p = &pixels[y*stride + x*4];
+      if (x == 1 && y == 2) {
+        EXPECT_EQ(255, p[0]);
+        EXPECT_EQ(128, p[1]);
+        EXPECT_EQ(64, p[2]);
+        EXPECT_EQ(32, p[3]);
+      }
+      else {
+        EXPECT_EQ(0, p[3]);
+      }
+    }
+    for (int i=4*4; i<stride; ++i)
+      EXPECT_EQ(7, pixels[y*stride + i]);
+  }
+}
+
+TEST(EmbedDocument, FileNotFound)
+{
+  EXPECT_THROW(embed::Document::load("this_file_does_not_exist.ase"),
+               std::runtime_error);
+}
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2017  David Capello
 //
 // This program is distributed under the terms of
@@ -56,10 +56,9 @@ void BrightnessContrastFilter::applyToRgba(FilterManager* filterMgr)
   const Palette* pal = fid->getPalette();
   Palette* newPal = (m_usePaletteOnRGB ? fid->getNewPalette(): nullptr);
 
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    color_t c = *src_address;
-
-    if (newPal) {
+  if (newPal) {
+    FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
+      color_t c = *src_address;
       int i =
         pal->findExactMatch(rgba_getr(c),
                             rgba_getg(c),
@@ -67,26 +66,37 @@ void BrightnessContrastFilter::applyToRgba(FilterManager* filterMgr)
                             rgba_geta(c), -1);
       if (i >= 0)
         c = newPal->getEntry(i);
+
+      *dst_address = c;
     }
-    else {
-      applyFilterToRgb(target, c);
-    }
+    FILTER_LOOP_THROUGH_ROW_END()
+    return;
+  }
 
-    *dst_address = c;
+  const Target channels = filterMgr->getTarget();
+  const int* rmap = (channels & TARGET_RED_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* gmap = (channels & TARGET_GREEN_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* bmap = (channels & TARGET_BLUE_CHANNEL ? m_cmap.data(): identity_lut());
+
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
+    const color_t c = *src_address;
+    *dst_address = rgba(rmap[rgba_getr(c)],
+                        gmap[rgba_getg(c)],
+                        bmap[rgba_getb(c)],
+                        rgba_geta(c));
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
 
 void BrightnessContrastFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    color_t c = *src_address;
-    int k = graya_getv(c);
-    int a = graya_geta(c);
-
-    if (target & TARGET_GRAY_CHANNEL) k = m_cmap[k];
+  const int* kmap = (filterMgr->getTarget() & TARGET_GRAY_CHANNEL ?
+                     m_cmap.data(): identity_lut());
 
-    *dst_address = graya(k, a);
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
+    const uint16_t c = *src_address;
+    *dst_address = graya(kmap[graya_getv(c)],
+                         graya_geta(c));
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -104,11 +114,16 @@ void BrightnessContrastFilter::applyToIndexed(FilterManager* filterMgr)
   // Apply filter to color region
   const Palette* pal = fid->getPalette();
   const RgbMap* rgbmap = fid->getRgbMap();
+  const uint8_t* lut = m_indexedLut.get(
+    filterMgr,
+    [this, pal, rgbmap, target = filterMgr->getTarget()](const uint8_t i) -> uint8_t {
+      color_t c = pal->getEntry(i);
+      applyFilterToRgb(target, c);
+      return rgbmap->mapColor(c);
+    });
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    color_t c = pal->getEntry(*src_address);
-    applyFilterToRgb(target, c);
-    *dst_address = rgbmap->mapColor(c);
+    *dst_address = lut[*src_address];
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
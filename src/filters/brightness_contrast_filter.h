@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2017  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +12,7 @@
 #include "doc/color.h"
 #include "doc/palette_picks.h"
 #include "filters/filter.h"
+#include "filters/lut.h"
 #include "filters/target.h"
 
 #include <vector>
@@ -41,6 +42,7 @@ namespace filters {
 
     double m_brightness, m_contrast;
     std::vector<int> m_cmap;
+    IndexedLut m_indexedLut;
   };
 
 } // namespace filters
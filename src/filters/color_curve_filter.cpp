@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -51,40 +51,32 @@ const char* ColorCurveFilter::getName()
 
 void ColorCurveFilter::applyToRgba(FilterManager* filterMgr)
 {
-  int c, r, g, b, a;
+  const Target channels = filterMgr->getTarget();
+  const int* rmap = (channels & TARGET_RED_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* gmap = (channels & TARGET_GREEN_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* bmap = (channels & TARGET_BLUE_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* amap = (channels & TARGET_ALPHA_CHANNEL ? m_cmap.data(): identity_lut());
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    c = *src_address;
-
-    r = rgba_getr(c);
-    g = rgba_getg(c);
-    b = rgba_getb(c);
-    a = rgba_geta(c);
-
-    if (target & TARGET_RED_CHANNEL) r = m_cmap[r];
-    if (target & TARGET_GREEN_CHANNEL) g = m_cmap[g];
-    if (target & TARGET_BLUE_CHANNEL) b = m_cmap[b];
-    if (target & TARGET_ALPHA_CHANNEL) a = m_cmap[a];
-
-    *dst_address = rgba(r, g, b, a);
+    const color_t c = *src_address;
+    *dst_address = rgba(rmap[rgba_getr(c)],
+                        gmap[rgba_getg(c)],
+                        bmap[rgba_getb(c)],
+                        amap[rgba_geta(c)]);
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
 
 void ColorCurveFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  int c, k, a;
+  const Target channels = filterMgr->getTarget();
+  const int* kmap = (channels & TARGET_GRAY_CHANNEL ? m_cmap.data(): identity_lut());
+  const int* amap = (channels & TARGET_ALPHA_CHANNEL ? m_cmap.data(): identity_lut());
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    c = *src_address;
-
-    k = graya_getv(c);
-    a = graya_geta(c);
-
-    if (target & TARGET_GRAY_CHANNEL) k = m_cmap[k];
-    if (target & TARGET_ALPHA_CHANNEL) a = m_cmap[a];
-
-    *dst_address = graya(k, a);
+    const uint16_t c = *src_address;
+    *dst_address = graya(kmap[graya_getv(c)],
+                         amap[graya_geta(c)]);
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -93,30 +85,34 @@ void ColorCurveFilter::applyToIndexed(FilterManager* filterMgr)
 {
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
-  int c, r, g, b, a;
+  const uint8_t* lut = m_indexedLut.get(
+    filterMgr,
+    [this, pal, rgbmap, target = filterMgr->getTarget()](const uint8_t i) -> uint8_t {
+      int c = i;
+
+      if (target & TARGET_INDEX_CHANNEL) {
+        c = m_cmap[c];
+      }
+      else {
+        c = pal->getEntry(c);
+        int r = rgba_getr(c);
+        int g = rgba_getg(c);
+        int b = rgba_getb(c);
+        int a = rgba_geta(c);
+
+        if (target & TARGET_RED_CHANNEL  ) r = m_cmap[r];
+        if (target & TARGET_GREEN_CHANNEL) g = m_cmap[g];
+        if (target & TARGET_BLUE_CHANNEL ) b = m_cmap[b];
+        if (target & TARGET_ALPHA_CHANNEL) a = m_cmap[a];
+
+        c = rgbmap->mapColor(r, g, b, a);
+      }
+
+      return std::clamp(c, 0, pal->size()-1);
+    });
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    c = *src_address;
-
-    if (target & TARGET_INDEX_CHANNEL) {
-      c = m_cmap[c];
-    }
-    else {
-      c = pal->getEntry(c);
-      r = rgba_getr(c);
-      g = rgba_getg(c);
-      b = rgba_getb(c);
-      a = rgba_geta(c);
-
-      if (target & TARGET_RED_CHANNEL  ) r = m_cmap[r];
-      if (target & TARGET_GREEN_CHANNEL) g = m_cmap[g];
-      if (target & TARGET_BLUE_CHANNEL ) b = m_cmap[b];
-      if (target & TARGET_ALPHA_CHANNEL) a = m_cmap[a];
-
-      c = rgbmap->mapColor(r, g, b, a);
-    }
-
-    *dst_address = std::clamp(c, 0, pal->size()-1);
+    *dst_address = lut[*src_address];
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -13,6 +13,7 @@
 
 #include "filters/filter.h"
 #include "filters/color_curve.h"
+#include "filters/lut.h"
 
 namespace filters {
 
@@ -34,6 +35,7 @@ namespace filters {
 
     ColorCurve m_curve;
     std::vector<int> m_cmap;
+    IndexedLut m_indexedLut;
   };
 
 } // namespace filters
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -19,6 +19,9 @@
 #include "doc/palette.h"
 #include "doc/rgbmap.h"
 
+#include <algorithm>
+#include <numeric>
+
 namespace filters {
 
 using namespace doc;
@@ -43,6 +46,16 @@ namespace {
       r = g = b = a = 0;
     }
 
+    // Loads the sums calculated in the r, g, b, a, and opaque weight
+    // channels of ConvolutionMatrixFilter::Rows.
+    void load(const int* acc, const int stride, const int div0) {
+      r = acc[0];
+      g = acc[stride];
+      b = acc[2*stride];
+      a = acc[3*stride];
+      div = div0 + acc[4*stride];
+    }
+
     void operator()(RgbTraits::pixel_t color) {
       if (*matrixData) {
         if (rgba_geta(color) == 0)
@@ -66,6 +79,12 @@ namespace {
       v = a = 0;
     }
 
+    void load(const int* acc, const int stride, const int div0) {
+      v = acc[0];
+      a = acc[stride];
+      div = div0 + acc[2*stride];
+    }
+
     void operator()(GrayscaleTraits::pixel_t color) {
       if (*matrixData) {
         if (graya_geta(color) == 0)
@@ -90,6 +109,15 @@ namespace {
       r = g = b = a = index = 0;
     }
 
+    void load(const int* acc, const int stride, const int div0) {
+      index = acc[0];
+      r = acc[stride];
+      g = acc[2*stride];
+      b = acc[3*stride];
+      a = acc[4*stride];
+      div = div0 + acc[5*stride];
+    }
+
     void operator()(IndexedTraits::pixel_t color) {
       if (*matrixData) {
         index += color * (*matrixData);
@@ -107,22 +135,164 @@ namespace {
     }
   };
 
+  // Functions to unpack a pixel in int channels for
+  // ConvolutionMatrixFilter::Rows. Transparent pixels are unpacked as
+  // zeros (they are not counted in the convolution, in the same way
+  // as the GetPixelsDelegate* structs), and the last channel is 1 for
+  // opaque pixels to know the weight of the transparent ones.
+
+  struct UnpackRgba {
+    static constexpr int kChannels = 5;
+
+    void operator()(const RgbTraits::pixel_t color, int* out, const int stride) const {
+      const bool opaque = (rgba_geta(color) != 0);
+      out[0]        = (opaque ? rgba_getr(color): 0);
+      out[stride]   = (opaque ? rgba_getg(color): 0);
+      out[2*stride] = (opaque ? rgba_getb(color): 0);
+      out[3*stride] = rgba_geta(color);
+      out[4*stride] = (opaque ? 1: 0);
+    }
+  };
+
+  struct UnpackGrayscale {
+    static constexpr int kChannels = 3;
+
+    void operator()(const GrayscaleTraits::pixel_t color, int* out, const int stride) const {
+      const bool opaque = (graya_geta(color) != 0);
+      out[0]        = (opaque ? graya_getv(color): 0);
+      out[stride]   = graya_geta(color);
+      out[2*stride] = (opaque ? 1: 0);
+    }
+  };
+
+  struct UnpackIndexed {
+    static constexpr int kChannels = 6;
+    const Palette* pal;
+
+    UnpackIndexed(const Palette* pal) : pal(pal) { }
+
+    void operator()(const IndexedTraits::pixel_t color, int* out, const int stride) const {
+      const color_t rgba = pal->getEntry(color);
+      const bool opaque = (rgba_geta(rgba) != 0);
+      out[0]        = color;
+      out[stride]   = (opaque ? rgba_getr(rgba): 0);
+      out[2*stride] = (opaque ? rgba_getg(rgba): 0);
+      out[3*stride] = (opaque ? rgba_getb(rgba): 0);
+      out[4*stride] = rgba_geta(rgba);
+      out[5*stride] = (opaque ? 1: 0);
+    }
+  };
+
+  // Returns true if the matrix is the product of a column and a row of
+  // integer weights, i.e. value(x, y) = colWeights[y] * rowWeights[x]
+  // (e.g. blur-3x3 or edges-find-horizontal/vertical).
+  bool split_separable_matrix(const ConvolutionMatrix* matrix,
+                              std::vector<int>& rowWeights,
+                              std::vector<int>& colWeights)
+  {
+    const int w = matrix->getWidth();
+    const int h = matrix->getHeight();
+    if (w < 2 || h < 2)
+      return false;
+
+    // The first row with non-zero values (divided by their greatest
+    // common divisor) gives us the row weights.
+    int y0 = 0;
+    int gcd = 0;
+    for (; y0<h && gcd == 0; ++y0) {
+      for (int x=0; x<w; ++x)
+        gcd = std::gcd(gcd, matrix->value(x, y0));
+    }
+    if (gcd == 0)
+      return false;
+    --y0;
+
+    int x0 = -1;
+    rowWeights.resize(w);
+    for (int x=0; x<w; ++x) {
+      rowWeights[x] = matrix->value(x, y0) / gcd;
+      if (x0 < 0 && rowWeights[x] != 0)
+        x0 = x;
+    }
+
+    colWeights.resize(h);
+    for (int y=0; y<h; ++y) {
+      const int v = matrix->value(x0, y);
+      if (v % rowWeights[x0] != 0)
+        return false;
+
+      colWeights[y] = v / rowWeights[x0];
+      for (int x=0; x<w; ++x) {
+        if (colWeights[y] * rowWeights[x] != matrix->value(x, y))
+          return false;
+      }
+    }
+    return true;
+  }
+
+  // Position of the pixel used for the given position outside the
+  // image in the same way as get_neighboring_pixels() does.
+  inline int wrap_position(const int pos, const int size, const bool tiled)
+  {
+    if (pos < 0)
+      return (tiled ? size - (-(pos+1) % size) - 1: 0);
+    else if (pos >= size)
+      return (tiled ? pos % size: size-1);
+    else
+      return pos;
+  }
+
+  // Simple loop that the compiler can vectorize.
+  inline void add_weighted_row(int* dst, const int* src, const int n, const int weight)
+  {
+    for (int i=0; i<n; ++i)
+      dst[i] += weight * src[i];
+  }
+
 }
 
+// Rows of the source image (unpacked in int channels) around the row
+// that is being filtered, so we can reuse them for the next row. When
+// the matrix is separable, rows are stored already convolved with the
+// row weights and each pixel needs matrix width + height
+// multiplications instead of width * height.
+struct ConvolutionMatrixFilter::Rows {
+  const Image* src = nullptr;
+  const ConvolutionMatrix* matrix = nullptr;
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int nchannels = 0;
+  int stride = 0;               // Number of ints of each channel in a row
+  int div0 = 0;                 // Matrix div minus the sum of all weights
+  bool separable = false;
+  std::vector<int> rowWeights;
+  std::vector<int> colWeights;
+  std::vector<int> ring;        // Matrix height rows (nchannels*stride ints each one)
+  std::vector<int> unpacked;    // Unpacked row for the separable case
+  std::vector<int> acc;         // Sums for the current row (nchannels*width)
+};
+
 ConvolutionMatrixFilter::ConvolutionMatrixFilter()
   : m_matrix(NULL)
   , m_tiledMode(TiledMode::NONE)
 {
 }
 
+ConvolutionMatrixFilter::~ConvolutionMatrixFilter()
+{
+}
+
 void ConvolutionMatrixFilter::setMatrix(const std::shared_ptr<ConvolutionMatrix>& matrix)
 {
   m_matrix = matrix;
+  m_rows.clear();
 }
 
 void ConvolutionMatrixFilter::setTiledMode(TiledMode tiledMode)
 {
   m_tiledMode = tiledMode;
+  m_rows.clear();
 }
 
 const char* ConvolutionMatrixFilter::getName()
@@ -130,6 +300,130 @@ const char* ConvolutionMatrixFilter::getName()
   return "Convolution Matrix";
 }
 
+// Returns the sums of the convolution for each channel of the current
+// row of filterMgr, or nullptr if we have to use
+// get_neighboring_pixels() for each pixel.
+template<typename Traits, typename Unpack>
+ConvolutionMatrixFilter::Rows*
+ConvolutionMatrixFilter::getRows(FilterManager* filterMgr,
+                                 const int nchannels,
+                                 Unpack unpack)
+{
+  const Image* src = filterMgr->getSourceImage();
+  const ConvolutionMatrix* matrix = m_matrix.get();
+  const int mw = matrix->getWidth();
+  const int mh = matrix->getHeight();
+  const bool tiledX = (int(m_tiledMode) & int(TiledMode::X_AXIS));
+  const bool tiledY = (int(m_tiledMode) & int(TiledMode::Y_AXIS));
+
+  // get_neighboring_pixels() doesn't repeat the border pixels in the
+  // same way when the matrix is bigger than the image.
+  if ((!tiledX && mw > src->width()) ||
+      (!tiledY && mh > src->height()))
+    return nullptr;
+
+  Rows* rows;
+  {
+    const std::lock_guard lock(m_rowsMutex);
+    auto& ptr = m_rows[std::this_thread::get_id()];
+    if (!ptr)
+      ptr = std::make_unique<Rows>();
+    rows = ptr.get();
+  }
+
+  const int x = filterMgr->x();
+  const int y = filterMgr->y();
+  const int width = filterMgr->getWidth();
+  const int cx = matrix->getCenterX();
+  const int cy = matrix->getCenterY();
+  const int ext = width + mw - 1; // Pixels of a row needed to filter "width" pixels
+
+  // Unpacks and stores in the ring the "ly" source row (which can be
+  // outside the image).
+  auto loadRow = [rows, src, &unpack, x, width, nchannels, ext,
+                  cx, mw, mh, tiledX, tiledY](const int ly) {
+    const int sy = wrap_position(ly, src->height(), tiledY);
+    const auto srcAddress =
+      (typename Traits::const_address_t)src->getPixelAddress(0, sy);
+    const int i = ((ly % mh) + mh) % mh;
+    int* slot = &rows->ring[i * nchannels * rows->stride];
+    int* out = (rows->separable ? &rows->unpacked[0]: slot);
+
+    for (int dx=0; dx<ext; ++dx) {
+      const int sx = wrap_position(x-cx+dx, src->width(), tiledX);
+      unpack(srcAddress[sx], out+dx, ext);
+    }
+
+    // Apply the row weights
+    if (rows->separable) {
+      std::fill(slot, slot + nchannels*width, 0);
+      for (int c=0; c<nchannels; ++c) {
+        for (int dx=0; dx<mw; ++dx) {
+          if (const int w = rows->rowWeights[dx])
+            add_weighted_row(slot + c*width, out + c*ext + dx, width, w);
+        }
+      }
+    }
+  };
+
+  if (filterMgr->isFirstRow() ||
+      rows->src != src ||
+      rows->matrix != matrix ||
+      rows->x != x ||
+      rows->y+1 != y ||
+      rows->width != width ||
+      rows->nchannels != nchannels) {
+    rows->src = src;
+    rows->matrix = matrix;
+    rows->x = x;
+    rows->width = width;
+    rows->nchannels = nchannels;
+    rows->separable = split_separable_matrix(matrix,
+                                             rows->rowWeights,
+                                             rows->colWeights);
+    rows->stride = (rows->separable ? width: ext);
+    rows->ring.resize(mh * nchannels * rows->stride);
+    rows->unpacked.resize(rows->separable ? nchannels * ext: 0);
+    rows->acc.resize(nchannels * width);
+
+    rows->div0 = matrix->getDiv();
+    for (int my=0; my<mh; ++my)
+      for (int mx=0; mx<mw; ++mx)
+        rows->div0 -= matrix->value(mx, my);
+
+    for (int dy=0; dy<mh; ++dy)
+      loadRow(y-cy+dy);
+  }
+  // Only the last row is new
+  else {
+    loadRow(y-cy+mh-1);
+  }
+  rows->y = y;
+
+  // Sum the rows of the ring with the column weights (or with each
+  // matrix value when the matrix is not separable)
+  int* acc = &rows->acc[0];
+  std::fill(rows->acc.begin(), rows->acc.end(), 0);
+  for (int dy=0; dy<mh; ++dy) {
+    const int ly = y-cy+dy;
+    const int* slot = &rows->ring[(((ly % mh) + mh) % mh) * nchannels * rows->stride];
+
+    for (int c=0; c<nchannels; ++c) {
+      if (rows->separable) {
+        if (const int w = rows->colWeights[dy])
+          add_weighted_row(acc + c*width, slot + c*rows->stride, width, w);
+      }
+      else {
+        for (int dx=0; dx<mw; ++dx) {
+          if (const int w = matrix->value(dx, dy))
+            add_weighted_row(acc + c*width, slot + c*rows->stride + dx, width, w);
+        }
+      }
+    }
+  }
+  return rows;
+}
+
 void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
 {
   if (!m_matrix)
@@ -138,15 +432,22 @@ void ConvolutionMatrixFilter::applyToRgba(FilterManager* filterMgr)
   const Image* src = filterMgr->getSourceImage();
   uint32_t color;
   GetPixelsDelegateRgba delegate;
+  const Rows* rows = getRows<RgbTraits>(filterMgr, UnpackRgba::kChannels, UnpackRgba());
+  const int x0 = filterMgr->x();
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    delegate.reset(m_matrix.get());
-    get_neighboring_pixels<RgbTraits>(src, x, y,
-                                      m_matrix->getWidth(),
-                                      m_matrix->getHeight(),
-                                      m_matrix->getCenterX(),
-                                      m_matrix->getCenterY(),
-                                      m_tiledMode, delegate);
+    if (rows) {
+      delegate.load(&rows->acc[x-x0], rows->width, rows->div0);
+    }
+    else {
+      delegate.reset(m_matrix.get());
+      get_neighboring_pixels<RgbTraits>(src, x, y,
+                                        m_matrix->getWidth(),
+                                        m_matrix->getHeight(),
+                                        m_matrix->getCenterX(),
+                                        m_matrix->getCenterY(),
+                                        m_tiledMode, delegate);
+    }
 
     color = get_pixel_fast<RgbTraits>(src, x, y);
     if (delegate.div == 0) {
@@ -195,15 +496,22 @@ void ConvolutionMatrixFilter::applyToGrayscale(FilterManager* filterMgr)
   const Image* src = filterMgr->getSourceImage();
   uint16_t color;
   GetPixelsDelegateGrayscale delegate;
+  const Rows* rows = getRows<GrayscaleTraits>(filterMgr, UnpackGrayscale::kChannels, UnpackGrayscale());
+  const int x0 = filterMgr->x();
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    delegate.reset(m_matrix.get());
-    get_neighboring_pixels<GrayscaleTraits>(src, x, y,
-                                            m_matrix->getWidth(),
-                                            m_matrix->getHeight(),
-                                            m_matrix->getCenterX(),
-                                            m_matrix->getCenterY(),
-                                            m_tiledMode, delegate);
+    if (rows) {
+      delegate.load(&rows->acc[x-x0], rows->width, rows->div0);
+    }
+    else {
+      delegate.reset(m_matrix.get());
+      get_neighboring_pixels<GrayscaleTraits>(src, x, y,
+                                              m_matrix->getWidth(),
+                                              m_matrix->getHeight(),
+                                              m_matrix->getCenterX(),
+                                              m_matrix->getCenterY(),
+                                              m_tiledMode, delegate);
+    }
 
     color = get_pixel_fast<GrayscaleTraits>(src, x, y);
     if (delegate.div == 0) {
@@ -240,15 +548,22 @@ void ConvolutionMatrixFilter::applyToIndexed(FilterManager* filterMgr)
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
   uint8_t color;
   GetPixelsDelegateIndexed delegate(pal);
+  const Rows* rows = getRows<IndexedTraits>(filterMgr, UnpackIndexed::kChannels, UnpackIndexed(pal));
+  const int x0 = filterMgr->x();
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    delegate.reset(m_matrix.get());
-    get_neighboring_pixels<IndexedTraits>(src, x, y,
-                                          m_matrix->getWidth(),
-                                          m_matrix->getHeight(),
-                                          m_matrix->getCenterX(),
-                                          m_matrix->getCenterY(),
-                                          m_tiledMode, delegate);
+    if (rows) {
+      delegate.load(&rows->acc[x-x0], rows->width, rows->div0);
+    }
+    else {
+      delegate.reset(m_matrix.get());
+      get_neighboring_pixels<IndexedTraits>(src, x, y,
+                                            m_matrix->getWidth(),
+                                            m_matrix->getHeight(),
+                                            m_matrix->getCenterX(),
+                                            m_matrix->getCenterY(),
+                                            m_tiledMode, delegate);
+    }
 
     color = get_pixel_fast<IndexedTraits>(src, x, y);
     if (delegate.div == 0) {
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -12,7 +12,10 @@
 #include "filters/filter.h"
 #include "filters/tiled_mode.h"
 
+#include <map>
 #include <memory>
+#include <mutex>
+#include <thread>
 
 namespace filters {
 
@@ -21,6 +24,7 @@ namespace filters {
   class ConvolutionMatrixFilter : public Filter {
   public:
     ConvolutionMatrixFilter();
+    ~ConvolutionMatrixFilter();
 
     void setMatrix(const std::shared_ptr<ConvolutionMatrix>& matrix);
     void setTiledMode(TiledMode tiledMode);
@@ -35,8 +39,20 @@ namespace filters {
     void applyToIndexed(FilterManager* filterMgr);
 
   private:
+    struct Rows;
+
+    template<typename Traits, typename Unpack>
+    Rows* getRows(FilterManager* filterMgr,
+                  const int nchannels,
+                  Unpack unpack);
+
     std::shared_ptr<ConvolutionMatrix> m_matrix;
     TiledMode m_tiledMode;
+
+    // Rows used by each thread (rows can be filtered from several
+    // threads at the same time, see Filter::canApplyInParallel()).
+    std::mutex m_rowsMutex;
+    std::map<std::thread::id, std::unique_ptr<Rows>> m_rows;
   };
 
 } // namespace filters
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2017-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -21,12 +21,50 @@
 #include "gfx/hsv.h"
 #include "gfx/rgb.h"
 
+#include <algorithm>
 #include <cmath>
 
 namespace filters {
 
 using namespace doc;
 
+namespace {
+
+  // Direct-mapped cache of filtered colors. Images usually contain a
+  // lot of pixels with the same color, and converting each one to
+  // HSL/HSV and back is expensive.
+  class ColorCache {
+  public:
+    static constexpr int kBits = 8;
+
+    template<typename Func>
+    ColorCache(Func func) {
+      // All entries start with the result for the 0 color
+      color_t c = 0;
+      func(c);
+      std::fill(std::begin(m_keys), std::end(m_keys), 0);
+      std::fill(std::begin(m_values), std::end(m_values), c);
+    }
+
+    template<typename Func>
+    color_t get(const color_t c, Func func) {
+      const int i = (c * 2654435761u) >> (32 - kBits);
+      if (m_keys[i] != c) {
+        color_t d = c;
+        func(d);
+        m_keys[i] = c;
+        m_values[i] = d;
+      }
+      return m_values[i];
+    }
+
+  private:
+    color_t m_keys[1 << kBits];
+    color_t m_values[1 << kBits];
+  };
+
+}
+
 const char* HueSaturationFilter::getName()
 {
   return "Hue Saturation Color";
@@ -39,6 +77,7 @@ HueSaturationFilter::HueSaturationFilter()
   , m_l(0.0)
   , m_a(0.0)
 {
+  updateMaps();
 }
 
 void HueSaturationFilter::setMode(Mode mode)
@@ -59,11 +98,13 @@ void HueSaturationFilter::setSaturation(double s)
 void HueSaturationFilter::setLightness(double l)
 {
   m_l = l;
+  updateMaps();
 }
 
 void HueSaturationFilter::setAlpha(double a)
 {
   m_a = a;
+  updateMaps();
 }
 
 void HueSaturationFilter::applyToRgba(FilterManager* filterMgr)
@@ -72,10 +113,9 @@ void HueSaturationFilter::applyToRgba(FilterManager* filterMgr)
   const Palette* pal = fid->getPalette();
   Palette* newPal = (m_usePaletteOnRGB ? fid->getNewPalette(): nullptr);
 
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    color_t c = *src_address;
-
-    if (newPal) {
+  if (newPal) {
+    FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
+      color_t c = *src_address;
       int i =
         pal->findExactMatch(rgba_getr(c),
                             rgba_getg(c),
@@ -83,41 +123,34 @@ void HueSaturationFilter::applyToRgba(FilterManager* filterMgr)
                             rgba_geta(c), -1);
       if (i >= 0)
         c = newPal->getEntry(i);
+
+      *dst_address = c;
     }
-    else {
-      applyFilterToRgb(target, c);
-    }
+    FILTER_LOOP_THROUGH_ROW_END()
+    return;
+  }
 
-    *dst_address = c;
+  auto filterColor = [this, target = filterMgr->getTarget()](color_t& c) {
+    applyFilterToRgb(target, c);
+  };
+  ColorCache cache(filterColor);
+
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
+    *dst_address = cache.get(*src_address, filterColor);
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
 
 void HueSaturationFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    color_t c = *src_address;
-    int k = graya_getv(c);
-    int a = graya_geta(c);
+  const Target channels = filterMgr->getTarget();
+  const int* kmap = (channels & TARGET_GRAY_CHANNEL ? m_grayMap: identity_lut());
+  const int* amap = (channels & TARGET_ALPHA_CHANNEL ? m_alphaMap: identity_lut());
 
-    {
-      gfx::Hsl hsl(gfx::Rgb(k, k, k));
-
-      double l = hsl.lightness()*(1.0+m_l);
-      l = std::clamp(l, 0.0, 1.0);
-
-      hsl.lightness(l);
-      gfx::Rgb rgb(hsl);
-
-      if (target & TARGET_GRAY_CHANNEL) k = rgb.red();
-
-      if (a && (target & TARGET_ALPHA_CHANNEL)) {
-        a = a*(1.0+m_a);
-        a = std::clamp(a, 0, 255);
-      }
-    }
-
-    *dst_address = graya(k, a);
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
+    const uint16_t c = *src_address;
+    *dst_address = graya(kmap[graya_getv(c)],
+                         amap[graya_geta(c)]);
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -134,11 +167,16 @@ void HueSaturationFilter::applyToIndexed(FilterManager* filterMgr)
   FilterIndexedData* fid = filterMgr->getIndexedData();
   const Palette* pal = fid->getPalette();
   const RgbMap* rgbmap = fid->getRgbMap();
+  const uint8_t* lut = m_indexedLut.get(
+    filterMgr,
+    [this, pal, rgbmap, target = filterMgr->getTarget()](const uint8_t i) -> uint8_t {
+      color_t c = pal->getEntry(i);
+      applyFilterToRgb(target, c);
+      return rgbmap->mapColor(c);
+    });
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    color_t c = pal->getEntry(*src_address);
-    applyFilterToRgb(target, c);
-    *dst_address = rgbmap->mapColor(c);
+    *dst_address = lut[*src_address];
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -199,10 +237,8 @@ void HueSaturationFilter::applyFilterToRgbT(const Target target,
   if (target & TARGET_RED_CHANNEL  ) r = rgb.red();
   if (target & TARGET_GREEN_CHANNEL) g = rgb.green();
   if (target & TARGET_BLUE_CHANNEL ) b = rgb.blue();
-  if (a && (target & TARGET_ALPHA_CHANNEL)) {
-    a = a*(1.0+m_a);
-    a = std::clamp(a, 0, 255);
-  }
+  if (target & TARGET_ALPHA_CHANNEL)
+    a = m_alphaMap[a];
 
   c = rgba(r, g, b, a);
 }
@@ -233,4 +269,21 @@ void HueSaturationFilter::applyFilterToRgb(const Target target, doc::color_t& co
   }
 }
 
+void HueSaturationFilter::updateMaps()
+{
+  for (int k=0; k<256; ++k) {
+    gfx::Hsl hsl(gfx::Rgb(k, k, k));
+
+    double l = hsl.lightness()*(1.0+m_l);
+    l = std::clamp(l, 0.0, 1.0);
+
+    hsl.lightness(l);
+    m_grayMap[k] = gfx::Rgb(hsl).red();
+  }
+
+  m_alphaMap[0] = 0;
+  for (int a=1; a<256; ++a)
+    m_alphaMap[a] = std::clamp(int(a*(1.0+m_a)), 0, 255);
+}
+
 } // namespace filters
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2017-2018  David Capello
 //
 // This program is distributed under the terms of
@@ -11,6 +11,7 @@
 
 #include "doc/color.h"
 #include "filters/filter.h"
+#include "filters/lut.h"
 #include "filters/target.h"
 
 namespace filters {
@@ -45,9 +46,13 @@ namespace filters {
              void (T::*set_lightness)(double)>
     void applyFilterToRgbT(const Target target, doc::color_t& color, bool multiply);
     void applyFilterToRgb(const Target target, doc::color_t& color);
+    void updateMaps();
 
     Mode m_mode;
     double m_h, m_s, m_l, m_a;
+    int m_grayMap[256];         // Lightness of each gray value
+    int m_alphaMap[256];
+    IndexedLut m_indexedLut;
   };
 
 } // namespace filters
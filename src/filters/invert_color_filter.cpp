@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This program is distributed under the terms of
@@ -27,40 +28,29 @@ const char* InvertColorFilter::getName()
 
 void InvertColorFilter::applyToRgba(FilterManager* filterMgr)
 {
-  int c, r, g, b, a;
+  // Bits to invert in each pixel
+  const Target channels = filterMgr->getTarget();
+  const uint32_t mask =
+    ((channels & TARGET_RED_CHANNEL) ? rgba(255, 0, 0, 0): 0) |
+    ((channels & TARGET_GREEN_CHANNEL) ? rgba(0, 255, 0, 0): 0) |
+    ((channels & TARGET_BLUE_CHANNEL) ? rgba(0, 0, 255, 0): 0) |
+    ((channels & TARGET_ALPHA_CHANNEL) ? rgba(0, 0, 0, 255): 0);
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    c = *src_address;
-
-    r = rgba_getr(c);
-    g = rgba_getg(c);
-    b = rgba_getb(c);
-    a = rgba_geta(c);
-
-    if (target & TARGET_RED_CHANNEL) r ^= 0xff;
-    if (target & TARGET_GREEN_CHANNEL) g ^= 0xff;
-    if (target & TARGET_BLUE_CHANNEL) b ^= 0xff;
-    if (target & TARGET_ALPHA_CHANNEL) a ^= 0xff;
-
-    *dst_address = rgba(r, g, b, a);
+    *dst_address = *src_address ^ mask;
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
 
 void InvertColorFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  int c, k, a;
+  const Target channels = filterMgr->getTarget();
+  const uint16_t mask =
+    ((channels & TARGET_GRAY_CHANNEL) ? graya(255, 0): 0) |
+    ((channels & TARGET_ALPHA_CHANNEL) ? graya(0, 255): 0);
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    c = *src_address;
-
-    k = graya_getv(c);
-    a = graya_geta(c);
-
-    if (target & TARGET_GRAY_CHANNEL) k ^= 0xff;
-    if (target & TARGET_ALPHA_CHANNEL) a ^= 0xff;
-
-    *dst_address = graya(k, a);
+    *dst_address = *src_address ^ mask;
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -69,29 +59,28 @@ void InvertColorFilter::applyToIndexed(FilterManager* filterMgr)
 {
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
-  int c, r, g, b, a;
-
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    c = *src_address;
-
-    if (target & TARGET_INDEX_CHANNEL)
-      c ^= 0xff;
-    else {
-      c = pal->getEntry(c);
-      r = rgba_getr(c);
-      g = rgba_getg(c);
-      b = rgba_getb(c);
-      a = rgba_geta(c);
+  const uint8_t* lut = m_indexedLut.get(
+    filterMgr,
+    [pal, rgbmap, target = filterMgr->getTarget()](const uint8_t i) -> uint8_t {
+      if (target & TARGET_INDEX_CHANNEL)
+        return i ^ 0xff;
+
+      const color_t c = pal->getEntry(i);
+      int r = rgba_getr(c);
+      int g = rgba_getg(c);
+      int b = rgba_getb(c);
+      int a = rgba_geta(c);
 
       if (target & TARGET_RED_CHANNEL  ) r ^= 0xff;
       if (target & TARGET_GREEN_CHANNEL) g ^= 0xff;
       if (target & TARGET_BLUE_CHANNEL ) b ^= 0xff;
       if (target & TARGET_ALPHA_CHANNEL) a ^= 0xff;
 
-      c = rgbmap->mapColor(r, g, b, a);
-    }
+      return rgbmap->mapColor(r, g, b, a);
+    });
 
-    *dst_address = c;
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
+    *dst_address = lut[*src_address];
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
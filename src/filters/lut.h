@@ -0,0 +1,57 @@
+// Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
+//
+// This program is distributed under the terms of
+// the End-User License Agreement for Aseprite.
+
+#ifndef FILTERS_LUT_H_INCLUDED
+#define FILTERS_LUT_H_INCLUDED
+#pragma once
+
+#include "filters/filter_manager.h"
+
+#include <cstdint>
+
+namespace filters {
+
+  // Returns a table that maps each channel value to itself. Filters
+  // can use it for the channels that are not in the target, so the
+  // same code (without branches) is used for all channels.
+  inline const int* identity_lut() {
+    static const struct Identity {
+      int values[256];
+      Identity() {
+        for (int i=0; i<256; ++i)
+          values[i] = i;
+      }
+    } identity;
+    return identity.values;
+  }
+
+  // Result of a filter for each palette index. Filters applied to
+  // indexed images (which use the palette and the RgbMap) generate
+  // the same output index for the same input index, so we calculate
+  // the 256 entries in the first row instead of calling
+  // RgbMap::mapColor() for each pixel. Indexed images are never
+  // filtered from several threads, so the table can be updated from
+  // Filter::applyToIndexed().
+  class IndexedLut {
+  public:
+    template<typename Func>
+    const uint8_t* get(FilterManager* filterMgr, Func func) {
+      if (filterMgr->isFirstRow() || !m_valid) {
+        for (int i=0; i<256; ++i)
+          m_values[i] = func(uint8_t(i));
+        m_valid = true;
+      }
+      return m_values;
+    }
+
+  private:
+    bool m_valid = false;
+    uint8_t m_values[256];
+  };
+
+} // namespace filters
+
+#endif
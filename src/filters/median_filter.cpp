@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2020  Igara Studio S.A.
+// Copyright (C) 2020-2026  Igara Studio S.A.
 // Copyright (C) 2001-2017  David Capello
 //
 // This program is distributed under the terms of
@@ -21,6 +21,7 @@
 #include "filters/tiled_mode.h"
 
 #include <algorithm>
+#include <cstdint>
 
 namespace filters {
 
@@ -87,6 +88,161 @@ namespace {
       c++;
     }
   };
+
+  // Windows with more pixels than this use the histograms to
+  // calculate the median (for small windows it's faster to select
+  // the median from the window pixels directly).
+  const int kMaxSelectPixels = 25;
+
+  // Returns the coordinate of the source image to get pixels outside
+  // the image bounds (the same as get_neighboring_pixels()).
+  inline int wrap_or_clamp(const int v, const int size, const bool tiled)
+  {
+    if (tiled) {
+      const int r = v % size;
+      return (r < 0 ? r+size: r);
+    }
+    return std::clamp(v, 0, size-1);
+  }
+
+  inline uint8_t select_median(std::vector<uint8_t>& channel, const int n)
+  {
+    std::nth_element(channel.begin(), channel.begin()+n, channel.end());
+    return channel[n];
+  }
+};
+
+// Histograms to calculate the median of each channel of the window in
+// constant time per pixel ("Median Filtering in Constant Time",
+// Perreault and Hebert, 2007). There is one histogram for each column
+// of the window (in each position of the row), which is updated when
+// we move to the next row, and the histogram of the whole window,
+// which is updated adding/subtracting columns when we move to the next
+// pixel. Histograms have 16 coarse bins and 256 fine bins, and the fine
+// bins of the window are updated only when they are needed to find
+// the median.
+struct MedianFilter::Histograms {
+  static constexpr int kBins = 256;
+  static constexpr int kCoarseBins = 16;
+
+  int ncols = 0;
+  int nchannels = 0;
+
+  // Histograms for each channel/column
+  std::vector<uint16_t> colFine;
+  std::vector<uint16_t> colCoarse;
+
+  // Histogram of the window for each channel
+  std::vector<uint32_t> fine;
+  std::vector<uint32_t> coarse;
+
+  // For each channel/coarse bin, the first column of the window where
+  // its fine bins were calculated (-1 if they must be re-calculated).
+  std::vector<int> fineCol;
+
+  // Source image columns of each histogram column
+  std::vector<int> srcCols;
+
+  // Last filtered row, to know if we can update the column
+  // histograms from the previous row
+  const doc::Image* src = nullptr;
+  int x = 0;
+  int y = 0;
+  int width = 0;
+  int height = 0;
+
+  void reset(const int ncols, const int nchannels) {
+    this->ncols = ncols;
+    this->nchannels = nchannels;
+    colFine.assign(size_t(nchannels)*ncols*kBins, 0);
+    colCoarse.assign(size_t(nchannels)*ncols*kCoarseBins, 0);
+    fine.resize(nchannels*kBins);
+    coarse.resize(nchannels*kCoarseBins);
+    fineCol.resize(nchannels*kCoarseBins);
+  }
+
+  uint16_t* columnFine(const int ch, const int col) {
+    return &colFine[(size_t(ch)*ncols + col)*kBins];
+  }
+
+  uint16_t* columnCoarse(const int ch, const int col) {
+    return &colCoarse[(size_t(ch)*ncols + col)*kCoarseBins];
+  }
+
+  // Adds (delta=1) or removes (delta=-1) the channel values "v" of a
+  // pixel to the given column
+  void updateColumn(const int col, const uint8_t* v, const int delta) {
+    for (int ch=0; ch<nchannels; ++ch) {
+      columnFine(ch, col)[v[ch]] += delta;
+      columnCoarse(ch, col)[v[ch] >> 4] += delta;
+    }
+  }
+
+  // Starts the window with the columns [0, w)
+  void startWindow(const int w) {
+    std::fill(coarse.begin(), coarse.end(), 0);
+    std::fill(fineCol.begin(), fineCol.end(), -1);
+    for (int ch=0; ch<nchannels; ++ch) {
+      uint32_t* k = &coarse[ch*kCoarseBins];
+      for (int col=0; col<w; ++col) {
+        const uint16_t* c = columnCoarse(ch, col);
+        for (int i=0; i<kCoarseBins; ++i)
+          k[i] += c[i];
+      }
+    }
+  }
+
+  // Moves the window from the columns [col, col+w) to [col+1, col+w+1)
+  void moveWindow(const int col, const int w) {
+    for (int ch=0; ch<nchannels; ++ch) {
+      uint32_t* k = &coarse[ch*kCoarseBins];
+      const uint16_t* a = columnCoarse(ch, col);
+      const uint16_t* b = columnCoarse(ch, col+w);
+      for (int i=0; i<kCoarseBins; ++i)
+        k[i] += b[i] - a[i];
+    }
+  }
+
+  // Returns the value of the given "rank" (0 is the minimum value) in
+  // the window of columns [col, col+w) for the "ch" channel.
+  int valueAt(const int ch, const int col, const int w, const int rank) {
+    const uint32_t* k = &coarse[ch*kCoarseBins];
+    int acc = 0;
+    int b = 0;
+    for (; b<kCoarseBins-1; ++b) {
+      if (acc + int(k[b]) > rank)
+        break;
+      acc += k[b];
+    }
+
+    // Update the fine bins of the "b" coarse bin
+    uint32_t* f = &fine[ch*kBins + b*kCoarseBins];
+    int& fcol = fineCol[ch*kCoarseBins + b];
+    if (fcol < 0 || col - fcol >= w) {
+      std::fill(f, f+kCoarseBins, 0);
+      for (int c=col; c<col+w; ++c) {
+        const uint16_t* cf = columnFine(ch, c) + b*kCoarseBins;
+        for (int i=0; i<kCoarseBins; ++i)
+          f[i] += cf[i];
+      }
+    }
+    else {
+      for (int c=fcol; c<col; ++c) {
+        const uint16_t* a = columnFine(ch, c) + b*kCoarseBins;
+        const uint16_t* d = columnFine(ch, c+w) + b*kCoarseBins;
+        for (int i=0; i<kCoarseBins; ++i)
+          f[i] += d[i] - a[i];
+      }
+    }
+    fcol = col;
+
+    for (int i=0; i<kCoarseBins-1; ++i) {
+      acc += f[i];
+      if (acc > rank)
+        return b*kCoarseBins + i;
+    }
+    return b*kCoarseBins + kCoarseBins-1;
+  }
 };
 
 MedianFilter::MedianFilter()
@@ -95,6 +251,11 @@ MedianFilter::MedianFilter()
   , m_height(1)
   , m_ncolors(0)
   , m_channel(4)
+  , m_histograms(new Histograms)
+{
+}
+
+MedianFilter::~MedianFilter()
 {
 }
 
@@ -108,9 +269,10 @@ void MedianFilter::setSize(int width, int height)
   ASSERT(width >= 1);
   ASSERT(height >= 1);
 
-  m_width = std::max(1, width);
-  m_height = std::max(1, height);
-  m_ncolors = width*height;
+  // The column histograms use 16-bit counters
+  m_width = std::clamp(width, 1, 0xffff);
+  m_height = std::clamp(height, 1, 0xffff);
+  m_ncolors = m_width*m_height;
 
   for (int c = 0; c < 4; ++c)
     m_channel[c].resize(m_ncolors);
@@ -121,9 +283,117 @@ const char* MedianFilter::getName()
   return "Median Blur";
 }
 
+template<typename Traits, typename GetChannels, typename PutPixel>
+void MedianFilter::applyWithHistograms(FilterManager* filterMgr,
+                                       const int nchannels,
+                                       const bool* channels,
+                                       GetChannels getChannels,
+                                       PutPixel putPixel)
+{
+  using pixel_t = typename Traits::pixel_t;
+
+  const Image* src = filterMgr->getSourceImage();
+  const int x0 = filterMgr->x();
+  const int y = filterMgr->y();
+  const int w = filterMgr->getWidth();
+  const int ncols = w + m_width - 1;
+  const bool tiledX = (int(m_tiledMode) & int(TiledMode::X_AXIS));
+  const bool tiledY = (int(m_tiledMode) & int(TiledMode::Y_AXIS));
+  Histograms& h = *m_histograms;
+  uint8_t v[4];
+
+  // Continue from the previous row, just removing the first row of
+  // the previous window and adding the last row of this window in
+  // each column.
+  if (!filterMgr->isFirstRow() &&
+      h.src == src &&
+      h.x == x0 &&
+      h.y+1 == y &&
+      h.width == w &&
+      h.height == m_height &&
+      h.ncols == ncols &&
+      h.nchannels == nchannels) {
+    const int oldY = wrap_or_clamp(y-1-m_height/2, src->height(), tiledY);
+    const int newY = wrap_or_clamp(y-1-m_height/2+m_height, src->height(), tiledY);
+    for (int col=0; col<ncols; ++col) {
+      getChannels(get_pixel_fast<Traits>(src, h.srcCols[col], newY), v);
+      h.updateColumn(col, v, 1);
+      getChannels(get_pixel_fast<Traits>(src, h.srcCols[col], oldY), v);
+      h.updateColumn(col, v, -1);
+    }
+  }
+  // Create the column histograms from scratch
+  else {
+    h.reset(ncols, nchannels);
+    h.srcCols.resize(ncols);
+    for (int col=0; col<ncols; ++col)
+      h.srcCols[col] = wrap_or_clamp(x0-m_width/2+col, src->width(), tiledX);
+
+    for (int dy=0; dy<m_height; ++dy) {
+      const int srcY = wrap_or_clamp(y-m_height/2+dy, src->height(), tiledY);
+      for (int col=0; col<ncols; ++col) {
+        getChannels(get_pixel_fast<Traits>(src, h.srcCols[col], srcY), v);
+        h.updateColumn(col, v, 1);
+      }
+    }
+  }
+  h.src = src;
+  h.x = x0;
+  h.y = y;
+  h.width = w;
+  h.height = m_height;
+
+  auto src_address = (const pixel_t*)filterMgr->getSourceAddress();
+  auto dst_address = (pixel_t*)filterMgr->getDestinationAddress();
+  auto& token = filterMgr->taskToken();
+  const int rank = m_ncolors/2;
+  int med[4] = { 0, 0, 0, 0 };
+
+  h.startWindow(m_width);
+  for (int i=0; i<w && !token.canceled(); ++i, ++src_address, ++dst_address) {
+    if (i > 0)
+      h.moveWindow(i-1, m_width);
+
+    if (filterMgr->skipPixel())
+      continue;
+
+    for (int ch=0; ch<nchannels; ++ch) {
+      if (channels[ch])
+        med[ch] = h.valueAt(ch, i, m_width, rank);
+    }
+    putPixel(dst_address, *src_address, med);
+  }
+}
+
 void MedianFilter::applyToRgba(FilterManager* filterMgr)
 {
+  if (m_ncolors > kMaxSelectPixels) {
+    const Target target = filterMgr->getTarget();
+    const bool channels[4] = {
+      (target & TARGET_RED_CHANNEL) != 0,
+      (target & TARGET_GREEN_CHANNEL) != 0,
+      (target & TARGET_BLUE_CHANNEL) != 0,
+      (target & TARGET_ALPHA_CHANNEL) != 0
+    };
+    applyWithHistograms<RgbTraits>(
+      filterMgr, 4, channels,
+      [](const color_t c, uint8_t* v) {
+        v[0] = rgba_getr(c);
+        v[1] = rgba_getg(c);
+        v[2] = rgba_getb(c);
+        v[3] = rgba_geta(c);
+      },
+      [&channels](uint32_t* dst, const color_t c, const int* med) {
+        *dst = rgba(channels[0] ? med[0]: rgba_getr(c),
+                    channels[1] ? med[1]: rgba_getg(c),
+                    channels[2] ? med[2]: rgba_getb(c),
+                    channels[3] ? med[3]: rgba_geta(c));
+      });
+    return;
+  }
+
   const Image* src = filterMgr->getSourceImage();
+  const int n = m_ncolors/2;
   int color, r, g, b, a;
   GetPixelsDelegateRgba delegate(m_channel);
 
@@ -134,31 +404,23 @@ void MedianFilter::applyToRgba(FilterManager* filterMgr)
 
     color = get_pixel_fast<RgbTraits>(src, x, y);
 
-    if (target & TARGET_RED_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      r = m_channel[0][m_ncolors/2];
-    }
+    if (target & TARGET_RED_CHANNEL)
+      r = select_median(m_channel[0], n);
     else
       r = rgba_getr(color);
 
-    if (target & TARGET_GREEN_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      g = m_channel[1][m_ncolors/2];
-    }
+    if (target & TARGET_GREEN_CHANNEL)
+      g = select_median(m_channel[1], n);
     else
       g = rgba_getg(color);
 
-    if (target & TARGET_BLUE_CHANNEL) {
-      std::sort(m_channel[2].begin(), m_channel[2].end());
-      b = m_channel[2][m_ncolors/2];
-    }
+    if (target & TARGET_BLUE_CHANNEL)
+      b = select_median(m_channel[2], n);
     else
       b = rgba_getb(color);
 
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[3].begin(), m_channel[3].end());
-      a = m_channel[3][m_ncolors/2];
-    }
+    if (target & TARGET_ALPHA_CHANNEL)
+      a = select_median(m_channel[3], n);
     else
       a = rgba_geta(color);
 
@@ -169,7 +431,27 @@ void MedianFilter::applyToRgba(FilterManager* filterMgr)
 
 void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
 {
+  if (m_ncolors > kMaxSelectPixels) {
+    const Target target = filterMgr->getTarget();
+    const bool channels[2] = {
+      (target & TARGET_GRAY_CHANNEL) != 0,
+      (target & TARGET_ALPHA_CHANNEL) != 0
+    };
+    applyWithHistograms<GrayscaleTraits>(
+      filterMgr, 2, channels,
+      [](const color_t c, uint8_t* v) {
+        v[0] = graya_getv(c);
+        v[1] = graya_geta(c);
+      },
+      [&channels](uint16_t* dst, const color_t c, const int* med) {
+        *dst = graya(channels[0] ? med[0]: graya_getv(c),
+                     channels[1] ? med[1]: graya_geta(c));
+      });
+    return;
+  }
+
   const Image* src = filterMgr->getSourceImage();
+  const int n = m_ncolors/2;
   int color, k, a;
   GetPixelsDelegateGrayscale delegate(m_channel);
 
@@ -180,17 +462,13 @@ void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
 
     color = get_pixel_fast<GrayscaleTraits>(src, x, y);
 
-    if (target & TARGET_GRAY_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      k = m_channel[0][m_ncolors/2];
-    }
+    if (target & TARGET_GRAY_CHANNEL)
+      k = select_median(m_channel[0], n);
     else
       k = graya_getv(color);
 
-    if (target & TARGET_ALPHA_CHANNEL) {
-      std::sort(m_channel[1].begin(), m_channel[1].end());
-      a = m_channel[1][m_ncolors/2];
-    }
+    if (target & TARGET_ALPHA_CHANNEL)
+      a = select_median(m_channel[1], n);
     else
       a = graya_geta(color);
 
@@ -201,9 +479,51 @@ void MedianFilter::applyToGrayscale(FilterManager* filterMgr)
 
 void MedianFilter::applyToIndexed(FilterManager* filterMgr)
 {
-  const Image* src = filterMgr->getSourceImage();
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
+
+  if (m_ncolors > kMaxSelectPixels) {
+    const Target target = filterMgr->getTarget();
+    if (target & TARGET_INDEX_CHANNEL) {
+      const bool channels[1] = { true };
+      applyWithHistograms<IndexedTraits>(
+        filterMgr, 1, channels,
+        [](const color_t c, uint8_t* v) {
+          v[0] = c;
+        },
+        [](uint8_t* dst, const color_t c, const int* med) {
+          *dst = med[0];
+        });
+    }
+    else {
+      const bool channels[4] = {
+        (target & TARGET_RED_CHANNEL) != 0,
+        (target & TARGET_GREEN_CHANNEL) != 0,
+        (target & TARGET_BLUE_CHANNEL) != 0,
+        (target & TARGET_ALPHA_CHANNEL) != 0
+      };
+      applyWithHistograms<IndexedTraits>(
+        filterMgr, 4, channels,
+        [pal](const color_t c, uint8_t* v) {
+          const color_t rgb = pal->getEntry(c);
+          v[0] = rgba_getr(rgb);
+          v[1] = rgba_getg(rgb);
+          v[2] = rgba_getb(rgb);
+          v[3] = rgba_geta(rgb);
+        },
+        [pal, rgbmap, &channels](uint8_t* dst, const color_t c, const int* med) {
+          const color_t rgb = pal->getEntry(c);
+          *dst = rgbmap->mapColor(channels[0] ? med[0]: rgba_getr(rgb),
+                                  channels[1] ? med[1]: rgba_getg(rgb),
+                                  channels[2] ? med[2]: rgba_getb(rgb),
+                                  channels[3] ? med[3]: rgba_geta(rgb));
+        });
+    }
+    return;
+  }
+
+  const Image* src = filterMgr->getSourceImage();
+  const int n = m_ncolors/2;
   int color, r, g, b, a;
   GetPixelsDelegateIndexed delegate(pal, m_channel, filterMgr->getTarget());
 
@@ -213,38 +533,29 @@ void MedianFilter::applyToIndexed(FilterManager* filterMgr)
                                           m_tiledMode, delegate);
 
     if (target & TARGET_INDEX_CHANNEL) {
-      std::sort(m_channel[0].begin(), m_channel[0].end());
-      *dst_address = m_channel[0][m_ncolors/2];
+      *dst_address = select_median(m_channel[0], n);
     }
     else {
       color = get_pixel_fast<IndexedTraits>(src, x, y);
       color = pal->getEntry(color);
 
-      if (target & TARGET_RED_CHANNEL) {
-        std::sort(m_channel[0].begin(), m_channel[0].end());
-        r = m_channel[0][m_ncolors/2];
-      }
+      if (target & TARGET_RED_CHANNEL)
+        r = select_median(m_channel[0], n);
       else
         r = rgba_getr(color);
 
-      if (target & TARGET_GREEN_CHANNEL) {
-        std::sort(m_channel[1].begin(), m_channel[1].end());
-        g = m_channel[1][m_ncolors/2];
-      }
+      if (target & TARGET_GREEN_CHANNEL)
+        g = select_median(m_channel[1], n);
       else
-        g = rgba_getg(pal->getEntry(color));
+        g = rgba_getg(color);
 
-      if (target & TARGET_BLUE_CHANNEL) {
-        std::sort(m_channel[2].begin(), m_channel[2].end());
-        b = m_channel[2][m_ncolors/2];
-      }
+      if (target & TARGET_BLUE_CHANNEL)
+        b = select_median(m_channel[2], n);
       else
         b = rgba_getb(color);
 
-      if (target & TARGET_ALPHA_CHANNEL) {
-        std::sort(m_channel[3].begin(), m_channel[3].end());
-        a = m_channel[3][m_ncolors/2];
-      }
+      if (target & TARGET_ALPHA_CHANNEL)
+        a = select_median(m_channel[3], n);
       else
         a = rgba_geta(color);
 
@@ -1,4 +1,5 @@
 // Aseprite
+// Copyright (C) 2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -12,6 +13,7 @@
 #include "filters/filter.h"
 #include "filters/tiled_mode.h"
 
+#include <memory>
 #include <vector>
 
 namespace filters {
@@ -19,6 +21,7 @@ namespace filters {
   class MedianFilter : public Filter {
   public:
     MedianFilter();
+    ~MedianFilter();
 
     void setTiledMode(TiledMode tiled);
     void setSize(int width, int height);
@@ -33,12 +36,27 @@ namespace filters {
     void applyToGrayscale(FilterManager* filterMgr);
     void applyToIndexed(FilterManager* filterMgr);
 
+    // The m_channel buffers and the column histograms are shared
+    // between rows (rows must be filtered in order to re-use the
+    // histograms of the previous row).
+    bool canApplyInParallel() const override { return false; }
+
   private:
+    struct Histograms;
+
+    template<typename Traits, typename GetChannels, typename PutPixel>
+    void applyWithHistograms(FilterManager* filterMgr,
+                             const int nchannels,
+                             const bool* channels,
+                             GetChannels getChannels,
+                             PutPixel putPixel);
+
     TiledMode m_tiledMode;
     int m_width;
     int m_height;
     int m_ncolors;
     std::vector<std::vector<uint8_t> > m_channel;
+    std::unique_ptr<Histograms> m_histograms;
   };
 
 } // namespace filters
@@ -1,5 +1,5 @@
 // Aseprite
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2016  David Capello
 //
 // This program is distributed under the terms of
@@ -11,12 +11,15 @@
 
 #include "filters/replace_color_filter.h"
 
+#include "doc/algorithm/color_match.h"
 #include "doc/image.h"
 #include "doc/palette.h"
 #include "doc/rgbmap.h"
 #include "filters/filter_indexed_data.h"
 #include "filters/filter_manager.h"
 
+#include <vector>
+
 namespace filters {
 
 using namespace doc;
@@ -47,43 +50,68 @@ const char* ReplaceColorFilter::getName()
   return "Replace Color";
 }
 
+namespace {
+
+// Channels of the target that are compared with the "from" color
+// (the other channels are ignored).
+color_t rgba_target_channels(const Target target)
+{
+  return ((target & TARGET_RED_CHANNEL   ? rgba_r_mask: 0) |
+          (target & TARGET_GREEN_CHANNEL ? rgba_g_mask: 0) |
+          (target & TARGET_BLUE_CHANNEL  ? rgba_b_mask: 0) |
+          (target & TARGET_ALPHA_CHANNEL ? rgba_a_mask: 0));
+}
+
+color_t graya_target_channels(const Target target)
+{
+  return ((target & TARGET_GRAY_CHANNEL  ? graya_v_mask: 0) |
+          (target & TARGET_ALPHA_CHANNEL ? graya_a_mask: 0));
+}
+
+inline bool get_bit(const std::vector<uint8_t>& bits, const int i)
+{
+  return (bits[i >> 3] & (1 << (i & 7))) ? true: false;
+}
+
+// Compares the whole row of the source with the "from" color at once
+// (the result for pixel "i" of the row is in the bit "i").
+template<typename ImageTraits>
+std::vector<uint8_t> match_row(FilterManager* filterMgr,
+                               const color_t from,
+                               const int tolerance,
+                               const color_t channels)
+{
+  const int w = filterMgr->getWidth();
+  std::vector<uint8_t> bits((w+7)/8);
+  const doc::algorithm::ColorMatch<ImageTraits> match(from, tolerance, false, channels);
+  match.matchRow(
+    (const typename ImageTraits::pixel_t*)filterMgr->getSourceAddress(),
+    w, bits.data());
+  return bits;
+}
+
+} // anonymous namespace
+
 void ReplaceColorFilter::applyToRgba(FilterManager* filterMgr)
 {
-  int from_r, from_g, from_b, from_a;
-  int src_r, src_g, src_b, src_a;
-  int to_r, to_g, to_b, to_a;
-  int c;
-
-  from_r = rgba_getr(m_from);
-  from_g = rgba_getg(m_from);
-  from_b = rgba_getb(m_from);
-  from_a = rgba_geta(m_from);
-  to_r = rgba_getr(m_to);
-  to_g = rgba_getg(m_to);
-  to_b = rgba_getb(m_to);
-  to_a = rgba_geta(m_to);
+  const std::vector<uint8_t> bits =
+    match_row<RgbTraits>(filterMgr, m_from, m_tolerance,
+                         rgba_target_channels(filterMgr->getTarget()));
+  const int x1 = filterMgr->x();
+  const int to_r = rgba_getr(m_to);
+  const int to_g = rgba_getg(m_to);
+  const int to_b = rgba_getb(m_to);
+  const int to_a = rgba_geta(m_to);
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint32_t) {
-    c = *src_address;
-    src_r = rgba_getr(c);
-    src_g = rgba_getg(c);
-    src_b = rgba_getb(c);
-    src_a = rgba_geta(c);
-
-    if (!(target & TARGET_RED_CHANNEL  )) from_r = src_r;
-    if (!(target & TARGET_GREEN_CHANNEL)) from_g = src_g;
-    if (!(target & TARGET_BLUE_CHANNEL )) from_b = src_b;
-    if (!(target & TARGET_ALPHA_CHANNEL)) from_a = src_a;
-
-    if ((ABS(src_r-from_r) <= m_tolerance) &&
-        (ABS(src_g-from_g) <= m_tolerance) &&
-        (ABS(src_b-from_b) <= m_tolerance) &&
-        (ABS(src_a-from_a) <= m_tolerance)) {
+    const color_t c = *src_address;
+
+    if (get_bit(bits, x-x1)) {
       *dst_address = rgba(
-        (target & TARGET_RED_CHANNEL   ? to_r: src_r),
-        (target & TARGET_GREEN_CHANNEL ? to_g: src_g),
-        (target & TARGET_BLUE_CHANNEL  ? to_b: src_b),
-        (target & TARGET_ALPHA_CHANNEL ? to_a: src_a));
+        (target & TARGET_RED_CHANNEL   ? to_r: rgba_getr(c)),
+        (target & TARGET_GREEN_CHANNEL ? to_g: rgba_getg(c)),
+        (target & TARGET_BLUE_CHANNEL  ? to_b: rgba_getb(c)),
+        (target & TARGET_ALPHA_CHANNEL ? to_a: rgba_geta(c)));
     }
     else
       *dst_address = c;
@@ -93,29 +121,20 @@ void ReplaceColorFilter::applyToRgba(FilterManager* filterMgr)
 
 void ReplaceColorFilter::applyToGrayscale(FilterManager* filterMgr)
 {
-  int from_v, from_a;
-  int src_v, src_a;
-  int to_v, to_a;
-  int c;
-
-  from_v = graya_getv(m_from);
-  from_a = graya_geta(m_from);
-  to_v = graya_getv(m_to);
-  to_a = graya_geta(m_to);
+  const std::vector<uint8_t> bits =
+    match_row<GrayscaleTraits>(filterMgr, m_from, m_tolerance,
+                               graya_target_channels(filterMgr->getTarget()));
+  const int x1 = filterMgr->x();
+  const int to_v = graya_getv(m_to);
+  const int to_a = graya_geta(m_to);
 
   FILTER_LOOP_THROUGH_ROW_BEGIN(uint16_t) {
-    c = *src_address;
-    src_v = graya_getv(c);
-    src_a = graya_geta(c);
+    const color_t c = *src_address;
 
-    if (!(target & TARGET_GRAY_CHANNEL )) from_v = src_v;
-    if (!(target & TARGET_ALPHA_CHANNEL)) from_a = src_a;
-
-    if ((ABS(src_v-from_v) <= m_tolerance) &&
-        (ABS(src_a-from_a) <= m_tolerance)) {
+    if (get_bit(bits, x-x1)) {
       *dst_address = graya(
-        (target & TARGET_GRAY_CHANNEL  ? to_v: src_v),
-        (target & TARGET_ALPHA_CHANNEL ? to_a: src_a));
+        (target & TARGET_GRAY_CHANNEL  ? to_v: graya_getv(c)),
+        (target & TARGET_ALPHA_CHANNEL ? to_a: graya_geta(c)));
     }
     else
       *dst_address = c;
@@ -127,56 +146,46 @@ void ReplaceColorFilter::applyToIndexed(FilterManager* filterMgr)
 {
   const Palette* pal = filterMgr->getIndexedData()->getPalette();
   const RgbMap* rgbmap = filterMgr->getIndexedData()->getRgbMap();
-  int from_r, from_g, from_b, from_a;
-  int src_r, src_g, src_b, src_a;
-  int to_r, to_g, to_b, to_a;
-  int c;
-
-  c = pal->getEntry(m_from);
-  from_r = rgba_getr(c);
-  from_g = rgba_getg(c);
-  from_b = rgba_getb(c);
-  from_a = rgba_geta(c);
-
-  c = pal->getEntry(m_to);
-  to_r = rgba_getr(c);
-  to_g = rgba_getg(c);
-  to_b = rgba_getb(c);
-  to_a = rgba_geta(c);
+  const int x1 = filterMgr->x();
 
-  FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
-    c = *src_address;
+  if (filterMgr->getTarget() & TARGET_INDEX_CHANNEL) {
+    const std::vector<uint8_t> bits =
+      match_row<IndexedTraits>(filterMgr, m_from, m_tolerance, 0xff);
 
-    if (target & TARGET_INDEX_CHANNEL) {
-      if (ABS(c-m_from) <= m_tolerance)
-        *dst_address = m_to;
-      else
-        *dst_address = c;
+    FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
+      *dst_address = (get_bit(bits, x-x1) ? m_to: *src_address);
     }
-    else {
-      src_r = rgba_getr(pal->getEntry(c));
-      src_g = rgba_getg(pal->getEntry(c));
-      src_b = rgba_getb(pal->getEntry(c));
-      src_a = rgba_geta(pal->getEntry(c));
-
-      if (!(target & TARGET_RED_CHANNEL  )) from_r = src_r;
-      if (!(target & TARGET_GREEN_CHANNEL)) from_g = src_g;
-      if (!(target & TARGET_BLUE_CHANNEL )) from_b = src_b;
-      if (!(target & TARGET_ALPHA_CHANNEL)) from_a = src_a;
-
-      if ((ABS(src_r-from_r) <= m_tolerance) &&
-          (ABS(src_g-from_g) <= m_tolerance) &&
-          (ABS(src_b-from_b) <= m_tolerance) &&
-          (ABS(src_a-from_a) <= m_tolerance)) {
-        *dst_address = rgbmap->mapColor(
-          (target & TARGET_RED_CHANNEL   ? to_r: src_r),
-          (target & TARGET_GREEN_CHANNEL ? to_g: src_g),
-          (target & TARGET_BLUE_CHANNEL  ? to_b: src_b),
-          (target & TARGET_ALPHA_CHANNEL ? to_a: src_a));
-      }
-      else
-        *dst_address = c;
+    FILTER_LOOP_THROUGH_ROW_END()
+    return;
+  }
+
+  // Compare the palette entries just one time
+  const doc::algorithm::ColorMatch<RgbTraits> match(
+    pal->getEntry(m_from), m_tolerance, false,
+    rgba_target_channels(filterMgr->getTarget()));
+  bool matches[256];
+  for (int i=0; i<256; ++i)
+    matches[i] = match.match(pal->getEntry(i));
+
+  const color_t to = pal->getEntry(m_to);
+  const int to_r = rgba_getr(to);
+  const int to_g = rgba_getg(to);
+  const int to_b = rgba_getb(to);
+  const int to_a = rgba_geta(to);
+
+  FILTER_LOOP_THROUGH_ROW_BEGIN(uint8_t) {
+    const int c = *src_address;
+
+    if (matches[c]) {
+      const color_t src = pal->getEntry(c);
+      *dst_address = rgbmap->mapColor(
+        (target & TARGET_RED_CHANNEL   ? to_r: rgba_getr(src)),
+        (target & TARGET_GREEN_CHANNEL ? to_g: rgba_getg(src)),
+        (target & TARGET_BLUE_CHANNEL  ? to_b: rgba_getb(src)),
+        (target & TARGET_ALPHA_CHANNEL ? to_a: rgba_geta(src)));
     }
+    else
+      *dst_address = c;
   }
   FILTER_LOOP_THROUGH_ROW_END()
 }
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c)      2020 Igara Studio S.A.
+// Copyright (c) 2020-2026 Igara Studio S.A.
 // Copyright (c) 2001-2015 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -61,21 +61,31 @@ namespace render {
       // Accurate colors are used only for less than 256 colors.  If the
       // image has more than 256 colors the m_histogram is used
       // instead.
-      if (m_useHighPrecision) {
-        std::vector<doc::color_t>::iterator it =
-          std::find(m_highPrecision.begin(), m_highPrecision.end(), color);
-
-        // The color is not in the high-precision table
-        if (it == m_highPrecision.end()) {
-          if (m_highPrecision.size() < 256) {
-            m_highPrecision.push_back(color);
-          }
-          else {
-            // In this case we reach the limit for the high-precision histogram.
-            m_useHighPrecision = false;
-          }
-        }
+      if (m_useHighPrecision)
+        addHighPrecisionColor(color);
+    }
+
+    // Adds all the samples of "other" histogram (e.g. a histogram
+    // filled from other thread). The high-precision table keeps the
+    // colors in order of appearance if the samples of "other" were
+    // added after the samples of this histogram.
+    void merge(const ColorHistogram& other) {
+      for (std::size_t i=0; i<m_histogram.size(); ++i) {
+        const std::size_t count = other.m_histogram[i];
+        if (count == 0)
+          continue;
+
+        if (m_histogram[i] < std::numeric_limits<std::size_t>::max()-count) // Avoid overflow
+          m_histogram[i] += count;
+        else
+          m_histogram[i] = std::numeric_limits<std::size_t>::max();
       }
+
+      if (!other.m_useHighPrecision)
+        m_useHighPrecision = false;
+
+      for (int i=0; m_useHighPrecision && i<int(other.m_highPrecision.size()); ++i)
+        addHighPrecisionColor(other.m_highPrecision[i]);
     }
 
     // Creates a set of entries for the given palette in the given range
@@ -107,6 +117,22 @@ namespace render {
     int highPrecisionSize() { return m_highPrecision.size(); }
 
   private:
+    void addHighPrecisionColor(doc::color_t color) {
+      std::vector<doc::color_t>::iterator it =
+        std::find(m_highPrecision.begin(), m_highPrecision.end(), color);
+
+      // The color is not in the high-precision table
+      if (it == m_highPrecision.end()) {
+        if (m_highPrecision.size() < 256) {
+          m_highPrecision.push_back(color);
+        }
+        else {
+          // In this case we reach the limit for the high-precision histogram.
+          m_useHighPrecision = false;
+        }
+      }
+    }
+
     // Converts input color in a index for the histogram. It reduces
     // each 8-bit component to the resolution given in the template
     // parameters.
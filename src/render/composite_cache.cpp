@@ -0,0 +1,215 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/composite_cache.h"
+
+#include "doc/image.h"
+#include "doc/primitives.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace render {
+
+namespace {
+
+// Number of keys that were stored only one time that we remember
+const std::size_t kMaxStoredOnce = 256;
+
+}
+
+CompositeCache::CompositeCache(const std::size_t maxMemory)
+  : m_maxMemory(maxMemory)
+  , m_memoryUsage(0)
+  , m_storedOnceIndex(0)
+{
+}
+
+std::size_t CompositeCache::maxMemory() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_maxMemory;
+}
+
+std::size_t CompositeCache::memoryUsage() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_memoryUsage;
+}
+
+void CompositeCache::setMaxMemory(const std::size_t maxMemory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_maxMemory = maxMemory;
+  shrink();
+}
+
+bool CompositeCache::restore(const Key& key, doc::Image* dst, const gfx::Clip& area)
+{
+  const std::lock_guard lock(m_mutex);
+  auto it = find(key, key.size());
+  if (it == m_entries.end())
+    return false;
+
+  const doc::Image* src = it->image.get();
+  if (src->pixelFormat() != dst->pixelFormat() ||
+      !src->bounds().contains(area.srcBounds()))
+    return false;
+
+  gfx::Clip clip(area);
+  if (clip.clip(dst->width(), dst->height(), src->width(), src->height())) {
+    const int rowBytes = clip.size.w * src->bytesPerPixel();
+    for (int y=0; y<clip.size.h; ++y) {
+      std::memcpy(dst->getPixelAddress(clip.dst.x, clip.dst.y+y),
+                  src->getPixelAddress(clip.src.x, clip.src.y+y),
+                  rowBytes);
+    }
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it);
+  return true;
+}
+
+bool CompositeCache::restore(const Key& key, const std::size_t count,
+                             doc::Image* dst, const gfx::Rect& bounds)
+{
+  const std::lock_guard lock(m_mutex);
+  auto it = find(key, count);
+  if (it == m_entries.end())
+    return false;
+
+  const Entry& entry = *it;
+  if (entry.bounds != bounds ||
+      entry.image->pixelFormat() != dst->pixelFormat())
+    return false;
+
+  doc::copy_image(dst, entry.image.get(), bounds.x, bounds.y);
+
+  // Move the entry to the front (most recently used)
+  m_entries.splice(m_entries.begin(), m_entries, it);
+  return true;
+}
+
+void CompositeCache::store(const Key& key, const std::size_t count,
+                           const doc::Image* src, const gfx::Rect& bounds)
+{
+  const std::lock_guard lock(m_mutex);
+  if (std::size_t(bounds.w) * bounds.h * src->bytesPerPixel() > m_maxMemory ||
+      !wasStoredBefore(key.hash(count)))
+    return;                     // Avoid the crop_image() call
+
+  add(key, count, doc::ImageRef(doc::crop_image(src, bounds, 0)), bounds);
+}
+
+doc::ImageRef CompositeCache::get(const Key& key)
+{
+  const std::lock_guard lock(m_mutex);
+  auto it = find(key, key.size());
+  if (it == m_entries.end())
+    return nullptr;
+
+  m_entries.splice(m_entries.begin(), m_entries, it);
+  return it->image;
+}
+
+void CompositeCache::store(const Key& key, const doc::ImageRef& image)
+{
+  const std::lock_guard lock(m_mutex);
+  add(key, key.size(), image, image->bounds());
+}
+
+void CompositeCache::clear()
+{
+  const std::lock_guard lock(m_mutex);
+  m_entries.clear();
+  m_map.clear();
+  m_storedOnce.clear();
+  m_storedOnceIndex = 0;
+  m_memoryUsage = 0;
+}
+
+// static
+uint64_t CompositeCache::combine(const uint64_t seed, const uint64_t value)
+{
+  // Same mixing used by boost::hash_combine() (64-bit version)
+  return seed ^ (value + 0x9e3779b97f4a7c15ull + (seed << 12) + (seed >> 4));
+}
+
+CompositeCache::Entries::iterator CompositeCache::find(const Key& key,
+                                                       const std::size_t count)
+{
+  auto it = m_map.find(key.hash(count));
+  if (it == m_map.end())
+    return m_entries.end();
+
+  // Compare all the values, the hash is not enough
+  const Entry& entry = *it->second;
+  if (entry.values.size() != count ||
+      !std::equal(entry.values.begin(), entry.values.end(), key.values()))
+    return m_entries.end();
+
+  return it->second;
+}
+
+void CompositeCache::add(const Key& key, const std::size_t count,
+                         const doc::ImageRef& image, const gfx::Rect& bounds)
+{
+  const std::size_t size = std::size_t(image->rowBytes()) * image->height();
+  if (size > m_maxMemory)
+    return;
+
+  // Replace the entry with the same hash (it's the same key or an
+  // old one with a hash collision)
+  const uint64_t hash = key.hash(count);
+  auto it = m_map.find(hash);
+  if (it != m_map.end()) {
+    m_memoryUsage -= it->second->size;
+    m_entries.erase(it->second);
+    m_map.erase(it);
+  }
+
+  m_entries.push_front(
+    Entry{ hash,
+           std::vector<uint64_t>(key.values(), key.values()+count),
+           bounds, image, size });
+  m_map[hash] = m_entries.begin();
+  m_memoryUsage += size;
+  shrink();
+}
+
+bool CompositeCache::wasStoredBefore(const uint64_t hash)
+{
+  auto it = std::find(m_storedOnce.begin(), m_storedOnce.end(), hash);
+  if (it != m_storedOnce.end()) {
+    // Forget it, the next store() of the same key will be a hit anyway
+    *it = 0;
+    return true;
+  }
+
+  if (m_storedOnce.size() < kMaxStoredOnce)
+    m_storedOnce.push_back(hash);
+  else {
+    m_storedOnce[m_storedOnceIndex] = hash;
+    m_storedOnceIndex = (m_storedOnceIndex+1) % kMaxStoredOnce;
+  }
+  return false;
+}
+
+void CompositeCache::shrink()
+{
+  while (m_memoryUsage > m_maxMemory && !m_entries.empty()) {
+    const Entry& entry = m_entries.back();
+    m_memoryUsage -= entry.size;
+    m_map.erase(entry.hash);
+    m_entries.pop_back();
+  }
+}
+
+} // namespace render
@@ -0,0 +1,172 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_COMPOSITE_CACHE_H_INCLUDED
+#define RENDER_COMPOSITE_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "base/ints.h"
+#include "doc/image_ref.h"
+#include "gfx/clip.h"
+#include "gfx/rect.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace doc {
+  class Image;
+}
+
+namespace render {
+
+  // Cache of partial composites used by render::Render::renderPlan()
+  // to avoid blending again and again layer groups that didn't
+  // change. Each entry is a snapshot of the destination image after
+  // blending all the layers of the doc::RenderPlan up to the end of a
+  // group, identified by a key that combines the initial state of the
+  // destination image (the background and the layers drawn in
+  // previous passes), the render options, and the versions of all
+  // the blended layers/cels/images. So after editing one layer, only
+  // the groups after the modified layer (the "dirty path") must be
+  // blended again.
+  //
+  // Snapshots are saved only when the same key is stored two times,
+  // so we don't copy the result of groups that will be invalidated in
+  // the next render (e.g. all the groups after the layer that the
+  // user is modifying).
+  //
+  // When the user starts drawing, a snapshot of the whole sprite with
+  // all the layers below the current layer is saved too, so each
+  // update of the stroke copies the exposed area from it and only
+  // blends the current layer, the extra cel, and the layers above.
+  //
+  // The same cache can be shared between several render::Render
+  // instances (and threads), entries are discarded in LRU order when
+  // the memory usage exceeds the given limit.
+  class CompositeCache {
+  public:
+    // List of values that identify the content of an entry. The hash
+    // is used to find the entry, and then all the values are compared
+    // to verify that it's the same key (two different states never
+    // share an entry).
+    class Key {
+    public:
+      Key() { }
+
+      bool empty() const { return m_values.empty(); }
+      void clear() {
+        m_values.clear();
+        m_hashes.clear();
+      }
+
+      // Keeps only the first "count" values.
+      void resize(const std::size_t count) {
+        m_values.resize(count);
+        m_hashes.resize(count);
+      }
+
+      void add(const uint64_t value) {
+        m_hashes.push_back(combine(hash(), value));
+        m_values.push_back(value);
+      }
+
+      // Number of values in the key. The first N values of a key
+      // identify the state after blending the first items of a
+      // doc::RenderPlan (see the "count" parameter of restore/store).
+      std::size_t size() const { return m_values.size(); }
+
+      uint64_t hash() const { return hash(size()); }
+      uint64_t hash(const std::size_t count) const {
+        return (count > 0 ? m_hashes[count-1]: 0);
+      }
+
+      const uint64_t* values() const { return m_values.data(); }
+
+      bool operator==(const Key& other) const {
+        return (m_values == other.m_values);
+      }
+      bool operator!=(const Key& other) const {
+        return !operator==(other);
+      }
+
+    private:
+      std::vector<uint64_t> m_values;
+      std::vector<uint64_t> m_hashes;
+    };
+
+    explicit CompositeCache(const std::size_t maxMemory);
+
+    std::size_t maxMemory() const;
+    std::size_t memoryUsage() const;
+    void setMaxMemory(const std::size_t maxMemory);
+
+    // Copies the "area.srcBounds()" of the whole image associated to
+    // the given key (see store(key, image)) to "area.dst" of "dst".
+    // Returns false if there is no image for this key or it doesn't
+    // contain the whole area.
+    bool restore(const Key& key, doc::Image* dst, const gfx::Clip& area);
+
+    // Copies the snapshot associated to the first "count" values of
+    // the given key to the "bounds" area of "dst". Returns false if
+    // there is no snapshot for this key/bounds.
+    bool restore(const Key& key, const std::size_t count,
+                 doc::Image* dst, const gfx::Rect& bounds);
+
+    // Saves a copy of the "bounds" area of "src" for the first
+    // "count" values of the given key (only if it's the second time
+    // that this key is stored).
+    void store(const Key& key, const std::size_t count,
+               const doc::Image* src, const gfx::Rect& bounds);
+
+    // Returns/saves a whole image associated to the given key (used
+    // by render::Render to cache flattened onion skin frames and the
+    // layers below the current layer). The image must not be
+    // modified after it's stored.
+    doc::ImageRef get(const Key& key);
+    void store(const Key& key, const doc::ImageRef& image);
+
+    void clear();
+
+    // Mixes the given value in the hash of a key.
+    static uint64_t combine(const uint64_t seed, const uint64_t value);
+
+  private:
+    struct Entry {
+      uint64_t hash;
+      std::vector<uint64_t> values;
+      gfx::Rect bounds;
+      doc::ImageRef image;
+      std::size_t size;
+    };
+    using Entries = std::list<Entry>;
+
+    Entries::iterator find(const Key& key, const std::size_t count);
+    void add(const Key& key, const std::size_t count,
+             const doc::ImageRef& image, const gfx::Rect& bounds);
+    bool wasStoredBefore(const uint64_t hash);
+    void shrink();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxMemory;
+    std::size_t m_memoryUsage;
+    // Most recently used entries at the beginning of the list
+    Entries m_entries;
+    std::unordered_map<uint64_t, Entries::iterator> m_map;
+    // Hashes of the last keys that were stored for the first time
+    // (circular buffer)
+    std::vector<uint64_t> m_storedOnce;
+    std::size_t m_storedOnceIndex;
+
+    DISABLE_COPYING(CompositeCache);
+  };
+
+} // namespace render
+
+#endif
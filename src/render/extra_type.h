@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (C) 2019  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2015  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,6 +9,12 @@
 #define RENDER_EXTRA_TYPE_H_INCLUDED
 #pragma once
 
+#include "gfx/point.h"
+
+namespace doc {
+  class Image;
+}
+
 namespace render {
 
   enum class ExtraType {
@@ -25,6 +31,25 @@ namespace render {
     // Composite the current cel two times (don't use the extral cel),
     // but the second time using the extral blend mode.
     OVER_COMPOSITE,
+
+    // The extra image is drawn over the current layer/frame
+    // transformed to the parallelogram given in
+    // Render::setExtraTransform(). The pixels are sampled from the
+    // extra image at display resolution (used to preview
+    // transformations without transforming the whole image).
+    TRANSFORM,
+  };
+
+  // Parallelogram (in sprite coordinates) where the extra image is
+  // drawn with ExtraType::TRANSFORM. The "mask" is an optional
+  // bitmap (with the size of the extra image) to draw only its
+  // selected pixels, and pixels equal to the image mask color are
+  // skipped.
+  struct ExtraTransform {
+    gfx::PointF leftTop;
+    gfx::PointF rightTop;
+    gfx::PointF leftBottom;
+    const doc::Image* mask = nullptr;
   };
 
 } // namespace render
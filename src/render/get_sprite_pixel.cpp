@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,14 +9,78 @@
 #include "config.h"
 #endif
 
+#include "render/get_sprite_pixel.h"
+
 #include "doc/doc.h"
 #include "gfx/clip.h"
 #include "render/render.h"
 
+#include <cmath>
+#include <utility>
+
 namespace render {
 
 using namespace doc;
 
+namespace {
+
+// Adds to "key" the state of all layers/cels that can modify the
+// composited sprite in the given frame. Returns false if the sprite
+// cannot be sampled from a cached block (it contains tilemaps).
+bool sprite_state(const Sprite* sprite,
+                  const frame_t frame,
+                  const bool newBlend,
+                  CompositeCache::Key& key)
+{
+  for (const uint64_t value : {
+         uint64_t(sprite->id()),
+         uint64_t(sprite->version()),
+         uint64_t(frame),
+         uint64_t(newBlend),
+         uint64_t(sprite->pixelFormat()),
+         uint64_t(sprite->transparentColor()) }) {
+    key.add(value);
+  }
+
+  for (const Layer* layer : sprite->allLayers()) {
+    if (layer->isTilemap())
+      return false;
+
+    key.add(layer->id());
+    key.add(layer->version());
+    key.add(uint64_t(layer->flags()));
+    if (!layer->isImage())
+      continue;
+
+    auto imageLayer = static_cast<const LayerImage*>(layer);
+    key.add(uint64_t(imageLayer->opacity()));
+    key.add(uint64_t(imageLayer->blendMode()));
+
+    const Cel* cel = imageLayer->cel(frame);
+    if (!cel) {
+      key.add(0);
+      continue;
+    }
+
+    const Image* image = cel->image();
+    for (const uint64_t value : {
+           uint64_t(cel->id()),
+           uint64_t(cel->version()),
+           uint64_t(cel->data()->id()),
+           uint64_t(cel->data()->version()),
+           uint64_t(cel->opacity()),
+           uint64_t(int64_t(cel->x())),
+           uint64_t(int64_t(cel->y())),
+           uint64_t(image->id()),
+           uint64_t(image->version()) }) {
+      key.add(value);
+    }
+  }
+  return true;
+}
+
+} // anonymous namespace
+
 color_t get_sprite_pixel(const Sprite* sprite,
                          const double x,
                          const double y,
@@ -44,4 +108,58 @@ color_t get_sprite_pixel(const Sprite* sprite,
   return color;
 }
 
+color_t SpritePixelSampler::getPixel(const Sprite* sprite,
+                                     const double x,
+                                     const double y,
+                                     const frame_t frame,
+                                     const Projection& proj,
+                                     const bool newBlend)
+{
+  if ((x < 0.0) || (x >= sprite->width()) ||
+      (y < 0.0) || (y >= sprite->height()))
+    return 0;
+
+  // With zoom levels >= 100% each pixel of the sprite is just
+  // repeated, so we can sample the sprite composited at 100%
+  CompositeCache::Key state;
+  if (proj.scaleX() < 1.0 || proj.scaleY() < 1.0 ||
+      !sprite_state(sprite, frame, newBlend, state)) {
+    clear();
+    return get_sprite_pixel(sprite, x, y, frame, proj, newBlend);
+  }
+
+  const gfx::Point pt(int(std::floor(x)), int(std::floor(y)));
+  if (!m_block ||
+      m_state != state ||
+      !m_bounds.contains(pt)) {
+    m_bounds = gfx::Rect(pt.x - pt.x % kBlockSize,
+                         pt.y - pt.y % kBlockSize,
+                         kBlockSize, kBlockSize);
+    m_bounds &= sprite->bounds();
+
+    if (!m_block ||
+        m_block->pixelFormat() != sprite->pixelFormat()) {
+      m_block.reset(Image::create(sprite->pixelFormat(),
+                                  kBlockSize, kBlockSize));
+    }
+
+    render::Render render;
+    render.setNewBlend(newBlend);
+    render.setRefLayersVisiblity(true);
+    render.renderSprite(
+      m_block.get(), sprite, frame,
+      gfx::ClipF(0, 0, m_bounds.x, m_bounds.y, m_bounds.w, m_bounds.h));
+
+    m_state = std::move(state);
+  }
+
+  return get_pixel(m_block.get(), pt.x - m_bounds.x, pt.y - m_bounds.y);
+}
+
+void SpritePixelSampler::clear()
+{
+  m_state.clear();
+  m_block.reset();
+}
+
 } // namespace render
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2016 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -9,7 +9,11 @@
 #define RENDER_GET_SPRITE_PIXEL_H_INCLUDED
 #pragma once
 
+#include "doc/color.h"
 #include "doc/frame.h"
+#include "doc/image_ref.h"
+#include "gfx/rect.h"
+#include "render/composite_cache.h"
 
 namespace doc {
   class Sprite;
@@ -30,6 +34,39 @@ namespace render {
                            const Projection& proj,
                            const bool newBlend);
 
+  // Gets pixels from the sprite like get_sprite_pixel(), but keeps
+  // the last block of the sprite composited at 100% to get the next
+  // pixels from it (e.g. when the eyedropper is dragged) instead of
+  // rendering the sprite for each pixel. The block is rendered again
+  // when the sprite/frame are different, or when the state of the
+  // layers/cels changes (visibility, opacity, blend mode, position,
+  // or versions of cels and images). The whole state is compared
+  // (not just a hash of it) using IDs instead of pointers, so a
+  // deleted object never matches a new one created at the same
+  // address.
+  //
+  // The block is not used (and each pixel is rendered) for zoom
+  // levels smaller than 100% (where the sampling depends on the zoom)
+  // or sprites with tilemaps.
+  class SpritePixelSampler {
+  public:
+    static constexpr int kBlockSize = 64;
+
+    color_t getPixel(const Sprite* sprite,
+                     const double x,
+                     const double y,
+                     const frame_t frame,
+                     const Projection& proj,
+                     const bool newBlend);
+
+    void clear();
+
+  private:
+    CompositeCache::Key m_state;
+    gfx::Rect m_bounds;
+    ImageRef m_block;
+  };
+
 } // namespace render
 
 #endif
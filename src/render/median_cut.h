@@ -1,4 +1,5 @@
 // Aseprite Render Library
+// Copyright (c)      2026 Igara Studio S.A.
 // Copyright (c) 2001-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -100,10 +101,12 @@ namespace render {
       std::size_t count = 0;
       int i, j, k, l;
 
-      for (i=r1; i<=r2; ++i)
-        for (j=g1; j<=g2; ++j)
-          for (k=b1; k<=b2; ++k)
-            for (l=a1; l<=a2; ++l) {
+      // The red component is iterated in the inner loop as it's
+      // contiguous in memory (see ColorHistogram::histogramIndex()).
+      for (l=a1; l<=a2; ++l)
+        for (k=b1; k<=b2; ++k)
+          for (j=g1; j<=g2; ++j)
+            for (i=r1; i<=r2; ++i) {
               int c = histogram.at(i, j, k, l);
               r += c * i;
               g += c * j;
@@ -152,10 +155,10 @@ namespace render {
       std::size_t count = 0;
       int i, j, k, l;
 
-      for (i=r1; i<=r2; ++i)
-        for (j=g1; j<=g2; ++j)
-          for (k=b1; k<=b2; ++k)
-            for (l=a1; l<=a2; ++l)
+      for (l=a1; l<=a2; ++l)
+        for (k=b1; k<=b2; ++k)
+          for (j=g1; j<=g2; ++j)
+            for (i=r1; i<=r2; ++i)
               count += histogram.at(i, j, k, l);
 
       return count;
@@ -175,9 +178,9 @@ namespace render {
 
       // Shrink i1.
       for (; i1<i2; ++i1) {
-        for (j=j1; j<=j2; ++j) {
+        for (l=l1; l<=l2; ++l) {
           for (k=k1; k<=k2; ++k) {
-            for (l=l1; l<=l2; ++l) {
+            for (j=j1; j<=j2; ++j) {
               if (AxisGetter::at(histogram, i1, j, k, l) > 0)
                 goto doneA;
             }
@@ -188,9 +191,9 @@ namespace render {
     doneA:;
 
       for (; i2>i1; --i2) {
-        for (j=j1; j<=j2; ++j) {
+        for (l=l1; l<=l2; ++l) {
           for (k=k1; k<=k2; ++k) {
-            for (l=l1; l<=l2; ++l) {
+            for (j=j1; j<=j2; ++j) {
               if (AxisGetter::at(histogram, i2, j, k, l) > 0)
                 goto doneB;
             }
@@ -227,10 +230,12 @@ namespace render {
       for (i=i1; i<=i2; ++i) {
         std::size_t planePoints = 0;
 
-        // We count all points in "i" plane.
-        for (j=j1; j<=j2; ++j)
+        // We count all points in "i" plane (the "j" axis is iterated
+        // in the inner loop because it's the red or green component,
+        // the closest ones in memory).
+        for (l=l1; l<=l2; ++l)
           for (k=k1; k<=k2; ++k)
-            for (l=l1; l<=l2; ++l)
+            for (j=j1; j<=j2; ++j)
               planePoints += AxisGetter::at(histogram, i, j, k, l);
 
         // As we move the plane to split through "i" axis One side is getting more points,
@@ -0,0 +1,153 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/mipmap_cache.h"
+
+#include "base/debug.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+
+#include <iterator>
+
+namespace render {
+
+namespace {
+
+// Creates a new image taking one of each 2x2 pixels of "src" (the
+// top-left one).
+template<typename ImageTraits>
+doc::Image* decimate_image(const doc::Image* src)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  doc::ImageSpec spec = src->spec();
+  spec.setSize((src->width()+1) / 2,
+               (src->height()+1) / 2);
+  doc::Image* dst = doc::Image::create(spec);
+
+  for (int y=0; y<dst->height(); ++y) {
+    const pixel_t* s = (const pixel_t*)src->getPixelAddress(0, 2*y);
+    pixel_t* d = (pixel_t*)dst->getPixelAddress(0, y);
+    for (int x=0; x<dst->width(); ++x, s+=2, ++d)
+      *d = *s;
+  }
+  return dst;
+}
+
+doc::Image* decimate_image(const doc::Image* src)
+{
+  switch (src->pixelFormat()) {
+    case doc::IMAGE_RGB:       return decimate_image<doc::RgbTraits>(src);
+    case doc::IMAGE_GRAYSCALE: return decimate_image<doc::GrayscaleTraits>(src);
+    case doc::IMAGE_INDEXED:   return decimate_image<doc::IndexedTraits>(src);
+  }
+  return nullptr;
+}
+
+std::size_t image_size(const doc::Image* image)
+{
+  return std::size_t(image->rowBytes()) * image->height();
+}
+
+} // anonymous namespace
+
+MipmapCache::MipmapCache(const std::size_t maxMemory)
+  : m_maxMemory(maxMemory)
+  , m_memoryUsage(0)
+{
+}
+
+std::size_t MipmapCache::maxMemory() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_maxMemory;
+}
+
+std::size_t MipmapCache::memoryUsage() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_memoryUsage;
+}
+
+void MipmapCache::setMaxMemory(const std::size_t maxMemory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_maxMemory = maxMemory;
+  shrink();
+}
+
+doc::ImageRef MipmapCache::getLevel(const doc::Image* image, const int level,
+                                    bool* cached)
+{
+  ASSERT(level >= 1 && level <= kMaxLevel);
+
+  const doc::ObjectId id = image->id();
+  const std::lock_guard lock(m_mutex);
+
+  auto it = m_map.find(id);
+  if (it != m_map.end() &&
+      it->second->version != image->version()) {
+    removeEntry(it->second);
+    it = m_map.end();
+  }
+
+  if (it == m_map.end()) {
+    m_entries.push_front(Entry{ id, image->version(), {}, 0 });
+    it = m_map.insert({ id, m_entries.begin() }).first;
+  }
+  else {
+    // Move the entry to the front (most recently used)
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+  }
+
+  // Create the missing levels from the previous one
+  Entry& entry = *it->second;
+  if (cached)
+    *cached = (int(entry.levels.size()) >= level);
+  while (int(entry.levels.size()) < level) {
+    const doc::Image* prev = (entry.levels.empty() ? image:
+                                                     entry.levels.back().get());
+    doc::ImageRef next(decimate_image(prev));
+    if (!next)
+      return nullptr;
+
+    const std::size_t size = image_size(next.get());
+    entry.levels.push_back(next);
+    entry.size += size;
+    m_memoryUsage += size;
+  }
+
+  doc::ImageRef result = entry.levels[level-1];
+  shrink();
+  return result;
+}
+
+void MipmapCache::clear()
+{
+  const std::lock_guard lock(m_mutex);
+  m_entries.clear();
+  m_map.clear();
+  m_memoryUsage = 0;
+}
+
+void MipmapCache::removeEntry(Entries::iterator it)
+{
+  m_memoryUsage -= it->size;
+  m_map.erase(it->id);
+  m_entries.erase(it);
+}
+
+void MipmapCache::shrink()
+{
+  while (m_memoryUsage > m_maxMemory && !m_entries.empty())
+    removeEntry(std::prev(m_entries.end()));
+}
+
+} // namespace render
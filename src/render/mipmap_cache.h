@@ -0,0 +1,86 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_MIPMAP_CACHE_H_INCLUDED
+#define RENDER_MIPMAP_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/image_ref.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace doc {
+  class Image;
+}
+
+namespace render {
+
+  // Cache of reduced versions of images (2x, 4x, 8x, and 16x smaller)
+  // used by render::Render to composite images with zoom levels
+  // smaller than 100% (e.g. 25%) reading less memory.
+  //
+  // Each level is point-sampled from the original image (the pixel
+  // (x, y) of the level "n" is the pixel (x*2^n, y*2^n) of the
+  // original image), which is the same sampling used by the
+  // zoomed-out composite, so the rendered result is exactly the same
+  // with or without this cache.
+  //
+  // Levels are created lazily and discarded when the version of the
+  // original image changes (so all code that modifies the pixels of
+  // a cel image must call Image::incrementVersion()), or in LRU
+  // order when the memory usage exceeds the given limit. The cache can be shared between several
+  // render::Render instances (and threads).
+  class MipmapCache {
+  public:
+    static constexpr int kMaxLevel = 4;
+
+    explicit MipmapCache(const std::size_t maxMemory);
+
+    std::size_t maxMemory() const;
+    std::size_t memoryUsage() const;
+    void setMaxMemory(const std::size_t maxMemory);
+
+    // Returns the given level (from 1 to kMaxLevel) of the image, or
+    // nullptr if the pixel format of the image is not supported.
+    // "cached" is set to true if the level was already in the cache.
+    doc::ImageRef getLevel(const doc::Image* image, const int level,
+                           bool* cached = nullptr);
+
+    void clear();
+
+  private:
+    struct Entry {
+      doc::ObjectId id;
+      doc::ObjectVersion version;
+      // levels[0] is the level 1 (2x smaller)
+      std::vector<doc::ImageRef> levels;
+      std::size_t size;
+    };
+    using Entries = std::list<Entry>;
+
+    void removeEntry(Entries::iterator it);
+    void shrink();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxMemory;
+    std::size_t m_memoryUsage;
+    // Most recently used entries at the beginning of the list
+    Entries m_entries;
+    std::unordered_map<doc::ObjectId, Entries::iterator> m_map;
+
+    DISABLE_COPYING(MipmapCache);
+  };
+
+} // namespace render
+
+#endif
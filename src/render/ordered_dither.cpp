@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2022  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 // Copyright (c) 2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,10 +11,12 @@
 
 #include "render/ordered_dither.h"
 
+#include "doc/parallel.h"
 #include "render/dithering.h"
 #include "render/dithering_matrix.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <vector>
 
@@ -227,6 +229,79 @@ doc::color_t OrderedDither2::ditherRgbPixelToIndex(
     return index;
 }
 
+// Rows of an image dithered by each parallel task.
+static const int kDitherRowsPerChunk = 8;
+
+static void dither_rgb_row_to_indexed(
+  DitheringAlgorithmBase& algorithm,
+  const DitheringMatrix& matrix,
+  const doc::Image* srcImage,
+  doc::Image* dstImage,
+  const int y,
+  const doc::RgbMap* rgbmap,
+  const doc::Palette* palette)
+{
+  const int w = srcImage->width();
+  auto srcIt = doc::get_pixel_address_fast<doc::RgbTraits>(srcImage, 0, y);
+  auto dstIt = doc::get_pixel_address_fast<doc::IndexedTraits>(dstImage, 0, y);
+  for (int x=0; x<w; ++x, ++srcIt, ++dstIt) {
+    *dstIt = algorithm.ditherRgbPixelToIndex(
+      matrix, *srcIt, x, y, rgbmap, palette);
+  }
+}
+
+// Dithers chunks of rows from several threads. Each pixel of a 1D
+// algorithm depends only on its source color and position, so the
+// result is the same as dithering the image from one thread. Returns
+// false if the task was canceled.
+static bool dither_rgb_rows_to_indexed_in_parallel(
+  DitheringAlgorithmBase& algorithm,
+  const DitheringMatrix& matrix,
+  const doc::Image* srcImage,
+  doc::Image* dstImage,
+  const doc::RgbMap* rgbmap,
+  const doc::Palette* palette,
+  const int chunks,
+  TaskDelegate* delegate)
+{
+  const int h = srcImage->height();
+  std::atomic<bool> canceled(false);
+  std::atomic<int> doneRows(0);
+
+  doc::parallel_for(
+    chunks,
+    [&algorithm, &matrix, srcImage, dstImage, rgbmap, palette, h,
+     &canceled, &doneRows](const int i){
+      if (canceled)
+        return;
+
+      const int y1 = i*kDitherRowsPerChunk;
+      const int y2 = std::min(y1 + kDitherRowsPerChunk, h);
+      for (int y=y1; y<y2; ++y) {
+        dither_rgb_row_to_indexed(algorithm, matrix, srcImage, dstImage,
+                                  y, rgbmap, palette);
+      }
+      doneRows += y2 - y1;
+    },
+    // Report the progress and check if the task is canceled from
+    // this thread.
+    [delegate, h, &canceled, &doneRows]{
+      if (delegate && !canceled) {
+        if (!delegate->continueTask())
+          canceled = true;
+        else
+          delegate->notifyTaskProgress(double(doneRows) / double(h));
+      }
+    });
+
+  if (canceled || (delegate && !delegate->continueTask()))
+    return false;
+
+  if (delegate)
+    delegate->notifyTaskProgress(1.0);
+  return true;
+}
+
 void dither_rgb_image_to_indexed(
   DitheringAlgorithmBase& algorithm,
   const Dithering& dithering,
@@ -242,31 +317,34 @@ void dither_rgb_image_to_indexed(
   algorithm.start(srcImage, dstImage, dithering.factor());
 
   if (algorithm.dimensions() == 1) {
-    const doc::LockImageBits<doc::RgbTraits> srcBits(srcImage);
-    doc::LockImageBits<doc::IndexedTraits> dstBits(dstImage);
-    auto srcIt = srcBits.begin();
-    auto dstIt = dstBits.begin();
-
-    for (int y=0; y<h; ++y) {
-      for (int x=0; x<w; ++x, ++srcIt, ++dstIt) {
-        ASSERT(srcIt != srcBits.end());
-        ASSERT(dstIt != dstBits.end());
-        *dstIt = algorithm.ditherRgbPixelToIndex(
-          dithering.matrix(), *srcIt, x, y, rgbmap, palette);
+    const DitheringMatrix matrix = dithering.matrix();
+    const int chunks = (h + kDitherRowsPerChunk - 1) / kDitherRowsPerChunk;
+
+    if (chunks > 1 && doc::parallel_threads() > 1) {
+      if (!dither_rgb_rows_to_indexed_in_parallel(
+            algorithm, matrix, srcImage, dstImage,
+            rgbmap, palette, chunks, delegate))
+        return;
+    }
+    else {
+      for (int y=0; y<h; ++y) {
+        dither_rgb_row_to_indexed(algorithm, matrix, srcImage, dstImage,
+                                  y, rgbmap, palette);
 
         if (delegate) {
           if (!delegate->continueTask())
             return;
-        }
-      }
 
-      if (delegate) {
-        delegate->notifyTaskProgress(
-          double(y+1) / double(h));
+          delegate->notifyTaskProgress(
+            double(y+1) / double(h));
+        }
       }
     }
   }
   else {
+    // Error diffusion uses the error of the previous pixel (and the
+    // previous row in the opposite direction when zigZag() is true),
+    // so it must be calculated from one thread.
     auto dstIt = doc::get_pixel_address_fast<doc::IndexedTraits>(dstImage, 0, 0);
     const bool zigZag = algorithm.zigZag();
 
@@ -276,10 +354,6 @@ void dither_rgb_image_to_indexed(
         for (int x=w-1; x>=0; --x, --dstIt) {
           ASSERT(dstIt == doc::get_pixel_address_fast<doc::IndexedTraits>(dstImage, x, y));
           *dstIt = algorithm.ditherRgbToIndex2D(x, y, rgbmap, palette);
-          if (delegate) {
-            if (!delegate->continueTask())
-              return;
-          }
         }
         dstIt += w+1;
       }
@@ -287,14 +361,12 @@ void dither_rgb_image_to_indexed(
         for (int x=0; x<w; ++x, ++dstIt) {
           ASSERT(dstIt == doc::get_pixel_address_fast<doc::IndexedTraits>(dstImage, x, y));
           *dstIt = algorithm.ditherRgbToIndex2D(x, y, rgbmap, palette);
-
-          if (delegate) {
-            if (!delegate->continueTask())
-              return;
-          }
         }
       }
       if (delegate) {
+        if (!delegate->continueTask())
+          return;
+
         delegate->notifyTaskProgress(
           double(y+1) / double(h));
       }
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2017 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -36,6 +36,8 @@ namespace render {
 
     virtual void finish() { }
 
+    // Used by 1D algorithms, it can be called from several threads
+    // at the same time (for different rows of the image).
     virtual doc::color_t ditherRgbPixelToIndex(
       const DitheringMatrix& matrix,
       const doc::color_t color,
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2022  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 // Copyright (c) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -15,6 +15,7 @@
 #include "doc/layer.h"
 #include "doc/octree_map.h"
 #include "doc/palette.h"
+#include "doc/parallel.h"
 #include "doc/primitives.h"
 #include "doc/remap.h"
 #include "doc/sprite.h"
@@ -25,6 +26,7 @@
 #include "render/task_delegate.h"
 
 #include <algorithm>
+#include <atomic>
 #include <limits>
 #include <map>
 #include <memory>
@@ -35,6 +37,78 @@ namespace render {
 using namespace doc;
 using namespace gfx;
 
+// Maximum number of threads to feed PaletteOptimizers, each one uses
+// its own histogram (16MB).
+static const int kMaxHistogramThreads = 4;
+
+static int histogram_threads()
+{
+  return std::min(doc::parallel_threads(), kMaxHistogramThreads);
+}
+
+// Renders the frames in several threads, each one feeding its own
+// PaletteOptimizer with a range of consecutive frames, and then merges
+// them in order (so the result is the same as feeding "optimizer"
+// frame by frame). Returns false if the task was canceled.
+static bool feed_optimizer_with_frames_in_parallel(
+  PaletteOptimizer& optimizer,
+  const Sprite* sprite,
+  const frame_t fromFrame,
+  const frame_t toFrame,
+  const bool withAlpha,
+  TaskDelegate* delegate,
+  const bool newBlend)
+{
+  const int frames = toFrame - fromFrame + 1;
+  const int tasks = std::min(histogram_threads(), frames);
+  std::vector<std::unique_ptr<PaletteOptimizer>> optimizers(tasks);
+
+  std::atomic<bool> canceled(false);
+  std::atomic<int> doneFrames(0);
+
+  for (auto& o : optimizers)
+    o = std::make_unique<PaletteOptimizer>();
+
+  doc::parallel_for(
+    tasks,
+    [sprite, fromFrame, frames, tasks, withAlpha, newBlend,
+     &optimizers, &canceled, &doneFrames](const int i){
+      const frame_t frame1 = fromFrame + frames * i / tasks;
+      const frame_t frame2 = fromFrame + frames * (i+1) / tasks;
+      ImageRef flat_image(Image::create(IMAGE_RGB,
+          sprite->width(), sprite->height()));
+
+      render::Render render;
+      render.setNewBlend(newBlend);
+
+      for (frame_t frame=frame1; frame<frame2 && !canceled; ++frame) {
+        render.renderSprite(flat_image.get(), sprite, frame);
+        optimizers[i]->feedWithImage(flat_image.get(), withAlpha);
+        ++doneFrames;
+      }
+    },
+    // Report the progress and check if the task is canceled from
+    // this thread.
+    [delegate, frames, &canceled, &doneFrames]{
+      if (delegate && !canceled) {
+        if (!delegate->continueTask())
+          canceled = true;
+        else
+          delegate->notifyTaskProgress(double(doneFrames) / double(frames));
+      }
+    });
+
+  if (canceled || (delegate && !delegate->continueTask()))
+    return false;
+
+  for (const auto& o : optimizers)
+    optimizer.merge(*o);
+
+  if (delegate)
+    delegate->notifyTaskProgress(1.0);
+  return true;
+}
+
 Palette* create_palette_from_sprite(
   const Sprite* sprite,
   const frame_t fromFrame,
@@ -81,27 +155,37 @@ Palette* create_palette_from_sprite(
   render.setNewBlend(newBlend);
 
   // Feed the optimizer with all rendered frames
-  for (frame_t frame=fromFrame; frame<=toFrame; ++frame) {
-    render.renderSprite(flat_image.get(), sprite, frame);
+  if (mapAlgo == RgbMapAlgorithm::RGB5A3 &&
+      toFrame > fromFrame &&
+      histogram_threads() > 1) {
+    if (!feed_optimizer_with_frames_in_parallel(
+          optimizer, sprite, fromFrame, toFrame,
+          withAlpha, delegate, newBlend))
+      return nullptr;
+  }
+  else {
+    for (frame_t frame=fromFrame; frame<=toFrame; ++frame) {
+      render.renderSprite(flat_image.get(), sprite, frame);
 
-    switch (mapAlgo) {
-      case RgbMapAlgorithm::RGB5A3:
-        optimizer.feedWithImage(flat_image.get(), withAlpha);
-        break;
-      case RgbMapAlgorithm::OCTREE:
-        octreemap.feedWithImage(flat_image.get(), withAlpha, maskColor);
-        break;
-      default:
-        ASSERT(false);
-        break;
-    }
+      switch (mapAlgo) {
+        case RgbMapAlgorithm::RGB5A3:
+          optimizer.feedWithImage(flat_image.get(), withAlpha);
+          break;
+        case RgbMapAlgorithm::OCTREE:
+          octreemap.feedWithImage(flat_image.get(), withAlpha, maskColor);
+          break;
+        default:
+          ASSERT(false);
+          break;
+      }
 
-    if (delegate) {
-      if (!delegate->continueTask())
-        return nullptr;
+      if (delegate) {
+        if (!delegate->continueTask())
+          return nullptr;
 
-      delegate->notifyTaskProgress(
-        double(frame-fromFrame+1) / double(toFrame-fromFrame+1));
+        delegate->notifyTaskProgress(
+          double(frame-fromFrame+1) / double(toFrame-fromFrame+1));
+      }
     }
   }
 
@@ -220,6 +304,22 @@ Image* convert_pixel_format(
 
         // RGB -> Indexed
         case IMAGE_INDEXED: {
+          // Map whole rows at once, and then fix transparent pixels
+          if (rgbmap) {
+            const int w = image->width();
+            const uint8_t maskIndex = (new_mask_color == -1? 0 : new_mask_color);
+            for (int y=0; y<image->height(); ++y) {
+              auto src = (const color_t*)image->getPixelAddress(0, y);
+              auto dst = (uint8_t*)new_image->getPixelAddress(0, y);
+              rgbmap->mapColors(src, dst, w);
+              for (int x=0; x<w; ++x) {
+                if (rgba_geta(src[x]) == 0)
+                  dst[x] = maskIndex;
+              }
+            }
+            break;
+          }
+
           LockImageBits<IndexedTraits> dstBits(new_image, Image::WriteLock);
           auto dst_it = dstBits.begin();
 #ifdef _DEBUG
@@ -237,8 +337,6 @@ Image* convert_pixel_format(
 
             if (a == 0)
               *dst_it = (new_mask_color == -1? 0 : new_mask_color);
-            else if (rgbmap)
-              *dst_it = rgbmap->mapColor(c);
             else
               *dst_it = palette->findBestfit(r, g, b, a, new_mask_color);
           }
@@ -425,15 +523,28 @@ void PaletteOptimizer::feedWithImage(const Image* image,
         const LockImageBits<RgbTraits> bits(image, bounds);
         auto it = bits.begin(), end = bits.end();
 
+        // Consecutive pixels with the same color are added at once
+        color_t runColor = 0;
+        std::size_t runLength = 0;
+
         for (; it != end; ++it) {
           color = *it;
           if (rgba_geta(color) > 0) {
             if (!withAlpha)
               color |= rgba(0, 0, 0, 255);
 
-            m_histogram.addSamples(color, 1);
+            if (runLength > 0 && color == runColor)
+              ++runLength;
+            else {
+              if (runLength > 0)
+                m_histogram.addSamples(runColor, runLength);
+              runColor = color;
+              runLength = 1;
+            }
           }
         }
+        if (runLength > 0)
+          m_histogram.addSamples(runColor, runLength);
       }
       break;
 
@@ -470,6 +581,13 @@ void PaletteOptimizer::feedWithRgbaColor(color_t color)
   m_histogram.addSamples(color, 1);
 }
 
+void PaletteOptimizer::merge(const PaletteOptimizer& other)
+{
+  m_histogram.merge(other.m_histogram);
+  if (other.m_withAlpha)
+    m_withAlpha = true;
+}
+
 void PaletteOptimizer::calculate(Palette* palette, int maskIndex)
 {
   bool addMask;
@@ -1,5 +1,5 @@
 // Aseprite Rener Library
-// Copyright (c) 2019-2021  Igara Studio S.A.
+// Copyright (c) 2019-2026  Igara Studio S.A.
 // Copyright (c) 2001-2017  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -35,6 +35,8 @@ namespace render {
                        const gfx::Rect& bounds,
                        const bool withAlpha);
     void feedWithRgbaColor(doc::color_t color);
+    // Adds the colors of other optimizer (fed after this one)
+    void merge(const PaletteOptimizer& other);
     void calculate(doc::Palette* palette, int maskIndex);
     bool isHighPrecision() { return m_histogram.isHighPrecision(); }
     int highPrecisionSize() { return m_histogram.highPrecisionSize(); }
@@ -0,0 +1,183 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/reference_cache.h"
+
+#include "base/debug.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+namespace render {
+
+using namespace doc;
+
+namespace {
+
+// Creates a new image of the given size where each pixel is the
+// average of the pixels of "src" covered by it (colors are weighted
+// by alpha so transparent pixels don't darken the result).
+Image* reduce_rgb_image(const Image* src, const gfx::Size& size)
+{
+  ASSERT(src->pixelFormat() == IMAGE_RGB);
+  ASSERT(size.w > 0 && size.h > 0);
+
+  const int sw = src->width();
+  const int sh = src->height();
+
+  // Range of source columns [x1, x2) of each destination column
+  std::vector<int> cols(size.w+1);
+  for (int x=0; x<=size.w; ++x)
+    cols[x] = int(int64_t(x) * sw / size.w);
+
+  ImageSpec spec = src->spec();
+  spec.setSize(size);
+  Image* dst = Image::create(spec);
+
+  std::vector<uint32_t> r(size.w), g(size.w), b(size.w), a(size.w), n(size.w);
+  for (int y=0; y<size.h; ++y) {
+    const int y1 = int(int64_t(y) * sh / size.h);
+    const int y2 = std::max(y1+1, int(int64_t(y+1) * sh / size.h));
+
+    std::fill(r.begin(), r.end(), 0);
+    std::fill(g.begin(), g.end(), 0);
+    std::fill(b.begin(), b.end(), 0);
+    std::fill(a.begin(), a.end(), 0);
+    std::fill(n.begin(), n.end(), 0);
+
+    for (int v=y1; v<y2; ++v) {
+      const color_t* s = (const color_t*)src->getPixelAddress(0, v);
+      for (int x=0; x<size.w; ++x) {
+        const int x2 = std::max(cols[x]+1, cols[x+1]);
+        for (int u=cols[x]; u<x2; ++u) {
+          const color_t c = s[u];
+          const int ca = rgba_geta(c);
+          r[x] += rgba_getr(c) * ca;
+          g[x] += rgba_getg(c) * ca;
+          b[x] += rgba_getb(c) * ca;
+          a[x] += ca;
+        }
+        n[x] += x2 - cols[x];
+      }
+    }
+
+    color_t* d = (color_t*)dst->getPixelAddress(0, y);
+    for (int x=0; x<size.w; ++x, ++d) {
+      if (a[x] == 0) {
+        *d = 0;
+        continue;
+      }
+      *d = rgba((r[x] + a[x]/2) / a[x],
+                (g[x] + a[x]/2) / a[x],
+                (b[x] + a[x]/2) / a[x],
+                (a[x] + n[x]/2) / n[x]);
+    }
+  }
+  return dst;
+}
+
+std::size_t image_size(const Image* image)
+{
+  return std::size_t(image->rowBytes()) * image->height();
+}
+
+} // anonymous namespace
+
+ReferenceCache::ReferenceCache(const std::size_t maxMemory)
+  : m_maxMemory(maxMemory)
+  , m_memoryUsage(0)
+{
+}
+
+std::size_t ReferenceCache::maxMemory() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_maxMemory;
+}
+
+std::size_t ReferenceCache::memoryUsage() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_memoryUsage;
+}
+
+void ReferenceCache::setMaxMemory(const std::size_t maxMemory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_maxMemory = maxMemory;
+  shrink();
+}
+
+doc::ImageRef ReferenceCache::getScaled(const doc::Image* image,
+                                        const gfx::Size& size,
+                                        bool* cached)
+{
+  if (image->pixelFormat() != IMAGE_RGB ||
+      size.w < 1 || size.h < 1 ||
+      size.w >= image->width() ||
+      size.h >= image->height())
+    return nullptr;
+
+  const doc::ObjectId id = image->id();
+  const std::lock_guard lock(m_mutex);
+
+  auto it = m_map.find(id);
+  if (it != m_map.end()) {
+    const Entry& entry = *it->second;
+    if (entry.version == image->version() &&
+        entry.scaled->size() == size) {
+      if (cached)
+        *cached = true;
+
+      // Move the entry to the front (most recently used)
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      return entry.scaled;
+    }
+    removeEntry(it->second);
+  }
+
+  if (cached)
+    *cached = false;
+
+  doc::ImageRef scaled(reduce_rgb_image(image, size));
+  const std::size_t bytes = image_size(scaled.get());
+  m_entries.push_front(Entry{ id, image->version(), scaled, bytes });
+  m_map.insert({ id, m_entries.begin() });
+  m_memoryUsage += bytes;
+
+  shrink();
+  return scaled;
+}
+
+void ReferenceCache::clear()
+{
+  const std::lock_guard lock(m_mutex);
+  m_entries.clear();
+  m_map.clear();
+  m_memoryUsage = 0;
+}
+
+void ReferenceCache::removeEntry(Entries::iterator it)
+{
+  m_memoryUsage -= it->size;
+  m_map.erase(it->id);
+  m_entries.erase(it);
+}
+
+void ReferenceCache::shrink()
+{
+  while (m_memoryUsage > m_maxMemory && !m_entries.empty())
+    removeEntry(std::prev(m_entries.end()));
+}
+
+} // namespace render
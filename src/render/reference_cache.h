@@ -0,0 +1,84 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_REFERENCE_CACHE_H_INCLUDED
+#define RENDER_REFERENCE_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/image_ref.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+#include "gfx/size.h"
+
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace doc {
+  class Image;
+}
+
+namespace render {
+
+  // Cache of images of reference layers (usually big photos) reduced
+  // to the size they have in the rendered area (which depends on the
+  // zoom level and the float bounds of the cel). Each pixel of the
+  // reduced image is the average of all pixels of the original image
+  // that it covers (instead of just taking one of them), so the
+  // reference looks smooth, and each render only composites the
+  // visible pixels.
+  //
+  // There is one reduced image for each original image, which is
+  // created again when the size changes (e.g. the zoom level changes
+  // or the cel is resized) or the version of the original image
+  // changes. Entries are discarded in LRU order when the memory usage
+  // exceeds the given limit. The cache can be shared between several
+  // render::Render instances (and threads).
+  class ReferenceCache {
+  public:
+    explicit ReferenceCache(const std::size_t maxMemory);
+
+    std::size_t maxMemory() const;
+    std::size_t memoryUsage() const;
+    void setMaxMemory(const std::size_t maxMemory);
+
+    // Returns the image reduced to the given size, or nullptr if the
+    // image cannot be reduced (it's not an RGB image, or the size is
+    // not smaller than the image). "cached" is set to true if the
+    // reduced image was already in the cache.
+    doc::ImageRef getScaled(const doc::Image* image,
+                            const gfx::Size& size,
+                            bool* cached = nullptr);
+
+    void clear();
+
+  private:
+    struct Entry {
+      doc::ObjectId id;
+      doc::ObjectVersion version;
+      doc::ImageRef scaled;
+      std::size_t size;
+    };
+    using Entries = std::list<Entry>;
+
+    void removeEntry(Entries::iterator it);
+    void shrink();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxMemory;
+    std::size_t m_memoryUsage;
+    // Most recently used entries at the beginning of the list
+    Entries m_entries;
+    std::unordered_map<doc::ObjectId, Entries::iterator> m_map;
+
+    DISABLE_COPYING(ReferenceCache);
+  };
+
+} // namespace render
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (C) 2019-2023  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -11,19 +11,30 @@
 
 #include "render/render.h"
 
+#include "doc/blend_funcs.h"
 #include "doc/blend_internals.h"
 #include "doc/blend_mode.h"
+#include "doc/blend_span.h"
 #include "doc/doc.h"
 #include "doc/image_impl.h"
 #include "doc/layer_tilemap.h"
+#include "doc/parallel.h"
 #include "doc/playback.h"
 #include "doc/render_plan.h"
 #include "doc/tileset.h"
 #include "doc/tilesets.h"
 #include "gfx/clip.h"
 #include "gfx/region.h"
+#include "render/composite_cache.h"
+#include "render/mipmap_cache.h"
+#include "render/reference_cache.h"
+#include "render/tilemap_cache.h"
+#include "render/render_stats.h"
 
+#include <algorithm>
 #include <cmath>
+#include <cstring>
+#include <type_traits>
 
 #define TRACE_RENDER_CEL(...) // TRACE
 
@@ -31,6 +42,18 @@ namespace render {
 
 namespace {
 
+// Approximated size (in bytes) of each band of rows rendered by one
+// thread in Render::renderSpriteInTiles(). It should fit in the L2
+// cache of the CPU so the whole layer stack is composited in cache.
+const int kTileBytes = 128*1024;
+
+// Initial values of the keys used in the CompositeCache for the
+// background of renderSprite(), snapshots of the layers below the
+// current layer, and flattened onion skin frames
+const uint64_t kBackgroundCacheKey = 0x6267726f756e6421ull;
+const uint64_t kLayersBelowCacheKey = 0x62656c6f776c6179ull;
+const uint64_t kOnionskinCacheKey = 0x6f6e696f6e736b6eull;
+
 //////////////////////////////////////////////////////////////////////
 // Scaled composite
 
@@ -147,6 +170,18 @@ public:
   }
 };
 
+// True if we can use rgba_blender_normal_masked_span() for the given
+// traits/blend mode.
+template<class DstTraits, class SrcTraits>
+inline bool use_rgba_normal_span(const BlendMode blendMode)
+{
+  if constexpr (std::is_same_v<DstTraits, RgbTraits> &&
+                std::is_same_v<SrcTraits, RgbTraits>)
+    return (blendMode == BlendMode::NORMAL);
+  else
+    return false;
+}
+
 template<class DstTraits, class SrcTraits>
 void composite_image_without_scale(
   Image* dst, const Image* src, const Palette* pal,
@@ -185,6 +220,18 @@ void composite_image_without_scale(
 #endif
   typename LockImageBits<DstTraits>::iterator dst_it, dst_end;
 
+  // Fast path for RGBA Normal blending (processes a whole row at once)
+  if (use_rgba_normal_span<DstTraits, SrcTraits>(blendMode)) {
+    const color_t maskColor = src->maskColor();
+    for (int y=0; y<srcBounds.h; ++y) {
+      rgba_blender_normal_masked_span(
+        (color_t*)get_pixel_address_fast<DstTraits>(dst, dstBounds.x, dstBounds.y+y),
+        (const color_t*)get_pixel_address_fast<SrcTraits>(src, srcBounds.x, srcBounds.y+y),
+        srcBounds.w, opacity, maskColor);
+    }
+    return;
+  }
+
   // For each line to draw of the source image...
   dstBounds.h = 1;
   for (int y=0; y<srcBounds.h; ++y) {
@@ -284,24 +331,43 @@ void composite_image_scale_up(
 
     // Read 'src' and 'dst' and blend them, put the result in `scanline'
     scanline_it = scanline.begin();
-    for (int x=0; x<srcBounds.w; ++x) {
-      ASSERT(src_it >= srcBits.begin() && src_it < src_end);
-      ASSERT(dst_it >= dstBits.begin() && dst_it < dst_end);
-      ASSERT(scanline_it >= scanline.begin() && scanline_it < scanline_end);
+    if (use_rgba_normal_span<DstTraits, SrcTraits>(blendMode)) {
+      // Gather the 'dst' pixels in the scanline and blend the whole
+      // 'src' row with them at once.
+      for (int x=0; x<srcBounds.w; ++x, ++scanline_it) {
+        ASSERT(scanline_it >= scanline.begin() && scanline_it < scanline_end);
+        *scanline_it = *dst_it;
+
+        int delta = (x == 0 ? first_px_w: px_w);
+        while (dst_it != dst_end && delta-- > 0)
+          ++dst_it;
+      }
+      rgba_blender_normal_masked_span(
+        (color_t*)&scanline[0],
+        (const color_t*)get_pixel_address_fast<SrcTraits>(src, srcBounds.x, srcBounds.y+y),
+        srcBounds.w, opacity, src->maskColor());
+      src_it += srcBounds.w;
+    }
+    else {
+      for (int x=0; x<srcBounds.w; ++x) {
+        ASSERT(src_it >= srcBits.begin() && src_it < src_end);
+        ASSERT(dst_it >= dstBits.begin() && dst_it < dst_end);
+        ASSERT(scanline_it >= scanline.begin() && scanline_it < scanline_end);
 
-      *scanline_it = blender(*dst_it, *src_it, opacity);
-      ++src_it;
+        *scanline_it = blender(*dst_it, *src_it, opacity);
+        ++src_it;
 
-      int delta;
-      if (x == 0)
-        delta = first_px_w;
-      else
-        delta = px_w;
+        int delta;
+        if (x == 0)
+          delta = first_px_w;
+        else
+          delta = px_w;
 
-      while (dst_it != dst_end && delta-- > 0)
-        ++dst_it;
+        while (dst_it != dst_end && delta-- > 0)
+          ++dst_it;
 
-      ++scanline_it;
+        ++scanline_it;
+      }
     }
 
     // Get the 'height' of the line to be painted in 'dst'
@@ -637,6 +703,70 @@ bool has_visible_reference_layers(const LayerGroup* group)
   return false;
 }
 
+// Fills the two rows of the checkered background pattern: the row
+// "i" starts with "tileWidth" pixels of color1 (i=0) or color2 (i=1),
+// and then both colors are alternated each "tileWidth" pixels.
+template<typename ImageTraits>
+void fill_checkered_rows(Render::CheckeredRows& cache)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+
+  for (int i=0; i<2; ++i) {
+    auto& row = cache.rows[i];
+    row.resize(cache.width * sizeof(pixel_t));
+
+    pixel_t* p = (pixel_t*)row.data();
+    for (int x=0; x<cache.width; ++x, ++p)
+      *p = ((((x / cache.tileWidth) + i) & 1) ? cache.color2: cache.color1);
+  }
+}
+
+bool is_scale_down_composition(const CompositeImageFunc func)
+{
+  return
+    (func == composite_image_scale_down<RgbTraits, RgbTraits> ||
+     func == composite_image_scale_down<GrayscaleTraits, RgbTraits> ||
+     func == composite_image_scale_down<IndexedTraits, RgbTraits> ||
+     func == composite_image_scale_down<RgbTraits, GrayscaleTraits> ||
+     func == composite_image_scale_down<GrayscaleTraits, GrayscaleTraits> ||
+     func == composite_image_scale_down<IndexedTraits, GrayscaleTraits> ||
+     func == composite_image_scale_down<RgbTraits, IndexedTraits> ||
+     func == composite_image_scale_down<GrayscaleTraits, IndexedTraits> ||
+     func == composite_image_scale_down<IndexedTraits, IndexedTraits>);
+}
+
+// Returns true if we should save a CompositeCache snapshot after
+// rendering the given item: if it's the last item of its group in the
+// plan. (While we are drawing, the layers below the current layer
+// come from the snapshot created by Render::cacheLayersBelow().)
+bool is_cache_checkpoint(const RenderPlan::Items& items,
+                         const int i,
+                         const int cachedItems)
+{
+  return (i < cachedItems &&
+          (i+1 == int(items.size()) ||
+           items[i+1].layer->parent() != items[i].layer->parent()));
+}
+
+// Returns true if the area can be split/copied pixel by pixel (it
+// doesn't have fractional coordinates).
+bool is_integer_clip(const gfx::ClipF& area)
+{
+  return (area.dst.x == std::floor(area.dst.x) &&
+          area.dst.y == std::floor(area.dst.y) &&
+          area.src.x == std::floor(area.src.x) &&
+          area.src.y == std::floor(area.src.y) &&
+          area.size.w == std::floor(area.size.w) &&
+          area.size.h == std::floor(area.size.h));
+}
+
+uint64_t double_bits(const double value)
+{
+  uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
 } // anonymous namespace
 
 Render::Render()
@@ -657,6 +787,12 @@ Render::Render()
   , m_previewTileset(nullptr)
   , m_previewBlendMode(BlendMode::NORMAL)
   , m_onionskin(OnionskinType::NONE)
+  , m_parallel(false)
+  , m_compositeCache(nullptr)
+  , m_mipmapCache(nullptr)
+  , m_referenceCache(nullptr)
+  , m_tilemapCache(nullptr)
+  , m_stats(nullptr)
 {
 }
 
@@ -693,6 +829,36 @@ void Render::setSelectedLayer(const Layer* layer)
   m_selectedLayerForOpacity = layer;
 }
 
+void Render::setParallel(const bool parallel)
+{
+  m_parallel = parallel;
+}
+
+void Render::setCompositeCache(CompositeCache* cache)
+{
+  m_compositeCache = cache;
+}
+
+void Render::setMipmapCache(MipmapCache* cache)
+{
+  m_mipmapCache = cache;
+}
+
+void Render::setReferenceCache(ReferenceCache* cache)
+{
+  m_referenceCache = cache;
+}
+
+void Render::setTilemapCache(TilemapCache* cache)
+{
+  m_tilemapCache = cache;
+}
+
+void Render::setStats(RenderStats* stats)
+{
+  m_stats = stats;
+}
+
 void Render::setPreviewImage(const Layer* layer,
                              const frame_t frame,
                              const Image* image,
@@ -734,6 +900,11 @@ void Render::removeExtraImage()
   m_extraCel = nullptr;
 }
 
+void Render::setExtraTransform(const ExtraTransform& transform)
+{
+  m_extraTransform = transform;
+}
+
 void Render::setOnionskin(const OnionskinOptions& options)
 {
   m_onionskin = options;
@@ -795,6 +966,74 @@ void Render::renderSprite(
   const Sprite* sprite,
   frame_t frame,
   const gfx::ClipF& area)
+{
+  if (m_parallel &&
+      renderSpriteInTiles(dstImage, sprite, frame, area))
+    return;
+
+  renderSpriteArea(dstImage, sprite, frame, area);
+}
+
+bool Render::renderSpriteInTiles(
+  Image* dstImage,
+  const Sprite* sprite,
+  frame_t frame,
+  const gfx::ClipF& area)
+{
+  // Areas with fractional coordinates are rendered in the serial
+  // path, we cannot split them in rows without changing the result.
+  if (!is_integer_clip(area))
+    return false;
+
+  const gfx::Clip iarea(area);
+  const gfx::Rect dstBounds = (iarea.dstBounds() & dstImage->bounds());
+  if (dstBounds.isEmpty())
+    return false;
+
+  const int rows = std::max(1, kTileBytes / (dstBounds.w * dstImage->bytesPerPixel()));
+  if (dstBounds.h <= rows)
+    return false;
+
+  m_sprite = sprite;
+
+  const gfx::Point srcOrigin(iarea.src.x + dstBounds.x - iarea.dst.x,
+                             iarea.src.y + dstBounds.y - iarea.dst.y);
+
+  // Make the private copy of shared pixels before the bands write
+  // the destination image from several threads
+  dstImage->detachBits();
+
+  doc::parallel_for(
+    (dstBounds.h + rows - 1) / rows,
+    [this, dstImage, sprite, frame, dstBounds, srcOrigin, rows](const int i){
+      const int y = i*rows;
+      const int h = std::min(rows, dstBounds.h-y);
+
+      // Each band is rendered with its own Render copy as the
+      // rendering process modifies the state of the instance
+      // (e.g. m_globalOpacity or m_tmpBuf).
+      Render render(*this);
+      render.m_parallel = false;
+      render.m_tmpBuf.reset();
+
+      ImageSpec spec = dstImage->spec();
+      spec.setSize(dstBounds.w, h);
+      ImageRef band(Image::create(spec));
+      render.renderSpriteArea(
+        band.get(), sprite, frame,
+        gfx::ClipF(0, 0, srcOrigin.x, srcOrigin.y+y, dstBounds.w, h));
+
+      // Bands don't overlap, so we can copy them without locking
+      copy_image(dstImage, band.get(), dstBounds.x, dstBounds.y+y);
+    });
+  return true;
+}
+
+void Render::renderSpriteArea(
+  Image* dstImage,
+  const Sprite* sprite,
+  frame_t frame,
+  const gfx::ClipF& area)
 {
   m_sprite = sprite;
 
@@ -806,19 +1045,7 @@ void Render::renderSprite(
     return;
 
   const LayerImage* bgLayer = m_sprite->backgroundLayer();
-  color_t bg_color = 0;
-  if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
-    switch (dstImage->pixelFormat()) {
-      case IMAGE_RGB:
-      case IMAGE_GRAYSCALE:
-        if (bgLayer && bgLayer->isVisible())
-          bg_color = m_sprite->palette(frame)->getEntry(m_sprite->transparentColor());
-        break;
-      case IMAGE_INDEXED:
-        bg_color = m_sprite->transparentColor();
-        break;
-    }
-  }
+  const color_t bg_color = backgroundColor(dstImage->pixelFormat(), frame);
 
   // New Blending Method:
   if (m_newBlendMethod) {
@@ -828,7 +1055,7 @@ void Render::renderSprite(
     fill_rect(dstImage, area.dstBounds(), bg_color);
 
     // Draw the Background layer - Onion skin behind the sprite - Transparent Layers
-    renderSpriteLayers(dstImage, area, frame, compositeImage);
+    renderSpriteLayers(dstImage, area, frame, compositeImage, bg_color);
 
     // In case that we need a special background (e.g. like the
     // checkered pattern), we can draw the background in a temporal
@@ -848,7 +1075,7 @@ void Render::renderSprite(
   // Old Blending Method:
   else {
     renderBackground(dstImage, bgLayer, bg_color, area);
-    renderSpriteLayers(dstImage, area, frame, compositeImage);
+    renderSpriteLayers(dstImage, area, frame, compositeImage, bg_color);
   }
 
   // Draw onion skin in front of the sprite.
@@ -876,25 +1103,85 @@ void Render::renderSprite(
   }
 }
 
+color_t Render::backgroundColor(const PixelFormat dstFormat,
+                                const frame_t frame) const
+{
+  const LayerImage* bgLayer = m_sprite->backgroundLayer();
+  color_t bg_color = 0;
+  if (m_sprite->pixelFormat() == IMAGE_INDEXED) {
+    switch (dstFormat) {
+      case IMAGE_RGB:
+      case IMAGE_GRAYSCALE:
+        if (bgLayer && bgLayer->isVisible())
+          bg_color = m_sprite->palette(frame)->getEntry(m_sprite->transparentColor());
+        break;
+      case IMAGE_INDEXED:
+        bg_color = m_sprite->transparentColor();
+        break;
+    }
+  }
+  return bg_color;
+}
+
 void Render::renderSpriteLayers(Image* dstImage,
                                 const gfx::ClipF& area,
                                 frame_t frame,
-                                CompositeImageFunc compositeImage)
+                                CompositeImageFunc compositeImage,
+                                const color_t bg_color)
 {
   doc::RenderPlan plan;
   plan.addLayer(m_sprite->root(), frame);
 
+  // While the user is drawing, copy the layers below the current
+  // layer from the snapshot created by cacheLayersBelow(), and blend
+  // only the current layer (with the extra cel) and the layers above.
+  int below;
+  if (m_compositeCache &&
+      m_extraType != ExtraType::NONE &&
+      restoreLayersBelow(plan, dstImage, area, frame,
+                         compositeImage, bg_color, below)) {
+    m_globalOpacity = 255;
+    renderPlan(plan, dstImage,
+               area, frame, compositeImage,
+               false,
+               true,
+               BlendMode::UNSPECIFIED,
+               nullptr, below);
+    return;
+  }
+
+  // State of the destination area to find snapshots of the blended
+  // layers in the CompositeCache (renderPlan() adds the state of
+  // each blended layer to it).
+  CompositeCache::Key key;
+  CompositeCache::Key* cacheKey = nullptr;
+  if (m_compositeCache) {
+    key.add(kBackgroundCacheKey);
+    for (const uint64_t value : {
+           double_bits(area.dst.x), double_bits(area.dst.y),
+           double_bits(area.src.x), double_bits(area.src.y),
+           double_bits(area.size.w), double_bits(area.size.h) }) {
+      key.add(value);
+    }
+    addBackgroundToKey(dstImage->spec(), compositeImage, bg_color, key);
+    cacheKey = &key;
+  }
+
   // Draw the background layer.
   m_globalOpacity = 255;
   renderPlan(plan, dstImage,
              area, frame, compositeImage,
              true,
              false,
-             BlendMode::UNSPECIFIED);
+             BlendMode::UNSPECIFIED,
+             cacheKey);
 
   // Draw onion skin behind the sprite.
-  if (m_onionskin.position() == OnionskinPosition::BEHIND)
+  if (m_onionskin.position() == OnionskinPosition::BEHIND) {
+    if (cacheKey && !key.empty() && !addOnionskinToKey(frame, key))
+      key.clear();
     renderOnionskin(dstImage, area, frame, compositeImage);
+  }
 
   // Draw the transparent layers.
   m_globalOpacity = 255;
@@ -902,7 +1189,222 @@ void Render::renderSpriteLayers(Image* dstImage,
              area, frame, compositeImage,
              false,
              true,
-             BlendMode::UNSPECIFIED);
+             BlendMode::UNSPECIFIED,
+             cacheKey);
+}
+
+void Render::addBackgroundToKey(const ImageSpec& dstSpec,
+                                const CompositeImageFunc compositeImage,
+                                const color_t bg_color,
+                                CompositeCache::Key& key) const
+{
+  for (const uint64_t value : {
+         uint64_t(m_sprite->id()),
+         uint64_t(dstSpec.colorMode()),
+         uint64_t(dstSpec.maskColor()),
+         uint64_t(reinterpret_cast<uintptr_t>(compositeImage)),
+         uint64_t(m_newBlendMethod),
+         uint64_t(bg_color) }) {
+    key.add(value);
+  }
+
+  // With the old blending method the background pattern is drawn
+  // before the layers.
+  if (!m_newBlendMethod) {
+    const LayerImage* bgLayer = m_sprite->backgroundLayer();
+    for (const uint64_t value : {
+           uint64_t(m_bg.type),
+           uint64_t(m_bg.zoom),
+           uint64_t(m_bg.colorPixelFormat),
+           uint64_t(m_bg.color1),
+           uint64_t(m_bg.color2),
+           uint64_t(m_bg.stripeSize.w),
+           uint64_t(m_bg.stripeSize.h),
+           uint64_t(bgLayer && bgLayer->isVisible()) }) {
+      key.add(value);
+    }
+  }
+}
+
+bool Render::addOnionskinToKey(const frame_t frame,
+                               CompositeCache::Key& key)
+{
+  const Tag* loop = m_onionskin.loopTag();
+  const Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
+                                                   m_sprite->root());
+  for (const uint64_t value : {
+         uint64_t(m_onionskin.type()),
+         uint64_t(m_onionskin.prevFrames()),
+         uint64_t(m_onionskin.nextFrames()),
+         uint64_t(m_onionskin.opacityBase()),
+         uint64_t(m_onionskin.opacityStep()),
+         uint64_t(onionLayer->id()),
+         uint64_t(m_sprite->totalFrames()),
+         uint64_t(loop ? loop->id(): 0),
+         uint64_t(loop ? loop->fromFrame(): 0),
+         uint64_t(loop ? loop->toFrame(): 0),
+         uint64_t(loop ? int(loop->aniDir()): 0),
+         uint64_t(loop ? loop->repeat(): 0) }) {
+    key.add(value);
+  }
+
+  std::vector<std::size_t> counts;
+  for (const OnionskinFrame& onion : onionskinFrames(frame)) {
+    doc::RenderPlan plan;
+    plan.addLayer(onionLayer, onion.frame);
+
+    m_globalOpacity = onion.opacity;
+    const int n = calcCompositeCacheKey(
+      plan, onion.frame, onion.renderBackground, true,
+      onion.blendMode, key, counts);
+    if (n < int(plan.items().size()))
+      return false;
+  }
+  return true;
+}
+
+void Render::cacheLayersBelow(const Sprite* sprite,
+                              const frame_t frame,
+                              const Layer* layer)
+{
+  // Only the new blending method draws the background pattern after
+  // the layers, so the snapshot doesn't depend on the area
+  if (!m_compositeCache || !m_newBlendMethod)
+    return;
+
+  m_sprite = sprite;
+
+  // The snapshot contains the whole sprite with the current
+  // projection in the pixel format used by the Editor
+  const gfx::Rect bounds = m_proj.apply(sprite->bounds());
+  const ImageSpec spec(ColorMode::RGB, bounds.w, bounds.h);
+  if (bounds.isEmpty() ||
+      std::size_t(bounds.w) * bounds.h * 4 > m_compositeCache->maxMemory())
+    return;
+
+  CompositeImageFunc compositeImage =
+    getImageComposition(IMAGE_RGB, sprite->pixelFormat(), sprite->root());
+  if (!compositeImage)
+    return;
+
+  // Render everything but the extra cel (which is set after the
+  // ToolLoop starts)
+  Render render(*this);
+  render.removeExtraImage();
+  render.m_parallel = false;
+  render.m_tmpBuf.reset();
+
+  doc::RenderPlan plan;
+  plan.addLayer(sprite->root(), frame);
+
+  const color_t bg_color = render.backgroundColor(IMAGE_RGB, frame);
+  CompositeCache::Key key;
+  int below;
+  if (!render.calcLayersBelowKey(plan, spec, frame, layer,
+                                 compositeImage, bg_color, key, below) ||
+      m_compositeCache->get(key)) // Already cached
+    return;
+
+  // Same steps as renderSpriteArea() + renderSpriteLayers() until
+  // the given layer
+  ImageRef snapshot(Image::create(spec));
+  const gfx::Clip area(0, 0, 0, 0, bounds.w, bounds.h);
+  fill_rect(snapshot.get(), snapshot->bounds(), bg_color);
+
+  render.m_globalOpacity = 255;
+  render.renderPlan(plan, snapshot.get(),
+                    area, frame, compositeImage,
+                    true,
+                    false,
+                    BlendMode::UNSPECIFIED);
+
+  if (m_onionskin.position() == OnionskinPosition::BEHIND)
+    render.renderOnionskin(snapshot.get(), area, frame, compositeImage);
+
+  render.m_globalOpacity = 255;
+  render.renderPlan(plan, snapshot.get(),
+                    area, frame, compositeImage,
+                    false,
+                    true,
+                    BlendMode::UNSPECIFIED,
+                    nullptr, 0, below);
+
+  m_compositeCache->store(key, snapshot);
+}
+
+bool Render::restoreLayersBelow(const RenderPlan& plan,
+                                Image* dstImage,
+                                const gfx::ClipF& area,
+                                const frame_t frame,
+                                const CompositeImageFunc compositeImage,
+                                const color_t bg_color,
+                                int& below)
+{
+  if (!m_newBlendMethod ||
+      !m_currentLayer ||
+      !is_integer_clip(area))
+    return false;
+
+  CompositeCache::Key key;
+  if (!calcLayersBelowKey(plan, dstImage->spec(), frame, m_currentLayer,
+                          compositeImage, bg_color, key, below))
+    return false;
+
+  const bool restored =
+    m_compositeCache->restore(key, dstImage, gfx::Clip(area));
+  if (m_stats)
+    ++(restored ? m_stats->compositeHits: m_stats->compositeMisses);
+  return restored;
+}
+
+bool Render::calcLayersBelowKey(const RenderPlan& plan,
+                                const ImageSpec& dstSpec,
+                                const frame_t frame,
+                                const Layer* layer,
+                                const CompositeImageFunc compositeImage,
+                                const color_t bg_color,
+                                CompositeCache::Key& key,
+                                int& below)
+{
+  if (!layer || layer->isBackground())
+    return false;
+
+  const RenderPlan::Items& items = plan.items();
+  const int n = int(items.size());
+  for (below=0; below<n; ++below) {
+    if (items[below].layer == layer)
+      break;
+  }
+  if (below == n)               // The layer is hidden
+    return false;
+
+  key.add(kLayersBelowCacheKey);
+  key.add(uint64_t(m_sprite->width()));
+  key.add(uint64_t(m_sprite->height()));
+  addBackgroundToKey(dstSpec, compositeImage, bg_color, key);
+
+  // Background layer
+  std::vector<std::size_t> counts;
+  m_globalOpacity = 255;
+  if (calcCompositeCacheKey(plan, frame, true, false,
+                            BlendMode::UNSPECIFIED, key, counts) < n)
+    return false;
+
+  // Onion skin behind the sprite
+  key.add(uint64_t(m_onionskin.position()));
+  if (m_onionskin.position() == OnionskinPosition::BEHIND &&
+      !addOnionskinToKey(frame, key))
+    return false;
+
+  // Transparent layers below the given layer (the extra cel is drawn
+  // in the given layer, so it's the first item that cannot be cached)
+  m_globalOpacity = 255;
+  if (calcCompositeCacheKey(plan, frame, false, true,
+                            BlendMode::UNSPECIFIED, key, counts) < below)
+    return false;
+
+  key.resize(counts[below]);
+  return true;
 }
 
 void Render::renderBackground(Image* image,
@@ -957,59 +1459,161 @@ void Render::renderOnionskin(
 {
   // Onion-skin feature: Draw previous/next frames with different
   // opacity (<255)
-  if (m_onionskin.type() != OnionskinType::NONE) {
-    Tag* loop = m_onionskin.loopTag();
-    Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
-                                               m_sprite->root());
-    Playback play(
-      m_sprite,
-      TagsList(),  // TODO add an onionskin option to iterate subtags
-      frame,
-      loop ? Playback::PlayInLoop : Playback::PlayAll,
-      loop);
-    frame_t prevFrames = (loop ? m_onionskin.prevFrames():
-                                 std::min(frame, m_onionskin.prevFrames()));
-    play.nextFrame(-prevFrames);
-
-    for (frame_t frameOut = frame - prevFrames;
-         frameOut <= frame + m_onionskin.nextFrames();
-         ++frameOut, play.nextFrame()) {
-      const frame_t frameIn = play.frame();
-
-      if (frameIn == frame ||
-          frameIn < 0 ||
-          frameIn > m_sprite->lastFrame()) {
-        continue;
-      }
+  const Layer* onionLayer = (m_onionskin.layer() ? m_onionskin.layer():
+                                                   m_sprite->root());
+  for (const OnionskinFrame& onion : onionskinFrames(frame)) {
+    m_globalOpacity = onion.opacity;
+
+    doc::RenderPlan plan;
+    plan.addLayer(onionLayer, onion.frame);
+    if (m_compositeCache &&
+        renderFlattenedOnionskin(plan, dstImage, area, onion.frame,
+                                 onion.renderBackground, onion.blendMode))
+      continue;
 
-      if (frameOut < frame) {
-        m_globalOpacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frame - frameOut)-1);
-      }
-      else {
-        m_globalOpacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frameOut - frame)-1);
-      }
+    renderPlan(
+      plan, dstImage,
+      area, onion.frame, compositeImage,
+      onion.renderBackground,
+      true, onion.blendMode);
+  }
+}
 
-      m_globalOpacity = std::clamp(m_globalOpacity, 0, 255);
-      if (m_globalOpacity > 0) {
-        BlendMode blendMode = BlendMode::UNSPECIFIED;
-        if (m_onionskin.type() == OnionskinType::MERGE)
-          blendMode = BlendMode::NORMAL;
-        else if (m_onionskin.type() == OnionskinType::RED_BLUE_TINT)
-          blendMode = (frameOut < frame ? BlendMode::RED_TINT: BlendMode::BLUE_TINT);
-
-        doc::RenderPlan plan;
-        plan.addLayer(onionLayer, frameIn);
-        renderPlan(
-          plan, dstImage,
-          area, frameIn, compositeImage,
-          // Render background only for "in-front" onion skinning and
-          // when opacity is < 255
-          (m_globalOpacity < 255 &&
-           m_onionskin.position() == OnionskinPosition::INFRONT),
-          true, blendMode);
-      }
+std::vector<Render::OnionskinFrame> Render::onionskinFrames(const frame_t frame) const
+{
+  std::vector<OnionskinFrame> frames;
+  if (m_onionskin.type() == OnionskinType::NONE)
+    return frames;
+
+  Tag* loop = m_onionskin.loopTag();
+  Playback play(
+    m_sprite,
+    TagsList(),  // TODO add an onionskin option to iterate subtags
+    frame,
+    loop ? Playback::PlayInLoop : Playback::PlayAll,
+    loop);
+  frame_t prevFrames = (loop ? m_onionskin.prevFrames():
+                               std::min(frame, m_onionskin.prevFrames()));
+  play.nextFrame(-prevFrames);
+
+  for (frame_t frameOut = frame - prevFrames;
+       frameOut <= frame + m_onionskin.nextFrames();
+       ++frameOut, play.nextFrame()) {
+    const frame_t frameIn = play.frame();
+
+    if (frameIn == frame ||
+        frameIn < 0 ||
+        frameIn > m_sprite->lastFrame()) {
+      continue;
+    }
+
+    int opacity;
+    if (frameOut < frame) {
+      opacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frame - frameOut)-1);
+    }
+    else {
+      opacity = m_onionskin.opacityBase() - m_onionskin.opacityStep() * ((frameOut - frame)-1);
+    }
+
+    opacity = std::clamp(opacity, 0, 255);
+    if (opacity > 0) {
+      BlendMode blendMode = BlendMode::UNSPECIFIED;
+      if (m_onionskin.type() == OnionskinType::MERGE)
+        blendMode = BlendMode::NORMAL;
+      else if (m_onionskin.type() == OnionskinType::RED_BLUE_TINT)
+        blendMode = (frameOut < frame ? BlendMode::RED_TINT: BlendMode::BLUE_TINT);
+
+      // Render background only for "in-front" onion skinning and
+      // when opacity is < 255
+      const bool renderBackground =
+        (opacity < 255 &&
+         m_onionskin.position() == OnionskinPosition::INFRONT);
+
+      frames.push_back(OnionskinFrame{ frameIn, opacity, blendMode,
+                                       renderBackground });
     }
   }
+  return frames;
+}
+
+bool Render::renderFlattenedOnionskin(
+  RenderPlan& plan,
+  Image* dstImage,
+  const gfx::Clip& area,
+  const frame_t frame,
+  const bool render_background,
+  const BlendMode blendMode)
+{
+  if (dstImage->pixelFormat() != IMAGE_RGB)
+    return false;
+
+  const gfx::Rect spriteBounds = m_sprite->bounds();
+  const BlendMode flattenBlendMode =
+    (blendMode == BlendMode::NORMAL ? BlendMode::NORMAL:
+                                      BlendMode::UNSPECIFIED);
+
+  // The frame is flattened at 100% (without onion skin, extra cel,
+  // etc.) so the same image can be reused in any zoom level and
+  // opacity (e.g. when the frame is moved from the next frames to the
+  // previous frames while we play the animation).
+  Render render(*this);
+  render.m_proj = Projection();
+  render.m_globalOpacity = 255;
+  render.m_onionskin.type(OnionskinType::NONE);
+  render.m_parallel = false;
+  render.m_compositeCache = nullptr;
+  render.m_mipmapCache = nullptr;
+  render.m_referenceCache = nullptr;
+  render.m_tmpBuf.reset();
+
+  CompositeImageFunc flattenComposite =
+    render.getImageComposition(IMAGE_RGB, m_sprite->pixelFormat(), nullptr);
+  if (!flattenComposite)
+    return false;
+
+  CompositeCache::Key key;
+  for (const uint64_t value : {
+         kOnionskinCacheKey,
+         uint64_t(m_sprite->id()),
+         uint64_t(spriteBounds.w),
+         uint64_t(spriteBounds.h),
+         uint64_t(reinterpret_cast<uintptr_t>(flattenComposite)) }) {
+    key.add(value);
+  }
+
+  std::vector<std::size_t> counts;
+  const int n = int(plan.items().size());
+  const int cachedItems = render.calcCompositeCacheKey(
+    plan, frame, render_background, true, flattenBlendMode, key, counts);
+
+  // Use the regular rendering if the frame contains the extra cel or
+  // the preview image
+  if (cachedItems < n)
+    return false;
+  if (n == 0)
+    return true;
+
+  ImageRef flat = m_compositeCache->get(key);
+  if (m_stats)
+    ++(flat ? m_stats->compositeHits: m_stats->compositeMisses);
+  if (!flat) {
+    flat.reset(Image::create(IMAGE_RGB, spriteBounds.w, spriteBounds.h));
+    clear_image(flat.get(), 0);
+    render.renderPlan(
+      plan, flat.get(), gfx::Clip(spriteBounds),
+      frame, flattenComposite,
+      render_background, true, flattenBlendMode);
+    m_compositeCache->store(key, flat);
+  }
+
+  // Only the onion skin tint/opacity is applied to the flattened frame
+  renderImage(
+    dstImage, flat.get(), m_sprite->palette(frame),
+    gfx::RectF(spriteBounds), area,
+    getImageComposition(IMAGE_RGB, IMAGE_RGB, nullptr),
+    m_globalOpacity,
+    (blendMode == BlendMode::UNSPECIFIED ? BlendMode::NORMAL: blendMode));
+  return true;
 }
 
 void Render::renderCheckeredBackground(
@@ -1052,6 +1656,28 @@ void Render::renderCheckeredBackground(
       break;
   }
 
+  // Offset of the first pixel to draw from the first drawn tile
+  // (which is the tile "u,v" starting in "x_start-tile_w,y_start-tile_h")
+  dstBounds &= image->bounds();
+  const int off_x = dstBounds.x - (x_start - tile_w);
+  const int off_y = dstBounds.y - (y_start - tile_h);
+
+  // Copy rows from the cached pattern
+  if (!dstBounds.isEmpty() && off_x >= 0 && off_y >= 0) {
+    const int x0 = off_x % (2*tile_w);
+    updateCheckeredRows(image->pixelFormat(), tile_w, x0 + dstBounds.w);
+
+    const int bpp = image->bytesPerPixel();
+    const int rowBytes = dstBounds.w * bpp;
+    for (y=0; y<dstBounds.h; ++y) {
+      const int parity = ((u + v + (off_y+y) / tile_h) & 1);
+      std::copy(m_checkeredRows.rows[parity].data() + x0*bpp,
+                m_checkeredRows.rows[parity].data() + x0*bpp + rowBytes,
+                image->getPixelAddress(dstBounds.x, dstBounds.y+y));
+    }
+    return;
+  }
+
   // Draw checkered background (tile by tile)
   int u_start = u;
   for (y=y_start-tile_h; y<image->height()+tile_h; y+=tile_h) {
@@ -1068,6 +1694,34 @@ void Render::renderCheckeredBackground(
   }
 }
 
+void Render::updateCheckeredRows(const PixelFormat pixelFormat,
+                                 const int tile_w,
+                                 const int width)
+{
+  CheckeredRows& cache = m_checkeredRows;
+  if (cache.pixelFormat == pixelFormat &&
+      cache.tileWidth == tile_w &&
+      cache.color1 == m_bg.color1 &&
+      cache.color2 == m_bg.color2 &&
+      cache.width >= width)
+    return;
+
+  cache.pixelFormat = pixelFormat;
+  cache.tileWidth = tile_w;
+  cache.color1 = m_bg.color1;
+  cache.color2 = m_bg.color2;
+  cache.width = std::max(width, cache.width);
+
+  switch (pixelFormat) {
+    case IMAGE_RGB:       fill_checkered_rows<RgbTraits>(cache); break;
+    case IMAGE_GRAYSCALE: fill_checkered_rows<GrayscaleTraits>(cache); break;
+    case IMAGE_INDEXED:   fill_checkered_rows<IndexedTraits>(cache); break;
+    default:
+      ASSERT(false);
+      break;
+  }
+}
+
 void Render::renderImage(
   Image* dst_image,
   const Image* src_image,
@@ -1106,9 +1760,50 @@ void Render::renderPlan(
   const CompositeImageFunc compositeImage,
   const bool render_background,
   const bool render_transparent,
-  const BlendMode blendMode)
+  const BlendMode blendMode,
+  CompositeCache::Key* key,
+  const int begin,
+  const int end)
 {
-  for (const auto& item : plan.items()) {
+  const RenderPlan::Items& items = plan.items();
+  const int n = (end >= 0 ? end: int(items.size()));
+  int first = begin;
+
+  // Snapshots can be used only when we render the whole plan
+  ASSERT(!key || (begin == 0 && end < 0));
+
+  // Number of values of the cache key with the first N items (the
+  // number of items that can be cached is "cachedItems", all the
+  // items after a preview/extra image are always rendered).
+  std::vector<std::size_t> counts;
+  int cachedItems = 0;
+  gfx::Rect cacheBounds;
+  if (m_compositeCache && key && !key->empty()) {
+    cachedItems = calcCompositeCacheKey(
+      plan, frame, render_background, render_transparent, blendMode,
+      *key, counts);
+
+    cacheBounds = (area.dstBounds() & image->bounds());
+    if (cacheBounds.isEmpty())
+      cachedItems = 0;
+
+    // Start from the last checkpoint that we already have in the cache
+    bool checkpoints = false;
+    for (int i=cachedItems-1; i>=0; --i) {
+      if (!is_cache_checkpoint(items, i, cachedItems))
+        continue;
+      checkpoints = true;
+      if (m_compositeCache->restore(*key, counts[i+1], image, cacheBounds)) {
+        first = i+1;
+        break;
+      }
+    }
+    if (m_stats && checkpoints)
+      ++(first > 0 ? m_stats->compositeHits: m_stats->compositeMisses);
+  }
+
+  for (int i=first; i<n; ++i) {
+    const auto& item = items[i];
     const Cel* cel = item.cel;
     const Layer* layer = item.layer;
 
@@ -1262,21 +1957,239 @@ void Render::renderPlan(
     // Draw extras
     if (drawExtra && m_extraType != ExtraType::NONE) {
       if (m_extraCel->opacity() > 0) {
-        renderCel(
-          image,
-          m_extraCel,
-          m_sprite,
-          m_extraImage,
-          m_currentLayer, // Current layer (useful to use get the tileset if extra cel is a tilemap)
-          m_sprite->palette(frame),
-          m_extraCel->bounds(),
-          gfx::Clip(area.dst.x+extraArea.x-area.src.x,
-                    area.dst.y+extraArea.y-area.src.y,
-                    extraArea),
-          m_extraCel->opacity(),
-          m_extraBlendMode);
+        if (m_extraType == ExtraType::TRANSFORM) {
+          renderTransformedExtra(
+            image,
+            m_sprite->palette(frame),
+            gfx::Clip(area.dst.x+extraArea.x-area.src.x,
+                      area.dst.y+extraArea.y-area.src.y,
+                      extraArea));
+        }
+        else {
+          renderCel(
+            image,
+            m_extraCel,
+            m_sprite,
+            m_extraImage,
+            m_currentLayer, // Current layer (useful to use get the tileset if extra cel is a tilemap)
+            m_sprite->palette(frame),
+            m_extraCel->bounds(),
+            gfx::Clip(area.dst.x+extraArea.x-area.src.x,
+                      area.dst.y+extraArea.y-area.src.y,
+                      extraArea),
+            m_extraCel->opacity(),
+            m_extraBlendMode);
+        }
       }
     }
+
+    if (is_cache_checkpoint(items, i, cachedItems))
+      m_compositeCache->store(*key, counts[i+1], image, cacheBounds);
+  }
+
+  // The next pass cannot use the cache if some item wasn't included
+  // in the key (e.g. the extra cel was drawn)
+  if (key && cachedItems < n)
+    key->clear();
+}
+
+int Render::calcCompositeCacheKey(
+  const RenderPlan& plan,
+  const frame_t frame,
+  const bool render_background,
+  const bool render_transparent,
+  const BlendMode blendMode,
+  CompositeCache::Key& key,
+  std::vector<std::size_t>& counts) const
+{
+  // All the parameters that can modify the result of renderCel()
+  // (the initial state of the destination image must be in the key)
+  const Palette* pal = m_sprite->palette(frame);
+  for (const uint64_t value : {
+         uint64_t(frame),
+         uint64_t(render_background),
+         uint64_t(render_transparent),
+         uint64_t(blendMode),
+         uint64_t(m_flags),
+         uint64_t(m_newBlendMethod),
+         uint64_t(m_globalOpacity),
+         uint64_t(m_nonactiveLayersOpacity),
+         uint64_t(m_selectedLayerForOpacity ? m_selectedLayerForOpacity->id(): 0),
+         uint64_t(m_sprite->transparentColor()),
+         uint64_t(pal->id()), uint64_t(pal->getModifications()),
+         double_bits(m_proj.scaleX()),
+         double_bits(m_proj.scaleY()) }) {
+    key.add(value);
+  }
+
+  const RenderPlan::Items& items = plan.items();
+  counts.resize(items.size()+1);
+  counts[0] = key.size();
+
+  int i = 0;
+  for (; i<int(items.size()); ++i) {
+    const Layer* layer = items[i].layer;
+    const Cel* cel = (items[i].cel ? items[i].cel: layer->cel(frame));
+
+    // Layers that are not drawn in this pass don't modify the result
+    if ((!render_background  &&  layer->isBackground()) ||
+        (!render_transparent && !layer->isBackground()) ||
+        (!(m_flags & Flags::ShowRefLayers) && layer->isReference())) {
+      counts[i+1] = key.size();
+      continue;
+    }
+
+    // The extra cel and the preview image are volatile images (they
+    // are modified without changing their versions), we cannot use
+    // the cache from this point.
+    if (isVolatileCel(layer, cel, frame))
+      break;
+
+    for (const uint64_t value : {
+           uint64_t(items[i].order),
+           uint64_t(layer->id()),
+           uint64_t(layer->version()),
+           uint64_t(layer->flags()),
+           uint64_t(layer->isImage() ? int(static_cast<const LayerImage*>(layer)->blendMode()): 0),
+           uint64_t(layer->isImage() ? static_cast<const LayerImage*>(layer)->opacity(): 0),
+           uint64_t(cel ? cel->id(): 0),
+           uint64_t(cel ? cel->version(): 0),
+           uint64_t(cel ? cel->data()->id(): 0),
+           uint64_t(cel ? cel->data()->version(): 0),
+           uint64_t(cel ? cel->opacity(): 0),
+           uint64_t(cel ? cel->zIndex(): 0),
+           uint64_t(cel ? double_bits(cel->boundsF().x): 0),
+           uint64_t(cel ? double_bits(cel->boundsF().y): 0),
+           uint64_t(cel ? double_bits(cel->boundsF().w): 0),
+           uint64_t(cel ? double_bits(cel->boundsF().h): 0),
+           uint64_t(cel && cel->image() ? cel->image()->id(): 0),
+           uint64_t(cel && cel->image() ? cel->image()->version(): 0) }) {
+      key.add(value);
+    }
+
+    if (layer->isTilemap()) {
+      const Tileset* tileset = static_cast<const LayerTilemap*>(layer)->tileset();
+      key.add(tileset ? tileset->id(): 0);
+      key.add(tileset ? tileset->version(): 0);
+    }
+
+    counts[i+1] = key.size();
+  }
+  return i;
+}
+
+bool Render::isVolatileCel(const Layer* layer,
+                           const Cel* cel,
+                           const frame_t frame) const
+{
+  // Same conditions used in renderPlan() to draw the extra cel
+  if (m_extraType != ExtraType::NONE &&
+      m_extraCel &&
+      layer == m_currentLayer) {
+    if (frame == m_extraCel->frame() &&
+        frame == m_currentFrame)
+      return true;
+
+    const Cel* cel2 = layer->cel(m_extraCel->frame());
+    if (cel && cel2 && cel->data() == cel2->data())
+      return true;
+  }
+  return ((m_previewImage || m_previewTileset) &&
+          cel && checkIfWeShouldUsePreview(cel));
+}
+
+// Draws each pixel of the output (in display resolution) sampling
+// the nearest pixel of the extra image through the inverse of the
+// parallelogram transformation. The cost depends on the visible
+// area only (not on the size of the transformed image).
+void Render::renderTransformedExtra(
+  Image* dst_image,
+  const Palette* pal,
+  const gfx::Clip& area)
+{
+  const Image* src = m_extraImage;
+  const Image* mask = m_extraTransform.mask;
+  if (dst_image->pixelFormat() != IMAGE_RGB ||
+      src->pixelFormat() == IMAGE_TILEMAP)
+    return;
+
+  ASSERT(!mask || mask->pixelFormat() == IMAGE_BITMAP);
+  ASSERT(!mask || mask->size() == src->size());
+
+  const gfx::PointF o = m_extraTransform.leftTop;
+  const gfx::PointF a = m_extraTransform.rightTop - o;
+  const gfx::PointF b = m_extraTransform.leftBottom - o;
+  const double det = a.x*b.y - a.y*b.x;
+  if (std::fabs(det) < 1e-9)
+    return;
+
+  // Clip the area to the destination image (the source position is
+  // in display coordinates, and it can be negative)
+  const gfx::Rect dstBounds =
+    area.dstBounds() & gfx::Rect(0, 0, dst_image->width(), dst_image->height());
+  if (dstBounds.isEmpty())
+    return;
+  const gfx::Point srcOrigin = area.src + (dstBounds.origin() - area.dst);
+
+  const double sx = m_proj.scaleX();
+  const double sy = m_proj.scaleY();
+  const int w = src->width();
+  const int h = src->height();
+  const color_t maskColor = src->maskColor();
+  const int opacity = m_extraCel->opacity();
+  const BlendFunc blender = get_rgba_blender(m_extraBlendMode, m_newBlendMethod);
+
+  // Increment of the (u, v) source coordinates (from 0 to 1) for
+  // each output pixel to the right
+  const double du = ( b.y/sx) / det;
+  const double dv = (-a.y/sx) / det;
+
+  for (int y=0; y<dstBounds.h; ++y) {
+    auto dstPtr = (RgbTraits::address_t)
+      dst_image->getPixelAddress(dstBounds.x, dstBounds.y+y);
+
+    // Sprite position of the center of the first pixel of this row
+    const double px = (srcOrigin.x + 0.5) / sx - o.x;
+    const double py = (srcOrigin.y + y + 0.5) / sy - o.y;
+    double u = (px*b.y - py*b.x) / det;
+    double v = (a.x*py - a.y*px) / det;
+
+    for (int x=0; x<dstBounds.w; ++x, ++dstPtr, u+=du, v+=dv) {
+      if (u < 0.0 || v < 0.0 || u >= 1.0 || v >= 1.0)
+        continue;
+
+      const int i = std::min(int(u*w), w-1);
+      const int j = std::min(int(v*h), h-1);
+      if (mask && !get_pixel_fast<BitmapTraits>(mask, i, j))
+        continue;
+
+      color_t c;
+      switch (src->pixelFormat()) {
+        case IMAGE_RGB:
+          c = get_pixel_fast<RgbTraits>(src, i, j);
+          if (c == maskColor)
+            continue;
+          break;
+        case IMAGE_GRAYSCALE: {
+          c = get_pixel_fast<GrayscaleTraits>(src, i, j);
+          if (c == maskColor)
+            continue;
+          const int k = graya_getv(c);
+          c = rgba(k, k, k, graya_geta(c));
+          break;
+        }
+        case IMAGE_INDEXED:
+          c = get_pixel_fast<IndexedTraits>(src, i, j);
+          if (c == maskColor)
+            continue;
+          c = pal->getEntry(c);
+          break;
+        default:
+          continue;
+      }
+
+      *dstPtr = blender(*dstPtr, c, opacity);
+    }
   }
 }
 
@@ -1333,6 +2246,9 @@ void Render::renderCel(
                    int(celBounds.w), int(celBounds.h),
                    area.src.x, area.src.y, area.dst.x, area.dst.y, area.size.w, area.size.h);
 
+  if (m_stats)
+    ++m_stats->cels;
+
   if (cel_layer &&
       cel_image->pixelFormat() == IMAGE_TILEMAP) {
     ASSERT(cel_layer->isTilemap());
@@ -1379,35 +2295,110 @@ void Render::renderCel(
     TRACE_RENDER_CEL("Drawing tilemap (%d %d %d %d)\n",
                      tilesToDraw.x, tilesToDraw.y, tilesToDraw.w, tilesToDraw.h);
 
-    for (int v=tilesToDraw.y; v<tilesToDraw.y2(); ++v) {
-      for (int u=tilesToDraw.x; u<tilesToDraw.x2(); ++u) {
-        auto tileBoundsOnCanvas = grid.tileToCanvas(gfx::Rect(u, v, 1, 1));
-        TRACE_RENDER_CEL(" - tile (%d %d) -> (%d %d %d %d)\n", u, v,
-                         tileBoundsOnCanvas.x, tileBoundsOnCanvas.y,
-                         tileBoundsOnCanvas.w, tileBoundsOnCanvas.h);
-        if (!cel_image->bounds().contains(u, v))
-          continue;
-
-        const tile_t t = cel_image->getPixel(u, v);
-        if (t != doc::notile) {
-          const tile_index i = tile_geti(t);
+    auto renderTiles = [&](const gfx::Rect& tiles) {
+      for (int v=tiles.y; v<tiles.y2(); ++v) {
+        for (int u=tiles.x; u<tiles.x2(); ++u) {
+          auto tileBoundsOnCanvas = grid.tileToCanvas(gfx::Rect(u, v, 1, 1));
+          TRACE_RENDER_CEL(" - tile (%d %d) -> (%d %d %d %d)\n", u, v,
+                           tileBoundsOnCanvas.x, tileBoundsOnCanvas.y,
+                           tileBoundsOnCanvas.w, tileBoundsOnCanvas.h);
+          if (!cel_image->bounds().contains(u, v))
+            continue;
+
+          const tile_t t = cel_image->getPixel(u, v);
+          if (t != doc::notile) {
+            const tile_index i = tile_geti(t);
+
+            if (dst_image->pixelFormat() == IMAGE_TILEMAP) {
+              put_pixel(dst_image, u-area.dst.x, v-area.dst.y, t);
+            }
+            else {
+              const ImageRef tile_image = tileset->get(i);
+              if (!tile_image)
+                continue;
 
-          if (dst_image->pixelFormat() == IMAGE_TILEMAP) {
-            put_pixel(dst_image, u-area.dst.x, v-area.dst.y, t);
+              renderImage(dst_image, tile_image.get(), pal, tileBoundsOnCanvas,
+                          area, compositeImage, opacity, blendMode, tile_getf(t));
+            }
+          }
+        }
+      }
+    };
+
+    // When the tilemap is zoomed out there are a lot of small tiles
+    // in the visible area, so we composite chunks of tiles
+    // pre-rendered in the TilemapCache (which are reduced with the
+    // MipmapCache too). Tiles can be drawn as a chunk only if they
+    // don't overlap (no isometric/hexagonal grids) and the
+    // transparent pixels of the chunk don't modify the destination.
+    const gfx::Size tileSize = grid.tileSize();
+    if (m_tilemapCache &&
+        dst_image->pixelFormat() != IMAGE_TILEMAP &&
+        tileset != m_previewTileset &&
+        blendMode != BlendMode::SRC &&
+        (m_proj.scaleX() < 1.0 || m_proj.scaleY() < 1.0) &&
+        !grid.hasMask() &&
+        grid.tileOffset().x == tileSize.w &&
+        grid.tileOffset().y == tileSize.h &&
+        grid.oddRowOffset() == gfx::Point(0, 0) &&
+        grid.oddColOffset() == gfx::Point(0, 0)) {
+      constexpr int K = TilemapCache::kChunkSize;
+      const int cu1 = tilesToDraw.x / K;
+      const int cv1 = tilesToDraw.y / K;
+      const int cu2 = (tilesToDraw.x2()+K-1) / K;
+      const int cv2 = (tilesToDraw.y2()+K-1) / K;
+
+      for (int cv=cv1; cv<cv2; ++cv) {
+        for (int cu=cu1; cu<cu2; ++cu) {
+          const gfx::Rect chunkTiles =
+            gfx::Rect(cu*K, cv*K, K, K).createIntersection(cel_image->bounds());
+
+          bool cached = false;
+          const ImageRef chunk =
+            m_tilemapCache->getChunk(cel_image, tileset, cu, cv, &cached);
+          if (m_stats)
+            ++(cached ? m_stats->tilemapHits: m_stats->tilemapMisses);
+
+          if (chunk) {
+            renderImage(dst_image, chunk.get(), pal,
+                        grid.tileToCanvas(chunkTiles),
+                        area, compositeImage, opacity, blendMode);
           }
           else {
-            const ImageRef tile_image = tileset->get(i);
-            if (!tile_image)
-              continue;
-
-            renderImage(dst_image, tile_image.get(), pal, tileBoundsOnCanvas,
-                        area, compositeImage, opacity, blendMode, tile_getf(t));
+            renderTiles(chunkTiles.createIntersection(tilesToDraw));
           }
         }
       }
     }
+    else {
+      renderTiles(tilesToDraw);
+    }
   }
   else {
+    // Reference layers are usually big images scaled down in the
+    // canvas, so we use a reduced image of the same size as the
+    // rendered cel (where each pixel is the average of the original
+    // pixels) instead of skipping pixels of the original image.
+    if (cel_layer &&
+        cel_layer->isReference() &&
+        cel_image != m_previewImage &&
+        cel_image != m_extraImage &&
+        m_referenceCache &&
+        dst_image->pixelFormat() == IMAGE_RGB &&
+        cel_image->pixelFormat() == IMAGE_RGB) {
+      const gfx::RectF scaledBounds = m_proj.apply(celBounds);
+      const gfx::Size size(int(std::round(scaledBounds.w)),
+                           int(std::round(scaledBounds.h)));
+
+      const ImageRef scaled = m_referenceCache->getScaled(cel_image, size);
+      if (scaled) {
+        renderImage(dst_image, scaled.get(), pal, celBounds,
+                    area, composite_image_general<RgbTraits, RgbTraits>,
+                    opacity, blendMode);
+        return;
+      }
+    }
+
     renderImage(dst_image, cel_image, pal, celBounds,
                 area, compositeImage, opacity, blendMode);
   }
@@ -1437,19 +2428,66 @@ void Render::renderImage(
       nullptr, tileFlags);
   }
 
+  gfx::ClipF imageArea(
+    double(area.dst.x) + srcBounds.x - double(area.src.x),
+    double(area.dst.y) + srcBounds.y - double(area.src.y),
+    srcBounds.x - scaledBounds.x,
+    srcBounds.y - scaledBounds.y,
+    srcBounds.w,
+    srcBounds.h);
+  double sx = m_proj.scaleX() * celBounds.w / double(cel_image->width());
+  double sy = m_proj.scaleY() * celBounds.h / double(cel_image->height());
+
+  // Use a reduced version of the image to composite it with
+  // composite_image_scale_down() when it's possible. The preview and
+  // extra images are modified in place without changing their
+  // version (e.g. while we draw), so they cannot be cached.
+  ImageRef mipmap;
+  if (m_mipmapCache &&
+      cel_image != m_previewImage &&
+      cel_image != m_extraImage &&
+      sx < 1.0 && sy < 1.0 &&
+      is_scale_down_composition(compositeImage)) {
+    // composite_image_scale_down() takes one of each "step" pixels,
+    // we can use the level "n" if 2^n divides both steps.
+    const int step_w = int(1.0 / sx);
+    const int step_h = int(1.0 / sy);
+    int level = 0;
+    while (level < MipmapCache::kMaxLevel &&
+           (step_w % (2 << level)) == 0 &&
+           (step_h % (2 << level)) == 0)
+      ++level;
+
+    if (level > 0) {
+      bool cached = false;
+      mipmap = m_mipmapCache->getLevel(cel_image, level, &cached);
+      if (m_stats)
+        ++(cached ? m_stats->mipmapHits: m_stats->mipmapMisses);
+    }
+
+    if (mipmap) {
+      // The reduced image can be bigger (rounding up the size) than
+      // the area that composite_image_scale_down() would render
+      // with the original image, so we clip it first.
+      gfx::Clip iarea(imageArea);
+      if (!iarea.clip(dst_image->width(), dst_image->height(),
+                      int(sx*double(cel_image->width())),
+                      int(sy*double(cel_image->height()))))
+        return;
+
+      imageArea = gfx::ClipF(iarea);
+      cel_image = mipmap.get();
+      sx *= (1 << level);
+      sy *= (1 << level);
+    }
+  }
+
   compositeImage(
     dst_image, cel_image, pal,
-    gfx::ClipF(
-      double(area.dst.x) + srcBounds.x - double(area.src.x),
-      double(area.dst.y) + srcBounds.y - double(area.src.y),
-      srcBounds.x - scaledBounds.x,
-      srcBounds.y - scaledBounds.y,
-      srcBounds.w,
-      srcBounds.h),
+    imageArea,
     opacity,
     blendMode,
-    m_proj.scaleX() * celBounds.w / double(cel_image->width()),
-    m_proj.scaleY() * celBounds.h / double(cel_image->height()),
+    sx, sy,
     m_newBlendMethod,
     tileFlags);
 }
@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -20,13 +20,17 @@
 #include "gfx/point.h"
 #include "gfx/size.h"
 #include "render/bg_options.h"
+#include "render/composite_cache.h"
 #include "render/extra_type.h"
 #include "render/onionskin_options.h"
 #include "render/projection.h"
 
+#include <vector>
+
 namespace doc {
   class Cel;
   class Image;
+  class ImageSpec;
   class Layer;
   class Palette;
   class RenderPlan;
@@ -37,6 +41,11 @@ namespace doc {
 namespace render {
   using namespace doc;
 
+  class MipmapCache;
+  class ReferenceCache;
+  class TilemapCache;
+  struct RenderStats;
+
   typedef void (*CompositeImageFunc)(
     Image* dst,
     const Image* src,
@@ -55,6 +64,17 @@ namespace render {
     };
 
   public:
+    // Cached rows of the checkered background pattern, see
+    // renderCheckeredBackground().
+    struct CheckeredRows {
+      PixelFormat pixelFormat = IMAGE_RGB;
+      int tileWidth = 0;
+      color_t color1 = 0;
+      color_t color2 = 0;
+      int width = 0;
+      std::vector<uint8_t> rows[2];
+    };
+
     Render();
 
     void setRefLayersVisiblity(const bool visible);
@@ -64,6 +84,39 @@ namespace render {
     void setBgOptions(const BgOptions& bg);
     void setSelectedLayer(const Layer* layer);
 
+    // Enables the tile-parallel mode: renderSprite() splits the
+    // destination area in bands of rows (small enough to fit in the
+    // CPU cache) and composites each band in the shared thread pool
+    // (see doc::parallel_for()). The result is the same as the serial
+    // path. By default everything is rendered in the caller thread.
+    void setParallel(const bool parallel);
+
+    // Uses the given cache to reuse the composite of layer groups
+    // that didn't change from a previous render (see
+    // CompositeCache). The cache can be shared between several
+    // Render instances. Use nullptr to disable it (the default).
+    void setCompositeCache(CompositeCache* cache);
+
+    // Uses the given cache of reduced images to render zoom levels
+    // smaller than 100% (see MipmapCache). Use nullptr to disable it
+    // (the default).
+    void setMipmapCache(MipmapCache* cache);
+
+    // Uses the given cache of reduced images to render reference
+    // layers scaled down with all their pixels averaged (see
+    // ReferenceCache). Use nullptr to disable it (the default).
+    void setReferenceCache(ReferenceCache* cache);
+
+    // Uses the given cache of pre-rendered chunks of tilemaps to
+    // render zoomed out tilemap layers (see TilemapCache). Use
+    // nullptr to disable it (the default).
+    void setTilemapCache(TilemapCache* cache);
+
+    // Counts the number of composited cels and cache lookups in the
+    // given instance (see RenderStats). Use nullptr to disable it
+    // (the default).
+    void setStats(RenderStats* stats);
+
     // Sets the preview image. This preview image is an alternative
     // image to be used for the given layer/frame.
     void setPreviewImage(const Layer* layer,
@@ -83,6 +136,10 @@ namespace render {
       frame_t currentFrame);
     void removeExtraImage();
 
+    // Parallelogram used to draw the extra image when it's an
+    // ExtraType::TRANSFORM.
+    void setExtraTransform(const ExtraTransform& transform);
+
     void setOnionskin(const OnionskinOptions& options);
     void disableOnionskin();
 
@@ -112,6 +169,19 @@ namespace render {
       frame_t frame,
       const gfx::ClipF& area);
 
+    // Saves in the CompositeCache a snapshot of the whole sprite
+    // (with the current projection) with everything that is drawn
+    // below the given layer: the background layer, the onion skin
+    // behind the sprite, and the transparent layers below it. Used
+    // when a ToolLoop starts, so while the user is drawing in the
+    // given layer renderSprite() copies the exposed area from this
+    // snapshot and only blends the layer (with the extra cel) and
+    // the layers above it.
+    void cacheLayersBelow(
+      const Sprite* sprite,
+      const frame_t frame,
+      const Layer* layer);
+
     // Extra functions
     void renderCheckeredBackground(
       Image* image,
@@ -139,11 +209,62 @@ namespace render {
       const BlendMode blendMode);
 
   private:
+    void renderSpriteArea(
+      Image* dstImage,
+      const Sprite* sprite,
+      frame_t frame,
+      const gfx::ClipF& area);
+
+    bool renderSpriteInTiles(
+      Image* dstImage,
+      const Sprite* sprite,
+      frame_t frame,
+      const gfx::ClipF& area);
+
     void renderSpriteLayers(
       Image* dstImage,
       const gfx::ClipF& area,
       frame_t frame,
-      CompositeImageFunc compositeImage);
+      CompositeImageFunc compositeImage,
+      const color_t bg_color);
+
+    color_t backgroundColor(
+      const PixelFormat dstFormat,
+      const frame_t frame) const;
+
+    // Adds to the key the initial state of the destination image in
+    // renderSpriteLayers() and the state of the onion skin frames
+    // drawn behind the sprite (returns false if the onion skin
+    // contains the extra cel or the preview image).
+    void addBackgroundToKey(
+      const ImageSpec& dstSpec,
+      const CompositeImageFunc compositeImage,
+      const color_t bg_color,
+      CompositeCache::Key& key) const;
+    bool addOnionskinToKey(
+      const frame_t frame,
+      CompositeCache::Key& key);
+
+    // Copies the given area from the snapshot created by
+    // cacheLayersBelow() for the current layer. "below" is the index
+    // of the current layer in the plan.
+    bool restoreLayersBelow(
+      const doc::RenderPlan& plan,
+      Image* dstImage,
+      const gfx::ClipF& area,
+      const frame_t frame,
+      const CompositeImageFunc compositeImage,
+      const color_t bg_color,
+      int& below);
+    bool calcLayersBelowKey(
+      const doc::RenderPlan& plan,
+      const ImageSpec& dstSpec,
+      const frame_t frame,
+      const Layer* layer,
+      const CompositeImageFunc compositeImage,
+      const color_t bg_color,
+      CompositeCache::Key& key,
+      int& below);
 
     void renderBackground(
       Image* image,
@@ -151,6 +272,11 @@ namespace render {
       const color_t bg_color,
       const gfx::ClipF& area);
 
+    void updateCheckeredRows(
+      const PixelFormat pixelFormat,
+      const int tile_w,
+      const int width);
+
     bool isSolidBackground(
       const Layer* bgLayer,
       const color_t bg_color) const;
@@ -161,6 +287,29 @@ namespace render {
       const frame_t frame,
       const CompositeImageFunc compositeImage);
 
+    // Frames of the onion skin to draw for the given frame.
+    struct OnionskinFrame {
+      frame_t frame;
+      int opacity;
+      BlendMode blendMode;
+      bool renderBackground;
+    };
+    std::vector<OnionskinFrame> onionskinFrames(const frame_t frame) const;
+
+    bool renderFlattenedOnionskin(
+      doc::RenderPlan& plan,
+      Image* dstImage,
+      const gfx::Clip& area,
+      const frame_t frame,
+      const bool render_background,
+      const BlendMode blendMode);
+
+    // If "key" is not nullptr, it must contain the initial state of
+    // the "area" of "image" to reuse snapshots from the
+    // CompositeCache. The state of the blended items is added to the
+    // key (or it's cleared if some item cannot be cached). Only the
+    // items in the [begin, end) range of the plan are drawn (end=-1
+    // means the last item).
     void renderPlan(
       doc::RenderPlan& plan,
       Image* image,
@@ -169,7 +318,10 @@ namespace render {
       const CompositeImageFunc compositeImage,
       const bool render_background,
       const bool render_transparent,
-      const BlendMode blendMode);
+      const BlendMode blendMode,
+      CompositeCache::Key* key = nullptr,
+      const int begin = 0,
+      const int end = -1);
 
     void renderCel(
       Image* dst_image,
@@ -183,6 +335,11 @@ namespace render {
       const int opacity,
       const BlendMode blendMode);
 
+    void renderTransformedExtra(
+      Image* dst_image,
+      const Palette* pal,
+      const gfx::Clip& area);
+
     void renderImage(
       Image* dst_image,
       const Image* cel_image,
@@ -202,6 +359,26 @@ namespace render {
 
     bool checkIfWeShouldUsePreview(const Cel* cel) const;
 
+    // Adds the render options and the state of each item of the
+    // plan to the key ("counts[i]" is the size of the key with the
+    // first i items). Returns the number of items that can be
+    // cached (the items before the extra cel or the preview image).
+    int calcCompositeCacheKey(
+      const doc::RenderPlan& plan,
+      const frame_t frame,
+      const bool render_background,
+      const bool render_transparent,
+      const BlendMode blendMode,
+      CompositeCache::Key& key,
+      std::vector<std::size_t>& counts) const;
+
+    // Returns true if the extra cel or the preview image is drawn
+    // with the given layer/cel.
+    bool isVolatileCel(
+      const Layer* layer,
+      const Cel* cel,
+      const frame_t frame) const;
+
     int m_flags;
     int m_nonactiveLayersOpacity;
     const Sprite* m_sprite;
@@ -211,6 +388,7 @@ namespace render {
     ExtraType m_extraType;
     const Cel* m_extraCel;
     const Image* m_extraImage;
+    ExtraTransform m_extraTransform;
     BlendMode m_extraBlendMode;
     bool m_newBlendMethod;
     BgOptions m_bg;
@@ -224,6 +402,13 @@ namespace render {
     BlendMode m_previewBlendMode;
     OnionskinOptions m_onionskin;
     ImageBufferPtr m_tmpBuf;
+    CheckeredRows m_checkeredRows;
+    bool m_parallel;
+    CompositeCache* m_compositeCache;
+    MipmapCache* m_mipmapCache;
+    ReferenceCache* m_referenceCache;
+    TilemapCache* m_tilemapCache;
+    RenderStats* m_stats;
   };
 
   void composite_image(Image* dst,
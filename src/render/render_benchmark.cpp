@@ -1,5 +1,5 @@
 // Aseprite Document Library
-// Copyright (c) 2019-2022 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 //
 // This file is released under the terms of the MIT license.
 // Read LICENSE.txt for more information.
@@ -22,11 +22,8 @@
 using namespace doc;
 using namespace render;
 
-static void Bm_Render(benchmark::State& state)
+static Sprite* make_benchmark_sprite(const int w, const int h)
 {
-  const int w = state.range(0);
-  const int h = state.range(1);
-
   Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
   LayerImage* lay1 = static_cast<LayerImage*>(spr->root()->firstLayer());
   LayerImage* lay2 = new LayerImage(spr);
@@ -50,7 +47,48 @@ static void Bm_Render(benchmark::State& state)
   fill_rect(img1, 32, 32, w-64, h-64, rgba(32, 128, 255, 128));
   fill_rect(img2.get(), 0, 0, w-64, h-64, rgba(255, 100, 32, 128));
   fill_rect(img3.get(), 64, 64, w-64, h-64, rgba(200, 64, 80, 128));
+  return spr;
+}
+
+static void render_benchmark_sprite(Render& render, Image* dst, const Sprite* spr)
+{
+  BgOptions bg;
+  bg.type = BgType::CHECKERED;
+  bg.zoom = true;
+  bg.color1 = rgba(100, 100, 100, 255);
+  bg.color2 = rgba(200, 200, 200, 255);
+  bg.stripeSize = gfx::Size(16, 16);
+  render.setBgOptions(bg);
+  render.renderSprite(
+    dst, spr, frame_t(0),
+    gfx::Clip(0, 0, 0, 0, dst->width(), dst->height()));
+}
+
+static void Bm_Render(benchmark::State& state)
+{
+  const int w = state.range(0);
+  const int h = state.range(1);
+
+  std::unique_ptr<Sprite> spr(make_benchmark_sprite(w, h));
+  std::unique_ptr<Image> dst(Image::create(spr->pixelFormat(), w, h));
+  clear_image(dst.get(), 0);
+
+  while (state.KeepRunning()) {
+    clear_image(dst.get(), 0);
+
+    Render render;
+    render_benchmark_sprite(render, dst.get(), spr.get());
+  }
+}
 
+// Same as Bm_Render but using the tile-parallel mode (with the
+// doc::parallel_for() thread pool).
+static void Bm_RenderParallel(benchmark::State& state)
+{
+  const int w = state.range(0);
+  const int h = state.range(1);
+
+  std::unique_ptr<Sprite> spr(make_benchmark_sprite(w, h));
   std::unique_ptr<Image> dst(Image::create(spr->pixelFormat(), w, h));
   clear_image(dst.get(), 0);
 
@@ -58,16 +96,8 @@ static void Bm_Render(benchmark::State& state)
     clear_image(dst.get(), 0);
 
     Render render;
-    BgOptions bg;
-    bg.type = BgType::CHECKERED;
-    bg.zoom = true;
-    bg.color1 = rgba(100, 100, 100, 255);
-    bg.color2 = rgba(200, 200, 200, 255);
-    bg.stripeSize = gfx::Size(16, 16);
-    render.setBgOptions(bg);
-    render.renderSprite(
-      dst.get(), spr, frame_t(0),
-      gfx::Clip(0, 0, 0, 0, w, h));
+    render.setParallel(true);
+    render_benchmark_sprite(render, dst.get(), spr.get());
   }
 }
 
@@ -79,4 +109,10 @@ BENCHMARK(Bm_Render)
   ->Args({ 4096, 4096 })
   ->Unit(benchmark::kMicrosecond);
 
+BENCHMARK(Bm_RenderParallel)
+  ->Args({ 1024, 1024 })
+  ->Args({ 4096, 4096 })
+  ->Unit(benchmark::kMicrosecond)
+  ->UseRealTime();
+
 BENCHMARK_MAIN();
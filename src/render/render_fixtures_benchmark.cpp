@@ -0,0 +1,234 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+// Parameterized render benchmarks with sprites similar to real
+// documents. Each case is a combination of layers x frames x canvas
+// size x color mode x blend mode mix x zoom, with optional tilemap
+// layers and onion skin.
+//
+// Use the JSON output of Google Benchmark to compare results across
+// commits, e.g.:
+//
+//   render_fixtures_benchmark --benchmark_out=before.json --benchmark_out_format=json
+//   [build a new version]
+//   render_fixtures_benchmark --benchmark_out=after.json --benchmark_out_format=json
+//   compare.py benchmarks before.json after.json
+//
+// (compare.py is in the "tools" directory of Google Benchmark.)
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/render.h"
+
+#include "doc/cel.h"
+#include "doc/grid.h"
+#include "doc/image.h"
+#include "doc/layer.h"
+#include "doc/layer_tilemap.h"
+#include "doc/palette.h"
+#include "doc/primitives.h"
+#include "doc/sprite.h"
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <iterator>
+#include <memory>
+
+using namespace doc;
+using namespace render;
+
+namespace {
+
+// Maximum size of the rendered area (similar to a full screen editor)
+const int kViewportW = 1920;
+const int kViewportH = 1080;
+
+const int kTileSize = 16;
+const int kTilesetSize = 16;
+
+enum Arg {
+  kLayers,
+  kFrames,
+  kCanvasSize,
+  kColorMode,
+  kBlendMix,                    // 0 = all layers normal, 1 = mixed blend modes
+  kZoom,                        // Zoom in percentage (e.g. 25, 100, 400)
+  kTilemap,                     // Number of tilemap layers
+  kOnionskin,                   // Number of onion skin frames (before/after)
+};
+
+const BlendMode kBlendModes[] = {
+  BlendMode::NORMAL,
+  BlendMode::MULTIPLY,
+  BlendMode::SCREEN,
+  BlendMode::OVERLAY,
+  BlendMode::DARKEN,
+  BlendMode::DIFFERENCE,
+  BlendMode::HSL_COLOR,
+  BlendMode::ADDITION,
+};
+
+color_t fixture_color(const PixelFormat format, const int i, const int alpha)
+{
+  switch (format) {
+    case IMAGE_RGB:       return rgba(40*i, 255-30*i, 100+20*i, alpha);
+    case IMAGE_GRAYSCALE: return graya(50+25*i, alpha);
+    case IMAGE_INDEXED:   return 1 + (i % 255);
+  }
+  return 0;
+}
+
+// Creates a sprite with opaque background, "layers" transparent
+// layers with some overlapped rectangles in each frame, and
+// "tilemaps" tilemap layers.
+Sprite* make_fixture_sprite(const benchmark::State& state)
+{
+  const int layers = state.range(kLayers);
+  const int frames = state.range(kFrames);
+  const int size = state.range(kCanvasSize);
+  const auto colorMode = ColorMode(state.range(kColorMode));
+  const bool blendMix = (state.range(kBlendMix) != 0);
+  const int tilemaps = state.range(kTilemap);
+
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(colorMode, size, size), 256);
+  const PixelFormat format = spr->pixelFormat();
+  spr->setTotalFrames(frame_t(frames));
+
+  LayerImage* bg = static_cast<LayerImage*>(spr->root()->firstLayer());
+  for (frame_t f=1; f<frames; ++f)
+    bg->addCel(new Cel(f, ImageRef(Image::create(format, size, size))));
+  for (frame_t f=0; f<frames; ++f)
+    clear_image(bg->cel(f)->image(), fixture_color(format, 0, 255));
+
+  for (int i=0; i<layers; ++i) {
+    LayerImage* lay = new LayerImage(spr);
+    spr->root()->addLayer(lay);
+    if (blendMix)
+      lay->setBlendMode(kBlendModes[i % std::size(kBlendModes)]);
+
+    for (frame_t f=0; f<frames; ++f) {
+      ImageRef img(Image::create(format, size, size));
+      clear_image(img.get(), img->maskColor());
+
+      // Two rectangles that move in each frame
+      const int d = (size / 8) * (((i+f) % 4) + 1);
+      fill_rect(img.get(), d/2, d/3, size-d, size-d/2,
+                fixture_color(format, i+1, 128));
+      fill_rect(img.get(), d, d, size-d/4, size-d/3,
+                fixture_color(format, i+2, 255));
+      lay->addCel(new Cel(f, img));
+    }
+  }
+
+  if (tilemaps > 0) {
+    auto tileset = new Tileset(spr, Grid(gfx::Size(kTileSize, kTileSize)), kTilesetSize);
+    for (tile_index ti=1; ti<kTilesetSize; ++ti) {
+      ImageRef tile = tileset->get(ti);
+      clear_image(tile.get(), tile->maskColor());
+      fill_rect(tile.get(), ti % kTileSize, 0, kTileSize-1, ti,
+                fixture_color(format, ti, 200));
+    }
+    const tileset_index tsi = spr->tilesets()->add(tileset);
+
+    const int cols = (size + kTileSize - 1) / kTileSize;
+    for (int i=0; i<tilemaps; ++i) {
+      auto lay = new LayerTilemap(spr, tsi);
+      spr->root()->addLayer(lay);
+
+      for (frame_t f=0; f<frames; ++f) {
+        ImageRef map(Image::create(IMAGE_TILEMAP, cols, cols));
+        for (int v=0; v<cols; ++v)
+          for (int u=0; u<cols; ++u)
+            put_pixel(map.get(), u, v, tile((u+v+f+i) % kTilesetSize, 0));
+        lay->addCel(new Cel(f, map));
+      }
+    }
+  }
+
+  return spr;
+}
+
+void Bm_RenderFixture(benchmark::State& state)
+{
+  std::unique_ptr<Sprite> spr(make_fixture_sprite(state));
+  const frame_t frames = spr->totalFrames();
+  const int onionskin = state.range(kOnionskin);
+  const Zoom zoom = Zoom::fromScale(state.range(kZoom) / 100.0);
+
+  const int w = std::min(kViewportW, zoom.apply(spr->width()));
+  const int h = std::min(kViewportH, zoom.apply(spr->height()));
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, w, h));
+
+  Render render;
+  BgOptions bg;
+  bg.type = BgType::CHECKERED;
+  bg.zoom = true;
+  bg.color1 = rgba(100, 100, 100, 255);
+  bg.color2 = rgba(200, 200, 200, 255);
+  bg.stripeSize = gfx::Size(16, 16);
+  render.setBgOptions(bg);
+  render.setProjection(Projection(PixelRatio(1, 1), zoom));
+  if (onionskin > 0) {
+    OnionskinOptions opts(OnionskinType::MERGE);
+    opts.prevFrames(onionskin);
+    opts.nextFrames(onionskin);
+    opts.opacityBase(68);
+    opts.opacityStep(28);
+    render.setOnionskin(opts);
+  }
+
+  // Render each frame like an animation playback
+  frame_t frame = 0;
+  for (auto _ : state) {
+    render.renderSprite(dst.get(), spr.get(), frame,
+                        gfx::Clip(0, 0, 0, 0, w, h));
+    frame = (frame+1) % frames;
+  }
+
+  state.counters["pixels"] =
+    benchmark::Counter(double(w) * h, benchmark::Counter::kIsIterationInvariantRate);
+}
+
+// Generates all the combinations of the given values for each argument
+void Fixtures(benchmark::internal::Benchmark* b)
+{
+  b->ArgNames({ "layers", "frames", "size", "mode", "blend", "zoom", "tilemap", "onion" });
+
+  const int rgb = int(ColorMode::RGB);
+  const int gray = int(ColorMode::GRAYSCALE);
+  const int indexed = int(ColorMode::INDEXED);
+
+  // Layers x canvas size x color mode x blend mix x zoom
+  for (int layers : { 1, 16, 64 })
+    for (int size : { 256, 1024, 4096 })
+      for (int mode : { rgb, gray, indexed })
+        for (int blend : { 0, 1 })
+          for (int zoom : { 25, 100, 400 }) {
+            // Avoid fixtures that need too much memory (>512 MB)
+            if (std::size_t(layers) * size * size * 4 > 512*1024*1024)
+              continue;
+            b->Args({ layers, 1, size, mode, blend, zoom, 0, 0 });
+          }
+
+  // Animations with tilemaps and onion skin
+  for (int frames : { 8, 32 })
+    for (int tilemap : { 0, 2 })
+      for (int onion : { 0, 3 })
+        b->Args({ 16, frames, 1024, rgb, 1, 100, tilemap, onion });
+}
+
+} // anonymous namespace
+
+BENCHMARK(Bm_RenderFixture)
+  ->Apply(Fixtures)
+  ->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
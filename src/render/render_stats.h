@@ -0,0 +1,52 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_RENDER_STATS_H_INCLUDED
+#define RENDER_RENDER_STATS_H_INCLUDED
+#pragma once
+
+#include <atomic>
+
+namespace render {
+
+  // Counters of the work done by render::Render (e.g. to show
+  // statistics of each repaint of the Editor). Render copies used to
+  // render bands in parallel share the same instance, so all
+  // counters are atomic.
+  struct RenderStats {
+    // Number of cels composited (each band of a parallel render
+    // counts the cel again)
+    std::atomic<int> cels { 0 };
+
+    // Lookups in the CompositeCache (layer groups and flattened onion
+    // skin frames), the MipmapCache, and the TilemapCache
+    std::atomic<int> compositeHits { 0 };
+    std::atomic<int> compositeMisses { 0 };
+    std::atomic<int> mipmapHits { 0 };
+    std::atomic<int> mipmapMisses { 0 };
+    std::atomic<int> tilemapHits { 0 };
+    std::atomic<int> tilemapMisses { 0 };
+
+    // Textures of images re-used by GPU renderers
+    std::atomic<int> textureHits { 0 };
+    std::atomic<int> textureMisses { 0 };
+
+    void reset() {
+      cels = 0;
+      compositeHits = 0;
+      compositeMisses = 0;
+      mipmapHits = 0;
+      mipmapMisses = 0;
+      tilemapHits = 0;
+      tilemapMisses = 0;
+      textureHits = 0;
+      textureMisses = 0;
+    }
+  };
+
+} // namespace render
+
+#endif
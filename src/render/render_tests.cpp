@@ -1,5 +1,5 @@
 // Aseprite Render Library
-// Copyright (c) 2019-2023 Igara Studio S.A.
+// Copyright (c) 2019-2026 Igara Studio S.A.
 // Copyright (c) 2001-2018 David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -13,13 +13,24 @@
 
 #include "render/render.h"
 
+#include "doc/blend_funcs.h"
 #include "doc/cel.h"
 #include "doc/document.h"
 #include "doc/image.h"
 #include "doc/layer.h"
+#include "doc/layer_tilemap.h"
 #include "doc/palette.h"
 #include "doc/primitives.h"
-
+#include "doc/tileset.h"
+#include "doc/tilesets.h"
+#include "render/composite_cache.h"
+#include "render/get_sprite_pixel.h"
+#include "render/mipmap_cache.h"
+#include "render/reference_cache.h"
+#include "render/render_stats.h"
+#include "render/tilemap_cache.h"
+
+#include <cstdlib>
 #include <memory>
 
 using namespace doc;
@@ -185,6 +196,46 @@ TEST(Render, CheckeredBackground)
     2, 2, 1, 1);
 }
 
+TEST(Render, CheckeredBackgroundWithOffsets)
+{
+  const color_t color1 = rgba(255, 255, 255, 255);
+  const color_t color2 = rgba(128, 128, 128, 255);
+
+  Render render;
+  BgOptions bg;
+  bg.type = BgType::CHECKERED;
+  bg.zoom = false;
+  bg.colorPixelFormat = IMAGE_RGB;
+  bg.color1 = color1;
+  bg.color2 = color2;
+
+  for (const int tile : { 1, 3, 8 }) {
+    bg.stripeSize = gfx::Size(tile, tile);
+    render.setBgOptions(bg);
+
+    // Different widths to test the cached pattern when it grows
+    for (const int w : { 5, 33, 70 }) {
+      const int h = 9;
+      std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, w, h));
+      for (const gfx::Point src : { gfx::Point(0, 0), gfx::Point(5, 2), gfx::Point(17, 11) }) {
+        clear_image(dst.get(), 0);
+        render.renderCheckeredBackground(dst.get(), gfx::Clip(0, 0, src.x, src.y, w, h));
+
+        for (int y=0; y<h; ++y) {
+          for (int x=0; x<w; ++x) {
+            const color_t expected =
+              ((((src.x+x) / tile) + ((src.y+y) / tile)) & 1 ? color2: color1);
+            ASSERT_EQ(expected, get_pixel(dst.get(), x, y))
+              << " tile=" << tile << " w=" << w
+              << " src=" << src.x << "," << src.y
+              << " x=" << x << " y=" << y;
+          }
+        }
+      }
+    }
+  }
+}
+
 TEST(Render, ZoomAndDstBounds)
 {
   // Create this image:
@@ -277,8 +328,551 @@ TEST(Render, BugWithMultiplesOf3ZoomFactors)
   }
 }
 
+TEST(Render, TileParallelMatchesSerial)
+{
+  const int w = 1024;
+  const int h = 300;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
+  doc->sprites().add(spr);
+
+  Image* img1 = spr->root()->firstLayer()->cel(0)->image();
+  clear_image(img1, 0);
+  draw_line(img1, 0, 0, w-1, h-1, rgba(255, 0, 0, 255));
+  fill_rect(img1, 32, 32, w-64, h-64, rgba(32, 128, 255, 128));
+
+  LayerImage* lay2 = new LayerImage(spr);
+  spr->root()->addLayer(lay2);
+  ImageRef img2(Image::create(IMAGE_RGB, w, h));
+  clear_image(img2.get(), 0);
+  fill_rect(img2.get(), 0, 64, w-64, h-1, rgba(255, 100, 32, 200));
+  lay2->addCel(new Cel(frame_t(0), img2));
+  lay2->setBlendMode(BlendMode::MULTIPLY);
+
+  for (int zoom : { 1, 2, 3 }) {
+    std::unique_ptr<Image> serial(Image::create(IMAGE_RGB, w*zoom, h*zoom));
+    std::unique_ptr<Image> parallel(Image::create(IMAGE_RGB, w*zoom, h*zoom));
+    clear_image(serial.get(), 0);
+    clear_image(parallel.get(), 0);
+
+    Render render;
+    BgOptions bg;
+    bg.type = BgType::CHECKERED;
+    bg.zoom = true;
+    bg.colorPixelFormat = IMAGE_RGB;
+    bg.color1 = rgba(128, 128, 128, 255);
+    bg.color2 = rgba(64, 64, 64, 255);
+    bg.stripeSize = gfx::Size(16, 16);
+    render.setBgOptions(bg);
+    render.setProjection(Projection(PixelRatio(1, 1), Zoom(zoom, 1)));
+
+    const gfx::Clip area(0, 0, 3, 5, w*zoom-7, h*zoom-3);
+    render.renderSprite(serial.get(), spr, frame_t(0), area);
+    render.setParallel(true);
+    render.renderSprite(parallel.get(), spr, frame_t(0), area);
+
+    EXPECT_TRUE(is_same_image(serial.get(), parallel.get()))
+      << " zoom=" << zoom;
+  }
+}
+
+TEST(Render, RgbaNormalFastPathMatchesBlender)
+{
+  const int w = 37;             // Not a multiple of 4 to test the tail
+  const int h = 5;
+  std::unique_ptr<Image> src(Image::create(IMAGE_RGB, w, h));
+  std::unique_ptr<Image> bg(Image::create(IMAGE_RGB, w, h));
+  for (int y=0; y<h; ++y) {
+    for (int x=0; x<w; ++x) {
+      // Include some fully transparent/opaque pixels
+      int a = std::rand() % 4;
+      a = (a == 0 ? 0: a == 1 ? 255: std::rand() % 256);
+      put_pixel(src.get(), x, y, rgba(std::rand() % 256, std::rand() % 256,
+                                       std::rand() % 256, a));
+      a = std::rand() % 4;
+      a = (a == 0 ? 0: a == 1 ? 255: std::rand() % 256);
+      put_pixel(bg.get(), x, y, rgba(std::rand() % 256, std::rand() % 256,
+                                      std::rand() % 256, a));
+    }
+  }
+  put_pixel(src.get(), 3, 2, src->maskColor());
+
+  for (int zoom : { 1, 2, 3 }) {
+    for (int opacity : { 255, 128, 1 }) {
+      std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, w*zoom, h*zoom));
+      for (int y=0; y<dst->height(); ++y)
+        for (int x=0; x<dst->width(); ++x)
+          put_pixel(dst.get(), x, y, get_pixel(bg.get(), x/zoom, y/zoom));
+
+      Render render;
+      render.setProjection(Projection(PixelRatio(1, 1), Zoom(zoom, 1)));
+      render.renderImage(dst.get(), src.get(), nullptr, 0, 0,
+                         opacity, BlendMode::NORMAL);
+
+      for (int y=0; y<dst->height(); ++y) {
+        for (int x=0; x<dst->width(); ++x) {
+          const color_t s = get_pixel(src.get(), x/zoom, y/zoom);
+          const color_t b = get_pixel(bg.get(), x/zoom, y/zoom);
+          const color_t expected =
+            (s == src->maskColor() ? b: rgba_blender_normal(b, s, opacity));
+          EXPECT_EQ(expected, get_pixel(dst.get(), x, y))
+            << " zoom=" << zoom << " opacity=" << opacity
+            << " x=" << x << " y=" << y;
+        }
+      }
+    }
+  }
+}
+
+TEST(Render, CompositeCacheMatchesUncached)
+{
+  const int w = 64;
+  const int h = 48;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
+  doc->sprites().add(spr);
+
+  Image* img1 = spr->root()->firstLayer()->cel(0)->image();
+  clear_image(img1, 0);
+  fill_rect(img1, 4, 4, w-8, h-8, rgba(32, 128, 255, 128));
+
+  // Group with two layers + one layer at the top
+  LayerGroup* group = new LayerGroup(spr);
+  spr->root()->addLayer(group);
+  ImageRef imgs[3];
+  for (int i=0; i<3; ++i) {
+    LayerImage* lay = new LayerImage(spr);
+    if (i < 2)
+      group->addLayer(lay);
+    else
+      spr->root()->addLayer(lay);
+    imgs[i].reset(Image::create(IMAGE_RGB, w, h));
+    clear_image(imgs[i].get(), 0);
+    fill_rect(imgs[i].get(), 8*i, 4*i, w/2, h/2, rgba(255, 50*i, 32, 200));
+    lay->addCel(new Cel(frame_t(0), imgs[i]));
+    lay->setBlendMode(i == 1 ? BlendMode::MULTIPLY: BlendMode::NORMAL);
+  }
+
+  CompositeCache cache(16*1024*1024);
+  const gfx::Clip area(0, 0, 0, 0, w, h);
+  auto check = [&]{
+    std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, w, h));
+    std::unique_ptr<Image> result(Image::create(IMAGE_RGB, w, h));
+    Render render;
+    render.renderSprite(expected.get(), spr, frame_t(0), area);
+    render.setCompositeCache(&cache);
+    for (int i=0; i<2; ++i) {
+      clear_image(result.get(), 0);
+      render.renderSprite(result.get(), spr, frame_t(0), area);
+      EXPECT_TRUE(is_same_image(expected.get(), result.get()));
+    }
+  };
+
+  check();
+  EXPECT_LT(0u, cache.memoryUsage());
+
+  // Modify a layer inside the group and the top layer
+  for (int i : { 0, 2 }) {
+    fill_rect(imgs[i].get(), 0, 0, 8, 8, rgba(0, 255, 0, 255));
+    imgs[i]->incrementVersion();
+    check();
+  }
+
+  cache.clear();
+  EXPECT_EQ(0u, cache.memoryUsage());
+}
+
+TEST(Render, CompositeCacheBelowCurrentLayer)
+{
+  const int w = 32;
+  const int h = 32;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
+  doc->sprites().add(spr);
+  clear_image(spr->root()->firstLayer()->cel(0)->image(), rgba(0, 0, 255, 255));
+
+  LayerImage* layers[4];
+  for (int i=0; i<4; ++i) {
+    layers[i] = new LayerImage(spr);
+    spr->root()->addLayer(layers[i]);
+    ImageRef img(Image::create(IMAGE_RGB, w, h));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(), 4*i, 4*i, w/2, h/2, rgba(60*i, 255, 32, 160));
+    layers[i]->addCel(new Cel(frame_t(0), img));
+    layers[i]->setBlendMode(i == 3 ? BlendMode::SCREEN: BlendMode::NORMAL);
+  }
+
+  // Extra cel like the one used by the ToolLoop while drawing
+  ImageRef extraImage(Image::create(IMAGE_RGB, 8, 8));
+  Cel extraCel(frame_t(0), extraImage);
+  extraCel.setPosition(10, 10);
+
+  // Snapshot created when the ToolLoop starts
+  CompositeCache cache(16*1024*1024);
+  {
+    Render render;
+    render.setCompositeCache(&cache);
+    render.cacheLayersBelow(spr, frame_t(0), layers[2]);
+  }
+  EXPECT_LT(0u, cache.memoryUsage());
+
+  RenderStats stats;
+  std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, w, h));
+  std::unique_ptr<Image> result(Image::create(IMAGE_RGB, w, h));
+
+  for (int i=0; i<3; ++i) {
+    // Each "mouse movement" modifies the extra image
+    clear_image(extraImage.get(), rgba(255, 40*i, 0, 100+50*i));
+
+    // Whole sprite and a sub-area
+    for (const gfx::Clip& area : { gfx::Clip(0, 0, 0, 0, w, h),
+                                   gfx::Clip(2, 3, 8+i, 6, 12, 10) }) {
+      clear_image(expected.get(), 0);
+      clear_image(result.get(), 0);
+
+      Render render;
+      render.setExtraImage(ExtraType::COMPOSITE, &extraCel, extraImage.get(),
+                           BlendMode::NORMAL, layers[2], frame_t(0));
+      render.renderSprite(expected.get(), spr, frame_t(0), area);
+      render.setCompositeCache(&cache);
+      render.setStats(&stats);
+      render.renderSprite(result.get(), spr, frame_t(0), area);
+      EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " i=" << i;
+    }
+  }
+  EXPECT_EQ(6, stats.compositeHits);
+
+  // Modifying a layer below the current one invalidates the snapshot
+  fill_rect(layers[0]->cel(0)->image(), 0, 0, 4, 4, rgba(0, 0, 0, 255));
+  layers[0]->cel(0)->image()->incrementVersion();
+  {
+    Render render;
+    render.setExtraImage(ExtraType::COMPOSITE, &extraCel, extraImage.get(),
+                         BlendMode::NORMAL, layers[2], frame_t(0));
+    render.renderSprite(expected.get(), spr, frame_t(0));
+    render.setCompositeCache(&cache);
+    render.setStats(&stats);
+    render.renderSprite(result.get(), spr, frame_t(0));
+    EXPECT_TRUE(is_same_image(expected.get(), result.get()));
+  }
+  EXPECT_EQ(6, stats.compositeHits);
+}
+
+TEST(Render, MipmapCacheMatchesFullResolution)
+{
+  const int w = 203;            // Sizes that are not multiple of 2
+  const int h = 155;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
+  doc->sprites().add(spr);
+
+  Image* img = spr->root()->firstLayer()->cel(0)->image();
+  for (int y=0; y<h; ++y)
+    for (int x=0; x<w; ++x)
+      put_pixel(img, x, y, rgba(std::rand() % 256, std::rand() % 256,
+                                std::rand() % 256, 255));
+
+  MipmapCache cache(16*1024*1024);
+  for (int modification=0; modification<2; ++modification) {
+    for (int den : { 2, 3, 4, 6, 8, 12, 16, 32 }) {
+      const Zoom zoom(1, den);
+      const int zw = zoom.apply(w);
+      const int zh = zoom.apply(h);
+      std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, zw, zh));
+      std::unique_ptr<Image> result(Image::create(IMAGE_RGB, zw, zh));
+      clear_image(expected.get(), 0);
+      clear_image(result.get(), 0);
+
+      Render render;
+      render.setProjection(Projection(PixelRatio(1, 1), zoom));
+      render.renderSprite(expected.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, zw, zh));
+      render.setMipmapCache(&cache);
+      render.renderSprite(result.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, zw, zh));
+
+      EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " zoom=1/" << den;
+    }
+    EXPECT_LT(0u, cache.memoryUsage());
+
+    // The cached levels must be discarded when the image changes
+    fill_rect(img, 0, 0, w/2, h/2, rgba(255, 0, 0, 255));
+    img->incrementVersion();
+  }
+}
+
+TEST(Render, MipmapCacheIgnoresPreviewImage)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 8, 8));
+  doc->sprites().add(spr);
+  Layer* lay = spr->root()->firstLayer();
+
+  // The preview image is modified in place (without changing its
+  // version) like the destination image of a ToolLoop
+  std::unique_ptr<Image> preview(Image::create(IMAGE_RGB, 8, 8));
+  clear_image(preview.get(), rgba(255, 0, 0, 255));
+
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
+  MipmapCache cache(1024*1024);
+  Render render;
+  render.setProjection(Projection(PixelRatio(1, 1), Zoom(1, 4)));
+  render.setMipmapCache(&cache);
+  render.setPreviewImage(lay, frame_t(0), preview.get(), nullptr,
+                         gfx::Point(0, 0), BlendMode::SRC);
+
+  const color_t r = rgba(255, 0, 0, 255);
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, 2, 2));
+  EXPECT_2X2_PIXELS(dst.get(), r, r, r, r);
+
+  const color_t b = rgba(0, 0, 255, 255);
+  const ObjectVersion version = preview->version();
+  clear_image(preview.get(), b);
+  ASSERT_EQ(version, preview->version());
+
+  clear_image(dst.get(), 0);
+  render.renderSprite(dst.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, 2, 2));
+  EXPECT_2X2_PIXELS(dst.get(), b, b, b, b);
+  EXPECT_EQ(0u, cache.memoryUsage());
+}
+
+TEST(Render, ReferenceCacheAveragesPixels)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 4, 4));
+  doc->sprites().add(spr);
+
+  Layer* lay = spr->root()->firstLayer();
+  lay->setReference(true);
+
+  // Checkered pattern of black and white pixels
+  Image* img = lay->cel(0)->image();
+  for (int y=0; y<4; ++y)
+    for (int x=0; x<4; ++x)
+      put_pixel(img, x, y, ((x+y) & 1) ? rgba(255, 255, 255, 255):
+                                         rgba(0, 0, 0, 255));
+
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 2, 2));
+  clear_image(dst.get(), 0);
+
+  ReferenceCache cache(1024*1024);
+  Render render;
+  render.setRefLayersVisiblity(true);
+  render.setProjection(Projection(PixelRatio(1, 1), Zoom(1, 2)));
+  render.setReferenceCache(&cache);
+  render.renderSprite(dst.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, 2, 2));
+
+  const color_t gray = rgba(128, 128, 128, 255);
+  EXPECT_2X2_PIXELS(dst.get(), gray, gray, gray, gray);
+  EXPECT_LT(0u, cache.memoryUsage());
+
+  // The reduced image is created again when the image changes
+  fill_rect(img, 0, 0, 1, 1, rgba(255, 0, 0, 255));
+  img->incrementVersion();
+
+  bool cached = true;
+  ImageRef scaled = cache.getScaled(img, gfx::Size(2, 2), &cached);
+  ASSERT_TRUE(scaled);
+  EXPECT_FALSE(cached);
+  EXPECT_EQ(rgba(255, 0, 0, 255), get_pixel(scaled.get(), 0, 0));
+  EXPECT_EQ(gray, get_pixel(scaled.get(), 1, 1));
+
+  // Only reductions are cached
+  EXPECT_FALSE(cache.getScaled(img, gfx::Size(4, 4)));
+}
+
+TEST(Render, TilemapCacheMatchesTiles)
+{
+  // 40x30 tiles of 8x8 pixels (chunks in the right/bottom edges are
+  // clipped)
+  const int tw = 40;
+  const int th = 30;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, tw*8, th*8));
+  doc->sprites().add(spr);
+
+  Tileset* tileset = new Tileset(spr, Grid::MakeRect(gfx::Size(8, 8)), 4);
+  for (tile_index ti=1; ti<tileset->size(); ++ti) {
+    Image* tile = tileset->get(ti).get();
+    for (int y=0; y<8; ++y)
+      for (int x=0; x<8; ++x)
+        put_pixel(tile, x, y, rgba(std::rand() % 256, std::rand() % 256,
+                                   std::rand() % 256, std::rand() % 2 ? 255: 0));
+  }
+  const tileset_index tsi = spr->tilesets()->add(tileset);
+
+  LayerTilemap* layer = new LayerTilemap(spr, tsi);
+  spr->root()->addLayer(layer);
+  ImageRef tilemap(Image::create(IMAGE_TILEMAP, tw, th));
+  for (int v=0; v<th; ++v)
+    for (int u=0; u<tw; ++u)
+      put_pixel(tilemap.get(), u, v, std::rand() % 4 == 0 ? notile:
+                                     tile(1 + std::rand() % 3, 0));
+  layer->addCel(new Cel(frame_t(0), tilemap));
+
+  TilemapCache cache(16*1024*1024);
+  for (int modification=0; modification<2; ++modification) {
+    for (int den : { 2, 4, 8 }) {
+      const Zoom zoom(1, den);
+      const int zw = zoom.apply(tw*8);
+      const int zh = zoom.apply(th*8);
+      std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, zw, zh));
+      std::unique_ptr<Image> result(Image::create(IMAGE_RGB, zw, zh));
+      clear_image(expected.get(), 0);
+      clear_image(result.get(), 0);
+
+      Render render;
+      render.setProjection(Projection(PixelRatio(1, 1), zoom));
+      render.renderSprite(expected.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, zw, zh));
+      render.setTilemapCache(&cache);
+      render.renderSprite(result.get(), spr, frame_t(0), gfx::Clip(0, 0, 0, 0, zw, zh));
+
+      EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " zoom=1/" << den;
+    }
+    EXPECT_LT(0u, cache.memoryUsage());
+
+    // Chunks must be re-created when a tile image changes (even if
+    // the tilemap doesn't change)
+    Image* tile = tileset->get(2).get();
+    fill_rect(tile, 0, 0, 3, 3, rgba(255, 0, 0, 255));
+    tile->incrementVersion();
+  }
+}
+
+TEST(Render, OnionskinWithCompositeCache)
+{
+  const int w = 32;
+  const int h = 24;
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, w, h));
+  doc->sprites().add(spr);
+  spr->setTotalFrames(frame_t(5));
+
+  // One transparent layer (with one layer, flattening each onion skin
+  // frame gives the same result as blending the layer directly)
+  LayerImage* lay = new LayerImage(spr);
+  spr->root()->addLayer(lay);
+  for (frame_t f=0; f<spr->totalFrames(); ++f) {
+    ImageRef img(Image::create(IMAGE_RGB, w, h));
+    clear_image(img.get(), 0);
+    fill_rect(img.get(), 4*f, 2*f, 4*f+8, 2*f+8, rgba(255, 40*f, 0, 255));
+    lay->addCel(new Cel(f, img));
+  }
+  spr->root()->firstLayer()->setVisible(false);
+
+  CompositeCache cache(16*1024*1024);
+  std::unique_ptr<Image> expected(Image::create(IMAGE_RGB, w, h));
+  std::unique_ptr<Image> result(Image::create(IMAGE_RGB, w, h));
+
+  for (auto type : { OnionskinType::MERGE, OnionskinType::RED_BLUE_TINT }) {
+    OnionskinOptions onionskin(type);
+    onionskin.prevFrames(2);
+    onionskin.nextFrames(2);
+    onionskin.opacityBase(128);
+    onionskin.opacityStep(32);
+
+    // Scrub all frames two times (the second time all onion skin
+    // frames come from the cache)
+    for (int i=0; i<2; ++i) {
+      for (frame_t f=0; f<spr->totalFrames(); ++f) {
+        Render render;
+        render.setOnionskin(onionskin);
+        render.renderSprite(expected.get(), spr, f);
+        render.setCompositeCache(&cache);
+        render.renderSprite(result.get(), spr, f);
+        EXPECT_TRUE(is_same_image(expected.get(), result.get())) << " frame=" << f;
+      }
+    }
+  }
+  EXPECT_LT(0u, cache.memoryUsage());
+}
+
 int main(int argc, char** argv)
 {
   ::testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();
 }
+
+TEST(Render, ExtraTransform)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  Sprite* spr = Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 4, 4));
+  doc->sprites().add(spr);
+  Layer* layer = spr->root()->firstLayer();
+  clear_image(layer->cel(0)->image(), 0);
+
+  const color_t a = rgba(255, 0, 0, 255);
+  const color_t b = rgba(0, 0, 255, 255);
+  ImageRef extraImage(Image::create(IMAGE_RGB, 2, 1));
+  put_pixel(extraImage.get(), 0, 0, a);
+  put_pixel(extraImage.get(), 1, 0, b);
+  extraImage->setMaskColor(0);
+
+  // Scale the 2x1 image to 4x2 in (0, 1)
+  Cel extraCel(frame_t(0), ImageRef(nullptr));
+  extraCel.setBounds(gfx::Rect(0, 1, 4, 2));
+  ExtraTransform transform;
+  transform.leftTop = gfx::PointF(0, 1);
+  transform.rightTop = gfx::PointF(4, 1);
+  transform.leftBottom = gfx::PointF(0, 3);
+
+  Render render;
+  render.setExtraImage(ExtraType::TRANSFORM, &extraCel, extraImage.get(),
+                       BlendMode::NORMAL, layer, frame_t(0));
+  render.setExtraTransform(transform);
+
+  std::unique_ptr<Image> dst(Image::create(IMAGE_RGB, 4, 4));
+  render.renderSprite(dst.get(), spr, frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
+                    0, 0, 0, 0,
+                    a, a, b, b,
+                    a, a, b, b,
+                    0, 0, 0, 0);
+
+  // Only the selected pixels are drawn
+  ImageRef mask(Image::create(IMAGE_BITMAP, 2, 1));
+  clear_image(mask.get(), 0);
+  put_pixel(mask.get(), 1, 0, 1);
+  transform.mask = mask.get();
+  render.setExtraTransform(transform);
+
+  render.renderSprite(dst.get(), spr, frame_t(0));
+  EXPECT_4X4_PIXELS(dst.get(),
+                    0, 0, 0, 0,
+                    0, 0, b, b,
+                    0, 0, b, b,
+                    0, 0, 0, 0);
+}
+
+TEST(Render, SpritePixelSamplerMatchesGetSpritePixel)
+{
+  std::shared_ptr<Document> doc = std::make_shared<Document>();
+  doc->sprites().add(Sprite::MakeStdSprite(ImageSpec(ColorMode::RGB, 100, 70)));
+  Sprite* spr = doc->sprite();
+  LayerImage* lay = static_cast<LayerImage*>(spr->root()->firstLayer());
+  Image* src = lay->cel(0)->image();
+  for (int y=0; y<src->height(); ++y)
+    for (int x=0; x<src->width(); ++x)
+      put_pixel(src, x, y, rgba(x*2, y*3, 0, (x+y) & 1 ? 255: 128));
+
+  const Projection proj(PixelRatio(1, 1), Zoom(4, 1));
+
+  SpritePixelSampler sampler;
+  for (double y=0.5; y<spr->height(); y+=3.0)
+    for (double x=0.5; x<spr->width(); x+=5.0)
+      EXPECT_EQ(get_sprite_pixel(spr, x, y, 0, proj, false),
+                sampler.getPixel(spr, x, y, 0, proj, false));
+
+  // Out of the sprite bounds
+  EXPECT_EQ(0, sampler.getPixel(spr, -1.0, 0.0, 0, proj, false));
+  EXPECT_EQ(0, sampler.getPixel(spr, 0.0, 70.0, 0, proj, false));
+
+  // The cached block is rendered again when the image is modified
+  EXPECT_EQ(rgba(2, 3, 0, 128), sampler.getPixel(spr, 1.5, 1.5, 0, proj, false));
+  put_pixel(src, 1, 1, rgba(255, 0, 0, 255));
+  src->incrementVersion();
+  EXPECT_EQ(rgba(255, 0, 0, 255), sampler.getPixel(spr, 1.5, 1.5, 0, proj, false));
+
+  // Or when the layer is hidden
+  lay->setVisible(false);
+  EXPECT_EQ(0, sampler.getPixel(spr, 1.5, 1.5, 0, proj, false));
+}
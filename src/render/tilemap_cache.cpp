@@ -0,0 +1,248 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "render/tilemap_cache.h"
+
+#include "base/debug.h"
+#include "doc/image.h"
+#include "doc/image_traits.h"
+#include "doc/primitives.h"
+#include "doc/tile.h"
+#include "doc/tileset.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iterator>
+#include <utility>
+
+namespace render {
+
+namespace {
+
+uint64_t mix_hash(uint64_t h, const uint64_t value)
+{
+  h ^= value + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+  return h;
+}
+
+// Copies the "tile" image to the (x0, y0) position of "dst" with the
+// given flip flags, using the same mapping of pixels used by
+// composite_image_general_with_tile_flags().
+template<typename ImageTraits>
+void copy_tile(doc::Image* dst, const doc::Image* tile,
+               const int x0, const int y0,
+               const doc::tile_flags flags)
+{
+  using pixel_t = typename ImageTraits::pixel_t;
+  const int w = tile->width();
+  const int h = tile->height();
+
+  if (!flags) {
+    for (int y=0; y<h; ++y)
+      std::memcpy(dst->getPixelAddress(x0, y0+y),
+                  tile->getPixelAddress(0, y),
+                  sizeof(pixel_t) * w);
+    return;
+  }
+
+  for (int y=0; y<h; ++y) {
+    pixel_t* d = (pixel_t*)dst->getPixelAddress(x0, y0+y);
+    for (int x=0; x<w; ++x, ++d) {
+      int srcX = (flags & doc::tile_f_xflip ? w-1-x: x);
+      int srcY = (flags & doc::tile_f_yflip ? h-1-y: y);
+      if (flags & doc::tile_f_dflip)
+        std::swap(srcX, srcY);
+      *d = *(const pixel_t*)tile->getPixelAddress(srcX, srcY);
+    }
+  }
+}
+
+bool copy_tile(doc::Image* dst, const doc::Image* tile,
+               const int x0, const int y0,
+               const doc::tile_flags flags)
+{
+  switch (dst->pixelFormat()) {
+    case doc::IMAGE_RGB:       copy_tile<doc::RgbTraits>(dst, tile, x0, y0, flags); return true;
+    case doc::IMAGE_GRAYSCALE: copy_tile<doc::GrayscaleTraits>(dst, tile, x0, y0, flags); return true;
+    case doc::IMAGE_INDEXED:   copy_tile<doc::IndexedTraits>(dst, tile, x0, y0, flags); return true;
+  }
+  return false;
+}
+
+// Returns a hash of the IDs/versions of the tiles in the given
+// rectangle of the tilemap, so a chunk is re-created when a tile
+// image is modified (tile images can be modified without changing
+// the version of the tilemap or the tileset).
+uint64_t calc_tiles_version(const doc::Image* tilemap,
+                            const doc::Tileset* tileset,
+                            const gfx::Rect& rc)
+{
+  uint64_t h = 0;
+  for (int v=rc.y; v<rc.y2(); ++v) {
+    const doc::tile_t* p =
+      (const doc::tile_t*)tilemap->getPixelAddress(rc.x, v);
+    for (int u=rc.x; u<rc.x2(); ++u, ++p) {
+      if (*p == doc::notile)
+        continue;
+      const doc::ImageRef tile = tileset->get(doc::tile_geti(*p));
+      if (tile)
+        h = mix_hash(mix_hash(h, tile->id()), tile->version());
+    }
+  }
+  return h;
+}
+
+// Creates the image of the given rectangle of tiles, or returns
+// nullptr if some tile cannot be copied.
+doc::Image* create_chunk(const doc::Image* tilemap,
+                         const doc::Tileset* tileset,
+                         const gfx::Rect& rc)
+{
+  const gfx::Size tileSize = tileset->grid().tileSize();
+  doc::Image* chunk = nullptr;
+
+  for (int v=rc.y; v<rc.y2(); ++v) {
+    const doc::tile_t* p =
+      (const doc::tile_t*)tilemap->getPixelAddress(rc.x, v);
+    for (int u=rc.x; u<rc.x2(); ++u, ++p) {
+      if (*p == doc::notile)
+        continue;
+
+      const doc::ImageRef tile = tileset->get(doc::tile_geti(*p));
+      if (!tile)
+        continue;
+
+      const doc::tile_flags flags = doc::tile_getf(*p);
+      if (tile->size() != tileSize ||
+          ((flags & doc::tile_f_dflip) && tileSize.w != tileSize.h) ||
+          (chunk && chunk->pixelFormat() != tile->pixelFormat())) {
+        delete chunk;
+        return nullptr;
+      }
+
+      if (!chunk) {
+        doc::ImageSpec spec = tile->spec();
+        spec.setSize(rc.w * tileSize.w,
+                     rc.h * tileSize.h);
+        chunk = doc::Image::create(spec);
+        doc::clear_image(chunk, spec.maskColor());
+      }
+
+      if (!copy_tile(chunk, tile.get(),
+                     (u-rc.x) * tileSize.w,
+                     (v-rc.y) * tileSize.h, flags)) {
+        delete chunk;
+        return nullptr;
+      }
+    }
+  }
+  return chunk;
+}
+
+std::size_t image_size(const doc::Image* image)
+{
+  return std::size_t(image->rowBytes()) * image->height();
+}
+
+} // anonymous namespace
+
+TilemapCache::TilemapCache(const std::size_t maxMemory)
+  : m_maxMemory(maxMemory)
+  , m_memoryUsage(0)
+{
+}
+
+std::size_t TilemapCache::maxMemory() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_maxMemory;
+}
+
+std::size_t TilemapCache::memoryUsage() const
+{
+  const std::lock_guard lock(m_mutex);
+  return m_memoryUsage;
+}
+
+void TilemapCache::setMaxMemory(const std::size_t maxMemory)
+{
+  const std::lock_guard lock(m_mutex);
+  m_maxMemory = maxMemory;
+  shrink();
+}
+
+doc::ImageRef TilemapCache::getChunk(const doc::Image* tilemap,
+                                     const doc::Tileset* tileset,
+                                     const int u, const int v,
+                                     bool* cached)
+{
+  ASSERT(tilemap->pixelFormat() == doc::IMAGE_TILEMAP);
+
+  const gfx::Rect rc = gfx::Rect(u*kChunkSize, v*kChunkSize,
+                                 kChunkSize, kChunkSize)
+    .createIntersection(tilemap->bounds());
+  if (rc.isEmpty())
+    return nullptr;
+
+  const Key key(tilemap->id(), tileset->id(), u, v);
+  const uint64_t tilesVersion = calc_tiles_version(tilemap, tileset, rc);
+  const std::lock_guard lock(m_mutex);
+
+  auto it = m_map.find(key);
+  if (it != m_map.end()) {
+    if (it->second->tilemapVersion == tilemap->version() &&
+        it->second->tilesVersion == tilesVersion) {
+      // Move the entry to the front (most recently used)
+      m_entries.splice(m_entries.begin(), m_entries, it->second);
+      if (cached)
+        *cached = true;
+      return it->second->image;
+    }
+    removeEntry(it->second);
+  }
+
+  if (cached)
+    *cached = false;
+
+  doc::ImageRef image(create_chunk(tilemap, tileset, rc));
+  if (!image)
+    return nullptr;
+
+  const std::size_t size = image_size(image.get());
+  m_entries.push_front(Entry{ key, tilemap->version(), tilesVersion, image, size });
+  m_map[key] = m_entries.begin();
+  m_memoryUsage += size;
+
+  shrink();
+  return image;
+}
+
+void TilemapCache::clear()
+{
+  const std::lock_guard lock(m_mutex);
+  m_entries.clear();
+  m_map.clear();
+  m_memoryUsage = 0;
+}
+
+void TilemapCache::removeEntry(Entries::iterator it)
+{
+  m_memoryUsage -= it->size;
+  m_map.erase(it->key);
+  m_entries.erase(it);
+}
+
+void TilemapCache::shrink()
+{
+  while (m_memoryUsage > m_maxMemory && !m_entries.empty())
+    removeEntry(std::prev(m_entries.end()));
+}
+
+} // namespace render
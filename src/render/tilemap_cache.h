@@ -0,0 +1,95 @@
+// Aseprite Render Library
+// Copyright (c) 2026 Igara Studio S.A.
+//
+// This file is released under the terms of the MIT license.
+// Read LICENSE.txt for more information.
+
+#ifndef RENDER_TILEMAP_CACHE_H_INCLUDED
+#define RENDER_TILEMAP_CACHE_H_INCLUDED
+#pragma once
+
+#include "base/disable_copying.h"
+#include "doc/image_ref.h"
+#include "doc/object_id.h"
+#include "doc/object_version.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <mutex>
+#include <tuple>
+
+namespace doc {
+  class Image;
+  class Tileset;
+}
+
+namespace render {
+
+  // Cache of pre-rendered chunks of tilemaps (kChunkSize x kChunkSize
+  // tiles copied with their flip flags into a regular image) used by
+  // render::Render to composite zoomed out tilemaps as a few big
+  // images instead of one small image per tile (which can be
+  // thousands of tiles in the visible area). Chunks are rendered at
+  // 100%, then the MipmapCache can reduce them as any other image.
+  //
+  // A chunk is discarded when the version of the tilemap or of any
+  // tile image used in the chunk changes, or in LRU order when the
+  // memory usage exceeds the given limit. The cache can be shared
+  // between several render::Render instances (and threads).
+  class TilemapCache {
+  public:
+    // Number of tiles in each side of a chunk
+    static constexpr int kChunkSize = 16;
+
+    explicit TilemapCache(const std::size_t maxMemory);
+
+    std::size_t maxMemory() const;
+    std::size_t memoryUsage() const;
+    void setMaxMemory(const std::size_t maxMemory);
+
+    // Returns the chunk (u, v) of the tilemap (the tiles from
+    // (u*kChunkSize, v*kChunkSize) to the next kChunkSize tiles
+    // clipped to the tilemap bounds) using the tiles of the given
+    // tileset. Returns nullptr if the chunk cannot be pre-rendered
+    // (e.g. a diagonal flip of a non-square tile) and tiles must be
+    // rendered one by one. "cached" is set to true if the chunk was
+    // already in the cache.
+    doc::ImageRef getChunk(const doc::Image* tilemap,
+                           const doc::Tileset* tileset,
+                           const int u, const int v,
+                           bool* cached = nullptr);
+
+    void clear();
+
+  private:
+    // Tilemap image, tileset, and chunk coordinates
+    using Key = std::tuple<doc::ObjectId, doc::ObjectId, int, int>;
+
+    struct Entry {
+      Key key;
+      doc::ObjectVersion tilemapVersion;
+      // Hash of the IDs/versions of the tile images in the chunk
+      uint64_t tilesVersion;
+      doc::ImageRef image;
+      std::size_t size;
+    };
+    using Entries = std::list<Entry>;
+
+    void removeEntry(Entries::iterator it);
+    void shrink();
+
+    mutable std::mutex m_mutex;
+    std::size_t m_maxMemory;
+    std::size_t m_memoryUsage;
+    // Most recently used entries at the beginning of the list
+    Entries m_entries;
+    std::map<Key, Entries::iterator> m_map;
+
+    DISABLE_COPYING(TilemapCache);
+  };
+
+} // namespace render
+
+#endif
@@ -1,5 +1,5 @@
 // Aseprite UI Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -31,6 +31,8 @@
 
 #include <algorithm>
 #include <cctype>
+#include <map>
+#include <mutex>
 #include <string>
 
 namespace ui {
@@ -449,14 +451,91 @@ gfx::Size Graphics::measureUIText(const std::string& str)
     m_font->height());
 }
 
+namespace {
+
+// Cache of measured UI strings. The same strings (widget texts, menu
+// items, layer names, keyboard shortcuts, etc.) are measured several
+// times in each layout/paint, and measuring a string requires
+// shaping it and loading each glyph.
+class TextLengthCache {
+public:
+  static const int kMaxStrings = 8192;
+
+  bool get(os::Font* font, const std::string& str, int& length) {
+    const std::lock_guard lock(m_mutex);
+    auto it = m_fonts.find(FontKey(font, font->height()));
+    if (it == m_fonts.end())
+      return false;
+
+    auto it2 = it->second.lengths.find(str);
+    if (it2 == it->second.lengths.end())
+      return false;
+
+    length = it2->second;
+    return true;
+  }
+
+  void clear() {
+    const std::lock_guard lock(m_mutex);
+    m_fonts.clear();
+    m_count = 0;
+  }
+
+  void set(os::Font* font, const std::string& str, const int length) {
+    const std::lock_guard lock(m_mutex);
+    if (m_count >= kMaxStrings) {
+      m_fonts.clear();
+      m_count = 0;
+    }
+
+    FontStrings& fontStrings = m_fonts[FontKey(font, font->height())];
+    if (!fontStrings.font)
+      fontStrings.font = AddRef(font);
+    if (fontStrings.lengths.insert(std::make_pair(str, length)).second)
+      ++m_count;
+  }
+
+private:
+  using FontKey = std::pair<os::Font*, int>;
+
+  struct FontStrings {
+    // We keep a reference to the font so its address cannot be
+    // re-used by other font while it's in the cache (the cache is
+    // cleared when the theme changes, so fonts are released).
+    os::FontRef font;
+    std::map<std::string, int> lengths;
+  };
+
+  std::mutex m_mutex;
+  std::map<FontKey, FontStrings> m_fonts;
+  int m_count = 0;
+};
+
+TextLengthCache g_textLengthCache;
+
+} // anonymous namespace
+
 // static
 int Graphics::measureUITextLength(const std::string& str, os::Font* font)
 {
+  int length;
+  if (g_textLengthCache.get(font, str, length))
+    return length;
+
   DrawUITextDelegate delegate(nullptr, font, 0);
   os::draw_text(nullptr, font, str,
                 gfx::ColorNone, gfx::ColorNone, 0, 0,
                 &delegate);
-  return delegate.bounds().w;
+
+  length = delegate.bounds().w;
+  g_textLengthCache.set(font, str, length);
+  return length;
+}
+
+// static
+void Graphics::clearUITextCache()
+{
+  g_textLengthCache.clear();
 }
 
 gfx::Size Graphics::fitString(const std::string& str, int maxWidth, int align)
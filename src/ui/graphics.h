@@ -1,5 +1,5 @@
 // Aseprite UI Library
-// Copyright (C) 2019-2022  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -114,6 +114,7 @@ namespace ui {
 
     gfx::Size measureUIText(const std::string& str);
     static int measureUITextLength(const std::string& str, os::Font* font);
+    static void clearUITextCache();
     gfx::Size fitString(const std::string& str, int maxWidth, int align);
 
     // Can be used in case that you've accessed/changed the
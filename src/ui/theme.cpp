@@ -1,5 +1,5 @@
 // Aseprite UI Library
-// Copyright (C) 2019-2024  Igara Studio S.A.
+// Copyright (C) 2019-2026  Igara Studio S.A.
 // Copyright (C) 2001-2018  David Capello
 //
 // This file is released under the terms of the MIT license.
@@ -16,6 +16,7 @@
 #include "os/font.h"
 #include "os/surface.h"
 #include "os/system.h"
+#include "ui/graphics.h"
 #include "ui/intern.h"
 #include "ui/manager.h"
 #include "ui/paint_event.h"
@@ -29,6 +30,8 @@
 
 #include <algorithm>
 #include <cstring>
+#include <map>
+#include <tuple>
 
 namespace ui {
 
@@ -38,6 +41,81 @@ int current_ui_scale = 1;       // Global UI Screen Scaling factor
 int old_ui_scale = 1;           // Add this field in InitThemeEvent
 Theme* current_theme = nullptr; // Global active theme
 
+// Nine-slice parts already composited for a specific size. Widgets
+// of the same type/state use the same size in most cases (buttons,
+// tabs, timeline cels, etc.) so we can draw one surface instead of
+// the nine pieces of the part.
+class SlicesCache {
+public:
+  // Only small parts are cached (big ones are windows/views
+  // backgrounds that aren't repainted so frequently)
+  static const int kMaxPartArea = 256*256;
+  static const int kMaxTotalArea = 4*1024*1024;
+
+  os::Surface* get(os::Surface* sheet,
+                   const gfx::Size& size,
+                   const gfx::Rect& sprite,
+                   const gfx::Rect& slices,
+                   const gfx::Color color,
+                   const bool drawCenter) {
+    if (size.w <= 0 || size.h <= 0 ||
+        size.w*size.h > kMaxPartArea)
+      return nullptr;
+
+    const Key key(sheet, size.w, size.h,
+                  sprite.x, sprite.y, sprite.w, sprite.h,
+                  slices.x, slices.y, slices.w, slices.h,
+                  color, drawCenter);
+    auto it = m_parts.find(key);
+    if (it != m_parts.end())
+      return it->second.surface.get();
+
+    if (m_totalArea + size.w*size.h > kMaxTotalArea)
+      clear();
+
+    os::SurfaceRef surface = os::instance()->makeRgbaSurface(size.w, size.h);
+    if (!surface)
+      return nullptr;
+    {
+      os::SurfaceLock lockSrc(sheet);
+      os::SurfaceLock lockDst(surface.get());
+      surface->clear();
+
+      Paint paint;
+      paint.color(color);
+      surface->drawSurfaceNine(sheet, sprite, slices,
+                               gfx::Rect(size), drawCenter, &paint);
+    }
+
+    m_totalArea += size.w*size.h;
+    m_parts[key] = Entry{ AddRef(sheet), surface };
+    return surface.get();
+  }
+
+  void clear() {
+    m_parts.clear();
+    m_totalArea = 0;
+  }
+
+private:
+  using Key = std::tuple<os::Surface*, int, int,
+                         int, int, int, int,
+                         int, int, int, int,
+                         gfx::Color, bool>;
+
+  struct Entry {
+    // Keep a reference to the sheet so its address is not re-used
+    // while it's in the cache.
+    os::SurfaceRef sheet;
+    os::SurfaceRef surface;
+  };
+
+  std::map<Key, Entry> m_parts;
+  int m_totalArea = 0;
+};
+
+SlicesCache slices_cache;
+
 int compare_layer_flags(int a, int b)
 {
   // TODO improve this
@@ -780,6 +858,10 @@ void set_theme(Theme* theme, const int uiscale)
   old_ui_scale = current_ui_scale;
   current_ui_scale = uiscale;
 
+  // Fonts and sprite sheets might change
+  Graphics::clearUITextCache();
+  slices_cache.clear();
+
   if (theme) {
     theme->regenerateTheme();
 
@@ -821,6 +903,12 @@ void Theme::drawSlices(Graphics* g, os::Surface* sheet,
                        const gfx::Color color,
                        const bool drawCenter)
 {
+  if (os::Surface* part = slices_cache.get(sheet, rc.size(), sprite, slices,
+                                           color, drawCenter)) {
+    g->drawRgbaSurface(part, rc.x, rc.y);
+    return;
+  }
+
   Paint paint;
   paint.color(color);
   g->drawSurfaceNine(sheet, sprite, slices, rc, drawCenter, &paint);
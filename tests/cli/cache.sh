@@ -0,0 +1,38 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+# --cache-dir copies the same outputs when the input didn't change
+
+d=$t/cache
+mkdir -p "$d"
+cp sprites/abcd.aseprite "$d/input.aseprite"
+
+$ASEPRITE -b "$d/input.aseprite" --cache-dir "$d/cache" \
+	  --sheet "$d/sheet.png" --data "$d/sheet.json" \
+	  --save-as "$d/frame{frame}.png" || exit 1
+if [ ! "$(ls $d/cache/*/manifest.txt)" ] ; then
+    echo "FAILED: --cache-dir didn't create a cache entry"
+    exit 1
+fi
+mkdir -p "$d/first"
+mv "$d"/sheet.png "$d"/sheet.json "$d"/frame*.png "$d/first"
+
+# Outputs restored from the cache
+$ASEPRITE -b "$d/input.aseprite" --cache-dir "$d/cache" \
+	  --sheet "$d/sheet.png" --data "$d/sheet.json" \
+	  --save-as "$d/frame{frame}.png" || exit 1
+for fn in $(ls "$d/first") ; do
+    if ! cmp "$d/first/$fn" "$d/$fn" ; then
+	echo "FAILED: $fn wasn't restored from the cache"
+	exit 1
+    fi
+done
+
+# A modified input generates new outputs
+cp sprites/1empty3.aseprite "$d/input.aseprite"
+$ASEPRITE -b "$d/input.aseprite" --cache-dir "$d/cache" \
+	  --sheet "$d/sheet.png" --data "$d/sheet.json" || exit 1
+if cmp "$d/first/sheet.png" "$d/sheet.png" > /dev/null ; then
+    echo "FAILED: --cache-dir restored the outputs of other input file"
+    exit 1
+fi
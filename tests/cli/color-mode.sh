@@ -0,0 +1,21 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+# --color-mode indexed --dithering <algorithm> converts all frames
+
+d=$t/color-mode
+for dithering in none ordered old error-diffusion ; do
+    $ASEPRITE -b sprites/abcd.aseprite \
+	      --color-mode indexed --dithering $dithering \
+	      --save-as "$d/$dithering.aseprite" || exit 1
+    cat >$d/check.lua <<EOF
+local a = app.open("sprites/abcd.aseprite")
+local b = app.open("$d/$dithering.aseprite")
+assert(b.colorMode == ColorMode.INDEXED)
+assert(#a.cels == #b.cels)
+for i,cel in ipairs(b.cels) do
+  assert(cel.image.colorMode == ColorMode.INDEXED)
+end
+EOF
+    $ASEPRITE -b -script "$d/check.lua" || exit 1
+done
@@ -0,0 +1,37 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+# --profile
+
+d=$t/profile
+out=$($ASEPRITE -b sprites/abcd.aseprite --profile --save-as "$d/abcd.png") || exit 1
+for phase in decode encode ; do
+    if ! echo "$out" | grep "^  $phase " > /dev/null ; then
+        echo "FAILED: --profile doesn't include the $phase phase"
+        echo "$out"
+        exit 1
+    fi
+done
+
+# --profile-trace
+
+$ASEPRITE -b sprites/abcd.aseprite \
+	  --profile-trace "$d/trace.json" \
+	  --sheet "$d/sheet.png" --data "$d/sheet.json" > /dev/null || exit 1
+cat >$d/check.lua <<EOF
+local f = io.open("$d/trace.json")
+local text = f:read("a")
+f:close()
+local trace = json.decode(text)
+local phases = {}
+for _,ev in ipairs(trace.traceEvents) do
+  assert(ev.ph == "X")
+  phases[ev.name] = true
+end
+assert(phases["decode"])
+assert(phases["render"])
+assert(phases["sheet pack"])
+assert(phases["data file"])
+assert(phases["encode"])
+EOF
+$ASEPRITE -b -script "$d/check.lua" || exit 1
@@ -1,5 +1,5 @@
 #! /bin/bash
-# Copyright (C) 2018-2023 Igara Studio S.A.
+# Copyright (C) 2018-2026 Igara Studio S.A.
 
 function list_files() {
     oldwd=$(pwd $PWDARG)
@@ -407,3 +407,55 @@ assert(d3.bounds == Rectangle(0, 0, 6, 4))
 assert(d4.bounds == Rectangle(0, 0, 8, 4))
 EOF
 $ASEPRITE -b -script "$d/compare.lua" || exit 1
+
+# --compression-level --save-as
+
+d=$t/save-as-compression-level
+$ASEPRITE -b sprites/groups3abc.aseprite --compression-level 0 --save-as "$d/level0.aseprite" || exit 1
+$ASEPRITE -b sprites/groups3abc.aseprite --compression-level 9 --save-as "$d/level9.aseprite" || exit 1
+cat >$d/compare.lua <<EOF
+local a = app.open("sprites/groups3abc.aseprite")
+local b = app.open("$d/level0.aseprite")
+local c = app.open("$d/level9.aseprite")
+for i,cel in ipairs(a.cels) do
+  assert(cel.image:isEqual(b.cels[i].image))
+  assert(cel.image:isEqual(c.cels[i].image))
+end
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
+
+# --png-preset --save-as
+
+d=$t/save-as-png-preset
+$ASEPRITE -b sprites/1empty3.aseprite --png-preset fast --save-as "$d/fast.png" || exit 1
+$ASEPRITE -b sprites/1empty3.aseprite --png-preset small --save-as "$d/small.png" || exit 1
+cat >$d/compare.lua <<EOF
+local a = app.open("$d/fast.png")
+local b = app.open("$d/small.png")
+assert(a.bounds == b.bounds)
+assert(a.cels[1].image:isEqual(b.cels[1].image))
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
+
+# --jobs --save-as (the result must be the same without --jobs)
+
+d=$t/save-as-jobs
+$ASEPRITE -b sprites/1empty3.aseprite --save-as "$d/1/a.png" \
+	  sprites/groups3abc.aseprite --save-as "$d/1/b.png" \
+	  sprites/abcd.aseprite --save-as "$d/1/c.png" || exit 1
+$ASEPRITE -b --jobs 3 \
+	  sprites/1empty3.aseprite --save-as "$d/2/a.png" \
+	  sprites/groups3abc.aseprite --save-as "$d/2/b.png" \
+	  sprites/abcd.aseprite --save-as "$d/2/c.png" || exit 1
+cat >$d/compare.lua <<EOF
+for _,fn in ipairs({ "a1.png", "b.png", "c.png" }) do
+  local a = app.open("$d/1/" .. fn)
+  local b = app.open("$d/2/" .. fn)
+  assert(a.bounds == b.bounds)
+  assert(#a.frames == #b.frames)
+  for i,cel in ipairs(a.cels) do
+    assert(cel.image:isEqual(b.cels[i].image))
+  end
+end
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
@@ -0,0 +1,37 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+# Huge frames are rendered in bands while they are saved (the result
+# must be the same as rendering the whole frame)
+
+d=$t/save-in-bands
+mkdir -p "$d"
+cat >$d/create.lua <<EOF
+local spr = Sprite(4100, 4100)
+local img = spr.cels[1].image
+for i=0,4099,7 do
+  img:drawPixel(i, i, Color(255, 0, 0))
+  img:drawPixel(4099-i, i, Color(0, 0, 255, 128))
+  img:drawPixel(i, 2050, Color(0, 255, 0))
+end
+spr:saveAs("$d/big.aseprite")
+EOF
+$ASEPRITE -b -script "$d/create.lua" || exit 1
+
+$ASEPRITE -b "$d/big.aseprite" --save-as "$d/big.png" || exit 1
+$ASEPRITE -b "$d/big.aseprite" --save-as "$d/big.bmp" || exit 1
+
+cat >$d/compare.lua <<EOF
+local a = Image(app.open("$d/big.aseprite"))
+local b = Image(app.open("$d/big.png"))
+assert(a:isEqual(b))
+
+-- BMP rows are saved from bottom to top (only opaque pixels are
+-- compared)
+local c = Image(app.open("$d/big.bmp"))
+assert(c.width == a.width and c.height == a.height)
+assert(c:getPixel(0, 0) == app.pixelColor.rgba(255, 0, 0))
+assert(c:getPixel(7, 2050) == app.pixelColor.rgba(0, 255, 0))
+assert(c:getPixel(4095, 4095) == app.pixelColor.rgba(255, 0, 0))
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
@@ -0,0 +1,35 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+# --server processes several requests in the same process
+
+d=$t/server
+mkdir $d
+$ASEPRITE --server > "$d/responses.txt" <<EOF
+{ "id": 1, "cmd": "open", "filename": "sprites/1empty3.aseprite" }
+{ "id": 2, "cmd": "export", "args": [ "sprites/abcd.aseprite", "--save-as", "$d/abcd.png" ] }
+{ "id": 3, "cmd": "unknown" }
+{ "id": 4, "cmd": "close" }
+{ "id": 5, "cmd": "quit" }
+{ "id": 6, "cmd": "close" }
+EOF
+
+# Prints the n-th response (with a fixed document ID)
+function server_response() {
+    sed -n "$1p" $d/responses.txt | sed -e 's/"doc": [0-9]*/"doc": 0/'
+}
+function count_server_responses() {
+    cat $d/responses.txt | wc -l | tr -d ' '
+}
+
+expect '{"doc": 0, "frames": 3, "height": 32, "id": 1, "ok": true, "width": 32}' "server_response 1"
+expect '{"code": 0, "id": 2, "ok": true}' "server_response 2"
+expect '{"error": "Unknown command: unknown", "id": 3, "ok": false}' "server_response 3"
+expect '{"id": 4, "ok": true}' "server_response 4"
+expect '{"id": 5, "ok": true}' "server_response 5"
+expect 5 "count_server_responses"
+
+if [ ! -f "$d/abcd.png" ] ; then
+    echo "FAILED: $d/abcd.png wasn't created"
+    exit 1
+fi
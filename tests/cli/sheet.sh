@@ -1,5 +1,5 @@
 #! /bin/bash
-# Copyright (C) 2019-2022 Igara Studio S.A.
+# Copyright (C) 2019-2026 Igara Studio S.A.
 
 # $1 = first sprite sheet json file
 # $2 = second sprite sheet json file
@@ -416,3 +416,50 @@ t = tags["tags3-reverse"]  assert(t.from == 4 and t.to == 7)
 t = tags["tags3-pingpong"] assert(t.from == 8 and t.to == 11)
 EOF
 $ASEPRITE -b -script "$d/compare.lua" || exit 1
+
+# --sheet-cache gives the same result re-using the cached samples
+d=$t/sheet-cache
+for i in 1 2 ; do
+    $ASEPRITE -b "sprites/1empty3.aseprite" "sprites/tags3.aseprite" \
+	      -sheet-type packed -trim -sheet-cache "$d/cache" \
+	      -data "$d/atlas$i.json" -sheet "$d/atlas$i.png" || exit 1
+done
+if [ ! "$(ls $d/cache/*.sample)" ] ; then
+    echo "FAILED: --sheet-cache didn't create cached samples"
+    exit 1
+fi
+compare_sheet_data $d/atlas1.json $d/atlas2.json || exit 1
+cat >$d/compare.lua <<EOF
+local a = app.open("$d/atlas1.png")
+local b = app.open("$d/atlas2.png")
+assert(a.cels[1].image:isEqual(b.cels[1].image))
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
+
+# --sheet-max-size splits the sheet in several pages
+d=$t/sheet-pages
+$ASEPRITE -b "sprites/1empty3.aseprite" \
+	  -sheet-type packed -sheet-max-size 40,40 \
+	  -data "$d/atlas.json" -sheet "$d/atlas.png" || exit 1
+for i in 0 1 2 ; do
+    if [ ! -f "$d/atlas-$i.png" ] ; then
+	echo "FAILED: $d/atlas-$i.png wasn't created"
+	exit 1
+    fi
+done
+cat >$d/compare.lua <<EOF
+local data = json.decode(io.open('$d/atlas.json'):read('a'))
+assert(#data.meta.pages == 3)
+local pages = {}
+for k,v in pairs(data.frames) do
+  assert(v.frame.x == 0 and v.frame.y == 0)
+  pages[v.page] = true
+end
+assert(pages[0] and pages[1] and pages[2])
+for i = 0,2 do
+  local page = data.meta.pages[i+1]
+  assert(page.image == "atlas-" .. i .. ".png")
+  assert(page.size.w == 32 and page.size.h == 32)
+end
+EOF
+$ASEPRITE -b -script "$d/compare.lua" || exit 1
@@ -0,0 +1,12 @@
+#! /bin/bash
+# Copyright (C) 2026 Igara Studio S.A.
+
+if ! $ASEPRITE -b --startup-profile | grep "startup: total" > /dev/null ; then
+    echo "FAILED: --startup-profile doesn't include the total startup time"
+    exit 1
+fi
+
+if $ASEPRITE -b sprites/abcd.aseprite --list-layers | grep "startup:" > /dev/null ; then
+    echo "FAILED: startup times printed without --startup-profile"
+    exit 1
+fi
@@ -1,3 +1,4 @@
+-- Copyright (C) 2026  Igara Studio S.A.
 -- Copyright (C) 2018  David Capello
 --
 -- This file is released under the terms of the MIT license.
@@ -38,3 +39,36 @@ assert(s.height == 32)
 app.redo()
 assert(s.width == 20)
 assert(s.height == 40)
+
+-- Commands of the same kind in one transaction are merged
+do
+  local s = Sprite(32, 32)
+  local cel = s.cels[1]
+  local img = Image(2, 2)
+  img:clear(Color(255, 0, 0))
+  app.transaction(
+    function()
+      for i=1,100 do
+        cel.position = Point(i, i*2)
+        cel.opacity = i
+      end
+      for i=0,15 do
+        cel.image:drawImage(img, Point(i*2, 0))
+      end
+    end)
+  assert(cel.position == Point(100, 200))
+  assert(cel.opacity == 100)
+  assert(cel.image:getPixel(31, 1) == app.pixelColor.rgba(255, 0, 0))
+
+  app.undo()
+  assert(cel.position == Point(0, 0))
+  assert(cel.opacity == 255)
+  assert(cel.image:getPixel(0, 0) == 0)
+  assert(cel.image:getPixel(31, 1) == 0)
+
+  app.redo()
+  assert(cel.position == Point(100, 200))
+  assert(cel.opacity == 100)
+  assert(cel.image:getPixel(0, 0) == app.pixelColor.rgba(255, 0, 0))
+  assert(cel.image:getPixel(31, 1) == app.pixelColor.rgba(255, 0, 0))
+end
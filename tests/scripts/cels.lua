@@ -1,4 +1,4 @@
--- Copyright (C) 2020  Igara Studio S.A.
+-- Copyright (C) 2020-2026  Igara Studio S.A.
 -- Copyright (C) 2018  David Capello
 --
 -- This file is released under the terms of the MIT license.
@@ -84,3 +84,39 @@ do
   app.undo()
 
 end
+
+-- Collections are updated when cels/layers are added/removed
+do
+  local s = Sprite(4, 4)
+  local a = s.layers[1]
+  local cels = s.cels
+  local layers = s.layers
+  assert(cels == s.cels)
+  assert(#cels == 1)
+  assert(#layers == 1)
+
+  local b = s:newLayer()
+  b.name = "b"
+  assert(#layers == 2)
+  assert(layers[2] == b)
+  assert(layers.b == b)
+
+  s:newFrame()
+  assert(#cels == 2)
+  s:newCel(b, 2)
+  assert(#cels == 3)
+  assert(#b.cels == 1)
+
+  s:cel(b, 2).frameNumber = 1
+  assert(b.cels[1].frameNumber == 1)
+  assert(s:cel(b, 2) == nil)
+
+  s:deleteLayer(b)
+  assert(#layers == 1)
+  assert(#cels == 2)
+
+  -- Sprite:cel()
+  assert(s:cel(a, 1) == a:cel(1))
+  assert(s:cel("Layer 1", 2) == a:cel(2))
+  assert(s:cel(a, 3) == nil)
+end
@@ -1,4 +1,4 @@
--- Copyright (C) 2019-2022  Igara Studio S.A.
+-- Copyright (C) 2019-2026  Igara Studio S.A.
 --
 -- This file is released under the terms of the MIT license.
 -- Read LICENSE.txt for more information.
@@ -199,3 +199,39 @@ do
                    1, 0,
                    0, 0 })
 end
+
+----------------------------------------------------------------------
+-- Conversion of several cels (converted in parallel) gives the same
+-- result in each cel
+
+do
+  local s = Sprite(3, 2, ColorMode.RGB)
+  local p = Palette(4)
+  p:setColor(0, Color(0, 0, 0, 0))
+  p:setColor(1, Color(255, 0, 0))
+  p:setColor(2, Color(0, 255, 0))
+  p:setColor(3, Color(0, 0, 255))
+  s:setPalette(p)
+
+  for i=2,32 do
+    s:newEmptyFrame()
+  end
+  for i,frame in ipairs(s.frames) do
+    local cel = s:newCel(s.layers[1], frame)
+    local c = 1+(i % 3)
+    array_to_pixels({ p:getColor(c).rgbaPixel, p:getColor(0).rgbaPixel, p:getColor(3).rgbaPixel,
+                      p:getColor(2).rgbaPixel, p:getColor(c).rgbaPixel, p:getColor(1).rgbaPixel },
+                    cel.image)
+  end
+
+  for _,rgbmap in ipairs({ "rgb5a3", "octree" }) do
+    app.command.ChangePixelFormat{ format="indexed", rgbmap=rgbmap }
+    assert(s.colorMode == ColorMode.INDEXED)
+    for i,cel in ipairs(s.cels) do
+      local c = 1+(cel.frameNumber % 3)
+      expect_img(cel.image, { c, 0, 3,
+                              2, c, 1 })
+    end
+    app.undo()
+  end
+end
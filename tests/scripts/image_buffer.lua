@@ -0,0 +1,54 @@
+-- Copyright (C) 2026  Igara Studio S.A.
+--
+-- This file is released under the terms of the MIT license.
+-- Read LICENSE.txt for more information.
+
+dofile('./test_utils.lua')
+
+local rgba = app.pixelColor.rgba
+
+do
+  local img = Image(2, 2, ColorMode.INDEXED)
+  local buf = img.buffer
+  assert(#buf == 4)
+
+  local version = img.version
+  buf:setU8(3, 5)
+  assert(img.version > version)
+  assert(buf:u8(3) == 5)
+  expect_img(img, { 0, 0,
+                    0, 5 })
+
+  buf:fill(2, 0, 2)
+  expect_img(img, { 2, 2,
+                    0, 5 })
+
+  buf:copy(2, '\7\8')
+  expect_img(img, { 2, 2,
+                    7, 8 })
+  assert(buf:read() == '\2\2\7\8')
+  assert(buf:read(1, 2) == '\2\7')
+
+  -- Copy inside the same buffer
+  buf:copy(0, buf, 2, 2)
+  expect_img(img, { 7, 8,
+                    7, 8 })
+
+  assert(not pcall(function() buf:u8(4) end))
+  assert(not pcall(function() buf:fill(0, 3, 2) end))
+end
+
+do
+  local img = Image(2, 1)
+  local buf = img.buffer
+  buf:setU32(1, rgba(1, 2, 3, 4))
+  assert(buf:u32(1) == rgba(1, 2, 3, 4))
+  buf:fillU32(rgba(255, 0, 0, 255), 0, 1)
+  expect_img(img, { rgba(255, 0, 0, 255), rgba(1, 2, 3, 4) })
+
+  -- Image.bytes is a copy, Image.buffer is a view
+  local bytes = img.bytes
+  buf:fill(0)
+  assert(img:isEmpty())
+  assert(bytes ~= img.bytes)
+end
@@ -0,0 +1,80 @@
+-- Copyright (C) 2026  Igara Studio S.A.
+--
+-- This file is released under the terms of the MIT license.
+-- Read LICENSE.txt for more information.
+
+dofile('./test_utils.lua')
+
+local rgba = app.pixelColor.rgba
+local graya = app.pixelColor.graya
+
+-- Image:replaceColors()
+do
+  local img = Image(3, 1, ColorMode.INDEXED)
+  array_to_pixels({ 1, 2, 3 }, img)
+  assert(img:replaceColors{ [1]=4, [3]=5 } == 2)
+  expect_img(img, { 4, 2, 5 })
+end
+
+-- Image:mapPixels()
+do
+  local img = Image(3, 1, ColorMode.INDEXED)
+  array_to_pixels({ 0, 1, 2 }, img)
+  img:mapPixels{ [0]=7, [2]=9 }
+  expect_img(img, { 7, 1, 9 })
+
+  local lut = {}
+  for i=0,255 do lut[i] = 255-i end
+  local rgb = Image(2, 1)
+  array_to_pixels({ rgba(0, 10, 20, 255), rgba(255, 255, 255, 128) }, rgb)
+  rgb:mapPixels(lut)
+  expect_img(rgb, { rgba(255, 245, 235, 255), rgba(0, 0, 0, 128) })
+  rgb:mapPixels{ a={ [255]=0 } }
+  expect_img(rgb, { rgba(255, 245, 235, 0), rgba(0, 0, 0, 128) })
+end
+
+-- Image:adjustChannels()
+do
+  local img = Image(2, 1, ColorMode.GRAYSCALE)
+  array_to_pixels({ graya(10, 255), graya(200, 100) }, img)
+  img:adjustChannels{ multiply=2, add={ a=-50 } }
+  expect_img(img, { graya(20, 205), graya(255, 50) })
+end
+
+-- Image:fillWhere()
+do
+  local img = Image(3, 1)
+  array_to_pixels({ rgba(100, 0, 0, 255),
+                    rgba(104, 0, 0, 255),
+                    rgba(120, 0, 0, 255) }, img)
+  assert(img:fillWhere(rgba(100, 0, 0, 255), rgba(0, 0, 255, 255), 4) == 2)
+  expect_img(img, { rgba(0, 0, 255, 255),
+                    rgba(0, 0, 255, 255),
+                    rgba(120, 0, 0, 255) })
+end
+
+-- Image:applyKernel()
+do
+  local img = Image(3, 3, ColorMode.GRAYSCALE)
+  array_to_pixels({ 0, 0, 0,
+                    0, graya(90, 90), 0,
+                    0, 0, 0 }, img)
+  img:applyKernel({ 1, 1, 1,
+                    1, 1, 1,
+                    1, 1, 1 })
+  local p = graya(10, 10)
+  expect_img(img, { p, p, p,
+                    p, p, p,
+                    p, p, p })
+end
+
+-- With undo
+do
+  local spr = Sprite(2, 1, ColorMode.INDEXED)
+  local img = app.image
+  array_to_pixels({ 1, 2 }, img)
+  img:replaceColors{ [2]=3 }
+  expect_img(img, { 1, 3 })
+  app.undo()
+  expect_img(img, { 1, 2 })
+end
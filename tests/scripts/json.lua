@@ -1,4 +1,4 @@
--- Copyright (C) 2023  Igara Studio S.A.
+-- Copyright (C) 2023-2026  Igara Studio S.A.
 --
 -- This file is released under the terms of the MIT license.
 -- Read LICENSE.txt for more information.
@@ -101,3 +101,51 @@ do
 
   assert(tostring(o) == '{"a": [10, 20, 30, 40], "b": {"c": 1, "d": 2}}')
 end
+
+-- Lazy decode
+do
+  local o = json.decode('{"a":true, "b":5, "c":[1,3,{"d":"x\\ny\\u00e1"}], "e":null}',
+                        { lazy=true })
+  assert(#o == 4)
+  assert(o.a == true)
+  assert(o.b == 5)
+  assert(#o.c == 3)
+  assert(o.c[1] == 1)
+  assert(o.c[3].d == "x\ny\u{e1}")
+  assert(o.e == nil)
+  assert(o.f == nil)
+  assert(o.c == o.c)
+  assert(tostring(o.c) == '[1,3,{"d":"x\\ny\\u00e1"}]')
+
+  local keys = {}
+  for k,v in pairs(o) do table.insert(keys, k) end
+  assert(#keys == 4)
+  assert(keys[1] == "a" and keys[4] == "e")
+
+  -- Read-only
+  assert(not pcall(function() o.a = false end))
+
+  -- Invalid JSON
+  assert(not pcall(function() json.decode('{"a":1,}', { lazy=true }) end))
+  assert(not pcall(function() json.decode('[1] 2', { lazy=true }) end))
+
+  -- Encode lazy values
+  assert(json.encode({ x=o.c }) == '{"x": [1,3,{"d":"x\\ny\\u00e1"}]}')
+end
+
+-- Encode tables with numeric keys and strings with escaped chars
+do
+  assert(json.encode({ [1]="a", b="\"\n" }) == '{"1": "a", "b": "\\"\\n"}')
+end
+
+-- Encode/decode files
+do
+  local fn = app.fs.joinPath(app.fs.tempPath, "_test_json.json")
+  json.encodeFile(fn, { a=4, b={ 1, 2 } })
+  local o = json.decodeFile(fn)
+  assert(o.a == 4)
+  assert(o.b[2] == 2)
+  o = json.decodeFile(fn, { lazy=true })
+  assert(o.a == 4)
+  assert(o.b[2] == 2)
+end
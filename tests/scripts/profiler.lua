@@ -0,0 +1,26 @@
+-- Copyright (C) 2026  Igara Studio S.A.
+--
+-- This file is released under the terms of the MIT license.
+-- Read LICENSE.txt for more information.
+
+local function busy_function()
+  local x = 0
+  for i=1,200000 do
+    x = x + math.sin(i)
+  end
+  return x
+end
+
+assert(not app.profiler.isRunning())
+app.profiler.start(100)
+assert(app.profiler.isRunning())
+busy_function()
+app.profiler.stop()
+assert(not app.profiler.isRunning())
+
+local report = app.profiler.report()
+assert(report:find("busy_function", 1, true))
+
+app.profiler.reset()
+report = app.profiler.report()
+assert(not report:find("busy_function", 1, true))
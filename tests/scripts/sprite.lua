@@ -1,4 +1,4 @@
--- Copyright (C) 2019-2023  Igara Studio S.A.
+-- Copyright (C) 2019-2026  Igara Studio S.A.
 -- Copyright (C) 2018  David Capello
 --
 -- This file is released under the terms of the MIT license.
@@ -228,3 +228,54 @@ do
   c = app.open(fn)
   assert(c.tileManagementPlugin == nil)
 end
+
+-- Memory usage
+do
+  local s = Sprite(32, 32)
+  local m = s.memoryUsage
+  assert(m.images >= 32*32*4)
+  assert(m.tilesets == 0)
+  assert(m.total == m.images + m.tilesets + m.tilesetsCache + m.celsCache + m.undo + m.render)
+
+  app.command.NewFrame()
+  local m2 = s.memoryUsage
+  assert(m2.images >= 2*32*32*4)
+  assert(m2.total > m.total)
+end
+
+-- Sprite:renderFrames()
+do
+  local rgba = app.pixelColor.rgba
+  local spr = Sprite(2, 1)
+  local red = rgba(255, 0, 0, 255)
+  local blue = rgba(0, 0, 255, 255)
+  spr:newFrame()
+  spr.cels[1].image:putPixel(0, 0, red)
+  spr.cels[2].image:putPixel(1, 0, blue)
+
+  local imgs = spr:renderFrames()
+  assert(#imgs == 2)
+  assert(imgs[1]:getPixel(0, 0) == red)
+  assert(imgs[1]:getPixel(1, 0) == 0)
+  assert(imgs[2]:getPixel(1, 0) == blue)
+
+  imgs = spr:renderFrames{ frames={ 2 }, scale=2, parallel=false }
+  assert(#imgs == 1)
+  assert(imgs[1].width == 4)
+  assert(imgs[1].height == 2)
+  assert(imgs[1]:getPixel(2, 1) == blue)
+  assert(imgs[1]:getPixel(3, 0) == blue)
+  assert(imgs[1]:getPixel(1, 0) == 0)
+
+  -- Only the given layers are rendered
+  local lay2 = spr:newLayer()
+  local img = Image(2, 1)
+  img:putPixel(1, 0, blue)
+  spr:newCel(lay2, 1, img)
+  imgs = spr:renderFrames{ frames={ 1 }, layers={ lay2 } }
+  assert(imgs[1]:getPixel(0, 0) == 0)
+  assert(imgs[1]:getPixel(1, 0) == blue)
+  assert(spr.layers[1].isVisible)
+
+  assert(not pcall(function() spr:renderFrames{ frames={ 3 } } end))
+end
@@ -0,0 +1,97 @@
+-- Copyright (C) 2026  Igara Studio S.A.
+--
+-- This file is released under the terms of the MIT license.
+-- Read LICENSE.txt for more information.
+
+dofile('./test_utils.lua')
+
+local rgba = app.pixelColor.rgba
+
+-- Copy arguments and results
+do
+  local result
+  local w = app.worker{
+    func=function(a, b, t)
+      return a + b, t.name, { x=t.values[2] }
+    end,
+    args={ 1, 2, { name="test", values={ 10, 20 } } },
+    onresult=function(...) result = { ... } end
+  }
+  local ok, sum, name, t = w:wait()
+  assert(ok)
+  assert(sum == 3)
+  assert(name == "test")
+  assert(t.x == 20)
+  assert(w.isDone)
+  assert(result[1] == 3)
+end
+
+-- Image snapshots are read-only
+do
+  local img = Image(2, 1)
+  array_to_pixels({ rgba(255, 0, 0), rgba(0, 0, 255) }, img)
+
+  local w = app.worker{
+    func=function(img)
+      local out = Image(img.width, img.height, img.colorMode)
+      for x=0,img.width-1 do
+        out:putPixel(img.width-1-x, 0, img:getPixel(x, 0))
+      end
+      return out
+    end,
+    args={ img }
+  }
+  -- Modifying the original image doesn't change the snapshot
+  img:clear()
+
+  local ok, out = w:wait()
+  assert(ok)
+  expect_img(out, { rgba(0, 0, 255), rgba(255, 0, 0) })
+
+  w = app.worker{
+    func=function(img) img:putPixel(0, 0, 0) end,
+    args={ img }
+  }
+  local ok, msg = w:wait()
+  assert(not ok)
+  assert(msg:find("read-only"))
+end
+
+-- Errors
+do
+  local err
+  local w = app.worker{
+    func="error('worker error')",
+    onerror=function(msg) err = msg end
+  }
+  local ok, msg = w:wait()
+  assert(not ok)
+  assert(msg:find("worker error"))
+  assert(err == msg)
+
+  -- Functions cannot use local variables from the main state
+  local x = 1
+  assert(not pcall(function()
+    app.worker{ func=function() return x end }
+  end))
+
+  -- Sprites cannot be copied
+  local spr = Sprite(2, 2)
+  assert(not pcall(function()
+    app.worker{ func=function() end, args={ spr } }
+  end))
+
+  -- Workers don't have access to the file system
+  w = app.worker{ func=function() return io, os, dofile end }
+  local ok, a, b, c = w:wait()
+  assert(ok and a == nil and b == nil and c == nil)
+end
+
+-- Cancel
+do
+  local w = app.worker{ func=function() while true do end end }
+  w:cancel()
+  local ok, msg = w:wait()
+  assert(not ok)
+  assert(msg:find("canceled"))
+end